@@ -0,0 +1,82 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   BenchmarkData.h
+ * @brief  Data shared by the benchmarks: the stereo pairs of the test data.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <string>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kimera-vio/frontend/CameraParams.h"
+#include "kimera-vio/frontend/StereoCamera.h"
+#include "kimera-vio/frontend/StereoFrame.h"
+#include "kimera-vio/frontend/VisionImuFrontendParams.h"
+#include "kimera-vio/utils/UtilsOpenCV.h"
+
+DECLARE_string(bench_data_path);
+
+namespace VIO {
+
+/**
+ * @brief The StereoBenchmarkData struct holds two consecutive stereo pairs
+ * (ForStereoFrame test data), with the default frontend params.
+ */
+struct StereoBenchmarkData {
+  StereoBenchmarkData()
+      : data_path_(FLAGS_bench_data_path + "/ForStereoFrame/"),
+        frontend_params_(),
+        cam_params_left_(),
+        cam_params_right_(),
+        stereo_camera_(nullptr) {
+    cam_params_left_.parseYAML(data_path_ + "sensorLeft.yaml");
+    cam_params_right_.parseYAML(data_path_ + "sensorRight.yaml");
+    stereo_camera_ =
+        std::make_shared<StereoCamera>(cam_params_left_, cam_params_right_);
+    for (size_t k = 0u; k < 2u; ++k) {
+      const std::string suffix = "_img_" + std::to_string(k) + ".png";
+      left_imgs_[k] = UtilsOpenCV::ReadAndConvertToGrayScale(
+          data_path_ + "left" + suffix,
+          frontend_params_.stereo_matching_params_.equalize_image_);
+      right_imgs_[k] = UtilsOpenCV::ReadAndConvertToGrayScale(
+          data_path_ + "right" + suffix,
+          frontend_params_.stereo_matching_params_.equalize_image_);
+      CHECK(!left_imgs_[k].empty() && !right_imgs_[k].empty())
+          << "Cannot read the images in " << data_path_
+          << ", see the bench_data_path flag.";
+    }
+  }
+
+  //! Stereo frame of the k-th (0 or 1) pair, without keypoints.
+  StereoFrame makeStereoFrame(const size_t& k) const {
+    CHECK_LT(k, 2u);
+    const FrameId id = k;
+    const Timestamp timestamp = 100000000 * (k + 1);
+    return StereoFrame(
+        id,
+        timestamp,
+        Frame(id, timestamp, cam_params_left_, left_imgs_[k]),
+        Frame(id, timestamp, cam_params_right_, right_imgs_[k]));
+  }
+
+  const std::string data_path_;
+  FrontendParams frontend_params_;
+  CameraParams cam_params_left_;
+  CameraParams cam_params_right_;
+  StereoCamera::Ptr stereo_camera_;
+  cv::Mat left_imgs_[2];
+  cv::Mat right_imgs_[2];
+};
+
+}  // namespace VIO
@@ -0,0 +1,183 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   benchBackend.cpp
+ * @brief  Benchmarks of the backend optimization, on a synthetic sequence of
+ * stereo keyframes (the scene of testVioBackend, with more landmarks).
+ * @author Antoni Rosinol
+ */
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <gtsam/geometry/Cal3_S2.h>
+#include <gtsam/geometry/PinholeCamera.h>
+
+#include "kimera-vio/backend/VioBackendFactory.h"
+#include "kimera-vio/imu-frontend/ImuFrontend.h"
+
+namespace VIO {
+
+namespace {
+//! Keyframes at 5Hz, IMU at 200Hz.
+constexpr Timestamp kKeyframeTimeStep = 200000000;
+constexpr Timestamp kImuTimeStep = 5000000;
+constexpr double kBaseline = 0.11;
+constexpr size_t kNrKeyframes = 30u;
+
+/**
+ * @brief The SyntheticBackendData struct: a stereo camera moving at constant
+ * velocity along x, looking at a wall of landmarks 5m away, and the
+ * measurements and IMU data of its keyframes.
+ */
+struct SyntheticBackendData {
+  explicit SyntheticBackendData(const size_t& nr_landmarks)
+      : cal_(458.0, 458.0, 0.0, 376.0, 240.0),
+        velocity_(0.5, 0.0, 0.0),
+        imu_bias_() {
+    imu_params_.gyro_noise_density_ = 0.00016968;
+    imu_params_.acc_noise_density_ = 0.002;
+    imu_params_.gyro_random_walk_ = 1.9393e-05;
+    imu_params_.acc_random_walk_ = 0.003;
+    imu_params_.n_gravity_ = gtsam::Vector3(0.0, 0.0, -9.81);
+    imu_params_.imu_integration_sigma_ = 1.0e-8;
+    imu_params_.nominal_sampling_time_s_ = kImuTimeStep * 1e-9;
+
+    backend_params_.nr_states_ = kNrKeyframes;
+    backend_params_.landmarkDistanceThreshold_ = 20.0;
+    backend_params_.initial_ground_truth_state_ =
+        VioNavState(gtsam::Pose3(), velocity_, imu_bias_);
+
+    // Landmarks on a grid, covering the field of view along the trajectory.
+    const double trajectory_length =
+        velocity_.x() * kNrKeyframes * kKeyframeTimeStep * 1e-9;
+    const size_t nr_cols = std::ceil(std::sqrt(2.0 * nr_landmarks));
+    const size_t nr_rows = std::ceil(nr_landmarks / double(nr_cols));
+    std::vector<gtsam::Point3> landmarks;
+    const size_t max_col = std::max(nr_cols - 1u, size_t{1});
+    for (size_t i = 0u; i < nr_landmarks; ++i) {
+      const double x =
+          -4.0 + (trajectory_length + 8.0) * (i % nr_cols) / max_col;
+      const double y = -3.0 + 6.0 * (i / nr_cols) / nr_rows;
+      landmarks.push_back(gtsam::Point3(x, y, 5.0));
+    }
+
+    TrackerStatusSummary tracker_status;
+    tracker_status.kfTrackingStatus_mono_ = TrackingStatus::VALID;
+    tracker_status.kfTrackingStatus_stereo_ = TrackingStatus::VALID;
+    const gtsam::Pose3 L_Pose_R(gtsam::Rot3(), gtsam::Point3(kBaseline, 0, 0));
+    nr_measurements_ = 0u;
+    for (size_t k = 0u; k < kNrKeyframes; ++k) {
+      const double t = k * kKeyframeTimeStep * 1e-9;
+      const gtsam::Pose3 W_Pose_L(gtsam::Rot3(), gtsam::Point3(velocity_ * t));
+      const gtsam::PinholeCamera<gtsam::Cal3_S2> left_cam(W_Pose_L, cal_);
+      const gtsam::PinholeCamera<gtsam::Cal3_S2> right_cam(
+          W_Pose_L.compose(L_Pose_R), cal_);
+      StereoMeasurements measurements;
+      for (size_t l = 0u; l < landmarks.size(); ++l) {
+        const gtsam::Point2 px_left = left_cam.project(landmarks[l]);
+        const gtsam::Point2 px_right = right_cam.project(landmarks[l]);
+        if (px_left.x() < 0.0 || px_left.x() >= 752.0 || px_left.y() < 0.0 ||
+            px_left.y() >= 480.0 || px_right.x() < 0.0) {
+          continue;
+        }
+        measurements.push_back(std::make_pair(
+            l, gtsam::StereoPoint2(px_left.x(), px_right.x(), px_left.y())));
+      }
+      nr_measurements_ += measurements.size();
+      measurements_.push_back(std::make_shared<StatusStereoMeasurements>(
+          std::make_pair(tracker_status, measurements)));
+    }
+
+    // Constant velocity: the IMU only measures gravity and the biases.
+    const size_t nr_imu_per_keyframe = kKeyframeTimeStep / kImuTimeStep;
+    imu_stamps_.resize(1, nr_imu_per_keyframe + 1u);
+    imu_accgyrs_.resize(6, nr_imu_per_keyframe + 1u);
+    for (size_t i = 0u; i <= nr_imu_per_keyframe; ++i) {
+      imu_stamps_(i) = i * kImuTimeStep;
+      imu_accgyrs_.col(i) << -imu_params_.n_gravity_ +
+                                 imu_bias_.accelerometer(),
+          imu_bias_.gyroscope();
+    }
+  }
+
+  //! Stamps of the IMU data in between keyframes k-1 and k.
+  ImuStampS getImuStamps(const size_t& k) const {
+    return (imu_stamps_.array() + Timestamp(k * kKeyframeTimeStep)).matrix();
+  }
+
+  gtsam::Cal3_S2 cal_;
+  gtsam::Vector3 velocity_;
+  ImuBias imu_bias_;
+  ImuParams imu_params_;
+  BackendParams backend_params_;
+  std::vector<StatusStereoMeasurementsPtr> measurements_;
+  size_t nr_measurements_;
+  ImuStampS imu_stamps_;
+  ImuAccGyrS imu_accgyrs_;
+};
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+// Arg: number of landmarks in the scene.
+// Times the backend spinOnce (add the keyframe, optimize) of all keyframes.
+static void BM_BackendOptimize(benchmark::State& state) {
+  const SyntheticBackendData data(state.range(0));
+  const StereoCalibPtr stereo_calibration(
+      new gtsam::Cal3_S2Stereo(data.cal_.fx(),
+                               data.cal_.fy(),
+                               data.cal_.skew(),
+                               data.cal_.px(),
+                               data.cal_.py(),
+                               kBaseline));
+  for (auto _ : state) {
+    state.PauseTiming();
+    ImuFrontend imu_frontend(data.imu_params_, data.imu_bias_);
+    VioBackend::UniquePtr vio_backend =
+        BackendFactory::createBackend(BackendType::kStereoImu,
+                                      gtsam::Pose3(),
+                                      stereo_calibration,
+                                      data.backend_params_,
+                                      data.imu_params_,
+                                      BackendOutputParams(false, 0, false),
+                                      false,
+                                      std::nullopt);
+    std::vector<ImuFrontend::PimPtr> pims;
+    for (size_t k = 0u; k < kNrKeyframes; ++k) {
+      pims.push_back(imu_frontend.preintegrateImuMeasurements(
+          data.getImuStamps(k), data.imu_accgyrs_));
+      imu_frontend.resetIntegrationWithCachedBias();
+    }
+    state.ResumeTiming();
+
+    for (size_t k = 0u; k < kNrKeyframes; ++k) {
+      benchmark::DoNotOptimize(
+          vio_backend->spinOnce(BackendInput((k + 1) * kKeyframeTimeStep,
+                                             data.measurements_[k],
+                                             pims[k],
+                                             data.imu_accgyrs_)));
+    }
+
+    state.PauseTiming();
+    vio_backend.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * kNrKeyframes);
+  state.counters["measurements"] = data.nr_measurements_;
+}
+BENCHMARK(BM_BackendOptimize)
+    ->ArgName("nr_landmarks")
+    ->Arg(50)
+    ->Arg(200)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace VIO
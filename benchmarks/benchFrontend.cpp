@@ -0,0 +1,103 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   benchFrontend.cpp
+ * @brief  Benchmarks of feature detection, tracking and stereo matching.
+ * @author Antoni Rosinol
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <gtsam/geometry/Rot3.h>
+
+#include "BenchmarkData.h"
+#include "kimera-vio/frontend/StereoMatcher.h"
+#include "kimera-vio/frontend/Tracker.h"
+#include "kimera-vio/frontend/feature-detector/FeatureDetector.h"
+
+namespace VIO {
+
+/* -------------------------------------------------------------------------- */
+static void BM_FeatureDetection(benchmark::State& state) {
+  const StereoBenchmarkData data;
+  FeatureDetectorParams params = data.frontend_params_.feature_detector_params_;
+  params.non_max_suppression_type_ =
+      static_cast<AnmsAlgorithmType>(state.range(0));
+  // Set when parsing the params otherwise.
+  params.binning_mask_ = Eigen::MatrixXd::Ones(params.nr_vertical_bins_,
+                                               params.nr_horizontal_bins_);
+  FeatureDetector feature_detector(params);
+  const cv::Mat R = data.stereo_camera_->getR1();
+  size_t nr_keypoints = 0u;
+  for (auto _ : state) {
+    state.PauseTiming();
+    StereoFrame stereo_frame = data.makeStereoFrame(0u);
+    state.ResumeTiming();
+    feature_detector.featureDetection(&stereo_frame.left_frame_, R);
+    nr_keypoints = stereo_frame.left_frame_.keypoints_.size();
+  }
+  state.counters["keypoints"] = nr_keypoints;
+}
+BENCHMARK(BM_FeatureDetection)
+    ->ArgName("anms_type")
+    ->DenseRange(static_cast<int>(AnmsAlgorithmType::TopN),
+                 static_cast<int>(AnmsAlgorithmType::Incremental))
+    ->Unit(benchmark::kMillisecond);
+
+/* -------------------------------------------------------------------------- */
+static void BM_FeatureTracking(benchmark::State& state) {
+  const StereoBenchmarkData data;
+  const FeatureDetectorParams& detector_params =
+      data.frontend_params_.feature_detector_params_;
+  FeatureDetector feature_detector(detector_params);
+  Tracker tracker(data.frontend_params_.tracker_params_,
+                  data.stereo_camera_->getOriginalLeftCamera());
+  const cv::Mat R = data.stereo_camera_->getR1();
+
+  StereoFrame ref_stereo_frame = data.makeStereoFrame(0u);
+  feature_detector.featureDetection(&ref_stereo_frame.left_frame_, R);
+  const StereoFrame cur_stereo_frame = data.makeStereoFrame(1u);
+  size_t nr_tracked = 0u;
+  for (auto _ : state) {
+    state.PauseTiming();
+    Frame ref_frame(ref_stereo_frame.left_frame_);
+    Frame cur_frame(cur_stereo_frame.left_frame_);
+    state.ResumeTiming();
+    tracker.featureTracking(
+        &ref_frame, &cur_frame, gtsam::Rot3(), detector_params, R);
+    nr_tracked = cur_frame.keypoints_.size();
+  }
+  state.counters["tracked"] = nr_tracked;
+}
+BENCHMARK(BM_FeatureTracking)->Unit(benchmark::kMillisecond);
+
+/* -------------------------------------------------------------------------- */
+static void BM_SparseStereoReconstruction(benchmark::State& state) {
+  const StereoBenchmarkData data;
+  FeatureDetector feature_detector(
+      data.frontend_params_.feature_detector_params_);
+  StereoMatcher stereo_matcher(data.stereo_camera_,
+                               data.frontend_params_.stereo_matching_params_);
+
+  StereoFrame detected_stereo_frame = data.makeStereoFrame(0u);
+  feature_detector.featureDetection(&detected_stereo_frame.left_frame_,
+                                    data.stereo_camera_->getR1());
+  for (auto _ : state) {
+    state.PauseTiming();
+    StereoFrame stereo_frame(detected_stereo_frame);
+    state.ResumeTiming();
+    stereo_matcher.sparseStereoReconstruction(&stereo_frame);
+    benchmark::DoNotOptimize(stereo_frame.keypoints_3d_.data());
+  }
+  state.counters["keypoints"] =
+      detected_stereo_frame.left_frame_.keypoints_.size();
+}
+BENCHMARK(BM_SparseStereoReconstruction)->Unit(benchmark::kMillisecond);
+
+}  // namespace VIO
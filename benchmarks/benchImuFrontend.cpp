@@ -0,0 +1,59 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   benchImuFrontend.cpp
+ * @brief  Benchmarks of the IMU preintegration.
+ * @author Antoni Rosinol
+ */
+
+#include <benchmark/benchmark.h>
+#include <gflags/gflags.h>
+
+#include "kimera-vio/imu-frontend/ImuFrontend.h"
+#include "kimera-vio/imu-frontend/ImuFrontendParams.h"
+
+DECLARE_string(bench_data_path);
+
+namespace VIO {
+
+/* -------------------------------------------------------------------------- */
+// Args: nr of IMU measurements (at 200Hz), ImuPreintegrationType.
+static void BM_ImuPreintegration(benchmark::State& state) {
+  ImuParams imu_params;
+  imu_params.parseYAML(FLAGS_bench_data_path + "/EurocParams/ImuParams.yaml");
+  imu_params.imu_preintegration_type_ =
+      static_cast<ImuPreintegrationType>(state.range(1));
+  ImuFrontend imu_frontend(imu_params, ImuBias());
+
+  // Constant rotation and acceleration, with gravity.
+  const size_t nr_measurements = state.range(0);
+  ImuStampS imu_stamps(1, nr_measurements);
+  ImuAccGyrS imu_accgyrs(6, nr_measurements);
+  for (size_t i = 0u; i < nr_measurements; ++i) {
+    imu_stamps(i) = 1000000000 + i * 5000000;
+    imu_accgyrs.col(i) << 0.1, -0.2, 9.81, 0.01, 0.02, -0.03;
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        imu_frontend.preintegrateImuMeasurements(imu_stamps, imu_accgyrs));
+    imu_frontend.resetIntegrationWithCachedBias();
+  }
+  state.SetItemsProcessed(state.iterations() * nr_measurements);
+}
+BENCHMARK(BM_ImuPreintegration)
+    ->ArgNames({"nr_measurements", "preintegration_type"})
+    ->ArgsProduct(
+        {{10, 200},
+         {static_cast<int>(
+              ImuPreintegrationType::kPreintegratedCombinedMeasurements),
+          static_cast<int>(
+              ImuPreintegrationType::kPreintegratedImuMeasurements)}})
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace VIO
@@ -0,0 +1,35 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   benchKimeraVIO.cpp
+ * @brief  Runs the benchmarks. Google Benchmark flags (e.g.
+ * --benchmark_filter, --benchmark_out=results.json) are parsed first, the
+ * remaining ones are gflags.
+ * @author Antoni Rosinol
+ */
+
+#include <benchmark/benchmark.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+DEFINE_string(bench_data_path,
+              "../tests/data",
+              "Path to the data of the benchmarks (the unit tests data).");
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  // The benchmarks should not be timing the logging.
+  FLAGS_logtostderr = 1;
+  FLAGS_minloglevel = 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
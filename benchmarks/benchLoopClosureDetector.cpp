@@ -0,0 +1,262 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   benchLoopClosureDetector.cpp
+ * @brief  Benchmarks of the loop closure detection, on the images of
+ * testLoopClosureDetector.
+ * @author Antoni Rosinol
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <DBoW2/DBoW2.h>
+#include <benchmark/benchmark.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kimera-vio/frontend/StereoCamera.h"
+#include "kimera-vio/frontend/StereoFrame.h"
+#include "kimera-vio/frontend/StereoMatcher.h"
+#include "kimera-vio/frontend/VisionImuFrontendParams.h"
+#include "kimera-vio/frontend/feature-detector/FeatureDetector.h"
+#include "kimera-vio/loopclosure/BinaryVocabulary.h"
+#include "kimera-vio/loopclosure/BowDatabase.h"
+#include "kimera-vio/loopclosure/GlobalDescriptor.h"
+#include "kimera-vio/loopclosure/HnswIndex.h"
+#include "kimera-vio/loopclosure/IncrementalPcm.h"
+#include "kimera-vio/loopclosure/LoopClosureDetector.h"
+#include "kimera-vio/utils/UtilsOpenCV.h"
+
+DECLARE_string(bench_data_path);
+DECLARE_string(vocabulary_path);
+
+namespace VIO {
+
+namespace {
+//! The four stereo keyframes of the test data, two pairs of loop closures.
+constexpr size_t kNrImages = 4u;
+
+std::vector<StereoFrame> makeLcdStereoFrames(
+    const std::string& data_path,
+    const FrontendParams& frontend_params,
+    const StereoCamera::Ptr& stereo_camera) {
+  FeatureDetector feature_detector(FeatureDetectorParams{});
+  StereoMatcher stereo_matcher(stereo_camera,
+                               frontend_params.stereo_matching_params_);
+  std::vector<StereoFrame> stereo_frames;
+  for (size_t k = 0u; k < kNrImages; ++k) {
+    const std::string suffix = "_img_" + std::to_string(k) + ".png";
+    const Timestamp timestamp = 1000 * (k + 1);
+    StereoFrame stereo_frame(
+        k,
+        timestamp,
+        Frame(k,
+              timestamp,
+              stereo_camera->getLeftCamParams(),
+              UtilsOpenCV::ReadAndConvertToGrayScale(data_path + "/left" +
+                                                     suffix)),
+        Frame(k,
+              timestamp,
+              stereo_camera->getRightCamParams(),
+              UtilsOpenCV::ReadAndConvertToGrayScale(data_path + "/right" +
+                                                     suffix)));
+    feature_detector.featureDetection(&stereo_frame.left_frame_);
+    stereo_frame.setIsKeyframe(true);
+    stereo_matcher.sparseStereoReconstruction(&stereo_frame);
+    stereo_frame.checkStereoFrame();
+    stereo_frame.left_frame_.keypoints_undistorted_ =
+        stereo_frame.left_keypoints_rectified_;
+    stereo_frame.right_frame_.keypoints_undistorted_ =
+        stereo_frame.right_keypoints_rectified_;
+    stereo_frames.push_back(stereo_frame);
+  }
+  return stereo_frames;
+}
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+// Each iteration adds one keyframe (cycling through the test images) and
+// times the detection of loops for it: the database grows as in a run, with
+// the same number of keyframes for every run given the fixed iterations.
+static void BM_LoopClosureDetection(benchmark::State& state) {
+  const std::string data_path =
+      FLAGS_bench_data_path + "/ForLoopClosureDetector";
+  FrontendParams frontend_params;
+  frontend_params.parseYAML(data_path + "/FrontendParams.yaml");
+  CameraParams cam_params_left;
+  CameraParams cam_params_right;
+  cam_params_left.parseYAML(data_path + "/sensorLeft.yaml");
+  cam_params_right.parseYAML(data_path + "/sensorRight.yaml");
+  const StereoCamera::Ptr stereo_camera =
+      std::make_shared<StereoCamera>(cam_params_left, cam_params_right);
+  const std::vector<StereoFrame> stereo_frames =
+      makeLcdStereoFrames(data_path, frontend_params, stereo_camera);
+
+  LoopClosureDetectorParams lcd_params;
+  lcd_params.parseYAML(data_path + "/testLCDParameters.yaml");
+  FLAGS_vocabulary_path = data_path + "/small_voc.yml.gz";
+  LoopClosureDetector lcd_detector(lcd_params,
+                                   stereo_camera->getLeftCamParams(),
+                                   stereo_camera->getBodyPoseLeftCamRect(),
+                                   stereo_camera,
+                                   frontend_params.stereo_matching_params_,
+                                   std::nullopt,
+                                   false);
+  lcd_detector.registerIsBackendQueueFilledCallback([]() { return false; });
+
+  size_t k = 0u;
+  size_t nr_loops = 0u;
+  for (auto _ : state) {
+    state.PauseTiming();
+    const FrameId frame_id =
+        lcd_detector.processAndAddStereoFrame(stereo_frames[k % kNrImages]);
+    ++k;
+    state.ResumeTiming();
+    LoopResult loop_result;
+    lcd_detector.detectLoopById(frame_id, &loop_result);
+    if (loop_result.isLoop()) ++nr_loops;
+  }
+  state.counters["loops"] = nr_loops;
+}
+BENCHMARK(BM_LoopClosureDetection)
+    ->Iterations(200)
+    ->Unit(benchmark::kMillisecond);
+
+/* -------------------------------------------------------------------------- */
+// Synthetic patrol: laps of a 20m square with a keyframe per meter, and a
+// loop closure of every keyframe after the first lap with the previous lap,
+// one out of ten being an outlier. Times the outlier rejection of all the
+// loop closures, for windows of increasing size (the largest one covers all
+// the loop closures, as PCM would).
+static void BM_IncrementalPcm(benchmark::State& state) {
+  constexpr size_t kNrKeyframesPerLap = 80u;
+  constexpr size_t kNrLaps = 6u;
+  std::vector<gtsam::Pose3> W_Pose_B{gtsam::Pose3()};
+  for (size_t i = 1u; i < kNrLaps * kNrKeyframesPerLap; ++i) {
+    W_Pose_B.push_back(W_Pose_B.back().compose(gtsam::Pose3(
+        i % 20u == 0u ? gtsam::Rot3::Yaw(M_PI / 2.0) : gtsam::Rot3(),
+        gtsam::Point3(1, 0, 0))));
+  }
+  const gtsam::Pose3 outlier(gtsam::Rot3::Yaw(0.5), gtsam::Point3(2, 1, 0));
+
+  IncrementalPcmParams params;
+  params.window_size = static_cast<int>(state.range(0));
+  size_t nr_inliers = 0u;
+  size_t nr_checks = 0u;
+  for (auto _ : state) {
+    IncrementalPcm pcm(params);
+    for (size_t i = 0u; i < W_Pose_B.size(); ++i) {
+      pcm.addOdometry(i, W_Pose_B[i]);
+    }
+    for (size_t i = kNrKeyframesPerLap; i < W_Pose_B.size(); ++i) {
+      const size_t ref = i - kNrKeyframesPerLap;
+      pcm.addLoopClosure(ref,
+                         i,
+                         i % 10u == 3u ? outlier
+                                       : W_Pose_B[ref].between(W_Pose_B[i]));
+    }
+    nr_inliers = pcm.getNumLCInliers();
+    nr_checks = pcm.getNumConsistencyChecks();
+  }
+  state.counters["inliers"] = nr_inliers;
+  state.counters["checks"] = nr_checks;
+}
+BENCHMARK(BM_IncrementalPcm)
+    ->Arg(16)
+    ->Arg(64)
+    ->Arg(400)
+    ->Unit(benchmark::kMillisecond);
+
+/* -------------------------------------------------------------------------- */
+// Synthetic place recognition: places of 300 features near vocabulary words,
+// each revisited with two thirds of its features seen again. Times the
+// retrieval of a revisit (description included) among all the places, with
+// the BoW database (range(0) = 0) or the global descriptor index (1), and
+// counts the recall of the top result and the memory per place.
+static void BM_PlaceRecognition(benchmark::State& state) {
+  const bool use_global_descriptors = state.range(0) == 1;
+  const size_t nr_places = static_cast<size_t>(state.range(1));
+  OrbVocabulary vocab;
+  vocab.load(FLAGS_bench_data_path +
+             "/ForLoopClosureDetector/small_voc.yml.gz");
+  cv::RNG rng(3);
+  const auto make_features = [&vocab, &rng](const int& nr_features) {
+    cv::Mat descriptors;
+    for (int i = 0; i < nr_features; ++i) {
+      cv::Mat descriptor =
+          vocab.getWord(rng.uniform(0, static_cast<int>(vocab.size())))
+              .clone();
+      for (int j = 0; j < 16; ++j) {
+        const int bit = rng.uniform(0, kOrbDescriptorBits);
+        descriptor.data[bit / 8] ^= static_cast<uchar>(1u << (bit % 8));
+      }
+      descriptors.push_back(descriptor);
+    }
+    return descriptors;
+  };
+
+  GlobalDescriptorParams params;
+  cv::Mat centers, bit_means;
+  getVocabularyLevel(vocab, params.vocabulary_level, &centers, &bit_means);
+  const GlobalDescriptorExtractor extractor(
+      centers, bit_means, params.projection_dim);
+  HnswIndex index(extractor.dim(), params.hnsw);
+  BowDatabase db(vocab);
+  std::vector<cv::Mat> revisits;
+  for (size_t i = 0u; i < nr_places; ++i) {
+    const cv::Mat place = make_features(300);
+    cv::Mat revisit = make_features(300);
+    place.rowRange(0, 200).copyTo(revisit.rowRange(0, 200));
+    revisits.push_back(revisit);
+    if (use_global_descriptors) {
+      index.add(static_cast<HnswIndex::Label>(i), extractor.compute(place));
+    } else {
+      DBoW2::BowVector bow_vec;
+      vocab.transform(descriptorRows(place), bow_vec);
+      db.add(bow_vec);
+    }
+  }
+
+  size_t nr_queries = 0u;
+  size_t nr_found = 0u;
+  for (auto _ : state) {
+    const size_t i = (nr_queries * 7919u) % nr_places;
+    size_t best = nr_places;
+    if (use_global_descriptors) {
+      std::vector<HnswIndex::Result> results;
+      index.search(extractor.compute(revisits[i]),
+                   1u,
+                   static_cast<HnswIndex::Label>(nr_places),
+                   &results);
+      if (!results.empty()) best = results[0].label;
+    } else {
+      DBoW2::BowVector bow_vec;
+      vocab.transform(descriptorRows(revisits[i]), bow_vec);
+      DBoW2::QueryResults results;
+      db.query(bow_vec, results, 1);
+      if (!results.empty()) best = results[0].Id;
+    }
+    ++nr_queries;
+    if (best == i) ++nr_found;
+  }
+  state.counters["recall"] =
+      static_cast<double>(nr_found) / static_cast<double>(nr_queries);
+  state.counters["bytes_per_place"] =
+      static_cast<double>(use_global_descriptors ? index.getMemoryBytes()
+                                                 : db.getMemoryBytes()) /
+      static_cast<double>(nr_places);
+}
+BENCHMARK(BM_PlaceRecognition)
+    ->ArgNames({"global_descriptors", "nr_places"})
+    ->ArgsProduct({{0, 1}, {500, 4000}})
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace VIO
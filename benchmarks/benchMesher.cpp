@@ -0,0 +1,71 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   benchMesher.cpp
+ * @brief  Benchmarks of the 3D mesh update.
+ * @author Antoni Rosinol
+ */
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "BenchmarkData.h"
+#include "kimera-vio/backend/VioBackend-definitions.h"
+#include "kimera-vio/frontend/StereoMatcher.h"
+#include "kimera-vio/frontend/feature-detector/FeatureDetector.h"
+#include "kimera-vio/mesh/Mesher.h"
+
+namespace VIO {
+
+/* -------------------------------------------------------------------------- */
+// Meshes the stereo landmarks of one keyframe, all of them taken as VIO
+// landmarks, with the camera at the origin.
+static void BM_MesherUpdateMesh3D(benchmark::State& state) {
+  const StereoBenchmarkData data;
+  FeatureDetector feature_detector(
+      data.frontend_params_.feature_detector_params_);
+  StereoMatcher stereo_matcher(data.stereo_camera_,
+                               data.frontend_params_.stereo_matching_params_);
+  StereoFrame stereo_frame = data.makeStereoFrame(0u);
+  feature_detector.featureDetection(&stereo_frame.left_frame_,
+                                    data.stereo_camera_->getR1());
+  stereo_frame.setIsKeyframe(true);
+  stereo_matcher.sparseStereoReconstruction(&stereo_frame);
+
+  const LandmarkIds& landmarks = stereo_frame.left_frame_.landmarks_;
+  std::vector<KeypointStatus> keypoints_status;
+  PointsWithIdMap points_with_id_VIO;
+  for (size_t i = 0u; i < landmarks.size(); ++i) {
+    const KeypointStatus& status =
+        stereo_frame.right_keypoints_rectified_.at(i).first;
+    keypoints_status.push_back(status);
+    if (status == KeypointStatus::VALID) {
+      points_with_id_VIO[landmarks[i]] = stereo_frame.keypoints_3d_.at(i);
+    }
+  }
+
+  const gtsam::Pose3 left_camera_pose;
+  for (auto _ : state) {
+    state.PauseTiming();
+    Mesher mesher(MesherParams(data.stereo_camera_->getBodyPoseLeftCamRect(),
+                               data.cam_params_left_.image_size_));
+    state.ResumeTiming();
+    mesher.updateMesh3D(points_with_id_VIO,
+                        stereo_frame.left_frame_.keypoints_,
+                        keypoints_status,
+                        stereo_frame.keypoints_3d_,
+                        landmarks,
+                        left_camera_pose);
+  }
+  state.counters["landmarks"] = points_with_id_VIO.size();
+}
+BENCHMARK(BM_MesherUpdateMesh3D)->Unit(benchmark::kMillisecond);
+
+}  // namespace VIO
@@ -0,0 +1,284 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   benchPipeline.cpp
+ * @brief  End-to-end throughput of the stereo-imu pipeline on a EuRoC
+ * dataset, in sequential and parallel modes, and per-frame overhead of the
+ * dynamic pipeline wrt the statically composed one.
+ * @author Antoni Rosinol
+ */
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kimera-vio/backend/VioBackend.h"
+#include "kimera-vio/dataprovider/EurocDataProvider.h"
+#include "kimera-vio/frontend/StereoVisionImuFrontend.h"
+#include "kimera-vio/pipeline/StaticStereoImuPipeline.h"
+#include "kimera-vio/pipeline/StereoImuPipeline.h"
+#include "kimera-vio/utils/AllocationTracker.h"
+
+DEFINE_string(bench_euroc_path,
+              "",
+              "EuRoC dataset to run the pipeline benchmarks on, the "
+              "MicroEurocDataset of the bench_data_path by default.");
+DEFINE_int32(bench_euroc_initial_k, 10, "First frame of the EuRoC dataset.");
+DEFINE_int32(bench_euroc_final_k, 80, "Last frame of the EuRoC dataset.");
+
+DECLARE_string(bench_data_path);
+DECLARE_bool(visualize);
+DECLARE_bool(use_lcd);
+DECLARE_int32(viz_type);
+
+namespace VIO {
+
+/* -------------------------------------------------------------------------- */
+// Arg: parallel run or not.
+// Times the processing of the whole dataset, from building the pipeline to
+// shutting it down once all data has been consumed.
+static void BM_StereoImuPipeline(benchmark::State& state) {
+  FLAGS_visualize = false;
+  const std::string dataset_path =
+      FLAGS_bench_euroc_path.empty()
+          ? FLAGS_bench_data_path + "/MicroEurocDataset"
+          : FLAGS_bench_euroc_path;
+  VioParams vio_params(FLAGS_bench_data_path + "/EurocParams");
+  vio_params.parallel_run_ = state.range(0);
+
+  size_t nr_allocations_after_warmup = 0u;
+  for (auto _ : state) {
+    // Each pipeline warms up again.
+    utils::AllocationTracker::reset();
+    //! The data provider has to be built before the pipeline, since it
+    //! updates the backend params with the ground-truth pose.
+    DataProviderInterface::UniquePtr data_provider =
+        std::make_unique<EurocDataProvider>(dataset_path,
+                                            FLAGS_bench_euroc_initial_k,
+                                            FLAGS_bench_euroc_final_k,
+                                            vio_params);
+    StereoImuPipeline::UniquePtr vio_pipeline =
+        std::make_unique<StereoImuPipeline>(vio_params);
+    vio_pipeline->registerShutdownCallback(std::bind(
+        &DataProviderInterface::shutdown, data_provider.get()));
+    data_provider->registerImuSingleCallback(
+        std::bind(&StereoImuPipeline::fillSingleImuQueue,
+                  vio_pipeline.get(),
+                  std::placeholders::_1));
+    data_provider->registerLeftFrameCallback(
+        std::bind(&StereoImuPipeline::fillLeftFrameQueueBlockingIfFull,
+                  vio_pipeline.get(),
+                  std::placeholders::_1));
+    data_provider->registerRightFrameCallback(
+        std::bind(&StereoImuPipeline::fillRightFrameQueueBlockingIfFull,
+                  vio_pipeline.get(),
+                  std::placeholders::_1));
+
+    if (vio_params.parallel_run_) {
+      auto handle_data = std::async(std::launch::async,
+                                    &DataProviderInterface::spin,
+                                    data_provider.get());
+      auto handle_pipeline = std::async(
+          std::launch::async, &StereoImuPipeline::spin, vio_pipeline.get());
+      auto handle_shutdown =
+          std::async(std::launch::async,
+                     &StereoImuPipeline::shutdownWhenFinished,
+                     vio_pipeline.get(),
+                     10,
+                     false);
+      handle_shutdown.get();
+      handle_pipeline.get();
+      handle_data.get();
+    } else {
+      while (data_provider->spin() && vio_pipeline->spin()) {
+      }
+      vio_pipeline->shutdown();
+    }
+
+    // The pipeline shuts down the data provider: destroy it first.
+    vio_pipeline.reset();
+    data_provider.reset();
+    nr_allocations_after_warmup +=
+        utils::AllocationTracker::getNumViolations();
+  }
+  state.counters["frames_per_second"] = benchmark::Counter(
+      state.iterations() *
+          (FLAGS_bench_euroc_final_k - FLAGS_bench_euroc_initial_k + 1),
+      benchmark::Counter::kIsRate);
+  // Heap allocations of the module spins after their warmup, see the
+  // pipeline's allocation report at shutdown for their callstacks.
+  state.counters["allocations_after_warmup"] = benchmark::Counter(
+      static_cast<double>(nr_allocations_after_warmup),
+      benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_StereoImuPipeline)
+    ->ArgName("parallel")
+    ->Arg(0)
+    ->Arg(1)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+/* -------------------------------------------------------------------------- */
+namespace {
+//! Counts the Backend outputs of the StaticStereoImuPipeline.
+struct CountingSink {
+  inline void operator()(const BackendOutput& /*backend_output*/) {
+    ++nr_keyframes;
+  }
+  size_t nr_keyframes = 0u;
+};
+
+using BenchStaticPipeline =
+    StaticStereoImuPipeline<StereoVisionImuFrontend, VioBackend, CountingSink>;
+
+/**
+ * @brief The StaticPipelineFeeder class steps a StaticStereoImuPipeline on
+ * the data of a data provider: each stereo frame with the IMU measurements
+ * since the previous one, as the data provider module of the Pipeline would
+ * (without the interpolation at the frame timestamp).
+ */
+class StaticPipelineFeeder {
+ public:
+  explicit StaticPipelineFeeder(BenchStaticPipeline* pipeline)
+      : pipeline_(CHECK_NOTNULL(pipeline)),
+        imu_measurements_(),
+        next_imu_(0u),
+        left_frame_(nullptr) {}
+
+  void fillImu(const ImuMeasurement& imu_measurement) {
+    imu_measurements_.push_back(imu_measurement);
+  }
+
+  void fillLeftFrame(Frame::UniquePtr left_frame) {
+    left_frame_ = std::move(left_frame);
+  }
+
+  void fillRightFrame(Frame::UniquePtr right_frame) {
+    CHECK(left_frame_);
+    CHECK_EQ(left_frame_->timestamp_, right_frame->timestamp_);
+    const Timestamp& timestamp = left_frame_->timestamp_;
+    size_t end_imu = next_imu_;
+    while (end_imu < imu_measurements_.size() &&
+           imu_measurements_[end_imu].timestamp_ <= timestamp) {
+      ++end_imu;
+    }
+    const int nr_imu = static_cast<int>(end_imu - next_imu_);
+    ImuStampS imu_stamps(1, nr_imu);
+    ImuAccGyrS imu_accgyrs(6, nr_imu);
+    for (int i = 0; i < nr_imu; ++i) {
+      const ImuMeasurement& imu_measurement = imu_measurements_[next_imu_ + i];
+      imu_stamps(0, i) = imu_measurement.timestamp_;
+      imu_accgyrs.col(i) = imu_measurement.acc_gyr_;
+    }
+    next_imu_ = end_imu;
+    pipeline_->step(std::make_unique<StereoImuSyncPacket>(
+        StereoFrame(left_frame_->id_, timestamp, *left_frame_, *right_frame),
+        imu_stamps,
+        imu_accgyrs));
+    left_frame_.reset();
+  }
+
+ private:
+  BenchStaticPipeline* pipeline_;
+  std::vector<ImuMeasurement> imu_measurements_;
+  size_t next_imu_;
+  Frame::UniquePtr left_frame_;
+};
+}  // namespace
+
+// Arg: statically composed pipeline or not.
+// Runs only the Frontend and the Backend, sequentially, so that the difference
+// in ms_per_frame between the dynamic Pipeline (modules, queues, factories and
+// callbacks) and the StaticStereoImuPipeline is their per-frame overhead.
+static void BM_StereoImuPipelineOverhead(benchmark::State& state) {
+  FLAGS_visualize = false;
+  FLAGS_use_lcd = false;
+  // No Mesher.
+  FLAGS_viz_type = static_cast<int>(VisualizationType::kNone);
+  const bool is_static = state.range(0);
+  const std::string dataset_path =
+      FLAGS_bench_euroc_path.empty()
+          ? FLAGS_bench_data_path + "/MicroEurocDataset"
+          : FLAGS_bench_euroc_path;
+  VioParams vio_params(FLAGS_bench_data_path + "/EurocParams");
+  vio_params.parallel_run_ = false;
+  // The Backend type of the StaticStereoImuPipeline.
+  vio_params.backend_type_ = BackendType::kStereoImu;
+
+  for (auto _ : state) {
+    DataProviderInterface::UniquePtr data_provider =
+        std::make_unique<EurocDataProvider>(dataset_path,
+                                            FLAGS_bench_euroc_initial_k,
+                                            FLAGS_bench_euroc_final_k,
+                                            vio_params);
+    if (is_static) {
+      BenchStaticPipeline::UniquePtr vio_pipeline =
+          std::make_unique<BenchStaticPipeline>(vio_params);
+      StaticPipelineFeeder feeder(vio_pipeline.get());
+      data_provider->registerImuSingleCallback(
+          std::bind(&StaticPipelineFeeder::fillImu,
+                    &feeder,
+                    std::placeholders::_1));
+      data_provider->registerLeftFrameCallback(
+          std::bind(&StaticPipelineFeeder::fillLeftFrame,
+                    &feeder,
+                    std::placeholders::_1));
+      data_provider->registerRightFrameCallback(
+          std::bind(&StaticPipelineFeeder::fillRightFrame,
+                    &feeder,
+                    std::placeholders::_1));
+      while (data_provider->spin()) {
+      }
+    } else {
+      StereoImuPipeline::UniquePtr vio_pipeline =
+          std::make_unique<StereoImuPipeline>(vio_params);
+      vio_pipeline->registerShutdownCallback(std::bind(
+          &DataProviderInterface::shutdown, data_provider.get()));
+      data_provider->registerImuSingleCallback(
+          std::bind(&StereoImuPipeline::fillSingleImuQueue,
+                    vio_pipeline.get(),
+                    std::placeholders::_1));
+      data_provider->registerLeftFrameCallback(
+          std::bind(&StereoImuPipeline::fillLeftFrameQueueBlockingIfFull,
+                    vio_pipeline.get(),
+                    std::placeholders::_1));
+      data_provider->registerRightFrameCallback(
+          std::bind(&StereoImuPipeline::fillRightFrameQueueBlockingIfFull,
+                    vio_pipeline.get(),
+                    std::placeholders::_1));
+      while (data_provider->spin() && vio_pipeline->spin()) {
+      }
+      vio_pipeline->shutdown();
+      // The pipeline shuts down the data provider: destroy it first.
+      vio_pipeline.reset();
+    }
+    data_provider.reset();
+  }
+  const double nr_frames =
+      FLAGS_bench_euroc_final_k - FLAGS_bench_euroc_initial_k + 1;
+  state.counters["frames_per_second"] = benchmark::Counter(
+      state.iterations() * nr_frames, benchmark::Counter::kIsRate);
+  state.counters["ms_per_frame"] = benchmark::Counter(
+      state.iterations() * nr_frames * 1e-3,
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+BENCHMARK(BM_StereoImuPipelineOverhead)
+    ->ArgName("static")
+    ->Arg(0)
+    ->Arg(1)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace VIO
@@ -0,0 +1,92 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ConvertDatasetToBinary.cpp
+ * @brief  Converts a EuRoC dataset to a binary dataset (see BinaryDataset.h),
+ * to be replayed with the BinaryDataProvider.
+ * @author Antoni Rosinol
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "kimera-vio/dataprovider/BinaryDataset.h"
+#include "kimera-vio/dataprovider/EurocDataProvider.h"
+#include "kimera-vio/pipeline/Pipeline-definitions.h"
+
+DEFINE_string(
+    params_folder_path,
+    "../params/Euroc",
+    "Path to the folder containing the yaml files with the VIO parameters.");
+DEFINE_string(binary_output_path,
+              "dataset.kimera",
+              "Path of the binary dataset to write.");
+
+int main(int argc, char* argv[]) {
+  // Initialize Google's flags library.
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  // Initialize Google's logging library.
+  google::InitGoogleLogging(argv[0]);
+
+  VIO::VioParams vio_params(FLAGS_params_folder_path);
+  // Store raw images, the BinaryDataProvider equalizes them if asked to, and
+  // parse the whole dataset in one spin.
+  vio_params.frontend_params_.stereo_matching_params_.equalize_image_ = false;
+  vio_params.parallel_run_ = true;
+
+  const bool is_stereo =
+      vio_params.frontend_type_ == VIO::FrontendType::kStereoImu;
+  VIO::EurocDataProvider::Ptr dataset_parser =
+      is_stereo ? std::make_shared<VIO::EurocDataProvider>(vio_params)
+                : std::make_shared<VIO::MonoEurocDataProvider>(vio_params);
+
+  VIO::BinaryDatasetWriter writer(FLAGS_binary_output_path,
+                                  is_stereo ? 2u : 1u);
+  for (const auto& gt : dataset_parser->gt_data_.map_to_gt_) {
+    writer.addGroundTruthState(gt.first, gt.second);
+  }
+
+  dataset_parser->registerImuSingleCallback(
+      [&writer](const VIO::ImuMeasurement& imu_measurement) {
+        writer.addImuMeasurement(imu_measurement);
+      });
+  // The right frame is always sent right after the left one.
+  VIO::Frame::UniquePtr left_frame = nullptr;
+  size_t nr_frames = 0u;
+  dataset_parser->registerLeftFrameCallback(
+      [&](VIO::Frame::UniquePtr frame) {
+        if (is_stereo) {
+          left_frame = std::move(frame);
+        } else {
+          writer.addFrame(frame->id_, frame->timestamp_, {frame->img_});
+          ++nr_frames;
+        }
+      });
+  dataset_parser->registerRightFrameCallback(
+      [&](VIO::Frame::UniquePtr frame) {
+        CHECK(left_frame);
+        CHECK_EQ(left_frame->id_, frame->id_);
+        writer.addFrame(
+            frame->id_, frame->timestamp_, {left_frame->img_, frame->img_});
+        left_frame.reset();
+        ++nr_frames;
+      });
+
+  while (dataset_parser->spin()) {
+  }
+  writer.close();
+
+  LOG(INFO) << "Wrote " << nr_frames << " frames to "
+            << FLAGS_binary_output_path;
+  return EXIT_SUCCESS;
+}
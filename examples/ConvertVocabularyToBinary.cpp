@@ -0,0 +1,35 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ConvertVocabularyToBinary.cpp
+ * @brief  Converts a DBoW2 text/YAML ORB vocabulary to a binary vocabulary
+ * (see BinaryVocabulary.h), to be memory-mapped by the LoopClosureDetector.
+ * @author Antoni Rosinol
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kimera-vio/loopclosure/BinaryVocabulary.h"
+
+DECLARE_string(vocabulary_path);
+DEFINE_string(binary_vocabulary_path,
+              "../vocabulary/ORBvoc.bin",
+              "Path of the binary vocabulary to write.");
+
+int main(int argc, char* argv[]) {
+  // Initialize Google's flags library.
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  // Initialize Google's logging library.
+  google::InitGoogleLogging(argv[0]);
+
+  VIO::convertVocabularyToBinary(FLAGS_vocabulary_path,
+                                 FLAGS_binary_vocabulary_path);
+  return 0;
+}
@@ -0,0 +1,85 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   KimeraLcdServer.cpp
+ * @brief  Runs the LCD and PGO of the robots offloading them (see the
+ * remote_server_host LCD param).
+ * @author Antoni Rosinol
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <memory>
+#include <utility>
+
+#include "kimera-vio/frontend/StereoCamera.h"
+#include "kimera-vio/loopclosure/LcdFactory.h"
+#include "kimera-vio/loopclosure/MultiRobotLcd.h"
+#include "kimera-vio/loopclosure/RemoteLcdServer.h"
+#include "kimera-vio/pipeline/Pipeline-definitions.h"
+#include "kimera-vio/pipeline/PipelineContext.h"
+
+DECLARE_bool(log_output);
+DEFINE_string(
+    params_folder_path,
+    "../params/Euroc",
+    "Path to the folder containing the yaml files with the VIO parameters, "
+    "the same as the robots'.");
+DEFINE_int32(lcd_server_port, 7100, "Port to listen on.");
+DEFINE_string(lcd_server_bind_address,
+              "127.0.0.1",
+              "IPv4 address of the interface to listen on: 0.0.0.0 for all "
+              "of them, to serve robots on other hosts.");
+DEFINE_int32(lcd_server_max_pending_bytes,
+             8 * 1024 * 1024,
+             "Max bytes of corrections not yet sent to a robot before "
+             "closing its connection.");
+
+int main(int argc, char* argv[]) {
+  // Initialize Google's flags library.
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  // Initialize Google's logging library.
+  google::InitGoogleLogging(argv[0]);
+
+  const VIO::VioParams vio_params(FLAGS_params_folder_path);
+  CHECK_EQ(vio_params.camera_params_.size(), 2u)
+      << "The LCD server needs the stereo camera of the robots.";
+  const VIO::StereoCamera::ConstPtr stereo_camera =
+      std::make_shared<VIO::StereoCamera>(vio_params.camera_params_.at(0),
+                                          vio_params.camera_params_.at(1));
+  // The robots share the vocabulary, loaded once.
+  auto context = std::make_shared<VIO::PipelineContext>();
+
+  VIO::MultiRobotLcd::UniquePtr multi_robot_lcd =
+      std::make_unique<VIO::MultiRobotLcd>(
+          [&vio_params, &stereo_camera, &context](const VIO::RobotId&) {
+            VIO::LoopClosureDetectorParams lcd_params = vio_params.lcd_params_;
+            // Runs the LCD here.
+            lcd_params.remote_server_host_.clear();
+            return VIO::LcdFactory::createLcd(
+                lcd_params.lcd_type_,
+                lcd_params,
+                stereo_camera->getLeftCamParams(),
+                stereo_camera->getBodyPoseLeftCamRect(),
+                stereo_camera,
+                vio_params.frontend_params_.stereo_matching_params_,
+                std::nullopt,
+                FLAGS_log_output,
+                context->getPreloadedVocab());
+          });
+
+  VIO::RemoteLcdServer server(
+      std::move(multi_robot_lcd),
+      FLAGS_lcd_server_port,
+      static_cast<size_t>(FLAGS_lcd_server_max_pending_bytes),
+      FLAGS_lcd_server_bind_address);
+  server.spin();
+  return 0;
+}
@@ -22,10 +22,15 @@
 #include <utility>
 #include <thread>
 
+#include "kimera-vio/dataprovider/BinaryDataProvider.h"
 #include "kimera-vio/dataprovider/EurocDataProvider.h"
 #include "kimera-vio/dataprovider/KittiDataProvider.h"
+#include "kimera-vio/dataprovider/SensorRecorder.h"
+#include "kimera-vio/dataprovider/SyntheticDataProvider.h"
+#include "kimera-vio/dataprovider/VideoDataProvider.h"
 #include "kimera-vio/frontend/StereoImuSyncPacket.h"
 #include "kimera-vio/logging/Logger.h"
+#include "kimera-vio/logging/TrajectoryEvaluator.h"
 #include "kimera-vio/pipeline/MonoImuPipeline.h"
 #include "kimera-vio/pipeline/Pipeline.h"
 #include "kimera-vio/pipeline/StereoImuPipeline.h"
@@ -35,11 +40,26 @@
 DEFINE_int32(dataset_type,
              0,
              "Type of parser to use:\n "
-             "0: Euroc \n 1: Kitti (not supported).");
+             "0: Euroc \n 1: Kitti (not supported) \n 2: Binary dataset "
+             "(see convertDatasetToBinary) \n 3: Synthetic (see "
+             "SyntheticDataProvider) \n 4: Video dataset (see "
+             "VideoDataProvider).");
+DEFINE_string(sensor_recording_path,
+              "",
+              "If set, record the sensor data sent to the pipeline to this "
+              "binary dataset (replay it with --dataset_type=2).");
 DEFINE_string(
     params_folder_path,
     "../params/Euroc",
     "Path to the folder containing the yaml files with the VIO parameters.");
+DEFINE_bool(evaluate_trajectory,
+            false,
+            "Evaluate the estimated trajectory (ATE and RPE) against the "
+            "ground truth of the dataset while running (EuRoC only).");
+DEFINE_double(rpe_delta_s,
+              1.0,
+              "Time between the poses compared by the relative pose error, "
+              "in seconds.");
 
 int main(int argc, char *argv[])
 {
@@ -81,13 +101,28 @@ int main(int argc, char *argv[])
   break;
   case 1:
   {
-    dataset_parser = std::make_unique<VIO::KittiDataProvider>();
+    dataset_parser = std::make_unique<VIO::KittiDataProvider>(vio_params);
+  }
+  break;
+  case 2:
+  {
+    dataset_parser = std::make_unique<VIO::BinaryDataProvider>(vio_params);
+  }
+  break;
+  case 3:
+  {
+    dataset_parser = std::make_unique<VIO::SyntheticDataProvider>(vio_params);
+  }
+  break;
+  case 4:
+  {
+    dataset_parser = std::make_unique<VIO::VideoDataProvider>(vio_params);
   }
   break;
   default:
   {
     LOG(FATAL) << "Unrecognized dataset type: " << FLAGS_dataset_type << "."
-               << " 0: EuRoC, 1: Kitti.";
+               << " 0: EuRoC, 1: Kitti, 2: Binary, 3: Synthetic, 4: Video.";
   }
   }
   CHECK(dataset_parser);
@@ -115,6 +150,26 @@ int main(int argc, char *argv[])
   break;
   }
 
+  if (FLAGS_evaluate_trajectory)
+  {
+    auto euroc_parser =
+        std::dynamic_pointer_cast<VIO::EurocDataProvider>(dataset_parser);
+    if (euroc_parser && euroc_parser->isGroundTruthAvailable())
+    {
+      vio_pipeline->setTrajectoryEvaluator(
+          std::make_unique<VIO::TrajectoryEvaluator>(
+              [euroc_parser](const VIO::Timestamp& timestamp,
+                             gtsam::Pose3* pose) -> bool
+              { return euroc_parser->findGroundTruthPose(timestamp, pose); },
+              FLAGS_rpe_delta_s));
+    }
+    else
+    {
+      LOG(WARNING) << "Not evaluating the trajectory: only EuRoC datasets "
+                      "with ground truth are supported.";
+    }
+  }
+
   // Register callback to shutdown data provider in case VIO pipeline
   // shutsdown.
   vio_pipeline->registerShutdownCallback(
@@ -125,8 +180,20 @@ int main(int argc, char *argv[])
       &VIO::Pipeline::fillSingleImuQueue, vio_pipeline, std::placeholders::_1));
   // We use blocking variants to avoid overgrowing the input queues (use
   // the non-blocking versions with real sensor streams)
-  dataset_parser->registerLeftFrameCallback(std::bind(
-      &VIO::Pipeline::fillLeftFrameQueue, vio_pipeline, std::placeholders::_1));
+  if (FLAGS_deterministic_replay)
+  {
+    dataset_parser->registerLeftFrameCallback(
+        std::bind(&VIO::Pipeline::fillLeftFrameQueueWithBackpressure,
+                  vio_pipeline,
+                  std::placeholders::_1));
+  }
+  else
+  {
+    dataset_parser->registerLeftFrameCallback(
+        std::bind(&VIO::Pipeline::fillLeftFrameQueue,
+                  vio_pipeline,
+                  std::placeholders::_1));
+  }
 
   if (vio_params.frontend_type_ == VIO::FrontendType::kStereoImu)
   {
@@ -140,6 +207,14 @@ int main(int argc, char *argv[])
                   std::placeholders::_1));
   }
 
+  if (!FLAGS_sensor_recording_path.empty())
+  {
+    // Owned by the data provider callbacks, closed along with them.
+    dataset_parser->attachRecorder(std::make_shared<VIO::SensorRecorder>(
+        FLAGS_sensor_recording_path,
+        vio_params.frontend_type_ == VIO::FrontendType::kStereoImu ? 2u : 1u));
+  }
+
   // Spin dataset.
   auto tic = VIO::utils::Timer::tic();
   bool is_pipeline_successful = false;
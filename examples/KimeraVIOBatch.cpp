@@ -0,0 +1,154 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   KimeraVIOBatch.cpp
+ * @brief  Runs one VIO pipeline per EuRoC dataset concurrently, in a single
+ * process sharing the parameters, the vocabulary, the startup cache and the
+ * module scheduler.
+ * @author Antoni Rosinol
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <future>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "kimera-vio/dataprovider/EurocDataProvider.h"
+#include "kimera-vio/pipeline/MonoImuPipeline.h"
+#include "kimera-vio/pipeline/Pipeline.h"
+#include "kimera-vio/pipeline/PipelineContext.h"
+#include "kimera-vio/pipeline/StereoImuPipeline.h"
+#include "kimera-vio/utils/Timer.h"
+
+DEFINE_string(
+    params_folder_path,
+    "../params/Euroc",
+    "Path to the folder containing the yaml files with the VIO parameters.");
+DEFINE_string(dataset_paths,
+              "",
+              "Comma-separated paths to the EuRoC datasets to run.");
+DEFINE_int32(shared_scheduler_workers,
+             0,
+             "Workers of the module scheduler shared by all pipelines, or 0 "
+             "for each pipeline to run its modules itself.");
+
+DECLARE_int64(initial_k);
+DECLARE_int64(final_k);
+
+namespace {
+
+std::vector<std::string> splitPaths(const std::string& paths) {
+  std::vector<std::string> split_paths;
+  std::stringstream stream(paths);
+  std::string path;
+  while (std::getline(stream, path, ',')) {
+    if (!path.empty()) split_paths.push_back(path);
+  }
+  return split_paths;
+}
+
+//! Runs the dataset through its own pipeline, returns whether it succeeded.
+bool runDataset(const std::string& dataset_path,
+                const VIO::VioParams& vio_params,
+                const VIO::PipelineContext::Ptr& context) {
+  VIO::DataProviderInterface::Ptr dataset_parser = nullptr;
+  VIO::Pipeline::Ptr vio_pipeline = nullptr;
+  const int initial_k = static_cast<int>(FLAGS_initial_k);
+  const int final_k = static_cast<int>(FLAGS_final_k);
+  if (vio_params.frontend_type_ == VIO::FrontendType::kMonoImu) {
+    dataset_parser = std::make_shared<VIO::MonoEurocDataProvider>(
+        dataset_path, initial_k, final_k, vio_params);
+    vio_pipeline = std::make_shared<VIO::MonoImuPipeline>(
+        vio_params, nullptr, nullptr, nullptr, context);
+  } else {
+    CHECK(vio_params.frontend_type_ == VIO::FrontendType::kStereoImu)
+        << "Unrecognized Frontend type: "
+        << VIO::to_underlying(vio_params.frontend_type_);
+    dataset_parser = std::make_shared<VIO::EurocDataProvider>(
+        dataset_path, initial_k, final_k, vio_params);
+    auto stereo_pipeline = std::make_shared<VIO::StereoImuPipeline>(
+        vio_params, nullptr, nullptr, nullptr, context);
+    dataset_parser->registerRightFrameCallback(
+        std::bind(&VIO::StereoImuPipeline::fillRightFrameQueue,
+                  stereo_pipeline,
+                  std::placeholders::_1));
+    vio_pipeline = stereo_pipeline;
+  }
+
+  vio_pipeline->registerShutdownCallback(
+      std::bind(&VIO::DataProviderInterface::shutdown, dataset_parser));
+  dataset_parser->registerImuSingleCallback(std::bind(
+      &VIO::Pipeline::fillSingleImuQueue, vio_pipeline, std::placeholders::_1));
+  dataset_parser->registerLeftFrameCallback(
+      std::bind(&VIO::Pipeline::fillLeftFrameQueueBlockingIfFull,
+                vio_pipeline,
+                std::placeholders::_1));
+
+  auto handle = std::async(
+      std::launch::async, &VIO::DataProviderInterface::spin, dataset_parser);
+  auto handle_pipeline =
+      std::async(std::launch::async, &VIO::Pipeline::spin, vio_pipeline);
+  vio_pipeline->waitForShutdown(
+      [&dataset_parser]() -> bool { return !dataset_parser->hasData(); },
+      500,
+      false);
+  const bool is_successful = !handle.get();
+  handle_pipeline.get();
+  LOG(INFO) << "Dataset " << dataset_path << " successful? "
+            << (is_successful ? "Yes!" : "No!");
+  return is_successful;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  const std::vector<std::string> dataset_paths =
+      splitPaths(FLAGS_dataset_paths);
+  CHECK(!dataset_paths.empty()) << "Give the datasets in --dataset_paths.";
+  CHECK_GE(FLAGS_shared_scheduler_workers, 0);
+
+  // Parsed once, copied by each pipeline.
+  const VIO::VioParams vio_params(FLAGS_params_folder_path);
+  CHECK(vio_params.parallel_run_)
+      << "Running several datasets concurrently requires parallel_run.";
+  LOG_IF(WARNING, dataset_paths.size() > 1u)
+      << "The output logs and the statistics are shared by the pipelines of "
+         "the process: disable log_output, or run one dataset per process, "
+         "for per-dataset logs.";
+
+  auto context = std::make_shared<VIO::PipelineContext>(
+      static_cast<size_t>(FLAGS_shared_scheduler_workers));
+
+  auto tic = VIO::utils::Timer::tic();
+  std::vector<std::future<bool>> handles;
+  for (const std::string& dataset_path : dataset_paths) {
+    handles.push_back(std::async(std::launch::async,
+                                 &runDataset,
+                                 dataset_path,
+                                 std::cref(vio_params),
+                                 context));
+  }
+  size_t nr_successful = 0u;
+  for (std::future<bool>& handle : handles) {
+    if (handle.get()) ++nr_successful;
+  }
+  LOG(WARNING) << "Running " << dataset_paths.size()
+               << " datasets took: " << VIO::utils::Timer::toc(tic).count()
+               << " ms.";
+  LOG(INFO) << nr_successful << " of " << dataset_paths.size()
+            << " datasets successful.";
+  return nr_successful == dataset_paths.size() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
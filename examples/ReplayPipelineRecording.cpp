@@ -0,0 +1,142 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ReplayPipelineRecording.cpp
+ * @brief  Replays the Backend, Mesher and LCD inputs recorded with
+ * --record_pipeline_inputs_path through these modules, as fast as possible
+ * and in the recorded order, to benchmark them deterministically.
+ * @author Antoni Rosinol
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <iostream>
+#include <memory>
+
+#include "kimera-vio/backend/VioBackendFactory.h"
+#include "kimera-vio/frontend/StereoCamera.h"
+#include "kimera-vio/loopclosure/LcdFactory.h"
+#include "kimera-vio/mesh/MesherFactory.h"
+#include "kimera-vio/pipeline/Pipeline-definitions.h"
+#include "kimera-vio/pipeline/PipelineRecording.h"
+#include "kimera-vio/utils/Statistics.h"
+#include "kimera-vio/utils/Timer.h"
+
+DEFINE_string(
+    params_folder_path,
+    "../params/Euroc",
+    "Path to the folder containing the yaml files with the VIO parameters "
+    "of the recorded run.");
+DEFINE_string(recording_path,
+              "pipeline_inputs.kimera",
+              "Path of the recording (see --record_pipeline_inputs_path).");
+DEFINE_bool(replay_backend, true, "Replay the Backend inputs.");
+DEFINE_bool(replay_mesher, true, "Replay the Mesher inputs.");
+DEFINE_bool(replay_lcd, true, "Replay the LCD inputs.");
+
+int main(int argc, char* argv[]) {
+  // Initialize Google's flags library.
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  // Initialize Google's logging library.
+  google::InitGoogleLogging(argv[0]);
+
+  VIO::VioParams vio_params(FLAGS_params_folder_path);
+  CHECK(vio_params.frontend_type_ == VIO::FrontendType::kStereoImu)
+      << "Only stereo recordings can be replayed.";
+  CHECK_EQ(vio_params.camera_params_.size(), 2u);
+  CHECK(vio_params.backend_params_);
+  const VIO::StereoCamera::ConstPtr stereo_camera =
+      std::make_shared<VIO::StereoCamera>(vio_params.camera_params_.at(0),
+                                          vio_params.camera_params_.at(1));
+  VIO::PipelineRecordingReader reader(FLAGS_recording_path,
+                                      vio_params.camera_params_.at(0),
+                                      vio_params.camera_params_.at(1));
+
+  // The modules are created when they get their first input: the Backend must
+  // be created after the initial state record.
+  VIO::VioBackend::UniquePtr backend = nullptr;
+  VIO::Mesher::UniquePtr mesher = nullptr;
+  VIO::LoopClosureDetector::UniquePtr lcd = nullptr;
+  VIO::utils::StatsCollector backend_timing("Replay Backend [ms]");
+  VIO::utils::StatsCollector mesher_timing("Replay Mesher [ms]");
+  VIO::utils::StatsCollector lcd_timing("Replay LCD [ms]");
+
+  VIO::PipelineRecord record;
+  size_t nr_records = 0u;
+  auto tic_replay = VIO::utils::Timer::tic();
+  while (reader.next(&record)) {
+    ++nr_records;
+    switch (record.type_) {
+      case VIO::PipelineRecordType::kInitialState: {
+        CHECK(!backend) << "The initial state must precede the inputs.";
+        vio_params.backend_params_->initial_ground_truth_state_ =
+            record.initial_state_;
+        break;
+      }
+      case VIO::PipelineRecordType::kBackendInput: {
+        if (!FLAGS_replay_backend) break;
+        if (!backend) {
+          backend = VIO::BackendFactory::createBackend(
+              static_cast<VIO::BackendType>(vio_params.backend_type_),
+              stereo_camera->getBodyPoseLeftCamRect(),
+              stereo_camera->getStereoCalib(),
+              *vio_params.backend_params_,
+              vio_params.imu_params_,
+              VIO::BackendOutputParams(false, 0, false),
+              false,
+              vio_params.odom_params_);
+        }
+        auto tic = VIO::utils::Timer::tic();
+        backend->spinOnce(*record.backend_input_);
+        backend_timing.AddSample(VIO::utils::Timer::toc(tic).count());
+        break;
+      }
+      case VIO::PipelineRecordType::kMesherInput: {
+        if (!FLAGS_replay_mesher) break;
+        if (!mesher) {
+          mesher = VIO::MesherFactory::createMesher(
+              VIO::MesherType::PROJECTIVE,
+              VIO::MesherParams(stereo_camera->getBodyPoseLeftCamRect(),
+                                vio_params.camera_params_.at(0u).image_size_));
+        }
+        auto tic = VIO::utils::Timer::tic();
+        mesher->spinOnce(*record.mesher_input_);
+        mesher_timing.AddSample(VIO::utils::Timer::toc(tic).count());
+        break;
+      }
+      case VIO::PipelineRecordType::kLcdInput: {
+        if (!FLAGS_replay_lcd) break;
+        if (!lcd) {
+          lcd = VIO::LcdFactory::createLcd(
+              vio_params.lcd_params_.lcd_type_,
+              vio_params.lcd_params_,
+              stereo_camera->getLeftCamParams(),
+              stereo_camera->getBodyPoseLeftCamRect(),
+              stereo_camera,
+              vio_params.frontend_params_.stereo_matching_params_,
+              std::nullopt,
+              false);
+          // Inputs are replayed one at a time: always optimize right away.
+          lcd->registerIsBackendQueueFilledCallback([]() { return false; });
+        }
+        auto tic = VIO::utils::Timer::tic();
+        lcd->spinOnce(*record.lcd_input_);
+        lcd_timing.AddSample(VIO::utils::Timer::toc(tic).count());
+        break;
+      }
+    }
+  }
+
+  LOG(INFO) << "Replayed " << nr_records << " records from "
+            << FLAGS_recording_path << " in "
+            << VIO::utils::Timer::toc(tic_replay).count() << " ms.";
+  std::cout << VIO::utils::Statistics::Print();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,53 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   LandmarkSelection.h
+ * @brief  Scores and selects the landmarks most informative for the latest
+ * pose, to bound the number of landmarks the backend adds per keyframe.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include <gtsam/base/Matrix.h>
+#include <gtsam/geometry/Cal3_S2Stereo.h>
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/geometry/StereoPoint2.h>
+
+#include "kimera-vio/common/vio_types.h"
+
+namespace VIO {
+
+using LandmarkScore = std::pair<LandmarkId, double>;
+
+/**
+ * @brief computeLandmarkInformationGain Information gained on the body pose
+ * by a stereo measurement of a landmark, in nats:
+ * log det(I + H * pose_covariance * H^T / sigma^2), with H the Jacobian of the
+ * measurement wrt the body pose, at the landmark backprojected from it.
+ * @param B_Pose_leftCamRect Pose of the left rectified camera in the body.
+ * @param pose_covariance Covariance of the body pose (rotation, translation).
+ * @return 0 if the measurement has no valid disparity.
+ */
+double computeLandmarkInformationGain(
+    const gtsam::StereoPoint2& measurement,
+    const gtsam::Cal3_S2Stereo::shared_ptr& stereo_cal,
+    const gtsam::Pose3& B_Pose_leftCamRect,
+    const gtsam::Matrix6& pose_covariance,
+    const double& noise_sigma);
+
+//! Ids of the (at most) max_nr_landmarks landmarks with the highest scores,
+//! by decreasing score.
+LandmarkIds selectMostInformativeLandmarks(std::vector<LandmarkScore> scores,
+                                           const size_t& max_nr_landmarks);
+
+}  // namespace VIO
@@ -0,0 +1,90 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ProjectionVioBackend.h
+ * @brief  VIO Backend with explicit landmarks in stereo projection factors,
+ * instead of smart factors.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <utility>
+
+#include <gtsam/slam/ProjectionFactor.h>
+#include <gtsam/slam/StereoFactor.h>
+
+#include "kimera-vio/backend/VioBackend-definitions.h"
+#include "kimera-vio/backend/VioBackend.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The ProjectionVioBackend class keeps each landmark as a variable of
+ * the smoother, with one projection factor per observation. A smart factor
+ * rebuilds the Schur complement of its whole track whenever it is
+ * relinearized, and is replaced (hence relinearized) at every new
+ * observation. Here a new observation only adds a factor, and iSAM2's
+ * elimination (constrained COLAMD, with the latest states last) eliminates
+ * the landmarks, which are leaves of the graph, before the poses observing
+ * them: the Schur complement is done once by the elimination, and only
+ * for the relinearized landmarks' cliques.
+ * Landmarks stay in the smoother as long as they are observed, and are
+ * marginalized once they fall out of the horizon.
+ */
+class ProjectionVioBackend : public VioBackend {
+ public:
+  KIMERA_POINTER_TYPEDEFS(ProjectionVioBackend);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(ProjectionVioBackend);
+
+  ProjectionVioBackend(const Pose3& B_Pose_leftCamRect,
+                       const StereoCalibPtr& stereo_calibration,
+                       const BackendParams& backend_params,
+                       const ImuParams& imu_params,
+                       const BackendOutputParams& backend_output_params,
+                       const bool& log_output,
+                       std::optional<OdometryParams> odom_params =
+                           std::nullopt);
+  virtual ~ProjectionVioBackend() = default;
+
+ protected:
+  void addLandmarksToGraph(const LandmarkIds& landmarks_kf) override;
+
+ private:
+  using StereoProjectionFactor = gtsam::GenericStereoFactor<Pose3, Point3>;
+  using MonoProjectionFactor =
+      gtsam::GenericProjectionFactor<Pose3, Point3, Cal3_S2>;
+
+  //! Estimate of the body pose of a keyframe in the smoother (or new).
+  std::optional<gtsam::Pose3> getPoseEstimate(const FrameId& frame_id) const;
+
+  /**
+   * @brief addNewLandmark Triangulates the landmark from its latest stereo
+   * observation, and adds it with its observations of keyframes still in
+   * the smoother.
+   * @return False if it can't be triangulated, or if fewer than 2 of its
+   * observations are of keyframes in the smoother.
+   */
+  bool addNewLandmark(const LandmarkId& lmk_id, const FeatureTrack& ft);
+
+  void addObservation(const LandmarkId& lmk_id,
+                      const std::pair<FrameId, StereoPoint2>& obs);
+
+  //! Deletes the feature tracks whose last observation is out of the
+  //! horizon: their landmark has been marginalized.
+  void deleteOldFeatureTracks();
+
+ private:
+  gtsam::SharedNoiseModel stereo_noise_;
+  gtsam::SharedNoiseModel mono_noise_;
+  Cal3_S2::shared_ptr mono_cal_;
+};
+
+}  // namespace VIO
@@ -49,6 +49,10 @@ class RegularVioBackend : public VioBackend {
       std::optional<gtsam::Pose3> odometry_body_pose = std::nullopt,
       std::optional<gtsam::Velocity3> odometry_vel = std::nullopt) override;
 
+  //! The regularity factors are updated with the smoother after each
+  //! keyframe, so keyframes can't be batched.
+  bool supportsBatchedUpdates() const override { return false; }
+
  private:
   typedef size_t Slot;
 
@@ -86,6 +90,16 @@ class RegularVioBackend : public VioBackend {
   size_t nr_of_planes_ = 0;
 
  private:
+  // Factors attached to a plane in the smoother, whose point plane factors
+  // are split in good (lmk still in the plane) and bad (lmk not anymore).
+  struct PlaneFactorSlots {
+    std::vector<std::pair<Slot, LandmarkId>> point_plane_factor_slots_bad;
+    std::vector<std::pair<Slot, LandmarkId>> point_plane_factor_slots_good;
+    bool has_prior = false;
+    bool has_linear_factor = false;
+    Slot prior_slot = 0;  // Invalid slot if there is no prior.
+  };
+
   /* ------------------------------------------------------------------------ */
   void addLandmarksToGraph(const LandmarkIds& lmks_kf,
                            const LandmarkIds& lmk_ids_with_regularity);
@@ -152,6 +166,28 @@ class RegularVioBackend : public VioBackend {
       PlaneIdToLmkIdRegType* plane_id_to_lmk_id_to_regularity_type_map,
       gtsam::FactorIndices* delete_slots);
 
+  /* ------------------------------------------------------------------------ */
+  // Same as removeOldRegularityFactors_Slow, but only visits the factors of
+  // each plane (through the smoother's variable index) instead of the whole
+  // graph, so that all planes are updated in a single pass.
+  void removeOldRegularityFactors(
+      const std::vector<Plane>& planes,
+      const std::map<PlaneId, std::vector<std::pair<Slot, LandmarkId>>>&
+          map_idx_of_point_plane_factors_to_add,
+      PlaneIdToLmkIdRegType* plane_id_to_lmk_id_to_regularity_type_map,
+      gtsam::FactorIndices* delete_slots);
+
+  /* ------------------------------------------------------------------------ */
+  // Decide whether to delete only the bad factors of the plane, or to put a
+  // prior on it, or to remove it, depending on its remaining constraints.
+  void removeOldRegularityFactorsOfPlane(
+      const gtsam::Key& plane_key,
+      const PlaneFactorSlots& plane_factor_slots,
+      const std::vector<std::pair<Slot, LandmarkId>>&
+          idx_of_point_plane_factors_to_add,
+      LmkIdToRegularityTypeMap* lmk_id_to_regularity_type_map,
+      gtsam::FactorIndices* delete_slots);
+
   /* ------------------------------------------------------------------------ */
   void fillDeleteSlots(
       const std::vector<std::pair<Slot, LandmarkId>>& point_plane_factor_slots,
@@ -0,0 +1,232 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   SlidingWindowSolver.h
+ * @brief  Gauss-Newton solver over a fixed-size window of keyframe states,
+ * with a dense Hessian, Schur elimination of the landmarks and an explicit
+ * marginalization prior.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include <Eigen/Cholesky>
+#include <Eigen/Core>
+
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/geometry/StereoPoint2.h>
+#include <gtsam/nonlinear/NonlinearFactor.h>
+#include <gtsam/nonlinear/Values.h>
+
+#include "kimera-vio/backend/VioBackend-definitions.h"
+#include "kimera-vio/common/LandmarkStore.h"
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/imu-frontend/ImuFrontend-definitions.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+struct SlidingWindowSolverParams {
+  //! Nr of keyframes in the window.
+  size_t window_size = 10u;
+  //! Pose of the left camera wrt the body.
+  gtsam::Pose3 B_Pose_leftCamRect = gtsam::Pose3();
+  //! Std deviation of the stereo measurements [px].
+  double stereo_noise_sigma = 3.0;
+  //! Huber threshold on the whitened stereo reprojection error.
+  double huber_threshold = 8.0 / 3.0;
+  //! Stop iterating once the state update norm is below this threshold.
+  double convergence_threshold = 1e-6;
+};
+
+/**
+ * @brief The SlidingWindowSolver class estimates the pose, velocity and IMU
+ * bias of the keyframes in a fixed-size window, along with the landmarks they
+ * observe, without going through a generic factor graph solver.
+ *
+ * Each Gauss-Newton iteration builds the dense Hessian of the window states
+ * (15 per keyframe), with the landmarks Schur-eliminated one at a time (3x3),
+ * solves it with a dense LDLT, and back-substitutes the landmarks. Keyframes
+ * have a fixed slot in the Hessian: slot = frame id % window size, so adding
+ * a keyframe never reorders nor reallocates it. When the window is full,
+ * the oldest keyframe, along with the landmarks it observes, is marginalized
+ * into a dense prior on the other keyframes before its slot is reused.
+ * All the dense workspace is allocated at construction; the cost of an
+ * iteration only depends on the window size and on the nr of observations.
+ *
+ * The inertial (and other) factors on the states are gtsam factors on the
+ * pose, velocity and IMU bias symbols of the keyframes, linearized with
+ * reused Jacobian buffers. Landmarks are stereo (or monocular, without a
+ * valid right pixel) observations, with a Huber kernel.
+ */
+class SlidingWindowSolver {
+ public:
+  KIMERA_POINTER_TYPEDEFS(SlidingWindowSolver);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(SlidingWindowSolver);
+
+  //! Pose (6), velocity (3) and IMU bias (6) of a keyframe.
+  static constexpr size_t kStateDim = 15u;
+
+  SlidingWindowSolver(const SlidingWindowSolverParams& params,
+                      const StereoCalibPtr& stereo_calibration);
+  ~SlidingWindowSolver() = default;
+
+  /**
+   * @brief addKeyframe Adds the state of the next keyframe (with consecutive
+   * ids), marginalizing the oldest keyframe first if the window is full.
+   * @param[out] marginalized_lmk_ids Landmarks marginalized with the oldest
+   * keyframe: they are not in the solver anymore.
+   */
+  void addKeyframe(const FrameId& frame_id,
+                   const gtsam::Pose3& W_Pose_B,
+                   const gtsam::Vector3& W_Vel_B,
+                   const ImuBias& imu_bias,
+                   LandmarkIds* marginalized_lmk_ids);
+
+  //! Adds a factor on the pose, velocity and IMU bias of keyframes in the
+  //! window (e.g. IMU, priors, between factors).
+  void addFactor(const gtsam::NonlinearFactor::shared_ptr& factor);
+
+  /**
+   * @brief addLandmark Triangulates a new landmark from its latest stereo
+   * observation, and adds its observations of keyframes in the window.
+   * @return False if it can't be triangulated within max_distance, or if
+   * fewer than 2 of its observations are of keyframes in the window.
+   */
+  bool addLandmark(const LandmarkId& lmk_id,
+                   const FeatureTrack& feature_track,
+                   const double& max_distance);
+
+  void addObservation(const LandmarkId& lmk_id,
+                      const std::pair<FrameId, StereoPoint2>& observation);
+
+  inline bool hasLandmark(const LandmarkId& lmk_id) const {
+    return landmarks_.count(lmk_id) > 0u;
+  }
+
+  /**
+   * @brief optimize Runs up to nr_iterations Gauss-Newton iterations.
+   * @return False if the linear system could not be solved: the estimate
+   * is left as after the last successful iteration.
+   */
+  bool optimize(const size_t& nr_iterations);
+
+  //! Poses, velocities and IMU biases of the keyframes in the window, and
+  //! landmarks, with the usual symbols.
+  void getEstimate(gtsam::Values* estimate) const;
+
+  inline size_t getNrKeyframes() const { return nr_keyframes_; }
+  //! Id of the oldest keyframe in the window, valid if it is not empty.
+  inline FrameId getOldestFrameId() const {
+    return newest_frame_id_ + 1u - nr_keyframes_;
+  }
+  inline size_t getNrLandmarks() const { return landmarks_.size(); }
+
+ private:
+  struct Keyframe {
+    FrameId frame_id = 0u;
+    bool active = false;
+    gtsam::Pose3 W_Pose_B;
+    gtsam::Vector3 W_Vel_B = gtsam::Vector3::Zero();
+    ImuBias imu_bias;
+    //! Linearization point of the marginalization prior.
+    gtsam::Pose3 lin_W_Pose_B;
+    gtsam::Vector3 lin_W_Vel_B = gtsam::Vector3::Zero();
+    ImuBias lin_imu_bias;
+  };
+
+  //! Block of the state of a keyframe that a factor key refers to.
+  struct KeyBlock {
+    FrameId frame_id;
+    size_t offset;  //!< within the keyframe state
+    size_t dim;
+  };
+
+  struct StateFactor {
+    gtsam::NonlinearFactor::shared_ptr factor;
+    const gtsam::NoiseModelFactor* noise_factor;
+    std::vector<KeyBlock> blocks;
+    FrameId oldest_frame_id;
+    //! Whitened Jacobians and error at the last linearization.
+    std::vector<gtsam::Matrix> jacobians;
+    gtsam::Vector error;
+  };
+
+  struct Observation {
+    FrameId frame_id;
+    StereoPoint2 measurement;
+    bool valid = false;
+    //! Whitened, reweighted Jacobians and error at the last linearization.
+    Eigen::Matrix<double, 3, 6> J_pose;
+    Eigen::Matrix3d J_point;
+    Eigen::Vector3d error;
+    //! J_pose^T * J_point
+    Eigen::Matrix<double, 6, 3> H_pose_point;
+  };
+
+  struct WindowLandmark {
+    gtsam::Point3 W_point;
+    std::vector<Observation> observations;
+    bool valid = false;
+    Eigen::Matrix3d H_point_inv;
+    Eigen::Vector3d g_point;
+  };
+
+  inline size_t slot(const FrameId& frame_id) const {
+    return frame_id % params_.window_size;
+  }
+  inline size_t offset(const FrameId& frame_id) const {
+    return slot(frame_id) * kStateDim;
+  }
+  inline bool isInWindow(const FrameId& frame_id) const {
+    const Keyframe& keyframe = keyframes_[slot(frame_id)];
+    return keyframe.active && keyframe.frame_id == frame_id;
+  }
+
+  void linearize(StateFactor* factor) const;
+  void addToSystem(const StateFactor& factor);
+  void linearize(WindowLandmark* landmark) const;
+  void addToSystem(const WindowLandmark& landmark);
+  //! Prior at the current estimate, relinearized to first order.
+  void addPriorToSystem();
+  void marginalizeOldestKeyframe(LandmarkIds* marginalized_lmk_ids);
+  void updateValues(const Keyframe& keyframe);
+
+ private:
+  const SlidingWindowSolverParams params_;
+  const StereoCalibPtr stereo_cal_;
+  const size_t dim_;
+
+  std::vector<Keyframe> keyframes_;
+  size_t nr_keyframes_ = 0u;
+  FrameId newest_frame_id_ = 0u;
+  //! States of the window, to evaluate the gtsam factors.
+  gtsam::Values values_;
+  std::vector<StateFactor> factors_;
+  LandmarkStore<WindowLandmark> landmarks_;
+
+  //! Marginalization prior, at the keyframes' linearization points.
+  bool has_prior_ = false;
+  gtsam::Matrix H_prior_;
+  gtsam::Vector g_prior_;
+
+  //! Workspace.
+  gtsam::Matrix H_;
+  gtsam::Vector g_;
+  gtsam::Vector delta_;
+  gtsam::Vector prior_error_;
+  gtsam::Matrix marginal_cols_;
+  gtsam::Matrix marginal_rows_;
+  Eigen::LDLT<gtsam::Matrix> ldlt_;
+};
+
+}  // namespace VIO
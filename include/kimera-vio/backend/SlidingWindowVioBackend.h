@@ -0,0 +1,81 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   SlidingWindowVioBackend.h
+ * @brief  VIO Backend optimizing a fixed-size window of keyframes with a
+ * dedicated solver, instead of the smoother.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include "kimera-vio/backend/SlidingWindowSolver.h"
+#include "kimera-vio/backend/VioBackend-definitions.h"
+#include "kimera-vio/backend/VioBackend.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The SlidingWindowVioBackend class builds the same inertial and
+ * visual problem as the other Backends, but solves it with a
+ * SlidingWindowSolver over the last slidingWindowSize_ keyframes: a dense
+ * Hessian of fixed size, with the landmarks Schur-eliminated and an explicit
+ * marginalization prior, instead of iSAM2's incremental machinery (variable
+ * ordering, Bayes tree, fluid relinearization).
+ * Landmarks observed by the oldest keyframe of the window are marginalized
+ * along with it, and are triangulated again from their next observations.
+ * The smoother is left empty.
+ */
+class SlidingWindowVioBackend : public VioBackend {
+ public:
+  KIMERA_POINTER_TYPEDEFS(SlidingWindowVioBackend);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(SlidingWindowVioBackend);
+
+  SlidingWindowVioBackend(const Pose3& B_Pose_leftCamRect,
+                          const StereoCalibPtr& stereo_calibration,
+                          const BackendParams& backend_params,
+                          const ImuParams& imu_params,
+                          const BackendOutputParams& backend_output_params,
+                          const bool& log_output,
+                          std::optional<OdometryParams> odom_params =
+                              std::nullopt);
+  virtual ~SlidingWindowVioBackend() = default;
+
+  //! The window can only be extended one keyframe at a time.
+  bool supportsBatchedUpdates() const override { return false; }
+
+ protected:
+  //! Only records the landmarks of the keyframe: they are added to the
+  //! solver once the keyframe is in the window.
+  void addLandmarksToGraph(const LandmarkIds& landmarks_kf) override;
+
+  bool optimize(const Timestamp& timestamp_kf_nsec,
+                const FrameId& cur_id,
+                const size_t& max_iterations,
+                const gtsam::FactorIndices& extra_factor_slots_to_delete =
+                    gtsam::FactorIndices()) override;
+
+ private:
+  //! Adds the landmarks of the current keyframe to the solver.
+  void addLandmarksToSolver(const FrameId& cur_id);
+
+  //! Deletes the feature tracks whose last observation is out of the
+  //! window: their landmark has been marginalized.
+  void deleteOldFeatureTracks();
+
+ private:
+  SlidingWindowSolver solver_;
+  //! Landmarks of the current keyframe, to add to the solver.
+  LandmarkIds landmarks_kf_;
+  //! Landmarks marginalized with the oldest keyframe (workspace).
+  LandmarkIds marginalized_lmk_ids_;
+};
+
+}  // namespace VIO
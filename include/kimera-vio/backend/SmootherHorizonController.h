@@ -0,0 +1,79 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   SmootherHorizonController.h
+ * @brief  Adapts the smoother horizon and its number of iterations per
+ * keyframe to the measured optimization time, to meet a target latency.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+struct SmootherHorizonControllerParams {
+  //! Target time of an optimization (update and extra iterations).
+  double target_latency_ms = 30.0;
+  //! Grow the horizon when the filtered time is below this ratio of the
+  //! target latency.
+  double slack_ratio = 0.6;
+  //! Weight of the latest measurement in the filtered optimization time.
+  double time_filter_weight = 0.2;
+  //! Bounds and step of the horizon, in number of keyframes.
+  double min_nr_states = 5.0;
+  double max_nr_states = 60.0;
+  double nr_states_step = 1.0;
+  //! Keyframes to wait after a decision, to measure its effect.
+  size_t cooldown_keyframes = 5u;
+};
+
+/**
+ * @brief The SmootherHorizonController class decides, after each
+ * optimization, the horizon and the number of smoother updates for the next
+ * ones. Under load, it first drops extra iterations, then shrinks the
+ * horizon; with slack, it first grows the horizon back, then the iterations.
+ */
+class SmootherHorizonController {
+ public:
+  KIMERA_POINTER_TYPEDEFS(SmootherHorizonController);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(SmootherHorizonController);
+
+  /**
+   * @param nr_states Initial horizon, clamped to the params' bounds.
+   * @param max_num_optimize Max number of smoother updates per keyframe (at
+   * least 1), as BackendParams::numOptimize_.
+   */
+  SmootherHorizonController(const SmootherHorizonControllerParams& params,
+                            const double& nr_states,
+                            const size_t& max_num_optimize);
+  ~SmootherHorizonController() = default;
+
+  //! Feeds the time of the last optimization.
+  //! @return True if the horizon or the number of updates changed.
+  bool update(const double& optimize_time_ms);
+
+  inline double getNrStates() const { return nr_states_; }
+  inline size_t getNumOptimize() const { return num_optimize_; }
+  inline double getFilteredTimeMs() const { return filtered_time_ms_; }
+
+ private:
+  const SmootherHorizonControllerParams params_;
+  const size_t max_num_optimize_;
+  double nr_states_;
+  size_t num_optimize_;
+  double filtered_time_ms_;
+  size_t nr_measurements_;
+  size_t keyframes_since_decision_;
+};
+
+}  // namespace VIO
@@ -22,6 +22,7 @@
 
 #include <vector>
 
+#include "kimera-vio/common/LandmarkStore.h"
 #include "kimera-vio/common/VioNavState.h"
 #include "kimera-vio/common/vio_types.h"
 #include "kimera-vio/frontend/StereoVisionImuFrontend-definitions.h"
@@ -70,8 +71,8 @@ using PointWithId = std::pair<LandmarkId, Landmark>;
 using PointsWithId = std::vector<PointWithId>;
 // TODO(Toni):  there is the same in vio_types.cpp, replace by that one, since
 // now the frontend also has such concept.
-using PointsWithIdMap = std::unordered_map<LandmarkId, Landmark>;
-using LmkIdToLmkTypeMap = std::unordered_map<LandmarkId, LandmarkType>;
+using PointsWithIdMap = LandmarkStore<Landmark>;
+using LmkIdToLmkTypeMap = LandmarkStore<LandmarkType>;
 
 ////////////////////////////////////////////////////////////////////////////////
 // FeatureTrack
@@ -105,7 +106,7 @@ class FeatureTrack {
 // Key is the lmk_id and feature track the collection of pairs of
 // frame id and pixel location.
 // TODO(Toni): what is this doing here... should be in Frontend at worst.
-using FeatureTracks = std::unordered_map<LandmarkId, FeatureTrack>;
+using FeatureTracks = LandmarkStore<FeatureTrack>;
 
 ////////////////////////////////////////////////////////////////////////////////
 class DebugVioInfo {
@@ -224,6 +225,26 @@ class DebugVioInfo {
   }
 };
 
+////////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief The CameraMeasurements struct holds the keyframe measurements of one
+ * camera of a multi-camera rig (see MultiCameraVisionImuFrontend): these are
+ * mono measurements, hence the right pixel coordinate is NaN.
+ */
+struct CameraMeasurements {
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  CameraMeasurements() = default;
+  CameraMeasurements(const gtsam::Pose3& body_Pose_cam,
+                     const StatusStereoMeasurementsPtr& status_measurements)
+      : body_Pose_cam_(body_Pose_cam),
+        status_measurements_(status_measurements) {}
+
+  //! Extrinsics of the camera.
+  gtsam::Pose3 body_Pose_cam_;
+  StatusStereoMeasurementsPtr status_measurements_;
+};
+using MultiCameraMeasurements = std::vector<CameraMeasurements>;
+
 ////////////////////////////////////////////////////////////////////////////////
 struct BackendInput : public PipelinePayload {
  public:
@@ -238,13 +259,16 @@ struct BackendInput : public PipelinePayload {
       const ImuAccGyrS& imu_acc_gyrs,
       std::optional<gtsam::Pose3> body_lkf_OdomPose_body_kf = std::nullopt,
       std::optional<gtsam::Velocity3> body_kf_world_OdomVel_body_kf =
-          std::nullopt)
+          std::nullopt,
+      const MultiCameraMeasurements& multi_camera_measurements =
+          MultiCameraMeasurements())
       : PipelinePayload(timestamp_kf_nsec),
         status_stereo_measurements_kf_(status_stereo_measurements_kf),
         pim_(pim),
         imu_acc_gyrs_(imu_acc_gyrs),
         body_lkf_OdomPose_body_kf_(body_lkf_OdomPose_body_kf),
-        body_kf_world_OdomVel_body_kf_(body_kf_world_OdomVel_body_kf) {}
+        body_kf_world_OdomVel_body_kf_(body_kf_world_OdomVel_body_kf),
+        multi_camera_measurements_(multi_camera_measurements) {}
 
  public:
   const StatusStereoMeasurementsPtr status_stereo_measurements_kf_;
@@ -255,6 +279,10 @@ struct BackendInput : public PipelinePayload {
   // velocity of the current keyframe body w.r.t. the world frame in the body
   // frame
   std::optional<gtsam::Velocity3> body_kf_world_OdomVel_body_kf_;
+  //! Measurements of each camera of a multi-camera rig, empty otherwise.
+  //! The first camera is the reference one, whose measurements are also in
+  //! status_stereo_measurements_kf_, the only ones used by the backends.
+  MultiCameraMeasurements multi_camera_measurements_;
 
  public:
   void print() const {
@@ -282,6 +310,48 @@ struct BackendInput : public PipelinePayload {
   }
 };
 
+////////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief The BackendOutputFields struct lists the heavy fields of the
+ * BackendOutput. The navigation state, keyframe id and landmark count are
+ * always filled, the fields below only if requested (see
+ * VioBackendModule::registerOutputCallback): otherwise they are left empty,
+ * instead of copying the smoother's state and graph at every keyframe.
+ */
+struct BackendOutputFields {
+  //! The smoother's estimate (gtsam::Values).
+  bool state_ = false;
+  //! The smoother's factor graph.
+  bool factor_graph_ = false;
+  //! The covariance of the last keyframe's state.
+  bool state_covariance_ = false;
+  //! Statistics of the optimization.
+  bool debug_info_ = false;
+
+  static BackendOutputFields all() { return {true, true, true, true}; }
+
+  inline BackendOutputFields& operator|=(const BackendOutputFields& other) {
+    state_ |= other.state_;
+    factor_graph_ |= other.factor_graph_;
+    state_covariance_ |= other.state_covariance_;
+    debug_info_ |= other.debug_info_;
+    return *this;
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//! Changes of the landmarks in time horizon since the previous output, for
+//! consumers that keep their own copy of the map.
+struct LandmarksDelta {
+  PointsWithIdMap added_;
+  PointsWithIdMap moved_;
+  LandmarkIds removed_;
+
+  inline bool empty() const {
+    return added_.empty() && moved_.empty() && removed_.empty();
+  }
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 struct BackendOutput : public PipelinePayload {
   KIMERA_POINTER_TYPEDEFS(BackendOutput);
@@ -298,7 +368,9 @@ struct BackendOutput : public PipelinePayload {
                 const int& landmark_count,
                 const DebugVioInfo& debug_info,
                 const PointsWithIdMap& landmarks_with_id_map,
-                const LmkIdToLmkTypeMap& lmk_id_to_lmk_type_map)
+                const LmkIdToLmkTypeMap& lmk_id_to_lmk_type_map,
+                const BackendOutputFields& fields = BackendOutputFields::all(),
+                const LandmarksDelta& landmarks_delta = LandmarksDelta())
       : PipelinePayload(timestamp_kf),
         W_State_Blkf_(timestamp_kf, W_Pose_Blkf, W_Vel_Blkf, imu_bias_lkf),
         state_(state),
@@ -308,7 +380,9 @@ struct BackendOutput : public PipelinePayload {
         landmark_count_(landmark_count),
         debug_info_(debug_info),
         landmarks_with_id_map_(landmarks_with_id_map),
-        lmk_id_to_lmk_type_map_(lmk_id_to_lmk_type_map) {}
+        lmk_id_to_lmk_type_map_(lmk_id_to_lmk_type_map),
+        fields_(fields),
+        landmarks_delta_(landmarks_delta) {}
 
   BackendOutput(const VioNavStateTimestamped& vio_navstate_timestamped,
                 const gtsam::Values& state,
@@ -318,7 +392,9 @@ struct BackendOutput : public PipelinePayload {
                 const int& landmark_count,
                 const DebugVioInfo& debug_info,
                 const PointsWithIdMap& landmarks_with_id_map,
-                const LmkIdToLmkTypeMap& lmk_id_to_lmk_type_map)
+                const LmkIdToLmkTypeMap& lmk_id_to_lmk_type_map,
+                const BackendOutputFields& fields = BackendOutputFields::all(),
+                const LandmarksDelta& landmarks_delta = LandmarksDelta())
       : PipelinePayload(vio_navstate_timestamped.timestamp_),
         W_State_Blkf_(vio_navstate_timestamped),
         state_(state),
@@ -328,7 +404,9 @@ struct BackendOutput : public PipelinePayload {
         landmark_count_(landmark_count),
         debug_info_(debug_info),
         landmarks_with_id_map_(landmarks_with_id_map),
-        lmk_id_to_lmk_type_map_(lmk_id_to_lmk_type_map) {}
+        lmk_id_to_lmk_type_map_(lmk_id_to_lmk_type_map),
+        fields_(fields),
+        landmarks_delta_(landmarks_delta) {}
 
   const VioNavStateTimestamped W_State_Blkf_;
   const gtsam::Values state_;
@@ -339,6 +417,10 @@ struct BackendOutput : public PipelinePayload {
   const DebugVioInfo debug_info_;
   const PointsWithIdMap landmarks_with_id_map_;
   const LmkIdToLmkTypeMap lmk_id_to_lmk_type_map_;
+  //! Which of the heavy fields above are filled, the others are empty.
+  const BackendOutputFields fields_;
+  //! Changes of landmarks_with_id_map_ since the previous output.
+  const LandmarksDelta landmarks_delta_;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -346,7 +428,16 @@ struct BackendOutput : public PipelinePayload {
  *  - kStereoImu: vanilla Backend type using Stereo and IMU
  *  - kStructuralRegularities: the `regular VIO` Backend, using structural
  * regularities derived from the 3D Mesh.
+ *  - kProjection: Stereo and IMU, with explicit landmarks in projection
+ * factors instead of smart factors.
+ *  - kSlidingWindow: Stereo and IMU, with a dedicated fixed-size sliding
+ * window solver instead of the smoother.
  */
-enum class BackendType { kStereoImu = 0, kStructuralRegularities = 1 };
+enum class BackendType {
+  kStereoImu = 0,
+  kStructuralRegularities = 1,
+  kProjection = 2,
+  kSlidingWindow = 3
+};
 
 }  // namespace VIO
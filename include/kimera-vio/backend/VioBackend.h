@@ -46,10 +46,16 @@
 
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "kimera-vio/backend/VioBackend-definitions.h"
+#include "kimera-vio/backend/SmootherHorizonController.h"
 #include "kimera-vio/backend/VioBackendParams.h"
 #include "kimera-vio/factors/PointPlaneFactor.h"
 #include "kimera-vio/frontend/OdometryParams.h"
@@ -57,7 +63,10 @@
 #include "kimera-vio/imu-frontend/ImuFrontend.h"
 #include "kimera-vio/initial/InitializationFromImu.h"
 #include "kimera-vio/logging/Logger.h"
+#include "kimera-vio/utils/LowPriorityWorker.h"
 #include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/MemoryAccounting.h"
+#include "kimera-vio/utils/PoolAllocator.h"
 #include "kimera-vio/utils/ThreadsafeQueue.h"
 #include "kimera-vio/utils/UtilsGTSAM.h"
 #include "kimera-vio/utils/UtilsOpenCV.h"
@@ -95,6 +104,21 @@ class VioBackend {
  public:
   BackendOutput::UniquePtr spinOnce(const BackendInput& input);
 
+  /**
+   * @brief spinOnceBatched Adds the keyframes of all inputs to the smoother
+   * with a single update, instead of one update per keyframe. Used to catch
+   * up when keyframes queued up while the Backend was busy.
+   * The Backend must be initialized, and support batched updates.
+   * @param inputs At most maxBatchedKeyframes consecutive keyframes.
+   * @return One output per input, in the same order, or none if the smoother
+   * update failed.
+   */
+  std::vector<BackendOutput::UniquePtr> spinOnceBatched(
+      const std::vector<BackendInput::UniquePtr>& inputs);
+
+  //! Whether spinOnceBatched can be used with this Backend.
+  virtual bool supportsBatchedUpdates() const { return true; }
+
   /**
    * @brief isInitialized Returns whether the Frontend is initializing.
    * Needs to be Thread-Safe! Therefore, frontend_state_ is atomic.
@@ -118,15 +142,27 @@ class VioBackend {
    */
   void registerMapUpdateCallback(const MapCallback& map_update_callback);
 
+  /**
+   * @brief setOutputFields Sets which heavy fields of the BackendOutput are
+   * filled (all by default). Call before the first input.
+   */
+  inline void setOutputFields(const BackendOutputFields& output_fields) {
+    output_fields_ = output_fields;
+  }
+  inline BackendOutputFields getOutputFields() const { return output_fields_; }
+
   // Get valid 3D points - TODO: this copies the graph.
   void get3DPoints(std::vector<gtsam::Point3>* points_3d) const;
 
   // Get valid 3D points and corresponding lmk id.
   // Warning! it modifies old_smart_factors_!!
+  // The points are kept across calls: only the changed ones are updated, and
+  // reported in landmarks_delta (changes since the previous call).
   PointsWithIdMap getMapLmkIdsTo3dPointsInTimeHorizon(
       const gtsam::NonlinearFactorGraph& graph,
       LmkIdToLmkTypeMap* lmk_id_to_lmk_type_map = nullptr,
-      const size_t& min_age = 2);
+      const size_t& min_age = 2,
+      LandmarksDelta* landmarks_delta = nullptr);
 
   inline gtsam::Matrix getCurrentStateCovariance() const {
     return state_covariance_lkf_;
@@ -136,12 +172,65 @@ class VioBackend {
   // NOT TESTED
   void computeStateCovariance();
 
+  /**
+   * @brief getRootCliqueCovariance Joint covariance of the given keys, from
+   * the root clique of the iSAM2 Bayes tree (reusing the smoother's
+   * factorization), in the order of gtsam::Marginals (sorted keys).
+   * @return False if not all keys are frontal variables of the root clique.
+   */
+  bool getRootCliqueCovariance(const gtsam::KeyVector& keys,
+                               gtsam::Matrix* covariance) const;
+
+  //! Approximate bytes held by the smoother: its estimate, factors and Bayes
+  //! tree. Linear in the nr of cliques.
+  size_t getSmootherMemoryBytes() const;
+
   // Set initial state at given pose, velocity and bias.
   bool initStateAndSetPriors(
       const VioNavStateTimestamped& vio_nav_state_initial_seed);
 
+  /**
+   * @brief setResumeState Seeds the Backend initialization with a previously
+   * estimated state (e.g. from a PipelineCheckpoint), instead of initializing
+   * it according to autoInitialize_. Must be called before the first input.
+   * @param resume_state State (and IMU bias) at the first input's timestamp,
+   * estimated at its own timestamp.
+   * @param max_age Max time between the state and the first input: the
+   * Backend is initialized according to autoInitialize_ instead if the first
+   * input is older or more recent, as the state's velocity would be stale.
+   */
+  inline void setResumeState(const VioNavStateTimestamped& resume_state,
+                             const Timestamp& max_age) {
+    CHECK(backend_state_ == BackendState::Bootstrap)
+        << "Can only resume a Backend that is not initialized yet.";
+    CHECK_GE(max_age, 0);
+    resume_state_ = resume_state;
+    max_resume_state_age_ = max_age;
+  }
+
+  /**
+   * @brief setRelocalizationPrior Re-seeds the pose of a keyframe, e.g. from
+   * a verified match against the keyframes before a tracking loss: a pose
+   * prior is added at the next update, if the keyframe is still in the
+   * smoother, and the output pose continues from the relocalized estimate.
+   * Thread-safe.
+   * @param kf_id Keyframe to relocalize.
+   * @param W_Pose_B Its pose, in the world frame of the Backend outputs
+   * (i.e. of W_State_Blkf_, which may be chained from increments).
+   */
+  void setRelocalizationPrior(const FrameId& kf_id,
+                              const gtsam::Pose3& W_Pose_B,
+                              const double& rotation_precision,
+                              const double& translation_precision);
+
+  inline size_t getNrRelocalizations() const { return nr_relocalizations_; }
+
   void initializeBackend(const BackendInput& input) {
     CHECK(backend_state_ == BackendState::Bootstrap);
+    if (resume_state_ && initializeFromResumeState(input)) {
+      backend_state_ = BackendState::Nominal;
+      return;
+    }
     switch (backend_params_.autoInitialize_) {
       case 0: {
         initializeFromGt(input);
@@ -170,6 +259,25 @@ class VioBackend {
         input.timestamp_, backend_params_.initial_ground_truth_state_));
   }
 
+  //! Returns false, without initializing, if the resume state is too old.
+  bool initializeFromResumeState(const BackendInput& input) {
+    CHECK(resume_state_);
+    const VioNavStateTimestamped resume_state = *resume_state_;
+    resume_state_.reset();
+    const Timestamp age = input.timestamp_ - resume_state.timestamp_;
+    if (age < 0 || age > max_resume_state_age_) {
+      LOG(WARNING) << "Not resuming Backend at timestamp " << input.timestamp_
+                   << " from the state at timestamp "
+                   << resume_state.timestamp_ << ", initializing normally.";
+      return false;
+    }
+    LOG(INFO) << "Resuming Backend at timestamp " << input.timestamp_
+              << " from the state at timestamp " << resume_state.timestamp_
+              << ".";
+    return initStateAndSetPriors(
+        VioNavStateTimestamped(input.timestamp_, resume_state));
+  }
+
   /**
    * @brief initializeFromIMU
    * Assumes Zero Velocity & upright vehicle. Uses the InitializationFromIMU
@@ -223,7 +331,15 @@ class VioBackend {
       std::optional<gtsam::Velocity3> odometry_vel = std::nullopt);
 
   // Uses landmark table to add factors in graph.
-  void addLandmarksToGraph(const LandmarkIds& landmarks_kf);
+  virtual void addLandmarksToGraph(const LandmarkIds& landmarks_kf);
+
+  /**
+   * @brief selectLandmarks Keeps the landmarks of the keyframe that fit in
+   * the backend's per-keyframe landmark budget: all the ones already in the
+   * graph, and the new ones with the highest information gain on the latest
+   * pose (given the latest state covariance, if computed).
+   */
+  LandmarkIds selectLandmarks(const LandmarkIds& landmarks_kf) const;
 
   // Adds a landmark to the graph for the first time.
   void addLandmarkToGraph(const LandmarkId& lm_id, const FeatureTrack& lm);
@@ -266,12 +382,25 @@ class VioBackend {
                         const gtsam::Velocity3& vel,
                         const double& precision);
 
+  //! Adds the pose prior given to setRelocalizationPrior, if any.
+  //! @return True if it was added.
+  bool addRelocalizationPrior();
+
   void addBetweenFactor(const FrameId& from_id,
                         const FrameId& to_id,
                         const gtsam::Pose3& from_id_POSE_to_id,
                         const double& between_rotation_precision,
                         const double& between_translation_precision);
 
+  //! Noise models of the between factors and velocity priors, created once
+  //! per precision (i.e. once per Backend/Odometry params) and shared by all
+  //! the factors using them: noise models are never modified.
+  const gtsam::SharedNoiseModel& getBetweenNoiseModel(
+      const double& rotation_precision,
+      const double& translation_precision);
+  const gtsam::SharedNoiseModel& getVelocityPriorNoiseModel(
+      const double& precision);
+
   /**
    * @brief optimize
    * @param timestamp_kf_nsec
@@ -280,11 +409,16 @@ class VioBackend {
    * @param extra_factor_slots_to_delete
    * @return False if optimization failed, true otherwise
    */
-  bool optimize(const Timestamp& timestamp_kf_nsec,
-                const FrameId& cur_id,
-                const size_t& max_iterations,
-                const gtsam::FactorIndices& extra_factor_slots_to_delete =
-                    gtsam::FactorIndices());
+  virtual bool optimize(const Timestamp& timestamp_kf_nsec,
+                        const FrameId& cur_id,
+                        const size_t& max_iterations,
+                        const gtsam::FactorIndices&
+                            extra_factor_slots_to_delete =
+                                gtsam::FactorIndices());
+
+  //! Updates the latest keyframe state from the estimate in state_, and
+  //! sends the IMU bias to the Frontend.
+  void updateStates(const FrameId& cur_id);
   /// Printers.
   void printFeatureTracks() const;
 
@@ -293,17 +427,40 @@ class VioBackend {
 
   bool deleteLmkFromFeatureTracks(const LandmarkId& lmk_id);
 
+  /**
+   * @brief triangulateSmartFactors Triangulates in parallel the smart factors
+   * among the new factors, at the point where the smoother linearizes them.
+   * Their triangulation is cached, and reused by the smoother's (serial)
+   * linearization as long as the poses move less than the retriangulation
+   * threshold: only the Schur complements are left to the update.
+   */
+  void triangulateSmartFactors(const gtsam::NonlinearFactorGraph& new_factors,
+                               const gtsam::Values& new_values) const;
+
  private:
   bool addVisualInertialStateAndOptimize(const BackendInput& input);
 
+  /**
+   * @brief updateMap Computes the landmarks in the time horizon (if
+   * requested in the output params), and sends them to the map callback.
+   */
+  void updateMap(PointsWithIdMap* lmk_ids_to_3d_points_in_time_horizon,
+                 LmkIdToLmkTypeMap* lmk_id_to_lmk_type_map,
+                 LandmarksDelta* landmarks_delta);
+
+  //! Creates the output of keyframe kf_id, with the current smoother state.
+  BackendOutput::UniquePtr createOutput(
+      const VioNavStateTimestamped& W_State_B_kf,
+      const FrameId& kf_id,
+      const PointsWithIdMap& lmk_ids_to_3d_points_in_time_horizon,
+      const LmkIdToLmkTypeMap& lmk_id_to_lmk_type_map,
+      const LandmarksDelta& landmarks_delta = LandmarksDelta());
+
   // Add initial prior factors.
   void addInitialPriorFactors(const FrameId& frame_id);
 
   void addConstantVelocityFactor(const FrameId& from_id, const FrameId& to_id);
 
-  // Update states.
-  void updateStates(const FrameId& cur_id);
-
   /**
    * @brief updateSmoother
    * @param result
@@ -322,6 +479,62 @@ class VioBackend {
           gtsam::FixedLagSmoother::KeyTimestampMap(),
       const gtsam::FactorIndices& delete_slots = gtsam::FactorIndices());
 
+ protected:
+  //! What is needed to roll back a failed update of the smoother: much
+  //! cheaper to keep than a copy of the smoother (with its Bayes tree).
+  struct SmootherSnapshot {
+    gtsam::NonlinearFactorGraph factors;  //!< Shallow copy, with empty slots.
+    gtsam::Values linearization_point;
+    gtsam::FixedLagSmoother::KeyTimestampMap timestamps;
+    //! The lag the keys were kept with: the current one may be shorter.
+    double lag;
+  };
+
+  //! A smoother with the current lag.
+  std::unique_ptr<Smoother> createSmoother() const;
+
+  //! The lag of the smoother: the horizon of the controller, if adaptive.
+  double getSmootherLag() const;
+
+  SmootherSnapshot getSmootherSnapshot() const;
+
+  /**
+   * @brief restoreSmoother Rebuilds the smoother from a snapshot, with the
+   * same factor slots (hence the bookkeeping of the smart factors' slots
+   * stays valid) and linearized at the same point. The factors are restored
+   * with the lag of the snapshot, and the current lag applies from the next
+   * update on.
+   */
+  void restoreSmoother(const SmootherSnapshot& snapshot);
+
+ private:
+  /**
+   * @brief compactSmootherFactors Rebuilds the smoother with its live factors
+   * only, renumbered in order, and updates the slots of old_smart_factors_
+   * accordingly (dropping the smart factors not in the smoother anymore).
+   * Otherwise the slots of the smoother only grow, as marginalized and
+   * deleted factors leave empty slots behind, and so does the cost of every
+   * pass over its factors.
+   * Relinearizes all the factors, hence is only done from time to time, see
+   * BackendParams::factorSlotCompactionPeriod_.
+   * @return The new slot of each old slot, -1 for the empty ones.
+   */
+  std::vector<Slot> compactSmootherFactors();
+
+  /**
+   * @brief findCheiralityLmk Evaluates the new factors involving landmarks
+   * at the point iSAM2 linearizes them, to catch their cheirality exceptions
+   * before updating the smoother.
+   * Only covers the factors with a landmark key (projection factors): smart
+   * factors only have pose keys, and never throw: they handle degenerate and
+   * behind-camera triangulations themselves (see
+   * setSmartStereoFactorsParams).
+   * @return True if a new factor throws, with its landmark in lmk_symbol.
+   */
+  bool findCheiralityLmk(const gtsam::NonlinearFactorGraph& new_factors,
+                         const gtsam::Values& new_values,
+                         gtsam::Symbol* lmk_symbol) const;
+
   void cleanCheiralityLmk(
       const gtsam::Symbol& lmk_symbol,
       gtsam::NonlinearFactorGraph* new_factors_tmp_cheirality,
@@ -349,10 +562,13 @@ class VioBackend {
                            const gtsam::Values& values,
                            gtsam::Values* values_output);
 
-  // Find all slots of factors that have the given key in the list of keys.
+  // Find all slots of factors that have the given key in the list of keys,
+  // in O(degree of the key) with the variable index of the graph (the one
+  // iSAM2 maintains for the smoother graph).
   void findSlotsOfFactorsWithKey(
       const gtsam::Key& key,
       const gtsam::NonlinearFactorGraph& graph,
+      const gtsam::VariableIndex& variable_index,
       std::vector<size_t>* slots_of_factors_with_key);
 
   virtual void deleteLmkFromExtraStructures(const LandmarkId& lmk_id);
@@ -415,9 +631,15 @@ class VioBackend {
       const bool& print_linear_container_factors = true) const;
 
   /// Debuggers.
-  void computeSmartFactorStatistics();
+  static void computeSmartFactorStatistics(
+      const gtsam::NonlinearFactorGraph& graph,
+      DebugVioInfo* debug_info);
 
-  void computeSparsityStatistics();
+  //! Dense hessian of the linearized graph: expensive, may run in the
+  //! debug stats worker since the linearized graph is not shared.
+  static void computeSparsityStatistics(
+      const gtsam::GaussianFactorGraph& linearized_graph,
+      DebugVioInfo* debug_info);
 
   // Debugging post optimization and estimate calculation.
   void postDebug(
@@ -459,7 +681,11 @@ class VioBackend {
   const BackendParams backend_params_;
   const ImuParams imu_params_;
   const BackendOutputParams backend_output_params_;
+  BackendOutputFields output_fields_ = BackendOutputFields::all();
   std::optional<OdometryParams> odom_params_;
+  //! State to seed the initialization with, see setResumeState.
+  std::optional<VioNavStateTimestamped> resume_state_;
+  Timestamp max_resume_state_age_ = 0;
 
   // State estimates.
   // TODO(Toni): bundle these in a VioNavStateTimestamped.
@@ -492,10 +718,27 @@ class VioBackend {
 
   // ISAM2 smoother
   std::unique_ptr<Smoother> smoother_;
+  //! Adapts the smoother horizon and updates, if backend params ask for it.
+  SmootherHorizonController::UniquePtr horizon_controller_;
 
   // Values
   //!< new states to be added
   gtsam::Values new_values_;
+  //!< keys already in the smoother, whose timestamp is moved to the current
+  //!< keyframe at the next update (to delay their marginalization)
+  gtsam::KeyVector refreshed_keys_;
+  //! Set while adding the first keyframes of a batch: optimize only stores
+  //! the keyframe, which is added to the smoother with the last one.
+  bool defer_optimization_ = false;
+  //!< keyframe id of the new values of the deferred keyframes
+  std::map<gtsam::Key, double> deferred_key_frame_count_;
+  //! See BackendParams::factorSlotCompactionPeriod_.
+  size_t nr_optimizations_since_compaction_ = 0u;
+  //! Set when a relocalization prior is added: pose of the output world
+  //! frame in the smoother's one, from which updateStates restarts the
+  //! incremental pose.
+  std::optional<Pose3> relocalization_state_Pose_output_;
+  size_t nr_relocalizations_ = 0u;
 
   // Factors.
   //!< New factors to be added
@@ -511,6 +754,13 @@ class VioBackend {
   // TODO grows unbounded currently, but it should be limited to time horizon.
   FeatureTracks feature_tracks_;
 
+  //! Landmarks in time horizon of the last map update, with their type and
+  //! the update that last saw them (see getMapLmkIdsTo3dPointsInTimeHorizon).
+  PointsWithIdMap lmk_points_cache_;
+  LmkIdToLmkTypeMap lmk_types_cache_;
+  LandmarkStore<size_t> lmk_cache_stamps_;
+  size_t lmk_cache_stamp_ = 0u;
+
   // Counters.
   //! Last keyframe id.
   int last_kf_id_;
@@ -530,11 +780,33 @@ class VioBackend {
   // To print smoother info, useful when looking for optimization bugs.
   bool debug_smoother_ = false;
 
+  //! Sparsity statistics computed by the debug stats worker, copied to the
+  //! debug info at the next sample.
+  std::mutex debug_stats_mutex_;
+  int async_nr_elements_in_matrix_ = 0;
+  int async_nr_zero_elements_in_matrix_ = 0;
+  //! Declared after the results it writes, to be joined before them.
+  utils::LowPriorityWorker::UniquePtr debug_stats_worker_;
+
  private:
   //! No motion factors settings.
   gtsam::SharedNoiseModel zero_velocity_prior_noise_;
   gtsam::SharedNoiseModel no_motion_prior_noise_;
   gtsam::SharedNoiseModel constant_velocity_prior_noise_;
+  //! See getBetweenNoiseModel, getVelocityPriorNoiseModel.
+  std::map<std::pair<double, double>, gtsam::SharedNoiseModel>
+      between_noise_models_;
+  std::map<double, gtsam::SharedNoiseModel> velocity_prior_noise_models_;
+
+  //! Given by setRelocalizationPrior, from another thread.
+  struct RelocalizationPrior {
+    FrameId kf_id_;
+    gtsam::Pose3 W_Pose_B_;
+    double rotation_precision_;
+    double translation_precision_;
+  };
+  std::mutex relocalization_mutex_;
+  std::optional<RelocalizationPrior> relocalization_prior_;
 
   //! Landmark count.
   int landmark_count_;
@@ -545,6 +817,9 @@ class VioBackend {
   //! Logger.
   const bool log_output_ = {false};
   std::unique_ptr<BackendLogger> logger_;
+
+  //! Of the smoother, see getSmootherMemoryBytes.
+  utils::MemoryGauge smoother_memory_;
 };
 
 }  // namespace VIO
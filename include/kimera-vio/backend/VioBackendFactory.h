@@ -15,7 +15,9 @@
 
 #pragma once
 
+#include "kimera-vio/backend/ProjectionVioBackend.h"
 #include "kimera-vio/backend/RegularVioBackend.h"
+#include "kimera-vio/backend/SlidingWindowVioBackend.h"
 #include "kimera-vio/backend/VioBackend-definitions.h"
 #include "kimera-vio/backend/VioBackend.h"
 #include "kimera-vio/utils/Macros.h"
@@ -57,10 +59,30 @@ class BackendFactory {
                                                    log_output,
                                                    odom_params);
       }
+      case BackendType::kProjection: {
+        return std::make_unique<ProjectionVioBackend>(B_Pose_leftCamRect,
+                                                      stereo_calibration,
+                                                      backend_params,
+                                                      imu_params,
+                                                      backend_output_params,
+                                                      log_output,
+                                                      odom_params);
+      }
+      case BackendType::kSlidingWindow: {
+        return std::make_unique<SlidingWindowVioBackend>(
+            B_Pose_leftCamRect,
+            stereo_calibration,
+            backend_params,
+            imu_params,
+            backend_output_params,
+            log_output,
+            odom_params);
+      }
       default: {
         LOG(FATAL) << "Requested Backend type is not supported.\n"
                    << "Currently supported Backend types:\n"
-                   << "0: normal VIO\n 1: regular VIO\n"
+                   << "0: normal VIO\n 1: regular VIO\n 2: projection VIO\n"
+                   << " 3: sliding window VIO\n"
                    << " but requested Backend: "
                    << static_cast<int>(backend_type);
         return nullptr;
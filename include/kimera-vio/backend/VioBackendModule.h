@@ -33,6 +33,8 @@ class VioBackendModule
 
   using SIMO = SIMOPipelineModule<BackendInput, BackendOutput>;
   using InputQueue = ThreadsafeQueue<typename PIO::InputUniquePtr>;
+  using InputQueueBase = typename SIMO::InputQueueBase;
+  using OutputCallback = typename SIMO::OutputCallback;
 
   /**
    * @brief VioBackendModule
@@ -41,7 +43,7 @@ class VioBackendModule
    * @param parallel_run
    * @param vio_backend
    */
-  VioBackendModule(InputQueue* input_queue,
+  VioBackendModule(InputQueueBase* input_queue,
                    bool parallel_run,
                    VioBackend::UniquePtr vio_backend);
   virtual ~VioBackendModule() = default;
@@ -53,9 +55,49 @@ class VioBackendModule
    */
   virtual OutputUniquePtr spinOnce(BackendInput::UniquePtr input);
 
+ protected:
+  /**
+   * @brief spinOnceBatched Processes the input along with all the inputs
+   * that queued up behind it, with one smoother update per
+   * maxBatchedKeyframes keyframes. The outputs of all keyframes but the last
+   * one are pushed here.
+   * @return The output of the last keyframe.
+   */
+  OutputUniquePtr spinOnceBatched(BackendInput::UniquePtr input);
+
  public:
   inline bool isInitialized() const { return vio_backend_->isInitialized(); }
 
+  //! See VioBackend::setResumeState, call before launching the module.
+  inline void setResumeState(const VioNavStateTimestamped& resume_state,
+                             const Timestamp& max_age) {
+    vio_backend_->setResumeState(resume_state, max_age);
+  }
+
+  //! See VioBackend::setRelocalizationPrior, thread-safe.
+  inline void setRelocalizationPrior(const FrameId& kf_id,
+                                     const gtsam::Pose3& W_Pose_B,
+                                     const double& rotation_precision,
+                                     const double& translation_precision) {
+    vio_backend_->setRelocalizationPrior(
+        kf_id, W_Pose_B, rotation_precision, translation_precision);
+  }
+
+  /**
+   * @brief registerOutputCallback Registers a callback that only uses the
+   * light fields of the BackendOutput (see BackendOutputFields).
+   */
+  void registerOutputCallback(const OutputCallback& output_callback) override;
+
+  /**
+   * @brief registerOutputCallback Registers a callback, and makes the Backend
+   * fill the heavy fields of its output it requires. Register all callbacks
+   * before launching the module.
+   * @param required_fields heavy fields used by the callback.
+   */
+  void registerOutputCallback(const OutputCallback& output_callback,
+                              const BackendOutputFields& required_fields);
+
   /**
    * @brief registerImuBiasUpdateCallback Register callback to be called
    * whenever the Backend has a new estimate of the IMU bias.
@@ -80,6 +122,8 @@ class VioBackendModule
 
  protected:
   const VioBackend::UniquePtr vio_backend_;
+  //! Nr of keyframes processed per spinOnce when batching.
+  utils::StatsCollector batch_size_stats_;
 };
 
 }  // namespace VIO
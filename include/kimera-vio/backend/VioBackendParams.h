@@ -116,6 +116,10 @@ class BackendParams : public PipelineParams {
   /// Only used if autoInitialize set to false.
   VioNavState initial_ground_truth_state_ = VioNavState();
   bool roundOnAutoInitialize_ = false;
+  //! Caps of the initial bundle adjustment (online alignment): the best
+  //! estimate so far is used once one is reached (time: 0 for no cap).
+  int initialBAMaxIterations_ = 100;
+  double initialBAMaxTimeSec_ = 0.0;
 
   //! Smart factor params
   gtsam::LinearizationMode linearizationMode_ = gtsam::HESSIAN;
@@ -127,6 +131,13 @@ class BackendParams : public PipelineParams {
   //! max acceptable reprojection error // before tuning: 3
   double outlierRejection_ = 8.0;
   double retriangulationThreshold_ = 1.0e-3;
+  //! Triangulate the new smart factors in parallel before the smoother
+  //! update, which then reuses their triangulation while linearizing them.
+  bool parallelSmartFactorsTriangulation_ = true;
+  //! Max number of landmarks added or updated per keyframe (0: no limit).
+  //! Landmarks already in the graph are always updated, the budget left is
+  //! given to the new landmarks most informative for the latest pose.
+  int maxLandmarksPerKeyframe_ = 0;
 
   bool addBetweenStereoFactors_ = true;
 
@@ -141,6 +152,29 @@ class BackendParams : public PipelineParams {
   int numOptimize_ = 2;
   double wildfire_threshold_ = 0.001;
   bool useDogLeg_ = false;
+  //! Adapt the horizon (within [minNrStates, maxNrStates]) and the number of
+  //! updates per keyframe (up to numOptimize) to meet targetLatencyMs.
+  bool adaptiveHorizon_ = false;
+  double targetLatencyMs_ = 30.0;
+  double minNrStates_ = 5.0;
+  double maxNrStates_ = 60.0;
+  //! Max nr of keyframes added to the smoother with a single update, when
+  //! they queued up while the Backend was busy (1: one update per keyframe).
+  int maxBatchedKeyframes_ = 1;
+  //! Nr of keyframes in the window of the sliding window Backend, which
+  //! replaces the smoother horizon.
+  int slidingWindowSize_ = 10;
+  //! Compute the graph statistics of the debug info (smart factors, sparsity)
+  //! every debugStatsPeriod keyframes (0: never), when logging the output.
+  int debugStatsPeriod_ = 1;
+  //! Compute them on a low priority thread, from a copy of the graph: the
+  //! debug info then has the statistics of the last computed sample.
+  bool asyncDebugStats_ = false;
+  //! Every factorSlotCompactionPeriod keyframes (0: never), rebuild the
+  //! smoother without the empty slots left by marginalized and deleted
+  //! factors, if they are at least minEmptySlotsRatio of its slots.
+  int factorSlotCompactionPeriod_ = 0;
+  double minEmptySlotsRatio_ = 0.5;
 
   //! No Motion params
   double zero_velocity_precision_ = 1000;
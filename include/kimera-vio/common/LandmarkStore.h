@@ -0,0 +1,390 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   LandmarkStore.h
+ * @brief  Map from landmark ids to per-landmark data, stored in a dense array
+ * of recycled slots instead of a hash table.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <gtsam/geometry/Point3.h>
+
+#include "kimera-vio/common/vio_types.h"
+
+namespace VIO {
+
+/**
+ * @brief The LandmarkStore class maps landmark ids to values, with the
+ * interface of the std::unordered_map subset used by the pipeline (find, at,
+ * operator[], insert, emplace, erase, iteration...).
+ *
+ * Landmark ids grow monotonically, and the landmarks alive at any time (those
+ * in the time horizon of the tracker, the backend or the mesher) have ids in a
+ * narrow range. Hence:
+ *  - the values are stored in a contiguous array of slots, and the slots of
+ *    erased landmarks are recycled for new ones, so the storage is as large as
+ *    the max nr of landmarks alive at once;
+ *  - the id to slot lookup is a direct index in a table covering the range of
+ *    ids alive, which is trimmed at both ends on erase. Ids far below the live
+ *    range can be stored, at the cost of a larger table.
+ * No hashing nor rehashing is ever involved.
+ *
+ * Each slot has a generation counter that is bumped when its landmark is
+ * erased, so that a Handle (slot and generation) can be kept to access a
+ * landmark in O(1) without looking up its id, and detected as stale once the
+ * landmark is gone.
+ *
+ * The iteration order is the slot order, which is unspecified, as for an
+ * std::unordered_map. Unlike an std::unordered_map, inserting may invalidate
+ * the iterators, pointers and references to the values.
+ */
+template <typename T>
+class LandmarkStore {
+ public:
+  using key_type = LandmarkId;
+  using mapped_type = T;
+  using value_type = std::pair<const LandmarkId, T>;
+  using size_type = size_t;
+
+  //! O(1) access to a landmark, which does not go through its id.
+  struct Handle {
+    uint32_t slot = kInvalidSlot;
+    uint32_t generation = 0u;
+    inline bool isValid() const { return slot != kInvalidSlot; }
+  };
+
+ private:
+  struct Slot {
+    Slot() = default;
+    Slot(const Slot& other)
+        : value(other.value), generation(other.generation) {}
+    Slot(Slot&& other) noexcept(std::is_nothrow_move_constructible<T>::value)
+        : value(std::move(other.value)), generation(other.generation) {}
+    // The key of value_type is const, so the value is re-constructed.
+    Slot& operator=(const Slot& other) {
+      if (this != &other) {
+        value.reset();
+        if (other.value) value.emplace(*other.value);
+        generation = other.generation;
+      }
+      return *this;
+    }
+    Slot& operator=(Slot&& other) {
+      if (this != &other) {
+        value.reset();
+        if (other.value) value.emplace(std::move(*other.value));
+        generation = other.generation;
+      }
+      return *this;
+    }
+
+    std::optional<value_type> value;
+    uint32_t generation = 0u;
+  };
+
+  template <bool kIsConst>
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename LandmarkStore::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer =
+        typename std::conditional<kIsConst, const value_type*, value_type*>::
+            type;
+    using reference =
+        typename std::conditional<kIsConst, const value_type&, value_type&>::
+            type;
+    using Slots = typename std::conditional<kIsConst,
+                                            const std::vector<Slot>,
+                                            std::vector<Slot>>::type;
+
+    Iterator() = default;
+    Iterator(Slots* slots, const size_t& slot) : slots_(slots), slot_(slot) {
+      skipEmptySlots();
+    }
+    //! Conversion from iterator to const_iterator.
+    template <bool kOtherIsConst,
+              typename = typename std::enable_if<kIsConst &&
+                                                 !kOtherIsConst>::type>
+    Iterator(const Iterator<kOtherIsConst>& other)
+        : slots_(other.slots_), slot_(other.slot_) {}
+
+    inline reference operator*() const { return *(*slots_)[slot_].value; }
+    inline pointer operator->() const { return &*(*slots_)[slot_].value; }
+    inline Iterator& operator++() {
+      ++slot_;
+      skipEmptySlots();
+      return *this;
+    }
+    inline Iterator operator++(int) {
+      Iterator it = *this;
+      ++(*this);
+      return it;
+    }
+    inline bool operator==(const Iterator& other) const {
+      return slot_ == other.slot_ && slots_ == other.slots_;
+    }
+    inline bool operator!=(const Iterator& other) const {
+      return !(*this == other);
+    }
+
+   private:
+    friend class LandmarkStore;
+    template <bool>
+    friend class Iterator;
+
+    inline void skipEmptySlots() {
+      while (slot_ < slots_->size() && !(*slots_)[slot_].value) ++slot_;
+    }
+
+    Slots* slots_ = nullptr;
+    size_t slot_ = 0u;
+  };
+
+ public:
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  LandmarkStore() = default;
+  ~LandmarkStore() = default;
+  LandmarkStore(const LandmarkStore&) = default;
+  LandmarkStore(LandmarkStore&&) = default;
+  LandmarkStore& operator=(const LandmarkStore&) = default;
+  LandmarkStore& operator=(LandmarkStore&&) = default;
+
+  inline iterator begin() { return iterator(&slots_, 0u); }
+  inline iterator end() { return iterator(&slots_, slots_.size()); }
+  inline const_iterator begin() const { return const_iterator(&slots_, 0u); }
+  inline const_iterator end() const {
+    return const_iterator(&slots_, slots_.size());
+  }
+  inline const_iterator cbegin() const { return begin(); }
+  inline const_iterator cend() const { return end(); }
+
+  inline size_t size() const { return size_; }
+  inline bool empty() const { return size_ == 0u; }
+
+  //! Reserves the slots of nr_landmarks alive at once.
+  inline void reserve(const size_t& nr_landmarks) {
+    slots_.reserve(nr_landmarks);
+  }
+
+  //! Erases all landmarks, but keeps the slots for the next ones.
+  void clear() {
+    free_slots_.clear();
+    for (size_t slot = 0u; slot < slots_.size(); ++slot) {
+      if (slots_[slot].value) {
+        slots_[slot].value.reset();
+        ++slots_[slot].generation;
+      }
+      free_slots_.push_back(static_cast<uint32_t>(slot));
+    }
+    index_.clear();
+    first_id_ = 0;
+    size_ = 0u;
+  }
+
+  inline iterator find(const LandmarkId& lmk_id) {
+    const uint32_t slot = getSlot(lmk_id);
+    return slot == kInvalidSlot ? end() : iterator(&slots_, slot);
+  }
+  inline const_iterator find(const LandmarkId& lmk_id) const {
+    const uint32_t slot = getSlot(lmk_id);
+    return slot == kInvalidSlot ? end() : const_iterator(&slots_, slot);
+  }
+  inline size_t count(const LandmarkId& lmk_id) const {
+    return getSlot(lmk_id) == kInvalidSlot ? 0u : 1u;
+  }
+
+  T& at(const LandmarkId& lmk_id) {
+    const uint32_t slot = getSlot(lmk_id);
+    if (slot == kInvalidSlot) throwOutOfRange(lmk_id);
+    return slots_[slot].value->second;
+  }
+  const T& at(const LandmarkId& lmk_id) const {
+    const uint32_t slot = getSlot(lmk_id);
+    if (slot == kInvalidSlot) throwOutOfRange(lmk_id);
+    return slots_[slot].value->second;
+  }
+
+  inline T& operator[](const LandmarkId& lmk_id) {
+    return emplace(lmk_id).first->second;
+  }
+
+  //! As std::unordered_map::try_emplace: the value is only constructed from
+  //! args if lmk_id is not in the store yet.
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(const LandmarkId& lmk_id, Args&&... args);
+
+  //! Takes an std::pair<LandmarkId, T>, or a value_type.
+  template <typename Pair>
+  inline std::pair<iterator, bool> insert(Pair&& lmk_id_value) {
+    return emplace(lmk_id_value.first,
+                   std::forward<Pair>(lmk_id_value).second);
+  }
+
+  //! @return Nr of landmarks erased (0 or 1).
+  size_t erase(const LandmarkId& lmk_id);
+  //! @return Iterator to the landmark after the erased one.
+  iterator erase(const_iterator it);
+
+  //! @return A handle to the landmark, invalid if it is not in the store.
+  inline Handle getHandle(const LandmarkId& lmk_id) const {
+    Handle handle;
+    const uint32_t slot = getSlot(lmk_id);
+    if (slot != kInvalidSlot) {
+      handle.slot = slot;
+      handle.generation = slots_[slot].generation;
+    }
+    return handle;
+  }
+  //! @return The landmark of the handle, or nullptr if it has been erased.
+  inline value_type* get(const Handle& handle) {
+    return isAlive(handle) ? &*slots_[handle.slot].value : nullptr;
+  }
+  inline const value_type* get(const Handle& handle) const {
+    return isAlive(handle) ? &*slots_[handle.slot].value : nullptr;
+  }
+
+ private:
+  static constexpr uint32_t kInvalidSlot =
+      std::numeric_limits<uint32_t>::max();
+
+  inline bool isAlive(const Handle& handle) const {
+    return handle.slot < slots_.size() &&
+           slots_[handle.slot].generation == handle.generation &&
+           slots_[handle.slot].value.has_value();
+  }
+
+  inline uint32_t getSlot(const LandmarkId& lmk_id) const {
+    if (lmk_id < first_id_) return kInvalidSlot;
+    const size_t idx = static_cast<size_t>(lmk_id - first_id_);
+    return idx < index_.size() ? index_[idx] : kInvalidSlot;
+  }
+
+  //! Grows the index to cover lmk_id. @return The entry of lmk_id.
+  uint32_t& indexEntry(const LandmarkId& lmk_id);
+
+  //! Drops the erased ids at both ends of the index.
+  void trimIndex();
+
+  [[noreturn]] static void throwOutOfRange(const LandmarkId& lmk_id) {
+    throw std::out_of_range("LandmarkStore: no landmark with id " +
+                            std::to_string(lmk_id));
+  }
+
+ private:
+  //! Values of the landmarks, or empty slots to be recycled.
+  std::vector<Slot> slots_;
+  std::vector<uint32_t> free_slots_;
+  //! Slot of each id in [first_id_, first_id_ + index_.size()).
+  std::deque<uint32_t> index_;
+  LandmarkId first_id_ = 0;
+  size_t size_ = 0u;
+};
+
+template <typename T>
+template <typename... Args>
+std::pair<typename LandmarkStore<T>::iterator, bool> LandmarkStore<T>::emplace(
+    const LandmarkId& lmk_id,
+    Args&&... args) {
+  uint32_t& entry = indexEntry(lmk_id);
+  if (entry != kInvalidSlot) {
+    return std::make_pair(iterator(&slots_, entry), false);
+  }
+  uint32_t slot;
+  if (free_slots_.empty()) {
+    slot = static_cast<uint32_t>(slots_.size());
+    slots_.emplace_back();
+  } else {
+    slot = free_slots_.back();
+    free_slots_.pop_back();
+  }
+  slots_[slot].value.emplace(
+      std::piecewise_construct,
+      std::forward_as_tuple(lmk_id),
+      std::forward_as_tuple(std::forward<Args>(args)...));
+  entry = slot;
+  ++size_;
+  return std::make_pair(iterator(&slots_, slot), true);
+}
+
+template <typename T>
+size_t LandmarkStore<T>::erase(const LandmarkId& lmk_id) {
+  const uint32_t slot = getSlot(lmk_id);
+  if (slot == kInvalidSlot) return 0u;
+  // Before resetting the value, lmk_id may be its key.
+  index_[static_cast<size_t>(lmk_id - first_id_)] = kInvalidSlot;
+  slots_[slot].value.reset();
+  ++slots_[slot].generation;
+  free_slots_.push_back(slot);
+  --size_;
+  trimIndex();
+  return 1u;
+}
+
+template <typename T>
+typename LandmarkStore<T>::iterator LandmarkStore<T>::erase(
+    const_iterator it) {
+  const size_t slot = it.slot_;
+  const LandmarkId lmk_id = it->first;
+  erase(lmk_id);
+  // Erasing does not move the other values.
+  return iterator(&slots_, slot + 1u);
+}
+
+template <typename T>
+uint32_t& LandmarkStore<T>::indexEntry(const LandmarkId& lmk_id) {
+  CHECK_GE(lmk_id, 0) << "Invalid landmark id.";
+  if (index_.empty()) {
+    first_id_ = lmk_id;
+    index_.push_back(kInvalidSlot);
+  } else if (lmk_id < first_id_) {
+    index_.insert(index_.begin(),
+                  static_cast<size_t>(first_id_ - lmk_id),
+                  kInvalidSlot);
+    first_id_ = lmk_id;
+  } else if (static_cast<size_t>(lmk_id - first_id_) >= index_.size()) {
+    index_.resize(static_cast<size_t>(lmk_id - first_id_) + 1u, kInvalidSlot);
+  }
+  return index_[static_cast<size_t>(lmk_id - first_id_)];
+}
+
+template <typename T>
+void LandmarkStore<T>::trimIndex() {
+  while (!index_.empty() && index_.front() == kInvalidSlot) {
+    index_.pop_front();
+    ++first_id_;
+  }
+  while (!index_.empty() && index_.back() == kInvalidSlot) {
+    index_.pop_back();
+  }
+}
+
+// Landmark id to its optimized position, shared by the backend and the
+// frontend (to track with PnP).
+using LandmarksMap = LandmarkStore<gtsam::Point3>;
+
+}  // namespace VIO
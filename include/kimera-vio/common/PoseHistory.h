@@ -0,0 +1,93 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   PoseHistory.h
+ * @brief  Thread-safe history of the estimated poses, interpolated at any
+ * timestamp.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <shared_mutex>
+#include <vector>
+
+#include <gtsam/geometry/Pose3.h>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The PoseHistory class keeps the odometry poses of the body (the
+ * Backend estimates, W_Pose_B) sorted by timestamp in a contiguous array, and
+ * gives the pose at any timestamp within the history in O(log n), by
+ * interpolating its neighbours on SE(3).
+ *
+ * Loop closures do not rewrite the history: the latest Map_Pose_Odom
+ * correction (see LcdOutput) is applied to the poses when they are read.
+ *
+ * Thread-safe: meant to be filled by a single writer at keyframe rate, and
+ * read by many consumers, which do not block each other.
+ */
+class PoseHistory {
+ public:
+  KIMERA_POINTER_TYPEDEFS(PoseHistory);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(PoseHistory);
+
+  PoseHistory();
+  ~PoseHistory() = default;
+
+  //! Appends the pose, or inserts it in order if it is older than the latest.
+  //! Overwrites the pose if there is already one at this timestamp.
+  void addPose(const Timestamp& timestamp, const gtsam::Pose3& W_Pose_B);
+
+  //! Correction of the odometry poses, applied when reading them corrected.
+  void setCorrection(const gtsam::Pose3& Map_Pose_Odom);
+  gtsam::Pose3 getCorrection() const;
+
+  /**
+   * @brief getPoseAtTime Pose at the given timestamp, interpolated between
+   * the closest poses before and after it.
+   * @param corrected If true, the pose in the map frame (Map_Pose_Odom *
+   * W_Pose_B), the odometry pose otherwise.
+   * @return False if the timestamp is not within the history.
+   */
+  bool getPoseAtTime(const Timestamp& timestamp,
+                     gtsam::Pose3* pose,
+                     const bool& corrected = true) const;
+
+  //! @return False if the history is empty.
+  bool getLatestPose(Timestamp* timestamp,
+                     gtsam::Pose3* pose,
+                     const bool& corrected = true) const;
+
+  size_t size() const;
+  bool empty() const;
+  void clear();
+
+ private:
+  struct StampedPose {
+    Timestamp timestamp_;
+    gtsam::Pose3 W_Pose_B_;
+  };
+
+  //! Mutex must be locked.
+  gtsam::Pose3 correct(const gtsam::Pose3& W_Pose_B,
+                       const bool& corrected) const;
+
+ private:
+  mutable std::shared_mutex mutex_;
+  //! Sorted by timestamp.
+  std::vector<StampedPose> poses_;
+  gtsam::Pose3 Map_Pose_Odom_;
+};
+
+}  // namespace VIO
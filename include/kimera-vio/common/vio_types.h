@@ -85,6 +85,4 @@ std::unique_ptr<Derived> castUnique(std::unique_ptr<Base>&& base) {
   return std::unique_ptr<Derived>(derived);
 }
 
-using LandmarksMap = std::unordered_map<LandmarkId, gtsam::Point3>;
-
 }  // namespace VIO
@@ -0,0 +1,90 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   BinaryDataProvider.h
+ * @brief  Replays a binary dataset container (see BinaryDataset.h).
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <string>
+
+#include "kimera-vio/dataprovider/BinaryDataset.h"
+#include "kimera-vio/dataprovider/DataProviderInterface-definitions.h"
+#include "kimera-vio/dataprovider/DataProviderInterface.h"
+#include "kimera-vio/pipeline/Pipeline-definitions.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The BinaryDataProvider class memory-maps a binary dataset (e.g.
+ * converted from EuRoC with convertDatasetToBinary) and replays it like the
+ * EurocDataProvider: all IMU data first, then one frame per spinOnce. Frames
+ * point directly inside the mapping, unless image equalization is enabled in
+ * the stereo matching params (the container stores non-equalized images).
+ * Containers with two cameras send left and right frames, containers with one
+ * camera only send left frames.
+ */
+class BinaryDataProvider : public DataProviderInterface {
+ public:
+  KIMERA_DELETE_COPY_CONSTRUCTORS(BinaryDataProvider);
+  KIMERA_POINTER_TYPEDEFS(BinaryDataProvider);
+
+  //! Replays frames [initial_k, final_k) of the container (clipped to its
+  //! nr of frames).
+  BinaryDataProvider(const std::string& dataset_filename,
+                     const int& initial_k,
+                     const int& final_k,
+                     const VioParams& vio_params);
+  //! Ctor from gflags
+  explicit BinaryDataProvider(const VioParams& vio_params);
+
+  virtual ~BinaryDataProvider() = default;
+
+ public:
+  virtual bool spin() override;
+
+  virtual bool hasData() const override;
+
+  inline size_t getNrCameras() const { return reader_.getNrCameras(); }
+
+ public:
+  // Ground truth data.
+  GroundTruthData gt_data_;
+
+ protected:
+  /**
+   * @brief spinOnce Send data to VIO pipeline on a per-frame basis
+   * @return if the dataset finished or not
+   */
+  virtual bool spinOnce();
+
+  void sendImuData() const;
+
+  //! Sends all the external odometry, if any, like the IMU data.
+  void sendExternalOdomData() const;
+
+  //! Image of the given camera for the current frame.
+  cv::Mat getImage(const size_t& cam_idx) const;
+
+ protected:
+  VioParams vio_params_;
+  BinaryDatasetReader reader_;
+
+  size_t current_k_;
+  size_t final_k_;
+
+  //! Flag to signal if the IMU (and external odometry) data has been sent to
+  //! the VIO pipeline
+  bool is_imu_data_sent_ = false;
+};
+
+}  // namespace VIO
@@ -0,0 +1,220 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   BinaryDataset.h
+ * @brief  Compact binary container for datasets (IMU, ground-truth and
+ * pre-decoded grayscale frames), with a writer and a memory-mapped reader.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "kimera-vio/common/VioNavState.h"
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/frontend/VisionImuFrontend-definitions.h"
+#include "kimera-vio/imu-frontend/ImuFrontend-definitions.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * Layout of a binary dataset file (all values little-endian, as written by
+ * the host):
+ *   BinaryDatasetHeader
+ *   image data: one block per image, each starting at a multiple of
+ *               kBinaryDatasetAlignment bytes
+ *   BinaryImuRecord[nr_imu_measurements]   at imu_offset
+ *   BinaryGtRecord[nr_gt_states]           at gt_offset
+ *   BinaryFrameRecord[nr_frames]           at frame_index_offset
+ *   BinaryOdomRecord[nr_odom_measurements] at odom_offset (version >= 2)
+ * Records are sorted by timestamp. Version 1 files have no external
+ * odometry: their header is followed by zero padding, read as no records.
+ */
+static constexpr char kBinaryDatasetMagic[8] = {
+    'K', 'I', 'M', 'E', 'R', 'A', 'D', 'S'};
+static constexpr uint32_t kBinaryDatasetVersion = 2u;
+static constexpr size_t kBinaryDatasetMaxCameras = 2u;
+static constexpr size_t kBinaryDatasetAlignment = 64u;
+
+struct BinaryDatasetHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t nr_cameras;
+  uint64_t nr_imu_measurements;
+  uint64_t imu_offset;
+  uint64_t nr_gt_states;
+  uint64_t gt_offset;
+  uint64_t nr_frames;
+  uint64_t frame_index_offset;
+  uint64_t file_size;
+  uint64_t nr_odom_measurements;
+  uint64_t odom_offset;
+};
+
+struct BinaryImuRecord {
+  int64_t timestamp;
+  //! Accelerometer (3) and gyroscope (3) measurements.
+  double acc_gyr[6];
+};
+
+struct BinaryGtRecord {
+  int64_t timestamp;
+  double position[3];
+  //! Quaternion as w, x, y, z.
+  double quaternion[4];
+  double velocity[3];
+  double acc_bias[3];
+  double gyro_bias[3];
+};
+
+struct BinaryOdomRecord {
+  int64_t timestamp;
+  double position[3];
+  //! Quaternion as w, x, y, z.
+  double quaternion[4];
+  double velocity[3];
+};
+
+struct BinaryImageRecord {
+  //! Offset of the first pixel from the start of the file.
+  uint64_t offset;
+  uint32_t rows;
+  uint32_t cols;
+  //! Bytes per row.
+  uint32_t step;
+  //! OpenCV type of the image (always CV_8UC1 for now).
+  int32_t type;
+};
+
+struct BinaryFrameRecord {
+  uint64_t frame_id;
+  int64_t timestamp;
+  BinaryImageRecord images[kBinaryDatasetMaxCameras];
+};
+
+static_assert(sizeof(BinaryDatasetHeader) == 88u, "Unexpected padding.");
+// Version 1 headers (72 bytes) are padded with zeros up to 128 bytes.
+static_assert(sizeof(BinaryDatasetHeader) <= 2u * kBinaryDatasetAlignment,
+              "Version 1 files would not have zeros in the new fields.");
+static_assert(sizeof(BinaryImuRecord) == 56u, "Unexpected padding.");
+static_assert(sizeof(BinaryGtRecord) == 136u, "Unexpected padding.");
+static_assert(sizeof(BinaryOdomRecord) == 88u, "Unexpected padding.");
+static_assert(sizeof(BinaryImageRecord) == 24u, "Unexpected padding.");
+static_assert(sizeof(BinaryFrameRecord) == 64u, "Unexpected padding.");
+
+/**
+ * @brief The BinaryDatasetWriter class writes a binary dataset file. Images
+ * are written as they are added, the index is written at close().
+ */
+class BinaryDatasetWriter {
+ public:
+  KIMERA_POINTER_TYPEDEFS(BinaryDatasetWriter);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(BinaryDatasetWriter);
+
+  //! @param nr_cameras Nr of images per frame (1 for mono, 2 for stereo).
+  BinaryDatasetWriter(const std::string& filename, const size_t& nr_cameras);
+  //! Closes the file if close() was not called.
+  ~BinaryDatasetWriter();
+
+ public:
+  void addImuMeasurement(const ImuMeasurement& imu_measurement);
+
+  void addGroundTruthState(const Timestamp& timestamp,
+                           const VioNavState& gt_state);
+
+  void addExternalOdomMeasurement(const ExternalOdomMeasurement& odom);
+
+  //! @param images One CV_8UC1 image per camera, in camera order.
+  void addFrame(const FrameId& frame_id,
+                const Timestamp& timestamp,
+                const std::vector<cv::Mat>& images);
+
+  //! Writes the index and header. No data can be added afterwards.
+  void close();
+
+ private:
+  void write(const void* data, const size_t& size);
+  //! Pads the file with zeros up to the next multiple of the alignment.
+  void align();
+
+ private:
+  std::ofstream file_;
+  const size_t nr_cameras_;
+  uint64_t offset_;
+  bool closed_;
+
+  std::vector<BinaryImuRecord> imu_records_;
+  std::vector<BinaryGtRecord> gt_records_;
+  std::vector<BinaryFrameRecord> frame_records_;
+  std::vector<BinaryOdomRecord> odom_records_;
+};
+
+class MappedFile;
+
+/**
+ * @brief The BinaryDatasetReader class memory-maps a binary dataset file.
+ * Images are handed out without copies: the returned cv::Mat points inside
+ * the mapping, and keeps it alive, so images can outlive the reader.
+ * The mapping is private (copy-on-write): writing into an image does not
+ * modify the file.
+ */
+class BinaryDatasetReader {
+ public:
+  KIMERA_POINTER_TYPEDEFS(BinaryDatasetReader);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(BinaryDatasetReader);
+
+  //! Maps the file and validates its header and index (CHECK fails if not).
+  explicit BinaryDatasetReader(const std::string& filename);
+  ~BinaryDatasetReader();
+
+ public:
+  inline size_t getNrCameras() const { return header_->nr_cameras; }
+  inline size_t getNrImuMeasurements() const {
+    return header_->nr_imu_measurements;
+  }
+  inline size_t getNrGroundTruthStates() const {
+    return header_->nr_gt_states;
+  }
+  inline size_t getNrFrames() const { return header_->nr_frames; }
+  inline size_t getNrExternalOdomMeasurements() const {
+    return header_->nr_odom_measurements;
+  }
+
+  ImuMeasurement getImuMeasurement(const size_t& i) const;
+
+  void getGroundTruthState(const size_t& i,
+                           Timestamp* timestamp,
+                           VioNavState* gt_state) const;
+
+  ExternalOdomMeasurement getExternalOdomMeasurement(const size_t& i) const;
+
+  const BinaryFrameRecord& getFrameRecord(const size_t& i) const;
+
+  //! Image of camera cam_idx of the i-th frame, pointing inside the mapping.
+  cv::Mat getImage(const size_t& i, const size_t& cam_idx) const;
+
+ private:
+  std::shared_ptr<const MappedFile> mapped_file_;
+  const BinaryDatasetHeader* header_;
+  const BinaryImuRecord* imu_records_;
+  const BinaryGtRecord* gt_records_;
+  const BinaryFrameRecord* frame_records_;
+  const BinaryOdomRecord* odom_records_;
+};
+
+}  // namespace VIO
@@ -19,6 +19,7 @@
 
 #include "kimera-vio/frontend/Camera.h"
 #include "kimera-vio/frontend/VisionImuFrontend-definitions.h"
+#include "kimera-vio/dataprovider/SensorRecorder.h"
 #include "kimera-vio/frontend/DepthFrame.h"
 #include "kimera-vio/pipeline/Pipeline-definitions.h"
 #include "kimera-vio/utils/Macros.h"
@@ -91,6 +92,13 @@ class DataProviderInterface {
     external_odom_callback_ = callback;
   }
 
+  /**
+   * @brief attachRecorder Records the data sent through the callbacks
+   * registered so far (hence, register them first) before forwarding it.
+   * Left frames are recorded as camera 0, right frames as camera 1.
+   */
+  void attachRecorder(const SensorRecorder::Ptr& recorder);
+
  protected:
   // Vio callbacks. These functions should be called once data is available for
   // processing.
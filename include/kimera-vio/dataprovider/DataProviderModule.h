@@ -33,6 +33,7 @@
 #include "kimera-vio/pipeline/Pipeline-definitions.h"
 #include "kimera-vio/pipeline/PipelineModule.h"
 #include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/ThreadsafeIngestionBuffer.h"
 #include "kimera-vio/utils/ThreadsafeOdometryBuffer.h"
 #include "kimera-vio/utils/UtilsNumerical.h"
 
@@ -48,25 +49,34 @@ class DataProviderModule : public MISOPipelineModule<FrontendInputPacketBase,
   using MISO =
       MISOPipelineModule<FrontendInputPacketBase, FrontendInputPacketBase>;
   using OutputQueue = typename MISO::OutputQueue;
+  using OutputQueueBase = typename MISO::OutputQueueBase;
   using PipelineOutputCallback =
       std::function<void(FrontendInputPacketBase::UniquePtr)>;
 
-  DataProviderModule(OutputQueue* output_queue,
+  DataProviderModule(OutputQueueBase* output_queue,
                      const std::string& name_id,
                      const bool& parallel_run);
 
   virtual ~DataProviderModule() = default;
 
   //! Callbacks to fill queues: they should be all lighting fast.
+  //! The IMU and external odometry measurements go through ingestion buffers
+  //! (see ThreadsafeIngestionBuffer), drained in bulk when a frame is synced:
+  //! the driver thread never waits for the lock of the IMU buffer. Each of
+  //! them must be filled from a single thread.
   //! Fill multiple IMU measurements at once
   inline void fillImuQueue(const ImuMeasurements& imu_measurements) {
-    imu_data_.imu_buffer_.addMeasurements(imu_measurements.timestamps_,
-                                          imu_measurements.acc_gyr_);
+    CHECK_EQ(imu_measurements.timestamps_.cols(),
+             imu_measurements.acc_gyr_.cols());
+    for (int idx = 0; idx < imu_measurements.timestamps_.cols(); ++idx) {
+      imu_ingestion_buffer_.push(
+          ImuMeasurement(imu_measurements.timestamps_(idx),
+                         imu_measurements.acc_gyr_.col(idx)));
+    }
   }
   //! Fill one IMU measurement only
   inline void fillImuQueue(const ImuMeasurement& imu_measurement) {
-    imu_data_.imu_buffer_.addMeasurement(imu_measurement.timestamp_,
-                                         imu_measurement.acc_gyr_);
+    imu_ingestion_buffer_.push(imu_measurement);
   }
 
   // TODO(Toni): remove, register at ctor level.
@@ -90,8 +100,8 @@ class DataProviderModule : public MISOPipelineModule<FrontendInputPacketBase,
              "odometry source is disabled! Measurements will be ignored";
       return;
     }
-    external_odometry_buffer_->add(
-        odom.timestamp_ + external_odometry_time_shift_ns_, odom.odom_data_);
+    external_odometry_ingestion_buffer_.push(ExternalOdomMeasurement(
+        odom.timestamp_ + external_odometry_time_shift_ns_, odom.odom_data_));
   }
 
   /**
@@ -118,6 +128,14 @@ class DataProviderModule : public MISOPipelineModule<FrontendInputPacketBase,
     imu_time_shift_ns_ = UtilsNumerical::SecToNsec(imu_time_shift_s);
   }
 
+  /**
+   * @brief Total offset between the IMU and Camera clocks, such that
+   * t_imu = t_cam + offset (coarse correction plus "fine" time shift).
+   */
+  inline Timestamp getImuTimeOffset() const {
+    return imu_timestamp_correction_ + imu_time_shift_ns_;
+  }
+
   /**
    * @brief Set the "fine" timestamp correction between the External odometry
    * and Camera
@@ -162,6 +180,10 @@ class DataProviderModule : public MISOPipelineModule<FrontendInputPacketBase,
   FrameAction getTimeSyncedImuMeasurements(const Timestamp& timestamp,
                                            ImuMeasurements* imu_meas);
 
+  //! Moves the measurements of the ingestion buffers to the IMU and external
+  //! odometry buffers. Called by the module thread before querying them.
+  void drainIngestionBuffers();
+
   void logQueryResult(const Timestamp& timestamp,
                       utils::ThreadsafeImuBuffer::QueryResult result) const;
 
@@ -175,12 +197,16 @@ class DataProviderModule : public MISOPipelineModule<FrontendInputPacketBase,
   bool repeated_frame_;
   Timestamp timestamp_last_frame_;
   bool do_coarse_imu_camera_temporal_sync_;
-  Timestamp imu_timestamp_correction_;
+  std::atomic<Timestamp> imu_timestamp_correction_;
   std::atomic<Timestamp> imu_time_shift_ns_;  // t_imu = t_cam + imu_shift
   std::atomic<Timestamp> external_odometry_time_shift_ns_;
   PipelineOutputCallback vio_pipeline_callback_;
   //! External odometry source
   ThreadsafeOdometryBuffer::UniquePtr external_odometry_buffer_;
+  //! Measurements pushed by the sensor threads, not yet in the buffers above.
+  ThreadsafeIngestionBuffer<ImuMeasurement> imu_ingestion_buffer_;
+  ThreadsafeIngestionBuffer<ExternalOdomMeasurement>
+      external_odometry_ingestion_buffer_;
 };  // namespace VIO
 
 }  // namespace VIO
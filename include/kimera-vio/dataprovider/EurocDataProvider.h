@@ -30,6 +30,7 @@
 #include "kimera-vio/common/VioNavState.h"
 #include "kimera-vio/dataprovider/DataProviderInterface-definitions.h"
 #include "kimera-vio/dataprovider/DataProviderInterface.h"
+#include "kimera-vio/dataprovider/ImagePrefetcher.h"
 #include "kimera-vio/frontend/Frame.h"
 #include "kimera-vio/frontend/StereoImuSyncPacket.h"
 #include "kimera-vio/frontend/StereoMatchingParams.h"
@@ -83,6 +84,11 @@ class EurocDataProvider : public DataProviderInterface {
     return getGroundTruthState(timestamp).pose_;
   }
 
+  // Retrieve absolute gt pose at *approx* timestamp, without failing if there
+  // is none: returns false if there is no gt within 10ms of the timestamp.
+  bool findGroundTruthPose(const Timestamp& timestamp,
+                           gtsam::Pose3* pose) const;
+
   inline std::string getDatasetPath() const {
     return dataset_path_;
   }
@@ -107,6 +113,24 @@ class EurocDataProvider : public DataProviderInterface {
    */
   void sendImuData() const;
 
+  /**
+   * @brief imageAllocator Allocator for the decoded images: the image buffer
+   * pool, or nullptr (OpenCV's default allocator) if disabled.
+   */
+  cv::MatAllocator* imageAllocator() const;
+
+  //! Reads the images of the first nr_cameras cameras (left, right) of frame
+  //! k (empty images if not available).
+  std::vector<cv::Mat> readImages(const FrameId& k,
+                                  const size_t& nr_cameras) const;
+
+  /**
+   * @brief getImages Same as readImages, but through the image prefetcher if
+   * prefetching is enabled (euroc_prefetch_threads > 0), in which case frames
+   * must be requested in increasing order.
+   */
+  std::vector<cv::Mat> getImages(const FrameId& k, const size_t& nr_cameras);
+
   /**
    * @brief parseDataset Parse camera, gt, and imu data if using
    * different Euroc format.
@@ -235,6 +259,10 @@ class EurocDataProvider : public DataProviderInterface {
 
 
   EurocGtLogger::UniquePtr logger_;
+
+  //! Decodes images ahead of playback, if enabled. Declared last so that its
+  //! workers stop before the data they read is destroyed.
+  ImagePrefetcher::UniquePtr image_prefetcher_;
 };
 
 class MonoEurocDataProvider : public EurocDataProvider {
@@ -0,0 +1,85 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ImagePrefetcher.h
+ * @brief  Decodes dataset images ahead of playback on worker threads.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The ImagePrefetcher class loads the images of frames
+ * [first_k, last_k) in order, on nr_threads worker threads, staying at most
+ * lookahead frames ahead of the frame last requested with get(). Hence disk
+ * reads and image decoding overlap with the processing of previous frames,
+ * while memory stays bounded.
+ */
+class ImagePrefetcher {
+ public:
+  KIMERA_POINTER_TYPEDEFS(ImagePrefetcher);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(ImagePrefetcher);
+
+  //! Loads the images (e.g. left and right) of a given frame. Must be
+  //! thread-safe, and return empty images for missing ones.
+  using ImageLoader = std::function<std::vector<cv::Mat>(const FrameId&)>;
+
+  ImagePrefetcher(const ImageLoader& image_loader,
+                  const FrameId& first_k,
+                  const FrameId& last_k,
+                  const size_t& nr_threads,
+                  const size_t& lookahead);
+  ~ImagePrefetcher();
+
+  /**
+   * @brief get Images of frame k, blocks until they are loaded. Frames must
+   * be requested in increasing order: images of frames before k are dropped.
+   */
+  std::vector<cv::Mat> get(const FrameId& k);
+
+  //! Stops and joins the worker threads.
+  void shutdown();
+
+ private:
+  void workerLoop();
+
+ private:
+  const ImageLoader image_loader_;
+  const FrameId last_k_;
+  const size_t lookahead_;
+
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable ready_cv_;
+  //! Next frame to be loaded by a worker.
+  FrameId next_k_;
+  //! Frame last requested by the consumer.
+  FrameId requested_k_;
+  //! Loaded frames not yet consumed.
+  std::map<FrameId, std::vector<cv::Mat>> ready_;
+  bool shutdown_;
+
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace VIO
@@ -13,49 +13,99 @@
  * @author Yun Chang
  */
 
+
 #pragma once
 
+#include <fstream>
 #include <functional>
 #include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
 
 #include "kimera-vio/dataprovider/DataProviderInterface.h"
+#include "kimera-vio/dataprovider/ImagePrefetcher.h"
 #include "kimera-vio/frontend/StereoImuSyncPacket.h"
+#include "kimera-vio/imu-frontend/ImuFrontend-definitions.h"
+#include "kimera-vio/pipeline/Pipeline-definitions.h"
+#include "kimera-vio/utils/Macros.h"
 
 namespace VIO {
 
+/**
+ * @brief The KittiDataProvider class plays a KITTI raw sequence
+ * (<date>/<date>_drive_<id>_sync), with the same callbacks as the
+ * EurocDataProvider.
+ *
+ * The sequence is streamed instead of being parsed up front: each spinOnce
+ * reads the next camera timestamp, sends the OXTS IMU measurements up to it
+ * (reading one OXTS file at a time), and the images of the frame, which are
+ * loaded on demand (ahead of playback if kitti_prefetch_threads > 0, see
+ * ImagePrefetcher). Hence memory and startup time do not depend on the length
+ * of the drive.
+ *
+ * The camera params are the ones of the VioParams (the grayscale cameras,
+ * image_00 and image_01).
+ */
 class KittiDataProvider : public DataProviderInterface {
  public:
-  KittiDataProvider();
-  virtual ~KittiDataProvider() = default;
-
-  virtual bool spin() override;
+  KIMERA_DELETE_COPY_CONSTRUCTORS(KittiDataProvider);
+  KIMERA_POINTER_TYPEDEFS(KittiDataProvider);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  //! Ctor with params.
+  KittiDataProvider(const std::string& dataset_path,
+                    const int& initial_k,
+                    const int& final_k,
+                    const VioParams& vio_params);
+  //! Ctor from gflags
+  explicit KittiDataProvider(const VioParams& vio_params);
+
+  virtual ~KittiDataProvider();
+
+  bool spin() override;
+
+  bool hasData() const override;
+
+  /**
+   * @brief parseTimestamp Parses a line of a KITTI timestamps file, e.g.
+   * "2011-09-26 13:02:25.964389445", into the time of the day.
+   * @return False if the line is not a timestamp.
+   */
+  static bool parseTimestamp(const std::string& line, Timestamp* timestamp);
+
+  /**
+   * @brief parseOxtsImuMeasurement Parses the accelerations (ax, ay, az) and
+   * angular rates (wx, wy, wz) of an OXTS data line, in the IMU frame.
+   * @return False if the line does not have all the measurements.
+   */
+  static bool parseOxtsImuMeasurement(const std::string& line,
+                                      ImuAccGyr* imu_accgyr);
 
  private:
-  struct KittiData {
-    inline size_t getNumberOfImages() const { return left_img_names_.size(); }
-
-    // also since sometimes don't have enough imu measurements for first few
-    // frames This matches the names of the folders in the dataset
-    std::string left_camera_name_;
-    std::string right_camera_name_;
-
-    // The image names of the images from left camera
-    std::vector<std::string> left_img_names_;
-    // The image names of the images from right camera
-    std::vector<std::string> right_img_names_;
-    // Vector of timestamps see issue in .cpp file
-    std::vector<Timestamp> timestamps_;
-    // IMU data
-    ImuData imuData_;
-    // Sanity check to ensure data is correctly parsed
-    // (returns true if data is correct, false otherwise)
-    explicit operator bool() const;
-  };
+  //! Sends the frames of current_k_ and the IMU measurements up to them.
+  bool spinOnce();
 
- private:
-  cv::Mat readKittiImage(const std::string& img_name);
-  void parseKittiData(const std::string& kitti_sequence_path,
-                      KittiData* kitti_data);
+  //! Reads the next line of the camera timestamps (those of the left camera).
+  bool readNextFrameTimestamp(Timestamp* timestamp);
+
+  //! Reads the next OXTS measurement, if any, into next_imu_measurement_.
+  void readNextImuMeasurement();
+
+  //! Sends the IMU measurements until the first one after the timestamp, so
+  //! that the data provider module does not wait for IMU data for the frame.
+  void sendImuDataUntil(const Timestamp& timestamp);
+
+  //! Thread-safe, returns empty images for missing ones.
+  std::vector<cv::Mat> readKittiImages(const FrameId& k) const;
+
+  //! Same as readKittiImages, but through the image prefetcher if enabled.
+  std::vector<cv::Mat> getImages(const FrameId& k);
+
+  //! @return Path of the data file of sensor_name (e.g. image_00) for frame k.
+  std::string getDataFilename(const std::string& sensor_name,
+                              const FrameId& k,
+                              const std::string& extension) const;
 
   // Parse the timestamps of a particular device of given dataset
   bool parseTimestamps(const std::string& timestamps_file,
@@ -64,12 +114,7 @@ class KittiDataProvider : public DataProviderInterface {
   // Parse camera info of given dataset
   bool parseCameraData(const std::string& input_dataset_path,
                        const std::string& left_cam_name,
-                       const std::string& right_cam_name,
-                       KittiData* kitti_data);
-
-  // Parse IMU data of a given dataset
-  bool parseImuData(const std::string& input_dataset_path,
-                    KittiData* kitti_data);
+                       const std::string& right_cam_name);
 
   // Get R and T matrix from calibration file
   bool parsePose(const std::string& input_dataset_path,
@@ -80,9 +125,29 @@ class KittiDataProvider : public DataProviderInterface {
   void print() const;
 
  private:
-  KittiData kitti_data_;
-  FrameId initial_k_ = 0;
-  FrameId final_k_ = 1000;
+  const VioParams vio_params_;
+  const std::string dataset_path_;
+  // These match the names of the folders in the dataset.
+  const std::string left_camera_name_;
+  const std::string right_camera_name_;
+  const std::string imu_name_;
+
+  FrameId current_k_;
+  FrameId initial_k_;
+  FrameId final_k_;
+  bool is_sequence_finished_;
+
+  //! Streams of the timestamps files, read one line per frame/measurement.
+  std::ifstream frame_timestamps_stream_;
+  std::ifstream imu_timestamps_stream_;
+  //! Index of the next OXTS data file.
+  FrameId next_imu_k_;
+  //! Next IMU measurement to be sent, if has_next_imu_measurement_.
+  ImuMeasurement next_imu_measurement_;
+  bool has_next_imu_measurement_;
+  Timestamp last_imu_timestamp_sent_;
+
+  ImagePrefetcher::UniquePtr image_prefetcher_;
 };
 
 }  // namespace VIO
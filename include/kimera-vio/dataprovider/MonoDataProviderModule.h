@@ -45,7 +45,7 @@ class MonoDataProviderModule : public DataProviderModule {
   KIMERA_POINTER_TYPEDEFS(MonoDataProviderModule);
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
-  MonoDataProviderModule(OutputQueue* output_queue,
+  MonoDataProviderModule(OutputQueueBase* output_queue,
                          const std::string& name_id,
                          const bool& parallel_run);
 
@@ -88,6 +88,14 @@ class MonoDataProviderModule : public DataProviderModule {
    */
   Frame::UniquePtr getLeftFramePayload();
 
+  /**
+   * @brief downscaleFrame Downscales the image of a frame to the image size
+   * of its camera params, with an area filter, if they were downscaled (see
+   * FrontendParams::image_downscale_factor_).
+   * @return The same frame if no downscaling is needed.
+   */
+  static Frame::UniquePtr downscaleFrame(Frame::UniquePtr frame);
+
   // Spin the dataset: processes the input data and constructs a Mono+Imu
   // Synchronized Packet (mono + IMU measurements), the minimum data
   // needed for the VIO pipeline to do one processing iteration.
@@ -0,0 +1,93 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   MultiCameraDataProviderModule.h
+ * @brief  Pipeline module that provides multi-camera + IMU data to the VIO
+ * pipeline.
+ * @details Same as the StereoDataProviderModule, but for N cameras: the frames
+ * of the reference camera (the left frame queue) are synced with the IMU, and
+ * the frames of the other cameras with the reference ones.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>  // for move
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "kimera-vio/dataprovider/MonoDataProviderModule.h"
+#include "kimera-vio/frontend/MultiCameraImuSyncPacket.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+class MultiCameraDataProviderModule : public MonoDataProviderModule {
+ public:
+  KIMERA_DELETE_COPY_CONSTRUCTORS(MultiCameraDataProviderModule);
+  KIMERA_POINTER_TYPEDEFS(MultiCameraDataProviderModule);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  //! @param nr_cameras Number of cameras, including the reference one.
+  MultiCameraDataProviderModule(OutputQueueBase* output_queue,
+                                const std::string& name_id,
+                                const bool& parallel_run,
+                                const size_t& nr_cameras);
+
+  virtual ~MultiCameraDataProviderModule() = default;
+
+  inline size_t getNrCameras() const { return frame_queues_.size() + 1u; }
+
+  //! @param cam_idx Index of the camera, the reference one (0) being the
+  //! left frame queue.
+  inline void fillFrameQueue(const size_t& cam_idx, Frame::UniquePtr frame) {
+    CHECK(frame);
+    if (cam_idx == 0u) {
+      fillLeftFrameQueue(std::move(frame));
+    } else {
+      getFrameQueue(cam_idx)->push(std::move(frame));
+    }
+  }
+  inline void fillFrameQueueBlockingIfFull(const size_t& cam_idx,
+                                           Frame::UniquePtr frame) {
+    CHECK(frame);
+    if (cam_idx == 0u) {
+      fillLeftFrameQueueBlockingIfFull(std::move(frame));
+    } else {
+      getFrameQueue(cam_idx)->pushBlockingIfFull(std::move(frame), 5u);
+    }
+  }
+
+ protected:
+  InputUniquePtr getInputPacket() override;
+
+  void shutdownQueues() override;
+
+  //! Checks if the module has work to do (should check input queues are empty)
+  bool hasWork() const override;
+
+ private:
+  inline ThreadsafeQueue<Frame::UniquePtr>* getFrameQueue(
+      const size_t& cam_idx) {
+    CHECK_GT(cam_idx, 0u);
+    CHECK_LT(cam_idx, getNrCameras());
+    return frame_queues_[cam_idx - 1u].get();
+  }
+
+ private:
+  //! Input data of the non-reference cameras: frame_queues_[i] holds the
+  //! frames of camera i + 1.
+  std::vector<std::unique_ptr<ThreadsafeQueue<Frame::UniquePtr>>>
+      frame_queues_;
+};
+
+}  // namespace VIO
@@ -41,7 +41,7 @@ class RgbdDataProviderModule : public MonoDataProviderModule {
   KIMERA_POINTER_TYPEDEFS(RgbdDataProviderModule);
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
-  RgbdDataProviderModule(OutputQueue* output_queue,
+  RgbdDataProviderModule(OutputQueueBase* output_queue,
                          const std::string& name_id,
                          const bool& parallel_run);
 
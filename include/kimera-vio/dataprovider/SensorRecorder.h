@@ -0,0 +1,138 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   SensorRecorder.h
+ * @brief  Records the sensor data sent by a data provider to a binary dataset.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/dataprovider/BinaryDataset.h"
+#include "kimera-vio/frontend/Frame.h"
+#include "kimera-vio/frontend/VisionImuFrontend-definitions.h"
+#include "kimera-vio/imu-frontend/ImuFrontend-definitions.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The SensorRecorder class appends the frames, IMU and external
+ * odometry measurements sent to the pipeline to a binary dataset (see
+ * BinaryDataset.h), which the BinaryDataProvider replays. Attach it to a data
+ * provider with DataProviderInterface::attachRecorder.
+ *
+ * The record functions only buffer the data (images are not copied, they are
+ * read-only in the pipeline), a background thread writes it. Buffers are
+ * bounded: if the disk cannot keep up, new data is dropped (and reported)
+ * instead of blocking the calling thread. Frames are written once all their
+ * images are there, out of order data (e.g. repeated timestamps) is dropped.
+ */
+class SensorRecorder {
+ public:
+  KIMERA_POINTER_TYPEDEFS(SensorRecorder);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(SensorRecorder);
+
+  /**
+   * @param nr_cameras Nr of images per frame (1 for mono, 2 for stereo).
+   * @param max_buffered_frames Max nr of frames waiting to be written.
+   * @param max_buffered_measurements Max nr of IMU and external odometry
+   * measurements waiting to be written.
+   */
+  SensorRecorder(const std::string& filename,
+                 const size_t& nr_cameras,
+                 const size_t& max_buffered_frames = 8u,
+                 const size_t& max_buffered_measurements = 10000u);
+  //! Closes the recording if close() was not called.
+  ~SensorRecorder();
+
+ public:
+  // Thread-safe, never wait for the disk. Ignored once closed.
+  void recordImu(const ImuMeasurement& imu_measurement);
+  void recordExternalOdom(const ExternalOdomMeasurement& odom);
+  //! @param cam_idx Camera of the frame, e.g. 0 for left and 1 for right.
+  void recordFrame(const size_t& cam_idx, const Frame& frame);
+
+  //! Writes the buffered data and the index of the recording. Blocks.
+  void close();
+
+  size_t getNrRecordedFrames() const;
+  //! Nr of images dropped as the buffer was full, or as the other images of
+  //! their frame were dropped.
+  size_t getNrDroppedImages() const;
+  size_t getNrDroppedMeasurements() const;
+
+ private:
+  struct BufferedImage {
+    size_t cam_idx;
+    FrameId frame_id;
+    Timestamp timestamp;
+    cv::Mat img;
+  };
+
+  struct IncompleteFrame {
+    Timestamp timestamp;
+    //! One per camera, empty until received.
+    std::vector<cv::Mat> images;
+    size_t nr_images;
+  };
+
+  void workerLoop();
+
+  //! Writes the buffered data, called by the background thread only.
+  void write(std::deque<ImuMeasurement>* imu_measurements,
+             std::deque<ExternalOdomMeasurement>* odom_measurements,
+             std::deque<BufferedImage>* images);
+
+  //! Logs the nr of dropped data if it changed, at most once per second.
+  void reportDrops(const bool& force);
+
+ private:
+  const size_t nr_cameras_;
+  const size_t max_buffered_images_;
+  const size_t max_buffered_measurements_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<ImuMeasurement> imu_measurements_;
+  std::deque<ExternalOdomMeasurement> odom_measurements_;
+  std::deque<BufferedImage> images_;
+  bool closing_;
+  bool closed_;
+  size_t nr_recorded_frames_;
+  size_t nr_dropped_images_;
+  size_t nr_dropped_measurements_;
+
+  // Only used by the background thread.
+  BinaryDatasetWriter writer_;
+  //! Images of the frames not complete yet, by frame id.
+  std::map<FrameId, IncompleteFrame> incomplete_frames_;
+  Timestamp last_imu_timestamp_;
+  Timestamp last_odom_timestamp_;
+  Timestamp last_frame_timestamp_;
+  size_t nr_reported_drops_;
+  std::chrono::steady_clock::time_point last_report_time_;
+
+  std::thread worker_;
+};
+
+}  // namespace VIO
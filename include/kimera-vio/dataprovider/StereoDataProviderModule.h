@@ -39,7 +39,7 @@ class StereoDataProviderModule : public MonoDataProviderModule {
   KIMERA_POINTER_TYPEDEFS(StereoDataProviderModule);
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
-  StereoDataProviderModule(OutputQueue* output_queue,
+  StereoDataProviderModule(OutputQueueBase* output_queue,
                            const std::string& name_id,
                            const bool& parallel_run,
                            const StereoMatchingParams& stereo_matching_params);
@@ -0,0 +1,152 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   SyntheticDataProvider.h
+ * @brief  Generates frames and IMU data of a procedural world, for load and
+ * scaling tests.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <random>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include <gtsam/geometry/Pose3.h>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/dataprovider/DataProviderInterface-definitions.h"
+#include "kimera-vio/dataprovider/DataProviderInterface.h"
+#include "kimera-vio/frontend/CameraParams.h"
+#include "kimera-vio/imu-frontend/ImuFrontend-definitions.h"
+#include "kimera-vio/pipeline/Pipeline-definitions.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+struct SyntheticWorldParams {
+  //! The world is the inner wall of a vertical cylinder (z up, gravity along
+  //! -z), textured with square landmarks.
+  double wall_radius_m = 6.0;
+  double wall_height_m = 4.0;
+  //! Nr of landmarks per square meter of wall.
+  double landmark_density = 2.0;
+  //! Side of the landmark squares [m].
+  double landmark_size_m = 0.1;
+
+  //! The left camera moves on a horizontal circle centered on the cylinder
+  //! axis, at half the wall height, looking outwards. It overlaps with the
+  //! beginning of the trajectory after each revolution, for loop closures.
+  double trajectory_radius_m = 1.0;
+  double angular_velocity_rad_s = 0.3;
+  //! Vertical oscillation, to excite the IMU.
+  double vertical_amplitude_m = 0.2;
+  double vertical_frequency_hz = 0.5;
+
+  double duration_s = 30.0;
+  //! 0 to use the frame rate of the camera params.
+  double frame_rate_hz = 0.0;
+  //! 0 to use the nominal sampling time of the IMU params.
+  double imu_rate_hz = 0.0;
+  //! Add white noise with the densities of the IMU params (no bias).
+  bool imu_noise = true;
+  unsigned int seed = 0u;
+};
+
+/**
+ * @brief The SyntheticDataProvider class renders a procedural world (see
+ * SyntheticWorldParams) at any frame and IMU rate, to measure how the cost of
+ * the modules scales with the nr of landmarks, the rates and the trajectory.
+ * It sends left frames, plus right frames for the stereo frontend and depth
+ * frames (in depth_to_meters units) for the RGB-D one, using the camera
+ * params as calibration. The IMU data is sent incrementally, up to one IMU
+ * period after each frame. The ground truth is exact (zero biases).
+ */
+class SyntheticDataProvider : public DataProviderInterface {
+ public:
+  KIMERA_DELETE_COPY_CONSTRUCTORS(SyntheticDataProvider);
+  KIMERA_POINTER_TYPEDEFS(SyntheticDataProvider);
+
+  SyntheticDataProvider(const SyntheticWorldParams& world_params,
+                        const VioParams& vio_params);
+  //! Ctor from gflags
+  explicit SyntheticDataProvider(const VioParams& vio_params);
+
+  virtual ~SyntheticDataProvider() = default;
+
+ public:
+  virtual bool spin() override;
+
+  virtual bool hasData() const override;
+
+  inline size_t getNrFrames() const { return nr_frames_; }
+  inline size_t getNrLandmarks() const { return landmarks_.size(); }
+
+  //! Pose of the body in the world at the given time [s] from the start.
+  gtsam::Pose3 getBodyPose(const double& t) const;
+
+  //! Accelerometer and gyroscope measurements (noiseless) at the given time.
+  ImuAccGyr getImuMeasurement(const double& t) const;
+
+ public:
+  // Ground truth data.
+  GroundTruthData gt_data_;
+
+ protected:
+  /**
+   * @brief spinOnce Send data to VIO pipeline on a per-frame basis
+   * @return if the dataset finished or not
+   */
+  virtual bool spinOnce();
+
+  //! Sends the IMU measurements up to the given time [s].
+  void sendImuDataUntil(const double& t);
+
+  //! Pose of the left camera in the world at the given time [s].
+  gtsam::Pose3 getLeftCameraPose(const double& t) const;
+
+  cv::Mat renderImage(const CameraParams& cam_params,
+                      const gtsam::Pose3& W_Pose_cam) const;
+
+  //! Depth of the wall along the rays of the left camera [depth_to_meters].
+  cv::Mat renderDepth(const gtsam::Pose3& W_Pose_cam) const;
+
+  inline Timestamp toTimestamp(const double& t) const {
+    return initial_timestamp_ + static_cast<Timestamp>(t * 1.0e9);
+  }
+
+ protected:
+  struct Landmark {
+    gtsam::Point3 position;
+    uchar intensity;
+  };
+
+  VioParams vio_params_;
+  SyntheticWorldParams world_params_;
+
+  double frame_period_s_;
+  double imu_period_s_;
+  size_t nr_frames_;
+  size_t current_k_;
+  //! Index of the next IMU measurement, which is the first one sent before
+  //! the first frame.
+  int64_t next_imu_idx_;
+
+  const Timestamp initial_timestamp_;
+  std::vector<Landmark> landmarks_;
+  //! Normalized rays (z = 1) of each pixel of the left camera, for depth.
+  std::vector<cv::Point3d> left_rays_;
+
+  std::mt19937 generator_;
+  std::normal_distribution<double> imu_noise_;
+};
+
+}  // namespace VIO
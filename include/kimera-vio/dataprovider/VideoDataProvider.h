@@ -0,0 +1,129 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   VideoDataProvider.h
+ * @brief  Replays a dataset stored as video streams (see VideoDataProvider).
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <opencv2/videoio.hpp>
+
+#include "kimera-vio/dataprovider/DataProviderInterface-definitions.h"
+#include "kimera-vio/dataprovider/DataProviderInterface.h"
+#include "kimera-vio/dataprovider/ImagePrefetcher.h"
+#include "kimera-vio/pipeline/Pipeline-definitions.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The VideoDataProvider class replays a dataset stored as video
+ * streams, much smaller and cheaper to read than image sequences. The dataset
+ * folder holds:
+ * - left.mkv (or .mp4): left images, required.
+ * - right.mkv (or .mp4): right images, optional.
+ * - depth.mkv (or .mp4): depth images, optional. 16-bit depths are stored in
+ *   a lossless codec (e.g. FFV1), either natively as gray16 or packed in bgr24
+ *   (see unpackDepth).
+ * - frames.csv: timestamp [ns] of each frame, one per line, as video
+ *   timestamps are quantized by the frame rate.
+ * - imu.csv: IMU measurements, in the EuRoC imu0/data.csv format.
+ * Frame k of every stream belongs to the k-th timestamp of frames.csv.
+ *
+ * Streams are decoded with the hardware decoders available to OpenCV's
+ * video backend (e.g. NVDEC or V4L2 M2M through FFmpeg), falling back to
+ * software decoding, into buffers of the ImageBufferPool. Decoding is
+ * sequential, but can run ahead of playback on a thread (see
+ * video_decode_lookahead). Like the EurocDataProvider, all IMU data is sent
+ * first, then one frame per spinOnce.
+ */
+class VideoDataProvider : public DataProviderInterface {
+ public:
+  KIMERA_DELETE_COPY_CONSTRUCTORS(VideoDataProvider);
+  KIMERA_POINTER_TYPEDEFS(VideoDataProvider);
+
+  //! Replays frames [initial_k, final_k) of the dataset (clipped to its nr
+  //! of frames).
+  VideoDataProvider(const std::string& dataset_path,
+                    const int& initial_k,
+                    const int& final_k,
+                    const VioParams& vio_params);
+  //! Ctor from gflags
+  explicit VideoDataProvider(const VioParams& vio_params);
+
+  virtual ~VideoDataProvider();
+
+ public:
+  virtual bool spin() override;
+
+  virtual bool hasData() const override;
+
+  inline size_t getNrFrames() const { return timestamps_.size(); }
+  inline bool hasRightStream() const { return right_capture_.isOpened(); }
+  inline bool hasDepthStream() const { return depth_capture_.isOpened(); }
+
+  /**
+   * @brief unpackDepth Depth image of a decoded depth stream frame: CV_16UC1
+   * frames are returned as is, bgr24 frames hold the low byte of the depth in
+   * blue and its high byte in green.
+   */
+  static cv::Mat unpackDepth(const cv::Mat& decoded,
+                             cv::MatAllocator* allocator = nullptr);
+
+ protected:
+  /**
+   * @brief spinOnce Send data to VIO pipeline on a per-frame basis
+   * @return if the dataset finished or not
+   */
+  virtual bool spinOnce();
+
+  void sendImuData() const;
+
+  //! Opens the stream with the given name, trying the supported containers.
+  //! @return False if there is no such stream.
+  bool openStream(const std::string& name, cv::VideoCapture* capture) const;
+
+  void parseTimestamps(const std::string& filename);
+  void parseImuData(const std::string& filename);
+
+  //! Decodes the next frame of each stream: left, right and depth images,
+  //! empty for missing streams. Frames must be decoded in order.
+  std::vector<cv::Mat> decodeFrame(const FrameId& k);
+
+  //! Images of frame k, decoded ahead of time if enabled.
+  std::vector<cv::Mat> getImages(const FrameId& k);
+
+ protected:
+  VioParams vio_params_;
+  const std::string dataset_path_;
+
+  cv::VideoCapture left_capture_;
+  cv::VideoCapture right_capture_;
+  cv::VideoCapture depth_capture_;
+  //! Index of the next frame decoded from the streams.
+  FrameId next_decoded_k_;
+
+  std::vector<Timestamp> timestamps_;
+  std::vector<ImuMeasurement> imu_measurements_;
+
+  FrameId current_k_;
+  FrameId final_k_;
+
+  ImagePrefetcher::UniquePtr image_prefetcher_;
+
+  //! Flag to signal if the IMU data has been sent to the VIO pipeline
+  bool is_imu_data_sent_ = false;
+};
+
+}  // namespace VIO
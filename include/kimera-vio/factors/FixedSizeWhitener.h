@@ -0,0 +1,76 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/*
+ * @file FixedSizeWhitener.h
+ * @brief Linearization of binary factors with fixed-size Jacobians.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <array>
+
+#include <gtsam/base/VerticalBlockMatrix.h>
+#include <gtsam/linear/JacobianFactor.h>
+#include <gtsam/linear/NoiseModel.h>
+
+namespace gtsam {
+
+/**
+ * Square root information of the Gaussian noise model of a factor, to whiten
+ * its fixed-size Jacobians and error straight into the JacobianFactor, instead
+ * of going through the dynamic-size NoiseModelFactor::linearize.
+ * Robust and constrained noise models are not supported: isValidFor returns
+ * false, and the factor should fall back to NoiseModelFactor::linearize.
+ */
+template <int Dim>
+class FixedSizeWhitener {
+ public:
+  using SqrtInformation = Eigen::Matrix<double, Dim, Dim>;
+
+  FixedSizeWhitener() = default;
+
+  explicit FixedSizeWhitener(const SharedNoiseModel& noise_model)
+      : noise_model_(nullptr), R_(SqrtInformation::Zero()) {
+    const auto gaussian =
+        dynamic_cast<const noiseModel::Gaussian*>(noise_model.get());
+    if (gaussian && !gaussian->isConstrained() && gaussian->dim() == Dim) {
+      R_ = gaussian->R();
+      noise_model_ = noise_model;
+    }
+  }
+
+  //! Whether the factor still has the noise model this was built with.
+  bool isValidFor(const SharedNoiseModel& noise_model) const {
+    return noise_model_ && noise_model_ == noise_model;
+  }
+
+  //! Same JacobianFactor as NoiseModelFactor::linearize with these Jacobians.
+  template <int D1, int D2>
+  GaussianFactor::shared_ptr linearize(
+      const Key& key_1,
+      const Eigen::Matrix<double, Dim, D1>& H_1,
+      const Key& key_2,
+      const Eigen::Matrix<double, Dim, D2>& H_2,
+      const Eigen::Matrix<double, Dim, 1>& error) const {
+    static const std::array<DenseIndex, 2> kDims = {D1, D2};
+    VerticalBlockMatrix Ab(kDims, Dim, true);
+    Ab(0) = R_ * H_1;
+    Ab(1) = R_ * H_2;
+    Ab(2).col(0) = -(R_ * error);
+    return GaussianFactor::shared_ptr(
+        new JacobianFactor(std::array<Key, 2>{key_1, key_2}, Ab));
+  }
+
+ private:
+  SharedNoiseModel noise_model_ = nullptr;
+  SqrtInformation R_ = SqrtInformation::Zero();
+};
+
+}  // namespace gtsam
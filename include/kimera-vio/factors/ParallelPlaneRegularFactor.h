@@ -18,6 +18,8 @@
 #include <gtsam/geometry/OrientedPlane3.h>
 #include <gtsam/nonlinear/NonlinearFactor.h>
 
+#include "kimera-vio/factors/FixedSizeWhitener.h"
+
 namespace gtsam {
 
 #if GTSAM_VERSION_MAJOR <= 4 && GTSAM_VERSION_MINOR < 3
@@ -93,6 +95,73 @@ class ParallelPlaneRegularFactor
                                  GtsamJacobianType H_plane_2) const = 0;
 };
 
+/**
+ * Parallel plane factor with a Dim-dimensional error, implemented with
+ * fixed-size types (no heap allocation) in evaluateErrorFixed.
+ * It is linearized without going through the dynamic-size
+ * NoiseModelFactor::linearize, unless its noise model is not supported by
+ * FixedSizeWhitener.
+ */
+template <int Dim>
+class FixedSizeParallelPlaneRegularFactor : public ParallelPlaneRegularFactor {
+ public:
+  using ErrorVector = Eigen::Matrix<double, Dim, 1>;
+  using PlaneJacobian = Eigen::Matrix<double, Dim, 3>;
+
+  FixedSizeParallelPlaneRegularFactor() {}
+  virtual ~FixedSizeParallelPlaneRegularFactor() {}
+
+  FixedSizeParallelPlaneRegularFactor(
+      const Key& plane1Key,
+      const Key& plane2Key,
+      const SharedNoiseModel& noiseModel,
+      const double& measured_distance_from_plane2_to_plane1 = 0)
+      : ParallelPlaneRegularFactor(plane1Key,
+                                   plane2Key,
+                                   noiseModel,
+                                   measured_distance_from_plane2_to_plane1),
+        whitener_(noiseModel) {}
+
+  /// Hplane1: jacobian of h wrt plane1
+  /// Hplane2: jacobian of h wrt plane2
+  virtual ErrorVector evaluateErrorFixed(
+      const OrientedPlane3& plane_1,
+      const OrientedPlane3& plane_2,
+      PlaneJacobian* H_plane_1 = nullptr,
+      PlaneJacobian* H_plane_2 = nullptr) const = 0;
+
+  virtual GaussianFactor::shared_ptr linearize(const Values& x) const {
+    if (!whitener_.isValidFor(this->noiseModel_)) {
+      return ParallelPlaneRegularFactor::linearize(x);
+    }
+    PlaneJacobian H_plane_1, H_plane_2;
+    const ErrorVector err = evaluateErrorFixed(x.at<OrientedPlane3>(plane1Key_),
+                                               x.at<OrientedPlane3>(plane2Key_),
+                                               &H_plane_1,
+                                               &H_plane_2);
+    return whitener_.linearize(
+        plane1Key_, H_plane_1, plane2Key_, H_plane_2, err);
+  }
+
+ private:
+  virtual Vector doEvaluateError(const OrientedPlane3& plane_1,
+                                 const OrientedPlane3& plane_2,
+                                 GtsamJacobianType H_plane_1,
+                                 GtsamJacobianType H_plane_2) const {
+    PlaneJacobian H_plane_1_fixed, H_plane_2_fixed;
+    const ErrorVector err =
+        evaluateErrorFixed(plane_1,
+                           plane_2,
+                           H_plane_1 ? &H_plane_1_fixed : nullptr,
+                           H_plane_2 ? &H_plane_2_fixed : nullptr);
+    if (H_plane_1) *H_plane_1 = H_plane_1_fixed;
+    if (H_plane_2) *H_plane_2 = H_plane_2_fixed;
+    return err;
+  }
+
+  FixedSizeWhitener<Dim> whitener_;
+};
+
 /**
  * Specialization of a ParallelPlaneRegularFactor using normals error
  * in Tangent Space of S² (geodesic).
@@ -100,7 +169,7 @@ class ParallelPlaneRegularFactor
  * no distance is enforced.
  */
 class ParallelPlaneRegularTangentSpaceFactor
-    : public ParallelPlaneRegularFactor {
+    : public FixedSizeParallelPlaneRegularFactor<2> {
  public:
   /// Constructor
   ParallelPlaneRegularTangentSpaceFactor() {}
@@ -109,34 +178,25 @@ class ParallelPlaneRegularTangentSpaceFactor
   ParallelPlaneRegularTangentSpaceFactor(const Key& plane1Key,
                                          const Key& plane2Key,
                                          const SharedNoiseModel& noiseModel)
-      : ParallelPlaneRegularFactor(plane1Key, plane2Key, noiseModel) {
+      : FixedSizeParallelPlaneRegularFactor<2>(plane1Key,
+                                               plane2Key,
+                                               noiseModel) {
     this->factor_type_ = "ParallelPlaneRegularTangentSpaceFactor";
   }
 
- private:
-  /// evaluateError
   /// Hplane1: jacobian of h wrt plane1
   /// Hplane2: jacobian of h wrt plane2
-  virtual Vector doEvaluateError(const OrientedPlane3& plane_1,
-                                 const OrientedPlane3& plane_2,
-                                 GtsamJacobianType H_plane_1,
-                                 GtsamJacobianType H_plane_2) const {
-    Unit3 plane_normal_1 = plane_1.normal();
-    Unit3 plane_normal_2 = plane_2.normal();
+  virtual ErrorVector evaluateErrorFixed(
+      const OrientedPlane3& plane_1,
+      const OrientedPlane3& plane_2,
+      PlaneJacobian* H_plane_1 = nullptr,
+      PlaneJacobian* H_plane_2 = nullptr) const {
     Matrix22 H_n_1, H_n_2;
-    Vector2 err;
-    err = plane_normal_1.errorVector(plane_normal_2, H_n_1, H_n_2);
-    if (H_plane_1) {
-      Matrix23 tmp;
-      tmp << H_n_1, Vector2::Zero();
-      *H_plane_1 = tmp;
-    }
-    if (H_plane_2) {
-      Matrix23 tmp;
-      tmp << H_n_2, Vector2::Zero();
-      *H_plane_2 = tmp;
-    }
-    return (err);
+    const Vector2 err =
+        plane_1.normal().errorVector(plane_2.normal(), H_n_1, H_n_2);
+    if (H_plane_1) *H_plane_1 << H_n_1, Vector2::Zero();
+    if (H_plane_2) *H_plane_2 << H_n_2, Vector2::Zero();
+    return err;
   }
 };
 
@@ -147,7 +207,7 @@ class ParallelPlaneRegularTangentSpaceFactor
  * between planes.
  */
 class GeneralParallelPlaneRegularTangentSpaceFactor
-    : public ParallelPlaneRegularFactor {
+    : public FixedSizeParallelPlaneRegularFactor<3> {
  public:
   /// Constructor
   GeneralParallelPlaneRegularTangentSpaceFactor() {}
@@ -158,42 +218,30 @@ class GeneralParallelPlaneRegularTangentSpaceFactor
       const Key& plane2Key,
       const SharedNoiseModel& noiseModel,
       const double& measured_distance_from_plane2_to_plane1 = 0)
-      : ParallelPlaneRegularFactor(plane1Key,
-                                   plane2Key,
-                                   noiseModel,
-                                   measured_distance_from_plane2_to_plane1) {
+      : FixedSizeParallelPlaneRegularFactor<3>(
+            plane1Key,
+            plane2Key,
+            noiseModel,
+            measured_distance_from_plane2_to_plane1) {
     this->factor_type_ = "GeneralParallelPlaneRegularTangentSpaceFactor";
   }
 
- private:
-  /// evaluateError
   /// Hplane1: jacobian of h wrt plane1
   /// Hplane2: jacobian of h wrt plane2
-  virtual Vector doEvaluateError(const OrientedPlane3& plane_1,
-                                 const OrientedPlane3& plane_2,
-                                 GtsamJacobianType H_plane_1,
-                                 GtsamJacobianType H_plane_2) const {
-    Unit3 plane_normal_1 = plane_1.normal();
-    Unit3 plane_normal_2 = plane_2.normal();
+  virtual ErrorVector evaluateErrorFixed(
+      const OrientedPlane3& plane_1,
+      const OrientedPlane3& plane_2,
+      PlaneJacobian* H_plane_1 = nullptr,
+      PlaneJacobian* H_plane_2 = nullptr) const {
     Matrix22 H_n_1, H_n_2;
-    Vector2 normal_err(
-        plane_normal_1.errorVector(plane_normal_2, H_n_1, H_n_2));
-    Vector3 err;
-    err = Vector3(normal_err(0),
-                  normal_err(1),
-                  plane_1.distance() - plane_2.distance() -
-                      measured_distance_from_plane2_to_plane1);
-    if (H_plane_1) {
-      Matrix33 a;
-      a << H_n_1, Vector2::Zero(), 0, 0, 1;
-      *H_plane_1 = a;
-    }
-    if (H_plane_2) {
-      Matrix33 a;
-      a << H_n_2, Vector2::Zero(), 0, 0, -1;
-      *H_plane_2 = a;
-    }
-    return (err);
+    const Vector2 normal_err =
+        plane_1.normal().errorVector(plane_2.normal(), H_n_1, H_n_2);
+    if (H_plane_1) *H_plane_1 << H_n_1, Vector2::Zero(), 0, 0, 1;
+    if (H_plane_2) *H_plane_2 << H_n_2, Vector2::Zero(), 0, 0, -1;
+    return ErrorVector(normal_err(0),
+                       normal_err(1),
+                       plane_1.distance() - plane_2.distance() -
+                           measured_distance_from_plane2_to_plane1);
   }
 };
 
@@ -203,7 +251,8 @@ class GeneralParallelPlaneRegularTangentSpaceFactor
  * The error metric only considers parallelism between planes,
  * no distance is enforced.
  */
-class ParallelPlaneRegularBasicFactor : public ParallelPlaneRegularFactor {
+class ParallelPlaneRegularBasicFactor
+    : public FixedSizeParallelPlaneRegularFactor<3> {
  public:
   /// Constructor
   ParallelPlaneRegularBasicFactor() {}
@@ -212,37 +261,26 @@ class ParallelPlaneRegularBasicFactor : public ParallelPlaneRegularFactor {
   ParallelPlaneRegularBasicFactor(const Key& plane1Key,
                                   const Key& plane2Key,
                                   const SharedNoiseModel& noiseModel)
-      : ParallelPlaneRegularFactor(plane1Key, plane2Key, noiseModel) {
+      : FixedSizeParallelPlaneRegularFactor<3>(plane1Key,
+                                               plane2Key,
+                                               noiseModel) {
     this->factor_type_ = "ParallelPlaneRegularBasicFactor";
   }
 
- private:
-  /// evaluateError
   /// Hplane1: jacobian of h wrt plane1
   /// Hplane2: jacobian of h wrt plane2
-  virtual Vector doEvaluateError(const OrientedPlane3& plane_1,
-                                 const OrientedPlane3& plane_2,
-                                 GtsamJacobianType H_plane_1,
-                                 GtsamJacobianType H_plane_2) const {
+  virtual ErrorVector evaluateErrorFixed(
+      const OrientedPlane3& plane_1,
+      const OrientedPlane3& plane_2,
+      PlaneJacobian* H_plane_1 = nullptr,
+      PlaneJacobian* H_plane_2 = nullptr) const {
     const Unit3& plane_normal_1 = plane_1.normal();
     const Unit3& plane_normal_2 = plane_2.normal();
-    Vector3 err(plane_normal_1.unitVector() - plane_normal_2.unitVector());
-
-    if (H_plane_1) {
-      // Jacobian of plane retraction when v = Vector3::Zero(), to speed-up
-      // computations.
-      Matrix33 tmp;
-      tmp << plane_normal_1.basis(), Vector3::Zero();
-      *H_plane_1 = tmp;
-    }
-    if (H_plane_2) {
-      // Jacobian of plane retraction when v = Vector3::Zero(), to speed-up
-      // computations.
-      Matrix33 tmp;
-      tmp << -plane_normal_2.basis(), Vector3::Zero();
-      *H_plane_2 = tmp;
-    }
-    return (err);
+    // Jacobians of plane retraction when v = Vector3::Zero(), to speed-up
+    // computations.
+    if (H_plane_1) *H_plane_1 << plane_normal_1.basis(), Vector3::Zero();
+    if (H_plane_2) *H_plane_2 << -plane_normal_2.basis(), Vector3::Zero();
+    return plane_normal_1.point3() - plane_normal_2.point3();
   }
 };
 
@@ -253,7 +291,7 @@ class ParallelPlaneRegularBasicFactor : public ParallelPlaneRegularFactor {
  * between planes.
  */
 class GeneralParallelPlaneRegularBasicFactor
-    : public ParallelPlaneRegularFactor {
+    : public FixedSizeParallelPlaneRegularFactor<4> {
  public:
   /// Constructor
   GeneralParallelPlaneRegularBasicFactor() {}
@@ -264,44 +302,36 @@ class GeneralParallelPlaneRegularBasicFactor
       const Key& plane2Key,
       const SharedNoiseModel& noiseModel,
       const double& measured_distance_from_plane2_to_plane1 = 0)
-      : ParallelPlaneRegularFactor(plane1Key,
-                                   plane2Key,
-                                   noiseModel,
-                                   measured_distance_from_plane2_to_plane1) {
+      : FixedSizeParallelPlaneRegularFactor<4>(
+            plane1Key,
+            plane2Key,
+            noiseModel,
+            measured_distance_from_plane2_to_plane1) {
     this->factor_type_ = "GeneralParallelPlaneRegularBasicFactor";
   }
 
- private:
-  /// evaluateError
   /// Hplane1: jacobian of h wrt plane1
   /// Hplane2: jacobian of h wrt plane2
-  virtual Vector doEvaluateError(const OrientedPlane3& plane_1,
-                                 const OrientedPlane3& plane_2,
-                                 GtsamJacobianType H_plane_1,
-                                 GtsamJacobianType H_plane_2) const {
-    const Unit3& plane_normal_1(plane_1.normal());
-    const Unit3& plane_normal_2(plane_2.normal());
-    Vector4 err(0.0, 0.0, 0.0, 0.0);
-    err = Vector4(plane_normal_1.point3().x() - plane_normal_2.point3().x(),
-                  plane_normal_1.point3().y() - plane_normal_2.point3().y(),
-                  plane_normal_1.point3().z() - plane_normal_2.point3().z(),
-                  plane_1.distance() - plane_2.distance() -
-                      measured_distance_from_plane2_to_plane1);
+  virtual ErrorVector evaluateErrorFixed(
+      const OrientedPlane3& plane_1,
+      const OrientedPlane3& plane_2,
+      PlaneJacobian* H_plane_1 = nullptr,
+      PlaneJacobian* H_plane_2 = nullptr) const {
+    const Unit3& plane_normal_1 = plane_1.normal();
+    const Unit3& plane_normal_2 = plane_2.normal();
+    // Jacobians of plane retraction when v = Vector3::Zero(), to speed-up
+    // computations.
     if (H_plane_1) {
-      // Jacobian of plane retraction when v = Vector3::Zero(), to speed-up
-      // computations.
-      Matrix43 tmp;
-      tmp << plane_normal_1.basis(), Vector3::Zero(), 0, 0, 1;
-      *H_plane_1 = tmp;
+      *H_plane_1 << plane_normal_1.basis(), Vector3::Zero(), 0, 0, 1;
     }
     if (H_plane_2) {
-      // Jacobian of plane retraction when v = Vector3::Zero(), to speed-up
-      // computations.
-      Matrix43 tmp;
-      tmp << -plane_normal_2.basis(), Vector3::Zero(), 0, 0, -1;
-      *H_plane_2 = tmp;
+      *H_plane_2 << -plane_normal_2.basis(), Vector3::Zero(), 0, 0, -1;
     }
-    return (err);
+    ErrorVector err;
+    err << plane_normal_1.point3() - plane_normal_2.point3(),
+        plane_1.distance() - plane_2.distance() -
+            measured_distance_from_plane2_to_plane1;
+    return err;
   }
 };
 
@@ -18,6 +18,8 @@
 #include <gtsam/geometry/OrientedPlane3.h>
 #include <gtsam/nonlinear/NonlinearFactor.h>
 
+#include "kimera-vio/factors/FixedSizeWhitener.h"
+
 namespace gtsam {
 
 #if GTSAM_VERSION_MAJOR <= 4 && GTSAM_VERSION_MINOR < 3
@@ -61,6 +63,16 @@ class PointPlaneFactor : public NoiseModelFactor2<Point3, OrientedPlane3> {
       GtsamJacobianType H_point = JACOBIAN_DEFAULT,
       GtsamJacobianType H_plane = JACOBIAN_DEFAULT) const;
 
+  /// Same error and Jacobians, with fixed-size types (no heap allocation).
+  static double evaluateErrorFixed(const Point3& point,
+                                   const OrientedPlane3& plane,
+                                   Matrix13* H_point = nullptr,
+                                   Matrix13* H_plane = nullptr);
+
+  /// Linearize with the fixed-size Jacobians, unless the noise model is not
+  /// supported by FixedSizeWhitener (then as any NoiseModelFactor).
+  virtual GaussianFactor::shared_ptr linearize(const Values& x) const;
+
   Key getPointKey() const { return pointKey_; }
 
   Key getPlaneKey() const { return planeKey_; }
@@ -71,6 +83,7 @@ class PointPlaneFactor : public NoiseModelFactor2<Point3, OrientedPlane3> {
  protected:
   Key pointKey_;
   Key planeKey_;
+  FixedSizeWhitener<1> whitener_;
 };
 
 }  // namespace gtsam
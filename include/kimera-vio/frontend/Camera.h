@@ -22,6 +22,7 @@
 #include <opencv2/core.hpp>
 #include <optional>
 
+#include "kimera-vio/frontend/CameraModels.h"
 #include "kimera-vio/frontend/CameraParams.h"
 #include "kimera-vio/frontend/UndistorterRectifier.h"
 #include "kimera-vio/utils/Macros.h"
@@ -130,6 +131,9 @@ class Camera {
   gtsam::Cal3_S2 calibration_;
   UndistorterRectifier::UniquePtr undistorter_;
   std::unique_ptr<CameraImpl> camera_impl_;
+  //! For the per-keypoint projections, instead of the camera_impl_.
+  PinholeCameraModel<NoDistortion> undistorted_camera_model_;
+  std::optional<OmniCameraModel> omni_camera_model_;
 };
 
 }  // namespace VIO
@@ -0,0 +1,386 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   CameraModels.h
+ * @brief  Camera models specialized at compile time for each projection and
+ * distortion model, for the per-keypoint projections.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cmath>
+#include <variant>
+
+#include <Eigen/Core>
+#include <Eigen/LU>
+
+namespace VIO {
+
+class CameraParams;
+
+/**
+ * Distortion models: map the normalized image coordinates (z = 1) of the
+ * ideal pinhole to the distorted ones, with the same coefficients as OpenCV.
+ * Each provides:
+ *   distort(normalized, J): with J the 2x2 Jacobian wrt normalized.
+ *   undistort(distorted): inverse of distort.
+ */
+struct NoDistortion {
+  inline Eigen::Vector2d distort(const Eigen::Vector2d& normalized,
+                                 Eigen::Matrix2d* J = nullptr) const {
+    if (J) J->setIdentity();
+    return normalized;
+  }
+
+  inline Eigen::Vector2d undistort(const Eigen::Vector2d& distorted) const {
+    return distorted;
+  }
+};
+
+//! Radial-tangential (plumb bob) model: k1, k2, p1, p2[, k3].
+struct RadTanDistortion {
+  RadTanDistortion(const double& k1,
+                   const double& k2,
+                   const double& p1,
+                   const double& p2,
+                   const double& k3 = 0.0)
+      : k1_(k1), k2_(k2), p1_(p1), p2_(p2), k3_(k3) {}
+
+  inline Eigen::Vector2d distort(const Eigen::Vector2d& normalized,
+                                 Eigen::Matrix2d* J = nullptr) const {
+    const double& x = normalized.x();
+    const double& y = normalized.y();
+    const double xx = x * x;
+    const double yy = y * y;
+    const double xy = x * y;
+    const double r2 = xx + yy;
+    const double radial = 1.0 + r2 * (k1_ + r2 * (k2_ + r2 * k3_));
+    if (J) {
+      // d(radial) / d(r2)
+      const double d_radial = k1_ + r2 * (2.0 * k2_ + 3.0 * k3_ * r2);
+      (*J)(0, 0) = radial + 2.0 * xx * d_radial + 2.0 * p1_ * y + 6.0 * p2_ * x;
+      (*J)(0, 1) = 2.0 * xy * d_radial + 2.0 * p1_ * x + 2.0 * p2_ * y;
+      (*J)(1, 0) = 2.0 * xy * d_radial + 2.0 * p1_ * x + 2.0 * p2_ * y;
+      (*J)(1, 1) = radial + 2.0 * yy * d_radial + 6.0 * p1_ * y + 2.0 * p2_ * x;
+    }
+    return Eigen::Vector2d(
+        x * radial + 2.0 * p1_ * xy + p2_ * (r2 + 2.0 * xx),
+        y * radial + p1_ * (r2 + 2.0 * yy) + 2.0 * p2_ * xy);
+  }
+
+  //! Gauss-Newton on distort, starting from the distorted coordinates.
+  inline Eigen::Vector2d undistort(const Eigen::Vector2d& distorted) const {
+    static constexpr int kMaxIterations = 20;
+    static constexpr double kTolerance = 1e-20;
+    Eigen::Vector2d normalized = distorted;
+    Eigen::Matrix2d J;
+    for (int i = 0; i < kMaxIterations; ++i) {
+      const Eigen::Vector2d error = distort(normalized, &J) - distorted;
+      if (error.squaredNorm() < kTolerance) break;
+      normalized -= J.inverse() * error;
+    }
+    return normalized;
+  }
+
+  double k1_, k2_, p1_, p2_, k3_;
+};
+
+//! Equidistant (Kannala-Brandt, OpenCV fisheye) model: k1, k2, k3, k4.
+struct EquidistantDistortion {
+  EquidistantDistortion(const double& k1,
+                        const double& k2,
+                        const double& k3,
+                        const double& k4)
+      : k1_(k1), k2_(k2), k3_(k3), k4_(k4) {}
+
+  inline Eigen::Vector2d distort(const Eigen::Vector2d& normalized,
+                                 Eigen::Matrix2d* J = nullptr) const {
+    const double r = normalized.norm();
+    if (r < kMinRadius) {
+      if (J) J->setIdentity();
+      return normalized;
+    }
+    const double theta = std::atan(r);
+    const double theta_d = distortTheta(theta);
+    const double scale = theta_d / r;
+    if (J) {
+      // d(theta_d) / dr, with d(theta) / dr = 1 / (1 + r^2).
+      const double d_theta_d = dDistortTheta(theta) / (1.0 + r * r);
+      const double d_scale = (d_theta_d * r - theta_d) / (r * r);
+      *J = scale * Eigen::Matrix2d::Identity() +
+           (d_scale / r) * normalized * normalized.transpose();
+    }
+    return scale * normalized;
+  }
+
+  //! Newton on theta_d(theta), then back to the normalized coordinates.
+  inline Eigen::Vector2d undistort(const Eigen::Vector2d& distorted) const {
+    static constexpr int kMaxIterations = 20;
+    static constexpr double kTolerance = 1e-12;
+    const double theta_d = distorted.norm();
+    if (theta_d < kMinRadius) return distorted;
+    double theta = theta_d;
+    for (int i = 0; i < kMaxIterations; ++i) {
+      const double step =
+          (distortTheta(theta) - theta_d) / dDistortTheta(theta);
+      theta -= step;
+      if (std::abs(step) < kTolerance) break;
+    }
+    return (std::tan(theta) / theta_d) * distorted;
+  }
+
+  inline double distortTheta(const double& theta) const {
+    const double theta2 = theta * theta;
+    const double theta4 = theta2 * theta2;
+    return theta * (1.0 + k1_ * theta2 + k2_ * theta4 +
+                    k3_ * theta4 * theta2 + k4_ * theta4 * theta4);
+  }
+
+  inline double dDistortTheta(const double& theta) const {
+    const double theta2 = theta * theta;
+    const double theta4 = theta2 * theta2;
+    return 1.0 + 3.0 * k1_ * theta2 + 5.0 * k2_ * theta4 +
+           7.0 * k3_ * theta4 * theta2 + 9.0 * k4_ * theta4 * theta4;
+  }
+
+  static constexpr double kMinRadius = 1e-8;
+  double k1_, k2_, k3_, k4_;
+};
+
+/**
+ * @brief The PinholeCameraModel class projects points in the camera frame to
+ * (distorted) pixels, and pixels back to rays, without going through OpenCV
+ * nor a runtime switch on the distortion model: the Distortion is a template
+ * parameter, so that the compiler inlines it in the per-keypoint loops.
+ */
+template <typename Distortion>
+class PinholeCameraModel {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  PinholeCameraModel(const double& fx,
+                     const double& fy,
+                     const double& cx,
+                     const double& cy,
+                     const Distortion& distortion = Distortion())
+      : fx_(fx), fy_(fy), cx_(cx), cy_(cy), distortion_(distortion) {}
+
+  /**
+   * @brief project Point in the camera frame (z > 0) to a pixel.
+   * @param J Optional 2x3 Jacobian of the pixel wrt the point.
+   */
+  inline Eigen::Vector2d project(
+      const Eigen::Vector3d& point,
+      Eigen::Matrix<double, 2, 3>* J = nullptr) const {
+    const double inv_z = 1.0 / point.z();
+    const Eigen::Vector2d normalized(point.x() * inv_z, point.y() * inv_z);
+    Eigen::Matrix2d J_distorted;
+    const Eigen::Vector2d distorted =
+        distortion_.distort(normalized, J ? &J_distorted : nullptr);
+    if (J) {
+      Eigen::Matrix<double, 2, 3> J_normalized;
+      J_normalized << inv_z, 0.0, -normalized.x() * inv_z,  // NOLINT
+          0.0, inv_z, -normalized.y() * inv_z;
+      *J = Eigen::Vector2d(fx_, fy_).asDiagonal() * J_distorted * J_normalized;
+    }
+    return Eigen::Vector2d(fx_ * distorted.x() + cx_,
+                           fy_ * distorted.y() + cy_);
+  }
+
+  /**
+   * @brief unproject Pixel to the normalized coordinates of its ray (z = 1):
+   * multiply by the depth to get the point in the camera frame.
+   * @param J Optional 3x2 Jacobian of the ray wrt the pixel.
+   */
+  inline Eigen::Vector3d unproject(
+      const Eigen::Vector2d& pixel,
+      Eigen::Matrix<double, 3, 2>* J = nullptr) const {
+    const Eigen::Vector2d distorted((pixel.x() - cx_) / fx_,
+                                    (pixel.y() - cy_) / fy_);
+    const Eigen::Vector2d normalized = distortion_.undistort(distorted);
+    if (J) {
+      Eigen::Matrix2d J_distorted;
+      distortion_.distort(normalized, &J_distorted);
+      J->template topRows<2>() = J_distorted.inverse() *
+                                 Eigen::Vector2d(1.0 / fx_, 1.0 / fy_)
+                                     .asDiagonal();
+      J->row(2).setZero();
+    }
+    return Eigen::Vector3d(normalized.x(), normalized.y(), 1.0);
+  }
+
+  //! Unit norm bearing vector of the pixel.
+  inline Eigen::Vector3d bearing(const Eigen::Vector2d& pixel) const {
+    return unproject(pixel).normalized();
+  }
+
+  inline const Distortion& distortion() const { return distortion_; }
+
+ private:
+  double fx_, fy_, cx_, cy_;
+  Distortion distortion_;
+};
+
+/**
+ * @brief The OmniCameraModel class implements Scaramuzza's omnidirectional
+ * model (http://rpg.ifi.uzh.ch/docs/CCMVS2007_scaramuzza.pdf), as
+ * Camera::BackProjectOmni: with m = A^-1 (pixel - center) and rho = |m|, the
+ * ray of the pixel is (m, f(rho)), f being the polynomial a0 + a1 rho + ...
+ *
+ * There is no inverse polynomial in the params, so project solves for rho
+ * with Newton instead.
+ */
+class OmniCameraModel {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  using Polynomial = Eigen::Matrix<double, 5, 1>;
+
+  OmniCameraModel(const Polynomial& polynomial,
+                  const Eigen::Vector2d& distortion_center,
+                  const Eigen::Matrix2d& affine)
+      : polynomial_(polynomial),
+        distortion_center_(distortion_center),
+        affine_(affine),
+        affine_inv_(affine.inverse()) {}
+
+  /**
+   * @brief project Point in the camera frame (z != 0) to a pixel, inverse of
+   * unproject.
+   * @param J Optional 2x3 Jacobian of the pixel wrt the point.
+   */
+  inline Eigen::Vector2d project(
+      const Eigen::Vector3d& point,
+      Eigen::Matrix<double, 2, 3>* J = nullptr) const {
+    static constexpr int kMaxIterations = 20;
+    static constexpr double kTolerance = 1e-12;
+    const double r = point.head<2>().norm();
+    if (r < kMinRadius) {
+      if (J) {
+        // Only the direction of the point is undefined: use the one of the
+        // small angle approximation f(rho) = a0.
+        const double scale = polynomial_(0) / point.z();
+        *J = affine_ * scale * Eigen::Matrix<double, 2, 3>::Identity();
+      }
+      return distortion_center_;
+    }
+    const Eigen::Vector2d direction = point.head<2>() / r;
+    // m = t * direction, with t / f(|t|) = r / z, the sign of t being the
+    // one of f (e.g. a0 < 0 for cameras looking along -z).
+    double t = r * polynomial_(0) / point.z();
+    for (int i = 0; i < kMaxIterations; ++i) {
+      const double rho = std::abs(t);
+      const double residual = t * point.z() - r * evaluate(rho);
+      const double d_residual =
+          point.z() - r * evaluateDerivative(rho) * (t < 0.0 ? -1.0 : 1.0);
+      const double step = residual / d_residual;
+      t -= step;
+      if (std::abs(step) < kTolerance) break;
+    }
+    if (J) {
+      const double rho = std::abs(t);
+      const double f = evaluate(rho);
+      const double d_residual_dt =
+          point.z() - r * evaluateDerivative(rho) * (t < 0.0 ? -1.0 : 1.0);
+      // Implicit function theorem on the residual t z - r f(|t|) = 0.
+      const Eigen::RowVector3d d_residual_dp(
+          -f * direction.x(), -f * direction.y(), t);
+      const Eigen::RowVector3d dt_dp = -d_residual_dp / d_residual_dt;
+      Eigen::Matrix<double, 2, 3> d_direction_dp;
+      d_direction_dp << direction.y() * direction.y() / r,  // NOLINT
+          -direction.x() * direction.y() / r, 0.0,
+          -direction.x() * direction.y() / r,
+          direction.x() * direction.x() / r, 0.0;
+      *J = affine_ * (direction * dt_dp + t * d_direction_dp);
+    }
+    return affine_ * (t * direction) + distortion_center_;
+  }
+
+  /**
+   * @brief unproject Pixel to the normalized coordinates of its ray (z = 1),
+   * as Camera::BackProjectOmni at unit depth.
+   * @param J Optional 3x2 Jacobian of the ray wrt the pixel.
+   */
+  inline Eigen::Vector3d unproject(
+      const Eigen::Vector2d& pixel,
+      Eigen::Matrix<double, 3, 2>* J = nullptr) const {
+    const Eigen::Vector2d m = affine_inv_ * (pixel - distortion_center_);
+    const double rho = m.norm();
+    const double f = evaluate(rho);
+    if (J) {
+      // d(m / f) / dm, with d(rho) / dm = m^T / rho.
+      Eigen::Matrix2d J_m = Eigen::Matrix2d::Identity() / f;
+      if (rho > kMinRadius) {
+        J_m -= (evaluateDerivative(rho) / (f * f * rho)) * m * m.transpose();
+      }
+      J->template topRows<2>() = J_m * affine_inv_;
+      J->row(2).setZero();
+    }
+    return Eigen::Vector3d(m.x() / f, m.y() / f, 1.0);
+  }
+
+  //! Unit norm bearing vector of the pixel.
+  inline Eigen::Vector3d bearing(const Eigen::Vector2d& pixel) const {
+    return unproject(pixel).normalized();
+  }
+
+ private:
+  //! f(rho), Horner's method.
+  inline double evaluate(const double& rho) const {
+    double f = polynomial_(4);
+    for (int i = 3; i >= 0; --i) f = polynomial_(i) + f * rho;
+    return f;
+  }
+
+  inline double evaluateDerivative(const double& rho) const {
+    double df = 4.0 * polynomial_(4);
+    for (int i = 3; i >= 1; --i) df = i * polynomial_(i) + df * rho;
+    return df;
+  }
+
+ private:
+  static constexpr double kMinRadius = 1e-8;
+  Polynomial polynomial_;
+  Eigen::Vector2d distortion_center_;
+  Eigen::Matrix2d affine_;
+  Eigen::Matrix2d affine_inv_;
+};
+
+//! Pinhole models of the distortion models supported by PinholeCameraModel.
+using PinholeCameraModelVariant =
+    std::variant<PinholeCameraModel<NoDistortion>,
+                 PinholeCameraModel<RadTanDistortion>,
+                 PinholeCameraModel<EquidistantDistortion>>;
+
+/**
+ * @brief The CameraModelFactory class selects the camera model of some
+ * CameraParams, once, so that the per-keypoint loops run on the specialized
+ * model (e.g. with std::visit around the loop, not inside it).
+ */
+class CameraModelFactory {
+ public:
+  /**
+   * @brief createPinholeCameraModel
+   * @return False if the params are not of a pinhole camera with a distortion
+   * supported by PinholeCameraModel (e.g. radtan with more than 5
+   * coefficients), in which case the callers fall back to OpenCV.
+   */
+  static bool createPinholeCameraModel(const CameraParams& cam_params,
+                                       PinholeCameraModelVariant* model);
+
+  //! Pinhole model of the intrinsics only, for undistorted images.
+  static PinholeCameraModel<NoDistortion> createUndistortedPinholeCameraModel(
+      const CameraParams& cam_params);
+
+  //! Requires the params of an omni camera.
+  static OmniCameraModel createOmniCameraModel(const CameraParams& cam_params);
+};
+
+}  // namespace VIO
@@ -70,7 +70,10 @@ class CameraParams : public PipelineParams {
         image_size_(),
         distortion_model_(),
         distortion_coeff_(),
-        distortion_coeff_mat_() {}
+        distortion_coeff_mat_(),
+        downscale_factor_(1),
+        roi_mask_(),
+        roi_bbox_() {}
   virtual ~CameraParams() = default;
 
   /**
@@ -87,6 +90,40 @@ class CameraParams : public PipelineParams {
   //! Assert equality up to a tolerance.
   bool equals(const CameraParams& cam_par, const double& tol = 1e-9) const;
 
+  /**
+   * @brief downscale Adapts the parameters to images downscaled by the given
+   * factor with an area filter (cv::INTER_AREA): scales the image size, the
+   * intrinsics (keeping pixel centers aligned) and the depth camera matrix.
+   * @param factor Integer factor, 2 for half resolution. Can only be applied
+   * once.
+   */
+  void downscale(const int& factor);
+
+  //! Pixel of the downscaled image in the pixel units of the original image.
+  KeypointCV toOriginalPixels(const KeypointCV& px) const;
+
+  /**
+   * @brief setRoiMask Sets the static region of interest of the camera.
+   * @param roi_mask CV_8UC1 of the image size, non-zero where features can
+   * be found. Empty to use the whole image.
+   */
+  void setRoiMask(const cv::Mat& roi_mask);
+
+  inline bool hasRoiMask() const { return !roi_mask_.empty(); }
+
+  //! Whether the pixel of the (distorted) image is inside the image and the
+  //! region of interest.
+  inline bool isInRoi(const KeypointCV& px) const {
+    const int u = cvRound(px.x);
+    const int v = cvRound(px.y);
+    if (roi_mask_.empty()) {
+      return u >= 0 && v >= 0 && u < image_size_.width &&
+             v < image_size_.height;
+    }
+    return u >= 0 && v >= 0 && u < roi_mask_.cols && v < roi_mask_.rows &&
+           roi_mask_.at<uchar>(v, u) != 0u;
+  }
+
  protected:
   bool equals(const PipelineParams& rhs) const override {
     return equals(static_cast<const CameraParams&>(rhs), 1e-9);
@@ -117,6 +154,17 @@ class CameraParams : public PipelineParams {
   std::vector<double> distortion_coeff_;
   cv::Mat distortion_coeff_mat_;
 
+  //! Factor by which the images are downscaled at ingestion (1 for none),
+  //! the rest of the parameters are given for the downscaled images.
+  int downscale_factor_;
+
+  //! Static region of interest of the (distorted) image, 255 where features
+  //! can be found and 0 elsewhere (e.g. on the robot's body or the sky), or
+  //! empty for the whole image. Its bounding box bounds the image processing.
+  //! Set with setRoiMask.
+  cv::Mat roi_mask_;
+  cv::Rect roi_bbox_;
+
   //! Omnicam only parameters
   Eigen::Vector2d omni_distortion_center_;
   Eigen::Matrix2d omni_affine_;      // matrix A in Scaramuzza's paper
@@ -147,6 +195,15 @@ class CameraParams : public PipelineParams {
     //! Whether or not the image is registered
     bool is_registered_ = true;
 
+    //! Level of the depth pyramid used to look up keypoint depths (0 is full
+    //! resolution, each level halves it with a 2x2 median of valid depths).
+    int pyramid_level_ = 0;
+
+    //! Keypoint depths whose 3x3 neighbourhood (at the pyramid level) spans
+    //! more than this (in meters) lie on a depth edge and are invalid.
+    //! Non-positive to disable the check.
+    float max_depth_discontinuity_ = 0.0f;
+
     //! Camera matrix for the depth image
     cv::Mat K_;
 
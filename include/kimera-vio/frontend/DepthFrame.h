@@ -14,6 +14,9 @@
 
 #pragma once
 
+#include <cstdint>
+#include <vector>
+
 #include "kimera-vio/pipeline/PipelinePayload.h"
 
 namespace VIO {
@@ -42,6 +45,31 @@ class DepthFrame : public PipelinePayload {
   float getDepthAtPoint(const CameraParams& params,
                         const KeypointCV& point) const;
 
+  /**
+   * @brief Get depths (in meters) at a batch of image points, looked up at
+   * params.depth.pyramid_level_ of the depth pyramid, and rejected if their
+   * neighbourhood has a depth discontinuity larger than
+   * params.depth.max_depth_discontinuity_.
+   * @param[in] params Camera params for RGBD camera
+   * @param[in] points Image points (full resolution) to extract depth for
+   * @param[out] depths Depth in meters (NaN if not valid) of each point
+   */
+  void getDepthsAtPoints(const CameraParams& params,
+                         const KeypointsCV& points,
+                         std::vector<float>* depths) const;
+
+  /**
+   * @brief Get the depth pyramid, with depths in meters (CV_32FC1), built
+   * lazily up to the given level. Level 0 is the full resolution depth, each
+   * next level halves it taking the median of the valid depths of each 2x2
+   * block (so that holes and depth edges do not bleed into valid depths).
+   * Depths below params.depth.min_depth_ are invalid.
+   * @param[in] params Camera params for RGBD camera
+   * @param[in] level Coarsest level needed
+   */
+  const std::vector<cv::Mat>& getDepthPyramid(const CameraParams& params,
+                                              const int& level) const;
+
   /**
    * @brief Get cv::Mat mask for invalid feature extraction regions
    * @param[in] params Camera params for RGBD camera
@@ -59,11 +87,33 @@ class DepthFrame : public PipelinePayload {
    */
   void registerDepth(const CameraParams& params) const;
 
+  /**
+   * @brief Append the frame (id, timestamp and unregistered depth) to bytes,
+   * with its depth compressed by the DepthCodec, e.g. to cache or log it.
+   * @param[out] bytes Buffer to which the frame is appended
+   * @param[in] float_step Quantization step of CV_32FC1 depths (in the units
+   * of the depth image): they decode with an error of at most half of it.
+   * CV_16UC1 depths are compressed losslessly.
+   */
+  void encode(std::vector<std::uint8_t>* bytes,
+              const float& float_step = 1e-3f) const;
+
+  /**
+   * @brief Decode a frame encoded with encode
+   * @param[in] bytes Buffer with the encoded frame at offset
+   * @param[in,out] offset Offset of the frame in bytes, moved past it
+   * @returns the frame, or nullptr if bytes does not hold a valid frame
+   */
+  static UniquePtr decode(const std::vector<std::uint8_t>& bytes,
+                          size_t* offset);
+
  public:
   const FrameId id_;
   const cv::Mat depth_img_;
   mutable bool is_registered_;
   mutable cv::Mat registered_img_;
+  //! Depth pyramid (in meters), empty until requested.
+  mutable std::vector<cv::Mat> depth_pyramid_;
 };
 
 }  // namespace VIO
@@ -0,0 +1,103 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   EpipolarStripeMatcher.h
+ * @brief  Dedicated SSD/NCC kernel to search a template along a horizontal
+ * stripe of a rectified image (replacement of cv::matchTemplate for sparse
+ * stereo matching).
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "kimera-vio/frontend/StereoMatchingParams.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The EpipolarStripeMatcher class slides a template (taken from the
+ * left rectified image) over a stripe of the right rectified image and finds
+ * the best match. It works in place on the images (no crops nor temporary
+ * cv::Mat allocations): the only memory used is a scratch buffer owned by
+ * the matcher, which is reused across keypoints. Hence, one matcher should be
+ * used to process the whole batch of keypoints of a stereo frame.
+ *
+ * Inner loops use AVX2 (x86) or NEON (ARM) when the compiler targets them,
+ * and fall back to scalar code otherwise.
+ *
+ * NOTE: only 8-bit single-channel images are supported.
+ */
+class EpipolarStripeMatcher {
+ public:
+  KIMERA_POINTER_TYPEDEFS(EpipolarStripeMatcher);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(EpipolarStripeMatcher);
+
+  explicit EpipolarStripeMatcher(const StereoMatchingKernelType& kernel_type);
+  ~EpipolarStripeMatcher() = default;
+
+ public:
+  /**
+   * @brief match Finds the template inside the stripe.
+   * @param[in] left_img Left rectified image (CV_8UC1).
+   * @param[in] templ_rect Template, in left image coordinates.
+   * @param[in] right_img Right rectified image (CV_8UC1).
+   * @param[in] stripe_rect Stripe, in right image coordinates. Must be at
+   * least as large as the template.
+   * @param[out] best_loc Location of the upper-left corner of the best match,
+   * relative to the stripe (same convention as cv::matchTemplate + minMaxLoc).
+   * @param[out] score Matching score in [0, 1]: the lower the better.
+   * For kSsd the score is min-max normalized over the stripe (same as the
+   * cv::matchTemplate path), for kNcc it is (1 - ZNCC) / 2.
+   */
+  void match(const cv::Mat& left_img,
+             const cv::Rect& templ_rect,
+             const cv::Mat& right_img,
+             const cv::Rect& stripe_rect,
+             cv::Point* best_loc,
+             double* score);
+
+  inline StereoMatchingKernelType getKernelType() const { return kernel_type_; }
+
+ public:
+  //! Sum of squared differences of two 8-bit arrays of length n.
+  static uint32_t ssdRow(const uint8_t* a, const uint8_t* b, const int& n);
+
+  //! Dot product of two 8-bit arrays of length n.
+  static uint32_t dotRow(const uint8_t* a, const uint8_t* b, const int& n);
+
+ private:
+  void matchSsd(const cv::Mat& left_img,
+                const cv::Rect& templ_rect,
+                const cv::Mat& right_img,
+                const cv::Rect& stripe_rect,
+                cv::Point* best_loc,
+                double* score);
+
+  void matchNcc(const cv::Mat& left_img,
+                const cv::Rect& templ_rect,
+                const cv::Mat& right_img,
+                const cv::Rect& stripe_rect,
+                cv::Point* best_loc,
+                double* score);
+
+ private:
+  const StereoMatchingKernelType kernel_type_;
+
+  //! Scratch buffers reused across calls to avoid per-keypoint allocations.
+  std::vector<uint32_t> col_sums_;
+  std::vector<uint32_t> col_sq_sums_;
+};
+
+}  // namespace VIO
@@ -0,0 +1,89 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   FeatureBudgetController.h
+ * @brief  Adapts the number of features, the KLT pyramid levels and the
+ * RANSAC iterations per keyframe to the measured latency, to meet a target.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+struct FeatureBudgetControllerParams {
+  //! Target latency of a keyframe (frontend, and backend if measured).
+  double target_latency_ms = 40.0;
+  //! Grow the budget when the filtered latency is below this ratio of the
+  //! target latency.
+  double slack_ratio = 0.6;
+  //! Weight of the latest measurement in the filtered latency.
+  double time_filter_weight = 0.2;
+  //! Quality floors and steps of each knob (the ceilings are the configured
+  //! values).
+  int min_features_per_frame = 100;
+  int features_step = 25;
+  int min_klt_max_level = 1;
+  int min_ransac_max_iterations = 30;
+  int ransac_iterations_step = 20;
+  //! Keyframes to wait after a decision, to measure its effect.
+  size_t cooldown_keyframes = 3u;
+};
+
+/**
+ * @brief The FeatureBudgetController class decides, after each keyframe, the
+ * budget of the frontend for the next ones. Under load, it first detects
+ * fewer features, then uses fewer KLT pyramid levels, then fewer RANSAC
+ * iterations; with slack, it restores them in the reverse order.
+ */
+class FeatureBudgetController {
+ public:
+  KIMERA_POINTER_TYPEDEFS(FeatureBudgetController);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(FeatureBudgetController);
+
+  //! The given values are the ceilings of the knobs, and the initial budget.
+  FeatureBudgetController(const FeatureBudgetControllerParams& params,
+                          const int& max_features_per_frame,
+                          const int& klt_max_level,
+                          const int& ransac_max_iterations);
+  ~FeatureBudgetController() = default;
+
+  //! Feeds the latency of the last keyframe.
+  //! @return True if the budget changed.
+  bool update(const double& latency_ms);
+
+  inline int getMaxFeaturesPerFrame() const { return max_features_per_frame_; }
+  inline int getKltMaxLevel() const { return klt_max_level_; }
+  inline int getRansacMaxIterations() const { return ransac_max_iterations_; }
+  inline double getFilteredLatencyMs() const { return filtered_latency_ms_; }
+
+ private:
+  //! Reduces the budget one step. @return False if already at the floors.
+  bool shrink();
+  //! Grows the budget one step. @return False if already at the ceilings.
+  bool grow();
+
+ private:
+  const FeatureBudgetControllerParams params_;
+  const int max_max_features_per_frame_;
+  const int max_klt_max_level_;
+  const int max_ransac_max_iterations_;
+  int max_features_per_frame_;
+  int klt_max_level_;
+  int ransac_max_iterations_;
+  double filtered_latency_ms_;
+  size_t nr_measurements_;
+  size_t keyframes_since_decision_;
+};
+
+}  // namespace VIO
@@ -0,0 +1,121 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   FixedWindowKlt.h
+ * @brief  Pyramidal KLT with kernels specialized at compile time for a few
+ * window sizes.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The KltPyramid struct holds the image pyramid of a frame for the
+ * FixedWindowKlt. Each level is padded with a reflected border, so that
+ * windows overlapping the image edges are sampled without bound checks, and
+ * its Scharr derivatives are only computed for the frames tracked from.
+ */
+struct KltPyramid {
+  //! Padded levels (CV_8UC1), the full resolution image first.
+  std::vector<cv::Mat> levels;
+  //! Scharr derivatives (CV_16SC1) of the padded levels, empty until
+  //! computed.
+  std::vector<cv::Mat> grad_x;
+  std::vector<cv::Mat> grad_y;
+  //! Width of the border padding each level [px].
+  int border = 0;
+  //! Window size and max level the pyramid was built for.
+  int win_size = 0;
+  int max_level = -1;
+
+  inline bool empty() const { return levels.empty(); }
+  inline bool hasGradients() const { return !grad_x.empty(); }
+  //! Number of levels above the full resolution one.
+  inline int getMaxLevel() const { return static_cast<int>(levels.size()) - 1; }
+  void clear();
+};
+
+/**
+ * @brief The FixedWindowKlt class is a drop-in replacement for
+ * cv::calcOpticalFlowPyrLK with cv::OPTFLOW_USE_INITIAL_FLOW, following the
+ * same (fixed-point) algorithm. Its inner loops are compiled for each of the
+ * supported window sizes (see isSupported), so that they are fully unrolled
+ * and vectorized, and the Scharr derivatives of the reference frame are
+ * computed once per pyramid level (instead of per window and tracking call).
+ */
+class FixedWindowKlt {
+ public:
+  KIMERA_POINTER_TYPEDEFS(FixedWindowKlt);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(FixedWindowKlt);
+
+  //! The window size must be supported.
+  explicit FixedWindowKlt(const int& win_size);
+  virtual ~FixedWindowKlt() = default;
+
+  //! Whether a kernel is compiled for the given window size.
+  static bool isSupported(const int& win_size);
+
+  /**
+   * @brief buildPyramid Builds the padded pyramid of the image, with as many
+   * levels as cv::buildOpticalFlowPyramid would for the same window size.
+   * The derivatives are not computed, see computeGradients.
+   */
+  static void buildPyramid(const cv::Mat& img,
+                           const int& win_size,
+                           const int& max_level,
+                           KltPyramid* pyramid);
+
+  //! Computes the Scharr derivatives of all the levels, if not done already.
+  static void computeGradients(KltPyramid* pyramid);
+
+  /**
+   * @brief track Tracks the keypoints from the reference to the current
+   * pyramid. Same as cv::calcOpticalFlowPyrLK with
+   * cv::OPTFLOW_USE_INITIAL_FLOW: px_cur holds the predicted keypoints on
+   * input, and the tracked ones on output.
+   * @param ref_pyramid Pyramid of the reference frame, with its gradients.
+   * @param max_level Max pyramid level used, at most that of the pyramids.
+   */
+  void track(const KltPyramid& ref_pyramid,
+             const KltPyramid& cur_pyramid,
+             const int& max_level,
+             const cv::TermCriteria& criteria,
+             const KeypointsCV& px_ref,
+             KeypointsCV* px_cur,
+             std::vector<uchar>* status) const;
+
+  inline int getWinSize() const { return win_size_; }
+
+ private:
+  using TrackPointFunction = bool (*)(const KltPyramid& ref_pyramid,
+                                      const KltPyramid& cur_pyramid,
+                                      const int& max_level,
+                                      const int& max_iter,
+                                      const float& eps_sq,
+                                      const KeypointCV& px_ref,
+                                      KeypointCV* px_cur);
+
+  //! Kernel instantiated for the window size, or nullptr if there is none.
+  static TrackPointFunction selectKernel(const int& win_size);
+
+ private:
+  const int win_size_;
+  TrackPointFunction track_point_;
+};
+
+}  // namespace VIO
@@ -28,11 +28,13 @@
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/opencv.hpp>
+#include <opencv2/video/tracking.hpp>
 
 #include <gtsam/base/Matrix.h>
 #include <gtsam/geometry/PinholeCamera.h>
 
 #include "kimera-vio/frontend/CameraParams.h"
+#include "kimera-vio/frontend/FixedWindowKlt.h"
 #include "kimera-vio/pipeline/PipelinePayload.h"
 #include "kimera-vio/utils/UtilsOpenCV.h"
 
@@ -69,6 +71,9 @@ class Frame : public PipelinePayload {
 
   // TODO(TONI): delete all copy constructors!!
   // Look at the waste of time this is :O
+  // NOTE: the optical flow pyramid is intentionally not copied: copies of a
+  // frame are sent downstream (e.g. in the frontend output) and should not
+  // keep the pyramid alive once the frame leaves the tracker.
   Frame(const Frame& frame)
       : PipelinePayload(frame.timestamp_),
         id_(frame.id_),
@@ -150,6 +155,67 @@ class Frame : public PipelinePayload {
     cam_param_.print();
   }
 
+  /* ------------------------------------------------------------------------ */
+  /**
+   * @brief getOpticalFlowPyramid Returns the image pyramid used for KLT
+   * tracking, building it lazily (using cv::buildOpticalFlowPyramid) the first
+   * time it is requested. The pyramid is cached so that it is built only once
+   * per frame, even if the frame is used both as current and reference frame.
+   * If the pyramid was built with a different window size or number of levels,
+   * it is rebuilt.
+   * @param win_size Window size of the KLT tracker.
+   * @param max_level Max pyramid level (0-based) requested.
+   * @param nr_levels [out] Optional: number of levels actually built.
+   * @return The cached pyramid, ready to be passed to cv::calcOpticalFlowPyrLK.
+   */
+  const std::vector<cv::Mat>& getOpticalFlowPyramid(
+      const cv::Size& win_size,
+      const int& max_level,
+      int* nr_levels = nullptr) const {
+    if (optical_flow_pyramid_.empty() ||
+        optical_flow_pyramid_win_size_ != win_size ||
+        optical_flow_pyramid_requested_level_ != max_level) {
+      CHECK(!img_.empty()) << "Cannot build pyramid for frame without image.";
+      optical_flow_pyramid_.clear();
+      optical_flow_pyramid_max_level_ = cv::buildOpticalFlowPyramid(
+          img_, optical_flow_pyramid_, win_size, max_level);
+      optical_flow_pyramid_win_size_ = win_size;
+      optical_flow_pyramid_requested_level_ = max_level;
+    }
+    if (nr_levels) *nr_levels = optical_flow_pyramid_max_level_;
+    return optical_flow_pyramid_;
+  }
+
+  /**
+   * @brief getKltPyramid Same as getOpticalFlowPyramid, for the
+   * FixedWindowKlt: the padded pyramid is built lazily and cached, and so are
+   * its Scharr derivatives, the first time they are requested (i.e. when the
+   * frame is tracked from).
+   */
+  const KltPyramid& getKltPyramid(const int& win_size,
+                                  const int& max_level,
+                                  const bool& with_gradients) const {
+    if (klt_pyramid_.empty() || klt_pyramid_.win_size != win_size ||
+        klt_pyramid_.max_level != max_level) {
+      CHECK(!img_.empty()) << "Cannot build pyramid for frame without image.";
+      FixedWindowKlt::buildPyramid(img_, win_size, max_level, &klt_pyramid_);
+    }
+    if (with_gradients) FixedWindowKlt::computeGradients(&klt_pyramid_);
+    return klt_pyramid_;
+  }
+
+  //! Frees the cached optical flow pyramids (if any).
+  inline void releaseOpticalFlowPyramid() const {
+    optical_flow_pyramid_.clear();
+    optical_flow_pyramid_max_level_ = 0;
+    optical_flow_pyramid_requested_level_ = -1;
+    klt_pyramid_.clear();
+  }
+
+  inline bool hasOpticalFlowPyramid() const {
+    return !optical_flow_pyramid_.empty() || !klt_pyramid_.empty();
+  }
+
   // get a much smaller (and faster) copy of a frame for frame-to-frame RANSAC
   Frame::UniquePtr getRansacFrame() const {
     return Frame::UniquePtr(new Frame(
@@ -166,6 +232,9 @@ class Frame : public PipelinePayload {
   // Actual image stored by the class frame.
   // This must be const otw, we have to reimplement the copy ctor to allow
   // for deep copies.
+  // Its buffer is shared (reference counted) by the copies of the frame and
+  // all the modules it is sent to: never write to it, draw on a copy (see
+  // UtilsOpenCV::CopyForDrawing).
   const cv::Mat img_;
 
   // Results of image processing.
@@ -185,6 +254,16 @@ class Frame : public PipelinePayload {
   //! Optional mask for feature detection. Note that can change when the frame is const
   mutable cv::Mat detection_mask_;
 
+ private:
+  //! Lazily built image pyramid for KLT (see getOpticalFlowPyramid).
+  //! Mutable since it is a cache that does not change the frame's state.
+  mutable std::vector<cv::Mat> optical_flow_pyramid_;
+  mutable cv::Size optical_flow_pyramid_win_size_;
+  mutable int optical_flow_pyramid_requested_level_ = -1;
+  mutable int optical_flow_pyramid_max_level_ = 0;
+  //! Lazily built pyramid for the FixedWindowKlt (see getKltPyramid).
+  mutable KltPyramid klt_pyramid_;
+
  protected:
   Frame(const FrameId& id,
         const Timestamp& timestamp,
@@ -21,6 +21,7 @@
 #include "kimera-vio/pipeline/PipelinePayload.h"
 
 #include <optional>
+#include <utility>
 
 namespace VIO {
 
@@ -47,8 +48,36 @@ class FrontendInputPacketBase : public PipelinePayload {
 
   virtual ~FrontendInputPacketBase() = default;
 
-  const ImuStampS imu_stamps_;
-  const ImuAccGyrS imu_accgyrs_;
+  /**
+   * @brief prependImuMeasurements Merges the IMU measurements of a previous
+   * packet that is dropped in front of this packet's ones, so that the IMU
+   * preintegration stays continuous. Measurements that are not older than
+   * the last one of the previous packet (typically the interpolated
+   * measurement at the previous frame's timestamp) are not duplicated.
+   */
+  void prependImuMeasurements(const FrontendInputPacketBase& previous) {
+    CHECK_LT(previous.timestamp_, timestamp_);
+    const int nr_previous = previous.imu_stamps_.cols();
+    const ImuStamp& last_previous_stamp = previous.imu_stamps_(nr_previous - 1);
+    int first_new = 0;
+    while (first_new < imu_stamps_.cols() &&
+           imu_stamps_(first_new) <= last_previous_stamp) {
+      ++first_new;
+    }
+    const int nr_new = imu_stamps_.cols() - first_new;
+    ImuStampS imu_stamps(nr_previous + nr_new);
+    ImuAccGyrS imu_accgyrs(6, nr_previous + nr_new);
+    imu_stamps.leftCols(nr_previous) = previous.imu_stamps_;
+    imu_stamps.rightCols(nr_new) = imu_stamps_.rightCols(nr_new);
+    imu_accgyrs.leftCols(nr_previous) = previous.imu_accgyrs_;
+    imu_accgyrs.rightCols(nr_new) = imu_accgyrs_.rightCols(nr_new);
+    imu_stamps_ = std::move(imu_stamps);
+    imu_accgyrs_ = std::move(imu_accgyrs);
+  }
+
+  //! Not const so that the measurements of dropped packets can be merged.
+  ImuStampS imu_stamps_;
+  ImuAccGyrS imu_accgyrs_;
   std::optional<gtsam::NavState> world_NavState_ext_odom_;
 };
 
@@ -0,0 +1,60 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   GpuDenseStereoMatcher.h
+ * @brief  Dense stereo matching on the GPU (OpenCV CUDA semi-global matching).
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <memory>
+
+#include <opencv2/core.hpp>
+
+#include "kimera-vio/frontend/StereoMatchingParams.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The GpuDenseStereoMatcher class runs cv::cuda::StereoSGM with the
+ * dense stereo params. The matcher and the device buffers are created once
+ * and reused across stereo pairs of the same size.
+ * Only available if Kimera-VIO is built with OpenCV's cudastereo module and a
+ * CUDA device is present: check isAvailable() before constructing one.
+ */
+class GpuDenseStereoMatcher {
+ public:
+  KIMERA_POINTER_TYPEDEFS(GpuDenseStereoMatcher);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(GpuDenseStereoMatcher);
+
+  /**
+   * @param num_disparities Must be 64, 128 or 256 (cv::cuda::StereoSGM).
+   */
+  GpuDenseStereoMatcher(const DenseStereoParams& params,
+                        const int& min_disparity,
+                        const int& num_disparities);
+  ~GpuDenseStereoMatcher();
+
+  static bool isAvailable();
+
+  //! Same output as cv::StereoSGBM::compute (CV_16S disparities with 4
+  //! fractional bits), for CV_8UC1 rectified images.
+  void compute(const cv::Mat& left_img_rectified,
+               const cv::Mat& right_img_rectified,
+               cv::Mat* disparity_img);
+
+ private:
+  //! CUDA objects, not exposed to avoid depending on the CUDA headers.
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace VIO
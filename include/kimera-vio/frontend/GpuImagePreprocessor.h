@@ -0,0 +1,102 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   GpuImagePreprocessor.h
+ * @brief  Preprocesses the stereo images on the GPU, uploading them once:
+ * rectification, feature candidates and optionally dense stereo.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/frontend/StereoCamera.h"
+#include "kimera-vio/frontend/StereoFrame.h"
+#include "kimera-vio/frontend/StereoMatchingParams.h"
+#include "kimera-vio/frontend/feature-detector/FeatureDetectorParams.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+//! Host-side results of the GpuImagePreprocessor for a stereo frame.
+struct GpuPreprocessedStereo {
+  cv::Mat left_img_rectified;
+  cv::Mat right_img_rectified;
+  //! Raw detections in the left (non-rectified) image, to be filtered by
+  //! FeatureDetector::featureDetection. Empty if not detected on the device.
+  std::vector<cv::KeyPoint> candidates;
+  bool has_candidates = false;
+  //! CV_16S disparities with 4 fractional bits, if dense stereo is enabled.
+  cv::Mat disparity_img;
+};
+
+/**
+ * @brief The GpuImagePreprocessor class runs the per-image work of the stereo
+ * frontend on the GPU: each stereo pair is uploaded once, then rectified
+ * (cv::cuda::remap), the left image is scored for feature candidates (FAST or
+ * GFTT, as the FeatureDetector params ask) and optionally the rectified pair
+ * goes through semi-global matching. Nothing is downloaded until the frontend
+ * retrieves the frame, which it only does for keyframes.
+ * Two frames are in flight at most, each on its own stream, so that the upload
+ * of a frame overlaps the processing of the previous one.
+ * Only available if Kimera-VIO is built with OpenCV's cudawarping and
+ * cudaimgproc modules and a CUDA device is present: check isAvailable()
+ * before constructing one.
+ */
+class GpuImagePreprocessor {
+ public:
+  KIMERA_POINTER_TYPEDEFS(GpuImagePreprocessor);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(GpuImagePreprocessor);
+
+  /**
+   * @param dense_stereo_params If given, also computes the disparities of the
+   * rectified images (needs OpenCV's cudastereo).
+   */
+  GpuImagePreprocessor(
+      const StereoCamera& stereo_camera,
+      const FeatureDetectorParams& feature_detector_params,
+      const DenseStereoParams* dense_stereo_params = nullptr);
+  ~GpuImagePreprocessor();
+
+  static bool isAvailable();
+
+  //! False if the feature detector (e.g. ORB, or grid detection) runs on the
+  //! CPU only: the candidates are then not computed.
+  bool detectsCandidates() const;
+
+  /**
+   * @brief enqueue Starts preprocessing the stereo frame on the device and
+   * returns right away. Reuses the buffers of the frame enqueued two frames
+   * ago, which is dropped if it was not retrieved.
+   * @param defer_right_image Only process the left image now, and the right
+   * one (with the disparities) once the frame is retrieved: frames that are
+   * never retrieved then cost a single image.
+   */
+  void enqueue(const StereoFrame& stereo_frame,
+               const bool& defer_right_image = false);
+
+  /**
+   * @brief retrieve Waits for the preprocessing of the frame and downloads
+   * its results.
+   * @return False if the frame is not (anymore) in flight.
+   */
+  bool retrieve(const FrameId& frame_id, GpuPreprocessedStereo* output);
+
+ private:
+  //! CUDA objects, not exposed to avoid depending on the CUDA headers.
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace VIO
@@ -0,0 +1,76 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   GpuSparseOpticalFlow.h
+ * @brief  Sparse pyramidal KLT on the GPU (OpenCV CUDA optical flow).
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The GpuSparseOpticalFlow class runs cv::cuda::SparsePyrLKOpticalFlow
+ * for the Tracker. The images of the last two frames stay on the device: each
+ * image is uploaded once, when its frame arrives, and is reused when the frame
+ * becomes the reference one. Only the keypoints and their status are
+ * transferred at each tracking call.
+ * Only available if Kimera-VIO is built with OpenCV's cudaoptflow module and a
+ * CUDA device is present: check isAvailable() before constructing one.
+ */
+class GpuSparseOpticalFlow {
+ public:
+  KIMERA_POINTER_TYPEDEFS(GpuSparseOpticalFlow);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(GpuSparseOpticalFlow);
+
+  GpuSparseOpticalFlow();
+  ~GpuSparseOpticalFlow();
+
+  static bool isAvailable();
+
+  /**
+   * @brief uploadAsync Starts the upload of the image of the frame with the
+   * given timestamp, unless it is already on the device. Returns right away:
+   * the CPU can keep working (e.g. on the IMU preintegration) meanwhile.
+   */
+  void uploadAsync(const Timestamp& timestamp, const cv::Mat& img);
+
+  /**
+   * @brief track Same as cv::calcOpticalFlowPyrLK with
+   * cv::OPTFLOW_USE_INITIAL_FLOW: px_cur holds the predicted keypoints on
+   * input, and the tracked ones on output.
+   * NOTE: the CUDA KLT only stops on the nr of iterations, not on an epsilon.
+   */
+  void track(const Timestamp& ref_timestamp,
+             const cv::Mat& ref_img,
+             const Timestamp& cur_timestamp,
+             const cv::Mat& cur_img,
+             const cv::Size& win_size,
+             const int& max_level,
+             const int& max_iter,
+             const KeypointsCV& px_ref,
+             KeypointsCV* px_cur,
+             std::vector<uchar>* status);
+
+ private:
+  //! CUDA objects, not exposed to avoid depending on the CUDA headers.
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace VIO
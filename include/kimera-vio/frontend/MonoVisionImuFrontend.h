@@ -23,6 +23,7 @@
 #include "kimera-vio/frontend/MonoVisionImuFrontend-definitions.h"
 #include "kimera-vio/frontend/VisionImuFrontend.h"
 #include "kimera-vio/frontend/feature-detector/FeatureDetector.h"
+#include "kimera-vio/frontend/feature-detector/SpeculativeFeatureDetector.h"
 #include "kimera-vio/pipeline/PipelineModule.h"
 #include "kimera-vio/utils/Statistics.h"
 #include "kimera-vio/utils/ThreadsafeQueue.h"
@@ -50,6 +51,11 @@ class MonoVisionImuFrontend : public VisionImuFrontend {
 
   virtual ~MonoVisionImuFrontend();
 
+  //! Measurements of the valid landmarks of the keyframe (NaN right pixel).
+  static void getSmartMonoMeasurements(
+      const Frame::Ptr& frame,
+      MonoMeasurements* smart_mono_measurements);
+
  private:
   void processFirstFrame(const Frame& firstFrame);
 
@@ -81,9 +87,6 @@ class MonoVisionImuFrontend : public VisionImuFrontend {
       const gtsam::Rot3& keyframe_R_ref_frame,
       cv::Mat* feature_tracks = nullptr);
 
-  void getSmartMonoMeasurements(const Frame::Ptr& frame,
-                                MonoMeasurements* smart_mono_measurements);
-
   void sendFeatureTracksToLogger() const;
 
   void sendMonoTrackingToLogger() const;
@@ -102,6 +105,8 @@ class MonoVisionImuFrontend : public VisionImuFrontend {
   gtsam::Rot3 keyframe_R_ref_frame_;
 
   FeatureDetector::UniquePtr feature_detector_;
+  //! Detects in the frames in between keyframes, if enabled (nullptr if not).
+  SpeculativeFeatureDetector::UniquePtr speculative_feature_detector_;
 
   Camera::ConstPtr mono_camera_;
 };
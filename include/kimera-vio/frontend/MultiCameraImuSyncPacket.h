@@ -0,0 +1,57 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   MultiCameraImuSyncPacket.h
+ * @brief  Class describing the minimum input for VIO to run
+ * Contains one Frame per camera of a multi-camera rig, all with the same
+ * timestamp, with Imu data synchronized from last Keyframe timestamp to the
+ * current frame timestamp.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <optional>
+#include <vector>
+
+#include "kimera-vio/frontend/Frame.h"
+#include "kimera-vio/frontend/FrontendInputPacketBase.h"
+
+namespace VIO {
+
+class MultiCameraImuSyncPacket : public FrontendInputPacketBase {
+ public:
+  KIMERA_POINTER_TYPEDEFS(MultiCameraImuSyncPacket);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(MultiCameraImuSyncPacket);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  MultiCameraImuSyncPacket() = delete;
+  /**
+   * @param frames One frame per camera, in the order of the camera params.
+   * The first one is the frame of the reference camera.
+   */
+  MultiCameraImuSyncPacket(
+      std::vector<Frame::UniquePtr> frames,
+      const ImuStampS& imu_stamps,
+      const ImuAccGyrS& imu_accgyrs,
+      std::optional<gtsam::NavState> external_odometry = std::nullopt);
+
+  virtual ~MultiCameraImuSyncPacket() = default;
+
+  inline size_t getNrCameras() const { return frames_.size(); }
+  inline const Frame& getFrame(const size_t& cam_idx) const {
+    return *frames_.at(cam_idx);
+  }
+  inline const ImuStampS& getImuStamps() const { return imu_stamps_; }
+  inline const ImuAccGyrS& getImuAccGyrs() const { return imu_accgyrs_; }
+  void print() const;
+
+  std::vector<Frame::UniquePtr> frames_;
+};
+
+}  // namespace VIO
@@ -0,0 +1,111 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   MultiCameraVisionImuFrontend-definitions.h
+ * @brief  Definitions for MultiCameraVisionImuFrontend
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "kimera-vio/backend/VioBackend-definitions.h"
+#include "kimera-vio/frontend/FrontendOutputPacketBase.h"
+#include "kimera-vio/frontend/MultiCameraImuSyncPacket.h"
+#include "kimera-vio/frontend/VisionImuFrontend-definitions.h"
+
+namespace VIO {
+
+using MultiCameraFrontendInputPayload = MultiCameraImuSyncPacket;
+
+/**
+ * @brief The MultiCameraFrontendOutput struct: like MonoFrontendOutput, but
+ * with the measurements, extrinsics and last (key)frame of each camera.
+ * The first camera is the reference one, which is returned by the getters
+ * of FrontendOutputPacketBase.
+ */
+struct MultiCameraFrontendOutput : public FrontendOutputPacketBase {
+ public:
+  KIMERA_POINTER_TYPEDEFS(MultiCameraFrontendOutput);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(MultiCameraFrontendOutput);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  MultiCameraFrontendOutput(
+      const bool& is_keyframe,
+      const MultiCameraMeasurements& camera_measurements,
+      const std::vector<Frame>& frames_lkf,
+      const ImuFrontend::PimPtr& pim,
+      const ImuAccGyrS& imu_acc_gyrs,
+      const cv::Mat& feature_tracks,
+      const DebugTrackerInfo& debug_tracker_info,
+      std::optional<gtsam::Pose3> lkf_body_Pose_kf_body = std::nullopt,
+      std::optional<gtsam::Velocity3> body_world_Vel_body = std::nullopt)
+      : FrontendOutputPacketBase(frames_lkf.at(0u).timestamp_,
+                                 is_keyframe,
+                                 FrontendType::kMultiCameraImu,
+                                 pim,
+                                 imu_acc_gyrs,
+                                 debug_tracker_info,
+                                 lkf_body_Pose_kf_body,
+                                 body_world_Vel_body),
+        camera_measurements_(camera_measurements),
+        frames_lkf_(frames_lkf),
+        feature_tracks_(feature_tracks) {
+    CHECK_EQ(camera_measurements_.size(), frames_lkf_.size());
+  }
+
+  virtual ~MultiCameraFrontendOutput() = default;
+
+  virtual const Frame* getTrackingFrame() const override {
+    return &frames_lkf_.at(0u);
+  }
+
+  virtual const cv::Mat* getTrackingImage() const override {
+    return &feature_tracks_;
+  }
+
+  virtual const gtsam::Pose3* getBodyPoseCam() const override {
+    return &camera_measurements_.at(0u).body_Pose_cam_;
+  }
+
+  virtual const TrackerStatusSummary* getTrackerStatus() const override {
+    const StatusStereoMeasurementsPtr& status_measurements =
+        camera_measurements_.at(0u).status_measurements_;
+    return status_measurements ? &(status_measurements->first) : nullptr;
+  }
+
+  inline size_t getNrCameras() const { return frames_lkf_.size(); }
+
+  //! The backend input of this keyframe: the backends only use the
+  //! measurements of the reference camera, the others are forwarded in
+  //! BackendInput::multi_camera_measurements_.
+  BackendInput::UniquePtr toBackendInput() const {
+    CHECK(is_keyframe_);
+    return std::make_unique<BackendInput>(
+        timestamp_,
+        camera_measurements_.at(0u).status_measurements_,
+        pim_,
+        imu_acc_gyrs_,
+        body_lkf_OdomPose_body_kf_,
+        body_kf_world_OdomVel_body_kf_,
+        camera_measurements_);
+  }
+
+ public:
+  //! Null measurements if the frontend is bootstrapping.
+  const MultiCameraMeasurements camera_measurements_;
+  //! Same as MonoFrontendOutput::frame_lkf_, for each camera.
+  const std::vector<Frame> frames_lkf_;
+  //! Feature tracks of the reference camera.
+  const cv::Mat feature_tracks_;
+};
+
+}  // namespace VIO
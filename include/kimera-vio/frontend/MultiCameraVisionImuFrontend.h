@@ -0,0 +1,145 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   MultiCameraVisionImuFrontend.h
+ * @brief  Class describing a tracking Frontend for N monocular cameras
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "kimera-vio/frontend/Camera.h"
+#include "kimera-vio/frontend/Frame.h"
+#include "kimera-vio/frontend/MonoVisionImuFrontend-definitions.h"
+#include "kimera-vio/frontend/MultiCameraImuSyncPacket.h"
+#include "kimera-vio/frontend/MultiCameraVisionImuFrontend-definitions.h"
+#include "kimera-vio/frontend/Tracker.h"
+#include "kimera-vio/frontend/VisionImuFrontend.h"
+#include "kimera-vio/frontend/feature-detector/FeatureDetector.h"
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/visualizer/Display-definitions.h"
+
+namespace VIO {
+
+/**
+ * @brief The MultiCameraVisionImuFrontend class tracks the features of each
+ * camera of a rig independently, as the MonoVisionImuFrontend does for one
+ * camera, but the cameras share the IMU preintegration and the keyframes.
+ *
+ * The per-camera work (copying the frame and building its pyramid, the
+ * feature tracking, the outlier rejection, the feature detection...) runs in
+ * parallel for all cameras (cv::parallel_for_), so that the frame rate
+ * depends on the number of cores rather than on the number of cameras.
+ *
+ * The first camera is the reference one: it decides when to create a
+ * keyframe, its tracker is the VisionImuFrontend::tracker_ (e.g. for the
+ * time alignment and the map updates of the backend), and its measurements
+ * are the BackendInput stereo measurements.
+ */
+class MultiCameraVisionImuFrontend : public VisionImuFrontend {
+ public:
+  KIMERA_POINTER_TYPEDEFS(MultiCameraVisionImuFrontend);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(MultiCameraVisionImuFrontend);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW;
+
+ public:
+  //! @param cameras At least one camera, the first one is the reference one.
+  MultiCameraVisionImuFrontend(
+      const FrontendParams& frontend_params,
+      const ImuParams& imu_params,
+      const ImuBias& imu_initial_bias,
+      const std::vector<Camera::ConstPtr>& cameras,
+      DisplayQueue* display_queue = nullptr,
+      bool log_output = false,
+      std::optional<OdometryParams> odom_params = std::nullopt);
+
+  virtual ~MultiCameraVisionImuFrontend();
+
+  inline size_t getNrCameras() const { return camera_tracks_.size(); }
+
+ private:
+  //! Tracking state of one camera.
+  struct CameraTrack {
+    Camera::ConstPtr camera_;
+    //! The tracker_ of the base class for the reference camera.
+    Tracker* tracker_ = nullptr;
+    Tracker::UniquePtr owned_tracker_;
+    FeatureDetector::UniquePtr feature_detector_;
+    // Current frame
+    Frame::Ptr frame_k_;
+    // Last frame
+    Frame::Ptr frame_km1_;
+    // Last keyframe
+    Frame::Ptr frame_lkf_;
+    gtsam::Rot3 keyframe_R_ref_frame_;
+    TrackerStatusSummary status_;
+  };
+
+  inline FrontendOutputPacketBase::UniquePtr bootstrapSpin(
+      FrontendInputPacketBase::UniquePtr&& input) override {
+    CHECK(frontend_state_ == FrontendState::Bootstrap);
+    CHECK(input);
+    return bootstrapSpinMultiCamera(
+        castUnique<MultiCameraFrontendInputPayload>(std::move(input)));
+  }
+
+  inline FrontendOutputPacketBase::UniquePtr nominalSpin(
+      FrontendInputPacketBase::UniquePtr&& input) override {
+    CHECK(frontend_state_ == FrontendState::Nominal ||
+          frontend_state_ == FrontendState::InitialTimeAlignment);
+    CHECK(input);
+    return nominalSpinMultiCamera(
+        castUnique<MultiCameraFrontendInputPayload>(std::move(input)));
+  }
+
+  MultiCameraFrontendOutput::UniquePtr bootstrapSpinMultiCamera(
+      MultiCameraFrontendInputPayload::UniquePtr&& input);
+
+  MultiCameraFrontendOutput::UniquePtr nominalSpinMultiCamera(
+      MultiCameraFrontendInputPayload::UniquePtr&& input);
+
+  //! Runs work(cam_idx) for all cameras in parallel.
+  void forEachCamera(const std::function<void(const size_t&)>& work) const;
+
+  void processFirstFrame(CameraTrack* track, const Frame& first_frame) const;
+
+  //! Tracks the features of the last frame in the current one.
+  void trackFrame(CameraTrack* track,
+                  const gtsam::Rot3& keyframe_R_cur_frame) const;
+
+  //! Makes the current frame a keyframe: outlier rejection, feature
+  //! detection, and measurements of the keyframe.
+  StatusMonoMeasurementsPtr processKeyframe(
+      CameraTrack* track,
+      const gtsam::Rot3& keyframe_R_cur_frame) const;
+
+  //! Moves on to the next frame (frame_km1_ becomes frame_k_).
+  void finishFrame(CameraTrack* track,
+                   const gtsam::Rot3& keyframe_R_cur_frame) const;
+
+  //! Rotation of the current camera frame wrt the last keyframe one.
+  gtsam::Rot3 getKeyframeRotation(const CameraTrack& track,
+                                  const ImuFrontend::PimPtr& pim) const;
+
+  MultiCameraMeasurements getCameraMeasurements(
+      const std::vector<StatusMonoMeasurementsPtr>& status_measurements) const;
+
+  //! Copies of the last keyframe of each camera if is_keyframe, else of the
+  //! last frame.
+  std::vector<Frame> getLastFrames(const bool& is_keyframe) const;
+
+ private:
+  std::vector<CameraTrack> camera_tracks_;
+};
+
+}  // namespace VIO
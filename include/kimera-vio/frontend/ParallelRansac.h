@@ -0,0 +1,249 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ParallelRansac.h
+ * @brief  Batched, multi-threaded and preemptive RANSAC for OpenGV problems.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <opencv2/core/core.hpp>
+
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The ParallelRansac class is a drop-in replacement of
+ * opengv::sac::Ransac (same public members and computeModel()) for
+ * opengv::sac::SampleConsensusProblem problems.
+ *
+ * Hypotheses are generated in batches: the minimal samples are drawn
+ * sequentially (the problem's random generator is not thread-safe), while
+ * the models are computed and scored in parallel. Scoring evaluates the
+ * residuals of a whole block of correspondences per call, and is optionally
+ * preemptive (Nister, "Preemptive RANSAC for live structure and motion
+ * estimation", 2005): after each block of preemptive_block_size
+ * correspondences only the best half of the hypotheses survives, and only
+ * the best hypothesis of the batch is scored on all correspondences.
+ * The adaptive termination criterion and max_iterations_ are the same as in
+ * opengv::sac::Ransac.
+ *
+ * NOTE: the problem's computeModelCoefficients and
+ * getSelectedDistancesToModel must be safe to call concurrently, which is the
+ * case for the OpenGV problems used by the Tracker.
+ */
+template <class SampleConsensusProblem>
+class ParallelRansac {
+ public:
+  KIMERA_POINTER_TYPEDEFS(ParallelRansac);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(ParallelRansac);
+  typedef typename SampleConsensusProblem::model_t model_t;
+
+  /**
+   * @param max_iterations Maximum nr of hypotheses.
+   * @param threshold Inlier threshold on the problem's residuals.
+   * @param probability Desired probability of drawing an outlier-free sample.
+   * @param batch_size Nr of hypotheses generated and scored in parallel.
+   * @param preemptive_block_size Nr of correspondences scored before halving
+   * the hypotheses of a batch. Zero disables preemption: all hypotheses are
+   * scored on all correspondences.
+   */
+  ParallelRansac(const int& max_iterations,
+                 const double& threshold,
+                 const double& probability,
+                 const int& batch_size,
+                 const int& preemptive_block_size)
+      : max_iterations_(max_iterations),
+        threshold_(threshold),
+        probability_(probability),
+        batch_size_(batch_size),
+        preemptive_block_size_(preemptive_block_size) {
+    CHECK_GT(batch_size_, 0);
+    CHECK_GE(preemptive_block_size_, 0);
+  }
+  ~ParallelRansac() = default;
+
+ public:
+  /**
+   * @brief computeModel Same semantics as opengv::sac::Ransac::computeModel.
+   * @param debug_verbosity_level Unused, kept for interface compatibility.
+   * @return true if a model was found.
+   */
+  bool computeModel(int debug_verbosity_level = 0) {
+    CHECK(sac_model_);
+    iterations_ = 0;
+    model_.clear();
+    inliers_.clear();
+
+    const std::vector<int>& indices = *sac_model_->indices_;
+    const int nr_correspondences = static_cast<int>(indices.size());
+    const int sample_size = sac_model_->getSampleSize();
+    if (nr_correspondences < sample_size) return false;
+
+    // Random evaluation order of the correspondences for preemptive scoring,
+    // so that each block is a fair sample of the data.
+    std::vector<int> order(indices);
+    if (preemptive_block_size_ > 0) {
+      std::shuffle(order.begin(), order.end(), rng_);
+    }
+
+    int best_nr_inliers = -1;
+    double k = static_cast<double>(max_iterations_);
+    while (iterations_ < k && iterations_ < max_iterations_) {
+      const int remaining = std::min(
+          max_iterations_ - iterations_,
+          static_cast<int>(std::ceil(k - static_cast<double>(iterations_))));
+      const int nr_hypotheses = std::min(batch_size_, remaining);
+      iterations_ += nr_hypotheses;
+
+      // Draw the minimal samples sequentially.
+      samples_.resize(nr_hypotheses);
+      for (std::vector<int>& sample : samples_) {
+        int unused_iterations = iterations_;
+        sac_model_->getSamples(unused_iterations, sample);
+      }
+
+      // Compute the models in parallel.
+      models_.resize(nr_hypotheses);
+      valid_.assign(nr_hypotheses, 0u);
+      cv::parallel_for_(cv::Range(0, nr_hypotheses), [&](const cv::Range& r) {
+        for (int h = r.start; h < r.end; ++h) {
+          valid_[h] = !samples_[h].empty() &&
+                      sac_model_->computeModelCoefficients(samples_[h],
+                                                           models_[h]);
+        }
+      });
+      survivors_.clear();
+      for (int h = 0; h < nr_hypotheses; ++h) {
+        if (valid_[h]) survivors_.push_back(h);
+      }
+      if (survivors_.empty()) continue;
+
+      // Score them, preemptively if required.
+      scores_.assign(nr_hypotheses, 0);
+      int scored = 0;
+      if (preemptive_block_size_ > 0) {
+        while (survivors_.size() > 1u && scored < nr_correspondences) {
+          const int block_end =
+              std::min(scored + preemptive_block_size_, nr_correspondences);
+          scoreSurvivors(order, scored, block_end);
+          scored = block_end;
+          // Keep the best half (ties broken by hypothesis index).
+          const size_t nr_kept = (survivors_.size() + 1u) / 2u;
+          std::stable_sort(survivors_.begin(),
+                           survivors_.end(),
+                           [this](const int& a, const int& b) {
+                             return scores_[a] > scores_[b];
+                           });
+          survivors_.resize(nr_kept);
+        }
+      }
+      if (scored < nr_correspondences) {
+        scoreSurvivors(order, scored, nr_correspondences);
+      }
+
+      // Best hypothesis of the batch (first one on ties).
+      int batch_best = survivors_.front();
+      for (const int& h : survivors_) {
+        if (scores_[h] > scores_[batch_best] ||
+            (scores_[h] == scores_[batch_best] && h < batch_best)) {
+          batch_best = h;
+        }
+      }
+
+      if (scores_[batch_best] > best_nr_inliers) {
+        best_nr_inliers = scores_[batch_best];
+        model_ = samples_[batch_best];
+        model_coefficients_ = models_[batch_best];
+
+        // Same adaptive termination as opengv::sac::Ransac.
+        const double w = static_cast<double>(best_nr_inliers) /
+                         static_cast<double>(nr_correspondences);
+        double p_no_outliers = 1.0 - std::pow(w, sample_size);
+        p_no_outliers = std::max(std::numeric_limits<double>::epsilon(),
+                                 p_no_outliers);
+        p_no_outliers = std::min(
+            1.0 - std::numeric_limits<double>::epsilon(), p_no_outliers);
+        k = std::log(1.0 - probability_) / std::log(p_no_outliers);
+      }
+    }
+
+    if (model_.empty()) return false;
+    sac_model_->selectWithinDistance(model_coefficients_, threshold_, inliers_);
+    return true;
+  }
+
+  //! Nr of residuals of the vector below the threshold.
+  static int countInliers(const std::vector<double>& distances,
+                          const double& threshold) {
+    // Branchless so that the compiler vectorizes it.
+    int count = 0;
+    const double* d = distances.data();
+    const size_t n = distances.size();
+    for (size_t i = 0u; i < n; ++i) count += d[i] < threshold;
+    return count;
+  }
+
+ private:
+  //! Adds to scores_ the inliers of each survivor among order[begin, end).
+  void scoreSurvivors(const std::vector<int>& order,
+                      const int& begin,
+                      const int& end) {
+    block_.assign(order.begin() + begin, order.begin() + end);
+    const int nr_survivors = static_cast<int>(survivors_.size());
+    cv::parallel_for_(cv::Range(0, nr_survivors), [&](const cv::Range& r) {
+      std::vector<double> distances;
+      for (int s = r.start; s < r.end; ++s) {
+        const int& h = survivors_[s];
+        sac_model_->getSelectedDistancesToModel(models_[h], block_, distances);
+        scores_[h] += countInliers(distances, threshold_);
+      }
+    });
+  }
+
+ public:
+  //! Same public interface as opengv::sac::Ransac.
+  std::shared_ptr<SampleConsensusProblem> sac_model_;
+  std::vector<int> model_;
+  std::vector<int> inliers_;
+  model_t model_coefficients_;
+  int iterations_ = 0;
+  int max_iterations_;
+  double threshold_;
+  double probability_;
+
+ private:
+  const int batch_size_;
+  const int preemptive_block_size_;
+
+  //! Fixed seed: the randomness of the samples comes from the problem.
+  std::mt19937 rng_;
+
+  //! Per-batch buffers, reused across batches.
+  std::vector<std::vector<int>> samples_;
+  std::vector<model_t> models_;
+  std::vector<uint8_t> valid_;
+  std::vector<int> scores_;
+  std::vector<int> survivors_;
+  std::vector<int> block_;
+};
+
+}  // namespace VIO
@@ -87,10 +87,16 @@ class RgbdCamera : public Camera {
    * point in the camera frame of reference.
    * @param[out] colors A color for each point in the cloud. Same layout
    * than the pointcloud.
+   * @param[in] stride Only every stride-th pixel of every stride-th row is
+   * converted: the cloud is decimated by stride in both dimensions.
+   * The rows are converted in parallel with the vectorized
+   * SimdKernels::depth_row_to_points, into the given cloud and colors if
+   * they have the right size already (e.g. reused from the previous frame).
    */
   void convertRgbdToPointcloud(const RgbdFrame& rgbd_frame,
                                cv::Mat* cloud,
-                               cv::Mat* colors);
+                               cv::Mat* colors,
+                               const int& stride = 1);
 
  protected:
   // TODO(Toni): put this in the DepthCameraParams struct
@@ -79,9 +79,10 @@ class RgbdVisionImuFrontend : public VisionImuFrontend {
   // high-level consistency checks and logging
   void checkAndLogKeyframe();
 
-  // Frontend nominal processing
+  // Frontend nominal processing, stereo_frame is built from cur_frame
   StatusStereoMeasurementsPtr processFrame(
       const RgbdFrame& cur_frame,
+      const StereoFrame::Ptr& stereo_frame,
       const gtsam::Rot3& keyframe_R_ref_frame,
       cv::Mat* feature_tracks = nullptr);
 
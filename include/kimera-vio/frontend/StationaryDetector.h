@@ -0,0 +1,106 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   StationaryDetector.h
+ * @brief  Detects when the platform stands still, from the IMU variance and
+ * the feature disparity, to run the pipeline in idle mode.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include <Eigen/Core>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/imu-frontend/ImuFrontend-definitions.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+struct StationaryDetectorParams {
+  //! Max std of the gyroscope [rad/s] and accelerometer [m/s^2] measurements
+  //! of a frame (norm over the axes) for the platform to be still.
+  double max_gyro_std = 0.005;
+  double max_acc_std = 0.05;
+  //! Max median disparity of a frame wrt the last keyframe [px].
+  double max_disparity = 0.5;
+  //! Time the platform must be still before entering the idle mode [s].
+  double min_duration_s = 1.0;
+  //! Max time between keyframes in idle mode [s], which must stay below the
+  //! time horizon of the backend smoother.
+  double max_keyframe_time_s = 10.0;
+};
+
+/**
+ * @brief The StationaryDetector class decides, for each frame, whether the
+ * platform stands still: the IMU measurements of the frame barely vary and
+ * the features did not move since the last keyframe. After min_duration_s of
+ * still frames it enters the idle mode, in which the frontend stops creating
+ * keyframes (hence the backend stops updating the smoother), and it leaves it
+ * at the first frame with motion.
+ *
+ * While still, it averages the gyroscope measurements, which then only
+ * measure the gyroscope bias (up to the earth rotation), to monitor the bias
+ * estimated by the backend.
+ */
+class StationaryDetector {
+ public:
+  KIMERA_POINTER_TYPEDEFS(StationaryDetector);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(StationaryDetector);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  explicit StationaryDetector(const StationaryDetectorParams& params);
+  ~StationaryDetector() = default;
+
+  //! Feeds the IMU measurements of the next frame.
+  void addImuMeasurements(const ImuAccGyrS& imu_accgyrs);
+
+  /**
+   * @brief update Feeds the median disparity of the frame wrt the last
+   * keyframe, once its IMU measurements were added.
+   * @return True if in idle mode.
+   */
+  bool update(const Timestamp& timestamp, const double& disparity);
+
+  inline bool isIdle() const { return is_idle_; }
+
+  //! Time spent in idle mode so far [s], 0 if not idle.
+  double getIdleDuration(const Timestamp& timestamp) const;
+
+  /**
+   * @brief getStillGyroMean Mean of the gyroscope measurements since the
+   * platform stands still.
+   * @return False if not idle, in which case the mean is not reliable.
+   */
+  bool getStillGyroMean(Eigen::Vector3d* gyro_mean) const;
+
+ private:
+  void reset();
+
+ private:
+  const StationaryDetectorParams params_;
+
+  //! IMU of the frame being processed: whether it is still, and the sum of
+  //! its gyroscope measurements.
+  bool frame_imu_still_;
+  Eigen::Vector3d frame_gyro_sum_;
+  size_t frame_nr_gyro_samples_;
+
+  //! Timestamp of the first still frame, and of the first idle frame.
+  Timestamp still_since_;
+  Timestamp idle_since_;
+  bool is_still_;
+  bool is_idle_;
+  Eigen::Vector3d still_gyro_sum_;
+  size_t still_nr_gyro_samples_;
+};
+
+}  // namespace VIO
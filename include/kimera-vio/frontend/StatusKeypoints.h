@@ -0,0 +1,85 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   StatusKeypoints.h
+ * @brief  Structure-of-arrays container of keypoints with their status.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include "kimera-vio/common/vio_types.h"
+
+namespace VIO {
+
+/**
+ * @brief The StatusKeypointsSoA class stores the same information as a
+ * StatusKeypointsCV, but as separate arrays: one byte of status per keypoint,
+ * and aligned arrays of x and y coordinates. Loops that only check the status
+ * read a byte instead of a whole pair, and loops over the coordinates can be
+ * vectorized.
+ */
+class StatusKeypointsSoA {
+ public:
+  using Floats = std::vector<float, Eigen::aligned_allocator<float>>;
+  using Statuses = std::vector<std::uint8_t>;
+
+  StatusKeypointsSoA() = default;
+  explicit StatusKeypointsSoA(const StatusKeypointsCV& keypoints);
+  ~StatusKeypointsSoA() = default;
+
+ public:
+  //! Replaces the keypoints, reusing the memory of the arrays.
+  void assign(const StatusKeypointsCV& keypoints);
+  void toStatusKeypointsCV(StatusKeypointsCV* keypoints) const;
+
+  void clear();
+  void reserve(const size_t& n);
+  void push_back(const KeypointStatus& status, const KeypointCV& keypoint);
+
+  inline size_t size() const { return status_.size(); }
+  inline bool empty() const { return status_.empty(); }
+
+  inline KeypointStatus status(const size_t& i) const {
+    return static_cast<KeypointStatus>(status_[i]);
+  }
+  inline bool isValid(const size_t& i) const {
+    return status_[i] == kValid;
+  }
+  inline void setStatus(const size_t& i, const KeypointStatus& status) {
+    status_[i] = static_cast<std::uint8_t>(status);
+  }
+  inline KeypointCV keypoint(const size_t& i) const {
+    return KeypointCV(x_[i], y_[i]);
+  }
+
+  //! Raw arrays, of size() elements.
+  inline const float* x() const { return x_.data(); }
+  inline const float* y() const { return y_.data(); }
+  inline const std::uint8_t* statuses() const { return status_.data(); }
+
+  //! Number of keypoints with a VALID status.
+  size_t countValid() const;
+
+ private:
+  static constexpr std::uint8_t kValid =
+      static_cast<std::uint8_t>(KeypointStatus::VALID);
+
+  Statuses status_;
+  Floats x_;
+  Floats y_;
+};
+
+}  // namespace VIO
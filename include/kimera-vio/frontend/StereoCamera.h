@@ -192,6 +192,15 @@ class StereoCamera {
   inline cv::Rect getROI1() const { return ROI1_; }
   inline cv::Rect getROI2() const { return ROI2_; }
 
+  //! Bounding boxes in the rectified images of the static regions of interest
+  //! of the cameras (see CameraParams::roi_mask_), empty if they have none.
+  inline const cv::Rect& getLeftRectifiedRoi() const {
+    return left_rectified_roi_;
+  }
+  inline const cv::Rect& getRightRectifiedRoi() const {
+    return right_rectified_roi_;
+  }
+
   inline CameraParams getLeftCamParams() const {
     return original_left_camera_->getCamParams();
   }
@@ -212,12 +221,34 @@ class StereoCamera {
 
   inline Baseline getBaseline() const { return stereo_baseline_; }
 
+  inline const UndistorterRectifier& getLeftCamUndistortRectifier() const {
+    CHECK(left_cam_undistort_rectifier_);
+    return *left_cam_undistort_rectifier_;
+  }
+
+  inline const UndistorterRectifier& getRightCamUndistortRectifier() const {
+    CHECK(right_cam_undistort_rectifier_);
+    return *right_cam_undistort_rectifier_;
+  }
+
   /**
-   * @brief rectifyUndistortStereoFrame
+   * @brief rectifyUndistortStereoFrame Only the bounding boxes of the regions
+   * of interest are rectified, if any, the rest is left black.
    * @param stereo_frame
    */
   void undistortRectifyStereoFrame(StereoFrame* stereo_frame) const;
 
+  /**
+   * @brief undistortRectifyStereoFrame Same as above, but only rectifies the
+   * given rows of the left/right images (e.g. the stripes read by the sparse
+   * stereo matcher). The rest of the rectified images is left black, and the
+   * stereo frame is flagged as not having full rectified images.
+   * @param row_ranges Rows of the rectified images to compute.
+   * @param stereo_frame
+   */
+  void undistortRectifyStereoFrame(const std::vector<cv::Range>& row_ranges,
+                                   StereoFrame* stereo_frame) const;
+
   /**
    * @brief undistortRectifyLeftKeypoints Undistorts and rectifies left
    * keypoints using the left camera distortion and rectification parameters.
@@ -232,6 +263,11 @@ class StereoCamera {
   void distortUnrectifyRightKeypoints(const StatusKeypointsCV& status_keypoints,
                                       KeypointsCV* keypoints) const;
 
+  //! Undistorts and rectifies right keypoints (e.g. tracked from the left
+  //! image) using the right camera distortion and rectification parameters.
+  void undistortRectifyRightKeypoints(const KeypointsCV& keypoints,
+                                      KeypointsCV* keypoints_rectified) const;
+
   /**
    * @brief computeRectificationParameters
    *
@@ -304,6 +340,10 @@ class StereoCamera {
   //! Regions of interest in the left/right image.
   cv::Rect ROI1_, ROI2_;
 
+  //! See getLeftRectifiedRoi.
+  cv::Rect left_rectified_roi_;
+  cv::Rect right_rectified_roi_;
+
   //! Stereo baseline
   Baseline stereo_baseline_;
 };
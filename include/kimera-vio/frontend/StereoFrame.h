@@ -68,11 +68,20 @@ class StereoFrame {
   inline void setIsRectified(bool is_rect) {
     is_rectified_ = is_rect;
   }
+  /**
+   * @param full_images False if only some rows of the images were rectified
+   * (see StereoMatchingParams::lazy_stereo_rectification_).
+   */
   void setRectifiedImages(const cv::Mat& left_rectified_img,
-                          const cv::Mat& right_rectified_img);
+                          const cv::Mat& right_rectified_img,
+                          const bool& full_images = true);
 
   inline bool isKeyframe() const { return is_keyframe_; }
   inline bool isRectified() const { return is_rectified_; }
+  //! False if only the rows needed for sparse stereo matching are rectified.
+  inline bool hasFullRectifiedImages() const {
+    return is_rectified_ && has_full_rectified_images_;
+  }
 
   //! Return rectified images, assumes the images have already been computed.
   //! Note that we return const images, since these should not be modified
@@ -140,6 +149,7 @@ class StereoFrame {
   // Can only be rectified if rectified images are filled.
   bool is_keyframe_;
   bool is_rectified_;
+  bool has_full_rectified_images_;
 
   //! Rectified undistorted images for sparse stereo epipolar matching
   //! If the flag is_rectified_ is not true,
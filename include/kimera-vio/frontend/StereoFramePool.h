@@ -0,0 +1,79 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   StereoFramePool.h
+ * @brief  Recycles the per-frame feature containers of stereo frames.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/frontend/Frame.h"
+#include "kimera-vio/frontend/StereoFrame.h"
+#include "kimera-vio/utils/ContainerPool.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The StereoFramePool class is owned by a frontend: stereo frames made
+ * with makeStereoFrame() get, on creation, the memory of the feature
+ * containers (keypoints, landmark ids, ages, versors, 3D points...) of frames
+ * that the frontend already let go, and give theirs back to the pool when
+ * destroyed. Hence, in steady state, the frontend tracks and matches features
+ * without allocating per-frame containers.
+ *
+ * NOTE: copies of the frames (as sent downstream in the frontend output) are
+ * regular frames and do not take part in the recycling.
+ */
+class StereoFramePool : public std::enable_shared_from_this<StereoFramePool> {
+ public:
+  KIMERA_POINTER_TYPEDEFS(StereoFramePool);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(StereoFramePool);
+
+  //! @param max_nr_frames Maximum nr of frames whose containers are recycled.
+  explicit StereoFramePool(const size_t& max_nr_frames = 4u);
+  ~StereoFramePool() = default;
+
+  /**
+   * @brief makeStereoFrame Copies the stereo frame into a frame whose
+   * containers come from the pool. Must be called on a pool owned by a
+   * shared_ptr.
+   */
+  StereoFrame::Ptr makeStereoFrame(const StereoFrame& stereo_frame);
+
+  //! Moves recycled memory into the (empty) containers of the frame.
+  void acquire(StereoFrame* stereo_frame);
+
+  //! Clears the containers of the frame and keeps their memory.
+  void release(StereoFrame* stereo_frame);
+
+ private:
+  void acquire(Frame* frame);
+  void release(Frame* frame);
+
+ private:
+  // Frame containers (both left and right frames use them).
+  ContainerPool<KeypointsCV> keypoints_pool_;
+  ContainerPool<StatusKeypointsCV> status_keypoints_pool_;
+  ContainerPool<std::vector<double>> scores_pool_;
+  ContainerPool<LandmarkIds> landmarks_pool_;
+  ContainerPool<std::vector<size_t>> ages_pool_;
+  ContainerPool<BearingVectors> versors_pool_;
+
+  // Stereo frame containers.
+  ContainerPool<Depths> depths_pool_;
+  ContainerPool<Landmarks> points_3d_pool_;
+};
+
+}  // namespace VIO
@@ -15,6 +15,10 @@
 
 #pragma once
 
+#include <opencv2/calib3d.hpp>
+
+#include "kimera-vio/frontend/EpipolarStripeMatcher.h"
+#include "kimera-vio/frontend/GpuDenseStereoMatcher.h"
 #include "kimera-vio/frontend/StereoCamera.h"
 #include "kimera-vio/frontend/StereoMatchingParams.h"
 #include "kimera-vio/utils/Macros.h"
@@ -32,9 +36,12 @@ class StereoMatcher {
    * stereo matches between left/right images of a stereo camera.
    * @param stereo_camera
    * @param stereo_matching_params
+   * @param dense_stereo_params
    */
   StereoMatcher(const StereoCamera::ConstPtr& stereo_camera,
-                const StereoMatchingParams& stereo_matching_params);
+                const StereoMatchingParams& stereo_matching_params,
+                const DenseStereoParams& dense_stereo_params =
+                    DenseStereoParams());
 
   virtual ~StereoMatcher() = default;
 
@@ -42,9 +49,11 @@ class StereoMatcher {
   /**
    * @brief denseStereoReconstruction
    * Given left and right images reconstructs a dense disparity image.
+   * The dense stereo matcher is created at the first call and reused.
    * @param[in] left_img Undistorted rectified left image
    * @param[in] right_img Undistorted rectified right image
-   * @param[out] disparity_img Disparity image
+   * @param[out] disparity_img Disparity image (CV_16S with 4 fractional bits,
+   * as cv::StereoMatcher::compute), at the resolution of the images.
    */
   void denseStereoReconstruction(const cv::Mat& left_img_rectified,
                                  const cv::Mat& right_img_rectified,
@@ -60,8 +69,13 @@ class StereoMatcher {
    * members.
    * @param[in/out] stereo_frame In the keypoints from left image and out the
    * right keypoints.
+   * @param[in] disparity_priors Optional predicted disparity of each left
+   * keypoint (non-positive if unknown), see use_disparity_prior_.
+   * In StereoMatchingMode::kKlt, they seed the KLT.
    */
-  void sparseStereoReconstruction(StereoFrame* stereo_frame);
+  void sparseStereoReconstruction(
+      StereoFrame* stereo_frame,
+      const std::vector<double>& disparity_priors = std::vector<double>());
 
   /**
    * @brief spaseStereoReconstruction
@@ -71,12 +85,14 @@ class StereoMatcher {
    * @param[in] right_img Undistorted rectified right image
    * @param[in] left_keypoints Left keypoints
    * @param[out] right_keypoints Corresponding right keypoints wrt left
+   * @param[in] disparity_priors Optional predicted disparities, as above.
    */
   void sparseStereoReconstruction(
       const cv::Mat& left_img_rectified,
       const cv::Mat& right_img_rectified,
       const StatusKeypointsCV& left_keypoints_rectified,
-      StatusKeypointsCV* right_keypoints_rectified);
+      StatusKeypointsCV* right_keypoints_rectified,
+      const std::vector<double>& disparity_priors = std::vector<double>());
 
   void getRightKeypointsRectified(
       const cv::Mat& left_img_rectified,
@@ -84,14 +100,60 @@ class StereoMatcher {
       const StatusKeypointsCV& left_keypoints_rectified,
       const double& fx,
       const double& baseline,
-      StatusKeypointsCV* right_keypoints_rectified) const;
+      StatusKeypointsCV* right_keypoints_rectified,
+      const std::vector<double>& disparity_priors =
+          std::vector<double>()) const;
+
+  /**
+   * @brief getStripeRowRanges Computes the (merged) rows of the rectified
+   * images that are read when searching the right keypoints of the given left
+   * keypoints. Used to only rectify these rows.
+   * @param[in] left_keypoints_rectified Left keypoints
+   * @param[in] img_rows Number of rows of the images
+   * @param[out] row_ranges Sorted, non-overlapping row ranges.
+   */
+  void getStripeRowRanges(const StatusKeypointsCV& left_keypoints_rectified,
+                          const int& img_rows,
+                          std::vector<cv::Range>* row_ranges) const;
 
   void getDepthFromRectifiedMatches(
       StatusKeypointsCV& left_keypoints_rectified,
       StatusKeypointsCV& right_keypoints_rectified,
       Depths* keypoints_depth) const;
 
+  inline const DenseStereoParams& getDenseStereoParams() const {
+    return dense_stereo_params_;
+  }
+
  protected:
+  //! Creates the dense stereo matcher (on the GPU if requested), with the
+  //! disparity range scaled to the matching resolution.
+  void createDenseStereoMatcher();
+
+  /**
+   * @brief getRightKeypointsKlt Finds the right keypoints with one batched
+   * pyramidal KLT call on the original (distorted, unrectified) images, which
+   * reuses the left pyramid built by the tracker. Each keypoint is seeded at
+   * its disparity prior if known, else at the disparity of max_point_dist_.
+   * Keypoints that are lost or off the rectified epipolar line are flagged
+   * NO_RIGHT_RECT.
+   * @param[in] stereo_frame With its left keypoints rectified.
+   * @param[in] disparity_priors Optional predicted disparities.
+   * @param[out] right_keypoints_rectified
+   */
+  void getRightKeypointsKlt(const StereoFrame& stereo_frame,
+                            const std::vector<double>& disparity_priors,
+                            StatusKeypointsCV* right_keypoints_rectified) const;
+
+  /**
+   * @brief searchRightKeypointEpipolar Searches the right keypoint along the
+   * epipolar stripe of the right rectified image.
+   * @param stripe_matcher Optional dedicated kernel to use instead of
+   * cv::matchTemplate (see StereoMatchingKernelType). Pass the same matcher
+   * for all keypoints of a frame so that its scratch memory is reused.
+   * @param min_disparity The stripe covers the disparities from
+   * min_disparity + 1 to min_disparity + stripe_cols - templ_cols + 1.
+   */
   void searchRightKeypointEpipolar(
       const cv::Mat& left_img_rectified,
       const KeypointCV& left_keypoint_rectified,
@@ -100,7 +162,9 @@ class StereoMatcher {
       const int& stripe_rows,
       const StereoMatchingParams& stereo_matching_params,
       StatusKeypointCV* right_keypoint_rectified,
-      double* score) const;
+      double* score,
+      EpipolarStripeMatcher* stripe_matcher = nullptr,
+      const int& min_disparity = 0) const;
 
  protected:
   //! Stereo camera shared that might be shared across modules
@@ -111,6 +175,10 @@ class StereoMatcher {
 
   //! Parameters for dense stereo matching
   DenseStereoParams dense_stereo_params_;
+
+  //! Dense stereo matchers, created once: only one of them is used.
+  cv::Ptr<cv::StereoMatcher> dense_stereo_matcher_;
+  GpuDenseStereoMatcher::UniquePtr gpu_dense_stereo_matcher_;
 };
 
 }  // namespace VIO
@@ -21,6 +21,26 @@
 
 namespace VIO {
 
+//! Kernel used to search the left template along the right epipolar stripe.
+enum class StereoMatchingKernelType {
+  //! cv::matchTemplate with CV_TM_SQDIFF, one call per keypoint.
+  kOpenCvTemplateMatching = 0,
+  //! Dedicated (SIMD) sum of squared differences kernel.
+  kSsd = 1,
+  //! Dedicated (SIMD) zero-mean normalized cross-correlation kernel.
+  kNcc = 2,
+};
+
+//! How right keypoints are found for the left keypoints.
+enum class StereoMatchingMode {
+  //! Epipolar stripe search of each left template (see
+  //! StereoMatchingKernelType).
+  kTemplateMatching = 0,
+  //! One batched pyramidal KLT call from the left to the right image, seeded
+  //! at the predicted disparity, reusing the left pyramid of the tracker.
+  kKlt = 1,
+};
+
 class StereoMatchingParams : public PipelineParams {
  public:
   StereoMatchingParams();
@@ -56,6 +76,34 @@ class StereoMatchingParams : public PipelineParams {
   bool subpixel_refinement_ = false;
   // do equalize image before processing options to use RGB-D vs. stereo.
   bool equalize_image_ = false;
+  // kernel used for the epipolar search of right keypoints.
+  StereoMatchingKernelType stereo_matching_kernel_type_ =
+      StereoMatchingKernelType::kOpenCvTemplateMatching;
+  // number of stripes the left keypoints are split in to be matched in
+  // parallel (the search of each keypoint is independent), by OpenCV's thread
+  // pool (see cv::setNumThreads to cap its threads). 1 means serial matching.
+  int sparse_stereo_num_stripes_ = 1;
+  // below this number of keypoints, matching is done serially.
+  int sparse_stereo_min_parallel_kpts_ = 50;
+  // only rectify the image rows read by the sparse stereo matcher instead of
+  // the full left/right images (rectified images are then partial).
+  bool lazy_stereo_rectification_ = false;
+  // search the right keypoints of tracked landmarks only around the disparity
+  // predicted from their known depth (+- disparity_prior_margin_ pixels),
+  // falling back to the full stripe if no match is found there.
+  bool use_disparity_prior_ = false;
+  int disparity_prior_margin_ = 4;
+  // how the right keypoints are found (template matching or KLT).
+  StereoMatchingMode stereo_matching_mode_ =
+      StereoMatchingMode::kTemplateMatching;
+  // KLT stereo matching: same window size and max level as the tracker's
+  // (klt_win_size, klt_max_level) so that the left pyramid is reused.
+  int klt_stereo_win_size_ = 24;
+  int klt_stereo_max_level_ = 3;
+  int klt_stereo_max_iter_ = 30;
+  // KLT stereo matching: max row difference between the rectified left and
+  // right keypoints (rectified epipolar lines are horizontal).
+  double klt_stereo_max_epipolar_error_ = 1.0;
 };
 
 // TODO(Toni) make it a pipeline params and parseable.
@@ -79,6 +127,12 @@ struct DenseStereoParams {
   int p2_ = 240;
   int disp_12_max_diff_ = -1;
   bool use_mode_HH_ = true;
+  // run semi-global matching on the GPU (cv::cuda::StereoSGM, needs
+  // OpenCV's cudastereo and a CUDA device), instead of StereoBM/StereoSGBM.
+  bool use_cuda_sgm_ = false;
+  // compute the disparities on half resolution images, upsampled to the
+  // full resolution afterwards.
+  bool half_resolution_ = false;
 };
 
 }  // namespace VIO
@@ -14,6 +14,9 @@
 
 #pragma once
 
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <optional>
 
 #include "kimera-vio/frontend/FrontendOutputPacketBase.h"
@@ -27,20 +30,23 @@ struct StereoFrontendOutput : public FrontendOutputPacketBase {
   KIMERA_POINTER_TYPEDEFS(StereoFrontendOutput);
   KIMERA_DELETE_COPY_CONSTRUCTORS(StereoFrontendOutput);
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  //! Draws the feature tracks image, only called if someone asks for it.
+  using FeatureTracksProducer = std::function<cv::Mat()>;
+
   StereoFrontendOutput(
       const bool is_keyframe,
       const StatusStereoMeasurementsPtr& status_stereo_measurements,
       const gtsam::Pose3& b_Pose_camL_rect,
       const gtsam::Pose3& b_Pose_camR_rect,
-      const StereoFrame& stereo_frame_lkf,
+      const StereoFrame::ConstPtr& stereo_frame_lkf,
       // Use rvalue reference: FrontendOutput owns pim now.
       const ImuFrontend::PimPtr& pim,
       const ImuAccGyrS& imu_acc_gyrs,
-      const cv::Mat& feature_tracks,
+      FeatureTracksProducer feature_tracks_producer,
       const DebugTrackerInfo& debug_tracker_info,
       std::optional<gtsam::Pose3> lkf_body_Pose_kf_body = std::nullopt,
       std::optional<gtsam::Velocity3> body_world_Vel_body = std::nullopt)
-      : FrontendOutputPacketBase(stereo_frame_lkf.timestamp_,
+      : FrontendOutputPacketBase(CHECK_NOTNULL(stereo_frame_lkf)->timestamp_,
                                  is_keyframe,
                                  FrontendType::kStereoImu,
                                  pim,
@@ -52,15 +58,51 @@ struct StereoFrontendOutput : public FrontendOutputPacketBase {
         b_Pose_camL_rect_(b_Pose_camL_rect),
         b_Pose_camR_rect_(b_Pose_camR_rect),
         stereo_frame_lkf_(stereo_frame_lkf),
-        feature_tracks_(feature_tracks) {}
+        feature_tracks_producer_(std::move(feature_tracks_producer)),
+        feature_tracks_once_(),
+        feature_tracks_() {}
+
+  //! Copies the stereo frame, with an already drawn feature tracks image.
+  StereoFrontendOutput(
+      const bool is_keyframe,
+      const StatusStereoMeasurementsPtr& status_stereo_measurements,
+      const gtsam::Pose3& b_Pose_camL_rect,
+      const gtsam::Pose3& b_Pose_camR_rect,
+      const StereoFrame& stereo_frame_lkf,
+      const ImuFrontend::PimPtr& pim,
+      const ImuAccGyrS& imu_acc_gyrs,
+      const cv::Mat& feature_tracks,
+      const DebugTrackerInfo& debug_tracker_info,
+      std::optional<gtsam::Pose3> lkf_body_Pose_kf_body = std::nullopt,
+      std::optional<gtsam::Velocity3> body_world_Vel_body = std::nullopt)
+      : StereoFrontendOutput(
+            is_keyframe,
+            status_stereo_measurements,
+            b_Pose_camL_rect,
+            b_Pose_camR_rect,
+            std::make_shared<const StereoFrame>(stereo_frame_lkf),
+            pim,
+            imu_acc_gyrs,
+            FeatureTracksProducer(),
+            debug_tracker_info,
+            lkf_body_Pose_kf_body,
+            body_world_Vel_body) {
+    feature_tracks_ = feature_tracks;
+  }
 
   virtual ~StereoFrontendOutput() = default;
 
   virtual const Frame* getTrackingFrame() const override {
-    return &stereo_frame_lkf_.left_frame_;
+    return &stereo_frame_lkf_->left_frame_;
   }
 
+  //! Draws the feature tracks the first time it is called.
   virtual const cv::Mat* getTrackingImage() const override {
+    std::call_once(feature_tracks_once_, [this]() {
+      if (feature_tracks_producer_) {
+        feature_tracks_ = feature_tracks_producer_();
+      }
+    });
     return &feature_tracks_;
   }
 
@@ -86,9 +128,14 @@ struct StereoFrontendOutput : public FrontendOutputPacketBase {
    * This member is not necessarily a key-frame and can be one of two things:
    * - The last frame processed (is_keyframe_ = false)
    * - The newest keyframe (is_keyframe_ = true)
+   * Shared with all the modules the output is sent to, hence never modified.
    */
-  const StereoFrame stereo_frame_lkf_;
-  const cv::Mat feature_tracks_;
+  const StereoFrame::ConstPtr stereo_frame_lkf_;
+
+ private:
+  const FeatureTracksProducer feature_tracks_producer_;
+  mutable std::once_flag feature_tracks_once_;
+  mutable cv::Mat feature_tracks_;
 };
 
 }  // namespace VIO
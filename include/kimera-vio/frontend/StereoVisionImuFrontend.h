@@ -18,19 +18,25 @@
 
 #include <atomic>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/opencv.hpp>
 
 #include "kimera-vio/backend/VioBackend-definitions.h"
+#include "kimera-vio/frontend/GpuImagePreprocessor.h"
 #include "kimera-vio/frontend/StereoFrame.h"
+#include "kimera-vio/frontend/StereoFramePool.h"
 #include "kimera-vio/frontend/StereoImuSyncPacket.h"
 #include "kimera-vio/frontend/StereoMatcher.h"
 #include "kimera-vio/frontend/StereoVisionImuFrontend-definitions.h"
 #include "kimera-vio/frontend/VisionImuFrontend.h"
+#include "kimera-vio/frontend/feature-detector/SpeculativeFeatureDetector.h"
 #include "kimera-vio/pipeline/PipelineModule.h"
 #include "kimera-vio/utils/Statistics.h"
+#include "kimera-vio/utils/TaskGraph.h"
 #include "kimera-vio/utils/ThreadsafeQueue.h"
 #include "kimera-vio/utils/Timer.h"
 
@@ -121,10 +127,28 @@ class StereoVisionImuFrontend : public VisionImuFrontend {
 
   /* ------------------------------------------------------------------------ */
   // Frontend main function.
+  // feature_tracks gets what the feature tracks image is drawn from, if any.
   StatusStereoMeasurementsPtr processStereoFrame(
       const StereoFrame& cur_frame,
       const gtsam::Rot3& keyframe_R_ref_frame,
-      cv::Mat* feature_tracks = nullptr);
+      TrackerImageInput* feature_tracks = nullptr,
+      const std::optional<gtsam::Pose3>& keyframe_P_cur_frame = std::nullopt);
+
+  // Depth of the keypoints of the reference frame (stereoFrame_km1_) using the
+  // stereo 3D points of the last keyframe, non-positive if unknown.
+  std::vector<double> getReferenceFrameDepths(
+      const gtsam::Pose3& keyframe_P_ref_frame) const;
+
+  // Disparity of the landmarks with a stereo 3D point in stereo_frame, once
+  // moved to the current frame (stereo_frame_P_cur_frame).
+  std::unordered_map<LandmarkId, double> getLandmarkDisparities(
+      const StereoFrame& stereo_frame,
+      const gtsam::Pose3& stereo_frame_P_cur_frame) const;
+
+  // Disparity prior of each keypoint of the current frame for the sparse
+  // stereo matching, non-positive if unknown.
+  std::vector<double> getDisparityPriors(
+      const std::unordered_map<LandmarkId, double>& lmk_disparities) const;
 
   /* ------------------------------------------------------------------------ */
   // Static function to display output of stereo tracker
@@ -145,6 +169,10 @@ class StereoVisionImuFrontend : public VisionImuFrontend {
   void sendMonoTrackingToLogger() const;
 
  private:
+  // Recycles the feature containers of the frames below once released.
+  // Declared first so that it outlives them.
+  StereoFramePool::Ptr stereo_frame_pool_;
+
   // TODO MAKE THESE GUYS std::unique_ptr, we do not want to have multiple
   // owners, instead they should be passed around.
   // Stereo Frames
@@ -159,9 +187,17 @@ class StereoVisionImuFrontend : public VisionImuFrontend {
   // We use this to calculate the rotation btw reference frame and current frame
   // Whenever a keyframe is created, we reset it to identity.
   gtsam::Rot3 keyframe_R_ref_frame_;
+  // Same for the full pose, if available (roto-translational optical flow).
+  std::optional<gtsam::Pose3> keyframe_P_ref_frame_;
 
   // Create the feature detector
   FeatureDetector::UniquePtr feature_detector_;
+  //! Detects in the frames in between keyframes, if enabled (nullptr if not).
+  SpeculativeFeatureDetector::UniquePtr speculative_feature_detector_;
+  //! Rectifies and detects on the GPU, if enabled and available.
+  GpuImagePreprocessor::UniquePtr gpu_image_preprocessor_;
+  //! Runs the independent stages of the keyframes at once.
+  utils::TaskGraph::UniquePtr keyframe_task_graph_;
 
   // A stereo camera
   StereoCamera::ConstPtr stereo_camera_;
@@ -81,6 +81,9 @@ public:
   size_t nrDetectedFeatures_ = 0, nrTrackerFeatures_ = 0, nrMonoInliers_ = 0;
   size_t nrMonoPutatives_ = 0, nrStereoInliers_ = 0, nrStereoPutatives_ = 0;
   size_t monoRansacIters_ = 0, stereoRansacIters_ = 0;
+  // Cumulative nr of 2-point mono RANSACs in fast-path mode, and of those
+  // that fell back to 5-point because the rotation prior was inconsistent.
+  size_t nrMono2PointRansacs_ = 0, nrMono2PointFallbacks_ = 0;
 
   // Info about performance of sparse stereo matching (and ransac):
   // RPK = right keypoints
@@ -112,6 +115,8 @@ public:
               << "nrStereoPutatives_: " << nrStereoPutatives_ << "\n"
               << "monoRansacIters_: " << monoRansacIters_ << "\n"
               << "stereoRansacIters_: " << stereoRansacIters_ << "\n"
+              << "nrMono2PointRansacs_: " << nrMono2PointRansacs_ << "\n"
+              << "nrMono2PointFallbacks_: " << nrMono2PointFallbacks_ << "\n"
               << "nrValidRKP_: " << nrValidRKP_ << "\n"
               << "nrNoLeftRectRKP_: " << nrNoLeftRectRKP_ << "\n"
               << "nrNoRightRectRKP_: " << nrNoRightRectRKP_ << "\n"
@@ -25,13 +25,18 @@
 
 #include <optional>
 
+#include "kimera-vio/common/LandmarkStore.h"
 #include "kimera-vio/frontend/Camera.h"
 #include "kimera-vio/frontend/CameraParams.h"
+#include "kimera-vio/frontend/FixedWindowKlt.h"
 #include "kimera-vio/frontend/Frame.h"
+#include "kimera-vio/frontend/GpuSparseOpticalFlow.h"
+#include "kimera-vio/frontend/ParallelRansac.h"
 #include "kimera-vio/frontend/StereoFrame.h"
 #include "kimera-vio/frontend/Tracker-definitions.h"
 #include "kimera-vio/frontend/VisionImuTrackerParams.h"
 #include "kimera-vio/frontend/optical-flow/OpticalFlowPredictor.h"
+#include "kimera-vio/utils/LowPriorityWorker.h"
 #include "kimera-vio/utils/Macros.h"
 #include "kimera-vio/visualizer/Display-definitions.h"
 
@@ -43,6 +48,27 @@ namespace VIO {
 class DisplayInputBase;
 using DisplayQueue = ThreadsafeQueue<std::unique_ptr<DisplayInputBase>>;
 
+/**
+ * @brief The TrackerImageInput struct: what the tracker image is drawn from,
+ * copied out of the frames so that it can be drawn in another thread.
+ * Only the image header is copied: frame images are never modified.
+ */
+struct TrackerImageInput {
+  TrackerImageInput() = default;
+  TrackerImageInput(const Frame& ref_frame,
+                    const Frame& cur_frame,
+                    const KeypointsCV& extra_corners_gray = KeypointsCV(),
+                    const KeypointsCV& extra_corners_blue = KeypointsCV());
+
+  cv::Mat cur_img_;
+  KeypointsCV ref_keypoints_;
+  LandmarkIds ref_landmarks_;
+  KeypointsCV cur_keypoints_;
+  LandmarkIds cur_landmarks_;
+  KeypointsCV extra_corners_gray_;
+  KeypointsCV extra_corners_blue_;
+};
+
 class Tracker {
  public:
   KIMERA_POINTER_TYPEDEFS(Tracker);
@@ -60,6 +86,12 @@ class Tracker {
 
   virtual ~Tracker() = default;
 
+  //! Draws the debug images in the given worker (if not null), which must
+  //! outlive the tracker.
+  inline void setDebugImageWorker(utils::LowPriorityWorker* worker) {
+    debug_image_worker_ = worker;
+  }
+
   // Tracker parameters.
   const TrackerParams tracker_params_;
 
@@ -67,11 +99,47 @@ class Tracker {
   cv::Mat cam_mask_;
 
  public:
-  void featureTracking(Frame* ref_frame,
-                       Frame* cur_frame,
-                       const gtsam::Rot3& inter_frame_rotation,
-                       const FeatureDetectorParams& feature_detector_params,
-                       std::optional<cv::Mat> R = std::nullopt);
+  /**
+   * @brief featureTracking Tracks the keypoints of ref_frame in cur_frame.
+   * @param inter_frame_rotation Rotation of cur_frame wrt ref_frame.
+   * @param R Rectification rotation, for stereo cameras.
+   * @param inter_frame_pose Optional pose prior of cur_frame wrt ref_frame.
+   * @param ref_depths Depth of each keypoint of ref_frame (non-positive if
+   * unknown), required if inter_frame_pose is given.
+   * Pose and depths are only used by the roto-translational optical flow
+   * predictor, which then also allows a cheaper KLT (see
+   * klt_max_level_with_motion_prior_ and klt_max_iter_with_motion_prior_).
+   * @param compute_versors If false, the versors of cur_frame are left empty
+   * (e.g. to compute them only if it becomes a keyframe).
+   */
+  void featureTracking(
+      Frame* ref_frame,
+      Frame* cur_frame,
+      const gtsam::Rot3& inter_frame_rotation,
+      const FeatureDetectorParams& feature_detector_params,
+      std::optional<cv::Mat> R = std::nullopt,
+      const std::optional<gtsam::Pose3>& inter_frame_pose = std::nullopt,
+      const std::vector<double>& ref_depths = std::vector<double>(),
+      const bool& compute_versors = true);
+
+  /**
+   * @brief buildOpticalFlowPyramid Builds the image pyramid of the frame with
+   * the KLT params, and caches it in the frame, so that featureTracking does
+   * not build it again. Does not depend on the inter-frame rotation, hence it
+   * can run while the IMU is preintegrated.
+   * When tracking on the GPU, starts the upload of the frame image instead.
+   */
+  void buildOpticalFlowPyramid(const Frame& frame) const;
+
+  //! Max KLT pyramid level and RANSAC iterations, initially those of the
+  //! tracker params, e.g. reduced under load (see FeatureBudgetController).
+  inline void setKltMaxLevel(const int& klt_max_level) {
+    CHECK_GE(klt_max_level, 0);
+    klt_max_level_ = klt_max_level;
+  }
+  inline int getKltMaxLevel() const { return klt_max_level_; }
+  void setRansacMaxIterations(const int& ransac_max_iterations);
+  inline int getRansacMaxIterations() const { return ransac_max_iterations_; }
 
   /**
    * @brief updateMap Updates the map of landmarks in the time horizon of
@@ -193,6 +261,9 @@ class Tracker {
       const KeypointsCV& extra_corners_blue = KeypointsCV()) const;
 
   /* ---------------------------- STATIC FUNCTIONS -------------------------- */
+  //! Same as getTrackerImage, but thread-safe.
+  static cv::Mat drawTrackerImage(const TrackerImageInput& input);
+
   static void findOutliers(const KeypointMatches& matches_ref_cur,
                            std::vector<int> inliers,
                            std::vector<int>* outliers);
@@ -234,7 +305,31 @@ class Tracker {
       const gtsam::Matrix3& stereo_point_covariance,
       std::optional<gtsam::Matrix3> Rmat);
 
+  //! Batched getPoint3AndCovariance for the given keypoints, with the Jacobian
+  //! of the stereo backprojection in closed form (fixed-size, no allocations
+  //! besides the outputs).
+  //! @param[out] points Optionally rotated by Rmat, one per point id.
+  //! @param[out] covariances Propagated covariances, one per point id.
+  static void getPoints3AndCovariances(
+      const StatusKeypointsCV& keypoints_undistorted_left,
+      const StatusKeypointsCV& keypoints_undistorted_right,
+      const BearingVectors& keypoints_3d,
+      const gtsam::StereoCamera& stereo_cam,
+      const std::vector<size_t>& point_ids,
+      const gtsam::Matrix3& stereo_point_covariance,
+      const std::optional<gtsam::Matrix3>& Rmat,
+      Vectors3* points,
+      Matrices3* covariances);
+
  private:
+  //! (landmark id, position of its keypoint) of the valid landmarks of a frame.
+  using LandmarkIndex = std::vector<std::pair<LandmarkId, size_t>>;
+
+  //! Sorted by landmark id, landmarks must be unique in a frame.
+  //! @return True if the landmarks were already sorted.
+  static bool buildLandmarkIndex(const LandmarkIds& landmarks,
+                                 LandmarkIndex* lm_index);
+
   /**
    * @brief runRansac
    * @param [in] sample_consensus_problem_ptr
@@ -243,6 +338,8 @@ class Tracker {
    * @param [out] The best pose estimate
    * @param [out] inliers The inliers from the input data
    * @return true on success, false on failure.
+   * Uses the ParallelRansac engine if ransac_use_parallel_engine_ is set,
+   * OpenGV's RANSAC otherwise.
    */
   template <class SampleConsensusProblem>
   bool runRansac(
@@ -253,12 +350,43 @@ class Tracker {
       const bool& do_nonlinear_optimization,
       gtsam::Pose3* best_pose,
       std::vector<int>* inliers) {
+    if (tracker_params_.ransac_use_parallel_engine_) {
+      ParallelRansac<SampleConsensusProblem> ransac(
+          max_iterations,
+          threshold,
+          probability,
+          tracker_params_.ransac_batch_size_,
+          tracker_params_.ransac_preemptive_block_size_);
+      return runRansac(&ransac,
+                       sample_consensus_problem_ptr,
+                       max_iterations,
+                       do_nonlinear_optimization,
+                       best_pose,
+                       inliers);
+    } else {
+      opengv::sac::Ransac<SampleConsensusProblem> ransac(
+          max_iterations, threshold, probability);
+      return runRansac(&ransac,
+                       sample_consensus_problem_ptr,
+                       max_iterations,
+                       do_nonlinear_optimization,
+                       best_pose,
+                       inliers);
+    }
+  }
+
+  template <class RansacEngine, class SampleConsensusProblem>
+  bool runRansac(
+      RansacEngine* ransac_ptr,
+      std::shared_ptr<SampleConsensusProblem> sample_consensus_problem_ptr,
+      const int& max_iterations,
+      const bool& do_nonlinear_optimization,
+      gtsam::Pose3* best_pose,
+      std::vector<int>* inliers) {
+    CHECK_NOTNULL(ransac_ptr);
     CHECK_NOTNULL(best_pose);
     CHECK(sample_consensus_problem_ptr);
-
-    //! Create ransac
-    opengv::sac::Ransac<SampleConsensusProblem> ransac(
-        max_iterations, threshold, probability);
+    RansacEngine& ransac = *ransac_ptr;
 
     //! Setup ransac
     ransac.sac_model_ = sample_consensus_problem_ptr;
@@ -296,8 +424,8 @@ class Tracker {
   }
 
   // Printers
-  template <class T>
-  std::string printRansacStats(const opengv::sac::Ransac<T>& ransac,
+  template <class RansacEngine>
+  std::string printRansacStats(const RansacEngine& ransac,
                                const size_t& total_correspondences,
                                const std::string& ransac_type) const {
     std::stringstream out;
@@ -318,6 +446,10 @@ class Tracker {
   // Incremental id assigned to new landmarks.
   LandmarkId landmark_count_;
 
+  // Budgeted KLT and RANSAC params (see setKltMaxLevel).
+  int klt_max_level_;
+  int ransac_max_iterations_;
+
   // Camera object for the camera we are tracking. For stereo, use left.
   Camera::ConstPtr camera_;
 
@@ -325,9 +457,25 @@ class Tracker {
   // where the features moved from frame to frame.
   OpticalFlowPredictor::UniquePtr optical_flow_predictor_;
 
+  // KLT on the GPU, if requested and available.
+  GpuSparseOpticalFlow::UniquePtr gpu_optical_flow_;
+
+  // KLT specialized for the window size, if requested and not on the GPU.
+  FixedWindowKlt::UniquePtr fixed_window_klt_;
+
+  // Scratch buffers for feature tracking, reused across frames to avoid
+  // allocations on the tracking hot path.
+  KeypointsCV klt_px_ref_;
+  std::vector<size_t> klt_ref_indices_;
+  std::vector<uchar> klt_status_;
+  std::vector<float> klt_error_;
+
   // Display queue: push to this queue if you want to display an image.
   DisplayQueue* display_queue_;
 
+  // If set, debug images are drawn in this worker instead of while tracking.
+  utils::LowPriorityWorker* debug_image_worker_;
+
   // This is not const as for debugging we want to redirect the image save path
   // where we like.
   std::string output_images_path_;
@@ -76,6 +76,20 @@ class UndistorterRectifier {
       const CameraParams& cam_param,
       std::optional<cv::Mat> R = std::nullopt);
 
+  /**
+   * @brief GetBearingVectors Batch version of GetBearingVector: undistorts all
+   * keypoints in a single call, which avoids the per-keypoint setup and
+   * allocations of undistortPoints.
+   * @param keypoints Distorted keypoints.
+   * @param cam_param CameraParams instance
+   * @param bearing_vectors Versors of the keypoints (overwritten).
+   * @param R Optional rectification rotation.
+   */
+  static void GetBearingVectors(const KeypointsCV& keypoints,
+                                const CameraParams& cam_param,
+                                BearingVectors* bearing_vectors,
+                                std::optional<cv::Mat> R = std::nullopt);
+
   /**
    * @brief undistortRectifyImage Given distorted (and optionally non-rectified)
    * image, returns a distortion-free rectified one.
@@ -85,6 +99,27 @@ class UndistorterRectifier {
   void undistortRectifyImage(const cv::Mat& img,
                              cv::Mat* undistorted_img) const;
 
+  /**
+   * @brief undistortRectifyImage Same as above, but only computes the pixels
+   * of the undistorted rectified image inside the given roi (e.g. only the
+   * rows used downstream). Pixels outside the roi are left untouched, if the
+   * output image is already allocated with the right size and type, or set to
+   * zero otherwise.
+   * @param img Distorted non-rectified input image
+   * @param roi Region of the *output* (rectified) image to compute.
+   * @param undistorted_img Undistorted Rectified output image
+   */
+  void undistortRectifyImage(const cv::Mat& img,
+                             const cv::Rect& roi,
+                             cv::Mat* undistorted_img) const;
+
+  /**
+   * @brief getRectifiedRoi Bounding box, in the undistorted rectified image,
+   * of the non-zero pixels of a mask of the distorted image (e.g. the region
+   * of interest of the camera, see CameraParams::roi_mask_).
+   */
+  cv::Rect getRectifiedRoi(const cv::Mat& mask) const;
+
   /**
    * @brief undistortRectifyKeypoints Undistorts and rectifies a sparse set of
    * keypoints (instead of a whole image), using OpenCV undistortPoints.
@@ -113,6 +148,18 @@ class UndistorterRectifier {
   void distortUnrectifyKeypoints(const StatusKeypointsCV& keypoints_rectified,
                                  KeypointsCV* keypoints_unrectified) const;
 
+  //! Floating point maps and remap flags, e.g. for cv::cuda::remap (which
+  //! does not take the fixed-point maps).
+  inline const cv::Mat& getMapX() const { return map_x_; }
+  inline const cv::Mat& getMapY() const { return map_y_; }
+  inline int getRemapInterpolationType() const {
+    return remap_interpolation_type_;
+  }
+  inline int getRemapBorderType() const {
+    return remap_use_constant_border_type_ ? cv::BORDER_CONSTANT
+                                           : cv::BORDER_REPLICATE;
+  }
+
  protected:
   /**
    * @brief initUndistortRectifyMaps Initialize pixel to pixel maps for
@@ -148,9 +195,30 @@ class UndistorterRectifier {
                                 cv::Mat* map_y);
 
  protected:
+  /**
+   * @brief initFixedPointMaps Converts the floating point maps to the compact
+   * fixed-point representation (CV_16SC2 + CV_16UC1) used by cv::remap, which
+   * roughly halves the memory bandwidth of remapping.
+   */
+  void initFixedPointMaps();
+
+  //! Maps to use for remapping images.
+  inline const cv::Mat& remapMap1() const {
+    return fixed_map_xy_.empty() ? map_x_ : fixed_map_xy_;
+  }
+  inline const cv::Mat& remapMap2() const {
+    return fixed_map_xy_.empty() ? map_y_ : fixed_map_interp_;
+  }
+
+ protected:
+  //! Floating point maps, needed for per-keypoint lookups.
   cv::Mat map_x_;
   cv::Mat map_y_;
 
+  //! Optional fixed-point maps, used for remapping images if not empty.
+  cv::Mat fixed_map_xy_;
+  cv::Mat fixed_map_interp_;
+
   cv::Mat P_;
   cv::Mat R_;
 
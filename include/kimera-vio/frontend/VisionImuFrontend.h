@@ -17,11 +17,17 @@
 #include <gflags/gflags.h>
 
 #include <atomic>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <optional>
 
+#include "kimera-vio/common/VioNavState.h"
+#include "kimera-vio/frontend/FeatureBudgetController.h"
 #include "kimera-vio/frontend/FrontendInputPacketBase.h"
 #include "kimera-vio/frontend/FrontendOutputPacketBase.h"
 #include "kimera-vio/frontend/OdometryParams.h"
+#include "kimera-vio/frontend/StationaryDetector.h"
 #include "kimera-vio/frontend/Tracker.h"
 #include "kimera-vio/frontend/feature-detector/FeatureDetector.h"
 #include "kimera-vio/imu-frontend/ImuFrontend-definitions.h"
@@ -30,6 +36,8 @@
 #include "kimera-vio/initial/TimeAlignerBase.h"
 #include "kimera-vio/logging/Logger.h"
 #include "kimera-vio/pipeline/PipelineModule.h"
+#include "kimera-vio/utils/LowPriorityWorker.h"
+#include "kimera-vio/utils/TaskGraph.h"
 #include "kimera-vio/visualizer/Display-definitions.h"
 #include "kimera-vio/visualizer/Visualizer3D-definitions.h"
 
@@ -39,6 +47,8 @@ DECLARE_bool(save_frontend_images);
 DECLARE_bool(log_feature_tracks);
 DECLARE_bool(log_mono_tracking_images);
 DECLARE_bool(log_stereo_matching_images);
+DECLARE_bool(frontend_parallel_imu_preintegration);
+DECLARE_bool(frontend_async_debug_images);
 
 namespace VIO {
 
@@ -79,6 +89,29 @@ class VisionImuFrontend {
     tracker_->updateMap(map);
   }
 
+  /**
+   * @brief updateNavState Update the state of the last keyframe with the most
+   * recent backend estimate. Only needed to predict inter-frame translations
+   * from the IMU preintegration. Thread-safe.
+   * @param W_State_Blkf
+   */
+  void updateNavState(const VioNavStateTimestamped& W_State_Blkf) const {
+    std::lock_guard<std::mutex> lock(W_State_Blkf_mtx_);
+    W_State_Blkf_ = W_State_Blkf;
+  }
+
+  /**
+   * @brief setFeatureBudgetScale Scales the max nr of features detected per
+   * frame (on top of the adaptive feature budget, if any) from the next
+   * keyframe on. Thread-safe.
+   * @param scale In ]0, 1].
+   */
+  inline void setFeatureBudgetScale(const double& scale) {
+    CHECK_GT(scale, 0.0);
+    CHECK_LE(scale, 1.0);
+    feature_budget_scale_ = scale;
+  }
+
   /* ------------------------------------------------------------------------ */
   /**
    * @brief isInitialized Returns whether the Frontend is initializing.
@@ -138,6 +171,22 @@ class VisionImuFrontend {
 
   virtual bool shouldBeKeyframe(const Frame& frame, const Frame& lkf) const;
 
+  //! Whether the frames in between keyframes are only tracked (see
+  //! keyframe_only_processing_). Not while time aligning, which uses the
+  //! versors of all frames.
+  inline bool isKeyframeOnlyProcessing() const {
+    return frontend_params_.keyframe_only_processing_ &&
+           frontend_state_ == FrontendState::Nominal;
+  }
+
+  /**
+   * @brief updateIdleMode Feeds the median disparity of the frame wrt the
+   * last keyframe to the stationary detector, if any, and logs the idle mode
+   * transitions, with the gyroscope bias error measured while idle.
+   * @return True if in idle mode.
+   */
+  bool updateIdleMode(const Frame& frame, const double& disparity) const;
+
   /* ------------------------------------------------------------------------ */
   // Reset ImuFrontend gravity. Trivial gravity is needed for initial alignment.
   // This is thread-safe as imu_frontend_->resetPreintegrationGravity is
@@ -154,10 +203,38 @@ class VisionImuFrontend {
     return imu_frontend_->getPreintegrationGravity();
   }
 
+  /**
+   * @brief preintegrateImuWhile Preintegrates the IMU measurements of the
+   * current frame while running vision_work, i.e. the image processing that
+   * does not need the IMU rotation prior (copying the frame, building its
+   * pyramid...). If frontend_parallel_imu_preintegration is set, the
+   * preintegration runs in the thread of imu_preintegration_graph_ and is
+   * joined before returning, otherwise both run one after the other.
+   * @return The preintegration since the last keyframe.
+   */
+  ImuFrontend::PimPtr preintegrateImuWhile(
+      const ImuStampS& imu_stamps,
+      const ImuAccGyrS& imu_accgyrs,
+      const std::function<void()>& vision_work);
+
+  /**
+   * @brief predictBodyPoseFromImu Relative pose of the current body frame wrt
+   * the last keyframe body frame, predicted with the IMU preintegration and
+   * the backend estimate of the last keyframe velocity and attitude
+   * (see updateNavState).
+   * @param pim Preintegration since the last keyframe.
+   * @return The pose, or nullopt if the backend has not yet estimated the
+   * state of the last keyframe.
+   */
+  std::optional<gtsam::Pose3> predictBodyPoseFromImu(
+      const ImuFrontend::PimPtr& pim) const;
+
+  //! @param tracker Tracker of the camera of the frames, tracker_ if null.
   void outlierRejectionMono(const gtsam::Rot3& keyframe_R_cur_frame,
                             Frame* frame_lkf,
                             Frame* frame_k,
-                            TrackingStatusPose* status_pose_mono) const;
+                            TrackingStatusPose* status_pose_mono,
+                            Tracker* tracker = nullptr) const;
 
   void outlierRejectionStereo(const gtsam::StereoCamera& stereo_camera,
                               const gtsam::Rot3& keyframe_R_cur_frame,
@@ -178,6 +255,34 @@ class VisionImuFrontend {
   std::optional<gtsam::Velocity3> getExternalOdometryWorldVelocity(
       FrontendInputPacketBase* input) const;
 
+  /**
+   * @brief runDebugImageJob Runs the job drawing debug images (and sending
+   * them to the logger or the display) in the debug image worker, or right
+   * away if there is none. The job must own copies of the data it draws.
+   */
+  void runDebugImageJob(utils::LowPriorityWorker::Job job) const;
+
+  /**
+   * @brief updateFeatureBudget Feeds the time of the last keyframe (plus the
+   * last backend compute time, if requested) to the feature budget
+   * controller, if any, and applies its decisions and the feature budget
+   * scale to the tracker_ and the given feature detector.
+   */
+  void updateFeatureBudget(const double& keyframe_time_ms,
+                           FeatureDetector* feature_detector);
+
+  //! Matches (ref idx, cur idx) between the keypoints of the same landmarks.
+  static DMatchVec findLandmarkMatches(const LandmarkIds& ref_landmarks,
+                                       const LandmarkIds& cur_landmarks);
+
+  /**
+   * @brief drawMonoTrackingImage Draws the ref image next to the current one
+   * (see TrackerImageInput), with the keypoint matches between them.
+   */
+  static cv::Mat drawMonoTrackingImage(const cv::Mat& ref_img,
+                                       const TrackerImageInput& input,
+                                       const int& keyframe_count);
+
  protected:
   //! Parameters
   FrontendParams frontend_params_;
@@ -199,6 +304,9 @@ class VisionImuFrontend {
 
   // IMU Frontend.
   ImuFrontend::UniquePtr imu_frontend_;
+  // Preintegrates the IMU while the vision work of the frame runs, if
+  // frontend_parallel_imu_preintegration (nullptr if not).
+  utils::TaskGraph::UniquePtr imu_preintegration_graph_;
 
   // Tracker
   Tracker::UniquePtr tracker_;
@@ -210,14 +318,30 @@ class VisionImuFrontend {
   // Logger
   FrontendLogger::UniquePtr logger_;
 
+  // Draws, saves and displays the debug images off the frontend thread, if
+  // not null. Declared after the logger, which its jobs use.
+  utils::LowPriorityWorker::UniquePtr debug_image_worker_;
+
   // Time alignment
   ImuTimeShiftCallback imu_time_shift_update_callback_;
   TimeAlignerBase::UniquePtr time_aligner_;
 
   // External odometry
   std::optional<OdometryParams> odom_params_;
+
+  // Adapts the frontend budget to the latency, if adaptive_feature_budget_.
+  FeatureBudgetController::UniquePtr feature_budget_controller_;
+  // See setFeatureBudgetScale, and the scale applied to the feature detector.
+  std::atomic<double> feature_budget_scale_;
+  double applied_feature_budget_scale_;
+  // Detects the platform standing still, if use_idle_mode_.
+  StationaryDetector::UniquePtr stationary_detector_;
   // world_Pose_body for the last keyframe
   std::optional<gtsam::Pose3> world_OdomPose_body_lkf_;
+
+  // Backend estimate of the state of the last keyframe.
+  mutable std::mutex W_State_Blkf_mtx_;
+  mutable std::optional<VioNavStateTimestamped> W_State_Blkf_;
 };
 
 }  // namespace VIO
@@ -14,7 +14,10 @@
 
 #pragma once
 
+#include <vector>
+
 #include "kimera-vio/frontend/MonoVisionImuFrontend.h"
+#include "kimera-vio/frontend/MultiCameraVisionImuFrontend.h"
 #include "kimera-vio/frontend/StereoVisionImuFrontend.h"
 #include "kimera-vio/frontend/VisionImuFrontend.h"
 #include "kimera-vio/imu-frontend/ImuFrontend-definitions.h"
@@ -52,11 +55,22 @@ class VisionImuFrontendFactory {
         LOG(FATAL) << "Tried to create a StereoVisionFrontEnd"
                    << "with a Mono Camera!";
       }
+      case FrontendType::kMultiCameraImu: {
+        return std::make_unique<MultiCameraVisionImuFrontend>(
+            frontend_params,
+            imu_params,
+            imu_initial_bias,
+            std::vector<Camera::ConstPtr>{camera},
+            display_queue,
+            log_output,
+            odom_params);
+      }
       default: {
         LOG(FATAL) << "Requested frontend type is not supported.\n"
                    << "Currently supported frontend types:\n"
                    << "0: Mono + IMU \n"
                    << "1: Stereo + IMU \n"
+                   << "3: Multi-camera + IMU \n"
                    << " but requested frontend: "
                    << static_cast<int>(frontend_type);
       }
@@ -92,11 +106,43 @@ class VisionImuFrontendFactory {
                    << "Currently supported frontend types:\n"
                    << "0: Mono + IMU \n"
                    << "1: Stereo + IMU \n"
+                   << "3: Multi-camera + IMU \n"
                    << " but requested frontend: "
                    << static_cast<int>(frontend_type);
       }
     }
   }
+
+  // Multi-camera version: feed one VIO::Camera per camera, the first one is
+  // the reference camera.
+  static VisionImuFrontend::UniquePtr createFrontend(
+      const FrontendType& frontend_type,
+      const ImuParams& imu_params,
+      const ImuBias& imu_initial_bias,
+      const FrontendParams& frontend_params,
+      const std::vector<Camera::ConstPtr>& cameras,
+      DisplayQueue* display_queue,
+      bool log_output,
+      std::optional<OdometryParams> odom_params) {
+    switch (frontend_type) {
+      case FrontendType::kMultiCameraImu: {
+        return std::make_unique<MultiCameraVisionImuFrontend>(frontend_params,
+                                                              imu_params,
+                                                              imu_initial_bias,
+                                                              cameras,
+                                                              display_queue,
+                                                              log_output,
+                                                              odom_params);
+      }
+      default: {
+        LOG(FATAL) << "Tried to create a frontend of type: "
+                   << static_cast<int>(frontend_type)
+                   << " with several cameras, only the multi-camera frontend ("
+                   << static_cast<int>(FrontendType::kMultiCameraImu)
+                   << ") supports them.";
+      }
+    }
+  }
 };
 
 }  // namespace VIO
@@ -14,9 +14,17 @@
 
 #pragma once
 
+#include <atomic>
+#include <deque>
+#include <mutex>
+
+#include <gflags/gflags.h>
+
 #include "kimera-vio/frontend/VisionImuFrontend.h"
 #include "kimera-vio/pipeline/PipelineModule.h"
 
+DECLARE_int32(frontend_latency_budget_ms);
+
 namespace VIO {
 
 class VisionImuFrontendModule
@@ -30,6 +38,7 @@ class VisionImuFrontendModule
   using SIMO =
       SIMOPipelineModule<FrontendInputPacketBase, FrontendOutputPacketBase>;
   using InputQueue = ThreadsafeQueue<typename SIMO::InputUniquePtr>;
+  using InputQueueBase = typename SIMO::InputQueueBase;
 
   /**
    * @brief VisionImuFrontendModule
@@ -38,7 +47,7 @@ class VisionImuFrontendModule
    * @param parallel_run
    * @param vio_frontend
    */
-  explicit VisionImuFrontendModule(InputQueue* input_queue,
+  explicit VisionImuFrontendModule(InputQueueBase* input_queue,
                                    bool parallel_run,
                                    VisionImuFrontend::UniquePtr vio_frontend);
 
@@ -68,13 +77,66 @@ class VisionImuFrontendModule
     vio_frontend_->updateMap(map);
   }
 
+  inline void updateNavState(const VioNavStateTimestamped& W_State_Blkf) const {
+    vio_frontend_->updateNavState(W_State_Blkf);
+  }
+
   inline void registerImuTimeShiftUpdateCallback(
       const VisionImuFrontend::ImuTimeShiftCallback& callback) {
     vio_frontend_->registerImuTimeShiftUpdateCallback(callback);
   }
 
+  //! Nr of input packets dropped to stay within the latency budget.
+  inline size_t getNrDroppedFrames() const { return nr_dropped_frames_; }
+
+  //! See VisionImuFrontend::setFeatureBudgetScale.
+  inline void setFeatureBudgetScale(const double& scale) {
+    vio_frontend_->setFeatureBudgetScale(scale);
+  }
+
+  /**
+   * @brief setFrameDecimation Once the Frontend is initialized, it processes
+   * one frame out of this many (1 for all of them): the IMU measurements of
+   * the skipped frames are merged in the next processed one. Can be called
+   * while the module spins (e.g. when switching execution profiles).
+   */
+  inline void setFrameDecimation(const size_t& decimation) {
+    CHECK_GT(decimation, 0u);
+    frame_decimation_ = decimation;
+  }
+
+ protected:
+  /**
+   * @brief getInputPacket In latency-bounded mode (parallel run and
+   * frontend_latency_budget_ms > 0), drains the input queue and drops the
+   * oldest packets while the newest one is more than the latency budget
+   * ahead of them (in sensor time). The IMU measurements of dropped packets
+   * are merged in the next packet, so that the IMU preintegration is not
+   * interrupted. Then skips the packets removed by the frame decimation, the
+   * same way.
+   */
+  InputUniquePtr getInputPacket() override;
+
+  bool hasWork() const override;
+
+ private:
+  //! The next packet, latency-bounded if requested.
+  InputUniquePtr getLatencyBoundedInputPacket();
+
  private:
   VisionImuFrontend::UniquePtr vio_frontend_;
+
+  //! Packets drained from the input queue in latency-bounded mode.
+  mutable std::mutex backlog_mutex_;
+  std::deque<InputUniquePtr> backlog_;
+  std::atomic<size_t> nr_dropped_frames_;
+
+  //! See setFrameDecimation.
+  std::atomic<size_t> frame_decimation_;
+  size_t nr_decimated_frames_;
+  //! The last packet skipped by the frame decimation, its IMU measurements
+  //! not yet merged in a processed packet.
+  InputUniquePtr skipped_input_;
 };
 
 }  // namespace VIO
@@ -14,6 +14,8 @@
 
 #pragma once
 
+#include "kimera-vio/frontend/FeatureBudgetController.h"
+#include "kimera-vio/frontend/StationaryDetector.h"
 #include "kimera-vio/frontend/StereoMatchingParams.h"
 #include "kimera-vio/frontend/VisionImuTrackerParams.h"
 #include "kimera-vio/frontend/feature-detector/FeatureDetector-definitions.h"
@@ -40,6 +42,11 @@ struct FrontendParams : public PipelineParams {
     return equals(rhs);
   }
 
+ private:
+  //! Converts the pixel sizes and thresholds, given for the original images,
+  //! to images downscaled by the given factor.
+  void downscalePixelParams(const int& factor);
+
  public:
   FeatureDetectorParams feature_detector_params_ = FeatureDetectorParams();
   TrackerParams tracker_params_ = TrackerParams();
@@ -48,6 +55,33 @@ struct FrontendParams : public PipelineParams {
   double min_intra_keyframe_time_ns_ = 0.2 * 10e6;
   double max_intra_keyframe_time_ns_ = 10.0 * 10e6;
   size_t min_number_features_ = 0u;
+  //! Only track the frames in between keyframes with KLT: their versors and
+  //! debug images are only computed if they become keyframes, and in stereo
+  //! their right image is only rectified on the GPU if they become keyframes.
+  bool keyframe_only_processing_ = false;
+  //! Adapt maxFeaturesPerFrame, klt_max_level and ransac_max_iterations at
+  //! each keyframe to meet a target latency (see FeatureBudgetController).
+  bool adaptive_feature_budget_ = false;
+  FeatureBudgetControllerParams feature_budget_params_;
+  //! Add the last backend compute time to the frontend keyframe time.
+  bool feature_budget_include_backend_ = true;
+  //! Stop creating keyframes while the platform stands still, until motion
+  //! resumes (see StationaryDetector).
+  bool use_idle_mode_ = false;
+  StationaryDetectorParams idle_params_;
+
+  //! Process the images downscaled by this factor (2 for half resolution),
+  //! with an area filter at ingestion. The camera params are adapted by
+  //! VioParams, and the pixel params of the frontend are still given for the
+  //! original images.
+  int image_downscale_factor_ = 1;
+  //! Detect features in the frames in between keyframes on a worker thread,
+  //! for the next keyframe to only filter them (see
+  //! SpeculativeFeatureDetector).
+  bool speculative_feature_detection_ = false;
+  //! Rectify and detect feature candidates on the GPU, if available (stereo
+  //! only, see GpuImagePreprocessor).
+  bool use_gpu_preprocessing_ = false;
 
   //! If set to false, pipeline reduces to monocular tracking.
   bool use_stereo_tracking_ = true;
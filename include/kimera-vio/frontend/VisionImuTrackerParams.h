@@ -45,6 +45,12 @@ struct TrackerParams : public PipelineParams {
 
   //! The desired accuracy for KLT
   double klt_eps_ = 0.01;
+  //! Track on the GPU (OpenCV CUDA KLT) if available. The GPU KLT stops
+  //! after klt_max_iter_ iterations only, it ignores klt_eps_.
+  bool klt_use_cuda_ = false;
+  //! Track on the CPU with the FixedWindowKlt instead of OpenCV's KLT, if it
+  //! has a kernel for klt_win_size_ (15, 21, 24 or 31).
+  bool klt_use_fixed_window_kernel_ = false;
 
   //! We cut feature tracks longer than that
   size_t max_feature_track_age_ = 25;
@@ -63,7 +69,18 @@ struct TrackerParams : public PipelineParams {
   bool ransac_randomize_ = true;
   bool ransac_use_1point_stereo_ = true;
   bool ransac_use_2point_mono_ = true;
-  
+  //! Always use the gyro rotation prior for 2-point mono RANSAC, and fall back
+  //! to 5-point only if the 2-point inlier ratio is below the given ratio.
+  bool ransac_use_2point_fast_path_ = false;
+  double ransac_2point_fallback_inlier_ratio_ = 0.5;
+  //! Use the multi-threaded ParallelRansac engine instead of OpenGV's RANSAC.
+  bool ransac_use_parallel_engine_ = false;
+  //! Nr of hypotheses generated and scored in parallel per batch.
+  int ransac_batch_size_ = 32;
+  //! Nr of correspondences scored before halving the hypotheses of a batch
+  //! (preemptive RANSAC), 0 to score all hypotheses on all correspondences.
+  int ransac_preemptive_block_size_ = 0;
+
   //! Use 2D-2D tracking to remove outliers
   Pose2d2dAlgorithm pose_2d2d_algorithm_ = Pose2d2dAlgorithm::NISTER;
   bool optimize_2d2d_pose_from_inliers_ = false;
@@ -78,6 +95,10 @@ struct TrackerParams : public PipelineParams {
   //! Optical flow
   OpticalFlowPredictorType optical_flow_predictor_type_ =
       OpticalFlowPredictorType::kNoPrediction;
+  //! KLT pyramid levels/iterations when the roto-translational predictor has
+  //! a motion prior (negative: use klt_max_level_/klt_max_iter_).
+  int klt_max_level_with_motion_prior_ = -1;
+  int klt_max_iter_with_motion_prior_ = -1;
 
   //! Others:
   // max disparity under which we consider the vehicle steady
@@ -22,6 +22,7 @@
 #include "kimera-vio/frontend/Frame.h"
 #include "kimera-vio/frontend/feature-detector/FeatureDetector-definitions.h"
 #include "kimera-vio/frontend/feature-detector/FeatureDetectorParams.h"
+#include "kimera-vio/frontend/feature-detector/FeatureOccupancyGrid.h"
 #include "kimera-vio/frontend/feature-detector/NonMaximumSuppression.h"
 #include "kimera-vio/utils/Macros.h"
 
@@ -36,26 +37,87 @@ class FeatureDetector {
   virtual ~FeatureDetector() = default;
 
  public:
-  void featureDetection(Frame* cur_frame,
-                        std::optional<cv::Mat> R = std::nullopt);
+  /**
+   * @brief featureDetection Detects new features where there are no tracked
+   * ones, and adds them to the frame.
+   * @param candidates Optional keypoints detected ahead of time (see
+   * detectCandidates and SpeculativeFeatureDetector): only filtered and
+   * suppressed, instead of detecting in the image.
+   */
+  void featureDetection(
+      Frame* cur_frame,
+      std::optional<cv::Mat> R = std::nullopt,
+      const std::vector<cv::KeyPoint>* candidates = nullptr);
+
+  /**
+   * @brief detectCandidates Raw (or grid) detection in the whole image,
+   * without the tracked features: the expensive part of featureDetection,
+   * which can run before the tracked features are known.
+   * @param roi Optional part of the image to detect in (e.g. the bounding box
+   * of the region of interest of the camera), empty for the whole image.
+   */
+  std::vector<cv::KeyPoint> detectCandidates(const cv::Mat& img,
+                                             const cv::Mat& mask = cv::Mat(),
+                                             const cv::Rect& roi = cv::Rect());
+
+  //! Nr of features to have after detection, initially max_features_per_frame_
+  //! of the params, e.g. reduced under load (see FeatureBudgetController).
+  inline void setMaxFeaturesPerFrame(const int& max_features_per_frame) {
+    CHECK_GT(max_features_per_frame, 0);
+    max_features_per_frame_ = max_features_per_frame;
+  }
+  inline int getMaxFeaturesPerFrame() const { return max_features_per_frame_; }
 
   /**
    * @brief rawFeatureDetection Raw feature detection: in image, out keypoints
    * @param img
+   * @param roi Optional part of the image to detect in, empty for all of it.
    * @return keypoints
    */
   std::vector<cv::KeyPoint> rawFeatureDetection(
       const cv::Mat& img,
-      const cv::Mat& mask = cv::Mat());
+      const cv::Mat& mask = cv::Mat(),
+      const cv::Rect& roi = cv::Rect());
+
+  /**
+   * @brief gridFeatureDetection Tiled feature detection: splits the image in
+   * grid_detection_rows_ x grid_detection_cols_ cells and detects keypoints in
+   * each cell in parallel, with a budget of max_nr_keypoints_before_anms_ /
+   * nr_cells keypoints per cell.
+   * @param img
+   * @param mask
+   * @param occupancy_grid Optional tracked features: detections close to them
+   * are dropped, and cells with enough of them are not detected.
+   * @param roi Optional part of the image to detect in: cells are cropped to
+   * it, and those outside are skipped. Empty for the whole image.
+   * @return keypoints of all cells, in image coordinates.
+   */
+  std::vector<cv::KeyPoint> gridFeatureDetection(
+      const cv::Mat& img,
+      const cv::Mat& mask = cv::Mat(),
+      const FeatureOccupancyGrid* occupancy_grid = nullptr,
+      const cv::Rect& roi = cv::Rect());
 
  private:
+  //! Candidates inside the image, the mask and the free cells of the grid.
+  static std::vector<cv::KeyPoint> filterCandidates(
+      const std::vector<cv::KeyPoint>& candidates,
+      const cv::Mat& mask,
+      const cv::Size& img_size,
+      const FeatureOccupancyGrid* occupancy_grid = nullptr);
+
+  cv::Ptr<cv::Feature2D> createFeatureDetector(
+      const int& max_nr_keypoints) const;
+
   // Returns landmark_count (updated from the new keypoints),
   // and nr or extracted corners.
   KeypointsCV featureDetection(const Frame& cur_frame,
-                               const int& need_n_corners);
+                               const int& need_n_corners,
+                               const std::vector<cv::KeyPoint>* candidates);
 
   // Parameters.
   const FeatureDetectorParams feature_detector_params_;
+  int max_features_per_frame_;
 
   // TODO(TOni): should be debug feature detector info...
   // Debug info.
@@ -66,6 +128,12 @@ class FeatureDetector {
 
   // Actual feature detector implementation.
   cv::Ptr<cv::Feature2D> feature_detector_;
+
+  // One detector per grid cell, only used if grid detection is enabled.
+  std::vector<cv::Ptr<cv::Feature2D>> grid_feature_detectors_;
+
+  // Tracked features, refilled at each detection (if enabled).
+  FeatureOccupancyGrid occupancy_grid_;
 };
 
 }  // namespace VIO
@@ -94,6 +94,22 @@ struct FeatureDetectorParams : public PipelineParams {
   int nr_vertical_bins_ = 5;
   //! Binary mask by the user to control which bins to use
   Eigen::MatrixXd binning_mask_;
+  //! Whether to detect features independently (and in parallel) in each cell
+  //! of a grid, with a per-cell budget of keypoints, before non-max
+  //! suppression.
+  bool enable_grid_detection_ = false;
+  //! Number of rows of the detection grid
+  int grid_detection_rows_ = 4;
+  //! Number of cols of the detection grid
+  int grid_detection_cols_ = 4;
+  //! Padding [px] around each cell so that corners close to the cell limits
+  //! are detected as in the full image.
+  int grid_detection_cell_border_ = 8;
+  //! Reject detections near tracked features with a coarse occupancy grid of
+  //! the tracked features instead of drawing a full resolution mask. With
+  //! grid detection, cells that already have their share of
+  //! max_features_per_frame_ tracked features are not detected at all.
+  bool enable_occupancy_grid_ = false;
 
   // GFTT specific parameters
   double quality_level_ = 0.001;
@@ -0,0 +1,76 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   FeatureOccupancyGrid.h
+ * @brief  Coarse grid of the tracked keypoints, to reject detections close to
+ * them without drawing a full resolution mask.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The FeatureOccupancyGrid class buckets keypoints in square cells of
+ * the minimum distance between keypoints, so that checking whether a new
+ * keypoint is too close to any of them only looks at the 3x3 neighbouring
+ * cells. The cells keep their memory across reset() calls, hence refilling
+ * the grid at each keyframe does not allocate once warmed up.
+ */
+class FeatureOccupancyGrid {
+ public:
+  KIMERA_POINTER_TYPEDEFS(FeatureOccupancyGrid);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(FeatureOccupancyGrid);
+
+  //! @param min_distance Keypoints closer than this [px] to an occupied
+  //! position are rejected (no rejection if non-positive).
+  explicit FeatureOccupancyGrid(const int& min_distance);
+  ~FeatureOccupancyGrid() = default;
+
+  //! Empties the grid, and resizes it for images of the given size.
+  void reset(const cv::Size& img_size);
+
+  //! Marks the position of a (tracked) keypoint as occupied.
+  void add(const KeypointCV& keypoint);
+
+  //! Whether there is no occupied position closer than min_distance.
+  bool isFree(const KeypointCV& keypoint) const;
+
+  //! Nr of occupied positions inside the given rectangle.
+  size_t count(const cv::Rect& rect) const;
+
+  inline size_t size() const { return nr_keypoints_; }
+
+ private:
+  inline int cellIndex(const int& cell_x, const int& cell_y) const {
+    return cell_y * grid_cols_ + cell_x;
+  }
+
+  int cellX(const float& x) const;
+  int cellY(const float& y) const;
+
+ private:
+  const int min_distance_;
+  //! Cells are min_distance_ wide, or a fixed size without min distance.
+  const int cell_size_;
+  int grid_cols_ = 0;
+  int grid_rows_ = 0;
+  std::vector<KeypointsCV> cells_;
+  size_t nr_keypoints_ = 0u;
+};
+
+}  // namespace VIO
@@ -44,6 +44,13 @@ class NonMaximumSuppression {
       const int& nr_horizontal_bins,
       const int& nr_vertical_bins,
       const Eigen::MatrixXd& binning_mask) = 0;
+
+  /**
+   * @brief setTrackedKeypoints keypoints that survived tracking since the last
+   * keyframe. Algorithms that keep state between keyframes use them to seed
+   * the suppression, others simply ignore them.
+   */
+  virtual void setTrackedKeypoints(const KeypointsCV& /*tracked_keypoints*/) {}
 };
 
 /**
@@ -56,7 +63,8 @@ enum class AnmsAlgorithmType : unsigned int {
   KdTree = 3,
   RangeTree = 4,
   Ssc = 5,
-  Binning = 6
+  Binning = 6,
+  Incremental = 7
 };
 
 /**
@@ -94,6 +102,29 @@ class AdaptiveNonMaximumSuppression : public NonMaximumSuppression {
                                     const int& nr_vertical_bins,
                                     const Eigen::MatrixXd& binning_mask);
 
+  /**
+   * @brief incremental Suppression seeded by the tracked keypoints (see
+   * setTrackedKeypoints): tracked keypoints are kept as-is and only the new
+   * candidates (sorted by decreasing response) are resolved against them and
+   * against each other, using a coverage grid (as in SSC) with a suppression
+   * radius that is warm-started from the previous keyframe. Hence the cost is
+   * linear in the nr of candidates, and only a few passes are needed when the
+   * scene does not change abruptly.
+   */
+  std::vector<cv::KeyPoint> incremental(
+      const std::vector<cv::KeyPoint>& keyPoints,
+      const int& numRetPoints,
+      const float& tolerance,
+      const int& cols,
+      const int& rows);
+
+  void setTrackedKeypoints(const KeypointsCV& tracked_keypoints) override {
+    tracked_keypoints_ = tracked_keypoints;
+  }
+
+  //! Suppression radius [px] used in the last call to incremental(), or 0.
+  inline float getIncrementalRadius() const { return incremental_radius_; }
+
   /**
    * @brief setAnmsAlgorithm in case the user wants to dynamically change the
    * ANMS algorithm (not sure why someone would do that, but here it is).
@@ -105,6 +136,10 @@ class AdaptiveNonMaximumSuppression : public NonMaximumSuppression {
 
  protected:
   AnmsAlgorithmType anms_algorithm_type_;
+
+  //! State kept between keyframes by the Incremental algorithm.
+  KeypointsCV tracked_keypoints_;
+  float incremental_radius_ = 0.0f;
 };
 
 }  // namespace VIO
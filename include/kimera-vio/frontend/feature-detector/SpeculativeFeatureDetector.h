@@ -0,0 +1,79 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   SpeculativeFeatureDetector.h
+ * @brief  Detects feature candidates in non-keyframes on a worker thread, for
+ * the next keyframe to reuse them.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <future>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/frontend/Frame.h"
+#include "kimera-vio/frontend/feature-detector/FeatureDetector.h"
+#include "kimera-vio/frontend/feature-detector/FeatureDetectorParams.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The SpeculativeFeatureDetector class runs the raw detection of a
+ * FeatureDetector (see FeatureDetector::detectCandidates) on the latest
+ * non-keyframe, on a worker thread. When a keyframe comes, its candidates
+ * are moved to the keyframe with the displacement of the features tracked
+ * between both frames, and only need to be filtered and suppressed: the
+ * detection is off the keyframe critical path.
+ * It has its own detectors, so it runs concurrently with the frontend's.
+ */
+class SpeculativeFeatureDetector {
+ public:
+  KIMERA_POINTER_TYPEDEFS(SpeculativeFeatureDetector);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(SpeculativeFeatureDetector);
+
+  explicit SpeculativeFeatureDetector(const FeatureDetectorParams& params);
+  //! Waits for the detection in flight, if any.
+  ~SpeculativeFeatureDetector();
+
+  /**
+   * @brief launch Starts detecting candidates in the (tracked) frame, unless
+   * the previous detection is still running: it is then kept.
+   */
+  void launch(const Frame& frame);
+
+  /**
+   * @brief takeCandidates Candidates of the last launched frame, moved to the
+   * keyframe with the median displacement of the features tracked from that
+   * frame to the keyframe. Waits for the detection if it is still running.
+   * @return False if there are no candidates, or too few features in common
+   * to move them: the keyframe should then be detected as usual.
+   */
+  bool takeCandidates(const Frame& keyframe,
+                      std::vector<cv::KeyPoint>* candidates);
+
+  //! Drops the candidates, e.g. when the tracking was lost.
+  void reset();
+
+ private:
+  //! Minimum nr of features tracked from the launched frame to the keyframe.
+  static constexpr size_t kMinNrCommonFeatures = 10u;
+
+  FeatureDetector feature_detector_;
+  std::future<std::vector<cv::KeyPoint>> detection_;
+  //! Tracked features of the launched frame.
+  KeypointsCV keypoints_;
+  LandmarkIds landmarks_;
+};
+
+}  // namespace VIO
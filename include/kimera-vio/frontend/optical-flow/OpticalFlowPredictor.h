@@ -17,6 +17,7 @@
 
 #include <opencv2/opencv.hpp>
 
+#include <gtsam/geometry/Pose3.h>
 #include <gtsam/geometry/Rot3.h>
 
 #include "kimera-vio/utils/Macros.h"
@@ -47,6 +48,25 @@ class OpticalFlowPredictor {
   virtual bool predictSparseFlow(const KeypointsCV& prev_kps,
                                  const gtsam::Rot3& cam1_R_cam2,
                                  KeypointsCV* next_kps) = 0;
+
+  /**
+   * @brief predictSparseFlow Same as above, but given a full relative pose
+   * and the depth of each keypoint in the previous frame. By default, the
+   * translation and depths are ignored.
+   * @param prev_kps: keypoints in previous (reference) image
+   * @param cam1_P_cam2: pose of camera 2 wrt camera 1.
+   * @param prev_depths: depth (z) of each prev_kps in camera 1, a
+   * non-positive depth means unknown.
+   * @param next_kps: keypoints in next image.
+   * @return true if flow could be determined successfully
+   */
+  virtual bool predictSparseFlow(const KeypointsCV& prev_kps,
+                                 const gtsam::Pose3& cam1_P_cam2,
+                                 const std::vector<double>& /* prev_depths */,
+                                 KeypointsCV* next_kps) {
+    return predictSparseFlow(prev_kps, cam1_P_cam2.rotation(), next_kps);
+  }
+
   virtual cv::Mat predictDenseFlow(const gtsam::Rot3& cam1_R_cam2) = 0;
 };
 
@@ -72,15 +92,26 @@ class NoOpticalFlowPredictor : public OpticalFlowPredictor {
 /**
  * @brief The RotationalOpticalFlowPredictor class predicts optical flow
  * by using a guess of inter-frame rotation and assumes no translation btw
- * frames.
+ * frames. All the keypoints are warped at once by the infinite homography
+ * K * R^T * K^-1 with a vectorized kernel (see utils::SimdKernels), straight
+ * into the output keypoints. For keypoints in unrectified images, the radial
+ * distortion is removed before and applied again after the rotation.
  */
 class RotationalOpticalFlowPredictor : public OpticalFlowPredictor {
  public:
   KIMERA_POINTER_TYPEDEFS(RotationalOpticalFlowPredictor);
   KIMERA_DELETE_COPY_CONSTRUCTORS(RotationalOpticalFlowPredictor);
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
-  RotationalOpticalFlowPredictor(const cv::Matx33f& K,
-                                 const cv::Size& img_size);
+  /**
+   * @param K Intrinsic matrix of the camera.
+   * @param img_size Size of the images: predictions outside are discarded.
+   * @param radial_distortion Radial distortion coefficients (k1, k2) of the
+   * keypoints, zero if the keypoints are rectified.
+   */
+  RotationalOpticalFlowPredictor(
+      const cv::Matx33f& K,
+      const cv::Size& img_size,
+      const cv::Vec2f& radial_distortion = cv::Vec2f(0.0f, 0.0f));
   virtual ~RotationalOpticalFlowPredictor() = default;
 
   bool predictSparseFlow(const KeypointsCV& prev_kps,
@@ -89,10 +120,38 @@ class RotationalOpticalFlowPredictor : public OpticalFlowPredictor {
   // NOT TESTED
   cv::Mat predictDenseFlow(const gtsam::Rot3& cam1_R_cam2) override;
 
- private:
+ protected:
   const cv::Matx33f K_;          // Intrinsic matrix of camera
   const cv::Matx33f K_inverse_;  // Cached inverse of K
   const cv::Rect2f img_size_;
+  //! Radial distortion (k1, k2) of the keypoints, zero if rectified.
+  const cv::Vec2f radial_distortion_;
+};
+
+/**
+ * @brief The RotoTranslationalOpticalFlowPredictor class predicts optical flow
+ * by using a guess of the inter-frame pose (e.g. from IMU preintegration) and
+ * the depth of each keypoint: keypoints are back-projected, transformed and
+ * re-projected. Keypoints with unknown depth fall back to the rotational
+ * prediction (i.e. assume the landmark is at infinity).
+ */
+class RotoTranslationalOpticalFlowPredictor
+    : public RotationalOpticalFlowPredictor {
+ public:
+  KIMERA_POINTER_TYPEDEFS(RotoTranslationalOpticalFlowPredictor);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(RotoTranslationalOpticalFlowPredictor);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  RotoTranslationalOpticalFlowPredictor(
+      const cv::Matx33f& K,
+      const cv::Size& img_size,
+      const cv::Vec2f& radial_distortion = cv::Vec2f(0.0f, 0.0f));
+  virtual ~RotoTranslationalOpticalFlowPredictor() = default;
+
+  using RotationalOpticalFlowPredictor::predictSparseFlow;
+  bool predictSparseFlow(const KeypointsCV& prev_kps,
+                         const gtsam::Pose3& cam1_P_cam2,
+                         const std::vector<double>& prev_depths,
+                         KeypointsCV* next_kps) override;
 };
 
 }  // namespace VIO
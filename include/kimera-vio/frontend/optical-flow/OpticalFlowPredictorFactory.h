@@ -34,6 +34,10 @@ class OpticalFlowPredictorFactory {
         return std::make_unique<RotationalOpticalFlowPredictor>(
             std::forward<Args>(args)...);
       }
+      case OpticalFlowPredictorType::kRotoTranslational: {
+        return std::make_unique<RotoTranslationalOpticalFlowPredictor>(
+            std::forward<Args>(args)...);
+      }
       default: {
         LOG(FATAL) << "Unknown OpticalFlowPredictorType: "
                    << static_cast<int>(optical_flow_predictor_type);
@@ -136,8 +136,9 @@ class ImuFrontend {
   // This should be called by the stereo Frontend, whenever there
   // is a new keyframe and we want to reset the integration to
   // use the latest imu bias.
-  // THIS IS NOT THREAD-SAFE: pim_ is not protected.
+  // THREAD-SAFE.
   inline void resetIntegrationWithCachedBias() {
+    std::lock_guard<std::mutex> pim_lock(pim_mutex_);
     std::lock_guard<std::mutex> lock(imu_bias_mutex_);
     pim_->resetIntegrationAndSetBias(latest_imu_bias_);
     // For debugging.
@@ -161,6 +162,7 @@ class ImuFrontend {
   inline void resetPreintegrationGravity(const gtsam::Vector3& reset_value) {
     LOG(WARNING) << "Resetting value of gravity in ImuFrontend to: "
                  << reset_value;
+    std::lock_guard<std::mutex> pim_lock(pim_mutex_);
     std::lock_guard<std::mutex> lock(imu_bias_mutex_);
     pim_->params()->n_gravity = reset_value;
     CHECK(gtsam::assert_equal(pim_->params()->getGravity(), reset_value));
@@ -182,6 +184,7 @@ class ImuFrontend {
 
   /* ------------------------------------------------------------------------ */
   inline gtsam::PreintegrationType::Params getGtsamImuParams() const {
+    std::lock_guard<std::mutex> pim_lock(pim_mutex_);
     return *(pim_->params());
   }
 
@@ -196,6 +199,8 @@ class ImuFrontend {
  private:
   ImuParams imu_params_;
   PimUniquePtr pim_ = nullptr;
+  // Guards pim_, locked before imu_bias_mutex_ when both are.
+  mutable std::mutex pim_mutex_;
   ImuBias latest_imu_bias_;
   mutable std::mutex imu_bias_mutex_;
 };
@@ -58,6 +58,15 @@ protected:
   double nominal_sampling_time_s_ = 0.0;
   double imu_integration_sigma_ = 0.0;
 
+  //! When propagating the Backend state at IMU rate, correct the integration
+  //! to a new bias with the first-order bias Jacobians instead of integrating
+  //! the IMU history again, if the bias changed by less than these.
+  bool bias_first_order_correction_ = false;
+  double bias_correction_max_acc_change_ = 0.05;    // [m/s^2]
+  double bias_correction_max_gyro_change_ = 0.005;  // [rad/s]
+  //! Integrate again when the integration being corrected is older than this.
+  double bias_correction_max_interval_s_ = 1.0;
+
   gtsam::Vector3 n_gravity_ = gtsam::Vector3::Zero();
 };
 
@@ -0,0 +1,192 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ImuPropagator.h
+ * @brief  Propagates the latest Backend state with the IMU, to output the
+ * state at IMU rate.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <Eigen/StdVector>
+
+#include <gtsam/navigation/NavState.h>
+
+#include "kimera-vio/common/VioNavState.h"
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/imu-frontend/ImuFrontend-definitions.h"
+#include "kimera-vio/imu-frontend/ImuFrontend.h"
+#include "kimera-vio/imu-frontend/ImuFrontendParams.h"
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/ThreadsafeImuBuffer.h"
+
+namespace VIO {
+
+/**
+ * @brief The ImuPropagator class outputs a VioNavStateTimestamped for every
+ * IMU measurement, by integrating the IMU on top of the latest optimized
+ * state (and IMU bias) of the Backend.
+ *
+ * Each Backend update resets the propagation: the IMU measurements since the
+ * new state's timestamp, kept in a ThreadsafeImuBuffer, are integrated again
+ * with the new bias, and only the resulting newest state is output.
+ *
+ * With ImuParams::bias_first_order_correction_, the integration is kept
+ * instead when the bias changed little: the motion integrated since the new
+ * state's timestamp is taken from the integration since the previous state,
+ * corrected to the new bias with the first-order bias Jacobians of the
+ * preintegration, and applied on top of the new state.
+ *
+ * Both resetState and the IMU callbacks only copy their data and notify: in
+ * parallel mode, all the integration happens in the propagator's own thread,
+ * hence it does not slow down the Backend nor the IMU data providers.
+ * In sequential mode, call spinOnce to process the pending data.
+ */
+class ImuPropagator {
+ public:
+  KIMERA_POINTER_TYPEDEFS(ImuPropagator);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(ImuPropagator);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  //! Called for every propagated state (timestamps in the camera clock).
+  using PropagatedStateCallback =
+      std::function<void(const VioNavStateTimestamped&)>;
+
+  /**
+   * @param imu_params Params for the IMU integration.
+   * @param parallel_run Whether to run the propagation in a thread.
+   * @param buffer_length_ns Length of the IMU history: must be longer than
+   * the latency of the Backend.
+   */
+  ImuPropagator(const ImuParams& imu_params,
+                const bool& parallel_run,
+                const Timestamp& buffer_length_ns = 10000000000);
+  ~ImuPropagator();
+
+ public:
+  //! Can be called at any time, also once started.
+  void registerPropagatedStateCallback(const PropagatedStateCallback& cb);
+
+  //! Launches the propagation thread in parallel mode.
+  void start();
+
+  void shutdown();
+
+  //! IMU callbacks (timestamps in the IMU clock, as received).
+  void fillImuQueue(const ImuMeasurement& imu_measurement);
+  void fillImuQueue(const ImuMeasurements& imu_measurements);
+
+  /**
+   * @brief resetState Sets the state to propagate from, typically called
+   * with the Backend output W_State_Blkf_. Only copies the state.
+   */
+  void resetState(const VioNavStateTimestamped& state);
+
+  //! Offset such that t_imu = t_cam + offset, see DataProviderModule.
+  inline void setImuTimeOffset(const Timestamp& imu_time_offset_ns) {
+    imu_time_offset_ns_ = imu_time_offset_ns;
+  }
+
+  /**
+   * @brief spinOnce Integrates all pending IMU measurements, after resetting
+   * the propagation if the state was updated.
+   * @return Nr of propagated states output.
+   */
+  size_t spinOnce();
+
+  inline size_t getNrPropagatedStates() const {
+    return nr_propagated_states_;
+  }
+
+  //! Nr of Backend updates that integrated the IMU history again.
+  inline size_t getNrReintegrations() const { return nr_reintegrations_; }
+  //! Nr of Backend updates that only corrected the integration to their bias.
+  inline size_t getNrBiasCorrections() const { return nr_bias_corrections_; }
+
+ private:
+  using ImuMeasurementVector =
+      std::vector<ImuMeasurement, Eigen::aligned_allocator<ImuMeasurement>>;
+
+  void spin();
+
+  //! Integrates the IMU history from the state's timestamp to the newest
+  //! measurement. Returns false if the IMU history does not cover it yet.
+  bool resetPropagation(const VioNavStateTimestamped& state);
+
+  //! Re-anchors the propagation on the state without integrating the IMU
+  //! history again. Returns false if the bias changed too much, or the
+  //! integration does not cover the state's timestamp.
+  bool correctPropagation(const VioNavStateTimestamped& state);
+
+  //! Integrates from the last integrated measurement to this one.
+  void propagate(const ImuMeasurement& imu_measurement);
+
+  //! Outputs the anchor state propagated up to the last integrated IMU.
+  void publishState(const Timestamp& imu_timestamp);
+
+ private:
+  const bool parallel_run_;
+  std::mutex callbacks_mutex_;
+  std::vector<PropagatedStateCallback> callbacks_;
+
+  //! IMU history, to integrate again after each reset.
+  utils::ThreadsafeImuBuffer imu_buffer_;
+  std::atomic<Timestamp> imu_time_offset_ns_;
+
+  //! Data passed to the propagation (thread), protected by mutex_.
+  std::mutex mutex_;
+  std::condition_variable data_cv_;
+  std::optional<VioNavStateTimestamped> pending_state_;
+  ImuMeasurementVector pending_measurements_;
+  bool shutdown_;
+
+  //! Propagation state, only used by spinOnce.
+  ImuFrontend imu_frontend_;
+  //! State being propagated, nullopt until the first valid reset.
+  std::optional<VioNavStateTimestamped> anchor_state_;
+  //! State waiting for the IMU history to cover its timestamp.
+  std::optional<VioNavStateTimestamped> waiting_state_;
+  Timestamp anchor_imu_time_offset_ns_;
+  ImuMeasurement last_measurement_;
+  ImuFrontend::PimPtr pim_;
+  std::atomic<size_t> nr_propagated_states_;
+
+  //! First-order bias correction, see ImuParams.
+  const bool bias_first_order_correction_;
+  const double bias_correction_max_acc_change_;
+  const double bias_correction_max_gyro_change_;
+  const Timestamp bias_correction_max_interval_ns_;
+  const gtsam::Vector3 n_gravity_;
+  //! State pim_ is integrated from, if bias_first_order_correction_: it is
+  //! the anchor state, unless the anchor has been corrected since.
+  std::optional<VioNavStateTimestamped> origin_state_;
+  Timestamp origin_imu_timestamp_;
+  //! Anchor state as predicted from the origin state, and its IMU timestamp.
+  gtsam::NavState origin_W_State_anchor_;
+  Timestamp anchor_imu_timestamp_;
+  //! Integration since the origin state at each integrated IMU measurement.
+  std::deque<std::pair<Timestamp, ImuFrontend::PimPtr>> pim_history_;
+  std::atomic<size_t> nr_reintegrations_;
+  std::atomic<size_t> nr_bias_corrections_;
+
+  std::unique_ptr<std::thread> thread_;
+};
+
+}  // namespace VIO
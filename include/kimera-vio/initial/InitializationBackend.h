@@ -55,6 +55,12 @@ class InitializationBackend : public VioBackend {
                                            gtsam::Vector3* g_iter_b0,
                                            gtsam::NavState* init_navstate);
 
+  // Iterations of the last initial bundle adjustment, within
+  // initialBAMaxIterations_ and initialBAMaxTimeSec_.
+  inline size_t getNrInitialBAIterations() const {
+    return nr_initial_ba_iterations_;
+  }
+
  public:
   /* ------------------------------------------------------------------------ */
   std::vector<gtsam::Pose3> addInitialVisualStatesAndOptimize(
@@ -80,6 +86,9 @@ class InitializationBackend : public VioBackend {
       const std::vector<size_t>& extra_factor_slots_to_delete =
           std::vector<size_t>(),
       const int verbosity = 0);
+
+ private:
+  size_t nr_initial_ba_iterations_ = 0u;
 };
 
 }  // namespace VIO
@@ -1,246 +1,16 @@
 #pragma once
 #include <glog/logging.h>
+#include <cmath>
+#include <complex>
 #include <cstddef>
+#include <functional>
 #include <iterator>
 #include <numeric>
 #include <vector>
 
-namespace VIO {
-
-// based on
-// https://internalpointers.com/post/writing-custom-iterators-modern-cpp
-template <typename Value>
-struct RingBufferIter {
-  using iterator_category = std::forward_iterator_tag;
-  using difference_type = std::ptrdiff_t;
-  using value_type = Value;
-  using pointer = value_type*;
-  using reference = value_type&;
-
-  /**
-   * @brief make an iterator bounded by the start and end of a non-zero sized
-   * buffer
-   * @param buffer non-zero sized buffer to iterate over
-   * @param num_measurements number of valid measurements in the buffer
-   * @param curr_index current index of the ring buffer head
-   * @param ptr pointer to element in the buffer
-   */
-  RingBufferIter(const std::vector<Value>& buffer,
-                 size_t num_measurements,
-                 size_t curr_index,
-                 Value const* ptr)
-      : m_ptr_(ptr), curr_index_(curr_index), num_values_(num_measurements) {
-    CHECK(ptr != nullptr);
-    CHECK_GE(buffer.size(), 1u);
-    begin_ptr_ = &(buffer.data()[0]);
-    end_ptr_ = &(buffer.data()[buffer.size() - 1]);
-    CHECK_GE(m_ptr_, begin_ptr_);
-    CHECK_LE(m_ptr_, end_ptr_);
-  }
-
-  /**
-   * @brief de-reference the iterator
-   * @return the value the iterator is pointing to
-   */
-  const Value& operator*() const {
-    // begin and end are guaranteed to be non-null,
-    // which means that m_ptr_ is also not null
-    CHECK_GE(m_ptr_, begin_ptr_);
-    CHECK_LE(m_ptr_, end_ptr_);
-    return *m_ptr_;
-  }
-
-  /**
-   * @brief get underlying iterator address
-   */
-  Value* operator->() { return m_ptr_; }
-
-  /**
-   * @brief increment the iterator address
-   */
-  RingBufferIter& operator++() {
-    m_ptr_++;
-    if (m_ptr_ > end_ptr_) {
-      m_ptr_ = begin_ptr_;
-    }
-    return *this;
-  }
-
-  /**
-   * @brief increment the iterator address
-   */
-  RingBufferIter operator++(int) {
-    RingBufferIter tmp = *this;
-    ++(*this);
-    return tmp;
-  }
-
-  /**
-   * @brief check if two iterators are pointing to the same element
-   */
-  inline friend bool operator==(const RingBufferIter& a,
-                                const RingBufferIter& b) {
-    CHECK_EQ(a.num_values_, b.num_values_);
-    CHECK_EQ(a.begin_ptr_, b.begin_ptr_);
-    CHECK_EQ(a.end_ptr_, b.end_ptr_);
-    CHECK_EQ(a.curr_index_, b.curr_index_);
-    return a.m_ptr_ == b.m_ptr_;
-  }
-
-  /**
-   * @brief check if two iterators are not pointing to the same element
-   */
-  inline friend bool operator!=(const RingBufferIter& a,
-                                const RingBufferIter& b) {
-    return !(a == b);
-  }
-
- private:
-  value_type const* m_ptr_;
-  const size_t curr_index_;
-  const size_t num_values_;
-  value_type const* begin_ptr_;
-  value_type const* end_ptr_;
-};
-
-template <typename T>
-class RingBuffer {
- public:
-  using Iterator = RingBufferIter<T>;
-  using value_type = T;
-
-  explicit RingBuffer(size_t buffer_size)
-      : size_(buffer_size),
-        num_values_(0),
-        curr_index_(0),
-        values_(buffer_size + 1) {}
-
-  /**
-   * @brief reset the buffer to be empty
-   */
-  void clear() {
-    values_ = std::vector<T>(size_ + 1);
-    num_values_ = 0;
-    curr_index_ = 0;
-  }
-
-  /**
-   * @brief get the element at the index specified.
-   *
-   * @note no specific bounds checking is performed,
-   *       but all memory accesses are safe
-   */
-  T operator[](size_t index) const {
-    if (num_values_ < size_) {
-      return values_.at(index);
-    }
-
-    if (index < size_ - curr_index_) {
-      return values_.at(curr_index_ + index + 1);
-    }
-
-    return values_.at(index - (size_ - curr_index_));
-  }
-
-  /**
-   * @brief get the current number of elements in the buffer
-   */
-  inline size_t size() const { return num_values_; }
-
-  /**
-   * @brief get whether the buffer is fulll
-   */
-  inline bool full() const { return size_ == num_values_; }
-
-  /**
-   * @brief get whether the buffer is empty
-   */
-  inline bool empty() const { return num_values_ == 0; }
-
-  /**
-   * @brief add a new value at the end of the buffer.
-   * @note will drop the earliest value if the buffer
-   *       is full
-   */
-  void push(const T& value) {
-    values_[curr_index_] = value;
-    if (curr_index_ == size_) {
-      curr_index_ = 0;
-    } else {
-      curr_index_++;
-    }
-    if (num_values_ < size_) {
-      num_values_++;
-    }
-  }
-
-  /**
-   * @brief get an iterator at the first element
-   */
-  inline Iterator begin() const {
-    return Iterator(
-        values_, num_values_, curr_index_, &(values_.data()[getBeginIndex()]));
-  }
-
-  /**
-   * @brief get an iterator at the last element
-   */
-  inline Iterator end() const {
-    return Iterator(
-        values_, num_values_, curr_index_, &(values_.data()[getEndIndex()]));
-  }
-
-  /**
-   * @brief get the first element (undefined behavior when empty)
-   */
-  inline T front() const { return values_[getBeginIndex()]; }
-
-  /**
-   * @brief get the last element (undefined behavior when empty)
-   */
-  inline T back() const { return values_[getNewestIndex()]; }
-
-  /**
-   * @brief display buffer statistics
-   */
-  friend std::ostream& operator<<(std::ostream& out, const RingBuffer& buffer) {
-    out << "buffer<(curr=" << buffer.curr_index_
-        << ", size=" << buffer.num_values_ << ", max_size=" << buffer.size_
-        << ")>";
-    return out;
-  }
-
- private:
-  // oldest message in buffer
-  size_t getBeginIndex() const {
-    if (num_values_ < size_) {
-      return 0;
-    }
-
-    return (curr_index_ == size_) ? 0 : curr_index_ + 1;
-  }
-
-  // newest message in buffer
-  size_t getNewestIndex() const {
-    if (num_values_ == 0) {
-      return 0;
-    }
-    return (curr_index_ == 0) ? size_ : curr_index_ - 1;
-  }
+#include "kimera-vio/utils/RingBuffer.h"
 
-  // index to stop iteration on
-  size_t getEndIndex() const {
-    if (num_values_ == 0) {
-      return 0;
-    }
-    return curr_index_;
-  }
-
-  size_t size_;
-  size_t num_values_;
-  size_t curr_index_;
-  std::vector<T> values_;
-};
+namespace VIO {
 
 namespace utils {
 
@@ -331,6 +101,124 @@ std::vector<double> crossCorrelation(
   return correlation;
 }
 
+namespace internal {
+
+/**
+ * @brief in-place iterative radix-2 FFT
+ * @param values sequence to transform, its size must be a power of 2
+ * @param inverse whether to compute the inverse transform (not scaled by
+ *        1 / size)
+ */
+inline void fftRadix2(std::vector<std::complex<double>>* values,
+                      bool inverse) {
+  CHECK_NOTNULL(values);
+  std::vector<std::complex<double>>& x = *values;
+  const size_t n = x.size();
+  CHECK(n > 0u && (n & (n - 1u)) == 0u) << "FFT size must be a power of 2";
+
+  // bit-reversal permutation
+  for (size_t i = 1u, j = 0u; i < n; ++i) {
+    size_t bit = n >> 1u;
+    for (; j & bit; bit >>= 1u) {
+      j ^= bit;
+    }
+    j ^= bit;
+    if (i < j) {
+      std::swap(x[i], x[j]);
+    }
+  }
+
+  // twiddle factors for the last stage, strided for the previous ones
+  const double sign = inverse ? 1.0 : -1.0;
+  std::vector<std::complex<double>> twiddles(n / 2u);
+  for (size_t k = 0u; k < twiddles.size(); ++k) {
+    twiddles[k] = std::polar(1.0, sign * 2.0 * M_PI * k / n);
+  }
+
+  for (size_t len = 2u; len <= n; len <<= 1u) {
+    const size_t half = len / 2u;
+    const size_t stride = n / len;
+    for (size_t i = 0u; i < n; i += len) {
+      for (size_t k = 0u; k < half; ++k) {
+        const std::complex<double> u = x[i + k];
+        const std::complex<double> v = x[i + k + half] * twiddles[k * stride];
+        x[i + k] = u + v;
+        x[i + k + half] = u - v;
+      }
+    }
+  }
+}
+
+}  // namespace internal
+
+/**
+ * @brief same as crossCorrelation, computed in O(N log N) via FFT
+ * @param seq_a first input sequence
+ * @param seq_b second input sequence
+ * @param accessor function to map T to a double
+ *
+ * Both (real) sequences are zero-padded to a power of 2 of at least the full
+ * correlation size and transformed with a single complex FFT (seq_a as real
+ * part, seq_b as imaginary part). Results are equal to crossCorrelation up to
+ * floating point rounding.
+ *
+ * @return correlation between seq_a and seq_b
+ */
+template <typename T>
+std::vector<double> crossCorrelationFft(
+    const T& seq_a,
+    const T& seq_b,
+    std::function<double(const typename T::value_type&)> accessor,
+    bool mean_removal = false) {
+  CHECK_GT(seq_a.size(), 0u);
+  CHECK_GT(seq_b.size(), 0u);
+  double mean_a = 0.0;
+  double mean_b = 0.0;
+  if (mean_removal) {
+    mean_a = mean(seq_a, accessor);
+    mean_b = mean(seq_b, accessor);
+  }
+  const size_t N = seq_a.size() + seq_b.size() - 1;
+  size_t fft_size = 1u;
+  while (fft_size < N) {
+    fft_size <<= 1u;
+  }
+
+  std::vector<std::complex<double>> signal(fft_size, 0.0);
+  size_t idx = 0u;
+  for (const auto& value : seq_a) {
+    signal[idx++].real(accessor(value) - mean_a);
+  }
+  idx = 0u;
+  for (const auto& value : seq_b) {
+    signal[idx++].imag(accessor(value) - mean_b);
+  }
+  internal::fftRadix2(&signal, false);
+
+  // split the spectra of both sequences using the conjugate symmetry of real
+  // signals, and multiply spectrum_a by the conjugate of spectrum_b
+  std::vector<std::complex<double>> spectrum(fft_size);
+  for (size_t k = 0u; k < fft_size; ++k) {
+    const std::complex<double> z = signal[k];
+    const std::complex<double> z_conj =
+        std::conj(signal[(fft_size - k) % fft_size]);
+    const std::complex<double> spectrum_a = 0.5 * (z + z_conj);
+    const std::complex<double> spectrum_b =
+        std::complex<double>(0.0, -0.5) * (z - z_conj);
+    spectrum[k] = spectrum_a * std::conj(spectrum_b);
+  }
+  internal::fftRadix2(&spectrum, true);
+
+  // the circular correlation holds negative lags at the end
+  std::vector<double> correlation(N);
+  const size_t lag_offset = fft_size - (seq_b.size() - 1);
+  for (size_t k = 0u; k < N; ++k) {
+    correlation[k] =
+        spectrum[(k + lag_offset) % fft_size].real() / fft_size;
+  }
+  return correlation;
+}
+
 }  // namespace utils
 
 }  // namespace VIO
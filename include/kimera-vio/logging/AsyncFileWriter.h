@@ -0,0 +1,101 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   AsyncFileWriter.h
+ * @brief  Output file stream written by a background thread.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/ThreadsafeSpscQueue.h"
+
+namespace VIO {
+
+/**
+ * @brief The AsyncFileWriter class is an output stream to a file that is
+ * written by a background thread, shared by all the writers.
+ *
+ * What is streamed is accumulated in chunks of kChunkSize bytes, handed over
+ * to the background thread through a lock-free queue once full. Hence,
+ * streaming never waits for the disk (unless kMaxChunksInFlight chunks are
+ * waiting to be written), and neither std::endl nor flush() write to the
+ * file: use flushToFile() to wait until everything streamed so far is in the
+ * file.
+ *
+ * Like a std::ofstream, a writer must only be used by one thread at a time
+ * (e.g. the thread of the module that logs).
+ */
+class AsyncFileWriter : public std::ostream {
+ public:
+  KIMERA_POINTER_TYPEDEFS(AsyncFileWriter);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(AsyncFileWriter);
+
+  static constexpr size_t kChunkSize = 1u << 16;
+  static constexpr size_t kMaxChunksInFlight = 64u;
+
+  AsyncFileWriter();
+  explicit AsyncFileWriter(const std::string& filename,
+                           const bool& append_mode = false);
+  virtual ~AsyncFileWriter();
+
+  //! Closes the current file, if any, and opens the given one.
+  void open(const std::string& filename, const bool& append_mode = false);
+  //! Writes everything streamed so far, and closes the file.
+  void close();
+  bool is_open();
+
+  //! Blocks until everything streamed so far is written to the file.
+  void flushToFile();
+
+  //! flushToFile() for all the writers, their threads must be idle.
+  static void flushAll();
+
+ private:
+  class Worker;
+
+  class StreamBuffer : public std::streambuf {
+   public:
+    explicit StreamBuffer(AsyncFileWriter* writer);
+
+    //! Hands the chunk streamed so far, if any, to the background thread.
+    void handOffChunk();
+
+   protected:
+    int_type overflow(int_type ch) override;
+    //! No write on std::endl or flush(), see flushToFile.
+    int sync() override { return 0; }
+
+   private:
+    void resetChunk();
+
+    AsyncFileWriter* writer_;
+    std::string chunk_;
+  };
+
+  //! Writes the chunks handed over so far. Called by the background thread,
+  //! or by the thread using the writer to flush or close it.
+  void writeChunks(const bool& flush_file);
+
+ private:
+  StreamBuffer stream_buffer_;
+  ThreadsafeSpscQueue<std::string> chunks_;
+  std::mutex file_mutex_;
+  //! Guarded by file_mutex_.
+  std::ofstream file_;
+};
+
+}  // namespace VIO
@@ -21,9 +21,12 @@
 #include <unordered_map>
 
 #include "kimera-vio/backend/VioBackend-definitions.h"
+#include "kimera-vio/frontend/DepthFrame.h"
+#include "kimera-vio/logging/AsyncFileWriter.h"
 #include "kimera-vio/loopclosure/LoopClosureDetector-definitions.h"
 #include "kimera-vio/loopclosure/LcdOutputPacket.h"
 #include "kimera-vio/mesh/Mesh.h"
+#include "kimera-vio/mesh/MeshLog.h"
 
 namespace VIO {
 
@@ -40,7 +43,9 @@ static inline void OpenFile(const std::string& output_filename,
   CHECK(output_file->good()) << "File in bad state: " << output_filename;
 }
 
-// Wrapper for std::ofstream to open/close it when created/destructed.
+// Wrapper for an output file stream to open/close it when
+// created/destructed. The file is written by a background thread, see
+// AsyncFileWriter.
 class OfstreamWrapper {
  public:
   KIMERA_POINTER_TYPEDEFS(OfstreamWrapper);
@@ -51,7 +56,7 @@ class OfstreamWrapper {
   void closeAndOpenLogFile();
 
  public:
-  std::ofstream ofstream_;
+  AsyncFileWriter ofstream_;
   const std::string filename_;
   const std::string output_path_;
   const bool open_file_in_append_mode = false;
@@ -141,12 +146,19 @@ class FrontendLogger {
   void logFrontendRansac(const Timestamp& timestamp_lkf,
                          const gtsam::Pose3& relative_pose_body_mono,
                          const gtsam::Pose3& relative_pose_body_stereo);
+  //! Thread-safe (it does not touch the log files), so that debug images
+  //! can be saved from another thread than the frontend's.
+  //! See frontend_images_format and frontend_images_scale.
   void logFrontendImg(const FrameId& kf_id,
                       const cv::Mat& img,
                       const std::string& img_name_prepend,
                       const std::string& dir_name,
                       bool disp_img,
                       bool save_img);
+  //! Saves the depth frame compressed (see DepthFrame::encode) to
+  //! rgbdDepthFrames/depth_<id>.bin, readable with DepthFrame::decode.
+  //! Thread-safe, like logFrontendImg.
+  void logDepthFrame(const DepthFrame& depth_frame);
   void logFrontendTemporalCal(const Timestamp& timestamp_vision,
                               const Timestamp& timestamp_imu,
                               const double& vision_relative_angle_norm,
@@ -176,17 +188,24 @@ class MesherLogger {
   virtual ~MesherLogger() = default;
 
   /**
-   * @brief serializeMesh logs the mesh into a file that can be later read.
-   * @param mesh Mesh to be serialized to file (this should be const, but the
-   * serialization function needs to be non-const to be able to deserialize).
+   * @brief serializeMesh appends the changes of the mesh since its previous
+   * serialization to filename, as a chunk of a MeshLog (see MeshLog.h), so
+   * that it can be later read.
    */
   template <typename T>
-  void serializeMesh(Mesh<T>& mesh, const std::string& filename) {
-    mesh.save(output_path_ + '/' + filename);
+  void serializeMesh(const Mesh<T>& mesh,
+                     const std::string& filename,
+                     const Timestamp& timestamp) {
+    MeshLogWriter::UniquePtr& mesh_log = mesh_logs_[filename];
+    if (!mesh_log) {
+      mesh_log = std::make_unique<MeshLogWriter>(output_path_ + '/' + filename,
+                                                 sizeof(T) / sizeof(float));
+    }
+    mesh_log->append(mesh, timestamp);
   }
 
   /**
-   * @brief deserializeMesh reads the serialized mesh from a file.
+   * @brief deserializeMesh reads the last serialized mesh from a file.
    * @param filename File where the mesh was serialized
    * @param mesh Mesh where to store deserialized data
    */
@@ -199,6 +218,8 @@ class MesherLogger {
  protected:
   std::string output_path_;
   bool is_header_written_ = false;
+  //! Open mesh logs, by filename.
+  std::unordered_map<std::string, MeshLogWriter::UniquePtr> mesh_logs_;
 };
 
 class VisualizerLogger {
@@ -211,24 +232,29 @@ class VisualizerLogger {
   void logLandmarks(const PointsWithId& lmks);
   void logLandmarks(const cv::Mat& lmks);
   /**
-   * @brief logMesh as a ply file
+   * @brief logMesh appends the changes of the mesh since the previous log to
+   * a binary MeshLog (see MeshLog.h), instead of writing the whole mesh.
+   * @param lmk_ids Landmark ids of the vertices
    * @param lmks Landmarks (Vertices of the mesh)
    * @param colors Colors of the vertices
    * @param polygons_mesh  Mesh polygons
    * @param timestamp the mesh timestamp
-   * @param log_accumulated_mesh whether to append the mesh vertices/faces
+   * @param log_accumulated_mesh whether to keep the vertices/faces removed
+   * from the mesh in the log
    */
-  void logMesh(const cv::Mat& lmks,
+  void logMesh(const LandmarkIds& lmk_ids,
+               const cv::Mat& lmks,
                const cv::Mat& colors,
                const cv::Mat& polygons_mesh,
-               const double& timestamp,
+               const Timestamp& timestamp,
                bool log_accumulated_mesh = false);
 
  private:
   // Filenames to be saved in the output folder.
-  OfstreamWrapper output_mesh_;
+  const std::string output_mesh_filename_;
   OfstreamWrapper output_landmarks_;
-  bool is_header_written_mesh_ = false;
+  //! Opened at the first logMesh.
+  MeshLogWriter::UniquePtr output_mesh_;
 };
 
 class PipelineLogger {
@@ -265,6 +291,9 @@ class LoopClosureDetectorLogger {
   void logOptimizedTraj(const LcdOutput& lcd_output);
   void logDebugInfo(const LcdDebugInfo& debug_info);
 
+ private:
+  void logTrajPose(const FrameId& kf_id, const gtsam::Pose3& pose);
+
  private:
   // Filenames to be saved in the output folder.
   OfstreamWrapper output_lcd_;
@@ -273,7 +302,10 @@ class LoopClosureDetectorLogger {
   OfstreamWrapper output_geom_verif_;
   OfstreamWrapper output_pose_recovery_;
   FrameIDTimestampMap ts_map_;
+  //! Optimized trajectory, updated with the poses of each output.
+  gtsam::Values traj_;
   bool is_header_written_lcd_ = false;
+  bool is_header_written_traj_ = false;
   bool is_header_written_status_ = false;
   bool is_header_written_geom_verif_ = false;
   bool is_header_written_pose_recovery_ = false;
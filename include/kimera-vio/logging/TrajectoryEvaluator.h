@@ -0,0 +1,141 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   TrajectoryEvaluator.h
+ * @brief  Online evaluation of the estimated trajectory against ground truth.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+
+#include <Eigen/Core>
+
+#include <gtsam/geometry/Pose3.h>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The TrajectoryEvaluator class computes the absolute trajectory error
+ * (ATE) and the relative pose error (RPE) of the estimated poses as they
+ * arrive, instead of dumping the trajectories and aligning them offline.
+ *
+ * - ATE: RMSE of the estimated positions after their least-squares alignment
+ *   to the ground truth (Umeyama). The alignment only needs the first and
+ *   second moments of the positions, which are accumulated per pose, hence
+ *   the ATE of the whole trajectory is available at any time in O(1).
+ * - RPE: error of the relative motion between each pose and the latest pose
+ *   at least rpe_delta_s older, split in translation and rotation.
+ *
+ * Thread-safe: poses may be added from the Backend thread while the errors are
+ * queried from another one.
+ */
+class TrajectoryEvaluator {
+ public:
+  KIMERA_POINTER_TYPEDEFS(TrajectoryEvaluator);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(TrajectoryEvaluator);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  //! Returns the ground-truth pose of the body at the given timestamp, or
+  //! false if there is none.
+  typedef std::function<bool(const Timestamp&, gtsam::Pose3*)>
+      GroundTruthCallback;
+
+  /**
+   * @param gt_callback Ground-truth poses of the body, only used by addPose.
+   * @param rpe_delta_s Time between the poses of the RPE pairs [s].
+   * @param align_scale Whether the ATE alignment is a similarity (e.g. for
+   * trajectories whose scale is not observable) or a rigid transformation.
+   */
+  TrajectoryEvaluator(const GroundTruthCallback& gt_callback,
+                      const double& rpe_delta_s = 1.0,
+                      const bool& align_scale = false);
+  virtual ~TrajectoryEvaluator() = default;
+
+  /**
+   * @brief addPose Evaluates the estimated pose against the ground truth at
+   * its timestamp.
+   * @return False if there is no ground truth for this timestamp, in which
+   * case the pose is ignored.
+   */
+  bool addPose(const Timestamp& timestamp, const gtsam::Pose3& W_Pose_B);
+
+  //! Evaluates the estimated pose against the given ground-truth pose.
+  void addPose(const Timestamp& timestamp,
+               const gtsam::Pose3& W_Pose_B,
+               const gtsam::Pose3& gt_Pose_B);
+
+  /**
+   * @brief getAteRmse ATE of all the poses added so far.
+   * @param gt_Pose_W Optional, the alignment of the estimated poses to the
+   * ground truth: gt_p = scale * gt_Pose_W.rotation() * W_p +
+   * gt_Pose_W.translation().
+   * @param scale Optional, the scale of the alignment (1 if not aligned).
+   * @return RMSE of the aligned positions [m], 0 if no pose was added.
+   */
+  double getAteRmse(gtsam::Pose3* gt_Pose_W = nullptr,
+                    double* scale = nullptr) const;
+
+  //! RMSE of the RPE translation [m] and rotation [deg], 0 if no pair yet.
+  double getRpeTranslationRmse() const;
+  double getRpeRotationRmse() const;
+
+  size_t getNrPoses() const;
+  size_t getNrRpePairs() const;
+
+  /**
+   * @brief reportStatistics Adds the errors of the whole trajectory to
+   * utils::Statistics (the RPE of each pair is added as it is computed).
+   * Meant to be called once, at shutdown.
+   */
+  void reportStatistics() const;
+
+  std::string print() const;
+
+ private:
+  struct TimestampedPoses {
+    Timestamp timestamp_;
+    gtsam::Pose3 W_Pose_B_;
+    gtsam::Pose3 gt_Pose_B_;
+  };
+
+  const GroundTruthCallback gt_callback_;
+  const Timestamp rpe_delta_ns_;
+  const bool align_scale_;
+
+  mutable std::mutex mutex_;
+
+  //! Moments of the positions for the ATE alignment. The positions are taken
+  //! relative to the first ones, to keep the sums small.
+  size_t nr_poses_;
+  Eigen::Vector3d W_origin_;
+  Eigen::Vector3d gt_origin_;
+  Eigen::Vector3d sum_W_p_;
+  Eigen::Vector3d sum_gt_p_;
+  //! Sum of gt_p * W_p^T.
+  Eigen::Matrix3d sum_gt_p_W_p_t_;
+  double sum_W_p_sq_;
+  double sum_gt_p_sq_;
+
+  //! Poses of the last rpe_delta_s, oldest first.
+  std::deque<TimestampedPoses> rpe_window_;
+  size_t nr_rpe_pairs_;
+  double sum_rpe_translation_sq_;
+  double sum_rpe_rotation_sq_;
+};
+
+}  // namespace VIO
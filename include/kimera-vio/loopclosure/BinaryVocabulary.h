@@ -0,0 +1,106 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   BinaryVocabulary.h
+ * @brief  Compact binary serialization of the ORB vocabulary, loaded with a
+ * memory mapping instead of parsing the text/YAML vocabulary.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <opencv2/core/core.hpp>
+
+namespace DBoW2 {
+class FORB;
+
+template <class D, class F>
+class TemplatedVocabulary;
+}  // namespace DBoW2
+
+typedef DBoW2::TemplatedVocabulary<cv::Mat, DBoW2::FORB> OrbVocabulary;
+
+namespace VIO {
+
+/**
+ * Layout of a binary vocabulary file (all values little-endian, as written by
+ * the host):
+ *   BinaryVocabularyHeader
+ *   BinaryVocabularyNode[nr_nodes]               at nodes_offset
+ *   uint8_t[nr_nodes][descriptor_size]           at descriptors_offset
+ * Nodes are in DBoW2's node id order (the root, without descriptor, first),
+ * each node after its parent. Children and words are rebuilt from the
+ * parents, in node id order, as DBoW2 does when copying a vocabulary.
+ */
+static constexpr char kBinaryVocabularyMagic[8] = {
+    'K', 'I', 'M', 'E', 'R', 'A', 'V', 'B'};
+static constexpr uint32_t kBinaryVocabularyVersion = 1u;
+static constexpr size_t kBinaryVocabularyAlignment = 64u;
+
+struct BinaryVocabularyHeader {
+  char magic[8];
+  uint32_t version;
+  //! Branching factor and depth levels.
+  int32_t k;
+  int32_t L;
+  //! DBoW2::WeightingType and DBoW2::ScoringType.
+  int32_t weighting;
+  int32_t scoring;
+  uint32_t descriptor_size;
+  uint64_t nr_nodes;
+  uint64_t nodes_offset;
+  uint64_t descriptors_offset;
+  uint64_t file_size;
+};
+
+struct BinaryVocabularyNode {
+  uint32_t parent;
+  uint32_t padding;
+  double weight;
+};
+
+//! True if the file starts with kBinaryVocabularyMagic.
+bool isBinaryVocabulary(const std::string& filename);
+
+//! CHECK fails if the file can not be written.
+void saveBinaryVocabulary(const OrbVocabulary& vocab,
+                          const std::string& filename);
+
+/**
+ * @brief loadBinaryVocabulary Maps the file, and builds the vocabulary tree
+ * with node descriptors pointing inside the mapping (no copies: the pages are
+ * shared with other processes using the same file). The mapping is released
+ * with the last vocabulary (copies included) using it.
+ * CHECK fails if the file is not a valid binary vocabulary.
+ */
+std::unique_ptr<OrbVocabulary> loadBinaryVocabulary(
+    const std::string& filename);
+
+/**
+ * @brief getVocabularyLevel Nodes of the vocabulary tree at the given depth
+ * (1 for the children of the root), in node order.
+ * @param[out] descriptors Their descriptors, one per row (CV_8U).
+ * @param[out] bit_means Per node, the mean of each descriptor bit over the
+ * words below it (CV_32F, one column per bit).
+ */
+void getVocabularyLevel(const OrbVocabulary& vocab,
+                        const int& level,
+                        cv::Mat* descriptors,
+                        cv::Mat* bit_means);
+
+//! Loads a DBoW2 text/YAML vocabulary and saves it as a binary vocabulary.
+void convertVocabularyToBinary(const std::string& vocabulary_filename,
+                               const std::string& binary_filename);
+
+}  // namespace VIO
@@ -0,0 +1,179 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   BowDatabase.h
+ * @brief  Inverted-index database of bag-of-words vectors, to query the most
+ * similar images to a given one.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "kimera-vio/utils/Macros.h"
+
+namespace DBoW2 {
+class BowVector;
+class QueryResults;
+class FORB;
+
+template <class D, class F>
+class TemplatedVocabulary;
+}  // namespace DBoW2
+
+typedef DBoW2::TemplatedVocabulary<cv::Mat, DBoW2::FORB> OrbVocabulary;
+
+namespace VIO {
+
+struct BowDatabaseParams {
+  //! Threads scoring the entries of a query (> 1 for parallel scoring).
+  int num_threads = 1;
+  //! Min nr of entries to score in parallel, below the threads do not pay.
+  int min_parallel_entries = 2000;
+  //! Words in more than this fraction of the entries are not scored (stop
+  //! words: they barely discriminate, but have the longest posting lists).
+  //! 1.0 disables it: then queries score as DBoW2's database.
+  double stop_word_fraction = 1.0;
+  //! Min nr of entries before stop words are pruned.
+  int stop_word_min_entries = 100;
+};
+
+/**
+ * @brief The BowDatabase class is a drop-in replacement of DBoW2's
+ * TemplatedDatabase (without direct index) for the LoopClosureDetector:
+ * add() and query() have the same semantics and, for L1-norm vocabularies
+ * (as the ORB vocabulary), the same scores.
+ * - Each word's posting list stores entry ids and weights in two contiguous,
+ *   sorted arrays, and queries accumulate scores in a dense array indexed by
+ *   entry id instead of a std::map.
+ * - Entries are scored in parallel over disjoint entry id ranges (each
+ *   thread binary-searches its range in every posting list), so that the
+ *   query latency does not grow with the session as the single-threaded
+ *   DBoW2 query does.
+ * - Optionally, stop words are skipped.
+ * For other scoring types, candidates (entries sharing a word with the
+ * query) are scored with the vocabulary's score().
+ */
+class BowDatabase {
+ public:
+  KIMERA_POINTER_TYPEDEFS(BowDatabase);
+  using EntryId = unsigned int;
+
+  //! Copies the vocabulary.
+  explicit BowDatabase(const OrbVocabulary& vocab,
+                       const BowDatabaseParams& params = BowDatabaseParams());
+  //! Shares the vocabulary, e.g. between the pipelines of a process.
+  explicit BowDatabase(std::shared_ptr<const OrbVocabulary> vocab,
+                       const BowDatabaseParams& params = BowDatabaseParams());
+  //! Copies the entries, and shares the vocabulary (which is never modified).
+  BowDatabase(const BowDatabase& other);
+  BowDatabase& operator=(const BowDatabase& other);
+  ~BowDatabase();
+
+ public:
+  inline const OrbVocabulary* getVocabulary() const { return vocab_.get(); }
+
+  //! Copies the vocabulary and clears the database.
+  void setVocabulary(const OrbVocabulary& vocab);
+
+  inline const BowDatabaseParams& getParams() const { return params_; }
+
+  //! Nr of entries.
+  inline size_t size() const { return entry_offsets_.size() - 1u; }
+
+  //! Bytes allocated for the entries (not for the vocabulary), linear in the
+  //! nr of words of the vocabulary.
+  size_t getMemoryBytes() const;
+
+  void clear();
+
+  //! Adds an entry: ids are consecutive, from 0.
+  EntryId add(const DBoW2::BowVector& bow_vec);
+
+  /**
+   * @brief query As DBoW2's TemplatedDatabase::query: results sorted by
+   * decreasing score (ties by increasing entry id).
+   * @param max_results Max nr of results, all if <= 0.
+   * @param max_id Only entries with ids < max_id are scored, all if -1.
+   */
+  void query(const DBoW2::BowVector& bow_vec,
+             DBoW2::QueryResults& results,
+             int max_results = 1,
+             int max_id = -1) const;
+
+  /**
+   * @brief queryCandidates As query, but only scores the given entries: the
+   * scores are the same, the cost is linear in the nr of candidates (each
+   * binary-searched in the posting lists of the query words) instead of in
+   * the length of the posting lists.
+   * @param candidates Entry ids, sorted and unique.
+   */
+  void queryCandidates(const DBoW2::BowVector& bow_vec,
+                       DBoW2::QueryResults& results,
+                       const std::vector<EntryId>& candidates,
+                       int max_results = 1) const;
+
+  //! Binary dump of the entries (not of the vocabulary).
+  void save(std::ostream& out) const;
+
+  //! Replaces the entries by the ones saved, with the same vocabulary.
+  void load(std::istream& in);
+
+ private:
+  struct PostingList {
+    //! Sorted, since entries are added with increasing ids.
+    std::vector<EntryId> entry_ids;
+    std::vector<double> weights;
+  };
+
+  //! Query word, and its posting list.
+  struct QueryWord {
+    const PostingList* posting_list;
+    double weight;
+  };
+
+  //! Query words with a posting list, without the stop words if pruned.
+  void getQueryWords(const DBoW2::BowVector& bow_vec,
+                     std::vector<QueryWord>* query_words) const;
+
+  //! Accumulates the L1 score terms of the entries in [begin, end).
+  void scoreEntriesL1(const std::vector<QueryWord>& query_words,
+                      const EntryId& begin,
+                      const EntryId& end,
+                      std::vector<double>* scores,
+                      std::vector<uint8_t>* is_candidate) const;
+
+  //! Sorts the results by decreasing score (ties by increasing entry id),
+  //! and keeps the max_results best if > 0.
+  static void sortResults(const int& max_results,
+                          DBoW2::QueryResults* results);
+
+  //! Bag of words of an entry, from the direct entry storage.
+  void getEntry(const EntryId& entry_id, DBoW2::BowVector* bow_vec) const;
+
+ private:
+  BowDatabaseParams params_;
+  std::shared_ptr<const OrbVocabulary> vocab_;
+  //! Inverted index, one posting list per word.
+  std::vector<PostingList> posting_lists_;
+  //! Entries' words and weights, entry i in [entry_offsets_[i],
+  //! entry_offsets_[i + 1]), only needed by non-L1 scoring.
+  std::vector<size_t> entry_offsets_;
+  std::vector<unsigned int> entry_words_;
+  std::vector<double> entry_weights_;
+};
+
+}  // namespace VIO
@@ -13,6 +13,14 @@
  */
 
 #pragma once
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include "kimera-vio/loopclosure/LoopClosureDetector-definitions.h"
@@ -25,8 +33,21 @@ struct FrameCacheConfig {
   std::string cache_name = ".kimera_lcd_frames";
   size_t num_frames_per_file = 15;
   bool remove_cache_on_exit = false;
+  //! Write the batches of frames in a background thread (else in addFrame).
+  bool async_write = true;
+  //! zstd compression level of the cached frames (0: no compression).
+  //! Ignored if Kimera-VIO is built without zstd.
+  int compression_level = 0;
+  //! Memory budget of the frames (<= 0: unbounded). Past it, the landmarks
+  //! and bearing vectors of the oldest frames are spilled to disk (in
+  //! cache_path, with max_frames of them kept in memory): only their
+  //! keypoints and descriptors stay resident.
+  int64_t max_resident_bytes = -1;
 };
 
+//! Approximate memory footprint of a frame.
+size_t getFrameBytes(const LCDFrame& frame);
+
 struct FrameCacheImpl {
   virtual ~FrameCacheImpl() = default;
 
@@ -35,6 +56,13 @@ struct FrameCacheImpl {
   virtual LCDFrame::Ptr getFrame(size_t index) const = 0;
 
   virtual size_t size() const = 0;
+
+  //! Approximate memory footprint of the frames held in memory.
+  virtual size_t getResidentBytes() const = 0;
+
+  //! Hint that the given frames will be retrieved soon: caches backed by disk
+  //! load them in the background.
+  virtual void prefetch(const std::vector<size_t>& indices) const {}
 };
 
 class FrameCache {
@@ -53,6 +81,12 @@ class FrameCache {
 
   size_t size() const { return impl_->size(); }
 
+  size_t getResidentBytes() const { return impl_->getResidentBytes(); }
+
+  void prefetch(const std::vector<size_t>& indices) const {
+    impl_->prefetch(indices);
+  }
+
  private:
   std::unique_ptr<FrameCacheImpl> impl_;
 };
@@ -69,10 +103,24 @@ class InMemoryCacheImpl : public FrameCacheImpl {
 
   virtual size_t size() const;
 
+  virtual size_t getResidentBytes() const;
+
  private:
   std::vector<LCDFrame::Ptr> frames_;
+  size_t resident_bytes_ = 0;
 };
 
+/**
+ * @brief The LRUCacheImpl class keeps at most max_frames frames in memory
+ * (besides the frames not archived yet), and archives the frames to disk in
+ * batches of num_frames_per_file frames.
+ *
+ * Each batch file starts with an index of its frames (offset and size), and
+ * each frame is stored (and optionally compressed) independently in a compact
+ * binary layout: a cache miss only reads and decodes the missed frame.
+ * With async_write, the batches are written by a background thread, and are
+ * kept in memory until written.
+ */
 class LRUCacheImpl : public FrameCacheImpl {
  public:
   struct CacheEntry {
@@ -90,6 +138,15 @@ class LRUCacheImpl : public FrameCacheImpl {
 
   virtual size_t size() const;
 
+  virtual size_t getResidentBytes() const;
+
+  //! Loads the archived frames that are not in memory yet (at most max_frames
+  //! of them are kept until retrieved) in a background thread.
+  virtual void prefetch(const std::vector<size_t>& indices) const;
+
+  //! Nr of cache misses served by a prefetched frame.
+  size_t getNrPrefetchHits() const { return nr_prefetch_hits_; }
+
  public:
   const FrameCacheConfig config;
 
@@ -100,13 +157,92 @@ class LRUCacheImpl : public FrameCacheImpl {
 
   size_t getNextSlot() const;
 
+  //! Writes a batch file (through a temporary file, renamed once written).
+  void writeBatch(size_t batch_idx,
+                  const std::vector<LCDFrame::Ptr>& frames) const;
+
+  //! Reads a single frame from its batch file.
+  LCDFrame::Ptr readFrame(size_t index) const;
+
+  void writerLoop();
+
+  void prefetchLoop() const;
+
+  //! The prefetched frame (waiting for it if it is being loaded), or nullptr
+  //! if it is not prefetched (it is then no longer queued).
+  LCDFrame::Ptr takePrefetchedFrame(size_t index) const;
+
  private:
   size_t total_ = 0;
   LCDFrame::Ptr last_added_;
   std::list<LCDFrame::Ptr> to_archive_;
-
-  mutable std::vector<std::vector<LCDFrame::Ptr>> loaded_;
+  bool compress_ = false;
+
+  //! Batches to write (or being written), by batch index.
+  mutable std::mutex write_mutex_;
+  std::condition_variable write_cv_;
+  std::map<size_t, std::vector<LCDFrame::Ptr>> pending_batches_;
+  bool shutdown_writer_ = false;
+  std::thread writer_;
+
+  //! Frames to prefetch, being prefetched, and prefetched (by frame index).
+  mutable std::mutex prefetch_mutex_;
+  mutable std::condition_variable prefetch_cv_;
+  mutable std::deque<size_t> prefetch_queue_;
+  mutable std::optional<size_t> prefetching_;
+  mutable std::map<size_t, LCDFrame::Ptr> prefetched_;
+  mutable std::deque<size_t> prefetched_order_;
+  bool shutdown_prefetch_ = false;
+  mutable std::thread prefetcher_;
+  mutable size_t nr_prefetch_hits_ = 0;
+
+  mutable std::vector<LCDFrame::Ptr> loaded_;
+  //! By frame index.
   mutable std::map<size_t, CacheEntry> entries_;
+  mutable size_t nr_accesses_ = 0;
+};
+
+/**
+ * @brief The MemoryBudgetCacheImpl class keeps all the frames in memory while
+ * within max_resident_bytes. Past it, the landmarks and bearing vectors of the
+ * oldest frames (only needed to verify a loop closure, unlike their keypoints
+ * and descriptors) are spilled to a disk-backed LRUCacheImpl, and merged back
+ * into a copy of the frame by getFrame.
+ * The latest frame is never spilled.
+ */
+class MemoryBudgetCacheImpl : public FrameCacheImpl {
+ public:
+  explicit MemoryBudgetCacheImpl(const FrameCacheConfig& config);
+
+  virtual ~MemoryBudgetCacheImpl() = default;
+
+  virtual size_t addFrame(const LCDFrame::Ptr& frame);
+
+  virtual LCDFrame::Ptr getFrame(size_t index) const;
+
+  virtual size_t size() const;
+
+  virtual size_t getResidentBytes() const;
+
+  //! Only the spilled data is loaded in the background.
+  virtual void prefetch(const std::vector<size_t>& indices) const;
+
+  //! Nr of frames with spilled landmarks and bearing vectors (the oldest).
+  inline size_t getNrSpilledFrames() const { return nr_spilled_; }
+
+ public:
+  const FrameCacheConfig config;
+
+ private:
+  void spillOldestFrame();
+
+ private:
+  //! Spilled frames only keep their keypoints and descriptors.
+  std::vector<LCDFrame::Ptr> frames_;
+  size_t nr_spilled_ = 0;
+  size_t resident_bytes_ = 0;
+  //! Landmarks and bearing vectors of the spilled frames, by frame index.
+  std::unique_ptr<LRUCacheImpl> spilled_;
 };
 
 }  // namespace VIO
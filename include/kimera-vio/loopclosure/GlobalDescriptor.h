@@ -0,0 +1,78 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   GlobalDescriptor.h
+ * @brief  Compact global image descriptors aggregating ORB descriptors.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "kimera-vio/loopclosure/HnswIndex.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+struct GlobalDescriptorParams {
+  //! Depth of the vocabulary nodes used as VLAD clusters (1 for the
+  //! children of the root, i.e. the branching factor of the vocabulary).
+  int vocabulary_level = 1;
+  //! Dimension of the global descriptors: VLAD (nr of clusters x 256 bits)
+  //! is randomly projected to it. If <= 0, VLAD is kept as is.
+  int projection_dim = 256;
+  HnswParams hnsw;
+};
+
+/**
+ * @brief The GlobalDescriptorExtractor class aggregates the ORB descriptors
+ * of an image into a single unit vector (VLAD): the sum, per cluster, of the
+ * residuals of the descriptor bits to their expected values in the (Hamming)
+ * nearest cluster. Residuals to the binary cluster center instead would be
+ * biased, and this bias shared by all images would dominate their
+ * similarity. The cosine similarity of two such vectors scores how alike two
+ * images are, and they are small enough to be indexed (see HnswIndex).
+ */
+class GlobalDescriptorExtractor {
+ public:
+  KIMERA_POINTER_TYPEDEFS(GlobalDescriptorExtractor);
+
+  /**
+   * @param centers ORB descriptors of the cluster centers, one per row.
+   * @param bit_means Mean of each bit of the descriptors in each cluster, one
+   * cluster per row. See getVocabularyLevel for both.
+   * @param projection_dim See GlobalDescriptorParams.
+   */
+  GlobalDescriptorExtractor(const cv::Mat& centers,
+                            const cv::Mat& bit_means,
+                            const int& projection_dim);
+  ~GlobalDescriptorExtractor() = default;
+
+  //! @param descriptors ORB descriptors, one per row. Zero if empty.
+  std::vector<float> compute(const cv::Mat& descriptors) const;
+
+  inline size_t dim() const { return dim_; }
+
+  static float similarity(const std::vector<float>& a,
+                          const std::vector<float>& b);
+
+ private:
+  const cv::Mat centers_;
+  const cv::Mat bit_means_;
+  const size_t vlad_dim_;
+  //! Gaussian random projection (Johnson-Lindenstrauss), empty if none.
+  cv::Mat projection_;
+  size_t dim_;
+};
+
+}  // namespace VIO
@@ -0,0 +1,57 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   GpuOrbExtractor.h
+ * @brief  ORB feature extraction on the GPU (OpenCV CUDA) for the LCD.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/features2d.hpp>
+
+#include "kimera-vio/loopclosure/LoopClosureDetector-definitions.h"
+#include "kimera-vio/loopclosure/LoopClosureDetectorParams.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The GpuOrbExtractor class runs cv::cuda::ORB with the ORB params of
+ * the LCD. Images are copied to a page-locked (pinned) host buffer, reused
+ * across images of the same size, so that their upload is a DMA transfer.
+ * Only available if Kimera-VIO is built with OpenCV's cudafeatures2d module
+ * and a CUDA device is present: check isAvailable() before constructing one.
+ */
+class GpuOrbExtractor {
+ public:
+  KIMERA_POINTER_TYPEDEFS(GpuOrbExtractor);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(GpuOrbExtractor);
+
+  explicit GpuOrbExtractor(const LoopClosureDetectorParams& params);
+  ~GpuOrbExtractor();
+
+  static bool isAvailable();
+
+  //! Same outputs as cv::ORB::detectAndCompute, for a CV_8UC1 image.
+  void detectAndCompute(const cv::Mat& img,
+                        std::vector<cv::KeyPoint>* keypoints,
+                        OrbDescriptor* descriptors);
+
+ private:
+  //! CUDA objects, not exposed to avoid depending on the CUDA headers.
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace VIO
@@ -0,0 +1,127 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   HnswIndex.h
+ * @brief  Approximate nearest neighbor index of unit vectors (HNSW).
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+struct HnswParams {
+  //! Nr of neighbors of each entry per level (twice as many on level 0).
+  int M = 16;
+  //! Nr of candidates considered when inserting: higher is slower to build,
+  //! but gives a better graph.
+  int ef_construction = 100;
+  //! Nr of candidates considered when searching: recall vs speed.
+  int ef_search = 64;
+};
+
+/**
+ * @brief The HnswIndex class is a Hierarchical Navigable Small World graph
+ * (Malkov and Yashunin, 2018) over unit vectors, to find the ones with the
+ * highest inner product (cosine similarity) to a query in a time
+ * logarithmic in the nr of entries. Entries are only added, never removed.
+ */
+class HnswIndex {
+ public:
+  KIMERA_POINTER_TYPEDEFS(HnswIndex);
+  using Label = unsigned int;
+
+  struct Result {
+    Label label;
+    float similarity;
+  };
+
+  HnswIndex(const size_t& dim, const HnswParams& params);
+  ~HnswIndex() = default;
+
+  //! @param vector Of size dim, unit norm.
+  void add(const Label& label, const std::vector<float>& vector);
+
+  /**
+   * @brief search Approximate k entries with labels < max_label most similar
+   * to the query, sorted by decreasing similarity.
+   */
+  void search(const std::vector<float>& query,
+              const size_t& k,
+              const Label& max_label,
+              std::vector<Result>* results) const;
+
+  inline size_t size() const { return labels_.size(); }
+  inline size_t dim() const { return dim_; }
+  size_t getMemoryBytes() const;
+
+ private:
+  using NodeId = uint32_t;
+  //! Distance and node, ordered by distance.
+  using Candidate = std::pair<float, NodeId>;
+  using MaxHeap = std::priority_queue<Candidate>;
+
+  inline const float* getVector(const NodeId& node) const {
+    return data_.data() + node * dim_;
+  }
+  //! 1 - inner product.
+  float distance(const float* a, const float* b) const;
+
+  //! Closest node on a level, greedily from the entry node.
+  NodeId searchGreedy(const float* query,
+                      NodeId entry,
+                      const int& level) const;
+
+  /**
+   * @brief searchLevel Best first search of the ef closest nodes on a level,
+   * only nodes with labels < max_label are returned (but all are traversed).
+   */
+  MaxHeap searchLevel(const float* query,
+                      const NodeId& entry,
+                      const size_t& ef,
+                      const int& level,
+                      const Label& max_label) const;
+
+  //! HNSW neighbor selection heuristic: keeps the closest candidates not
+  //! closer to an already kept one than to the query, for diversity.
+  std::vector<NodeId> selectNeighbors(MaxHeap candidates,
+                                      const size_t& max_neighbors) const;
+
+  //! Adds node to the neighbors of neighbor, pruning them if too many.
+  void connect(const NodeId& neighbor, const NodeId& node, const int& level);
+
+  inline size_t maxNeighbors(const int& level) const {
+    return static_cast<size_t>(level == 0 ? 2 * params_.M : params_.M);
+  }
+
+ private:
+  const size_t dim_;
+  const HnswParams params_;
+  const double level_multiplier_;
+  std::mt19937 rng_;
+
+  //! Vectors of the nodes, contiguous.
+  std::vector<float> data_;
+  std::vector<Label> labels_;
+  //! Neighbors of each node, by level (up to the level of the node).
+  std::vector<std::vector<std::vector<NodeId>>> links_;
+  NodeId entry_point_;
+  int max_level_;
+};
+
+}  // namespace VIO
@@ -0,0 +1,116 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   IncrementalPcm.h
+ * @brief  Pairwise consistency maximization of the loop closures, restricted
+ * to a window of recent loop closures in the same region.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include <gtsam/geometry/Pose3.h>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+struct IncrementalPcmParams {
+  //! Check the loop closures with IncrementalPcm before adding them to the
+  //! pose graph, instead of KimeraRPGO's PCM: each loop closure is only
+  //! checked against the last window_size ones (0: disabled).
+  int window_size = 0;
+  //! Of these, only the loop closures whose reference keyframes are within
+  //! this distance (in the odometry frame) of its own (0: no region).
+  double region_radius = 0.0;  // [m]
+  //! Max error of the cycle made by two loop closures and the odometry
+  //! between their keyframes for these to be consistent.
+  double trans_threshold = 0.5;  // [m]
+  double rot_threshold = 0.1;    // [rad]
+  //! Loop closures are only accepted once part of a consistent set of at
+  //! least this size.
+  int min_clique_size = 1;
+};
+
+/**
+ * @brief The IncrementalPcm class rejects outlier loop closures as PCM does:
+ * the accepted loop closures are the largest set of pairwise consistent ones.
+ * Instead of checking every new loop closure against all the previous ones
+ * and solving the max-clique of the whole set, the checks and the (greedy)
+ * max-clique are restricted to the group of the new loop closure: the recent
+ * loop closures in its region. The pairwise checks are cached, hence the cost
+ * of a loop closure is bounded by the window size, not by the number of loop
+ * closures so far.
+ *
+ * Accepted loop closures are never rejected afterwards (they are already in
+ * the pose graph), but a loop closure rejected when added may be accepted
+ * with a later one that makes it part of the largest consistent set.
+ * Keyframes must be added with consecutive ids starting at 0.
+ */
+class IncrementalPcm {
+ public:
+  KIMERA_POINTER_TYPEDEFS(IncrementalPcm);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(IncrementalPcm);
+
+  explicit IncrementalPcm(const IncrementalPcmParams& params);
+  ~IncrementalPcm() = default;
+
+  //! Odometry estimate of the next keyframe.
+  void addOdometry(const FrameId& key, const gtsam::Pose3& W_Pose_B);
+
+  /**
+   * @brief addLoopClosure Checks a loop closure between two keyframes
+   * already added.
+   * @return Indices (in order of addition, starting at 0) of the loop
+   * closures accepted by this one: itself if accepted, and the previous ones
+   * accepted with it.
+   */
+  std::vector<size_t> addLoopClosure(const FrameId& ref_key,
+                                     const FrameId& cur_key,
+                                     const gtsam::Pose3& ref_Pose_cur);
+
+  inline size_t getNumLC() const { return loop_closures_.size(); }
+  inline size_t getNumLCInliers() const { return nr_accepted_; }
+  //! Nr of pairwise consistency checks computed (not cached) so far.
+  inline size_t getNumConsistencyChecks() const { return nr_checks_; }
+
+ private:
+  struct LoopClosure {
+    FrameId ref_key;
+    FrameId cur_key;
+    gtsam::Pose3 ref_Pose_cur;
+    bool accepted;
+    //! Cached consistency with the previous loop closures checked.
+    std::unordered_map<size_t, bool> consistent_with;
+  };
+
+  //! Previous loop closures in the group of the given one.
+  std::vector<size_t> getGroup(const size_t& index) const;
+
+  //! Cached.
+  bool areConsistent(const size_t& i, const size_t& j);
+
+  //! Greedy max-clique of the consistency graph of the group.
+  std::vector<size_t> findMaxClique(const std::vector<size_t>& group);
+
+ private:
+  const IncrementalPcmParams params_;
+  //! Indexed by keyframe id.
+  std::vector<gtsam::Pose3> W_Pose_B_;
+  std::vector<LoopClosure> loop_closures_;
+  size_t nr_accepted_;
+  size_t nr_checks_;
+};
+
+}  // namespace VIO
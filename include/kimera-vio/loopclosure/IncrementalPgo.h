@@ -0,0 +1,159 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   IncrementalPgo.h
+ * @brief  Incremental (iSAM2) pose graph optimization of the LCD keyframes,
+ * with sparsified odometry chains and a bounded solve time.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/linear/NoiseModel.h>
+#include <gtsam/nonlinear/ISAM2.h>
+#include <gtsam/nonlinear/NonlinearFactorGraph.h>
+#include <gtsam/nonlinear/Values.h>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+struct IncrementalPgoParams {
+  //! Use IncrementalPgo instead of KimeraRPGO's RobustSolver in the LCD.
+  bool enabled = false;
+  //! A keyframe only becomes a node of the pose graph if it moved at least
+  //! this much wrt the last node (0: all keyframes are nodes), or if it is
+  //! max_keyframes_between_nodes keyframes away from it.
+  double min_node_translation = 0.0;  // [m]
+  double min_node_rotation = 0.0;     // [rad]
+  int max_keyframes_between_nodes = 10;
+  //! After a loop closure, iSAM2 iterates again (to converge) at most
+  //! max_solve_iterations times, while within max_solve_time_ms.
+  int max_solve_iterations = 5;
+  double max_solve_time_ms = 50.0;
+  double relinearize_threshold = 0.01;
+  //! Width of the Cauchy kernel of the loop-closure factors (0: no kernel).
+  //! There is no PCM outlier rejection as in KimeraRPGO.
+  double loop_closure_cauchy_width = 0.0;
+};
+
+/**
+ * @brief The IncrementalPgo class optimizes the pose graph of the LCD
+ * keyframes with iSAM2 instead of re-solving it on every loop closure.
+ * Keyframes must be added with consecutive ids starting at 0.
+ *
+ * To bound the size of the graph, only some keyframes are nodes: the
+ * odometry of the keyframes in between is composed into a single between
+ * factor (composing their covariances too), and these keyframes are then
+ * expressed wrt their previous node. Loop closures involving them are
+ * expressed between their nodes (the latest keyframe becomes a node).
+ */
+class IncrementalPgo {
+ public:
+  KIMERA_POINTER_TYPEDEFS(IncrementalPgo);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(IncrementalPgo);
+
+  explicit IncrementalPgo(const IncrementalPgoParams& params);
+  ~IncrementalPgo() = default;
+
+  //! First keyframe (id 0), with a prior.
+  void initialize(const FrameId& key,
+                  const gtsam::Pose3& W_Pose_B,
+                  const gtsam::SharedNoiseModel& noise);
+
+  //! Next keyframe, given its pose wrt the previous keyframe. The noise must
+  //! be Gaussian.
+  void addOdometry(const FrameId& key,
+                   const gtsam::Pose3& Blkf_Pose_Bkf,
+                   const gtsam::SharedNoiseModel& noise);
+
+  /**
+   * @brief addLoopClosure Adds a loop closure between two keyframes.
+   * @param optimize If false, the factor is only added (to the graph solved)
+   * at the next loop closure with optimize set.
+   */
+  void addLoopClosure(const FrameId& ref_key,
+                      const FrameId& cur_key,
+                      const gtsam::Pose3& ref_Pose_cur,
+                      const gtsam::SharedNoiseModel& noise,
+                      const bool& optimize = true);
+
+  /**
+   * @brief addPrior Adds a prior on the pose of a keyframe, e.g. wrt a prior
+   * map, with the robust kernel of the loop closures. Solved as addLoopClosure.
+   */
+  void addPrior(const FrameId& key,
+                const gtsam::Pose3& W_Pose_B,
+                const gtsam::SharedNoiseModel& noise,
+                const bool& optimize = true);
+
+  //! Estimated poses of all the keyframes (not only of the nodes).
+  gtsam::Values calculateEstimate() const;
+
+  //! Estimated pose of a keyframe, without estimating all the others.
+  gtsam::Pose3 calculateEstimate(const FrameId& key) const;
+
+  //! Factors of the sparsified graph (between nodes).
+  gtsam::NonlinearFactorGraph getFactors() const;
+
+  //! Nr of keyframes.
+  inline size_t size() const { return keyframes_.size(); }
+  inline size_t getNumNodes() const { return nr_nodes_; }
+  inline size_t getNumLC() const { return nr_loop_closures_; }
+  //! Duration of the last solve with a loop closure.
+  inline double getLastSolveTimeMs() const { return last_solve_time_ms_; }
+
+ private:
+  //! A keyframe, wrt its node (itself if it is a node).
+  struct KeyframeAnchor {
+    FrameId node;
+    gtsam::Pose3 node_Pose_kf;
+  };
+
+  bool isNodeNeeded(const gtsam::Pose3& node_Pose_kf) const;
+
+  //! Makes the latest keyframe a node, with a factor from the previous node
+  //! composing the chained odometry.
+  void addNode(const FrameId& key);
+
+  //! Updates iSAM2 with the pending factors (and the pending loop closures if
+  //! solve_loop_closures), iterating again within the budget in that case.
+  void update(const bool& solve_loop_closures);
+
+ private:
+  const IncrementalPgoParams params_;
+  std::unique_ptr<gtsam::ISAM2> isam_;
+
+  //! Indexed by keyframe id.
+  std::vector<KeyframeAnchor> keyframes_;
+  FrameId last_node_;
+  size_t nr_nodes_;
+  //! Covariance of the odometry chained since the last node, in the tangent
+  //! space of the latest keyframe.
+  gtsam::Matrix6 chain_covariance_;
+  int nr_chained_keyframes_;
+
+  gtsam::NonlinearFactorGraph pending_factors_;
+  gtsam::Values pending_values_;
+  gtsam::NonlinearFactorGraph pending_loop_closures_;
+  size_t nr_loop_closures_;
+  double last_solve_time_ms_;
+
+  //! Invalidated by every iSAM2 update.
+  mutable std::optional<gtsam::Values> estimate_cache_;
+};
+
+}  // namespace VIO
@@ -0,0 +1,102 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   KeyframeSpatialIndex.h
+ * @brief  Grid over the keyframe positions, to gate loop closure candidates.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <gtsam/geometry/Point3.h>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+struct SpatialGatingParams {
+  //! Only score the keyframes near the query in the BoW database, instead
+  //! of all of them (see KeyframeSpatialIndex).
+  bool enabled = false;
+  //! Uncertainty of the relative position of two keyframes: min_radius plus
+  //! drift_fraction of the distance traveled between them.
+  double min_radius = 5.0;  // [m]
+  double drift_fraction = 0.05;
+  //! Keyframes more uncertain than this are not gated: they are always
+  //! candidates.
+  double max_radius = 30.0;  // [m]
+  //! If more than this fraction of the database would be candidates, the
+  //! whole database is queried instead.
+  double max_candidate_fraction = 0.5;
+};
+
+/**
+ * @brief The KeyframeSpatialIndex class stores the (odometry) positions of
+ * the keyframes in a hash grid, to find the loop closure candidates of a
+ * query keyframe: the keyframes whose distance to it is within the
+ * uncertainty of their relative position. This uncertainty grows with the
+ * distance traveled between them, as the odometry drift: past max_radius,
+ * keyframes cannot be gated and are always candidates.
+ */
+class KeyframeSpatialIndex {
+ public:
+  KIMERA_POINTER_TYPEDEFS(KeyframeSpatialIndex);
+
+  explicit KeyframeSpatialIndex(const SpatialGatingParams& params);
+  ~KeyframeSpatialIndex() = default;
+
+  /**
+   * @brief addKeyframe Adds the position of the next keyframe: ids are
+   * consecutive, from the first one added. Keyframes before it (e.g. from a
+   * loaded map) have no position, hence are always candidates.
+   */
+  void addKeyframe(const FrameId& id, const gtsam::Point3& position);
+
+  inline bool hasKeyframe(const FrameId& id) const {
+    return !positions_.empty() && id >= first_id_ &&
+           id - first_id_ < positions_.size();
+  }
+
+  /**
+   * @brief getCandidates Keyframes with ids < max_id that may be at the
+   * position of the query keyframe.
+   * @param candidates Sorted candidate ids.
+   * @return False if the query keyframe has no position, or if the
+   * candidates are more than max_candidate_fraction of the keyframes: then
+   * all of them should be queried.
+   */
+  bool getCandidates(const FrameId& query_id,
+                     const FrameId& max_id,
+                     std::vector<unsigned int>* candidates) const;
+
+  inline size_t size() const { return positions_.size(); }
+
+ private:
+  int64_t getCellKey(const gtsam::Point3& position,
+                     const int& dx,
+                     const int& dy,
+                     const int& dz) const;
+
+ private:
+  const SpatialGatingParams params_;
+  FrameId first_id_;
+  std::vector<gtsam::Point3> positions_;
+  //! Distance traveled from the first keyframe, by keyframe.
+  std::vector<double> path_lengths_;
+  //! Keyframes by cell: cells are max_radius wide, so that the keyframes
+  //! within max_radius of a position are in its cell or the neighbor ones.
+  std::unordered_map<int64_t, std::vector<FrameId>> cells_;
+};
+
+}  // namespace VIO
@@ -17,6 +17,7 @@
 
 #include "kimera-vio/loopclosure/LoopClosureDetector.h"
 #include "kimera-vio/loopclosure/LoopClosureDetector-definitions.h"
+#include "kimera-vio/loopclosure/RemoteLoopClosureDetector.h"
 
 namespace VIO {
 
@@ -38,8 +39,22 @@ class LcdFactory {
       bool log_output,
       PreloadedVocab::Ptr&& preloaded_vocab = nullptr) {
     switch (lcd_type) {
-      case LoopClosureDetectorType::BoW: {
-        return std::make_unique<LoopClosureDetector>(lcd_params,
+      case LoopClosureDetectorType::BoW:
+      case LoopClosureDetectorType::GlobalDescriptor: {
+        LoopClosureDetectorParams params = lcd_params;
+        params.lcd_type_ = lcd_type;
+        if (!params.remote_server_host_.empty()) {
+          return std::make_unique<RemoteLoopClosureDetector>(
+              params,
+              tracker_cam_params,
+              B_Pose_Cam,
+              stereo_camera,
+              stereo_matching_params,
+              rgbd_camera,
+              log_output,
+              std::move(preloaded_vocab));
+        }
+        return std::make_unique<LoopClosureDetector>(params,
                                                      tracker_cam_params,
                                                      B_Pose_Cam,
                                                      stereo_camera,
@@ -51,7 +66,8 @@ class LcdFactory {
       default: {
         LOG(FATAL) << "Requested loop closure detector type is not supported.\n"
                    << "Currently supported loop closure detector types:\n"
-                   << "0: BoW \n but requested loop closure detector: "
+                   << "0: BoW \n1: GlobalDescriptor \n"
+                   << "but requested loop closure detector: "
                    << static_cast<int>(lcd_type);
       }
     }
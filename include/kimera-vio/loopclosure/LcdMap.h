@@ -0,0 +1,67 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   LcdMap.h
+ * @brief  Persisted state of the LoopClosureDetector (frames, bag-of-words
+ * database and pose graph), to detect loop closures against prior sessions.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <gtsam/nonlinear/NonlinearFactorGraph.h>
+#include <gtsam/nonlinear/Values.h>
+
+#include "kimera-vio/loopclosure/BowDatabase.h"
+#include "kimera-vio/loopclosure/FrameCache.h"
+#include "kimera-vio/loopclosure/LoopClosureDetector-definitions.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The LcdMap struct is the state of an LCD session, as saved by
+ * saveLcdMap. Frame i is entry i of the database and key i of the pose graph.
+ */
+struct LcdMap {
+  KIMERA_POINTER_TYPEDEFS(LcdMap);
+
+  std::vector<LCDFrame::Ptr> frames;
+  //! Optimized keyframe poses, in the world frame of that session.
+  gtsam::Values W_Pose_B;
+  //! Pose3 between and prior factors of the pose graph.
+  gtsam::NonlinearFactorGraph factors;
+  BowDatabase::UniquePtr database;
+};
+
+/**
+ * @brief saveLcdMap Writes the LCD state in an indexed binary file: a header
+ * with the offset and size of each section (frames, poses, factors and
+ * database), and, in the frames section, the offset and size of each frame,
+ * so that readers can seek to any of them.
+ * Only the Pose3 between and prior factors are saved (with a Gaussian noise,
+ * robust kernels are dropped).
+ */
+void saveLcdMap(const std::string& filepath,
+                const FrameCache& cache,
+                const gtsam::Values& W_Pose_B,
+                const gtsam::NonlinearFactorGraph& factors,
+                const BowDatabase& database);
+
+//! Reads a file written by saveLcdMap, whose database must have been built
+//! with the given vocabulary. Returns nullptr if the file can't be read.
+LcdMap::UniquePtr loadLcdMap(const std::string& filepath,
+                             const OrbVocabulary& vocab,
+                             const BowDatabaseParams& database_params =
+                                 BowDatabaseParams());
+
+}  // namespace VIO
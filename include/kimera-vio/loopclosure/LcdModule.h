@@ -15,6 +15,8 @@
 
 #pragma once
 
+#include <future>
+
 #include "kimera-vio/loopclosure/LoopClosureDetector-definitions.h"
 #include "kimera-vio/loopclosure/LoopClosureDetector.h"
 #include "kimera-vio/pipeline/PipelineModule.h"
@@ -29,23 +31,39 @@ class LcdModule : public MIMOPipelineModule<LcdInput, LcdOutput> {
   using LcdBackendInput = BackendOutput::Ptr;
 
   LcdModule(bool parallel_run, LoopClosureDetector::UniquePtr lcd);
+  /**
+   * @brief LcdModule whose detector is still being constructed (e.g. loading
+   * its vocabulary) by an asynchronous task. The inputs queue up meanwhile,
+   * and the first spin waits for the detector: no keyframe is missed.
+   * A deferred task is run right away.
+   */
+  LcdModule(bool parallel_run,
+            std::future<LoopClosureDetector::UniquePtr>&& lcd_future);
   virtual ~LcdModule() = default;
 
+  //! Whether the detector is constructed, i.e. the module processes inputs.
+  bool isLcdReady() const;
+
   inline void fillFrontendQueue(const LcdFrontendInput& frontend_payload) {
     if (!frontend_payload || !frontend_payload->is_keyframe_) {
       return;
     }
 
-    frontend_queue_.push(frontend_payload);
+    frontend_buffer_.push(frontend_payload->timestamp_, frontend_payload);
   }
 
   inline void fillBackendQueue(const LcdBackendInput& backend_payload) {
     backend_queue_.push(backend_payload);
   }
 
+  //! See LoopClosureDetector::registerRelocalizationCallback, it is
+  //! registered once the detector is constructed.
+  void registerRelocalizationCallback(
+      const LoopClosureDetector::RelocalizationCallback& cb);
+
   LoopResult registerFrames(FrameId first_kf, FrameId second_kf) {
     std::unique_lock<std::mutex> lock(mutex_);
-    return lcd_->registerFrames(first_kf, second_kf);
+    return getLcd().registerFrames(first_kf, second_kf);
   }
 
  protected:
@@ -54,13 +72,13 @@ class LcdModule : public MIMOPipelineModule<LcdInput, LcdOutput> {
 
   OutputUniquePtr spinOnce(LcdInput::UniquePtr input) override {
     std::unique_lock<std::mutex> lock(mutex_);
-    return lcd_->spinOnce(*input);
+    return getLcd().spinOnce(*input);
   }
 
   //! Called when general shutdown of PipelineModule is triggered.
   void shutdownQueues() override {
     LOG(INFO) << "Shutting down queues for: " << name_id_;
-    frontend_queue_.shutdown();
+    frontend_buffer_.shutdown();
     backend_queue_.shutdown();
   }
 
@@ -70,13 +88,27 @@ class LcdModule : public MIMOPipelineModule<LcdInput, LcdOutput> {
     return !backend_queue_.empty();
   }
 
+  //! The odometry of every keyframe goes to the pose graph: when optional or
+  //! decimated, the module sheds the loop detection instead of its inputs,
+  //! and defers the optimizations while the critical path is loaded.
+  bool admitInput() override { return true; }
+
  private:
   //! Input Queues
-  ThreadsafeQueue<LcdFrontendInput> frontend_queue_;
+  ThreadsafeRendezvousBuffer<LcdFrontendInput> frontend_buffer_;
   ThreadsafeQueue<LcdBackendInput> backend_queue_;
 
+  //! Waits for the detector if it is still being constructed. Call it with
+  //! mutex_ locked.
+  LoopClosureDetector& getLcd();
+
+  void registerLcdCallbacks();
+
   //! Lcd implementation
   LoopClosureDetector::UniquePtr lcd_;
+  //! Until lcd_ is constructed.
+  std::future<LoopClosureDetector::UniquePtr> lcd_future_;
+  LoopClosureDetector::RelocalizationCallback relocalization_cb_;
 
   // handles access to underlying lcd detector
   mutable std::mutex mutex_;
@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <optional>
+
 #include <gtsam/geometry/Pose3.h>
 #include <gtsam/nonlinear/NonlinearFactorGraph.h>
 #include <gtsam/nonlinear/Values.h>
@@ -69,14 +71,27 @@ struct LcdOutput : PipelinePayload {
   gtsam::Pose3 W_Pose_Map_;
   gtsam::Pose3 Map_Pose_Odom_;  // Map frame is the optimal (RPGO) global frame
                                 // and odom is the VIO estimate global frame
+  //! Map-frame poses updated by this keyframe, by keyframe id: only the new
+  //! keyframe, unless is_trajectory_corrected_, in which case the poses that
+  //! the optimization changed are also given. Apply them to the previous ones
+  //! to get the full trajectory.
   gtsam::Values states_;
+  //! True if a loop closure (or a prior) optimization changed the trajectory.
+  bool is_trajectory_corrected_;
+  //! Factors of the pose graph, only given when a loop closure was added or
+  //! the trajectory corrected (empty otherwise).
   gtsam::NonlinearFactorGraph nfg_;
   // frame information
   Landmarks keypoints_3d_;
   BearingVectors versors_;
   std::map<int, double> bow_vec_;
   cv::Mat descriptors_mat_;
+  //! Timestamps of the keyframes in states_.
   FrameIDTimestampMap timestamp_map_;
+  //! Pose of the map frame in the frame shared by the robots of a
+  //! RemoteLcdServer, once it aligned this robot with the others (unset
+  //! otherwise, e.g. when the loop closures run locally).
+  std::optional<gtsam::Pose3> Shared_Pose_Map_;
 };
 
 }  // namespace VIO
@@ -83,7 +83,8 @@ class LcdThirdPartyWrapper {
 
   /* ------------------------------------------------------------------------ */
   /** @brief Computes the various islands created by a QueryResult, which is
-   *  given by the OrbDatabase.
+   *  given by the OrbDatabase, in a single pass over the results sorted by id
+   *  (sorting them first if needed).
    * @param[in] q A QueryResults object containing all the resulting possible
    *  matches with a frame.
    * @param[out] A vector of MatchIslands, each of which is an island of
@@ -93,19 +94,6 @@ class LcdThirdPartyWrapper {
   void computeIslands(DBoW2::QueryResults* q,
                       std::vector<MatchIsland>* islands) const;
 
- private:
-  /* ------------------------------------------------------------------------ */
-  /** @brief Compute the overall score of an island.
-   * @param[in] q A QueryResults object containing all the possible matches
-   *  with a frame.
-   * @param[in] start_id The frame ID that starts the island.
-   * @param[in] end_id The frame ID that ends the island.
-   * @reutrn The score of the island.
-   */
-  double computeIslandScore(const DBoW2::QueryResults& q,
-                            const FrameId& start_id,
-                            const FrameId& end_id) const;
-
  private:
   LoopClosureDetectorParams lcd_params_;
   int temporal_entries_;
@@ -19,8 +19,11 @@
 #include <gtsam/geometry/Pose3.h>
 #include <gtsam/linear/NoiseModel.h>
 
+#include <limits>
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "kimera-vio/backend/VioBackend-definitions.h"
@@ -33,8 +36,24 @@ namespace VIO {
 typedef cv::Mat OrbDescriptor;
 typedef std::vector<OrbDescriptor> OrbDescriptorVec;
 
+/**
+ * @brief descriptorRows View of a descriptors matrix as one descriptor per
+ * row, as DBoW2 takes them: the rows are headers sharing the matrix data,
+ * no descriptor is copied.
+ */
+inline OrbDescriptorVec descriptorRows(const OrbDescriptor& descriptors_mat) {
+  OrbDescriptorVec descriptors_vec;
+  descriptors_vec.reserve(descriptors_mat.rows);
+  for (int i = 0; i < descriptors_mat.rows; ++i) {
+    descriptors_vec.push_back(descriptors_mat.row(i));
+  }
+  return descriptors_vec;
+}
+
 enum class LoopClosureDetectorType {
   BoW = 0u,  //! Bag of Words approach
+  //! Global image descriptors in an approximate nearest neighbor index.
+  GlobalDescriptor = 1u,
 };
 
 enum class LCDStatus : int {
@@ -45,9 +64,13 @@ enum class LCDStatus : int {
   NO_GROUPS,
   FAILED_TEMPORAL_CONSTRAINT,
   FAILED_GEOM_VERIFICATION,
-  FAILED_POSE_RECOVERY
+  FAILED_POSE_RECOVERY,
+  VERIFICATION_PENDING,     //! Queued for asynchronous verification.
+  VERIFICATION_QUEUE_FULL,  //! Dropped, too many pending verifications.
 };
 
+class FrameReader;
+
 struct LCDFrame {
   KIMERA_POINTER_TYPEDEFS(LCDFrame);
   LCDFrame() = default;
@@ -57,7 +80,6 @@ struct LCDFrame {
            const FrameId& id_kf,
            const std::vector<cv::KeyPoint>& keypoints,
            const Landmarks& keypoints_3d,
-           const OrbDescriptorVec& descriptors_vec,
            const OrbDescriptor& descriptors_mat,
            const BearingVectors& bearing_vectors)
       : timestamp_(timestamp),
@@ -65,29 +87,40 @@ struct LCDFrame {
         id_kf_(id_kf),
         keypoints_(keypoints),
         keypoints_3d_(keypoints_3d),
-        descriptors_vec_(descriptors_vec),
-        descriptors_mat_(descriptors_mat),
+        descriptors_mat_(descriptors_mat.isContinuous()
+                             ? descriptors_mat
+                             : descriptors_mat.clone()),
         bearing_vectors_(bearing_vectors) {}
 
   virtual ~LCDFrame() = default;
 
   virtual void save(std::ostream& buffer) const;
 
-  static LCDFrame::Ptr load(std::istream& buffer);
+  /**
+   * @brief load Reads a frame written by save, of at most max_bytes: the
+   * counts in the data are checked against the bytes left, as the frames may
+   * come from the network (see RemoteLcdCodec).
+   * @return The frame, or nullptr if the data is truncated or invalid.
+   */
+  static LCDFrame::Ptr load(
+      std::istream& buffer,
+      const size_t& max_bytes = std::numeric_limits<size_t>::max());
 
   Timestamp timestamp_;
   FrameId id_;
   FrameId id_kf_;
   std::vector<cv::KeyPoint> keypoints_;
   Landmarks keypoints_3d_;
-  OrbDescriptorVec descriptors_vec_;
+  //! One descriptor per row, in a single continuous block: see
+  //! descriptorRows to give them to DBoW2.
   OrbDescriptor descriptors_mat_;
   BearingVectors bearing_vectors_;
 
  protected:
   virtual void saveBytes(std::ostream& buffer) const;
 
-  virtual void loadBytes(std::istream& buffer);
+  //! @return False if the data is truncated or invalid.
+  virtual bool loadBytes(FrameReader* reader);
 };
 
 struct StereoLCDFrame : LCDFrame {
@@ -99,7 +132,6 @@ struct StereoLCDFrame : LCDFrame {
                  const FrameId& id_kf,
                  const std::vector<cv::KeyPoint>& keypoints,
                  const Landmarks& keypoints_3d,
-                 const OrbDescriptorVec& descriptors_vec,
                  const OrbDescriptor& descriptors_mat,
                  const BearingVectors& bearing_vectors,
                  const StatusKeypointsCV& left_keypoints_rectified,
@@ -109,7 +141,6 @@ struct StereoLCDFrame : LCDFrame {
                  id_kf,
                  keypoints,
                  keypoints_3d,
-                 descriptors_vec,
                  descriptors_mat,
                  bearing_vectors),
         left_keypoints_rectified_(left_keypoints_rectified),
@@ -125,7 +156,7 @@ struct StereoLCDFrame : LCDFrame {
  protected:
   void saveBytes(std::ostream& buffer) const override;
 
-  void loadBytes(std::istream& buffer) override;
+  bool loadBytes(FrameReader* reader) override;
 };
 
 struct MatchIsland {
@@ -213,6 +244,14 @@ struct LoopResult {
         status_str = "FAILED_POSE_RECOVERY";
         break;
       }
+      case LCDStatus::VERIFICATION_PENDING: {
+        status_str = "VERIFICATION_PENDING";
+        break;
+      }
+      case LCDStatus::VERIFICATION_QUEUE_FULL: {
+        status_str = "VERIFICATION_QUEUE_FULL";
+        break;
+      }
     }
     return status_str;
   }
@@ -221,6 +260,15 @@ struct LoopResult {
   FrameId query_id_;
   FrameId match_id_;
   gtsam::Pose3 relative_pose_;
+
+  //! RANSAC statistics of the tracker that verified the candidate, zero if
+  //! it was not verified.
+  size_t mono_input_size_ = 0u;
+  size_t mono_inliers_ = 0u;
+  int mono_iter_ = 0;
+  size_t stereo_input_size_ = 0u;
+  size_t stereo_inliers_ = 0u;
+  int stereo_iter_ = 0;
 };  // struct LoopResult
 
 struct LcdDebugInfo {
@@ -276,20 +324,36 @@ struct LcdInput : public PipelinePayload {
   LcdInput(const Timestamp& timestamp,
            const FrontendOutputPacketBase::Ptr& frontend_output,
            const FrameId& cur_kf_id,
-           const PointsWithIdMap& W_points_with_ids,
+           PointsWithIdMap W_points_with_ids,
            const gtsam::Pose3& W_Pose_Blkf)
       : PipelinePayload(timestamp),
         frontend_output_(frontend_output),
         cur_kf_id_(cur_kf_id),
-        W_points_with_ids_(W_points_with_ids),
+        W_points_with_ids_(std::make_shared<const PointsWithIdMap>(
+            std::move(W_points_with_ids))),
         W_Pose_Blkf_(W_Pose_Blkf) {
     CHECK(frontend_output);
     CHECK_EQ(timestamp, frontend_output->timestamp_);
   }
 
+  //! Shares the landmarks of the Backend output instead of copying them.
+  LcdInput(const Timestamp& timestamp,
+           const FrontendOutputPacketBase::Ptr& frontend_output,
+           const BackendOutput::ConstPtr& backend_output)
+      : PipelinePayload(timestamp),
+        frontend_output_(frontend_output),
+        cur_kf_id_(CHECK_NOTNULL(backend_output)->cur_kf_id_),
+        W_points_with_ids_(backend_output,
+                           &backend_output->landmarks_with_id_map_),
+        W_Pose_Blkf_(backend_output->W_State_Blkf_.pose_) {
+    CHECK(frontend_output);
+    CHECK_EQ(timestamp, frontend_output->timestamp_);
+  }
+
   const FrontendOutputPacketBase::Ptr frontend_output_;
   const FrameId cur_kf_id_;
-  const PointsWithIdMap W_points_with_ids_;
+  //! Never null.
+  const std::shared_ptr<const PointsWithIdMap> W_points_with_ids_;
   const gtsam::Pose3 W_Pose_Blkf_;
 };
 
@@ -18,9 +18,14 @@
 #include <gtsam/geometry/Pose3.h>
 #include <gtsam/linear/NoiseModel.h>
 
+#include <condition_variable>
+#include <deque>
 #include <limits>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <opencv2/opencv.hpp>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -31,10 +36,20 @@
 #include "kimera-vio/frontend/StereoMatcher.h"
 #include "kimera-vio/frontend/Tracker.h"
 #include "kimera-vio/logging/Logger.h"
+#include "kimera-vio/loopclosure/BowDatabase.h"
 #include "kimera-vio/loopclosure/FrameCache.h"
+#include "kimera-vio/loopclosure/GlobalDescriptor.h"
+#include "kimera-vio/loopclosure/GpuOrbExtractor.h"
+#include "kimera-vio/loopclosure/HnswIndex.h"
+#include "kimera-vio/loopclosure/IncrementalPcm.h"
+#include "kimera-vio/loopclosure/IncrementalPgo.h"
+#include "kimera-vio/loopclosure/KeyframeSpatialIndex.h"
+#include "kimera-vio/loopclosure/LcdMap.h"
 #include "kimera-vio/loopclosure/LcdOutputPacket.h"
 #include "kimera-vio/loopclosure/LoopClosureDetector-definitions.h"
 #include "kimera-vio/loopclosure/LoopClosureDetectorParams.h"
+#include "kimera-vio/loopclosure/OrbHammingMatcher.h"
+#include "kimera-vio/utils/MemoryAccounting.h"
 
 /* ------------------------------------------------------------------------ */
 // Forward declare KimeraRPGO, a private dependency.
@@ -66,14 +81,30 @@ struct PreloadedVocab {
   KIMERA_DELETE_COPY_CONSTRUCTORS(PreloadedVocab);
   using Ptr = std::unique_ptr<PreloadedVocab>;
 
+  //! Loads the vocabulary at the vocabulary_path flag.
   PreloadedVocab();
+  //! Shares a loaded vocabulary (see PipelineContext).
+  explicit PreloadedVocab(std::shared_ptr<const OrbVocabulary> shared_vocab);
   PreloadedVocab(PreloadedVocab&& other);
   ~PreloadedVocab();
 
-  std::unique_ptr<OrbVocabulary> vocab;
+  //! Never modified: the databases of several detectors can share it.
+  std::shared_ptr<const OrbVocabulary> vocab;
 };
 
 /* ------------------------------------------------------------------------ */
+/**
+ * @brief The LoopClosureDetector class detects loop closures between keyframes
+ * and optimizes the PGO with them.
+ *
+ * If verification_num_workers_ > 0, the detection is split in two stages:
+ * spinOnce only adds the keyframe to the database and detects candidates
+ * (BoW query, islands and temporal constraint), which are queued (at most
+ * verification_queue_size_) to a pool of workers for the expensive geometric
+ * verification and pose recovery. The verified loop closures are added to the
+ * PGO at the next spinOnce, which still runs all the optimization: hence
+ * their LcdOutput is reported with a later keyframe than the query one.
+ */
 class LoopClosureDetector {
  public:
   KIMERA_POINTER_TYPEDEFS(LoopClosureDetector);
@@ -81,6 +112,11 @@ class LoopClosureDetector {
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
   using IsBackendQueueFilledCallback = std::function<bool()>;
+  using IsDetectionAdmittedCallback = std::function<bool()>;
+  //! Pose of a keyframe relocalized after a tracking loss, in the world
+  //! frame of the VIO estimates.
+  using RelocalizationCallback =
+      std::function<void(const FrameId& kf_id, const gtsam::Pose3& W_Pose_B)>;
 
   /* ------------------------------------------------------------------------ */
   /** @brief Constructor: detects loop-closures and updates internal PGO.
@@ -111,6 +147,34 @@ class LoopClosureDetector {
    */
   virtual LcdOutput::UniquePtr spinOnce(const LcdInput& input);
 
+  /* ------------------------------------------------------------------------ */
+  /** @brief spinOnce for a keyframe whose LCDFrame was already built, e.g. by
+   * a RemoteLoopClosureDetector on a robot: the frame is cached as is.
+   * Without tracker status, there is no relocalization after tracking loss.
+   * @param[in] kf_id Id of the keyframe: contiguous, as for spinOnce.
+   * @param[in] W_Pose_Blkf The VIO estimate of the keyframe.
+   * @param[in] frame The keyframe, of the type the pose recovery expects.
+   * @param[in] bow_vec Its BoW vector, computed from the frame if nullptr.
+   * @return The output payload from the pipeline.
+   */
+  LcdOutput::UniquePtr spinOnceWithFrame(
+      const Timestamp& timestamp,
+      const FrameId& kf_id,
+      const gtsam::Pose3& W_Pose_Blkf,
+      const LCDFrame::Ptr& frame,
+      const DBoW2::BowVector* bow_vec = nullptr);
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Geometric verification and pose recovery between two frames not
+   * necessarily in the cache (e.g. of another robot), as for the candidates
+   * of the loop detection. The frames must come from the same camera model.
+   * @param[out] result Its status_ and relative_pose_ (match_Pose_query, in
+   * the body frame) are set.
+   */
+  void verifyLoop(const LCDFrame& match_frame,
+                  const LCDFrame& query_frame,
+                  LoopResult* result);
+
   /* ------------------------------------------------------------------------ */
   /** @brief Register callback for checking the size of the input queue. Knowing
    * this can help determine when to optimize the factor graph and when to wait
@@ -122,6 +186,28 @@ class LoopClosureDetector {
     is_backend_queue_filled_cb_ = cb;
   }
 
+  /* ------------------------------------------------------------------------ */
+  /** @brief Register callback deciding, for each keyframe, whether to look
+   * for loop closures (e.g. not while the critical path is overloaded). The
+   * keyframe is added to the pose graph and the database in any case.
+   * Without callback, the detection runs on every keyframe.
+   * @param[in] cb A callback function.
+   */
+  inline void registerIsDetectionAdmittedCallback(
+      const IsDetectionAdmittedCallback& cb) {
+    is_detection_admitted_cb_ = cb;
+  }
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Register callback receiving the relocalizations after tracking
+   * losses (see LoopClosureDetectorParams::relocalize_after_tracking_loss_),
+   * e.g. to re-seed the Backend pose.
+   * @param[in] cb A callback function.
+   */
+  inline void registerRelocalizationCallback(const RelocalizationCallback& cb) {
+    relocalization_cb_ = cb;
+  }
+
   /* ------------------------------------------------------------------------ */
   /** @brief Processed a single frame and adds it to relevant internal
    * databases. Also generates associated bearing vectors for PnP.
@@ -230,6 +316,25 @@ class LoopClosureDetector {
    */
   LoopResult registerFrames(FrameId query_id, FrameId match_id);
 
+  /* ------------------------------------------------------------------------ */
+  /** @brief Blocks until all the queued candidates are verified (their results
+   * are added to the PGO at the next spinOnce). Returns immediately if the
+   * verification is not asynchronous.
+   */
+  void waitForPendingVerifications();
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Stops and joins the verification workers, the candidates still
+   * queued are dropped. Called by the destructor.
+   */
+  void shutdownVerification();
+
+  //! Nr of candidates dropped because the verification queue was full.
+  inline size_t getNrDroppedVerifications() const {
+    std::lock_guard<std::mutex> lock(verification_mutex_);
+    return nr_dropped_verifications_;
+  }
+
  public:
   /* ------------------------------------------------------------------------ */
   /** @brief Returns the RAW pointer to the BoW database.
@@ -238,7 +343,7 @@ class LoopClosureDetector {
    * WARNING: This is a potentially dangerous method to use because it requires
    *  a manual deletion of the pointer before it goes out of scope.
    */
-  inline const OrbDatabase* getBoWDatabase() const { return db_BoW_.get(); }
+  inline const BowDatabase* getBoWDatabase() const { return db_BoW_.get(); }
 
   /**
    * @brief Get cache of LCD keyframes.
@@ -275,16 +380,46 @@ class LoopClosureDetector {
   const gtsam::NonlinearFactorGraph getPGOnfg() const;
 
   /* ------------------------------------------------------------------------ */
-  /** @brief Set the OrbDatabase internal member.
-   * @param[in] db An OrbDatabase object.
+  /** @brief Set the BowDatabase internal member.
+   * @param[in] db A BowDatabase object.
    */
-  void setDatabase(const OrbDatabase& db);
+  void setDatabase(const BowDatabase& db);
 
-  /* @brief Set the vocabulary of the BoW detector.
+  /* @brief Set the vocabulary of the BoW detector (clears the database).
    * @param[in] voc An OrbVocabulary object.
    */
   void setVocabulary(const OrbVocabulary& voc);
 
+  /* ------------------------------------------------------------------------ */
+  /** @brief Saves the frames, database and PGO of this session (see
+   * saveLcdMap), to be loaded as the prior map of a next session.
+   * @return False if the database does not hold all the frames, e.g. if the
+   * detection was disabled.
+   */
+  bool saveMap(const std::string& filepath) const;
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Loads the map of a prior session, built with the same vocabulary:
+   * next keyframes are also matched against its frames, and these loop
+   * closures are added to the PGO as priors wrt the prior map (kept fixed),
+   * expressed in the world frame of this session thanks to the transform
+   * estimated by the first of them.
+   */
+  bool loadPriorMap(const std::string& filepath);
+
+  //! Pose of this session's world frame in the prior map's world frame,
+  //! once relocalized in the prior map.
+  inline std::optional<gtsam::Pose3> getPriorMapPoseWorld() const {
+    return Map_Pose_W_;
+  }
+  inline size_t getNumPriorMapLC() const { return nr_prior_map_lc_; }
+
+  //! Whether tracking was lost and the keyframes are not relocalized yet.
+  inline bool isTrackingLost() const {
+    return tracking_lost_kf_id_.has_value();
+  }
+  inline size_t getNrRelocalizations() const { return nr_relocalizations_; }
+
   /* ------------------------------------------------------------------------ */
   /* @brief Prints parameters and other statistics on the LoopClosureDetector.
    */
@@ -337,11 +472,21 @@ class LoopClosureDetector {
 
   /* ------------------------------------------------------------------------ */
   /** @brief Adds a loop-closure factor to the PGO and optimizes the trajectory.
+   * With lcd_params_.incremental_pcm, only once consistent with the others.
+   * The factor is buffered until loop_closure_batch_size_ loop closures are,
+   * see addLoopClosureBatchAndOptimize.
    * @param[in] factor A LoopClosureFactor representing the relative pose
    *  between two frames that are not (necessarily) consecutive.
    */
   void addLoopClosureFactorAndOptimize(const LoopClosureFactor& factor);
 
+  /* ------------------------------------------------------------------------ */
+  /** @brief Adds the buffered loop-closure factors to the PGO with a single
+   * update, and optimizes it (unless more loop closures are expected, see
+   * max_lc_cached_before_optimize_).
+   */
+  void addLoopClosureBatchAndOptimize();
+
   /* ------------------------------------------------------------------------ */
   /** @brief Initializes the RobustSolver member with an initial prior factor,
    *  which can be the first OdometryFactor given by the Backend.
@@ -364,7 +509,53 @@ class LoopClosureDetector {
                                 KeypointMatches* matches_match_query,
                                 bool cut_matches = false) const;
 
+  /** @brief Same as computeDescriptorMatches (with Lowe's Ratio Test), but
+   * only matching keypoints in the same BoW vocabulary node
+   * (bow_guided_matching_levels_up_ levels up from the words).
+   * @param[in] ref_frame The match frame.
+   * @param[in] cur_frame The query frame.
+   * @param[out] matches_match_query Map of matching keypoint indices between
+   * match frame and query frame.
+   */
+  void computeBowGuidedDescriptorMatches(
+      const LCDFrame& ref_frame,
+      const LCDFrame& cur_frame,
+      KeypointMatches* matches_match_query) const;
+
+ protected:
+  /* ------------------------------------------------------------------------ */
+  /** @brief Builds the LCDFrame of the keyframe of the input with the
+   * processAndAdd*Frame of its frontend type, and stores it with storeFrame.
+   * @return The local ID of the frame.
+   */
+  FrameId processAndAddFrame(const LcdInput& input);
+
+  //! BoW vector of the descriptors of the frame, with the vocabulary.
+  void computeBowVector(const LCDFrame& frame, DBoW2::BowVector* bow_vec) const;
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Stores a frame built by processAndAdd*Frame: adds it to the frame
+   * cache, by default. Overridden to not keep the frames locally.
+   * @return The local ID of the frame, which is set in it.
+   */
+  virtual FrameId storeFrame(const LCDFrame::Ptr& frame);
+
  private:
+  //! Adds the keyframe and its VIO estimate to the PGO.
+  void addKeyframeOdometry(const Timestamp& timestamp,
+                           const FrameId& kf_id,
+                           const gtsam::Pose3& W_Pose_Blkf);
+
+  //! Detects and adds the loop closures of the keyframe lcd_frame_id, once
+  //! cached, and builds the output. The BoW vector is computed if nullptr.
+  LcdOutput::UniquePtr detectAndOutput(
+      const Timestamp& timestamp,
+      const FrameId& cur_kf_id,
+      const gtsam::Pose3& W_Pose_Blkf,
+      const FrameId& lcd_frame_id,
+      const TrackerStatusSummary* tracker_status,
+      const DBoW2::BowVector* bow_vec);
+
   /* ------------------------------------------------------------------------ */
   /** @brief Detect features in frame for use with BoW and return keypoints and
    * descriptors. Currently only ORB features are supported.
@@ -372,20 +563,37 @@ class LoopClosureDetector {
    * @param[out] keypoints The ORB keypoints that are detected in the image.
    * @param[out] descriptors_mat The descriptors associated with the ORB
    * keypoints in a matrix form.
-   * @param[out] descriptors_vec The descriptors vectorized.
    */
   void getNewFeaturesAndDescriptors(const cv::Mat& img,
                                     std::vector<cv::KeyPoint>* keypoints,
                                     OrbDescriptor* descriptors_mat);
 
   /* ------------------------------------------------------------------------ */
-  /** @brief Convert an ORB descriptor from matrix form to vector form for
-   * use with BoW.
-   * @param[in] descriptors_mat An OrbDescriptor matrix with input descriptors
-   * @param[out] descriptors_vec The descriptors in vectorize format
+  /** @brief Compute ORB descriptors at given keypoints (e.g. tracked by the
+   * frontend) instead of detecting new ones. Their orientation is computed
+   * as cv::ORB does for the keypoints it detects.
+   * @param[in] img Image in which the keypoints are.
+   * @param[in] keypoints_cv The keypoints.
+   * @param[out] keypoints The ORB keypoints with descriptors.
+   * @param[out] descriptors_mat Their descriptors in a matrix form.
+   * @param[out] indices The index in keypoints_cv of each ORB keypoint: ORB
+   * drops the keypoints too close to the image border.
    */
-  void descriptorMatToVec(const OrbDescriptor& descriptors_mat,
-                          OrbDescriptorVec* descriptors_vec);
+  void getDescriptorsAtKeypoints(const cv::Mat& img,
+                                 const KeypointsCV& keypoints_cv,
+                                 std::vector<cv::KeyPoint>* keypoints,
+                                 OrbDescriptor* descriptors_mat,
+                                 std::vector<size_t>* indices);
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief processAndAddMonoFrame for the PnP pose recovery, with descriptors
+   * computed at the tracked keypoints that have a landmark in the backend
+   * (lcd_params_.reuse_frontend_features_).
+   */
+  FrameId processAndAddMonoFrameWithTrackedFeatures(
+      const Frame& frame,
+      const PointsWithIdMap& W_points_with_ids,
+      const gtsam::Pose3& W_Pose_Blkf);
 
   /* ------------------------------------------------------------------------ */
   /** @brief Refine relative pose given by ransac using smart factors.
@@ -403,7 +611,131 @@ class LoopClosureDetector {
                            const gtsam::Pose3& camMatch_T_camQuery_3d,
                            const KeypointMatches& matches_query_match);
 
+  /* ------------------------------------------------------------------------ */
+  //! verifyAndRecoverPose, geometricVerificationCam2d2d and recoverPoseBody
+  //! using the given tracker for outlier rejection, so that each verification
+  //! worker can use its own tracker.
+  void verifyAndRecoverPose(const LCDFrame& match_frame,
+                            const LCDFrame& query_frame,
+                            Tracker* tracker,
+                            LoopResult* result);
+  bool geometricVerificationCam2d2d(const LCDFrame& ref_frame,
+                                    const LCDFrame& cur_frame,
+                                    const KeypointMatches& matches_query_match,
+                                    Tracker* tracker,
+                                    gtsam::Pose3* camMatch_T_camQuery_2d,
+                                    std::vector<int>* inliers);
+  bool recoverPoseBody(const LCDFrame& ref_frame,
+                       const LCDFrame& cur_frame,
+                       const gtsam::Pose3& camMatch_T_camQuery_2d,
+                       const KeypointMatches& matches_query_match,
+                       Tracker* tracker,
+                       gtsam::Pose3* bodyMatch_T_bodyQuery_3d,
+                       std::vector<int>* inliers);
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Builds the loop-closure factor of a verified loop closure (with
+   * the noise model of the pose recovery type) and optimizes the PGO.
+   * @param[in] loop_result A LoopResult with status LOOP_DETECTED.
+   */
+  void addLoopClosure(const LoopResult& loop_result);
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Matches a keyframe against the prior map's database (with the
+   * same score thresholds as detectLoop) and verifies the best match.
+   * @param[out] result Loop result, whose match_id_ is the prior map frame.
+   */
+  void detectPriorMapLoop(const LCDFrame& query_frame,
+                          const DBoW2::BowVector& bow_vec,
+                          LoopResult* result);
+
+  //! Adds the prior factor (wrt the prior map) of a verified loop closure
+  //! with the prior map.
+  void addPriorMapFactor(const LoopResult& loop_result);
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Tracks the tracking losses of the Frontend and, once it tracks
+   * again, matches the keyframe against the keyframes before the loss (whose
+   * VIO estimate did not drift yet). The best match is verified (same
+   * pose recovery as loop closures) and the relocalized pose is sent to the
+   * relocalization callback.
+   * @param[in] frame_id Keyframe, already added to the database.
+   * @param[in] bow_vec Its BoW vector.
+   * @param[in] tracker_status Tracking status of the keyframe.
+   * @param[out] result Loop result of the relocalization, if attempted.
+   * @return True if the keyframe was relocalized.
+   */
+  bool relocalizeAfterTrackingLoss(const FrameId& frame_id,
+                                   const DBoW2::BowVector& bow_vec,
+                                   const TrackerStatusSummary& tracker_status,
+                                   LoopResult* result);
+
+  /* ------------------------------------------------------------------------ */
+  /** @brief Queues a detected candidate for asynchronous verification, sets
+   * its status to VERIFICATION_PENDING (or VERIFICATION_QUEUE_FULL if the
+   * queue is full, in which case it is dropped).
+   * @param[in/out] result The candidate (uses match and query id).
+   */
+  void queueVerification(LoopResult* result);
+
+  //! Loop of a verification worker, verifying candidates with its tracker.
+  void verificationWorker(Tracker* tracker);
+
+  //! Moves out the results verified since the last call.
+  std::vector<LoopResult> takeVerifiedResults();
+
+  //! (Re)creates the global descriptor extractor and index, if used.
+  void resetGlobalDescriptors(const OrbVocabulary& voc);
+
+  //! Global descriptor of a cached frame, computed once for the latest one.
+  const std::vector<float>& getGlobalDescriptor(const FrameId& frame_id);
+
+  /**
+   * @brief addToDatabase Adds a keyframe to the database (and global
+   * descriptor index), unless lcd_params_.database_insertion rejects it.
+   * @return True if added.
+   */
+  bool addToDatabase(const FrameId& frame_id, const DBoW2::BowVector& bow_vec);
+
+  //! Whether a keyframe is novel enough to be added to the database.
+  bool isNovelKeyframe(const FrameId& frame_id,
+                       const DBoW2::BowVector& bow_vec) const;
+
+  //! Nr of database entries of the keyframes with ids < frame_id, i.e. the
+  //! max entry id to query for them. -1 (all) if frame_id is.
+  int getNrEntriesBefore(const int& frame_id) const;
+
+  //! Replaces the database entry ids of query results by their keyframe ids.
+  void entryToFrameIds(DBoW2::QueryResults* query_result) const;
+
+  inline bool isVerificationAsync() const {
+    return !verification_workers_.empty();
+  }
+
+  //! Estimate and factors of the PGO in use (robust or incremental).
+  gtsam::Values calculatePgoEstimate() const;
+  gtsam::NonlinearFactorGraph getPgoFactors() const;
+  //! Estimate of a single keyframe, cheap for the latest one.
+  gtsam::Pose3 calculatePgoEstimate(const FrameId& key) const;
+
+  //! Poses of the PGO changed since the last output (see LcdOutput::states_):
+  //! the latest keyframe, and the ones that moved if the PGO was optimized
+  //! since. Updates published_trajectory_.
+  //! @param[out] is_corrected True if keyframes other than the latest moved.
+  gtsam::Values updatePublishedTrajectory(bool* is_corrected);
+
+  //! To call after each optimization of the PGO.
+  void setPgoOptimized();
+
  private:
+  //! A candidate waiting for verification, with its frames so that the
+  //! workers do not access the frame cache.
+  struct VerificationCandidate {
+    LoopResult result;
+    LCDFrame::Ptr match_frame;
+    LCDFrame::Ptr query_frame;
+  };
+
   enum class LcdState {
     Bootstrap,  //! Lcd is initializing
     Nominal     //! Lcd is running in nominal mode
@@ -417,20 +749,63 @@ class LoopClosureDetector {
   // TODO(Toni): we should be using the FeatureDetector/Description class...
   // ORB extraction and matching members
   cv::Ptr<cv::ORB> orb_feature_detector_;
+  //! Used instead of orb_feature_detector_ to extract new features if
+  //! lcd_params_.use_gpu_orb_ (and a GPU is available).
+  GpuOrbExtractor::UniquePtr gpu_orb_extractor_;
   cv::Ptr<cv::DescriptorMatcher> orb_feature_matcher_;
+  //! Used instead of orb_feature_matcher_ if it is a Hamming matcher.
+  OrbHammingMatcher orb_hamming_matcher_;
+  bool use_orb_hamming_matcher_;
 
   // TODO(marcus): want to move outlier-rejection to its own file
   // Tracker for outlier rejection
   Tracker::UniquePtr tracker_;
 
   // BoW database
-  std::unique_ptr<OrbDatabase> db_BoW_;
+  std::unique_ptr<BowDatabase> db_BoW_;
+  //! Keyframe of each database entry, increasing: not all the keyframes are
+  //! added if lcd_params_.database_insertion.enabled.
+  std::vector<FrameId> db_frame_ids_;
+  //! BoW vectors and position of the latest entries, to detect novelty.
+  std::deque<DBoW2::BowVector> recent_db_bowvecs_;
+  std::optional<gtsam::Point3> last_db_position_;
+  //! Gates the database queries by keyframe position, if
+  //! lcd_params_.spatial_gating.enabled.
+  KeyframeSpatialIndex::UniquePtr spatial_index_;
+  //! Retrieval of the loop candidates instead of db_BoW_ (still kept for
+  //! relocalization and maps), if lcd_params_.lcd_type_ is
+  //! LoopClosureDetectorType::GlobalDescriptor.
+  GlobalDescriptorExtractor::UniquePtr global_descriptor_extractor_;
+  HnswIndex::UniquePtr global_descriptor_index_;
+  std::optional<FrameId> global_descriptor_id_;
+  std::vector<float> global_descriptor_;
+  //! As latest_bowvec_.
+  std::vector<float> latest_global_descriptor_;
   FrameCache cache_;
+  utils::MemoryGauge frame_cache_memory_;
+  utils::MemoryGauge bow_database_memory_;
   FrameIDTimestampMap timestamp_map_;
 
   // Store latest computed objects for temporal matching and nss scoring
   std::unique_ptr<LcdThirdPartyWrapper> lcd_tp_wrapper_;
   std::unique_ptr<DBoW2::BowVector> latest_bowvec_;
+  //! Match of the last loop closure, whose successors are prefetched.
+  std::optional<FrameId> last_match_id_;
+
+  //! Map of a prior session, if lcd_params_.prior_map_path_ is set.
+  LcdMap::UniquePtr prior_map_;
+  std::optional<gtsam::Pose3> Map_Pose_W_;
+  size_t nr_prior_map_lc_;
+
+  //! First keyframe of the ongoing tracking loss, if any.
+  std::optional<FrameId> tracking_lost_kf_id_;
+  //! Keyframes tracked again, but not relocalized, since the loss.
+  int nr_relocalization_attempts_;
+  size_t nr_relocalizations_;
+  //! VIO estimate of the keyframes, indexed by keyframe id, if
+  //! relocalize_after_tracking_loss_.
+  std::vector<gtsam::Pose3> vio_trajectory_;
+  RelocalizationCallback relocalization_cb_;
 
   // Store camera parameters and StereoFrame stuff once
   gtsam::Pose3 B_Pose_Cam_;
@@ -442,15 +817,49 @@ class LoopClosureDetector {
 
   // Robust PGO members
   std::unique_ptr<KimeraRPGO::RobustSolver> pgo_;
+  //! Used instead of pgo_ if lcd_params_.incremental_pgo.enabled.
+  std::unique_ptr<IncrementalPgo> incremental_pgo_;
+  //! Outlier rejection of the loop closures instead of KimeraRPGO's PCM, if
+  //! lcd_params_.incremental_pcm.window_size > 0.
+  IncrementalPcm::UniquePtr incremental_pcm_;
+  //! Loop closures given to incremental_pcm_, by index.
+  std::vector<LoopClosureFactor> pcm_loop_closures_;
   std::pair<gtsam::Symbol, gtsam::Pose3> W_Pose_B_kf_vio_;
+  //! Estimate of pgo_ for the latest keyframe: pgo_ only optimizes on loop
+  //! closures and priors, where it is refreshed.
+  std::pair<gtsam::Symbol, gtsam::Pose3> W_Pose_B_kf_pgo_;
+  //! True if the PGO was optimized since the last output.
+  bool is_pgo_optimized_;
+  //! Keyframe poses sent in the outputs, indexed by keyframe id.
+  std::vector<gtsam::Pose3> published_trajectory_;
   gtsam::SharedNoiseModel shared_noise_model_;
 
   // Queue-checking callback
   IsBackendQueueFilledCallback is_backend_queue_filled_cb_;
+  IsDetectionAdmittedCallback is_detection_admitted_cb_;
   int num_lc_unoptimized_;
+  //! Accepted loop closures not added to the PGO yet, and the keyframe at
+  //! which the first of them was buffered.
+  std::vector<LoopClosureFactor> pending_loop_closures_;
+  FrameId pending_loop_closures_kf_id_;
+
+  // Asynchronous verification members
+  //! One tracker per worker, owned here.
+  std::vector<Tracker::UniquePtr> verification_trackers_;
+  std::vector<std::thread> verification_workers_;
+  //! Protects the members below.
+  mutable std::mutex verification_mutex_;
+  std::condition_variable verification_cv_;
+  std::deque<VerificationCandidate> pending_verifications_;
+  std::vector<LoopResult> verified_results_;
+  size_t nr_verifying_;
+  size_t nr_dropped_verifications_;
+  bool shutdown_verification_;
 
   // Logging members
   std::unique_ptr<LoopClosureDetectorLogger> logger_;
+  //! The verification workers also log.
+  std::mutex logger_mutex_;
   LcdDebugInfo debug_info_;
 };
 
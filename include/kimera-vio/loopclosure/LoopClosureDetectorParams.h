@@ -21,7 +21,12 @@
 #include <string>
 
 #include "kimera-vio/frontend/VisionImuTrackerParams.h"
+#include "kimera-vio/loopclosure/BowDatabase.h"
 #include "kimera-vio/loopclosure/FrameCache.h"
+#include "kimera-vio/loopclosure/GlobalDescriptor.h"
+#include "kimera-vio/loopclosure/IncrementalPcm.h"
+#include "kimera-vio/loopclosure/IncrementalPgo.h"
+#include "kimera-vio/loopclosure/KeyframeSpatialIndex.h"
 #include "kimera-vio/loopclosure/LoopClosureDetector-definitions.h"
 #include "kimera-vio/pipeline/PipelineParams.h"
 #include "kimera-vio/utils/YamlParser.h"
@@ -34,6 +39,23 @@ enum class PoseRecoveryType {
   k5ptRotOnly = 2,
 };
 
+/**
+ * @brief Policy adding keyframes to the loop closure database (BoW and global
+ * descriptors) only if they are novel, so that it grows with the area
+ * explored rather than with the duration of the session. All the keyframes
+ * are still queried and kept in the frame cache.
+ */
+struct DatabaseInsertionParams {
+  //! If false, all the keyframes are added.
+  bool enabled = false;
+  //! A keyframe is novel if its BoW score to each of the recent entries is
+  //! below this...
+  double max_similarity = 0.3;
+  int nr_recent_entries = 3;
+  //! ...or if it moved by more than this (m) since the last entry.
+  double min_translation = 2.0;
+};
+
 class LoopClosureDetectorParams : public PipelineParams {
  public:
   KIMERA_POINTER_TYPEDEFS(LoopClosureDetectorParams);
@@ -74,6 +96,18 @@ class LoopClosureDetectorParams : public PipelineParams {
   int max_nrFrames_between_queries_ =
       2;  // Max separation between two queries s.t. they count towards
           // min_temporal_matches_
+  int verification_num_workers_ =
+      0;  // Threads verifying the candidates (geometric verification and
+          // pose recovery) asynchronously; if 0, verified in spinOnce
+  int verification_queue_size_ =
+      10;  // Max nr of candidates waiting for asynchronous verification
+  int prefetch_top_k_ =
+      0;  // Nr of best BoW matches whose frames the cache loads from disk in
+          // the background; if 0, no prefetching
+  int prefetch_temporal_neighbors_ =
+      0;  // Nr of frames after the last loop-closure match to prefetch
+  LoopClosureDetectorType lcd_type_ =
+      LoopClosureDetectorType::BoW;  // Retrieval of the loop candidates
   //////////////////////////////////////////////////////////////////////////////
 
   /////////////////////////// 3D Pose Recovery Params //////////////////////////
@@ -90,6 +124,14 @@ class LoopClosureDetectorParams : public PipelineParams {
   cv::DescriptorMatcher::MatcherType matcher_type_ =
       cv::DescriptorMatcher::MatcherType::BRUTEFORCE_L1;
 #endif
+  // With BRUTEFORCE_HAMMING(LUT), ORB descriptors are matched with the
+  // OrbHammingMatcher instead of OpenCV's matcher.
+  // Hamming matches with a larger distance are dropped (256: no threshold).
+  int max_hamming_distance_ = 256;
+  // Only match descriptors in the same vocabulary node, this many levels up
+  // from the words (as ORB-SLAM's search by BoW). Only with Hamming matching.
+  bool bow_guided_matching_ = false;
+  int bow_guided_matching_levels_up_ = 2;
   //////////////////////////////////////////////////////////////////////////////
 
   ///////////////////////// ORB feature detector params ////////////////////////
@@ -106,6 +148,12 @@ class LoopClosureDetectorParams : public PipelineParams {
 #endif
   int patch_sze_ = 31;
   int fast_threshold_ = 20;
+  // Extract the ORB features on the GPU (OpenCV CUDA), if available
+  bool use_gpu_orb_ = false;
+  // Compute the ORB descriptors at the keypoints tracked (and triangulated)
+  // by the frontend, instead of detecting new features and matching them
+  // in stereo again
+  bool reuse_frontend_features_ = false;
   //////////////////////////////////////////////////////////////////////////////
 
   double betweenRotationPrecision_ = 1 / (0.1 * 0.1);
@@ -120,8 +168,60 @@ class LoopClosureDetectorParams : public PipelineParams {
   //////////////////////////////////////////////////////////////////////////////
 
   int max_lc_cached_before_optimize_ = 10;
+  // Accepted loop closures are buffered and added to the PGO with a single
+  // update once this many are buffered (1: one update per loop closure)...
+  int loop_closure_batch_size_ = 1;
+  // ...or once the first buffered one waited this many keyframes
+  int loop_closure_batch_window_ = 0;
+
+  ////////////////////////////// Multi-session params //////////////////////////
+  // LCD map of a prior session (see LcdMap.h) to detect loop closures
+  // against, with the same vocabulary (empty: none)
+  std::string prior_map_path_ = "";
+  // Where to save the LCD map on destruction (empty: not saved)
+  std::string save_map_path_ = "";
+  // Loop closures against the prior map are prior factors: precision of
+  // these wrt the (fixed) prior map
+  double prior_map_rotation_precision_ = 1 / (0.1 * 0.1);
+  double prior_map_translation_precision_ = 1 / (0.1 * 0.1);
+  //////////////////////////////////////////////////////////////////////////////
+
+  ////////////////////////////// Relocalization params /////////////////////////
+  // After the Frontend lost tracking, match the first keyframes tracked again
+  // against the keyframes before the loss, to re-seed the Backend pose
+  bool relocalize_after_tracking_loss_ = false;
+  // Keyframes tracked again before giving up on relocalizing
+  int relocalization_max_keyframes_ = 10;
+  // Precision of the Backend pose prior of a relocalization
+  double relocalization_rotation_precision_ = 1 / (0.05 * 0.05);
+  double relocalization_translation_precision_ = 1 / (0.1 * 0.1);
+  //////////////////////////////////////////////////////////////////////////////
+
+  ////////////////////////////// Remote LCD params /////////////////////////////
+  // Server running the LCD and PGO of this robot (see RemoteLcdServer.h),
+  // which then only streams its keyframes to it (empty: LCD runs locally)
+  std::string remote_server_host_ = "";
+  int remote_server_port_ = 7100;
+  // Id of this robot among the robots streaming to the server
+  int robot_id_ = 0;
+  // Keyframes not yet sent to the server are dropped past this many bytes
+  int remote_max_pending_bytes_ = 8 * 1024 * 1024;
+  //////////////////////////////////////////////////////////////////////////////
 
   FrameCacheConfig frame_cache;
+
+  BowDatabaseParams bow_database;
+
+  IncrementalPgoParams incremental_pgo;
+
+  IncrementalPcmParams incremental_pcm;
+
+  SpatialGatingParams spatial_gating;
+
+  DatabaseInsertionParams database_insertion;
+
+  //! Used if lcd_type_ is LoopClosureDetectorType::GlobalDescriptor.
+  GlobalDescriptorParams global_descriptor;
 };
 
 }  // namespace VIO
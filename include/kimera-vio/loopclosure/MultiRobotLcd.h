@@ -0,0 +1,133 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   MultiRobotLcd.h
+ * @brief  Loop closures and PGO of the keyframes streamed by several robots,
+ * with a database shared by all of them.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <gtsam/geometry/Pose3.h>
+
+#include "kimera-vio/loopclosure/BowDatabase.h"
+#include "kimera-vio/loopclosure/LoopClosureDetector.h"
+#include "kimera-vio/loopclosure/RemoteLcdCodec.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+struct MultiRobotLcdParams {
+  //! Best entries of the shared database queried for each keyframe, among
+  //! which the ones of other robots are the inter-robot candidates.
+  int max_query_results = 20;
+  //! Inter-robot candidates verified per keyframe, at most.
+  int max_inter_robot_candidates = 2;
+  //! Min BoW score of an inter-robot candidate.
+  double min_inter_robot_score = 0.05;
+};
+
+/**
+ * @brief The MultiRobotLcd class runs the loop closure detection and the PGO
+ * of several robots, fed with their keyframes (see RemoteKeyframe), e.g. by
+ * a RemoteLcdServer:
+ * - Each robot has its own LoopClosureDetector (hence PGO), built by the
+ *   given factory at its first keyframe, which detects its intra-robot loop
+ *   closures as when running on the robot. The keyframes are renumbered
+ *   contiguously per robot (the robots drop keyframes when the network
+ *   lags), and the corrections are given back in the robot's ids.
+ * - The keyframes of all robots are also added to one shared BoW database,
+ *   where each keyframe looks for inter-robot candidates, verified by the
+ *   LoopClosureDetector of its robot.
+ * - The first robot defines the shared frame. The first verified inter-robot
+ *   loop closure between a robot aligned with it and one that is not aligns
+ *   the latter: its Shared_Pose_Map, given in its corrections, is fixed from
+ *   then on. Inter-robot loop closures are only looked for while they can
+ *   align a robot: the PGOs of the robots are not joint.
+ *
+ * Not thread-safe.
+ */
+class MultiRobotLcd {
+ public:
+  KIMERA_POINTER_TYPEDEFS(MultiRobotLcd);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(MultiRobotLcd);
+
+  //! Builds the LoopClosureDetector of a robot: all must use the same
+  //! vocabulary and camera model.
+  using LcdFactoryCallback =
+      std::function<LoopClosureDetector::UniquePtr(const RobotId& robot_id)>;
+
+  MultiRobotLcd(const LcdFactoryCallback& lcd_factory,
+                const MultiRobotLcdParams& params = MultiRobotLcdParams());
+  virtual ~MultiRobotLcd() = default;
+
+  /**
+   * @brief addKeyframe Detects the loop closures of the keyframe, and adds
+   * it to the PGO of its robot.
+   * @return The correction of the keyframe, or nullptr if it is dropped
+   * (not after the previous keyframe of the robot).
+   */
+  std::unique_ptr<RemoteLcdCorrection> addKeyframe(
+      const RemoteKeyframe& keyframe);
+
+  inline size_t getNrRobots() const { return robots_.size(); }
+  inline size_t getNrInterRobotLoopClosures() const {
+    return nr_inter_robot_lc_;
+  }
+
+  //! Pose of the map frame of the robot in the shared frame, if aligned.
+  std::optional<gtsam::Pose3> getSharedPoseMap(const RobotId& robot_id) const;
+
+  //! The LoopClosureDetector of the robot, or nullptr if unknown.
+  const LoopClosureDetector* getLcd(const RobotId& robot_id) const;
+
+ private:
+  struct Robot {
+    LoopClosureDetector::UniquePtr lcd;
+    //! Keyframe id on the robot, by keyframe id in lcd.
+    std::vector<FrameId> robot_kf_ids;
+    std::optional<gtsam::Pose3> Shared_Pose_Map;
+  };
+
+  //! Looks for an inter-robot loop closure of the keyframe kf_id of the robot
+  //! that aligns it, or aligns the other robot, with the shared frame.
+  void detectInterRobotLoop(const RobotId& robot_id,
+                            const FrameId& kf_id,
+                            const LCDFrame& frame,
+                            const gtsam::Pose3& Map_Pose_B,
+                            const DBoW2::BowVector& bow_vec);
+
+  //! The correction of the keyframe, in the robot's ids.
+  std::unique_ptr<RemoteLcdCorrection> toCorrection(
+      const RobotId& robot_id,
+      const Robot& robot,
+      const LcdOutput& output) const;
+
+ private:
+  const LcdFactoryCallback lcd_factory_;
+  const MultiRobotLcdParams params_;
+
+  std::map<RobotId, Robot> robots_;
+  //! Built at the first keyframe, with the vocabulary of its robot.
+  std::unique_ptr<BowDatabase> shared_db_;
+  //! Robot and keyframe id in its lcd, by entry of shared_db_.
+  std::vector<std::pair<RobotId, FrameId>> shared_db_entries_;
+  size_t nr_inter_robot_lc_;
+};
+
+}  // namespace VIO
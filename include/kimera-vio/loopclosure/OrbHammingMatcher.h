@@ -0,0 +1,93 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   OrbHammingMatcher.h
+ * @brief  Brute-force 2-NN matcher specialized for 256-bit ORB descriptors.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+static constexpr int kOrbDescriptorBytes = 32;
+static constexpr int kOrbDescriptorBits = 8 * kOrbDescriptorBytes;
+
+//! Hamming distance between two kOrbDescriptorBytes descriptors.
+uint32_t orbHammingDistance(const uint8_t* a, const uint8_t* b);
+
+/**
+ * @brief The OrbHammingMatcher class matches ORB descriptors (CV_8U rows of
+ * kOrbDescriptorBytes) with the Hamming distance, as a
+ * cv::BFMatcher(NORM_HAMMING) knnMatch with k = 2 followed by Lowe's ratio
+ * test, but keeping only the two best distances per query (no sorting,
+ * no DMatch vectors), with POPCNT, AVX-512 VPOPCNTQ, AVX2 or NEON kernels
+ * selected at run time for the CPU (see utils::SimdKernels).
+ */
+class OrbHammingMatcher {
+ public:
+  KIMERA_POINTER_TYPEDEFS(OrbHammingMatcher);
+
+  //! Same layout as DBoW2::FeatureVector: descriptor indices per vocabulary
+  //! node.
+  using DescriptorGroups = std::map<unsigned int, std::vector<unsigned int>>;
+
+  /**
+   * @param max_distance Matches with a larger distance are dropped
+   * (kOrbDescriptorBits: no threshold).
+   */
+  explicit OrbHammingMatcher(const int& max_distance = kOrbDescriptorBits);
+
+ public:
+  /**
+   * @brief match For each query descriptor, the nearest train descriptor
+   * (queryIdx, trainIdx, distance), if its distance is less than lowe_ratio
+   * times the second nearest one. Queries with less than two train
+   * descriptors have no match, as with knnMatch.
+   */
+  void match(const cv::Mat& query_descriptors,
+             const cv::Mat& train_descriptors,
+             const double& lowe_ratio,
+             std::vector<cv::DMatch>* matches) const;
+
+  /**
+   * @brief matchGrouped Same as match, but query descriptors are only
+   * compared with the train descriptors of the same group, e.g. of the same
+   * BoW vocabulary node (from DBoW2's direct index).
+   */
+  void matchGrouped(const cv::Mat& query_descriptors,
+                    const cv::Mat& train_descriptors,
+                    const DescriptorGroups& query_groups,
+                    const DescriptorGroups& train_groups,
+                    const double& lowe_ratio,
+                    std::vector<cv::DMatch>* matches) const;
+
+ private:
+  //! 2-NN of one query among the given train rows (all if nullptr).
+  void matchQuery(const uint8_t* query,
+                  const int& query_idx,
+                  const cv::Mat& train_descriptors,
+                  const std::vector<unsigned int>* train_indices,
+                  const double& lowe_ratio,
+                  std::vector<cv::DMatch>* matches) const;
+
+ private:
+  const uint32_t max_distance_;
+};
+
+}  // namespace VIO
@@ -0,0 +1,92 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   RemoteLcdClient.h
+ * @brief  Non-blocking connection of a robot to a RemoteLcdServer.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The RemoteLcdClient class sends packets to a RemoteLcdServer and
+ * receives its packets, without ever blocking the caller: what the socket
+ * does not take yet is kept, up to max_pending_bytes, and sent at the next
+ * calls. Packets that do not fit are dropped, whole.
+ *
+ * The connection is (re)established at the calls, at most once per
+ * kReconnectPeriod. After a disconnection, the packet that was partly sent
+ * is sent again from its start; the packets received partly are dropped.
+ */
+class RemoteLcdClient {
+ public:
+  KIMERA_POINTER_TYPEDEFS(RemoteLcdClient);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(RemoteLcdClient);
+
+  static constexpr std::chrono::milliseconds kReconnectPeriod{1000};
+
+  RemoteLcdClient(const std::string& host,
+                  const int& port,
+                  const size_t& max_pending_bytes);
+  virtual ~RemoteLcdClient();
+
+  /**
+   * @brief send Queues a packet (or several), and sends what the connection
+   * takes.
+   * @return False if the packet was dropped: too many bytes pending.
+   */
+  bool send(std::string packet);
+
+  //! Appends the complete packets received since the last call, after
+  //! sending what is pending.
+  void receive(std::vector<std::string>* packets);
+
+  inline bool isConnected() const { return socket_fd_ >= 0 && !connecting_; }
+  inline size_t getNrDroppedPackets() const { return nr_dropped_packets_; }
+  inline size_t getPendingBytes() const { return pending_bytes_; }
+
+ private:
+  //! Starts connecting if disconnected, and checks whether the connection in
+  //! progress is established. @return True if connected.
+  bool connect();
+  void disconnect();
+  //! @return False if the connection was lost.
+  bool sendPending();
+
+ private:
+  const std::string host_;
+  const int port_;
+  const size_t max_pending_bytes_;
+
+  int socket_fd_;
+  //! True while the non-blocking connect is in progress.
+  bool connecting_;
+  std::chrono::steady_clock::time_point last_connect_attempt_;
+
+  //! Packets not fully sent yet, the first one from front_offset_.
+  std::deque<std::string> pending_packets_;
+  size_t front_offset_;
+  size_t pending_bytes_;
+  size_t nr_dropped_packets_;
+
+  //! Bytes received, not yet framed in complete packets.
+  std::string received_;
+};
+
+}  // namespace VIO
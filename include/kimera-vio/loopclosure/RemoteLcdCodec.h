@@ -0,0 +1,150 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   RemoteLcdCodec.h
+ * @brief  Binary encoding of the keyframes streamed by the robots to a
+ * RemoteLcdServer, and of the corrections it sends back.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+
+#include <gtsam/geometry/Pose3.h>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/loopclosure/LcdOutputPacket.h"
+#include "kimera-vio/loopclosure/LoopClosureDetector-definitions.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+using RobotId = std::uint32_t;
+
+//! BoW vector as (word id, weight) pairs: a DBoW2::BowVector, without the
+//! public DBoW2 dependency.
+using RemoteBowVector = std::map<unsigned int, double>;
+
+/**
+ * @brief The RemoteKeyframe struct: what the server needs of a keyframe of
+ * a robot to detect its loop closures and add it to the robot's PGO.
+ */
+struct RemoteKeyframe {
+  RobotId robot_id_ = 0u;
+  //! Keyframe id on the robot.
+  FrameId kf_id_ = 0u;
+  Timestamp timestamp_ = 0;
+  //! VIO estimate of the keyframe.
+  gtsam::Pose3 W_Pose_Blkf_;
+  //! Keypoints, 3D points and descriptors, as built by the robot's
+  //! LoopClosureDetector.
+  LCDFrame::Ptr frame_;
+  RemoteBowVector bow_vec_;
+};
+
+/**
+ * @brief The RemoteLcdCorrection struct: the LcdOutput of a keyframe of a
+ * robot, in the keyframe ids of the robot, without the frame and the graph.
+ */
+struct RemoteLcdCorrection {
+  RobotId robot_id_ = 0u;
+  //! Keyframe processed.
+  FrameId kf_id_ = 0u;
+  Timestamp timestamp_ = 0;
+  bool is_loop_closure_ = false;
+  FrameId id_match_ = 0u;
+  FrameId id_recent_ = 0u;
+  Timestamp timestamp_match_ = 0;
+  Timestamp timestamp_query_ = 0;
+  gtsam::Pose3 relative_pose_;
+  gtsam::Pose3 W_Pose_Map_;
+  gtsam::Pose3 Map_Pose_Odom_;
+  bool is_trajectory_corrected_ = false;
+  //! Map-frame poses updated, as LcdOutput::states_, and their timestamps.
+  std::map<FrameId, gtsam::Pose3> states_;
+  FrameIDTimestampMap timestamp_map_;
+  //! Pose of the map frame of the robot in the frame shared by the robots,
+  //! once the server aligned them.
+  std::optional<gtsam::Pose3> Shared_Pose_Map_;
+};
+
+/**
+ * Wire format, little endian. Each packet has an 8 bytes header:
+ * - u16 kRemoteLcdMagic, u8 kRemoteLcdVersion, u8 RemoteLcdPacketType,
+ * - u32 size of the payload in bytes, at most kRemoteLcdMaxPayloadSize.
+ * Poses are 3 f64 translation and 4 f64 (w, x, y, z) quaternion.
+ * Keyframe payloads (kKeyframe):
+ * - u32 robot id, u64 keyframe id, i64 timestamp, pose,
+ * - varint size and bytes of the frame, as saved by LCDFrame::save,
+ * - varint nr of words, and u32 word id and f64 weight for each.
+ * Correction payloads (kCorrection):
+ * - u32 robot id, u64 keyframe id, i64 timestamp,
+ * - u8 is loop closure, u64 match and recent ids, i64 match and query
+ *   timestamps, relative pose,
+ * - W_Pose_Map, Map_Pose_Odom, u8 is trajectory corrected,
+ * - varint nr of states, and u64 id, i64 timestamp and pose for each,
+ * - u8 has Shared_Pose_Map, and the pose if so.
+ * The frames are in the native layout of LCDFrame::save, and are not
+ * validated as strictly as the rest: only for a trusted network, between
+ * machines of the same endianness.
+ */
+static constexpr uint16_t kRemoteLcdMagic = 0x4c52u;  // "RL"
+static constexpr uint8_t kRemoteLcdVersion = 1u;
+static constexpr size_t kRemoteLcdHeaderSize = 8u;
+static constexpr size_t kRemoteLcdMaxPayloadSize = 64u * 1024u * 1024u;
+
+enum class RemoteLcdPacketType : uint8_t { kKeyframe = 0u, kCorrection = 1u };
+
+class RemoteLcdCodec {
+ public:
+  KIMERA_POINTER_TYPEDEFS(RemoteLcdCodec);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(RemoteLcdCodec);
+  RemoteLcdCodec() = delete;
+  virtual ~RemoteLcdCodec() = default;
+
+  //! Appends the packet of the keyframe to the given one.
+  static void encodeKeyframe(const RemoteKeyframe& keyframe,
+                             std::string* packet);
+
+  //! Appends the packet of the correction to the given one.
+  static void encodeCorrection(const RemoteLcdCorrection& correction,
+                               std::string* packet);
+
+  /**
+   * @brief isHeaderValid For dropping a stream that is not ours.
+   * @return False if the data starts with a complete header of another
+   * magic or version, or announcing a payload that is too large.
+   */
+  static bool isHeaderValid(const char* data, const size_t& size);
+
+  /**
+   * @brief getPacketSize For framing a stream of packets.
+   * @return Size of the packet at the beginning of the data (header included),
+   * or 0 if the data does not hold a complete packet yet.
+   */
+  static size_t getPacketSize(const char* data, const size_t& size);
+
+  //! Decodes one complete keyframe packet, see getPacketSize.
+  //! @return False if the packet is malformed or of another type.
+  static bool decodeKeyframe(const char* data,
+                             const size_t& size,
+                             RemoteKeyframe* keyframe);
+
+  //! Decodes one complete correction packet, see getPacketSize.
+  //! @return False if the packet is malformed or of another type.
+  static bool decodeCorrection(const char* data,
+                               const size_t& size,
+                               RemoteLcdCorrection* correction);
+};
+
+}  // namespace VIO
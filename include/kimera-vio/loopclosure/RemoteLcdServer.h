@@ -0,0 +1,103 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   RemoteLcdServer.h
+ * @brief  Server running the LCD and PGO of the robots streaming their
+ * keyframes to it.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <string>
+
+#include "kimera-vio/loopclosure/MultiRobotLcd.h"
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/Statistics.h"
+
+namespace VIO {
+
+/**
+ * @brief The RemoteLcdServer class accepts the connections of the robots
+ * running a RemoteLoopClosureDetector, feeds their keyframes to a
+ * MultiRobotLcd, and sends each correction back on the connection of its
+ * keyframe. A robot may reconnect, or use several connections: robots are
+ * identified by the id in their keyframes.
+ *
+ * The keyframes are processed in the order they are received, in the thread
+ * of spin(). Connections lagging by more than max_pending_bytes of
+ * corrections, or sending an invalid stream, are closed.
+ *
+ * No authentication nor encryption: only for a trusted network. The server
+ * listens on the loopback interface unless given another bind address.
+ */
+class RemoteLcdServer {
+ public:
+  KIMERA_POINTER_TYPEDEFS(RemoteLcdServer);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(RemoteLcdServer);
+
+  /**
+   * @param port To listen on, any free port if 0 (see getPort).
+   * @param max_pending_bytes Of corrections not yet sent, per connection.
+   * @param bind_address IPv4 address of the interface to listen on: the
+   * loopback only by default, "0.0.0.0" for all the interfaces.
+   */
+  RemoteLcdServer(MultiRobotLcd::UniquePtr multi_robot_lcd,
+                  const int& port,
+                  const size_t& max_pending_bytes = 8u * 1024u * 1024u,
+                  const std::string& bind_address = "127.0.0.1");
+  virtual ~RemoteLcdServer();
+
+  /**
+   * @brief spinOnce Accepts the new connections, processes the keyframes
+   * received, and sends the corrections.
+   * @param timeout_ms Max time to wait for the connections to be ready.
+   */
+  void spinOnce(const int& timeout_ms);
+
+  //! Spins until shutdown.
+  void spin();
+
+  //! Stops spin(), from any thread.
+  inline void shutdown() { shutdown_ = true; }
+
+  inline int getPort() const { return port_; }
+  inline size_t getNrConnections() const { return connections_.size(); }
+  inline const MultiRobotLcd& getMultiRobotLcd() const {
+    return *multi_robot_lcd_;
+  }
+
+ private:
+  struct Connection {
+    int socket_fd_;
+    //! Bytes received, not yet framed in complete packets.
+    std::string received_;
+    //! Bytes of the corrections not sent yet.
+    std::string pending_;
+  };
+
+  void acceptConnections();
+  //! @return False if the connection was lost or must be closed.
+  bool receive(Connection* connection);
+  bool sendPending(Connection* connection) const;
+
+ private:
+  MultiRobotLcd::UniquePtr multi_robot_lcd_;
+  const size_t max_pending_bytes_;
+  int server_fd_;
+  int port_;
+  std::list<Connection> connections_;
+  std::atomic<bool> shutdown_;
+  utils::StatsCollector keyframe_stats_;
+};
+
+}  // namespace VIO
@@ -0,0 +1,106 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   RemoteLoopClosureDetector.h
+ * @brief  Robot side of the LCD and PGO offloaded to a RemoteLcdServer.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <map>
+#include <optional>
+#include <utility>
+
+#include <gtsam/geometry/Pose3.h>
+
+#include "kimera-vio/loopclosure/LoopClosureDetector.h"
+#include "kimera-vio/loopclosure/RemoteLcdClient.h"
+#include "kimera-vio/loopclosure/RemoteLcdCodec.h"
+#include "kimera-vio/utils/Statistics.h"
+
+namespace VIO {
+
+/**
+ * @brief The RemoteLoopClosureDetector class runs on a robot in place of the
+ * LoopClosureDetector when lcd_params.remote_server_host_ is set: each
+ * keyframe is only turned into its LCDFrame (keypoints, 3D points and
+ * descriptors, as the LoopClosureDetector does) and BoW vector, and streamed
+ * with its VIO estimate to the RemoteLcdServer, which detects the loop
+ * closures (with the keyframes of all the robots) and optimizes the PGO.
+ * Neither the frames nor the pose graph are kept on the robot.
+ *
+ * The server answers each keyframe with its correction, received
+ * asynchronously: the output of a keyframe holds the corrections received
+ * since the previous output, and the pose of the keyframe in the map frame
+ * predicted with the latest Map_Pose_Odom until the server corrects it. The
+ * loop closure of an output is the latest one the server reported.
+ *
+ * Keyframes are dropped (and counted) while the server lags behind by more
+ * than lcd_params.remote_max_pending_bytes_, and the output does not block
+ * on the server: the VIO runs on when the network is down.
+ */
+class RemoteLoopClosureDetector : public LoopClosureDetector {
+ public:
+  KIMERA_POINTER_TYPEDEFS(RemoteLoopClosureDetector);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(RemoteLoopClosureDetector);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  //! As LoopClosureDetector's constructor.
+  RemoteLoopClosureDetector(
+      const LoopClosureDetectorParams& lcd_params,
+      const CameraParams& tracker_cam_params,
+      const gtsam::Pose3& B_Pose_Cam,
+      const std::optional<VIO::StereoCamera::ConstPtr>& stereo_camera =
+          std::nullopt,
+      const std::optional<StereoMatchingParams>& stereo_matching_params =
+          std::nullopt,
+      const std::optional<VIO::RgbdCamera::ConstPtr>& rgbd_camera =
+          std::nullopt,
+      bool log_output = false,
+      PreloadedVocab::Ptr&& preloaded_vocab = nullptr);
+  virtual ~RemoteLoopClosureDetector() = default;
+
+  LcdOutput::UniquePtr spinOnce(const LcdInput& input) override;
+
+  //! Keyframes not sent because the server lagged behind.
+  inline size_t getNrDroppedKeyframes() const {
+    return client_.getNrDroppedPackets();
+  }
+
+  //! Pose of the map frame of this robot in the frame shared by the robots
+  //! of the server, once it aligned them.
+  inline std::optional<gtsam::Pose3> getSharedPoseMap() const {
+    return Shared_Pose_Map_;
+  }
+
+ protected:
+  //! Keeps the frame for the current keyframe only.
+  FrameId storeFrame(const LCDFrame::Ptr& frame) override;
+
+ private:
+  const RobotId robot_id_;
+  RemoteLcdClient client_;
+
+  FrameId cur_kf_id_;
+  //! The frame of cur_kf_id_, until it is sent.
+  LCDFrame::Ptr cur_frame_;
+
+  //! As of the latest correction received.
+  gtsam::Pose3 W_Pose_Map_;
+  gtsam::Pose3 Map_Pose_Odom_;
+  std::optional<gtsam::Pose3> Shared_Pose_Map_;
+  //! Timestamp and VIO estimate of the keyframes sent and not yet corrected
+  //! by the server, by keyframe id.
+  std::map<FrameId, std::pair<Timestamp, gtsam::Pose3>> uncorrected_kfs_;
+
+  utils::StatsCollector keyframe_bytes_stats_;
+};
+
+}  // namespace VIO
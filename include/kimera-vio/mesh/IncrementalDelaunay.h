@@ -0,0 +1,166 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   IncrementalDelaunay.h
+ * @brief  2D Delaunay triangulation updated incrementally (insertions,
+ * removals and moves of vertices), to mesh the keypoints tracked across
+ * frames without triangulating from scratch.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The IncrementalDelaunay class keeps the Delaunay triangulation of a
+ * set of 2D points with external ids (e.g. landmark ids), inside an image.
+ * Like cv::Subdiv2D, the points are triangulated together with three outer
+ * vertices enclosing the image, and the triangles touching them are not
+ * returned. Each insertion, removal or move only flips the edges around the
+ * affected vertex (Lawson flips), so that updating the triangulation between
+ * frames costs O(changes) instead of O(points).
+ * Triangles and vertices are kept in pools reused across updates.
+ */
+class IncrementalDelaunay {
+ public:
+  KIMERA_POINTER_TYPEDEFS(IncrementalDelaunay);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(IncrementalDelaunay);
+
+  using VertexId = int64_t;
+  using TriangleVertexIds = std::array<VertexId, 3>;
+
+  explicit IncrementalDelaunay(const cv::Size& img_size);
+  virtual ~IncrementalDelaunay() = default;
+
+  /**
+   * @brief insert Adds a vertex.
+   * @return False if the id already exists, if the point is outside the
+   * image, or if it coincides with another vertex (then it is not added).
+   */
+  bool insert(const VertexId& id, const cv::Point2f& point);
+
+  //! Moves a vertex, flipping the edges around it if it stays within its
+  //! neighbors, else removing and re-inserting it. False if not moved (then
+  //! the vertex is removed if the new position is invalid).
+  bool move(const VertexId& id, const cv::Point2f& point);
+
+  //! Removes a vertex, re-triangulating its hole. False if not found.
+  bool remove(const VertexId& id);
+
+  /**
+   * @brief update Sets the vertices of the triangulation: removes the ones
+   * not given, moves the ones given that exist, and inserts the new ones.
+   * @return Number of vertices in the triangulation after the update.
+   */
+  size_t update(const std::vector<std::pair<VertexId, cv::Point2f>>& vertices);
+
+  void clear();
+
+  inline bool contains(const VertexId& id) const {
+    return id_to_vertex_.find(id) != id_to_vertex_.end();
+  }
+  inline size_t size() const { return id_to_vertex_.size(); }
+
+  /**
+   * @brief getTriangleList Triangles not touching the outer vertices, as
+   * cv::Subdiv2D::getTriangleList, each with its vertices counterclockwise.
+   * @param vertex_ids Optionally, the ids of the vertices of each triangle.
+   */
+  std::vector<cv::Vec6f> getTriangleList(
+      std::vector<TriangleVertexIds>* vertex_ids = nullptr) const;
+
+  //! Checks the adjacency and the Delaunay property of all edges, for tests.
+  bool isValid() const;
+
+ private:
+  using Index = int32_t;
+  static constexpr Index kInvalid = -1;
+
+  struct Vertex {
+    cv::Point2d point;
+    VertexId id = 0;
+    Index triangle = kInvalid;  // Any triangle incident to the vertex.
+    bool alive = false;
+  };
+
+  // Vertices counterclockwise, neighbor i is across the edge opposite to
+  // vertex i.
+  struct Triangle {
+    std::array<Index, 3> vertices = {{kInvalid, kInvalid, kInvalid}};
+    std::array<Index, 3> neighbors = {{kInvalid, kInvalid, kInvalid}};
+    bool alive = false;
+  };
+
+  // Edge of a triangle, opposite to its vertex edge_idx.
+  using Edge = std::pair<Index, int>;
+
+  void initOuterVertices();
+
+  Index newVertex(const cv::Point2d& point, const VertexId& id);
+  Index newTriangle(const Index& v0, const Index& v1, const Index& v2);
+  void deleteTriangle(const Index& triangle);
+
+  //! Triangle containing the point, walking from the hint.
+  Index locate(const cv::Point2d& point, Index hint) const;
+
+  //! Inserts in the triangulation an already created vertex.
+  bool insertVertex(const Index& vertex, const Index& hint);
+  //! Removes the vertex from the triangulation, without freeing it.
+  void removeVertex(const Index& vertex);
+
+  //! Flips the edges, and the edges around the flipped ones, until all are
+  //! Delaunay.
+  void legalize(std::vector<Edge>* edges);
+  void flip(const Index& triangle, const int& edge_idx);
+
+  //! Triangles around the vertex, counterclockwise.
+  void getStar(const Index& vertex, std::vector<Index>* star) const;
+
+  void setNeighbor(const Index& triangle,
+                   const Index& old_neighbor,
+                   const Index& new_neighbor);
+  int vertexIdx(const Index& triangle, const Index& vertex) const;
+  int neighborIdx(const Index& triangle, const Index& neighbor) const;
+  bool isOuterVertex(const Index& vertex) const { return vertex < 3; }
+  bool isInside(const cv::Point2d& point) const;
+
+  //! > 0 if a, b, c are counterclockwise.
+  static double orient(const cv::Point2d& a,
+                       const cv::Point2d& b,
+                       const cv::Point2d& c);
+  //! > 0 if d is inside the circumcircle of the counterclockwise a, b, c.
+  static double inCircle(const cv::Point2d& a,
+                         const cv::Point2d& b,
+                         const cv::Point2d& c,
+                         const cv::Point2d& d);
+
+ private:
+  const cv::Rect2d rect_;
+
+  std::vector<Vertex> vertices_;
+  std::vector<Triangle> triangles_;
+  std::vector<Index> free_vertices_;
+  std::vector<Index> free_triangles_;
+  std::unordered_map<VertexId, Index> id_to_vertex_;
+  //! Last triangle created, to start the walks from.
+  Index last_triangle_ = kInvalid;
+};
+
+}  // namespace VIO
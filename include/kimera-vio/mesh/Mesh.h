@@ -18,9 +18,12 @@
 #include <math.h>
 
 #include <map>
+#include <memory>
 #include <opencv2/core/core.hpp>
 #include <opencv2/core/mat.hpp>
 #include <opencv2/viz/types.hpp>  // Just for color type.
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "kimera-vio/utils/Macros.h"
@@ -28,7 +31,8 @@
 
 namespace VIO {
 
-// TODO this class is NOT THREADSAFE...
+// TODO this class is NOT THREADSAFE... But copies (and non-safe views) of a
+// mesh can be used in other threads while the mesh is modified.
 // Class defining the concept of a polygonal mesh.
 template <typename VertexPosition = cv::Point3f>
 class Mesh {
@@ -48,27 +52,28 @@ class Mesh {
   Mesh(const size_t& polygon_dimension = 3);
 
   // Copy constructor.
-  // Performs a deep copy (clones) the data members.
+  // Copy-on-write: shares the data of the given mesh, which is only cloned
+  // when one of the two meshes is modified. Hence copies are O(1) and are
+  // immutable snapshots of the mesh when they were taken.
   Mesh(const Mesh& rhs_mesh);
 
   // Copy assignement operator.
-  // Performs a deep copy (clones) the data members.
+  // Copy-on-write, as the copy constructor.
   Mesh& operator=(const Mesh& mesh);
 
-  // Use default move constructor.
-  // TODO define explicitly what the move ctor shall look like.
-  Mesh(Mesh&& mesh) = default;
-
-  // Delete move assignement operator.
-  Mesh& operator=(Mesh&& mesh) = delete;
+  // Move constructor and move assignement operator, the moved mesh is left
+  // empty.
+  Mesh(Mesh&& mesh);
+  Mesh& operator=(Mesh&& mesh);
 
   // Destructor.
   ~Mesh() = default;
 
  private:
-  // Maps (for internal processing).
-  typedef std::map<VertexId, LandmarkId> VertexToLmkIdMap;
-  typedef std::map<LandmarkId, VertexId> LmkIdToVertexMap;
+  // Maps (for internal processing). Vertex ids are the rows of the vertices
+  // matrix, hence the vertex to lmk id map is a vector indexed by them.
+  typedef std::vector<LandmarkId> VertexToLmkIdMap;
+  typedef std::unordered_map<LandmarkId, VertexId> LmkIdToVertexMap;
 
  public:
   template <typename PositionType = cv::Point3f>
@@ -135,25 +140,62 @@ class Mesh {
   //! Adds a new polygon into the mesh, updates the internal data structures.
   void addPolygonToMesh(const Polygon& polygon);
 
+  //! Removes a polygon from the mesh in O(1) (plus the degree of its
+  //! vertices): the last polygon takes its index. Vertices left without
+  //! polygons are removed too, and the last vertex takes the id of each of
+  //! them.
+  void removePolygon(const size_t& polygon_idx);
+
+  //! Removes all the polygons of the vertex with the given landmark id (and so
+  //! the vertex). Returns the number of removed polygons.
+  size_t removePolygonsOfLmkId(const LandmarkId& lmk_id);
+
   //! Completely clears the mesh.
   void clearMesh();
 
   /// Getters
   inline size_t getNumberOfPolygons() const {
-    return static_cast<size_t>(polygons_mesh_.rows / (polygon_dimension_ + 1));
+    return static_cast<size_t>(data_->polygons_mesh_.rows /
+                               (polygon_dimension_ + 1));
   }
   inline size_t getNumberOfUniqueVertices() const {
-    return vertices_mesh_.rows;
+    return data_->vertices_mesh_.rows;
   }
+  //! Approximate bytes held by the data of the mesh, which may be shared
+  //! with copies (see MemoryAccounting). Linear in the nr of vertices.
+  size_t getMemoryBytes() const;
   // TODO needs to be generalized to aleatory polygonal meshes.
   // Currently it only allows polygons of same size.
   inline size_t getMeshPolygonDimension() const { return polygon_dimension_; }
-  inline cv::Mat getAdjacencyMatrix() const { return adjacency_matrix_; }
+  //! Vertex id / position of the j-th vertex of a polygon, read in place
+  //! (no Polygon copy, unlike getPolygon), for per-polygon loops.
+  inline VertexId getPolygonVertexId(const size_t& polygon_idx,
+                                     const size_t& j) const {
+    DCHECK_LT(polygon_idx, getNumberOfPolygons());
+    DCHECK_LT(j, polygon_dimension_);
+    return static_cast<VertexId>(data_->polygons_mesh_.at<int32_t>(
+        polygon_idx * (polygon_dimension_ + 1) + j + 1));
+  }
+  inline const VertexPosition& getPolygonVertexPosition(
+      const size_t& polygon_idx,
+      const size_t& j) const {
+    return data_->vertices_mesh_.at<VertexPosition>(
+        getPolygonVertexId(polygon_idx, j));
+  }
+  //! Dense (n x n, CV_8UC1) adjacency matrix of the vertices, built on
+  //! demand from the adjacency lists: O(n^2), use getAdjacentVertices instead
+  //! whenever possible.
+  cv::Mat getAdjacencyMatrix() const;
+  //! Vertices sharing an edge with the given vertex, sorted by vertex id.
+  inline const VertexIds& getAdjacentVertices(const VertexId& vtx_id) const {
+    CHECK_LT(vtx_id, data_->adjacency_lists_.size());
+    return data_->adjacency_lists_[vtx_id];
+  }
 
   /// Checkers
   inline bool isLmkIdInMesh(const LandmarkId& lmk_id) const {
-    const auto& it = lmk_id_to_vertex_map_.find(lmk_id);
-    if (it != lmk_id_to_vertex_map_.end()) {
+    const auto& it = data_->lmk_id_to_vertex_map_.find(lmk_id);
+    if (it != data_->lmk_id_to_vertex_map_.end()) {
       // Sanity check
       CHECK(isVtxIdInMesh(it->second));
       return true;
@@ -162,20 +204,13 @@ class Mesh {
     }
   }
   inline bool isVtxIdInMesh(const VertexId& vtx_id) const {
-    const auto& it = vertex_to_lmk_id_map_.find(vtx_id);
-    if (it != vertex_to_lmk_id_map_.end()) {
-      // Sanity check
-      CHECK(isLmkIdInMesh(it->second));
-      return true;
-    } else {
-      return false;
-    }
+    return vtx_id < data_->vertex_to_lmk_id_map_.size();
   }
   inline bool getVtxIdForLmkId(const LandmarkId& lmk_id,
                                VertexId* vtx_id) const {
     CHECK_NOTNULL(vtx_id);
-    auto it = lmk_id_to_vertex_map_.find(lmk_id);
-    if (it != lmk_id_to_vertex_map_.end()) {
+    auto it = data_->lmk_id_to_vertex_map_.find(lmk_id);
+    if (it != data_->lmk_id_to_vertex_map_.end()) {
       *vtx_id = it->second;
       return true;
     } else {
@@ -185,9 +220,8 @@ class Mesh {
   inline bool getLmkIdForVtxId(const VertexId& vtx_id,
                                LandmarkId* lmk_id) const {
     CHECK_NOTNULL(lmk_id);
-    auto it = vertex_to_lmk_id_map_.find(vtx_id);
-    if (it != vertex_to_lmk_id_map_.end()) {
-      *lmk_id = it->second;
+    if (vtx_id < data_->vertex_to_lmk_id_map_.size()) {
+      *lmk_id = data_->vertex_to_lmk_id_map_[vtx_id];
       return true;
     } else {
       return false;
@@ -195,8 +229,13 @@ class Mesh {
   }
 
   // Retrieve the mesh data structures.
-  void getVerticesMeshToMat(cv::Mat* vertices_mesh) const;
-  void getPolygonsMeshToMat(cv::Mat* polygons_mesh) const;
+  // If not safe, the returned matrices are views of the mesh data (no copy),
+  // which are copy-on-write as copies of the mesh: they are not modified by
+  // later changes of the mesh.
+  void getVerticesMeshToMat(cv::Mat* vertices_mesh,
+                            const bool& safe = true) const;
+  void getPolygonsMeshToMat(cv::Mat* polygons_mesh,
+                            const bool& safe = true) const;
   cv::Mat getColorsMesh(const bool& safe = true) const;
 
   /**
@@ -237,8 +276,12 @@ class Mesh {
                                 const cv::Point3f& p3,
                                 VertexNormal* normal);
 
-  // NOT TESTED
-  void computePerVertexNormals();
+  //! Per-vertex normals are always available: they are the normalized sum of
+  //! the area-weighted normals of the faces around each vertex, updated
+  //! incrementally as faces are added, removed or moved. This recomputes them
+  //! from scratch (e.g. to drop the accumulated rounding errors), with the
+  //! face normals computed in parallel over polygon ranges if num_threads > 1.
+  void computePerVertexNormals(const int& num_threads = 1);
 
   // NOT THREADSAFE.
   // Colors a vertex of the mesh given a LandmarkId.
@@ -246,20 +289,37 @@ class Mesh {
   // false otherwise.
   bool setVertexColor(const LandmarkId& lmk_id, const VertexColorRGB& vertex);
   // NOT THREADSAFE.
-  // Updates position of a vertex of the mesh given a LandmarkId.
+  // Updates position of a vertex of the mesh given a LandmarkId, and the
+  // normals of the vertices of its faces.
   // Returns true if we could find the vertex with the given landmark id
   // false otherwise.
   bool setVertexPosition(const LandmarkId& lmk_id,
                          const VertexPosition& vertex);
 
-  // Get a list of all lmk ids in the mesh.
+  // Get a list of all lmk ids in the mesh, ordered by vertex id.
   LandmarkIds getLandmarkIds() const;
 
+  /**
+   * @brief setMesh Replaces the whole mesh: the i-th vertex has the i-th
+   * landmark id, position (row of vertices_mesh) and color (row of
+   * vertices_mesh_color). Normals are computed from the polygons.
+   * @param polygons_mesh Faces in the format of getPolygonsMeshToMat.
+   */
+  void setMesh(const LandmarkIds& lmk_ids,
+               const cv::Mat& vertices_mesh,
+               const cv::Mat& vertices_mesh_color,
+               const cv::Mat& polygons_mesh);
+
+  //! Saves the mesh as a MeshLog of a single chunk (see MeshLog.h).
   void save(const std::string& filepath) const;
 
+  //! Loads the last state of a MeshLog, or a mesh saved by older versions
+  //! with cv::FileStorage.
   void load(const std::string& filepath);
 
  private:
+  void loadFileStorage(const std::string& filepath);
+
   /// Functions
   // Updates internal structures to add a vertex.
   // Used by addPolygonToMesh, it is not supposed to be used by the end user.
@@ -267,61 +327,126 @@ class Mesh {
       const LandmarkId& lmk_id,
       const VertexPosition& lmk_position,
       const VertexColorRGB& vertex_color,
-      const VertexNormal& vertex_normal,
-      std::map<VertexId, LandmarkId>* vertex_to_lmk_id_map,
-      std::map<LandmarkId, VertexId>* lmk_id_to_vertex_id_map,
+      VertexToLmkIdMap* vertex_to_lmk_id_map,
+      LmkIdToVertexMap* lmk_id_to_vertex_id_map,
       cv::Mat* vertices_mesh,
       VertexNormals* vertices_mesh_normal,
       cv::Mat* vertices_mesh_color) const;
 
-  // Sets all vertex normals to 0.
-  inline void clearVertexNormals() { vertices_mesh_normal_.clear(); }
+  // Adds the vertex to the adjacency list of the other, if not there.
+  void addAdjacency(const VertexId& vtx_id, const VertexId& adjacent_vtx_id);
+
+  // Rebuilds the adjacency lists, polygons of the vertices, face hashes and
+  // vertex normals from polygons_mesh_.
+  void updateConnectivityFromPolygons();
+
+  // Normal (p3 - p1) x (p2 - p1) of a triangle, hence scaled by twice its
+  // area (zero if degenerate).
+  cv::Point3d getFaceNormalSum(const size_t& polygon_idx) const;
+
+  // Adds (sign = 1) or subtracts (sign = -1) the normal of a face to the
+  // normal sums of its vertices, and updates their normals.
+  void accumulateFaceNormal(const size_t& polygon_idx, const double& sign);
+
+  // Normalizes the normal sum of a vertex into its normal.
+  void updateVertexNormal(const VertexId& vtx_id);
+
+  // Moves a vertex, updating the normals of the vertices of its faces.
+  void moveVertex(const VertexId& vtx_id, const VertexPosition& position);
+
+  // Recomputes the normal sums and normals of all vertices.
+  void recomputeVertexNormals(const int& num_threads);
+
+  // Hash of the (sorted) vertex ids of a triangle.
+  size_t getFaceHash(const size_t& polygon_idx) const;
+
+  // Whether a polygon of vtx_id has an edge with adjacent_vtx_id.
+  bool isEdgeInMesh(const VertexId& vtx_id,
+                    const VertexId& adjacent_vtx_id) const;
+
+  // Removes a vertex without polygons: the last vertex takes its id.
+  void removeVertex(const VertexId& vtx_id);
+
+  // Clones the data if it is shared with other meshes or with views, before
+  // modifying it.
+  void detach();
 
  private:
   /// TODO change internal structures for the mesh with std::vector<Polygon>.
 
-  /// Members
-  /// TODO maybe use bimap.
-  // Vertex to LmkId Map
-  VertexToLmkIdMap vertex_to_lmk_id_map_;
-
-  // LmkId to Vertex Map
-  LmkIdToVertexMap lmk_id_to_vertex_map_;
-
-  // Vertices 3D.
-  // Set of (non-repeated) 3d points.
-  // Format: n rows (one for each point), with each row being a cv::Point3f.
-  cv::Mat vertices_mesh_;
-
-  // Normal for each vertex
-  // Format: n rows (one for each point), with each row being a CV_32FC3.
-  // where n should be the same number as rows for vertices_mesh_.
-  // One normal per vertex.
-  VertexNormals vertices_mesh_normal_;
-  // If the normals have been computed;
-  bool normals_computed_ = false;
-
-  // Color for each vertex.
-  // Format: n rows (one for each point), with each row being a CV_8UC3.
-  // where n should be the same number as rows for vertices_mesh_.
-  // One color per vertex. (This is how it is done for OpenCV...
-  cv::Mat vertices_mesh_color_;
-
-  // Connectivity of the mesh.
-  // Set of polygons.
-  // Raw integer list of the form: (n,id1_a,id2_a,...,idn_a,
-  // n,id1_b,id2_b,...,idn_b, ..., n, ... idn_x)
-  // where n is the number of points per polygon, and id is a zero-offset
-  // index into the associated row in vertices_mesh_.
-  cv::Mat polygons_mesh_;
-
-  //! Connectivity of the mesh at the edge level.
-  //! Squared matrix of vertices, ordered according to vtx_id (meaning their
-  //! position in the vertices_mesh_ rows.
-  cv::Mat adjacency_matrix_;
-
-  //! Used as a hash to know if a face is in the mesh
-  std::unordered_map<size_t, bool> face_hashes_;
+  // Data of the mesh, shared by its copies until modified (copy-on-write).
+  struct MeshData {
+    /// Members
+    /// TODO maybe use bimap.
+    // Vertex to LmkId Map
+    VertexToLmkIdMap vertex_to_lmk_id_map_;
+
+    // LmkId to Vertex Map
+    LmkIdToVertexMap lmk_id_to_vertex_map_;
+
+    // Vertices 3D.
+    // Set of (non-repeated) 3d points.
+    // Format: n rows (one for each point), with each row being a
+    // cv::Point3f.
+    cv::Mat vertices_mesh_ = cv::Mat(0, 1, CV_32FC3);
+
+    // Normal for each vertex
+    // Format: n rows (one for each point), with each row being a CV_32FC3.
+    // where n should be the same number as rows for vertices_mesh_.
+    // One normal per vertex.
+    VertexNormals vertices_mesh_normal_;
+    //! For each vtx_id, the sum of the area-weighted normals of its faces,
+    //! which vertices_mesh_normal_ normalizes. In double, since faces are
+    //! added and subtracted incrementally.
+    std::vector<cv::Point3d> vertex_normal_sums_;
+
+    // Color for each vertex.
+    // Format: n rows (one for each point), with each row being a CV_8UC3.
+    // where n should be the same number as rows for vertices_mesh_.
+    // One color per vertex. (This is how it is done for OpenCV...
+    cv::Mat vertices_mesh_color_ =
+        cv::Mat(0, 0, CV_8UC3, cv::viz::Color::blue());
+
+    // Connectivity of the mesh.
+    // Set of polygons.
+    // Raw integer list of the form: (n,id1_a,id2_a,...,idn_a,
+    // n,id1_b,id2_b,...,idn_b, ..., n, ... idn_x)
+    // where n is the number of points per polygon, and id is a zero-offset
+    // index into the associated row in vertices_mesh_.
+    cv::Mat polygons_mesh_ = cv::Mat(0, 1, CV_32SC1);
+
+    //! Connectivity of the mesh at the edge level.
+    //! For each vtx_id (meaning its position in the vertices_mesh_ rows), the
+    //! sorted vtx_ids of its adjacent vertices. Memory is linear in the number
+    //! of edges, unlike a dense adjacency matrix.
+    std::vector<VertexIds> adjacency_lists_;
+
+    //! For each vtx_id, the indices of the polygons using it (unsorted): its
+    //! reference count, to remove polygons and vertices in place.
+    std::vector<std::vector<size_t>> vertex_polygons_;
+
+    //! Used as a hash to know if a face is in the mesh
+    std::unordered_set<size_t> face_hashes_;
+
+    //! Clones the matrices shared with views (see getVerticesMeshToMat), so
+    //! that modifying them does not modify the views.
+    void detachMatrices() {
+      for (cv::Mat* mat :
+           {&vertices_mesh_, &vertices_mesh_color_, &polygons_mesh_}) {
+        if (mat->u && mat->u->refcount > 1) *mat = mat->clone();
+      }
+    }
+
+    //! Deep copy, cloning the matrices.
+    std::shared_ptr<MeshData> clone() const {
+      std::shared_ptr<MeshData> data = std::make_shared<MeshData>(*this);
+      data->vertices_mesh_ = vertices_mesh_.clone();
+      data->vertices_mesh_color_ = vertices_mesh_color_.clone();
+      data->polygons_mesh_ = polygons_mesh_.clone();
+      return data;
+    }
+  };
+  std::shared_ptr<MeshData> data_;
 
   // Number of vertices per polygon.
   const size_t polygon_dimension_;
@@ -0,0 +1,122 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   MeshDecimation.h
+ * @brief  Incremental quadric-error decimation of the 3D mesh, to keep a
+ * coarse level of detail of it for visualization and logging.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "kimera-vio/mesh/Mesh.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+struct MeshDecimationParams {
+  //! Side [m] of the cubic cells in which the mesh is decimated: a triangle
+  //! belongs to the cell of its centroid.
+  double cell_size_ = 2.0;
+  //! Fraction of the triangles of each cell to keep, in (0, 1].
+  double target_ratio_ = 0.5;
+  //! Edges whose collapse has a larger quadric error [m^2] are kept.
+  double max_error_ = 1e-3;
+};
+
+/**
+ * @brief The MeshDecimator keeps a coarse version of the mesh, decimated with
+ * quadric-error edge collapses (Garland & Heckbert), next to the full one.
+ * The mesh is split in cells, and only the cells whose triangles changed
+ * since the previous update are decimated again: the others keep their
+ * coarse triangles. The vertices shared by several cells and the ones on the
+ * border of the mesh are never collapsed, hence the coarse cells stitch
+ * together and keep the silhouette of the mesh.
+ * The vertices of the coarse mesh keep the landmark ids (and colors) of the
+ * full mesh, the collapses only move them.
+ *
+ * Not thread-safe.
+ */
+class MeshDecimator {
+ public:
+  KIMERA_POINTER_TYPEDEFS(MeshDecimator);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(MeshDecimator);
+
+  explicit MeshDecimator(
+      const MeshDecimationParams& params = MeshDecimationParams());
+  virtual ~MeshDecimator() = default;
+
+  /**
+   * @brief update Decimates the cells of the (triangle) mesh that changed
+   * since the previous update, and rebuilds the coarse mesh.
+   * @param mesh The full mesh, e.g. MesherOutput::mesh_3d_.
+   * @return The coarse mesh, see getCoarseMesh.
+   */
+  const Mesh3D& update(const Mesh3D& mesh);
+
+  //! The coarse mesh of the last update. Copies of it are O(1) snapshots.
+  inline const Mesh3D& getCoarseMesh() const { return coarse_mesh_; }
+
+  //! Nr of cells decimated by the last update.
+  inline size_t getNrDecimatedCells() const { return nr_decimated_cells_; }
+  inline size_t getNrCells() const { return cells_.size(); }
+
+  void clear();
+
+ public:
+  typedef std::array<LandmarkId, 3> Triangle;
+  typedef std::unordered_map<LandmarkId, Vertex3D> LmkIdToPosition;
+
+  /**
+   * @brief decimate Collapses the edges of the given triangles by increasing
+   * quadric error, until target_ratio of them are left or the error gets
+   * larger than max_error. Collapses that change the topology or flip a
+   * triangle are skipped.
+   * @param triangles Oriented triangles, by landmark id.
+   * @param positions Positions of the vertices of the triangles.
+   * @param locked Vertices that must not be collapsed (nor moved).
+   * @param decimated Remaining triangles.
+   * @param decimated_positions Positions of the vertices of the remaining
+   * triangles.
+   */
+  static void decimate(const std::vector<Triangle>& triangles,
+                       const LmkIdToPosition& positions,
+                       const std::vector<LandmarkId>& locked,
+                       const MeshDecimationParams& params,
+                       std::vector<Triangle>* decimated,
+                       LmkIdToPosition* decimated_positions);
+
+ private:
+  typedef std::uint64_t CellKey;
+
+  struct Cell {
+    //! Hash of the full triangles (and locked vertices) of the cell when it
+    //! was decimated.
+    size_t signature_ = 0u;
+    std::vector<Triangle> triangles_;
+    LmkIdToPosition positions_;
+  };
+
+  CellKey getCellKey(const Vertex3D& point) const;
+
+ private:
+  const MeshDecimationParams params_;
+
+  std::unordered_map<CellKey, Cell> cells_;
+  size_t nr_decimated_cells_ = 0u;
+
+  Mesh3D coarse_mesh_;
+};
+
+}  // namespace VIO
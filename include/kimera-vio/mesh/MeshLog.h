@@ -0,0 +1,169 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   MeshLog.h
+ * @brief  Binary, append-only log of a mesh, as one chunk of changes per
+ * keyframe, and its memory-mapped reader.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/mesh/Mesh.h"
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/MemoryAccounting.h"
+
+namespace VIO {
+
+class MappedFile;
+
+/**
+ * @brief The MeshLogWriter class appends the state of a mesh to a binary file
+ * as the changes since the previous append: vertices removed, vertices added
+ * or moved (or recolored), faces removed and faces added. Vertices are keyed
+ * by landmark id, and faces by the id the writer gives them, so a delta is
+ * independent of the vertex ids of the mesh (which removals reorder). Writing
+ * a chunk only costs the size of the changes, not of the whole mesh: long
+ * runs neither slow down the logging nor fill the disk with repeated meshes.
+ *
+ * Each chunk is flushed once written; a chunk cut short (e.g. by a crash) is
+ * ignored by the MeshLogReader. Only triangle meshes are supported.
+ *
+ * Layout: header (magic, version, vertex dimension, polygon dimension), then
+ * per chunk: ChunkHeader and its arrays, each padded to 8 bytes:
+ *   removed vertex lmk ids (int64), removed face ids (uint64),
+ *   vertex lmk ids (int64), positions (float[vertex dimension]),
+ *   colors (uint8[3]), face ids (uint64), face lmk ids (int64[3]).
+ */
+class MeshLogWriter {
+ public:
+  KIMERA_POINTER_TYPEDEFS(MeshLogWriter);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(MeshLogWriter);
+
+  /**
+   * @param filepath Log file, overwritten.
+   * @param vertex_dim 2 for Mesh2D, 3 for Mesh3D.
+   * @param log_removals If false, vertices and faces removed from the mesh
+   * stay in the log: it replays as the mesh accumulated over the run.
+   */
+  MeshLogWriter(const std::string& filepath,
+                const size_t& vertex_dim,
+                const size_t& polygon_dim = 3u,
+                const bool& log_removals = true);
+  ~MeshLogWriter() = default;
+
+  //! Appends the changes of the mesh since the previous append.
+  template <typename VertexPosition>
+  void append(const Mesh<VertexPosition>& mesh, const Timestamp& timestamp);
+
+  /**
+   * @brief append Same, for a mesh given as matrices.
+   * @param lmk_ids Landmark id of each vertex.
+   * @param vertices n vertices, with vertex_dim float coordinates each.
+   * @param colors n CV_8UC3 colors.
+   * @param polygons_mesh Faces in the format of Mesh::getPolygonsMeshToMat.
+   */
+  void append(const Timestamp& timestamp,
+              const LandmarkIds& lmk_ids,
+              const cv::Mat& vertices,
+              const cv::Mat& colors,
+              const cv::Mat& polygons_mesh);
+
+  inline size_t getNrChunks() const { return nr_chunks_; }
+
+ private:
+  typedef std::array<LandmarkId, 3> FaceKey;
+  struct FaceKeyHash {
+    size_t operator()(const FaceKey& key) const;
+  };
+
+  struct LoggedVertex {
+    std::array<float, 3> position;
+    std::array<uint8_t, 3> color;
+    uint64_t generation;
+  };
+  struct LoggedFace {
+    uint64_t id;
+    uint64_t generation;
+  };
+
+ private:
+  const size_t vertex_dim_;
+  const size_t polygon_dim_;
+  const bool log_removals_;
+  std::ofstream stream_;
+  size_t nr_chunks_;
+
+  //! State of the mesh as logged so far, to compute the next changes.
+  //! Entries not seen at the current generation are not in the mesh anymore.
+  uint64_t generation_;
+  uint64_t next_face_id_;
+  std::unordered_map<LandmarkId, LoggedVertex> vertices_;
+  std::unordered_map<FaceKey, LoggedFace, FaceKeyHash> faces_;
+  //! Bytes of the logged state above.
+  utils::MemoryGauge memory_;
+};
+
+/**
+ * @brief The MeshLogReader class memory-maps a log written by MeshLogWriter
+ * and indexes its chunks, without reading their arrays until a mesh is
+ * replayed from them.
+ */
+class MeshLogReader {
+ public:
+  KIMERA_POINTER_TYPEDEFS(MeshLogReader);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(MeshLogReader);
+
+  //! Not valid if the file does not exist or is not a mesh log.
+  explicit MeshLogReader(const std::string& filepath);
+  ~MeshLogReader() = default;
+
+  inline bool isValid() const { return file_ != nullptr; }
+  inline size_t getVertexDim() const { return vertex_dim_; }
+  inline size_t getNrChunks() const { return chunks_.size(); }
+  Timestamp getTimestamp(const size_t& chunk_idx) const;
+
+  /**
+   * @brief getMesh Replays the first nr_chunks chunks of the log into mesh,
+   * which is replaced. The normals are not logged: compute them if needed.
+   */
+  template <typename VertexPosition>
+  void getMesh(const size_t& nr_chunks, Mesh<VertexPosition>* mesh) const;
+
+ private:
+  struct Chunk {
+    Timestamp timestamp;
+    uint64_t nr_removed_vertices;
+    uint64_t nr_removed_faces;
+    uint64_t nr_vertices;
+    uint64_t nr_faces;
+    //! Offset of the arrays in the file.
+    size_t offset;
+  };
+
+ private:
+  std::shared_ptr<const MappedFile> file_;
+  size_t vertex_dim_;
+  size_t polygon_dim_;
+  std::vector<Chunk> chunks_;
+};
+
+}  // namespace VIO
@@ -26,7 +26,10 @@ enum class MeshOptimizerType {
   kConnectedMesh = 0,
   kDisconnectedMesh = 1,
   kClosedForm = 2,
-  kGtsamMesh = 3
+  kGtsamMesh = 3,
+  //! Same problem as kGtsamMesh, solved with conjugate gradient iterations
+  //! warm-started from the previous solution.
+  kIncrementalMesh = 4
 };
 
 enum class MeshColorType {
@@ -16,6 +16,7 @@
 #pragma once
 
 #include <map>
+#include <unordered_map>
 #include <vector>
 
 #include <Eigen/Core>
@@ -24,6 +25,8 @@
 
 #include <gtsam/geometry/Cal3_S2.h>
 #include <gtsam/geometry/Pose3.h>
+#include <gtsam/linear/GaussianFactorGraph.h>
+#include <gtsam/linear/VectorValues.h>
 
 #include "kimera-vio/common/vio_types.h"
 #include "kimera-vio/frontend/Camera.h"
@@ -101,9 +104,11 @@ class MeshOptimization {
                                      TriangleToPixels* pixel_corresp,
                                      size_t* number_of_valid_datapoints);
 
-  /** THIS IS TOO SLOW, and assumes noisy point cloud is not organized...
+  /** Assumes noisy point cloud is not organized...
    * @brief collectTriangleDataPoints Builds correspondences between 2D
-   * triangles and noisy point cloud.
+   * triangles and noisy point cloud. The triangles are scan-converted once
+   * into a pixel to triangle id buffer (first triangle wins), which is then
+   * looked up for each projected point.
    * @param noisy_point_cloud
    * @param mesh_2d
    * @param corresp
@@ -146,6 +151,19 @@ class MeshOptimization {
       const cv::Mat& pcl_colors,
       const Mesh2D& mesh_2d);
 
+  /**
+   * @brief solveWarmStarted Solves the linear factor graph with conjugate
+   * gradient iterations, starting from the inverse depths of the previous
+   * solution for the landmarks that were already in it.
+   * @param factor_graph Keys are the vertex ids of mesh_2d.
+   * @param mesh_2d To get the landmark ids of the vertices.
+   * @param initial_inv_depth Initial guess for the new landmarks.
+   */
+  gtsam::VectorValues solveWarmStarted(
+      const gtsam::GaussianFactorGraph& factor_graph,
+      const Mesh2D& mesh_2d,
+      const double& initial_inv_depth) const;
+
  private:
   void getBearingVectorFrom2DPixel(const cv::Point2f& pixel,
                                    cv::Point3f* bearing_vector);
@@ -173,11 +191,19 @@ class MeshOptimization {
   static constexpr float kMissingZ = 10000.0f;
   static constexpr float kMinZ = 0.00001f;
   static constexpr float kMaxZ = 10.0f;
+  //! Conjugate gradient stopping criteria for kIncrementalMesh.
+  static constexpr size_t kIncrementalMaxIterations = 200u;
+  static constexpr double kIncrementalRelativeTolerance = 1e-6;
+  static constexpr double kIncrementalAbsoluteTolerance = 1e-10;
 
   //! Camera with which the noisy point cloud and the 2d mesh were generated.
   Camera::ConstPtr mono_camera_;
   gtsam::Pose3 body_pose_cam_;
 
+  //! Inverse depths of the landmarks in the last solution, to warm-start
+  //! the next one (kIncrementalMesh).
+  std::unordered_map<LandmarkId, double> lmk_ids_to_inv_depths_;
+
   //! Mesh count: just for visualization to change the ids of the 3d mesh widget
   size_t mesh_count_ = 0u;
 
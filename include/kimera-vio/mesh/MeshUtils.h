@@ -16,6 +16,11 @@
 
 #include <Eigen/Core>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
 #include <glog/logging.h>
 
 #include <opencv2/viz.hpp>
@@ -239,4 +244,105 @@ T max3(const T& a, const T& b, const T& c) {
   return std::max(a, std::max(b, c));
 }
 
+/**
+ * @brief rasterizeTriangle Scan-converts a 2D triangle: calls f(u, v) for each
+ * pixel (u, v) of an image of size img_size that is inside the triangle or on
+ * its edges, row by row, with the same test as pointInTriangle in
+ * MeshOptimization (the edge functions do not have different signs).
+ * Each row of the bounding box is first clipped analytically to the span
+ * where the edge functions can agree (with a margin for the float rounding),
+ * so that only the pixels of the span are tested.
+ * @param v1, v2, v3 Vertices of the triangle, as (u, v) = (x, y) pixels.
+ * @return False if the triangle is out of the image.
+ */
+template <typename PixelFunction>
+bool rasterizeTriangle(const KeypointCV& v1,
+                       const KeypointCV& v2,
+                       const KeypointCV& v3,
+                       const cv::Size& img_size,
+                       const PixelFunction& f) {
+  const float xmin = min3(v1.x, v2.x, v3.x);
+  const float ymin = min3(v1.y, v2.y, v3.y);
+  const float xmax = max3(v1.x, v2.x, v3.x);
+  const float ymax = max3(v1.y, v2.y, v3.y);
+  // WARNING bcs of cv::Point2f convention x is the width...
+  if (xmin > img_size.width - 1 || xmax < 0 || ymin > img_size.height - 1 ||
+      ymax < 0) {
+    return false;
+  }
+  // be careful xmin/xmax/ymin/ymax can be negative.
+  const int32_t x0 = std::max(int32_t(0), (int32_t)(std::floor(xmin)));
+  const int32_t x1 =
+      std::min(int32_t(img_size.width) - 1, (int32_t)(std::floor(xmax)));
+  const int32_t y0 = std::max(int32_t(0), (int32_t)(std::floor(ymin)));
+  const int32_t y1 =
+      std::min(int32_t(img_size.height) - 1, (int32_t)(std::floor(ymax)));
+
+  // Edge e function: (u - a[e].x) * dy[e] - dx[e] * (v - a[e].y).
+  const KeypointCV a[3] = {v2, v3, v1};
+  const float dx[3] = {v1.x - v2.x, v2.x - v3.x, v3.x - v1.x};
+  const float dy[3] = {v1.y - v2.y, v2.y - v3.y, v3.y - v1.y};
+  const auto is_inside = [&a, &dx, &dy](const float& u, const float& v) {
+    const float d1 = (u - a[0].x) * dy[0] - dx[0] * (v - a[0].y);
+    const float d2 = (u - a[1].x) * dy[1] - dx[1] * (v - a[1].y);
+    const float d3 = (u - a[2].x) * dy[2] - dx[2] * (v - a[2].y);
+    const bool has_neg = (d1 < 0) || (d2 < 0) || (d3 < 0);
+    const bool has_pos = (d1 > 0) || (d2 > 0) || (d3 > 0);
+    return !(has_neg && has_pos);
+  };
+
+  // Bound of the float rounding of the edge functions, per edge.
+  const double extent = 1.0 + std::max(max3(std::fabs(xmin),
+                                            std::fabs(xmax),
+                                            static_cast<float>(img_size.width)),
+                                       max3(std::fabs(ymin),
+                                            std::fabs(ymax),
+                                            static_cast<float>(
+                                                img_size.height)));
+  static constexpr double kRounding =
+      16.0 * std::numeric_limits<float>::epsilon();
+  double rounding[3];
+  for (size_t e = 0u; e < 3u; ++e) {
+    rounding[e] = kRounding * extent * (std::fabs(dx[e]) + std::fabs(dy[e]));
+  }
+  // Sign of the edge functions inside the triangle (first edge function at
+  // the opposite vertex). For (nearly) degenerate triangles, the sign of the
+  // pixels inside is not known, and the whole bounding box is tested.
+  double orientation =
+      (static_cast<double>(v3.x) - a[0].x) * dy[0] -
+      static_cast<double>(dx[0]) * (static_cast<double>(v3.y) - a[0].y);
+  if (std::fabs(orientation) <=
+      4.0 * (rounding[0] + rounding[1] + rounding[2])) {
+    orientation = 0.0;
+  }
+
+  for (int32_t v = y0; v <= y1; ++v) {
+    double lo = x0;
+    double hi = x1;
+    for (size_t e = 0u; e < 3u && orientation != 0.0 && lo <= hi; ++e) {
+      // Keep the u with s * (dy * u + c) >= -rounding, s the orientation.
+      const double c =
+          -static_cast<double>(a[e].x) * dy[e] -
+          static_cast<double>(dx[e]) * (static_cast<double>(v) - a[e].y);
+      const double s_dy = orientation > 0.0 ? dy[e] : -dy[e];
+      const double s_c = orientation > 0.0 ? c : -c;
+      if (s_dy > 0.0) {
+        lo = std::max(lo, (-s_c - rounding[e]) / s_dy - 1.0);
+      } else if (s_dy < 0.0) {
+        hi = std::min(hi, (-s_c - rounding[e]) / s_dy + 1.0);
+      } else if (s_c < -rounding[e]) {
+        hi = lo - 1.0;
+      }
+    }
+    if (lo > hi) continue;
+    // Test the pixels of the span, in a branch-free loop body.
+    const int32_t u0 = std::max(x0, static_cast<int32_t>(std::floor(lo)));
+    const int32_t u1 = std::min(x1, static_cast<int32_t>(std::ceil(hi)));
+    for (int32_t u = u0; u <= u1; ++u) {
+      if (is_inside(u, v)) f(u, v);
+    }
+  }
+  return true;
+}
+
 }  // namespace VIO
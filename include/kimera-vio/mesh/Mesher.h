@@ -14,20 +14,29 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <cstdlib>
+#include <deque>
 #include <limits>  // for numeric_limits<>
 #include <opencv2/opencv.hpp>
 #include <optional>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>  // for move
 #include <vector>
 
+#include "kimera-vio/common/LandmarkStore.h"
 #include "kimera-vio/common/vio_types.h"
 #include "kimera-vio/logging/Logger.h"
+#include "kimera-vio/mesh/IncrementalDelaunay.h"
 #include "kimera-vio/mesh/Mesh.h"
 #include "kimera-vio/mesh/Mesher-definitions.h"
+#include "kimera-vio/mesh/NormalHash.h"
 #include "kimera-vio/utils/Histogram.h"
 #include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/MemoryAccounting.h"
+#include "kimera-vio/utils/UtilsNumerical.h"
 
 namespace VIO {
 
@@ -102,11 +111,10 @@ class Mesher {
       LandmarkIds* lmk_ids) const;
 
   /**
-   * @brief serializeMeshes Write meshes to file so that they can be loaded
-   * later (Note: the function is not const bcs serialize needs to be non-const)
-   * But we do not modify the meshes.
+   * @brief serializeMeshes Appends the changes of the meshes at this keyframe
+   * to their files, so that they can be loaded later.
    */
-  void serializeMeshes();
+  void serializeMeshes(const Timestamp& timestamp);
 
   /**
    * @brief deserializeMeshes Load meshes from a file where the meshes were
@@ -168,7 +176,8 @@ class Mesher {
   inline const Mesh3D& get3DMesh() const { return mesh_3d_; }
 
   /* ------------------------------------------------------------------------ */
-  // Reduce the 3D mesh to the current VIO lmks only.
+  // Reduce the 3D mesh to the current VIO lmks only, in place: the landmarks
+  // that left the time horizon are found with an expiry queue.
   void updatePolygonMeshToTimeHorizon(
       const PointsWithIdMap& points_with_id_map,
       const gtsam::Pose3& leftCameraPose,
@@ -297,6 +306,15 @@ class Mesher {
                      const double& min_ratio_between_largest_an_smallest_side,
                      const double& min_elongation_ratio,
                      const double& max_triangle_side) const;
+  //! Same, on the vertex positions of a triangle (e.g. read in place in the
+  //! mesh).
+  bool isBadTriangle(const Vertex3D& p1,
+                     const Vertex3D& p2,
+                     const Vertex3D& p3,
+                     const gtsam::Pose3& left_camera_pose,
+                     const double& min_ratio_between_largest_an_smallest_side,
+                     const double& min_elongation_ratio,
+                     const double& max_triangle_side) const;
 
   /* ------------------------------------------------------------------------ */
   // Segment planes in the mesh:
@@ -333,45 +351,51 @@ class Mesher {
       const PointsWithIdMap& points_with_id_vio) const;
 
   /* ------------------------------------------------------------------------ */
-  // Updates planes lmk ids field with a polygon vertices ids if this polygon
-  // is part of the plane according to given tolerance.
+  // Computes the normal of each polygon of the 3D mesh, and hashes them so
+  // that the plane association only visits the polygons with a similar normal.
+  void updatePolygonNormals();
+
+  /* ------------------------------------------------------------------------ */
+  // Updates planes lmk ids field with the vertices ids of the polygons that
+  // are part of the plane according to given tolerance. Only the polygons
+  // whose normal hashes close to the plane normal are tested.
   // It can either associate a polygon only once to the first plane it matches,
   // or it can associate to multiple planes, depending on the flag passed.
-  bool updatePlanesLmkIdsFromPolygon(
-      std::vector<Plane>* seed_planes,
-      const Mesh3D::Polygon& polygon,
-      const size_t& triangle_id,
-      const cv::Point3f& triangle_normal,
+  // Polygons associated to a plane are flagged in is_polygon_on_a_plane.
+  void updatePlanesLmkIdsFromPolygons(
+      std::vector<Plane>* planes,
       double normal_tolerance,
       double distance_tolerance,
       const PointsWithIdMap& points_with_id_vio,
-      bool only_associate_a_polygon_to_a_single_plane = false) const;
+      bool only_associate_a_polygon_to_a_single_plane,
+      std::vector<uint8_t>* is_polygon_on_a_plane) const;
 
   /* --------------------------------------------------------------------------
    */
-  // Segment new planes in the mesh.
-  // Currently segments horizontal planes using z_components, which is
-  // expected to be a cv::Mat z_components (1, 0, CV_32F);
-  // And walls perpendicular to the ground, using a cv::Mat which is expected to
-  // be a cv::Mat walls (0, 0, CV_32FC2), with first channel being theta (yaw
-  // angle of the wall) and the second channel the distance of it.
-  // points_with_id_vio is only used if we are using stereo points...
-  void segmentNewPlanes(std::vector<Plane>* new_segmented_planes,
-                        const cv::Mat& z_components,
-                        const cv::Mat& walls);
+  // Updates the histograms of the plane segmentation with the polygons that
+  // changed since the last call: the z values of the vertices of horizontal
+  // polygons (z_hist_), and the theta angle (yaw) and distance of polygons
+  // perpendicular to the ground (hist_2d_). Polygons already on a plane are
+  // skipped if only_use_non_clustered_points.
+  void updatePlaneHistograms(const std::vector<uint8_t>& is_polygon_on_a_plane,
+                             const double& normal_tolerance_horizontal_surface,
+                             const double& normal_tolerance_walls);
+
+  /* ------------------------------------------------------------------------ */
+  // Segment new planes in the mesh, from the peaks of the histograms.
+  // Currently segments horizontal planes using z_hist_, and walls
+  // perpendicular to the ground using hist_2d_.
+  void segmentNewPlanes(std::vector<Plane>* new_segmented_planes);
 
   /* ------------------------------------------------------------------------ */
   // Segment wall planes.
-  void segmentWalls(std::vector<Plane>* wall_planes,
-                    size_t* plane_id,
-                    const cv::Mat& walls);
+  void segmentWalls(std::vector<Plane>* wall_planes, size_t* plane_id);
 
   /* ------------------------------------------------------------------------ */
   // Segment new planes horizontal.
   void segmentHorizontalPlanes(std::vector<Plane>* horizontal_planes,
                                size_t* plane_id,
-                               const Plane::Normal& normal,
-                               const cv::Mat& z_components);
+                               const Plane::Normal& normal);
 
   /* ------------------------------------------------------------------------ */
   // Data association between planes:
@@ -404,9 +428,13 @@ class Mesher {
   // meaning it checks that we can find the lmk id in points_with_id_vio...
   // WARNING: this function won't check that the original lmk_ids are in the
   // optimization (time-horizon)...
-  void appendLmkIdsOfPolygon(const Mesh3D::Polygon& polygon,
-                             LandmarkIds* lmk_ids,
-                             const PointsWithIdMap& points_with_id_vio) const;
+  // If given, lmk_ids_set must hold the same ids as lmk_ids, and is used
+  // instead of searching lmk_ids for duplicates.
+  void appendLmkIdsOfPolygon(
+      const Mesh3D::Polygon& polygon,
+      LandmarkIds* lmk_ids,
+      const PointsWithIdMap& points_with_id_vio,
+      std::unordered_set<LandmarkId>* lmk_ids_set = nullptr) const;
 
   /* ------------------------------------------------------------------------ */
   // Clones underlying data structures encoding the mesh.
@@ -434,6 +462,19 @@ class Mesher {
       const cv::Size& img_size,
       const PointsWithIdMap& pointsWithIdVIO);
 
+  /**
+   * @brief createMesh2dIncremental Same as createMesh2dVIO, but updates the
+   * triangulation of the previous call instead of triangulating all the
+   * keypoints from scratch: tracked keypoints are moved, lost ones removed
+   * and new ones inserted.
+   */
+  void createMesh2dIncremental(
+      std::vector<cv::Vec6f>* triangulation_2D,
+      const LandmarkIds& landmarks,
+      const std::vector<KeypointStatus>& keypoints_status,
+      const KeypointsCV& keypoints,
+      const PointsWithIdMap& pointsWithIdVIO);
+
   static void createMesh2dStereo(
       std::vector<cv::Vec6f>* triangulation_2D,
       const LandmarkIds& landmarks,
@@ -449,15 +490,54 @@ class Mesher {
   Mesh2D mesh_2d_;
   // The 3D mesh.
   Mesh3D mesh_3d_;
+  // Number of updates of the 3D mesh to the time horizon, and last update in
+  // which each landmark of the time horizon was seen.
+  size_t time_horizon_update_count_ = 0u;
+  LandmarkStore<size_t> lmk_ids_last_seen_;
+  // (update, lmk id) pairs in the order they were seen, to find the landmarks
+  // that left the time horizon without going through the whole mesh.
+  std::deque<std::pair<size_t, LandmarkId>> lmk_ids_expiry_queue_;
   // The histogram of z values for vertices of polygons parallel to ground.
   Histogram z_hist_;
   // The 2d histogram of theta angle (latitude) and distance of polygons
   // perpendicular to the vertical (aka parallel to walls).
   Histogram hist_2d_;
 
+  // Sample of a polygon in the histograms above.
+  struct PolygonHistogramSample {
+    enum class Type : uint8_t { kHorizontal, kWall };
+    Type type = Type::kHorizontal;
+    // z of the vertices (kHorizontal), or theta and distance (kWall).
+    std::array<float, 3> values = {{0.0f, 0.0f, 0.0f}};
+    bool operator==(const PolygonHistogramSample& other) const {
+      return type == other.type && values == other.values;
+    }
+  };
+  // Lmk ids of the vertices of a polygon, sorted: stable across frames unlike
+  // the vertex ids of the mesh.
+  using PolygonLmkIds = std::array<LandmarkId, 3>;
+  struct PolygonLmkIdsHash {
+    size_t operator()(const PolygonLmkIds& lmk_ids) const {
+      return UtilsNumerical::hashTriplet(lmk_ids[0], lmk_ids[1], lmk_ids[2]);
+    }
+  };
+  // Samples currently in the histograms, per polygon.
+  std::unordered_map<PolygonLmkIds, PolygonHistogramSample, PolygonLmkIdsHash>
+      polygon_histogram_samples_;
+
   const MesherParams mesher_params_;
+  // 2D triangulation of the keypoints, kept across keyframes.
+  IncrementalDelaunay delaunay_;
+  // Normal of each polygon of mesh_3d_ (valid if polygon_has_normal_), and
+  // their hash, for the plane segmentation and association.
+  std::vector<cv::Point3f> polygon_normals_;
+  std::vector<uint8_t> polygon_has_normal_;
+  NormalHash polygon_normal_hash_;
   std::unique_ptr<MesherLogger> mesher_logger_;
   const bool serialize_meshes_;
+
+  //! Of the 3D mesh.
+  utils::MemoryGauge mesh_memory_;
 };
 
 }  // namespace VIO
@@ -18,6 +18,7 @@
 #include "kimera-vio/mesh/Mesher.h"
 #include "kimera-vio/pipeline/PipelineModule.h"
 #include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/ThreadsafeRendezvousBuffer.h"
 
 namespace VIO {
 
@@ -35,18 +36,22 @@ class MesherModule : public MIMOPipelineModule<MesherInput, MesherOutput> {
 
   //! Callbacks to fill queues: they should be all lighting fast.
   inline void fillFrontendQueue(const MesherFrontendInput& frontend_payload) {
-    frontend_payload_queue_.push(frontend_payload);
+    // Only keyframes have a Backend output to be synchronized with.
+    if (!frontend_payload || !frontend_payload->is_keyframe_) {
+      return;
+    }
+    frontend_payload_buffer_.push(frontend_payload->timestamp_,
+                                  frontend_payload);
   }
   inline void fillBackendQueue(const MesherBackendInput& backend_payload) {
     backend_payload_queue_.push(backend_payload);
   }
 
  protected:
-  //! Synchronize input queues. Currently doing it in a crude way:
-  //! Pop blocking the payload that should be the last to be computed,
-  //! then loop over the other queues until you get a payload that has exactly
-  //! the same timestamp. Guaranteed to sync messages unless the assumption
-  //! on the order of msg generation is broken.
+  //! Synchronize input queues: pop blocking the payload that should be the
+  //! last to be computed (Backend), then wait for the Frontend payload with
+  //! exactly the same timestamp. Guaranteed to sync messages unless the
+  //! assumption on the order of msg generation is broken.
   InputUniquePtr getInputPacket() override;
 
   OutputUniquePtr spinOnce(MesherInput::UniquePtr input) override;
@@ -60,7 +65,7 @@ class MesherModule : public MIMOPipelineModule<MesherInput, MesherOutput> {
 
  private:
   //! Input Queues
-  ThreadsafeQueue<MesherFrontendInput> frontend_payload_queue_;
+  ThreadsafeRendezvousBuffer<MesherFrontendInput> frontend_payload_buffer_;
   ThreadsafeQueue<MesherBackendInput> backend_payload_queue_;
 
   //! Mesher implementation
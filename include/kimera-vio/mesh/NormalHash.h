@@ -0,0 +1,93 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   NormalHash.h
+ * @brief  Spatial hash of unit normals, to find the polygons or planes
+ * parallel to a given normal without testing all of them.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The NormalHash class bins unit normals (points on the unit sphere)
+ * in a regular 3D grid of cells hashed by their coordinates, and returns the
+ * ids of the normals that may be parallel (in either direction) to a query
+ * normal. Normals with |n.dot(q)| > 1 - tolerance are within a chord
+ * sqrt(2 * tolerance) of q or -q, so a query only visits the cells around q
+ * and -q. The results are candidates: callers still run their exact test.
+ */
+class NormalHash {
+ public:
+  KIMERA_POINTER_TYPEDEFS(NormalHash);
+
+  using Id = size_t;
+  using Ids = std::vector<Id>;
+
+  /**
+   * @param cell_size Side of the cells, in normal space. Best set to the
+   * chord radius of the tolerance of the queries (getChordRadius).
+   */
+  explicit NormalHash(const double& cell_size);
+  virtual ~NormalHash() = default;
+
+  //! Adds the unit normal of the element id.
+  void insert(const Id& id, const cv::Point3f& normal);
+
+  /**
+   * @brief query Ids of the normals n that may satisfy
+   * |n.dot(normal)| > 1 - tolerance, in increasing order, so that looping over
+   * them follows the insertion order of the ids.
+   */
+  void query(const cv::Point3f& normal,
+             const double& tolerance,
+             Ids* ids) const;
+
+  void clear();
+
+  inline size_t size() const { return size_; }
+  inline double getCellSize() const { return cell_size_; }
+
+  //! Max distance between two unit normals n, q with n.dot(q) > 1 - tolerance.
+  static double getChordRadius(const double& tolerance);
+
+ private:
+  using CellCoords = std::array<int32_t, 3>;
+  struct Cell {
+    CellCoords coords;
+    Ids ids;
+  };
+
+  CellCoords getCellCoords(const cv::Point3d& point) const;
+  static int64_t getCellKey(const CellCoords& coords);
+
+  //! Appends the ids of the cells overlapping the cube of half side radius
+  //! around center.
+  void collectAround(const cv::Point3d& center,
+                     const double& radius,
+                     Ids* ids) const;
+
+ private:
+  const double cell_size_;
+  std::unordered_map<int64_t, Cell> cells_;
+  size_t size_ = 0u;
+};
+
+}  // namespace VIO
@@ -0,0 +1,135 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   AdmissionController.h
+ * @brief  Sheds the inputs of the optional modules when the critical path
+ * (Frontend and Backend) falls behind.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/Statistics.h"
+
+namespace VIO {
+
+//! Load of the critical path, from its queues.
+enum class CriticalPathLoad {
+  //! Keeping up: the optional modules run within their budgets.
+  kSlack = 0,
+  //! Falling behind: the optional modules decimate their inputs.
+  kPressure = 1,
+  //! At risk: the optional modules skip all their inputs.
+  kCritical = 2,
+};
+
+struct OptionalModuleBudget {
+  //! Mean processing time per input the module is allowed [ms]: a module
+  //! taking longer decimates its inputs to stay within it. 0 for no budget.
+  double budget_ms = 0.0;
+  //! Under pressure, the module processes one input out of this many.
+  size_t decimation_under_pressure = 2u;
+};
+
+/**
+ * @brief The AdmissionController class decides, for each input of the
+ * optional modules (mesher, loop closure, visualizer, display), whether the
+ * module processes it, depending on the load of the critical path:
+ * - kSlack: the inputs are admitted, decimated only to keep the module within
+ *   its budget.
+ * - kPressure (a critical path queue holds pressure_depth values or more):
+ *   the inputs are also decimated by decimation_under_pressure.
+ * - kCritical (critical_depth values or more): no input is admitted.
+ * Once loaded, the critical path only goes back to kSlack when all its queues
+ * are down to slack_depth values, to avoid switching at every input.
+ *
+ * Thread-safe: the modules call admit and reportSpinDuration from their own
+ * threads.
+ */
+class AdmissionController {
+ public:
+  KIMERA_POINTER_TYPEDEFS(AdmissionController);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(AdmissionController);
+  //! Nr of values waiting in a queue of the critical path.
+  using DepthCallback = std::function<size_t()>;
+
+  AdmissionController(const size_t& slack_depth,
+                      const size_t& pressure_depth,
+                      const size_t& critical_depth);
+  ~AdmissionController() = default;
+
+  //! Call before the modules start.
+  void addCriticalPathQueue(const std::string& queue_id,
+                            const DepthCallback& depth);
+
+  //! Call before the module starts.
+  //! @return Id of the module, for admit and reportSpinDuration.
+  size_t registerOptionalModule(const std::string& name_id,
+                                const OptionalModuleBudget& budget);
+
+  //! Updates the load from the depth of the critical path queues.
+  CriticalPathLoad getLoad();
+
+  inline bool isCriticalPathAtRisk() {
+    return getLoad() != CriticalPathLoad::kSlack;
+  }
+
+  //! Whether the module processes its next input. Counts the input as shed
+  //! otherwise.
+  bool admit(const size_t& module_id);
+
+  //! Time the module took to process an admitted input [ms].
+  void reportSpinDuration(const size_t& module_id, const double& duration_ms);
+
+  //! Admitted and shed inputs of each module.
+  std::string print() const;
+
+ private:
+  struct CriticalPathQueue {
+    std::string queue_id;
+    DepthCallback depth;
+  };
+
+  struct OptionalModule {
+    OptionalModule(const std::string& name_id,
+                   const OptionalModuleBudget& budget);
+
+    std::string name_id;
+    OptionalModuleBudget budget;
+    //! Moving average, 0 until the first input is processed.
+    double mean_spin_ms;
+    size_t nr_inputs;
+    size_t nr_admitted;
+    //! One sample per input: 1 if shed, 0 if admitted.
+    utils::StatsCollector shed_stats;
+  };
+
+  //! Mutex must be locked.
+  CriticalPathLoad updateLoad();
+
+ private:
+  const size_t slack_depth_;
+  const size_t pressure_depth_;
+  const size_t critical_depth_;
+
+  mutable std::mutex mutex_;
+  std::vector<CriticalPathQueue> critical_path_queues_;
+  std::vector<std::unique_ptr<OptionalModule>> optional_modules_;
+  CriticalPathLoad load_;
+};
+
+}  // namespace VIO
@@ -0,0 +1,134 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   EmbeddedStereoImuPipeline.h
+ * @brief  Stereo VIO run inline in the thread of the caller, one step per
+ * stereo frame.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "kimera-vio/backend/VioBackend.h"
+#include "kimera-vio/common/VioNavState.h"
+#include "kimera-vio/frontend/Frame.h"
+#include "kimera-vio/frontend/StereoCamera.h"
+#include "kimera-vio/frontend/VisionImuFrontend.h"
+#include "kimera-vio/imu-frontend/ImuFrontend-definitions.h"
+#include "kimera-vio/mesh/Mesher.h"
+#include "kimera-vio/pipeline/Pipeline-definitions.h"
+#include "kimera-vio/pipeline/StereoKeyframeStep.h"
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/PerfCounters.h"
+#include "kimera-vio/utils/Statistics.h"
+
+namespace VIO {
+
+//! State estimated by a step of the EmbeddedStereoImuPipeline.
+struct EmbeddedVioState {
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  //! Whether W_State_B is estimated: false until the Backend is
+  //! initialized.
+  bool valid = false;
+  //! Whether the frame is a keyframe, W_State_B then being optimized by the
+  //! Backend, else predicted from the IMU since the last keyframe.
+  bool is_keyframe = false;
+  //! At the timestamp of the frame.
+  VioNavStateTimestamped W_State_B = VioNavStateTimestamped(0, VioNavState());
+  //! Durations of the step and of its stages [us], 0 if not run.
+  int64_t frontend_us = 0;
+  int64_t backend_us = 0;
+  int64_t mesher_us = 0;
+  int64_t step_us = 0;
+};
+
+/**
+ * @brief The EmbeddedStereoImuPipeline class runs the Frontend, the Backend
+ * and optionally the Mesher of the stereo VIO directly in the thread of the
+ * caller, one step per stereo frame: no data provider, no queues, no module
+ * threads and no callbacks between modules. For users that embed the VIO in
+ * their own loop and want the lowest latency, instead of
+ * Pipeline::spinOnce which, even when sequential, goes through the queues of
+ * all modules.
+ *
+ * The caller synchronizes the IMU with the frames: each step gets the IMU
+ * measurements from the previous frame up to this one (as the data provider
+ * would). Hence the online IMU-camera time alignment is not supported.
+ *
+ * Not thread-safe: steps must not overlap. Each step is timed, in the
+ * returned state and in the "Embedded ... [ms]" statistics, and sampled by
+ * the performance counters and the allocation tracker like a module spin.
+ */
+class EmbeddedStereoImuPipeline {
+ public:
+  KIMERA_POINTER_TYPEDEFS(EmbeddedStereoImuPipeline);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(EmbeddedStereoImuPipeline);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  /**
+   * @brief EmbeddedStereoImuPipeline
+   * @param params Vio parameters, with two cameras.
+   * @param use_mesher Whether each keyframe also updates the 3D mesh.
+   * @param max_imu_batch_size Max nr of IMU measurements per step, which
+   * bounds the cost of the preintegration of a step.
+   */
+  EmbeddedStereoImuPipeline(const VioParams& params,
+                            const bool& use_mesher = false,
+                            const size_t& max_imu_batch_size = 1000u);
+  ~EmbeddedStereoImuPipeline() = default;
+
+  /**
+   * @brief step Processes one stereo frame.
+   * @param imu_stamps Stamps of the IMU measurements since the previous frame,
+   * up to the timestamp of this one.
+   * @param imu_accgyrs The IMU measurements, one column per stamp.
+   * @param left_frame Frame of the left camera.
+   * @param right_frame Frame of the right camera, at the same timestamp.
+   * @param state Estimated state at the timestamp of the frames, preallocated
+   * by the caller.
+   * @return False if the Backend failed: the pipeline can not step anymore.
+   */
+  bool step(const ImuStampS& imu_stamps,
+            const ImuAccGyrS& imu_accgyrs,
+            const Frame& left_frame,
+            const Frame& right_frame,
+            EmbeddedVioState* state);
+
+  //! Latest 3D mesh, nullptr if there is no Mesher or no keyframe yet.
+  inline const MesherOutput::ConstPtr& getMesherOutput() const {
+    return mesher_output_;
+  }
+
+ private:
+  StereoCamera::ConstPtr stereo_camera_;
+  VisionImuFrontend::UniquePtr vio_frontend_;
+  VioBackend::UniquePtr vio_backend_;
+  StereoKeyframeStep::UniquePtr keyframe_step_;
+  //! nullptr if no mesher.
+  Mesher::UniquePtr mesher_;
+  const size_t max_imu_batch_size_;
+
+  //! Latest Backend estimate, at the last keyframe.
+  VioNavStateTimestamped W_State_Blkf_;
+  bool backend_initialized_;
+  bool backend_failed_;
+  MesherOutput::ConstPtr mesher_output_;
+
+  utils::StatsCollector step_stats_;
+  utils::StatsCollector frontend_stats_;
+  utils::StatsCollector backend_stats_;
+  utils::StatsCollector mesher_stats_;
+  utils::PerfCounterStats perf_stats_;
+};
+
+}  // namespace VIO
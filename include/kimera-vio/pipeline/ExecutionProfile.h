@@ -0,0 +1,218 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ExecutionProfile.h
+ * @brief  Performance, balanced and low-power execution profiles of the
+ * pipeline, and the monitor switching between them from the temperature, the
+ * CPU frequency and the latency headroom.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "kimera-vio/pipeline/PipelineParams.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+//! From the most to the least demanding.
+enum class ExecutionProfileType {
+  kPerformance = 0,
+  kBalanced = 1,
+  kLowPower = 2,
+};
+
+static constexpr size_t kNrExecutionProfiles = 3u;
+
+//! E.g. "low_power", the prefix of its keys in the pipeline params.
+std::string asString(const ExecutionProfileType& type);
+
+//! The knobs of the pipeline an execution profile sets.
+struct ExecutionProfile {
+  //! Scales the max nr of features detected per frame (in ]0, 1]), on top of
+  //! the adaptive feature budget if any.
+  double feature_budget_scale = 1.0;
+  //! The Frontend processes one frame out of this many once initialized
+  //! (the IMU of the skipped frames is kept).
+  size_t frontend_frame_decimation = 1u;
+  //! The Mesher and LCD process one input out of this many (the LCD still
+  //! adds the odometry of every keyframe, only its detections are skipped).
+  size_t mesher_decimation = 1u;
+  size_t lcd_decimation = 1u;
+  //! Max nr of threads of GTSAM's TBB scheduler, 0 for the backend_nr_threads
+  //! of the pipeline params.
+  int backend_nr_threads = 0;
+};
+
+bool operator==(const ExecutionProfile& lhs, const ExecutionProfile& rhs);
+
+//! When the monitor switches profiles, see ExecutionProfileGovernor.
+struct ExecutionProfileMonitorParams {
+  //! Between two readings of the platform.
+  std::chrono::milliseconds period = std::chrono::milliseconds(1000);
+  //! Target latency of the pipeline output ("VioBackend Latency [ms]"), the
+  //! headroom being the fraction of it left. 0 to ignore the latency.
+  double target_latency_ms = 100.0;
+  //! Step down (less demanding profile) from this temperature of the hottest
+  //! thermal zone, or this ratio of the max CPU frequency, or below this
+  //! latency headroom.
+  double hot_temperature_c = 80.0;
+  double throttled_frequency_ratio = 0.8;
+  double min_latency_headroom = 0.1;
+  //! Step up once below this temperature, above the throttled frequency
+  //! ratio and above this latency headroom for recover_periods readings in a
+  //! row.
+  double cool_temperature_c = 65.0;
+  double recover_latency_headroom = 0.4;
+  size_t recover_periods = 10u;
+  //! Readings to wait after a switch before stepping down again, to measure
+  //! its effect.
+  size_t hold_periods = 3u;
+};
+
+/**
+ * @brief The ExecutionProfileParams class holds the execution profiles and
+ * the profile to start with, parsed from optional keys of the pipeline
+ * params: execution_profile, auto_execution_profile, <profile>_<knob> (e.g.
+ * low_power_feature_budget_scale) and profile_<monitor param>.
+ */
+class ExecutionProfileParams : public PipelineParams {
+ public:
+  KIMERA_POINTER_TYPEDEFS(ExecutionProfileParams);
+  ExecutionProfileParams();
+  virtual ~ExecutionProfileParams() = default;
+
+  bool parseYAML(const std::string& filepath) override;
+  void print() const override;
+
+  inline const ExecutionProfile& getProfile(
+      const ExecutionProfileType& type) const {
+    return profiles_.at(static_cast<size_t>(type));
+  }
+
+ protected:
+  bool equals(const PipelineParams& obj) const override;
+
+ public:
+  ExecutionProfileType initial_profile_;
+  //! Whether the ExecutionProfileMonitor switches profiles at runtime.
+  bool auto_switch_;
+  //! Indexed by ExecutionProfileType.
+  std::array<ExecutionProfile, kNrExecutionProfiles> profiles_;
+  ExecutionProfileMonitorParams monitor_params_;
+};
+
+//! A reading of the platform, NaN values are unknown (and ignored).
+struct PlatformReading {
+  //! Of the hottest thermal zone [C].
+  double temperature_c = std::numeric_limits<double>::quiet_NaN();
+  //! Max CPU frequency allowed over the max CPU frequency, the lowest over
+  //! the CPUs: below 1 when the CPUs are throttled.
+  double frequency_ratio = std::numeric_limits<double>::quiet_NaN();
+  //! 1 - latency / target latency, negative when over the target.
+  double latency_headroom = std::numeric_limits<double>::quiet_NaN();
+};
+
+/**
+ * @brief The ExecutionProfileGovernor class decides the execution profile
+ * from the readings of the platform: it steps down to the next less
+ * demanding profile as soon as the platform is hot, throttled or out of
+ * latency headroom, and steps up to the next more demanding one only once
+ * it stayed cool with headroom for a while, to avoid switching back and
+ * forth.
+ */
+class ExecutionProfileGovernor {
+ public:
+  KIMERA_POINTER_TYPEDEFS(ExecutionProfileGovernor);
+
+  ExecutionProfileGovernor(const ExecutionProfileMonitorParams& params,
+                           const ExecutionProfileType& initial_profile);
+  ~ExecutionProfileGovernor() = default;
+
+  //! Feeds a reading of the platform.
+  //! @return True if the profile changed.
+  bool update(const PlatformReading& reading);
+
+  //! Restarts from the given profile (e.g. switched by hand).
+  void reset(const ExecutionProfileType& profile);
+
+  inline ExecutionProfileType getProfile() const { return profile_; }
+
+ private:
+  bool isStressed(const PlatformReading& reading) const;
+  bool isRelaxed(const PlatformReading& reading) const;
+
+ private:
+  const ExecutionProfileMonitorParams params_;
+  ExecutionProfileType profile_;
+  size_t nr_relaxed_readings_;
+  size_t readings_since_switch_;
+};
+
+/**
+ * @brief The ExecutionProfileMonitor class reads the platform every period in
+ * its own thread, and calls the switch callback (from that thread) when its
+ * governor changes the profile.
+ *
+ * The temperature is the hottest of /sys/class/thermal/thermal_zone*, and the
+ * frequency ratio the lowest scaling_max_freq / cpuinfo_max_freq of
+ * /sys/devices/system/cpu/cpufreq/policy* (the CPU frequency cooling lowers
+ * scaling_max_freq): both are unknown off Linux or without these. The
+ * latency headroom is from the mean of the "VioBackend Latency [ms]" samples
+ * of the period, unknown if there are none.
+ */
+class ExecutionProfileMonitor {
+ public:
+  KIMERA_POINTER_TYPEDEFS(ExecutionProfileMonitor);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(ExecutionProfileMonitor);
+  using SwitchCallback = std::function<void(const ExecutionProfileType&)>;
+
+  ExecutionProfileMonitor(const ExecutionProfileMonitorParams& params,
+                          const ExecutionProfileType& initial_profile,
+                          const SwitchCallback& switch_callback);
+  ~ExecutionProfileMonitor();
+
+  //! Restarts from the given profile, switched by hand: thread-safe, does
+  //! not call the switch callback.
+  void reset(const ExecutionProfileType& profile);
+
+  //! NaN if unknown.
+  static double readMaxTemperatureC();
+  static double readMinFrequencyRatio();
+
+ private:
+  void run();
+
+  //! From the latency samples since the previous reading.
+  double measureLatencyHeadroom();
+
+ private:
+  const ExecutionProfileMonitorParams params_;
+  const SwitchCallback switch_callback_;
+  std::mutex mutex_;
+  std::condition_variable shutdown_cond_;
+  bool shutdown_;
+  ExecutionProfileGovernor governor_;
+  //! Of the latency statistic at the previous reading.
+  size_t last_nr_latency_samples_;
+  double last_latency_total_ms_;
+  std::thread thread_;
+};
+
+}  // namespace VIO
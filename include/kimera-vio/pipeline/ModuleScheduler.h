@@ -0,0 +1,134 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ModuleScheduler.h
+ * @brief  Runs pipeline modules as tasks on a shared pool of worker threads,
+ * instead of one thread per module.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "kimera-vio/pipeline/PipelineModule.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+enum class ModulePriority {
+  //! Always has a worker available (e.g. Frontend, Backend).
+  kCritical = 0,
+  //! Shares the remaining workers (e.g. Mesher, LCD, Visualizer).
+  kBackground = 1,
+};
+
+/**
+ * @brief The ModuleScheduler class runs pipeline modules on a fixed pool of
+ * worker threads. A module is scheduled as soon as it has work (i.e. its
+ * input queues are not empty), and each scheduled task runs exactly one
+ * iteration of the module's spin. Hence, the modules must be constructed in
+ * sequential mode (parallel_run = false), so that their spin pops without
+ * blocking and returns after one iteration.
+ *
+ * Scheduling rules:
+ * - A module is never run by two workers at the same time (modules are not
+ *   reentrant, and this preserves the order of their payloads).
+ * - Critical modules are picked before background modules, in the order they
+ *   were added.
+ * - Background modules never occupy more than
+ *   nr_workers - nr_critical_modules workers, so that the critical modules
+ *   are never blocked by the background ones.
+ *
+ * Workers sleep when no module has work. They are woken up when a module is
+ * done (its output is typically the input of another module), or when new
+ * data is pushed from outside the pool (see notify()). As a safety net for
+ * queues filled elsewhere, idle workers also poll every idle_poll_period.
+ *
+ * Modules can also be added and removed while the workers run, so that
+ * several pipelines share one scheduler (see PipelineContext). If there are
+ * then more critical modules than workers, one worker is still left to the
+ * background modules.
+ */
+class ModuleScheduler {
+ public:
+  KIMERA_POINTER_TYPEDEFS(ModuleScheduler);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(ModuleScheduler);
+
+  ModuleScheduler(const size_t& nr_workers,
+                  const std::chrono::milliseconds& idle_poll_period =
+                      std::chrono::milliseconds(5));
+  ~ModuleScheduler();
+
+ public:
+  //! Modules must outlive the scheduler, or be removed before destruction.
+  void addModule(PipelineModuleBase* module,
+                 const ModulePriority& priority,
+                 const std::string& name);
+
+  //! Stops scheduling the module, and waits until no worker is running it.
+  void removeModule(PipelineModuleBase* module);
+
+  //! Launches the worker threads.
+  void start();
+
+  //! Wakes up idle workers, to be called when pushing data from outside.
+  void notify();
+
+  //! Stops scheduling new tasks, running tasks are finished.
+  void shutdown();
+
+  //! Joins the worker threads (call shutdown first).
+  void join();
+
+  inline size_t getNrWorkers() const { return nr_workers_; }
+
+  std::string printStats() const;
+
+ private:
+  struct ScheduledModule {
+    PipelineModuleBase* module = nullptr;
+    ModulePriority priority = ModulePriority::kBackground;
+    std::string name;
+    //! True while a worker is running it.
+    bool is_running = false;
+    //! True once its spin returned false (module shutdown), or removed.
+    bool is_done = false;
+    size_t nr_runs = 0u;
+  };
+
+  void workerLoop();
+
+  //! Returns next module to run, or nullptr if none. Requires mutex_.
+  ScheduledModule* pickModule();
+
+ private:
+  const size_t nr_workers_;
+  const std::chrono::milliseconds idle_poll_period_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable work_cv_;
+  //! A list, so that workers can run a module while others are added.
+  std::list<ScheduledModule> modules_;
+  size_t nr_critical_modules_;
+  size_t nr_running_background_;
+  bool shutdown_;
+
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace VIO
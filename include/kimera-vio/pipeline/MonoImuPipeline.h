@@ -30,7 +30,8 @@ class MonoImuPipeline : public Pipeline {
   MonoImuPipeline(const VioParams& params,
                   Visualizer3D::UniquePtr&& visualizer = nullptr,
                   DisplayBase::UniquePtr&& displayer = nullptr,
-                  PreloadedVocab::Ptr&& preloaded_vocab = nullptr);
+                  PreloadedVocab::Ptr&& preloaded_vocab = nullptr,
+                  PipelineContext::Ptr context = nullptr);
 
   ~MonoImuPipeline() = default;
 
@@ -16,6 +16,8 @@
 
 #include <gflags/gflags.h>
 
+#include <vector>
+
 #include "kimera-vio/backend/RegularVioBackendParams.h"
 #include "kimera-vio/backend/VioBackend-definitions.h"
 #include "kimera-vio/backend/VioBackendParams.h"
@@ -25,6 +27,7 @@
 #include "kimera-vio/frontend/VisionImuFrontendParams.h"
 #include "kimera-vio/imu-frontend/ImuFrontendParams.h"
 #include "kimera-vio/loopclosure/LoopClosureDetectorParams.h"
+#include "kimera-vio/pipeline/ExecutionProfile.h"
 #include "kimera-vio/visualizer/DisplayParams.h"
 
 DECLARE_bool(use_external_odometry);
@@ -151,6 +154,15 @@ struct VioParams : public PipelineParams {
   DisplayType display_type_;
   std::optional<OdometryParams> odom_params_;
   bool parallel_run_;
+  //! Threading (optional keys of the pipeline params, parallel mode only).
+  //! Max number of threads of GTSAM's TBB scheduler, 0 for TBB's default.
+  int backend_nr_threads_;
+  //! CPUs the frontend and backend threads are pinned to, any if empty.
+  //! GTSAM's TBB workers are pinned to the backend CPUs.
+  std::vector<int> frontend_cpus_;
+  std::vector<int> backend_cpus_;
+  //! Execution profiles (optional keys of the pipeline params).
+  ExecutionProfileParams execution_profile_params_;
 
  protected:
   //! Helper function to parse camera params.
@@ -167,7 +179,11 @@ struct VioParams : public PipelineParams {
            display_type_ == rhs.display_type_ &&
            lcd_params_ == rhs.lcd_params_ &&
            display_params_ == rhs.display_params_ &&
-           parallel_run_ == rhs.parallel_run_;
+           parallel_run_ == rhs.parallel_run_ &&
+           backend_nr_threads_ == rhs.backend_nr_threads_ &&
+           frontend_cpus_ == rhs.frontend_cpus_ &&
+           backend_cpus_ == rhs.backend_cpus_ &&
+           execution_profile_params_ == rhs.execution_profile_params_;
   }
 
   //! Names of the YAML files with the parameters.
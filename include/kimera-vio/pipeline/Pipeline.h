@@ -20,18 +20,36 @@
 
 #include <atomic>
 #include <cstdlib>  // for srand()
+#include <future>
 #include <memory>
+#include <mutex>
 #include <thread>
 #include <vector>
 
 #include "kimera-vio/backend/VioBackend-definitions.h"
 #include "kimera-vio/backend/VioBackendModule.h"
+#include "kimera-vio/common/PoseHistory.h"
 #include "kimera-vio/common/VioNavState.h"
 #include "kimera-vio/dataprovider/MonoDataProviderModule.h"
 #include "kimera-vio/frontend/VisionImuFrontendModule.h"
+#include "kimera-vio/imu-frontend/ImuPropagator.h"
+#include "kimera-vio/logging/TrajectoryEvaluator.h"
 #include "kimera-vio/loopclosure/LcdModule.h"
 #include "kimera-vio/mesh/MesherModule.h"
+#include "kimera-vio/pipeline/AdmissionController.h"
+#include "kimera-vio/pipeline/ExecutionProfile.h"
+#include "kimera-vio/pipeline/ModuleScheduler.h"
+#include "kimera-vio/pipeline/PipelineCheckpoint.h"
+#include "kimera-vio/pipeline/PipelineContext.h"
+#include "kimera-vio/pipeline/PipelineRecording.h"
+#include "kimera-vio/pipeline/ReplayScheduler.h"
+#include "kimera-vio/pipeline/SharedMemoryOutput.h"
+#include "kimera-vio/utils/MemoryAccounting.h"
+#include "kimera-vio/utils/MetricsExporter.h"
+#include "kimera-vio/utils/Threading.h"
 #include "kimera-vio/utils/ThreadsafeQueue.h"
+#include "kimera-vio/utils/ThreadsafeSpscQueue.h"
+#include "kimera-vio/utils/Tracing.h"
 #include "kimera-vio/visualizer/Display.h"
 #include "kimera-vio/visualizer/DisplayModule.h"
 #include "kimera-vio/visualizer/Visualizer3D.h"
@@ -45,6 +63,14 @@ DECLARE_int32(viz_type);
 DECLARE_bool(deterministic_random_number_generator);
 DECLARE_int32(min_num_obs_for_mesher_points);
 DECLARE_bool(use_lcd);
+DECLARE_bool(parallel_startup);
+DECLARE_bool(deterministic_replay);
+DECLARE_bool(use_imu_propagator);
+DECLARE_string(checkpoint_path);
+DECLARE_bool(resume_from_checkpoint);
+DECLARE_double(checkpoint_max_age_s);
+DECLARE_string(trace_output_file);
+DECLARE_string(record_pipeline_inputs_path);
 
 namespace VIO {
 
@@ -55,7 +81,12 @@ class Pipeline {
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
  public:
-  Pipeline(const VioParams& params);
+  /**
+   * @param context Optional resources shared with the other pipelines of the
+   * process: its module scheduler, if any, then runs the modules of this
+   * pipeline instead of the use_module_scheduler flag.
+   */
+  Pipeline(const VioParams& params, PipelineContext::Ptr context = nullptr);
 
   virtual ~Pipeline();
 
@@ -74,14 +105,24 @@ class Pipeline {
         std::move(left_frame));
   }
 
+  /**
+   * @brief fillLeftFrameQueueWithBackpressure Callback for dataset providers
+   * replaying as fast as the pipeline can absorb the data: blocks until the
+   * replay scheduler grants a frame credit (see ReplayScheduler). Falls back
+   * to fillLeftFrameQueueBlockingIfFull if deterministic_replay is disabled.
+   */
+  void fillLeftFrameQueueWithBackpressure(Frame::UniquePtr left_frame);
+
   inline void fillSingleImuQueue(const ImuMeasurement& imu_measurement) {
     CHECK(data_provider_module_);
     data_provider_module_->fillImuQueue(imu_measurement);
+    if (imu_propagator_) imu_propagator_->fillImuQueue(imu_measurement);
   }
 
   inline void fillMultiImuQueue(const ImuMeasurements& imu_measurements) {
     CHECK(data_provider_module_);
     data_provider_module_->fillImuQueue(imu_measurements);
+    if (imu_propagator_) imu_propagator_->fillImuQueue(imu_measurements);
   }
 
   inline void fillExternalOdomQueue(
@@ -90,8 +131,29 @@ class Pipeline {
     data_provider_module_->fillExternalOdometryQueue(odom_measurement);
   }
 
+  /**
+   * @brief registerPropagatedStateCallback Callback called with the latest
+   * Backend state propagated to each IMU measurement (requires the
+   * use_imu_propagator flag).
+   */
+  inline void registerPropagatedStateCallback(
+      const ImuPropagator::PropagatedStateCallback& callback) {
+    if (imu_propagator_) {
+      imu_propagator_->registerPropagatedStateCallback(callback);
+    } else {
+      LOG(WARNING) << "Attempt to register IMU-rate state callback, but the "
+                   << "IMU propagator is not enabled (use_imu_propagator).";
+    }
+  }
+
   inline LcdModule* getLcdModule() const { return lcd_module_.get(); }
 
+  /**
+   * @brief getPoseHistory Estimated poses of the body, filled by the Backend
+   * and corrected by the LCD, to query the pose at any past timestamp.
+   */
+  inline PoseHistory::Ptr getPoseHistory() const { return pose_history_; }
+
  public:
   /**
    * @brief spin Spin the whole pipeline by spinning the data provider
@@ -185,6 +247,25 @@ class Pipeline {
     }
   }
 
+  /**
+   * @brief setTrajectoryEvaluator Evaluates the Backend poses against the
+   * ground truth as they are estimated. The evaluation is logged and added to
+   * the statistics at shutdown. Must be called before spinning the pipeline.
+   */
+  void setTrajectoryEvaluator(TrajectoryEvaluator::UniquePtr evaluator);
+
+  /**
+   * @brief setExecutionProfile Switches the execution profile (see
+   * ExecutionProfileParams) while the pipeline runs: the modules use its
+   * knobs from their next inputs. If auto_execution_profile, the monitor
+   * goes on switching from this profile. Thread-safe.
+   */
+  void setExecutionProfile(const ExecutionProfileType& profile);
+
+  inline ExecutionProfileType getExecutionProfile() const {
+    return execution_profile_;
+  }
+
  protected:
   // Spin the pipeline only once.
   virtual void spinOnce(FrontendInputPacketBase::UniquePtr input);
@@ -234,9 +315,82 @@ class Pipeline {
     }
   }
 
-  /// Launch threads for each pipeline module.
+  /// Run startup work independent of the rest of the construction (e.g.
+  /// constructing the Backend, or the LCD and its vocabulary) on its own
+  /// thread if FLAGS_parallel_startup, else when its result is requested.
+  template <class Task>
+  static auto startAsync(Task&& task) {
+    return std::async(FLAGS_parallel_startup ? std::launch::async
+                                             : std::launch::deferred,
+                      std::forward<Task>(task));
+  }
+
+  /// Whether to visualize (FLAGS_visualize), if the visualizer and display
+  /// are given or were built for the display type of the params (see
+  /// KIMERA_BUILD_GUI). Headless builds only build the telemetry ones.
+  static bool shouldVisualize(const VioParams& params,
+                              const bool& has_visualizer,
+                              const bool& has_displayer);
+
+  /// Launch threads for each pipeline module, or the module scheduler.
   virtual void launchThreads();
 
+  /// Whether the Frontend, Backend, Mesher, LCD and Visualizer modules spin
+  /// in their own thread. Otherwise they run one iteration per spin, either
+  /// sequentially or as tasks of the module scheduler.
+  inline bool spinModulesInOwnThreads() const {
+    return parallel_run_ && !module_scheduler_;
+  }
+
+  /// Add the module to the module scheduler, and remember it for removal.
+  void scheduleModule(PipelineModuleBase* module,
+                      const ModulePriority& priority,
+                      const std::string& name);
+
+  /// Remove the modules of this pipeline from the (shared) module scheduler.
+  void removeScheduledModules();
+
+  /// Pin the Frontend and Backend threads to their CPUs, if any.
+  void setThreadsAffinity();
+
+  /// Log the effective threading configuration of the pipeline.
+  void logThreadingConfig() const;
+
+  /// Signal the replay scheduler when frames are done (keyframes are done
+  /// once the Backend processed them). Registered after all other callbacks.
+  void registerReplaySchedulerCallbacks();
+
+  /// Reset the IMU propagator with each Backend output.
+  void registerImuPropagatorCallbacks();
+
+  /// Seed the Backend with the checkpoint at FLAGS_checkpoint_path, if
+  /// FLAGS_resume_from_checkpoint, and save a checkpoint at each Backend
+  /// output, in the thread of checkpoint_writer_.
+  void setupCheckpointing();
+
+  /// Record the inputs of the Backend, Mesher and LCD modules to
+  /// FLAGS_record_pipeline_inputs_path.
+  void setupRecording();
+
+  /// Declare the Mesher, LCD, Visualizer and Display modules as optional,
+  /// shedding load when the Frontend or Backend input queues back up.
+  void setupAdmissionControl();
+
+  /// Apply the initial execution profile, and start the monitor switching
+  /// profiles if auto_execution_profile.
+  void setupExecutionProfiles();
+
+  /// Set the knobs of the modules to the given execution profile.
+  void applyExecutionProfile(const ExecutionProfileType& profile);
+
+  /// Publish the Backend, LCD and Mesher outputs to the shared memory region
+  /// FLAGS_shared_memory_output, for readers in other processes.
+  void setupSharedMemoryOutput();
+
+  /// Fill the pose history with the Backend outputs, and correct it with the
+  /// LCD outputs.
+  void registerPoseHistoryCallbacks();
+
   /// Shutdown processes and queues.
   virtual void stopThreads();
 
@@ -254,10 +408,33 @@ class Pipeline {
   FrontendParams frontend_params_;
   ImuParams imu_params_;
   bool parallel_run_;
+  std::vector<int> frontend_cpus_;
+  std::vector<int> backend_cpus_;
+  int backend_nr_threads_;
+  ExecutionProfileParams execution_profile_params_;
+
+  //! Limits and pins GTSAM's worker threads for the pipeline's lifetime.
+  utils::GtsamThreadingControl::UniquePtr gtsam_threading_control_;
 
   //! Shutdown switch to stop pipeline, threads, and queues.
   std::atomic_bool shutdown_ = {false};
 
+  //! Records the modules' inputs if enabled, nullptr otw. Declared before the
+  //! modules so that it outlives their callbacks.
+  PipelineRecorder::UniquePtr recorder_;
+  //! Saves the checkpoints if enabled, nullptr otw. Declared before the
+  //! modules so that it outlives their callbacks.
+  PipelineCheckpointWriter::UniquePtr checkpoint_writer_;
+  //! Publishes the outputs to shared memory if enabled, nullptr otw. Declared
+  //! before the modules so that it outlives their callbacks.
+  SharedMemoryOutput::UniquePtr shared_memory_output_;
+  //! Shared with the consumers of the poses, declared before the modules so
+  //! that it outlives their callbacks.
+  PoseHistory::Ptr pose_history_;
+  //! Evaluates the Backend poses if set, nullptr otw. Declared before the
+  //! modules so that it outlives their callbacks.
+  TrajectoryEvaluator::UniquePtr trajectory_evaluator_;
+
   // Pipeline Modules
   // TODO(Toni) this should go to another class to avoid not having copy-ctor...
   //! Frontend.
@@ -267,13 +444,13 @@ class Pipeline {
   VisionImuFrontendModule::UniquePtr vio_frontend_module_;
 
   //! Vision Frontend payloads.
-  VisionImuFrontendModule::InputQueue frontend_input_queue_;
+  VisionImuFrontendModule::InputQueueBase::UniquePtr frontend_input_queue_;
 
   //! Backend
   VioBackendModule::UniquePtr vio_backend_module_;
 
   //! Thread-safe queue for the Backend.
-  VioBackendModule::InputQueue backend_input_queue_;
+  VioBackendModule::InputQueueBase::UniquePtr backend_input_queue_;
 
   //! Mesher
   MesherModule::UniquePtr mesher_module_;
@@ -284,8 +461,40 @@ class Pipeline {
   //! Visualizer: builds images to be displayed
   VisualizerModule::UniquePtr visualizer_module_;
 
-  //! Thread-safe queue for the input to the display module
-  DisplayModule::InputQueue display_input_queue_;
+  //! Paces the data providers in deterministic replay mode, nullptr otw.
+  ReplayScheduler::UniquePtr replay_scheduler_;
+
+  //! Sheds the inputs of the optional modules if enabled, nullptr otw.
+  AdmissionController::Ptr admission_controller_;
+
+  //! Shared with the other pipelines of the process, nullptr otw.
+  PipelineContext::Ptr context_;
+
+  //! Runs the modules on a shared pool of workers if enabled, nullptr otw.
+  //! Owned by the context if shared with the other pipelines.
+  ModuleScheduler::Ptr module_scheduler_;
+  bool owns_module_scheduler_;
+  //! Modules of this pipeline added to the module scheduler.
+  std::vector<PipelineModuleBase*> scheduled_modules_;
+
+  //! Outputs the Backend state propagated at IMU rate if enabled, nullptr otw.
+  ImuPropagator::UniquePtr imu_propagator_;
+
+  //! Logs the memory report periodically if enabled, nullptr otw.
+  utils::MemoryReporter::UniquePtr memory_reporter_;
+
+  //! Serves the live statistics if the metrics_port flag is set, nullptr otw.
+  utils::MetricsExporter::UniquePtr metrics_exporter_;
+
+  //! Serializes the switches of execution profile.
+  std::mutex execution_profile_mutex_;
+  std::atomic<ExecutionProfileType> execution_profile_;
+  //! Switches the execution profile if auto_execution_profile, nullptr otw.
+  ExecutionProfileMonitor::UniquePtr execution_profile_monitor_;
+
+  //! Thread-safe queue for the input to the display module: only keeps the
+  //! latest input, merged with the skipped ones, if the display lags behind.
+  DisplayModule::InputMailbox display_input_queue_;
 
   //! Displays actual images and 3D visualization
   DisplayModule::UniquePtr display_module_;
@@ -297,7 +506,7 @@ class Pipeline {
   //! Callback called when the VIO pipeline has shut down.
   ShutdownPipelineCallback shutdown_pipeline_cb_;
 
-  // Pipeline Threads.
+  // Pipeline Threads (unused if the module scheduler is enabled).
   std::unique_ptr<std::thread> frontend_thread_ = {nullptr};
   std::unique_ptr<std::thread> backend_thread_ = {nullptr};
   std::unique_ptr<std::thread> mesher_thread_ = {nullptr};
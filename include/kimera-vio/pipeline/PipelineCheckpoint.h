@@ -0,0 +1,109 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   PipelineCheckpoint.h
+ * @brief  On-disk checkpoint of the latest Backend state, to resume the
+ * pipeline without initializing it again.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "kimera-vio/common/VioNavState.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The PipelineCheckpoint class stores the latest optimized state and
+ * IMU bias of the Backend. A pipeline resumed from it seeds its Backend with
+ * this state (instead of initializing from ground-truth or the IMU), so the
+ * first pose is output at the first keyframe, unless the checkpoint is too
+ * old for its velocity to hold (see VioBackend::setResumeState).
+ *
+ * Only the state is saved: neither the smoother's factor graph nor the LCD
+ * database and frame cache, which are rebuilt after the restart.
+ *
+ * Files are small and written atomically (to a temporary file, synced to
+ * disk, then renamed), so that a crash or a power loss while saving leaves
+ * the previous checkpoint valid.
+ */
+class PipelineCheckpoint {
+ public:
+  KIMERA_POINTER_TYPEDEFS(PipelineCheckpoint);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  PipelineCheckpoint() : state_(0, VioNavState()) {}
+  explicit PipelineCheckpoint(const VioNavStateTimestamped& state)
+      : state_(state) {}
+  ~PipelineCheckpoint() = default;
+
+ public:
+  //! Returns false if the file could not be written.
+  bool save(const std::string& filepath) const;
+
+  //! Returns false, leaving checkpoint untouched, if the file is missing or
+  //! is not a valid checkpoint.
+  static bool load(const std::string& filepath,
+                   PipelineCheckpoint* checkpoint);
+
+ public:
+  //! Latest Backend state (W_State_Blkf_), with its timestamp.
+  VioNavStateTimestamped state_;
+};
+
+/**
+ * @brief The PipelineCheckpointWriter class saves the checkpoints in its own
+ * thread, so that the Backend does not wait for the disk: a state written
+ * while the previous one is being saved replaces the one pending, only the
+ * latest one is worth saving.
+ */
+class PipelineCheckpointWriter {
+ public:
+  KIMERA_POINTER_TYPEDEFS(PipelineCheckpointWriter);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(PipelineCheckpointWriter);
+
+  explicit PipelineCheckpointWriter(const std::string& filepath);
+  //! Saves the pending checkpoint, if any.
+  ~PipelineCheckpointWriter();
+
+ public:
+  //! Thread-safe, does not block on the disk.
+  void write(const VioNavStateTimestamped& state);
+
+  //! Blocks until the pending checkpoint, if any, is saved.
+  void flush();
+
+  //! Nr of checkpoints replaced before being saved.
+  inline size_t getNrSkipped() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return nr_skipped_;
+  }
+
+ private:
+  void writerLoop();
+
+ private:
+  const std::string filepath_;
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::optional<VioNavStateTimestamped> pending_state_;
+  bool is_saving_ = false;
+  bool shutdown_ = false;
+  size_t nr_skipped_ = 0u;
+  std::thread writer_thread_;
+};
+
+}  // namespace VIO
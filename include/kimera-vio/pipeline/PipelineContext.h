@@ -0,0 +1,70 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   PipelineContext.h
+ * @brief  Read-only resources shared by the pipelines of a process.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+
+#include "kimera-vio/loopclosure/LoopClosureDetector.h"
+#include "kimera-vio/pipeline/ModuleScheduler.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The PipelineContext class holds what several pipelines running in
+ * the same process (e.g. one per dataset) can share instead of duplicating:
+ * - the ORB vocabulary of the loop closure detectors, loaded once at the
+ *   first request and never modified afterwards,
+ * - the matrices of the startup cache (e.g. rectification maps), shared in
+ *   memory even without a cache file (see StartupCache::shareInMemory),
+ * - optionally, one ModuleScheduler running the modules of all pipelines on
+ *   a single pool of workers, instead of one pool (or threads) per pipeline.
+ *
+ * Parameters are parsed by the caller and passed to each pipeline, so one
+ * VioParams can be parsed once and copied for all of them.
+ *
+ * Must outlive the pipelines using it.
+ */
+class PipelineContext {
+ public:
+  KIMERA_POINTER_TYPEDEFS(PipelineContext);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(PipelineContext);
+
+  /**
+   * @param nr_scheduler_workers Workers of the shared module scheduler, or 0
+   * for pipelines to run their modules themselves (see the
+   * use_module_scheduler flag).
+   */
+  explicit PipelineContext(const size_t& nr_scheduler_workers = 0u);
+  ~PipelineContext();
+
+  //! Vocabulary shared with the other pipelines, loaded at the first call.
+  PreloadedVocab::Ptr getPreloadedVocab();
+
+  //! Shared module scheduler, already started, or nullptr if disabled.
+  inline ModuleScheduler::Ptr getModuleScheduler() const {
+    return module_scheduler_;
+  }
+
+ private:
+  std::mutex vocab_mutex_;
+  std::shared_ptr<const OrbVocabulary> vocab_;
+
+  ModuleScheduler::Ptr module_scheduler_;
+};
+
+}  // namespace VIO
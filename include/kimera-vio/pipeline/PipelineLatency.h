@@ -0,0 +1,76 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   PipelineLatency.h
+ * @brief  Per-frame latency of the pipeline modules: queue wait, compute, and
+ * end-to-end latency since the frame entered the pipeline.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include "kimera-vio/common/vio_types.h"
+
+namespace VIO {
+
+/**
+ * @brief The PipelineLatency class accounts the latency of each frame through
+ * the pipeline modules. Frames are identified by the timestamp of their
+ * payloads, which every module keeps (see QueueSynchronizer). For each
+ * module, and each frame it processes, it adds samples to the Statistics:
+ * - "<module> Queue Wait [ms]": from the creation of the input payload (when
+ *   pushed by the upstream module) until the module starts processing it.
+ * - "<module> Compute [ms]": spinOnce, including pushing the output.
+ * - "<module> Latency [ms]": from the frame entering the pipeline
+ *   (recordPipelineIngress) until the module output is pushed.
+ */
+class PipelineLatency {
+ public:
+  using TimePoint = std::chrono::high_resolution_clock::time_point;
+
+  //! Frames in flight remembered, the oldest are forgotten first.
+  static constexpr size_t kMaxFramesInFlight = 1000u;
+
+  //! The frame with the given timestamp enters the pipeline now.
+  static void recordPipelineIngress(const Timestamp& timestamp);
+
+  /**
+   * @brief recordModule Adds the latency samples of a module for a frame.
+   * @param input_creation Creation time of the input payload.
+   * @param ingress When the module started processing the input.
+   * @param egress When the module pushed its output.
+   */
+  static void recordModule(const std::string& module_name,
+                           const Timestamp& timestamp,
+                           const TimePoint& input_creation,
+                           const TimePoint& ingress,
+                           const TimePoint& egress);
+
+  //! Table with the p50/p95/p99 of queue wait, compute and latency, per
+  //! module. Empty if nothing was recorded.
+  static std::string print();
+
+  //! Forgets the frames in flight and the modules (not their Statistics).
+  static void reset();
+
+ private:
+  static PipelineLatency& instance();
+
+  std::mutex mutex_;
+  std::map<Timestamp, TimePoint> pipeline_ingress_;
+  std::set<std::string> module_names_;
+};
+
+}  // namespace VIO
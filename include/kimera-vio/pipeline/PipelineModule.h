@@ -15,24 +15,49 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <functional>  // for function
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <utility>  // for move
 #include <vector>
 
 #include <glog/logging.h>
 
 #include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/pipeline/AdmissionController.h"
+#include "kimera-vio/pipeline/PipelineLatency.h"
 #include "kimera-vio/pipeline/PipelinePayload.h"
 #include "kimera-vio/pipeline/QueueSynchronizer.h"
+#include "kimera-vio/utils/AllocationTracker.h"
 #include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/PerfCounters.h"
 #include "kimera-vio/utils/Statistics.h"
 #include "kimera-vio/utils/ThreadsafeQueue.h"
+#include "kimera-vio/utils/ThreadsafeRendezvousBuffer.h"
 #include "kimera-vio/utils/Timer.h"
+#include "kimera-vio/utils/Tracing.h"
 
 namespace VIO {
 
+namespace internal {
+//! Inputs that are pipeline payloads have a timestamp, which correlates the
+//! spans and latencies of the same frame across modules.
+template <typename T>
+typename std::enable_if<std::is_base_of<PipelinePayload, T>::value,
+                        const PipelinePayload*>::type
+asPipelinePayload(const T& payload) {
+  return &payload;
+}
+template <typename T>
+typename std::enable_if<!std::is_base_of<PipelinePayload, T>::value,
+                        const PipelinePayload*>::type
+asPipelinePayload(const T&) {
+  return nullptr;
+}
+}  // namespace internal
+
 /**
  * @brief Abstraction of a pipeline module. Contains non-templated members.
  *
@@ -53,7 +78,9 @@ class PipelineModuleBase {
    * @param
    */
   PipelineModuleBase(const std::string& name_id, const bool& parallel_run)
-      : name_id_(name_id), parallel_run_(parallel_run) {}
+      : name_id_(name_id),
+        parallel_run_(parallel_run),
+        trace_name_(utils::Tracer::internName(name_id)) {}
 
   virtual ~PipelineModuleBase() = default;
 
@@ -93,7 +120,49 @@ class PipelineModuleBase {
     on_failure_callbacks_.push_back(callback);
   }
 
+  /**
+   * @brief setAdmissionController Declares the module as optional: it then
+   * skips the inputs the controller does not admit, to leave the CPU to the
+   * critical path. Call before the module starts spinning.
+   */
+  void setAdmissionController(
+      const AdmissionController::Ptr& admission_controller,
+      const OptionalModuleBudget& budget) {
+    CHECK(admission_controller);
+    admission_controller_ = admission_controller;
+    admission_id_ =
+        admission_controller_->registerOptionalModule(name_id_, budget);
+  }
+
+  /**
+   * @brief setInputDecimation The module processes one input out of this
+   * many (1 for all of them), before admission control. Can be called while
+   * the module spins (e.g. when switching execution profiles).
+   */
+  inline void setInputDecimation(const size_t& decimation) {
+    CHECK_GT(decimation, 0u);
+    input_decimation_ = decimation;
+  }
+
  protected:
+  /**
+   * @brief admitInput Whether to process the input just received: always for
+   * the modules that are not optional or decimated. Optional modules whose
+   * inputs cannot be skipped (e.g. the loop closure's odometry chain)
+   * override it, and shed part of their work instead.
+   */
+  virtual bool admitInput() {
+    return isKeptByInputDecimation() &&
+           (!admission_controller_ ||
+            admission_controller_->admit(admission_id_));
+  }
+
+  //! Counts the inputs: whether this one is kept by the input decimation.
+  inline bool isKeptByInputDecimation() {
+    const size_t decimation = input_decimation_;
+    return decimation <= 1u || nr_decimated_inputs_++ % decimation == 0u;
+  }
+
   // TODO(Toni) Pass the specific queue synchronizer at the ctor level
   // (kind of like visitor pattern), and use the queue synchronizer base class.
   /**
@@ -102,13 +171,31 @@ class PipelineModuleBase {
    */
   template <class T>
   bool syncQueue(const Timestamp& timestamp,
-                 ThreadsafeQueue<T>* queue,
+                 ThreadsafeQueueBase<T>* queue,
                  T* pipeline_payload,
                  int max_iterations = 10,
                  size_t timeout_ms = 10000u) {
     return SimpleQueueSynchronizer<T>::getInstance().syncQueue(
         timestamp, queue, pipeline_payload, name_id_, max_iterations, timeout_ms);
   }
+
+  /**
+   * @brief Gets the payload at the given timestamp from a rendezvous buffer,
+   * waiting for it to be pushed if the module runs in its own thread.
+   */
+  template <class T>
+  typename ThreadsafeRendezvousBuffer<T>::QueryResult syncBuffer(
+      const Timestamp& timestamp,
+      ThreadsafeRendezvousBuffer<T>* buffer,
+      T* pipeline_payload,
+      const std::chrono::milliseconds& timeout =
+          std::chrono::milliseconds(10000)) {
+    CHECK_NOTNULL(buffer);
+    return parallel_run_
+               ? buffer->popBlockingWithTimeout(
+                     timestamp, pipeline_payload, timeout)
+               : buffer->pop(timestamp, pipeline_payload);
+  }
   /**
    * @brief shutdownQueues If the module stores Threadsafe queues, it must
    * shutdown those for a complete shutdown.
@@ -132,10 +219,21 @@ class PipelineModuleBase {
   //! Properties
   std::string name_id_ = {"PipelineModule"};
   bool parallel_run_ = {true};
+  //! Name of the spans of spinOnce in the trace.
+  const char* trace_name_;
 
   //! Callbacks to be called in case module does not return an output.
   std::vector<OnFailureCallback> on_failure_callbacks_;
 
+  //! Null unless the module is optional.
+  AdmissionController::Ptr admission_controller_ = {nullptr};
+  size_t admission_id_ = {0u};
+
+  //! See setInputDecimation.
+  std::atomic<size_t> input_decimation_ = {1u};
+  //! Only used by the thread of the module.
+  size_t nr_decimated_inputs_ = {0u};
+
   //! Thread related members.
   std::atomic_bool shutdown_ = {false};
   std::atomic_bool is_thread_working_ = {false};
@@ -165,6 +263,8 @@ class PipelineModule : public PipelineModuleBase {
   //! The output is instead a shared ptr, since many users might need the output
   using OutputUniquePtr = std::unique_ptr<Output>;
   using OutputSharedPtr = std::shared_ptr<Output>;
+  //! Callback used to observe the inputs, e.g. to record them.
+  using InputCallback = std::function<void(const Input& input)>;
 
   /**
    * @brief PipelineModule
@@ -173,10 +273,21 @@ class PipelineModule : public PipelineModuleBase {
    * does only one call to spinOnce and returns).
    */
   PipelineModule(const std::string& name_id, const bool& parallel_run)
-      : PipelineModuleBase(name_id, parallel_run) {}
+      : PipelineModuleBase(name_id, parallel_run), input_callbacks_() {}
 
   virtual ~PipelineModule() { VLOG(1) << name_id_ + " destructor called."; }
 
+  /**
+   * @brief registerInputCallback Add an extra input callback to the list of
+   * callbacks. This will be called in the module's thread with every input,
+   * right before the module processes it.
+   * @param input_callback actual callback to register.
+   */
+  void registerInputCallback(const InputCallback& input_callback) {
+    CHECK(input_callback);
+    input_callbacks_.push_back(input_callback);
+  }
+
   /**
    * @brief Main spin function. Every pipeline module calls this spin, where
    * the input is taken from an input queue and processed into an output packet
@@ -190,13 +301,31 @@ class PipelineModule : public PipelineModuleBase {
   bool spin() override {
     VLOG_IF(1, parallel_run_) << "Module: " << name_id_ << " - Spinning.";
     utils::StatsCollector timing_stats(name_id_ + " [ms]");
+    utils::PerfCounterStats perf_stats(name_id_);
+    if (parallel_run_) utils::Tracer::setCurrentThreadName(name_id_);
     while (!shutdown_) {
       // Get input data from queue by waiting for payload.
       is_thread_working_ = false;
       InputUniquePtr input = getInputPacket();
       is_thread_working_ = true;
-      if (input) {
+      if (input && !admitInput()) {
+        // Shed to leave the CPU to the critical path: drop the input.
+        VLOG(2) << "Module: " << name_id_ << " - Input not admitted.";
+      } else if (input) {
         auto tic = utils::Timer::tic();
+        const PipelinePayload* input_payload =
+            internal::asPipelinePayload(*input);
+        const bool has_timestamp = input_payload != nullptr;
+        const Timestamp timestamp =
+            has_timestamp ? input_payload->timestamp_ : Timestamp();
+        const auto input_creation_time =
+            has_timestamp ? input_payload->creation_time_ : tic;
+        utils::TraceSpan trace_span(
+            trace_name_,
+            has_timestamp ? timestamp : utils::Tracer::kNoCorrelationId);
+        utils::PerfScope perf_scope(&perf_stats);
+        utils::AllocationScope allocation_scope(name_id_);
+        runInputCallbacks(*input);
         // Transfer the ownership of input to the actual pipeline module.
         // From this point on, you cannot use input, since spinOnce owns it.
         OutputUniquePtr output = spinOnce(std::move(input));
@@ -214,6 +343,17 @@ class PipelineModule : public PipelineModuleBase {
         }
         auto spin_duration = utils::Timer::toc(tic).count();
         timing_stats.AddSample(spin_duration);
+        if (admission_controller_) {
+          admission_controller_->reportSpinDuration(admission_id_,
+                                                    spin_duration);
+        }
+        if (has_timestamp) {
+          PipelineLatency::recordModule(name_id_,
+                                        timestamp,
+                                        input_creation_time,
+                                        tic,
+                                        utils::Timer::tic());
+        }
       } else {
         // TODO(nathan) switch to VLOG_IS_ON(1) when we fix how spinning works
         LOG_IF_EVERY_N(WARNING, VLOG_IS_ON(10), 50)
@@ -272,6 +412,20 @@ class PipelineModule : public PipelineModuleBase {
    * signals that the output should not be sent to the output queue.
    */
   virtual OutputUniquePtr spinOnce(InputUniquePtr input) = 0;
+
+  /**
+   * @brief runInputCallbacks Calls the input callbacks on an input. spin
+   * calls them on the input it passes to spinOnce: only call this for inputs
+   * the module gets otherwise (e.g. drained from its queue in spinOnce).
+   */
+  void runInputCallbacks(const Input& input) const {
+    for (const InputCallback& callback : input_callbacks_) {
+      callback(input);
+    }
+  }
+
+ private:
+  std::vector<InputCallback> input_callbacks_;
 };
 
 /** @brief MIMOPipelineModule Multiple Input Multiple Output (MIMO) pipeline
@@ -363,8 +517,11 @@ class SIMOPipelineModule : public MIMOPipelineModule<Input, Output> {
 
   using PIO = PipelineModule<Input, Output>;
   using InputQueue = ThreadsafeQueue<typename PIO::InputUniquePtr>;
+  //! Any queue implementation can be used as input (e.g. a lock-free SPSC
+  //! queue when there is a single producer).
+  using InputQueueBase = ThreadsafeQueueBase<typename PIO::InputUniquePtr>;
 
-  SIMOPipelineModule(InputQueue* input_queue,
+  SIMOPipelineModule(InputQueueBase* input_queue,
                      const std::string& name_id,
                      const bool& parallel_run)
       : MIMOPipelineModule<Input, Output>(name_id, parallel_run),
@@ -411,9 +568,9 @@ class SIMOPipelineModule : public MIMOPipelineModule<Input, Output> {
     return !input_queue_->isShutdown() && !input_queue_->empty();
   }
 
- private:
+ protected:
   //! Input
-  InputQueue* input_queue_;
+  InputQueueBase* input_queue_;
 };
 
 /** @brief MISOPipelineModule Multi Input Single Output (MISO) pipeline
@@ -442,8 +599,9 @@ class MISOPipelineModule : public MIMOPipelineModule<Input, Output> {
   //! The output queue of a MISO pipeline is a unique pointer instead of a
   //! shared pointer!
   using OutputQueue = ThreadsafeQueue<typename MIMO::OutputUniquePtr>;
+  using OutputQueueBase = ThreadsafeQueueBase<typename MIMO::OutputUniquePtr>;
 
-  MISOPipelineModule(OutputQueue* output_queue,
+  MISOPipelineModule(OutputQueueBase* output_queue,
                      const std::string& name_id,
                      const bool& parallel_run)
       : MIMOPipelineModule<Input, Output>(name_id, parallel_run),
@@ -479,7 +637,7 @@ class MISOPipelineModule : public MIMOPipelineModule<Input, Output> {
 
  private:
   //! Output
-  OutputQueue* output_queue_;
+  OutputQueueBase* output_queue_;
 };
 
 // We explictly avoid using multiple inheritance (SISO is a MISO and a SIMO)
@@ -505,10 +663,12 @@ class SISOPipelineModule : public MISOPipelineModule<Input, Output> {
   using PIO = PipelineModule<Input, Output>;
   using MISO = MISOPipelineModule<Input, Output>;
   using InputQueue = ThreadsafeQueue<typename PIO::InputUniquePtr>;
+  using InputQueueBase = ThreadsafeQueueBase<typename PIO::InputUniquePtr>;
   using OutputQueue = typename MISO::OutputQueue;
+  using OutputQueueBase = typename MISO::OutputQueueBase;
 
-  SISOPipelineModule(InputQueue* input_queue,
-                     OutputQueue* output_queue,
+  SISOPipelineModule(InputQueueBase* input_queue,
+                     OutputQueueBase* output_queue,
                      const std::string& name_id,
                      const bool& parallel_run)
       : MISOPipelineModule<Input, Output>(output_queue, name_id, parallel_run),
@@ -564,7 +724,7 @@ class SISOPipelineModule : public MISOPipelineModule<Input, Output> {
 
  protected:
   //! Input
-  InputQueue* input_queue_;
+  InputQueueBase* input_queue_;
 };
 
 }  // namespace VIO
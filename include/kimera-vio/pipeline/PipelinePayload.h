@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include <chrono>
+
 #include "kimera-vio/common/vio_types.h"
 #include "kimera-vio/utils/Macros.h"
 
@@ -20,6 +22,9 @@ struct PipelinePayload {
 
   // Untouchable timestamp of the payload.
   const Timestamp timestamp_;
+  // When the payload was created: for the modules' inputs, when pushed to
+  // their queue (see PipelineLatency).
+  const std::chrono::high_resolution_clock::time_point creation_time_;
 };
 
 /**
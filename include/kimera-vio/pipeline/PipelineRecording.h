@@ -0,0 +1,126 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   PipelineRecording.h
+ * @brief  Records the inputs of the Backend, Mesher and LCD modules to a file,
+ * and reads them back, to replay these modules without the Frontend.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+#include "kimera-vio/backend/VioBackend-definitions.h"
+#include "kimera-vio/common/VioNavState.h"
+#include "kimera-vio/frontend/CameraParams.h"
+#include "kimera-vio/logging/AsyncFileWriter.h"
+#include "kimera-vio/loopclosure/LoopClosureDetector-definitions.h"
+#include "kimera-vio/mesh/Mesher-definitions.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * Layout of a recording (all values as written by the host):
+ *   magic (8 bytes), version (uint32)
+ *   records: PipelineRecordType (uint32), payload size (uint64), payload
+ * Records are in the order in which the modules processed their inputs.
+ *
+ * Everything a module uses from its input is recorded, including the PIMs,
+ * but not the parameters: the replay parses the same parameters as the
+ * recorded run (the camera params are needed to rebuild the frames). Images
+ * are only recorded for the LCD, which extracts its own features.
+ */
+static constexpr char kPipelineRecordingMagic[8] = {
+    'K', 'I', 'M', 'E', 'R', 'A', 'R', 'C'};
+static constexpr uint32_t kPipelineRecordingVersion = 1u;
+
+enum class PipelineRecordType : uint32_t {
+  //! Backend initial state (BackendParams::initial_ground_truth_state_).
+  kInitialState = 0u,
+  kBackendInput = 1u,
+  kMesherInput = 2u,
+  kLcdInput = 3u,
+};
+
+struct PipelineRecord {
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  PipelineRecordType type_ = PipelineRecordType::kInitialState;
+  //! Only the member of the type of the record is set.
+  VioNavState initial_state_;
+  BackendInput::UniquePtr backend_input_;
+  MesherInput::UniquePtr mesher_input_;
+  LcdInput::UniquePtr lcd_input_;
+};
+
+/**
+ * @brief The PipelineRecorder class appends module inputs to a recording.
+ * Records are serialized in the calling thread, and written to the file by
+ * the background thread of the AsyncFileWriter.
+ */
+class PipelineRecorder {
+ public:
+  KIMERA_POINTER_TYPEDEFS(PipelineRecorder);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(PipelineRecorder);
+
+  explicit PipelineRecorder(const std::string& filename);
+  ~PipelineRecorder() = default;
+
+ public:
+  // Thread-safe: each module records its inputs from its own thread.
+  void recordInitialState(const VioNavState& initial_state);
+  void recordBackendInput(const BackendInput& input);
+  void recordMesherInput(const MesherInput& input);
+  //! Only the inputs with a stereo Frontend output are recorded.
+  void recordLcdInput(const LcdInput& input);
+
+  //! Blocks until all the records so far are in the file.
+  void flush();
+
+ private:
+  void writeRecord(const PipelineRecordType& type, const std::string& payload);
+
+ private:
+  std::mutex mutex_;
+  AsyncFileWriter file_;
+};
+
+/**
+ * @brief The PipelineRecordingReader class reads the records of a recording,
+ * one at a time.
+ */
+class PipelineRecordingReader {
+ public:
+  KIMERA_POINTER_TYPEDEFS(PipelineRecordingReader);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(PipelineRecordingReader);
+
+  /**
+   * @brief Opens the recording and validates its header (CHECK fails if not).
+   * @param left_cam_params, right_cam_params Cameras of the recorded frames.
+   */
+  PipelineRecordingReader(const std::string& filename,
+                          const CameraParams& left_cam_params,
+                          const CameraParams& right_cam_params);
+  ~PipelineRecordingReader() = default;
+
+ public:
+  //! @return False at the end of the recording.
+  bool next(PipelineRecord* record);
+
+ private:
+  std::ifstream file_;
+  const CameraParams left_cam_params_;
+  const CameraParams right_cam_params_;
+};
+
+}  // namespace VIO
@@ -52,7 +52,7 @@ class QueueSynchronizerBase {
    * payload with an older timestamp was retrieved.
    */
   virtual bool syncQueue(const Timestamp& timestamp,
-                         ThreadsafeQueue<T>* queue,
+                         ThreadsafeQueueBase<T>* queue,
                          T* pipeline_payload,
                          std::string name_id,
                          int max_iterations = 10,
@@ -98,7 +98,7 @@ class SimpleQueueSynchronizer : public QueueSynchronizerBase<T> {
    * payload with an older timestamp was retrieved.
    */
   bool syncQueue(const Timestamp& timestamp,
-                 ThreadsafeQueue<T>* queue,
+                 ThreadsafeQueueBase<T>* queue,
                  T* pipeline_payload,
                  std::string name_id,
                  int max_iterations = 10,
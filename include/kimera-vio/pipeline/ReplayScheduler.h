@@ -0,0 +1,112 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ReplayScheduler.h
+ * @brief  Credit-based backpressure to replay datasets as fast as the
+ * pipeline can absorb them, with the same results as in sequential mode.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The ReplayScheduler class paces a dataset replay in parallel mode
+ * without sleeps nor dropped frames. It has two gates:
+ * - Frame credits, between the dataset provider and the data provider module:
+ *   the provider blocks once max_frames_in_flight frames are waiting to be
+ *   synchronized with the IMU. Credits are returned when the data provider
+ *   module forwards a frame (or drops it, which is detected when a later
+ *   frame is forwarded).
+ * - A pipeline barrier, between the data provider module and the Frontend:
+ *   a frame only enters the Frontend once the previous frame is done, i.e.
+ *   the Frontend processed it and, if it is a keyframe, the Backend too.
+ *   Since the Backend feeds back into the Frontend (IMU bias, map and state
+ *   updates), this is what keeps the results identical to sequential mode,
+ *   while the dataset provider, IMU synchronization and the downstream
+ *   modules (mesher, loop closure, visualizer) work in parallel.
+ *
+ * The results are bit-identical to sequential mode as long as the random
+ * number generators are deterministic (deterministic_random_number_generator).
+ */
+class ReplayScheduler {
+ public:
+  KIMERA_POINTER_TYPEDEFS(ReplayScheduler);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(ReplayScheduler);
+
+  //! @param max_frames_in_flight Nr of frames the dataset provider can send
+  //! ahead of the data provider module. At least 2, since the data provider
+  //! module holds back the first frame as a timing fencepost.
+  explicit ReplayScheduler(const size_t& max_frames_in_flight);
+  ~ReplayScheduler() = default;
+
+ public:
+  /**
+   * @brief acquireFrameCredit Blocks until a frame can be sent to the data
+   * provider module.
+   * @return false if the scheduler was shutdown.
+   */
+  bool acquireFrameCredit(const Timestamp& timestamp);
+
+  //! Returns the credits of all frames up to the given (forwarded) timestamp.
+  void releaseFrameCredits(const Timestamp& timestamp);
+
+  /**
+   * @brief waitForIdlePipeline Blocks until the previous frame is done, and
+   * marks the next one as being processed.
+   * @return false if the scheduler was shutdown.
+   */
+  bool waitForIdlePipeline();
+
+  //! Signals that the frame being processed is done.
+  void signalFrameDone();
+
+  //! Unblocks all waiting threads: no more frames will be scheduled.
+  void shutdown();
+
+ public:
+  inline size_t getNrFramesDone() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return nr_frames_done_;
+  }
+
+  //! Frames done per second, since the first frame entered the pipeline.
+  double getThroughput() const;
+
+  std::string printStats() const;
+
+ private:
+  const size_t max_frames_in_flight_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable credits_cv_;
+  std::condition_variable pipeline_cv_;
+
+  //! Timestamps of the frames sent but not forwarded yet.
+  std::deque<Timestamp> frames_in_flight_;
+  bool is_frame_in_pipeline_;
+  bool shutdown_;
+
+  size_t nr_frames_done_;
+  std::chrono::high_resolution_clock::time_point first_frame_time_;
+  std::chrono::high_resolution_clock::time_point last_frame_done_time_;
+};
+
+}  // namespace VIO
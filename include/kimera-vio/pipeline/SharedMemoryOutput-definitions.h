@@ -0,0 +1,143 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   SharedMemoryOutput-definitions.h
+ * @brief  Layout of the shared memory region written by SharedMemoryOutput
+ * and read by the SharedMemoryReader C API.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#include "kimera-vio/pipeline/SharedMemoryReader.h"
+
+namespace VIO {
+
+//! "KIMERASH", written last by the writer once the region is initialized.
+static constexpr uint64_t kSharedMemoryMagic = 0x4b494d4552415348u;
+//! Bump on any change of the layout.
+static constexpr uint32_t kSharedMemoryVersion = 1u;
+
+// The sequences and magic are shared between processes: they must not rely on
+// a lock of this process.
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "The shared memory output needs lock-free 64 bit atomics.");
+
+/**
+ * @brief The SeqlockSection struct starts each section of the region. The
+ * single writer makes the sequence odd while it writes the section, and even
+ * once done: readers copy the section without locking, and retry if the
+ * sequence changed meanwhile. Its own cache line, so that the readers polling
+ * it do not slow down the writer of the neighbouring data.
+ */
+struct alignas(64) SeqlockSection {
+  std::atomic<uint64_t> sequence;
+
+  //! Nr of completed writes.
+  inline uint64_t version() const {
+    return sequence.load(std::memory_order_acquire) / 2u;
+  }
+
+  inline void beginWrite() {
+    sequence.store(sequence.load(std::memory_order_relaxed) + 1u,
+                   std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  inline void endWrite() {
+    sequence.store(sequence.load(std::memory_order_relaxed) + 1u,
+                   std::memory_order_release);
+  }
+
+  /**
+   * @brief read Calls read_fn until it copied the section without the writer
+   * writing it meanwhile.
+   * @return KIMERA_SHM_NO_DATA if never written, KIMERA_SHM_BUSY if the writer
+   * kept writing, the result of read_fn otherwise.
+   */
+  template <typename ReadFn>
+  int read(const ReadFn& read_fn, const size_t& max_attempts = 64u) const {
+    for (size_t attempt = 0u; attempt < max_attempts; ++attempt) {
+      const uint64_t before = sequence.load(std::memory_order_acquire);
+      if (before == 0u) return KIMERA_SHM_NO_DATA;
+      if (before % 2u == 1u) {
+        std::this_thread::yield();
+        continue;
+      }
+      const int result = read_fn();
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (sequence.load(std::memory_order_relaxed) == before) return result;
+    }
+    return KIMERA_SHM_BUSY;
+  }
+};
+
+struct alignas(64) SharedMemoryHeader {
+  std::atomic<uint64_t> magic;
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t size;
+  uint64_t trajectory_capacity;
+  uint64_t vertices_capacity;
+  uint64_t triangles_capacity;
+  uint64_t nav_state_offset;
+  uint64_t trajectory_offset;
+  uint64_t mesh_offset;
+};
+
+struct SharedNavStateSection {
+  SeqlockSection lock;
+  kimera_shm_nav_state nav_state;
+};
+
+//! Followed by trajectory_capacity kimera_shm_pose.
+struct SharedTrajectorySection {
+  SeqlockSection lock;
+  uint64_t nr_poses;
+};
+
+//! Followed by 3 * vertices_capacity floats (x, y, z), then
+//! 3 * triangles_capacity int32_t (vertex indices).
+struct SharedMeshSection {
+  SeqlockSection lock;
+  uint64_t nr_vertices;
+  uint64_t nr_triangles;
+  uint64_t is_truncated;
+};
+
+//! Offsets of the sections for the given capacities, cache line aligned.
+struct SharedMemoryLayout {
+  SharedMemoryLayout(const uint64_t& trajectory_capacity,
+                     const uint64_t& vertices_capacity,
+                     const uint64_t& triangles_capacity)
+      : nav_state_offset(align(sizeof(SharedMemoryHeader))),
+        trajectory_offset(
+            align(nav_state_offset + sizeof(SharedNavStateSection))),
+        mesh_offset(align(trajectory_offset + sizeof(SharedTrajectorySection) +
+                          trajectory_capacity * sizeof(kimera_shm_pose))),
+        size(align(mesh_offset + sizeof(SharedMeshSection) +
+                   3u * vertices_capacity * sizeof(float) +
+                   3u * triangles_capacity * sizeof(int32_t))) {}
+
+  static inline uint64_t align(const uint64_t& offset) {
+    return (offset + 63u) / 64u * 64u;
+  }
+
+  uint64_t nav_state_offset;
+  uint64_t trajectory_offset;
+  uint64_t mesh_offset;
+  uint64_t size;
+};
+
+}  // namespace VIO
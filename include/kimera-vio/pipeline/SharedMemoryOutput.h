@@ -0,0 +1,117 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   SharedMemoryOutput.h
+ * @brief  Publishes the latest outputs of the pipeline to a shared memory
+ * region, for readers in other processes (see SharedMemoryReader.h).
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "kimera-vio/pipeline/SharedMemoryOutput-definitions.h"
+#include "kimera-vio/pipeline/SharedMemoryReader.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+struct BackendOutput;
+struct LcdOutput;
+struct MesherOutput;
+
+/**
+ * @brief The SharedMemoryOutput class owns a POSIX shared memory region where
+ * it publishes the latest navigation state (with its covariance), the
+ * optimized trajectory and the 3D mesh. Each section is protected by a
+ * seqlock: readers in other processes (planner, controller...) copy them
+ * without locks nor serialization, and see a new nav state as soon as the
+ * Backend outputs it. The region is sized for the given capacities, larger
+ * trajectories keep their latest poses and larger meshes are truncated.
+ *
+ * Thread-safe: the publish functions may be called from the modules' threads
+ * (each section has a single writer at a time). The region is unlinked on
+ * destruction: readers keep their mapping, the next writer creates a new one.
+ */
+class SharedMemoryOutput {
+ public:
+  KIMERA_POINTER_TYPEDEFS(SharedMemoryOutput);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(SharedMemoryOutput);
+
+  //! CHECK fails if the region can not be created.
+  //! @param name POSIX shared memory name, e.g. "/kimera_vio".
+  SharedMemoryOutput(const std::string& name,
+                     const size_t& trajectory_capacity,
+                     const size_t& vertices_capacity,
+                     const size_t& triangles_capacity);
+  ~SharedMemoryOutput();
+
+  void publishNavState(const kimera_shm_nav_state& nav_state);
+
+  //! Replaces the trajectory, keeping the latest poses if it does not fit.
+  void publishTrajectory(const std::vector<kimera_shm_pose>& poses);
+
+  //! Appends a pose to the trajectory.
+  void appendTrajectoryPose(const kimera_shm_pose& pose);
+
+  //! @param vertices x, y, z of each vertex.
+  //! @param triangles 3 vertex indices per triangle.
+  void publishMesh(const float* vertices,
+                   const size_t& nr_vertices,
+                   const int32_t* triangles,
+                   const size_t& nr_triangles);
+
+ public:
+  //! Nav state, and the keyframe pose until the LCD publishes its trajectory.
+  //! Register it with the BackendOutputFields::state_covariance_.
+  void publishBackendOutput(const BackendOutput& output);
+  //! Optimized trajectory of the pose graph, applying the poses updated by
+  //! each output (see LcdOutput::states_).
+  void publishLcdOutput(const LcdOutput& output);
+  void publishMesherOutput(const MesherOutput& output);
+
+  inline const std::string& getName() const { return name_; }
+
+ private:
+  //! Trajectory mutex must be locked.
+  void writeTrajectory();
+
+ private:
+  const std::string name_;
+  const SharedMemoryLayout layout_;
+  void* data_;
+
+  SharedMemoryHeader* header_;
+  SharedNavStateSection* nav_state_section_;
+  SharedTrajectorySection* trajectory_section_;
+  kimera_shm_pose* trajectory_poses_;
+  SharedMeshSection* mesh_section_;
+  float* mesh_vertices_;
+  int32_t* mesh_triangles_;
+
+  //! One writer per section at a time, readers never lock.
+  std::mutex nav_state_mutex_;
+  std::mutex trajectory_mutex_;
+  std::mutex mesh_mutex_;
+  //! Trajectory published, to append to it.
+  std::vector<kimera_shm_pose> trajectory_;
+  //! Once the LCD publishes its trajectory, the Backend does not append to it.
+  bool has_lcd_trajectory_;
+  //! Poses of the LCD trajectory by keyframe id, the outputs only give the
+  //! ones that changed.
+  std::map<size_t, kimera_shm_pose> lcd_trajectory_;
+};
+
+}  // namespace VIO
@@ -0,0 +1,129 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   SharedMemoryReader.h
+ * @brief  C API to read the outputs published by SharedMemoryOutput from
+ * another process, without serialization.
+ * @author Antoni Rosinol
+ */
+
+/*
+ * Usage, e.g. in a controller loop:
+ *
+ *   kimera_shm_reader* reader = kimera_shm_open("/kimera_vio");
+ *   uint64_t last_version = 0;
+ *   kimera_shm_nav_state nav_state;
+ *   ...
+ *   if (kimera_shm_get_version(reader, KIMERA_SHM_NAV_STATE) != last_version &&
+ *       kimera_shm_read_nav_state(reader, &nav_state) == KIMERA_SHM_OK) {
+ *     last_version = kimera_shm_get_version(reader, KIMERA_SHM_NAV_STATE);
+ *     ...
+ *   }
+ *   kimera_shm_close(reader);
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Return codes of the read functions. */
+#define KIMERA_SHM_OK 0
+/** Nothing published yet. */
+#define KIMERA_SHM_NO_DATA 1
+/** The writer kept publishing while reading: retry later. */
+#define KIMERA_SHM_BUSY 2
+/** The output buffers are too small, the sizes are set to the needed ones. */
+#define KIMERA_SHM_TOO_SMALL 3
+#define KIMERA_SHM_ERROR -1
+
+/** Largest covariance published: pose, velocity and IMU biases. */
+#define KIMERA_SHM_MAX_COVARIANCE_DIM 15
+
+/** Latest navigation state of the Backend, in the world frame. */
+typedef struct {
+  int64_t timestamp_ns;
+  uint64_t keyframe_id;
+  int32_t landmark_count;
+  /** Dimension of the covariance, 0 if not available. */
+  uint32_t covariance_dim;
+  double position[3];
+  /** qw, qx, qy, qz */
+  double orientation[4];
+  double velocity[3];
+  double acc_bias[3];
+  double gyro_bias[3];
+  /** Row-major, covariance_dim x covariance_dim. */
+  double covariance[KIMERA_SHM_MAX_COVARIANCE_DIM *
+                    KIMERA_SHM_MAX_COVARIANCE_DIM];
+} kimera_shm_nav_state;
+
+typedef struct {
+  int64_t timestamp_ns;
+  double position[3];
+  /** qw, qx, qy, qz */
+  double orientation[4];
+} kimera_shm_pose;
+
+typedef enum {
+  KIMERA_SHM_NAV_STATE = 0,
+  KIMERA_SHM_TRAJECTORY = 1,
+  KIMERA_SHM_MESH = 2,
+} kimera_shm_section;
+
+typedef struct kimera_shm_reader kimera_shm_reader;
+
+/**
+ * Maps the region published under the given name (e.g. "/kimera_vio"), read
+ * only. Returns NULL if it does not exist (yet) or is not compatible.
+ */
+kimera_shm_reader* kimera_shm_open(const char* name);
+
+void kimera_shm_close(kimera_shm_reader* reader);
+
+/**
+ * Nr of times the section was published: poll it to only read new data.
+ * Lock-free, a few nanoseconds.
+ */
+uint64_t kimera_shm_get_version(const kimera_shm_reader* reader,
+                                kimera_shm_section section);
+
+int kimera_shm_read_nav_state(const kimera_shm_reader* reader,
+                              kimera_shm_nav_state* nav_state);
+
+/**
+ * Optimized trajectory: the loop closure one if enabled, the Backend
+ * keyframes otherwise, oldest first.
+ */
+int kimera_shm_read_trajectory(const kimera_shm_reader* reader,
+                               kimera_shm_pose* poses,
+                               size_t poses_capacity,
+                               size_t* nr_poses);
+
+/**
+ * Latest 3D mesh: x, y, z of each vertex and the 3 vertex indices of each
+ * triangle (capacities in nr of vertices and triangles). *is_truncated is set
+ * if the mesh did not fit in the region, it may be NULL.
+ */
+int kimera_shm_read_mesh(const kimera_shm_reader* reader,
+                         float* vertices,
+                         size_t vertices_capacity,
+                         size_t* nr_vertices,
+                         int32_t* triangles,
+                         size_t triangles_capacity,
+                         size_t* nr_triangles,
+                         int* is_truncated);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
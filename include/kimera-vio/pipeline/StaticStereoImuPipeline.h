@@ -0,0 +1,212 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   StaticStereoImuPipeline.h
+ * @brief  Stereo VIO composed at compile time from concrete Frontend, Backend
+ * and sink types.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kimera-vio/backend/VioBackend-definitions.h"
+#include "kimera-vio/backend/VioBackend.h"
+#include "kimera-vio/frontend/StereoCamera.h"
+#include "kimera-vio/frontend/StereoImuSyncPacket.h"
+#include "kimera-vio/frontend/StereoVisionImuFrontend-definitions.h"
+#include "kimera-vio/frontend/StereoVisionImuFrontend.h"
+#include "kimera-vio/pipeline/Pipeline-definitions.h"
+#include "kimera-vio/pipeline/StereoKeyframeStep.h"
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/Statistics.h"
+#include "kimera-vio/utils/ThreadsafeSpscQueue.h"
+#include "kimera-vio/utils/Timer.h"
+
+DECLARE_bool(log_output);
+DECLARE_bool(do_fine_imu_camera_temporal_sync);
+
+namespace VIO {
+
+//! Sink of a StaticStereoImuPipeline discarding the Backend outputs.
+struct NullBackendOutputSink {
+  inline void operator()(const BackendOutput& /*backend_output*/) const {}
+};
+
+/**
+ * @brief The StaticStereoImuPipeline class runs the stereo VIO composed at
+ * compile time, instead of through the factories, the modules and the
+ * callbacks of the Pipeline:
+ * - Frontend (a StereoVisionImuFrontend) and Backend (a VioBackend, e.g.
+ *   RegularVioBackend) are held by value: the pipeline calls them directly,
+ *   and the output of the Frontend is cast statically.
+ * - Each Backend output is handed to the Sink, any type callable with a
+ *   const BackendOutput& (e.g. a lambda), called directly as well.
+ * - The input is either given to step(), in the thread of the caller, or
+ *   pushed by a producer thread to a typed single-producer single-consumer
+ *   queue, which spin() consumes.
+ *
+ * The dispatch within the Frontend and the Backend is unchanged. The Backend
+ * still updates the IMU bias and the map of the Frontend through its
+ * callbacks, registered once by the StereoKeyframeStep shared with the
+ * EmbeddedStereoImuPipeline. As for the EmbeddedStereoImuPipeline, the
+ * caller synchronizes the IMU with the frames, and the online IMU-camera time
+ * alignment is not supported. There is no Mesher, LCD or visualizer: the Sink
+ * may run them.
+ *
+ * Not thread-safe: steps must not overlap, and only one thread may push.
+ * See benchPipeline.cpp for its per-frame overhead wrt the Pipeline.
+ */
+template <typename Frontend,
+          typename Backend,
+          typename Sink = NullBackendOutputSink>
+class StaticStereoImuPipeline {
+  static_assert(std::is_base_of<StereoVisionImuFrontend, Frontend>::value,
+                "The Frontend must be a StereoVisionImuFrontend.");
+  static_assert(std::is_base_of<VioBackend, Backend>::value,
+                "The Backend must be a VioBackend.");
+
+ public:
+  KIMERA_POINTER_TYPEDEFS(StaticStereoImuPipeline);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(StaticStereoImuPipeline);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  /**
+   * @param params Vio parameters, with two cameras.
+   * @param sink Called with each Backend output, in the stepping thread.
+   * @param input_queue_capacity Max nr of packets pushed and not yet stepped.
+   */
+  StaticStereoImuPipeline(const VioParams& params,
+                          Sink sink = Sink(),
+                          const size_t& input_queue_capacity = 8u)
+      : stereo_camera_(makeStereoCamera(params)),
+        frontend_(params.frontend_params_,
+                  params.imu_params_,
+                  ImuBias(),
+                  stereo_camera_,
+                  nullptr,
+                  FLAGS_log_output,
+                  params.odom_params_),
+        backend_(stereo_camera_->getBodyPoseLeftCamRect(),
+                 stereo_camera_->getStereoCalib(),
+                 *CHECK_NOTNULL(params.backend_params_),
+                 params.imu_params_,
+                 BackendOutputParams(false, 0, false),
+                 FLAGS_log_output,
+                 params.odom_params_),
+        keyframe_step_(&frontend_, &backend_),
+        sink_(std::move(sink)),
+        input_queue_("Static Stereo Input", input_queue_capacity, false),
+        backend_failed_(false),
+        step_stats_("Static step [ms]") {
+    CHECK(!FLAGS_do_fine_imu_camera_temporal_sync)
+        << "StaticStereoImuPipeline does not support the online IMU-camera "
+           "time alignment: synchronize the IMU with the frames instead.";
+    // Only the light fields of the output are used.
+    backend_.setOutputFields(BackendOutputFields());
+  }
+  ~StaticStereoImuPipeline() = default;
+
+  /**
+   * @brief step Processes one stereo frame in the thread of the caller.
+   * @param packet The stereo frame, with the IMU measurements since the
+   * previous one.
+   * @return False if the Backend failed: the pipeline can not step anymore.
+   */
+  bool step(StereoImuSyncPacket::UniquePtr packet) {
+    CHECK(packet);
+    if (backend_failed_) return false;
+    const auto start = utils::Timer::tic();
+
+    FrontendOutputPacketBase::UniquePtr frontend_output =
+        frontend_.spinOnce(std::move(packet));
+    if (frontend_output) {
+      const StereoFrontendOutput& stereo_output =
+          StereoKeyframeStep::castOutput(*frontend_output);
+      if (stereo_output.is_keyframe_) {
+        const BackendOutput::UniquePtr backend_output =
+            keyframe_step_.spinOnce(stereo_output);
+        if (!backend_output) {
+          LOG(ERROR) << "Backend did not return an output: stopping the "
+                        "steps.";
+          backend_failed_ = true;
+          return false;
+        }
+        sink_(*backend_output);
+      }
+    }
+
+    step_stats_.AddSample(
+        static_cast<double>(
+            utils::Timer::toc<std::chrono::microseconds>(start).count()) /
+        1e3);
+    return true;
+  }
+
+  /**
+   * @brief push Queues a stereo frame for spin(), from a single producer
+   * thread. Blocks while the queue is full. A nullptr packet ends the spin
+   * once the packets before it are stepped.
+   * @return False if shutdown.
+   */
+  inline bool push(StereoImuSyncPacket::UniquePtr packet) {
+    return input_queue_.push(std::move(packet));
+  }
+
+  /**
+   * @brief spin Steps on the pushed packets, until a nullptr packet, a
+   * shutdown or a failure of the Backend.
+   * @return False if stopped by a shutdown or a failure of the Backend.
+   */
+  bool spin() {
+    StereoImuSyncPacket::UniquePtr packet;
+    while (input_queue_.popBlocking(packet)) {
+      if (!packet) return true;
+      if (!step(std::move(packet))) return false;
+    }
+    return false;
+  }
+
+  //! Stops spin() right away, dropping the packets not yet stepped.
+  inline void shutdown() { input_queue_.shutdown(); }
+
+  inline const Frontend& getFrontend() const { return frontend_; }
+  inline const Backend& getBackend() const { return backend_; }
+  inline Sink& getSink() { return sink_; }
+
+ private:
+  static StereoCamera::ConstPtr makeStereoCamera(const VioParams& params) {
+    CHECK_EQ(params.camera_params_.size(), 2u)
+        << "Need two cameras for StaticStereoImuPipeline.";
+    return std::make_shared<StereoCamera>(params.camera_params_.at(0),
+                                          params.camera_params_.at(1));
+  }
+
+ private:
+  //! Before the Frontend and the Backend, which are built from it.
+  const StereoCamera::ConstPtr stereo_camera_;
+  Frontend frontend_;
+  Backend backend_;
+  //! After the Frontend and the Backend, which it connects.
+  StereoKeyframeStep keyframe_step_;
+  Sink sink_;
+  ThreadsafeSpscQueue<StereoImuSyncPacket::UniquePtr> input_queue_;
+  bool backend_failed_;
+  utils::StatsCollector step_stats_;
+};
+
+}  // namespace VIO
@@ -32,11 +32,15 @@ class StereoImuPipeline : public Pipeline {
      * @param params Vio parameters
      * @param visualizer Optional visualizer for visualizing 3D results
      * @param displayer Optional displayer for visualizing 2D results
+     * @param preloaded_vocab Optional vocabulary for the loop closure detector
+     * @param context Optional resources shared with other pipelines, the
+     * vocabulary being taken from it if not given
      */
   StereoImuPipeline(const VioParams& params,
                     Visualizer3D::UniquePtr&& visualizer = nullptr,
                     DisplayBase::UniquePtr&& displayer = nullptr,
-                    PreloadedVocab::Ptr&& preloaded_vocab = nullptr);
+                    PreloadedVocab::Ptr&& preloaded_vocab = nullptr,
+                    PipelineContext::Ptr context = nullptr);
 
   ~StereoImuPipeline() = default;
 
@@ -0,0 +1,67 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   StereoKeyframeStep.h
+ * @brief  Step from the stereo Frontend to the Backend of the pipelines that
+ * call them directly.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include "kimera-vio/backend/VioBackend-definitions.h"
+#include "kimera-vio/backend/VioBackend.h"
+#include "kimera-vio/frontend/FrontendOutputPacketBase.h"
+#include "kimera-vio/frontend/StereoVisionImuFrontend-definitions.h"
+#include "kimera-vio/frontend/VisionImuFrontend.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The StereoKeyframeStep class connects a stereo Frontend to a Backend
+ * for the pipelines that call them directly, instead of through modules and
+ * queues (EmbeddedStereoImuPipeline, StaticStereoImuPipeline):
+ * - At construction, the Backend gets the callbacks updating the IMU bias and
+ *   the map of the Frontend, called inline by the Backend.
+ * - Each stereo keyframe is given to the Backend, whose estimate then updates
+ *   the nav state of the Frontend.
+ *
+ * Neither the Frontend nor the Backend are owned: they must outlive it.
+ */
+class StereoKeyframeStep {
+ public:
+  KIMERA_POINTER_TYPEDEFS(StereoKeyframeStep);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(StereoKeyframeStep);
+
+  StereoKeyframeStep(VisionImuFrontend* frontend, VioBackend* backend);
+  ~StereoKeyframeStep() = default;
+
+  //! The output of a stereo Frontend, whose type is fixed: no dynamic cast.
+  static const StereoFrontendOutput& castOutput(
+      const FrontendOutputPacketBase& frontend_output);
+  static StereoFrontendOutput::Ptr castOutput(
+      FrontendOutputPacketBase::UniquePtr frontend_output);
+
+  //! The Backend input of a stereo keyframe.
+  static BackendInput toBackendInput(const StereoFrontendOutput& keyframe);
+
+  /**
+   * @brief spinOnce Gives a stereo keyframe to the Backend, and its estimate
+   * to the Frontend.
+   * @return The Backend output, nullptr if the Backend failed.
+   */
+  BackendOutput::UniquePtr spinOnce(const StereoFrontendOutput& keyframe) const;
+
+ private:
+  VisionImuFrontend* frontend_;
+  VioBackend* backend_;
+};
+
+}  // namespace VIO
@@ -18,6 +18,7 @@
 
 #include <future>
 #include <limits>
+#include <string>
 #include <utility>
 
 #include <gflags/gflags.h>
@@ -76,6 +77,21 @@ class EurocPlayground {
                        const bool& viz_img_in_frustum,
                        const bool& viz_pointcloud);
 
+  /**
+   * @brief reconstructDenseBatch Batch dense stereo reconstruction, e.g. to
+   * build reference dense maps: every frame_stride-th stereo frame is
+   * rectified, matched, back-projected and transformed to the world frame
+   * with its ground-truth pose, with frames processed concurrently. The valid
+   * points of each frame are written to output_dir/<timestamp>.ply as soon
+   * as the frame is done, so memory does not grow with the sequence.
+   * Consumes the frame queues, as visualizeGtData does.
+   * @param nr_threads Number of worker threads, 0 for one per core.
+   * @return Number of frames written.
+   */
+  size_t reconstructDenseBatch(const std::string& output_dir,
+                               const FrameId& frame_stride = 1u,
+                               const size_t& nr_threads = 0u);
+
   // Very naive!
   void projectVisibleLandmarksToCam(const StereoCamera& stereo_cam,
                                     const Landmarks& lmks);
@@ -107,6 +123,18 @@ public:
   //! Callbacks to fill queues: they should be all lighting fast.
   void fillRightFrameQueue(Frame::UniquePtr left_frame);
 
+  /**
+   * @brief reconstructDenseFrame Dense point cloud of one stereo frame in the
+   * world frame, written to a binary PLY file. Thread-safe as long as each
+   * thread uses its own stereo_matcher. Points are kept if isValidPoint, as
+   * in visualizeGtData.
+   * @return False if the file could not be written.
+   */
+  bool reconstructDenseFrame(const Frame& left_frame,
+                             const Frame& right_frame,
+                             StereoMatcher* stereo_matcher,
+                             const std::string& filename) const;
+
  protected:
   std::string dataset_path_;
 
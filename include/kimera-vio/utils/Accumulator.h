@@ -33,47 +33,46 @@
 #include <algorithm>
 #include <cmath>
 #include <limits>
+#include <type_traits>
 #include <vector>
 
 #include <glog/logging.h>
 
+#include "kimera-vio/utils/RingBuffer.h"
+
 namespace VIO {
 
 namespace utils {
 
 static constexpr int kInfiniteWindowSize = std::numeric_limits<int>::max();
 
-// If the window size is set to -1, the vector will grow infinitely, otherwise,
-// the vector has a fixed size.
+// If the window size is set to kInfiniteWindowSize, the samples are kept in a
+// vector that grows infinitely, otherwise the last WindowSize samples are kept
+// in a fixed size ring buffer (oldest first).
 template <typename SampleType, typename SumType, int WindowSize>
 class Accumulator {
  public:
+  static_assert(WindowSize > 0, "The window size must be positive.");
+  static constexpr bool kIsWindowed = WindowSize < kInfiniteWindowSize;
+
   Accumulator()
-      : sample_index_(0),
-        total_samples_(0),
+      : total_samples_(0),
         sum_(0),
         window_sum_(0),
         min_(std::numeric_limits<SampleType>::max()),
         max_(std::numeric_limits<SampleType>::lowest()),
-        most_recent_(0) {
-    CHECK_GT(WindowSize, 0);
-    if (WindowSize < kInfiniteWindowSize) {
-      samples_.reserve(WindowSize);
-    }
-  }
+        most_recent_(0) {}
 
   /* ------------------------------------------------------------------------ */
   void Add(SampleType sample) {
     most_recent_ = sample;
-    if (sample_index_ < WindowSize) {
-      samples_.push_back(sample);
-      window_sum_ += sample;
-      ++sample_index_;
+    if constexpr (kIsWindowed) {
+      if (samples_.full()) window_sum_ -= samples_.front();
+      samples_.push(sample);
     } else {
-      SampleType& oldest = samples_.at(sample_index_++ % WindowSize);
-      window_sum_ += sample - oldest;
-      oldest = sample;
+      samples_.push_back(sample);
     }
+    window_sum_ += sample;
     sum_ += sample;
     ++total_samples_;
     if (sample > max_) {
@@ -99,8 +98,8 @@ class Accumulator {
   // Rolling mean is only used for fixed sized data for now. We don't need this
   // function for our infinite accumulator at this point.
   SumType RollingMean() const {
-    if (WindowSize < kInfiniteWindowSize) {
-      return window_sum_ / std::min(sample_index_, WindowSize);
+    if (kIsWindowed) {
+      return window_sum_ / samples_.size();
     } else {
       return Mean();
     }
@@ -115,26 +114,6 @@ class Accumulator {
   /* ------------------------------------------------------------------------ */
   SumType min() const { return min_; }
 
-  /* ------------------------------------------------------------------------ */
-  inline SumType median() const {
-    CHECK_GT(samples_.size(), 0);
-    return samples_.at(std::ceil(samples_.size() / 2) - 1);
-  }
-
-  /* ------------------------------------------------------------------------ */
-  // First quartile.
-  inline SumType q1() const {
-    CHECK_GT(samples_.size(), 0);
-    return samples_.at(std::ceil(samples_.size() / 4) - 1);
-  }
-
-  /* ------------------------------------------------------------------------ */
-  // Third quartile.
-  inline SumType q3() const {
-    CHECK_GT(samples_.size(), 0);
-    return samples_.at(std::ceil(samples_.size() * 3 / 4) - 1);
-  }
-
   /* ------------------------------------------------------------------------ */
   SumType LazyVariance() const {
     if (samples_.size() < 2) {
@@ -144,8 +123,12 @@ class Accumulator {
     SumType var = static_cast<SumType>(0.0);
     SumType mean = RollingMean();
 
-    for (unsigned int i = 0; i < samples_.size(); ++i) {
-      var += (samples_[i] - mean) * (samples_[i] - mean);
+    if constexpr (kIsWindowed) {
+      for (const auto& range : samples_.ranges()) {
+        var += SquaredDeviations(range.data, range.size, mean);
+      }
+    } else {
+      var += SquaredDeviations(samples_.data(), samples_.size(), mean);
     }
 
     var /= samples_.size() - 1;
@@ -156,11 +139,29 @@ class Accumulator {
   SumType StandardDeviation() const { return std::sqrt(LazyVariance()); }
 
   /* ------------------------------------------------------------------------ */
-  const std::vector<SampleType> &GetAllSamples() const { return samples_; }
+  // Oldest first.
+  std::vector<SampleType> GetAllSamples() const {
+    return std::vector<SampleType>(samples_.begin(), samples_.end());
+  }
+
+ private:
+  // Contiguous loop, for the compiler to vectorize.
+  static SumType SquaredDeviations(const SampleType* samples,
+                                   size_t nr_samples,
+                                   SumType mean) {
+    SumType var = static_cast<SumType>(0.0);
+    for (size_t i = 0; i < nr_samples; ++i) {
+      var += (samples[i] - mean) * (samples[i] - mean);
+    }
+    return var;
+  }
 
-private:
-  std::vector<SampleType> samples_;
-  int sample_index_;
+ private:
+  std::conditional_t<
+      kIsWindowed,
+      RingBuffer<SampleType, static_cast<size_t>(kIsWindowed ? WindowSize : 1)>,
+      std::vector<SampleType>>
+      samples_;
   int total_samples_;
   SumType sum_;
   SumType window_sum_;
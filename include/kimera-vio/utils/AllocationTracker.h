@@ -0,0 +1,121 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   AllocationTracker.h
+ * @brief  Counts the heap allocations of the threads and of the module spins.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+namespace utils {
+
+//! Heap allocations of a thread.
+struct AllocationCounts {
+  uint64_t nr_allocations = 0u;
+  uint64_t nr_deallocations = 0u;
+  uint64_t allocated_bytes = 0u;
+};
+
+//! An allocation in a spin of a module after its warmup.
+struct AllocationViolation {
+  std::string module;
+  //! Index of the spin of the module.
+  size_t spin = 0u;
+  size_t bytes = 0u;
+  //! Return addresses, innermost first.
+  std::vector<void*> callstack;
+};
+
+/**
+ * @brief The AllocationTracker class counts the heap allocations of each
+ * thread, and attributes them to the spin of the module running in it (see
+ * AllocationScope). Past the warmup spins of a module (allocation_warmup_spins
+ * flag), each of its allocations is a violation of the real-time constraints,
+ * kept with its callstack.
+ *
+ * Counting needs the allocation functions to be interposed, i.e.
+ * AllocationInterposer.cpp to be linked in the executable: the tests and the
+ * benchmarks are, the library alone is not. Otherwise nothing is counted.
+ */
+class AllocationTracker {
+ public:
+  //! Frames kept per violation.
+  static constexpr size_t kMaxCallstackDepth = 32u;
+  //! Violations kept with their callstack per module, the others only
+  //! counted.
+  static constexpr size_t kMaxViolationsPerModule = 16u;
+  //! Allocation counts of a module, opaque.
+  struct Module;
+
+  //! Whether the allocation functions are interposed.
+  static bool isEnabled();
+  //! Called by the interposer, once, before main.
+  static void enable();
+
+  //! Hooks of the interposed allocation functions. They do not allocate,
+  //! except to keep a violation (not counted).
+  static void onAllocation(const size_t& bytes);
+  static void onDeallocation();
+
+  //! Allocations of the calling thread since it started.
+  static AllocationCounts getThreadCounts();
+
+  //! Nr of allocations past the warmup, over all modules.
+  static size_t getNumViolations();
+  //! The violations kept, see kMaxViolationsPerModule.
+  static std::vector<AllocationViolation> getViolations();
+
+  //! Spins and allocations per module, and the violations kept with their
+  //! symbolized callstacks.
+  static std::string print();
+
+  //! Forgets the spins and violations of the modules (e.g. between tests).
+  static void reset();
+
+ private:
+  friend class AllocationScope;
+
+  //! Of the module of the given name, created on first use. Never destroyed.
+  static Module* getModule(const std::string& name);
+};
+
+/**
+ * @brief The AllocationScope class attributes the allocations of the calling
+ * thread, from its construction to its destruction, to a spin of the module.
+ * Each scope is a sample of the "<module> allocations [#]" statistic. Does
+ * nothing if the tracker is not enabled.
+ */
+class AllocationScope {
+ public:
+  KIMERA_DELETE_COPY_CONSTRUCTORS(AllocationScope);
+
+  explicit AllocationScope(const std::string& module);
+  ~AllocationScope();
+
+ private:
+  AllocationTracker::Module* module_;
+  //! Of the enclosing scope of the thread, if any.
+  AllocationTracker::Module* previous_module_;
+  size_t previous_spin_;
+  uint64_t begin_nr_allocations_;
+};
+
+}  // namespace utils
+
+}  // namespace VIO
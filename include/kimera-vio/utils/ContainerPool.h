@@ -0,0 +1,85 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ContainerPool.h
+ * @brief  Pool of recycled (cleared but still allocated) std containers.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The ContainerPool class keeps containers (e.g. std::vector) that are
+ * no longer used, so that their memory can be handed over to new owners
+ * instead of being freed and reallocated. Containers are exchanged by swap,
+ * hence acquiring and releasing never allocates nor copies elements.
+ * Thread-safe.
+ */
+template <class Container>
+class ContainerPool {
+ public:
+  KIMERA_POINTER_TYPEDEFS(ContainerPool);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(ContainerPool);
+
+  //! @param max_size Maximum nr of containers kept, the others are freed.
+  explicit ContainerPool(const size_t& max_size) : max_size_(max_size) {}
+  ~ContainerPool() = default;
+
+  /**
+   * @brief acquire Gives the memory of a recycled container to an empty one.
+   * Does nothing if the pool is empty or if the container is not empty.
+   */
+  void acquire(Container* container) {
+    CHECK_NOTNULL(container);
+    if (!container->empty()) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pool_.empty()) return;
+    std::swap(*container, pool_.back());
+    pool_.pop_back();
+  }
+
+  /**
+   * @brief release Clears the container and keeps its memory in the pool.
+   * The container is left empty (and without memory) in any case.
+   */
+  void release(Container* container) {
+    CHECK_NOTNULL(container);
+    container->clear();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pool_.size() < max_size_ && container->capacity() > 0u) {
+      pool_.emplace_back();
+      std::swap(*container, pool_.back());
+    } else {
+      Container().swap(*container);
+    }
+  }
+
+  inline size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pool_.size();
+  }
+
+ private:
+  const size_t max_size_;
+  mutable std::mutex mutex_;
+  std::vector<Container> pool_;
+};
+
+}  // namespace VIO
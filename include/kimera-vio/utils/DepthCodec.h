@@ -0,0 +1,67 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   DepthCodec.h
+ * @brief  Compression of depth images for caching and logging.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+namespace VIO {
+
+/**
+ * @brief The DepthCodec class compresses depth images with the run-length
+ * variable-length (RVL) scheme of Wilson (2017): runs of invalid (zero)
+ * depths are stored as their length, and valid depths as the zigzag-encoded
+ * difference with the previous valid depth, in variable-length nibbles.
+ * Depth images are smooth and have large holes, hence this is several times
+ * smaller than the raw image, and much cheaper to encode than a 16-bit PNG.
+ *
+ * - CV_16UC1 depth is encoded losslessly.
+ * - CV_32FC1 depth is quantized to uint16 steps of float_step (in the units
+ *   of the image), hence decoded with an error of at most float_step / 2 for
+ *   depths in (0, 65535 * float_step]; larger depths are clamped to that
+ *   range. Non-positive and non-finite depths decode as 0.
+ *
+ * The encoded buffer is self-describing (size, type and step), decode
+ * restores the image type of the encoded one.
+ */
+class DepthCodec {
+ public:
+  /**
+   * @brief encode Appends the compressed depth image to bytes.
+   * @param depth CV_16UC1 or CV_32FC1 depth image.
+   * @param float_step Quantization step of CV_32FC1 depths, e.g. 1e-3 for
+   * millimetric steps of depths in meters. Unused for CV_16UC1 depths.
+   * @param bytes Buffer to which the compressed image is appended.
+   */
+  static void encode(const cv::Mat& depth,
+                     const float& float_step,
+                     std::vector<std::uint8_t>* bytes);
+
+  /**
+   * @brief decode Decodes a depth image compressed with encode.
+   * @param bytes Buffer with the compressed image at offset.
+   * @param offset Offset of the compressed image in bytes, moved past it.
+   * @param depth Decoded image, reallocated only if its size or type differs.
+   * @return False if the buffer does not hold a valid compressed image.
+   */
+  static bool decode(const std::vector<std::uint8_t>& bytes,
+                     size_t* offset,
+                     cv::Mat* depth);
+};
+
+}  // namespace VIO
@@ -16,6 +16,7 @@
 
 #include <vector>
 #include <array>
+#include <glog/logging.h>
 #include <opencv2/core.hpp>
 
 // TODO move these to .cpp when removing static functions...
@@ -129,6 +130,30 @@ public:
   // Calculates histogram.
   void calculateHistogram(const cv::Mat& input, bool log_histogram = false);
 
+  /* ------------------------------------------------------------------------ */
+  // Streaming interface, for uniform histograms without mask: the histogram is
+  // updated in place one sample at a time, as calculateHistogram with the
+  // accumulate flag but without building an input matrix. A sample has one
+  // value per dimension, and is not counted if any value is out of range.
+  // A negative weight removes a sample added before, so that the histogram can
+  // be updated with only the samples that changed.
+  // Sets all bins to zero, allocating the histogram if needed.
+  void resetHistogram();
+  void addSample(const float* sample, const float& weight = 1.0f);
+  inline void addSample(const float& value, const float& weight = 1.0f) {
+    CHECK_EQ(dims_, 1);
+    addSample(&value, weight);
+  }
+  inline void addSample(const cv::Point2f& values,
+                        const float& weight = 1.0f) {
+    CHECK_EQ(dims_, 2);
+    const float sample[2] = {values.x, values.y};
+    addSample(sample, weight);
+  }
+  // Logs the histogram to a yaml file, as calculateHistogram does.
+  void logHistogram() const;
+  inline const cv::Mat& getHistogram() const { return histogram_; }
+
   /* ------------------------------------------------------------------------ */
   // If you play with the peak_per attribute value, you can increase/decrease the
   // number of peaks found.
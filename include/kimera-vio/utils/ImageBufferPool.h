@@ -0,0 +1,90 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ImageBufferPool.h
+ * @brief  cv::Mat allocator recycling image buffers.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+
+#include <opencv2/core/core.hpp>
+
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The ImageBufferPool class is a cv::MatAllocator that recycles image
+ * buffers: when the last cv::Mat referencing a buffer is released (wherever
+ * in the pipeline that happens), the buffer goes back to the pool instead of
+ * being freed, and the next image of the same size reuses it. Buffers are
+ * allocated with cv::fastMalloc, hence aligned as any other cv::Mat.
+ *
+ * Usage: set the allocator of a cv::Mat before it is created, e.g.
+ *   cv::Mat img;
+ *   img.allocator = &ImageBufferPool::getInstance();
+ *   cv::cvtColor(src, img, cv::COLOR_BGR2GRAY);  // img data is pooled.
+ * Copies of img (shallow or deep, via clone/copyTo) use regular memory, only
+ * img's buffer is recycled.
+ */
+class ImageBufferPool : public cv::MatAllocator {
+ public:
+  KIMERA_DELETE_COPY_CONSTRUCTORS(ImageBufferPool);
+
+  //! @param max_nr_free_buffers Max nr of unused buffers kept in the pool.
+  explicit ImageBufferPool(const size_t& max_nr_free_buffers = 16u);
+  virtual ~ImageBufferPool();
+
+  /**
+   * @brief getInstance Process-wide pool, to be used by data providers. It is
+   * never destroyed, so that images outliving the pipeline can still be
+   * released into it.
+   */
+  static ImageBufferPool& getInstance();
+
+ public:
+  // cv::MatAllocator interface.
+  cv::UMatData* allocate(int dims,
+                         const int* sizes,
+                         int type,
+                         void* data,
+                         size_t* step,
+                         cv::AccessFlag flags,
+                         cv::UMatUsageFlags usage_flags) const override;
+  bool allocate(cv::UMatData* data,
+                cv::AccessFlag access_flags,
+                cv::UMatUsageFlags usage_flags) const override;
+  void deallocate(cv::UMatData* data) const override;
+
+ public:
+  //! Nr of unused buffers currently in the pool.
+  size_t getNrFreeBuffers() const;
+
+  //! Nr of buffers allocated since construction (i.e. pool misses).
+  size_t getNrAllocatedBuffers() const;
+
+ private:
+  uchar* acquireBuffer(const size_t& size) const;
+  void releaseBuffer(uchar* buffer, const size_t& size) const;
+
+ private:
+  const size_t max_nr_free_buffers_;
+
+  mutable std::mutex mutex_;
+  //! Unused buffers, by size in bytes.
+  mutable std::multimap<size_t, uchar*> free_buffers_;
+  mutable size_t nr_allocated_buffers_;
+};
+
+}  // namespace VIO
@@ -0,0 +1,80 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   LowPriorityWorker.h
+ * @brief  Thread running optional work (e.g. debug images) at low priority.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/Statistics.h"
+
+namespace VIO {
+
+namespace utils {
+
+/**
+ * @brief The LowPriorityWorker class runs jobs in a thread of its own, with
+ * the lowest priority (see setCurrentThreadLowPriority), in the order they
+ * were added. It is meant for work nothing waits for, e.g. drawing and
+ * saving debug images: adding a job never blocks, and jobs are dropped
+ * (and counted) if the worker lags behind by more than max_nr_queued_jobs.
+ *
+ * Jobs run in another thread than the one adding them: they should own
+ * copies of the data they use, instead of referencing the caller's members.
+ */
+class LowPriorityWorker {
+ public:
+  KIMERA_POINTER_TYPEDEFS(LowPriorityWorker);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(LowPriorityWorker);
+  using Job = std::function<void()>;
+
+  LowPriorityWorker(const std::string& name, const size_t& max_nr_queued_jobs);
+  //! Runs the queued jobs before joining the thread.
+  virtual ~LowPriorityWorker();
+
+  //! @return False if the job was dropped because the queue is full.
+  bool addJob(Job job);
+
+  //! Blocks until all the jobs added so far have run.
+  void waitUntilIdle();
+
+  size_t getNrDroppedJobs() const;
+
+ private:
+  void run();
+
+ private:
+  const std::string name_;
+  const size_t max_nr_queued_jobs_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable jobs_cond_;
+  std::condition_variable idle_cond_;
+  std::deque<Job> jobs_;
+  bool is_running_job_;
+  bool shutdown_;
+  size_t nr_dropped_jobs_;
+
+  StatsCollector dropped_jobs_stats_;
+  std::thread thread_;
+};
+
+}  // namespace utils
+
+}  // namespace VIO
@@ -0,0 +1,60 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   MappedFile.h
+ * @brief  Memory mapping of a whole file, and cv::Mat pointing inside it.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include <opencv2/core/core.hpp>
+
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The MappedFile class owns a private, read-write (copy-on-write)
+ * memory mapping of a whole file. Pages that are not written are the page
+ * cache's, hence shared with any other process mapping the same file.
+ */
+class MappedFile {
+ public:
+  KIMERA_DELETE_COPY_CONSTRUCTORS(MappedFile);
+
+  //! CHECK fails if the file can not be mapped.
+  explicit MappedFile(const std::string& filename);
+  ~MappedFile();
+
+  inline uchar* data() const { return data_; }
+  inline size_t size() const { return size_; }
+
+ private:
+  uchar* data_;
+  size_t size_;
+};
+
+/**
+ * @brief wrapMappedFile cv::Mat without copies of the data at offset in the
+ * mapping: it holds a reference to the mapping (also its copies, ROIs and
+ * rows do), so it can outlive the owner of the mapped_file pointer.
+ */
+cv::Mat wrapMappedFile(const std::shared_ptr<const MappedFile>& mapped_file,
+                       const size_t& offset,
+                       const int& rows,
+                       const int& cols,
+                       const int& type,
+                       const size_t& step);
+
+}  // namespace VIO
@@ -0,0 +1,174 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   MemoryAccounting.h
+ * @brief  Bytes held by the major structures of each module, and high-water
+ * marks of the queues.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/Statistics.h"
+
+namespace VIO {
+
+namespace utils {
+
+//! Whether the modules measure their structures (enable_memory_accounting
+//! flag): measuring may iterate over them, so it is disabled by default.
+bool isMemoryAccountingEnabled();
+
+//! Resident set size of the process, 0 if unknown (e.g. not on Linux).
+size_t getResidentSetBytes();
+
+//! Bytes allocated by a vector (without its elements' own allocations).
+template <typename Vector>
+inline size_t getVectorBytes(const Vector& vector) {
+  return vector.capacity() * sizeof(typename Vector::value_type);
+}
+
+//! Approximate bytes allocated by a node-based hash container: one node per
+//! value (value and next pointer, plus the cached hash) and the buckets.
+template <typename UnorderedContainer>
+inline size_t getUnorderedContainerBytes(const UnorderedContainer& container) {
+  return container.size() *
+             (sizeof(typename UnorderedContainer::value_type) +
+              sizeof(void*) + sizeof(size_t)) +
+         container.bucket_count() * sizeof(void*);
+}
+
+/**
+ * @brief The MemoryGauge class holds the last bytes reported for one
+ * structure of a module (e.g. "LCD frame cache"), and its peak. Each report
+ * is also a sample of the "Memory <tag> [MB]" statistic.
+ *
+ * The owner measures the structure in its own thread (the structures are not
+ * thread-safe) and sets the gauge, which can be read from any thread.
+ * Registered to the MemoryAccounting while alive.
+ */
+class MemoryGauge {
+ public:
+  KIMERA_POINTER_TYPEDEFS(MemoryGauge);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(MemoryGauge);
+
+  explicit MemoryGauge(const std::string& tag);
+  ~MemoryGauge();
+
+  void set(const size_t& bytes);
+
+  inline size_t get() const { return bytes_; }
+  inline size_t getPeak() const { return peak_bytes_; }
+  inline const std::string& getTag() const { return tag_; }
+
+ private:
+  const std::string tag_;
+  std::atomic<size_t> bytes_;
+  std::atomic<size_t> peak_bytes_;
+  StatsCollector stats_;
+};
+
+//! Memory counters at the time of MemoryAccounting::getReport.
+struct MemoryReport {
+  struct Gauge {
+    std::string tag;
+    size_t bytes;
+    size_t peak_bytes;
+  };
+  struct Queue {
+    std::string queue_id;
+    size_t high_water_mark;
+  };
+
+  //! Summed by tag, sorted by tag.
+  std::vector<Gauge> gauges;
+  std::vector<Queue> queues;
+  size_t resident_set_bytes = 0u;
+};
+
+/**
+ * @brief The MemoryAccounting class is the process-wide registry of the
+ * memory gauges and of the queues, reporting the bytes and the high-water
+ * marks of all of them.
+ */
+class MemoryAccounting {
+ public:
+  KIMERA_DELETE_COPY_CONSTRUCTORS(MemoryAccounting);
+  //! Thread-safe, returns the max nr of values the queue ever held.
+  typedef std::function<size_t()> HighWaterMarkCallback;
+
+  static MemoryAccounting& getInstance();
+
+  void registerGauge(const MemoryGauge* gauge);
+  void unregisterGauge(const MemoryGauge* gauge);
+
+  //! @return Id to unregister the queue.
+  size_t registerQueue(const std::string& queue_id,
+                       const HighWaterMarkCallback& high_water_mark);
+  void unregisterQueue(const size_t& id);
+
+  MemoryReport getReport() const;
+
+  //! Table of the current and peak bytes of the gauges (summed by tag), the
+  //! high-water marks of the queues, and the resident set size.
+  std::string print() const;
+
+ private:
+  MemoryAccounting() = default;
+
+  struct Queue {
+    std::string queue_id;
+    HighWaterMarkCallback high_water_mark;
+  };
+
+  mutable std::mutex mutex_;
+  std::multimap<std::string, const MemoryGauge*> gauges_;
+  std::map<size_t, Queue> queues_;
+  size_t next_queue_id_ = 0u;
+};
+
+/**
+ * @brief The MemoryReporter class logs the memory report every period (if
+ * non-zero), and once when destroyed (e.g. at shutdown).
+ */
+class MemoryReporter {
+ public:
+  KIMERA_POINTER_TYPEDEFS(MemoryReporter);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(MemoryReporter);
+
+  explicit MemoryReporter(const std::chrono::seconds& period);
+  ~MemoryReporter();
+
+ private:
+  void run();
+
+ private:
+  const std::chrono::seconds period_;
+  std::mutex mutex_;
+  std::condition_variable shutdown_cond_;
+  bool shutdown_;
+  StatsCollector resident_set_stats_;
+  std::thread thread_;
+};
+
+}  // namespace utils
+
+}  // namespace VIO
@@ -0,0 +1,65 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   MetricsExporter.h
+ * @brief  Serves the statistics and memory counters to Prometheus over HTTP.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+namespace utils {
+
+/**
+ * @brief The MetricsExporter class serves, in its own thread, the live
+ * statistics (module latencies, queue depths...) and the memory counters in
+ * the Prometheus text exposition format, at GET /metrics on the given port.
+ *
+ * Each scrape takes a snapshot of the Statistics and of the MemoryAccounting:
+ * the pipeline threads keep adding samples without locking meanwhile.
+ */
+class MetricsExporter {
+ public:
+  KIMERA_POINTER_TYPEDEFS(MetricsExporter);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(MetricsExporter);
+
+  //! @param port TCP port to listen on, any free one if 0 (see getPort).
+  explicit MetricsExporter(const int& port);
+  ~MetricsExporter();
+
+  inline int getPort() const { return port_; }
+
+  //! The metrics as served, e.g. kimera_vio_statistic{tag="...",quantile=
+  //! "0.99"} for the statistics, which are summaries.
+  static std::string printMetrics();
+
+ private:
+  void run();
+
+  //! Answers one request of the connected client, then disconnects it.
+  void serve(const int& socket_fd) const;
+
+ private:
+  int server_fd_;
+  int port_;
+  std::atomic<bool> shutdown_;
+  std::thread thread_;
+};
+
+}  // namespace utils
+
+}  // namespace VIO
@@ -0,0 +1,123 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   PerfCounters.h
+ * @brief  Hardware performance counters of the scopes of the pipeline.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/Statistics.h"
+#include "kimera-vio/utils/Tracing.h"
+
+///
+// Example usage:
+//
+// void Tracker::featureTracking(...) {
+//   KIMERA_PERF_SCOPE("Tracker featureTracking");
+//   ...
+// }
+//
+// With --enable_perf_counters, each counter of the scope is a statistic
+// (e.g. "Tracker featureTracking LLC misses [#]"), and a counter in the trace.
+
+namespace VIO {
+
+namespace utils {
+
+//! Whether the scopes read the hardware counters (enable_perf_counters flag).
+bool isPerfCountingEnabled();
+
+/**
+ * @brief The PerfCounters class reads the performance counters of the calling
+ * thread (perf_event_open on Linux), opened on its first read. Counters the
+ * kernel or the CPU does not provide (e.g. in a VM, or with a restrictive
+ * perf_event_paranoid) are not available.
+ */
+class PerfCounters {
+ public:
+  enum Counter : size_t {
+    kCycles = 0u,
+    kInstructions,
+    kLlcMisses,
+    kBranchMisses,
+    kContextSwitches,
+    kNumCounters
+  };
+  struct Values {
+    std::array<uint64_t, kNumCounters> counts;
+    //! Whether each counter is read, else its count is 0.
+    std::array<bool, kNumCounters> available;
+  };
+
+  //! E.g. "LLC misses".
+  static const char* getName(const Counter& counter);
+
+  //! @return False if no counter is available to the calling thread.
+  static bool read(Values* values);
+};
+
+/**
+ * @brief The PerfCounterStats class holds the statistics, and the names in
+ * the trace, of the counters of one scope. Registered on the first sample,
+ * so that unused scopes add no statistics.
+ */
+class PerfCounterStats {
+ public:
+  KIMERA_DELETE_COPY_CONSTRUCTORS(PerfCounterStats);
+
+  explicit PerfCounterStats(const std::string& name);
+  ~PerfCounterStats() = default;
+
+  //! Samples the available counts of the scope, at the given time of the
+  //! trace.
+  void addSample(const PerfCounters::Values& counts, const int64_t& time_ns);
+
+ private:
+  const std::string name_;
+  std::once_flag registered_;
+  std::array<size_t, PerfCounters::kNumCounters> handles_;
+  std::array<const char*, PerfCounters::kNumCounters> trace_names_;
+};
+
+/**
+ * @brief The PerfScope class samples the counts of the calling thread from
+ * its construction to its destruction, if enabled at construction.
+ */
+class PerfScope {
+ public:
+  KIMERA_DELETE_COPY_CONSTRUCTORS(PerfScope);
+
+  explicit PerfScope(PerfCounterStats* stats);
+  ~PerfScope();
+
+ private:
+  PerfCounterStats* stats_;
+  PerfCounters::Values begin_;
+};
+
+//! Samples the counters of the enclosing scope.
+#define KIMERA_PERF_SCOPE(name)                                         \
+  static ::VIO::utils::PerfCounterStats KIMERA_TRACE_CONCAT(            \
+      kimera_perf_stats_, __LINE__)(name);                              \
+  ::VIO::utils::PerfScope KIMERA_TRACE_CONCAT(kimera_perf_scope_,       \
+                                              __LINE__)(                \
+      &KIMERA_TRACE_CONCAT(kimera_perf_stats_, __LINE__))
+
+}  // namespace utils
+
+}  // namespace VIO
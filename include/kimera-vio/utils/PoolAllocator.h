@@ -0,0 +1,171 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   PoolAllocator.h
+ * @brief  Allocator recycling the memory of objects of a fixed size, e.g. the
+ * factors created for every keyframe by the Backend.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+#include <glog/logging.h>
+
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The FixedSizeBlockPool class hands out blocks of a fixed size and
+ * alignment, carved from chunks of several blocks. Released blocks are kept
+ * in a free list for the next allocations, chunks are only freed on
+ * destruction.
+ * Thread-safe: blocks may be released from another thread than the one that
+ * allocated them (e.g. factors freed by a worker holding a graph copy).
+ */
+class FixedSizeBlockPool {
+ public:
+  KIMERA_DELETE_COPY_CONSTRUCTORS(FixedSizeBlockPool);
+
+  FixedSizeBlockPool(const size_t& block_size,
+                     const size_t& block_alignment,
+                     const size_t& blocks_per_chunk = 64u)
+      : block_alignment_(std::max(block_alignment, alignof(void*))),
+        block_size_(((std::max(block_size, sizeof(void*)) + block_alignment_ -
+                      1u) /
+                     block_alignment_) *
+                    block_alignment_),
+        blocks_per_chunk_(blocks_per_chunk) {
+    CHECK_GT(blocks_per_chunk_, 0u);
+    CHECK_EQ(block_alignment_ & (block_alignment_ - 1u), 0u)
+        << "Alignment must be a power of 2.";
+  }
+
+  ~FixedSizeBlockPool() {
+    for (void* chunk : chunks_) {
+      ::operator delete(chunk, std::align_val_t(block_alignment_));
+    }
+  }
+
+  void* allocate() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_blocks_.empty()) {
+      void* chunk = ::operator new(block_size_ * blocks_per_chunk_,
+                                   std::align_val_t(block_alignment_));
+      chunks_.push_back(chunk);
+      free_blocks_.reserve(free_blocks_.size() + blocks_per_chunk_);
+      // Reversed, so that blocks are handed out in address order.
+      for (size_t i = blocks_per_chunk_; i > 0u; --i) {
+        free_blocks_.push_back(static_cast<unsigned char*>(chunk) +
+                               (i - 1u) * block_size_);
+      }
+    }
+    void* block = free_blocks_.back();
+    free_blocks_.pop_back();
+    return block;
+  }
+
+  void deallocate(void* block) {
+    if (!block) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_blocks_.push_back(block);
+  }
+
+  //! Nr of blocks ever carved (free or in use).
+  inline size_t getNrBlocks() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return chunks_.size() * blocks_per_chunk_;
+  }
+
+  inline size_t getNrFreeBlocks() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return free_blocks_.size();
+  }
+
+  inline size_t getBlockSize() const { return block_size_; }
+
+ private:
+  const size_t block_alignment_;
+  const size_t block_size_;
+  const size_t blocks_per_chunk_;
+
+  mutable std::mutex mutex_;
+  std::vector<void*> chunks_;
+  std::vector<void*> free_blocks_;
+};
+
+/**
+ * @brief The PoolAllocator class is a standard allocator taking single
+ * objects of type T from a process-wide FixedSizeBlockPool per type (arrays
+ * use the default allocator). It is meant for boost::allocate_shared (see
+ * allocatePooled), which rebinds it to the type holding both the object and
+ * its reference count, so that a single pooled block is used per object.
+ * The alignment of T is honored, e.g. for types with fixed-size Eigen members.
+ */
+template <class T>
+class PoolAllocator {
+ public:
+  typedef T value_type;
+
+  PoolAllocator() noexcept = default;
+  template <class U>
+  PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+  T* allocate(const size_t& n) {
+    if (n != 1u) return std::allocator<T>().allocate(n);
+    return static_cast<T*>(getPool().allocate());
+  }
+
+  void deallocate(T* p, const size_t& n) {
+    if (n != 1u) {
+      std::allocator<T>().deallocate(p, n);
+      return;
+    }
+    getPool().deallocate(p);
+  }
+
+  /**
+   * @brief getPool Pool of the blocks of type T. It is never destroyed, so
+   * that objects outliving static destruction can still be released into it.
+   */
+  static FixedSizeBlockPool& getPool() {
+    static FixedSizeBlockPool* pool =
+        new FixedSizeBlockPool(sizeof(T), alignof(T));
+    return *pool;
+  }
+
+  template <class U>
+  inline bool operator==(const PoolAllocator<U>&) const noexcept {
+    return true;
+  }
+  template <class U>
+  inline bool operator!=(const PoolAllocator<U>&) const noexcept {
+    return false;
+  }
+};
+
+//! Like boost::make_shared, but the object (with its reference count) is
+//! allocated from a PoolAllocator.
+template <class T, class... Args>
+inline boost::shared_ptr<T> allocatePooled(Args&&... args) {
+  return boost::allocate_shared<T>(PoolAllocator<T>(),
+                                   std::forward<Args>(args)...);
+}
+
+}  // namespace VIO
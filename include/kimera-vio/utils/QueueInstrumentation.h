@@ -0,0 +1,107 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   QueueInstrumentation.h
+ * @brief  Rates, depth and wait times of a queue, exported to the statistics
+ * and to the trace.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/Statistics.h"
+#include "kimera-vio/utils/Tracing.h"
+
+namespace VIO {
+
+namespace utils {
+
+//! Whether the queues are instrumented (instrument_queues flag), read when
+//! each queue is constructed.
+bool isQueueInstrumentationEnabled();
+
+/**
+ * @brief The QueueInstrumentation class records, for one queue:
+ * - "<queue_id> Push blocked [ms]": time the producer waited for room, one
+ *   sample per push (its rate is the push rate).
+ * - "<queue_id> Pop wait [ms]": time the consumer waited for a value, one
+ *   sample per pop (its rate is the pop rate).
+ * - "<queue_id> Time in queue [ms]": from the push to the pop of each value.
+ * - "<queue_id> Depth [#]": nr of values after each push and pop, also
+ *   plotted as a counter in the trace, where the waits are spans.
+ *
+ * The edge limiting the pipeline is the one whose producer is blocked (or
+ * whose values wait) the longest. Thread-safe.
+ */
+class QueueInstrumentation {
+ public:
+  KIMERA_POINTER_TYPEDEFS(QueueInstrumentation);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(QueueInstrumentation);
+  //! Wait start of a side that did not have to wait.
+  static constexpr int64_t kNotWaited = -1;
+
+  explicit QueueInstrumentation(const std::string& queue_id);
+  ~QueueInstrumentation() = default;
+
+  //! Time of the events, in nanoseconds (same clock as the tracer).
+  static inline int64_t now() { return Tracer::now(); }
+
+  /**
+   * @brief onPush Producer side, once a value is pushed.
+   * @param depth Nr of values in the queue after the push.
+   * @param push_ns Time of the push.
+   * @param blocked_since_ns Time the producer started waiting for room, or
+   * kNotWaited.
+   */
+  void onPush(const size_t& depth,
+              const int64_t& push_ns,
+              const int64_t& blocked_since_ns = kNotWaited);
+
+  /**
+   * @brief onPop Consumer side, once a value is popped.
+   * @param depth Nr of values in the queue after the pop.
+   * @param pushed_ns Time the value was pushed.
+   * @param waiting_since_ns Time the consumer started waiting for a value, or
+   * kNotWaited.
+   */
+  void onPop(const size_t& depth,
+             const int64_t& pushed_ns,
+             const int64_t& waiting_since_ns = kNotWaited);
+
+  inline uint64_t getNrPushes() const { return nr_pushes_; }
+  inline uint64_t getNrPops() const { return nr_pops_; }
+  inline size_t getMaxDepth() const { return max_depth_; }
+
+ private:
+  void updateDepth(const size_t& depth, const int64_t& time_ns);
+
+ private:
+  //! Interned, as the tracer only keeps pointers to the names.
+  const char* depth_trace_name_;
+  const char* push_blocked_trace_name_;
+  const char* pop_wait_trace_name_;
+
+  std::atomic<uint64_t> nr_pushes_;
+  std::atomic<uint64_t> nr_pops_;
+  std::atomic<size_t> max_depth_;
+
+  StatsCollector push_blocked_stats_;
+  StatsCollector pop_wait_stats_;
+  StatsCollector time_in_queue_stats_;
+  StatsCollector depth_stats_;
+};
+
+}  // namespace utils
+
+}  // namespace VIO
@@ -0,0 +1,224 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   RingBuffer.h
+ * @brief  Fixed-capacity ring buffer keeping the last values pushed.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+namespace internal {
+constexpr size_t nextPowerOfTwo(size_t n) {
+  size_t power = 1u;
+  while (power < n) power <<= 1u;
+  return power;
+}
+}  // namespace internal
+
+//! Capacity of a RingBuffer given at construction instead of at compile time.
+static constexpr size_t kDynamicCapacity = 0u;
+
+/**
+ * @brief The RingBuffer class keeps the last capacity values pushed: pushing
+ * to a full buffer drops the oldest value. Values are indexed and iterated
+ * from the oldest to the newest.
+ *
+ * The storage size is the capacity rounded up to a power of two, so that
+ * wrapping around is a mask instead of a branch or a modulo. With a capacity
+ * known at compile time, the storage is in place and cache line aligned (no
+ * allocation, no indirection); with kDynamicCapacity it is allocated once at
+ * construction. ranges() exposes the values as (at most) two contiguous
+ * arrays, for reductions the compiler can vectorize.
+ *
+ * Not thread-safe: ThreadsafeSpscQueue is the lock-free ring buffer for a
+ * single producer and a single consumer thread.
+ */
+template <typename T, size_t Capacity = kDynamicCapacity>
+class RingBuffer {
+ public:
+  using value_type = T;
+  static constexpr size_t kStorageSize = internal::nextPowerOfTwo(Capacity);
+
+  //! Contiguous values, oldest first.
+  struct Range {
+    const T* data;
+    size_t size;
+  };
+
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = T;
+    using pointer = const T*;
+    using reference = const T&;
+
+    Iterator(const RingBuffer* buffer, size_t index)
+        : buffer_(buffer), index_(index) {}
+
+    inline reference operator*() const { return (*buffer_)[index_]; }
+    inline pointer operator->() const { return &(*buffer_)[index_]; }
+    inline Iterator& operator++() {
+      ++index_;
+      return *this;
+    }
+    inline Iterator operator++(int) {
+      Iterator tmp = *this;
+      ++index_;
+      return tmp;
+    }
+    inline friend bool operator==(const Iterator& a, const Iterator& b) {
+      DCHECK_EQ(a.buffer_, b.buffer_);
+      return a.index_ == b.index_;
+    }
+    inline friend bool operator!=(const Iterator& a, const Iterator& b) {
+      return !(a == b);
+    }
+
+   private:
+    const RingBuffer* buffer_;
+    //! From the oldest value.
+    size_t index_;
+  };
+
+  //! For a capacity known at compile time.
+  RingBuffer() : capacity_(Capacity), mask_(kStorageSize - 1u) {
+    static_assert(Capacity != kDynamicCapacity,
+                  "Give the capacity of the buffer at construction.");
+  }
+
+  //! For a capacity given at run time (Capacity = kDynamicCapacity).
+  explicit RingBuffer(size_t capacity)
+      : capacity_(capacity),
+        mask_(internal::nextPowerOfTwo(capacity) - 1u),
+        values_(mask_ + 1u) {
+    static_assert(Capacity == kDynamicCapacity,
+                  "The capacity of the buffer is a template parameter.");
+    CHECK_GT(capacity, 0u);
+  }
+
+  /**
+   * @brief reset the buffer to be empty
+   */
+  inline void clear() {
+    head_ = 0u;
+    size_ = 0u;
+  }
+
+  /**
+   * @brief get the element at the index specified, from the oldest one
+   * @note no bounds checking is performed in release
+   */
+  inline const T& operator[](size_t index) const {
+    DCHECK_LT(index, size_);
+    return values_[(head_ + index) & mask_];
+  }
+
+  /**
+   * @brief get the current number of elements in the buffer
+   */
+  inline size_t size() const { return size_; }
+
+  /**
+   * @brief get the maximum number of elements in the buffer
+   */
+  inline size_t capacity() const { return capacity_; }
+
+  /**
+   * @brief get whether the buffer is full
+   */
+  inline bool full() const { return size_ == capacity_; }
+
+  /**
+   * @brief get whether the buffer is empty
+   */
+  inline bool empty() const { return size_ == 0u; }
+
+  /**
+   * @brief add a new value at the end of the buffer.
+   * @note will drop the earliest value if the buffer is full
+   */
+  inline void push(const T& value) {
+    // The storage is larger or equal than the capacity: the slot after the
+    // newest value is never the oldest one, except when they are equal.
+    values_[(head_ + size_) & mask_] = value;
+    if (size_ < capacity_) {
+      ++size_;
+    } else {
+      head_ = (head_ + 1u) & mask_;
+    }
+  }
+
+  /**
+   * @brief get an iterator at the first element
+   */
+  inline Iterator begin() const { return Iterator(this, 0u); }
+
+  /**
+   * @brief get an iterator past the last element
+   */
+  inline Iterator end() const { return Iterator(this, size_); }
+
+  /**
+   * @brief get the first (oldest) element; the buffer must not be empty
+   */
+  inline const T& front() const { return (*this)[0u]; }
+
+  /**
+   * @brief get the last (newest) element; the buffer must not be empty
+   */
+  inline const T& back() const { return (*this)[size_ - 1u]; }
+
+  /**
+   * @brief get the values as two contiguous ranges, the second one being
+   * empty if the values do not wrap around the end of the storage.
+   */
+  inline std::array<Range, 2> ranges() const {
+    const size_t first_size = std::min(size_, mask_ + 1u - head_);
+    return {{{values_.data() + head_, first_size},
+             {values_.data(), size_ - first_size}}};
+  }
+
+  /**
+   * @brief display buffer statistics
+   */
+  friend std::ostream& operator<<(std::ostream& out, const RingBuffer& buffer) {
+    out << "buffer<(head=" << buffer.head_ << ", size=" << buffer.size_
+        << ", max_size=" << buffer.capacity_ << ")>";
+    return out;
+  }
+
+ private:
+  using Storage = std::conditional_t<Capacity == kDynamicCapacity,
+                                     std::vector<T>,
+                                     std::array<T, kStorageSize>>;
+
+  size_t capacity_;
+  size_t mask_;
+  //! Storage index of the oldest value.
+  size_t head_ = 0u;
+  size_t size_ = 0u;
+  alignas(Capacity == kDynamicCapacity ? alignof(Storage) : 64u)
+      Storage values_;
+};
+
+}  // namespace VIO
@@ -0,0 +1,172 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   SimdKernels.h
+ * @brief  Registry of the vectorized kernels, with one implementation per
+ * instruction set, selected at run time for the CPU.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+namespace utils {
+
+//! Instruction set extensions the kernels can use (bit flags).
+typedef uint32_t CpuFeatures;
+static constexpr CpuFeatures kCpuScalar = 0u;
+static constexpr CpuFeatures kCpuPopcnt = 1u << 0;
+static constexpr CpuFeatures kCpuAvx2 = 1u << 1;
+static constexpr CpuFeatures kCpuAvx512Vl = 1u << 2;
+static constexpr CpuFeatures kCpuAvx512Vpopcntdq = 1u << 3;
+static constexpr CpuFeatures kCpuNeon = 1u << 4;
+
+/**
+ * @brief detectCpuFeatures Features of the CPU running the program (and
+ * enabled by the OS), detected at the first call. NEON is part of the ARM
+ * targets it is compiled for.
+ */
+CpuFeatures detectCpuFeatures();
+
+//! E.g. "popcnt avx2", or "none".
+std::string cpuFeaturesToString(const CpuFeatures& features);
+
+template <typename Function>
+struct KernelImplementation {
+  std::string name;
+  //! Features the implementation needs to run.
+  CpuFeatures required_features;
+  Function function;
+};
+
+/**
+ * @brief selectKernel Best implementation runnable with the given features.
+ * @param implementations Best first, the last one being the scalar reference
+ * (no required features).
+ */
+template <typename Function>
+const KernelImplementation<Function>& selectKernel(
+    const std::vector<KernelImplementation<Function>>& implementations,
+    const CpuFeatures& features) {
+  CHECK(!implementations.empty());
+  CHECK_EQ(implementations.back().required_features, kCpuScalar);
+  for (const KernelImplementation<Function>& implementation :
+       implementations) {
+    if ((implementation.required_features & features) ==
+        implementation.required_features) {
+      return implementation;
+    }
+  }
+  return implementations.back();
+}
+
+/**
+ * @brief The PointWarp struct maps image points through a homography, e.g.
+ * the infinite homography of a rotation:
+ * - Without distortion (k1 = k2 = 0), the homography H is applied to the
+ *   pixels and the intrinsics are unused.
+ * - Otherwise, the pixels are normalized with the intrinsics and undistorted
+ *   with the radial model r_d = r * (1 + k1 r^2 + k2 r^4) (a fixed number of
+ *   fixed-point iterations), mapped by H in normalized coordinates, and
+ *   distorted and projected back to pixels.
+ * Points mapped behind the camera or outside [0, width) x [0, height) keep
+ * their source position.
+ */
+struct PointWarp {
+  //! Row-major homography.
+  float H[9] = {1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f};
+  float k1 = 0.0f;
+  float k2 = 0.0f;
+  float fx = 1.0f;
+  float fy = 1.0f;
+  float cx = 0.0f;
+  float cy = 0.0f;
+  float width = 0.0f;
+  float height = 0.0f;
+};
+
+/**
+ * @brief The SimdKernels class holds, for each kernel, the implementations
+ * compiled in this binary (AVX2/AVX-512 on x86 through function target
+ * attributes, so no -march flag is needed, NEON on ARM, and a scalar
+ * reference) and the one selected for the CPU at the first call to get().
+ * Set --disable_simd_kernels to run the scalar references instead.
+ */
+class SimdKernels {
+ public:
+  //! Reduction of two 8-bit arrays of length n.
+  typedef uint32_t (*RowFunction)(const uint8_t* a,
+                                  const uint8_t* b,
+                                  int n);
+  //! Distance between two 256-bit descriptors.
+  typedef uint32_t (*DescriptorFunction)(const uint8_t* a, const uint8_t* b);
+  //! Back-projection of a row of n depths [m]: xyz[3i..3i+2] =
+  //! (ray_x[i] * depth[i], ray_y * depth[i], depth[i]), or NaNs if the depth
+  //! is not finite.
+  typedef void (*DepthRowFunction)(const float* depth,
+                                   const float* ray_x,
+                                   float ray_y,
+                                   int n,
+                                   float* xyz);
+  //! Warp of n points (interleaved x, y) by the given PointWarp. src_xy and
+  //! dst_xy may be the same array.
+  typedef void (*WarpPointsFunction)(const float* src_xy,
+                                     const PointWarp& warp,
+                                     int n,
+                                     float* dst_xy);
+
+  static const SimdKernels& get();
+
+  //! Sum of squared differences.
+  static const std::vector<KernelImplementation<RowFunction>>&
+  ssdRowImplementations();
+  //! Dot product.
+  static const std::vector<KernelImplementation<RowFunction>>&
+  dotRowImplementations();
+  //! Hamming distance.
+  static const std::vector<KernelImplementation<DescriptorFunction>>&
+  orbHammingDistanceImplementations();
+  //! Depth row back-projection.
+  static const std::vector<KernelImplementation<DepthRowFunction>>&
+  depthRowToPointsImplementations();
+  //! Point warp.
+  static const std::vector<KernelImplementation<WarpPointsFunction>>&
+  warpPointsImplementations();
+
+  //! CPU features and the implementation selected for each kernel.
+  std::string print() const;
+
+ public:
+  CpuFeatures cpu_features;
+  RowFunction ssd_row;
+  RowFunction dot_row;
+  DescriptorFunction orb_hamming_distance;
+  DepthRowFunction depth_row_to_points;
+  WarpPointsFunction warp_points;
+
+ private:
+  explicit SimdKernels(const CpuFeatures& features);
+
+  std::string ssd_row_name_;
+  std::string dot_row_name_;
+  std::string orb_hamming_distance_name_;
+  std::string depth_row_to_points_name_;
+  std::string warp_points_name_;
+};
+
+}  // namespace utils
+
+}  // namespace VIO
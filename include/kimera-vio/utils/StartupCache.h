@@ -0,0 +1,121 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   StartupCache.h
+ * @brief  On-disk cache of the data precomputed at startup from the params
+ * (e.g. undistortion maps), to skip computing it at the next launch.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The StartupCache class stores, in a single binary file, matrices
+ * derived from the params at startup (stereo rectification, undistortion and
+ * rectification maps...), each entry being keyed by a name and by a hash of
+ * all the inputs it was computed from. Hence a repeated launch with the same
+ * calibration loads them instead of computing them, and a changed calibration
+ * silently computes (and caches) them again.
+ *
+ * The file is memory-mapped: loaded matrices point inside the mapping and
+ * are only read from disk when used. Saving writes the whole file again,
+ * atomically (to a temporary file, then renamed), so that matrices of the
+ * previous mapping stay valid.
+ *
+ * Disabled (get always misses, put does nothing) unless the startup_cache_path
+ * flag is set, or the entries are shared in memory (shareInMemory()): the
+ * pipelines of a process then compute each entry once, and share its
+ * matrices, even without a cache file.
+ */
+class StartupCache {
+ public:
+  KIMERA_POINTER_TYPEDEFS(StartupCache);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(StartupCache);
+
+  //! @param filepath Cache file, disabled if empty.
+  explicit StartupCache(const std::string& filepath);
+  ~StartupCache() = default;
+
+  //! Process-wide cache at the startup_cache_path flag.
+  static StartupCache& getInstance();
+
+  inline bool isEnabled() const {
+    return !filepath_.empty() || share_in_memory_;
+  }
+
+  //! Keeps the entries in memory even without a cache file.
+  inline void shareInMemory() { share_in_memory_ = true; }
+
+  /**
+   * @brief get Matrices of the entry key, if it was computed from inputs with
+   * the given hash.
+   * @return False if there is no such entry.
+   */
+  bool get(const std::string& key,
+           const uint64_t& hash,
+           std::vector<cv::Mat>* mats);
+
+  /**
+   * @brief put Adds (or replaces) the entry key, and saves the cache file.
+   * @return False if the cache is disabled or the file could not be written
+   * (true without cache file if shared in memory).
+   */
+  bool put(const std::string& key,
+           const uint64_t& hash,
+           const std::vector<cv::Mat>& mats);
+
+  // FNV-1a hashes, to chain the inputs of an entry, e.g.:
+  //   hash(mat_b, hash(mat_a))
+  static constexpr uint64_t kHashSeed = 14695981039346656037ull;
+  static uint64_t hash(const void* data,
+                       const size_t& size,
+                       const uint64_t& seed = kHashSeed);
+  //! Hashes the size, type and values of the matrix.
+  static uint64_t hash(const cv::Mat& mat, const uint64_t& seed = kHashSeed);
+  template <typename T>
+  static inline uint64_t hashValue(const T& value,
+                                   const uint64_t& seed = kHashSeed) {
+    return hash(&value, sizeof(T), seed);
+  }
+
+ private:
+  struct Entry {
+    uint64_t hash_;
+    std::vector<cv::Mat> mats_;
+  };
+
+  //! Loads the entries of the cache file, if any. Requires the lock.
+  void loadIfNeeded();
+
+  //! Requires the lock.
+  bool save() const;
+
+ private:
+  const std::string filepath_;
+  std::atomic_bool share_in_memory_;
+  std::mutex mutex_;
+  bool loaded_;
+  std::map<std::string, Entry> entries_;
+};
+
+}  // namespace VIO
@@ -29,10 +29,16 @@
  */
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
 #include <map>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "kimera-vio/utils/Accumulator.h"
@@ -48,6 +54,13 @@
 // distance_stat.AddSample(my_distance);
 //
 // std::cout << utils::Statistics::Print();
+//
+// Samples go to a buffer of the calling thread without locking, and are
+// merged into the statistics periodically by a background thread, or when
+// queried. In hot loops, also resolve the handle only once:
+//
+// static const utils::StatsCollector stereo_stat("Stereo matching [us]");
+// stereo_stat.AddSample(elapsed_us);
 
 namespace VIO {
 
@@ -55,25 +68,119 @@ namespace utils {
 
 const double kNumSecondsPerNanosecond = 1.e-9;
 
+/**
+ * @brief The QuantileHistogram class gives the percentiles of all the
+ * samples added, in bounded memory: it counts the samples in log-spaced bins
+ * (as an HDR histogram) of relative width kRelativeError. Its bins span the
+ * range of the samples seen, e.g. ~1200 bins for 5 orders of magnitude, and
+ * a sample is added in O(1) (amortized, when the range grows).
+ */
+class QuantileHistogram {
+ public:
+  //! Max relative error of the percentiles.
+  static constexpr double kRelativeError = 0.01;
+
+  //! Non-finite samples are not counted.
+  inline void Add(double sample) {
+    if (!std::isfinite(sample)) return;
+    const int bin = GetBin(sample);
+    if (counts_.empty()) {
+      first_bin_ = bin;
+      counts_.assign(1u, 0);
+    } else if (bin < first_bin_) {
+      counts_.insert(counts_.begin(), first_bin_ - bin, 0);
+      first_bin_ = bin;
+    } else if (bin - first_bin_ >= static_cast<int>(counts_.size())) {
+      counts_.resize(bin - first_bin_ + 1, 0);
+    }
+    ++counts_[bin - first_bin_];
+    ++total_samples_;
+  }
+
+  inline int64_t TotalSamples() const { return total_samples_; }
+  inline size_t NumBins() const { return counts_.size(); }
+
+  //! Nearest-rank percentile in [0, 100], clamped to the given min and max
+  //! of the samples (which are exact).
+  double Percentile(double percentile, double min, double max) const {
+    if (total_samples_ == 0) return 0.0;
+    if (percentile <= 0.0) return min;
+    if (percentile >= 100.0) return max;
+    const double rank = std::ceil(percentile / 100.0 * total_samples_);
+    int64_t count = 0;
+    for (size_t i = 0u; i < counts_.size(); ++i) {
+      count += counts_[i];
+      if (count >= rank) {
+        return std::min(
+            std::max(GetBinValue(first_bin_ + static_cast<int>(i)), min), max);
+      }
+    }
+    return max;
+  }
+
+ private:
+  // Log-spaced bins, signed and ordered like the samples: bin 0 holds
+  // |sample| < kMinAbsValue.
+  static constexpr double kMinAbsValue = 1e-9;
+  //! Bins are clamped to [-kMaxBin, kMaxBin]: the samples above ~1e299 all
+  //! fall in the last bins.
+  static constexpr int kMaxBin = 75000;
+  static inline int GetBin(double sample) {
+    const double abs_sample = std::abs(sample);
+    if (!(abs_sample >= kMinAbsValue)) return 0;
+    // Clamped before the cast: the largest doubles divided by kMinAbsValue
+    // overflow to infinity.
+    const double log_bin =
+        std::log(abs_sample / kMinAbsValue) / std::log1p(kRelativeError);
+    const int bin = 1 + static_cast<int>(std::min(log_bin, kMaxBin - 1.0));
+    return sample > 0.0 ? bin : -bin;
+  }
+  static inline double GetBinValue(int bin) {
+    if (bin == 0) return 0.0;
+    // Geometric center of the bin.
+    const double abs_value =
+        kMinAbsValue * std::pow(1.0 + kRelativeError, std::abs(bin) - 0.5);
+    return bin > 0 ? abs_value : -abs_value;
+  }
+
+ private:
+  //! Nr of samples of the bins [first_bin_, first_bin_ + counts_.size()).
+  std::vector<int64_t> counts_;
+  int first_bin_ = 0;
+  int64_t total_samples_ = 0;
+};
+
 struct StatisticsMapValue {
   static const int kWindowSize = 100;
+  //! Max relative error of the percentiles, over all the samples.
+  static constexpr double kPercentileRelativeError =
+      QuantileHistogram::kRelativeError;
 
   inline StatisticsMapValue() {
     time_last_called_ = std::chrono::system_clock::now();
   }
 
   inline void AddValue(double sample) {
-    std::chrono::time_point<std::chrono::system_clock> now =
-        std::chrono::system_clock::now();
-    double dt = static_cast<double>(
-                    std::chrono::duration_cast<std::chrono::nanoseconds>(
-                        now - time_last_called_)
-                        .count()) *
-                kNumSecondsPerNanosecond;
-    time_last_called_ = now;
+    AddValue(sample, std::chrono::system_clock::now());
+  }
+  //! For samples taken at a given time. Samples older than the last one
+  //! (taken concurrently by another thread) count as taken at the same time.
+  inline void AddValue(
+      double sample,
+      const std::chrono::time_point<std::chrono::system_clock>& time) {
+    double dt = 0.0;
+    if (time > time_last_called_) {
+      dt = static_cast<double>(
+               std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   time - time_last_called_)
+                   .count()) *
+           kNumSecondsPerNanosecond;
+      time_last_called_ = time;
+    }
 
     values_.Add(sample);
     time_deltas_.Add(dt);
+    quantiles_.Add(sample);
   }
   inline double GetLastDeltaTime() const {
     if (time_deltas_.total_samples()) {
@@ -95,9 +202,10 @@ struct StatisticsMapValue {
   double RollingMean() const { return values_.RollingMean(); }
   double Max() const { return values_.max(); }
   double Min() const { return values_.min(); }
-  double Median() const { return values_.median(); }
-  double Q1() const { return values_.q1(); }
-  double Q3() const { return values_.q3(); }
+  //! Of all the samples, as the percentiles.
+  double Median() const { return Percentile(50.0); }
+  double Q1() const { return Percentile(25.0); }
+  double Q3() const { return Percentile(75.0); }
   double LazyVariance() const { return values_.LazyVariance(); }
   double MeanCallsPerSec() const {
     double mean_dt = time_deltas_.Mean();
@@ -115,11 +223,18 @@ struct StatisticsMapValue {
   double LazyVarianceDeltaTime() const { return time_deltas_.LazyVariance(); }
   std::vector<double> GetAllValues() const { return values_.GetAllSamples(); }
 
+  //! Nearest-rank percentile in [0, 100] of all the samples (not only of the
+  //! window), up to kPercentileRelativeError.
+  double Percentile(double percentile) const {
+    return quantiles_.Percentile(percentile, Min(), Max());
+  }
+
 private:
   // Create an accumulator with specified window size.
   Accumulator<double, double, kWindowSize> values_;
   Accumulator<double, double, kWindowSize> time_deltas_;
   std::chrono::time_point<std::chrono::system_clock> time_last_called_;
+  QuantileHistogram quantiles_;
 };
 
 // A class that has the statistics interface but does nothing. Swapping this in
@@ -148,9 +263,25 @@ class StatsCollectorImpl {
   size_t handle_;
 };
 
+//! Summary of one statistic at the time of Statistics::GetSnapshot.
+struct StatisticSnapshot {
+  std::string tag;
+  size_t num_samples = 0u;
+  double sum = 0.0;
+  double last = 0.0;
+  double min = 0.0;
+  double max = 0.0;
+  double hz = 0.0;
+  //! Values of the kSnapshotQuantiles, in the same order.
+  std::vector<double> quantiles;
+};
+
 class Statistics {
  public:
   typedef std::map<std::string, size_t> map_t;
+  //! Quantiles (in [0, 1]) summarized by GetSnapshot.
+  static constexpr std::array<double, 4> kSnapshotQuantiles{
+      {0.5, 0.95, 0.99, 0.999}};
   friend class StatsCollectorImpl;
   // Definition of static functions to query the stats.
   static size_t GetHandle(std::string const& tag);
@@ -178,6 +309,9 @@ class Statistics {
   static double GetQ1(std::string const &tag);
   static double GetQ3(size_t handle);
   static double GetQ3(std::string const &tag);
+  //! Percentile in [0, 100] of all the samples, e.g. 99 for p99.
+  static double GetPercentile(size_t handle, double percentile);
+  static double GetPercentile(std::string const& tag, double percentile);
   static double GetHz(size_t handle);
   static double GetHz(std::string const& tag);
 
@@ -199,12 +333,34 @@ class Statistics {
   static void Print(std::ostream& out);  // NOLINT
   static std::string Print();
   static std::string SecondsToTimeString(double seconds);
+  //! Summaries of all the statistics with samples, sorted by tag, taken at
+  //! once: samples are added without locking meanwhile, only the aggregator
+  //! and other queries wait.
+  static std::vector<StatisticSnapshot> GetSnapshot();
   static void Reset();
   static const map_t& GetStatsCollectors() { return Instance().tag_map_; }
 
  private:
+  //! Per-thread lock-free buffer of samples, defined in Statistics.cpp.
+  class ThreadBuffer;
+
+  struct Sample {
+    size_t handle = 0u;
+    double value = 0.0;
+    std::chrono::time_point<std::chrono::system_clock> time;
+  };
+
+  //! Adds the sample to the buffer of the calling thread: no lock is taken,
+  //! unless the buffer is full.
   void AddSample(size_t handle, double sample);
 
+  //! Merges the samples of all thread buffers into the stats collectors, in
+  //! the order they were taken. The mutex must be locked.
+  void FlushThreadBuffers();
+
+  //! Background thread flushing the thread buffers periodically.
+  void SpinAggregator();
+
   static Statistics& Instance();
 
   Statistics();
@@ -216,6 +372,15 @@ class Statistics {
   map_t tag_map_;
   size_t max_tag_length_;
   std::mutex mutex_;
+
+  //! Buffers of the threads that added samples, and scratch to sort the
+  //! samples flushed from them. Guarded by mutex_.
+  std::vector<ThreadBuffer*> thread_buffers_;
+  std::vector<Sample> flushed_samples_;
+
+  std::condition_variable aggregator_cond_;
+  bool shutdown_aggregator_;
+  std::thread aggregator_;
 };
 
 // TODO make this a gflag?
@@ -0,0 +1,103 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   TaskGraph.h
+ * @brief  Runs the tasks of a small dependency graph on a pool of threads.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+namespace utils {
+
+/**
+ * @brief The TaskGraph class runs a set of tasks, each one once all the
+ * tasks it depends on have finished, so that independent tasks overlap. It
+ * is meant for the stages of a single frame: the graph is built, run, and
+ * built again for the next frame, while the threads live as long as the
+ * graph.
+ *
+ * The thread calling run() executes tasks too: with N threads, up to N + 1
+ * tasks run at once. With no threads, the tasks run one after the other in
+ * the order they were added, i.e. as the equivalent sequential code would.
+ *
+ * Tasks run in other threads than the one adding them, but run() waits for
+ * all of them: they may reference the caller's locals. Tasks that may run at
+ * the same time must not write the same data.
+ */
+class TaskGraph {
+ public:
+  KIMERA_POINTER_TYPEDEFS(TaskGraph);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(TaskGraph);
+  using Task = std::function<void()>;
+  using TaskId = size_t;
+
+  explicit TaskGraph(const size_t& nr_threads);
+  //! Joins the threads, which must not be running a graph.
+  virtual ~TaskGraph();
+
+  /**
+   * @brief addTask Adds a task to the graph of the next run().
+   * @param dependencies Tasks added before this one that must finish before
+   * it starts (hence the graph has no cycles).
+   */
+  TaskId addTask(Task task, const std::vector<TaskId>& dependencies = {});
+
+  /**
+   * @brief run Runs the tasks added since the last run and waits for them,
+   * then clears the graph. If a task throws, the tasks depending on it are
+   * skipped and the first exception is rethrown once the others finished.
+   */
+  void run();
+
+  inline size_t getNrThreads() const { return threads_.size(); }
+
+ private:
+  struct Node {
+    Task task;
+    std::vector<TaskId> dependents;
+    size_t nr_pending_dependencies;
+    //! A task it depends on threw: it is not run.
+    bool skipped;
+  };
+
+  void workerLoop();
+
+  //! Runs the task and releases its dependents. Locks the mutex in between.
+  void runTask(const TaskId& task_id, std::unique_lock<std::mutex>* lock);
+
+ private:
+  std::vector<Node> nodes_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<TaskId> ready_tasks_;
+  size_t nr_unfinished_tasks_;
+  std::exception_ptr exception_;
+  bool shutdown_;
+
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace utils
+
+}  // namespace VIO
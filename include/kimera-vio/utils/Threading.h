@@ -0,0 +1,87 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   Threading.h
+ * @brief  CPU affinity of the pipeline threads, and control of the worker
+ * threads GTSAM spawns (if built with TBB).
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+namespace utils {
+
+/**
+ * @brief setThreadAffinity Pins the thread to the given CPUs (Linux only).
+ * @return False if it could not be pinned. True if pinned, or if cpus is
+ * empty (the thread is left untouched).
+ */
+bool setThreadAffinity(std::thread* thread, const std::vector<int>& cpus);
+bool setCurrentThreadAffinity(const std::vector<int>& cpus);
+
+/**
+ * @brief setCurrentThreadLowPriority Lets the thread run only when the CPUs
+ * have nothing else to do (SCHED_IDLE on Linux, else the highest niceness),
+ * for work that must not steal time from the pipeline threads.
+ * @return False if the priority could not be lowered.
+ */
+bool setCurrentThreadLowPriority();
+
+//! E.g. "{0, 1, 3}", or "any" if empty.
+std::string cpusToString(const std::vector<int>& cpus);
+
+/**
+ * @brief The GtsamThreadingControl class limits the number of worker threads
+ * of GTSAM's TBB scheduler, and pins them to the given CPUs, for as long as
+ * it lives. Without TBB, GTSAM is single threaded and this does nothing.
+ */
+class GtsamThreadingControl {
+ public:
+  KIMERA_POINTER_TYPEDEFS(GtsamThreadingControl);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(GtsamThreadingControl);
+
+  /**
+   * @param max_nr_threads Max number of threads running GTSAM's parallel
+   * algorithms (including the calling thread), 0 for TBB's default.
+   * @param cpus CPUs of TBB's worker threads, any if empty.
+   */
+  GtsamThreadingControl(const int& max_nr_threads,
+                        const std::vector<int>& cpus);
+  ~GtsamThreadingControl();
+
+  /**
+   * @brief setMaxNrThreads Changes the max number of threads at runtime (e.g.
+   * with the execution profile): the parallel algorithms started afterwards
+   * use it. Thread-safe.
+   * @param max_nr_threads 0 for TBB's default.
+   */
+  void setMaxNrThreads(const int& max_nr_threads);
+
+  static bool isTbbEnabled();
+
+  //! Max number of threads TBB currently allows (1 without TBB).
+  static size_t getMaxNrThreads();
+
+ private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace utils
+
+}  // namespace VIO
@@ -53,17 +53,11 @@ inline void ThreadsafeImuBuffer::addMeasurement(
     const Timestamp& timestamp_nanoseconds,
     const ImuAccGyr& imu_measurement) {
   // Enforce strict time-wise ordering.
-  ImuMeasurement last_value;
-  if (buffer_.getNewestValue(&last_value)) {
-    if (timestamp_nanoseconds <= last_value.timestamp_) {
-      LOG_FIRST_N(WARNING, 1) << "Imu timestamps not strictly increasing";
-      VLOG(10) << "Timestamps not strictly increasing";
-      return;
-    }
+  if (!buffer_.addValue(timestamp_nanoseconds, imu_measurement)) {
+    LOG_FIRST_N(WARNING, 1) << "Imu timestamps not strictly increasing";
+    VLOG(10) << "Timestamps not strictly increasing";
+    return;
   }
-  buffer_.addValue(
-      timestamp_nanoseconds,
-      ImuMeasurement(timestamp_nanoseconds, imu_measurement));
 
   // Notify possibly waiting consumers.
   cv_new_measurement_.notify_all();
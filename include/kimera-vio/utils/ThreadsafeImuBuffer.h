@@ -44,7 +44,7 @@
 
 #include "kimera-vio/common/vio_types.h"
 #include "kimera-vio/imu-frontend/ImuFrontend-definitions.h"
-#include "kimera-vio/utils/ThreadsafeTemporalBuffer.h"
+#include "kimera-vio/utils/ThreadsafeTemporalRingBuffer.h"
 
 namespace VIO {
 
@@ -192,9 +192,9 @@ class ThreadsafeImuBuffer {
   QueryResult isDataAvailableUpToImpl(const Timestamp& timestamp_ns_from,
                                       const Timestamp& timestamp_ns_to) const;
 
-  typedef std::pair<const Timestamp, ImuMeasurement> BufferElement;
-  typedef Eigen::aligned_allocator<BufferElement> BufferAllocator;
-  typedef ThreadsafeTemporalBuffer<ImuMeasurement, BufferAllocator> Buffer;
+  //! Contiguous storage: queries are binary searches and copy Eigen blocks.
+  //! Queries never block addMeasurement, nor each other (seqlock).
+  typedef ThreadsafeTemporalRingBuffer<6> Buffer;
 
   Buffer buffer_;
   mutable std::mutex m_buffer_;
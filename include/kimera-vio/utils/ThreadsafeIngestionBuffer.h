@@ -0,0 +1,135 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ThreadsafeIngestionBuffer.h
+ * @brief  Buffer between a sensor driver thread and the thread consuming its
+ * measurements, which never blocks the driver on the consumer.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/Statistics.h"
+#include "kimera-vio/utils/ThreadsafeSpscQueue.h"
+
+namespace VIO {
+
+/**
+ * @brief The ThreadsafeIngestionBuffer class takes the measurements of a
+ * high-rate sensor (e.g. IMU at 400-1000Hz) from the driver thread, and hands
+ * them in bulk to the consumer, which moves them to its own buffer (e.g. the
+ * ThreadsafeImuBuffer) when it needs them. Hence the driver does not take the
+ * lock of the consumer's buffer at each measurement, and is never blocked
+ * while the consumer holds it.
+ *
+ * Measurements go through a ThreadsafeSpscQueue: a push only touches atomic
+ * indices. If the consumer falls behind and the ring fills up (e.g. a dataset
+ * sending all its IMU data before the first frame), the producer appends the
+ * measurements to an overflow vector instead, under a mutex that is only
+ * contended by the consumer while draining. Nothing is dropped, and the
+ * consumer gets the measurements in the order they were pushed.
+ *
+ * push must only be called from one producer thread, drain from one consumer
+ * thread.
+ */
+template <typename T>
+class ThreadsafeIngestionBuffer {
+ public:
+  KIMERA_POINTER_TYPEDEFS(ThreadsafeIngestionBuffer);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(ThreadsafeIngestionBuffer);
+
+  //! @param capacity Nr of measurements in the ring, rounded up to a power
+  //! of two.
+  explicit ThreadsafeIngestionBuffer(const std::string& buffer_id,
+                                     const size_t& capacity = 1024u)
+      : ring_(buffer_id, capacity),
+        overflowing_(false),
+        overflow_mutex_(),
+        overflow_(),
+        overflow_stats_(buffer_id + " Overflow [#]") {}
+  ~ThreadsafeIngestionBuffer() = default;
+
+  //! Producer thread only. Returns false if the buffer has been shutdown.
+  bool push(T value);
+
+  /**
+   * @brief drain Consumer thread only. Calls sink(T&&) on all measurements
+   * pushed so far, in order.
+   * @return Nr of measurements drained.
+   */
+  template <typename Sink>
+  size_t drain(Sink sink);
+
+  void shutdown() { ring_.shutdown(); }
+
+  bool isShutdown() const { return ring_.isShutdown(); }
+
+  bool empty() const { return ring_.empty() && !overflowing_; }
+
+ private:
+  ThreadsafeSpscQueue<T> ring_;
+  //! Set by the producer when the ring is full: until the consumer drains
+  //! the overflow, the producer only pushes to it, so that the measurements
+  //! in the ring are older than the overflowing ones.
+  std::atomic_bool overflowing_;
+  std::mutex overflow_mutex_;
+  std::vector<T> overflow_;
+  utils::StatsCollector overflow_stats_;
+};
+
+template <typename T>
+bool ThreadsafeIngestionBuffer<T>::push(T value) {
+  if (ring_.isShutdown()) return false;
+  if (!overflowing_.load(std::memory_order_acquire) &&
+      ring_.pushIfNotFull(value)) {
+    return true;
+  }
+  std::lock_guard<std::mutex> lk(overflow_mutex_);
+  // Let the consumer know it has to drain the overflow too.
+  overflowing_.store(true, std::memory_order_release);
+  overflow_.push_back(std::move(value));
+  return true;
+}
+
+template <typename T>
+template <typename Sink>
+size_t ThreadsafeIngestionBuffer<T>::drain(Sink sink) {
+  size_t nr_drained = 0u;
+  T value;
+  while (ring_.pop(value)) {
+    sink(std::move(value));
+    ++nr_drained;
+  }
+  if (!overflowing_.load(std::memory_order_acquire)) return nr_drained;
+
+  std::lock_guard<std::mutex> lk(overflow_mutex_);
+  // The producer does not push to the ring while overflowing, so the ring
+  // only holds measurements older than the overflowing ones.
+  while (ring_.pop(value)) {
+    sink(std::move(value));
+    ++nr_drained;
+  }
+  overflow_stats_.AddSample(static_cast<double>(overflow_.size()));
+  for (T& overflow_value : overflow_) {
+    sink(std::move(overflow_value));
+    ++nr_drained;
+  }
+  overflow_.clear();
+  overflowing_.store(false, std::memory_order_release);
+  return nr_drained;
+}
+
+}  // namespace VIO
@@ -0,0 +1,104 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ThreadsafeMailbox.h
+ * @brief  Thread Safe Queue that only keeps the latest value.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/Statistics.h"
+#include "kimera-vio/utils/ThreadsafeQueue.h"
+
+namespace VIO {
+
+/**
+ * @brief The ThreadsafeMailbox class is a queue holding at most one value:
+ * pushing while a value is waiting overwrites it, instead of queueing. Hence,
+ * producers never wait for a slow consumer, which only gets the latest value.
+ *
+ * Values that can not be overwritten as a whole (e.g. incremental updates)
+ * can be merged instead: the merge callback is given the stale value and the
+ * new one, and returns the value that replaces them.
+ *
+ * Pops behave like the ones of ThreadsafeQueue.
+ */
+template <typename T>
+class ThreadsafeMailbox : public ThreadsafeQueue<T> {
+ public:
+  using TQB = ThreadsafeQueueBase<T>;
+  KIMERA_POINTER_TYPEDEFS(ThreadsafeMailbox);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(ThreadsafeMailbox);
+  //! Returns the value replacing the stale and the new ones.
+  using MergeCallback = std::function<T(T stale_value, T new_value)>;
+
+  //! @param merge_callback If empty, new values overwrite stale ones.
+  explicit ThreadsafeMailbox(const std::string& queue_id,
+                             const MergeCallback& merge_callback = nullptr)
+      : ThreadsafeQueue<T>(queue_id, false),
+        merge_callback_(merge_callback),
+        overwrites_stats_(queue_id + " Overwrites [#]") {}
+  virtual ~ThreadsafeMailbox() = default;
+
+  //! Never blocks. Returns false if the queue has been shutdown.
+  bool push(T new_value) override;
+
+  //! Same as push: the mailbox is never full.
+  bool pushBlockingIfFull(T new_value, size_t) override {
+    return push(std::move(new_value));
+  }
+
+ public:
+  using TQB::queue_id_;
+
+ private:
+  using TQB::data_cond_;
+  using TQB::data_queue_;
+  using TQB::mutex_;
+  using TQB::shutdown_;
+
+  const MergeCallback merge_callback_;
+  utils::StatsCollector overwrites_stats_;
+};
+
+template <typename T>
+bool ThreadsafeMailbox<T>::push(T new_value) {
+  if (shutdown_) return false;  // atomic, no lock needed.
+  std::unique_lock<std::mutex> lk(mutex_);
+  if (data_queue_.empty()) {
+    data_queue_.push(std::make_shared<T>(std::move(new_value)));
+    lk.unlock();  // Unlock before notify.
+    data_cond_.notify_one();
+    return true;
+  }
+  DCHECK_EQ(data_queue_.size(), 1u);
+  T& stale_value = *data_queue_.front();
+  if (merge_callback_) {
+    stale_value = merge_callback_(std::move(stale_value), std::move(new_value));
+  } else {
+    stale_value = std::move(new_value);
+  }
+  lk.unlock();
+  // The consumer was already notified of the stale value.
+  overwrites_stats_.IncrementOne();
+  VLOG(10) << "Mailbox with id: " << queue_id_ << " overwrote a stale value.";
+  return true;
+}
+
+}  // namespace VIO
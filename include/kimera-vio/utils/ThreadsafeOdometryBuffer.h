@@ -35,11 +35,36 @@ class ThreadsafeOdometryBuffer {
   ThreadsafeOdometryBuffer::QueryResult getNearest(const Timestamp& timestamp,
                                                    gtsam::NavState* odometry);
 
+  /**
+   * @brief getInterpolated Odometry at the timestamp, interpolated between
+   * the measurements around it: pose on SE(3), velocity linearly.
+   */
+  ThreadsafeOdometryBuffer::QueryResult getInterpolated(
+      const Timestamp& timestamp,
+      gtsam::NavState* odometry);
+
+  /**
+   * @brief getRelativePose Pose of the odometry at timestamp_to wrt the one
+   * at timestamp_from (e.g. of two keyframes), both interpolated, in a single
+   * query of the buffer.
+   */
+  ThreadsafeOdometryBuffer::QueryResult getRelativePose(
+      const Timestamp& timestamp_from,
+      const Timestamp& timestamp_to,
+      gtsam::Pose3* from_Pose_to);
+
  private:
   struct Odometry {
     Timestamp timestamp;
     gtsam::NavState value;
   };
+
+  // All queries lock the buffer once, then use these.
+  QueryResult getNearestLocked(const Timestamp& timestamp,
+                               gtsam::NavState* odometry) const;
+  QueryResult getInterpolatedLocked(const Timestamp& timestamp,
+                                    gtsam::NavState* odometry) const;
+
   utils::ThreadsafeTemporalBuffer<Odometry> buffer_;
 };
 
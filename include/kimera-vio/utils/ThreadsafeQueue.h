@@ -17,6 +17,8 @@
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <memory>
 #include <mutex>
 #include <queue>
@@ -27,6 +29,8 @@
 
 #include "kimera-vio/common/vio_types.h"
 #include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/MemoryAccounting.h"
+#include "kimera-vio/utils/QueueInstrumentation.h"
 #include "kimera-vio/utils/Statistics.h"
 
 namespace VIO {
@@ -37,8 +41,13 @@ class ThreadsafeQueueBase {
   KIMERA_POINTER_TYPEDEFS(ThreadsafeQueueBase);
   KIMERA_DELETE_COPY_CONSTRUCTORS(ThreadsafeQueueBase);
   typedef std::queue<std::shared_ptr<T>> InternalQueue;
-  explicit ThreadsafeQueueBase(const std::string& queue_id);
-  virtual ~ThreadsafeQueueBase() = default;
+  //! @param instrument Whether to record the rates, depth and wait times of
+  //! the queue if the instrument_queues flag is set (see
+  //! utils::QueueInstrumentation). False for the queues of the statistics
+  //! themselves.
+  explicit ThreadsafeQueueBase(const std::string& queue_id,
+                               const bool& instrument = true);
+  virtual ~ThreadsafeQueueBase();
 
   /** \brief Push by value. Returns false if the queue has been shutdown.
    * Not optimal, since it will make two move operations.
@@ -130,11 +139,19 @@ class ThreadsafeQueueBase {
   /** \brief Checks if the queue is empty.
    * the state of the queue might change right after this query.
    */
-  bool empty() const {
+  virtual bool empty() const {
     std::lock_guard<std::mutex> lk(mutex_);
     return data_queue_.empty();
   }
 
+  /** \brief Nr of values in the queue.
+   * the state of the queue might change right after this query.
+   */
+  virtual size_t size() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return data_queue_.size();
+  }
+
   /** \brief Checks if the queue is shutdown.
    * the state of the queue might change right after this query.
    */
@@ -143,6 +160,14 @@ class ThreadsafeQueueBase {
     return shutdown_;
   }
 
+  //! Max nr of values the queue ever held (see MemoryAccounting).
+  inline size_t getHighWaterMark() const { return high_water_mark_; }
+
+  //! Null unless the queue is instrumented.
+  inline const utils::QueueInstrumentation* getInstrumentation() const {
+    return instrumentation_.get();
+  }
+
  public:
   std::string queue_id_;
 
@@ -151,6 +176,17 @@ class ThreadsafeQueueBase {
   InternalQueue data_queue_;
   std::condition_variable data_cond_;
   std::atomic_bool shutdown_;  //! flag for signaling queue shutdown.
+  //! Null unless instrumented.
+  const std::unique_ptr<utils::QueueInstrumentation> instrumentation_;
+
+  //! Called by the pushing thread(s), serialized (e.g. under the mutex).
+  inline void updateHighWaterMark(const size_t& queue_size) {
+    if (queue_size > high_water_mark_) high_water_mark_ = queue_size;
+  }
+
+ private:
+  std::atomic<size_t> high_water_mark_;
+  size_t memory_accounting_id_;
 };
 
 template <typename T>
@@ -160,7 +196,8 @@ class ThreadsafeQueue : public ThreadsafeQueueBase<T> {
   KIMERA_POINTER_TYPEDEFS(ThreadsafeQueue);
   KIMERA_DELETE_COPY_CONSTRUCTORS(ThreadsafeQueue);
   explicit ThreadsafeQueue(const std::string& queue_id,
-                           const bool& log_queue_size = true);
+                           const bool& log_queue_size = true,
+                           const bool& instrument = true);
   virtual ~ThreadsafeQueue() = default;
 
   /** \brief Push by value. Returns false if the queue has been shutdown.
@@ -238,14 +275,42 @@ class ThreadsafeQueue : public ThreadsafeQueueBase<T> {
  public:
   using TQB::queue_id_;
 
- private:
+ protected:
   using TQB::data_cond_;
   using TQB::data_queue_;
+  using TQB::instrumentation_;
   using TQB::mutex_;
   using TQB::shutdown_;
 
+ private:
+  //! Under the mutex, if instrumented: records the push of a value.
+  inline int64_t addPushTime() {
+    const int64_t push_ns = utils::QueueInstrumentation::now();
+    push_times_ns_.push_back(push_ns);
+    return push_ns;
+  }
+
+  //! Under the mutex, if instrumented: push time of the popped value.
+  inline int64_t popPushTime() {
+    DCHECK(!push_times_ns_.empty());
+    const int64_t pushed_ns = push_times_ns_.front();
+    push_times_ns_.pop_front();
+    return pushed_ns;
+  }
+
+  //! Under the mutex, if instrumented: time the caller starts waiting, if it
+  //! has to.
+  inline int64_t waitStart(const bool& has_to_wait) const {
+    return has_to_wait ? utils::QueueInstrumentation::now()
+                       : utils::QueueInstrumentation::kNotWaited;
+  }
+
+ private:
   //! Stats on how full the queue gets.
   std::unique_ptr<utils::StatsCollector> queue_size_stats_;
+  //! If instrumented, push time of each value in data_queue_, in order.
+  //! Guarded by the mutex.
+  std::deque<int64_t> push_times_ns_;
 };
 
 /**
@@ -258,7 +323,7 @@ class ThreadsafeNullQueue : public ThreadsafeQueue<T> {
   KIMERA_POINTER_TYPEDEFS(ThreadsafeNullQueue);
   KIMERA_DELETE_COPY_CONSTRUCTORS(ThreadsafeNullQueue);
   explicit ThreadsafeNullQueue(const std::string& queue_id)
-      : ThreadsafeQueue<T>(queue_id) {}
+      : ThreadsafeQueue<T>(queue_id, true, false) {}
   ~ThreadsafeNullQueue() override = default;
 
   //! Do nothing
@@ -275,21 +340,38 @@ class ThreadsafeNullQueue : public ThreadsafeQueue<T> {
 };
 
 template <typename T>
-ThreadsafeQueueBase<T>::ThreadsafeQueueBase(const std::string& queue_id)
+ThreadsafeQueueBase<T>::ThreadsafeQueueBase(const std::string& queue_id,
+                                            const bool& instrument)
     : queue_id_(queue_id),
       mutex_(),
       data_queue_(),
       data_cond_(),
-      shutdown_(false) {}
+      shutdown_(false),
+      instrumentation_(
+          instrument && utils::isQueueInstrumentationEnabled()
+              ? std::make_unique<utils::QueueInstrumentation>(queue_id)
+              : nullptr),
+      high_water_mark_(0u),
+      memory_accounting_id_(
+          utils::MemoryAccounting::getInstance().registerQueue(
+              queue_id, [this]() -> size_t { return high_water_mark_; })) {}
+
+template <typename T>
+ThreadsafeQueueBase<T>::~ThreadsafeQueueBase() {
+  utils::MemoryAccounting::getInstance().unregisterQueue(
+      memory_accounting_id_);
+}
 
 template <typename T>
 ThreadsafeQueue<T>::ThreadsafeQueue(const std::string& queue_id,
-                                    const bool& log_queue_size)
-    : ThreadsafeQueueBase<T>(queue_id),
+                                    const bool& log_queue_size,
+                                    const bool& instrument)
+    : ThreadsafeQueueBase<T>(queue_id, instrument),
       queue_size_stats_(
           log_queue_size
               ? std::make_unique<utils::StatsCollector>(queue_id + " Size [#]")
-              : nullptr) {}
+              : nullptr),
+      push_times_ns_() {}
 
 template <typename T>
 bool ThreadsafeQueue<T>::push(T new_value) {
@@ -297,11 +379,14 @@ bool ThreadsafeQueue<T>::push(T new_value) {
   std::shared_ptr<T> data(std::make_shared<T>(std::move(new_value)));
   std::unique_lock<std::mutex> lk(mutex_);
   data_queue_.push(data);
+  const int64_t push_ns = instrumentation_ ? addPushTime() : 0;
   size_t queue_size = data_queue_.size();
+  TQB::updateHighWaterMark(queue_size);
   lk.unlock();  // Unlock before notify.
   data_cond_.notify_one();
   // Thread-safe so doesn't need external mutex.
   if (queue_size_stats_) queue_size_stats_->AddSample(queue_size);
+  if (instrumentation_) instrumentation_->onPush(queue_size, push_ns);
   VLOG_IF(1, queue_size > 1u) << "Queue with id: " << queue_id_
                               << " is getting full, size: " << queue_size;
   return true;
@@ -313,17 +398,24 @@ bool ThreadsafeQueue<T>::pushBlockingIfFull(T new_value,
   if (shutdown_) return false;  // atomic, no lock needed.
   std::shared_ptr<T> data(std::make_shared<T>(std::move(new_value)));
   std::unique_lock<std::mutex> lk(mutex_);
+  const int64_t blocked_since_ns =
+      instrumentation_ ? waitStart(data_queue_.size() >= max_queue_size) : 0;
   // Wait until the queue has space or shutdown requested.
   data_cond_.wait(lk, [this, max_queue_size] {
     return data_queue_.size() < max_queue_size || shutdown_;
   });
   if (shutdown_) return false;
   data_queue_.push(data);
+  const int64_t push_ns = instrumentation_ ? addPushTime() : 0;
   size_t queue_size = data_queue_.size();
+  TQB::updateHighWaterMark(queue_size);
   lk.unlock();  // Unlock before notify.
   data_cond_.notify_one();
   // Thread-safe so doesn't need external mutex.
   if (queue_size_stats_) queue_size_stats_->AddSample(queue_size);
+  if (instrumentation_) {
+    instrumentation_->onPush(queue_size, push_ns, blocked_since_ns);
+  }
   VLOG_IF(1, queue_size > 1u) << "Queue with id: " << queue_id_
                               << " is getting full, size: " << queue_size;
   return true;
@@ -332,32 +424,48 @@ bool ThreadsafeQueue<T>::pushBlockingIfFull(T new_value,
 template <typename T>
 bool ThreadsafeQueue<T>::popBlocking(T& value) {
   std::unique_lock<std::mutex> lk(mutex_);
+  const int64_t waiting_since_ns =
+      instrumentation_ ? waitStart(data_queue_.empty()) : 0;
   // Wait until there is data in the queue or shutdown requested.
   data_cond_.wait(lk, [this] { return !data_queue_.empty() || shutdown_; });
   // Return false in case shutdown is requested.
   if (shutdown_) return false;
   value = std::move(*data_queue_.front());
   data_queue_.pop();
+  const int64_t pushed_ns = instrumentation_ ? popPushTime() : 0;
+  const size_t queue_size = data_queue_.size();
   lk.unlock();  // Unlock before notify.
   data_cond_.notify_one();
+  if (instrumentation_) {
+    instrumentation_->onPop(queue_size, pushed_ns, waiting_since_ns);
+  }
   return true;
 }
 
 template <typename T>
 std::shared_ptr<T> ThreadsafeQueue<T>::popBlocking() {
   std::unique_lock<std::mutex> lk(mutex_);
+  const int64_t waiting_since_ns =
+      instrumentation_ ? waitStart(data_queue_.empty()) : 0;
   data_cond_.wait(lk, [this] { return !data_queue_.empty() || shutdown_; });
   if (shutdown_) return std::shared_ptr<T>(nullptr);
   std::shared_ptr<T> result = data_queue_.front();
   data_queue_.pop();
+  const int64_t pushed_ns = instrumentation_ ? popPushTime() : 0;
+  const size_t queue_size = data_queue_.size();
   lk.unlock();  // Unlock before notify.
   data_cond_.notify_one();
+  if (instrumentation_) {
+    instrumentation_->onPop(queue_size, pushed_ns, waiting_since_ns);
+  }
   return result;
 }
 
 template <typename T>
 bool ThreadsafeQueue<T>::popBlockingWithTimeout(T& value, size_t duration_ms) {
   std::unique_lock<std::mutex> lk(mutex_);
+  const int64_t waiting_since_ns =
+      instrumentation_ ? waitStart(data_queue_.empty()) : 0;
   // Wait until there is data in the queue, shutdown is requested, or
   // the given time is elapsed...
   data_cond_.wait_for(lk, std::chrono::milliseconds(duration_ms), [this] {
@@ -368,6 +476,12 @@ bool ThreadsafeQueue<T>::popBlockingWithTimeout(T& value, size_t duration_ms) {
   if (shutdown_ || data_queue_.empty()) return false;
   value = std::move(*data_queue_.front());
   data_queue_.pop();
+  if (instrumentation_) {
+    const int64_t pushed_ns = popPushTime();
+    const size_t queue_size = data_queue_.size();
+    lk.unlock();
+    instrumentation_->onPop(queue_size, pushed_ns, waiting_since_ns);
+  }
   return true;
 }
 
@@ -378,8 +492,11 @@ bool ThreadsafeQueue<T>::pop(T& value) {
   if (data_queue_.empty()) return false;
   value = std::move(*data_queue_.front());
   data_queue_.pop();
+  const int64_t pushed_ns = instrumentation_ ? popPushTime() : 0;
+  const size_t queue_size = data_queue_.size();
   lk.unlock();  // Unlock before notify.
   data_cond_.notify_one();
+  if (instrumentation_) instrumentation_->onPop(queue_size, pushed_ns);
   return true;
 }
 
@@ -390,8 +507,11 @@ std::shared_ptr<T> ThreadsafeQueue<T>::pop() {
   if (data_queue_.empty()) return std::shared_ptr<T>(nullptr);
   std::shared_ptr<T> result = data_queue_.front();
   data_queue_.pop();
+  const int64_t pushed_ns = instrumentation_ ? popPushTime() : 0;
+  const size_t queue_size = data_queue_.size();
   lk.unlock();  // Unlock before notify.
   data_cond_.notify_one();
+  if (instrumentation_) instrumentation_->onPop(queue_size, pushed_ns);
   return result;
 }
 
@@ -407,8 +527,14 @@ bool ThreadsafeQueue<T>::batchPop(typename TQB::InternalQueue* output_queue) {
     data_queue_.swap(*output_queue);
     success = true;
   }
+  std::deque<int64_t> pushed_ns;
+  if (instrumentation_) push_times_ns_.swap(pushed_ns);
   lk.unlock();  // Unlock before notify.
   data_cond_.notify_one();
+  // All popped at once: the depth drops to zero.
+  for (const int64_t& value_pushed_ns : pushed_ns) {
+    instrumentation_->onPop(0u, value_pushed_ns);
+  }
   return success;
 }
 
@@ -0,0 +1,197 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ThreadsafeRendezvousBuffer.h
+ * @brief  Thread Safe buffer of values indexed by timestamp, where a consumer
+ * waits for the value of a given timestamp.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/Statistics.h"
+
+namespace VIO {
+
+/**
+ * @brief The ThreadsafeRendezvousBuffer class synchronizes a consumer with a
+ * producer that runs ahead of it (e.g. the Mesher with the Frontend output,
+ * given the Backend output): the consumer asks for the value at a timestamp,
+ * and is woken up as soon as it is pushed, instead of popping and comparing
+ * values one at a time (see SimpleQueueSynchronizer).
+ *
+ * Producers must push values in increasing timestamp order: a value newer
+ * than the requested timestamp means the requested one will never arrive.
+ * Finding a value evicts it together with all the older ones, since the
+ * consumer also asks for timestamps in increasing order.
+ */
+template <typename T>
+class ThreadsafeRendezvousBuffer {
+ public:
+  KIMERA_POINTER_TYPEDEFS(ThreadsafeRendezvousBuffer);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(ThreadsafeRendezvousBuffer);
+
+  enum class QueryResult {
+    //! The value was found and moved out of the buffer.
+    kFound,
+    //! A newer value was pushed instead: it will never be found.
+    kMissed,
+    kTimeout,
+    kShutdown,
+  };
+
+  explicit ThreadsafeRendezvousBuffer(const std::string& buffer_id)
+      : buffer_id_(buffer_id),
+        mutex_(),
+        data_cond_(),
+        buffer_(),
+        newest_timestamp_(std::numeric_limits<Timestamp>::min()),
+        shutdown_(false),
+        evictions_stats_(buffer_id + " Evictions [#]") {}
+  ~ThreadsafeRendezvousBuffer() = default;
+
+  //! Never blocks. Returns false if the buffer has been shutdown.
+  bool push(const Timestamp& timestamp, T value);
+
+  /**
+   * @brief Waits until the value at the given timestamp is pushed, and moves
+   * it to value. Values older than the timestamp are evicted, even if it is
+   * not found.
+   */
+  QueryResult popBlockingWithTimeout(const Timestamp& timestamp,
+                                     T* value,
+                                     const std::chrono::milliseconds& timeout);
+
+  //! Non-blocking version of popBlockingWithTimeout: never returns kTimeout,
+  //! but kMissed if the value has not been pushed yet (without evicting).
+  QueryResult pop(const Timestamp& timestamp, T* value);
+
+  //! Wakes up all waiting consumers: no more values are pushed nor popped.
+  void shutdown() {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      shutdown_ = true;
+    }
+    data_cond_.notify_all();
+  }
+
+  bool isShutdown() const { return shutdown_; }
+
+  size_t size() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return buffer_.size();
+  }
+
+  bool empty() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return buffer_.empty();
+  }
+
+ public:
+  const std::string buffer_id_;
+
+ private:
+  //! Given the lock, returns the value if found, and evicts older values.
+  //! @return False if the value may still be pushed.
+  bool extract(const Timestamp& timestamp, T* value, QueryResult* result);
+
+ private:
+  mutable std::mutex mutex_;
+  std::condition_variable data_cond_;
+  std::map<Timestamp, T> buffer_;
+  Timestamp newest_timestamp_;
+  std::atomic_bool shutdown_;
+  utils::StatsCollector evictions_stats_;
+};
+
+template <typename T>
+bool ThreadsafeRendezvousBuffer<T>::push(const Timestamp& timestamp,
+                                         T value) {
+  if (shutdown_) return false;  // atomic, no lock needed.
+  std::unique_lock<std::mutex> lk(mutex_);
+  LOG_IF(WARNING, timestamp <= newest_timestamp_)
+      << "Buffer with id: " << buffer_id_
+      << " got a value out of order, at timestamp: " << timestamp
+      << ", newest timestamp: " << newest_timestamp_;
+  buffer_[timestamp] = std::move(value);
+  newest_timestamp_ = std::max(newest_timestamp_, timestamp);
+  lk.unlock();  // Unlock before notify.
+  data_cond_.notify_all();
+  return true;
+}
+
+template <typename T>
+typename ThreadsafeRendezvousBuffer<T>::QueryResult
+ThreadsafeRendezvousBuffer<T>::popBlockingWithTimeout(
+    const Timestamp& timestamp,
+    T* value,
+    const std::chrono::milliseconds& timeout) {
+  CHECK_NOTNULL(value);
+  QueryResult result = QueryResult::kTimeout;
+  std::unique_lock<std::mutex> lk(mutex_);
+  if (!data_cond_.wait_for(lk, timeout, [&] {
+        return shutdown_ || extract(timestamp, value, &result);
+      })) {
+    VLOG(1) << "Buffer with id: " << buffer_id_
+            << " timed out waiting for timestamp: " << timestamp;
+    return QueryResult::kTimeout;
+  }
+  return shutdown_ ? QueryResult::kShutdown : result;
+}
+
+template <typename T>
+typename ThreadsafeRendezvousBuffer<T>::QueryResult
+ThreadsafeRendezvousBuffer<T>::pop(const Timestamp& timestamp, T* value) {
+  CHECK_NOTNULL(value);
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (shutdown_) return QueryResult::kShutdown;
+  QueryResult result = QueryResult::kMissed;
+  extract(timestamp, value, &result);
+  return result;
+}
+
+template <typename T>
+bool ThreadsafeRendezvousBuffer<T>::extract(const Timestamp& timestamp,
+                                            T* value,
+                                            QueryResult* result) {
+  DCHECK(value);
+  DCHECK(result);
+  // O(log n) lookup, and older values are evicted in bulk.
+  auto it = buffer_.lower_bound(timestamp);
+  const bool found = it != buffer_.end() && it->first == timestamp;
+  if (!found && newest_timestamp_ <= timestamp) return false;
+  const size_t nr_evicted = std::distance(buffer_.begin(), it);
+  if (found) {
+    *value = std::move(it->second);
+    ++it;
+  }
+  buffer_.erase(buffer_.begin(), it);
+  if (nr_evicted > 0u) {
+    evictions_stats_.AddSample(static_cast<double>(nr_evicted));
+  }
+  *result = found ? QueryResult::kFound : QueryResult::kMissed;
+  return true;
+}
+
+}  // namespace VIO
@@ -0,0 +1,355 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ThreadsafeSpscQueue.h
+ * @brief  Bounded lock-free single-producer single-consumer queue with the
+ * same interface and shutdown/resume functionality as ThreadsafeQueue.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/RingBuffer.h"
+#include "kimera-vio/utils/ThreadsafeQueue.h"
+
+namespace VIO {
+
+/**
+ * @brief The ThreadsafeSpscQueue class is a ring buffer for pipeline edges
+ * with a single producer thread and a single consumer thread (e.g. Frontend
+ * to Backend). Push and pop only use atomic indices: no mutex is locked
+ * unless one side has to sleep (consumer on an empty queue, producer on a
+ * full queue), in which case it first spins for a short while and then
+ * waits on the base class condition variable.
+ *
+ * Differences wrt ThreadsafeQueue:
+ * - The queue is bounded: push blocks while the queue is full (use
+ *   pushBlockingIfFull for a tighter bound).
+ * - push* must only be called from the producer thread, pop*, batchPop and
+ *   peekBlockingWithTimeout from the consumer thread. empty(), shutdown() and
+ *   resume() can be called from any thread.
+ * - peekBlockingWithTimeout returns a non-owning pointer to the front value,
+ *   valid until the consumer pops it.
+ * - Values are stored in place, without a heap allocation per push.
+ */
+template <typename T>
+class ThreadsafeSpscQueue : public ThreadsafeQueueBase<T> {
+ public:
+  using TQB = ThreadsafeQueueBase<T>;
+  KIMERA_POINTER_TYPEDEFS(ThreadsafeSpscQueue);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(ThreadsafeSpscQueue);
+  static_assert(std::is_default_constructible<T>::value,
+                "ThreadsafeSpscQueue stores default-constructed values.");
+
+  //! @param capacity Max nr of values in the queue, rounded up to a power of
+  //! two.
+  //! @param instrument See ThreadsafeQueueBase.
+  explicit ThreadsafeSpscQueue(const std::string& queue_id,
+                               const size_t& capacity = 64u,
+                               const bool& instrument = true);
+  virtual ~ThreadsafeSpscQueue() = default;
+
+  //! Blocks while the queue is full. Returns false if shutdown.
+  bool push(T new_value) override;
+
+  bool pushBlockingIfFull(T new_value, size_t max_queue_size = 10u) override;
+
+  //! Never blocks: returns false, without moving value, if the queue is full
+  //! or shutdown.
+  bool pushIfNotFull(T& value);
+
+  bool popBlocking(T& value) override;
+
+  std::shared_ptr<T> popBlocking() override;
+
+  bool popBlockingWithTimeout(T& value, size_t duration_ms) override;
+
+  bool pop(T& value) override;
+
+  std::shared_ptr<T> pop() override;
+
+  bool batchPop(typename TQB::InternalQueue* output_queue) override;
+
+  std::shared_ptr<T> peekBlockingWithTimeout(size_t duration_ms) override;
+
+  bool empty() const override { return size() == 0u; }
+
+  size_t size() const override {
+    return tail_.load(std::memory_order_acquire) -
+           head_.load(std::memory_order_acquire);
+  }
+
+  inline size_t capacity() const { return capacity_; }
+
+ public:
+  using TQB::queue_id_;
+
+ private:
+  //! Producer side: moves value in if there are less than max_size values.
+  //! @param blocked_since_ns For the instrumentation.
+  bool tryPush(T& value,
+               const size_t& max_size,
+               const int64_t& blocked_since_ns =
+                   utils::QueueInstrumentation::kNotWaited);
+  //! Consumer side: moves the front value out if not empty.
+  //! @param waiting_since_ns For the instrumentation.
+  bool tryPop(T& value,
+              const int64_t& waiting_since_ns =
+                  utils::QueueInstrumentation::kNotWaited);
+
+  /**
+   * @brief wait Spins, then sleeps, until ready() or shutdown.
+   * @param waiting Flag of the waiting side, read by the other side to know
+   * whether it has to notify.
+   * @param timeout_ms Max time to wait, negative to wait forever.
+   * @return ready() at the end of the wait.
+   */
+  template <typename Predicate>
+  bool wait(std::atomic_bool* waiting, Predicate ready, const int& timeout_ms);
+
+  //! Wakes up the other side if it is sleeping.
+  void notify(const std::atomic_bool& waiting);
+
+ private:
+  using TQB::data_cond_;
+  using TQB::instrumentation_;
+  using TQB::mutex_;
+  using TQB::shutdown_;
+
+  static constexpr size_t kSpinIterations = 256u;
+
+  const size_t capacity_;
+  const size_t mask_;
+  std::vector<T> slots_;
+  //! If instrumented, push time of the value in each slot.
+  std::vector<int64_t> push_times_ns_;
+
+  //! Monotonic indices, on separate cache lines to avoid false sharing.
+  alignas(64) std::atomic<size_t> head_;  //! Written by the consumer.
+  alignas(64) std::atomic<size_t> tail_;  //! Written by the producer.
+  alignas(64) std::atomic_bool consumer_waiting_;
+  std::atomic_bool producer_waiting_;
+};
+
+template <typename T>
+ThreadsafeSpscQueue<T>::ThreadsafeSpscQueue(const std::string& queue_id,
+                                            const size_t& capacity,
+                                            const bool& instrument)
+    : ThreadsafeQueueBase<T>(queue_id, instrument),
+      capacity_(internal::nextPowerOfTwo(capacity)),
+      mask_(capacity_ - 1u),
+      slots_(capacity_),
+      push_times_ns_(instrumentation_ ? capacity_ : 0u),
+      head_(0u),
+      tail_(0u),
+      consumer_waiting_(false),
+      producer_waiting_(false) {
+  CHECK_GT(capacity, 0u);
+}
+
+template <typename T>
+bool ThreadsafeSpscQueue<T>::push(T new_value) {
+  return pushBlockingIfFull(std::move(new_value), capacity_);
+}
+
+template <typename T>
+bool ThreadsafeSpscQueue<T>::pushBlockingIfFull(T new_value,
+                                                size_t max_queue_size) {
+  if (shutdown_) return false;
+  const size_t max_size = std::min(std::max(max_queue_size, size_t(1u)),
+                                   capacity_);
+  if (tryPush(new_value, max_size)) return true;
+  VLOG(1) << "Queue with id: " << queue_id_ << " is full, size: " << size();
+  const int64_t blocked_since_ns =
+      instrumentation_ ? utils::QueueInstrumentation::now() : 0;
+  while (!shutdown_) {
+    wait(&producer_waiting_,
+         [this, max_size] { return size() < max_size; },
+         -1);
+    if (tryPush(new_value, max_size, blocked_since_ns)) return true;
+  }
+  return false;
+}
+
+template <typename T>
+bool ThreadsafeSpscQueue<T>::pushIfNotFull(T& value) {
+  if (shutdown_) return false;
+  return tryPush(value, capacity_);
+}
+
+template <typename T>
+bool ThreadsafeSpscQueue<T>::popBlocking(T& value) {
+  if (shutdown_) return false;
+  if (tryPop(value)) return true;
+  const int64_t waiting_since_ns =
+      instrumentation_ ? utils::QueueInstrumentation::now() : 0;
+  while (!shutdown_) {
+    wait(&consumer_waiting_, [this] { return !empty(); }, -1);
+    if (tryPop(value, waiting_since_ns)) return true;
+  }
+  return false;
+}
+
+template <typename T>
+std::shared_ptr<T> ThreadsafeSpscQueue<T>::popBlocking() {
+  T value;
+  if (!popBlocking(value)) return std::shared_ptr<T>(nullptr);
+  return std::make_shared<T>(std::move(value));
+}
+
+template <typename T>
+bool ThreadsafeSpscQueue<T>::popBlockingWithTimeout(T& value,
+                                                    size_t duration_ms) {
+  if (shutdown_) return false;
+  if (tryPop(value)) return true;
+  const int64_t waiting_since_ns =
+      instrumentation_ ? utils::QueueInstrumentation::now() : 0;
+  wait(&consumer_waiting_,
+       [this] { return !empty(); },
+       static_cast<int>(duration_ms));
+  return !shutdown_ && tryPop(value, waiting_since_ns);
+}
+
+template <typename T>
+bool ThreadsafeSpscQueue<T>::pop(T& value) {
+  if (shutdown_) return false;
+  return tryPop(value);
+}
+
+template <typename T>
+std::shared_ptr<T> ThreadsafeSpscQueue<T>::pop() {
+  T value;
+  if (!pop(value)) return std::shared_ptr<T>(nullptr);
+  return std::make_shared<T>(std::move(value));
+}
+
+template <typename T>
+bool ThreadsafeSpscQueue<T>::batchPop(
+    typename TQB::InternalQueue* output_queue) {
+  if (shutdown_) return false;
+  CHECK_NOTNULL(output_queue);
+  CHECK(output_queue->empty());
+  T value;
+  while (tryPop(value)) {
+    output_queue->push(std::make_shared<T>(std::move(value)));
+  }
+  return !output_queue->empty();
+}
+
+template <typename T>
+std::shared_ptr<T> ThreadsafeSpscQueue<T>::peekBlockingWithTimeout(
+    size_t duration_ms) {
+  if (empty()) {
+    wait(&consumer_waiting_,
+         [this] { return !empty(); },
+         static_cast<int>(duration_ms));
+  }
+  if (shutdown_ || empty()) return nullptr;
+  // Only the consumer pops, hence the front value stays valid until then.
+  T* front = &slots_[head_.load(std::memory_order_relaxed) & mask_];
+  return std::shared_ptr<T>(std::shared_ptr<T>(), front);
+}
+
+template <typename T>
+bool ThreadsafeSpscQueue<T>::tryPush(T& value,
+                                     const size_t& max_size,
+                                     const int64_t& blocked_since_ns) {
+  const size_t tail = tail_.load(std::memory_order_relaxed);
+  if (tail - head_.load(std::memory_order_acquire) >= max_size) return false;
+  slots_[tail & mask_] = std::move(value);
+  const int64_t push_ns =
+      instrumentation_ ? utils::QueueInstrumentation::now() : 0;
+  // Published to the consumer with the value, by the store of the tail.
+  if (instrumentation_) push_times_ns_[tail & mask_] = push_ns;
+  // Sequentially consistent, to order it wrt the load of consumer_waiting_.
+  tail_.store(tail + 1u);
+  // Only the producer pushes. The consumer may have popped since: at worst
+  // a lower bound.
+  const size_t queue_size = tail + 1u - head_.load(std::memory_order_acquire);
+  TQB::updateHighWaterMark(queue_size);
+  notify(consumer_waiting_);
+  if (instrumentation_) {
+    instrumentation_->onPush(queue_size, push_ns, blocked_since_ns);
+  }
+  return true;
+}
+
+template <typename T>
+bool ThreadsafeSpscQueue<T>::tryPop(T& value,
+                                    const int64_t& waiting_since_ns) {
+  const size_t head = head_.load(std::memory_order_relaxed);
+  if (head == tail_.load(std::memory_order_acquire)) return false;
+  T& slot = slots_[head & mask_];
+  value = std::move(slot);
+  // Release what the moved-from value may still hold before the producer
+  // reuses the slot.
+  slot = T();
+  const int64_t pushed_ns =
+      instrumentation_ ? push_times_ns_[head & mask_] : 0;
+  // Sequentially consistent, to order it wrt the load of producer_waiting_.
+  head_.store(head + 1u);
+  notify(producer_waiting_);
+  if (instrumentation_) {
+    // The producer may have pushed since: at worst an upper bound.
+    instrumentation_->onPop(
+        tail_.load(std::memory_order_acquire) - head - 1u,
+        pushed_ns,
+        waiting_since_ns);
+  }
+  return true;
+}
+
+template <typename T>
+template <typename Predicate>
+bool ThreadsafeSpscQueue<T>::wait(std::atomic_bool* waiting,
+                                  Predicate ready,
+                                  const int& timeout_ms) {
+  for (size_t i = 0u; i < kSpinIterations; ++i) {
+    if (ready() || shutdown_) return ready();
+  }
+  std::unique_lock<std::mutex> lk(mutex_);
+  // Set under the mutex: the other side either sees the flag and notifies
+  // after we started waiting, or updated its index before we check ready().
+  waiting->store(true);
+  const auto predicate = [&ready, this] { return ready() || shutdown_; };
+  if (timeout_ms < 0) {
+    data_cond_.wait(lk, predicate);
+  } else {
+    data_cond_.wait_for(lk, std::chrono::milliseconds(timeout_ms), predicate);
+  }
+  waiting->store(false);
+  return ready();
+}
+
+template <typename T>
+void ThreadsafeSpscQueue<T>::notify(const std::atomic_bool& waiting) {
+  if (waiting.load()) {
+    // Lock to make sure the waiting side is either sleeping or has not
+    // checked its predicate yet.
+    { std::lock_guard<std::mutex> lk(mutex_); }
+    data_cond_.notify_all();
+  }
+}
+
+}  // namespace VIO
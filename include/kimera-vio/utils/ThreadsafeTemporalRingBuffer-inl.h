@@ -0,0 +1,318 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ThreadsafeTemporalRingBuffer-inl.h
+ * @brief  Thread Safe Buffer with timestamp lookup, storing fixed-size vectors
+ * contiguously in time order.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <thread>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+namespace utils {
+
+template <int Rows, typename Scalar>
+ThreadsafeTemporalRingBuffer<Rows, Scalar>::ThreadsafeTemporalRingBuffer(
+    const Timestamp& buffer_length_nanoseconds,
+    const size_t& initial_capacity)
+    : buffer_length_nanoseconds_(buffer_length_nanoseconds),
+      writer_mutex_(),
+      sequence_(0u),
+      storage_(nullptr),
+      storages_(),
+      head_(0u),
+      size_(0u) {
+  storages_.emplace_back(
+      new Storage(std::max(initial_capacity, size_t(1u))));
+  storage_.store(storages_.back().get(), std::memory_order_release);
+}
+
+template <int Rows, typename Scalar>
+bool ThreadsafeTemporalRingBuffer<Rows, Scalar>::addValue(
+    const Timestamp& timestamp,
+    const Value& value) {
+  std::lock_guard<std::mutex> lock(writer_mutex_);
+  const View view = writerView();
+  if (view.size_ > 0u && timestamp <= view.stamp(view.size_ - 1u)) {
+    return false;
+  }
+  beginWrite();
+  // Same values than ThreadsafeTemporalBuffer once this value is added.
+  removeOutdatedItemsImpl(timestamp);
+  if (size_.load(std::memory_order_relaxed) == view.storage_->capacity_) {
+    growImpl();
+  }
+  Storage& storage = *storages_.back();
+  const size_t head = head_.load(std::memory_order_relaxed);
+  const size_t size = size_.load(std::memory_order_relaxed);
+  const size_t ring_slot = (head + size) % storage.capacity_;
+  storage.stamps_(ring_slot) = timestamp;
+  storage.stamps_(ring_slot + storage.capacity_) = timestamp;
+  storage.values_.col(ring_slot) = value;
+  storage.values_.col(ring_slot + storage.capacity_) = value;
+  size_.store(size + 1u, std::memory_order_relaxed);
+  endWrite();
+  return true;
+}
+
+template <int Rows, typename Scalar>
+void ThreadsafeTemporalRingBuffer<Rows, Scalar>::clear() {
+  std::lock_guard<std::mutex> lock(writer_mutex_);
+  beginWrite();
+  head_.store(0u, std::memory_order_relaxed);
+  size_.store(0u, std::memory_order_relaxed);
+  endWrite();
+}
+
+template <int Rows, typename Scalar>
+bool ThreadsafeTemporalRingBuffer<Rows, Scalar>::getOldestValue(
+    Timestamp* timestamp,
+    Value* value) const {
+  CHECK_NOTNULL(timestamp);
+  CHECK_NOTNULL(value);
+  return readConsistent([timestamp, value](const View& view) {
+    if (view.size_ == 0u) return false;
+    *timestamp = view.stamp(0u);
+    *value = view.storage_->values_.col(view.slot(0u));
+    return true;
+  });
+}
+
+template <int Rows, typename Scalar>
+bool ThreadsafeTemporalRingBuffer<Rows, Scalar>::getNewestValue(
+    Timestamp* timestamp,
+    Value* value) const {
+  CHECK_NOTNULL(timestamp);
+  CHECK_NOTNULL(value);
+  return readConsistent([timestamp, value](const View& view) {
+    if (view.size_ == 0u) return false;
+    *timestamp = view.stamp(view.size_ - 1u);
+    *value = view.storage_->values_.col(view.slot(view.size_ - 1u));
+    return true;
+  });
+}
+
+template <int Rows, typename Scalar>
+bool ThreadsafeTemporalRingBuffer<Rows, Scalar>::getValueAtOrBeforeTime(
+    const Timestamp& timestamp_ns,
+    Timestamp* timestamp_ns_of_value,
+    Value* value) const {
+  CHECK_NOTNULL(timestamp_ns_of_value);
+  CHECK_NOTNULL(value);
+  const bool found = readConsistent(
+      [&timestamp_ns, timestamp_ns_of_value, value](const View& view) {
+        size_t idx = lowerBoundImpl(view, timestamp_ns);
+        if (idx == view.size_ || view.stamp(idx) != timestamp_ns) {
+          // No exact match: take the previous value, if any.
+          if (idx == 0u) return false;
+          --idx;
+        }
+        *timestamp_ns_of_value = view.stamp(idx);
+        *value = view.storage_->values_.col(view.slot(idx));
+        return true;
+      });
+  if (found) CHECK_LE(*timestamp_ns_of_value, timestamp_ns);
+  return found;
+}
+
+template <int Rows, typename Scalar>
+bool ThreadsafeTemporalRingBuffer<Rows, Scalar>::getValueAtOrAfterTime(
+    const Timestamp& timestamp_ns,
+    Timestamp* timestamp_ns_of_value,
+    Value* value) const {
+  CHECK_NOTNULL(timestamp_ns_of_value);
+  CHECK_NOTNULL(value);
+  const bool found = readConsistent(
+      [&timestamp_ns, timestamp_ns_of_value, value](const View& view) {
+        const size_t idx = lowerBoundImpl(view, timestamp_ns);
+        if (idx == view.size_) return false;
+        *timestamp_ns_of_value = view.stamp(idx);
+        *value = view.storage_->values_.col(view.slot(idx));
+        return true;
+      });
+  if (found) CHECK_GE(*timestamp_ns_of_value, timestamp_ns);
+  return found;
+}
+
+template <int Rows, typename Scalar>
+bool ThreadsafeTemporalRingBuffer<Rows, Scalar>::getValuesBetweenTimes(
+    const Timestamp& timestamp_lower_ns,
+    const Timestamp& timestamp_higher_ns,
+    Stamps* timestamps,
+    Values* values,
+    const bool get_lower_bound) const {
+  CHECK_NOTNULL(timestamps);
+  CHECK_NOTNULL(values);
+  CHECK_GT(timestamp_higher_ns, timestamp_lower_ns);
+  return readConsistent([&, timestamps, values](const View& view) {
+    size_t begin = 0u;
+    size_t end = 0u;
+    if (!rangeBetweenTimesImpl(view,
+                               timestamp_lower_ns,
+                               timestamp_higher_ns,
+                               get_lower_bound,
+                               &begin,
+                               &end)) {
+      return false;
+    }
+    // Contiguous thanks to the mirrored ring, even if wrapping around.
+    const Eigen::Index nr_values = static_cast<Eigen::Index>(end - begin);
+    const Eigen::Index first_slot = static_cast<Eigen::Index>(view.slot(begin));
+    *timestamps = view.storage_->stamps_.middleCols(first_slot, nr_values);
+    *values = view.storage_->values_.middleCols(first_slot, nr_values);
+    return true;
+  });
+}
+
+template <int Rows, typename Scalar>
+template <typename Visitor>
+bool ThreadsafeTemporalRingBuffer<Rows, Scalar>::visitValuesBetweenTimes(
+    const Timestamp& timestamp_lower_ns,
+    const Timestamp& timestamp_higher_ns,
+    const Visitor& visitor,
+    const bool get_lower_bound) const {
+  CHECK_GT(timestamp_higher_ns, timestamp_lower_ns);
+  std::lock_guard<std::mutex> lock(writer_mutex_);
+  const View view = writerView();
+  size_t begin = 0u;
+  size_t end = 0u;
+  if (!rangeBetweenTimesImpl(view,
+                             timestamp_lower_ns,
+                             timestamp_higher_ns,
+                             get_lower_bound,
+                             &begin,
+                             &end)) {
+    return false;
+  }
+  const Eigen::Index nr_values = static_cast<Eigen::Index>(end - begin);
+  const Eigen::Index first_slot = static_cast<Eigen::Index>(view.slot(begin));
+  visitor(view.storage_->stamps_.middleCols(first_slot, nr_values),
+          view.storage_->values_.middleCols(first_slot, nr_values));
+  return true;
+}
+
+template <int Rows, typename Scalar>
+size_t ThreadsafeTemporalRingBuffer<Rows, Scalar>::lowerBoundImpl(
+    const View& view,
+    const Timestamp& timestamp) {
+  const Timestamp* oldest = view.storage_->stamps_.data() + view.slot(0u);
+  return static_cast<size_t>(
+      std::lower_bound(oldest, oldest + view.size_, timestamp) - oldest);
+}
+
+template <int Rows, typename Scalar>
+bool ThreadsafeTemporalRingBuffer<Rows, Scalar>::rangeBetweenTimesImpl(
+    const View& view,
+    const Timestamp& timestamp_lower_ns,
+    const Timestamp& timestamp_higher_ns,
+    const bool& get_lower_bound,
+    size_t* begin,
+    size_t* end) {
+  CHECK_NOTNULL(begin);
+  CHECK_NOTNULL(end);
+  if (view.size_ == 0u) return false;
+  // Only 100% overlapping query intervals are accepted, as in
+  // ThreadsafeTemporalBuffer.
+  if (view.stamp(0u) > timestamp_lower_ns ||
+      timestamp_higher_ns > view.stamp(view.size_ - 1u)) {
+    return false;
+  }
+  *begin = lowerBoundImpl(view, timestamp_lower_ns);
+  if (*begin < view.size_ && view.stamp(*begin) == timestamp_lower_ns &&
+      !get_lower_bound) {
+    ++(*begin);
+  }
+  *end = std::max(*begin, lowerBoundImpl(view, timestamp_higher_ns));
+  return true;
+}
+
+template <int Rows, typename Scalar>
+template <typename Read>
+auto ThreadsafeTemporalRingBuffer<Rows, Scalar>::readConsistent(
+    const Read& read) const -> decltype(read(View())) {
+  for (;;) {
+    const std::uint64_t sequence = sequence_.load(std::memory_order_acquire);
+    if (sequence & 1u) {
+      // Writes only copy a value (or the ring, when growing): short.
+      std::this_thread::yield();
+      continue;
+    }
+    const View view{storage_.load(std::memory_order_acquire),
+                    head_.load(std::memory_order_relaxed),
+                    size_.load(std::memory_order_relaxed)};
+    // A torn view is only read if it indexes within its storage, the sequence
+    // check below discards the result anyway.
+    if (view.isValid()) {
+      const auto result = read(view);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (sequence_.load(std::memory_order_relaxed) == sequence) {
+        return result;
+      }
+    }
+  }
+}
+
+template <int Rows, typename Scalar>
+void ThreadsafeTemporalRingBuffer<Rows, Scalar>::beginWrite() {
+  sequence_.store(sequence_.load(std::memory_order_relaxed) + 1u,
+                  std::memory_order_relaxed);
+  // The odd sequence is visible before any of the writes that follow.
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+template <int Rows, typename Scalar>
+void ThreadsafeTemporalRingBuffer<Rows, Scalar>::endWrite() {
+  sequence_.store(sequence_.load(std::memory_order_relaxed) + 1u,
+                  std::memory_order_release);
+}
+
+template <int Rows, typename Scalar>
+void ThreadsafeTemporalRingBuffer<Rows, Scalar>::removeOutdatedItemsImpl(
+    const Timestamp& newest_timestamp) {
+  const View view = writerView();
+  if (view.size_ == 0u || buffer_length_nanoseconds_ <= 0) return;
+  const size_t nr_outdated =
+      lowerBoundImpl(view, newest_timestamp - buffer_length_nanoseconds_);
+  head_.store((view.head_ + nr_outdated) % view.storage_->capacity_,
+              std::memory_order_relaxed);
+  size_.store(view.size_ - nr_outdated, std::memory_order_relaxed);
+}
+
+template <int Rows, typename Scalar>
+void ThreadsafeTemporalRingBuffer<Rows, Scalar>::growImpl() {
+  const View view = writerView();
+  const size_t new_capacity = 2u * view.storage_->capacity_;
+  const Eigen::Index nr_values = static_cast<Eigen::Index>(view.size_);
+  const Eigen::Index first_slot = static_cast<Eigen::Index>(view.slot(0u));
+  const Eigen::Index mirror_slot = static_cast<Eigen::Index>(new_capacity);
+  std::unique_ptr<Storage> storage(new Storage(new_capacity));
+  storage->stamps_.leftCols(nr_values) =
+      view.storage_->stamps_.middleCols(first_slot, nr_values);
+  storage->stamps_.middleCols(mirror_slot, nr_values) =
+      view.storage_->stamps_.middleCols(first_slot, nr_values);
+  storage->values_.leftCols(nr_values) =
+      view.storage_->values_.middleCols(first_slot, nr_values);
+  storage->values_.middleCols(mirror_slot, nr_values) =
+      view.storage_->values_.middleCols(first_slot, nr_values);
+  // The previous storage is retired, not freed: readers may still read it.
+  storage_.store(storage.get(), std::memory_order_release);
+  storages_.push_back(std::move(storage));
+  head_.store(0u, std::memory_order_relaxed);
+}
+
+}  // namespace utils
+
+}  // namespace VIO
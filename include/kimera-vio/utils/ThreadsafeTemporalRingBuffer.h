@@ -0,0 +1,206 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ThreadsafeTemporalRingBuffer.h
+ * @brief  Thread Safe Buffer with timestamp lookup, storing fixed-size vectors
+ * contiguously in time order.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include "kimera-vio/common/vio_types.h"
+
+namespace VIO {
+
+namespace utils {
+
+/**
+ * @brief The ThreadsafeTemporalRingBuffer class is a variant of
+ * ThreadsafeTemporalBuffer for time-sorted fixed-size vectors (e.g. IMU
+ * samples), with the same query semantics, but:
+ * - Values are stored in a ring of Eigen columns instead of std::map nodes:
+ *   adding a value does not allocate (the ring only grows, by doubling, if it
+ *   is full of values that are not outdated yet).
+ * - Timestamp queries are binary searches over contiguous timestamps.
+ * - The ring is mirrored (each value is written twice, at slot i and
+ *   i + capacity) so that the buffered values are always contiguous in
+ *   memory, and ranges of values are handed out as Eigen blocks.
+ * - Values must be added in strictly increasing timestamp order.
+ *
+ * Concurrency: writers (addValue, clear) are serialized by a mutex, but
+ * readers never take it, hence they neither block the writer nor each other.
+ * Each write is bracketed by a sequence counter (seqlock): readers copy what
+ * they need and retry if a write overlapped the copy. The storage is never
+ * freed under a reader: growing the ring retires the previous storage, kept
+ * until destruction (at most as large as the current one, by doubling).
+ */
+template <int Rows, typename Scalar = double>
+class ThreadsafeTemporalRingBuffer {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  using Value = Eigen::Matrix<Scalar, Rows, 1>;
+  using Values = Eigen::Matrix<Scalar, Rows, Eigen::Dynamic>;
+  using Stamps = Eigen::Matrix<Timestamp, 1, Eigen::Dynamic>;
+
+  // Buffer length in nanoseconds defines after which time old entries get
+  // dropped. (buffer_length_nanoseconds <= 0: infinite length.)
+  explicit ThreadsafeTemporalRingBuffer(
+      const Timestamp& buffer_length_nanoseconds = -1,
+      const size_t& initial_capacity = 128u);
+
+  ThreadsafeTemporalRingBuffer(const ThreadsafeTemporalRingBuffer&) = delete;
+  ThreadsafeTemporalRingBuffer& operator=(const ThreadsafeTemporalRingBuffer&) =
+      delete;
+
+  // Returns false, without adding it, if the timestamp is not strictly newer
+  // than the newest value.
+  bool addValue(const Timestamp& timestamp, const Value& value);
+
+  inline size_t size() const { return size_.load(std::memory_order_acquire); }
+  inline bool empty() const { return size() == 0u; }
+  inline size_t capacity() const {
+    return storage_.load(std::memory_order_acquire)->capacity_;
+  }
+  void clear();
+
+  bool getOldestValue(Timestamp* timestamp, Value* value) const;
+  bool getNewestValue(Timestamp* timestamp, Value* value) const;
+
+  // These functions return False if there is no valid time.
+  bool getValueAtOrBeforeTime(const Timestamp& timestamp_ns,
+                              Timestamp* timestamp_ns_of_value,
+                              Value* value) const;
+  bool getValueAtOrAfterTime(const Timestamp& timestamp_ns,
+                             Timestamp* timestamp_ns_of_value,
+                             Value* value) const;
+
+  // Same semantics as ThreadsafeTemporalBuffer::getValuesBetweenTimes: values
+  // strictly between the timestamps (also at timestamp_lower_ns if
+  // get_lower_bound), returns false unless the buffer spans the whole query.
+  // The outputs are resized and copied as a single block.
+  bool getValuesBetweenTimes(const Timestamp& timestamp_lower_ns,
+                             const Timestamp& timestamp_higher_ns,
+                             Stamps* timestamps,
+                             Values* values,
+                             const bool get_lower_bound = false) const;
+
+  /**
+   * @brief visitValuesBetweenTimes Same query as getValuesBetweenTimes, but
+   * without copies: calls visitor(stamps_block, values_block) with Eigen
+   * blocks of the buffered data, while holding the writer lock (hence the
+   * visitor must not add values to this buffer). Unlike the other queries,
+   * this blocks the writer while the visitor runs.
+   */
+  template <typename Visitor>
+  bool visitValuesBetweenTimes(const Timestamp& timestamp_lower_ns,
+                               const Timestamp& timestamp_higher_ns,
+                               const Visitor& visitor,
+                               const bool get_lower_bound = false) const;
+
+ private:
+  //! 2 * capacity_ columns, slot i + capacity_ mirrors slot i.
+  struct Storage {
+    explicit Storage(const size_t& capacity)
+        : capacity_(capacity),
+          stamps_(1, 2 * capacity),
+          values_(Rows, 2 * capacity) {}
+    const size_t capacity_;
+    Stamps stamps_;
+    Values values_;
+  };
+
+  //! Snapshot of the buffered values. Readers' views may be torn by a
+  //! concurrent write, which is detected after the fact, but they always
+  //! index within their storage.
+  struct View {
+    const Storage* storage_;
+    //! Slot of the oldest value, in [0, capacity_).
+    size_t head_;
+    size_t size_;
+
+    //! Slot of the i-th oldest value, in [0, 2 * capacity_).
+    inline size_t slot(const size_t& i) const { return head_ + i; }
+    inline const Timestamp& stamp(const size_t& i) const {
+      return storage_->stamps_(slot(i));
+    }
+    inline bool isValid() const {
+      return head_ < storage_->capacity_ && size_ <= storage_->capacity_;
+    }
+  };
+
+  //! Index (wrt the oldest value) of the first value with a timestamp not
+  //! less than the given timestamp.
+  static size_t lowerBoundImpl(const View& view, const Timestamp& timestamp);
+
+  //! Range [*begin, *end) of getValuesBetweenTimes.
+  static bool rangeBetweenTimesImpl(const View& view,
+                                    const Timestamp& timestamp_lower_ns,
+                                    const Timestamp& timestamp_higher_ns,
+                                    const bool& get_lower_bound,
+                                    size_t* begin,
+                                    size_t* end);
+
+  /**
+   * @brief readConsistent Calls read(view) until no write overlapped it, and
+   * returns its last result. read must only write to its own outputs, and
+   * must not CHECK the values it reads, as they are only known to be
+   * consistent once it returns.
+   */
+  template <typename Read>
+  auto readConsistent(const Read& read) const -> decltype(read(View()));
+
+  //! The writer's view. Requires writer_mutex_.
+  inline View writerView() const {
+    return View{storage_.load(std::memory_order_relaxed),
+                head_.load(std::memory_order_relaxed),
+                size_.load(std::memory_order_relaxed)};
+  }
+
+  //! Odd sequence while writing. Requires writer_mutex_.
+  void beginWrite();
+  void endWrite();
+
+  //! Drops values older than newest_timestamp - buffer length. Requires
+  //! writer_mutex_, within a write.
+  void removeOutdatedItemsImpl(const Timestamp& newest_timestamp);
+
+  //! Doubles the capacity, keeping the values. Requires writer_mutex_,
+  //! within a write.
+  void growImpl();
+
+ private:
+  const Timestamp buffer_length_nanoseconds_;
+  //! Serializes the writers only.
+  mutable std::mutex writer_mutex_;
+  //! Incremented before and after each write: odd while writing.
+  std::atomic<std::uint64_t> sequence_;
+  //! Current storage, and every storage ever used (the last one is current),
+  //! which readers may still be reading.
+  std::atomic<const Storage*> storage_;
+  std::vector<std::unique_ptr<Storage>> storages_;
+  std::atomic<size_t> head_;
+  std::atomic<size_t> size_;
+};
+
+}  // namespace utils
+
+}  // namespace VIO
+
+#include "./ThreadsafeTemporalRingBuffer-inl.h"
@@ -0,0 +1,165 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   Tracing.h
+ * @brief  Scoped trace events per thread, exported to the Chrome trace event
+ * format (chrome://tracing, ui.perfetto.dev).
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "kimera-vio/utils/Macros.h"
+
+///
+// Example usage:
+//
+// void Frontend::processFrame(const Frame& frame) {
+//   KIMERA_TRACE_SCOPE_ID("Frontend processFrame", frame.timestamp_);
+//   {
+//     KIMERA_TRACE_SCOPE("Feature detection");
+//     ...
+//   }
+// }
+//
+// utils::Tracer::enable();
+// ... run the pipeline ...
+// utils::Tracer::writeChromeTrace("trace.json");
+//
+// Spans with the same correlation id (e.g. the timestamp of a frame) are
+// linked by flow arrows across threads in the trace viewer. Counters (e.g.
+// utils::Tracer::recordCounter("Backend queue depth", now, depth)) are
+// plotted as graphs over time.
+
+namespace VIO {
+
+namespace utils {
+
+/**
+ * @brief The Tracer class records spans (name, begin, end, correlation id)
+ * and counter samples in a ring buffer per thread: recording takes no lock
+ * and allocates nothing, and only the latest events of each thread are kept.
+ * Recording is a single relaxed atomic load while the tracer is disabled (the
+ * default).
+ *
+ * Export (writeChromeTrace) is meant to be called once the traced threads are
+ * idle or joined: events overwritten while exporting are dropped. Buffers
+ * outlive their threads, so that joined threads can still be exported.
+ */
+class Tracer {
+ public:
+  static constexpr int64_t kNoCorrelationId = -1;
+  //! Max nr of events kept per thread.
+  static constexpr size_t kEventsPerThread = 1u << 14;
+
+  static void enable();
+  static void disable();
+  static inline bool isEnabled() {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  //! Copy of a dynamic span name that lives as long as the program, since
+  //! spans only store a pointer to their name.
+  static const char* internName(const std::string& name);
+
+  //! Name of the calling thread in the trace.
+  static void setCurrentThreadName(const std::string& name);
+
+  //! Monotonic time of the events, in nanoseconds.
+  static inline int64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  //! Adds a span to the buffer of the calling thread, if enabled.
+  //! @param name Must outlive the tracer: a literal, or use internName.
+  static void record(const char* name,
+                     const int64_t& begin_ns,
+                     const int64_t& end_ns,
+                     const int64_t& correlation_id = kNoCorrelationId);
+
+  //! Adds a sample of a counter (e.g. the depth of a queue) to the buffer of
+  //! the calling thread, if enabled. Plotted per name in the trace viewer.
+  //! @param name Must outlive the tracer: a literal, or use internName.
+  static void recordCounter(const char* name,
+                            const int64_t& time_ns,
+                            const double& value);
+
+  //! Drops all the recorded events. The traced threads must be idle.
+  static void clear();
+
+  //! Nr of events currently kept, over all threads.
+  static size_t getNumberOfEvents();
+
+  //! Writes the events in the Chrome trace event JSON format.
+  static void writeChromeTrace(std::ostream& out);  // NOLINT
+  static bool writeChromeTrace(const std::string& path);
+
+ private:
+  class ThreadBuffer;
+  struct Event;
+  struct State;
+
+  //! Buffer of the calling thread, created on its first event.
+  static ThreadBuffer* getThreadBuffer();
+  static State& getState();
+
+  static std::atomic_bool enabled_;
+};
+
+/**
+ * @brief The TraceSpan class records a span from its construction to its
+ * destruction, if the tracer is enabled at construction.
+ */
+class TraceSpan {
+ public:
+  KIMERA_DELETE_COPY_CONSTRUCTORS(TraceSpan);
+
+  explicit TraceSpan(const char* name,
+                     const int64_t& correlation_id = Tracer::kNoCorrelationId)
+      : name_(Tracer::isEnabled() ? name : nullptr),
+        begin_ns_(name_ ? Tracer::now() : 0),
+        correlation_id_(correlation_id) {}
+
+  ~TraceSpan() {
+    if (name_) Tracer::record(name_, begin_ns_, Tracer::now(), correlation_id_);
+  }
+
+  //! For spans whose correlation id is only known once started.
+  inline void setCorrelationId(const int64_t& correlation_id) {
+    correlation_id_ = correlation_id;
+  }
+
+ private:
+  const char* name_;
+  int64_t begin_ns_;
+  int64_t correlation_id_;
+};
+
+#define KIMERA_TRACE_CONCAT_IMPL(a, b) a##b
+#define KIMERA_TRACE_CONCAT(a, b) KIMERA_TRACE_CONCAT_IMPL(a, b)
+//! Traces the enclosing scope.
+#define KIMERA_TRACE_SCOPE(name)      \
+  ::VIO::utils::TraceSpan KIMERA_TRACE_CONCAT(kimera_trace_span_, \
+                                              __LINE__)(name)
+//! Traces the enclosing scope, with a correlation id (e.g. frame timestamp).
+#define KIMERA_TRACE_SCOPE_ID(name, correlation_id)               \
+  ::VIO::utils::TraceSpan KIMERA_TRACE_CONCAT(kimera_trace_span_, \
+                                              __LINE__)(name, correlation_id)
+
+}  // namespace utils
+
+}  // namespace VIO
@@ -204,9 +204,12 @@ class UtilsOpenCV {
       const bool upToScale = false);
 
   /* ------------------------------------------------------------------------ */
-  // reads image and converts to 1 channel image
-  static cv::Mat ReadAndConvertToGrayScale(const std::string& img_name,
-                                           bool const equalize = false);
+  // reads image and converts to 1 channel image. If an allocator is given
+  // (e.g. an ImageBufferPool), the output image is allocated with it.
+  static cv::Mat ReadAndConvertToGrayScale(
+      const std::string& img_name,
+      bool const equalize = false,
+      cv::MatAllocator* allocator = nullptr);
   /* ------------------------------------------------------------------------ */
   // reorder block entries of covariance from state: [bias, vel, pose] to [pose
   // vel bias]
@@ -217,6 +220,12 @@ class UtilsOpenCV {
                                  const cv::Mat templ,
                                  cv::Mat& result);
 
+  /* ------------------------------------------------------------------------ */
+  // Images of the frames are shared (not copied) by all the modules they are
+  // sent to, which must hence only read them. To draw on one, take a BGR copy
+  // of it: gray images are converted (a single copy), color ones cloned.
+  static cv::Mat CopyForDrawing(const cv::Mat& img);
+
   /* ------------------------------------------------------------------------ */
   // add circles in the image at desired position/size/color
   static void DrawCirclesInPlace(
@@ -257,8 +266,7 @@ class UtilsOpenCV {
       const std::vector<double>& textDoubles = std::vector<double>());
 
   /* ------------------------------------------------------------------------ */
-  // Concatenate two images and return results as a new mat.
-  // Clones the two images.
+  // Concatenate two images and return results as a new (BGR) mat.
   static cv::Mat concatenateTwoImages(const cv::Mat& imL_in,
                                       const cv::Mat& imR_in);
 
@@ -14,52 +14,52 @@
 
 #pragma once
 
+#include <functional>
+
 #include <glog/logging.h>
 
+#include "kimera-vio/pipeline/Pipeline-definitions.h"
 #include "kimera-vio/utils/Macros.h"
 #include "kimera-vio/visualizer/Display.h"
 #include "kimera-vio/visualizer/DisplayParams.h"
-#include "kimera-vio/visualizer/OpenCvDisplay.h"
-#ifdef Pangolin_FOUND
-#include "kimera-vio/visualizer/PangolinDisplay.h"
-#endif
 
 namespace VIO {
 
+/**
+ * @brief The DisplayFactory makes the displays registered for each display
+ * type. Each display registers itself when the library is loaded (see
+ * registerDisplay), hence only the displays that were built are available:
+ * the OpenCV and Pangolin ones need KIMERA_BUILD_GUI (and Pangolin), the
+ * telemetry one is always built.
+ */
 class DisplayFactory {
  public:
   KIMERA_POINTER_TYPEDEFS(DisplayFactory);
   KIMERA_DELETE_COPY_CONSTRUCTORS(DisplayFactory);
 
+  typedef std::function<DisplayBase::UniquePtr(
+      DisplayParams::Ptr,
+      const ShutdownPipelineCallback&)>
+      DisplayCreator;
+
   DisplayFactory() = default;
   virtual ~DisplayFactory() = default;
 
-  template <class... Types>
+  /**
+   * @brief registerDisplay Registers the creator of the displays of the
+   * given type, replacing the previous one if any.
+   * @return True, so that it can initialize a static variable.
+   */
+  static bool registerDisplay(const DisplayType& display_type,
+                              const DisplayCreator& creator);
+
+  static bool isDisplayRegistered(const DisplayType& display_type);
+
+  //! Returns nullptr if no display of the given type was registered.
   static DisplayBase::UniquePtr makeDisplay(
       const DisplayType& display_type,
-      Types... args) {
-    switch (display_type) {
-      case DisplayType::kPangolin: {
-#ifdef Pangolin_FOUND
-        return std::make_unique<PangolinDisplay>(args...);
-#else
-        // No pangolin library found...
-        return nullptr;
-#endif
-      }
-      case DisplayType::kOpenCV: {
-        return std::make_unique<OpenCv3dDisplay>(args...);
-      }
-      default: {
-        LOG(FATAL) << "Requested display type is not supported.\n"
-                   << "Currently supported display types:\n"
-                   << "0: OpenCV 3D viz\n 1: Pangolin (not supported yet)\n"
-                   << " but requested display: "
-                   << VIO::to_underlying(display_type);
-        return nullptr;
-      }
-    }
-  }
+      DisplayParams::Ptr display_params,
+      const ShutdownPipelineCallback& shutdown_pipeline_cb);
 };
 
 }  // namespace VIO
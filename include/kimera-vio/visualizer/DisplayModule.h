@@ -14,11 +14,14 @@
 
 #pragma once
 
+#include <chrono>
+#include <optional>
 #include <utility>
 
 #include "kimera-vio/common/vio_types.h"
 #include "kimera-vio/pipeline/PipelineModule.h"
 #include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/ThreadsafeMailbox.h"
 #include "kimera-vio/visualizer/Display-definitions.h"
 #include "kimera-vio/visualizer/Display.h"
 #include "kimera-vio/visualizer/Visualizer3D-definitions.h"
@@ -38,11 +41,20 @@ class DisplayModule
   KIMERA_DELETE_COPY_CONSTRUCTORS(DisplayModule);
 
   using SISO = SISOPipelineModule<DisplayInputBase, NullPipelinePayload>;
+  //! Input queue that does not back up when the display is slower than the
+  //! pipeline: see mergeInputs.
+  using InputMailbox = ThreadsafeMailbox<InputUniquePtr>;
 
+  /**
+   * @param target_fps Max rate at which the inputs are displayed, 0 for no
+   * limit. Inputs arriving faster are merged in the input queue if it is an
+   * InputMailbox, or wait in it otherwise.
+   */
   DisplayModule(DisplayQueue* input_queue,
                 OutputQueue* output_queue,
                 bool parallel_run,
-                DisplayBase::UniquePtr&& display);
+                DisplayBase::UniquePtr&& display,
+                const double& target_fps = 0.0);
 
   virtual ~DisplayModule() = default;
 
@@ -50,9 +62,21 @@ class DisplayModule
 
   typename MISO::InputUniquePtr getInputPacket() override;
 
+  /**
+   * @brief mergeInputs Merge callback of the InputMailbox: skips the stale
+   * input, but keeps what the new one does not replace. That is, the images
+   * of the other windows, and the widgets: visualizer outputs only carry the
+   * widgets that changed.
+   */
+  static InputUniquePtr mergeInputs(InputUniquePtr stale_input,
+                                    InputUniquePtr new_input);
+
  private:
   // The renderer used to display the visualizer output.
   DisplayBase::UniquePtr display_;
+
+  const double target_fps_;
+  std::optional<std::chrono::steady_clock::time_point> last_display_time_;
 };
 
 }  // namespace VIO
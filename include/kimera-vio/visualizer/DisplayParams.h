@@ -25,7 +25,12 @@ namespace VIO {
 /**
  * @brief The DisplayType enum: enumerates the types of supported renderers.
  */
-enum class DisplayType { kOpenCV = 0, kPangolin = 1 };
+enum class DisplayType {
+  kOpenCV = 0,
+  kPangolin = 1,
+  kTelemetry = 2,
+  kVideo = 3
+};
 
 /*
  * Class describing display parameters.
@@ -55,6 +60,9 @@ class DisplayParams : public PipelineParams {
 
  public:
   DisplayType display_type_;
+  //! Max rate at which the display is refreshed [Hz], 0 for no limit. Skipped
+  //! frames are merged with the next ones, see DisplayModule::mergeInputs.
+  double target_fps_ = 0.0;
 };
 
 }  // namespace VIO
@@ -0,0 +1,94 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   IncrementalVertexBuffer.h
+ * @brief  Host copy of a GPU vertex buffer, tracking what to upload.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/visualizer/TelemetryCodec.h"
+
+namespace VIO {
+
+/**
+ * @brief The IncrementalVertexBuffer class is the host copy of a GPU buffer
+ * of 3D points (3 floats each), so that a display only uploads what changed
+ * instead of the whole buffer. A buffer is either appended to (e.g. a
+ * trajectory), or updated with the points of a map keyed by landmark id.
+ * The GPU buffer is reallocated only when its capacity doubles.
+ */
+class IncrementalVertexBuffer {
+ public:
+  KIMERA_POINTER_TYPEDEFS(IncrementalVertexBuffer);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(IncrementalVertexBuffer);
+
+  //! Points [begin, end) to upload.
+  struct SlotRange {
+    size_t begin;
+    size_t end;
+  };
+
+  /**
+   * @param position_tolerance Points that moved less than this [m] (in each
+   * coordinate) since they were last uploaded are not uploaded again.
+   */
+  explicit IncrementalVertexBuffer(const float& position_tolerance = 1e-3f);
+  virtual ~IncrementalVertexBuffer() = default;
+
+  void append(const TelemetryPoint& point);
+
+  /**
+   * @brief update Replaces the points by the given ones: new points are
+   * appended, moved ones are updated in place, and removed ones are replaced
+   * by the last point, so that the points stay contiguous.
+   */
+  void update(const TelemetryPoints& points);
+
+  /**
+   * @brief takeDirtyRanges Ranges of points changed since the last call,
+   * sorted. Close ranges are merged: one larger upload is cheaper than many.
+   * @return True if the GPU buffer must first be reallocated to capacity()
+   * points, in which case the ranges cover all the points.
+   */
+  bool takeDirtyRanges(std::vector<SlotRange>* ranges);
+
+  //! Nr of points.
+  inline size_t size() const { return data_.size() / 3u; }
+  //! Nr of points the GPU buffer holds.
+  inline size_t capacity() const { return capacity_; }
+  //! Coordinates of the points, 3 per point.
+  inline const std::vector<float>& getData() const { return data_; }
+
+  //! Slot of the point of a landmark, false if not in the buffer.
+  bool getSlot(const LandmarkId& lmk_id, size_t* slot) const;
+
+ private:
+  void setPoint(const size_t& slot, const TelemetryPoint& point);
+
+ private:
+  const float position_tolerance_;
+  std::vector<float> data_;
+  //! Landmark of each slot, and slot of each landmark, if updated.
+  std::vector<LandmarkId> lmk_ids_;
+  std::unordered_map<LandmarkId, size_t> slots_;
+  //! Changed since the last takeDirtyRanges, may be repeated.
+  std::vector<size_t> dirty_slots_;
+  size_t capacity_;
+  bool reallocate_;
+};
+
+}  // namespace VIO
@@ -0,0 +1,76 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   MeshColorCache.h
+ * @brief  Per-vertex colors of a mesh, only rewritten where they changed.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+/**
+ * @brief The MeshColorCache class keeps the colors of the vertices of a mesh
+ * (N rows, 1 column, CV_8UC3) across frames, so that coloring the mesh by
+ * triangle clusters only writes the vertices whose color changed since the
+ * previous frame (e.g. a new vertex, or a vertex that joined or left a
+ * cluster) instead of filling and recoloring the whole mesh every frame.
+ *
+ * Each frame: startFrame, then setTrianglesColor per cluster (a vertex takes
+ * the color of the last cluster having it), then finishFrame.
+ */
+class MeshColorCache {
+ public:
+  KIMERA_POINTER_TYPEDEFS(MeshColorCache);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(MeshColorCache);
+
+  //! @param default_color Of the vertices in no cluster.
+  explicit MeshColorCache(const cv::Vec3b& default_color);
+  virtual ~MeshColorCache() = default;
+
+  //! Starts coloring a mesh of nr_vertices, all of the default color.
+  void startFrame(const size_t& nr_vertices);
+
+  /**
+   * @brief setTrianglesColor Colors the vertices of the given triangles.
+   * @param triangle_ids Ids of the triangles in polygons_mesh.
+   * @param polygons_mesh Faces of the mesh, 1 column of 4 ints per triangle:
+   * [3 id_a id_b id_c ...].
+   */
+  void setTrianglesColor(const std::vector<int>& triangle_ids,
+                         const cv::Mat& polygons_mesh,
+                         const cv::Vec3b& color);
+
+  /**
+   * @brief finishFrame Writes the colors of the vertices that changed since
+   * the previous frame.
+   * @return Nr of vertices recolored, including the vertices added since the
+   * previous frame.
+   */
+  size_t finishFrame();
+
+  //! Colors of the vertices as of the last finishFrame.
+  inline const cv::Mat& getColors() const { return colors_; }
+
+ private:
+  const cv::Vec3b default_color_;
+  cv::Mat colors_;
+  //! Colors of the frame being colored, written to colors_ by finishFrame.
+  std::vector<cv::Vec3b> frame_colors_;
+};
+
+}  // namespace VIO
@@ -14,9 +14,11 @@
 
 #pragma once
 
+#include <chrono>
 #include <deque>
 #include <map>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -34,8 +36,10 @@
 #include "kimera-vio/frontend/MonoVisionImuFrontend-definitions.h"
 #include "kimera-vio/frontend/StereoVisionImuFrontend-definitions.h"
 #include "kimera-vio/logging/Logger.h"
+#include "kimera-vio/mesh/MeshDecimation.h"
 #include "kimera-vio/mesh/Mesher-definitions.h"
 #include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/visualizer/MeshColorCache.h"
 #include "kimera-vio/visualizer/Visualizer3D-definitions.h"
 #include "kimera-vio/visualizer/Visualizer3D.h"
 
@@ -78,6 +82,14 @@ class OpenCvVisualizer3D : public Visualizer3D {
    */
   VisualizerOutput::UniquePtr spinOnce(const VisualizerInput& input) override;
 
+  //! The factor graph is drawn with the smoother's state.
+  BackendOutputFields getRequiredBackendOutputFields() const override {
+    BackendOutputFields fields;
+    fields.state_ = true;
+    fields.factor_graph_ = true;
+    return fields;
+  }
+
  public:
   // Visualization calls are public in case the user wants to manually visualize
   // things, instead of running spinOnce and do it automatically.
@@ -97,7 +109,8 @@ class OpenCvVisualizer3D : public Visualizer3D {
   /**
    * @brief visualizeTrajectory3D
    * Visualize currently stored 3D trajectory (user needs to add poses with
-   * addPoseToTrajectory).
+   * addPoseToTrajectory). The trajectory is split in several widgets, only
+   * those that changed since the last call are added to widgets_map.
    * @param frustum_image
    * @param widgets_map
    */
@@ -196,6 +209,10 @@ class OpenCvVisualizer3D : public Visualizer3D {
                 WidgetsMap* widgets);
 
  private:
+  //! Whether the 3D widgets must be rebuilt for the current input, given
+  //! FLAGS_visualizer_widgets_rate_hz.
+  bool shouldUpdateWidgets();
+
   //! Create a 2D mesh from 2D corners in an image, coded as a Frame class
   static cv::Mat visualizeMesh2D(
       const std::vector<cv::Vec6f>& triangulation2D,
@@ -208,7 +225,8 @@ class OpenCvVisualizer3D : public Visualizer3D {
       const Frame& ref_frame);
 
  private:
-  //! Visualize a 3D point cloud of unique 3D landmarks.
+  //! Visualize a 3D point cloud of unique 3D landmarks, downsampled if
+  //! FLAGS_visualize_point_cloud_voxel_size is positive.
   void visualizePoints3D(const PointsWithIdMap& points_with_id,
                          const LmkIdToLmkTypeMap& lmk_id_to_lmk_type_map,
                          WidgetsMap* widgets_map);
@@ -244,12 +262,14 @@ class OpenCvVisualizer3D : public Visualizer3D {
   /// [in] polygons_mesh: mesh faces, format is n rows, 1 column,
   ///  with [n id_a id_b id_c, ..., n /id_x id_y id_z], where n = polygon size
   ///  n=3 for triangles.
+  /// [in] vertices_lmk_ids: landmark id of each vertex, to log the mesh.
   /// [in] color_mesh whether to color the mesh or not
   /// [in] timestamp to store the timestamp of the mesh when logging the mesh.
   void visualizeMesh3DWithColoredClusters(
       const std::vector<Plane>& planes,
       const cv::Mat& map_points_3d,
       const cv::Mat& polygons_mesh,
+      const LandmarkIds& vertices_lmk_ids,
       WidgetsMap* widgets,
       const bool visualize_mesh_with_colored_polygon_clusters = false,
       const Timestamp& timestamp = 0.0);
@@ -313,8 +333,9 @@ class OpenCvVisualizer3D : public Visualizer3D {
   // Record video sequence at a hardcoded directory relative to executable.
   void recordVideo();
 
-  //! Log mesh to ply file.
-  void logMesh(const cv::Mat& map_points_3d,
+  //! Log changes of the mesh to a binary mesh log.
+  void logMesh(const LandmarkIds& vertices_lmk_ids,
+               const cv::Mat& map_points_3d,
                const cv::Mat& colors,
                const cv::Mat& polygons_mesh,
                const Timestamp& timestamp,
@@ -323,10 +344,12 @@ class OpenCvVisualizer3D : public Visualizer3D {
   //! Input the mesh points and triangle clusters, and
   //! output colors matrix for mesh visualizer.
   //! This will color the point with the color of the last plane having it.
+  //! The colors are cached: only the vertices whose color changed since the
+  //! previous call are recolored, and colors shares the cached data.
   void colorMeshByClusters(const std::vector<Plane>& planes,
                            const cv::Mat& map_points_3d,
                            const cv::Mat& polygons_mesh,
-                           cv::Mat* colors) const;
+                           cv::Mat* colors);
 
   //! Decide color of the cluster depending on its id.
   void getColorById(const size_t& id, cv::viz::Color* color) const;
@@ -411,6 +434,18 @@ class OpenCvVisualizer3D : public Visualizer3D {
   Mesh3dVizPropertiesSetterCallback mesh3d_viz_properties_callback_;
 
   std::deque<cv::Affine3d> trajectory_poses_3d_;
+  //! Nr of poses ever added to the trajectory.
+  size_t trajectory_nr_poses_ = 0u;
+  //! Nr of segments of a trajectory widget, see visualizeTrajectory3D.
+  static constexpr size_t kTrajectoryWidgetSize = 100u;
+  //! Trajectory widgets shown: [begin, end).
+  size_t trajectory_widgets_begin_ = 0u;
+  size_t trajectory_widgets_end_ = 0u;
+  size_t trajectory_first_pose_shown_ = 0u;
+
+  //! Last time the 3D widgets were rebuilt, see shouldUpdateWidgets.
+  std::optional<std::chrono::high_resolution_clock::time_point>
+      last_widgets_update_;
 
   std::map<PlaneId, LineNr> plane_to_line_nr_map_;
   PlaneIdMap plane_id_map_;
@@ -472,6 +507,14 @@ class OpenCvVisualizer3D : public Visualizer3D {
   //! Logging instance.
   std::unique_ptr<VisualizerLogger> logger_;
 
+  //! Coarse version of the mesh to display and log, only if
+  //! FLAGS_visualize_decimated_mesh.
+  MeshDecimator::UniquePtr mesh_decimator_;
+
+  //! Colors of the vertices of the mesh colored by clusters, kept across
+  //! spins to only recolor what changed.
+  MeshColorCache mesh_color_cache_;
+
   // TODO(Toni): maybe just use the trajectory_poses_3d_ as it has this info
   //! Pose of the last last keyframe (Bllkf), ie previous to the current
   //! keyframe (Blkf). This is for the frontendVisualizer to plot the
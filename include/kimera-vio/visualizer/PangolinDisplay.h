@@ -14,14 +14,20 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include <pangolin/pangolin.h>
-#include <pangolin/scene/axis.h>
-#include <pangolin/scene/scenehandler.h>
 
 #include "kimera-vio/pipeline/Pipeline-definitions.h"  // Needed for shutdown cb
 #include "kimera-vio/utils/Macros.h"
 #include "kimera-vio/visualizer/Display-definitions.h"
 #include "kimera-vio/visualizer/Display.h"
+#include "kimera-vio/visualizer/IncrementalVertexBuffer.h"
 #include "kimera-vio/visualizer/Visualizer3D-definitions.h"
 
 #include "kimera-vio/mesh/Mesh.h"
@@ -38,6 +44,14 @@ struct PangolinDisplayInput: public DisplayInputBase {
   Mesh3D mesh_3d_;
 };
 
+/**
+ * @brief The PangolinDisplay class renders the TelemetryOutput of the
+ * TelemetryVisualizer3D (trajectory, landmarks and mesh) from persistent
+ * OpenGL buffers, on its own thread at the monitor rate. The outputs only
+ * update the host copies of the buffers, and the render thread uploads what
+ * changed: new trajectory poses are appended, and moved landmarks updated in
+ * place (see IncrementalVertexBuffer). Images are not displayed.
+ */
 class PangolinDisplay : public DisplayBase {
  public:
   KIMERA_POINTER_TYPEDEFS(PangolinDisplay);
@@ -47,34 +61,47 @@ class PangolinDisplay : public DisplayBase {
   PangolinDisplay(DisplayParams::Ptr display_params,
                   const ShutdownPipelineCallback& shutdown_pipeline_cb);
 
-  // TODO(Toni): consider using `unregisterAllWindows`
-  ~PangolinDisplay() override = default;
+  ~PangolinDisplay() override;
 
   /**
-   * @brief spinOnce
-   * Spins renderers to display data using Pangolin
-   * Displaying must be done in the main thread, that it is why it is separated
-   * from Visualizer3D (plus it makes everything faster as displaying and
-   * building 3D graphics is decoupled).
-   * @param viz_output
+   * @brief spinOnce Updates the scene with the visualizer output, rendered
+   * by the render thread. Calls the shutdown callback once the window is
+   * closed.
+   * @param viz_input Visualizer output, used if a TelemetryOutput.
    */
   void spinOnce(DisplayInputBase::UniquePtr&& viz_input) override;
 
  private:
-  //! Adds 3D widgets to the window, and displays it.
-  void spin3dWindow(VisualizerOutput::UniquePtr&& viz_output);
+  //! OpenGL buffers of the scene, owned by the render thread.
+  struct GlScene;
 
-  //! Visualizes 2D data.
-  void spin2dWindow(const DisplayInputBase& viz_output);
+  //! Loop of the render thread, which owns the OpenGL context.
+  void render();
+
+  //! Uploads the changes of the scene to its OpenGL buffers.
+  void uploadScene(GlScene* gl_scene);
 
  private:
-  pangolin::OpenGlRenderState s_cam;
-  pangolin::Renderable tree;
-  std::unique_ptr<pangolin::SceneHandler> handler;
-  pangolin::View d_cam;
+  const std::string window_name_;
   //! We use this callback to shutdown the pipeline gracefully if
   //! the visualization window is closed.
   ShutdownPipelineCallback shutdown_pipeline_cb_;
+
+  //! Scene, as of the last visualizer output, guarded by scene_mutex_.
+  std::mutex scene_mutex_;
+  IncrementalVertexBuffer trajectory_;
+  IncrementalVertexBuffer landmarks_;
+  IncrementalVertexBuffer mesh_vertices_;
+  //! Slots of the mesh vertices of each triangle, uploaded as a whole since
+  //! the mesh is triangulated again at each keyframe.
+  std::vector<uint32_t> mesh_indices_;
+  bool mesh_indices_changed_;
+  //! Current pose of the body, column major.
+  pangolin::OpenGlMatrix W_T_B_;
+
+  std::atomic<bool> shutdown_;
+  std::atomic<bool> window_closed_;
+  std::thread render_thread_;
 };
 
 }  // namespace VIO
@@ -0,0 +1,155 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   TelemetryCodec.h
+ * @brief  Compact binary encoding of the map essentials (pose, landmarks,
+ * mesh, images) for external viewers.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+//! 3D position, single precision is enough for display.
+using TelemetryPoint = std::array<float, 3>;
+using TelemetryPoints = std::map<LandmarkId, TelemetryPoint>;
+//! Triangle of the mesh, given by the landmark ids of its vertices.
+using TelemetryTriangle = std::array<LandmarkId, 3>;
+using TelemetryTriangles = std::set<TelemetryTriangle>;
+
+/**
+ * @brief The TelemetryMap struct: what an external viewer needs to render
+ * the map, all in the world frame.
+ */
+struct TelemetryMap {
+  Timestamp timestamp_ = 0;
+  //! Pose of the body: position and (w, x, y, z) quaternion.
+  std::array<double, 3> position_ = {{0.0, 0.0, 0.0}};
+  std::array<double, 4> orientation_ = {{1.0, 0.0, 0.0, 0.0}};
+  TelemetryPoints landmarks_;
+  TelemetryPoints mesh_vertices_;
+  TelemetryTriangles mesh_triangles_;
+};
+
+struct TelemetryImage {
+  Timestamp timestamp_ = 0;
+  std::string name_;
+  //! Compressed image (e.g. JPEG), see cv::imdecode.
+  std::string data_;
+};
+
+/**
+ * Wire format, little endian. Each packet has an 8 bytes header:
+ * - u16 kTelemetryMagic, u8 kTelemetryVersion, u8 TelemetryPacketType,
+ * - u32 size of the payload in bytes.
+ * Map payloads (kMapDelta, kMapSnapshot):
+ * - i64 timestamp, 3 f64 position, 4 f32 orientation,
+ * - landmarks, then mesh vertices: varint nr of upserts, and for each the
+ *   landmark id and 3 f32 position; varint nr of removals, and their ids,
+ * - mesh triangles: varint nr of additions, and their 3 ids each; varint
+ *   nr of removals, and their 3 ids each.
+ * Ids are sorted, and written as the zigzag varint of their difference with
+ * the previous id of the same list. A snapshot replaces the map, a delta
+ * updates it.
+ * Image payloads (kImage):
+ * - i64 timestamp, varint size and bytes of the name, then of the data.
+ */
+static constexpr uint16_t kTelemetryMagic = 0x564bu;  // "KV"
+static constexpr uint8_t kTelemetryVersion = 1u;
+static constexpr size_t kTelemetryHeaderSize = 8u;
+
+enum class TelemetryPacketType : uint8_t {
+  kMapDelta = 0u,
+  kMapSnapshot = 1u,
+  kImage = 2u
+};
+
+/**
+ * @brief The TelemetryEncoder class encodes maps as deltas with respect to
+ * the last map it encoded, which is what the receivers of all its packets
+ * have decoded.
+ */
+class TelemetryEncoder {
+ public:
+  KIMERA_POINTER_TYPEDEFS(TelemetryEncoder);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(TelemetryEncoder);
+
+  /**
+   * @param position_tolerance Points that moved less than this [m] (in each
+   * coordinate) since they were last encoded are not encoded again.
+   */
+  explicit TelemetryEncoder(const float& position_tolerance = 1e-3f);
+  virtual ~TelemetryEncoder() = default;
+
+  //! Appends the delta packet from the last encoded map to the given one.
+  void encodeMapDelta(const TelemetryMap& map, std::string* packet);
+
+  //! Appends a snapshot packet of the last encoded map, for new receivers.
+  void encodeMapSnapshot(std::string* packet) const;
+
+  static void encodeImage(const TelemetryImage& image, std::string* packet);
+
+  //! The map as decoded by the receivers: within tolerance of the encoded
+  //! maps.
+  inline const TelemetryMap& getEncodedMap() const { return encoded_map_; }
+
+ private:
+  const float position_tolerance_;
+  TelemetryMap encoded_map_;
+};
+
+/**
+ * @brief The TelemetryDecoder class applies the packets of a
+ * TelemetryEncoder to its map.
+ */
+class TelemetryDecoder {
+ public:
+  KIMERA_POINTER_TYPEDEFS(TelemetryDecoder);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(TelemetryDecoder);
+
+  TelemetryDecoder() = default;
+  virtual ~TelemetryDecoder() = default;
+
+  /**
+   * @brief getPacketSize For framing a stream of packets.
+   * @return Size of the packet at the beginning of the data (header included),
+   * or 0 if the data does not hold a complete packet yet.
+   */
+  static size_t getPacketSize(const char* data, const size_t& size);
+
+  /**
+   * @brief decodePacket Decodes one complete packet, see getPacketSize.
+   * Updates the map, or the image, depending on the packet type.
+   * @return False if the packet is malformed; the map is then unspecified
+   * until the next snapshot.
+   */
+  bool decodePacket(const char* data,
+                    const size_t& size,
+                    TelemetryPacketType* type = nullptr);
+
+  inline const TelemetryMap& getMap() const { return map_; }
+  //! Last decoded image.
+  inline const TelemetryImage& getImage() const { return image_; }
+
+ private:
+  TelemetryMap map_;
+  TelemetryImage image_;
+};
+
+}  // namespace VIO
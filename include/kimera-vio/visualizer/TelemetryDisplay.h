@@ -0,0 +1,79 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   TelemetryDisplay.h
+ * @brief  Streams the map essentials and image thumbnails to external
+ * viewers, instead of rendering them.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "kimera-vio/pipeline/Pipeline-definitions.h"  // Needed for shutdown cb
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/visualizer/Display.h"
+#include "kimera-vio/visualizer/TelemetryCodec.h"
+#include "kimera-vio/visualizer/TelemetryDisplayParams.h"
+#include "kimera-vio/visualizer/Visualizer3D-definitions.h"
+
+namespace VIO {
+
+/**
+ * @brief The TelemetryDisplay class is a TCP server streaming the
+ * TelemetryCodec packets to any number of viewers: map deltas of the
+ * TelemetryOutput of the TelemetryVisualizer3D (a snapshot first), and
+ * thumbnails of the images to display. Never blocks: viewers that lag too
+ * far behind are disconnected, and may reconnect.
+ */
+class TelemetryDisplay : public DisplayBase {
+ public:
+  KIMERA_POINTER_TYPEDEFS(TelemetryDisplay);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(TelemetryDisplay);
+
+  //! There is no window to close, hence the shutdown callback is not used.
+  TelemetryDisplay(DisplayParams::Ptr display_params,
+                   const ShutdownPipelineCallback& shutdown_pipeline_cb);
+  ~TelemetryDisplay() override;
+
+  void spinOnce(DisplayInputBase::UniquePtr&& display_input) override;
+
+  //! Port the server listens to, e.g. if any free port was requested.
+  inline int getPort() const { return port_; }
+
+  inline size_t getNumberOfViewers() const { return viewers_.size(); }
+
+ private:
+  struct Viewer {
+    int socket_fd_;
+    //! Packets not sent yet.
+    std::string pending_;
+    bool needs_snapshot_;
+  };
+
+  void acceptViewers();
+
+  //! Appends the thumbnail packets of the images to the given packets.
+  void encodeImages(const DisplayInputBase& display_input,
+                    std::string* packets) const;
+
+  //! Sends what the socket takes, false if the viewer must be disconnected.
+  bool sendPending(Viewer* viewer) const;
+
+ private:
+  const TelemetryDisplayParams params_;
+  TelemetryEncoder encoder_;
+  int server_fd_;
+  int port_;
+  std::vector<Viewer> viewers_;
+};
+
+}  // namespace VIO
@@ -0,0 +1,58 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   TelemetryDisplayParams.h
+ * @brief  Params for the telemetry display
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <string>
+
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/visualizer/DisplayParams.h"
+
+namespace VIO {
+
+class TelemetryDisplayParams : public DisplayParams {
+ public:
+  KIMERA_POINTER_TYPEDEFS(TelemetryDisplayParams);
+  TelemetryDisplayParams();
+  ~TelemetryDisplayParams() override = default;
+
+  // Parse YAML file describing telemetry parameters.
+  bool parseYAML(const std::string& filepath) override;
+
+  // Display all params.
+  void print() const override;
+
+  // Assert equality up to a tolerance.
+  bool equals(const TelemetryDisplayParams& tel_par,
+              const double& tol = 1e-9) const;
+
+ protected:
+  inline bool equals(const DisplayParams& rhs,
+                     const double& tol = 1e-9) const override {
+    return equals(static_cast<const TelemetryDisplayParams&>(rhs), tol);
+  }
+
+ public:
+  //! TCP port viewers connect to, 0 for any free port.
+  int port_ = 5600;
+  //! Images are downscaled to at most this width [px] before compression.
+  int thumbnail_width_ = 320;
+  int jpeg_quality_ = 70;
+  //! Points that moved less than this [m] are not sent again.
+  double position_tolerance_ = 0.005;
+  //! Viewers lagging behind by more than this are disconnected.
+  int max_pending_bytes_ = 16 * 1024 * 1024;
+};
+
+}  // namespace VIO
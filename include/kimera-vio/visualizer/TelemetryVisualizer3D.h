@@ -0,0 +1,58 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   TelemetryVisualizer3D.h
+ * @brief  Gathers the map essentials for TelemetryDisplay, without building
+ * any 3D widget.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/visualizer/TelemetryCodec.h"
+#include "kimera-vio/visualizer/Visualizer3D-definitions.h"
+#include "kimera-vio/visualizer/Visualizer3D.h"
+
+namespace VIO {
+
+/**
+ * @brief The TelemetryOutput struct: the whole map (not a delta) so that
+ * the display may skip outputs, see DisplayModule::mergeInputs. It has no
+ * widgets.
+ */
+struct TelemetryOutput : public VisualizerOutput {
+  KIMERA_POINTER_TYPEDEFS(TelemetryOutput);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(TelemetryOutput);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  TelemetryOutput() : VisualizerOutput(), map_() {}
+  ~TelemetryOutput() = default;
+
+  TelemetryMap map_;
+};
+
+/**
+ * @brief The TelemetryVisualizer3D class: for headless runs, the rendering is
+ * left to external viewers of the TelemetryDisplay stream.
+ */
+class TelemetryVisualizer3D : public Visualizer3D {
+ public:
+  KIMERA_POINTER_TYPEDEFS(TelemetryVisualizer3D);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(TelemetryVisualizer3D);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  explicit TelemetryVisualizer3D(const VisualizationType& viz_type);
+  virtual ~TelemetryVisualizer3D() = default;
+
+  //! Returns a TelemetryOutput: with the pose, and depending on the
+  //! visualization type, the landmarks and the 3D mesh.
+  VisualizerOutput::UniquePtr spinOnce(const VisualizerInput& input) override;
+};
+
+}  // namespace VIO
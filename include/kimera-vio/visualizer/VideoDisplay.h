@@ -0,0 +1,91 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   VideoDisplay.h
+ * @brief  Renders the visualizer output offscreen and encodes it to videos.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+
+#include <opencv2/videoio.hpp>
+#include <opencv2/viz.hpp>
+
+#include "kimera-vio/pipeline/Pipeline-definitions.h"  // Needed for shutdown cb
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/visualizer/Display.h"
+#include "kimera-vio/visualizer/VideoDisplayParams.h"
+#include "kimera-vio/visualizer/Visualizer3D-definitions.h"
+
+namespace VIO {
+
+/**
+ * @brief The VideoDisplay class records review videos instead of showing
+ * windows: the 3D widgets of the OpenCV visualizer are rendered offscreen (no
+ * window is created, but VTK needs an offscreen-capable OpenGL context, e.g.
+ * OSMesa or EGL, on machines without a display server), and each image to
+ * display is a stream of its own. Each stream is encoded to a video in
+ * VideoDisplayParams::output_path_, with a hardware encoder if the OpenCV
+ * backend has one (OpenCV >= 4.5.2), a software one otherwise. The size of
+ * each video is set by its first frame, later frames are resized to it.
+ */
+class VideoDisplay : public DisplayBase {
+ public:
+  KIMERA_POINTER_TYPEDEFS(VideoDisplay);
+  KIMERA_DELETE_COPY_CONSTRUCTORS(VideoDisplay);
+
+  //! There is no window to close, hence the shutdown callback is not used.
+  VideoDisplay(DisplayParams::Ptr display_params,
+               const ShutdownPipelineCallback& shutdown_pipeline_cb);
+  //! Finalizes the videos.
+  ~VideoDisplay() override = default;
+
+  void spinOnce(DisplayInputBase::UniquePtr&& display_input) override;
+
+  //! Frames encoded in the given stream ("3d_viz" or an image name) so far.
+  size_t getNumberOfFrames(const std::string& stream_name) const;
+
+  //! Whether the given stream is encoded by a hardware encoder.
+  bool isHardwareAccelerated(const std::string& stream_name) const;
+
+ public:
+  static const std::string k3dStreamName;
+
+ private:
+  struct VideoStream {
+    cv::VideoWriter writer_;
+    cv::Size size_;
+    size_t nr_frames_ = 0u;
+    bool hardware_accelerated_ = false;
+    //! Could not be opened: further frames are dropped.
+    bool failed_ = false;
+  };
+
+  //! Renders the widgets offscreen, returns the rendered image.
+  cv::Mat render3d(const VisualizerOutput& viz_output);
+
+  //! Encodes the frame (converted to 8-bit BGR) in the given stream, opening
+  //! it if needed.
+  void writeFrame(const std::string& stream_name, const cv::Mat& frame);
+
+  //! Opens the video, with a hardware encoder first if requested.
+  bool openStream(const std::string& stream_name,
+                  const cv::Size& size,
+                  VideoStream* stream) const;
+
+ private:
+  const VideoDisplayParams params_;
+  cv::viz::Viz3d window_;
+  std::map<std::string, VideoStream> streams_;
+};
+
+}  // namespace VIO
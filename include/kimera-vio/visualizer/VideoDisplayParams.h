@@ -0,0 +1,62 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   VideoDisplayParams.h
+ * @brief  Params for the video display
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <string>
+
+#include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/visualizer/DisplayParams.h"
+
+namespace VIO {
+
+class VideoDisplayParams : public DisplayParams {
+ public:
+  KIMERA_POINTER_TYPEDEFS(VideoDisplayParams);
+  VideoDisplayParams();
+  ~VideoDisplayParams() override = default;
+
+  // Parse YAML file describing video parameters.
+  bool parseYAML(const std::string& filepath) override;
+
+  // Display all params.
+  void print() const override;
+
+  // Assert equality up to a tolerance.
+  bool equals(const VideoDisplayParams& vid_par,
+              const double& tol = 1e-9) const;
+
+ protected:
+  inline bool equals(const DisplayParams& rhs,
+                     const double& tol = 1e-9) const override {
+    return equals(static_cast<const VideoDisplayParams&>(rhs), tol);
+  }
+
+ public:
+  //! Directory where the videos are written, one per stream: 3d_viz and
+  //! each of the images to display, by name.
+  std::string output_path_ = ".";
+  //! h264 or hevc (mp4 files), or mjpg (avi files).
+  std::string codec_ = "h264";
+  //! Frame rate written in the videos [Hz]: one frame per display refresh.
+  double fps_ = 20.0;
+  //! Try a hardware encoder first, falls back to a software one.
+  bool hardware_acceleration_ = true;
+  //! Whether to render the 3D widgets offscreen, and the render size [px].
+  bool record_3d_ = true;
+  int width_3d_ = 1280;
+  int height_3d_ = 720;
+};
+
+}  // namespace VIO
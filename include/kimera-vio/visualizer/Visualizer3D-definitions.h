@@ -32,7 +32,9 @@ namespace VIO {
 
 enum class VisualizerType {
   //! OpenCV 3D viz, uses VTK underneath the hood.
-  OpenCV = 0u
+  OpenCV = 0u,
+  //! No rendering, only the map essentials for TelemetryDisplay.
+  kTelemetry = 1u
 };
 
 enum class VisualizationType {
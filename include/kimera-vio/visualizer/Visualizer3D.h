@@ -36,6 +36,11 @@ class Visualizer3D {
   virtual VisualizerOutput::UniquePtr spinOnce(
       const VisualizerInput& input) = 0;
 
+  //! Heavy fields of the Backend output used by spinOnce (none by default).
+  virtual BackendOutputFields getRequiredBackendOutputFields() const {
+    return BackendOutputFields();
+  }
+
  public:
   VisualizationType visualization_type_;
 };
@@ -14,15 +14,23 @@
 
 #pragma once
 
+#include <functional>
+
 #include <glog/logging.h>
 
 #include "kimera-vio/backend/VioBackend-definitions.h"
 #include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/visualizer/DisplayParams.h"
 #include "kimera-vio/visualizer/Visualizer3D-definitions.h"
 #include "kimera-vio/visualizer/Visualizer3D.h"
 
 namespace VIO {
 
+/**
+ * @brief The VisualizerFactory creates the visualizers registered for each
+ * visualizer type, as the DisplayFactory does for displays: the OpenCV one
+ * needs KIMERA_BUILD_GUI, the telemetry one is always built.
+ */
 class VisualizerFactory {
  public:
   KIMERA_POINTER_TYPEDEFS(VisualizerFactory);
@@ -30,6 +38,26 @@ class VisualizerFactory {
   VisualizerFactory() = delete;
   virtual ~VisualizerFactory() = default;
 
+  typedef std::function<Visualizer3D::UniquePtr(const VisualizationType&,
+                                                const BackendType&)>
+      VisualizerCreator;
+
+  /**
+   * @brief registerVisualizer Registers the creator of the visualizers of
+   * the given type, replacing the previous one if any.
+   * @return True, so that it can initialize a static variable.
+   */
+  static bool registerVisualizer(const VisualizerType& visualizer_type,
+                                 const VisualizerCreator& creator);
+
+  static bool isVisualizerRegistered(const VisualizerType& visualizer_type);
+
+  //! Visualizer feeding the given display: the telemetry and Pangolin
+  //! displays only need the map essentials, no widgets.
+  static VisualizerType getVisualizerTypeForDisplay(
+      const DisplayType& display_type);
+
+  //! Returns nullptr if no visualizer of the given type was registered.
   static Visualizer3D::UniquePtr createVisualizer(
       const VisualizerType visualizer_type,
       const VisualizationType& viz_type,
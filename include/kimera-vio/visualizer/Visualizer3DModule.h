@@ -61,6 +61,12 @@ class VisualizerModule
 
   inline void disableMesherQueue() { mesher_queue_.reset(nullptr); }
 
+  //! Heavy Backend output fields to request when registering
+  //! fillBackendQueue.
+  inline BackendOutputFields getRequiredBackendOutputFields() const {
+    return visualizer_->getRequiredBackendOutputFields();
+  }
+
  protected:
   //! Synchronize input queues. Currently doing it in a crude way:
   //! Pop blocking the payload that should be the last to be computed,
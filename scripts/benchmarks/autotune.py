@@ -0,0 +1,321 @@
+#!/usr/bin/env python3
+"""Tune the VIO parameters for speed and accuracy on recorded datasets.
+
+Runs stereoVIOEuroc on each EuRoC dataset once per parameter configuration,
+several runs at a time, and measures the compute time per frame and the
+absolute trajectory error (ATE) of each configuration. Writes the Pareto
+front of the configurations (the fastest one for each accuracy), and the
+parameters of the most accurate configuration within the compute budget.
+
+A configuration overrides the values of keys of the YAML parameter files
+(FrontendParams.yaml, BackendParams.yaml, LcdParams.yaml...), the other keys
+keeping the values of --params-folder. Without --space, a default space of
+the main speed/accuracy knobs is searched.
+
+Examples, from the build directory:
+    # Default space, 40 configurations, 4 runs at a time, 30 ms per frame.
+    ../scripts/benchmarks/autotune.py --dataset ~/euroc/MH_01_easy \
+        --dataset ~/euroc/V1_01_easy --max-configs 40 --jobs 4 \
+        --budget-ms 30
+    # Own space, with extra flags for stereoVIOEuroc after --.
+    ../scripts/benchmarks/autotune.py --dataset ~/euroc/MH_01_easy \
+        --space FrontendParams.yaml:maxFeaturesPerFrame=100,200,300 \
+        --space BackendParams.yaml:nr_states=10,25 --budget-ms 20 \
+        -- --use_lcd=false --final_k=1000
+"""
+import argparse
+import concurrent.futures
+import csv
+import itertools
+import json
+import pathlib
+import random
+import re
+import shutil
+import subprocess
+import sys
+
+# Main speed/accuracy knobs, searched if no --space is given.
+DEFAULT_SPACE = [
+    ("FrontendParams.yaml", "maxFeaturesPerFrame", ["150", "200", "300"]),
+    ("FrontendParams.yaml", "klt_max_level", ["2", "3", "4"]),
+    ("FrontendParams.yaml", "ransac_max_iterations", ["50", "100"]),
+    ("FrontendParams.yaml", "templ_cols", ["41", "71", "101"]),
+    ("BackendParams.yaml", "nr_states", ["10", "15", "25"]),
+    ("LcdParams.yaml", "nfeatures", ["500", "1000"]),
+]
+
+# Timing stats of the modules (see PipelineModule), summed into the compute
+# time per frame.
+MODULE_STATS = ["VioFrontend [ms]", "VioBackend [ms]", "Mesher [ms]",
+                "Lcd [ms]"]
+# Per-frame stat, to count the frames.
+FRAME_STAT = "VioFrontend [ms]"
+# End-to-end latency of the keyframes (see PipelineLatency).
+LATENCY_STAT = "VioBackend Latency [ms]"
+ATE_STAT = "Evaluation ATE RMSE [m]"
+
+
+def parse_space(space):
+    """Parse a 'File.yaml:key=v1,v2,...' dimension of the search space."""
+    file_key, _, values = space.partition("=")
+    file_name, _, key = file_key.partition(":")
+    if not file_name or not key or not values:
+        raise argparse.ArgumentTypeError(
+            "Expected File.yaml:key=v1,v2,..., got: {}".format(space))
+    return file_name, key, values.split(",")
+
+
+def make_configs(space, max_configs, seed):
+    """The configurations to run, as {(file, key): value}, the first one
+    being the base parameters (no overrides)."""
+    dimensions = [[((file_name, key), value) for value in values]
+                  for file_name, key, values in space]
+    configs = [dict(combination)
+               for combination in itertools.product(*dimensions)]
+    if max_configs and len(configs) > max_configs - 1:
+        configs = random.Random(seed).sample(configs, max_configs - 1)
+    return [{}] + configs
+
+
+def override_yaml(path, key, value):
+    """Set the value of a top-level key of an OpenCV YAML file, keeping its
+    comments."""
+    pattern = re.compile(r"^({}\s*:\s*)([^#\n]*?)(\s*#.*)?$".format(
+        re.escape(key)), re.MULTILINE)
+    text = path.read_text()
+    text, nr_matches = pattern.subn(
+        lambda match: match.group(1) + value + (match.group(3) or ""),
+        text, count=1)
+    if nr_matches != 1:
+        raise KeyError("No key {} in {}".format(key, path))
+    path.write_text(text)
+
+
+def write_params(params_folder, config, output_folder):
+    """Copy the base parameters with the overrides of the configuration."""
+    if output_folder.exists():
+        shutil.rmtree(str(output_folder))
+    shutil.copytree(str(params_folder), str(output_folder))
+    for (file_name, key), value in sorted(config.items()):
+        override_yaml(output_folder / file_name, key, value)
+
+
+def load_statistics(stats_path):
+    """Parse StatisticsVIO.yaml (see Statistics::WriteToYamlFile)."""
+    statistics = {}
+    label = None
+    with open(str(stats_path), "r") as stats_file:
+        for line in stats_file:
+            if not line.strip():
+                continue
+            if not line.startswith(" "):
+                label = line.rstrip().rstrip(":")
+                statistics[label] = {}
+            elif label is not None:
+                name, _, value = line.strip().partition(":")
+                statistics[label][name] = float(value)
+    return statistics
+
+
+def yaml_label(tag):
+    """The label of a stat in StatisticsVIO.yaml."""
+    return tag.replace(":", "_").replace("#", "_")
+
+
+def get_run_metrics(stats_path):
+    """Compute time per frame, keyframe latency and ATE of a run."""
+    statistics = load_statistics(stats_path)
+    frames = statistics.get(yaml_label(FRAME_STAT), {}).get("samples", 0)
+    ate = statistics.get(yaml_label(ATE_STAT), {}).get("mean")
+    if not frames or ate is None:
+        return None
+    total_ms = sum(stats["samples"] * stats["mean"]
+                   for tag, stats in statistics.items()
+                   if tag in [yaml_label(stat) for stat in MODULE_STATS])
+    latency = statistics.get(yaml_label(LATENCY_STAT), {})
+    return {
+        "frames": int(frames),
+        "compute_ms": total_ms / frames,
+        "latency_p95_ms": latency.get("p95", float("nan")),
+        "ate_m": ate,
+    }
+
+
+def run_kimera(executable, flagfiles, params_folder, dataset, output_dir,
+               extra_flags):
+    """Run stereoVIOEuroc on the dataset, return its metrics or None."""
+    output_dir.mkdir(parents=True, exist_ok=True)
+    command = [str(executable)]
+    command += ["--flagfile={}".format(flagfile) for flagfile in flagfiles]
+    command += [
+        "--dataset_type=0",
+        "--dataset_path={}".format(dataset),
+        "--params_folder_path={}".format(params_folder),
+        "--output_path={}".format(output_dir),
+        "--log_output=true",
+        "--evaluate_trajectory=true",
+        "--visualize=false",
+        # Frames are not dropped, for the runs to be comparable.
+        "--deterministic_replay=true",
+        "--logtostderr=1",
+    ]
+    command += extra_flags
+    with open(str(output_dir / "kimera.log"), "w") as log_file:
+        ret = subprocess.run(command, stdout=log_file,
+                             stderr=subprocess.STDOUT)
+    if ret.returncode != 0:
+        print("{} failed with code {}, see {}".format(
+            command[0], ret.returncode, output_dir / "kimera.log"))
+        return None
+    stats_path = output_dir / "StatisticsVIO.yaml"
+    if not stats_path.exists():
+        print("No statistics in {}".format(output_dir))
+        return None
+    return get_run_metrics(stats_path)
+
+
+def run_config(index, config, args, extra_flags):
+    """Run the configuration on all datasets, return its result."""
+    config_dir = args.output_dir / "config_{:03d}".format(index)
+    params_folder = config_dir / "params"
+    write_params(args.params_folder, config, params_folder)
+    flagfiles = sorted((args.params_folder / "flags").glob("*.flags"))
+    runs = []
+    for dataset in args.dataset:
+        metrics = run_kimera(args.executable, flagfiles, params_folder,
+                             dataset, config_dir / dataset.name, extra_flags)
+        if metrics is None:
+            # A configuration failing on any dataset is not a candidate.
+            runs = None
+            break
+        runs.append(dict(metrics, dataset=str(dataset)))
+    result = {
+        "index": index,
+        "overrides": {"{}:{}".format(file_name, key): value
+                      for (file_name, key), value in sorted(config.items())},
+        "params_folder": str(params_folder),
+        "runs": runs,
+    }
+    if runs:
+        for metric in ["compute_ms", "latency_p95_ms", "ate_m"]:
+            result[metric] = sum(run[metric] for run in runs) / len(runs)
+    return result
+
+
+def pareto_front(results, cost):
+    """The results no other one is both faster and more accurate than."""
+    front = []
+    for result in sorted(results, key=lambda result: (result[cost],
+                                                      result["ate_m"])):
+        if not front or result["ate_m"] < front[-1]["ate_m"]:
+            front.append(result)
+    return front
+
+
+def main():
+    """Run the configurations, write the Pareto front and recommendation."""
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.
+                                     RawDescriptionHelpFormatter)
+    parser.add_argument("--executable", default="./stereoVIOEuroc",
+                        help="stereoVIOEuroc executable.")
+    parser.add_argument("--params-folder", default="../params/Euroc",
+                        help="Base parameters of the configurations.")
+    parser.add_argument("--dataset", type=pathlib.Path, action="append",
+                        required=True,
+                        help="EuRoC dataset, with ground truth, can be "
+                        "repeated.")
+    parser.add_argument("--space", type=parse_space, action="append",
+                        help="Dimension of the search space, as "
+                        "File.yaml:key=v1,v2,..., can be repeated.")
+    parser.add_argument("--max-configs", type=int, default=50,
+                        help="Configurations run, sampled from the space if "
+                        "it is larger (0: the whole space).")
+    parser.add_argument("--seed", type=int, default=0,
+                        help="Seed of the sampling of the configurations.")
+    parser.add_argument("--jobs", type=int, default=1,
+                        help="Configurations run at a time: keep the cores "
+                        "used by each run free for the timings to hold.")
+    parser.add_argument("--budget-ms", type=float, required=True,
+                        help="Compute budget of the target platform.")
+    parser.add_argument("--budget-metric",
+                        choices=["compute_ms", "latency_p95_ms"],
+                        default="compute_ms",
+                        help="Mean compute time per frame, or 95th "
+                        "percentile latency of the keyframes, in ms.")
+    parser.add_argument("--output-dir", default="autotune",
+                        help="Where to write the runs and the results.")
+    parser.add_argument("extra_flags", nargs=argparse.REMAINDER,
+                        help="Flags for stereoVIOEuroc, after --.")
+    args = parser.parse_args()
+    extra_flags = [flag for flag in args.extra_flags if flag != "--"]
+
+    args.executable = pathlib.Path(args.executable).resolve()
+    args.params_folder = pathlib.Path(args.params_folder).resolve()
+    args.output_dir = pathlib.Path(args.output_dir).resolve()
+    args.dataset = [dataset.resolve() for dataset in args.dataset]
+    configs = make_configs(args.space or DEFAULT_SPACE, args.max_configs,
+                           args.seed)
+    print("Running {} configurations on {} datasets, {} at a time.".format(
+        len(configs), len(args.dataset), args.jobs))
+
+    results = []
+    with concurrent.futures.ThreadPoolExecutor(args.jobs) as executor:
+        futures = [executor.submit(run_config, index, config, args,
+                                   extra_flags)
+                   for index, config in enumerate(configs)]
+        for future in concurrent.futures.as_completed(futures):
+            result = future.result()
+            results.append(result)
+            if result["runs"]:
+                print("config_{:03d}: {:>8.2f} ms/frame  p95 latency {:>8.2f} "
+                      "ms  ATE {:.4f} m  {}".format(
+                          result["index"], result["compute_ms"],
+                          result["latency_p95_ms"], result["ate_m"],
+                          result["overrides"]))
+            else:
+                print("config_{:03d}: failed  {}".format(
+                    result["index"], result["overrides"]))
+    results.sort(key=lambda result: result["index"])
+
+    results_path = args.output_dir / "autotune_results.json"
+    with open(str(results_path), "w") as results_file:
+        json.dump(results, results_file, indent=2)
+    print("Wrote {}".format(results_path))
+
+    candidates = [result for result in results if result["runs"]]
+    front = pareto_front(candidates, args.budget_metric)
+    pareto_path = args.output_dir / "pareto_front.csv"
+    with open(str(pareto_path), "w") as pareto_file:
+        writer = csv.writer(pareto_file)
+        writer.writerow(["config", "compute_ms", "latency_p95_ms", "ate_m",
+                         "overrides"])
+        for result in front:
+            writer.writerow([result["index"], result["compute_ms"],
+                             result["latency_p95_ms"], result["ate_m"],
+                             json.dumps(result["overrides"])])
+    print("Wrote {}".format(pareto_path))
+
+    # The front is sorted by cost: the last one within budget is the most
+    # accurate.
+    within_budget = [result for result in front
+                     if result[args.budget_metric] <= args.budget_ms]
+    if not within_budget:
+        print("No configuration within {} ms ({}).".format(
+            args.budget_ms, args.budget_metric))
+        return 1
+    best = within_budget[-1]
+    recommended = args.output_dir / "recommended"
+    if recommended.exists():
+        shutil.rmtree(str(recommended))
+    shutil.copytree(best["params_folder"], str(recommended))
+    print("Recommended config_{:03d} ({:.2f} ms, ATE {:.4f} m): {}".format(
+        best["index"], best[args.budget_metric], best["ate_m"],
+        best["overrides"] or "base parameters"))
+    print("Wrote its parameters to {}".format(recommended))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+"""Run the kimera_vio benchmarks and check them against a baseline.
+
+Examples, from the build directory:
+    # Save the baseline of this machine (e.g. on the main branch).
+    ../scripts/benchmarks/run_benchmarks.py --save-baseline baseline.json
+    # Check a change against it, failing on regressions of more than 10%.
+    ../scripts/benchmarks/run_benchmarks.py --baseline baseline.json
+    # Only compare two existing results.
+    ../scripts/benchmarks/run_benchmarks.py --baseline baseline.json \
+        --results results.json
+"""
+import argparse
+import json
+import pathlib
+import shutil
+import subprocess
+import sys
+
+
+def run_benchmarks(executable, output, benchmark_filter, repetitions):
+    """Run the benchmarks, writing the JSON results to output."""
+    command = [
+        str(executable),
+        "--benchmark_out={}".format(output),
+        "--benchmark_out_format=json",
+        "--benchmark_repetitions={}".format(repetitions),
+        "--benchmark_report_aggregates_only=true",
+    ]
+    if benchmark_filter:
+        command.append("--benchmark_filter={}".format(benchmark_filter))
+    # The benchmarks find their data relative to the build directory.
+    ret = subprocess.run(command, cwd=str(pathlib.Path(executable).parent))
+    if ret.returncode != 0:
+        raise RuntimeError("{} failed with code {}".format(command[0],
+                                                           ret.returncode))
+
+
+def load_times(results_path, metric):
+    """Get the time of each benchmark, the median if repeated, in ns."""
+    to_ns = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+    with open(str(results_path), "r") as results_file:
+        results = json.load(results_file)
+
+    times = {}
+    for benchmark in results["benchmarks"]:
+        is_median = benchmark.get("aggregate_name", "") == "median"
+        if benchmark.get("run_type", "iteration") == "aggregate" and \
+                not is_median:
+            continue
+        name = benchmark.get("run_name", benchmark["name"])
+        # Medians take precedence over single iterations.
+        if name in times and not is_median:
+            continue
+        times[name] = benchmark[metric] * to_ns[benchmark["time_unit"]]
+    return times
+
+
+def compare(baseline_path, results_path, metric, threshold):
+    """Print the change of each benchmark, return the number of regressions."""
+    baseline = load_times(baseline_path, metric)
+    results = load_times(results_path, metric)
+    nr_regressions = 0
+    print("{:<60} {:>12} {:>12} {:>8}".format(
+        "Benchmark", "Baseline[ms]", "Current[ms]", "Change"))
+    for name in sorted(results):
+        if name not in baseline:
+            print("{:<60} {:>12} {:>12.3f} {:>8}".format(
+                name, "-", results[name] / 1e6, "new"))
+            continue
+        change = results[name] / baseline[name] - 1.0
+        is_regression = change > threshold
+        nr_regressions += is_regression
+        print("{:<60} {:>12.3f} {:>12.3f} {:>+7.1f}%{}".format(
+            name, baseline[name] / 1e6, results[name] / 1e6, 100.0 * change,
+            "  REGRESSION" if is_regression else ""))
+    for name in sorted(set(baseline) - set(results)):
+        print("{:<60} {:>12.3f} {:>12} {:>8}".format(
+            name, baseline[name] / 1e6, "-", "missing"))
+    return nr_regressions
+
+
+def main():
+    """Run and/or compare the benchmarks."""
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.
+                                     RawDescriptionHelpFormatter)
+    parser.add_argument("--executable", default="./benchKimeraVIO",
+                        help="benchKimeraVIO executable (built with "
+                        "-DKIMERA_BUILD_BENCHMARKS=ON).")
+    parser.add_argument("--results", default=None,
+                        help="Existing results to compare, instead of "
+                        "running the benchmarks.")
+    parser.add_argument("--output", default="benchmark_results.json",
+                        help="Where to write the results of the run.")
+    parser.add_argument("--baseline", default=None,
+                        help="Results to compare against.")
+    parser.add_argument("--save-baseline", default=None,
+                        help="Copy the results of the run there.")
+    parser.add_argument("--filter", default="",
+                        help="Regex of the benchmarks to run.")
+    parser.add_argument("--repetitions", type=int, default=5,
+                        help="Repetitions of each benchmark, the median is "
+                        "compared.")
+    parser.add_argument("--metric", default="real_time",
+                        choices=["real_time", "cpu_time"])
+    parser.add_argument("--threshold", type=float, default=0.1,
+                        help="Relative slowdown considered a regression.")
+    args = parser.parse_args()
+
+    results = args.results
+    if results is None:
+        results = str(pathlib.Path(args.output).resolve())
+        run_benchmarks(pathlib.Path(args.executable).resolve(), results,
+                       args.filter, args.repetitions)
+        if args.save_baseline:
+            shutil.copyfile(results, args.save_baseline)
+
+    if args.baseline:
+        nr_regressions = compare(args.baseline, results, args.metric,
+                                 args.threshold)
+        if nr_regressions > 0:
+            print("{} benchmarks regressed by more than {:.0f}%.".format(
+                nr_regressions, 100.0 * args.threshold))
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,170 @@
+#!/usr/bin/env python3
+"""Sweep the synthetic dataset parameters and plot the cost of the modules.
+
+Runs kimeraVIO on the synthetic dataset (--dataset_type=3) once per value of
+each swept parameter, the others keeping their defaults, and plots the mean
+and 95th percentile processing time of the Backend, loop closure and mesher
+against each parameter. The swept parameters are the synthetic_* flags of
+SyntheticDataProvider, without the prefix.
+
+Examples, from the build directory:
+    # Nr of landmarks and frame rate.
+    ../scripts/benchmarks/sweep_synthetic.py \
+        --sweep landmark_density=0.5,1,2,4,8 --sweep frame_rate=10,20,40
+    # Longer trajectory, with extra flags for kimeraVIO after --.
+    ../scripts/benchmarks/sweep_synthetic.py \
+        --sweep angular_velocity=0.1,0.3,0.6 --output-dir sweep_speed \
+        -- --synthetic_duration=60 --use_lcd=false
+"""
+import argparse
+import csv
+import json
+import math
+import pathlib
+import subprocess
+import sys
+
+# Timing stats of the modules (see PipelineModule), and how to plot them.
+MODULE_STATS = {
+    "Backend": "VioBackend [ms]",
+    "Loop closure": "Lcd [ms]",
+    "Mesher": "Mesher [ms]",
+}
+
+
+def parse_sweep(sweep):
+    """Parse a 'name=v1,v2,...' sweep."""
+    name, _, values = sweep.partition("=")
+    if not name or not values:
+        raise argparse.ArgumentTypeError(
+            "Expected name=v1,v2,..., got: {}".format(sweep))
+    return name, [float(value) for value in values.split(",")]
+
+
+def percentile(samples, percent):
+    """Nearest-rank percentile of the samples."""
+    ordered = sorted(samples)
+    rank = max(0, int(math.ceil(percent / 100.0 * len(ordered))) - 1)
+    return ordered[rank]
+
+
+def load_module_costs(stats_path):
+    """Get the mean and p95 cost of each module from StatisticsVIO.csv."""
+    samples = {}
+    with open(str(stats_path), "r") as stats_file:
+        for row in csv.reader(stats_file):
+            if row:
+                samples[row[0]] = [float(sample) for sample in row[1:]]
+
+    costs = {}
+    for module, tag in MODULE_STATS.items():
+        module_samples = samples.get(tag, [])
+        if module_samples:
+            costs[module] = {
+                "mean": sum(module_samples) / len(module_samples),
+                "p95": percentile(module_samples, 95.0),
+                "samples": len(module_samples),
+            }
+    return costs
+
+
+def run_kimera(executable, params_folder, output_dir, flags, extra_flags):
+    """Run kimeraVIO on the synthetic dataset, return the module costs."""
+    output_dir.mkdir(parents=True, exist_ok=True)
+    command = [
+        str(executable),
+        "--dataset_type=3",
+        "--params_folder_path={}".format(params_folder),
+        "--output_path={}".format(output_dir),
+        "--visualize=false",
+        "--use_lcd=true",
+        "--logtostderr=1",
+    ]
+    command += ["--synthetic_{}={:g}".format(name, value)
+                for name, value in flags.items()]
+    command += extra_flags
+    print(" ".join(command))
+    with open(str(output_dir / "kimera.log"), "w") as log_file:
+        ret = subprocess.run(command, stdout=log_file,
+                             stderr=subprocess.STDOUT)
+    if ret.returncode != 0:
+        raise RuntimeError("{} failed with code {}, see {}".format(
+            command[0], ret.returncode, output_dir / "kimera.log"))
+    return load_module_costs(output_dir / "StatisticsVIO.csv")
+
+
+def plot(results, output_dir):
+    """One figure per swept parameter, one line per module."""
+    import matplotlib
+    matplotlib.use("Agg")
+    import matplotlib.pyplot as plt
+
+    for name, runs in results.items():
+        fig, ax = plt.subplots()
+        values = [run["value"] for run in runs]
+        for module in MODULE_STATS:
+            means = [run["costs"].get(module, {}).get("mean", float("nan"))
+                     for run in runs]
+            p95s = [run["costs"].get(module, {}).get("p95", float("nan"))
+                    for run in runs]
+            line, = ax.plot(values, means, marker="o", label=module)
+            ax.plot(values, p95s, linestyle="--", color=line.get_color())
+        ax.set_xlabel(name)
+        ax.set_ylabel("Processing time [ms] (mean, dashed: p95)")
+        ax.set_title("Module cost vs {}".format(name))
+        ax.grid(True)
+        ax.legend()
+        path = output_dir / "sweep_{}.png".format(name)
+        fig.savefig(str(path))
+        plt.close(fig)
+        print("Wrote {}".format(path))
+
+
+def main():
+    """Run the sweeps and plot them."""
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.
+                                     RawDescriptionHelpFormatter)
+    parser.add_argument("--executable", default="./kimeraVIO",
+                        help="kimeraVIO executable.")
+    parser.add_argument("--params-folder", default="../params/Euroc",
+                        help="VIO parameters, the camera and IMU ones are "
+                        "the calibration of the synthetic sensors.")
+    parser.add_argument("--sweep", type=parse_sweep, action="append",
+                        required=True,
+                        help="Parameter to sweep, as name=v1,v2,... (e.g. "
+                        "landmark_density=1,2,4), can be repeated.")
+    parser.add_argument("--output-dir", default="synthetic_sweep",
+                        help="Where to write the runs, results and plots.")
+    parser.add_argument("--no-plot", action="store_true",
+                        help="Only write the results (no matplotlib).")
+    parser.add_argument("extra_flags", nargs=argparse.REMAINDER,
+                        help="Flags for kimeraVIO, after --.")
+    args = parser.parse_args()
+    extra_flags = [flag for flag in args.extra_flags if flag != "--"]
+
+    executable = pathlib.Path(args.executable).resolve()
+    params_folder = pathlib.Path(args.params_folder).resolve()
+    output_dir = pathlib.Path(args.output_dir).resolve()
+    results = {}
+    for name, values in args.sweep:
+        results[name] = []
+        for value in values:
+            run_dir = output_dir / "{}_{:g}".format(name, value)
+            costs = run_kimera(executable, params_folder, run_dir,
+                               {name: value}, extra_flags)
+            results[name].append({"value": value, "costs": costs})
+            for module, cost in sorted(costs.items()):
+                print("  {:<14} mean {:>9.3f} ms  p95 {:>9.3f} ms".format(
+                    module, cost["mean"], cost["p95"]))
+
+    results_path = output_dir / "sweep_results.json"
+    with open(str(results_path), "w") as results_file:
+        json.dump(results, results_file, indent=2)
+    print("Wrote {}".format(results_path))
+    if not args.no_plot:
+        plot(results, output_dir)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
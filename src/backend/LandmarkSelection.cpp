@@ -0,0 +1,78 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   LandmarkSelection.cpp
+ * @brief  Scores and selects the landmarks most informative for the latest
+ * pose, to bound the number of landmarks the backend adds per keyframe.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/backend/LandmarkSelection.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glog/logging.h>
+
+#include <gtsam/geometry/StereoCamera.h>
+
+namespace VIO {
+
+double computeLandmarkInformationGain(
+    const gtsam::StereoPoint2& measurement,
+    const gtsam::Cal3_S2Stereo::shared_ptr& stereo_cal,
+    const gtsam::Pose3& B_Pose_leftCamRect,
+    const gtsam::Matrix6& pose_covariance,
+    const double& noise_sigma) {
+  CHECK_GT(noise_sigma, 0.0);
+  const double disparity = measurement.uL() - measurement.uR();
+  if (!std::isfinite(disparity) || disparity <= 0.0 ||
+      !std::isfinite(measurement.v())) {
+    return 0.0;
+  }
+
+  // Landmark in the body frame, and Jacobian of its measurement wrt the body
+  // pose (at identity): the camera pose is perturbed by Ad(cam_Pose_B) xi.
+  CHECK(stereo_cal);
+  const gtsam::StereoCamera camera(B_Pose_leftCamRect, stereo_cal);
+  const gtsam::Point3 B_lmk = camera.backproject(measurement);
+  gtsam::Matrix36 H_cam;
+  camera.project2(B_lmk, H_cam, boost::none);
+  const gtsam::Matrix36 H_body =
+      H_cam * B_Pose_leftCamRect.inverse().AdjointMap();
+
+  // Matrix determinant lemma: the 3x3 form of log det(I + Sigma J^T J).
+  const gtsam::Matrix3 gain = gtsam::Matrix3::Identity() +
+                              H_body * pose_covariance * H_body.transpose() /
+                                  (noise_sigma * noise_sigma);
+  return std::log(gain.determinant());
+}
+
+LandmarkIds selectMostInformativeLandmarks(std::vector<LandmarkScore> scores,
+                                           const size_t& max_nr_landmarks) {
+  const auto by_decreasing_score = [](const LandmarkScore& a,
+                                      const LandmarkScore& b) {
+    return a.second > b.second || (a.second == b.second && a.first < b.first);
+  };
+  if (scores.size() > max_nr_landmarks) {
+    std::nth_element(scores.begin(),
+                     scores.begin() + max_nr_landmarks,
+                     scores.end(),
+                     by_decreasing_score);
+    scores.resize(max_nr_landmarks);
+  }
+  std::sort(scores.begin(), scores.end(), by_decreasing_score);
+
+  LandmarkIds selected;
+  selected.reserve(scores.size());
+  for (const LandmarkScore& score : scores) selected.push_back(score.first);
+  return selected;
+}
+
+}  // namespace VIO
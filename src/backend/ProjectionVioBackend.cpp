@@ -0,0 +1,196 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ProjectionVioBackend.cpp
+ * @brief  VIO Backend with explicit landmarks in stereo projection factors,
+ * instead of smart factors.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/backend/ProjectionVioBackend.h"
+
+#include <cmath>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <gtsam/geometry/StereoCamera.h>
+#include <gtsam/inference/Symbol.h>
+
+namespace VIO {
+
+/* -------------------------------------------------------------------------- */
+ProjectionVioBackend::ProjectionVioBackend(
+    const Pose3& B_Pose_leftCamRect,
+    const StereoCalibPtr& stereo_calibration,
+    const BackendParams& backend_params,
+    const ImuParams& imu_params,
+    const BackendOutputParams& backend_output_params,
+    const bool& log_output,
+    std::optional<OdometryParams> odom_params)
+    : VioBackend(B_Pose_leftCamRect,
+                 stereo_calibration,
+                 backend_params,
+                 imu_params,
+                 backend_output_params,
+                 log_output,
+                 odom_params),
+      stereo_noise_(),
+      mono_noise_(),
+      mono_cal_(new Cal3_S2(stereo_cal_->calibration())) {
+  LOG(INFO) << "Using Projection VIO Backend.\n";
+  // Same measurement model as the smart factors, with a Huber kernel
+  // instead of their outlier rejection threshold.
+  const auto huber = gtsam::noiseModel::mEstimator::Huber::Create(
+      backend_params_.outlierRejection_ / backend_params_.smartNoiseSigma_);
+  stereo_noise_ = gtsam::noiseModel::Robust::Create(
+      huber,
+      gtsam::noiseModel::Isotropic::Sigma(3, backend_params_.smartNoiseSigma_));
+  mono_noise_ = gtsam::noiseModel::Robust::Create(
+      huber,
+      gtsam::noiseModel::Isotropic::Sigma(2, backend_params_.smartNoiseSigma_));
+}
+
+/* -------------------------------------------------------------------------- */
+void ProjectionVioBackend::addLandmarksToGraph(
+    const LandmarkIds& landmarks_kf) {
+  int n_new_landmarks = 0;
+  int n_updated_landmarks = 0;
+  debug_info_.numAddedSmartF_ += landmarks_kf.size();
+
+  const LandmarkIds selected_landmarks =
+      backend_params_.maxLandmarksPerKeyframe_ > 0
+          ? selectLandmarks(landmarks_kf)
+          : landmarks_kf;
+  for (const LandmarkId& lmk_id : selected_landmarks) {
+    FeatureTrack& ft = feature_tracks_.at(lmk_id);
+    const gtsam::Symbol lmk_key(kLandmarkSymbolChar, lmk_id);
+    // The landmark may have been marginalized while not observed. It may also
+    // not be in the smoother yet, if its keyframe was deferred (batched
+    // update).
+    if (ft.in_ba_graph_ && !state_.exists(lmk_key) &&
+        !new_values_.exists(lmk_key)) {
+      ft.in_ba_graph_ = false;
+    }
+
+    if (!ft.in_ba_graph_) {
+      if (ft.obs_.size() < 2u) continue;
+      if (addNewLandmark(lmk_id, ft)) {
+        ft.in_ba_graph_ = true;
+        ++n_new_landmarks;
+      }
+    } else {
+      const std::pair<FrameId, StereoPoint2>& obs_kf = ft.obs_.back();
+      CHECK_EQ(obs_kf.first, static_cast<FrameId>(curr_kf_id_))
+          << "addLandmarksToGraph: last obs is not from the current keyframe!";
+      addObservation(lmk_id, obs_kf);
+      // Keep the landmark in the smoother while it is observed.
+      if (!new_values_.exists(lmk_key)) refreshed_keys_.push_back(lmk_key);
+      ++n_updated_landmarks;
+    }
+  }
+  deleteOldFeatureTracks();
+
+  VLOG(10) << "Added " << n_new_landmarks << " new landmarks\n"
+           << "Updated " << n_updated_landmarks << " landmarks in graph";
+}
+
+/* -------------------------------------------------------------------------- */
+std::optional<gtsam::Pose3> ProjectionVioBackend::getPoseEstimate(
+    const FrameId& frame_id) const {
+  const gtsam::Symbol pose_key(kPoseSymbolChar, frame_id);
+  if (new_values_.exists(pose_key)) {
+    return new_values_.at<gtsam::Pose3>(pose_key);
+  }
+  if (state_.exists(pose_key)) return state_.at<gtsam::Pose3>(pose_key);
+  return std::nullopt;
+}
+
+/* -------------------------------------------------------------------------- */
+bool ProjectionVioBackend::addNewLandmark(const LandmarkId& lmk_id,
+                                          const FeatureTrack& ft) {
+  const std::pair<FrameId, StereoPoint2>& obs_kf = ft.obs_.back();
+  const StereoPoint2& measurement = obs_kf.second;
+  const double disparity = measurement.uL() - measurement.uR();
+  if (!std::isfinite(disparity) || disparity <= 0.0) return false;
+  const std::optional<gtsam::Pose3> W_Pose_B = getPoseEstimate(obs_kf.first);
+  CHECK(W_Pose_B) << "No estimate of the current keyframe pose.";
+
+  const gtsam::StereoCamera camera(W_Pose_B->compose(B_Pose_leftCamRect_),
+                                   stereo_cal_);
+  const gtsam::Point3 W_lmk = camera.backproject(measurement);
+  if (camera.pose().transformTo(W_lmk).z() >
+      backend_params_.landmarkDistanceThreshold_) {
+    return false;
+  }
+
+  std::vector<std::pair<FrameId, StereoPoint2>> observations;
+  for (const std::pair<FrameId, StereoPoint2>& obs : ft.obs_) {
+    if (getPoseEstimate(obs.first)) observations.push_back(obs);
+  }
+  if (observations.size() < 2u) return false;
+
+  new_values_.insert(gtsam::Symbol(kLandmarkSymbolChar, lmk_id), W_lmk);
+  for (const std::pair<FrameId, StereoPoint2>& obs : observations) {
+    addObservation(lmk_id, obs);
+  }
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+void ProjectionVioBackend::addObservation(
+    const LandmarkId& lmk_id,
+    const std::pair<FrameId, StereoPoint2>& obs) {
+  const gtsam::Symbol pose_key(kPoseSymbolChar, obs.first);
+  const gtsam::Symbol lmk_key(kLandmarkSymbolChar, lmk_id);
+  const StereoPoint2& measurement = obs.second;
+  // Cheirality is not thrown: points behind the camera get a constant error.
+  if (std::isfinite(measurement.uR()) &&
+      measurement.uL() - measurement.uR() > 0.0) {
+    new_imu_prior_and_other_factors_.emplace_shared<StereoProjectionFactor>(
+        measurement,
+        stereo_noise_,
+        pose_key,
+        lmk_key,
+        stereo_cal_,
+        false,
+        false,
+        B_Pose_leftCamRect_);
+  } else {
+    // No valid right pixel: monocular projection factor.
+    new_imu_prior_and_other_factors_.emplace_shared<MonoProjectionFactor>(
+        gtsam::Point2(measurement.uL(), measurement.v()),
+        mono_noise_,
+        pose_key,
+        lmk_key,
+        mono_cal_,
+        false,
+        false,
+        B_Pose_leftCamRect_);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void ProjectionVioBackend::deleteOldFeatureTracks() {
+  const double horizon = smoother_->smootherLag();
+  LandmarkIds old_lmk_ids;
+  for (const auto& lmk_id_ft : feature_tracks_) {
+    const FeatureTrack& ft = lmk_id_ft.second;
+    if (!ft.obs_.empty() &&
+        static_cast<double>(ft.obs_.back().first) + horizon <
+            static_cast<double>(curr_kf_id_)) {
+      old_lmk_ids.push_back(lmk_id_ft.first);
+    }
+  }
+  for (const LandmarkId& lmk_id : old_lmk_ids) {
+    deleteLmkFromFeatureTracks(lmk_id);
+  }
+}
+
+}  // namespace VIO
@@ -20,6 +20,8 @@
 
 #include "kimera-vio/backend/RegularVioBackend.h"
 
+#include <algorithm>
+
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <gtsam/slam/PriorFactor.h>
@@ -62,6 +64,11 @@ DEFINE_bool(remove_old_reg_factors,
             true,
             "Remove regularity factors for those landmarks that were "
             "originally associated to the plane, but which are not anymore.");
+DEFINE_bool(batch_regularity_updates,
+            true,
+            "Find the old regularity factors of each plane through the "
+            "smoother's variable index. Otherwise, loop over the whole factor "
+            "graph for all planes (slow, kept as reference).");
 DEFINE_int32(min_num_of_plane_constraints_to_remove_factors,
              10,
              "Number of constraints for a plane to be considered "
@@ -324,10 +331,18 @@ bool RegularVioBackend::addVisualInertialStateAndOptimize(
           if (FLAGS_remove_old_reg_factors) {
             VLOG(10) << "Removing old regularity factors.";
             gtsam::FactorIndices delete_old_regularity_factors;
-            removeOldRegularityFactors_Slow(planes_,
-                                            idx_of_point_plane_factors_to_add,
-                                            &plane_id_to_lmk_id_reg_type_,
-                                            &delete_old_regularity_factors);
+            if (FLAGS_batch_regularity_updates) {
+              removeOldRegularityFactors(planes_,
+                                         idx_of_point_plane_factors_to_add,
+                                         &plane_id_to_lmk_id_reg_type_,
+                                         &delete_old_regularity_factors);
+            } else {
+              removeOldRegularityFactors_Slow(
+                  planes_,
+                  idx_of_point_plane_factors_to_add,
+                  &plane_id_to_lmk_id_reg_type_,
+                  &delete_old_regularity_factors);
+            }
             if (delete_old_regularity_factors.size() > 0) {
               delete_slots.insert(delete_slots.end(),
                                   delete_old_regularity_factors.begin(),
@@ -483,8 +498,8 @@ void RegularVioBackend::addLandmarkToGraph(const LandmarkId& lmk_id,
   // Add as a smart factor.
   // We use a unit pinhole projection camera for the smart factors to be
   // more efficient.
-  SmartStereoFactor::shared_ptr new_factor(new SmartStereoFactor(
-      smart_noise_, smart_factors_params_, B_Pose_leftCamRect_));
+  SmartStereoFactor::shared_ptr new_factor = allocatePooled<SmartStereoFactor>(
+      smart_noise_, smart_factors_params_, B_Pose_leftCamRect_);
 
   VLOG(20) << "Adding landmark with id: " << lmk_id
            << " for the first time to graph. \n"
@@ -596,7 +611,8 @@ void RegularVioBackend::updateExistingSmartFactor(
   CHECK(old_factor);
 
   // Clone old factor as a new factor.
-  SmartStereoFactor::shared_ptr new_factor(new SmartStereoFactor(*old_factor));
+  SmartStereoFactor::shared_ptr new_factor =
+      allocatePooled<SmartStereoFactor>(*old_factor);
 
   // Add observation to new factor.
   VLOG(20) << "Added observation for smart factor of lmk with id: " << lmk_id;
@@ -1230,13 +1246,7 @@ void RegularVioBackend::removeOldRegularityFactors_Slow(
   CHECK_NOTNULL(delete_slots);
 
   std::vector<size_t> plane_idx_to_clean;
-  std::map<size_t, std::vector<std::pair<Slot, LandmarkId>>>
-      plane_id_to_factor_slots_bad;
-  std::map<size_t, std::vector<std::pair<Slot, LandmarkId>>>
-      plane_id_to_factor_slots_good;
-  std::map<size_t, bool> has_plane_a_prior_map;
-  std::map<size_t, bool> has_plane_a_linear_factor_map;
-  std::map<size_t, Slot> plane_prior_slot_map;
+  std::map<size_t, PlaneFactorSlots> plane_idx_to_factor_slots;
   size_t i = 0;
   for (const Plane& plane : planes) {
     const gtsam::Symbol& plane_symbol = plane.getPlaneSymbol();
@@ -1268,11 +1278,7 @@ void RegularVioBackend::removeOldRegularityFactors_Slow(
 
     plane_idx_to_clean.push_back(i);
     // Init data structures empty, by using [] instead of .at().
-    plane_id_to_factor_slots_bad[i];
-    plane_id_to_factor_slots_good[i];
-    has_plane_a_prior_map[i] = false;
-    has_plane_a_linear_factor_map[i] = false;
-    plane_prior_slot_map[i] = 0;  // Set as invalid slot.
+    plane_idx_to_factor_slots[i];
 
     i++;
   }
@@ -1311,15 +1317,17 @@ void RegularVioBackend::removeOldRegularityFactors_Slow(
               // to avoid having underconstrained lmks...)
               VLOG(20) << "Found bad point plane factor on lmk with id: "
                        << lmk_id;
-              plane_id_to_factor_slots_bad.at(plane_id).push_back(
-                  std::make_pair(slot, lmk_id));
+              plane_idx_to_factor_slots.at(plane_id)
+                  .point_plane_factor_slots_bad.push_back(
+                      std::make_pair(slot, lmk_id));
 
               // Before deleting this slot, we must ensure that both the plane
               // and the landmark are well constrained!
             } else {
               // Store those factors that we will potentially keep.
-              plane_id_to_factor_slots_good.at(plane_id).push_back(
-                  std::make_pair(slot, lmk_id));
+              plane_idx_to_factor_slots.at(plane_id)
+                  .point_plane_factor_slots_good.push_back(
+                      std::make_pair(slot, lmk_id));
             }
           }
         }
@@ -1332,8 +1340,8 @@ void RegularVioBackend::removeOldRegularityFactors_Slow(
                          << gtsam::DefaultKeyFormatter(plane_symbol.key());
             // Store slot of plane_prior, since we might have to delete it
             // if the plane has no constraints.
-            plane_prior_slot_map.at(plane_idx) = slot;
-            has_plane_a_prior_map.at(plane_idx) = true;
+            plane_idx_to_factor_slots.at(plane_idx).prior_slot = slot;
+            plane_idx_to_factor_slots.at(plane_idx).has_prior = true;
           }
         }
       } else if (lcf) {
@@ -1343,7 +1351,7 @@ void RegularVioBackend::removeOldRegularityFactors_Slow(
           if (lcf->find(plane_symbol.key()) != lcf->end()) {
             VLOG(10) << "Found linear container factor for plane: "
                      << gtsam::DefaultKeyFormatter(plane_symbol.key());
-            has_plane_a_linear_factor_map.at(plane_idx) = true;
+            plane_idx_to_factor_slots.at(plane_idx).has_linear_factor = true;
           }
         }
       }
@@ -1356,168 +1364,262 @@ void RegularVioBackend::removeOldRegularityFactors_Slow(
   // Decide whether we can just delete the bad point plane factors,
   // or whether we need to delete all the factors involving the plane
   // so that it is removed.
-  // For this we need to check if the plane is fully constrained!
   for (const size_t& plane_idx : plane_idx_to_clean) {
-    const gtsam::Symbol& plane_symbol =
-        planes.at(plane_idx).getPlaneSymbol().key();
-    const std::vector<std::pair<Slot, LandmarkId>>&
-        point_plane_factor_slots_bad =
-            plane_id_to_factor_slots_bad.at(plane_idx);
-    const std::vector<std::pair<Slot, LandmarkId>>&
-        point_plane_factor_slots_good =
-            plane_id_to_factor_slots_good.at(plane_idx);
-    DCHECK(map_idx_of_point_plane_factors_to_add.find(plane_symbol.key()) !=
+    const gtsam::Key& plane_key = planes.at(plane_idx).getPlaneSymbol().key();
+    DCHECK(map_idx_of_point_plane_factors_to_add.find(plane_key) !=
            map_idx_of_point_plane_factors_to_add.end());
-    const std::vector<std::pair<Slot, LandmarkId>>&
-        idx_of_point_plane_factors_to_add =
-            map_idx_of_point_plane_factors_to_add.at(plane_symbol.key());
-    DCHECK(plane_id_to_lmk_id_to_reg_type_map->find(plane_symbol.key()) !=
+    DCHECK(plane_id_to_lmk_id_to_reg_type_map->find(plane_key) !=
            plane_id_to_lmk_id_to_reg_type_map->end());
-    LmkIdToRegularityTypeMap& lmk_id_to_regularity_type_map =
-        (*plane_id_to_lmk_id_to_reg_type_map).at(plane_symbol.key());
-    const bool& has_plane_a_prior = has_plane_a_prior_map.at(plane_idx);
-    const bool& has_plane_a_linear_factor =
-        has_plane_a_linear_factor_map.at(plane_idx);
-    const size_t& plane_prior_slot = plane_prior_slot_map.at(plane_idx);
-    /// If there are enough new constraints to be added then delete only
-    /// delete_slots else, if there are enough constraints left, only delete
-    /// delete_slots otherwise delete ALL constraints, both old and new, so that
-    /// the plane disappears (take into account priors!). Priors affecting
-    /// planes: linear container factor & prior on OrientedPlane3
-    const int32_t total_nr_of_plane_constraints =
-        point_plane_factor_slots_good.size() +
-        idx_of_point_plane_factors_to_add.size();
-    VLOG(10) << "Total number of constraints of plane "
-             << gtsam::DefaultKeyFormatter(plane_symbol.key())
-             << " is: " << total_nr_of_plane_constraints << "\n"
-             << "\tConstraints in graph which are good: "
-             << point_plane_factor_slots_good.size() << "\n"
-             << "\tConstraints that are going to be added: "
-             << idx_of_point_plane_factors_to_add.size() << "\n"
-             << "Constraints in graph which are bad: "
-             << point_plane_factor_slots_bad.size() << "\n"
-             << "Has the plane a prior? " << (has_plane_a_prior ? "Yes" : "No")
-             << ".\n"
-             << "Has the plane a linear factor? "
-             << (has_plane_a_linear_factor ? "Yes" : "No") << ".";
-    if (total_nr_of_plane_constraints >
-        FLAGS_min_num_of_plane_constraints_to_remove_factors) {
-      // The plane is fully constrained.
-      // We can just delete bad factors, assuming lmks will be well constrained.
-      // TODO ensure the lmks are themselves well constrained.
-      VLOG(10) << "Plane is fully constrained, removing only bad factors.";
-      fillDeleteSlots(point_plane_factor_slots_bad,
-                      &lmk_id_to_regularity_type_map,
-                      delete_slots);
-    } else {
-      // The plane is NOT fully constrained if we remove all bad factors,
-      // unless the plane has a prior.
-      // Check if the plane has a prior.
-      VLOG(10) << "Plane is NOT fully constrained if we just remove"
-                  " the bad factors.";
-      if (has_plane_a_prior || has_plane_a_linear_factor) {
-        // The plane has a prior.
-        VLOG(10) << "Plane has a prior.";
-        // TODO Remove: this is just a patch to avoid issue 32:
-        // https://github.mit.edu/lcarlone/VIO/issues/32
-        if (FLAGS_use_unstable_plane_removal) {
-          // This should be the correct way to do it, but a bug in gtsam will
-          // make the optimization break.
-          if (total_nr_of_plane_constraints == 0 && has_plane_a_prior &&
-              !has_plane_a_linear_factor) {
-            // Not only the plane is not fully constrained, it has no
-            // constraints at all, and we are going to delete the bad ones, so
-            // plane floating with a plane prior, not attached to anything
-            // else... Delete the prior as well, to get rid of this plane.
-            LOG(ERROR)
-                << "Plane has no constraints at all, deleting prior as well.";
-            CHECK_NE(plane_prior_slot, 0);
-            delete_slots->push_back(plane_prior_slot);
-          }
+    removeOldRegularityFactorsOfPlane(
+        plane_key,
+        plane_idx_to_factor_slots.at(plane_idx),
+        map_idx_of_point_plane_factors_to_add.at(plane_key),
+        &plane_id_to_lmk_id_to_reg_type_map->at(plane_key),
+        delete_slots);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void RegularVioBackend::removeOldRegularityFactors(
+    const std::vector<Plane>& planes,
+    const std::map<PlaneId, std::vector<std::pair<Slot, LandmarkId>>>&
+        map_idx_of_point_plane_factors_to_add,
+    PlaneIdToLmkIdRegType* plane_id_to_lmk_id_to_reg_type_map,
+    gtsam::FactorIndices* delete_slots) {
+  CHECK_NOTNULL(plane_id_to_lmk_id_to_reg_type_map);
+  CHECK_NOTNULL(delete_slots);
+  VLOG(10) << "Starting removeOldRegularityFactors...";
+
+  const gtsam::NonlinearFactorGraph& graph = smoother_->getFactors();
+  const gtsam::VariableIndex& variable_index =
+      smoother_->getISAM2().getVariableIndex();
+  for (const Plane& plane : planes) {
+    const gtsam::Key& plane_key = plane.getPlaneSymbol().key();
+    CHECK(!(state_.exists(plane_key) && new_values_.exists(plane_key)))
+        << "Inconsistency: plane is in current state,"
+           " but it is going to be added.";
+    if (!state_.exists(plane_key)) {
+      // The plane is going to be added in this iteration (hence already
+      // well constrained), or not at all: nothing to clean.
+      VLOG(10) << "Plane with id " << gtsam::DefaultKeyFormatter(plane_key)
+               << " is not in state.";
+      continue;
+    }
+    if (variable_index.find(plane_key) == variable_index.end()) {
+      VLOG(10) << "Plane with id " << gtsam::DefaultKeyFormatter(plane_key)
+               << " has no factors in the smoother.";
+      continue;
+    }
+
+    // Sorted copy of the lmks of the plane, for the membership queries.
+    LandmarkIds plane_lmk_ids = plane.lmk_ids_;
+    std::sort(plane_lmk_ids.begin(), plane_lmk_ids.end());
+
+    // Only visit the factors involving the plane.
+    PlaneFactorSlots plane_factor_slots;
+    for (const size_t& slot : variable_index[plane_key]) {
+      if (!graph.exists(slot)) continue;
+      const gtsam::NonlinearFactor* factor = graph.at(slot).get();
+      if (const auto ppf =
+              dynamic_cast<const gtsam::PointPlaneFactor*>(factor)) {
+        DCHECK_EQ(ppf->getPlaneKey(), plane_key);
+        const LandmarkId& lmk_id = gtsam::Symbol(ppf->getPointKey()).index();
+        if (std::binary_search(
+                plane_lmk_ids.begin(), plane_lmk_ids.end(), lmk_id)) {
+          plane_factor_slots.point_plane_factor_slots_good.push_back(
+              std::make_pair(slot, lmk_id));
         } else {
-          // This is just a patch...
-          // TODO maybe if we are deleting too much constraints, add a no
-          // information factor btw the plane and a lmk!
-          if (total_nr_of_plane_constraints >
-              FLAGS_min_num_of_plane_constraints_to_avoid_seg_fault) {
-            // Delete just the bad factors, since we still have some factors
-            // that won't make the optimizer try to delete the plane variable,
-            // which at the current time breaks gtsam.
-            VLOG(10) << "Delete bad factors attached to plane.";
-            fillDeleteSlots(point_plane_factor_slots_bad,
-                            &lmk_id_to_regularity_type_map,
-                            delete_slots);
-          } else {
-            // Do not delete all factors, otherwise gtsam will break.
-            VLOG(10)
-                << "Not deleting bad factors attached to plane, or gtsam will "
-                   "break.";
-          }
+          VLOG(20) << "Found bad point plane factor on lmk with id: "
+                   << lmk_id;
+          plane_factor_slots.point_plane_factor_slots_bad.push_back(
+              std::make_pair(slot, lmk_id));
+        }
+      } else if (dynamic_cast<
+                     const gtsam::PriorFactor<gtsam::OrientedPlane3>*>(
+                     factor)) {
+        LOG(WARNING) << "Found plane prior for plane: "
+                     << gtsam::DefaultKeyFormatter(plane_key);
+        plane_factor_slots.prior_slot = slot;
+        plane_factor_slots.has_prior = true;
+      } else if (dynamic_cast<const gtsam::LinearContainerFactor*>(factor)) {
+        VLOG(10) << "Found linear container factor for plane: "
+                 << gtsam::DefaultKeyFormatter(plane_key);
+        plane_factor_slots.has_linear_factor = true;
+      }
+    }
+
+    DCHECK(map_idx_of_point_plane_factors_to_add.find(plane_key) !=
+           map_idx_of_point_plane_factors_to_add.end());
+    DCHECK(plane_id_to_lmk_id_to_reg_type_map->find(plane_key) !=
+           plane_id_to_lmk_id_to_reg_type_map->end());
+    removeOldRegularityFactorsOfPlane(
+        plane_key,
+        plane_factor_slots,
+        map_idx_of_point_plane_factors_to_add.at(plane_key),
+        &plane_id_to_lmk_id_to_reg_type_map->at(plane_key),
+        delete_slots);
+  }
+  VLOG(10) << "Finished removeOldRegularityFactors.";
+}
+
+/* -------------------------------------------------------------------------- */
+void RegularVioBackend::removeOldRegularityFactorsOfPlane(
+    const gtsam::Key& plane_key,
+    const PlaneFactorSlots& plane_factor_slots,
+    const std::vector<std::pair<Slot, LandmarkId>>&
+        idx_of_point_plane_factors_to_add,
+    LmkIdToRegularityTypeMap* lmk_id_to_regularity_type_map,
+    gtsam::FactorIndices* delete_slots) {
+  CHECK_NOTNULL(lmk_id_to_regularity_type_map);
+  CHECK_NOTNULL(delete_slots);
+  const gtsam::Symbol plane_symbol(plane_key);
+  const std::vector<std::pair<Slot, LandmarkId>>&
+      point_plane_factor_slots_bad =
+          plane_factor_slots.point_plane_factor_slots_bad;
+  const std::vector<std::pair<Slot, LandmarkId>>&
+      point_plane_factor_slots_good =
+          plane_factor_slots.point_plane_factor_slots_good;
+  const bool& has_plane_a_prior = plane_factor_slots.has_prior;
+  const bool& has_plane_a_linear_factor = plane_factor_slots.has_linear_factor;
+  const size_t& plane_prior_slot = plane_factor_slots.prior_slot;
+  /// If there are enough new constraints to be added then delete only
+  /// delete_slots else, if there are enough constraints left, only delete
+  /// delete_slots otherwise delete ALL constraints, both old and new, so that
+  /// the plane disappears (take into account priors!). Priors affecting
+  /// planes: linear container factor & prior on OrientedPlane3
+  const int32_t total_nr_of_plane_constraints =
+      point_plane_factor_slots_good.size() +
+      idx_of_point_plane_factors_to_add.size();
+  VLOG(10) << "Total number of constraints of plane "
+           << gtsam::DefaultKeyFormatter(plane_symbol.key())
+           << " is: " << total_nr_of_plane_constraints << "\n"
+           << "\tConstraints in graph which are good: "
+           << point_plane_factor_slots_good.size() << "\n"
+           << "\tConstraints that are going to be added: "
+           << idx_of_point_plane_factors_to_add.size() << "\n"
+           << "Constraints in graph which are bad: "
+           << point_plane_factor_slots_bad.size() << "\n"
+           << "Has the plane a prior? " << (has_plane_a_prior ? "Yes" : "No")
+           << ".\n"
+           << "Has the plane a linear factor? "
+           << (has_plane_a_linear_factor ? "Yes" : "No") << ".";
+  if (total_nr_of_plane_constraints >
+      FLAGS_min_num_of_plane_constraints_to_remove_factors) {
+    // The plane is fully constrained.
+    // We can just delete bad factors, assuming lmks will be well constrained.
+    // TODO ensure the lmks are themselves well constrained.
+    VLOG(10) << "Plane is fully constrained, removing only bad factors.";
+    fillDeleteSlots(point_plane_factor_slots_bad,
+                    lmk_id_to_regularity_type_map,
+                    delete_slots);
+  } else {
+    // The plane is NOT fully constrained if we remove all bad factors,
+    // unless the plane has a prior.
+    // Check if the plane has a prior.
+    VLOG(10) << "Plane is NOT fully constrained if we just remove"
+                " the bad factors.";
+    if (has_plane_a_prior || has_plane_a_linear_factor) {
+      // The plane has a prior.
+      VLOG(10) << "Plane has a prior.";
+      // TODO Remove: this is just a patch to avoid issue 32:
+      // https://github.mit.edu/lcarlone/VIO/issues/32
+      if (FLAGS_use_unstable_plane_removal) {
+        // This should be the correct way to do it, but a bug in gtsam will
+        // make the optimization break.
+        if (total_nr_of_plane_constraints == 0 && has_plane_a_prior &&
+            !has_plane_a_linear_factor) {
+          // Not only the plane is not fully constrained, it has no
+          // constraints at all, and we are going to delete the bad ones, so
+          // plane floating with a plane prior, not attached to anything
+          // else... Delete the prior as well, to get rid of this plane.
+          LOG(ERROR)
+              << "Plane has no constraints at all, deleting prior as well.";
+          CHECK_NE(plane_prior_slot, 0);
+          delete_slots->push_back(plane_prior_slot);
         }
       } else {
-        // The plane has NOT a prior.
-        if (FLAGS_use_unstable_plane_removal) {
-          // Delete all factors involving the plane so that iSAM removes the
-          // plane from the optimization.
-          LOG(ERROR) << "Plane has no prior, trying to forcefully"
-                        " remove the PLANE!";
-          debug_smoother_ = true;
+        // This is just a patch...
+        // TODO maybe if we are deleting too much constraints, add a no
+        // information factor btw the plane and a lmk!
+        if (total_nr_of_plane_constraints >
+            FLAGS_min_num_of_plane_constraints_to_avoid_seg_fault) {
+          // Delete just the bad factors, since we still have some factors
+          // that won't make the optimizer try to delete the plane variable,
+          // which at the current time breaks gtsam.
+          VLOG(10) << "Delete bad factors attached to plane.";
           fillDeleteSlots(point_plane_factor_slots_bad,
-                          &lmk_id_to_regularity_type_map,
+                          lmk_id_to_regularity_type_map,
                           delete_slots);
-          fillDeleteSlots(point_plane_factor_slots_good,
-                          &lmk_id_to_regularity_type_map,
+        } else {
+          // Do not delete all factors, otherwise gtsam will break.
+          VLOG(10)
+              << "Not deleting bad factors attached to plane, or gtsam will "
+                 "break.";
+        }
+      }
+    } else {
+      // The plane has NOT a prior.
+      if (FLAGS_use_unstable_plane_removal) {
+        // Delete all factors involving the plane so that iSAM removes the
+        // plane from the optimization.
+        LOG(ERROR) << "Plane has no prior, trying to forcefully"
+                      " remove the PLANE!";
+        debug_smoother_ = true;
+        fillDeleteSlots(point_plane_factor_slots_bad,
+                        lmk_id_to_regularity_type_map,
+                        delete_slots);
+        fillDeleteSlots(point_plane_factor_slots_good,
+                        lmk_id_to_regularity_type_map,
+                        delete_slots);
+
+        // Remove as well the factors that are going to be added in this
+        // iteration.
+        deleteNewSlots(plane_symbol.key(),
+                       idx_of_point_plane_factors_to_add,
+                       lmk_id_to_regularity_type_map,
+                       &new_imu_prior_and_other_factors_);
+      } else {
+        // Do not use unstable implementation...
+        // Just add a prior on the plane and remove only bad factors...
+        // Add a prior to the plane.
+        VLOG(10)
+            << "Adding a prior to the plane, delete just the bad factors.";
+        gtsam::OrientedPlane3 plane_estimate;
+        CHECK(getEstimateOfKey(state_, plane_symbol.key(), &plane_estimate));
+        LOG(WARNING) << "Using plane prior on plane with id "
+                     << gtsam::DefaultKeyFormatter(plane_symbol);
+        CHECK(!has_plane_a_prior && !has_plane_a_linear_factor)
+            << "Check that the plane has no prior.";
+        static const gtsam::noiseModel::Diagonal::shared_ptr prior_noise =
+            gtsam::noiseModel::Diagonal::Sigmas(
+                Vector3(FLAGS_prior_noise_sigma_normal,
+                        FLAGS_prior_noise_sigma_normal,
+                        FLAGS_prior_noise_sigma_distance));
+        new_imu_prior_and_other_factors_
+            .emplace_shared<gtsam::PriorFactor<gtsam::OrientedPlane3>>(
+                plane_symbol.key(), plane_estimate, prior_noise);
+
+        // Delete just the bad factors.
+        // TODO Remove: this is just a patch to avoid issue 32:
+        // https://github.mit.edu/lcarlone/VIO/issues/32
+        if (total_nr_of_plane_constraints >
+            FLAGS_min_num_of_plane_constraints_to_avoid_seg_fault) {
+          // Delete just the bad factors, since we still have some factors
+          // that won't make the optimizer try to delete the plane variable,
+          // which at the current time breaks gtsam.
+          VLOG(10) << "Delete bad factors attached to plane.";
+          fillDeleteSlots(point_plane_factor_slots_bad,
+                          lmk_id_to_regularity_type_map,
                           delete_slots);
-
-          // Remove as well the factors that are going to be added in this
-          // iteration.
-          deleteNewSlots(plane_symbol.key(),
-                         idx_of_point_plane_factors_to_add,
-                         &lmk_id_to_regularity_type_map,
-                         &new_imu_prior_and_other_factors_);
         } else {
-          // Do not use unstable implementation...
-          // Just add a prior on the plane and remove only bad factors...
-          // Add a prior to the plane.
+          // Do not delete all factors, otherwise gtsam will break.
           VLOG(10)
-              << "Adding a prior to the plane, delete just the bad factors.";
-          gtsam::OrientedPlane3 plane_estimate;
-          CHECK(getEstimateOfKey(state_, plane_symbol.key(), &plane_estimate));
-          LOG(WARNING) << "Using plane prior on plane with id "
-                       << gtsam::DefaultKeyFormatter(plane_symbol);
-          CHECK(!has_plane_a_prior && !has_plane_a_linear_factor)
-              << "Check that the plane has no prior.";
-          static const gtsam::noiseModel::Diagonal::shared_ptr prior_noise =
-              gtsam::noiseModel::Diagonal::Sigmas(
-                  Vector3(FLAGS_prior_noise_sigma_normal,
-                          FLAGS_prior_noise_sigma_normal,
-                          FLAGS_prior_noise_sigma_distance));
-          new_imu_prior_and_other_factors_
-              .emplace_shared<gtsam::PriorFactor<gtsam::OrientedPlane3>>(
-                  plane_symbol.key(), plane_estimate, prior_noise);
-
-          // Delete just the bad factors.
-          // TODO Remove: this is just a patch to avoid issue 32:
-          // https://github.mit.edu/lcarlone/VIO/issues/32
-          if (total_nr_of_plane_constraints >
-              FLAGS_min_num_of_plane_constraints_to_avoid_seg_fault) {
-            // Delete just the bad factors, since we still have some factors
-            // that won't make the optimizer try to delete the plane variable,
-            // which at the current time breaks gtsam.
-            VLOG(10) << "Delete bad factors attached to plane.";
-            fillDeleteSlots(point_plane_factor_slots_bad,
-                            &lmk_id_to_regularity_type_map,
-                            delete_slots);
-          } else {
-            // Do not delete all factors, otherwise gtsam will break.
-            VLOG(10)
-                << "Not deleting bad factors attached to plane, or gtsam will "
-                   "break.";
-          }
+              << "Not deleting bad factors attached to plane, or gtsam will "
+                 "break.";
         }
-      }  // The plane has NOT a prior.
-    }    // The plane is NOT fully constraint.
-  }
+      }
+    }  // The plane has NOT a prior.
+  }    // The plane is NOT fully constraint.
 }
 
 /* -------------------------------------------------------------------------- */
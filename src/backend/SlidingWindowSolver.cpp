@@ -0,0 +1,495 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   SlidingWindowSolver.cpp
+ * @brief  Gauss-Newton solver over a fixed-size window of keyframe states,
+ * with a dense Hessian, Schur elimination of the landmarks and an explicit
+ * marginalization prior.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/backend/SlidingWindowSolver.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glog/logging.h>
+
+#include <Eigen/Eigenvalues>
+
+#include <gtsam/geometry/StereoCamera.h>
+#include <gtsam/inference/Symbol.h>
+
+namespace VIO {
+
+namespace {
+//! Damping of the normal equations, for the unobservable directions.
+constexpr double kDamping = 1e-8;
+//! Min eigenvalue of the information of a landmark to be Schur-eliminated.
+constexpr double kMinLandmarkInformation = 1e-6;
+//! Relative threshold on the eigenvalues of the marginalized block.
+constexpr double kPseudoInverseThreshold = 1e-9;
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+SlidingWindowSolver::SlidingWindowSolver(
+    const SlidingWindowSolverParams& params,
+    const StereoCalibPtr& stereo_calibration)
+    : params_(params),
+      stereo_cal_(stereo_calibration),
+      dim_(params.window_size * kStateDim),
+      keyframes_(params.window_size),
+      values_(),
+      factors_(),
+      landmarks_(),
+      H_prior_(gtsam::Matrix::Zero(dim_, dim_)),
+      g_prior_(gtsam::Vector::Zero(dim_)),
+      H_(gtsam::Matrix::Zero(dim_, dim_)),
+      g_(gtsam::Vector::Zero(dim_)),
+      delta_(gtsam::Vector::Zero(dim_)),
+      prior_error_(gtsam::Vector::Zero(dim_)),
+      marginal_cols_(gtsam::Matrix::Zero(dim_, kStateDim)),
+      marginal_rows_(gtsam::Matrix::Zero(kStateDim, dim_)),
+      ldlt_(dim_) {
+  CHECK_GE(params_.window_size, 2u);
+  CHECK(stereo_cal_);
+  CHECK_GT(params_.stereo_noise_sigma, 0.0);
+  CHECK_GT(params_.huber_threshold, 0.0);
+  // Roughly an IMU factor and a bias factor per keyframe, and some priors.
+  factors_.reserve(3u * params_.window_size);
+}
+
+/* -------------------------------------------------------------------------- */
+void SlidingWindowSolver::addKeyframe(const FrameId& frame_id,
+                                      const gtsam::Pose3& W_Pose_B,
+                                      const gtsam::Vector3& W_Vel_B,
+                                      const ImuBias& imu_bias,
+                                      LandmarkIds* marginalized_lmk_ids) {
+  CHECK_NOTNULL(marginalized_lmk_ids)->clear();
+  CHECK(nr_keyframes_ == 0u || frame_id == newest_frame_id_ + 1u)
+      << "Keyframe ids must be consecutive: got " << frame_id
+      << " after " << newest_frame_id_;
+
+  Keyframe& keyframe = keyframes_[slot(frame_id)];
+  if (keyframe.active) {
+    CHECK_EQ(keyframe.frame_id, getOldestFrameId());
+    marginalizeOldestKeyframe(marginalized_lmk_ids);
+  }
+  CHECK(!keyframe.active);
+
+  keyframe.frame_id = frame_id;
+  keyframe.active = true;
+  keyframe.W_Pose_B = W_Pose_B;
+  keyframe.W_Vel_B = W_Vel_B;
+  keyframe.imu_bias = imu_bias;
+  keyframe.lin_W_Pose_B = W_Pose_B;
+  keyframe.lin_W_Vel_B = W_Vel_B;
+  keyframe.lin_imu_bias = imu_bias;
+  ++nr_keyframes_;
+  newest_frame_id_ = frame_id;
+  updateValues(keyframe);
+}
+
+/* -------------------------------------------------------------------------- */
+void SlidingWindowSolver::addFactor(
+    const gtsam::NonlinearFactor::shared_ptr& factor) {
+  CHECK(factor);
+  StateFactor state_factor;
+  state_factor.factor = factor;
+  state_factor.noise_factor =
+      dynamic_cast<const gtsam::NoiseModelFactor*>(factor.get());
+  CHECK(state_factor.noise_factor)
+      << "Only noise model factors are supported.";
+  state_factor.oldest_frame_id = newest_frame_id_;
+  for (const gtsam::Key& key : factor->keys()) {
+    const gtsam::Symbol symbol(key);
+    KeyBlock block;
+    block.frame_id = symbol.index();
+    switch (symbol.chr()) {
+      case kPoseSymbolChar: {
+        block.offset = 0u;
+        block.dim = 6u;
+        break;
+      }
+      case kVelocitySymbolChar: {
+        block.offset = 6u;
+        block.dim = 3u;
+        break;
+      }
+      case kImuBiasSymbolChar: {
+        block.offset = 9u;
+        block.dim = 6u;
+        break;
+      }
+      default: {
+        LOG(FATAL) << "Unsupported key in sliding window factor: "
+                   << symbol.chr();
+      }
+    }
+    CHECK(isInWindow(block.frame_id))
+        << "Factor on keyframe " << block.frame_id << " out of the window.";
+    state_factor.oldest_frame_id =
+        std::min(state_factor.oldest_frame_id, block.frame_id);
+    state_factor.blocks.push_back(block);
+  }
+  state_factor.jacobians.resize(state_factor.blocks.size());
+  factors_.push_back(state_factor);
+}
+
+/* -------------------------------------------------------------------------- */
+bool SlidingWindowSolver::addLandmark(const LandmarkId& lmk_id,
+                                      const FeatureTrack& feature_track,
+                                      const double& max_distance) {
+  CHECK(!hasLandmark(lmk_id));
+  CHECK(!feature_track.obs_.empty());
+  const std::pair<FrameId, StereoPoint2>& obs_kf = feature_track.obs_.back();
+  const StereoPoint2& measurement = obs_kf.second;
+  const double disparity = measurement.uL() - measurement.uR();
+  if (!std::isfinite(disparity) || disparity <= 0.0) return false;
+  if (!isInWindow(obs_kf.first)) return false;
+
+  const Keyframe& keyframe = keyframes_[slot(obs_kf.first)];
+  const gtsam::StereoCamera camera(
+      keyframe.W_Pose_B.compose(params_.B_Pose_leftCamRect), stereo_cal_);
+  const gtsam::Point3 W_point = camera.backproject(measurement);
+  if (camera.pose().transformTo(W_point).z() > max_distance) return false;
+
+  size_t nr_observations = 0u;
+  for (const std::pair<FrameId, StereoPoint2>& obs : feature_track.obs_) {
+    if (isInWindow(obs.first)) ++nr_observations;
+  }
+  if (nr_observations < 2u) return false;
+
+  WindowLandmark& landmark = landmarks_[lmk_id];
+  landmark.W_point = W_point;
+  landmark.valid = false;
+  landmark.observations.clear();
+  landmark.observations.reserve(params_.window_size);
+  for (const std::pair<FrameId, StereoPoint2>& obs : feature_track.obs_) {
+    if (isInWindow(obs.first)) addObservation(lmk_id, obs);
+  }
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+void SlidingWindowSolver::addObservation(
+    const LandmarkId& lmk_id,
+    const std::pair<FrameId, StereoPoint2>& observation) {
+  CHECK(isInWindow(observation.first))
+      << "Observation of keyframe " << observation.first
+      << " out of the window.";
+  WindowLandmark& landmark = landmarks_.at(lmk_id);
+  CHECK(landmark.observations.empty() ||
+        landmark.observations.back().frame_id < observation.first)
+      << "Observations must be added in keyframe order.";
+  Observation obs;
+  obs.frame_id = observation.first;
+  obs.measurement = observation.second;
+  landmark.observations.push_back(obs);
+}
+
+/* -------------------------------------------------------------------------- */
+bool SlidingWindowSolver::optimize(const size_t& nr_iterations) {
+  for (size_t iter = 0u; iter < nr_iterations; ++iter) {
+    H_.setZero();
+    g_.setZero();
+    addPriorToSystem();
+    for (StateFactor& factor : factors_) {
+      linearize(&factor);
+      addToSystem(factor);
+    }
+    for (auto& lmk_id_landmark : landmarks_) {
+      WindowLandmark& landmark = lmk_id_landmark.second;
+      linearize(&landmark);
+      if (landmark.valid) addToSystem(landmark);
+    }
+
+    // Empty slots are decoupled from the rest, with a zero update.
+    for (size_t s = 0u; s < keyframes_.size(); ++s) {
+      if (keyframes_[s].active) continue;
+      H_.block<kStateDim, kStateDim>(s * kStateDim, s * kStateDim)
+          .setIdentity();
+    }
+    H_.diagonal().array() += kDamping;
+
+    ldlt_.compute(H_);
+    if (ldlt_.info() != Eigen::Success) {
+      LOG(ERROR) << "Sliding window: failed to factorize the Hessian.";
+      return false;
+    }
+    delta_ = ldlt_.solve(-g_);
+    if (!delta_.allFinite()) {
+      LOG(ERROR) << "Sliding window: non-finite state update.";
+      return false;
+    }
+
+    for (Keyframe& keyframe : keyframes_) {
+      if (!keyframe.active) continue;
+      const size_t o = offset(keyframe.frame_id);
+      keyframe.W_Pose_B = keyframe.W_Pose_B.retract(delta_.segment<6>(o));
+      keyframe.W_Vel_B += delta_.segment<3>(o + 6u);
+      keyframe.imu_bias =
+          ImuBias(keyframe.imu_bias.vector() + delta_.segment<6>(o + 9u));
+      updateValues(keyframe);
+    }
+
+    // Back-substitution of the landmarks.
+    for (auto& lmk_id_landmark : landmarks_) {
+      WindowLandmark& landmark = lmk_id_landmark.second;
+      if (!landmark.valid) continue;
+      Eigen::Vector3d rhs = landmark.g_point;
+      for (const Observation& obs : landmark.observations) {
+        if (!obs.valid) continue;
+        rhs += obs.H_pose_point.transpose() *
+               delta_.segment<6>(offset(obs.frame_id));
+      }
+      landmark.W_point -= landmark.H_point_inv * rhs;
+    }
+
+    if (delta_.norm() < params_.convergence_threshold) break;
+  }
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+void SlidingWindowSolver::getEstimate(gtsam::Values* estimate) const {
+  CHECK_NOTNULL(estimate)->clear();
+  estimate->insert(values_);
+  for (const auto& lmk_id_landmark : landmarks_) {
+    if (!lmk_id_landmark.second.valid) continue;
+    estimate->insert(gtsam::Symbol(kLandmarkSymbolChar, lmk_id_landmark.first),
+                     lmk_id_landmark.second.W_point);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void SlidingWindowSolver::linearize(StateFactor* factor) const {
+  CHECK_NOTNULL(factor);
+#if GTSAM_VERSION_MAJOR <= 4 && GTSAM_VERSION_MINOR < 3
+  factor->error =
+      factor->noise_factor->unwhitenedError(values_, factor->jacobians);
+#else
+  factor->error =
+      factor->noise_factor->unwhitenedError(values_, &factor->jacobians);
+#endif
+  const gtsam::SharedNoiseModel& noise = factor->noise_factor->noiseModel();
+  if (noise) noise->WhitenSystem(factor->jacobians, factor->error);
+}
+
+/* -------------------------------------------------------------------------- */
+void SlidingWindowSolver::addToSystem(const StateFactor& factor) {
+  for (size_t i = 0u; i < factor.blocks.size(); ++i) {
+    const KeyBlock& block_i = factor.blocks[i];
+    const gtsam::Matrix& J_i = factor.jacobians[i];
+    const size_t o_i = offset(block_i.frame_id) + block_i.offset;
+    g_.segment(o_i, block_i.dim).noalias() += J_i.transpose() * factor.error;
+    for (size_t j = i; j < factor.blocks.size(); ++j) {
+      const KeyBlock& block_j = factor.blocks[j];
+      const size_t o_j = offset(block_j.frame_id) + block_j.offset;
+      H_.block(o_i, o_j, block_i.dim, block_j.dim).noalias() +=
+          J_i.transpose() * factor.jacobians[j];
+      if (o_i != o_j) {
+        H_.block(o_j, o_i, block_j.dim, block_i.dim) =
+            H_.block(o_i, o_j, block_i.dim, block_j.dim).transpose();
+      }
+    }
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void SlidingWindowSolver::linearize(WindowLandmark* landmark) const {
+  CHECK_NOTNULL(landmark);
+  Eigen::Matrix3d H_point = Eigen::Matrix3d::Zero();
+  landmark->g_point.setZero();
+  size_t nr_valid_observations = 0u;
+  for (Observation& obs : landmark->observations) {
+    obs.valid = false;
+    const Keyframe& keyframe = keyframes_[slot(obs.frame_id)];
+    Eigen::Matrix<double, 6, 6> H_compose;
+    const gtsam::Pose3 W_Pose_C =
+        keyframe.W_Pose_B.compose(params_.B_Pose_leftCamRect, H_compose);
+    if (W_Pose_C.transformTo(landmark->W_point).z() <= 0.0) continue;
+
+    const gtsam::StereoCamera camera(W_Pose_C, stereo_cal_);
+    Eigen::Matrix<double, 3, 6> J_camera;
+    const StereoPoint2 projection =
+        camera.project2(landmark->W_point, J_camera, obs.J_point);
+    obs.J_pose = J_camera * H_compose;
+    obs.error = (projection - obs.measurement).vector();
+    if (!std::isfinite(obs.measurement.uR())) {
+      // No valid right pixel: monocular observation.
+      obs.error(1) = 0.0;
+      obs.J_pose.row(1).setZero();
+      obs.J_point.row(1).setZero();
+    }
+
+    const double inv_sigma = 1.0 / params_.stereo_noise_sigma;
+    const double error_norm = obs.error.norm() * inv_sigma;
+    const double weight = error_norm > params_.huber_threshold
+                              ? std::sqrt(params_.huber_threshold / error_norm)
+                              : 1.0;
+    obs.error *= weight * inv_sigma;
+    obs.J_pose *= weight * inv_sigma;
+    obs.J_point *= weight * inv_sigma;
+
+    obs.H_pose_point.noalias() = obs.J_pose.transpose() * obs.J_point;
+    H_point.noalias() += obs.J_point.transpose() * obs.J_point;
+    landmark->g_point.noalias() += obs.J_point.transpose() * obs.error;
+    obs.valid = true;
+    ++nr_valid_observations;
+  }
+
+  landmark->valid = false;
+  if (nr_valid_observations < 2u) return;
+  const Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eigen(H_point);
+  if (eigen.eigenvalues()(0) < kMinLandmarkInformation) return;
+  landmark->H_point_inv = eigen.eigenvectors() *
+                          eigen.eigenvalues().cwiseInverse().asDiagonal() *
+                          eigen.eigenvectors().transpose();
+  landmark->valid = true;
+}
+
+/* -------------------------------------------------------------------------- */
+void SlidingWindowSolver::addToSystem(const WindowLandmark& landmark) {
+  CHECK(landmark.valid);
+  // Schur complement of the landmark onto the poses observing it.
+  for (const Observation& obs_i : landmark.observations) {
+    if (!obs_i.valid) continue;
+    const size_t o_i = offset(obs_i.frame_id);
+    const Eigen::Matrix<double, 6, 3> K_i =
+        obs_i.H_pose_point * landmark.H_point_inv;
+    H_.block<6, 6>(o_i, o_i).noalias() += obs_i.J_pose.transpose() *
+                                          obs_i.J_pose;
+    g_.segment<6>(o_i).noalias() += obs_i.J_pose.transpose() * obs_i.error;
+    g_.segment<6>(o_i).noalias() -= K_i * landmark.g_point;
+    for (const Observation& obs_j : landmark.observations) {
+      if (!obs_j.valid) continue;
+      const size_t o_j = offset(obs_j.frame_id);
+      H_.block<6, 6>(o_i, o_j).noalias() -=
+          K_i * obs_j.H_pose_point.transpose();
+    }
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void SlidingWindowSolver::addPriorToSystem() {
+  if (!has_prior_) return;
+  prior_error_.setZero();
+  for (const Keyframe& keyframe : keyframes_) {
+    if (!keyframe.active) continue;
+    const size_t o = offset(keyframe.frame_id);
+    prior_error_.segment<6>(o) =
+        keyframe.lin_W_Pose_B.localCoordinates(keyframe.W_Pose_B);
+    prior_error_.segment<3>(o + 6u) = keyframe.W_Vel_B - keyframe.lin_W_Vel_B;
+    prior_error_.segment<6>(o + 9u) =
+        (keyframe.imu_bias - keyframe.lin_imu_bias).vector();
+  }
+  H_ += H_prior_;
+  g_ += g_prior_;
+  g_.noalias() += H_prior_ * prior_error_;
+}
+
+/* -------------------------------------------------------------------------- */
+void SlidingWindowSolver::marginalizeOldestKeyframe(
+    LandmarkIds* marginalized_lmk_ids) {
+  CHECK_NOTNULL(marginalized_lmk_ids);
+  CHECK_GT(nr_keyframes_, 0u);
+  const FrameId oldest_frame_id = getOldestFrameId();
+  Keyframe& oldest = keyframes_[slot(oldest_frame_id)];
+  CHECK(oldest.active);
+  CHECK_EQ(oldest.frame_id, oldest_frame_id);
+
+  // Linear system of all the terms involving the oldest keyframe.
+  H_.setZero();
+  g_.setZero();
+  addPriorToSystem();
+  for (StateFactor& factor : factors_) {
+    if (factor.oldest_frame_id != oldest_frame_id) continue;
+    linearize(&factor);
+    addToSystem(factor);
+  }
+  factors_.erase(std::remove_if(factors_.begin(),
+                                factors_.end(),
+                                [&oldest_frame_id](const StateFactor& factor) {
+                                  return factor.oldest_frame_id ==
+                                         oldest_frame_id;
+                                }),
+                 factors_.end());
+  for (auto it = landmarks_.begin(); it != landmarks_.end();) {
+    WindowLandmark& landmark = it->second;
+    if (landmark.observations.empty() ||
+        landmark.observations.front().frame_id != oldest_frame_id) {
+      ++it;
+      continue;
+    }
+    linearize(&landmark);
+    if (landmark.valid) addToSystem(landmark);
+    marginalized_lmk_ids->push_back(it->first);
+    it = landmarks_.erase(it);
+  }
+
+  // Schur complement of the oldest keyframe state.
+  const size_t o_m = offset(oldest_frame_id);
+  const Eigen::SelfAdjointEigenSolver<Eigen::Matrix<double, 15, 15>> eigen(
+      H_.block<kStateDim, kStateDim>(o_m, o_m));
+  const Eigen::Matrix<double, 15, 1>& eigenvalues = eigen.eigenvalues();
+  const double threshold =
+      kPseudoInverseThreshold * std::max(eigenvalues.maxCoeff(), 1.0);
+  const Eigen::Matrix<double, 15, 1> inv_eigenvalues =
+      (eigenvalues.array() > threshold)
+          .select(eigenvalues.array().inverse(), 0.0)
+          .matrix();
+  const Eigen::Matrix<double, 15, 15> H_mm_inv =
+      eigen.eigenvectors() * inv_eigenvalues.asDiagonal() *
+      eigen.eigenvectors().transpose();
+  const Eigen::Matrix<double, 15, 1> g_m = g_.segment<kStateDim>(o_m);
+
+  marginal_cols_ = H_.middleCols<kStateDim>(o_m);
+  marginal_rows_.noalias() = H_mm_inv * marginal_cols_.transpose();
+  H_prior_ = H_;
+  H_prior_.noalias() -= marginal_cols_ * marginal_rows_;
+  g_prior_ = g_;
+  g_prior_.noalias() -= marginal_cols_ * (H_mm_inv * g_m);
+  H_prior_.middleRows<kStateDim>(o_m).setZero();
+  H_prior_.middleCols<kStateDim>(o_m).setZero();
+  g_prior_.segment<kStateDim>(o_m).setZero();
+  has_prior_ = true;
+
+  // The new prior is linearized at the current estimate.
+  for (Keyframe& keyframe : keyframes_) {
+    if (!keyframe.active) continue;
+    keyframe.lin_W_Pose_B = keyframe.W_Pose_B;
+    keyframe.lin_W_Vel_B = keyframe.W_Vel_B;
+    keyframe.lin_imu_bias = keyframe.imu_bias;
+  }
+
+  oldest.active = false;
+  --nr_keyframes_;
+  values_.erase(gtsam::Symbol(kPoseSymbolChar, oldest_frame_id));
+  values_.erase(gtsam::Symbol(kVelocitySymbolChar, oldest_frame_id));
+  values_.erase(gtsam::Symbol(kImuBiasSymbolChar, oldest_frame_id));
+}
+
+/* -------------------------------------------------------------------------- */
+void SlidingWindowSolver::updateValues(const Keyframe& keyframe) {
+  const gtsam::Symbol pose_key(kPoseSymbolChar, keyframe.frame_id);
+  const gtsam::Symbol vel_key(kVelocitySymbolChar, keyframe.frame_id);
+  const gtsam::Symbol bias_key(kImuBiasSymbolChar, keyframe.frame_id);
+  if (values_.exists(pose_key)) {
+    values_.update(pose_key, keyframe.W_Pose_B);
+    values_.update(vel_key, keyframe.W_Vel_B);
+    values_.update(bias_key, keyframe.imu_bias);
+  } else {
+    values_.insert(pose_key, keyframe.W_Pose_B);
+    values_.insert(vel_key, keyframe.W_Vel_B);
+    values_.insert(bias_key, keyframe.imu_bias);
+  }
+}
+
+}  // namespace VIO
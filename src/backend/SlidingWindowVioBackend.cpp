@@ -0,0 +1,186 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   SlidingWindowVioBackend.cpp
+ * @brief  VIO Backend optimizing a fixed-size window of keyframes with a
+ * dedicated solver, instead of the smoother.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/backend/SlidingWindowVioBackend.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <gtsam/inference/Symbol.h>
+
+#include "kimera-vio/utils/Timer.h"
+#include "kimera-vio/utils/Tracing.h"
+
+namespace VIO {
+
+namespace {
+SlidingWindowSolverParams createSolverParams(
+    const Pose3& B_Pose_leftCamRect,
+    const BackendParams& backend_params) {
+  SlidingWindowSolverParams params;
+  params.window_size = static_cast<size_t>(backend_params.slidingWindowSize_);
+  params.B_Pose_leftCamRect = B_Pose_leftCamRect;
+  // Same measurement model as the ProjectionVioBackend.
+  params.stereo_noise_sigma = backend_params.smartNoiseSigma_;
+  params.huber_threshold =
+      backend_params.outlierRejection_ / backend_params.smartNoiseSigma_;
+  return params;
+}
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+SlidingWindowVioBackend::SlidingWindowVioBackend(
+    const Pose3& B_Pose_leftCamRect,
+    const StereoCalibPtr& stereo_calibration,
+    const BackendParams& backend_params,
+    const ImuParams& imu_params,
+    const BackendOutputParams& backend_output_params,
+    const bool& log_output,
+    std::optional<OdometryParams> odom_params)
+    : VioBackend(B_Pose_leftCamRect,
+                 stereo_calibration,
+                 backend_params,
+                 imu_params,
+                 backend_output_params,
+                 log_output,
+                 odom_params),
+      solver_(createSolverParams(B_Pose_leftCamRect, backend_params),
+              stereo_calibration),
+      landmarks_kf_(),
+      marginalized_lmk_ids_() {
+  LOG(INFO) << "Using Sliding Window VIO Backend.\n";
+  LOG_IF(WARNING, backend_params_.adaptiveHorizon_)
+      << "The sliding window Backend has a fixed horizon: "
+      << "ignoring adaptiveHorizon.";
+}
+
+/* -------------------------------------------------------------------------- */
+void SlidingWindowVioBackend::addLandmarksToGraph(
+    const LandmarkIds& landmarks_kf) {
+  debug_info_.numAddedSmartF_ += landmarks_kf.size();
+  landmarks_kf_ = backend_params_.maxLandmarksPerKeyframe_ > 0
+                      ? selectLandmarks(landmarks_kf)
+                      : landmarks_kf;
+}
+
+/* -------------------------------------------------------------------------- */
+bool SlidingWindowVioBackend::optimize(
+    const Timestamp& /*timestamp_kf_nsec*/,
+    const FrameId& cur_id,
+    const size_t& max_iterations,
+    const gtsam::FactorIndices& extra_factor_slots_to_delete) {
+  KIMERA_TRACE_SCOPE("SlidingWindowVioBackend::optimize");
+  CHECK(extra_factor_slots_to_delete.empty())
+      << "The sliding window Backend has no factor slots.";
+  CHECK(!defer_optimization_);
+  const auto& start_time = utils::Timer::tic();
+
+  solver_.addKeyframe(
+      cur_id,
+      new_values_.at<gtsam::Pose3>(gtsam::Symbol(kPoseSymbolChar, cur_id)),
+      new_values_.at<gtsam::Vector3>(
+          gtsam::Symbol(kVelocitySymbolChar, cur_id)),
+      new_values_.at<ImuBias>(gtsam::Symbol(kImuBiasSymbolChar, cur_id)),
+      &marginalized_lmk_ids_);
+  for (const LandmarkId& lmk_id : marginalized_lmk_ids_) {
+    const auto ft_it = feature_tracks_.find(lmk_id);
+    if (ft_it == feature_tracks_.end()) continue;
+    // The past observations are in the marginalization prior: only the one
+    // of the current keyframe can be used to triangulate it again.
+    FeatureTrack& ft = ft_it->second;
+    ft.obs_.erase(std::remove_if(ft.obs_.begin(),
+                                 ft.obs_.end(),
+                                 [&cur_id](const auto& obs) {
+                                   return obs.first != cur_id;
+                                 }),
+                  ft.obs_.end());
+    ft.in_ba_graph_ = false;
+  }
+
+  for (const auto& factor : new_imu_prior_and_other_factors_) {
+    if (factor) solver_.addFactor(factor);
+  }
+  addLandmarksToSolver(cur_id);
+
+  const bool is_solver_ok =
+      solver_.optimize(std::max<size_t>(max_iterations, 1u));
+
+  new_values_.clear();
+  new_imu_prior_and_other_factors_.resize(0);
+  new_smart_factors_.clear();
+  refreshed_keys_.clear();
+  landmarks_kf_.clear();
+
+  if (!is_solver_ok) {
+    LOG(ERROR) << "Sliding window solver failed! Not updating Backend state.";
+    return false;
+  }
+  solver_.getEstimate(&state_);
+  updateStates(cur_id);
+  deleteOldFeatureTracks();
+
+  VLOG(10) << "Sliding window with " << solver_.getNrKeyframes()
+           << " keyframes and " << solver_.getNrLandmarks()
+           << " landmarks optimized in "
+           << utils::Timer::toc<std::chrono::milliseconds>(start_time).count()
+           << " ms.";
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+void SlidingWindowVioBackend::addLandmarksToSolver(const FrameId& cur_id) {
+  int n_new_landmarks = 0;
+  int n_updated_landmarks = 0;
+  for (const LandmarkId& lmk_id : landmarks_kf_) {
+    FeatureTrack& ft = feature_tracks_.at(lmk_id);
+    if (!solver_.hasLandmark(lmk_id)) {
+      ft.in_ba_graph_ = false;
+      if (ft.obs_.size() < 2u) continue;
+      if (solver_.addLandmark(
+              lmk_id, ft, backend_params_.landmarkDistanceThreshold_)) {
+        ft.in_ba_graph_ = true;
+        ++n_new_landmarks;
+      }
+    } else {
+      const std::pair<FrameId, StereoPoint2>& obs_kf = ft.obs_.back();
+      CHECK_EQ(obs_kf.first, cur_id)
+          << "addLandmarksToSolver: last obs is not from the current keyframe!";
+      solver_.addObservation(lmk_id, obs_kf);
+      ++n_updated_landmarks;
+    }
+  }
+  VLOG(10) << "Added " << n_new_landmarks << " new landmarks\n"
+           << "Updated " << n_updated_landmarks << " landmarks in window";
+}
+
+/* -------------------------------------------------------------------------- */
+void SlidingWindowVioBackend::deleteOldFeatureTracks() {
+  const FrameId oldest_frame_id = solver_.getOldestFrameId();
+  LandmarkIds old_lmk_ids;
+  for (const auto& lmk_id_ft : feature_tracks_) {
+    const FeatureTrack& ft = lmk_id_ft.second;
+    if (!ft.obs_.empty() && ft.obs_.back().first < oldest_frame_id) {
+      old_lmk_ids.push_back(lmk_id_ft.first);
+    }
+  }
+  for (const LandmarkId& lmk_id : old_lmk_ids) {
+    deleteLmkFromFeatureTracks(lmk_id);
+  }
+}
+
+}  // namespace VIO
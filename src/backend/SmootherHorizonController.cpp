@@ -0,0 +1,99 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   SmootherHorizonController.cpp
+ * @brief  Adapts the smoother horizon and its number of iterations per
+ * keyframe to the measured optimization time, to meet a target latency.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/backend/SmootherHorizonController.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+#include "kimera-vio/utils/Statistics.h"
+
+namespace VIO {
+
+SmootherHorizonController::SmootherHorizonController(
+    const SmootherHorizonControllerParams& params,
+    const double& nr_states,
+    const size_t& max_num_optimize)
+    : params_(params),
+      max_num_optimize_(std::max<size_t>(max_num_optimize, 1u)),
+      nr_states_(std::clamp(
+          nr_states, params.min_nr_states, params.max_nr_states)),
+      num_optimize_(max_num_optimize_),
+      filtered_time_ms_(0.0),
+      nr_measurements_(0u),
+      keyframes_since_decision_(0u) {
+  CHECK_GT(params_.target_latency_ms, 0.0);
+  CHECK_GT(params_.slack_ratio, 0.0);
+  CHECK_LT(params_.slack_ratio, 1.0);
+  CHECK_GT(params_.time_filter_weight, 0.0);
+  CHECK_LE(params_.time_filter_weight, 1.0);
+  CHECK_GT(params_.min_nr_states, 0.0);
+  CHECK_LE(params_.min_nr_states, params_.max_nr_states);
+  CHECK_GT(params_.nr_states_step, 0.0);
+}
+
+bool SmootherHorizonController::update(const double& optimize_time_ms) {
+  filtered_time_ms_ =
+      nr_measurements_ == 0u
+          ? optimize_time_ms
+          : params_.time_filter_weight * optimize_time_ms +
+                (1.0 - params_.time_filter_weight) * filtered_time_ms_;
+  ++nr_measurements_;
+  ++keyframes_since_decision_;
+  static const utils::StatsCollector optimize_time_stats(
+      "Backend Filtered Optimize Time [ms]");
+  static const utils::StatsCollector horizon_stats(
+      "Backend Horizon [nr states]");
+  optimize_time_stats.AddSample(filtered_time_ms_);
+  horizon_stats.AddSample(nr_states_);
+  if (keyframes_since_decision_ <= params_.cooldown_keyframes) return false;
+
+  const double prev_nr_states = nr_states_;
+  const size_t prev_num_optimize = num_optimize_;
+  if (filtered_time_ms_ > params_.target_latency_ms) {
+    if (num_optimize_ > 1u) {
+      --num_optimize_;
+    } else {
+      nr_states_ = std::max(nr_states_ - params_.nr_states_step,
+                            params_.min_nr_states);
+    }
+  } else if (filtered_time_ms_ <
+             params_.slack_ratio * params_.target_latency_ms) {
+    if (nr_states_ < params_.max_nr_states) {
+      nr_states_ = std::min(nr_states_ + params_.nr_states_step,
+                            params_.max_nr_states);
+    } else if (num_optimize_ < max_num_optimize_) {
+      ++num_optimize_;
+    }
+  }
+
+  const bool changed =
+      nr_states_ != prev_nr_states || num_optimize_ != prev_num_optimize;
+  if (changed) {
+    keyframes_since_decision_ = 0u;
+    static const utils::StatsCollector decisions_stats(
+        "Backend Horizon Decisions");
+    decisions_stats.IncrementOne();
+    VLOG(1) << "Smoother horizon controller: optimize time "
+            << filtered_time_ms_ << " [ms] (target "
+            << params_.target_latency_ms << " [ms]), horizon "
+            << prev_nr_states << " -> " << nr_states_ << " states, updates "
+            << prev_num_optimize << " -> " << num_optimize_ << ".";
+  }
+  return changed;
+}
+
+}  // namespace VIO
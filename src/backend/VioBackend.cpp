@@ -32,18 +32,28 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include <algorithm>
 #include <limits>  // for numeric_limits<>
 #include <map>
+#include <optional>
 #include <string>
 #include <utility>  // for make_pair
 #include <vector>
 
+#include <gtsam/linear/GaussianFactorGraph.h>
+
+#include <opencv2/core/utility.hpp>
+
+#include "kimera-vio/backend/LandmarkSelection.h"
 #include "kimera-vio/common/VioNavState.h"
 #include "kimera-vio/imu-frontend/ImuFrontend-definitions.h"
 #include "kimera-vio/logging/Logger.h"
 #include "kimera-vio/utils/GtsamPrinting.h"
+#include "kimera-vio/utils/MemoryAccounting.h"
+#include "kimera-vio/utils/PerfCounters.h"
 #include "kimera-vio/utils/Statistics.h"
 #include "kimera-vio/utils/Timer.h"
+#include "kimera-vio/utils/Tracing.h"
 #include "kimera-vio/utils/UtilsNumerical.h"
 
 DEFINE_bool(debug_graph_before_opt,
@@ -62,6 +72,12 @@ DEFINE_int32(max_number_of_cheirality_exceptions,
 DEFINE_bool(compute_state_covariance,
             false,
             "Flag to compute state covariance from optimization Backend");
+DEFINE_bool(state_covariance_from_bayes_tree,
+            true,
+            "Recover the state covariance from the root clique of the iSAM2 "
+            "Bayes tree, instead of factorizing the whole graph again. Falls "
+            "back to the full factorization if the latest state is not in the "
+            "root clique.");
 DEFINE_bool(no_incremental_pose,
             false,
             "Flag to disable incremental pose usage in backend");
@@ -81,6 +97,7 @@ VioBackend::VioBackend(const gtsam::Pose3& B_Pose_leftCamRect,
       imu_params_(imu_params),
       backend_output_params_(backend_output_params),
       odom_params_(odom_params),
+      resume_state_(std::nullopt),
       timestamp_lkf_(-1),
       imu_bias_lkf_(ImuBias()),
       W_Vel_B_lkf_(gtsam::Vector3::Zero()),
@@ -93,7 +110,8 @@ VioBackend::VioBackend(const gtsam::Pose3& B_Pose_leftCamRect,
       curr_kf_id_(0),
       landmark_count_(0),
       log_output_(log_output),
-      logger_(log_output ? std::make_unique<BackendLogger>() : nullptr) {
+      logger_(log_output ? std::make_unique<BackendLogger>() : nullptr),
+      smoother_memory_("Backend smoother") {
 // TODO the parsing of the params should be done inside here out from the
 // path to the params file, otherwise other derived VIO Backends will be
 // stuck with the parameters used by vanilla VIO, as there is no polymorphic
@@ -107,18 +125,18 @@ VioBackend::VioBackend(const gtsam::Pose3& B_Pose_leftCamRect,
 
 //////////////////////////////////////////////////////////////////////////////
 // Initialize smoother.
-#ifdef INCREMENTAL_SMOOTHER
-  gtsam::ISAM2Params isam_param;
-  BackendParams::setIsam2Params(backend_params, &isam_param);
-
-  smoother_ = std::make_unique<Smoother>(backend_params.nr_states_, isam_param);
-#else  // BATCH SMOOTHER
-  gtsam::LevenbergMarquardtParams lmParams;
-  lmParams.setlambdaInitial(0.0);     // same as GN
-  lmParams.setlambdaLowerBound(0.0);  // same as GN
-  lmParams.setlambdaUpperBound(0.0);  // same as GN)
-  smoother_ = std::make_unique<Smoother>(backend_params.nr_states_, lmParams);
-#endif
+  smoother_ = createSmoother();
+  if (backend_params.adaptiveHorizon_) {
+    SmootherHorizonControllerParams controller_params;
+    controller_params.target_latency_ms = backend_params.targetLatencyMs_;
+    controller_params.min_nr_states = backend_params.minNrStates_;
+    controller_params.max_nr_states = backend_params.maxNrStates_;
+    horizon_controller_ = std::make_unique<SmootherHorizonController>(
+        controller_params,
+        backend_params.nr_states_,
+        backend_params.numOptimize_);
+    smoother_->smootherLag() = horizon_controller_->getNrStates();
+  }
 
   // Set parameters for all factors.
   setFactorsParams(backend_params,
@@ -130,6 +148,12 @@ VioBackend::VioBackend(const gtsam::Pose3& B_Pose_leftCamRect,
 
   // Reset debug info.
   resetDebugInfo(&debug_info_);
+  if (log_output_ && backend_params.asyncDebugStats_ &&
+      backend_params.debugStatsPeriod_ > 0) {
+    // A single sample queued: if the worker lags, newer ones are dropped.
+    debug_stats_worker_ =
+        std::make_unique<utils::LowPriorityWorker>("Backend Debug Stats", 1u);
+  }
 
   // Print parameters if verbose
   if (VLOG_IS_ON(1)) print();
@@ -175,60 +199,175 @@ BackendOutput::UniquePtr VioBackend::spinOnce(const BackendInput& input) {
       getImuBiasPrevKf().print();
     }
 
-    // TODO(Toni): remove all of this.... It should be done in 3DVisualizer
-    // or in the Mesher depending on who needs what...
-    // Generate extra optional backend ouputs.
-    static const bool kOutputLmkMap =
-        backend_output_params_.output_map_lmk_ids_to_3d_points_in_time_horizon_;
-    static const bool kMinLmkObs =
-        backend_output_params_.min_num_obs_for_lmks_in_time_horizon_;
-    static const bool kOutputLmkTypeMap =
-        backend_output_params_.output_lmk_id_to_lmk_type_map_;
     LmkIdToLmkTypeMap lmk_id_to_lmk_type_map;
     PointsWithIdMap lmk_ids_to_3d_points_in_time_horizon;
-    if (kOutputLmkMap) {
-      // Generate this map only if requested, since costly.
-      // Also, if lmk type requested, fill lmk id to lmk type object.
-      // WARNING this also cleans the lmks inside the old_smart_factors map!
-      lmk_ids_to_3d_points_in_time_horizon =
-          getMapLmkIdsTo3dPointsInTimeHorizon(
-              smoother_->getFactors(),
-              kOutputLmkTypeMap ? &lmk_id_to_lmk_type_map : nullptr,
-              kMinLmkObs);
-    }
-
-    if (map_update_callback_) {
-      map_update_callback_(lmk_ids_to_3d_points_in_time_horizon);
-    } else {
-      LOG(FATAL) << "Did you forget to register the Map "
-                    "Update callback for at least the "
-                    "Frontend? Do so by using "
-                    "registerMapUpdateCallback function.";
-    }
-
-    // Create Backend Output Payload.
-    output_payload = std::make_unique<BackendOutput>(
+    LandmarksDelta landmarks_delta;
+    updateMap(&lmk_ids_to_3d_points_in_time_horizon,
+              &lmk_id_to_lmk_type_map,
+              &landmarks_delta);
+    output_payload = createOutput(
         VioNavStateTimestamped(
             input.timestamp_,
             (FLAGS_no_incremental_pose ? W_Pose_B_lkf_from_state_
                                        : W_Pose_B_lkf_from_increments_),
             W_Vel_B_lkf_,
             imu_bias_lkf_),
-        // TODO(Toni): Make all below optional!!
-        state_,
-        smoother_->getFactors(),
-        getCurrentStateCovariance(),
         curr_kf_id_,
-        landmark_count_,
-        debug_info_,
         lmk_ids_to_3d_points_in_time_horizon,
-        lmk_id_to_lmk_type_map);
+        lmk_id_to_lmk_type_map,
+        landmarks_delta);
+  }
 
+  return output_payload;
+}
+
+/* -------------------------------------------------------------------------- */
+std::vector<BackendOutput::UniquePtr> VioBackend::spinOnceBatched(
+    const std::vector<BackendInput::UniquePtr>& inputs) {
+  KIMERA_TRACE_SCOPE("VioBackend::spinOnceBatched");
+  CHECK(!inputs.empty());
+  CHECK_LE(inputs.size(),
+           static_cast<size_t>(backend_params_.maxBatchedKeyframes_));
+  CHECK(backend_state_ == BackendState::Nominal)
+      << "Batched updates need an initialized Backend.";
+  CHECK(supportsBatchedUpdates());
+  VLOG(1) << "Adding " << inputs.size()
+          << " keyframes with a single smoother update.";
+
+  // updateStates only chains the relative motion of the last keyframe.
+  Pose3 W_Pose_B_kf_from_increments = W_Pose_B_lkf_from_increments_;
+  const FrameId first_kf_id = curr_kf_id_ + 1;
+  const size_t nr_relocalizations = nr_relocalizations_;
+  bool backend_status = true;
+  for (size_t i = 0u; i < inputs.size() && backend_status; ++i) {
+    CHECK(inputs[i]);
+    if (VLOG_IS_ON(10)) {
+      inputs[i]->print();
+    }
     if (logger_) {
-      logger_->logBackendOutput(*output_payload);
+      logger_->logBackendExtOdom(*inputs[i]);
     }
+    // Only the last keyframe of the batch updates the smoother.
+    defer_optimization_ = i + 1u < inputs.size();
+    backend_status = addVisualInertialStateAndOptimize(*inputs[i]);
+  }
+  defer_optimization_ = false;
+
+  std::vector<BackendOutput::UniquePtr> output_payloads;
+  if (!backend_status) return output_payloads;
+
+  LmkIdToLmkTypeMap lmk_id_to_lmk_type_map;
+  PointsWithIdMap lmk_ids_to_3d_points_in_time_horizon;
+  LandmarksDelta landmarks_delta;
+  updateMap(&lmk_ids_to_3d_points_in_time_horizon,
+            &lmk_id_to_lmk_type_map,
+            &landmarks_delta);
+  if (nr_relocalizations_ != nr_relocalizations) {
+    // Relocalized: updateStates restarted the increments of the last
+    // keyframe from the state, the previous ones restart likewise.
+    const Pose3 output_Pose_state = W_Pose_B_lkf_from_increments_.compose(
+        state_.at<Pose3>(gtsam::Symbol(kPoseSymbolChar, curr_kf_id_))
+            .inverse());
+    W_Pose_B_kf_from_increments = output_Pose_state.compose(
+        state_.at<Pose3>(gtsam::Symbol(kPoseSymbolChar, first_kf_id - 1)));
   }
+  output_payloads.reserve(inputs.size());
+  for (size_t i = 0u; i < inputs.size(); ++i) {
+    const FrameId kf_id = first_kf_id + i;
+    const Pose3 W_Pose_B_kf =
+        state_.at<Pose3>(gtsam::Symbol(kPoseSymbolChar, kf_id));
+    W_Pose_B_kf_from_increments = W_Pose_B_kf_from_increments.compose(
+        state_.at<Pose3>(gtsam::Symbol(kPoseSymbolChar, kf_id - 1))
+            .between(W_Pose_B_kf));
+    output_payloads.push_back(createOutput(
+        VioNavStateTimestamped(
+            inputs[i]->timestamp_,
+            (FLAGS_no_incremental_pose ? W_Pose_B_kf
+                                       : W_Pose_B_kf_from_increments),
+            state_.at<Vector3>(gtsam::Symbol(kVelocitySymbolChar, kf_id)),
+            state_.at<ImuBias>(gtsam::Symbol(kImuBiasSymbolChar, kf_id))),
+        kf_id,
+        lmk_ids_to_3d_points_in_time_horizon,
+        lmk_id_to_lmk_type_map,
+        // The map changed once for the whole batch.
+        i + 1u == inputs.size() ? landmarks_delta : LandmarksDelta()));
+  }
+  W_Pose_B_lkf_from_increments_ = W_Pose_B_kf_from_increments;
+  return output_payloads;
+}
+
+/* -------------------------------------------------------------------------- */
+void VioBackend::updateMap(
+    PointsWithIdMap* lmk_ids_to_3d_points_in_time_horizon,
+    LmkIdToLmkTypeMap* lmk_id_to_lmk_type_map,
+    LandmarksDelta* landmarks_delta) {
+  CHECK_NOTNULL(lmk_ids_to_3d_points_in_time_horizon);
+  CHECK_NOTNULL(lmk_id_to_lmk_type_map);
+  CHECK_NOTNULL(landmarks_delta);
+  // TODO(Toni): remove all of this.... It should be done in 3DVisualizer
+  // or in the Mesher depending on who needs what...
+  // Generate extra optional backend ouputs.
+  static const bool kOutputLmkMap =
+      backend_output_params_.output_map_lmk_ids_to_3d_points_in_time_horizon_;
+  static const bool kMinLmkObs =
+      backend_output_params_.min_num_obs_for_lmks_in_time_horizon_;
+  static const bool kOutputLmkTypeMap =
+      backend_output_params_.output_lmk_id_to_lmk_type_map_;
+  if (kOutputLmkMap) {
+    // Generate this map only if requested, since costly.
+    // Also, if lmk type requested, fill lmk id to lmk type object.
+    // WARNING this also cleans the lmks inside the old_smart_factors map!
+    *lmk_ids_to_3d_points_in_time_horizon =
+        getMapLmkIdsTo3dPointsInTimeHorizon(
+            smoother_->getFactors(),
+            kOutputLmkTypeMap ? lmk_id_to_lmk_type_map : nullptr,
+            kMinLmkObs,
+            landmarks_delta);
+  }
+
+  if (map_update_callback_) {
+    map_update_callback_(*lmk_ids_to_3d_points_in_time_horizon);
+  } else {
+    LOG(FATAL) << "Did you forget to register the Map "
+                  "Update callback for at least the "
+                  "Frontend? Do so by using "
+                  "registerMapUpdateCallback function.";
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+BackendOutput::UniquePtr VioBackend::createOutput(
+    const VioNavStateTimestamped& W_State_B_kf,
+    const FrameId& kf_id,
+    const PointsWithIdMap& lmk_ids_to_3d_points_in_time_horizon,
+    const LmkIdToLmkTypeMap& lmk_id_to_lmk_type_map,
+    const LandmarksDelta& landmarks_delta) {
+  // Create Backend Output Payload, only copying the heavy fields that
+  // are needed: the logger needs the state and the debug info.
+  BackendOutputFields fields = output_fields_;
+  if (logger_) fields |= BackendOutputFields{true, false, false, true};
+  // The covariance is only computed for the latest keyframe.
+  if (kf_id != static_cast<FrameId>(curr_kf_id_)) {
+    fields.state_covariance_ = false;
+  }
+  static const gtsam::Values kNoState;
+  static const gtsam::NonlinearFactorGraph kNoFactorGraph;
+  BackendOutput::UniquePtr output_payload = std::make_unique<BackendOutput>(
+      W_State_B_kf,
+      fields.state_ ? state_ : kNoState,
+      fields.factor_graph_ ? smoother_->getFactors() : kNoFactorGraph,
+      fields.state_covariance_ ? getCurrentStateCovariance() : gtsam::Matrix(),
+      kf_id,
+      landmark_count_,
+      fields.debug_info_ ? debug_info_ : DebugVioInfo(),
+      lmk_ids_to_3d_points_in_time_horizon,
+      lmk_id_to_lmk_type_map,
+      fields,
+      landmarks_delta);
 
+  if (logger_) {
+    logger_->logBackendOutput(*output_payload);
+  }
   return output_payload;
 }
 
@@ -428,6 +567,7 @@ bool VioBackend::addVisualInertialStateAndOptimize(
 }
 
 bool VioBackend::addVisualInertialStateAndOptimize(const BackendInput& input) {
+  KIMERA_TRACE_SCOPE("VioBackend::addVisualInertialStateAndOptimize");
   VLOG(10) << "Add visual inertial state and optimize.";
   CHECK(input.status_stereo_measurements_kf_);
   CHECK(input.pim_);
@@ -451,7 +591,11 @@ void VioBackend::addLandmarksToGraph(const LandmarkIds& landmarks_kf) {
   int n_updated_landmarks = 0;
   debug_info_.numAddedSmartF_ += landmarks_kf.size();
 
-  for (const LandmarkId& lmk_id : landmarks_kf) {
+  const LandmarkIds selected_landmarks =
+      backend_params_.maxLandmarksPerKeyframe_ > 0
+          ? selectLandmarks(landmarks_kf)
+          : landmarks_kf;
+  for (const LandmarkId& lmk_id : selected_landmarks) {
     FeatureTrack& ft = feature_tracks_.at(lmk_id);
     // TODO(TONI): parametrize this min_num_of_obs... should be in Frontend
     // rather than Backend though...
@@ -480,14 +624,52 @@ void VioBackend::addLandmarksToGraph(const LandmarkIds& landmarks_kf) {
            << "Updated " << n_updated_landmarks << " landmarks in graph";
 }
 
+/* -------------------------------------------------------------------------- */
+LandmarkIds VioBackend::selectLandmarks(const LandmarkIds& landmarks_kf) const {
+  const size_t budget =
+      static_cast<size_t>(backend_params_.maxLandmarksPerKeyframe_);
+  // Without the state covariance, only the geometry is scored.
+  gtsam::Matrix6 pose_covariance = gtsam::Matrix6::Identity();
+  if (FLAGS_compute_state_covariance && !state_covariance_lkf_.isZero()) {
+    pose_covariance = state_covariance_lkf_.topLeftCorner<6, 6>();
+  }
+
+  LandmarkIds selected;
+  std::vector<LandmarkScore> new_landmark_scores;
+  for (const LandmarkId& lmk_id : landmarks_kf) {
+    const FeatureTrack& ft = feature_tracks_.at(lmk_id);
+    if (ft.in_ba_graph_) {
+      selected.push_back(lmk_id);
+    } else if (ft.obs_.size() >= 2u) {
+      new_landmark_scores.emplace_back(
+          lmk_id,
+          computeLandmarkInformationGain(ft.obs_.back().second,
+                                         stereo_cal_,
+                                         B_Pose_leftCamRect_,
+                                         pose_covariance,
+                                         backend_params_.smartNoiseSigma_));
+    }
+  }
+
+  const size_t nr_new_landmarks =
+      selected.size() < budget ? budget - selected.size() : 0u;
+  const LandmarkIds new_landmarks =
+      selectMostInformativeLandmarks(new_landmark_scores, nr_new_landmarks);
+  VLOG(10) << "Selected " << new_landmarks.size() << " new landmarks out of "
+           << new_landmark_scores.size() << ", and " << selected.size()
+           << " landmarks in the graph (budget: " << budget << ").";
+  selected.insert(selected.end(), new_landmarks.begin(), new_landmarks.end());
+  return selected;
+}
+
 /* -------------------------------------------------------------------------- */
 // Adds a landmark to the graph for the first time.
 void VioBackend::addLandmarkToGraph(const LandmarkId& lmk_id,
                                     const FeatureTrack& ft) {
   // We use a unit pinhole projection camera for the smart factors to be
   // more efficient.
-  SmartStereoFactor::shared_ptr new_factor(new SmartStereoFactor(
-      smart_noise_, smart_factors_params_, B_Pose_leftCamRect_));
+  SmartStereoFactor::shared_ptr new_factor = allocatePooled<SmartStereoFactor>(
+      smart_noise_, smart_factors_params_, B_Pose_leftCamRect_);
 
   VLOG(10) << "Adding landmark with: " << ft.obs_.size()
            << " landmarks to graph, with keys: ";
@@ -523,7 +705,8 @@ void VioBackend::updateLandmarkInGraph(
 
   const auto& old_factor = old_smart_factors_it->second.first;
   // Clone old factor to keep all previous measurements, now append one.
-  SmartStereoFactor::shared_ptr new_factor(new SmartStereoFactor(*old_factor));
+  SmartStereoFactor::shared_ptr new_factor =
+      allocatePooled<SmartStereoFactor>(*old_factor);
 
   const gtsam::Symbol pose_symbol(kPoseSymbolChar, new_measurement.first);
   const StereoPoint2& measurement = new_measurement.second;
@@ -531,8 +714,10 @@ void VioBackend::updateLandmarkInGraph(
 
   // Update the factor
   Slot slot = old_smart_factors_it->second.second;
-  if (slot != -1) {
-    new_smart_factors_.insert(std::make_pair(lmk_id, new_factor));
+  if (slot != -1 || new_smart_factors_.count(lmk_id) > 0u) {
+    // The factor is in the graph, or not added yet since its keyframe was
+    // deferred (batched update): replace the factor to add.
+    new_smart_factors_[lmk_id] = new_factor;
   } else {
     // If it's slot in the graph is still -1, it means that the factor has not
     // been inserted yet in the graph...
@@ -550,12 +735,31 @@ void VioBackend::updateLandmarkInGraph(
 PointsWithIdMap VioBackend::getMapLmkIdsTo3dPointsInTimeHorizon(
     const gtsam::NonlinearFactorGraph& graph,
     LmkIdToLmkTypeMap* lmk_id_to_lmk_type_map,
-    const size_t& min_age) {
-  PointsWithIdMap points_with_id;
-
-  if (lmk_id_to_lmk_type_map) {
-    lmk_id_to_lmk_type_map->clear();
-  }
+    const size_t& min_age,
+    LandmarksDelta* landmarks_delta) {
+  if (landmarks_delta) *landmarks_delta = LandmarksDelta();
+
+  // The points of the previous call are updated in place: only the landmarks
+  // that appeared, moved or left the time horizon are touched.
+  ++lmk_cache_stamp_;
+  const auto update_lmk = [this, &landmarks_delta](const LandmarkId& lmk_id,
+                                                   const gtsam::Point3& point,
+                                                   const LandmarkType& type) {
+    // Check that we have not added this lmk already...
+    auto stamp_it = lmk_cache_stamps_.find(lmk_id);
+    DCHECK(stamp_it == lmk_cache_stamps_.end() ||
+           stamp_it->second != lmk_cache_stamp_);
+    auto point_it = lmk_points_cache_.find(lmk_id);
+    if (point_it == lmk_points_cache_.end()) {
+      lmk_points_cache_[lmk_id] = point;
+      if (landmarks_delta) landmarks_delta->added_[lmk_id] = point;
+    } else if (point_it->second != point) {
+      point_it->second = point;
+      if (landmarks_delta) landmarks_delta->moved_[lmk_id] = point;
+    }
+    lmk_types_cache_[lmk_id] = type;
+    lmk_cache_stamps_[lmk_id] = lmk_cache_stamp_;
+  };
 
   // Step 1:
   /////////////// Add landmarks encoded in the smart factors. //////////////////
@@ -645,12 +849,7 @@ PointsWithIdMap VioBackend::getMapLmkIdsTo3dPointsInTimeHorizon(
         // we have observed the lmk at least min_age times.
         VLOG(20) << "Adding lmk with id: " << lmk_id
                  << " to list of lmks in time horizon";
-        // Check that we have not added this lmk already...
-        CHECK(points_with_id.find(lmk_id) == points_with_id.end());
-        points_with_id[lmk_id] = *result;
-        if (lmk_id_to_lmk_type_map) {
-          (*lmk_id_to_lmk_type_map)[lmk_id] = LandmarkType::SMART;
-        }
+        update_lmk(lmk_id, *result, LandmarkType::SMART);
         nr_valid_smart_lmks++;
       } else {
         VLOG(20) << "Rejecting lmk with id: " << lmk_id
@@ -677,14 +876,28 @@ PointsWithIdMap VioBackend::getMapLmkIdsTo3dPointsInTimeHorizon(
     }
 
     const auto lmk_id = key.index();
-    DCHECK(points_with_id.find(lmk_id) == points_with_id.end());
-    points_with_id[lmk_id] = key_value.value.cast<gtsam::Point3>();
-    if (lmk_id_to_lmk_type_map) {
-      (*lmk_id_to_lmk_type_map)[lmk_id] = LandmarkType::PROJECTION;
-    }
+    update_lmk(lmk_id,
+               key_value.value.cast<gtsam::Point3>(),
+               LandmarkType::PROJECTION);
     nr_proj_lmks++;
   }
 
+  // Step 3:
+  ////////////// Remove landmarks that left the time horizon. //////////////////
+  LandmarkIds removed_lmk_ids;
+  for (const auto& lmk_id_stamp : lmk_cache_stamps_) {
+    if (lmk_id_stamp.second != lmk_cache_stamp_) {
+      removed_lmk_ids.push_back(lmk_id_stamp.first);
+    }
+  }
+  for (const LandmarkId& lmk_id : removed_lmk_ids) {
+    lmk_cache_stamps_.erase(lmk_id);
+    lmk_points_cache_.erase(lmk_id);
+    lmk_types_cache_.erase(lmk_id);
+  }
+  if (landmarks_delta) landmarks_delta->removed_ = std::move(removed_lmk_ids);
+  if (lmk_id_to_lmk_type_map) *lmk_id_to_lmk_type_map = lmk_types_cache_;
+
   // TODO aren't these points post-optimization? Shouldn't we instead add
   // the points before optimization? Then the regularities we enforce will
   // have the most impact, otherwise the points in the optimization horizon
@@ -700,26 +913,113 @@ PointsWithIdMap VioBackend::getMapLmkIdsTo3dPointsInTimeHorizon(
            << "Number of landmarks (not involved in a smart factor) "
            << nr_proj_lmks << ".\n Total number of landmarks: "
            << (nr_valid_smart_lmks + nr_proj_lmks);
-  return points_with_id;
+  return lmk_points_cache_;
 }
 
 /* -------------------------------------------------------------------------- */
 // NOT TESTED (--> There is a UnitTest function in UtilsOpenCV)
 void VioBackend::computeStateCovariance() {
-  gtsam::Marginals marginals(smoother_->getFactors(),
-                             state_,
-                             gtsam::Marginals::Factorization::CHOLESKY);
-
   // Current state includes pose, velocity and imu biases.
   gtsam::KeyVector keys;
   keys.push_back(gtsam::Symbol(kPoseSymbolChar, curr_kf_id_));
   keys.push_back(gtsam::Symbol(kVelocitySymbolChar, curr_kf_id_));
   keys.push_back(gtsam::Symbol(kImuBiasSymbolChar, curr_kf_id_));
 
+  gtsam::Matrix covariance_bvx;
+  if (!FLAGS_state_covariance_from_bayes_tree ||
+      !getRootCliqueCovariance(keys, &covariance_bvx)) {
+    gtsam::Marginals marginals(smoother_->getFactors(),
+                               state_,
+                               gtsam::Marginals::Factorization::CHOLESKY);
+    covariance_bvx = marginals.jointMarginalCovariance(keys).fullMatrix();
+  }
+
   // Return the marginal covariance matrix.
   state_covariance_lkf_ = UtilsOpenCV::Covariance_bvx2xvb(
-      marginals.jointMarginalCovariance(keys)
-          .fullMatrix());  // 6 + 3 + 6 = 15x15matrix
+      covariance_bvx);  // 6 + 3 + 6 = 15x15matrix
+}
+
+/* -------------------------------------------------------------------------- */
+size_t VioBackend::getSmootherMemoryBytes() const {
+  const gtsam::ISAM2& isam = smoother_->getISAM2();
+  // Estimate, linearization point and deltas.
+  size_t bytes = 3u * state_.dim() * sizeof(double);
+  // Factors, and the Bayes tree: the dense conditional of each clique.
+  bytes += smoother_->getFactors().size() *
+           (sizeof(gtsam::NonlinearFactor) + sizeof(void*));
+  std::vector<gtsam::ISAM2Clique::shared_ptr> cliques(isam.roots().begin(),
+                                                      isam.roots().end());
+  while (!cliques.empty()) {
+    const gtsam::ISAM2Clique::shared_ptr clique = cliques.back();
+    cliques.pop_back();
+    if (!clique) continue;
+    if (clique->conditional()) {
+      bytes += clique->conditional()->matrixObject().matrix().size() *
+               sizeof(double);
+    }
+    cliques.insert(
+        cliques.end(), clique->children.begin(), clique->children.end());
+  }
+  return bytes;
+}
+
+/* -------------------------------------------------------------------------- */
+bool VioBackend::getRootCliqueCovariance(const gtsam::KeyVector& keys,
+                                         gtsam::Matrix* covariance) const {
+  CHECK_NOTNULL(covariance);
+  const gtsam::ISAM2& isam = smoother_->getISAM2();
+  // The fixed-lag smoother orders the keys by timestamp: the latest state
+  // is usually eliminated last, in the root clique.
+  gtsam::ISAM2Clique::shared_ptr root = nullptr;
+  for (const gtsam::Key& key : keys) {
+    if (!isam.valueExists(key)) return false;
+    const gtsam::ISAM2Clique::shared_ptr& clique = isam[key];
+    if (!clique || clique->parent() || (root && clique != root)) {
+      VLOG(5) << "Key " << gtsam::DefaultKeyFormatter(key)
+              << " is not in the root clique of the Bayes tree.";
+      return false;
+    }
+    root = clique;
+  }
+  CHECK(root);
+
+  // Without parents, the root conditional is the joint density of its
+  // frontal variables: its information matrix is R^T * R.
+  const gtsam::GaussianConditional::shared_ptr& conditional =
+      root->conditional();
+  CHECK(conditional);
+  std::map<gtsam::Key, std::pair<size_t, size_t>> key_slices;
+  size_t dim = 0u;
+  for (auto it = conditional->begin(); it != conditional->end(); ++it) {
+    const size_t key_dim = conditional->getDim(it);
+    key_slices[*it] = std::make_pair(dim, key_dim);
+    dim += key_dim;
+  }
+  const gtsam::Matrix root_covariance =
+      conditional->information().inverse();
+
+  // Same order as gtsam::Marginals::jointMarginalCovariance (sorted keys).
+  gtsam::KeyVector sorted_keys = keys;
+  std::sort(sorted_keys.begin(), sorted_keys.end());
+  size_t state_dim = 0u;
+  for (const gtsam::Key& key : sorted_keys) {
+    state_dim += key_slices.at(key).second;
+  }
+  covariance->resize(state_dim, state_dim);
+  size_t row = 0u;
+  for (const gtsam::Key& key_i : sorted_keys) {
+    const auto& slice_i = key_slices.at(key_i);
+    size_t col = 0u;
+    for (const gtsam::Key& key_j : sorted_keys) {
+      const auto& slice_j = key_slices.at(key_j);
+      covariance->block(row, col, slice_i.second, slice_j.second) =
+          root_covariance.block(
+              slice_i.first, slice_j.first, slice_i.second, slice_j.second);
+      col += slice_j.second;
+    }
+    row += slice_i.second;
+  }
+  return true;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -912,24 +1212,26 @@ void VioBackend::addImuFactor(const FrameId& from_id,
                               const gtsam::PreintegrationType& pim) {
   switch (imu_params_.imu_preintegration_type_) {
     case ImuPreintegrationType::kPreintegratedCombinedMeasurements: {
-      new_imu_prior_and_other_factors_.emplace_shared<gtsam::CombinedImuFactor>(
-          gtsam::Symbol(kPoseSymbolChar, from_id),
-          gtsam::Symbol(kVelocitySymbolChar, from_id),
-          gtsam::Symbol(kPoseSymbolChar, to_id),
-          gtsam::Symbol(kVelocitySymbolChar, to_id),
-          gtsam::Symbol(kImuBiasSymbolChar, from_id),
-          gtsam::Symbol(kImuBiasSymbolChar, to_id),
-          safeCastToPreintegratedCombinedImuMeasurements(pim));
+      new_imu_prior_and_other_factors_.push_back(
+          allocatePooled<gtsam::CombinedImuFactor>(
+              gtsam::Symbol(kPoseSymbolChar, from_id),
+              gtsam::Symbol(kVelocitySymbolChar, from_id),
+              gtsam::Symbol(kPoseSymbolChar, to_id),
+              gtsam::Symbol(kVelocitySymbolChar, to_id),
+              gtsam::Symbol(kImuBiasSymbolChar, from_id),
+              gtsam::Symbol(kImuBiasSymbolChar, to_id),
+              safeCastToPreintegratedCombinedImuMeasurements(pim)));
       break;
     }
     case ImuPreintegrationType::kPreintegratedImuMeasurements: {
-      new_imu_prior_and_other_factors_.emplace_shared<gtsam::ImuFactor>(
-          gtsam::Symbol(kPoseSymbolChar, from_id),
-          gtsam::Symbol(kVelocitySymbolChar, from_id),
-          gtsam::Symbol(kPoseSymbolChar, to_id),
-          gtsam::Symbol(kVelocitySymbolChar, to_id),
-          gtsam::Symbol(kImuBiasSymbolChar, from_id),
-          safeCastToPreintegratedImuMeasurements(pim));
+      new_imu_prior_and_other_factors_.push_back(
+          allocatePooled<gtsam::ImuFactor>(
+              gtsam::Symbol(kPoseSymbolChar, from_id),
+              gtsam::Symbol(kVelocitySymbolChar, from_id),
+              gtsam::Symbol(kPoseSymbolChar, to_id),
+              gtsam::Symbol(kVelocitySymbolChar, to_id),
+              gtsam::Symbol(kImuBiasSymbolChar, from_id),
+              safeCastToPreintegratedImuMeasurements(pim)));
 
       static const gtsam::imuBias::ConstantBias zero_bias(
           gtsam::Vector3(0.0, 0.0, 0.0), gtsam::Vector3(0.0, 0.0, 0.0));
@@ -946,15 +1248,16 @@ void VioBackend::addImuFactor(const FrameId& from_id,
                                         imu_params_.acc_random_walk_);
       bias_sigmas.tail<3>().setConstant(sqrt_delta_t_ij *
                                         imu_params_.gyro_random_walk_);
+      // Depends on the time between keyframes, hence not shared.
       const gtsam::SharedNoiseModel& bias_noise_model =
           gtsam::noiseModel::Diagonal::Sigmas(bias_sigmas);
 
-      new_imu_prior_and_other_factors_
-          .emplace_shared<gtsam::BetweenFactor<gtsam::imuBias::ConstantBias>>(
+      new_imu_prior_and_other_factors_.push_back(
+          allocatePooled<gtsam::BetweenFactor<gtsam::imuBias::ConstantBias>>(
               gtsam::Symbol(kImuBiasSymbolChar, from_id),
               gtsam::Symbol(kImuBiasSymbolChar, to_id),
               zero_bias,
-              bias_noise_model);
+              bias_noise_model));
       break;
     }
     default: {
@@ -973,19 +1276,13 @@ void VioBackend::addBetweenFactor(const FrameId& from_id,
                                   const gtsam::Pose3& from_id_POSE_to_id,
                                   const double& between_rotation_precision,
                                   const double& between_translation_precision) {
-  // TODO(Toni): make noise models const members of Backend...
-  Vector6 precisions;
-  precisions.head<3>().setConstant(between_rotation_precision);
-  precisions.tail<3>().setConstant(between_translation_precision);
-  const gtsam::SharedNoiseModel& betweenNoise_ =
-      gtsam::noiseModel::Diagonal::Precisions(precisions);
-
-  new_imu_prior_and_other_factors_
-      .emplace_shared<gtsam::BetweenFactor<gtsam::Pose3>>(
+  new_imu_prior_and_other_factors_.push_back(
+      allocatePooled<gtsam::BetweenFactor<gtsam::Pose3>>(
           gtsam::Symbol(kPoseSymbolChar, from_id),
           gtsam::Symbol(kPoseSymbolChar, to_id),
           from_id_POSE_to_id,
-          betweenNoise_);
+          getBetweenNoiseModel(between_rotation_precision,
+                               between_translation_precision)));
 
   debug_info_.numAddedBetweenStereoF_++;
 }
@@ -993,12 +1290,12 @@ void VioBackend::addBetweenFactor(const FrameId& from_id,
 /* -------------------------------------------------------------------------- */
 void VioBackend::addNoMotionFactor(const FrameId& from_id,
                                    const FrameId& to_id) {
-  new_imu_prior_and_other_factors_
-      .emplace_shared<gtsam::BetweenFactor<gtsam::Pose3>>(
+  new_imu_prior_and_other_factors_.push_back(
+      allocatePooled<gtsam::BetweenFactor<gtsam::Pose3>>(
           gtsam::Symbol(kPoseSymbolChar, from_id),
           gtsam::Symbol(kPoseSymbolChar, to_id),
           gtsam::Pose3(),
-          no_motion_prior_noise_);
+          no_motion_prior_noise_));
 
   debug_info_.numAddedNoMotionF_++;
 
@@ -1008,24 +1305,96 @@ void VioBackend::addNoMotionFactor(const FrameId& from_id,
 /* -------------------------------------------------------------------------- */
 void VioBackend::addZeroVelocityPrior(const FrameId& frame_id) {
   VLOG(10) << "No motion detected, adding zero velocity prior.";
-  new_imu_prior_and_other_factors_
-      .emplace_shared<gtsam::PriorFactor<gtsam::Vector3>>(
+  new_imu_prior_and_other_factors_.push_back(
+      allocatePooled<gtsam::PriorFactor<gtsam::Vector3>>(
           gtsam::Symbol(kVelocitySymbolChar, frame_id),
           gtsam::Vector3::Zero(),
-          zero_velocity_prior_noise_);
+          zero_velocity_prior_noise_));
 }
 
 void VioBackend::addVelocityPrior(const FrameId& frame_id,
                                   const gtsam::Velocity3& vel,
                                   const double& precision) {
   VLOG(10) << "Adding odometry pose velocity prior factor.";
-  gtsam::Vector3 precisions;
-  precisions.head<3>().setConstant(precision);
-  const gtsam::SharedNoiseModel& noise_model =
-      gtsam::noiseModel::Diagonal::Precisions(precisions);
-  new_imu_prior_and_other_factors_
-      .emplace_shared<gtsam::PriorFactor<gtsam::Vector3>>(
-          gtsam::Symbol(kVelocitySymbolChar, frame_id), vel, noise_model);
+  new_imu_prior_and_other_factors_.push_back(
+      allocatePooled<gtsam::PriorFactor<gtsam::Vector3>>(
+          gtsam::Symbol(kVelocitySymbolChar, frame_id),
+          vel,
+          getVelocityPriorNoiseModel(precision)));
+}
+
+/* -------------------------------------------------------------------------- */
+void VioBackend::setRelocalizationPrior(const FrameId& kf_id,
+                                        const gtsam::Pose3& W_Pose_B,
+                                        const double& rotation_precision,
+                                        const double& translation_precision) {
+  CHECK_GT(rotation_precision, 0.0);
+  CHECK_GT(translation_precision, 0.0);
+  std::lock_guard<std::mutex> lock(relocalization_mutex_);
+  // Only the latest relocalization matters.
+  relocalization_prior_ = RelocalizationPrior{
+      kf_id, W_Pose_B, rotation_precision, translation_precision};
+}
+
+bool VioBackend::addRelocalizationPrior() {
+  std::optional<RelocalizationPrior> prior;
+  {
+    std::lock_guard<std::mutex> lock(relocalization_mutex_);
+    prior.swap(relocalization_prior_);
+  }
+  if (!prior) return false;
+
+  const gtsam::Symbol pose_key(kPoseSymbolChar, prior->kf_id_);
+  if (!state_.exists(pose_key) && !new_values_.exists(pose_key)) {
+    LOG(WARNING) << "Backend: keyframe " << prior->kf_id_
+                 << " left the smoother before its relocalization.";
+    return false;
+  }
+  LOG(INFO) << "Backend: relocalizing keyframe " << prior->kf_id_ << ".";
+  // The output poses chained from increments drift away from the smoother's
+  // estimates: the prior is expressed in the smoother's world frame.
+  const Pose3 state_Pose_output =
+      FLAGS_no_incremental_pose
+          ? Pose3()
+          : W_Pose_B_lkf_from_state_.compose(
+                W_Pose_B_lkf_from_increments_.inverse());
+  new_imu_prior_and_other_factors_.push_back(
+      allocatePooled<gtsam::PriorFactor<gtsam::Pose3>>(
+          pose_key,
+          state_Pose_output.compose(prior->W_Pose_B_),
+          getBetweenNoiseModel(prior->rotation_precision_,
+                               prior->translation_precision_)));
+  relocalization_state_Pose_output_ = state_Pose_output;
+  ++nr_relocalizations_;
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+const gtsam::SharedNoiseModel& VioBackend::getBetweenNoiseModel(
+    const double& rotation_precision,
+    const double& translation_precision) {
+  gtsam::SharedNoiseModel& noise_model = between_noise_models_[std::make_pair(
+      rotation_precision, translation_precision)];
+  if (!noise_model) {
+    gtsam::Vector6 precisions;
+    precisions.head<3>().setConstant(rotation_precision);
+    precisions.tail<3>().setConstant(translation_precision);
+    noise_model = gtsam::noiseModel::Diagonal::Precisions(precisions);
+  }
+  return noise_model;
+}
+
+/* -------------------------------------------------------------------------- */
+const gtsam::SharedNoiseModel& VioBackend::getVelocityPriorNoiseModel(
+    const double& precision) {
+  gtsam::SharedNoiseModel& noise_model =
+      velocity_prior_noise_models_[precision];
+  if (!noise_model) {
+    gtsam::Vector3 precisions;
+    precisions.setConstant(precision);
+    noise_model = gtsam::noiseModel::Diagonal::Precisions(precisions);
+  }
+  return noise_model;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -1038,8 +1407,27 @@ bool VioBackend::optimize(
     const FrameId& cur_id,
     const size_t& max_extra_iterations,
     const gtsam::FactorIndices& extra_factor_slots_to_delete) {
+  KIMERA_TRACE_SCOPE("VioBackend::optimize");
+  KIMERA_PERF_SCOPE("VioBackend::optimize");
   DCHECK(smoother_) << "Incremental smoother is a null pointer.";
 
+  if (defer_optimization_) {
+    // Batched update: the keyframe is added to the smoother with the last
+    // keyframe of the batch, its new values keep their own timestamp.
+    CHECK(extra_factor_slots_to_delete.empty());
+    for (const auto& key_value : new_values_) {
+      deferred_key_frame_count_.emplace(key_value.key, cur_id);
+    }
+    // The next keyframe of the batch is predicted from this one.
+    W_Pose_B_lkf_from_state_ =
+        new_values_.at<Pose3>(gtsam::Symbol(kPoseSymbolChar, cur_id));
+    W_Vel_B_lkf_ =
+        new_values_.at<Vector3>(gtsam::Symbol(kVelocitySymbolChar, cur_id));
+    return true;
+  }
+
+  addRelocalizationPrior();
+
   // Only for statistics and debugging.
   // Store start time to calculate absolute total time taken.
   const auto& total_start_time = utils::Timer::tic();
@@ -1161,9 +1549,16 @@ bool VioBackend::optimize(
   // are actually counting the number of states in the smoother.
   std::map<Key, double> key_frame_count;
   for (const auto& key_value : new_values_) {
-    key_frame_count[key_value.key] = cur_id;
+    const auto deferred_it = deferred_key_frame_count_.find(key_value.key);
+    key_frame_count[key_value.key] =
+        deferred_it != deferred_key_frame_count_.end() ? deferred_it->second
+                                                       : cur_id;
   }
   DCHECK_EQ(key_frame_count.size(), new_values_.size());
+  for (const Key& key : refreshed_keys_) {
+    DCHECK(!new_values_.exists(key));
+    key_frame_count[key] = cur_id;
+  }
 
   // Store time before iSAM update.
   if (VLOG_IS_ON(10) || log_output_) {
@@ -1202,6 +1597,8 @@ bool VioBackend::optimize(
 
     // Clear values.
     new_values_.clear();
+    refreshed_keys_.clear();
+    deferred_key_frame_count_.clear();
 
     // Update slots of smart factors:.
     // TODO(Toni): shouldn't we be doing this after each updateSmoother call?
@@ -1219,7 +1616,12 @@ bool VioBackend::optimize(
     ////////////////////////////////////////////////////////////////////////////
 
     // Do some more optimization iterations.
-    for (size_t n_iter = 1; n_iter < max_extra_iterations && is_smoother_ok;
+    const size_t nr_iterations =
+        horizon_controller_
+            ? std::min(max_extra_iterations,
+                       horizon_controller_->getNumOptimize())
+            : max_extra_iterations;
+    for (size_t n_iter = 1; n_iter < nr_iterations && is_smoother_ok;
          ++n_iter) {
       VLOG(10) << "Doing extra iteration nr: " << n_iter;
       is_smoother_ok = updateSmoother(&result);
@@ -1233,12 +1635,30 @@ bool VioBackend::optimize(
 
     // Update states we need for next iteration, if smoother is ok.
     if (is_smoother_ok) {
+      VLOG(10) << "Starting to calculate estimate.";
+      state_ = smoother_->calculateEstimate();
+      VLOG(10) << "Finished to calculate estimate.";
       updateStates(cur_id);
 
+      if (backend_params_.factorSlotCompactionPeriod_ > 0 &&
+          ++nr_optimizations_since_compaction_ >=
+              static_cast<size_t>(
+                  backend_params_.factorSlotCompactionPeriod_)) {
+        const gtsam::NonlinearFactorGraph& graph = smoother_->getFactors();
+        if (graph.size() - graph.nrFactors() >=
+            backend_params_.minEmptySlotsRatio_ * graph.size()) {
+          compactSmootherFactors();
+        }
+        nr_optimizations_since_compaction_ = 0u;
+      }
+
       // TODO: Add Update latest covariance --> move flag
       if (FLAGS_compute_state_covariance) {
         computeStateCovariance();
       }
+      if (utils::isMemoryAccountingEnabled()) {
+        smoother_memory_.set(getSmootherMemoryBytes());
+      }
 
       // Debug.
       postDebug(total_start_time, start_time);
@@ -1246,6 +1666,15 @@ bool VioBackend::optimize(
       LOG(ERROR) << "Smoother is not ok! Not updating Backend state.";
     }
   }
+
+  // The smoother marginalizes wrt its new horizon from the next update on.
+  if (horizon_controller_ &&
+      horizon_controller_->update(
+          utils::Timer::toc<std::chrono::microseconds>(total_start_time)
+              .count() /
+          1000.0)) {
+    smoother_->smootherLag() = horizon_controller_->getNrStates();
+  }
   return is_smoother_ok;
 }
 
@@ -1335,10 +1764,6 @@ void VioBackend::addConstantVelocityFactor(const FrameId& from_id,
 
 /* -------------------------------- UPDATE ---------------------------------- */
 void VioBackend::updateStates(const FrameId& cur_id) {
-  VLOG(10) << "Starting to calculate estimate.";
-  state_ = smoother_->calculateEstimate();
-  VLOG(10) << "Finished to calculate estimate.";
-
   DCHECK(state_.find(gtsam::Symbol(kPoseSymbolChar, cur_id)) != state_.end());
   DCHECK(state_.find(gtsam::Symbol(kVelocitySymbolChar, cur_id)) !=
          state_.end());
@@ -1368,9 +1793,16 @@ void VioBackend::updateStates(const FrameId& cur_id) {
   imu_bias_lkf_ = state_.at<gtsam::imuBias::ConstantBias>(
       gtsam::Symbol(kImuBiasSymbolChar, cur_id));
 
-  // Update output estimate by chaining relative motion estimates
-  W_Pose_B_lkf_from_increments_ =
-      W_Pose_B_lkf_from_increments_.compose(B_lkf_Pose_kf);
+  // Update output estimate by chaining relative motion estimates, unless
+  // relocalized: the drift accumulated in the increments is discarded.
+  if (relocalization_state_Pose_output_) {
+    W_Pose_B_lkf_from_increments_ =
+        relocalization_state_Pose_output_->inverse().compose(W_Pose_B_kf);
+    relocalization_state_Pose_output_.reset();
+  } else {
+    W_Pose_B_lkf_from_increments_ =
+        W_Pose_B_lkf_from_increments_.compose(B_lkf_Pose_kf);
+  }
 
   VLOG(1) << "Backend: Update IMU Bias.";
   CHECK(imu_bias_update_callback_) << "Did you forget to register the IMU bias "
@@ -1385,21 +1817,34 @@ bool VioBackend::updateSmoother(Smoother::Result* result,
                                 const gtsam::Values& new_values,
                                 const std::map<Key, double>& timestamps,
                                 const gtsam::FactorIndices& delete_slots) {
+  KIMERA_TRACE_SCOPE("VioBackend::updateSmoother");
+  KIMERA_PERF_SCOPE("VioBackend::updateSmoother");
   CHECK_NOTNULL(result);
-  // Store smoother as backup.
   CHECK(smoother_);
-  // This is not doing a full deep copy: it is keeping same shared_ptrs for
-  // factors but copying the isam result.
-  Smoother smoother_backup(*smoother_);
 
   bool got_cheirality_exception = false;
   gtsam::Symbol lmk_symbol_cheirality;
+  // Snapshot of the smoother before its update, to roll it back on failure
+  // (none if the update is not attempted).
+  std::optional<SmootherSnapshot> snapshot = std::nullopt;
   try {
-    // Update smoother.
-    VLOG(10) << "Starting update of smoother_...";
-    *result =
-        smoother_->update(new_factors, new_values, timestamps, delete_slots);
-    VLOG(10) << "Finished update of smoother_.";
+    if (FLAGS_process_cheirality &&
+        findCheiralityLmk(new_factors, new_values, &lmk_symbol_cheirality)) {
+      // Caught before the update: there is nothing to roll back.
+      LOG(ERROR) << "Cheirality of new factors of landmark "
+                 << lmk_symbol_cheirality.index();
+      got_cheirality_exception = true;
+    } else {
+      snapshot = getSmootherSnapshot();
+      if (backend_params_.parallelSmartFactorsTriangulation_) {
+        triangulateSmartFactors(new_factors, new_values);
+      }
+      // Update smoother.
+      VLOG(10) << "Starting update of smoother_...";
+      *result =
+          smoother_->update(new_factors, new_values, timestamps, delete_slots);
+      VLOG(10) << "Finished update of smoother_.";
+    }
     if (debug_smoother_) {
       printSmootherInfo(new_factors, delete_slots, "CATCHING EXCEPTION", false);
       debug_smoother_ = false;
@@ -1485,7 +1930,8 @@ bool VioBackend::updateSmoother(Smoother::Result* result,
     try {
       // Update smoother
       LOG(ERROR) << "Attempting to update smoother with added prior factors";
-      *smoother_ = smoother_backup;  // reset isam to backup
+      CHECK(snapshot);
+      restoreSmoother(*snapshot);  // reset isam to backup
       *result = smoother_->update(
           new_factors_mutable, new_values, timestamps, delete_slots);
     } catch (...) {
@@ -1569,7 +2015,7 @@ bool VioBackend::updateSmoother(Smoother::Result* result,
       counter_of_exceptions_++;
 
       // Restore smoother as it was before failure.
-      *smoother_ = smoother_backup;
+      if (snapshot) restoreSmoother(*snapshot);
 
       // Limit the number of cheirality exceptions per run.
       CHECK_LE(counter_of_exceptions_,
@@ -1635,6 +2081,181 @@ bool VioBackend::updateSmoother(Smoother::Result* result,
   return true;
 }
 
+/* -------------------------------------------------------------------------- */
+void VioBackend::triangulateSmartFactors(
+    const gtsam::NonlinearFactorGraph& new_factors,
+    const gtsam::Values& new_values) const {
+  std::vector<SmartStereoFactor*> smart_factors;
+  for (const auto& factor : new_factors) {
+    auto* smart_factor = dynamic_cast<SmartStereoFactor*>(factor.get());
+    if (smart_factor) smart_factors.push_back(smart_factor);
+  }
+  if (smart_factors.size() < 2u) return;
+
+  // New factors are linearized at the linearization point of the smoother,
+  // extended with the new values.
+  const gtsam::Values& linearization_point =
+      smoother_->getLinearizationPoint();
+  gtsam::Values poses;
+  for (const SmartStereoFactor* smart_factor : smart_factors) {
+    for (const Key& key : smart_factor->keys()) {
+      if (poses.exists(key)) continue;
+      if (new_values.exists(key)) {
+        poses.insert(key, new_values.at(key));
+      } else if (linearization_point.exists(key)) {
+        poses.insert(key, linearization_point.at(key));
+      }
+    }
+  }
+
+  // Each factor only writes to its own triangulation cache.
+  cv::parallel_for_(
+      cv::Range(0, static_cast<int>(smart_factors.size())),
+      [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; ++i) {
+          SmartStereoFactor* smart_factor = smart_factors[i];
+          const bool has_all_poses =
+              std::all_of(smart_factor->keys().begin(),
+                          smart_factor->keys().end(),
+                          [&poses](const Key& key) {
+                            return poses.exists(key);
+                          });
+          if (has_all_poses) {
+            smart_factor->triangulateSafe(smart_factor->cameras(poses));
+          }
+        }
+      });
+}
+
+/* -------------------------------------------------------------------------- */
+std::unique_ptr<Smoother> VioBackend::createSmoother() const {
+#ifdef INCREMENTAL_SMOOTHER
+  gtsam::ISAM2Params isam_param;
+  BackendParams::setIsam2Params(backend_params_, &isam_param);
+
+  return std::make_unique<Smoother>(getSmootherLag(), isam_param);
+#else  // BATCH SMOOTHER
+  gtsam::LevenbergMarquardtParams lmParams;
+  lmParams.setlambdaInitial(0.0);     // same as GN
+  lmParams.setlambdaLowerBound(0.0);  // same as GN
+  lmParams.setlambdaUpperBound(0.0);  // same as GN)
+  return std::make_unique<Smoother>(getSmootherLag(), lmParams);
+#endif
+}
+
+/* -------------------------------------------------------------------------- */
+double VioBackend::getSmootherLag() const {
+  return horizon_controller_ ? horizon_controller_->getNrStates()
+                             : backend_params_.nr_states_;
+}
+
+/* -------------------------------------------------------------------------- */
+VioBackend::SmootherSnapshot VioBackend::getSmootherSnapshot() const {
+  CHECK(smoother_);
+  return SmootherSnapshot{smoother_->getFactors(),
+                          smoother_->getLinearizationPoint(),
+                          smoother_->timestamps(),
+                          smoother_->smootherLag()};
+}
+
+/* -------------------------------------------------------------------------- */
+void VioBackend::restoreSmoother(const SmootherSnapshot& snapshot) {
+  // The marginalized keys are not in the snapshot anymore, and the latest
+  // timestamp and the lag are the same: this update does not marginalize
+  // anything. A shorter current lag would, appending the marginal factors.
+  VLOG(10) << "Starting to restore smoother_...";
+  smoother_ = createSmoother();
+  smoother_->smootherLag() = snapshot.lag;
+  smoother_->update(
+      snapshot.factors, snapshot.linearization_point, snapshot.timestamps);
+  CHECK_EQ(smoother_->getFactors().size(), snapshot.factors.size());
+  smoother_->smootherLag() = getSmootherLag();
+  VLOG(10) << "Finished to restore smoother_.";
+}
+
+/* -------------------------------------------------------------------------- */
+std::vector<Slot> VioBackend::compactSmootherFactors() {
+  KIMERA_TRACE_SCOPE("VioBackend::compactSmootherFactors");
+  SmootherSnapshot snapshot = getSmootherSnapshot();
+  const gtsam::NonlinearFactorGraph& factors = snapshot.factors;
+  std::vector<Slot> new_slots(factors.size(), -1);
+  gtsam::NonlinearFactorGraph live_factors;
+  live_factors.reserve(factors.nrFactors());
+  for (size_t slot = 0u; slot < factors.size(); ++slot) {
+    if (factors[slot]) {
+      new_slots[slot] = static_cast<Slot>(live_factors.size());
+      live_factors.push_back(factors[slot]);
+    }
+  }
+  VLOG(5) << "Compacting smoother factors: " << factors.size() << " slots, "
+          << live_factors.size() << " live factors.";
+  snapshot.factors = std::move(live_factors);
+  restoreSmoother(snapshot);
+
+  for (auto it = old_smart_factors_.begin(); it != old_smart_factors_.end();) {
+    Slot& slot = it->second.second;
+    if (slot == -1) {
+      // Not added to the smoother yet.
+      ++it;
+      continue;
+    }
+    DCHECK_GE(slot, 0);
+    DCHECK_LT(slot, static_cast<Slot>(new_slots.size()));
+    slot = new_slots[slot];
+    if (slot == -1) {
+      // Marginalized: same as in getMapLmkIdsTo3dPointsInTimeHorizon.
+      CHECK(deleteLmkFromFeatureTracks(it->first));
+      it = old_smart_factors_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  return new_slots;
+}
+
+/* -------------------------------------------------------------------------- */
+bool VioBackend::findCheiralityLmk(
+    const gtsam::NonlinearFactorGraph& new_factors,
+    const gtsam::Values& new_values,
+    gtsam::Symbol* lmk_symbol) const {
+  CHECK_NOTNULL(lmk_symbol);
+  const gtsam::Values& linearization_point =
+      smoother_->getLinearizationPoint();
+  for (const auto& factor : new_factors) {
+    if (!factor) continue;
+    const auto lmk_key_it =
+        std::find_if(factor->begin(), factor->end(), [](const Key& key) {
+          return gtsam::Symbol(key).chr() == kLandmarkSymbolChar;
+        });
+    if (lmk_key_it == factor->end()) continue;
+
+    // iSAM2 linearizes new factors at its linearization point.
+    gtsam::Values factor_values;
+    bool has_all_values = true;
+    for (const Key& key : *factor) {
+      if (new_values.exists(key)) {
+        factor_values.insert(key, new_values.at(key));
+      } else if (linearization_point.exists(key)) {
+        factor_values.insert(key, linearization_point.at(key));
+      } else {
+        has_all_values = false;
+        break;
+      }
+    }
+    if (!has_all_values) continue;
+    try {
+      factor->error(factor_values);
+    } catch (const gtsam::CheiralityException&) {
+      *lmk_symbol = gtsam::Symbol(*lmk_key_it);
+      return true;
+    } catch (const gtsam::StereoCheiralityException&) {
+      *lmk_symbol = gtsam::Symbol(*lmk_key_it);
+      return true;
+    }
+  }
+  return false;
+}
+
 /* -------------------------------------------------------------------------- */
 void VioBackend::cleanCheiralityLmk(
     const gtsam::Symbol& lmk_symbol,
@@ -1681,7 +2302,10 @@ void VioBackend::cleanCheiralityLmk(
   std::vector<size_t> slots_of_extra_factors_to_delete;
   // Achtung: This has the chance to make the plane underconstrained, if
   // we delete too many point_plane factors.
-  findSlotsOfFactorsWithKey(lmk_key, graph, &slots_of_extra_factors_to_delete);
+  findSlotsOfFactorsWithKey(lmk_key,
+                            graph,
+                            smoother_->getISAM2().getVariableIndex(),
+                            &slots_of_extra_factors_to_delete);
   delete_slots_cheirality->insert(delete_slots_cheirality->end(),
                                   slots_of_extra_factors_to_delete.begin(),
                                   slots_of_extra_factors_to_delete.end());
@@ -2059,15 +2683,17 @@ void VioBackend::printSelectedGraph(
 }
 
 /* -------------------------------------------------------------------------- */
-void VioBackend::computeSmartFactorStatistics() {
+void VioBackend::computeSmartFactorStatistics(
+    const gtsam::NonlinearFactorGraph& graph,
+    DebugVioInfo* debug_info) {
+  CHECK_NOTNULL(debug_info);
   // Compute number of valid/degenerate
-  debug_info_.resetSmartFactorsStatistics();
-  gtsam::NonlinearFactorGraph graph = smoother_->getFactors();
+  debug_info->resetSmartFactorsStatistics();
   for (const auto& g : graph) {
     if (g) {
       const auto gsf = dynamic_cast<const SmartStereoFactor*>(g.get());
       if (gsf) {
-        debug_info_.numSF_ += 1;
+        debug_info->numSF_ += 1;
 
         // Check for consecutive Keys: this check is wrong: if there is
         // LOW_DISPARITY at some frame, we do not add the measurement to the
@@ -2094,43 +2720,44 @@ void VioBackend::computeSmartFactorStatistics() {
         const gtsam::TriangulationResult& result = gsf->point();
         if (result) {
           if (result.valid()) {
-            debug_info_.numValid_ += 1;
+            debug_info->numValid_ += 1;
             // Check track length
             size_t trackLength = gsf->keys().size();
-            if (trackLength > debug_info_.maxTrackLength_) {
-              debug_info_.maxTrackLength_ = trackLength;
+            if (trackLength > debug_info->maxTrackLength_) {
+              debug_info->maxTrackLength_ = trackLength;
             }
-            debug_info_.meanTrackLength_ += trackLength;
+            debug_info->meanTrackLength_ += trackLength;
           }
         } else {
           VLOG(5) << "Triangulation result is not initialized...";
-          if (result.degenerate()) debug_info_.numDegenerate_ += 1;
-          if (result.farPoint()) debug_info_.numFarPoints_ += 1;
-          if (result.outlier()) debug_info_.numOutliers_ += 1;
-          if (result.behindCamera()) debug_info_.numCheirality_ += 1;
-          debug_info_.numNonInitialized_ += 1;
+          if (result.degenerate()) debug_info->numDegenerate_ += 1;
+          if (result.farPoint()) debug_info->numFarPoints_ += 1;
+          if (result.outlier()) debug_info->numOutliers_ += 1;
+          if (result.behindCamera()) debug_info->numCheirality_ += 1;
+          debug_info->numNonInitialized_ += 1;
         }
       }
     }
   }
-  if (debug_info_.numValid_ > 0) {
-    debug_info_.meanTrackLength_ = debug_info_.meanTrackLength_ /
-                                   static_cast<double>(debug_info_.numValid_);
+  if (debug_info->numValid_ > 0) {
+    debug_info->meanTrackLength_ = debug_info->meanTrackLength_ /
+                                   static_cast<double>(debug_info->numValid_);
   } else {
-    debug_info_.meanTrackLength_ = 0;
+    debug_info->meanTrackLength_ = 0;
   }
 }
 
-void VioBackend::computeSparsityStatistics() {
-  gtsam::NonlinearFactorGraph graph = smoother_->getFactors();
-  gtsam::GaussianFactorGraph::shared_ptr gfg = graph.linearize(state_);
-  gtsam::Matrix Hessian = gfg->hessian().first;
-  debug_info_.nrElementsInMatrix_ = Hessian.rows() * Hessian.cols();
-  debug_info_.nrZeroElementsInMatrix_ = 0;
+void VioBackend::computeSparsityStatistics(
+    const gtsam::GaussianFactorGraph& linearized_graph,
+    DebugVioInfo* debug_info) {
+  CHECK_NOTNULL(debug_info);
+  gtsam::Matrix Hessian = linearized_graph.hessian().first;
+  debug_info->nrElementsInMatrix_ = Hessian.rows() * Hessian.cols();
+  debug_info->nrZeroElementsInMatrix_ = 0;
   for (int i = 0; i < Hessian.rows(); ++i) {
     for (int j = 0; j < Hessian.cols(); ++j) {
       if (std::fabs(Hessian(i, j)) < 1e-15) {
-        debug_info_.nrZeroElementsInMatrix_ += 1;
+        debug_info->nrZeroElementsInMatrix_ += 1;
       }
     }
   }
@@ -2140,21 +2767,51 @@ void VioBackend::computeSparsityStatistics() {
 
   VLOG(10) << "Hessian stats: ===========\n"
            << "rows: " << Hessian.rows() << '\n'
-           << "nrElementsInMatrix_: " << debug_info_.nrElementsInMatrix_ << '\n'
+           << "nrElementsInMatrix_: " << debug_info->nrElementsInMatrix_ << '\n'
            << "nrZeroElementsInMatrix_: "
-           << debug_info_.nrZeroElementsInMatrix_;
+           << debug_info->nrZeroElementsInMatrix_;
 }
 
 // Debugging post optimization and estimate calculation.
 void VioBackend::postDebug(
     const std::chrono::high_resolution_clock::time_point& total_start_time,
     const std::chrono::high_resolution_clock::time_point& start_time) {
-  if (log_output_) {
-    computeSparsityStatistics();
-    computeSmartFactorStatistics();
+  // Graph statistics are only computed every debugStatsPeriod keyframes.
+  const bool is_debug_stats_sample =
+      backend_params_.debugStatsPeriod_ > 0 &&
+      curr_kf_id_ % backend_params_.debugStatsPeriod_ == 0;
+  if (log_output_ && is_debug_stats_sample) {
+    // Reads the triangulation results cached in the smart factors: cheap,
+    // but the factors are shared with the smoother, so not in the worker.
+    computeSmartFactorStatistics(smoother_->getFactors(), &debug_info_);
+
+    // Linearizing also updates the smart factors, the dense hessian of the
+    // linearized graph (a copy of its own) is what may run in the worker.
+    gtsam::GaussianFactorGraph::shared_ptr linearized_graph =
+        smoother_->getFactors().linearize(state_);
+    CHECK(linearized_graph);
+    if (debug_stats_worker_) {
+      {
+        // Statistics of the last sample the worker completed.
+        std::lock_guard<std::mutex> lock(debug_stats_mutex_);
+        debug_info_.nrElementsInMatrix_ = async_nr_elements_in_matrix_;
+        debug_info_.nrZeroElementsInMatrix_ =
+            async_nr_zero_elements_in_matrix_;
+      }
+      debug_stats_worker_->addJob([this, linearized_graph]() {
+        DebugVioInfo sparsity_info;
+        computeSparsityStatistics(*linearized_graph, &sparsity_info);
+        std::lock_guard<std::mutex> lock(debug_stats_mutex_);
+        async_nr_elements_in_matrix_ = sparsity_info.nrElementsInMatrix_;
+        async_nr_zero_elements_in_matrix_ =
+            sparsity_info.nrZeroElementsInMatrix_;
+      });
+    } else {
+      computeSparsityStatistics(*linearized_graph, &debug_info_);
+    }
   }
 
-  if (VLOG_IS_ON(10)) {
+  if (VLOG_IS_ON(10) && is_debug_stats_sample) {
     // Print old_smart_factors_
     LOG(INFO) << "Landmarks in old_smart_factors_: "
               << old_smart_factors_.size();
@@ -2282,33 +2939,31 @@ bool VioBackend::deleteKeyFromValues(const gtsam::Key& key,
   return false;
 }
 
-// Returns if the key in timestamps could be removed or not.
+// Uses the variable index instead of scanning the whole graph.
 void VioBackend::findSlotsOfFactorsWithKey(
     const gtsam::Key& key,
     const gtsam::NonlinearFactorGraph& graph,
+    const gtsam::VariableIndex& variable_index,
     std::vector<size_t>* slots_of_factors_with_key) {
   CHECK_NOTNULL(slots_of_factors_with_key);
   slots_of_factors_with_key->resize(0);
-  size_t slot = 0;
-  for (const auto& g : graph) {
-    if (g) {
-      // Found a valid factor.
-      if (g->find(key) != g->end()) {
-        // Whatever factor this is, it has our lmk...
-        // Sanity check, this lmk has no priors right?
-        CHECK(!dynamic_cast<const gtsam::LinearContainerFactor*>(g.get()));
-        CHECK(!dynamic_cast<const gtsam::PriorFactor<gtsam::Point3>*>(g.get()));
-        // Sanity check that we are not deleting a smart factor.
-        CHECK(!dynamic_cast<const SmartStereoFactor*>(g.get()));
-        // Delete it.
-        LOG(WARNING) << "Delete factor in graph at slot # " << slot
-                     << " corresponding to lmk with id: "
-                     << gtsam::Symbol(key).index();
-        CHECK(graph.exists(slot));
-        slots_of_factors_with_key->push_back(slot);
-      }
-    }
-    slot++;
+  const auto key_it = variable_index.find(key);
+  if (key_it == variable_index.end()) return;
+  for (const size_t& slot : key_it->second) {
+    CHECK(graph.exists(slot));
+    const auto& g = graph.at(slot);
+    DCHECK(g->find(key) != g->end());
+    // Whatever factor this is, it has our lmk...
+    // Sanity check, this lmk has no priors right?
+    CHECK(!dynamic_cast<const gtsam::LinearContainerFactor*>(g.get()));
+    CHECK(!dynamic_cast<const gtsam::PriorFactor<gtsam::Point3>*>(g.get()));
+    // Sanity check that we are not deleting a smart factor.
+    CHECK(!dynamic_cast<const SmartStereoFactor*>(g.get()));
+    // Delete it.
+    LOG(WARNING) << "Delete factor in graph at slot # " << slot
+                 << " corresponding to lmk with id: "
+                 << gtsam::Symbol(key).index();
+    slots_of_factors_with_key->push_back(slot);
   }
 }
 
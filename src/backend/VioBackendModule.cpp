@@ -15,20 +15,32 @@
 
 #include "kimera-vio/backend/VioBackendModule.h"
 
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
 namespace VIO {
 
-VioBackendModule::VioBackendModule(InputQueue* input_queue,
+VioBackendModule::VioBackendModule(InputQueueBase* input_queue,
                                    bool parallel_run,
                                    VioBackend::UniquePtr vio_backend)
     : SIMO(input_queue, "VioBackend", parallel_run),
-      vio_backend_(std::move(vio_backend)) {
+      vio_backend_(std::move(vio_backend)),
+      batch_size_stats_("VioBackend Batch Size [#]") {
   CHECK(vio_backend_);
+  // Heavy output fields are only filled once a subscriber requests them.
+  vio_backend_->setOutputFields(BackendOutputFields());
 }
 
 VioBackendModule::OutputUniquePtr VioBackendModule::spinOnce(
     BackendInput::UniquePtr input) {
   CHECK(input);
   CHECK(vio_backend_);
+  if (vio_backend_->getBackendParams().maxBatchedKeyframes_ > 1 &&
+      vio_backend_->isInitialized() &&
+      vio_backend_->supportsBatchedUpdates()) {
+    return spinOnceBatched(std::move(input));
+  }
   OutputUniquePtr output = vio_backend_->spinOnce(*input);
   if (!output) {
     LOG(ERROR) << "Backend did not return an output: shutting down Backend.";
@@ -37,6 +49,64 @@ VioBackendModule::OutputUniquePtr VioBackendModule::spinOnce(
   return output;
 }
 
+VioBackendModule::OutputUniquePtr VioBackendModule::spinOnceBatched(
+    BackendInput::UniquePtr input) {
+  std::vector<BackendInput::UniquePtr> inputs;
+  inputs.push_back(std::move(input));
+  // Take the keyframes that queued up while the Backend was busy.
+  InputQueueBase::InternalQueue queued_inputs;
+  if (input_queue_->batchPop(&queued_inputs)) {
+    while (!queued_inputs.empty()) {
+      CHECK(queued_inputs.front() && *queued_inputs.front());
+      inputs.push_back(std::move(*queued_inputs.front()));
+      queued_inputs.pop();
+      runInputCallbacks(*inputs.back());
+    }
+  }
+  batch_size_stats_.AddSample(static_cast<double>(inputs.size()));
+
+  const size_t max_batch_size = static_cast<size_t>(
+      vio_backend_->getBackendParams().maxBatchedKeyframes_);
+  OutputUniquePtr last_output = nullptr;
+  for (size_t begin = 0u; begin < inputs.size(); begin += max_batch_size) {
+    const size_t end = std::min(begin + max_batch_size, inputs.size());
+    std::vector<BackendInput::UniquePtr> batch(
+        std::make_move_iterator(inputs.begin() + begin),
+        std::make_move_iterator(inputs.begin() + end));
+    std::vector<OutputUniquePtr> outputs =
+        vio_backend_->spinOnceBatched(batch);
+    if (outputs.empty()) {
+      LOG(ERROR) << "Backend did not return an output: shutting down Backend.";
+      if (last_output) pushOutputPacket(std::move(last_output));
+      shutdown();
+      return nullptr;
+    }
+    CHECK_EQ(outputs.size(), batch.size());
+    // The spin loop pushes the last output.
+    if (last_output) pushOutputPacket(std::move(last_output));
+    for (size_t i = 0u; i + 1u < outputs.size(); ++i) {
+      pushOutputPacket(std::move(outputs[i]));
+    }
+    last_output = std::move(outputs.back());
+  }
+  return last_output;
+}
+
+void VioBackendModule::registerOutputCallback(
+    const OutputCallback& output_callback) {
+  registerOutputCallback(output_callback, BackendOutputFields());
+}
+
+void VioBackendModule::registerOutputCallback(
+    const OutputCallback& output_callback,
+    const BackendOutputFields& required_fields) {
+  CHECK(vio_backend_);
+  BackendOutputFields output_fields = vio_backend_->getOutputFields();
+  output_fields |= required_fields;
+  vio_backend_->setOutputFields(output_fields);
+  SIMO::registerOutputCallback(output_callback);
+}
+
 void VioBackendModule::registerImuBiasUpdateCallback(
     const VioBackend::ImuBiasCallback& imu_bias_update_callback) {
   CHECK(vio_backend_);
@@ -74,6 +74,15 @@ bool BackendParams::parseYAMLVioBackendParams(const YamlParser& yaml_parser) {
   yaml_parser.getYamlParam("initialVelocitySigma", &initialVelocitySigma_);
   yaml_parser.getYamlParam("initialAccBiasSigma", &initialAccBiasSigma_);
   yaml_parser.getYamlParam("initialGyroBiasSigma", &initialGyroBiasSigma_);
+  if (yaml_parser.hasParam("initialBAMaxIterations")) {
+    yaml_parser.getYamlParam("initialBAMaxIterations",
+                             &initialBAMaxIterations_);
+  }
+  CHECK_GE(initialBAMaxIterations_, 1);
+  if (yaml_parser.hasParam("initialBAMaxTimeSec")) {
+    yaml_parser.getYamlParam("initialBAMaxTimeSec", &initialBAMaxTimeSec_);
+  }
+  CHECK_GE(initialBAMaxTimeSec_, 0.0);
 
   // VISION PARAMS
   int linearization_mode_id;
@@ -118,6 +127,15 @@ bool BackendParams::parseYAMLVioBackendParams(const YamlParser& yaml_parser) {
   yaml_parser.getYamlParam("outlierRejection", &outlierRejection_);
   yaml_parser.getYamlParam("retriangulationThreshold",
                            &retriangulationThreshold_);
+  if (yaml_parser.hasParam("parallelSmartFactorsTriangulation")) {
+    yaml_parser.getYamlParam("parallelSmartFactorsTriangulation",
+                             &parallelSmartFactorsTriangulation_);
+  }
+  if (yaml_parser.hasParam("maxLandmarksPerKeyframe")) {
+    yaml_parser.getYamlParam("maxLandmarksPerKeyframe",
+                             &maxLandmarksPerKeyframe_);
+  }
+  CHECK_GE(maxLandmarksPerKeyframe_, 0);
   yaml_parser.getYamlParam("addBetweenStereoFactors",
                            &addBetweenStereoFactors_);
   yaml_parser.getYamlParam("betweenRotationPrecision",
@@ -134,6 +152,39 @@ bool BackendParams::parseYAMLVioBackendParams(const YamlParser& yaml_parser) {
   yaml_parser.getYamlParam("constant_vel_precision", &constant_vel_precision_);
   yaml_parser.getYamlParam("numOptimize", &numOptimize_);
   yaml_parser.getYamlParam("nr_states", &nr_states_);
+  if (yaml_parser.hasParam("adaptiveHorizon")) {
+    yaml_parser.getYamlParam("adaptiveHorizon", &adaptiveHorizon_);
+    yaml_parser.getYamlParam("targetLatencyMs", &targetLatencyMs_);
+    yaml_parser.getYamlParam("minNrStates", &minNrStates_);
+    yaml_parser.getYamlParam("maxNrStates", &maxNrStates_);
+  }
+  if (yaml_parser.hasParam("maxBatchedKeyframes")) {
+    yaml_parser.getYamlParam("maxBatchedKeyframes", &maxBatchedKeyframes_);
+  }
+  CHECK_GE(maxBatchedKeyframes_, 1);
+  // The keyframes of a batch must all fit in the horizon.
+  CHECK_LT(maxBatchedKeyframes_, nr_states_);
+  if (yaml_parser.hasParam("slidingWindowSize")) {
+    yaml_parser.getYamlParam("slidingWindowSize", &slidingWindowSize_);
+  }
+  CHECK_GE(slidingWindowSize_, 2);
+  if (yaml_parser.hasParam("debugStatsPeriod")) {
+    yaml_parser.getYamlParam("debugStatsPeriod", &debugStatsPeriod_);
+  }
+  CHECK_GE(debugStatsPeriod_, 0);
+  if (yaml_parser.hasParam("asyncDebugStats")) {
+    yaml_parser.getYamlParam("asyncDebugStats", &asyncDebugStats_);
+  }
+  if (yaml_parser.hasParam("factorSlotCompactionPeriod")) {
+    yaml_parser.getYamlParam("factorSlotCompactionPeriod",
+                             &factorSlotCompactionPeriod_);
+  }
+  if (yaml_parser.hasParam("minEmptySlotsRatio")) {
+    yaml_parser.getYamlParam("minEmptySlotsRatio", &minEmptySlotsRatio_);
+  }
+  CHECK_GE(factorSlotCompactionPeriod_, 0);
+  CHECK_GE(minEmptySlotsRatio_, 0.0);
+  CHECK_LE(minEmptySlotsRatio_, 1.0);
   yaml_parser.getYamlParam("wildfire_threshold", &wildfire_threshold_);
   yaml_parser.getYamlParam("useDogLeg", &useDogLeg_);
 
@@ -185,6 +236,8 @@ bool BackendParams::equalsVioBackendParams(const BackendParams& vp2,
       (fabs(initialVelocitySigma_ - vp2.initialVelocitySigma_) <= tol) &&
       (fabs(initialAccBiasSigma_ - vp2.initialAccBiasSigma_) <= tol) &&
       (fabs(initialGyroBiasSigma_ - vp2.initialGyroBiasSigma_) <= tol) &&
+      (initialBAMaxIterations_ == vp2.initialBAMaxIterations_) &&
+      (fabs(initialBAMaxTimeSec_ - vp2.initialBAMaxTimeSec_) <= tol) &&
       // VISION PARAMS
       (linearizationMode_ == vp2.linearizationMode_) &&
       (degeneracyMode_ == vp2.degeneracyMode_) &&
@@ -195,6 +248,9 @@ bool BackendParams::equalsVioBackendParams(const BackendParams& vp2,
       (fabs(outlierRejection_ - vp2.outlierRejection_) <= tol) &&
       (fabs(retriangulationThreshold_ - vp2.retriangulationThreshold_) <=
        tol) &&
+      (parallelSmartFactorsTriangulation_ ==
+       vp2.parallelSmartFactorsTriangulation_) &&
+      (maxLandmarksPerKeyframe_ == vp2.maxLandmarksPerKeyframe_) &&
       (addBetweenStereoFactors_ == vp2.addBetweenStereoFactors_) &&
       (fabs(betweenRotationPrecision_ - vp2.betweenRotationPrecision_) <=
        tol) &&
@@ -210,6 +266,16 @@ bool BackendParams::equalsVioBackendParams(const BackendParams& vp2,
       (numOptimize_ == vp2.numOptimize_) && (nr_states_ == vp2.nr_states_) &&
       (wildfire_threshold_ == vp2.wildfire_threshold_) &&
       (useDogLeg_ == vp2.useDogLeg_) &&
+      (adaptiveHorizon_ == vp2.adaptiveHorizon_) &&
+      (fabs(targetLatencyMs_ - vp2.targetLatencyMs_) <= tol) &&
+      (fabs(minNrStates_ - vp2.minNrStates_) <= tol) &&
+      (fabs(maxNrStates_ - vp2.maxNrStates_) <= tol) &&
+      (maxBatchedKeyframes_ == vp2.maxBatchedKeyframes_) &&
+      (slidingWindowSize_ == vp2.slidingWindowSize_) &&
+      (debugStatsPeriod_ == vp2.debugStatsPeriod_) &&
+      (asyncDebugStats_ == vp2.asyncDebugStats_) &&
+      (factorSlotCompactionPeriod_ == vp2.factorSlotCompactionPeriod_) &&
+      (fabs(minEmptySlotsRatio_ - vp2.minEmptySlotsRatio_) <= tol) &&
       (pose_guess_source_ == vp2.pose_guess_source_) &&
       (fabs(mono_translation_scale_factor_ ==
             vp2.mono_translation_scale_factor_));
@@ -240,6 +306,10 @@ void BackendParams::printVioBackendParams() const {
       initialAccBiasSigma_,
       "Initial Gyro Bias Sigma",
       initialGyroBiasSigma_,
+      "Initial BA Max Iterations",
+      initialBAMaxIterations_,
+      "Initial BA Max Time [s]",
+      initialBAMaxTimeSec_,
       std::string(kCenter, '.') + "** Vision parameters **",
       "",
       "Linearization Mode: hessian, implicit_schur, jacobian_q, jacobian_svd",
@@ -254,6 +324,10 @@ void BackendParams::printVioBackendParams() const {
       outlierRejection_,
       "Retriangulation Threshold",
       retriangulationThreshold_,
+      "Parallel Smart Factors Triangulation",
+      parallelSmartFactorsTriangulation_,
+      "Max Landmarks Per Keyframe",
+      maxLandmarksPerKeyframe_,
       "Add Btw Stereo Factors",
       addBetweenStereoFactors_,
       "Btw Rotation Precision",
@@ -282,6 +356,26 @@ void BackendParams::printVioBackendParams() const {
       wildfire_threshold_,
       "Use Dog Leg",
       useDogLeg_,
+      "Adaptive Horizon",
+      adaptiveHorizon_,
+      "Target Latency [ms]",
+      targetLatencyMs_,
+      "Min nr_states",
+      minNrStates_,
+      "Max nr_states",
+      maxNrStates_,
+      "Max Batched Keyframes",
+      maxBatchedKeyframes_,
+      "Sliding Window Size",
+      slidingWindowSize_,
+      "Debug Stats Period",
+      debugStatsPeriod_,
+      "Async Debug Stats",
+      asyncDebugStats_,
+      "Factor Slot Compaction Period",
+      factorSlotCompactionPeriod_,
+      "Min Empty Slots Ratio",
+      minEmptySlotsRatio_,
       "Pose Guess Source",
       VIO::to_underlying(pose_guess_source_),
       "Mono Translation Scale Factor",
@@ -0,0 +1,123 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   PoseHistory.cpp
+ * @brief  Thread-safe history of the estimated poses, interpolated at any
+ * timestamp.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/common/PoseHistory.h"
+
+#include <algorithm>
+#include <mutex>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+PoseHistory::PoseHistory() : mutex_(), poses_(), Map_Pose_Odom_() {}
+
+void PoseHistory::addPose(const Timestamp& timestamp,
+                          const gtsam::Pose3& W_Pose_B) {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  if (poses_.empty() || poses_.back().timestamp_ < timestamp) {
+    poses_.push_back({timestamp, W_Pose_B});
+    return;
+  }
+  const auto it = std::lower_bound(
+      poses_.begin(),
+      poses_.end(),
+      timestamp,
+      [](const StampedPose& pose, const Timestamp& timestamp) {
+        return pose.timestamp_ < timestamp;
+      });
+  if (it != poses_.end() && it->timestamp_ == timestamp) {
+    it->W_Pose_B_ = W_Pose_B;
+  } else {
+    poses_.insert(it, {timestamp, W_Pose_B});
+  }
+}
+
+void PoseHistory::setCorrection(const gtsam::Pose3& Map_Pose_Odom) {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  Map_Pose_Odom_ = Map_Pose_Odom;
+}
+
+gtsam::Pose3 PoseHistory::getCorrection() const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  return Map_Pose_Odom_;
+}
+
+bool PoseHistory::getPoseAtTime(const Timestamp& timestamp,
+                                gtsam::Pose3* pose,
+                                const bool& corrected) const {
+  CHECK_NOTNULL(pose);
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  if (poses_.empty() || timestamp < poses_.front().timestamp_ ||
+      timestamp > poses_.back().timestamp_) {
+    return false;
+  }
+  // First pose at or after the timestamp.
+  const auto after = std::lower_bound(
+      poses_.begin(),
+      poses_.end(),
+      timestamp,
+      [](const StampedPose& pose, const Timestamp& timestamp) {
+        return pose.timestamp_ < timestamp;
+      });
+  CHECK(after != poses_.end());
+  if (after->timestamp_ == timestamp) {
+    *pose = correct(after->W_Pose_B_, corrected);
+    return true;
+  }
+  CHECK(after != poses_.begin());
+  const auto before = after - 1;
+  const double alpha =
+      static_cast<double>(timestamp - before->timestamp_) /
+      static_cast<double>(after->timestamp_ - before->timestamp_);
+  *pose = correct(before->W_Pose_B_.interpolateRt(after->W_Pose_B_, alpha),
+                  corrected);
+  return true;
+}
+
+bool PoseHistory::getLatestPose(Timestamp* timestamp,
+                                gtsam::Pose3* pose,
+                                const bool& corrected) const {
+  CHECK_NOTNULL(timestamp);
+  CHECK_NOTNULL(pose);
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  if (poses_.empty()) return false;
+  *timestamp = poses_.back().timestamp_;
+  *pose = correct(poses_.back().W_Pose_B_, corrected);
+  return true;
+}
+
+size_t PoseHistory::size() const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  return poses_.size();
+}
+
+bool PoseHistory::empty() const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  return poses_.empty();
+}
+
+void PoseHistory::clear() {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  poses_.clear();
+  Map_Pose_Odom_ = gtsam::Pose3();
+}
+
+gtsam::Pose3 PoseHistory::correct(const gtsam::Pose3& W_Pose_B,
+                                  const bool& corrected) const {
+  return corrected ? Map_Pose_Odom_ * W_Pose_B : W_Pose_B;
+}
+
+}  // namespace VIO
@@ -0,0 +1,164 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   BinaryDataProvider.cpp
+ * @brief  Replays a binary dataset container (see BinaryDataset.h).
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/dataprovider/BinaryDataProvider.h"
+
+#include <algorithm>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "kimera-vio/frontend/Frame.h"
+
+DEFINE_string(binary_dataset_path,
+              "",
+              "Path of the binary dataset to replay (see "
+              "convertDatasetToBinary).");
+DECLARE_int64(initial_k);
+DECLARE_int64(final_k);
+
+namespace VIO {
+
+/* -------------------------------------------------------------------------- */
+BinaryDataProvider::BinaryDataProvider(const std::string& dataset_filename,
+                                       const int& initial_k,
+                                       const int& final_k,
+                                       const VioParams& vio_params)
+    : DataProviderInterface(),
+      gt_data_(),
+      vio_params_(vio_params),
+      reader_(dataset_filename),
+      current_k_(0u),
+      final_k_(0u) {
+  CHECK_GE(initial_k, 0);
+  CHECK_GT(final_k, initial_k) << "Value for final_k (" << final_k
+                               << ") is smaller than value for"
+                               << " initial_k (" << initial_k << ").";
+  CHECK_GE(vio_params_.camera_params_.size(), reader_.getNrCameras());
+  current_k_ = static_cast<size_t>(initial_k);
+  final_k_ = std::min(static_cast<size_t>(final_k), reader_.getNrFrames());
+
+  for (size_t i = 0u; i < reader_.getNrGroundTruthStates(); ++i) {
+    Timestamp timestamp;
+    VioNavState gt_state;
+    reader_.getGroundTruthState(i, &timestamp, &gt_state);
+    gt_data_.map_to_gt_[timestamp] = gt_state;
+  }
+
+  LOG(INFO) << "Binary dataset " << dataset_filename << ": "
+            << reader_.getNrFrames() << " frames ("
+            << reader_.getNrCameras() << " cameras), "
+            << reader_.getNrImuMeasurements() << " IMU measurements, "
+            << reader_.getNrExternalOdomMeasurements()
+            << " external odometry measurements, "
+            << reader_.getNrGroundTruthStates() << " ground-truth states.";
+}
+
+/* -------------------------------------------------------------------------- */
+BinaryDataProvider::BinaryDataProvider(const VioParams& vio_params)
+    : BinaryDataProvider(FLAGS_binary_dataset_path,
+                         FLAGS_initial_k,
+                         FLAGS_final_k,
+                         vio_params) {}
+
+/* -------------------------------------------------------------------------- */
+bool BinaryDataProvider::spin() {
+  if (!is_imu_data_sent_) {
+    // First, send all the IMU data. The flag is to avoid sending it several
+    // times if we are running in sequential mode.
+    if (imu_single_callback_) {
+      sendImuData();
+    } else {
+      LOG(ERROR) << "Imu callback not registered! Not sending IMU data.";
+    }
+    if (external_odom_callback_) {
+      sendExternalOdomData();
+    } else {
+      LOG_IF(WARNING, reader_.getNrExternalOdomMeasurements() > 0u)
+          << "External odometry callback not registered! Not sending "
+             "external odometry data.";
+    }
+    is_imu_data_sent_ = true;
+  }
+
+  while (!shutdown_ && spinOnce()) {
+    if (!vio_params_.parallel_run_) {
+      // Return, instead of blocking, when running in sequential mode.
+      return true;
+    }
+  }
+  LOG_IF(INFO, shutdown_) << "BinaryDataProvider shutdown requested.";
+  return false;
+}
+
+bool BinaryDataProvider::hasData() const { return current_k_ < final_k_; }
+
+/* -------------------------------------------------------------------------- */
+bool BinaryDataProvider::spinOnce() {
+  if (current_k_ >= final_k_) {
+    LOG(INFO) << "Finished spinning binary dataset.";
+    return false;
+  }
+
+  const BinaryFrameRecord& record = reader_.getFrameRecord(current_k_);
+  VLOG(10) << "Sending frame k= " << record.frame_id
+           << " with timestamp: " << record.timestamp;
+  CHECK(left_frame_callback_);
+  left_frame_callback_(std::make_unique<Frame>(record.frame_id,
+                                               record.timestamp,
+                                               vio_params_.camera_params_.at(0),
+                                               getImage(0u)));
+  if (reader_.getNrCameras() > 1u) {
+    CHECK(right_frame_callback_);
+    right_frame_callback_(
+        std::make_unique<Frame>(record.frame_id,
+                                record.timestamp,
+                                vio_params_.camera_params_.at(1),
+                                getImage(1u)));
+  }
+
+  current_k_++;
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+void BinaryDataProvider::sendImuData() const {
+  CHECK(imu_single_callback_) << "Did you forget to register the IMU callback?";
+  for (size_t i = 0u; i < reader_.getNrImuMeasurements(); ++i) {
+    imu_single_callback_(reader_.getImuMeasurement(i));
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void BinaryDataProvider::sendExternalOdomData() const {
+  CHECK(external_odom_callback_);
+  for (size_t i = 0u; i < reader_.getNrExternalOdomMeasurements(); ++i) {
+    external_odom_callback_(reader_.getExternalOdomMeasurement(i));
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+cv::Mat BinaryDataProvider::getImage(const size_t& cam_idx) const {
+  cv::Mat img = reader_.getImage(current_k_, cam_idx);
+  if (vio_params_.frontend_params_.stereo_matching_params_.equalize_image_) {
+    cv::Mat equalized_img;
+    cv::equalizeHist(img, equalized_img);
+    return equalized_img;
+  }
+  return img;
+}
+
+}  // namespace VIO
@@ -0,0 +1,315 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   BinaryDataset.cpp
+ * @brief  Compact binary container for datasets (IMU, ground-truth and
+ * pre-decoded grayscale frames), with a writer and a memory-mapped reader.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/dataprovider/BinaryDataset.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <glog/logging.h>
+
+#include "kimera-vio/utils/MappedFile.h"
+
+namespace VIO {
+
+/* -------------------------------------------------------------------------- */
+BinaryDatasetWriter::BinaryDatasetWriter(const std::string& filename,
+                                         const size_t& nr_cameras)
+    : file_(filename, std::ios::out | std::ios::binary | std::ios::trunc),
+      nr_cameras_(nr_cameras),
+      offset_(0u),
+      closed_(false),
+      imu_records_(),
+      gt_records_(),
+      frame_records_(),
+      odom_records_() {
+  CHECK(file_.is_open()) << "Could not open for writing: " << filename;
+  CHECK_GT(nr_cameras_, 0u);
+  CHECK_LE(nr_cameras_, kBinaryDatasetMaxCameras);
+  // Placeholder header, rewritten at close().
+  BinaryDatasetHeader header;
+  std::memset(&header, 0, sizeof(header));
+  write(&header, sizeof(header));
+  align();
+}
+
+BinaryDatasetWriter::~BinaryDatasetWriter() {
+  if (!closed_) close();
+}
+
+void BinaryDatasetWriter::addImuMeasurement(
+    const ImuMeasurement& imu_measurement) {
+  CHECK(!closed_);
+  CHECK(imu_records_.empty() ||
+        imu_measurement.timestamp_ > imu_records_.back().timestamp)
+      << "IMU measurements must be added in chronological order.";
+  BinaryImuRecord record;
+  record.timestamp = imu_measurement.timestamp_;
+  for (size_t i = 0u; i < 6u; ++i) {
+    record.acc_gyr[i] = imu_measurement.acc_gyr_(i);
+  }
+  imu_records_.push_back(record);
+}
+
+void BinaryDatasetWriter::addGroundTruthState(const Timestamp& timestamp,
+                                              const VioNavState& gt_state) {
+  CHECK(!closed_);
+  CHECK(gt_records_.empty() || timestamp > gt_records_.back().timestamp)
+      << "Ground-truth states must be added in chronological order.";
+  BinaryGtRecord record;
+  record.timestamp = timestamp;
+  const gtsam::Point3& position = gt_state.pose_.translation();
+  const gtsam::Quaternion quaternion = gt_state.pose_.rotation().toQuaternion();
+  const gtsam::Vector3& acc_bias = gt_state.imu_bias_.accelerometer();
+  const gtsam::Vector3& gyro_bias = gt_state.imu_bias_.gyroscope();
+  for (size_t i = 0u; i < 3u; ++i) {
+    record.position[i] = position(i);
+    record.velocity[i] = gt_state.velocity_(i);
+    record.acc_bias[i] = acc_bias(i);
+    record.gyro_bias[i] = gyro_bias(i);
+  }
+  record.quaternion[0] = quaternion.w();
+  record.quaternion[1] = quaternion.x();
+  record.quaternion[2] = quaternion.y();
+  record.quaternion[3] = quaternion.z();
+  gt_records_.push_back(record);
+}
+
+void BinaryDatasetWriter::addExternalOdomMeasurement(
+    const ExternalOdomMeasurement& odom) {
+  CHECK(!closed_);
+  CHECK(odom_records_.empty() ||
+        odom.timestamp_ > odom_records_.back().timestamp)
+      << "External odometry must be added in chronological order.";
+  BinaryOdomRecord record;
+  record.timestamp = odom.timestamp_;
+  const gtsam::Point3& position = odom.odom_data_.position();
+  const gtsam::Quaternion quaternion =
+      odom.odom_data_.attitude().toQuaternion();
+  const gtsam::Vector3& velocity = odom.odom_data_.velocity();
+  for (size_t i = 0u; i < 3u; ++i) {
+    record.position[i] = position(i);
+    record.velocity[i] = velocity(i);
+  }
+  record.quaternion[0] = quaternion.w();
+  record.quaternion[1] = quaternion.x();
+  record.quaternion[2] = quaternion.y();
+  record.quaternion[3] = quaternion.z();
+  odom_records_.push_back(record);
+}
+
+void BinaryDatasetWriter::addFrame(const FrameId& frame_id,
+                                   const Timestamp& timestamp,
+                                   const std::vector<cv::Mat>& images) {
+  CHECK(!closed_);
+  CHECK_EQ(images.size(), nr_cameras_);
+  CHECK(frame_records_.empty() || timestamp > frame_records_.back().timestamp)
+      << "Frames must be added in chronological order.";
+  BinaryFrameRecord record;
+  std::memset(&record, 0, sizeof(record));
+  record.frame_id = frame_id;
+  record.timestamp = timestamp;
+  for (size_t cam_idx = 0u; cam_idx < nr_cameras_; ++cam_idx) {
+    const cv::Mat& img = images[cam_idx];
+    CHECK(!img.empty());
+    CHECK_EQ(img.type(), CV_8UC1) << "Only grayscale images are supported.";
+    BinaryImageRecord& image_record = record.images[cam_idx];
+    image_record.offset = offset_;
+    image_record.rows = static_cast<uint32_t>(img.rows);
+    image_record.cols = static_cast<uint32_t>(img.cols);
+    image_record.step = static_cast<uint32_t>(img.cols * img.elemSize());
+    image_record.type = img.type();
+    for (int r = 0; r < img.rows; ++r) {
+      write(img.ptr(r), image_record.step);
+    }
+    align();
+  }
+  frame_records_.push_back(record);
+}
+
+void BinaryDatasetWriter::close() {
+  CHECK(!closed_);
+  BinaryDatasetHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kBinaryDatasetMagic, sizeof(header.magic));
+  header.version = kBinaryDatasetVersion;
+  header.nr_cameras = static_cast<uint32_t>(nr_cameras_);
+
+  header.nr_imu_measurements = imu_records_.size();
+  header.imu_offset = offset_;
+  write(imu_records_.data(), imu_records_.size() * sizeof(BinaryImuRecord));
+  align();
+
+  header.nr_gt_states = gt_records_.size();
+  header.gt_offset = offset_;
+  write(gt_records_.data(), gt_records_.size() * sizeof(BinaryGtRecord));
+  align();
+
+  header.nr_frames = frame_records_.size();
+  header.frame_index_offset = offset_;
+  write(frame_records_.data(),
+        frame_records_.size() * sizeof(BinaryFrameRecord));
+  align();
+
+  header.nr_odom_measurements = odom_records_.size();
+  header.odom_offset = offset_;
+  write(odom_records_.data(),
+        odom_records_.size() * sizeof(BinaryOdomRecord));
+  header.file_size = offset_;
+
+  file_.seekp(0);
+  file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file_.close();
+  CHECK(!file_.fail()) << "Failed to write binary dataset.";
+  closed_ = true;
+}
+
+void BinaryDatasetWriter::write(const void* data, const size_t& size) {
+  if (size == 0u) return;
+  file_.write(static_cast<const char*>(data), size);
+  CHECK(!file_.fail()) << "Failed to write binary dataset.";
+  offset_ += size;
+}
+
+void BinaryDatasetWriter::align() {
+  static const char kZeros[kBinaryDatasetAlignment] = {0};
+  const size_t remainder = offset_ % kBinaryDatasetAlignment;
+  if (remainder != 0u) write(kZeros, kBinaryDatasetAlignment - remainder);
+}
+
+/* -------------------------------------------------------------------------- */
+BinaryDatasetReader::BinaryDatasetReader(const std::string& filename)
+    : mapped_file_(std::make_shared<const MappedFile>(filename)),
+      header_(nullptr),
+      imu_records_(nullptr),
+      gt_records_(nullptr),
+      frame_records_(nullptr),
+      odom_records_(nullptr) {
+  const uchar* data = mapped_file_->data();
+  const size_t size = mapped_file_->size();
+  CHECK_GE(size, sizeof(BinaryDatasetHeader))
+      << "Binary dataset too small: " << filename;
+  header_ = reinterpret_cast<const BinaryDatasetHeader*>(data);
+  CHECK_EQ(std::memcmp(header_->magic,
+                       kBinaryDatasetMagic,
+                       sizeof(kBinaryDatasetMagic)),
+           0)
+      << "Not a binary dataset: " << filename;
+  CHECK_GE(header_->version, 1u);
+  CHECK_LE(header_->version, kBinaryDatasetVersion)
+      << "Unsupported binary dataset version: " << filename;
+  CHECK_EQ(header_->file_size, size) << "Truncated binary dataset: " << filename;
+  CHECK_GT(header_->nr_cameras, 0u);
+  CHECK_LE(header_->nr_cameras, kBinaryDatasetMaxCameras);
+
+  CHECK_LE(header_->imu_offset +
+               header_->nr_imu_measurements * sizeof(BinaryImuRecord),
+           size);
+  CHECK_LE(header_->gt_offset + header_->nr_gt_states * sizeof(BinaryGtRecord),
+           size);
+  CHECK_LE(header_->frame_index_offset +
+               header_->nr_frames * sizeof(BinaryFrameRecord),
+           size);
+  imu_records_ =
+      reinterpret_cast<const BinaryImuRecord*>(data + header_->imu_offset);
+  gt_records_ =
+      reinterpret_cast<const BinaryGtRecord*>(data + header_->gt_offset);
+  CHECK_LE(header_->odom_offset +
+               header_->nr_odom_measurements * sizeof(BinaryOdomRecord),
+           size);
+  frame_records_ = reinterpret_cast<const BinaryFrameRecord*>(
+      data + header_->frame_index_offset);
+  odom_records_ =
+      reinterpret_cast<const BinaryOdomRecord*>(data + header_->odom_offset);
+
+  for (size_t i = 0u; i < header_->nr_frames; ++i) {
+    for (size_t cam_idx = 0u; cam_idx < header_->nr_cameras; ++cam_idx) {
+      const BinaryImageRecord& record = frame_records_[i].images[cam_idx];
+      CHECK_EQ(record.type, CV_8UC1);
+      CHECK_LE(record.offset + static_cast<uint64_t>(record.step) * record.rows,
+               size)
+          << "Image out of bounds in binary dataset: " << filename;
+    }
+  }
+}
+
+BinaryDatasetReader::~BinaryDatasetReader() = default;
+
+ImuMeasurement BinaryDatasetReader::getImuMeasurement(const size_t& i) const {
+  CHECK_LT(i, getNrImuMeasurements());
+  const BinaryImuRecord& record = imu_records_[i];
+  ImuAccGyr acc_gyr;
+  for (size_t j = 0u; j < 6u; ++j) acc_gyr(j) = record.acc_gyr[j];
+  return ImuMeasurement(record.timestamp, acc_gyr);
+}
+
+void BinaryDatasetReader::getGroundTruthState(const size_t& i,
+                                              Timestamp* timestamp,
+                                              VioNavState* gt_state) const {
+  CHECK_NOTNULL(timestamp);
+  CHECK_NOTNULL(gt_state);
+  CHECK_LT(i, getNrGroundTruthStates());
+  const BinaryGtRecord& record = gt_records_[i];
+  *timestamp = record.timestamp;
+  gt_state->pose_ = gtsam::Pose3(
+      gtsam::Rot3::Quaternion(record.quaternion[0],
+                              record.quaternion[1],
+                              record.quaternion[2],
+                              record.quaternion[3]),
+      gtsam::Point3(record.position[0], record.position[1], record.position[2]));
+  gt_state->velocity_ =
+      gtsam::Vector3(record.velocity[0], record.velocity[1], record.velocity[2]);
+  gt_state->imu_bias_ = gtsam::imuBias::ConstantBias(
+      gtsam::Vector3(record.acc_bias[0], record.acc_bias[1], record.acc_bias[2]),
+      gtsam::Vector3(
+          record.gyro_bias[0], record.gyro_bias[1], record.gyro_bias[2]));
+}
+
+ExternalOdomMeasurement BinaryDatasetReader::getExternalOdomMeasurement(
+    const size_t& i) const {
+  CHECK_LT(i, getNrExternalOdomMeasurements());
+  const BinaryOdomRecord& record = odom_records_[i];
+  return ExternalOdomMeasurement(
+      record.timestamp,
+      gtsam::NavState(
+          gtsam::Rot3::Quaternion(record.quaternion[0],
+                                  record.quaternion[1],
+                                  record.quaternion[2],
+                                  record.quaternion[3]),
+          gtsam::Point3(
+              record.position[0], record.position[1], record.position[2]),
+          gtsam::Vector3(
+              record.velocity[0], record.velocity[1], record.velocity[2])));
+}
+
+const BinaryFrameRecord& BinaryDatasetReader::getFrameRecord(
+    const size_t& i) const {
+  CHECK_LT(i, getNrFrames());
+  return frame_records_[i];
+}
+
+cv::Mat BinaryDatasetReader::getImage(const size_t& i,
+                                      const size_t& cam_idx) const {
+  CHECK_LT(cam_idx, getNrCameras());
+  const BinaryImageRecord& record = getFrameRecord(i).images[cam_idx];
+  return wrapMappedFile(mapped_file_,
+                        record.offset,
+                        static_cast<int>(record.rows),
+                        static_cast<int>(record.cols),
+                        record.type,
+                        static_cast<size_t>(record.step));
+}
+
+}  // namespace VIO
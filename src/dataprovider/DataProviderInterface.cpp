@@ -14,6 +14,8 @@
 
 #include "kimera-vio/dataprovider/DataProviderInterface.h"
 
+#include <utility>
+
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
@@ -67,6 +69,52 @@ bool DataProviderInterface::hasData() const {
   return false;
 }
 
+void DataProviderInterface::attachRecorder(
+    const SensorRecorder::Ptr& recorder) {
+  CHECK(recorder);
+  if (imu_single_callback_) {
+    imu_single_callback_ = [recorder, callback = imu_single_callback_](
+                               const ImuMeasurement& imu_measurement) {
+      recorder->recordImu(imu_measurement);
+      callback(imu_measurement);
+    };
+  }
+  if (imu_multi_callback_) {
+    imu_multi_callback_ = [recorder, callback = imu_multi_callback_](
+                              const ImuMeasurements& imu_measurements) {
+      for (int i = 0; i < imu_measurements.timestamps_.cols(); ++i) {
+        recorder->recordImu(
+            ImuMeasurement(imu_measurements.timestamps_(i),
+                           imu_measurements.acc_gyr_.col(i)));
+      }
+      callback(imu_measurements);
+    };
+  }
+  if (left_frame_callback_) {
+    left_frame_callback_ = [recorder, callback = left_frame_callback_](
+                               Frame::UniquePtr frame) {
+      recorder->recordFrame(0u, *frame);
+      callback(std::move(frame));
+    };
+  }
+  if (right_frame_callback_) {
+    right_frame_callback_ = [recorder, callback = right_frame_callback_](
+                                Frame::UniquePtr frame) {
+      recorder->recordFrame(1u, *frame);
+      callback(std::move(frame));
+    };
+  }
+  if (external_odom_callback_) {
+    external_odom_callback_ = [recorder, callback = external_odom_callback_](
+                                  const ExternalOdomMeasurement& odom) {
+      recorder->recordExternalOdom(odom);
+      callback(odom);
+    };
+  }
+  LOG_IF(WARNING, depth_frame_callback_)
+      << "Depth frames are not recorded.";
+}
+
 void DataProviderInterface::shutdown() {
   LOG_IF(ERROR, shutdown_)
       << "Shutdown requested, but DataProviderInterface was already "
@@ -20,7 +20,7 @@ namespace VIO {
 
 using utils::ThreadsafeImuBuffer;
 
-DataProviderModule::DataProviderModule(OutputQueue* output_queue,
+DataProviderModule::DataProviderModule(OutputQueueBase* output_queue,
                                        const std::string& name_id,
                                        const bool& parallel_run)
     : MISO(output_queue, name_id, parallel_run),
@@ -31,12 +31,29 @@ DataProviderModule::DataProviderModule(OutputQueue* output_queue,
       imu_timestamp_correction_(0),
       imu_time_shift_ns_(0),
       external_odometry_time_shift_ns_(0),
-      external_odometry_buffer_(nullptr) {
+      external_odometry_buffer_(nullptr),
+      imu_ingestion_buffer_("data_provider_imu_ingestion"),
+      external_odometry_ingestion_buffer_(
+          "data_provider_external_odometry_ingestion") {
   // TODO(nathan) replace with non-unlimited buffer size
   if (FLAGS_use_external_odometry)
     external_odometry_buffer_ = std::make_unique<ThreadsafeOdometryBuffer>(-1);
 }
 
+void DataProviderModule::drainIngestionBuffers() {
+  // One IMU measurement at a time: the buffer enforces strict ordering.
+  imu_ingestion_buffer_.drain([this](ImuMeasurement&& imu_measurement) {
+    imu_data_.imu_buffer_.addMeasurement(imu_measurement.timestamp_,
+                                         imu_measurement.acc_gyr_);
+  });
+  if (external_odometry_buffer_) {
+    external_odometry_ingestion_buffer_.drain(
+        [this](ExternalOdomMeasurement&& odom) {
+          external_odometry_buffer_->add(odom.timestamp_, odom.odom_data_);
+        });
+  }
+}
+
 void DataProviderModule::logQueryResult(
     const Timestamp& timestamp,
     ThreadsafeImuBuffer::QueryResult result) const {
@@ -84,6 +101,7 @@ DataProviderModule::getTimeSyncedImuMeasurements(const Timestamp& timestamp,
   }
 
   CHECK_NOTNULL(imu_meas);
+  drainIngestionBuffers();
   CHECK_LT(timestamp_last_frame_, timestamp)
       << "Image timestamps out of order: "
       << UtilsNumerical::NsecToSec(timestamp_last_frame_)
@@ -178,6 +196,8 @@ DataProviderModule::getTimeSyncedImuMeasurements(const Timestamp& timestamp,
 }
 
 void DataProviderModule::shutdownQueues() {
+  imu_ingestion_buffer_.shutdown();
+  external_odometry_ingestion_buffer_.shutdown();
   imu_data_.imu_buffer_.shutdown();
   MISO::shutdownQueues();
 }
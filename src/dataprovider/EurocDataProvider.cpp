@@ -17,7 +17,9 @@
 #include "kimera-vio/dataprovider/EurocDataProvider.h"
 
 #include <algorithm>  // for max
+#include <cstdlib>
 #include <fstream>
+#include <iterator>
 #include <map>
 #include <string>
 #include <utility>  // for pair<>
@@ -34,6 +36,7 @@
 #include "kimera-vio/frontend/StereoFrame.h"
 #include "kimera-vio/imu-frontend/ImuFrontend-definitions.h"
 #include "kimera-vio/logging/Logger.h"
+#include "kimera-vio/utils/ImageBufferPool.h"
 #include "kimera-vio/utils/YamlParser.h"
 
 DEFINE_string(dataset_path,
@@ -50,6 +53,17 @@ DEFINE_int64(final_k,
 DEFINE_bool(log_euroc_gt_data,
             false,
             "Log Euroc ground-truth data to file for later evaluation.");
+DEFINE_int32(euroc_prefetch_threads,
+             0,
+             "Nr of threads decoding Euroc images ahead of playback, 0 to "
+             "decode them synchronously when sent.");
+DEFINE_int32(euroc_prefetch_lookahead,
+             8,
+             "Max nr of frames decoded ahead of playback when prefetching.");
+DEFINE_bool(euroc_use_image_buffer_pool,
+            true,
+            "Decode Euroc images into recycled buffers (ImageBufferPool), "
+            "so that steady-state operation does not allocate images.");
 
 namespace VIO {
 
@@ -153,8 +167,6 @@ bool EurocDataProvider::spinOnce() {
 
   const CameraParams& left_cam_info = vio_params_.camera_params_.at(0);
   const CameraParams& right_cam_info = vio_params_.camera_params_.at(1);
-  const bool& equalize_image =
-      vio_params_.frontend_params_.stereo_matching_params_.equalize_image_;
 
   const Timestamp& timestamp_frame_k = timestampAtFrame(current_k_);
   VLOG(10) << "Sending left/right frames k= " << current_k_
@@ -169,6 +181,8 @@ bool EurocDataProvider::spinOnce() {
   bool available_right_img = getRightImgName(current_k_, &right_img_filename);
   if (available_left_img && available_right_img) {
     // Both stereo images are available, send data to VIO
+    std::vector<cv::Mat> images = getImages(current_k_, 2u);
+    CHECK_EQ(images.size(), 2u);
     CHECK(left_frame_callback_);
     left_frame_callback_(
         std::make_unique<Frame>(current_k_,
@@ -176,8 +190,7 @@ bool EurocDataProvider::spinOnce() {
                                 // TODO(Toni): this info should be passed to
                                 // the camera... not all the time here...
                                 left_cam_info,
-                                UtilsOpenCV::ReadAndConvertToGrayScale(
-                                    left_img_filename, equalize_image)));
+                                images[0]));
     CHECK(right_frame_callback_);
     right_frame_callback_(
         std::make_unique<Frame>(current_k_,
@@ -185,8 +198,7 @@ bool EurocDataProvider::spinOnce() {
                                 // TODO(Toni): this info should be passed to
                                 // the camera... not all the time here...
                                 right_cam_info,
-                                UtilsOpenCV::ReadAndConvertToGrayScale(
-                                    right_img_filename, equalize_image)));
+                                images[1]));
   } else {
     LOG(ERROR) << "Missing left/right stereo pair, proceeding to the next one.";
   }
@@ -199,6 +211,48 @@ bool EurocDataProvider::spinOnce() {
   return true;
 }
 
+cv::MatAllocator* EurocDataProvider::imageAllocator() const {
+  return FLAGS_euroc_use_image_buffer_pool ? &ImageBufferPool::getInstance()
+                                           : nullptr;
+}
+
+std::vector<cv::Mat> EurocDataProvider::readImages(
+    const FrameId& k,
+    const size_t& nr_cameras) const {
+  const bool& equalize_image =
+      vio_params_.frontend_params_.stereo_matching_params_.equalize_image_;
+  std::vector<cv::Mat> images(nr_cameras);
+  for (size_t i = 0u; i < nr_cameras; ++i) {
+    std::string img_filename;
+    const bool available = i == 0u ? getLeftImgName(k, &img_filename)
+                                   : getRightImgName(k, &img_filename);
+    if (available) {
+      images[i] = UtilsOpenCV::ReadAndConvertToGrayScale(
+          img_filename, equalize_image, imageAllocator());
+    }
+  }
+  return images;
+}
+
+std::vector<cv::Mat> EurocDataProvider::getImages(const FrameId& k,
+                                                  const size_t& nr_cameras) {
+  if (FLAGS_euroc_prefetch_threads <= 0) {
+    return readImages(k, nr_cameras);
+  }
+  if (!image_prefetcher_) {
+    CHECK_GT(FLAGS_euroc_prefetch_lookahead, 0);
+    image_prefetcher_ = std::make_unique<ImagePrefetcher>(
+        [this, nr_cameras](const FrameId& frame_k) {
+          return readImages(frame_k, nr_cameras);
+        },
+        k,
+        final_k_,
+        static_cast<size_t>(FLAGS_euroc_prefetch_threads),
+        static_cast<size_t>(FLAGS_euroc_prefetch_lookahead));
+  }
+  return image_prefetcher_->get(k);
+}
+
 void EurocDataProvider::sendImuData() const {
   CHECK(imu_single_callback_) << "Did you forget to register the IMU callback?";
   Timestamp previous_timestamp = -1;
@@ -607,6 +661,24 @@ VioNavState EurocDataProvider::getGroundTruthState(
   return it_low->second;
 }
 
+/* -------------------------------------------------------------------------- */
+bool EurocDataProvider::findGroundTruthPose(const Timestamp& timestamp,
+                                            gtsam::Pose3* pose) const {
+  CHECK_NOTNULL(pose);
+  if (!is_gt_available_ || gt_data_.map_to_gt_.empty()) return false;
+  static constexpr Timestamp kMaxDelta = 10000000;  // 10ms
+  // Closest of the gt states around the timestamp.
+  auto it = gt_data_.map_to_gt_.lower_bound(timestamp);
+  if (it == gt_data_.map_to_gt_.end() ||
+      (it != gt_data_.map_to_gt_.begin() &&
+       timestamp - std::prev(it)->first < it->first - timestamp)) {
+    --it;
+  }
+  if (std::abs(it->first - timestamp) > kMaxDelta) return false;
+  *pose = it->second.pose_;
+  return true;
+}
+
 /* -------------------------------------------------------------------------- */
 // Compute initialization errors and stats.
 // [in]: timestamp vector for poses in bundle-adjustment
@@ -829,8 +901,6 @@ bool MonoEurocDataProvider::spinOnce() {
   }
 
   const CameraParams& left_cam_info = vio_params_.camera_params_.at(0);
-  const bool& equalize_image =
-      vio_params_.frontend_params_.stereo_matching_params_.equalize_image_;
 
   const Timestamp& timestamp_frame_k = timestampAtFrame(current_k_);
   VLOG(10) << "Sending left frame k= " << current_k_
@@ -843,6 +913,8 @@ bool MonoEurocDataProvider::spinOnce() {
   bool available_left_img = getLeftImgName(current_k_, &left_img_filename);
   if (available_left_img) {
     // Both stereo images are available, send data to VIO
+    std::vector<cv::Mat> images = getImages(current_k_, 1u);
+    CHECK_EQ(images.size(), 1u);
     CHECK(left_frame_callback_);
     left_frame_callback_(
         std::make_unique<Frame>(current_k_,
@@ -850,8 +922,7 @@ bool MonoEurocDataProvider::spinOnce() {
                                 // TODO(Toni): this info should be passed to
                                 // the camera... not all the time here...
                                 left_cam_info,
-                                UtilsOpenCV::ReadAndConvertToGrayScale(
-                                    left_img_filename, equalize_image)));
+                                images[0]));
   } else {
     LOG(ERROR) << "Missing left image, proceeding to the next one.";
   }
@@ -0,0 +1,114 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ImagePrefetcher.cpp
+ * @brief  Decodes dataset images ahead of playback on worker threads.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/dataprovider/ImagePrefetcher.h"
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+ImagePrefetcher::ImagePrefetcher(const ImageLoader& image_loader,
+                                 const FrameId& first_k,
+                                 const FrameId& last_k,
+                                 const size_t& nr_threads,
+                                 const size_t& lookahead)
+    : image_loader_(image_loader),
+      last_k_(last_k),
+      lookahead_(lookahead),
+      mutex_(),
+      work_cv_(),
+      ready_cv_(),
+      next_k_(first_k),
+      requested_k_(first_k),
+      ready_(),
+      shutdown_(false),
+      workers_() {
+  CHECK(image_loader_);
+  CHECK_GT(nr_threads, 0u);
+  CHECK_GT(lookahead_, 0u);
+  workers_.reserve(nr_threads);
+  for (size_t i = 0u; i < nr_threads; ++i) {
+    workers_.emplace_back(&ImagePrefetcher::workerLoop, this);
+  }
+}
+
+ImagePrefetcher::~ImagePrefetcher() { shutdown(); }
+
+void ImagePrefetcher::shutdown() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  work_cv_.notify_all();
+  ready_cv_.notify_all();
+  for (std::thread& worker : workers_) {
+    if (worker.joinable()) worker.join();
+  }
+  workers_.clear();
+}
+
+std::vector<cv::Mat> ImagePrefetcher::get(const FrameId& k) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  CHECK_GE(k, requested_k_) << "Frames must be requested in increasing order.";
+  requested_k_ = k;
+  // Drop frames the consumer skipped.
+  ready_.erase(ready_.begin(), ready_.lower_bound(k));
+  const bool scheduled = k < next_k_;
+  if (!scheduled) {
+    // The consumer jumped ahead of the workers: restart loading from k + 1,
+    // and load k here.
+    next_k_ = k + 1;
+  }
+  work_cv_.notify_all();
+
+  if (!scheduled || workers_.empty()) {
+    lock.unlock();
+    return image_loader_(k);
+  }
+
+  ready_cv_.wait(lock, [this, &k] { return shutdown_ || ready_.count(k); });
+  if (shutdown_ && !ready_.count(k)) {
+    lock.unlock();
+    return image_loader_(k);
+  }
+  std::vector<cv::Mat> images = std::move(ready_.at(k));
+  ready_.erase(k);
+  return images;
+}
+
+void ImagePrefetcher::workerLoop() {
+  while (true) {
+    FrameId k;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_cv_.wait(lock, [this] {
+        return shutdown_ ||
+               (next_k_ < last_k_ && next_k_ < requested_k_ + lookahead_);
+      });
+      if (shutdown_) return;
+      k = next_k_++;
+    }
+
+    std::vector<cv::Mat> images = image_loader_(k);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      // Only keep it if the consumer did not move past it meanwhile.
+      if (k >= requested_k_) ready_[k] = std::move(images);
+    }
+    ready_cv_.notify_all();
+  }
+}
+
+}  // namespace VIO
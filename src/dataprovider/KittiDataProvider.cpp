@@ -14,57 +14,292 @@
  */
 #include "kimera-vio/dataprovider/KittiDataProvider.h"
 
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
 #include <opencv2/core/core.hpp>
 
 #include "kimera-vio/frontend/StereoFrame.h"
 #include "kimera-vio/frontend/StereoImuSyncPacket.h"
+#include "kimera-vio/utils/UtilsNumerical.h"
+#include "kimera-vio/utils/UtilsOpenCV.h"
+
+DECLARE_string(dataset_path);
+DECLARE_int64(initial_k);
+DECLARE_int64(final_k);
+DEFINE_int32(kitti_prefetch_threads,
+             1,
+             "Nr of threads decoding Kitti images ahead of playback, 0 to "
+             "decode them synchronously when sent.");
+DEFINE_int32(kitti_prefetch_lookahead,
+             8,
+             "Max nr of frames decoded ahead of playback when prefetching.");
 
 namespace VIO {
 
-KittiDataProvider::KittiData::operator bool() const {
-  bool empty_data = timestamps_.empty() || left_img_names_.empty() ||
-                    right_img_names_.empty();
-  LOG_IF(ERROR, empty_data) << "Kitti Data is empty!";
-  const size_t num_stamps = timestamps_.size();
-  bool missing_data = (num_stamps != left_img_names_.size()) ||
-                      (num_stamps != right_img_names_.size());
-  LOG_IF(ERROR, missing_data) << "Missing Kitti Data!";
-  LOG_IF(ERROR, empty_data || missing_data)
-      << "# of timestamps: " << timestamps_.size() << '\n'
-      << "# of left img names: " << left_img_names_.size() << '\n'
-      << "# of right img names: " << right_img_names_.size();
-  return !empty_data && !missing_data;
-}
+KittiDataProvider::KittiDataProvider(const std::string& dataset_path,
+                                     const int& initial_k,
+                                     const int& final_k,
+                                     const VioParams& vio_params)
+    : DataProviderInterface(),
+      vio_params_(vio_params),
+      dataset_path_(dataset_path),
+      left_camera_name_("image_00"),
+      right_camera_name_("image_01"),
+      imu_name_("oxts"),
+      current_k_(initial_k),
+      initial_k_(initial_k),
+      final_k_(final_k),
+      is_sequence_finished_(false),
+      frame_timestamps_stream_(),
+      imu_timestamps_stream_(),
+      next_imu_k_(0u),
+      next_imu_measurement_(),
+      has_next_imu_measurement_(false),
+      last_imu_timestamp_sent_(std::numeric_limits<Timestamp>::min()),
+      image_prefetcher_(nullptr) {
+  CHECK(!dataset_path_.empty())
+      << "Dataset path for KittiDataProvider is empty.";
+  CHECK_GE(initial_k_, 0);
+  CHECK_GT(final_k_, 0);
+  CHECK_GT(final_k_, initial_k_) << "Value for final_k (" << final_k_
+                                 << ") is smaller than value for"
+                                 << " initial_k (" << initial_k_ << ").";
 
-KittiDataProvider::KittiDataProvider()
-    : DataProviderInterface(), kitti_data_() {
-  // Parse Kitti dataset.
-  std::string dataset_path = "Not implemented...";
-  parseKittiData(dataset_path, &kitti_data_);
+  // Only open the timestamps files: the data is read while spinning.
+  const std::string frame_timestamps_file =
+      dataset_path_ + "/" + left_camera_name_ + "/timestamps.txt";
+  frame_timestamps_stream_.open(frame_timestamps_file.c_str());
+  CHECK(frame_timestamps_stream_.is_open())
+      << "Could not open timestamps file: " << frame_timestamps_file;
+  const std::string imu_timestamps_file =
+      dataset_path_ + "/" + imu_name_ + "/timestamps.txt";
+  imu_timestamps_stream_.open(imu_timestamps_file.c_str());
+  CHECK(imu_timestamps_stream_.is_open())
+      << "Could not open timestamps file: " << imu_timestamps_file;
+
+  // Skip the frames before initial_k.
+  Timestamp timestamp;
+  for (FrameId k = 0u; k < initial_k_; ++k) {
+    if (!readNextFrameTimestamp(&timestamp)) {
+      LOG(ERROR) << "Kitti sequence has less than initial_k (" << initial_k_
+                 << ") frames.";
+      is_sequence_finished_ = true;
+      break;
+    }
+  }
+  readNextImuMeasurement();
 }
 
-cv::Mat KittiDataProvider::readKittiImage(const std::string& img_name) {
-  cv::Mat img = cv::imread(img_name, cv::ImreadModes::IMREAD_UNCHANGED);
-  LOG_IF(FATAL, img.empty()) << "Failed to load image: " << img_name;
-  // cv::imshow("check", img);
-  // cv::waitKey(0);
-  return img;
+KittiDataProvider::KittiDataProvider(const VioParams& vio_params)
+    : KittiDataProvider(FLAGS_dataset_path,
+                        FLAGS_initial_k,
+                        FLAGS_final_k,
+                        vio_params) {}
+
+KittiDataProvider::~KittiDataProvider() {
+  LOG(INFO) << "KittiDataProvider destructor called.";
 }
 
 bool KittiDataProvider::spin() {
-  LOG(FATAL) << "Not implemented.";
+  CHECK_EQ(vio_params_.camera_params_.size(), 2u);
+  // We log only the first one, because we may be running in sequential mode.
+  LOG_FIRST_N(INFO, 1) << "Running dataset between frame " << initial_k_
+                       << " and frame " << final_k_;
+  while (!shutdown_ && spinOnce()) {
+    if (!vio_params_.parallel_run_) {
+      // Return, instead of blocking, when running in sequential mode.
+      return true;
+    }
+  }
+  LOG_IF(INFO, shutdown_) << "KittiDataProvider shutdown requested.";
+  return false;
+}
+
+bool KittiDataProvider::hasData() const {
+  return !is_sequence_finished_ && current_k_ < final_k_;
+}
+
+bool KittiDataProvider::spinOnce() {
+  Timestamp timestamp_frame_k;
+  if (!hasData() || !readNextFrameTimestamp(&timestamp_frame_k)) {
+    LOG(INFO) << "Finished spinning Kitti dataset.";
+    is_sequence_finished_ = true;
+    return false;
+  }
+
+  // The IMU measurements go first, so that the frame can be synced.
+  if (imu_single_callback_) {
+    sendImuDataUntil(timestamp_frame_k);
+  } else {
+    LOG_FIRST_N(ERROR, 1) << "Imu callback not registered! Not sending IMU "
+                             "data.";
+  }
+
+  VLOG(10) << "Sending left/right frames k= " << current_k_
+           << " with timestamp: " << timestamp_frame_k;
+  std::vector<cv::Mat> images = getImages(current_k_);
+  CHECK_EQ(images.size(), 2u);
+  if (!images[0].empty() && !images[1].empty()) {
+    CHECK(left_frame_callback_);
+    left_frame_callback_(
+        std::make_unique<Frame>(current_k_,
+                                timestamp_frame_k,
+                                vio_params_.camera_params_.at(0),
+                                images[0]));
+    CHECK(right_frame_callback_);
+    right_frame_callback_(
+        std::make_unique<Frame>(current_k_,
+                                timestamp_frame_k,
+                                vio_params_.camera_params_.at(1),
+                                images[1]));
+  } else {
+    LOG(ERROR) << "Missing left/right stereo pair, proceeding to the next one.";
+  }
+
+  VLOG(10) << "Finished VIO processing for frame k = " << current_k_;
+  current_k_++;
+  return true;
+}
+
+bool KittiDataProvider::readNextFrameTimestamp(Timestamp* timestamp) {
+  CHECK_NOTNULL(timestamp);
+  std::string line;
+  while (std::getline(frame_timestamps_stream_, line)) {
+    if (parseTimestamp(line, timestamp)) return true;
+  }
   return false;
 }
 
-bool Earlier_time(std::pair<Timestamp, std::string>& a,
-                  std::pair<Timestamp, std::string>& b) {
-  // for sorting below
-  return a.first < b.first;
+void KittiDataProvider::readNextImuMeasurement() {
+  has_next_imu_measurement_ = false;
+  std::string line;
+  while (std::getline(imu_timestamps_stream_, line)) {
+    Timestamp timestamp;
+    if (!parseTimestamp(line, &timestamp)) continue;
+    const FrameId imu_k = next_imu_k_++;
+    const std::string data_file = getDataFilename(imu_name_, imu_k, ".txt");
+    std::ifstream data_stream(data_file.c_str());
+    std::string data_line;
+    ImuAccGyr imu_accgyr;
+    if (!data_stream.is_open() || !std::getline(data_stream, data_line) ||
+        !parseOxtsImuMeasurement(data_line, &imu_accgyr)) {
+      LOG(WARNING) << "Skipping invalid OXTS measurement: " << data_file;
+      continue;
+    }
+    if (timestamp <= last_imu_timestamp_sent_) {
+      LOG(WARNING) << "Skipping OXTS measurement out of order: " << data_file;
+      continue;
+    }
+    next_imu_measurement_ = ImuMeasurement(timestamp, imu_accgyr);
+    has_next_imu_measurement_ = true;
+    return;
+  }
 }
 
-void KittiDataProvider::parseKittiData(const std::string& kitti_sequence_path,
-                                       KittiData* kitti_data) {
-  LOG(FATAL) << "Not implemented";
+void KittiDataProvider::sendImuDataUntil(const Timestamp& timestamp) {
+  CHECK(imu_single_callback_);
+  while (has_next_imu_measurement_ && last_imu_timestamp_sent_ <= timestamp) {
+    imu_single_callback_(next_imu_measurement_);
+    last_imu_timestamp_sent_ = next_imu_measurement_.timestamp_;
+    readNextImuMeasurement();
+  }
+}
+
+std::vector<cv::Mat> KittiDataProvider::readKittiImages(
+    const FrameId& k) const {
+  const bool& equalize_image =
+      vio_params_.frontend_params_.stereo_matching_params_.equalize_image_;
+  std::vector<cv::Mat> images;
+  images.reserve(2u);
+  for (const std::string& camera_name :
+       {left_camera_name_, right_camera_name_}) {
+    const std::string img_filename = getDataFilename(camera_name, k, ".png");
+    if (std::ifstream(img_filename.c_str()).good()) {
+      images.push_back(UtilsOpenCV::ReadAndConvertToGrayScale(img_filename,
+                                                              equalize_image));
+    } else {
+      images.push_back(cv::Mat());
+    }
+  }
+  return images;
+}
+
+std::vector<cv::Mat> KittiDataProvider::getImages(const FrameId& k) {
+  if (FLAGS_kitti_prefetch_threads <= 0) {
+    return readKittiImages(k);
+  }
+  if (!image_prefetcher_) {
+    CHECK_GT(FLAGS_kitti_prefetch_lookahead, 0);
+    image_prefetcher_ = std::make_unique<ImagePrefetcher>(
+        [this](const FrameId& frame_k) { return readKittiImages(frame_k); },
+        k,
+        final_k_,
+        static_cast<size_t>(FLAGS_kitti_prefetch_threads),
+        static_cast<size_t>(FLAGS_kitti_prefetch_lookahead));
+  }
+  return image_prefetcher_->get(k);
+}
+
+std::string KittiDataProvider::getDataFilename(
+    const std::string& sensor_name,
+    const FrameId& k,
+    const std::string& extension) const {
+  std::ostringstream filename;
+  filename << dataset_path_ << "/" << sensor_name << "/data/"
+           << std::setfill('0') << std::setw(10) << k << extension;
+  return filename.str();
+}
+
+bool KittiDataProvider::parseTimestamp(const std::string& line,
+                                       Timestamp* timestamp) {
+  CHECK_NOTNULL(timestamp);
+  static constexpr int seconds_per_hour = 3600u;
+  static constexpr int seconds_per_minute = 60u;
+  static constexpr long int seconds_to_nanoseconds = 1e9;
+  if (line.empty()) return false;
+  std::string time_line = line;
+  std::replace(time_line.begin(), time_line.end(), ':', ' ');
+  std::stringstream ss(time_line);
+  std::string date;
+  double hr, min, sec;
+  if (!(ss >> date >> hr >> min >> sec)) return false;
+  // formate time into Timestamp (in nanosecs), the nanoseconds apart to
+  // keep their precision.
+  const double whole_sec = std::floor(sec);
+  *timestamp = static_cast<Timestamp>(hr * seconds_per_hour +
+                                      min * seconds_per_minute + whole_sec) *
+                   seconds_to_nanoseconds +
+               static_cast<Timestamp>(
+                   std::llround((sec - whole_sec) * seconds_to_nanoseconds));
+  return true;
+}
+
+bool KittiDataProvider::parseOxtsImuMeasurement(const std::string& line,
+                                                ImuAccGyr* imu_accgyr) {
+  CHECK_NOTNULL(imu_accgyr);
+  // lat lon alt roll pitch yaw vn ve vf vl vu ax ay az af al au wx wy wz ...
+  static constexpr size_t kAccIdx = 11u;
+  static constexpr size_t kGyrIdx = 17u;
+  std::stringstream ss(line);
+  std::vector<double> values;
+  double value;
+  while (values.size() < kGyrIdx + 3u && ss >> value) {
+    values.push_back(value);
+  }
+  if (values.size() < kGyrIdx + 3u) return false;
+  *imu_accgyr << values[kAccIdx], values[kAccIdx + 1u], values[kAccIdx + 2u],
+      values[kGyrIdx], values[kGyrIdx + 1u], values[kGyrIdx + 2u];
+  return true;
 }
 
 bool KittiDataProvider::parseTimestamps(
@@ -75,24 +310,11 @@ bool KittiDataProvider::parseTimestamps(
   CHECK(times_stream.is_open())
       << "Could not open timestamps file: " << timestamps_file;
   timestamps_list.clear();
-  static constexpr int seconds_per_hour = 3600u;
-  static constexpr int seconds_per_minute = 60u;
-  static constexpr long int seconds_to_nanoseconds = 1e9;
   // Loop through timestamps text file
-  while (!times_stream.eof()) {
-    std::string line;
-    getline(times_stream, line);
-    if (!line.empty()) {
-      std::stringstream ss;
-      std::replace(line.begin(), line.end(), ':', ' ');
-      ss << line;
-      std::string date;
-      double hr, min, sec;
-      ss >> date >> hr >> min >> sec;
-      // formate time into Timestamp (in nanosecs)
-      Timestamp timestamp =
-          (hr * seconds_per_hour + min * seconds_per_minute + sec) *
-          seconds_to_nanoseconds;
+  std::string line;
+  while (std::getline(times_stream, line)) {
+    Timestamp timestamp;
+    if (parseTimestamp(line, &timestamp)) {
       timestamps_list.push_back(timestamp);
     }
   }
@@ -101,15 +323,7 @@ bool KittiDataProvider::parseTimestamps(
 
 bool KittiDataProvider::parseCameraData(const std::string& input_dataset_path,
                                         const std::string& left_cam_id,
-                                        const std::string& right_cam_id,
-                                        KittiData* kitti_data) {
-  // note that the stamps and images were parsed in parseKittiData method
-  // perhaps move all that into this method?
-  // for now write parse camera info here
-  // Default names: match names of the corresponding folders.
-  kitti_data->left_camera_name_ = left_cam_id;
-  kitti_data->right_camera_name_ = right_cam_id;
-
+                                        const std::string& right_cam_id) {
   // Read camera info and list of images.
   std::vector<std::string> camera_names;
   camera_names.push_back(left_cam_id);
@@ -199,18 +413,14 @@ bool KittiDataProvider::parsePose(const std::string& input_dataset_path,
   return true;
 }
 
-bool Earlier_time_imu(std::pair<Timestamp, int>& a,
-                      std::pair<Timestamp, int>& b) {
-  // for sorting below
-  return a.first < b.first;
-}
-
-bool KittiDataProvider::parseImuData(const std::string& input_dataset_path,
-                                     KittiData* kitti_data) {
-  return false;
-}
-
 /* -------------------------------------------------------------------------- */
-void KittiDataProvider::print() const {}
+void KittiDataProvider::print() const {
+  LOG(INFO) << "------------------ KittiDataProvider::print -----------------\n"
+            << "Dataset path: " << dataset_path_ << '\n'
+            << "Current frame: " << current_k_ << '\n'
+            << "Initial frame: " << initial_k_ << '\n'
+            << "Final frame: " << final_k_ << '\n'
+            << "Last IMU timestamp sent: " << last_imu_timestamp_sent_;
+}
 
 }  // namespace VIO
@@ -15,12 +15,14 @@
 
 #include <utility>  // for move
 
+#include <opencv2/imgproc.hpp>
+
 #include "kimera-vio/dataprovider/MonoDataProviderModule.h"
 #include "kimera-vio/frontend/MonoImuSyncPacket.h"
 
 namespace VIO {
 
-MonoDataProviderModule::MonoDataProviderModule(OutputQueue* output_queue,
+MonoDataProviderModule::MonoDataProviderModule(OutputQueueBase* output_queue,
                                                const std::string& name_id,
                                                const bool& parallel_run)
     : DataProviderModule(output_queue,
@@ -86,7 +88,8 @@ MonoImuSyncPacket::UniquePtr MonoDataProviderModule::getMonoImuSyncPacket(
   gtsam::NavState external_odometry;
   if (external_odometry_buffer_) {
     ThreadsafeOdometryBuffer::QueryResult result =
-        external_odometry_buffer_->getNearest(timestamp, &external_odometry);
+        external_odometry_buffer_->getInterpolated(timestamp,
+                                                  &external_odometry);
     switch (result) {
       case ThreadsafeOdometryBuffer::QueryResult::DataNotYetAvailable:
         // TODO(nathan) consider increasing verbosity here
@@ -138,7 +141,22 @@ Frame::UniquePtr MonoDataProviderModule::getLeftFramePayload() {
   }
   CHECK(left_frame_payload);
 
-  return left_frame_payload;
+  return downscaleFrame(std::move(left_frame_payload));
+}
+
+Frame::UniquePtr MonoDataProviderModule::downscaleFrame(
+    Frame::UniquePtr frame) {
+  CHECK(frame);
+  const CameraParams& cam_param = frame->cam_param_;
+  if (cam_param.downscale_factor_ == 1 || frame->img_.empty() ||
+      frame->img_.size() == cam_param.image_size_) {
+    return frame;
+  }
+  cv::Mat img;
+  cv::resize(frame->img_, img, cam_param.image_size_, 0.0, 0.0,
+             cv::INTER_AREA);
+  return std::make_unique<Frame>(
+      frame->id_, frame->timestamp_, cam_param, img);
 }
 
 void MonoDataProviderModule::shutdownQueues() {
@@ -0,0 +1,96 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   MultiCameraDataProviderModule.cpp
+ * @brief  Pipeline Module that takes care of providing multi-camera + IMU
+ * data to the VIO pipeline.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/dataprovider/MultiCameraDataProviderModule.h"
+
+#include <string>
+#include <utility>  // for move
+
+namespace VIO {
+
+MultiCameraDataProviderModule::MultiCameraDataProviderModule(
+    OutputQueueBase* output_queue,
+    const std::string& name_id,
+    const bool& parallel_run,
+    const size_t& nr_cameras)
+    : MonoDataProviderModule(output_queue, name_id, parallel_run),
+      frame_queues_() {
+  CHECK_GT(nr_cameras, 0u);
+  frame_queues_.reserve(nr_cameras - 1u);
+  for (size_t cam_idx = 1u; cam_idx < nr_cameras; ++cam_idx) {
+    const std::string queue_id =
+        "data_provider_frame_queue_" + std::to_string(cam_idx);
+    frame_queues_.push_back(
+        std::make_unique<ThreadsafeQueue<Frame::UniquePtr>>(queue_id));
+  }
+}
+
+MultiCameraDataProviderModule::InputUniquePtr
+MultiCameraDataProviderModule::getInputPacket() {
+  //! Get reference image + IMU data
+  MonoImuSyncPacket::UniquePtr mono_imu_sync_packet =
+      getMonoImuSyncPacket(false);
+  if (!mono_imu_sync_packet) {
+    return nullptr;
+  }
+
+  const Timestamp& timestamp = mono_imu_sync_packet->timestamp_;
+  const FrameId& ref_frame_id = mono_imu_sync_packet->frame_->id_;
+
+  //! Get the image data of the other cameras
+  std::vector<Frame::UniquePtr> frames;
+  frames.reserve(getNrCameras());
+  frames.push_back(std::move(mono_imu_sync_packet->frame_));
+  for (size_t cam_idx = 1u; cam_idx < getNrCameras(); ++cam_idx) {
+    Frame::UniquePtr frame_payload = nullptr;
+    if (!MISO::syncQueue(timestamp, getFrameQueue(cam_idx), &frame_payload)) {
+      // Dropping this message because of missing synced frames.
+      LOG(ERROR) << "Missing frame of camera " << cam_idx
+                 << " for reference frame with id " << ref_frame_id
+                 << ", dropping this frame.";
+      return nullptr;
+    }
+    CHECK(frame_payload);
+    frames.push_back(std::move(frame_payload));
+  }
+  timestamp_last_frame_ = timestamp;
+
+  if (!shutdown_) {
+    CHECK(vio_pipeline_callback_);
+    vio_pipeline_callback_(std::make_unique<MultiCameraImuSyncPacket>(
+        std::move(frames),
+        mono_imu_sync_packet->imu_stamps_,
+        mono_imu_sync_packet->imu_accgyrs_,
+        mono_imu_sync_packet->world_NavState_ext_odom_));
+  }
+  return nullptr;
+}
+
+void MultiCameraDataProviderModule::shutdownQueues() {
+  for (const auto& frame_queue : frame_queues_) {
+    frame_queue->shutdown();
+  }
+  MonoDataProviderModule::shutdownQueues();
+}
+
+bool MultiCameraDataProviderModule::hasWork() const {
+  if (MonoDataProviderModule::hasWork()) return true;
+  for (const auto& frame_queue : frame_queues_) {
+    if (!frame_queue->empty()) return true;
+  }
+  return false;
+}
+
+}  // namespace VIO
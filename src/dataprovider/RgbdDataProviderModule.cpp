@@ -19,6 +19,7 @@
 #include "kimera-vio/frontend/RgbdImuSyncPacket.h"
 
 #include <gflags/gflags.h>
+#include <opencv2/imgproc.hpp>
 
 DEFINE_string(depth_image_mask,
               "",
@@ -26,7 +27,7 @@ DEFINE_string(depth_image_mask,
 
 namespace VIO {
 
-RgbdDataProviderModule::RgbdDataProviderModule(OutputQueue* output_queue,
+RgbdDataProviderModule::RgbdDataProviderModule(OutputQueueBase* output_queue,
                                                const std::string& name_id,
                                                const bool& parallel_run)
     : MonoDataProviderModule(output_queue, name_id, parallel_run),
@@ -78,6 +79,21 @@ RgbdDataProviderModule::getInputPacket() {
     depth_frame_payload.reset(new DepthFrame(id, stamp, result));
   }
 
+  // Downscaled with the color image, without mixing valid and invalid depths.
+  const cv::Size img_size = mono_imu_sync_packet->frame_->img_.size();
+  if (!img_size.empty() && depth_frame_payload->depth_img_.size() != img_size) {
+    cv::Mat depth_img;
+    cv::resize(depth_frame_payload->depth_img_,
+               depth_img,
+               img_size,
+               0.0,
+               0.0,
+               cv::INTER_NEAREST);
+    const auto id = depth_frame_payload->id_;
+    const auto stamp = depth_frame_payload->timestamp_;
+    depth_frame_payload.reset(new DepthFrame(id, stamp, depth_img));
+  }
+
   if (!shutdown_) {
     CHECK(vio_pipeline_callback_);
     vio_pipeline_callback_(std::make_unique<RgbdImuSyncPacket>(
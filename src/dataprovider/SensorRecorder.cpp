@@ -0,0 +1,249 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   SensorRecorder.cpp
+ * @brief  Records the sensor data sent by a data provider to a binary dataset.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/dataprovider/SensorRecorder.h"
+
+#include <utility>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+SensorRecorder::SensorRecorder(const std::string& filename,
+                               const size_t& nr_cameras,
+                               const size_t& max_buffered_frames,
+                               const size_t& max_buffered_measurements)
+    : nr_cameras_(nr_cameras),
+      max_buffered_images_(max_buffered_frames * nr_cameras),
+      max_buffered_measurements_(max_buffered_measurements),
+      mutex_(),
+      cond_(),
+      imu_measurements_(),
+      odom_measurements_(),
+      images_(),
+      closing_(false),
+      closed_(false),
+      nr_recorded_frames_(0u),
+      nr_dropped_images_(0u),
+      nr_dropped_measurements_(0u),
+      writer_(filename, nr_cameras),
+      incomplete_frames_(),
+      last_imu_timestamp_(-1),
+      last_odom_timestamp_(-1),
+      last_frame_timestamp_(-1),
+      nr_reported_drops_(0u),
+      last_report_time_(),
+      worker_() {
+  CHECK_GT(max_buffered_frames, 0u);
+  CHECK_GT(max_buffered_measurements_, 0u);
+  worker_ = std::thread(&SensorRecorder::workerLoop, this);
+  LOG(INFO) << "Recording sensor data to: " << filename;
+}
+
+SensorRecorder::~SensorRecorder() {
+  if (!closed_) close();
+}
+
+void SensorRecorder::recordImu(const ImuMeasurement& imu_measurement) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (closing_) return;
+  if (imu_measurements_.size() + odom_measurements_.size() >=
+      max_buffered_measurements_) {
+    ++nr_dropped_measurements_;
+    return;
+  }
+  imu_measurements_.push_back(imu_measurement);
+  cond_.notify_one();
+}
+
+void SensorRecorder::recordExternalOdom(const ExternalOdomMeasurement& odom) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (closing_) return;
+  if (imu_measurements_.size() + odom_measurements_.size() >=
+      max_buffered_measurements_) {
+    ++nr_dropped_measurements_;
+    return;
+  }
+  odom_measurements_.push_back(odom);
+  cond_.notify_one();
+}
+
+void SensorRecorder::recordFrame(const size_t& cam_idx, const Frame& frame) {
+  CHECK_LT(cam_idx, nr_cameras_);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (closing_) return;
+  if (images_.size() >= max_buffered_images_) {
+    ++nr_dropped_images_;
+    return;
+  }
+  // Shallow copy: the pipeline does not write into its input images.
+  images_.push_back({cam_idx, frame.id_, frame.timestamp_, frame.img_});
+  cond_.notify_one();
+}
+
+void SensorRecorder::close() {
+  CHECK(!closed_);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closing_ = true;
+  }
+  cond_.notify_one();
+  worker_.join();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& id_and_frame : incomplete_frames_) {
+      nr_dropped_images_ += id_and_frame.second.nr_images;
+    }
+  }
+  incomplete_frames_.clear();
+  writer_.close();
+  reportDrops(true);
+  LOG(INFO) << "Recorded " << getNrRecordedFrames() << " frames.";
+  closed_ = true;
+}
+
+size_t SensorRecorder::getNrRecordedFrames() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return nr_recorded_frames_;
+}
+
+size_t SensorRecorder::getNrDroppedImages() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return nr_dropped_images_;
+}
+
+size_t SensorRecorder::getNrDroppedMeasurements() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return nr_dropped_measurements_;
+}
+
+void SensorRecorder::workerLoop() {
+  std::deque<ImuMeasurement> imu_measurements;
+  std::deque<ExternalOdomMeasurement> odom_measurements;
+  std::deque<BufferedImage> images;
+  while (true) {
+    bool closing = false;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait(lock, [this]() {
+        return closing_ || !imu_measurements_.empty() ||
+               !odom_measurements_.empty() || !images_.empty();
+      });
+      // Take everything buffered so far, so that the callers never wait for
+      // the writes.
+      imu_measurements.swap(imu_measurements_);
+      odom_measurements.swap(odom_measurements_);
+      images.swap(images_);
+      closing = closing_;
+    }
+    write(&imu_measurements, &odom_measurements, &images);
+    reportDrops(false);
+    if (closing) return;
+  }
+}
+
+void SensorRecorder::write(
+    std::deque<ImuMeasurement>* imu_measurements,
+    std::deque<ExternalOdomMeasurement>* odom_measurements,
+    std::deque<BufferedImage>* images) {
+  CHECK_NOTNULL(imu_measurements);
+  CHECK_NOTNULL(odom_measurements);
+  CHECK_NOTNULL(images);
+  size_t nr_dropped_measurements = 0u;
+  size_t nr_dropped_images = 0u;
+  size_t nr_recorded_frames = 0u;
+
+  for (const ImuMeasurement& imu_measurement : *imu_measurements) {
+    if (imu_measurement.timestamp_ <= last_imu_timestamp_) {
+      ++nr_dropped_measurements;
+      continue;
+    }
+    writer_.addImuMeasurement(imu_measurement);
+    last_imu_timestamp_ = imu_measurement.timestamp_;
+  }
+  imu_measurements->clear();
+
+  for (const ExternalOdomMeasurement& odom : *odom_measurements) {
+    if (odom.timestamp_ <= last_odom_timestamp_) {
+      ++nr_dropped_measurements;
+      continue;
+    }
+    writer_.addExternalOdomMeasurement(odom);
+    last_odom_timestamp_ = odom.timestamp_;
+  }
+  odom_measurements->clear();
+
+  for (BufferedImage& image : *images) {
+    if (image.timestamp <= last_frame_timestamp_) {
+      ++nr_dropped_images;
+      continue;
+    }
+    IncompleteFrame& frame = incomplete_frames_[image.frame_id];
+    if (frame.images.empty()) {
+      frame.timestamp = image.timestamp;
+      frame.images.resize(nr_cameras_);
+      frame.nr_images = 0u;
+    }
+    if (!frame.images[image.cam_idx].empty()) {
+      // Same camera twice for this frame.
+      ++nr_dropped_images;
+      continue;
+    }
+    frame.images[image.cam_idx] = std::move(image.img);
+    if (++frame.nr_images < nr_cameras_) continue;
+
+    // Frames complete in order: the older incomplete ones never will.
+    auto it = incomplete_frames_.begin();
+    while (it->first != image.frame_id) {
+      nr_dropped_images += it->second.nr_images;
+      it = incomplete_frames_.erase(it);
+    }
+    if (frame.timestamp > last_frame_timestamp_) {
+      writer_.addFrame(image.frame_id, frame.timestamp, frame.images);
+      last_frame_timestamp_ = frame.timestamp;
+      ++nr_recorded_frames;
+    } else {
+      nr_dropped_images += frame.nr_images;
+    }
+    incomplete_frames_.erase(it);
+  }
+  images->clear();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  nr_dropped_measurements_ += nr_dropped_measurements;
+  nr_dropped_images_ += nr_dropped_images;
+  nr_recorded_frames_ += nr_recorded_frames;
+}
+
+void SensorRecorder::reportDrops(const bool& force) {
+  const auto now = std::chrono::steady_clock::now();
+  if (!force && now - last_report_time_ < std::chrono::seconds(1)) return;
+  size_t nr_dropped_images = 0u;
+  size_t nr_dropped_measurements = 0u;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    nr_dropped_images = nr_dropped_images_;
+    nr_dropped_measurements = nr_dropped_measurements_;
+  }
+  if (nr_dropped_images + nr_dropped_measurements == nr_reported_drops_) {
+    return;
+  }
+  LOG(WARNING) << "Sensor recorder dropped "
+               << nr_dropped_images << " images and "
+               << nr_dropped_measurements << " measurements so far.";
+  nr_reported_drops_ = nr_dropped_images + nr_dropped_measurements;
+  last_report_time_ = now;
+}
+
+}  // namespace VIO
@@ -22,7 +22,7 @@
 namespace VIO {
 
 StereoDataProviderModule::StereoDataProviderModule(
-    OutputQueue* output_queue,
+    OutputQueueBase* output_queue,
     const std::string& name_id,
     const bool& parallel_run,
     const StereoMatchingParams& stereo_matching_params)
@@ -57,6 +57,7 @@ StereoDataProviderModule::getInputPacket() {
     return nullptr;
   }
   CHECK(right_frame_payload);
+  right_frame_payload = downscaleFrame(std::move(right_frame_payload));
   timestamp_last_frame_ = timestamp;
 
   if (!shutdown_) {
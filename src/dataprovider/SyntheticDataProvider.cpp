@@ -0,0 +1,426 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   SyntheticDataProvider.cpp
+ * @brief  Generates frames and IMU data of a procedural world, for load and
+ * scaling tests.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/dataprovider/SyntheticDataProvider.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <opencv2/calib3d/calib3d.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "kimera-vio/frontend/DepthFrame.h"
+#include "kimera-vio/frontend/Frame.h"
+#include "kimera-vio/frontend/FrontendType.h"
+
+DEFINE_double(synthetic_wall_radius, 6.0, "Radius of the synthetic world [m].");
+DEFINE_double(synthetic_wall_height, 4.0, "Height of the synthetic world [m].");
+DEFINE_double(synthetic_landmark_density,
+              2.0,
+              "Nr of landmarks per square meter of the synthetic world.");
+DEFINE_double(synthetic_trajectory_radius,
+              1.0,
+              "Radius of the circle followed by the camera [m].");
+DEFINE_double(synthetic_angular_velocity,
+              0.3,
+              "Angular velocity of the camera around the circle [rad/s].");
+DEFINE_double(synthetic_vertical_amplitude,
+              0.2,
+              "Amplitude of the vertical oscillation of the camera [m].");
+DEFINE_double(synthetic_duration, 30.0, "Duration of the synthetic run [s].");
+DEFINE_double(synthetic_frame_rate,
+              0.0,
+              "Frame rate of the synthetic run [Hz], 0 for the camera params "
+              "one.");
+DEFINE_double(synthetic_imu_rate,
+              0.0,
+              "IMU rate of the synthetic run [Hz], 0 for the IMU params one.");
+DEFINE_bool(synthetic_imu_noise,
+            true,
+            "Add the white noise of the IMU params to the synthetic IMU data.");
+DEFINE_int32(synthetic_seed, 0, "Seed of the synthetic world and IMU noise.");
+
+namespace VIO {
+
+namespace {
+//! Time step of the finite differences of the trajectory [s].
+static constexpr double kDerivativeStep = 1.0e-4;
+//! Landmarks closer to the camera are not rendered [m].
+static constexpr double kNearPlane = 0.1;
+//! Intensity of the background.
+static constexpr uchar kBackgroundIntensity = 20u;
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+SyntheticDataProvider::SyntheticDataProvider(
+    const SyntheticWorldParams& world_params,
+    const VioParams& vio_params)
+    : DataProviderInterface(),
+      gt_data_(),
+      vio_params_(vio_params),
+      world_params_(world_params),
+      frame_period_s_(0.0),
+      imu_period_s_(0.0),
+      nr_frames_(0u),
+      current_k_(0u),
+      next_imu_idx_(0),
+      initial_timestamp_(1000000000),
+      landmarks_(),
+      left_rays_(),
+      generator_(world_params.seed),
+      imu_noise_(0.0, 1.0) {
+  CHECK(!vio_params_.camera_params_.empty());
+  CHECK_GT(world_params_.wall_radius_m, world_params_.trajectory_radius_m);
+  CHECK_GT(world_params_.wall_height_m, 0.0);
+  CHECK_GE(world_params_.landmark_density, 0.0);
+  CHECK_GT(world_params_.duration_s, 0.0);
+  const CameraParams& left_cam_params = vio_params_.camera_params_.at(0);
+  if (vio_params_.frontend_type_ == FrontendType::kStereoImu) {
+    CHECK_GE(vio_params_.camera_params_.size(), 2u);
+  }
+  const double frame_rate = world_params_.frame_rate_hz > 0.0
+                                ? world_params_.frame_rate_hz
+                                : left_cam_params.frame_rate_;
+  const double imu_rate =
+      world_params_.imu_rate_hz > 0.0
+          ? world_params_.imu_rate_hz
+          : 1.0 / vio_params_.imu_params_.nominal_sampling_time_s_;
+  CHECK_GT(frame_rate, 0.0);
+  CHECK_GT(imu_rate, frame_rate);
+  frame_period_s_ = 1.0 / frame_rate;
+  imu_period_s_ = 1.0 / imu_rate;
+  nr_frames_ = static_cast<size_t>(world_params_.duration_s * frame_rate);
+  // A few IMU measurements before the first frame.
+  next_imu_idx_ = -10;
+  LOG_IF(WARNING,
+         std::abs(vio_params_.imu_params_.n_gravity_.normalized().z() + 1.0) >
+             1.0e-3)
+      << "The synthetic world has gravity along -z, but the IMU params have: "
+      << vio_params_.imu_params_.n_gravity_.transpose();
+
+  // Landmarks uniformly distributed on the wall.
+  const size_t nr_landmarks = static_cast<size_t>(
+      world_params_.landmark_density * 2.0 * M_PI *
+      world_params_.wall_radius_m * world_params_.wall_height_m);
+  std::uniform_real_distribution<double> angle(0.0, 2.0 * M_PI);
+  std::uniform_real_distribution<double> height(0.0,
+                                                world_params_.wall_height_m);
+  std::uniform_int_distribution<int> intensity(80, 255);
+  landmarks_.reserve(nr_landmarks);
+  for (size_t i = 0u; i < nr_landmarks; ++i) {
+    const double theta = angle(generator_);
+    landmarks_.push_back(
+        {gtsam::Point3(world_params_.wall_radius_m * std::cos(theta),
+                       world_params_.wall_radius_m * std::sin(theta),
+                       height(generator_)),
+         static_cast<uchar>(intensity(generator_))});
+  }
+
+  if (vio_params_.frontend_type_ == FrontendType::kRgbdImu) {
+    // Rays of the left camera pixels, for the depth frames.
+    const cv::Size& size = left_cam_params.image_size_;
+    std::vector<cv::Point2d> pixels;
+    pixels.reserve(size.area());
+    for (int v = 0; v < size.height; ++v) {
+      for (int u = 0; u < size.width; ++u) {
+        pixels.emplace_back(u, v);
+      }
+    }
+    std::vector<cv::Point2d> rays;
+    if (left_cam_params.distortion_model_ == DistortionModel::EQUIDISTANT) {
+      cv::fisheye::undistortPoints(pixels,
+                                   rays,
+                                   left_cam_params.K_,
+                                   left_cam_params.distortion_coeff_mat_);
+    } else {
+      cv::undistortPoints(pixels,
+                          rays,
+                          left_cam_params.K_,
+                          left_cam_params.distortion_coeff_mat_);
+    }
+    left_rays_.reserve(rays.size());
+    for (const cv::Point2d& ray : rays) {
+      left_rays_.emplace_back(ray.x, ray.y, 1.0);
+    }
+  }
+
+  for (size_t k = 0u; k < nr_frames_; ++k) {
+    const double t = k * frame_period_s_;
+    const gtsam::Vector3 velocity =
+        (getBodyPose(t + kDerivativeStep).translation() -
+         getBodyPose(t - kDerivativeStep).translation()) /
+        (2.0 * kDerivativeStep);
+    gt_data_.map_to_gt_[toTimestamp(t)] = VioNavState(
+        getBodyPose(t), velocity, gtsam::imuBias::ConstantBias());
+  }
+  // Send first ground-truth pose to VIO for initialization if requested.
+  if (vio_params_.backend_params_->autoInitialize_ == 0 && nr_frames_ > 0u) {
+    vio_params_.backend_params_->initial_ground_truth_state_ =
+        gt_data_.map_to_gt_.begin()->second;
+  }
+
+  LOG(INFO) << "Synthetic dataset: " << nr_frames_ << " frames at "
+            << frame_rate << " Hz, IMU at " << imu_rate << " Hz, "
+            << landmarks_.size() << " landmarks.";
+}
+
+/* -------------------------------------------------------------------------- */
+SyntheticDataProvider::SyntheticDataProvider(const VioParams& vio_params)
+    : SyntheticDataProvider(
+          [] {
+            SyntheticWorldParams params;
+            params.wall_radius_m = FLAGS_synthetic_wall_radius;
+            params.wall_height_m = FLAGS_synthetic_wall_height;
+            params.landmark_density = FLAGS_synthetic_landmark_density;
+            params.trajectory_radius_m = FLAGS_synthetic_trajectory_radius;
+            params.angular_velocity_rad_s = FLAGS_synthetic_angular_velocity;
+            params.vertical_amplitude_m = FLAGS_synthetic_vertical_amplitude;
+            params.duration_s = FLAGS_synthetic_duration;
+            params.frame_rate_hz = FLAGS_synthetic_frame_rate;
+            params.imu_rate_hz = FLAGS_synthetic_imu_rate;
+            params.imu_noise = FLAGS_synthetic_imu_noise;
+            params.seed = static_cast<unsigned int>(FLAGS_synthetic_seed);
+            return params;
+          }(),
+          vio_params) {}
+
+/* -------------------------------------------------------------------------- */
+bool SyntheticDataProvider::spin() {
+  while (!shutdown_ && spinOnce()) {
+    if (!vio_params_.parallel_run_) {
+      // Return, instead of blocking, when running in sequential mode.
+      return true;
+    }
+  }
+  LOG_IF(INFO, shutdown_) << "SyntheticDataProvider shutdown requested.";
+  return false;
+}
+
+bool SyntheticDataProvider::hasData() const { return current_k_ < nr_frames_; }
+
+/* -------------------------------------------------------------------------- */
+gtsam::Pose3 SyntheticDataProvider::getBodyPose(const double& t) const {
+  const gtsam::Pose3& body_Pose_cam =
+      vio_params_.camera_params_.at(0).body_Pose_cam_;
+  return getLeftCameraPose(t) * body_Pose_cam.inverse();
+}
+
+ImuAccGyr SyntheticDataProvider::getImuMeasurement(const double& t) const {
+  const gtsam::Pose3 W_Pose_B = getBodyPose(t);
+  const gtsam::Pose3 W_Pose_B_before = getBodyPose(t - kDerivativeStep);
+  const gtsam::Pose3 W_Pose_B_after = getBodyPose(t + kDerivativeStep);
+  const gtsam::Vector3 W_acc =
+      (W_Pose_B_after.translation() - 2.0 * W_Pose_B.translation() +
+       W_Pose_B_before.translation()) /
+      (kDerivativeStep * kDerivativeStep);
+  const gtsam::Vector3 B_omega =
+      gtsam::Rot3::Logmap(
+          W_Pose_B_before.rotation().between(W_Pose_B_after.rotation())) /
+      (2.0 * kDerivativeStep);
+
+  ImuAccGyr acc_gyr;
+  acc_gyr << W_Pose_B.rotation().unrotate(W_acc -
+                                          vio_params_.imu_params_.n_gravity_),
+      B_omega;
+  return acc_gyr;
+}
+
+gtsam::Pose3 SyntheticDataProvider::getLeftCameraPose(const double& t) const {
+  const double theta = world_params_.angular_velocity_rad_s * t;
+  const gtsam::Point3 position(
+      world_params_.trajectory_radius_m * std::cos(theta),
+      world_params_.trajectory_radius_m * std::sin(theta),
+      0.5 * world_params_.wall_height_m +
+          world_params_.vertical_amplitude_m *
+              std::sin(2.0 * M_PI * world_params_.vertical_frequency_hz * t));
+  // Looking outwards (z), with the image rows (y) pointing down.
+  const gtsam::Point3 z_axis(std::cos(theta), std::sin(theta), 0.0);
+  const gtsam::Point3 y_axis(0.0, 0.0, -1.0);
+  return gtsam::Pose3(gtsam::Rot3(y_axis.cross(z_axis), y_axis, z_axis),
+                      position);
+}
+
+/* -------------------------------------------------------------------------- */
+bool SyntheticDataProvider::spinOnce() {
+  if (current_k_ >= nr_frames_) {
+    LOG(INFO) << "Finished spinning synthetic dataset.";
+    return false;
+  }
+
+  const double t = current_k_ * frame_period_s_;
+  // The frontend needs the IMU data up to the frame, and past it to know
+  // there is no more data before it.
+  sendImuDataUntil(t + imu_period_s_);
+
+  const FrameId frame_id = current_k_;
+  const Timestamp timestamp = toTimestamp(t);
+  VLOG(10) << "Sending frame k= " << frame_id
+           << " with timestamp: " << timestamp;
+  const gtsam::Pose3 W_Pose_left_cam = getLeftCameraPose(t);
+  const CameraParams& left_cam_params = vio_params_.camera_params_.at(0);
+  CHECK(left_frame_callback_);
+  left_frame_callback_(std::make_unique<Frame>(
+      frame_id,
+      timestamp,
+      left_cam_params,
+      renderImage(left_cam_params, W_Pose_left_cam)));
+  if (vio_params_.frontend_type_ == FrontendType::kStereoImu) {
+    CHECK(right_frame_callback_);
+    const CameraParams& right_cam_params = vio_params_.camera_params_.at(1);
+    const gtsam::Pose3 W_Pose_right_cam =
+        getBodyPose(t) * right_cam_params.body_Pose_cam_;
+    right_frame_callback_(std::make_unique<Frame>(
+        frame_id,
+        timestamp,
+        right_cam_params,
+        renderImage(right_cam_params, W_Pose_right_cam)));
+  } else if (vio_params_.frontend_type_ == FrontendType::kRgbdImu) {
+    CHECK(depth_frame_callback_);
+    depth_frame_callback_(std::make_unique<DepthFrame>(
+        frame_id, timestamp, renderDepth(W_Pose_left_cam)));
+  }
+
+  current_k_++;
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+void SyntheticDataProvider::sendImuDataUntil(const double& t) {
+  CHECK(imu_single_callback_) << "Did you forget to register the IMU callback?";
+  const ImuParams& imu_params = vio_params_.imu_params_;
+  // Discrete-time standard deviations of the white noise.
+  const double acc_sigma =
+      imu_params.acc_noise_density_ / std::sqrt(imu_period_s_);
+  const double gyro_sigma =
+      imu_params.gyro_noise_density_ / std::sqrt(imu_period_s_);
+  while (next_imu_idx_ * imu_period_s_ <= t) {
+    const double imu_t = next_imu_idx_ * imu_period_s_;
+    ImuAccGyr acc_gyr = getImuMeasurement(imu_t);
+    if (world_params_.imu_noise) {
+      for (int i = 0; i < 3; ++i) {
+        acc_gyr(i) += acc_sigma * imu_noise_(generator_);
+        acc_gyr(i + 3) += gyro_sigma * imu_noise_(generator_);
+      }
+    }
+    imu_single_callback_(ImuMeasurement(toTimestamp(imu_t), acc_gyr));
+    ++next_imu_idx_;
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+cv::Mat SyntheticDataProvider::renderImage(
+    const CameraParams& cam_params,
+    const gtsam::Pose3& W_Pose_cam) const {
+  std::vector<cv::Point3d> cam_points;
+  std::vector<const Landmark*> visible_landmarks;
+  cam_points.reserve(landmarks_.size());
+  visible_landmarks.reserve(landmarks_.size());
+  for (const Landmark& landmark : landmarks_) {
+    const gtsam::Point3 cam_point = W_Pose_cam.transformTo(landmark.position);
+    if (cam_point.z() > kNearPlane) {
+      cam_points.emplace_back(cam_point.x(), cam_point.y(), cam_point.z());
+      visible_landmarks.push_back(&landmark);
+    }
+  }
+
+  cv::Mat img(
+      cam_params.image_size_, CV_8UC1, cv::Scalar(kBackgroundIntensity));
+  if (cam_points.empty()) return img;
+  std::vector<cv::Point2d> pixels;
+  const cv::Mat zero = cv::Mat::zeros(3, 1, CV_64F);
+  switch (cam_params.distortion_model_) {
+    case DistortionModel::NONE:
+    case DistortionModel::RADTAN: {
+      cv::projectPoints(cam_points,
+                        zero,
+                        zero,
+                        cam_params.K_,
+                        cam_params.distortion_coeff_mat_,
+                        pixels);
+    } break;
+    case DistortionModel::EQUIDISTANT: {
+      cv::fisheye::projectPoints(cam_points,
+                                 pixels,
+                                 zero,
+                                 zero,
+                                 cam_params.K_,
+                                 cam_params.distortion_coeff_mat_);
+    } break;
+    default: {
+      LOG(FATAL) << "Distortion model not supported by the synthetic dataset: "
+                 << static_cast<int>(cam_params.distortion_model_);
+    } break;
+  }
+
+  // Far to near, so that the closest landmarks are on top.
+  std::vector<size_t> order(cam_points.size());
+  for (size_t i = 0u; i < order.size(); ++i) order[i] = i;
+  std::sort(order.begin(), order.end(), [&cam_points](size_t a, size_t b) {
+    return cam_points[a].z > cam_points[b].z;
+  });
+  const cv::Rect image_rect(cv::Point(0, 0), cam_params.image_size_);
+  const double fx = cam_params.K_.at<double>(0, 0);
+  for (const size_t& i : order) {
+    const cv::Point2d& pixel = pixels[i];
+    if (!image_rect.contains(pixel)) continue;
+    const int half_side = std::max(
+        1,
+        static_cast<int>(0.5 * fx * world_params_.landmark_size_m /
+                         cam_points[i].z));
+    const cv::Rect square(static_cast<int>(pixel.x) - half_side,
+                          static_cast<int>(pixel.y) - half_side,
+                          2 * half_side + 1,
+                          2 * half_side + 1);
+    img(square & image_rect).setTo(cv::Scalar(visible_landmarks[i]->intensity));
+  }
+  return img;
+}
+
+/* -------------------------------------------------------------------------- */
+cv::Mat SyntheticDataProvider::renderDepth(
+    const gtsam::Pose3& W_Pose_cam) const {
+  const CameraParams& cam_params = vio_params_.camera_params_.at(0);
+  CHECK_EQ(left_rays_.size(),
+           static_cast<size_t>(cam_params.image_size_.area()));
+  const float to_depth_units = 1.0f / cam_params.depth.depth_to_meters_;
+  const gtsam::Matrix3 R = W_Pose_cam.rotation().matrix();
+  const gtsam::Point3& c = W_Pose_cam.translation();
+  const double radius_sq =
+      world_params_.wall_radius_m * world_params_.wall_radius_m;
+  // Intersects c + s * R * ray with the wall: as the camera is inside the
+  // cylinder, the positive root is the one in front of it. s is the depth, as
+  // the rays have z = 1.
+  const double cc = c.x() * c.x() + c.y() * c.y() - radius_sq;
+  cv::Mat depth(cam_params.image_size_, CV_32FC1, cv::Scalar(0.0f));
+  float* depth_ptr = depth.ptr<float>();
+  for (size_t i = 0u; i < left_rays_.size(); ++i) {
+    const cv::Point3d& ray = left_rays_[i];
+    const gtsam::Vector3 dir = R * gtsam::Vector3(ray.x, ray.y, ray.z);
+    const double a = dir.x() * dir.x() + dir.y() * dir.y();
+    if (a < 1.0e-12) continue;
+    const double b = 2.0 * (c.x() * dir.x() + c.y() * dir.y());
+    const double s = (-b + std::sqrt(b * b - 4.0 * a * cc)) / (2.0 * a);
+    const double z = c.z() + s * dir.z();
+    if (s > kNearPlane && z >= 0.0 && z <= world_params_.wall_height_m) {
+      depth_ptr[i] = static_cast<float>(s) * to_depth_units;
+    }
+  }
+  return depth;
+}
+
+}  // namespace VIO
@@ -0,0 +1,342 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   VideoDataProvider.cpp
+ * @brief  Replays a dataset stored as video streams (see VideoDataProvider).
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/dataprovider/VideoDataProvider.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <opencv2/core/version.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "kimera-vio/frontend/DepthFrame.h"
+#include "kimera-vio/frontend/Frame.h"
+#include "kimera-vio/utils/FilesystemUtils.h"
+#include "kimera-vio/utils/ImageBufferPool.h"
+
+// Decoder params, e.g. hardware acceleration, are in OpenCV >= 4.5.2.
+#if CV_VERSION_MAJOR > 4 ||                              \
+    (CV_VERSION_MAJOR == 4 &&                            \
+     (CV_VERSION_MINOR > 5 ||                            \
+      (CV_VERSION_MINOR == 5 && CV_VERSION_REVISION >= 2)))
+#define KIMERA_VIDEOIO_HW_ACCELERATION
+#endif
+
+DEFINE_string(video_dataset_path,
+              "",
+              "Path of the video dataset to replay (see VideoDataProvider).");
+DEFINE_bool(video_hardware_decoding,
+            true,
+            "Decode video datasets with hardware decoders if available.");
+DEFINE_int32(video_decode_lookahead,
+             8,
+             "Max nr of frames decoded ahead of playback by a video decoding "
+             "thread, 0 to decode them synchronously when sent.");
+DECLARE_int64(initial_k);
+DECLARE_int64(final_k);
+
+namespace VIO {
+
+/* -------------------------------------------------------------------------- */
+VideoDataProvider::VideoDataProvider(const std::string& dataset_path,
+                                     const int& initial_k,
+                                     const int& final_k,
+                                     const VioParams& vio_params)
+    : DataProviderInterface(),
+      vio_params_(vio_params),
+      dataset_path_(dataset_path),
+      left_capture_(),
+      right_capture_(),
+      depth_capture_(),
+      next_decoded_k_(0u),
+      timestamps_(),
+      imu_measurements_(),
+      current_k_(0u),
+      final_k_(0u),
+      image_prefetcher_(nullptr) {
+  CHECK_GE(initial_k, 0);
+  CHECK_GT(final_k, initial_k) << "Value for final_k (" << final_k
+                               << ") is smaller than value for"
+                               << " initial_k (" << initial_k << ").";
+  CHECK(openStream("left", &left_capture_))
+      << "No left video stream in: " << dataset_path_;
+  if (openStream("right", &right_capture_)) {
+    CHECK_GE(vio_params_.camera_params_.size(), 2u);
+  }
+  openStream("depth", &depth_capture_);
+  parseTimestamps(common::pathAppend(dataset_path_, "frames.csv"));
+  parseImuData(common::pathAppend(dataset_path_, "imu.csv"));
+
+  current_k_ = static_cast<FrameId>(initial_k);
+  final_k_ = std::min(static_cast<FrameId>(final_k),
+                      static_cast<FrameId>(timestamps_.size()));
+
+  LOG(INFO) << "Video dataset " << dataset_path_ << ": "
+            << timestamps_.size() << " frames ("
+            << (hasRightStream() ? "stereo" : "mono")
+            << (hasDepthStream() ? " with depth" : "") << "), "
+            << imu_measurements_.size() << " IMU measurements.";
+}
+
+/* -------------------------------------------------------------------------- */
+VideoDataProvider::VideoDataProvider(const VioParams& vio_params)
+    : VideoDataProvider(FLAGS_video_dataset_path,
+                        FLAGS_initial_k,
+                        FLAGS_final_k,
+                        vio_params) {}
+
+/* -------------------------------------------------------------------------- */
+VideoDataProvider::~VideoDataProvider() {
+  // Stop decoding before the streams are closed.
+  image_prefetcher_.reset();
+}
+
+/* -------------------------------------------------------------------------- */
+bool VideoDataProvider::spin() {
+  if (!is_imu_data_sent_) {
+    // First, send all the IMU data. The flag is to avoid sending it several
+    // times if we are running in sequential mode.
+    if (imu_single_callback_) {
+      sendImuData();
+    } else {
+      LOG(ERROR) << "Imu callback not registered! Not sending IMU data.";
+    }
+    is_imu_data_sent_ = true;
+  }
+
+  while (!shutdown_ && spinOnce()) {
+    if (!vio_params_.parallel_run_) {
+      // Return, instead of blocking, when running in sequential mode.
+      return true;
+    }
+  }
+  LOG_IF(INFO, shutdown_) << "VideoDataProvider shutdown requested.";
+  return false;
+}
+
+bool VideoDataProvider::hasData() const { return current_k_ < final_k_; }
+
+/* -------------------------------------------------------------------------- */
+bool VideoDataProvider::spinOnce() {
+  if (current_k_ >= final_k_) {
+    LOG(INFO) << "Finished spinning video dataset.";
+    return false;
+  }
+
+  const Timestamp& timestamp = timestamps_.at(current_k_);
+  const std::vector<cv::Mat> images = getImages(current_k_);
+  CHECK_EQ(images.size(), 3u);
+  if (images[0].empty()) {
+    LOG(WARNING) << "Video streams end before frame k= " << current_k_
+                 << ", the last " << final_k_ - current_k_
+                 << " timestamps are ignored.";
+    final_k_ = current_k_;
+    return false;
+  }
+
+  VLOG(10) << "Sending frame k= " << current_k_
+           << " with timestamp: " << timestamp;
+  CHECK(left_frame_callback_);
+  left_frame_callback_(std::make_unique<Frame>(
+      current_k_, timestamp, vio_params_.camera_params_.at(0), images[0]));
+  if (!images[1].empty()) {
+    CHECK(right_frame_callback_);
+    right_frame_callback_(std::make_unique<Frame>(
+        current_k_, timestamp, vio_params_.camera_params_.at(1), images[1]));
+  }
+  if (!images[2].empty()) {
+    CHECK(depth_frame_callback_);
+    depth_frame_callback_(
+        std::make_unique<DepthFrame>(current_k_, timestamp, images[2]));
+  }
+
+  current_k_++;
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+void VideoDataProvider::sendImuData() const {
+  CHECK(imu_single_callback_) << "Did you forget to register the IMU callback?";
+  for (const ImuMeasurement& imu_meas : imu_measurements_) {
+    imu_single_callback_(imu_meas);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+bool VideoDataProvider::openStream(const std::string& name,
+                                   cv::VideoCapture* capture) const {
+  CHECK_NOTNULL(capture);
+  for (const std::string& extension : {".mkv", ".mp4"}) {
+    const std::string filename =
+        common::pathAppend(dataset_path_, name + extension);
+    if (!std::ifstream(filename).good()) continue;
+
+    bool hardware_accelerated = false;
+#ifdef KIMERA_VIDEOIO_HW_ACCELERATION
+    if (FLAGS_video_hardware_decoding) {
+      const std::vector<int> hw_params = {cv::CAP_PROP_HW_ACCELERATION,
+                                          cv::VIDEO_ACCELERATION_ANY};
+      if (capture->open(filename, cv::CAP_ANY, hw_params)) {
+        hardware_accelerated = capture->get(cv::CAP_PROP_HW_ACCELERATION) !=
+                               cv::VIDEO_ACCELERATION_NONE;
+      }
+    }
+#endif
+    if (!capture->isOpened() && !capture->open(filename, cv::CAP_ANY)) {
+      LOG(FATAL) << "Could not open a video decoder for: " << filename;
+    }
+    if (name == "depth") {
+      // Keep 16-bit depths instead of converting them to bgr24.
+      capture->set(cv::CAP_PROP_CONVERT_RGB, 0);
+    }
+    LOG(INFO) << "Replaying " << name << " stream " << filename << " ("
+              << (hardware_accelerated ? "hardware" : "software")
+              << " decoder).";
+    return true;
+  }
+  return false;
+}
+
+/* -------------------------------------------------------------------------- */
+void VideoDataProvider::parseTimestamps(const std::string& filename) {
+  std::ifstream fin(filename.c_str());
+  LOG_IF(FATAL, !fin.is_open()) << "Cannot open file: " << filename;
+  std::string line;
+  Timestamp previous_timestamp = -1;
+  while (std::getline(fin, line)) {
+    // Skip the header and empty lines.
+    if (line.empty() || line[0] == '#') continue;
+    const Timestamp timestamp = std::stoll(line.substr(0, line.find(',')));
+    CHECK_GT(timestamp, previous_timestamp)
+        << "Video frame timestamps are not in chronological order!";
+    timestamps_.push_back(timestamp);
+    previous_timestamp = timestamp;
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void VideoDataProvider::parseImuData(const std::string& filename) {
+  //#timestamp [ns],w_RS_S_x [rad s^-1],w_RS_S_y [rad s^-1],w_RS_S_z [rad s^-1],
+  // a_RS_S_x [m s^-2],a_RS_S_y [m s^-2],a_RS_S_z [m s^-2]
+  std::ifstream fin(filename.c_str());
+  LOG_IF(FATAL, !fin.is_open()) << "Cannot open file: " << filename;
+  std::string line;
+  Timestamp previous_timestamp = -1;
+  while (std::getline(fin, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    Timestamp timestamp = 0;
+    gtsam::Vector6 gyr_acc_data;
+    for (int i = 0; i < gyr_acc_data.size() + 1; i++) {
+      const size_t idx = line.find_first_of(',');
+      if (i == 0) {
+        timestamp = std::stoll(line.substr(0, idx));
+      } else {
+        gyr_acc_data(i - 1) = std::stod(line.substr(0, idx));
+      }
+      line = line.substr(idx + 1);
+    }
+    CHECK_GT(timestamp, previous_timestamp)
+        << "Video IMU data is not in chronological order!";
+    ImuAccGyr imu_accgyr;
+    // Acceleration first!
+    imu_accgyr << gyr_acc_data.tail(3), gyr_acc_data.head(3);
+    imu_measurements_.push_back(ImuMeasurement(timestamp, imu_accgyr));
+    previous_timestamp = timestamp;
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+std::vector<cv::Mat> VideoDataProvider::decodeFrame(const FrameId& k) {
+  CHECK_GE(k, next_decoded_k_) << "Video frames must be decoded in order.";
+  // Streams are only decoded sequentially: skip the frames before k.
+  for (; next_decoded_k_ < k; ++next_decoded_k_) {
+    left_capture_.grab();
+    if (right_capture_.isOpened()) right_capture_.grab();
+    if (depth_capture_.isOpened()) depth_capture_.grab();
+  }
+  ++next_decoded_k_;
+
+  cv::MatAllocator* allocator = &ImageBufferPool::getInstance();
+  const bool& equalize_image =
+      vio_params_.frontend_params_.stereo_matching_params_.equalize_image_;
+  const auto decode_gray = [allocator, &equalize_image](
+                               cv::VideoCapture* capture) {
+    cv::Mat decoded;
+    decoded.allocator = allocator;
+    if (!capture->isOpened() || !capture->read(decoded) || decoded.empty()) {
+      return cv::Mat();
+    }
+    cv::Mat img = decoded;
+    if (decoded.channels() > 1) {
+      img = cv::Mat();
+      img.allocator = allocator;
+      cv::cvtColor(decoded, img, cv::COLOR_BGR2GRAY);
+    }
+    if (equalize_image) cv::equalizeHist(img, img);
+    return img;
+  };
+
+  std::vector<cv::Mat> images(3u);
+  images[0] = decode_gray(&left_capture_);
+  images[1] = decode_gray(&right_capture_);
+  if (depth_capture_.isOpened()) {
+    cv::Mat decoded;
+    decoded.allocator = allocator;
+    if (depth_capture_.read(decoded) && !decoded.empty()) {
+      images[2] = unpackDepth(decoded, allocator);
+    }
+  }
+  return images;
+}
+
+/* -------------------------------------------------------------------------- */
+std::vector<cv::Mat> VideoDataProvider::getImages(const FrameId& k) {
+  if (FLAGS_video_decode_lookahead <= 0) {
+    return decodeFrame(k);
+  }
+  if (!image_prefetcher_) {
+    // A single thread, as the streams are decoded in order.
+    image_prefetcher_ = std::make_unique<ImagePrefetcher>(
+        [this](const FrameId& frame_k) { return decodeFrame(frame_k); },
+        k,
+        final_k_,
+        1u,
+        static_cast<size_t>(FLAGS_video_decode_lookahead));
+  }
+  return image_prefetcher_->get(k);
+}
+
+/* -------------------------------------------------------------------------- */
+cv::Mat VideoDataProvider::unpackDepth(const cv::Mat& decoded,
+                                       cv::MatAllocator* allocator) {
+  if (decoded.type() == CV_16UC1) return decoded;
+  CHECK_EQ(decoded.type(), CV_8UC3)
+      << "Depth streams must decode to gray16 or bgr24 frames.";
+  cv::Mat depth;
+  depth.allocator = allocator;
+  depth.create(decoded.size(), CV_16UC1);
+  for (int v = 0; v < decoded.rows; ++v) {
+    const cv::Vec3b* src = decoded.ptr<cv::Vec3b>(v);
+    uint16_t* dst = depth.ptr<uint16_t>(v);
+    for (int u = 0; u < decoded.cols; ++u) {
+      dst[u] = static_cast<uint16_t>(src[u][0] | (src[u][1] << 8));
+    }
+  }
+  return depth;
+}
+
+}  // namespace VIO
@@ -28,7 +28,8 @@ PointPlaneFactor::PointPlaneFactor(const Key& pointKey,
                                    const SharedNoiseModel& noiseModel)
     : Base(noiseModel, pointKey, planeKey),
       pointKey_(pointKey),
-      planeKey_(planeKey) {}
+      planeKey_(planeKey),
+      whitener_(noiseModel) {}
 
 void PointPlaneFactor::print(const string& s,
                              const KeyFormatter& keyFormatter) const {
@@ -41,26 +42,47 @@ Vector PointPlaneFactor::evaluateError(const Point3& point,
                                        const OrientedPlane3& plane,
                                        GtsamJacobianType H_point,
                                        GtsamJacobianType H_plane) const {
-  Vector err(1);
-  Unit3 plane_normal = plane.normal();
-  double plane_distance = plane.distance();
+  Matrix13 H_point_fixed, H_plane_fixed;
+  const double err = evaluateErrorFixed(point,
+                                        plane,
+                                        H_point ? &H_point_fixed : nullptr,
+                                        H_plane ? &H_plane_fixed : nullptr);
+  if (H_point) *H_point = H_point_fixed;
+  if (H_plane) *H_plane = H_plane_fixed;
+  return Vector1(err);
+}
+
+double PointPlaneFactor::evaluateErrorFixed(const Point3& point,
+                                            const OrientedPlane3& plane,
+                                            Matrix13* H_point,
+                                            Matrix13* H_plane) {
+  const Unit3& plane_normal = plane.normal();
+  const Point3& n = plane_normal.point3();
 
   if (H_point) {
-    *H_point = plane_normal.unitVector().transpose();
+    *H_point = n.transpose();
   }
 
   if (H_plane) {
-    Matrix43 H_plane_retract;
     // Jacobian of plane retraction when v = Vector3::Zero(), to speed-up
-    // computations.
-    H_plane_retract << plane_normal.basis(), Vector3::Zero(), 0, 0, 1;
-    Vector4 p;
-    p << point, -1;
-    *H_plane = p.transpose() * H_plane_retract;
+    // computations: [p^T * B, -1] with B the basis of the normal's tangent
+    // space, since d(n^T p - d) / d(v1, v2, vd) = (p^T B, -1).
+    H_plane->leftCols<2>() = point.transpose() * plane_normal.basis();
+    (*H_plane)(2) = -1.0;
   }
 
-  err << point.dot(plane_normal.unitVector()) - plane_distance;
-  return (err);
+  return point.dot(n) - plane.distance();
+}
+
+GaussianFactor::shared_ptr PointPlaneFactor::linearize(const Values& x) const {
+  if (!whitener_.isValidFor(noiseModel_)) return Base::linearize(x);
+  Matrix13 H_point, H_plane;
+  const double err = evaluateErrorFixed(x.at<Point3>(pointKey_),
+                                        x.at<OrientedPlane3>(planeKey_),
+                                        &H_point,
+                                        &H_plane);
+  return whitener_.linearize(
+      pointKey_, H_point, planeKey_, H_plane, Vector1(err));
 }
 
 gtsam::NonlinearFactor::shared_ptr PointPlaneFactor::clone() const {
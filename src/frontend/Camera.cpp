@@ -21,6 +21,7 @@
 
 #include <gtsam/geometry/Point2.h>
 
+#include "kimera-vio/frontend/CameraModels.h"
 #include "kimera-vio/frontend/CameraParams.h"
 #include "kimera-vio/utils/Macros.h"
 
@@ -34,7 +35,10 @@ Camera::Camera(const CameraParams& cam_params)
                    cam_params.intrinsics_.at(2),
                    cam_params.intrinsics_.at(3)),
       undistorter_(nullptr),
-      camera_impl_(nullptr) {
+      camera_impl_(nullptr),
+      undistorted_camera_model_(
+          CameraModelFactory::createUndistortedPinholeCameraModel(cam_params)),
+      omni_camera_model_(std::nullopt) {
   // NOTE: no rectification, use camera matrix as P for cv::undistortPoints
   // see https://stackoverflow.com/questions/22027419/bad-results-when-undistorting-points-using-opencv-in-python
   cv::Mat P = cam_params.K_;
@@ -45,6 +49,10 @@ Camera::Camera(const CameraParams& cam_params)
   camera_impl_ =
       std::make_unique<CameraImpl>(cam_params.body_Pose_cam_, calibration_);
   CHECK(camera_impl_);
+
+  if (cam_params.camera_model_ == CameraModel::OMNI) {
+    omni_camera_model_ = CameraModelFactory::createOmniCameraModel(cam_params);
+  }
 }
 
 void Camera::project(const LandmarksCV& lmks, KeypointsCV* kpts) const {
@@ -144,11 +152,9 @@ void Camera::projectPinhole(const LandmarksCV& lmks, KeypointsCV* kpts) const {
 
 void Camera::projectPinhole(const LandmarkCV& lmk, KeypointCV* kpt) const {
   CHECK_NOTNULL(kpt);
-  // I believe this project call in gtsam is quite inefficient as it goes
-  // through a cascade of calls... Only useful if you want gradients I guess...
-  CHECK(camera_impl_);
-  const gtsam::Point2& kp =
-      camera_impl_->project2(gtsam::Point3(lmk.x, lmk.y, lmk.z));
+  const gtsam::Point3 cam_lmk = cam_params_.body_Pose_cam_.transformTo(
+      gtsam::Point3(lmk.x, lmk.y, lmk.z));
+  const Eigen::Vector2d kp = undistorted_camera_model_.project(cam_lmk);
   // What if the keypoint is out of the image bounds?
   *kpt = KeypointCV(kp.x(), kp.y());
 }
@@ -170,14 +176,15 @@ void Camera::backProjectPinhole(const KeypointCV& kp,
                                 const Depth& depth,
                                 LandmarkCV* lmk) const {
   CHECK_NOTNULL(lmk);
-  CHECK(camera_impl_);
   CHECK_GT(depth, 0.0);
   CHECK_GE(kp.x, 0.0);
   CHECK_GE(kp.y, 0.0);
   CHECK_LT(kp.x, cam_params_.image_size_.width);
   CHECK_LT(kp.y, cam_params_.image_size_.height);
-  gtsam::Point2 uv(kp.x, kp.y);
-  gtsam::Point3 gtsam_lmk = camera_impl_->backproject(uv, depth);
+  const gtsam::Point3 cam_lmk =
+      depth * undistorted_camera_model_.unproject(Eigen::Vector2d(kp.x, kp.y));
+  const gtsam::Point3 gtsam_lmk =
+      cam_params_.body_Pose_cam_.transformFrom(cam_lmk);
   lmk->x = gtsam_lmk.x();
   lmk->y = gtsam_lmk.y();
   lmk->z = gtsam_lmk.z();
@@ -194,7 +201,12 @@ void Camera::projectOmni(const LandmarksCV& lmks, KeypointsCV* kpts) const {
 }
 
 void Camera::projectOmni(const LandmarkCV& lmk, KeypointCV* kpt) const {
-  LOG(FATAL) << "Camera: projectOmni not implemented!";
+  CHECK_NOTNULL(kpt);
+  CHECK(omni_camera_model_);
+  // NOTE: inverse of backProjectOmni, hence in the camera frame.
+  const Eigen::Vector2d kp =
+      omni_camera_model_->project(Eigen::Vector3d(lmk.x, lmk.y, lmk.z));
+  *kpt = KeypointCV(kp.x(), kp.y());
 }
 
 void Camera::backProjectOmni(const KeypointsCV& kps,
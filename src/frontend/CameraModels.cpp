@@ -0,0 +1,90 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   CameraModels.cpp
+ * @brief  Camera models specialized at compile time for each projection and
+ * distortion model, for the per-keypoint projections.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/frontend/CameraModels.h"
+
+#include <glog/logging.h>
+
+#include "kimera-vio/frontend/CameraParams.h"
+#include "kimera-vio/utils/Macros.h"
+
+namespace VIO {
+
+bool CameraModelFactory::createPinholeCameraModel(
+    const CameraParams& cam_params,
+    PinholeCameraModelVariant* model) {
+  CHECK_NOTNULL(model);
+  if (cam_params.camera_model_ != CameraModel::PINHOLE) return false;
+  const CameraParams::Intrinsics& intrinsics = cam_params.intrinsics_;
+  const std::vector<double>& coeffs = cam_params.distortion_coeff_;
+  switch (cam_params.distortion_model_) {
+    case DistortionModel::NONE: {
+      *model = createUndistortedPinholeCameraModel(cam_params);
+      return true;
+    }
+    case DistortionModel::RADTAN: {
+      // OpenCV's rational and thin prism coefficients are not supported.
+      if (coeffs.size() != 4u && coeffs.size() != 5u) return false;
+      *model = PinholeCameraModel<RadTanDistortion>(
+          intrinsics[0],
+          intrinsics[1],
+          intrinsics[2],
+          intrinsics[3],
+          RadTanDistortion(coeffs[0],
+                           coeffs[1],
+                           coeffs[2],
+                           coeffs[3],
+                           coeffs.size() == 5u ? coeffs[4] : 0.0));
+      return true;
+    }
+    case DistortionModel::EQUIDISTANT: {
+      if (coeffs.size() != 4u) return false;
+      *model = PinholeCameraModel<EquidistantDistortion>(
+          intrinsics[0],
+          intrinsics[1],
+          intrinsics[2],
+          intrinsics[3],
+          EquidistantDistortion(coeffs[0], coeffs[1], coeffs[2], coeffs[3]));
+      return true;
+    }
+    default: {
+      return false;
+    }
+  }
+}
+
+PinholeCameraModel<NoDistortion>
+CameraModelFactory::createUndistortedPinholeCameraModel(
+    const CameraParams& cam_params) {
+  const CameraParams::Intrinsics& intrinsics = cam_params.intrinsics_;
+  return PinholeCameraModel<NoDistortion>(
+      intrinsics[0], intrinsics[1], intrinsics[2], intrinsics[3]);
+}
+
+OmniCameraModel CameraModelFactory::createOmniCameraModel(
+    const CameraParams& cam_params) {
+  CHECK(cam_params.camera_model_ == CameraModel::OMNI)
+      << "Camera " << cam_params.camera_id_ << " is not an omni camera.";
+  CHECK_EQ(cam_params.distortion_coeff_.size(), 5u);
+  OmniCameraModel::Polynomial polynomial;
+  for (int i = 0; i < polynomial.size(); ++i) {
+    polynomial(i) = cam_params.distortion_coeff_[i];
+  }
+  return OmniCameraModel(polynomial,
+                         cam_params.omni_distortion_center_,
+                         cam_params.omni_affine_);
+}
+
+}  // namespace VIO
@@ -17,9 +17,12 @@
 
 #include <gtsam/navigation/ImuBias.h>
 
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <opencv2/core/eigen.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
 
 namespace VIO {
 
@@ -55,6 +58,19 @@ bool CameraParams::parseYAML(const std::string& filepath) {
     depth.valid = false;
   }
 
+  // Static region of interest: an image, relative to the yaml file.
+  if (yaml_parser.hasParam("roi_mask")) {
+    std::string roi_mask_path;
+    yaml_parser.getYamlParam("roi_mask", &roi_mask_path);
+    std::filesystem::path path(roi_mask_path);
+    if (path.is_relative()) {
+      path = std::filesystem::path(filepath).parent_path() / path;
+    }
+    const cv::Mat roi_mask = cv::imread(path.string(), cv::IMREAD_GRAYSCALE);
+    CHECK(!roi_mask.empty()) << "Cannot read the roi mask: " << path;
+    setRoiMask(roi_mask);
+  }
+
   // P_ = R_rectify_ * camera_matrix_;
   return true;
 }
@@ -259,6 +275,66 @@ void CameraParams::createGtsamCalibration(const cv::Mat& distortion,
                                 distortion.at<double>(0, 3));  // p2 (k4)
 }
 
+void CameraParams::downscale(const int& factor) {
+  CHECK_GE(factor, 1);
+  CHECK_EQ(downscale_factor_, 1) << "Camera params already downscaled.";
+  if (factor == 1) return;
+  downscale_factor_ = factor;
+  const double scale = 1.0 / static_cast<double>(factor);
+
+  // cv::INTER_AREA maps the pixel centers as x' = (x + 0.5) / factor - 0.5.
+  const auto scale_center = [scale](const double& c) {
+    return (c + 0.5) * scale - 0.5;
+  };
+  image_size_ = cv::Size(image_size_.width / factor,
+                         image_size_.height / factor);
+  intrinsics_[0] *= scale;
+  intrinsics_[1] *= scale;
+  intrinsics_[2] = scale_center(intrinsics_[2]);
+  intrinsics_[3] = scale_center(intrinsics_[3]);
+  convertIntrinsicsVectorToMatrix(intrinsics_, &K_);
+  if (camera_model_ == CameraModel::OMNI) {
+    omni_distortion_center_ = omni_distortion_center_.unaryExpr(scale_center);
+  }
+
+  if (depth.valid && !depth.K_.empty()) {
+    depth.K_ = depth.K_.clone();
+    depth.K_.at<double>(0, 0) *= scale;
+    depth.K_.at<double>(1, 1) *= scale;
+    depth.K_.at<double>(0, 2) = scale_center(depth.K_.at<double>(0, 2));
+    depth.K_.at<double>(1, 2) = scale_center(depth.K_.at<double>(1, 2));
+  }
+
+  if (hasRoiMask()) {
+    // Pixels partially outside the region of interest are dropped.
+    cv::Mat roi_mask;
+    cv::resize(roi_mask_, roi_mask, image_size_, 0.0, 0.0, cv::INTER_AREA);
+    setRoiMask(roi_mask);
+  }
+}
+
+void CameraParams::setRoiMask(const cv::Mat& roi_mask) {
+  if (roi_mask.empty()) {
+    roi_mask_ = cv::Mat();
+    roi_bbox_ = cv::Rect();
+    return;
+  }
+  CHECK_EQ(roi_mask.type(), CV_8UC1);
+  CHECK(roi_mask.size() == image_size_)
+      << "The roi mask must have the size of the image: " << image_size_;
+  // Binarize: interpolated masks (e.g. downscaled) only keep full pixels.
+  cv::compare(roi_mask, 255, roi_mask_, cv::CMP_EQ);
+  roi_bbox_ = cv::boundingRect(roi_mask_);
+  LOG_IF(WARNING, roi_bbox_.empty())
+      << "Empty roi mask for camera " << camera_id_ << ": nothing to track.";
+}
+
+KeypointCV CameraParams::toOriginalPixels(const KeypointCV& px) const {
+  const float factor = static_cast<float>(downscale_factor_);
+  return KeypointCV((px.x + 0.5f) * factor - 0.5f,
+                    (px.y + 0.5f) * factor - 0.5f);
+}
+
 //! Display all params.
 void CameraParams::print() const {
   std::stringstream out;
@@ -279,6 +355,10 @@ void CameraParams::print() const {
                         image_size_.width,
                         "- height",
                         image_size_.height,
+                        "downscale_factor_: ",
+                        downscale_factor_,
+                        "roi_bbox_: ",
+                        roi_bbox_,
                         "depth_: \n- virtual_baseline",
                         depth.virtual_baseline_,
                         "- depth_to_meters",
@@ -288,7 +368,11 @@ void CameraParams::print() const {
                         "- max_depth",
                         depth.max_depth_,
                         "- is_registered",
-                        depth.is_registered_);
+                        depth.is_registered_,
+                        "- pyramid_level",
+                        depth.pyramid_level_,
+                        "- max_depth_discontinuity",
+                        depth.max_depth_discontinuity_);
 
   LOG(INFO) << out.str();
   LOG(INFO) << "- body_Pose_cam_: " << body_Pose_cam_ << '\n'
@@ -325,7 +409,11 @@ bool CameraParams::equals(const CameraParams& cam_par,
         floatWithinTol(
             depth.depth_to_meters_, cam_par.depth.depth_to_meters_, tol) &&
         floatWithinTol(depth.min_depth_, cam_par.depth.min_depth_, tol) &&
-        floatWithinTol(depth.max_depth_, cam_par.depth.max_depth_, tol);
+        floatWithinTol(depth.max_depth_, cam_par.depth.max_depth_, tol) &&
+        depth.pyramid_level_ == cam_par.depth.pyramid_level_ &&
+        floatWithinTol(depth.max_depth_discontinuity_,
+                       cam_par.depth.max_depth_discontinuity_,
+                       tol);
   }
 
   return camera_id_ == cam_par.camera_id_ && areIntrinsicEqual &&
@@ -334,6 +422,12 @@ bool CameraParams::equals(const CameraParams& cam_par,
          floatWithinTol(frame_rate_, cam_par.frame_rate_, tol) &&
          (image_size_.width == cam_par.image_size_.width) &&
          (image_size_.height == cam_par.image_size_.height) &&
+         downscale_factor_ == cam_par.downscale_factor_ &&
+         roi_bbox_ == cam_par.roi_bbox_ &&
+         (roi_mask_.empty()
+              ? cam_par.roi_mask_.empty()
+              : !cam_par.roi_mask_.empty() &&
+                    cv::countNonZero(roi_mask_ != cam_par.roi_mask_) == 0) &&
          UtilsOpenCV::compareCvMatsUpToTol(K_, cam_par.K_) &&
          UtilsOpenCV::compareCvMatsUpToTol(distortion_coeff_mat_,
                                            cam_par.distortion_coeff_mat_);
@@ -346,6 +440,14 @@ void CameraParams::parseDepthParams(const YamlParser& yaml_parser) {
   yaml_parser.getYamlParam("min_depth", &depth.min_depth_);
   yaml_parser.getYamlParam("max_depth", &depth.max_depth_);
   yaml_parser.getYamlParam("is_registered", &depth.is_registered_);
+  if (yaml_parser.hasParam("depth_pyramid_level")) {
+    yaml_parser.getYamlParam("depth_pyramid_level", &depth.pyramid_level_);
+    CHECK_GE(depth.pyramid_level_, 0);
+  }
+  if (yaml_parser.hasParam("max_depth_discontinuity")) {
+    yaml_parser.getYamlParam("max_depth_discontinuity",
+                             &depth.max_depth_discontinuity_);
+  }
 
   if (!depth.is_registered_) {
     std::vector<double> pose_elements;
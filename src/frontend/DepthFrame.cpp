@@ -13,10 +13,16 @@
  */
 #include "kimera-vio/frontend/DepthFrame.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
 #include <opencv2/core/core.hpp>
 #include <opencv2/rgbd.hpp>
 
 #include "kimera-vio/frontend/CameraParams.h"
+#include "kimera-vio/utils/DepthCodec.h"
 
 namespace VIO {
 
@@ -35,7 +41,8 @@ DepthFrame::DepthFrame(const DepthFrame& other)
       id_(other.id_),
       depth_img_(other.depth_img_),
       is_registered_(other.is_registered_),
-      registered_img_(other.registered_img_) {}
+      registered_img_(other.registered_img_),
+      depth_pyramid_(other.depth_pyramid_) {}
 
 float DepthFrame::getDepthAtPoint(const CameraParams& params,
                                   const KeypointCV& point) const {
@@ -73,6 +80,125 @@ float DepthFrame::getDepthAtPoint(const CameraParams& params,
   return depth;
 }
 
+namespace {
+
+//! Halves the depth image taking the median of the valid depths of each 2x2
+//! block (NaN if none is valid).
+void downsampleDepth(const cv::Mat& depth,
+                     const float& min_depth,
+                     cv::Mat* downsampled) {
+  CHECK_NOTNULL(downsampled);
+  CHECK_EQ(depth.type(), CV_32FC1);
+  downsampled->create(depth.rows / 2, depth.cols / 2, CV_32FC1);
+  for (int r = 0; r < downsampled->rows; ++r) {
+    const float* row0 = depth.ptr<float>(2 * r);
+    const float* row1 = depth.ptr<float>(2 * r + 1);
+    float* out = downsampled->ptr<float>(r);
+    for (int c = 0; c < downsampled->cols; ++c) {
+      float values[4];
+      int n = 0;
+      for (const float& v :
+           {row0[2 * c], row0[2 * c + 1], row1[2 * c], row1[2 * c + 1]}) {
+        // NaN fails the comparison, hence it is skipped as well.
+        if (v >= min_depth) values[n++] = v;
+      }
+      switch (n) {
+        case 0:
+          out[c] = std::numeric_limits<float>::quiet_NaN();
+          break;
+        case 1:
+          out[c] = values[0];
+          break;
+        case 2:
+          out[c] = 0.5f * (values[0] + values[1]);
+          break;
+        default:
+          // Median of 3, or mean of the two middle values of 4.
+          std::sort(values, values + n);
+          out[c] = n == 3 ? values[1] : 0.5f * (values[1] + values[2]);
+          break;
+      }
+    }
+  }
+}
+
+}  // namespace
+
+const std::vector<cv::Mat>& DepthFrame::getDepthPyramid(
+    const CameraParams& params,
+    const int& level) const {
+  CHECK_GE(level, 0);
+  if (depth_pyramid_.empty()) {
+    const cv::Mat& img = is_registered_ ? registered_img_ : depth_img_;
+    depth_pyramid_.emplace_back();
+    img.convertTo(
+        depth_pyramid_.back(), CV_32FC1, params.depth.depth_to_meters_);
+  }
+  while (static_cast<int>(depth_pyramid_.size()) <= level) {
+    const cv::Mat& finer = depth_pyramid_.back();
+    if (finer.rows < 2 || finer.cols < 2) break;
+    cv::Mat coarser;
+    downsampleDepth(finer, params.depth.min_depth_, &coarser);
+    depth_pyramid_.push_back(coarser);
+  }
+  return depth_pyramid_;
+}
+
+void DepthFrame::getDepthsAtPoints(const CameraParams& params,
+                                   const KeypointsCV& points,
+                                   std::vector<float>* depths) const {
+  CHECK_NOTNULL(depths)->clear();
+  depths->reserve(points.size());
+  const int& level = params.depth.pyramid_level_;
+  const float& max_discontinuity = params.depth.max_depth_discontinuity_;
+  if (level == 0 && max_discontinuity <= 0.0f) {
+    // Plain lookups at full resolution, no need for the pyramid.
+    for (const KeypointCV& point : points) {
+      depths->push_back(getDepthAtPoint(params, point));
+    }
+    return;
+  }
+
+  const std::vector<cv::Mat>& pyramid = getDepthPyramid(params, level);
+  const int used_level = std::min(level, static_cast<int>(pyramid.size()) - 1);
+  const cv::Mat& depth = pyramid[used_level];
+  const float scale = 1.0f / static_cast<float>(1 << used_level);
+  const float& min_depth = params.depth.min_depth_;
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  for (const KeypointCV& point : points) {
+    const int x = static_cast<int>(point.x * scale);
+    const int y = static_cast<int>(point.y * scale);
+    if (point.x < 0.0f || point.y < 0.0f || x >= depth.cols ||
+        y >= depth.rows) {
+      depths->push_back(nan);
+      continue;
+    }
+    const float center = depth.at<float>(y, x);
+    if (!(center >= min_depth)) {
+      depths->push_back(nan);
+      continue;
+    }
+
+    bool on_edge = false;
+    if (max_discontinuity > 0.0f) {
+      // Cheap neighbourhood check: valid neighbours must be close in depth.
+      const int r0 = std::max(y - 1, 0), r1 = std::min(y + 1, depth.rows - 1);
+      const int c0 = std::max(x - 1, 0), c1 = std::min(x + 1, depth.cols - 1);
+      for (int r = r0; r <= r1 && !on_edge; ++r) {
+        const float* row = depth.ptr<float>(r);
+        for (int c = c0; c <= c1; ++c) {
+          if (row[c] >= min_depth &&
+              std::abs(row[c] - center) > max_discontinuity) {
+            on_edge = true;
+            break;
+          }
+        }
+      }
+    }
+    depths->push_back(on_edge ? nan : center);
+  }
+}
+
 cv::Mat DepthFrame::getDetectionMask(const CameraParams& params) const {
   float min = params.depth.min_depth_ * 1.0f / params.depth.depth_to_meters_;
   float max = params.depth.max_depth_ * 1.0f / params.depth.depth_to_meters_;
@@ -109,6 +235,41 @@ void DepthFrame::registerDepth(const CameraParams& params) const {
                           params.image_size_,
                           registered_img_);
   is_registered_ = true;
+  // The pyramid, if any, was built from the unregistered depth.
+  depth_pyramid_.clear();
+}
+
+void DepthFrame::encode(std::vector<std::uint8_t>* bytes,
+                        const float& float_step) const {
+  CHECK_NOTNULL(bytes);
+  const size_t offset = bytes->size();
+  bytes->resize(offset + sizeof(id_) + sizeof(timestamp_));
+  std::memcpy(bytes->data() + offset, &id_, sizeof(id_));
+  std::memcpy(
+      bytes->data() + offset + sizeof(id_), &timestamp_, sizeof(timestamp_));
+  DepthCodec::encode(depth_img_, float_step, bytes);
+}
+
+DepthFrame::UniquePtr DepthFrame::decode(const std::vector<std::uint8_t>& bytes,
+                                         size_t* offset) {
+  CHECK_NOTNULL(offset);
+  FrameId id;
+  Timestamp timestamp;
+  if (*offset > bytes.size() ||
+      bytes.size() - *offset < sizeof(id) + sizeof(timestamp)) {
+    LOG(ERROR) << "Truncated depth frame.";
+    return nullptr;
+  }
+  std::memcpy(&id, bytes.data() + *offset, sizeof(id));
+  std::memcpy(
+      &timestamp, bytes.data() + *offset + sizeof(id), sizeof(timestamp));
+  size_t depth_offset = *offset + sizeof(id) + sizeof(timestamp);
+  cv::Mat depth_img;
+  if (!DepthCodec::decode(bytes, &depth_offset, &depth_img)) {
+    return nullptr;
+  }
+  *offset = depth_offset;
+  return std::make_unique<DepthFrame>(id, timestamp, depth_img);
 }
 
 }  // namespace VIO
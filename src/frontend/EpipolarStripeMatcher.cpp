@@ -0,0 +1,204 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   EpipolarStripeMatcher.cpp
+ * @brief  Dedicated SSD/NCC kernel to search a template along a horizontal
+ * stripe of a rectified image.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/frontend/EpipolarStripeMatcher.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <glog/logging.h>
+
+#include "kimera-vio/utils/SimdKernels.h"
+
+namespace VIO {
+
+EpipolarStripeMatcher::EpipolarStripeMatcher(
+    const StereoMatchingKernelType& kernel_type)
+    : kernel_type_(kernel_type), col_sums_(), col_sq_sums_() {
+  CHECK(kernel_type_ != StereoMatchingKernelType::kOpenCvTemplateMatching)
+      << "EpipolarStripeMatcher does not implement OpenCV template matching.";
+}
+
+void EpipolarStripeMatcher::match(const cv::Mat& left_img,
+                                  const cv::Rect& templ_rect,
+                                  const cv::Mat& right_img,
+                                  const cv::Rect& stripe_rect,
+                                  cv::Point* best_loc,
+                                  double* score) {
+  CHECK_NOTNULL(best_loc);
+  CHECK_NOTNULL(score);
+  CHECK_EQ(left_img.type(), CV_8UC1);
+  CHECK_EQ(right_img.type(), CV_8UC1);
+  CHECK_GE(stripe_rect.width, templ_rect.width);
+  CHECK_GE(stripe_rect.height, templ_rect.height);
+  DCHECK((templ_rect & cv::Rect(0, 0, left_img.cols, left_img.rows)) ==
+         templ_rect);
+  DCHECK((stripe_rect & cv::Rect(0, 0, right_img.cols, right_img.rows)) ==
+         stripe_rect);
+
+  switch (kernel_type_) {
+    case StereoMatchingKernelType::kSsd: {
+      matchSsd(left_img, templ_rect, right_img, stripe_rect, best_loc, score);
+      break;
+    }
+    case StereoMatchingKernelType::kNcc: {
+      matchNcc(left_img, templ_rect, right_img, stripe_rect, best_loc, score);
+      break;
+    }
+    default: {
+      LOG(FATAL) << "Unknown stereo matching kernel type: "
+                 << VIO::to_underlying(kernel_type_);
+    }
+  }
+}
+
+void EpipolarStripeMatcher::matchSsd(const cv::Mat& left_img,
+                                     const cv::Rect& templ_rect,
+                                     const cv::Mat& right_img,
+                                     const cv::Rect& stripe_rect,
+                                     cv::Point* best_loc,
+                                     double* score) {
+  const int result_cols = stripe_rect.width - templ_rect.width + 1;
+  const int result_rows = stripe_rect.height - templ_rect.height + 1;
+
+  uint64_t min_ssd = std::numeric_limits<uint64_t>::max();
+  *best_loc = cv::Point(0, 0);
+  for (int dy = 0; dy < result_rows; ++dy) {
+    for (int dx = 0; dx < result_cols; ++dx) {
+      uint64_t ssd = 0u;
+      for (int r = 0; r < templ_rect.height && ssd < min_ssd; ++r) {
+        const uint8_t* templ_row =
+            left_img.ptr<uint8_t>(templ_rect.y + r) + templ_rect.x;
+        const uint8_t* stripe_row =
+            right_img.ptr<uint8_t>(stripe_rect.y + dy + r) + stripe_rect.x +
+            dx;
+        ssd += ssdRow(templ_row, stripe_row, templ_rect.width);
+      }
+      // Strict comparison: keep the first minimum as cv::minMaxLoc does.
+      if (ssd < min_ssd) {
+        min_ssd = ssd;
+        *best_loc = cv::Point(dx, dy);
+      }
+    }
+  }
+
+  // The OpenCV path min-max normalizes the SSD image before taking its
+  // minimum, so the score of the best match is always 0: keep the same
+  // semantics to make both paths interchangeable.
+  *score = 0.0;
+}
+
+void EpipolarStripeMatcher::matchNcc(const cv::Mat& left_img,
+                                     const cv::Rect& templ_rect,
+                                     const cv::Mat& right_img,
+                                     const cv::Rect& stripe_rect,
+                                     cv::Point* best_loc,
+                                     double* score) {
+  const int result_cols = stripe_rect.width - templ_rect.width + 1;
+  const int result_rows = stripe_rect.height - templ_rect.height + 1;
+  const double n = static_cast<double>(templ_rect.area());
+
+  // Template statistics.
+  uint64_t templ_sum = 0u;
+  uint64_t templ_sq_sum = 0u;
+  for (int r = 0; r < templ_rect.height; ++r) {
+    const uint8_t* templ_row =
+        left_img.ptr<uint8_t>(templ_rect.y + r) + templ_rect.x;
+    for (int c = 0; c < templ_rect.width; ++c) templ_sum += templ_row[c];
+    templ_sq_sum += dotRow(templ_row, templ_row, templ_rect.width);
+  }
+  const double templ_var =
+      static_cast<double>(templ_sq_sum) -
+      static_cast<double>(templ_sum) * static_cast<double>(templ_sum) / n;
+
+  col_sums_.resize(stripe_rect.width);
+  col_sq_sums_.resize(stripe_rect.width);
+
+  double best_zncc = -1.0;
+  *best_loc = cv::Point(0, 0);
+  for (int dy = 0; dy < result_rows; ++dy) {
+    // Column sums of the stripe rows covered by the template at this dy.
+    std::fill(col_sums_.begin(), col_sums_.end(), 0u);
+    std::fill(col_sq_sums_.begin(), col_sq_sums_.end(), 0u);
+    for (int r = 0; r < templ_rect.height; ++r) {
+      const uint8_t* stripe_row =
+          right_img.ptr<uint8_t>(stripe_rect.y + dy + r) + stripe_rect.x;
+      for (int c = 0; c < stripe_rect.width; ++c) {
+        const uint32_t v = stripe_row[c];
+        col_sums_[c] += v;
+        col_sq_sums_[c] += v * v;
+      }
+    }
+
+    // Sliding window sums along the stripe.
+    uint64_t win_sum = 0u;
+    uint64_t win_sq_sum = 0u;
+    for (int c = 0; c < templ_rect.width; ++c) {
+      win_sum += col_sums_[c];
+      win_sq_sum += col_sq_sums_[c];
+    }
+    for (int dx = 0; dx < result_cols; ++dx) {
+      if (dx > 0) {
+        win_sum += col_sums_[dx + templ_rect.width - 1];
+        win_sum -= col_sums_[dx - 1];
+        win_sq_sum += col_sq_sums_[dx + templ_rect.width - 1];
+        win_sq_sum -= col_sq_sums_[dx - 1];
+      }
+
+      uint64_t cross = 0u;
+      for (int r = 0; r < templ_rect.height; ++r) {
+        const uint8_t* templ_row =
+            left_img.ptr<uint8_t>(templ_rect.y + r) + templ_rect.x;
+        const uint8_t* stripe_row =
+            right_img.ptr<uint8_t>(stripe_rect.y + dy + r) + stripe_rect.x +
+            dx;
+        cross += dotRow(templ_row, stripe_row, templ_rect.width);
+      }
+
+      const double stripe_var =
+          static_cast<double>(win_sq_sum) -
+          static_cast<double>(win_sum) * static_cast<double>(win_sum) / n;
+      const double denominator = std::sqrt(templ_var * stripe_var);
+      const double zncc =
+          denominator > std::numeric_limits<double>::epsilon()
+              ? (static_cast<double>(cross) -
+                 static_cast<double>(templ_sum) *
+                     static_cast<double>(win_sum) / n) /
+                    denominator
+              : 0.0;
+      if (zncc > best_zncc) {
+        best_zncc = zncc;
+        *best_loc = cv::Point(dx, dy);
+      }
+    }
+  }
+
+  *score = (1.0 - best_zncc) / 2.0;
+}
+
+uint32_t EpipolarStripeMatcher::ssdRow(const uint8_t* a,
+                                       const uint8_t* b,
+                                       const int& n) {
+  return utils::SimdKernels::get().ssd_row(a, b, n);
+}
+
+uint32_t EpipolarStripeMatcher::dotRow(const uint8_t* a,
+                                       const uint8_t* b,
+                                       const int& n) {
+  return utils::SimdKernels::get().dot_row(a, b, n);
+}
+
+}  // namespace VIO
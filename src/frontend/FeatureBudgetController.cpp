@@ -0,0 +1,145 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   FeatureBudgetController.cpp
+ * @brief  Adapts the number of features, the KLT pyramid levels and the
+ * RANSAC iterations per keyframe to the measured latency, to meet a target.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/frontend/FeatureBudgetController.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+#include "kimera-vio/utils/Statistics.h"
+
+namespace VIO {
+
+FeatureBudgetController::FeatureBudgetController(
+    const FeatureBudgetControllerParams& params,
+    const int& max_features_per_frame,
+    const int& klt_max_level,
+    const int& ransac_max_iterations)
+    : params_(params),
+      // A floor above the configured value is not a floor.
+      max_max_features_per_frame_(
+          std::max(max_features_per_frame, params.min_features_per_frame)),
+      max_klt_max_level_(std::max(klt_max_level, params.min_klt_max_level)),
+      max_ransac_max_iterations_(
+          std::max(ransac_max_iterations, params.min_ransac_max_iterations)),
+      max_features_per_frame_(max_max_features_per_frame_),
+      klt_max_level_(max_klt_max_level_),
+      ransac_max_iterations_(max_ransac_max_iterations_),
+      filtered_latency_ms_(0.0),
+      nr_measurements_(0u),
+      keyframes_since_decision_(0u) {
+  CHECK_GT(params_.target_latency_ms, 0.0);
+  CHECK_GT(params_.slack_ratio, 0.0);
+  CHECK_LT(params_.slack_ratio, 1.0);
+  CHECK_GT(params_.time_filter_weight, 0.0);
+  CHECK_LE(params_.time_filter_weight, 1.0);
+  CHECK_GT(params_.min_features_per_frame, 0);
+  CHECK_GT(params_.features_step, 0);
+  CHECK_GE(params_.min_klt_max_level, 0);
+  CHECK_GT(params_.min_ransac_max_iterations, 0);
+  CHECK_GT(params_.ransac_iterations_step, 0);
+}
+
+bool FeatureBudgetController::update(const double& latency_ms) {
+  filtered_latency_ms_ =
+      nr_measurements_ == 0u
+          ? latency_ms
+          : params_.time_filter_weight * latency_ms +
+                (1.0 - params_.time_filter_weight) * filtered_latency_ms_;
+  ++nr_measurements_;
+  ++keyframes_since_decision_;
+  static const utils::StatsCollector latency_stats(
+      "Frontend Budget Filtered Latency [ms]");
+  static const utils::StatsCollector features_stats(
+      "Frontend Budget Features [#]");
+  static const utils::StatsCollector klt_level_stats(
+      "Frontend Budget KLT Max Level");
+  static const utils::StatsCollector ransac_stats(
+      "Frontend Budget RANSAC Iterations");
+  latency_stats.AddSample(filtered_latency_ms_);
+  features_stats.AddSample(max_features_per_frame_);
+  klt_level_stats.AddSample(klt_max_level_);
+  ransac_stats.AddSample(ransac_max_iterations_);
+  if (keyframes_since_decision_ <= params_.cooldown_keyframes) return false;
+
+  const int prev_max_features_per_frame = max_features_per_frame_;
+  const int prev_klt_max_level = klt_max_level_;
+  const int prev_ransac_max_iterations = ransac_max_iterations_;
+  bool changed = false;
+  if (filtered_latency_ms_ > params_.target_latency_ms) {
+    changed = shrink();
+  } else if (filtered_latency_ms_ <
+             params_.slack_ratio * params_.target_latency_ms) {
+    changed = grow();
+  }
+
+  if (changed) {
+    keyframes_since_decision_ = 0u;
+    static const utils::StatsCollector decisions_stats(
+        "Frontend Budget Decisions");
+    decisions_stats.IncrementOne();
+    VLOG(1) << "Feature budget controller: latency " << filtered_latency_ms_
+            << " [ms] (target " << params_.target_latency_ms
+            << " [ms]), features " << prev_max_features_per_frame << " -> "
+            << max_features_per_frame_ << ", KLT max level "
+            << prev_klt_max_level << " -> " << klt_max_level_
+            << ", RANSAC iterations " << prev_ransac_max_iterations << " -> "
+            << ransac_max_iterations_ << ".";
+  }
+  return changed;
+}
+
+bool FeatureBudgetController::shrink() {
+  if (max_features_per_frame_ > params_.min_features_per_frame) {
+    max_features_per_frame_ =
+        std::max(max_features_per_frame_ - params_.features_step,
+                 params_.min_features_per_frame);
+    return true;
+  }
+  if (klt_max_level_ > params_.min_klt_max_level) {
+    --klt_max_level_;
+    return true;
+  }
+  if (ransac_max_iterations_ > params_.min_ransac_max_iterations) {
+    ransac_max_iterations_ =
+        std::max(ransac_max_iterations_ - params_.ransac_iterations_step,
+                 params_.min_ransac_max_iterations);
+    return true;
+  }
+  return false;
+}
+
+bool FeatureBudgetController::grow() {
+  if (ransac_max_iterations_ < max_ransac_max_iterations_) {
+    ransac_max_iterations_ =
+        std::min(ransac_max_iterations_ + params_.ransac_iterations_step,
+                 max_ransac_max_iterations_);
+    return true;
+  }
+  if (klt_max_level_ < max_klt_max_level_) {
+    ++klt_max_level_;
+    return true;
+  }
+  if (max_features_per_frame_ < max_max_features_per_frame_) {
+    max_features_per_frame_ =
+        std::min(max_features_per_frame_ + params_.features_step,
+                 max_max_features_per_frame_);
+    return true;
+  }
+  return false;
+}
+
+}  // namespace VIO
@@ -0,0 +1,336 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   FixedWindowKlt.cpp
+ * @brief  Pyramidal KLT with kernels specialized at compile time for a few
+ * window sizes.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/frontend/FixedWindowKlt.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+
+#include <glog/logging.h>
+
+#include <opencv2/imgproc.hpp>
+
+namespace VIO {
+
+namespace {
+
+//! Same fixed-point arithmetic as cv::calcOpticalFlowPyrLK: bilinear weights
+//! with 14 fractional bits, and interpolated intensities keeping 5 of them.
+constexpr int kWeightBits = 14;
+constexpr int kIntensityShift = kWeightBits - 5;
+constexpr float kFltScale = 1.0f / (1 << 20);
+constexpr float kMinEigThreshold = 1.0e-4f;
+
+struct BilinearWeights {
+  BilinearWeights(const float& a, const float& b)
+      : w00(cvRound((1.0f - a) * (1.0f - b) * (1 << kWeightBits))),
+        w01(cvRound(a * (1.0f - b) * (1 << kWeightBits))),
+        w10(cvRound((1.0f - a) * b * (1 << kWeightBits))),
+        w11((1 << kWeightBits) - w00 - w01 - w10) {}
+  int w00, w01, w10, w11;
+};
+
+//! Interpolates W samples between two consecutive rows (reading W + 1 of
+//! each). The trip count is known at compile time: the loop is vectorized.
+template <int W, typename T>
+inline void interpolateRow(const T* row0,
+                           const T* row1,
+                           const BilinearWeights& w,
+                           const int& shift,
+                           int16_t* out) {
+  const int rounding = 1 << (shift - 1);
+  for (int x = 0; x < W; ++x) {
+    const int value = row0[x] * w.w00 + row0[x + 1] * w.w01 +
+                      row1[x] * w.w10 + row1[x + 1] * w.w11;
+    out[x] = static_cast<int16_t>((value + rounding) >> shift);
+  }
+}
+
+//! Whether the window with the given top left corner (in level coordinates,
+//! without the border) can be interpolated within the padded level.
+template <int W>
+inline bool isWindowInside(const cv::Point2i& corner,
+                           const cv::Mat& level,
+                           const int& border) {
+  return corner.x >= -border && corner.y >= -border &&
+         corner.x + border + W < level.cols &&
+         corner.y + border + W < level.rows;
+}
+
+/**
+ * @brief trackPoint Tracks one keypoint through the pyramid levels, for a
+ * window of WxW pixels. Fails like cv::calcOpticalFlowPyrLK: if the window
+ * leaves the image or has no texture at the full resolution level (coarser
+ * levels are skipped instead).
+ * @param px_cur Initial guess on input, tracked keypoint on output.
+ */
+template <int W>
+bool trackPoint(const KltPyramid& ref_pyramid,
+                const KltPyramid& cur_pyramid,
+                const int& max_level,
+                const int& max_iter,
+                const float& eps_sq,
+                const KeypointCV& px_ref,
+                KeypointCV* px_cur) {
+  const cv::Point2f half_win((W - 1) * 0.5f, (W - 1) * 0.5f);
+  // Reference window and its derivatives, for the current level.
+  alignas(32) int16_t i_win[W * W];
+  alignas(32) int16_t dx_win[W * W];
+  alignas(32) int16_t dy_win[W * W];
+  alignas(32) int16_t j_row[W];
+
+  // Window center in the current level.
+  cv::Point2f next_pt = *px_cur * (1.0f / (1 << max_level));
+  for (int level = max_level; level >= 0; --level) {
+    if (level != max_level) next_pt *= 2.0f;
+    const cv::Mat& ref_img = ref_pyramid.levels[level];
+    const cv::Mat& ref_dx = ref_pyramid.grad_x[level];
+    const cv::Mat& ref_dy = ref_pyramid.grad_y[level];
+    const cv::Mat& cur_img = cur_pyramid.levels[level];
+
+    const cv::Point2f prev_pt = px_ref * (1.0f / (1 << level)) - half_win;
+    const cv::Point2i iprev_pt(cvFloor(prev_pt.x), cvFloor(prev_pt.y));
+    if (!isWindowInside<W>(iprev_pt, ref_img, ref_pyramid.border)) {
+      if (level == 0) return false;
+      continue;
+    }
+
+    // The reference window and the normal matrix are the same for all the
+    // iterations.
+    const BilinearWeights prev_w(prev_pt.x - iprev_pt.x,
+                                 prev_pt.y - iprev_pt.y);
+    const int prev_col = iprev_pt.x + ref_pyramid.border;
+    float a11 = 0.0f, a12 = 0.0f, a22 = 0.0f;
+    for (int y = 0; y < W; ++y) {
+      const int row = iprev_pt.y + ref_pyramid.border + y;
+      int16_t* i_row = i_win + y * W;
+      int16_t* dx_row = dx_win + y * W;
+      int16_t* dy_row = dy_win + y * W;
+      interpolateRow<W>(ref_img.ptr<uchar>(row) + prev_col,
+                        ref_img.ptr<uchar>(row + 1) + prev_col,
+                        prev_w,
+                        kIntensityShift,
+                        i_row);
+      interpolateRow<W>(ref_dx.ptr<int16_t>(row) + prev_col,
+                        ref_dx.ptr<int16_t>(row + 1) + prev_col,
+                        prev_w,
+                        kWeightBits,
+                        dx_row);
+      interpolateRow<W>(ref_dy.ptr<int16_t>(row) + prev_col,
+                        ref_dy.ptr<int16_t>(row + 1) + prev_col,
+                        prev_w,
+                        kWeightBits,
+                        dy_row);
+      // Scharr derivatives are below 2^12: the sums of a row fit in 32 bits.
+      int32_t s11 = 0, s12 = 0, s22 = 0;
+      for (int x = 0; x < W; ++x) {
+        s11 += dx_row[x] * dx_row[x];
+        s12 += dx_row[x] * dy_row[x];
+        s22 += dy_row[x] * dy_row[x];
+      }
+      a11 += s11;
+      a12 += s12;
+      a22 += s22;
+    }
+    a11 *= kFltScale;
+    a12 *= kFltScale;
+    a22 *= kFltScale;
+    const float det = a11 * a22 - a12 * a12;
+    const float min_eig = (a22 + a11 - std::sqrt((a11 - a22) * (a11 - a22) +
+                                                 4.0f * a12 * a12)) /
+                          (2.0f * W * W);
+    if (min_eig < kMinEigThreshold || det < FLT_EPSILON) {
+      if (level == 0) return false;
+      continue;
+    }
+    const float inv_det = 1.0f / det;
+
+    cv::Point2f corner = next_pt - half_win;
+    cv::Point2f prev_delta(0.0f, 0.0f);
+    for (int iter = 0; iter < max_iter; ++iter) {
+      const cv::Point2i inext_pt(cvFloor(corner.x), cvFloor(corner.y));
+      if (!isWindowInside<W>(inext_pt, cur_img, cur_pyramid.border)) {
+        if (level == 0) return false;
+        break;
+      }
+      const BilinearWeights next_w(corner.x - inext_pt.x,
+                                   corner.y - inext_pt.y);
+      const int next_col = inext_pt.x + cur_pyramid.border;
+      float b1 = 0.0f, b2 = 0.0f;
+      for (int y = 0; y < W; ++y) {
+        const int row = inext_pt.y + cur_pyramid.border + y;
+        interpolateRow<W>(cur_img.ptr<uchar>(row) + next_col,
+                          cur_img.ptr<uchar>(row + 1) + next_col,
+                          next_w,
+                          kIntensityShift,
+                          j_row);
+        const int16_t* i_row = i_win + y * W;
+        const int16_t* dx_row = dx_win + y * W;
+        const int16_t* dy_row = dy_win + y * W;
+        int32_t s1 = 0, s2 = 0;
+        for (int x = 0; x < W; ++x) {
+          const int32_t diff = j_row[x] - i_row[x];
+          s1 += diff * dx_row[x];
+          s2 += diff * dy_row[x];
+        }
+        b1 += s1;
+        b2 += s2;
+      }
+      b1 *= kFltScale;
+      b2 *= kFltScale;
+
+      const cv::Point2f delta((a12 * b2 - a22 * b1) * inv_det,
+                              (a12 * b1 - a11 * b2) * inv_det);
+      corner += delta;
+      if (delta.ddot(delta) <= eps_sq) break;
+      // Oscillating around the solution: take the middle.
+      if (iter > 0 && std::abs(delta.x + prev_delta.x) < 0.01f &&
+          std::abs(delta.y + prev_delta.y) < 0.01f) {
+        corner -= delta * 0.5f;
+        break;
+      }
+      prev_delta = delta;
+    }
+    next_pt = corner + half_win;
+  }
+  *px_cur = next_pt;
+  return true;
+}
+
+}  // namespace
+
+void KltPyramid::clear() {
+  levels.clear();
+  grad_x.clear();
+  grad_y.clear();
+  border = 0;
+  win_size = 0;
+  max_level = -1;
+}
+
+FixedWindowKlt::FixedWindowKlt(const int& win_size)
+    : win_size_(win_size), track_point_(selectKernel(win_size)) {
+  CHECK(track_point_) << "FixedWindowKlt: no kernel for a window size of "
+                      << win_size_ << ", see isSupported.";
+}
+
+bool FixedWindowKlt::isSupported(const int& win_size) {
+  return selectKernel(win_size) != nullptr;
+}
+
+FixedWindowKlt::TrackPointFunction FixedWindowKlt::selectKernel(
+    const int& win_size) {
+  switch (win_size) {
+    case 15:
+      return &trackPoint<15>;
+    case 21:
+      return &trackPoint<21>;
+    case 24:
+      return &trackPoint<24>;
+    case 31:
+      return &trackPoint<31>;
+    default:
+      return nullptr;
+  }
+}
+
+void FixedWindowKlt::buildPyramid(const cv::Mat& img,
+                                  const int& win_size,
+                                  const int& max_level,
+                                  KltPyramid* pyramid) {
+  CHECK_NOTNULL(pyramid);
+  CHECK_EQ(img.type(), CV_8UC1);
+  CHECK_GT(win_size, 0);
+  CHECK_GE(max_level, 0);
+  pyramid->clear();
+  pyramid->border = win_size + 1;
+  pyramid->win_size = win_size;
+  pyramid->max_level = max_level;
+  const int& border = pyramid->border;
+
+  cv::Mat level_img = img;
+  for (int level = 0; level <= max_level; ++level) {
+    if (level != 0) {
+      // Same levels as cv::buildOpticalFlowPyramid.
+      const cv::Size size((level_img.cols + 1) / 2, (level_img.rows + 1) / 2);
+      if (size.width <= win_size || size.height <= win_size) break;
+      cv::Mat down;
+      cv::pyrDown(level_img, down, size);
+      level_img = down;
+    }
+    cv::Mat padded;
+    cv::copyMakeBorder(level_img,
+                       padded,
+                       border,
+                       border,
+                       border,
+                       border,
+                       cv::BORDER_REFLECT_101);
+    pyramid->levels.push_back(padded);
+  }
+}
+
+void FixedWindowKlt::computeGradients(KltPyramid* pyramid) {
+  CHECK_NOTNULL(pyramid);
+  if (pyramid->hasGradients()) return;
+  pyramid->grad_x.resize(pyramid->levels.size());
+  pyramid->grad_y.resize(pyramid->levels.size());
+  for (size_t level = 0u; level < pyramid->levels.size(); ++level) {
+    cv::Scharr(pyramid->levels[level], pyramid->grad_x[level], CV_16S, 1, 0);
+    cv::Scharr(pyramid->levels[level], pyramid->grad_y[level], CV_16S, 0, 1);
+  }
+}
+
+void FixedWindowKlt::track(const KltPyramid& ref_pyramid,
+                           const KltPyramid& cur_pyramid,
+                           const int& max_level,
+                           const cv::TermCriteria& criteria,
+                           const KeypointsCV& px_ref,
+                           KeypointsCV* px_cur,
+                           std::vector<uchar>* status) const {
+  CHECK_NOTNULL(px_cur);
+  CHECK_NOTNULL(status);
+  CHECK_EQ(px_cur->size(), px_ref.size());
+  CHECK(ref_pyramid.hasGradients());
+  CHECK_GE(max_level, 0);
+  CHECK_LE(max_level, ref_pyramid.getMaxLevel());
+  CHECK_LE(max_level, cur_pyramid.getMaxLevel());
+
+  // Same defaults and bounds as cv::calcOpticalFlowPyrLK.
+  const int max_iter = (criteria.type & cv::TermCriteria::COUNT)
+                           ? std::min(std::max(criteria.maxCount, 0), 100)
+                           : 30;
+  const double eps = (criteria.type & cv::TermCriteria::EPS)
+                         ? std::min(std::max(criteria.epsilon, 0.0), 10.0)
+                         : 0.01;
+  const float eps_sq = static_cast<float>(eps * eps);
+
+  status->resize(px_ref.size());
+  for (size_t i = 0u; i < px_ref.size(); ++i) {
+    (*status)[i] = track_point_(ref_pyramid,
+                                cur_pyramid,
+                                max_level,
+                                max_iter,
+                                eps_sq,
+                                px_ref[i],
+                                &(*px_cur)[i])
+                       ? 1u
+                       : 0u;
+  }
+}
+
+}  // namespace VIO
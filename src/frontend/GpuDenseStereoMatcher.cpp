@@ -0,0 +1,92 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   GpuDenseStereoMatcher.cpp
+ * @brief  Dense stereo matching on the GPU (OpenCV CUDA semi-global matching).
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/frontend/GpuDenseStereoMatcher.h"
+
+#include <glog/logging.h>
+
+#include <opencv2/calib3d.hpp>
+
+#ifdef KIMERA_HAS_CUDA_STEREO
+#include <opencv2/core/cuda.hpp>
+#include <opencv2/cudastereo.hpp>
+#endif
+
+namespace VIO {
+
+#ifdef KIMERA_HAS_CUDA_STEREO
+struct GpuDenseStereoMatcher::Impl {
+  cv::Ptr<cv::cuda::StereoSGM> sgm;
+  cv::cuda::Stream stream;
+  cv::cuda::GpuMat d_left_img;
+  cv::cuda::GpuMat d_right_img;
+  cv::cuda::GpuMat d_disparity_img;
+};
+#else
+struct GpuDenseStereoMatcher::Impl {};
+#endif
+
+GpuDenseStereoMatcher::GpuDenseStereoMatcher(const DenseStereoParams& params,
+                                             const int& min_disparity,
+                                             const int& num_disparities)
+    : impl_(std::make_unique<Impl>()) {
+  CHECK(isAvailable()) << "GpuDenseStereoMatcher: no CUDA device, or "
+                          "Kimera-VIO built without OpenCV's cudastereo.";
+  CHECK(num_disparities == 64 || num_disparities == 128 ||
+        num_disparities == 256)
+      << "GpuDenseStereoMatcher: num_disparities must be 64, 128 or 256.";
+#ifdef KIMERA_HAS_CUDA_STEREO
+  impl_->sgm = cv::cuda::createStereoSGM(
+      min_disparity,
+      num_disparities,
+      params.p1_,
+      params.p2_,
+      params.uniqueness_ratio_,
+      params.use_mode_HH_ ? cv::StereoSGBM::MODE_HH
+                          : cv::StereoSGBM::MODE_HH4);
+#endif
+}
+
+GpuDenseStereoMatcher::~GpuDenseStereoMatcher() = default;
+
+bool GpuDenseStereoMatcher::isAvailable() {
+#ifdef KIMERA_HAS_CUDA_STEREO
+  return cv::cuda::getCudaEnabledDeviceCount() > 0;
+#else
+  return false;
+#endif
+}
+
+void GpuDenseStereoMatcher::compute(const cv::Mat& left_img_rectified,
+                                    const cv::Mat& right_img_rectified,
+                                    cv::Mat* disparity_img) {
+  CHECK_NOTNULL(disparity_img);
+  CHECK_EQ(left_img_rectified.type(), CV_8UC1)
+      << "GpuDenseStereoMatcher: expects grayscale images.";
+  CHECK_EQ(right_img_rectified.type(), CV_8UC1)
+      << "GpuDenseStereoMatcher: expects grayscale images.";
+#ifdef KIMERA_HAS_CUDA_STEREO
+  // Device buffers are reallocated only if the image size changes.
+  impl_->d_left_img.upload(left_img_rectified, impl_->stream);
+  impl_->d_right_img.upload(right_img_rectified, impl_->stream);
+  impl_->sgm->compute(impl_->d_left_img,
+                      impl_->d_right_img,
+                      impl_->d_disparity_img,
+                      impl_->stream);
+  impl_->d_disparity_img.download(*disparity_img, impl_->stream);
+  impl_->stream.waitForCompletion();
+#endif
+}
+
+}  // namespace VIO
@@ -0,0 +1,314 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   GpuImagePreprocessor.cpp
+ * @brief  Preprocesses the stereo images on the GPU, uploading them once:
+ * rectification, feature candidates and optionally dense stereo.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/frontend/GpuImagePreprocessor.h"
+
+#include <glog/logging.h>
+
+#include <opencv2/calib3d.hpp>
+
+#ifdef KIMERA_HAS_CUDA_PREPROCESSING
+#include <opencv2/core/cuda.hpp>
+#include <opencv2/cudaimgproc.hpp>
+#include <opencv2/cudawarping.hpp>
+#ifdef KIMERA_HAS_CUDA_ORB
+#include <opencv2/cudafeatures2d.hpp>
+#endif
+#ifdef KIMERA_HAS_CUDA_STEREO
+#include <opencv2/cudastereo.hpp>
+#endif
+#endif
+
+#include "kimera-vio/frontend/feature-detector/FeatureDetector-definitions.h"
+
+namespace VIO {
+
+#ifdef KIMERA_HAS_CUDA_PREPROCESSING
+struct GpuImagePreprocessor::Impl {
+  //! Device buffers of a frame in flight.
+  struct Slot {
+    FrameId frame_id = 0;
+    bool in_flight = false;
+    cv::cuda::Stream stream;
+    cv::cuda::GpuMat d_left_img;
+    cv::cuda::GpuMat d_right_img;
+    cv::cuda::GpuMat d_left_img_rectified;
+    cv::cuda::GpuMat d_right_img_rectified;
+    cv::cuda::GpuMat d_candidates;
+    cv::cuda::GpuMat d_disparity_img;
+    //! Host right image, kept until retrieved if its processing is deferred.
+    cv::Mat right_img;
+    bool right_img_pending = false;
+  };
+
+  //! Uploads and rectifies the right image of the slot, and computes the
+  //! disparities if requested, on the stream of the slot.
+  void processRightImage(Slot* slot, const cv::Mat& right_img);
+
+  //! Rectification maps, uploaded once.
+  cv::cuda::GpuMat d_left_map_x;
+  cv::cuda::GpuMat d_left_map_y;
+  cv::cuda::GpuMat d_right_map_x;
+  cv::cuda::GpuMat d_right_map_y;
+  int interpolation = cv::INTER_LINEAR;
+  int border_type = cv::BORDER_REPLICATE;
+
+  cv::Ptr<cv::cuda::CornersDetector> gftt;
+#ifdef KIMERA_HAS_CUDA_ORB
+  cv::Ptr<cv::cuda::FastFeatureDetector> fast;
+#endif
+#ifdef KIMERA_HAS_CUDA_STEREO
+  cv::Ptr<cv::cuda::StereoSGM> sgm;
+#endif
+
+  Slot slots[2];
+  size_t next_slot = 0u;
+};
+
+void GpuImagePreprocessor::Impl::processRightImage(Slot* slot,
+                                                   const cv::Mat& right_img) {
+  CHECK_NOTNULL(slot);
+  CHECK(right_img.size() == d_right_map_x.size());
+  slot->d_right_img.upload(right_img, slot->stream);
+  cv::cuda::remap(slot->d_right_img,
+                  slot->d_right_img_rectified,
+                  d_right_map_x,
+                  d_right_map_y,
+                  interpolation,
+                  border_type,
+                  cv::Scalar(),
+                  slot->stream);
+#ifdef KIMERA_HAS_CUDA_STEREO
+  if (sgm) {
+    sgm->compute(slot->d_left_img_rectified,
+                 slot->d_right_img_rectified,
+                 slot->d_disparity_img,
+                 slot->stream);
+  }
+#endif
+}
+#else
+struct GpuImagePreprocessor::Impl {};
+#endif
+
+GpuImagePreprocessor::GpuImagePreprocessor(
+    const StereoCamera& stereo_camera,
+    const FeatureDetectorParams& feature_detector_params,
+    const DenseStereoParams* dense_stereo_params)
+    : impl_(std::make_unique<Impl>()) {
+  CHECK(isAvailable()) << "GpuImagePreprocessor: no CUDA device, or "
+                          "Kimera-VIO built without OpenCV's cudawarping "
+                          "and cudaimgproc.";
+#ifdef KIMERA_HAS_CUDA_PREPROCESSING
+  const UndistorterRectifier& left_rectifier =
+      stereo_camera.getLeftCamUndistortRectifier();
+  const UndistorterRectifier& right_rectifier =
+      stereo_camera.getRightCamUndistortRectifier();
+  impl_->d_left_map_x.upload(left_rectifier.getMapX());
+  impl_->d_left_map_y.upload(left_rectifier.getMapY());
+  impl_->d_right_map_x.upload(right_rectifier.getMapX());
+  impl_->d_right_map_y.upload(right_rectifier.getMapY());
+  impl_->interpolation = left_rectifier.getRemapInterpolationType();
+  impl_->border_type = left_rectifier.getRemapBorderType();
+
+  // Same detectors as FeatureDetector::rawFeatureDetection.
+  if (!feature_detector_params.enable_grid_detection_) {
+    const int& max_nr_keypoints =
+        feature_detector_params.max_nr_keypoints_before_anms_;
+    switch (feature_detector_params.feature_detector_type_) {
+      case FeatureDetectorType::GFTT: {
+        impl_->gftt = cv::cuda::createGoodFeaturesToTrackDetector(
+            CV_8UC1,
+            max_nr_keypoints,
+            feature_detector_params.quality_level_,
+            feature_detector_params
+                .min_distance_btw_tracked_and_detected_features_,
+            feature_detector_params.block_size_,
+            feature_detector_params.use_harris_corner_detector_,
+            feature_detector_params.k_);
+        break;
+      }
+      case FeatureDetectorType::FAST: {
+#ifdef KIMERA_HAS_CUDA_ORB
+        impl_->fast = cv::cuda::FastFeatureDetector::create(
+            feature_detector_params.fast_thresh_,
+            true,
+            cv::FastFeatureDetector::TYPE_9_16,
+            max_nr_keypoints);
+#endif
+        break;
+      }
+      default:
+        break;
+    }
+  }
+  VLOG_IF(1, !detectsCandidates())
+      << "GpuImagePreprocessor: features are detected on the CPU.";
+
+  if (dense_stereo_params) {
+#ifdef KIMERA_HAS_CUDA_STEREO
+    // cv::cuda::StereoSGM only supports 64, 128 or 256 disparities.
+    int num_disparities = 64;
+    while (num_disparities < dense_stereo_params->num_disparities_ &&
+           num_disparities < 256) {
+      num_disparities *= 2;
+    }
+    impl_->sgm = cv::cuda::createStereoSGM(
+        dense_stereo_params->min_disparity_,
+        num_disparities,
+        dense_stereo_params->p1_,
+        dense_stereo_params->p2_,
+        dense_stereo_params->uniqueness_ratio_,
+        dense_stereo_params->use_mode_HH_ ? cv::StereoSGBM::MODE_HH
+                                          : cv::StereoSGBM::MODE_HH4);
+#else
+    LOG(WARNING) << "GpuImagePreprocessor: built without OpenCV's "
+                    "cudastereo, no dense stereo.";
+#endif
+  }
+#endif
+}
+
+GpuImagePreprocessor::~GpuImagePreprocessor() {
+#ifdef KIMERA_HAS_CUDA_PREPROCESSING
+  for (Impl::Slot& slot : impl_->slots) slot.stream.waitForCompletion();
+#endif
+}
+
+bool GpuImagePreprocessor::isAvailable() {
+#ifdef KIMERA_HAS_CUDA_PREPROCESSING
+  return cv::cuda::getCudaEnabledDeviceCount() > 0;
+#else
+  return false;
+#endif
+}
+
+bool GpuImagePreprocessor::detectsCandidates() const {
+#ifdef KIMERA_HAS_CUDA_PREPROCESSING
+#ifdef KIMERA_HAS_CUDA_ORB
+  if (impl_->fast) return true;
+#endif
+  return !impl_->gftt.empty();
+#else
+  return false;
+#endif
+}
+
+void GpuImagePreprocessor::enqueue(const StereoFrame& stereo_frame,
+                                   const bool& defer_right_image) {
+  const cv::Mat& left_img = stereo_frame.left_frame_.img_;
+  const cv::Mat& right_img = stereo_frame.right_frame_.img_;
+  CHECK_EQ(left_img.type(), CV_8UC1)
+      << "GpuImagePreprocessor: expects grayscale images.";
+  CHECK_EQ(right_img.type(), CV_8UC1)
+      << "GpuImagePreprocessor: expects grayscale images.";
+#ifdef KIMERA_HAS_CUDA_PREPROCESSING
+  CHECK(left_img.size() == impl_->d_left_map_x.size());
+  Impl::Slot& slot = impl_->slots[impl_->next_slot];
+  impl_->next_slot = 1u - impl_->next_slot;
+  // Only busy if its frame was never retrieved.
+  slot.stream.waitForCompletion();
+  slot.frame_id = stereo_frame.id_;
+  slot.in_flight = true;
+
+  // Device buffers are reallocated only if the image size changes.
+  slot.d_left_img.upload(left_img, slot.stream);
+  cv::cuda::remap(slot.d_left_img,
+                  slot.d_left_img_rectified,
+                  impl_->d_left_map_x,
+                  impl_->d_left_map_y,
+                  impl_->interpolation,
+                  impl_->border_type,
+                  cv::Scalar(),
+                  slot.stream);
+
+  // Candidates are detected in the whole image: the CPU masks them with the
+  // tracked features, which are not known yet.
+  if (!impl_->gftt.empty()) {
+    impl_->gftt->detect(
+        slot.d_left_img, slot.d_candidates, cv::noArray(), slot.stream);
+  }
+#ifdef KIMERA_HAS_CUDA_ORB
+  if (impl_->fast) {
+    impl_->fast->detectAsync(slot.d_left_img,
+                             slot.d_candidates,
+                             cv::noArray(),
+                             slot.stream);
+  }
+#endif
+
+  if (defer_right_image) {
+    // Shallow copy: the frame keeps its image alive anyway.
+    slot.right_img = right_img;
+    slot.right_img_pending = true;
+  } else {
+    slot.right_img.release();
+    slot.right_img_pending = false;
+    impl_->processRightImage(&slot, right_img);
+  }
+#endif
+}
+
+bool GpuImagePreprocessor::retrieve(const FrameId& frame_id,
+                                    GpuPreprocessedStereo* output) {
+  CHECK_NOTNULL(output);
+#ifdef KIMERA_HAS_CUDA_PREPROCESSING
+  for (Impl::Slot& slot : impl_->slots) {
+    if (!slot.in_flight || slot.frame_id != frame_id) continue;
+    slot.in_flight = false;
+    if (slot.right_img_pending) {
+      impl_->processRightImage(&slot, slot.right_img);
+      slot.right_img.release();
+      slot.right_img_pending = false;
+    }
+    slot.d_left_img_rectified.download(output->left_img_rectified,
+                                       slot.stream);
+    slot.d_right_img_rectified.download(output->right_img_rectified,
+                                        slot.stream);
+    cv::Mat candidates;
+    if (detectsCandidates() && !slot.d_candidates.empty()) {
+      slot.d_candidates.download(candidates, slot.stream);
+    }
+    output->disparity_img.release();
+#ifdef KIMERA_HAS_CUDA_STEREO
+    if (impl_->sgm) {
+      slot.d_disparity_img.download(output->disparity_img, slot.stream);
+    }
+#endif
+    slot.stream.waitForCompletion();
+
+    output->candidates.clear();
+    output->has_candidates = detectsCandidates();
+    if (!impl_->gftt.empty() && !candidates.empty()) {
+      // 1xN CV_32FC2, sorted by decreasing quality: the rank is the score.
+      output->candidates.reserve(candidates.cols);
+      for (int i = 0; i < candidates.cols; ++i) {
+        const cv::Point2f& pt = candidates.at<cv::Point2f>(0, i);
+        output->candidates.emplace_back(
+            pt, 0.0f, -1.0f, static_cast<float>(candidates.cols - i));
+      }
+    }
+#ifdef KIMERA_HAS_CUDA_ORB
+    if (impl_->fast && !candidates.empty()) {
+      impl_->fast->convert(candidates, output->candidates);
+    }
+#endif
+    return true;
+  }
+#endif
+  return false;
+}
+
+}  // namespace VIO
@@ -0,0 +1,148 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   GpuSparseOpticalFlow.cpp
+ * @brief  Sparse pyramidal KLT on the GPU (OpenCV CUDA optical flow).
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/frontend/GpuSparseOpticalFlow.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+#ifdef KIMERA_HAS_CUDA_OPTFLOW
+#include <opencv2/core/cuda.hpp>
+#include <opencv2/cudaoptflow.hpp>
+#endif
+
+namespace VIO {
+
+#ifdef KIMERA_HAS_CUDA_OPTFLOW
+struct GpuSparseOpticalFlow::Impl {
+  //! Image of a frame on the device.
+  struct DeviceImage {
+    Timestamp timestamp = -1;
+    cv::cuda::GpuMat img;
+  };
+
+  //! Returns the device image of the frame, uploading it if needed. Evicts
+  //! the least recently used of the two images.
+  cv::cuda::GpuMat& getDeviceImage(const Timestamp& timestamp,
+                                   const cv::Mat& img) {
+    if (images[last_used].timestamp != timestamp) {
+      last_used = 1u - last_used;
+      if (images[last_used].timestamp != timestamp) {
+        // Device buffers are reallocated only if the image size changes.
+        images[last_used].img.upload(img, stream);
+        images[last_used].timestamp = timestamp;
+      }
+    }
+    return images[last_used].img;
+  }
+
+  cv::Ptr<cv::cuda::SparsePyrLKOpticalFlow> klt;
+  cv::cuda::Stream stream;
+  DeviceImage images[2];
+  size_t last_used = 0u;
+  cv::cuda::GpuMat d_px_ref;
+  cv::cuda::GpuMat d_px_cur;
+  cv::cuda::GpuMat d_status;
+  cv::Mat px_cur;
+  cv::Mat status;
+};
+#else
+struct GpuSparseOpticalFlow::Impl {};
+#endif
+
+GpuSparseOpticalFlow::GpuSparseOpticalFlow()
+    : impl_(std::make_unique<Impl>()) {
+  CHECK(isAvailable()) << "GpuSparseOpticalFlow: no CUDA device, or "
+                          "Kimera-VIO built without OpenCV's cudaoptflow.";
+#ifdef KIMERA_HAS_CUDA_OPTFLOW
+  impl_->klt = cv::cuda::SparsePyrLKOpticalFlow::create();
+  impl_->klt->setUseInitialFlow(true);
+#endif
+}
+
+GpuSparseOpticalFlow::~GpuSparseOpticalFlow() = default;
+
+bool GpuSparseOpticalFlow::isAvailable() {
+#ifdef KIMERA_HAS_CUDA_OPTFLOW
+  return cv::cuda::getCudaEnabledDeviceCount() > 0;
+#else
+  return false;
+#endif
+}
+
+void GpuSparseOpticalFlow::uploadAsync(const Timestamp& timestamp,
+                                       const cv::Mat& img) {
+  CHECK_EQ(img.type(), CV_8UC1)
+      << "GpuSparseOpticalFlow: expects grayscale images.";
+#ifdef KIMERA_HAS_CUDA_OPTFLOW
+  impl_->getDeviceImage(timestamp, img);
+#endif
+}
+
+void GpuSparseOpticalFlow::track(const Timestamp& ref_timestamp,
+                                 const cv::Mat& ref_img,
+                                 const Timestamp& cur_timestamp,
+                                 const cv::Mat& cur_img,
+                                 const cv::Size& win_size,
+                                 const int& max_level,
+                                 const int& max_iter,
+                                 const KeypointsCV& px_ref,
+                                 KeypointsCV* px_cur,
+                                 std::vector<uchar>* status) {
+  CHECK_NOTNULL(px_cur);
+  CHECK_NOTNULL(status);
+  CHECK_EQ(px_cur->size(), px_ref.size());
+  status->clear();
+  if (px_ref.empty()) return;
+#ifdef KIMERA_HAS_CUDA_OPTFLOW
+  // Both images are on the device if they were uploaded beforehand.
+  const cv::cuda::GpuMat& d_ref_img =
+      impl_->getDeviceImage(ref_timestamp, ref_img);
+  const cv::cuda::GpuMat& d_cur_img =
+      impl_->getDeviceImage(cur_timestamp, cur_img);
+
+  impl_->klt->setWinSize(win_size);
+  impl_->klt->setMaxLevel(max_level);
+  impl_->klt->setNumIters(max_iter);
+
+  // The CUDA KLT expects the keypoints as a 1xN CV_32FC2 row.
+  const int nr_kpts = static_cast<int>(px_ref.size());
+  impl_->d_px_ref.upload(
+      cv::Mat(1, nr_kpts, CV_32FC2, const_cast<KeypointCV*>(px_ref.data())),
+      impl_->stream);
+  impl_->d_px_cur.upload(cv::Mat(1, nr_kpts, CV_32FC2, px_cur->data()),
+                         impl_->stream);
+  impl_->klt->calc(d_ref_img,
+                   d_cur_img,
+                   impl_->d_px_ref,
+                   impl_->d_px_cur,
+                   impl_->d_status,
+                   cv::noArray(),
+                   impl_->stream);
+  impl_->d_px_cur.download(impl_->px_cur, impl_->stream);
+  impl_->d_status.download(impl_->status, impl_->stream);
+  impl_->stream.waitForCompletion();
+
+  CHECK_EQ(impl_->px_cur.cols, nr_kpts);
+  CHECK_EQ(impl_->status.cols, nr_kpts);
+  std::copy(impl_->px_cur.ptr<KeypointCV>(),
+            impl_->px_cur.ptr<KeypointCV>() + nr_kpts,
+            px_cur->begin());
+  status->assign(impl_->status.ptr<uchar>(),
+                 impl_->status.ptr<uchar>() + nr_kpts);
+#endif
+}
+
+}  // namespace VIO
@@ -15,8 +15,10 @@
 #include "kimera-vio/frontend/MonoVisionImuFrontend.h"
 
 #include <memory>
+#include <vector>
 
 #include "kimera-vio/frontend/MonoVisionImuFrontend-definitions.h"
+#include "kimera-vio/frontend/UndistorterRectifier.h"
 #include "kimera-vio/utils/UtilsNumerical.h"
 
 DEFINE_bool(log_mono_matching_images,
@@ -45,14 +47,21 @@ MonoVisionImuFrontend::MonoVisionImuFrontend(
       mono_frame_lkf_(nullptr),
       keyframe_R_ref_frame_(gtsam::Rot3()),
       feature_detector_(nullptr),
+      speculative_feature_detector_(nullptr),
       mono_camera_(camera) {
   CHECK(mono_camera_);
 
   tracker_ = std::make_unique<Tracker>(
       frontend_params_.tracker_params_, mono_camera_, display_queue);
+  tracker_->setDebugImageWorker(debug_image_worker_.get());
 
   feature_detector_ = std::make_unique<FeatureDetector>(
       frontend_params_.feature_detector_params_);
+  if (frontend_params_.speculative_feature_detection_) {
+    speculative_feature_detector_ =
+        std::make_unique<SpeculativeFeatureDetector>(
+            frontend_params_.feature_detector_params_);
+  }
 
   if (VLOG_IS_ON(1)) tracker_->tracker_params_.print();
 }
@@ -113,10 +122,13 @@ MonoFrontendOutput::UniquePtr MonoVisionImuFrontend::nominalSpinMono(
 
   if (VLOG_IS_ON(10)) input->print();
 
-  // auto tic_full_preint = utils::Timer::tic();
-  const ImuFrontend::PimPtr& pim = imu_frontend_->preintegrateImuMeasurements(
-      input->getImuStamps(), input->getImuAccGyrs());
-  CHECK(pim);
+  // The copy of the frame and its pyramid do not need the IMU: they can be
+  // done while preintegrating.
+  const ImuFrontend::PimPtr pim = preintegrateImuWhile(
+      input->getImuStamps(), input->getImuAccGyrs(), [this, &mono_frame_k]() {
+        mono_frame_k_ = std::make_shared<Frame>(mono_frame_k);
+        tracker_->buildOpticalFlowPyramid(*mono_frame_k_);
+      });
   const gtsam::Rot3 body_R_cam = mono_camera_->getBodyPoseCam().rotation();
   const gtsam::Rot3 cam_R_body = body_R_cam.inverse();
   gtsam::Rot3 camLrectLkf_R_camLrectK_imu =
@@ -166,7 +178,9 @@ MonoFrontendOutput::UniquePtr MonoVisionImuFrontend::nominalSpinMono(
     imu_frontend_->resetIntegrationWithCachedBias();
 
     // Record keyframe rate timing
-    timing_stats_keyframe_rate.AddSample(utils::Timer::toc(start_time).count());
+    const double keyframe_time_ms = utils::Timer::toc(start_time).count();
+    timing_stats_keyframe_rate.AddSample(keyframe_time_ms);
+    updateFeatureBudget(keyframe_time_ms, feature_detector_.get());
 
     // Return the output of the Frontend for the others.
     // We have a keyframe, so We fill frame_lkf_ with the newest keyframe
@@ -240,7 +254,13 @@ StatusMonoMeasurementsPtr MonoVisionImuFrontend::processFrame(
           << cur_frame.timestamp_ - mono_frame_km1_->timestamp_ << ")";
   auto start_time = utils::Timer::tic();
 
-  mono_frame_k_ = std::make_shared<Frame>(cur_frame);
+  // Copied by nominalSpinMono, while preintegrating the IMU.
+  CHECK(mono_frame_k_);
+  CHECK_EQ(mono_frame_k_->id_, cur_frame.id_);
+
+  // Only the keyframes reach the Backend: the other frames only need their
+  // keypoints to be tracked.
+  const bool keyframe_only_processing = isKeyframeOnlyProcessing();
 
   VLOG(2) << "Starting feature tracking...";
   gtsam::Rot3 ref_frame_R_cur_frame =
@@ -248,8 +268,12 @@ StatusMonoMeasurementsPtr MonoVisionImuFrontend::processFrame(
   tracker_->featureTracking(mono_frame_km1_.get(),
                             mono_frame_k_.get(),
                             ref_frame_R_cur_frame,
-                            frontend_params_.feature_detector_params_);
-  if (feature_tracks) {
+                            frontend_params_.feature_detector_params_,
+                            std::nullopt,
+                            std::nullopt,
+                            std::vector<double>(),
+                            !keyframe_only_processing);
+  if (feature_tracks && !keyframe_only_processing) {
     *feature_tracks =
         tracker_->getTrackerImage(*mono_frame_lkf_, *mono_frame_k_);
   }
@@ -266,6 +290,16 @@ StatusMonoMeasurementsPtr MonoVisionImuFrontend::processFrame(
   if (new_keyframe) {
     ++keyframe_count_;
 
+    if (keyframe_only_processing) {
+      UndistorterRectifier::GetBearingVectors(mono_frame_k_->keypoints_,
+                                              mono_frame_k_->cam_param_,
+                                              &mono_frame_k_->versors_);
+      if (feature_tracks) {
+        *feature_tracks =
+            tracker_->getTrackerImage(*mono_frame_lkf_, *mono_frame_k_);
+      }
+    }
+
     if (frontend_params_.useRANSAC_) {
       TrackingStatusPose status_pose_mono;
       outlierRejectionMono(keyframe_R_cur_frame,
@@ -290,7 +324,14 @@ StatusMonoMeasurementsPtr MonoVisionImuFrontend::processFrame(
     mono_frame_k_->isKeyframe_ = true;
 
     CHECK(feature_detector_);
-    feature_detector_->featureDetection(mono_frame_k_.get());
+    std::vector<cv::KeyPoint> candidates;
+    const bool has_candidates =
+        speculative_feature_detector_ &&
+        speculative_feature_detector_->takeCandidates(*mono_frame_k_,
+                                                      &candidates);
+    feature_detector_->featureDetection(mono_frame_k_.get(),
+                                        std::nullopt,
+                                        has_candidates ? &candidates : nullptr);
 
     // Undistort keypoints:
     mono_camera_->undistortKeypoints(mono_frame_k_->keypoints_,
@@ -302,10 +343,15 @@ StatusMonoMeasurementsPtr MonoVisionImuFrontend::processFrame(
       if (FLAGS_log_mono_matching_images) sendMonoTrackingToLogger();
     }
     if (display_queue_ && FLAGS_visualize_feature_tracks) {
-      displayImage(mono_frame_k_->timestamp_,
-                   "feature_tracks",
-                   tracker_->getTrackerImage(*mono_frame_lkf_, *mono_frame_k_),
-                   display_queue_);
+      const Timestamp timestamp = mono_frame_k_->timestamp_;
+      DisplayQueue* display_queue = display_queue_;
+      TrackerImageInput input(*mono_frame_lkf_, *mono_frame_k_);
+      runDebugImageJob([timestamp, display_queue, input = std::move(input)]() {
+        displayImage(timestamp,
+                     "feature_tracks",
+                     Tracker::drawTrackerImage(input),
+                     display_queue);
+      });
     }
 
     mono_frame_lkf_ = mono_frame_k_;
@@ -318,6 +364,10 @@ StatusMonoMeasurementsPtr MonoVisionImuFrontend::processFrame(
   } else {
     CHECK_EQ(smart_mono_measurements.size(), 0u);
     mono_frame_k_->isKeyframe_ = false;
+    if (speculative_feature_detector_) {
+      // Detect ahead of the next keyframe, while tracking the next frames.
+      speculative_feature_detector_->launch(*mono_frame_k_);
+    }
   }
 
   if (mono_frame_k_->isKeyframe_) {
@@ -369,58 +419,47 @@ void MonoVisionImuFrontend::getSmartMonoMeasurements(
 }
 
 void MonoVisionImuFrontend::sendFeatureTracksToLogger() const {
-  CHECK(tracker_);
-  cv::Mat img_left =
-      tracker_->getTrackerImage(*mono_frame_lkf_, *mono_frame_k_);
-  logger_->logFrontendImg(mono_frame_k_->id_,
-                          img_left,
-                          "monoFeatureTracksLeft",
-                          "/monoFeatureTracksLeftImg/",
-                          FLAGS_visualize_frontend_images,
-                          FLAGS_save_frontend_images);
+  CHECK(logger_);
+  FrontendLogger* logger = logger_.get();
+  const FrameId frame_id = mono_frame_k_->id_;
+  const bool disp_img = FLAGS_visualize_frontend_images;
+  const bool save_img = FLAGS_save_frontend_images;
+  TrackerImageInput input(*mono_frame_lkf_, *mono_frame_k_);
+  runDebugImageJob(
+      [logger, frame_id, disp_img, save_img, input = std::move(input)]() {
+        logger->logFrontendImg(frame_id,
+                               Tracker::drawTrackerImage(input),
+                               "monoFeatureTracksLeft",
+                               "/monoFeatureTracksLeftImg/",
+                               disp_img,
+                               save_img);
+      });
 }
 
 void MonoVisionImuFrontend::sendMonoTrackingToLogger() const {
-  const Frame& cur_left_frame = *mono_frame_k_;
-  const Frame& ref_left_frame = *mono_frame_lkf_;
-
-  // Find keypoint matches.
-  DMatchVec matches;
-  for (size_t i = 0; i < cur_left_frame.keypoints_.size(); ++i) {
-    if (cur_left_frame.landmarks_.at(i) != -1) {  // if landmark is valid
-      auto it = find(ref_left_frame.landmarks_.begin(),
-                     ref_left_frame.landmarks_.end(),
-                     cur_left_frame.landmarks_.at(i));
-      if (it != ref_left_frame.landmarks_.end()) {  // if landmark was found
-        int nPos = std::distance(ref_left_frame.landmarks_.begin(), it);
-        matches.push_back(cv::DMatch(nPos, i, 0));
-      }
-    }
-  }
-  //############################################################################
-
-  // Plot matches.
-  cv::Mat img_left_lkf_kf =
-      UtilsOpenCV::DrawCornersMatches(ref_left_frame.img_,
-                                      ref_left_frame.keypoints_,
-                                      cur_left_frame.img_,
-                                      cur_left_frame.keypoints_,
-                                      matches,
-                                      false);  // true: random color
-  cv::putText(img_left_lkf_kf,
-              "M:" + std::to_string(keyframe_count_ - 1) + "-" +
-                  std::to_string(keyframe_count_),
-              KeypointCV(10, 15),
-              CV_FONT_HERSHEY_COMPLEX,
-              0.6,
-              cv::Scalar(0, 255, 0));
-
-  logger_->logFrontendImg(cur_left_frame.id_,
-                          img_left_lkf_kf,
-                          "monoTrackingUnrectified",
-                          "/monoTrackingUnrectifiedImg/",
-                          FLAGS_visualize_frontend_images,
-                          FLAGS_save_frontend_images);
+  CHECK(logger_);
+  FrontendLogger* logger = logger_.get();
+  const FrameId frame_id = mono_frame_k_->id_;
+  const int keyframe_count = keyframe_count_;
+  const bool disp_img = FLAGS_visualize_frontend_images;
+  const bool save_img = FLAGS_save_frontend_images;
+  const cv::Mat ref_img = mono_frame_lkf_->img_;
+  TrackerImageInput input(*mono_frame_lkf_, *mono_frame_k_);
+  runDebugImageJob([logger,
+                    frame_id,
+                    keyframe_count,
+                    disp_img,
+                    save_img,
+                    ref_img,
+                    input = std::move(input)]() {
+    logger->logFrontendImg(
+        frame_id,
+        drawMonoTrackingImage(ref_img, input, keyframe_count),
+        "monoTrackingUnrectified",
+        "/monoTrackingUnrectifiedImg/",
+        disp_img,
+        save_img);
+  });
 }
 
 void MonoVisionImuFrontend::printStatusMonoMeasurements(
@@ -0,0 +1,59 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   MultiCameraImuSyncPacket.cpp
+ * @brief  Class describing the minimum input for VIO to run
+ * Contains one Frame per camera of a multi-camera rig, all with the same
+ * timestamp, with Imu data synchronized from last Keyframe timestamp to the
+ * current frame timestamp.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/frontend/MultiCameraImuSyncPacket.h"
+
+#include <utility>
+
+namespace VIO {
+
+MultiCameraImuSyncPacket::MultiCameraImuSyncPacket(
+    std::vector<Frame::UniquePtr> frames,
+    const ImuStampS& imu_stamps,
+    const ImuAccGyrS& imu_accgyrs,
+    std::optional<gtsam::NavState> external_odometry)
+    : FrontendInputPacketBase(CHECK_NOTNULL(frames.at(0u).get())->timestamp_,
+                              imu_stamps,
+                              imu_accgyrs,
+                              external_odometry),
+      frames_(std::move(frames)) {
+  for (const Frame::UniquePtr& frame : frames_) {
+    CHECK(frame);
+    CHECK_EQ(frame->timestamp_, timestamp_);
+  }
+  CHECK_GT(imu_stamps_.cols(), 0u);
+  CHECK_EQ(timestamp_, imu_stamps_(imu_stamps_.cols() - 1));
+}
+
+void MultiCameraImuSyncPacket::print() const {
+  LOG(INFO) << "Multi-camera Frame timestamp: " << timestamp_ << '\n'
+            << "Nr cameras: " << frames_.size() << '\n'
+            << "STAMPS IMU rows : \n"
+            << imu_stamps_.rows() << '\n'
+            << "STAMPS IMU cols : \n"
+            << imu_stamps_.cols() << '\n'
+            << "STAMPS IMU: \n"
+            << imu_stamps_ << '\n'
+            << "ACCGYR IMU rows : \n"
+            << imu_accgyrs_.rows() << '\n'
+            << "ACCGYR IMU cols : \n"
+            << imu_accgyrs_.cols() << '\n'
+            << "ACCGYR IMU: \n"
+            << imu_accgyrs_;
+}
+
+}  // namespace VIO
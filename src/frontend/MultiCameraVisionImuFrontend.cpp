@@ -0,0 +1,398 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   MultiCameraVisionImuFrontend.cpp
+ * @brief  Class describing a tracking Frontend for N monocular cameras
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/frontend/MultiCameraVisionImuFrontend.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <opencv2/core/utility.hpp>
+
+#include "kimera-vio/frontend/MonoVisionImuFrontend.h"
+#include "kimera-vio/utils/Statistics.h"
+#include "kimera-vio/utils/Timer.h"
+#include "kimera-vio/utils/Tracing.h"
+
+DECLARE_bool(do_fine_imu_camera_temporal_sync);
+
+namespace VIO {
+
+MultiCameraVisionImuFrontend::MultiCameraVisionImuFrontend(
+    const FrontendParams& frontend_params,
+    const ImuParams& imu_params,
+    const ImuBias& imu_initial_bias,
+    const std::vector<Camera::ConstPtr>& cameras,
+    DisplayQueue* display_queue,
+    bool log_output,
+    std::optional<OdometryParams> odom_params)
+    : VisionImuFrontend(frontend_params,
+                        imu_params,
+                        imu_initial_bias,
+                        display_queue,
+                        log_output,
+                        odom_params),
+      camera_tracks_(cameras.size()) {
+  CHECK(!cameras.empty());
+  for (size_t cam_idx = 0u; cam_idx < cameras.size(); ++cam_idx) {
+    CameraTrack& track = camera_tracks_[cam_idx];
+    track.camera_ = CHECK_NOTNULL(cameras[cam_idx]);
+    // Each camera has its own tracker: trackers are not thread-safe.
+    track.owned_tracker_ = std::make_unique<Tracker>(
+        frontend_params_.tracker_params_, track.camera_, display_queue);
+    track.owned_tracker_->setDebugImageWorker(debug_image_worker_.get());
+    track.feature_detector_ = std::make_unique<FeatureDetector>(
+        frontend_params_.feature_detector_params_);
+  }
+  // The reference camera's tracker is the one of the base class.
+  tracker_ = std::move(camera_tracks_[0u].owned_tracker_);
+  for (CameraTrack& track : camera_tracks_) {
+    track.tracker_ =
+        track.owned_tracker_ ? track.owned_tracker_.get() : tracker_.get();
+  }
+
+  if (VLOG_IS_ON(1)) tracker_->tracker_params_.print();
+}
+
+MultiCameraVisionImuFrontend::~MultiCameraVisionImuFrontend() {
+  LOG(INFO) << "MultiCameraVisionImuFrontend destructor called.";
+}
+
+MultiCameraFrontendOutput::UniquePtr
+MultiCameraVisionImuFrontend::bootstrapSpinMultiCamera(
+    MultiCameraFrontendInputPayload::UniquePtr&& input) {
+  CHECK(input);
+  CHECK_EQ(input->getNrCameras(), camera_tracks_.size());
+
+  // Initialize members of the Frontend
+  forEachCamera([this, &input](const size_t& cam_idx) {
+    processFirstFrame(&camera_tracks_[cam_idx], input->getFrame(cam_idx));
+  });
+  last_keyframe_timestamp_ = input->timestamp_;
+  ++frame_count_;
+  imu_frontend_->resetIntegrationWithCachedBias();
+
+  // Initialization done, set state to nominal
+  frontend_state_ = FLAGS_do_fine_imu_camera_temporal_sync
+                        ? FrontendState::InitialTimeAlignment
+                        : FrontendState::Nominal;
+
+  if (!FLAGS_do_fine_imu_camera_temporal_sync && odom_params_) {
+    // we assume that the first frame is hardcoded to be a keyframe.
+    // it's okay if world_NavState_odom_ is none (it gets cached later)
+    cacheExternalOdometry(input.get());
+  }
+
+  if (FLAGS_do_fine_imu_camera_temporal_sync) {
+    return nullptr;  // skip adding a frame to all downstream modules
+  }
+
+  // Create mostly invalid output
+  return std::make_unique<MultiCameraFrontendOutput>(
+      true,
+      getCameraMeasurements(
+          std::vector<StatusMonoMeasurementsPtr>(camera_tracks_.size())),
+      getLastFrames(true),
+      nullptr,
+      input->getImuAccGyrs(),
+      cv::Mat(),
+      getTrackerInfo());
+}
+
+MultiCameraFrontendOutput::UniquePtr
+MultiCameraVisionImuFrontend::nominalSpinMultiCamera(
+    MultiCameraFrontendInputPayload::UniquePtr&& input) {
+  CHECK(input);
+  CHECK_EQ(input->getNrCameras(), camera_tracks_.size());
+  // For timing
+  utils::StatsCollector timing_stats_frame_rate("VioFrontend Frame Rate [ms]");
+  utils::StatsCollector timing_stats_keyframe_rate(
+      "VioFrontend Keyframe Rate [ms]");
+  auto start_time = utils::Timer::tic();
+
+  VLOG(1) << "------------------- Processing frame k = "
+          << input->getFrame(0u).id_ << "--------------------";
+  if (VLOG_IS_ON(10)) input->print();
+
+  // The copies of the frames and their pyramids do not need the IMU: they
+  // can be done while preintegrating.
+  const ImuFrontend::PimPtr pim = preintegrateImuWhile(
+      input->getImuStamps(), input->getImuAccGyrs(), [this, &input]() {
+        forEachCamera([this, &input](const size_t& cam_idx) {
+          CameraTrack& track = camera_tracks_[cam_idx];
+          track.frame_k_ = std::make_shared<Frame>(input->getFrame(cam_idx));
+          track.tracker_->buildOpticalFlowPyramid(*track.frame_k_);
+        });
+      });
+  std::vector<gtsam::Rot3> keyframe_R_cur_frames;
+  keyframe_R_cur_frames.reserve(camera_tracks_.size());
+  for (const CameraTrack& track : camera_tracks_) {
+    keyframe_R_cur_frames.push_back(getKeyframeRotation(track, pim));
+  }
+
+  /////////////////////////////// TRACKING /////////////////////////////////////
+  forEachCamera([this, &keyframe_R_cur_frames](const size_t& cam_idx) {
+    trackFrame(&camera_tracks_[cam_idx], keyframe_R_cur_frames[cam_idx]);
+  });
+  CameraTrack& reference_track = camera_tracks_[0u];
+  const cv::Mat feature_tracks = tracker_->getTrackerImage(
+      *reference_track.frame_lkf_, *reference_track.frame_k_);
+
+  // The reference camera decides for all cameras.
+  const bool is_keyframe =
+      shouldBeKeyframe(*reference_track.frame_k_, *reference_track.frame_lkf_);
+  std::vector<StatusMonoMeasurementsPtr> status_measurements(
+      camera_tracks_.size());
+  if (is_keyframe) {
+    ++keyframe_count_;
+    last_keyframe_timestamp_ = reference_track.frame_k_->timestamp_;
+    forEachCamera([this, &keyframe_R_cur_frames, &status_measurements](
+                      const size_t& cam_idx) {
+      status_measurements[cam_idx] = processKeyframe(
+          &camera_tracks_[cam_idx], keyframe_R_cur_frames[cam_idx]);
+    });
+  } else {
+    for (size_t cam_idx = 0u; cam_idx < camera_tracks_.size(); ++cam_idx) {
+      CameraTrack& track = camera_tracks_[cam_idx];
+      track.frame_k_->isKeyframe_ = false;
+      status_measurements[cam_idx] = std::make_shared<StatusMonoMeasurements>(
+          std::make_pair(track.status_, MonoMeasurements()));
+    }
+  }
+  tracker_status_summary_ = reference_track.status_;
+  for (size_t cam_idx = 0u; cam_idx < camera_tracks_.size(); ++cam_idx) {
+    finishFrame(&camera_tracks_[cam_idx], keyframe_R_cur_frames[cam_idx]);
+  }
+  ++frame_count_;
+  //////////////////////////////////////////////////////////////////////////////
+
+  if (is_keyframe) {
+    VLOG(1) << "Keyframe " << reference_track.frame_lkf_->id_ << " with: "
+            << status_measurements[0u]->second.size()
+            << " smart measurements in the reference camera";
+
+    ////////////////// DEBUG INFO FOR FRONT-END ////////////////////////////////
+    if (logger_) {
+      const Frame& frame_lkf = *reference_track.frame_lkf_;
+      logger_->logFrontendStats(frame_lkf.timestamp_,
+                                getTrackerInfo(),
+                                tracker_status_summary_,
+                                frame_lkf.getNrValidKeypoints());
+      logger_->logFrontendRansac(frame_lkf.timestamp_,
+                                 tracker_status_summary_.lkf_T_k_mono_,
+                                 gtsam::Pose3());
+    }
+    ////////////////////////////////////////////////////////////////////////////
+
+    // Reset integration; the later the better.
+    VLOG(10) << "Reset IMU preintegration with latest IMU bias.";
+    imu_frontend_->resetIntegrationWithCachedBias();
+
+    // Record keyframe rate timing
+    timing_stats_keyframe_rate.AddSample(utils::Timer::toc(start_time).count());
+
+    VLOG(2) << "Frontend output is a keyframe: pushing to output callbacks.";
+    return std::make_unique<MultiCameraFrontendOutput>(
+        frontend_state_ == FrontendState::Nominal,
+        getCameraMeasurements(status_measurements),
+        getLastFrames(true),
+        pim,
+        input->getImuAccGyrs(),
+        feature_tracks,
+        getTrackerInfo(),
+        getExternalOdometryRelativeBodyPose(input.get()),
+        getExternalOdometryWorldVelocity(input.get()));
+  }
+
+  // Record frame rate timing
+  timing_stats_frame_rate.AddSample(utils::Timer::toc(start_time).count());
+
+  // We don't have a keyframe, so instead we forward the newest frames in this
+  // packet for use in the temporal calibration (if enabled)
+  VLOG(2) << "Frontend output is not a keyframe. Skipping output queue push.";
+  return std::make_unique<MultiCameraFrontendOutput>(
+      false,
+      getCameraMeasurements(status_measurements),
+      getLastFrames(false),
+      pim,
+      input->getImuAccGyrs(),
+      feature_tracks,
+      getTrackerInfo());
+}
+
+void MultiCameraVisionImuFrontend::forEachCamera(
+    const std::function<void(const size_t&)>& work) const {
+  CHECK(work);
+  if (camera_tracks_.size() == 1u) {
+    work(0u);
+    return;
+  }
+  // One stripe per camera, so that a slow camera does not hold the others.
+  cv::parallel_for_(
+      cv::Range(0, static_cast<int>(camera_tracks_.size())),
+      [&work](const cv::Range& range) {
+        for (int cam_idx = range.start; cam_idx < range.end; ++cam_idx) {
+          work(static_cast<size_t>(cam_idx));
+        }
+      },
+      static_cast<double>(camera_tracks_.size()));
+}
+
+void MultiCameraVisionImuFrontend::processFirstFrame(
+    CameraTrack* track,
+    const Frame& first_frame) const {
+  CHECK_NOTNULL(track);
+  VLOG(2) << "Processing first frame of camera "
+          << track->camera_->getCamParams().camera_id_;
+  track->frame_k_ = std::make_shared<Frame>(first_frame);
+  track->frame_k_->isKeyframe_ = true;
+
+  CHECK_EQ(track->frame_k_->keypoints_.size(), 0)
+      << "Keypoints already present in first frame: please do not extract"
+         " keypoints manually";
+
+  CHECK(track->feature_detector_);
+  track->feature_detector_->featureDetection(track->frame_k_.get());
+
+  // Undistort keypoints:
+  track->camera_->undistortKeypoints(track->frame_k_->keypoints_,
+                                     &track->frame_k_->keypoints_undistorted_);
+
+  track->frame_km1_ = track->frame_k_;
+  track->frame_lkf_ = track->frame_k_;
+  track->frame_k_.reset();
+}
+
+void MultiCameraVisionImuFrontend::trackFrame(
+    CameraTrack* track,
+    const gtsam::Rot3& keyframe_R_cur_frame) const {
+  KIMERA_TRACE_SCOPE("MultiCameraVisionImuFrontend::trackFrame");
+  CHECK_NOTNULL(track);
+  // Copied by nominalSpinMultiCamera, while preintegrating the IMU.
+  CHECK(track->frame_k_);
+  CHECK(track->frame_km1_);
+
+  const gtsam::Rot3 ref_frame_R_cur_frame =
+      track->keyframe_R_ref_frame_.inverse().compose(keyframe_R_cur_frame);
+  track->tracker_->featureTracking(track->frame_km1_.get(),
+                                   track->frame_k_.get(),
+                                   ref_frame_R_cur_frame,
+                                   frontend_params_.feature_detector_params_);
+
+  // TODO(marcus): need another structure for monocular slam
+  track->status_.kfTrackingStatus_mono_ = TrackingStatus::INVALID;
+  track->status_.kfTrackingStatus_stereo_ = TrackingStatus::DISABLED;
+}
+
+StatusMonoMeasurementsPtr MultiCameraVisionImuFrontend::processKeyframe(
+    CameraTrack* track,
+    const gtsam::Rot3& keyframe_R_cur_frame) const {
+  KIMERA_TRACE_SCOPE("MultiCameraVisionImuFrontend::processKeyframe");
+  CHECK_NOTNULL(track);
+  Frame::Ptr& frame_k = track->frame_k_;
+  CHECK(frame_k);
+
+  if (frontend_params_.useRANSAC_) {
+    TrackingStatusPose status_pose_mono;
+    outlierRejectionMono(keyframe_R_cur_frame,
+                         track->frame_lkf_.get(),
+                         frame_k.get(),
+                         &status_pose_mono,
+                         track->tracker_);
+    track->status_.kfTrackingStatus_mono_ = status_pose_mono.first;
+    if (status_pose_mono.first == TrackingStatus::VALID) {
+      track->status_.lkf_T_k_mono_ = status_pose_mono.second;
+    }
+  } else {
+    track->status_.kfTrackingStatus_mono_ = TrackingStatus::DISABLED;
+  }
+
+  frame_k->isKeyframe_ = true;
+  CHECK(track->feature_detector_);
+  track->feature_detector_->featureDetection(frame_k.get());
+
+  // Undistort keypoints:
+  track->camera_->undistortKeypoints(frame_k->keypoints_,
+                                     &frame_k->keypoints_undistorted_);
+
+  if (display_queue_ && FLAGS_visualize_feature_tracks) {
+    const Timestamp timestamp = frame_k->timestamp_;
+    const std::string name =
+        "feature_tracks_" + track->camera_->getCamParams().camera_id_;
+    DisplayQueue* display_queue = display_queue_;
+    TrackerImageInput input(*track->frame_lkf_, *frame_k);
+    runDebugImageJob(
+        [timestamp, name, display_queue, input = std::move(input)]() {
+          displayImage(timestamp,
+                       name,
+                       Tracker::drawTrackerImage(input),
+                       display_queue);
+        });
+  }
+
+  track->frame_lkf_ = frame_k;
+
+  MonoMeasurements smart_mono_measurements;
+  MonoVisionImuFrontend::getSmartMonoMeasurements(frame_k,
+                                                  &smart_mono_measurements);
+  return std::make_shared<StatusMonoMeasurements>(
+      std::make_pair(track->status_, std::move(smart_mono_measurements)));
+}
+
+void MultiCameraVisionImuFrontend::finishFrame(
+    CameraTrack* track,
+    const gtsam::Rot3& keyframe_R_cur_frame) const {
+  CHECK_NOTNULL(track);
+  CHECK(track->frame_k_);
+  track->keyframe_R_ref_frame_ = track->frame_k_->isKeyframe_
+                                     ? gtsam::Rot3()
+                                     : keyframe_R_cur_frame;
+  track->frame_km1_ = track->frame_k_;
+  track->frame_k_.reset();
+}
+
+gtsam::Rot3 MultiCameraVisionImuFrontend::getKeyframeRotation(
+    const CameraTrack& track,
+    const ImuFrontend::PimPtr& pim) const {
+  CHECK(pim);
+  const gtsam::Rot3 body_R_cam = track.camera_->getBodyPoseCam().rotation();
+  return body_R_cam.inverse() * pim->deltaRij() * body_R_cam;
+}
+
+MultiCameraMeasurements MultiCameraVisionImuFrontend::getCameraMeasurements(
+    const std::vector<StatusMonoMeasurementsPtr>& status_measurements) const {
+  CHECK_EQ(status_measurements.size(), camera_tracks_.size());
+  MultiCameraMeasurements camera_measurements;
+  camera_measurements.reserve(camera_tracks_.size());
+  for (size_t cam_idx = 0u; cam_idx < camera_tracks_.size(); ++cam_idx) {
+    camera_measurements.emplace_back(
+        camera_tracks_[cam_idx].camera_->getBodyPoseCam(),
+        status_measurements[cam_idx]);
+  }
+  return camera_measurements;
+}
+
+std::vector<Frame> MultiCameraVisionImuFrontend::getLastFrames(
+    const bool& is_keyframe) const {
+  std::vector<Frame> frames;
+  frames.reserve(camera_tracks_.size());
+  for (const CameraTrack& track : camera_tracks_) {
+    const Frame::Ptr& frame = is_keyframe ? track.frame_lkf_ : track.frame_km1_;
+    CHECK(frame);
+    frames.push_back(*frame);
+  }
+  return frames;
+}
+
+}  // namespace VIO
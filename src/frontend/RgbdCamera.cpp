@@ -15,7 +15,14 @@
 
 #include "kimera-vio/frontend/RgbdCamera.h"
 
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include <opencv2/core/utility.hpp>
+
 #include "kimera-vio/frontend/Camera.h"
+#include "kimera-vio/utils/SimdKernels.h"
 
 namespace VIO {
 
@@ -24,6 +31,7 @@ void convertToPcl(const cv::Mat& intensity_img,
                   const cv::Mat& depth_img,
                   const CameraParams::Intrinsics& intrinsics,
                   const T& depth_factor,
+                  const int& stride,
                   cv::Mat* cloud,
                   cv::Mat* colors) {
   CHECK_NOTNULL(cloud);
@@ -31,54 +39,61 @@ void convertToPcl(const cv::Mat& intensity_img,
   CHECK_EQ(intensity_img.type(), CV_8UC1);
   CHECK(depth_img.type() == CV_16UC1 || depth_img.type() == CV_32FC1);
   CHECK_EQ(depth_img.size(), intensity_img.size());
+  CHECK_GT(stride, 0);
+
+  const int rows = (intensity_img.rows + stride - 1) / stride;
+  const int cols = (intensity_img.cols + stride - 1) / stride;
+
+  // Rays through the sampled pixels, using the principal point from
+  // calibration: (X, Y, Z) = (ray_x[u] * Z, ray_y[v] * Z, Z).
+  const float center_x = intrinsics.at(2u);
+  const float center_y = intrinsics.at(3u);
+  std::vector<float> ray_x(cols);
+  for (int u = 0; u < cols; ++u) {
+    ray_x[u] = (u * stride - center_x) / intrinsics.at(0u);
+  }
+  std::vector<float> ray_y(rows);
+  for (int v = 0; v < rows; ++v) {
+    ray_y[v] = (v * stride - center_y) / intrinsics.at(1u);
+  }
 
-  int img_rows = intensity_img.rows;
-  int img_cols = intensity_img.cols;
-
-  // Use correct principal point from calibration
-  float center_x = intrinsics.at(2u);
-  float center_y = intrinsics.at(3u);
-
-  // Combine unit conversion (if necessary) with scaling by focal length
-  // for computing (X,Y) 0.001f if uint16_t, 1.0f if floats in depth_msg
-  // float unit_scaling = 0.001f;
-  double unit_scaling = DepthTraits<T>::toMeters(T(1));
-  float constant_x = unit_scaling / intrinsics.at(0u);
-  float constant_y = unit_scaling / intrinsics.at(1u);
-  float bad_point = std::numeric_limits<float>::quiet_NaN();
-
-  cv::Mat_<cv::Point3f> cloud_out =
-      cv::Mat(img_rows, img_cols, CV_32FC3, cv::Scalar(0.0, 0.0, 0.0));
-  cv::Mat colors_out =
-      cv::Mat(img_rows, img_cols, CV_8UC3, cv::viz::Color::red());
-
-  for (int v = 0u; v < img_rows; ++v) {
-    for (int u = 0u; u < img_cols; ++u) {
-      T depth = depth_img.at<T>(v, u) * depth_factor;
-      cv::Point3f& xyz = cloud_out.at<cv::Point3f>(v, u);
-      cv::Vec3b& color = colors_out.at<cv::Vec3b>(v, u);
-
-      // Check for invalid measurements
-      // TODO(Toni): could clip depth here...
-      if (!DepthTraits<T>::valid(depth)) {
-        xyz.x = bad_point;
-        xyz.y = bad_point;
-        xyz.z = bad_point;
-      } else {
-        // Fill in XYZ
-        xyz.x = (u - center_x) * depth * constant_x;
-        xyz.y = (v - center_y) * depth * constant_y;
-        xyz.z = depth * unit_scaling;
-
-        // Fill in color (grayscale for now)
-        const auto& grey_value = intensity_img.at<uint8_t>(v, u);
-        color = cv::Vec3b(grey_value, grey_value, grey_value);
+  // No reallocation if the buffers have the right size and type already.
+  cloud->create(rows, cols, CV_32FC3);
+  colors->create(rows, cols, CV_8UC3);
+
+  const cv::Scalar& red = cv::viz::Color::red();
+  const cv::Vec3b invalid_color(red[0], red[1], red[2]);
+  const utils::SimdKernels::DepthRowFunction depth_row_to_points =
+      utils::SimdKernels::get().depth_row_to_points;
+  cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range& range) {
+    std::vector<float> depth_row(cols);
+    for (int v = range.start; v < range.end; ++v) {
+      const T* depth_ptr = depth_img.ptr<T>(v * stride);
+      for (int u = 0; u < cols; ++u) {
+        const T depth = depth_ptr[u * stride] * depth_factor;
+        // Invalid measurements are NaNs for the kernel.
+        // TODO(Toni): could clip depth here...
+        depth_row[u] = DepthTraits<T>::valid(depth)
+                           ? DepthTraits<T>::toMeters(depth)
+                           : std::numeric_limits<float>::quiet_NaN();
+      }
+      depth_row_to_points(depth_row.data(),
+                          ray_x.data(),
+                          ray_y[v],
+                          cols,
+                          cloud->ptr<float>(v));
+
+      // Fill in color (grayscale for now)
+      const uint8_t* intensity_ptr = intensity_img.ptr<uint8_t>(v * stride);
+      cv::Vec3b* color_ptr = colors->ptr<cv::Vec3b>(v);
+      for (int u = 0; u < cols; ++u) {
+        const uint8_t& grey_value = intensity_ptr[u * stride];
+        color_ptr[u] = std::isnan(depth_row[u])
+                           ? invalid_color
+                           : cv::Vec3b(grey_value, grey_value, grey_value);
       }
     }
-  }
-
-  *cloud = cloud_out;
-  *colors = colors_out;
+  });
 }
 
 RgbdCamera::RgbdCamera(const CameraParams& cam_params) : Camera(cam_params) {}
@@ -105,7 +120,8 @@ gtsam::StereoCamera RgbdCamera::getFakeStereoCamera() const {
 
 void RgbdCamera::convertRgbdToPointcloud(const RgbdFrame& rgbd_frame,
                                          cv::Mat* cloud,
-                                         cv::Mat* colors) {
+                                         cv::Mat* colors,
+                                         const int& stride) {
   CHECK_NOTNULL(cloud);
   CHECK_NOTNULL(colors);
   const auto& depth_type = rgbd_frame.depth_img_.depth_img_.type();
@@ -114,6 +130,7 @@ void RgbdCamera::convertRgbdToPointcloud(const RgbdFrame& rgbd_frame,
                                   rgbd_frame.depth_img_.depth_img_,
                                   cam_params_.intrinsics_,
                                   depth_factor_,
+                                  stride,
                                   cloud,
                                   colors);
   } else if (depth_type == CV_32FC1) {
@@ -121,6 +138,7 @@ void RgbdCamera::convertRgbdToPointcloud(const RgbdFrame& rgbd_frame,
                                rgbd_frame.depth_img_.depth_img_,
                                cam_params_.intrinsics_,
                                static_cast<float>(depth_factor_),
+                               stride,
                                cloud,
                                colors);
 
@@ -74,6 +74,11 @@ void RgbdFrame::fillStereoFrame(const RgbdCamera& camera,
   keypoint_depths.reserve(left_keypoints_rect.size());
   stereo_frame.keypoints_3d_.reserve(left_keypoints_rect.size());
 
+  std::vector<float> depths;
+  depth_img_.getDepthsAtPoints(
+      params, stereo_frame.left_frame_.keypoints_, &depths);
+  CHECK_GE(depths.size(), left_keypoints_rect.size());
+
   for (size_t i = 0; i < left_keypoints_rect.size(); ++i) {
     const auto& status_keypoint_pair = left_keypoints_rect[i];
     if (status_keypoint_pair.first != KeypointStatus::VALID) {
@@ -83,8 +88,7 @@ void RgbdFrame::fillStereoFrame(const RgbdCamera& camera,
       continue;
     }
 
-    const float keypoint_depth = depth_img_.getDepthAtPoint(
-        params, stereo_frame.left_frame_.keypoints_[i]);
+    const float& keypoint_depth = depths[i];
 
     if (!std::isfinite(keypoint_depth)) {
       right_keypoints_rect.push_back({KeypointStatus::NO_DEPTH, null_point});
@@ -24,6 +24,9 @@
 DEFINE_bool(log_rgbd_tracking_images,
             false,
             "Display and/or save rgbd specific debug images");
+DEFINE_bool(log_rgbd_depth_frames,
+            false,
+            "Save the depth frames, compressed, to the frontend log folder.");
 DECLARE_bool(do_fine_imu_camera_temporal_sync);
 
 namespace VIO {
@@ -55,6 +58,7 @@ RgbdVisionImuFrontend::RgbdVisionImuFrontend(
 
   tracker_ = std::make_unique<Tracker>(
       frontend_params_.tracker_params_, camera_, display_queue);
+  tracker_->setDebugImageWorker(debug_image_worker_.get());
 
   if (VLOG_IS_ON(1)) tracker_->tracker_params_.print();
 }
@@ -117,13 +121,16 @@ RgbdOutputPtr RgbdVisionImuFrontend::nominalSpin(RgbdInputPtr&& base_input) {
   if (VLOG_IS_ON(10)) input->print();
 
   // see stereo frontend for PIM window end behavior explanation
-  auto tic_pim = Timer::tic();
-  const ImuFrontend::PimPtr& pim = imu_frontend_->preintegrateImuMeasurements(
-      input->imu_stamps_, input->imu_accgyrs_);
-  CHECK(pim);
-
-  auto pim_duration = Timer::toc<std::chrono::microseconds>(tic_pim).count();
-  VLOG(1) << "Current IMU Preintegration time: " << pim_duration << "[us]";
+  // The stereo frame and its pyramid do not need the IMU: they can be built
+  // while preintegrating.
+  StereoFrame::Ptr stereo_frame_k = nullptr;
+  const ImuFrontend::PimPtr pim = preintegrateImuWhile(
+      input->imu_stamps_,
+      input->imu_accgyrs_,
+      [this, &frame_k, &stereo_frame_k]() {
+        stereo_frame_k = frame_k.getStereoFrame();
+        tracker_->buildOpticalFlowPyramid(stereo_frame_k->left_frame_);
+      });
 
   const gtsam::Rot3 body_Rot_cam = camera_->getBodyPoseCam().rotation();
   const gtsam::Rot3 cam_Rot_body = body_Rot_cam.inverse();
@@ -141,7 +148,10 @@ RgbdOutputPtr RgbdVisionImuFrontend::nominalSpin(RgbdInputPtr&& base_input) {
   VLOG(10) << "Starting processStereoFrame...";
   cv::Mat feature_tracks;
   StatusStereoMeasurementsPtr stereo_measurements =
-      processFrame(frame_k, camLrectLkf_R_camLrectK_imu, &feature_tracks);
+      processFrame(frame_k,
+                   stereo_frame_k,
+                   camLrectLkf_R_camLrectK_imu,
+                   &feature_tracks);
   VLOG(10) << "Finished processStereoFrame.";
 
   if (VLOG_IS_ON(5)) {
@@ -157,7 +167,9 @@ RgbdOutputPtr RgbdVisionImuFrontend::nominalSpin(RgbdInputPtr&& base_input) {
     VLOG(10) << "Reset IMU preintegration with latest IMU bias.";
     imu_frontend_->resetIntegrationWithCachedBias();
 
-    timing_stats_kf_rate.AddSample(Timer::toc(start_time).count());
+    const double keyframe_time_ms = Timer::toc(start_time).count();
+    timing_stats_kf_rate.AddSample(keyframe_time_ms);
+    updateFeatureBudget(keyframe_time_ms, feature_detector_.get());
     VLOG(2) << "Frontend output is a keyframe: pushing to output callbacks.";
   } else {
     timing_stats_frame_rate.AddSample(Timer::toc(start_time).count());
@@ -235,6 +247,7 @@ void RgbdVisionImuFrontend::checkAndLogKeyframe() {
 
 StatusStereoMeasurementsPtr RgbdVisionImuFrontend::processFrame(
     const RgbdFrame& rgbd_frame,
+    const StereoFrame::Ptr& stereo_frame,
     const gtsam::Rot3& keyframe_R_cur_frame,
     cv::Mat* feature_tracks) {
   CHECK(tracker_);
@@ -247,7 +260,7 @@ StatusStereoMeasurementsPtr RgbdVisionImuFrontend::processFrame(
           << " timestamp diff [s]: " << UtilsNumerical::NsecToSec(frame_diff_ns)
           << " (timestamp diff [ns]: " << frame_diff_ns << ")";
 
-  auto stereo_frame = rgbd_frame.getStereoFrame();
+  CHECK(stereo_frame);
 
   VLOG(2) << "Starting feature tracking...";
   gtsam::Rot3 ref_frame_R_cur_frame =
@@ -398,15 +411,13 @@ void RgbdVisionImuFrontend::fillSmartStereoMeasurements(
   }
 }
 
-cv::Mat drawDepthImage(const StereoFrame& stereo_frame,
-                       const DepthFrame& depth_frame,
-                       const CameraParams& params) {
+cv::Mat drawDepthImage(const cv::Mat& depth_img_raw,
+                       const double& depth_to_uint8,
+                       const KeypointsCV& keypoints,
+                       const std::vector<bool>& has_depth) {
+  CHECK_EQ(keypoints.size(), has_depth.size());
   cv::Mat depth_img;
-  // convert to uint8_t while so that [0, max_depth] maps to 255
-  depth_frame.depth_img_.convertTo(
-      depth_img,
-      CV_8UC1,
-      params.depth.depth_to_meters_ / params.depth.max_depth_ * 255);
+  depth_img_raw.convertTo(depth_img, CV_8UC1, depth_to_uint8);
 
   cv::Mat img_rgb;
   cv::cvtColor(depth_img, img_rgb, cv::COLOR_GRAY2RGB);
@@ -414,18 +425,9 @@ cv::Mat drawDepthImage(const StereoFrame& stereo_frame,
   static const cv::Scalar red(0, 0, 255);
   static const cv::Scalar green(0, 255, 0);
 
-  const Frame& frame = stereo_frame.left_frame_;
   // Add all keypoints in cur_frame with the tracks.
-  for (size_t i = 0; i < frame.keypoints_.size(); ++i) {
-    const cv::Point2f& px = frame.keypoints_.at(i);
-    if (stereo_frame.left_keypoints_rectified_[i].first ==
-            KeypointStatus::VALID &&
-        stereo_frame.right_keypoints_rectified_[i].first ==
-            KeypointStatus::VALID) {
-      cv::circle(img_rgb, px, 4, green, 2);
-    } else {
-      cv::circle(img_rgb, px, 4, red, 2);
-    }
+  for (size_t i = 0; i < keypoints.size(); ++i) {
+    cv::circle(img_rgb, keypoints[i], 4, has_depth[i] ? green : red, 2);
   }
   return img_rgb;
 }
@@ -438,80 +440,112 @@ void RgbdVisionImuFrontend::logTrackingImages(const StereoFrame& frame,
     sendMonoTrackingToLogger(frame);
   }
 
+  if (logger_ && FLAGS_log_rgbd_depth_frames) {
+    // Shares the depth image, the frame is compressed by the worker.
+    FrontendLogger* logger = logger_.get();
+    const DepthFrame depth_frame(rgbd_frame.depth_img_);
+    runDebugImageJob(
+        [logger, depth_frame]() { logger->logDepthFrame(depth_frame); });
+  }
+
   const bool log_tracks = logger_valid && FLAGS_log_feature_tracks;
   const bool display_tracks = display_queue_ && FLAGS_visualize_feature_tracks;
-  if (!log_tracks && !display_tracks) {
+  const bool log_depth = logger_valid && FLAGS_log_rgbd_tracking_images;
+  if (!log_tracks && !display_tracks && !log_depth) {
     return;
   }
 
-  cv::Mat img =
-      tracker_->getTrackerImage(frame_lkf_->left_frame_, frame.left_frame_);
-  if (log_tracks) {
-    logger_->logFrontendImg(frame.id_,
-                            img,
-                            "monoFeatureTracksLeft",
-                            "/monoFeatureTracksLeftImg/",
-                            FLAGS_visualize_frontend_images,
-                            FLAGS_save_frontend_images);
-  }
+  // Only image headers and keypoints are copied for drawing.
+  FrontendLogger* logger = logger_.get();
+  DisplayQueue* display_queue = display_queue_;
+  const FrameId frame_id = frame.id_;
+  const Timestamp timestamp = frame.timestamp_;
+  const bool disp_img = FLAGS_visualize_frontend_images;
+  const bool save_img = FLAGS_save_frontend_images;
+  TrackerImageInput input(frame_lkf_->left_frame_, frame.left_frame_);
 
-  if (logger_valid && FLAGS_log_rgbd_tracking_images) {
-    cv::Mat rgbd_img =
-        drawDepthImage(frame, rgbd_frame.depth_img_, camera_->getCamParams());
-    logger_->logFrontendImg(frame.id_,
-                            rgbd_img,
-                            "rgbdDepthFeatures",
-                            "/rgbdDepthFeaturesImg/",
-                            FLAGS_visualize_frontend_images,
-                            FLAGS_save_frontend_images);
+  cv::Mat depth_img;
+  double depth_to_uint8 = 0.0;
+  std::vector<bool> has_depth;
+  if (log_depth) {
+    // convert to uint8_t while so that [0, max_depth] maps to 255
+    const CameraParams& params = camera_->getCamParams();
+    depth_img = rgbd_frame.depth_img_.depth_img_;
+    depth_to_uint8 =
+        params.depth.depth_to_meters_ / params.depth.max_depth_ * 255;
+    has_depth.reserve(frame.left_frame_.keypoints_.size());
+    for (size_t i = 0; i < frame.left_frame_.keypoints_.size(); ++i) {
+      has_depth.push_back(
+          frame.left_keypoints_rectified_[i].first == KeypointStatus::VALID &&
+          frame.right_keypoints_rectified_[i].first == KeypointStatus::VALID);
+    }
   }
 
-  if (display_tracks) {
-    displayImage(frame.timestamp_, "feature_tracks", img, display_queue_);
-  }
+  runDebugImageJob([logger,
+                    display_queue,
+                    frame_id,
+                    timestamp,
+                    disp_img,
+                    save_img,
+                    log_tracks,
+                    display_tracks,
+                    input = std::move(input),
+                    depth_img,
+                    depth_to_uint8,
+                    has_depth = std::move(has_depth)]() {
+    if (log_tracks || display_tracks) {
+      const cv::Mat img = Tracker::drawTrackerImage(input);
+      if (log_tracks) {
+        logger->logFrontendImg(frame_id,
+                               img,
+                               "monoFeatureTracksLeft",
+                               "/monoFeatureTracksLeftImg/",
+                               disp_img,
+                               save_img);
+      }
+      if (display_tracks) {
+        displayImage(timestamp, "feature_tracks", img, display_queue);
+      }
+    }
+
+    if (!depth_img.empty()) {
+      logger->logFrontendImg(
+          frame_id,
+          drawDepthImage(
+              depth_img, depth_to_uint8, input.cur_keypoints_, has_depth),
+          "rgbdDepthFeatures",
+          "/rgbdDepthFeaturesImg/",
+          disp_img,
+          save_img);
+    }
+  });
 }
 
 void RgbdVisionImuFrontend::sendMonoTrackingToLogger(
     const StereoFrame& frame) const {
-  const Frame& cur_left_frame = frame.left_frame_;
-  const Frame& ref_left_frame = frame_lkf_->left_frame_;
-
-  // Find keypoint matches.
-  DMatchVec matches;
-  for (size_t i = 0; i < cur_left_frame.keypoints_.size(); ++i) {
-    if (cur_left_frame.landmarks_.at(i) != -1) {  // if landmark is valid
-      auto it = find(ref_left_frame.landmarks_.begin(),
-                     ref_left_frame.landmarks_.end(),
-                     cur_left_frame.landmarks_.at(i));
-      if (it != ref_left_frame.landmarks_.end()) {  // if landmark was found
-        int nPos = std::distance(ref_left_frame.landmarks_.begin(), it);
-        matches.push_back(cv::DMatch(nPos, i, 0));
-      }
-    }
-  }
-
-  // Plot matches.
-  cv::Mat img_left_lkf_kf =
-      UtilsOpenCV::DrawCornersMatches(ref_left_frame.img_,
-                                      ref_left_frame.keypoints_,
-                                      cur_left_frame.img_,
-                                      cur_left_frame.keypoints_,
-                                      matches,
-                                      false);  // true: random color
-  cv::putText(img_left_lkf_kf,
-              "M:" + std::to_string(keyframe_count_ - 1) + "-" +
-                  std::to_string(keyframe_count_),
-              KeypointCV(10, 15),
-              CV_FONT_HERSHEY_COMPLEX,
-              0.6,
-              cv::Scalar(0, 255, 0));
-
-  logger_->logFrontendImg(cur_left_frame.id_,
-                          img_left_lkf_kf,
-                          "monoTrackingUnrectified",
-                          "/monoTrackingUnrectifiedImg/",
-                          FLAGS_visualize_frontend_images,
-                          FLAGS_save_frontend_images);
+  CHECK(logger_);
+  FrontendLogger* logger = logger_.get();
+  const FrameId frame_id = frame.left_frame_.id_;
+  const int keyframe_count = keyframe_count_;
+  const bool disp_img = FLAGS_visualize_frontend_images;
+  const bool save_img = FLAGS_save_frontend_images;
+  const cv::Mat ref_img = frame_lkf_->left_frame_.img_;
+  TrackerImageInput input(frame_lkf_->left_frame_, frame.left_frame_);
+  runDebugImageJob([logger,
+                    frame_id,
+                    keyframe_count,
+                    disp_img,
+                    save_img,
+                    ref_img,
+                    input = std::move(input)]() {
+    logger->logFrontendImg(
+        frame_id,
+        drawMonoTrackingImage(ref_img, input, keyframe_count),
+        "monoTrackingUnrectified",
+        "/monoTrackingUnrectifiedImg/",
+        disp_img,
+        save_img);
+  });
 }
 
 gtsam::Pose3 RgbdVisionImuFrontend::getRelativePoseBodyMono() const {
@@ -0,0 +1,105 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   StationaryDetector.cpp
+ * @brief  Detects when the platform stands still, from the IMU variance and
+ * the feature disparity, to run the pipeline in idle mode.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/frontend/StationaryDetector.h"
+
+#include <cmath>
+
+#include <glog/logging.h>
+
+#include "kimera-vio/utils/UtilsNumerical.h"
+
+namespace VIO {
+
+StationaryDetector::StationaryDetector(const StationaryDetectorParams& params)
+    : params_(params),
+      frame_imu_still_(false),
+      frame_gyro_sum_(Eigen::Vector3d::Zero()),
+      frame_nr_gyro_samples_(0u),
+      still_since_(0),
+      idle_since_(0),
+      is_still_(false),
+      is_idle_(false),
+      still_gyro_sum_(Eigen::Vector3d::Zero()),
+      still_nr_gyro_samples_(0u) {
+  CHECK_GE(params_.min_duration_s, 0.0);
+  CHECK_GT(params_.max_keyframe_time_s, 0.0);
+}
+
+void StationaryDetector::addImuMeasurements(const ImuAccGyrS& imu_accgyrs) {
+  const Eigen::Index n = imu_accgyrs.cols();
+  frame_nr_gyro_samples_ = static_cast<size_t>(n);
+  frame_gyro_sum_ = imu_accgyrs.bottomRows<3>().rowwise().sum();
+  // The variance needs two measurements at least.
+  if (n < 2) {
+    frame_imu_still_ = false;
+    return;
+  }
+  const Eigen::Matrix<double, 6, 1> mean = imu_accgyrs.rowwise().mean();
+  const Eigen::Matrix<double, 6, 1> variance =
+      (imu_accgyrs.colwise() - mean).rowwise().squaredNorm() /
+      static_cast<double>(n - 1);
+  const double acc_std = std::sqrt(variance.head<3>().sum());
+  const double gyro_std = std::sqrt(variance.tail<3>().sum());
+  frame_imu_still_ =
+      acc_std <= params_.max_acc_std && gyro_std <= params_.max_gyro_std;
+}
+
+bool StationaryDetector::update(const Timestamp& timestamp,
+                                const double& disparity) {
+  // Each batch of IMU measurements is only used once.
+  const bool frame_imu_still = frame_imu_still_;
+  frame_imu_still_ = false;
+  if (!frame_imu_still || !(disparity <= params_.max_disparity)) {
+    reset();
+    return false;
+  }
+
+  if (!is_still_) {
+    is_still_ = true;
+    still_since_ = timestamp;
+    still_gyro_sum_.setZero();
+    still_nr_gyro_samples_ = 0u;
+  }
+  still_gyro_sum_ += frame_gyro_sum_;
+  still_nr_gyro_samples_ += frame_nr_gyro_samples_;
+
+  if (!is_idle_ && UtilsNumerical::NsecToSec(timestamp - still_since_) >=
+                       params_.min_duration_s) {
+    is_idle_ = true;
+    idle_since_ = timestamp;
+  }
+  return is_idle_;
+}
+
+double StationaryDetector::getIdleDuration(const Timestamp& timestamp) const {
+  return is_idle_ ? UtilsNumerical::NsecToSec(timestamp - idle_since_) : 0.0;
+}
+
+bool StationaryDetector::getStillGyroMean(Eigen::Vector3d* gyro_mean) const {
+  CHECK_NOTNULL(gyro_mean);
+  if (!is_idle_ || still_nr_gyro_samples_ == 0u) return false;
+  *gyro_mean = still_gyro_sum_ / static_cast<double>(still_nr_gyro_samples_);
+  return true;
+}
+
+void StationaryDetector::reset() {
+  is_still_ = false;
+  is_idle_ = false;
+  still_gyro_sum_.setZero();
+  still_nr_gyro_samples_ = 0u;
+}
+
+}  // namespace VIO
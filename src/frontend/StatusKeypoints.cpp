@@ -0,0 +1,74 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   StatusKeypoints.cpp
+ * @brief  Structure-of-arrays container of keypoints with their status.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/frontend/StatusKeypoints.h"
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+StatusKeypointsSoA::StatusKeypointsSoA(const StatusKeypointsCV& keypoints)
+    : status_(), x_(), y_() {
+  assign(keypoints);
+}
+
+void StatusKeypointsSoA::assign(const StatusKeypointsCV& keypoints) {
+  const size_t n = keypoints.size();
+  status_.resize(n);
+  x_.resize(n);
+  y_.resize(n);
+  for (size_t i = 0u; i < n; ++i) {
+    status_[i] = static_cast<std::uint8_t>(keypoints[i].first);
+    x_[i] = keypoints[i].second.x;
+    y_[i] = keypoints[i].second.y;
+  }
+}
+
+void StatusKeypointsSoA::toStatusKeypointsCV(
+    StatusKeypointsCV* keypoints) const {
+  CHECK_NOTNULL(keypoints)->resize(size());
+  for (size_t i = 0u; i < size(); ++i) {
+    (*keypoints)[i] = std::make_pair(status(i), keypoint(i));
+  }
+}
+
+void StatusKeypointsSoA::clear() {
+  status_.clear();
+  x_.clear();
+  y_.clear();
+}
+
+void StatusKeypointsSoA::reserve(const size_t& n) {
+  status_.reserve(n);
+  x_.reserve(n);
+  y_.reserve(n);
+}
+
+void StatusKeypointsSoA::push_back(const KeypointStatus& status,
+                                   const KeypointCV& keypoint) {
+  status_.push_back(static_cast<std::uint8_t>(status));
+  x_.push_back(keypoint.x);
+  y_.push_back(keypoint.y);
+}
+
+size_t StatusKeypointsSoA::countValid() const {
+  // Branchless, vectorizable.
+  size_t nr_valid = 0u;
+  for (const std::uint8_t& status : status_) {
+    nr_valid += static_cast<size_t>(status == kValid);
+  }
+  return nr_valid;
+}
+
+}  // namespace VIO
@@ -15,6 +15,8 @@
 #include "kimera-vio/frontend/StereoCamera.h"
 
 #include <glog/logging.h>
+#include <string>
+#include <vector>
 #include <gtsam/geometry/Cal3_S2.h>
 #include <gtsam/geometry/Cal3_S2Stereo.h>
 #include <gtsam/geometry/Pose3.h>
@@ -28,6 +30,7 @@
 #include "kimera-vio/frontend/StereoMatchingParams.h"
 #include "kimera-vio/frontend/UndistorterRectifier.h"
 #include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/StartupCache.h"
 
 namespace VIO {
 
@@ -39,6 +42,8 @@ StereoCamera::StereoCamera(const CameraParams& left_cam_params,
       stereo_calibration_(nullptr),
       left_cam_undistort_rectifier_(nullptr),
       right_cam_undistort_rectifier_(nullptr),
+      left_rectified_roi_(),
+      right_rectified_roi_(),
       stereo_baseline_(0.0) {
   computeRectificationParameters(left_cam_params,
                                  right_cam_params,
@@ -87,6 +92,14 @@ StereoCamera::StereoCamera(const CameraParams& left_cam_params,
       std::make_unique<UndistorterRectifier>(P1_, left_cam_params, R1_);
   right_cam_undistort_rectifier_ =
       std::make_unique<UndistorterRectifier>(P2_, right_cam_params, R2_);
+  if (left_cam_params.hasRoiMask()) {
+    left_rectified_roi_ = left_cam_undistort_rectifier_->getRectifiedRoi(
+        left_cam_params.roi_mask_);
+  }
+  if (right_cam_params.hasRoiMask()) {
+    right_rectified_roi_ = right_cam_undistort_rectifier_->getRectifiedRoi(
+        right_cam_params.roi_mask_);
+  }
 
   //! Create stereo camera implementation
   undistorted_rectified_stereo_camera_impl_ =
@@ -266,6 +279,28 @@ void StereoCamera::distortUnrectifyRightKeypoints(
       status_keypoints_rectified, keypoints);
 }
 
+void StereoCamera::undistortRectifyRightKeypoints(
+    const KeypointsCV& keypoints,
+    KeypointsCV* keypoints_rectified) const {
+  CHECK_NOTNULL(keypoints_rectified);
+  CHECK(right_cam_undistort_rectifier_);
+  switch (original_right_camera_->getCamParams().camera_model_) {
+    case CameraModel::PINHOLE: {
+      right_cam_undistort_rectifier_->undistortRectifyKeypoints(
+          keypoints, keypoints_rectified);
+    } break;
+    case CameraModel::OMNI: {
+      Camera::UndistortKeypointsOmni(keypoints,
+                                     original_right_camera_->getCamParams(),
+                                     original_right_camera_->getCamParams().K_,
+                                     keypoints_rectified);
+    } break;
+    default: {
+      LOG(FATAL) << "Camera: Unrecognized camera model.";
+    }
+  }
+}
+
 void StereoCamera::undistortRectifyStereoFrame(
     StereoFrame* stereo_frame) const {
   CHECK_NOTNULL(stereo_frame);
@@ -276,19 +311,69 @@ void StereoCamera::undistortRectifyStereoFrame(
   //! Left img
   CHECK(left_cam_undistort_rectifier_);
   cv::Mat left_img_rectified;
-  left_cam_undistort_rectifier_->undistortRectifyImage(
-      stereo_frame->left_frame_.img_, &left_img_rectified);
+  if (left_rectified_roi_.empty()) {
+    left_cam_undistort_rectifier_->undistortRectifyImage(
+        stereo_frame->left_frame_.img_, &left_img_rectified);
+  } else {
+    left_cam_undistort_rectifier_->undistortRectifyImage(
+        stereo_frame->left_frame_.img_,
+        left_rectified_roi_,
+        &left_img_rectified);
+  }
 
   //! Right img
   CHECK(right_cam_undistort_rectifier_);
   cv::Mat right_img_rectified;
-  right_cam_undistort_rectifier_->undistortRectifyImage(
-      stereo_frame->right_frame_.img_, &right_img_rectified);
+  if (right_rectified_roi_.empty()) {
+    right_cam_undistort_rectifier_->undistortRectifyImage(
+        stereo_frame->right_frame_.img_, &right_img_rectified);
+  } else {
+    right_cam_undistort_rectifier_->undistortRectifyImage(
+        stereo_frame->right_frame_.img_,
+        right_rectified_roi_,
+        &right_img_rectified);
+  }
 
   //! Update stereo_frame
   stereo_frame->setRectifiedImages(left_img_rectified, right_img_rectified);
 }
 
+void StereoCamera::undistortRectifyStereoFrame(
+    const std::vector<cv::Range>& row_ranges,
+    StereoFrame* stereo_frame) const {
+  CHECK_NOTNULL(stereo_frame);
+  CHECK(left_cam_undistort_rectifier_);
+  CHECK(right_cam_undistort_rectifier_);
+  const cv::Mat& left_img = stereo_frame->left_frame_.img_;
+  const cv::Mat& right_img = stereo_frame->right_frame_.img_;
+
+  // Allocate black images once, then only compute the requested rows.
+  cv::Mat left_img_rectified = cv::Mat::zeros(left_img.size(), left_img.type());
+  cv::Mat right_img_rectified =
+      cv::Mat::zeros(right_img.size(), right_img.type());
+  const cv::Rect left_roi = left_rectified_roi_.empty()
+                                ? cv::Rect(0, 0, left_img.cols, left_img.rows)
+                                : left_rectified_roi_;
+  const cv::Rect right_roi =
+      right_rectified_roi_.empty()
+          ? cv::Rect(0, 0, right_img.cols, right_img.rows)
+          : right_rectified_roi_;
+  for (const cv::Range& rows : row_ranges) {
+    if (rows.empty()) continue;
+    left_cam_undistort_rectifier_->undistortRectifyImage(
+        left_img,
+        cv::Rect(0, rows.start, left_img.cols, rows.size()) & left_roi,
+        &left_img_rectified);
+    right_cam_undistort_rectifier_->undistortRectifyImage(
+        right_img,
+        cv::Rect(0, rows.start, right_img.cols, rows.size()) & right_roi,
+        &right_img_rectified);
+  }
+
+  stereo_frame->setRectifiedImages(
+      left_img_rectified, right_img_rectified, false);
+}
+
 void StereoCamera::computeRectificationParameters(
     const CameraParams& left_cam_params,
     const CameraParams& right_cam_params,
@@ -324,6 +409,45 @@ void StereoCamera::computeRectificationParameters(
   // https://github.com/opencv/opencv/issues/7240 for this issue with kAlpha
   // Setting to -1 to make it easy, but it should NOT be -1!
   static constexpr int kAlpha = 0;
+
+  // Only depends on the calibration: skip computing it if cached.
+  const std::string cache_key = "stereo_rectification/" +
+                                left_cam_params.camera_id_ + "/" +
+                                right_cam_params.camera_id_;
+  uint64_t cache_hash = StartupCache::hashValue(
+      VIO::to_underlying(left_cam_params.distortion_model_));
+  cache_hash = StartupCache::hash(left_cam_params.K_, cache_hash);
+  cache_hash =
+      StartupCache::hash(left_cam_params.distortion_coeff_mat_, cache_hash);
+  cache_hash = StartupCache::hash(right_cam_params.K_, cache_hash);
+  cache_hash =
+      StartupCache::hash(right_cam_params.distortion_coeff_mat_, cache_hash);
+  cache_hash =
+      StartupCache::hashValue(left_cam_params.image_size_, cache_hash);
+  cache_hash = StartupCache::hash(camL_Rot_camR, cache_hash);
+  cache_hash = StartupCache::hash(camL_Tran_camR, cache_hash);
+  cache_hash = StartupCache::hashValue(kAlpha, cache_hash);
+  StartupCache& startup_cache = StartupCache::getInstance();
+  std::vector<cv::Mat> cached;
+  if (startup_cache.get(cache_key, cache_hash, &cached) &&
+      cached.size() == 6u && cached[5].total() == 8u) {
+    *R1 = cached[0];
+    *R2 = cached[1];
+    *P1 = cached[2];
+    *P2 = cached[3];
+    *Q = cached[4];
+    const cv::Mat& rois = cached[5];
+    *ROI1 = cv::Rect(rois.at<int>(0),
+                     rois.at<int>(1),
+                     rois.at<int>(2),
+                     rois.at<int>(3));
+    *ROI2 = cv::Rect(rois.at<int>(4),
+                     rois.at<int>(5),
+                     rois.at<int>(6),
+                     rois.at<int>(7));
+    return;
+  }
+
   switch (left_cam_params.distortion_model_) {
     case DistortionModel::RADTAN: {
       cv::stereoRectify(
@@ -376,6 +500,16 @@ void StereoCamera::computeRectificationParameters(
                  << VIO::to_underlying(left_cam_params.distortion_model_);
     }
   }
+
+  const cv::Mat rois = (cv::Mat_<int>(1, 8) << ROI1->x,
+                        ROI1->y,
+                        ROI1->width,
+                        ROI1->height,
+                        ROI2->x,
+                        ROI2->y,
+                        ROI2->width,
+                        ROI2->height);
+  startup_cache.put(cache_key, cache_hash, {*R1, *R2, *P1, *P2, *Q, rois});
 }
 
 }  // namespace VIO
@@ -29,6 +29,7 @@ StereoFrame::StereoFrame(const FrameId& id,
                          const Frame& right_frame)
     : is_keyframe_(false),
       is_rectified_(false),
+      has_full_rectified_images_(false),
       left_img_rectified_(),
       right_img_rectified_(),
       id_(id),
@@ -47,10 +48,12 @@ StereoFrame::StereoFrame(const FrameId& id,
 }
 
 void StereoFrame::setRectifiedImages(const cv::Mat& left_rectified_img,
-                                     const cv::Mat& right_rectified_img) {
+                                     const cv::Mat& right_rectified_img,
+                                     const bool& full_images) {
   left_img_rectified_ = left_rectified_img;
   right_img_rectified_ = right_rectified_img;
   is_rectified_ = true;
+  has_full_rectified_images_ = full_images;
 }
 
 void StereoFrame::checkStereoFrame() const {
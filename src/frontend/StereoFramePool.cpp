@@ -0,0 +1,93 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   StereoFramePool.cpp
+ * @brief  Recycles the per-frame feature containers of stereo frames.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/frontend/StereoFramePool.h"
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+StereoFramePool::StereoFramePool(const size_t& max_nr_frames)
+    // Two frames per stereo frame, and the status keypoints pool also serves
+    // the left/right rectified keypoints.
+    : keypoints_pool_(2u * max_nr_frames),
+      status_keypoints_pool_(4u * max_nr_frames),
+      scores_pool_(2u * max_nr_frames),
+      landmarks_pool_(2u * max_nr_frames),
+      ages_pool_(2u * max_nr_frames),
+      versors_pool_(2u * max_nr_frames),
+      depths_pool_(max_nr_frames),
+      points_3d_pool_(max_nr_frames) {}
+
+StereoFrame::Ptr StereoFramePool::makeStereoFrame(
+    const StereoFrame& stereo_frame) {
+  // The frame must be able to give its memory back even if it outlives the
+  // frontend, hence the weak reference.
+  StereoFramePool::WeakPtr weak_pool = weak_from_this();
+  CHECK(!weak_pool.expired())
+      << "StereoFramePool must be owned by a shared_ptr.";
+  StereoFrame::Ptr pooled_frame(
+      new StereoFrame(stereo_frame), [weak_pool](StereoFrame* frame) {
+        if (StereoFramePool::Ptr pool = weak_pool.lock()) {
+          pool->release(frame);
+        }
+        delete frame;
+      });
+  // Only containers that are empty in the source get recycled memory: copied
+  // containers already have their own.
+  acquire(pooled_frame.get());
+  return pooled_frame;
+}
+
+void StereoFramePool::acquire(StereoFrame* stereo_frame) {
+  CHECK_NOTNULL(stereo_frame);
+  acquire(&stereo_frame->left_frame_);
+  acquire(&stereo_frame->right_frame_);
+  status_keypoints_pool_.acquire(&stereo_frame->left_keypoints_rectified_);
+  status_keypoints_pool_.acquire(&stereo_frame->right_keypoints_rectified_);
+  depths_pool_.acquire(&stereo_frame->keypoints_depth_);
+  points_3d_pool_.acquire(&stereo_frame->keypoints_3d_);
+}
+
+void StereoFramePool::release(StereoFrame* stereo_frame) {
+  CHECK_NOTNULL(stereo_frame);
+  release(&stereo_frame->left_frame_);
+  release(&stereo_frame->right_frame_);
+  status_keypoints_pool_.release(&stereo_frame->left_keypoints_rectified_);
+  status_keypoints_pool_.release(&stereo_frame->right_keypoints_rectified_);
+  depths_pool_.release(&stereo_frame->keypoints_depth_);
+  points_3d_pool_.release(&stereo_frame->keypoints_3d_);
+}
+
+void StereoFramePool::acquire(Frame* frame) {
+  CHECK_NOTNULL(frame);
+  keypoints_pool_.acquire(&frame->keypoints_);
+  status_keypoints_pool_.acquire(&frame->keypoints_undistorted_);
+  scores_pool_.acquire(&frame->scores_);
+  landmarks_pool_.acquire(&frame->landmarks_);
+  ages_pool_.acquire(&frame->landmarks_age_);
+  versors_pool_.acquire(&frame->versors_);
+}
+
+void StereoFramePool::release(Frame* frame) {
+  CHECK_NOTNULL(frame);
+  keypoints_pool_.release(&frame->keypoints_);
+  status_keypoints_pool_.release(&frame->keypoints_undistorted_);
+  scores_pool_.release(&frame->scores_);
+  landmarks_pool_.release(&frame->landmarks_);
+  ages_pool_.release(&frame->landmarks_age_);
+  versors_pool_.release(&frame->versors_);
+}
+
+}  // namespace VIO
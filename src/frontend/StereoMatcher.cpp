@@ -14,36 +14,63 @@
 
 #include "kimera-vio/frontend/StereoMatcher.h"
 
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
 #include <glog/logging.h>
 
 #include <opencv2/calib3d.hpp>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
 
 #include "kimera-vio/frontend/StereoFrame.h"
 #include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/PerfCounters.h"
+#include "kimera-vio/utils/Tracing.h"
 
 namespace VIO {
 
 StereoMatcher::StereoMatcher(const StereoCamera::ConstPtr& stereo_camera,
-                             const StereoMatchingParams& stereo_matching_params)
+                             const StereoMatchingParams& stereo_matching_params,
+                             const DenseStereoParams& dense_stereo_params)
     : stereo_camera_(stereo_camera),
       stereo_matching_params_(stereo_matching_params),
-      dense_stereo_params_() {}
+      dense_stereo_params_(dense_stereo_params),
+      dense_stereo_matcher_(),
+      gpu_dense_stereo_matcher_(nullptr) {}
 
-void StereoMatcher::denseStereoReconstruction(
-    const cv::Mat& left_img_rectified,
-    const cv::Mat& right_img_rectified,
-    cv::Mat* disparity_img) {
-  CHECK_NOTNULL(disparity_img);
-  CHECK_EQ(disparity_img->cols, left_img_rectified.cols);
-  CHECK_EQ(right_img_rectified.cols, left_img_rectified.cols);
-  CHECK_EQ(disparity_img->rows, left_img_rectified.rows);
-  CHECK_EQ(right_img_rectified.rows, left_img_rectified.rows);
-  CHECK_EQ(right_img_rectified.type(), left_img_rectified.type());
-  CHECK_EQ(disparity_img->type(), CV_32F);
+void StereoMatcher::createDenseStereoMatcher() {
   CHECK(stereo_camera_);
+  // At half resolution, disparities are halved too: keep the same range in
+  // the full resolution images. StereoBM/SGBM need a multiple of 16.
+  const bool& half_resolution = dense_stereo_params_.half_resolution_;
+  const int min_disparity = half_resolution
+                                ? dense_stereo_params_.min_disparity_ / 2
+                                : dense_stereo_params_.min_disparity_;
+  int num_disparities = dense_stereo_params_.num_disparities_;
+  if (half_resolution) {
+    num_disparities = std::max(16, (num_disparities / 2 + 15) / 16 * 16);
+  }
+
+  if (dense_stereo_params_.use_cuda_sgm_) {
+    if (GpuDenseStereoMatcher::isAvailable()) {
+      // cv::cuda::StereoSGM only supports 64, 128 or 256 disparities.
+      int gpu_num_disparities = 64;
+      while (gpu_num_disparities < num_disparities &&
+             gpu_num_disparities < 256) {
+        gpu_num_disparities *= 2;
+      }
+      gpu_dense_stereo_matcher_ = std::make_unique<GpuDenseStereoMatcher>(
+          dense_stereo_params_, min_disparity, gpu_num_disparities);
+      return;
+    }
+    LOG(WARNING) << "Dense stereo: no CUDA SGM available, using the CPU.";
+  }
 
   // Setup stereo matcher
-  cv::Ptr<cv::StereoMatcher> cv_stereo_matcher;
   if (dense_stereo_params_.use_sgbm_) {
     int mode;
     if (dense_stereo_params_.use_mode_HH_) {
@@ -51,9 +78,9 @@ void StereoMatcher::denseStereoReconstruction(
     } else {
       mode = cv::StereoSGBM::MODE_SGBM;
     }
-    cv_stereo_matcher =
-        cv::StereoSGBM::create(dense_stereo_params_.min_disparity_,
-                               dense_stereo_params_.num_disparities_,
+    dense_stereo_matcher_ =
+        cv::StereoSGBM::create(min_disparity,
+                               num_disparities,
                                dense_stereo_params_.sad_window_size_,
                                dense_stereo_params_.p1_,
                                dense_stereo_params_.p2_,
@@ -65,32 +92,86 @@ void StereoMatcher::denseStereoReconstruction(
                                mode);
   } else {
     cv::Ptr<cv::StereoBM> sbm =
-        cv::StereoBM::create(dense_stereo_params_.num_disparities_,
+        cv::StereoBM::create(num_disparities,
                              dense_stereo_params_.sad_window_size_);
 
     sbm->setPreFilterType(dense_stereo_params_.pre_filter_type_);
     sbm->setPreFilterSize(dense_stereo_params_.pre_filter_size_);
     sbm->setPreFilterCap(dense_stereo_params_.pre_filter_cap_);
-    sbm->setMinDisparity(dense_stereo_params_.min_disparity_);
+    sbm->setMinDisparity(min_disparity);
     sbm->setTextureThreshold(dense_stereo_params_.texture_threshold_);
     sbm->setUniquenessRatio(dense_stereo_params_.uniqueness_ratio_);
     sbm->setSpeckleRange(dense_stereo_params_.speckle_range_);
     sbm->setSpeckleWindowSize(dense_stereo_params_.speckle_window_size_);
-    const cv::Rect& roi1 = stereo_camera_->getROI1();
-    const cv::Rect& roi2 = stereo_camera_->getROI2();
+    cv::Rect roi1 = stereo_camera_->getROI1();
+    cv::Rect roi2 = stereo_camera_->getROI2();
     if (!roi1.empty() && !roi2.empty()) {
+      if (half_resolution) {
+        const auto halve = [](const cv::Rect& roi) {
+          return cv::Rect(roi.x / 2, roi.y / 2, roi.width / 2, roi.height / 2);
+        };
+        roi1 = halve(roi1);
+        roi2 = halve(roi2);
+      }
       sbm->setROI1(roi1);
       sbm->setROI2(roi2);
     } else {
       LOG(WARNING) << "ROIs are empty.";
     }
 
-    cv_stereo_matcher = sbm;
+    dense_stereo_matcher_ = sbm;
+  }
+}
+
+void StereoMatcher::denseStereoReconstruction(
+    const cv::Mat& left_img_rectified,
+    const cv::Mat& right_img_rectified,
+    cv::Mat* disparity_img) {
+  CHECK_NOTNULL(disparity_img);
+  CHECK_EQ(disparity_img->cols, left_img_rectified.cols);
+  CHECK_EQ(right_img_rectified.cols, left_img_rectified.cols);
+  CHECK_EQ(disparity_img->rows, left_img_rectified.rows);
+  CHECK_EQ(right_img_rectified.rows, left_img_rectified.rows);
+  CHECK_EQ(right_img_rectified.type(), left_img_rectified.type());
+  CHECK_EQ(disparity_img->type(), CV_32F);
+  CHECK(stereo_camera_);
+
+  if (!dense_stereo_matcher_ && !gpu_dense_stereo_matcher_) {
+    createDenseStereoMatcher();
+  }
+
+  // Optionally, match half resolution images.
+  cv::Mat left_img = left_img_rectified;
+  cv::Mat right_img = right_img_rectified;
+  if (dense_stereo_params_.half_resolution_) {
+    cv::resize(
+        left_img_rectified, left_img, cv::Size(), 0.5, 0.5, cv::INTER_AREA);
+    cv::resize(
+        right_img_rectified, right_img, cv::Size(), 0.5, 0.5, cv::INTER_AREA);
   }
 
   // Reconstruct scene
-  cv_stereo_matcher->compute(
-      left_img_rectified, right_img_rectified, *disparity_img);
+  cv::Mat disparity;
+  if (gpu_dense_stereo_matcher_) {
+    gpu_dense_stereo_matcher_->compute(left_img, right_img, &disparity);
+  } else {
+    CHECK(dense_stereo_matcher_);
+    dense_stereo_matcher_->compute(left_img, right_img, disparity);
+  }
+
+  if (dense_stereo_params_.half_resolution_) {
+    // Back to full resolution, where disparities are twice as large (invalid
+    // disparities stay below the min disparity).
+    cv::resize(disparity,
+               *disparity_img,
+               left_img_rectified.size(),
+               0.0,
+               0.0,
+               cv::INTER_NEAREST);
+    disparity_img->convertTo(*disparity_img, -1, 2.0);
+  } else {
+    *disparity_img = disparity;
+  }
 
   // Optionally, post-filter disparity
   if (dense_stereo_params_.post_filter_disparity_) {
@@ -120,7 +201,11 @@ void StereoMatcher::denseStereoReconstruction(
   }
 }
 
-void StereoMatcher::sparseStereoReconstruction(StereoFrame* stereo_frame) {
+void StereoMatcher::sparseStereoReconstruction(
+    StereoFrame* stereo_frame,
+    const std::vector<double>& disparity_priors) {
+  KIMERA_TRACE_SCOPE("StereoMatcher::sparseStereoReconstruction");
+  KIMERA_PERF_SCOPE("StereoMatcher::sparseStereoReconstruction");
   CHECK_NOTNULL(stereo_frame);
   //! Undistort rectify left/right images
   // CHECK(!stereo_frame->isRectified());
@@ -129,8 +214,6 @@ void StereoMatcher::sparseStereoReconstruction(StereoFrame* stereo_frame) {
   if (stereo_frame->isRectified()) {
     VLOG(1) << "sparseStereoMatching: StereoFrame is already rectified!";
   }
-  stereo_camera_->undistortRectifyStereoFrame(stereo_frame);
-  CHECK(stereo_frame->isRectified());
 
   //! Undistort rectify left keypoints
   CHECK_GT(stereo_frame->left_frame_.keypoints_.size(), 0u)
@@ -138,10 +221,34 @@ void StereoMatcher::sparseStereoReconstruction(StereoFrame* stereo_frame) {
   stereo_camera_->undistortRectifyLeftKeypoints(
       stereo_frame->left_frame_.keypoints_,
       &stereo_frame->left_keypoints_rectified_);
-  sparseStereoReconstruction(stereo_frame->getLeftImgRectified(),
-                             stereo_frame->getRightImgRectified(),
-                             stereo_frame->left_keypoints_rectified_,
-                             &stereo_frame->right_keypoints_rectified_);
+
+  if (stereo_frame->hasFullRectifiedImages()) {
+    //! Nothing to do, e.g. rectified on the GPU (see GpuImagePreprocessor).
+    VLOG(10) << "sparseStereoMatching: reusing the rectified images.";
+  } else if (stereo_matching_params_.lazy_stereo_rectification_) {
+    //! Only rectify the rows read by the epipolar search.
+    std::vector<cv::Range> row_ranges;
+    getStripeRowRanges(stereo_frame->left_keypoints_rectified_,
+                       stereo_frame->left_frame_.img_.rows,
+                       &row_ranges);
+    stereo_camera_->undistortRectifyStereoFrame(row_ranges, stereo_frame);
+  } else {
+    //! Undistort rectify left/right images
+    stereo_camera_->undistortRectifyStereoFrame(stereo_frame);
+  }
+  CHECK(stereo_frame->isRectified());
+  if (stereo_matching_params_.stereo_matching_mode_ ==
+      StereoMatchingMode::kKlt) {
+    getRightKeypointsKlt(*stereo_frame,
+                         disparity_priors,
+                         &stereo_frame->right_keypoints_rectified_);
+  } else {
+    sparseStereoReconstruction(stereo_frame->getLeftImgRectified(),
+                               stereo_frame->getRightImgRectified(),
+                               stereo_frame->left_keypoints_rectified_,
+                               &stereo_frame->right_keypoints_rectified_,
+                               disparity_priors);
+  }
 
   //! Fill out keypoint depths
   getDepthFromRectifiedMatches(stereo_frame->left_keypoints_rectified_,
@@ -174,11 +281,171 @@ void StereoMatcher::sparseStereoReconstruction(StereoFrame* stereo_frame) {
   }
 }
 
+void StereoMatcher::getRightKeypointsKlt(
+    const StereoFrame& stereo_frame,
+    const std::vector<double>& disparity_priors,
+    StatusKeypointsCV* right_keypoints_rectified) const {
+  KIMERA_TRACE_SCOPE("StereoMatcher::getRightKeypointsKlt");
+  CHECK_NOTNULL(right_keypoints_rectified);
+  CHECK(stereo_camera_);
+  const StatusKeypointsCV& left_keypoints_rectified =
+      stereo_frame.left_keypoints_rectified_;
+  const KeypointsCV& left_keypoints = stereo_frame.left_frame_.keypoints_;
+  CHECK_EQ(left_keypoints.size(), left_keypoints_rectified.size());
+  const bool use_disparity_priors = !disparity_priors.empty();
+  if (use_disparity_priors) {
+    CHECK_EQ(disparity_priors.size(), left_keypoints_rectified.size());
+  }
+  const auto& stereo_calib = stereo_camera_->getStereoCalib();
+  CHECK(stereo_calib);
+  const double fx_baseline = stereo_calib->fx() * stereo_calib->baseline();
+  const double default_disparity =
+      fx_baseline / stereo_matching_params_.max_point_dist_;
+
+  // Seed each right keypoint on the rectified epipolar line, and move it to
+  // the original right image where the KLT runs.
+  const cv::Mat& right_img = stereo_frame.right_frame_.img_;
+  StatusKeypointsCV seeds_rectified;
+  seeds_rectified.reserve(left_keypoints_rectified.size());
+  for (size_t i = 0u; i < left_keypoints_rectified.size(); ++i) {
+    KeypointCV seed = left_keypoints_rectified[i].second;
+    seed.x -= use_disparity_priors && disparity_priors[i] > 0.0
+                  ? disparity_priors[i]
+                  : default_disparity;
+    const bool in_image = std::round(seed.x) >= 0 &&
+                          std::round(seed.x) < right_img.cols &&
+                          std::round(seed.y) >= 0 &&
+                          std::round(seed.y) < right_img.rows;
+    seeds_rectified.push_back(std::make_pair(
+        left_keypoints_rectified[i].first == KeypointStatus::VALID && in_image
+            ? KeypointStatus::VALID
+            : KeypointStatus::NO_RIGHT_RECT,
+        seed));
+  }
+  KeypointsCV seeds;
+  stereo_camera_->distortUnrectifyRightKeypoints(seeds_rectified, &seeds);
+  // Nothing is tracked outside the region of interest of the right camera.
+  const CameraParams& right_cam_params =
+      stereo_camera_->getOriginalRightCamera()->getCamParams();
+  const bool has_roi_mask = right_cam_params.hasRoiMask();
+  if (has_roi_mask) {
+    for (size_t i = 0u; i < seeds_rectified.size(); ++i) {
+      if (!right_cam_params.isInRoi(seeds[i])) {
+        seeds_rectified[i].first = KeypointStatus::NO_RIGHT_RECT;
+      }
+    }
+  }
+
+  std::vector<size_t> indices;
+  KeypointsCV px_left;
+  KeypointsCV px_right;
+  indices.reserve(seeds.size());
+  px_left.reserve(seeds.size());
+  px_right.reserve(seeds.size());
+  for (size_t i = 0u; i < seeds_rectified.size(); ++i) {
+    if (seeds_rectified[i].first != KeypointStatus::VALID) continue;
+    indices.push_back(i);
+    px_left.push_back(left_keypoints[i]);
+    px_right.push_back(seeds[i]);
+  }
+
+  *right_keypoints_rectified = seeds_rectified;
+  if (indices.empty()) return;
+
+  // The left pyramid is the one of the tracker if the window size and the
+  // number of levels are the same.
+  const cv::Size win_size(stereo_matching_params_.klt_stereo_win_size_,
+                          stereo_matching_params_.klt_stereo_win_size_);
+  const int& max_level = stereo_matching_params_.klt_stereo_max_level_;
+  const std::vector<cv::Mat>& left_pyramid =
+      stereo_frame.left_frame_.getOpticalFlowPyramid(win_size, max_level);
+  const std::vector<cv::Mat>& right_pyramid =
+      stereo_frame.right_frame_.getOpticalFlowPyramid(win_size, max_level);
+  std::vector<uchar> status;
+  std::vector<float> error;
+  cv::calcOpticalFlowPyrLK(
+      left_pyramid,
+      right_pyramid,
+      px_left,
+      px_right,
+      status,
+      error,
+      win_size,
+      max_level,
+      cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS,
+                       stereo_matching_params_.klt_stereo_max_iter_,
+                       0.01),
+      cv::OPTFLOW_USE_INITIAL_FLOW);
+  // The right pyramid is not used by the tracker.
+  stereo_frame.right_frame_.releaseOpticalFlowPyramid();
+
+  KeypointsCV px_right_rectified;
+  stereo_camera_->undistortRectifyRightKeypoints(px_right,
+                                                 &px_right_rectified);
+  CHECK_EQ(px_right_rectified.size(), indices.size());
+  for (size_t j = 0u; j < indices.size(); ++j) {
+    StatusKeypointCV& right_keypoint =
+        (*right_keypoints_rectified)[indices[j]];
+    const KeypointCV& left_keypoint =
+        left_keypoints_rectified[indices[j]].second;
+    right_keypoint.second = px_right_rectified[j];
+    // Depth checks are done in getDepthFromRectifiedMatches.
+    right_keypoint.first =
+        status[j] &&
+                std::abs(px_right_rectified[j].y - left_keypoint.y) <=
+                    stereo_matching_params_.klt_stereo_max_epipolar_error_ &&
+                (!has_roi_mask || right_cam_params.isInRoi(px_right[j]))
+            ? KeypointStatus::VALID
+            : KeypointStatus::NO_RIGHT_RECT;
+  }
+}
+
+void StereoMatcher::getStripeRowRanges(
+    const StatusKeypointsCV& left_keypoints_rectified,
+    const int& img_rows,
+    std::vector<cv::Range>* row_ranges) const {
+  CHECK_NOTNULL(row_ranges)->clear();
+  // Half height of the rows needed around each keypoint: the stripe (which
+  // contains the template) plus the subpixel refinement window, and 1 pixel
+  // for rounding.
+  const int stripe_rows = stereo_matching_params_.templ_rows_ +
+                          stereo_matching_params_.stripe_extra_rows_;
+  static constexpr int kSubpixelHalfWindow = 10;
+  const int half_rows =
+      std::max((stripe_rows - 1) / 2,
+               stereo_matching_params_.subpixel_refinement_
+                   ? kSubpixelHalfWindow
+                   : 0) +
+      1;
+
+  std::vector<int> rows;
+  rows.reserve(left_keypoints_rectified.size());
+  for (const StatusKeypointCV& kpt : left_keypoints_rectified) {
+    if (kpt.first == KeypointStatus::VALID) {
+      rows.push_back(static_cast<int>(std::round(kpt.second.y)));
+    }
+  }
+  std::sort(rows.begin(), rows.end());
+
+  // Merge overlapping ranges.
+  for (const int& row : rows) {
+    const int start = std::max(0, row - half_rows);
+    const int end = std::min(img_rows, row + half_rows + 1);
+    if (start >= end) continue;
+    if (!row_ranges->empty() && start <= row_ranges->back().end) {
+      row_ranges->back().end = std::max(row_ranges->back().end, end);
+    } else {
+      row_ranges->push_back(cv::Range(start, end));
+    }
+  }
+}
+
 void StereoMatcher::sparseStereoReconstruction(
     const cv::Mat& left_img_rectified,
     const cv::Mat& right_img_rectified,
     const StatusKeypointsCV& left_keypoints_rectified,
-    StatusKeypointsCV* right_keypoints_rectified) {
+    StatusKeypointsCV* right_keypoints_rectified,
+    const std::vector<double>& disparity_priors) {
   CHECK_NOTNULL(right_keypoints_rectified);
   CHECK(stereo_camera_);
   const auto& stereo_calib = stereo_camera_->getStereoCalib();
@@ -190,7 +457,8 @@ void StereoMatcher::sparseStereoReconstruction(
                              left_keypoints_rectified,
                              fx,
                              baseline,
-                             right_keypoints_rectified);
+                             right_keypoints_rectified,
+                             disparity_priors);
 }
 
 void StereoMatcher::getRightKeypointsRectified(
@@ -199,9 +467,21 @@ void StereoMatcher::getRightKeypointsRectified(
     const StatusKeypointsCV& left_keypoints_rectified,
     const double& fx,
     const double& baseline,
-    StatusKeypointsCV* right_keypoints_rectified) const {
+    StatusKeypointsCV* right_keypoints_rectified,
+    const std::vector<double>& disparity_priors) const {
   CHECK_NOTNULL(right_keypoints_rectified)->clear();
-  right_keypoints_rectified->reserve(left_keypoints_rectified.size());
+  CHECK(stereo_matching_params_.stereo_matching_mode_ !=
+        StereoMatchingMode::kKlt)
+      << "KLT stereo matching needs the stereo frame, use "
+         "sparseStereoReconstruction(StereoFrame*).";
+  const bool use_disparity_priors =
+      stereo_matching_params_.use_disparity_prior_ && !disparity_priors.empty();
+  if (use_disparity_priors) {
+    CHECK_EQ(disparity_priors.size(), left_keypoints_rectified.size());
+  }
+  // Preallocate all slots: each keypoint writes only to its own slot, which
+  // allows to match keypoints in parallel without locking.
+  right_keypoints_rectified->resize(left_keypoints_rectified.size());
 
   int verbosity = 0;
 
@@ -230,34 +510,113 @@ void StereoMatcher::getRightKeypointsRectified(
     stripe_cols = right_img_rectified.cols;
   }
 
-  // Serial version (could be parallelized).
-  for (const StatusKeypointCV& left_keypoint_rectified :
-       left_keypoints_rectified) {
-    // If left point is invalid, set right point to be invalid and continue
-    if (left_keypoint_rectified.first != KeypointStatus::VALID) {
-      // Skip invalid points (fill in with placeholders in right)
-      // Gtsam is able to deal with non-valid stereo matches.
-      right_keypoints_rectified->push_back(
-          std::make_pair(left_keypoint_rectified.first, KeypointCV(0.0, 0.0)));
-      continue;
-    }
-
-    // Do left->right matching
-    const KeypointCV& left_rectified_i = left_keypoint_rectified.second;
-    StatusKeypointCV right_rectified_i_candidate;
-    double matching_val_LR;
-    searchRightKeypointEpipolar(left_img_rectified,
-                                left_rectified_i,
-                                right_img_rectified,
-                                stripe_cols,
-                                stripe_rows,
-                                stereo_matching_params_,
-                                &right_rectified_i_candidate,
-                                &matching_val_LR);
+  // Narrow stripe around a disparity prior: about +- margin disparities.
+  const int& prior_margin = stereo_matching_params_.disparity_prior_margin_;
+  int prior_stripe_cols =
+      stereo_matching_params_.templ_cols_ + 2 * prior_margin + 1;
+  if (prior_stripe_cols % 2 != 1) prior_stripe_cols += 1;
+  prior_stripe_cols = std::min(prior_stripe_cols, stripe_cols);
+
+  // Dedicated kernels need 8-bit images, otherwise use cv::matchTemplate.
+  const bool use_stripe_matcher =
+      stereo_matching_params_.stereo_matching_kernel_type_ !=
+          StereoMatchingKernelType::kOpenCvTemplateMatching &&
+      left_img_rectified.type() == CV_8UC1 &&
+      right_img_rectified.type() == CV_8UC1;
+  if (!use_stripe_matcher &&
+      stereo_matching_params_.stereo_matching_kernel_type_ !=
+          StereoMatchingKernelType::kOpenCvTemplateMatching) {
+    LOG_FIRST_N(WARNING, 1)
+        << "Stereo matching kernel requires CV_8UC1 images, "
+           "falling back to cv::matchTemplate.";
+  }
 
-    // TODO(Toni): Here we could perform bidirectional checking...
+  // The match lies on the same row, left of the left keypoint: there is none
+  // if these are outside the region of interest of the right camera.
+  const cv::Rect& right_roi = stereo_camera_->getRightRectifiedRoi();
+  const auto can_match_in_roi = [&right_roi](const KeypointCV& left_kpt) {
+    if (right_roi.empty()) return true;
+    const int row = static_cast<int>(std::round(left_kpt.y));
+    return row >= right_roi.y && row < right_roi.y + right_roi.height &&
+           left_kpt.x >= right_roi.x;
+  };
+
+  // Matches keypoints in [begin, end). Each chunk of keypoints uses its own
+  // stripe matcher, so that its scratch buffers are reused across the chunk.
+  auto match_keypoints = [&](const int& begin, const int& end) {
+    EpipolarStripeMatcher::UniquePtr stripe_matcher = nullptr;
+    if (use_stripe_matcher) {
+      stripe_matcher = std::make_unique<EpipolarStripeMatcher>(
+          stereo_matching_params_.stereo_matching_kernel_type_);
+    }
+    for (int i = begin; i < end; ++i) {
+      const StatusKeypointCV& left_keypoint_rectified =
+          left_keypoints_rectified[i];
+      StatusKeypointCV& right_keypoint_rectified =
+          (*right_keypoints_rectified)[i];
+      // If left point is invalid, set right point to be invalid and continue
+      if (left_keypoint_rectified.first != KeypointStatus::VALID) {
+        // Skip invalid points (fill in with placeholders in right)
+        // Gtsam is able to deal with non-valid stereo matches.
+        right_keypoint_rectified = std::make_pair(left_keypoint_rectified.first,
+                                                  KeypointCV(0.0, 0.0));
+        continue;
+      }
+      if (!can_match_in_roi(left_keypoint_rectified.second)) {
+        right_keypoint_rectified =
+            std::make_pair(KeypointStatus::NO_RIGHT_RECT, KeypointCV(0.0, 0.0));
+        continue;
+      }
 
-    right_keypoints_rectified->push_back(right_rectified_i_candidate);
+      // Do left->right matching
+      double matching_val_LR;
+      if (use_disparity_priors && disparity_priors[i] > 0.0) {
+        const int min_disparity = std::max(
+            0,
+            static_cast<int>(std::round(disparity_priors[i])) - prior_margin -
+                1);
+        searchRightKeypointEpipolar(left_img_rectified,
+                                    left_keypoint_rectified.second,
+                                    right_img_rectified,
+                                    prior_stripe_cols,
+                                    stripe_rows,
+                                    stereo_matching_params_,
+                                    &right_keypoint_rectified,
+                                    &matching_val_LR,
+                                    stripe_matcher.get(),
+                                    min_disparity);
+        if (right_keypoint_rectified.first == KeypointStatus::VALID) continue;
+        // Bad prior (e.g. wrong depth or motion prediction): full search.
+      }
+      searchRightKeypointEpipolar(left_img_rectified,
+                                  left_keypoint_rectified.second,
+                                  right_img_rectified,
+                                  stripe_cols,
+                                  stripe_rows,
+                                  stereo_matching_params_,
+                                  &right_keypoint_rectified,
+                                  &matching_val_LR,
+                                  stripe_matcher.get());
+
+      // TODO(Toni): Here we could perform bidirectional checking...
+    }
+  };
+
+  const int nr_keypoints = static_cast<int>(left_keypoints_rectified.size());
+  const int& nr_stripes = stereo_matching_params_.sparse_stereo_num_stripes_;
+  if (nr_stripes > 1 &&
+      nr_keypoints >= stereo_matching_params_.sparse_stereo_min_parallel_kpts_) {
+    // Parallel version: split keypoints in (roughly) nr_stripes chunks, run by
+    // OpenCV's thread pool.
+    cv::parallel_for_(
+        cv::Range(0, nr_keypoints),
+        [&](const cv::Range& range) {
+          match_keypoints(range.start, range.end);
+        },
+        static_cast<double>(nr_stripes));
+  } else {
+    // Serial version.
+    match_keypoints(0, nr_keypoints);
   }
 
   if (verbosity > 0) {
@@ -288,13 +647,13 @@ void StereoMatcher::searchRightKeypointEpipolar(
     const int& stripe_rows,
     const StereoMatchingParams& stereo_matching_params,
     StatusKeypointCV* right_keypoint_rectified,
-    double* score) const {
+    double* score,
+    EpipolarStripeMatcher* stripe_matcher,
+    const int& min_disparity) const {
   CHECK_NOTNULL(right_keypoint_rectified);
+  CHECK_GE(min_disparity, 0);
   CHECK_NOTNULL(score);
 
-  // Correlation matrix
-  cv::Mat result;
-
   int rounded_left_rectified_i_x = round(left_keypoint_rectified.x);
   int rounded_left_rectified_i_y = round(left_keypoint_rectified.y);
 
@@ -340,7 +699,6 @@ void StereoMatcher::searchRightKeypointEpipolar(
                           temp_corner_y,
                           stereo_matching_params.templ_cols_,
                           stereo_matching_params.templ_rows_);
-  cv::Mat templ(left_img_rectified, templ_selector);
 
   // CORRECTLY PLACE THE STRIPE (IN RIGHT IMAGE)
   // y-component of upper left corner of stripe
@@ -359,7 +717,7 @@ void StereoMatcher::searchRightKeypointEpipolar(
   // y-component of upper left corner of stripe
   int stripe_corner_x = rounded_left_rectified_i_x +
                         (stereo_matching_params.templ_cols_ - 1) / 2 -
-                        stripe_cols;
+                        min_disparity - stripe_cols;
   if (stripe_corner_x + stripe_cols > right_rectified.cols - 1) {
     // stripe exceeds on the right of image
     // amount that exceeds
@@ -377,19 +735,32 @@ void StereoMatcher::searchRightKeypointEpipolar(
   // Create stripe
   cv::Rect stripe_selector(
       stripe_corner_x, stripe_corner_y, stripe_cols, stripe_rows);
-  cv::Mat stripe(right_rectified, stripe_selector);
 
   // Find template and normalize results
   double min_val;
-  double max_val;
   cv::Point min_loc;
-  cv::Point max_loc;
-
-  cv::matchTemplate(stripe, templ, result, CV_TM_SQDIFF);
-  normalize(result, result, 0, 1, cv::NORM_MINMAX, -1, cv::Mat());
-
-  // Localizing the best match with minMaxLoc
-  cv::minMaxLoc(result, &min_val, &max_val, &min_loc, &max_loc, cv::Mat());
+  if (stripe_matcher) {
+    // Works in place on the rectified images, no crops nor allocations.
+    stripe_matcher->match(left_img_rectified,
+                          templ_selector,
+                          right_rectified,
+                          stripe_selector,
+                          &min_loc,
+                          &min_val);
+  } else {
+    cv::Mat templ(left_img_rectified, templ_selector);
+    cv::Mat stripe(right_rectified, stripe_selector);
+
+    // Correlation matrix
+    cv::Mat result;
+    cv::matchTemplate(stripe, templ, result, CV_TM_SQDIFF);
+    normalize(result, result, 0, 1, cv::NORM_MINMAX, -1, cv::Mat());
+
+    // Localizing the best match with minMaxLoc
+    double max_val;
+    cv::Point max_loc;
+    cv::minMaxLoc(result, &min_val, &max_val, &min_loc, &max_loc, cv::Mat());
+  }
 
   // Position within the result matrix
   cv::Point matchLoc = min_loc;
@@ -33,6 +33,18 @@ void StereoMatchingParams::checkParams() {
       << "StereoMatchingParams: template size must be odd!";
   CHECK(!(stripe_extra_rows_ % 2 != 0))  // check that they are even
       << "StereoMatchingParams: stripe_extra_rows size must be even!";
+  CHECK_GE(sparse_stereo_num_stripes_, 1)
+      << "StereoMatchingParams: sparse_stereo_num_stripes must be >= 1!";
+  CHECK_GE(disparity_prior_margin_, 0)
+      << "StereoMatchingParams: disparity_prior_margin must be >= 0!";
+  CHECK_GT(klt_stereo_win_size_, 0)
+      << "StereoMatchingParams: klt_stereo_win_size must be > 0!";
+  CHECK_GE(klt_stereo_max_level_, 0)
+      << "StereoMatchingParams: klt_stereo_max_level must be >= 0!";
+  CHECK_GT(klt_stereo_max_iter_, 0)
+      << "StereoMatchingParams: klt_stereo_max_iter must be > 0!";
+  CHECK_GT(klt_stereo_max_epipolar_error_, 0.0)
+      << "StereoMatchingParams: klt_stereo_max_epipolar_error must be > 0!";
 }
 
 bool StereoMatchingParams::equals(const StereoMatchingParams& tp2,
@@ -46,7 +58,20 @@ bool StereoMatchingParams::equals(const StereoMatchingParams& tp2,
          (fabs(min_point_dist_ - tp2.min_point_dist_) <= tol) &&
          (fabs(max_point_dist_ - tp2.max_point_dist_) <= tol) &&
          (bidirectional_matching_ == tp2.bidirectional_matching_) &&
-         (subpixel_refinement_ == tp2.subpixel_refinement_);
+         (subpixel_refinement_ == tp2.subpixel_refinement_) &&
+         (stereo_matching_kernel_type_ == tp2.stereo_matching_kernel_type_) &&
+         (sparse_stereo_num_stripes_ == tp2.sparse_stereo_num_stripes_) &&
+         (sparse_stereo_min_parallel_kpts_ ==
+          tp2.sparse_stereo_min_parallel_kpts_) &&
+         (lazy_stereo_rectification_ == tp2.lazy_stereo_rectification_) &&
+         (use_disparity_prior_ == tp2.use_disparity_prior_) &&
+         (disparity_prior_margin_ == tp2.disparity_prior_margin_) &&
+         (stereo_matching_mode_ == tp2.stereo_matching_mode_) &&
+         (klt_stereo_win_size_ == tp2.klt_stereo_win_size_) &&
+         (klt_stereo_max_level_ == tp2.klt_stereo_max_level_) &&
+         (klt_stereo_max_iter_ == tp2.klt_stereo_max_iter_) &&
+         (fabs(klt_stereo_max_epipolar_error_ -
+               tp2.klt_stereo_max_epipolar_error_) <= tol);
 }
 
 void StereoMatchingParams::print() const {
@@ -71,7 +96,29 @@ void StereoMatchingParams::print() const {
                         "bidirectionalMatching_: ",
                         bidirectional_matching_,
                         "subpixelRefinementStereo_: ",
-                        subpixel_refinement_);
+                        subpixel_refinement_,
+                        "stereo_matching_kernel_type_: ",
+                        VIO::to_underlying(stereo_matching_kernel_type_),
+                        "sparse_stereo_num_stripes_: ",
+                        sparse_stereo_num_stripes_,
+                        "sparse_stereo_min_parallel_kpts_: ",
+                        sparse_stereo_min_parallel_kpts_,
+                        "lazy_stereo_rectification_: ",
+                        lazy_stereo_rectification_,
+                        "use_disparity_prior_: ",
+                        use_disparity_prior_,
+                        "disparity_prior_margin_: ",
+                        disparity_prior_margin_,
+                        "stereo_matching_mode_: ",
+                        VIO::to_underlying(stereo_matching_mode_),
+                        "klt_stereo_win_size_: ",
+                        klt_stereo_win_size_,
+                        "klt_stereo_max_level_: ",
+                        klt_stereo_max_level_,
+                        "klt_stereo_max_iter_: ",
+                        klt_stereo_max_iter_,
+                        "klt_stereo_max_epipolar_error_: ",
+                        klt_stereo_max_epipolar_error_);
   LOG(INFO) << out.str();
 }
 
@@ -88,6 +135,52 @@ bool StereoMatchingParams::parseYAML(const std::string& filepath) {
   yaml_parser.getYamlParam("maxPointDist", &max_point_dist_);
   yaml_parser.getYamlParam("bidirectionalMatching", &bidirectional_matching_);
   yaml_parser.getYamlParam("subpixelRefinementStereo", &subpixel_refinement_);
+  if (yaml_parser.hasParam("stereo_matching_kernel_type")) {
+    int stereo_matching_kernel_type;
+    yaml_parser.getYamlParam("stereo_matching_kernel_type",
+                             &stereo_matching_kernel_type);
+    stereo_matching_kernel_type_ =
+        static_cast<StereoMatchingKernelType>(stereo_matching_kernel_type);
+  }
+  if (yaml_parser.hasParam("sparse_stereo_num_stripes")) {
+    yaml_parser.getYamlParam("sparse_stereo_num_stripes",
+                             &sparse_stereo_num_stripes_);
+  }
+  if (yaml_parser.hasParam("sparse_stereo_min_parallel_kpts")) {
+    yaml_parser.getYamlParam("sparse_stereo_min_parallel_kpts",
+                             &sparse_stereo_min_parallel_kpts_);
+  }
+  if (yaml_parser.hasParam("lazy_stereo_rectification")) {
+    yaml_parser.getYamlParam("lazy_stereo_rectification",
+                             &lazy_stereo_rectification_);
+  }
+  if (yaml_parser.hasParam("use_disparity_prior")) {
+    yaml_parser.getYamlParam("use_disparity_prior", &use_disparity_prior_);
+  }
+  if (yaml_parser.hasParam("disparity_prior_margin")) {
+    yaml_parser.getYamlParam("disparity_prior_margin",
+                             &disparity_prior_margin_);
+  }
+  if (yaml_parser.hasParam("stereo_matching_mode")) {
+    int stereo_matching_mode;
+    yaml_parser.getYamlParam("stereo_matching_mode", &stereo_matching_mode);
+    stereo_matching_mode_ =
+        static_cast<StereoMatchingMode>(stereo_matching_mode);
+  }
+  if (yaml_parser.hasParam("klt_stereo_win_size")) {
+    yaml_parser.getYamlParam("klt_stereo_win_size", &klt_stereo_win_size_);
+  }
+  if (yaml_parser.hasParam("klt_stereo_max_level")) {
+    yaml_parser.getYamlParam("klt_stereo_max_level", &klt_stereo_max_level_);
+  }
+  if (yaml_parser.hasParam("klt_stereo_max_iter")) {
+    yaml_parser.getYamlParam("klt_stereo_max_iter", &klt_stereo_max_iter_);
+  }
+  if (yaml_parser.hasParam("klt_stereo_max_epipolar_error")) {
+    yaml_parser.getYamlParam("klt_stereo_max_epipolar_error",
+                             &klt_stereo_max_epipolar_error_);
+  }
+  checkParams();
   return true;
 }
 
@@ -18,11 +18,20 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <gtsam/geometry/Rot3.h>
+#include <unordered_map>
 
+#include "kimera-vio/frontend/StatusKeypoints.h"
+#include "kimera-vio/frontend/UndistorterRectifier.h"
 #include "kimera-vio/utils/Timer.h"
 #include "kimera-vio/utils/UtilsNumerical.h"
 
 DECLARE_bool(do_fine_imu_camera_temporal_sync);
+DEFINE_int32(frontend_keyframe_task_threads,
+             0,
+             "Threads (besides the frontend thread) running the independent "
+             "stages of the keyframes at once, e.g. the mono outlier "
+             "rejection and the sparse stereo matching. 0 runs them one "
+             "after the other.");
 
 namespace VIO {
 
@@ -40,11 +49,16 @@ StereoVisionImuFrontend::StereoVisionImuFrontend(
                         display_queue,
                         log_output,
                         odom_params),
+      stereo_frame_pool_(std::make_shared<StereoFramePool>()),
       stereoFrame_k_(nullptr),
       stereoFrame_km1_(nullptr),
       stereoFrame_lkf_(nullptr),
       keyframe_R_ref_frame_(gtsam::Rot3()),
+      keyframe_P_ref_frame_(gtsam::Pose3()),
       feature_detector_(nullptr),
+      speculative_feature_detector_(nullptr),
+      gpu_image_preprocessor_(nullptr),
+      keyframe_task_graph_(nullptr),
       stereo_camera_(stereo_camera),
       stereo_matcher_(stereo_camera, frontend_params.stereo_matching_params_),
       output_images_path_("./outputImages/") {
@@ -52,10 +66,28 @@ StereoVisionImuFrontend::StereoVisionImuFrontend(
 
   feature_detector_ = std::make_unique<FeatureDetector>(
       frontend_params.feature_detector_params_);
+  CHECK_GE(FLAGS_frontend_keyframe_task_threads, 0);
+  keyframe_task_graph_ = std::make_unique<utils::TaskGraph>(
+      static_cast<size_t>(FLAGS_frontend_keyframe_task_threads));
+  if (frontend_params.speculative_feature_detection_) {
+    speculative_feature_detector_ =
+        std::make_unique<SpeculativeFeatureDetector>(
+            frontend_params.feature_detector_params_);
+  }
+  if (frontend_params.use_gpu_preprocessing_) {
+    if (GpuImagePreprocessor::isAvailable()) {
+      gpu_image_preprocessor_ = std::make_unique<GpuImagePreprocessor>(
+          *stereo_camera_, frontend_params.feature_detector_params_);
+    } else {
+      LOG(WARNING) << "GPU preprocessing: no CUDA device available, using "
+                      "the CPU.";
+    }
+  }
 
   tracker_ = std::make_unique<Tracker>(frontend_params_.tracker_params_,
                                        stereo_camera_->getOriginalLeftCamera(),
                                        display_queue);
+  tracker_->setDebugImageWorker(debug_image_worker_.get());
 
   if (VLOG_IS_ON(1)) tracker_->tracker_params_.print();
 }
@@ -92,10 +124,10 @@ StereoFrontendOutput::UniquePtr StereoVisionImuFrontend::bootstrapSpinStereo(
       nullptr,
       stereo_camera_->getBodyPoseLeftCamRect(),
       stereo_camera_->getBodyPoseRightCamRect(),
-      *stereoFrame_lkf_,
+      std::make_shared<const StereoFrame>(*stereoFrame_lkf_),
       nullptr,
       input->getImuAccGyrs(),
-      cv::Mat(),
+      StereoFrontendOutput::FeatureTracksProducer(),
       getTrackerInfo());
 }
 
@@ -125,19 +157,19 @@ StereoFrontendOutput::UniquePtr StereoVisionImuFrontend::nominalSpinStereo(
   // Actually, currently does not integrate fake interpolated meas as it does
   // not take the last measurement into account (although it takes its stamp
   // into account!!!).
-  auto tic_full_preint = utils::Timer::tic();
-  const ImuFrontend::PimPtr& pim = imu_frontend_->preintegrateImuMeasurements(
-      input->getImuStamps(), input->getImuAccGyrs());
-  CHECK(pim);
-
-  auto full_preint_duration =
-      utils::Timer::toc<std::chrono::microseconds>(tic_full_preint).count();
-  // Don't add them because they are confusing
-  // utils::StatsCollector stats_full_preint("IMU Preintegration Timing [us]");
-  // stats_full_preint.AddSample(full_preint_duration);
-  VLOG_IF(1, full_preint_duration != 0.0)
-      << "Current IMU Preintegration frequency: " << 10e6 / full_preint_duration
-      << " Hz. (" << full_preint_duration << " us).";
+  // The copy of the frame and its pyramid do not need the IMU: they can be
+  // done while preintegrating.
+  const ImuFrontend::PimPtr pim = preintegrateImuWhile(
+      input->getImuStamps(), input->getImuAccGyrs(), [this, &stereoFrame_k]() {
+        // TODO this copies the stereo frame!!
+        stereoFrame_k_ = stereo_frame_pool_->makeStereoFrame(stereoFrame_k);
+        if (gpu_image_preprocessor_) {
+          // Runs on the device while tracking, retrieved if a keyframe.
+          gpu_image_preprocessor_->enqueue(*stereoFrame_k_,
+                                           isKeyframeOnlyProcessing());
+        }
+        tracker_->buildOpticalFlowPyramid(stereoFrame_k_->left_frame_);
+      });
 
   // On the left camera rectified!!
   const gtsam::Rot3 body_Rot_cam =
@@ -153,15 +185,38 @@ StereoFrontendOutput::UniquePtr StereoVisionImuFrontend::nominalSpinStereo(
     body_Rot_cam.print("Body_Rot_cam");
     camLrectLkf_R_camLrectK_imu.print("calLrectLkf_R_camLrectK_imu");
   }
+
+  // Full relative pose, only needed for roto-translational optical flow.
+  std::optional<gtsam::Pose3> camLrectLkf_P_camLrectK_imu;
+  if (tracker_->tracker_params_.optical_flow_predictor_type_ ==
+      OpticalFlowPredictorType::kRotoTranslational) {
+    const std::optional<gtsam::Pose3> bodyLkf_P_bodyK =
+        predictBodyPoseFromImu(pim);
+    if (bodyLkf_P_bodyK) {
+      const gtsam::Pose3& body_P_cam =
+          stereo_camera_->getBodyPoseLeftCamRect();
+      camLrectLkf_P_camLrectK_imu =
+          body_P_cam.inverse() * (*bodyLkf_P_bodyK) * body_P_cam;
+    }
+  }
   //////////////////////////////////////////////////////////////////////////////
 
   /////////////////////////////// TRACKING /////////////////////////////////////
   // Main function for tracking.
   // Rotation used in 1 and 2 point ransac.
   VLOG(10) << "Starting processStereoFrame...";
-  cv::Mat feature_tracks;
-  StatusStereoMeasurementsPtr status_stereo_measurements = processStereoFrame(
-      stereoFrame_k, camLrectLkf_R_camLrectK_imu, &feature_tracks);
+  TrackerImageInput feature_tracks;
+  StatusStereoMeasurementsPtr status_stereo_measurements =
+      processStereoFrame(stereoFrame_k,
+                         camLrectLkf_R_camLrectK_imu,
+                         &feature_tracks,
+                         camLrectLkf_P_camLrectK_imu);
+  StereoFrontendOutput::FeatureTracksProducer feature_tracks_producer;
+  if (!feature_tracks.cur_img_.empty()) {
+    feature_tracks_producer = [feature_tracks = std::move(feature_tracks)]() {
+      return Tracker::drawTrackerImage(feature_tracks);
+    };
+  }
 
   CHECK(!stereoFrame_k_);  // processStereoFrame is setting this to nullptr!!!
   VLOG(10) << "Finished processStereoFrame.";
@@ -201,7 +256,9 @@ StereoFrontendOutput::UniquePtr StereoVisionImuFrontend::nominalSpinStereo(
     imu_frontend_->resetIntegrationWithCachedBias();
 
     // Record keyframe rate timing
-    timing_stats_keyframe_rate.AddSample(utils::Timer::toc(start_time).count());
+    const double keyframe_time_ms = utils::Timer::toc(start_time).count();
+    timing_stats_keyframe_rate.AddSample(keyframe_time_ms);
+    updateFeatureBudget(keyframe_time_ms, feature_detector_.get());
 
     // Return the output of the Frontend for the others.
     // We have a keyframe, so We fill stereo_frame_lkf_ with the newest keyframe
@@ -211,10 +268,10 @@ StereoFrontendOutput::UniquePtr StereoVisionImuFrontend::nominalSpinStereo(
         status_stereo_measurements,
         stereo_camera_->getBodyPoseLeftCamRect(),
         stereo_camera_->getBodyPoseRightCamRect(),
-        *stereoFrame_lkf_,
+        std::make_shared<const StereoFrame>(*stereoFrame_lkf_),
         pim,
         input->getImuAccGyrs(),
-        feature_tracks,
+        std::move(feature_tracks_producer),
         getTrackerInfo(),
         getExternalOdometryRelativeBodyPose(input.get()),
         getExternalOdometryWorldVelocity(input.get()));
@@ -231,10 +288,10 @@ StereoFrontendOutput::UniquePtr StereoVisionImuFrontend::nominalSpinStereo(
         status_stereo_measurements,
         stereo_camera_->getBodyPoseLeftCamRect(),
         stereo_camera_->getBodyPoseRightCamRect(),
-        *stereoFrame_km1_,
+        std::make_shared<const StereoFrame>(*stereoFrame_km1_),
         pim,
         input->getImuAccGyrs(),
-        feature_tracks,
+        std::move(feature_tracks_producer),
         getTrackerInfo());
   }
 }
@@ -245,8 +302,7 @@ StereoFrontendOutput::UniquePtr StereoVisionImuFrontend::nominalSpinStereo(
 void StereoVisionImuFrontend::processFirstStereoFrame(
     const StereoFrame& firstFrame) {
   VLOG(2) << "Processing first stereo frame \n";
-  stereoFrame_k_ =
-      std::make_shared<StereoFrame>(firstFrame);  // TODO this can be optimized!
+  stereoFrame_k_ = stereo_frame_pool_->makeStereoFrame(firstFrame);
   stereoFrame_k_->setIsKeyframe(true);
   last_keyframe_timestamp_ = stereoFrame_k_->timestamp_;
 
@@ -283,7 +339,8 @@ void StereoVisionImuFrontend::processFirstStereoFrame(
 StatusStereoMeasurementsPtr StereoVisionImuFrontend::processStereoFrame(
     const StereoFrame& cur_frame,
     const gtsam::Rot3& keyframe_R_cur_frame,
-    cv::Mat* feature_tracks) {
+    TrackerImageInput* feature_tracks,
+    const std::optional<gtsam::Pose3>& keyframe_P_cur_frame) {
   CHECK(tracker_);
   VLOG(2) << "===================================================\n"
           << "Frame number: " << frame_count_ << " at time "
@@ -294,25 +351,38 @@ StatusStereoMeasurementsPtr StereoVisionImuFrontend::processStereoFrame(
           << cur_frame.timestamp_ - stereoFrame_km1_->timestamp_ << ")";
   auto start_time = utils::Timer::tic();
 
-  // TODO this copies the stereo frame!!
-  stereoFrame_k_ = std::make_shared<StereoFrame>(cur_frame);
+  // Copied by nominalSpinStereo, while preintegrating the IMU.
+  CHECK(stereoFrame_k_);
+  CHECK_EQ(stereoFrame_k_->id_, cur_frame.id_);
   Frame* left_frame_k = &stereoFrame_k_->left_frame_;
+  const bool keyframe_only_processing = isKeyframeOnlyProcessing();
 
   /////////////////////// MONO TRACKING ////////////////////////////////////////
   VLOG(2) << "Starting feature tracking...";
   // We need to use the frame to frame rotation.
   gtsam::Rot3 ref_frame_R_cur_frame =
       keyframe_R_ref_frame_.inverse().compose(keyframe_R_cur_frame);
+  std::optional<gtsam::Pose3> ref_frame_P_cur_frame;
+  std::vector<double> ref_frame_depths;
+  if (keyframe_P_cur_frame && keyframe_P_ref_frame_) {
+    ref_frame_P_cur_frame =
+        keyframe_P_ref_frame_->inverse().compose(*keyframe_P_cur_frame);
+    ref_frame_depths = getReferenceFrameDepths(*keyframe_P_ref_frame_);
+  }
   tracker_->featureTracking(&stereoFrame_km1_->left_frame_,
                             left_frame_k,
                             ref_frame_R_cur_frame,
                             frontend_params_.feature_detector_params_,
-                            stereo_camera_->getR1());
+                            stereo_camera_->getR1(),
+                            ref_frame_P_cur_frame,
+                            ref_frame_depths,
+                            !keyframe_only_processing);
 
   // feature tracking failed for all points, move on to the next frame
   if (left_frame_k->keypoints_.size() == 0) {
     VLOG(2)
         << "feature tracking failed for all points, moving to next frame \n";
+    if (speculative_feature_detector_) speculative_feature_detector_->reset();
     feature_detector_->featureDetection(left_frame_k, stereo_camera_->getR1());
     stereoFrame_km1_ = stereoFrame_k_;
     stereoFrame_k_.reset();
@@ -324,11 +394,9 @@ StatusStereoMeasurementsPtr StereoVisionImuFrontend::processStereoFrame(
 
   if (feature_tracks) {
     // TODO(Toni): these feature tracks are not outlier rejected...
-    // TODO(Toni): this image should already be computed and inside the
-    // display_queue
-    // if it is sent to the tracker.
-    *feature_tracks = tracker_->getTrackerImage(stereoFrame_lkf_->left_frame_,
-                                                stereoFrame_k_->left_frame_);
+    // The image itself is only drawn if the output is asked for it.
+    *feature_tracks = TrackerImageInput(stereoFrame_lkf_->left_frame_,
+                                        stereoFrame_k_->left_frame_);
   }
 
   VLOG(2) << "Finished feature tracking.";
@@ -345,59 +413,125 @@ StatusStereoMeasurementsPtr StereoVisionImuFrontend::processStereoFrame(
     tracker_status_summary_.kfTrackingStatus_mono_ = TrackingStatus::INVALID;
     tracker_status_summary_.kfTrackingStatus_stereo_ = TrackingStatus::INVALID;
 
+    if (keyframe_only_processing) {
+      // Versors in the left rectified frame, as featureTracking does.
+      UndistorterRectifier::GetBearingVectors(left_frame_k->keypoints_,
+                                              left_frame_k->cam_param_,
+                                              &left_frame_k->versors_,
+                                              stereo_camera_->getR1());
+    }
+
+    // The sparse stereo matching reuses the images rectified on the GPU.
+    GpuPreprocessedStereo gpu_preprocessed;
+    const bool has_gpu_preprocessed =
+        gpu_image_preprocessor_ &&
+        gpu_image_preprocessor_->retrieve(stereoFrame_k_->id_,
+                                          &gpu_preprocessed);
+    if (has_gpu_preprocessed) {
+      stereoFrame_k_->setRectifiedImages(gpu_preprocessed.left_img_rectified,
+                                         gpu_preprocessed.right_img_rectified);
+    }
+
+    // Predicted disparities of the tracked landmarks, to narrow the
+    // epipolar search of the sparse stereo matching.
+    const bool use_disparity_prior =
+        frontend_params_.stereo_matching_params_.use_disparity_prior_;
+    std::vector<double> disparity_priors;
+    std::unordered_map<LandmarkId, double> lmk_disparities;
+    if (use_disparity_prior) {
+      lmk_disparities = getLandmarkDisparities(
+          *stereoFrame_lkf_,
+          keyframe_P_cur_frame ? *keyframe_P_cur_frame
+                               : gtsam::Pose3(keyframe_R_cur_frame,
+                                              gtsam::Point3::Zero()));
+      disparity_priors = getDisparityPriors(lmk_disparities);
+    }
+
     double sparse_stereo_time = 0;
     if (frontend_params_.useRANSAC_) {
+      // The mono outlier rejection only touches the left frames, and the
+      // stereo matching of the tracked keypoints only reads their positions:
+      // both run at once, then the stereo and PnP outlier rejections.
+      utils::TaskGraph& task_graph = *keyframe_task_graph_;
+
       // MONO geometric outlier rejection
-      TrackingStatusPose status_pose_mono;
-      Frame* left_frame_lkf = &stereoFrame_lkf_->left_frame_;
-      outlierRejectionMono(keyframe_R_cur_frame,
-                           left_frame_lkf,
-                           left_frame_k,
-                           &status_pose_mono);
-      tracker_status_summary_.kfTrackingStatus_mono_ = status_pose_mono.first;
-      if (status_pose_mono.first == TrackingStatus::VALID) {
-        tracker_status_summary_.lkf_T_k_mono_ = status_pose_mono.second;
-      }
+      const utils::TaskGraph::TaskId mono_ransac = task_graph.addTask(
+          [this, &keyframe_R_cur_frame, left_frame_k]() {
+            TrackingStatusPose status_pose_mono;
+            Frame* left_frame_lkf = &stereoFrame_lkf_->left_frame_;
+            outlierRejectionMono(keyframe_R_cur_frame,
+                                 left_frame_lkf,
+                                 left_frame_k,
+                                 &status_pose_mono);
+            tracker_status_summary_.kfTrackingStatus_mono_ =
+                status_pose_mono.first;
+            if (status_pose_mono.first == TrackingStatus::VALID) {
+              tracker_status_summary_.lkf_T_k_mono_ = status_pose_mono.second;
+            }
+          });
+
       // STEREO geometric outlier rejection
       // get 3D points via stereo
-      start_time = utils::Timer::tic();
-      stereo_matcher_.sparseStereoReconstruction(stereoFrame_k_.get());
-      sparse_stereo_time = utils::Timer::toc(start_time).count();
-
-      TrackingStatusPose status_pose_stereo;
-      if (frontend_params_.use_stereo_tracking_) {
-        outlierRejectionStereo(
-            stereo_camera_->getGtsamStereoCam(),
-            keyframe_R_cur_frame,
-            stereoFrame_lkf_.get(),
-            stereoFrame_k_.get(),
-            &status_pose_stereo,
-            &tracker_status_summary_.infoMatStereoTranslation_);
-        tracker_status_summary_.kfTrackingStatus_stereo_ =
-            status_pose_stereo.first;
-
-        if (status_pose_stereo.first == TrackingStatus::VALID) {
-          tracker_status_summary_.lkf_T_k_stereo_ = status_pose_stereo.second;
-        }
-      } else {
-        status_pose_stereo.first = TrackingStatus::INVALID;
-        status_pose_stereo.second = gtsam::Pose3();
-        tracker_status_summary_.kfTrackingStatus_stereo_ =
-            TrackingStatus::INVALID;
-      }
-
-      if (frontend_params_.use_pnp_tracking_) {
-        TrackingStatusPose status_pose_pnp;
-        outlierRejectionPnP(*stereoFrame_k_, &status_pose_pnp);
-
-        tracker_status_summary_.kfTracking_status_pnp_ = status_pose_pnp.first;
-        tracker_status_summary_.W_T_k_pnp_ = status_pose_pnp.second;
-      } else {
-        tracker_status_summary_.kfTracking_status_pnp_ =
-            TrackingStatus::INVALID;
-        tracker_status_summary_.W_T_k_pnp_ = gtsam::Pose3();
-      }
-
+      const utils::TaskGraph::TaskId stereo_matching = task_graph.addTask(
+          [this, &disparity_priors, &sparse_stereo_time]() {
+            const auto tic = utils::Timer::tic();
+            stereo_matcher_.sparseStereoReconstruction(stereoFrame_k_.get(),
+                                                       disparity_priors);
+            sparse_stereo_time = utils::Timer::toc(tic).count();
+          });
+
+      const utils::TaskGraph::TaskId stereo_ransac = task_graph.addTask(
+          [this,
+           &keyframe_R_cur_frame,
+           use_disparity_prior,
+           &lmk_disparities]() {
+            if (use_disparity_prior) {
+              // Tracked landmarks now have the disparity just matched.
+              lmk_disparities =
+                  getLandmarkDisparities(*stereoFrame_k_, gtsam::Pose3());
+            }
+
+            if (frontend_params_.use_stereo_tracking_) {
+              TrackingStatusPose status_pose_stereo;
+              outlierRejectionStereo(
+                  stereo_camera_->getGtsamStereoCam(),
+                  keyframe_R_cur_frame,
+                  stereoFrame_lkf_.get(),
+                  stereoFrame_k_.get(),
+                  &status_pose_stereo,
+                  &tracker_status_summary_.infoMatStereoTranslation_);
+              tracker_status_summary_.kfTrackingStatus_stereo_ =
+                  status_pose_stereo.first;
+
+              if (status_pose_stereo.first == TrackingStatus::VALID) {
+                tracker_status_summary_.lkf_T_k_stereo_ =
+                    status_pose_stereo.second;
+              }
+            } else {
+              tracker_status_summary_.kfTrackingStatus_stereo_ =
+                  TrackingStatus::INVALID;
+            }
+          },
+          {mono_ransac, stereo_matching});
+
+      task_graph.addTask(
+          [this]() {
+            if (frontend_params_.use_pnp_tracking_) {
+              TrackingStatusPose status_pose_pnp;
+              outlierRejectionPnP(*stereoFrame_k_, &status_pose_pnp);
+
+              tracker_status_summary_.kfTracking_status_pnp_ =
+                  status_pose_pnp.first;
+              tracker_status_summary_.W_T_k_pnp_ = status_pose_pnp.second;
+            } else {
+              tracker_status_summary_.kfTracking_status_pnp_ =
+                  TrackingStatus::INVALID;
+              tracker_status_summary_.W_T_k_pnp_ = gtsam::Pose3();
+            }
+          },
+          {stereo_ransac});
+
+      task_graph.run();
     } else {
       tracker_status_summary_.kfTrackingStatus_mono_ = TrackingStatus::DISABLED;
       tracker_status_summary_.kfTrackingStatus_stereo_ =
@@ -418,12 +552,29 @@ StatusStereoMeasurementsPtr StereoVisionImuFrontend::processStereoFrame(
     // Perform feature detection (note: this must be after RANSAC,
     // since if we discard more features, we need to extract more)
     CHECK(feature_detector_);
-    feature_detector_->featureDetection(left_frame_k, stereo_camera_->getR1());
+    std::vector<cv::KeyPoint> candidates;
+    bool has_candidates = false;
+    if (has_gpu_preprocessed && gpu_preprocessed.has_candidates) {
+      candidates = std::move(gpu_preprocessed.candidates);
+      has_candidates = true;
+      if (speculative_feature_detector_) speculative_feature_detector_->reset();
+    } else if (speculative_feature_detector_) {
+      has_candidates = speculative_feature_detector_->takeCandidates(
+          *left_frame_k, &candidates);
+    }
+    feature_detector_->featureDetection(left_frame_k,
+                                        stereo_camera_->getR1(),
+                                        has_candidates ? &candidates : nullptr);
 
     // Get 3D points via stereo, including newly extracted
     // (this might be only for the visualization).
+    // Newly extracted features get the full search.
+    if (use_disparity_prior) {
+      disparity_priors = getDisparityPriors(lmk_disparities);
+    }
     start_time = utils::Timer::tic();
-    stereo_matcher_.sparseStereoReconstruction(stereoFrame_k_.get());
+    stereo_matcher_.sparseStereoReconstruction(stereoFrame_k_.get(),
+                                               disparity_priors);
     sparse_stereo_time += utils::Timer::toc(start_time).count();
 
     // Log images if needed.
@@ -434,11 +585,16 @@ StatusStereoMeasurementsPtr StereoVisionImuFrontend::processStereoFrame(
       if (FLAGS_log_stereo_matching_images) sendMonoTrackingToLogger();
     }
     if (display_queue_ && FLAGS_visualize_feature_tracks) {
-      displayImage(stereoFrame_k_->timestamp_,
-                   "feature_tracks",
-                   tracker_->getTrackerImage(stereoFrame_lkf_->left_frame_,
-                                             stereoFrame_k_->left_frame_),
-                   display_queue_);
+      const Timestamp timestamp = stereoFrame_k_->timestamp_;
+      DisplayQueue* display_queue = display_queue_;
+      TrackerImageInput input(stereoFrame_lkf_->left_frame_,
+                              stereoFrame_k_->left_frame_);
+      runDebugImageJob([timestamp, display_queue, input = std::move(input)]() {
+        displayImage(timestamp,
+                     "feature_tracks",
+                     Tracker::drawTrackerImage(input),
+                     display_queue);
+      });
     }
 
     // Populate statistics.
@@ -457,16 +613,22 @@ StatusStereoMeasurementsPtr StereoVisionImuFrontend::processStereoFrame(
   } else {
     CHECK_EQ(smart_stereo_measurements.size(), 0u);
     stereoFrame_k_->setIsKeyframe(false);
+    if (speculative_feature_detector_) {
+      // Detect ahead of the next keyframe, while tracking the next frames.
+      speculative_feature_detector_->launch(*left_frame_k);
+    }
   }
 
   // Update keyframe to reference frame for next iteration.
   if (stereoFrame_k_->isKeyframe()) {
     // Reset relative rotation if we have a keyframe.
     keyframe_R_ref_frame_ = gtsam::Rot3();
+    keyframe_P_ref_frame_ = gtsam::Pose3();
   } else {
     // Update rotation from keyframe to next iteration reference frame (aka
     // cur_frame in current iteration).
     keyframe_R_ref_frame_ = keyframe_R_cur_frame;
+    keyframe_P_ref_frame_ = keyframe_P_cur_frame;
   }
 
   // Reset frames.
@@ -480,6 +642,79 @@ StatusStereoMeasurementsPtr StereoVisionImuFrontend::processStereoFrame(
                      smart_stereo_measurements));
 }
 
+/* -------------------------------------------------------------------------- */
+std::vector<double> StereoVisionImuFrontend::getReferenceFrameDepths(
+    const gtsam::Pose3& keyframe_P_ref_frame) const {
+  CHECK(stereoFrame_lkf_);
+  CHECK(stereoFrame_km1_);
+  // Stereo 3D points are only computed at keyframes: use those of the last
+  // keyframe, moved to the reference frame.
+  const Frame& lkf_left_frame = stereoFrame_lkf_->left_frame_;
+  std::unordered_map<LandmarkId, size_t> lmk_id_to_lkf_idx;
+  if (stereoFrame_lkf_->keypoints_3d_.size() ==
+      lkf_left_frame.landmarks_.size()) {
+    for (size_t i = 0u; i < lkf_left_frame.landmarks_.size(); ++i) {
+      if (lkf_left_frame.landmarks_[i] != -1 &&
+          stereoFrame_lkf_->right_keypoints_rectified_[i].first ==
+              KeypointStatus::VALID) {
+        lmk_id_to_lkf_idx[lkf_left_frame.landmarks_[i]] = i;
+      }
+    }
+  }
+
+  const Frame& ref_left_frame = stereoFrame_km1_->left_frame_;
+  std::vector<double> depths(ref_left_frame.landmarks_.size(), 0.0);
+  for (size_t i = 0u; i < ref_left_frame.landmarks_.size(); ++i) {
+    const auto& it = lmk_id_to_lkf_idx.find(ref_left_frame.landmarks_[i]);
+    if (it == lmk_id_to_lkf_idx.end()) continue;
+    depths[i] = keyframe_P_ref_frame
+                    .transformTo(stereoFrame_lkf_->keypoints_3d_[it->second])
+                    .z();
+  }
+  return depths;
+}
+
+/* -------------------------------------------------------------------------- */
+std::unordered_map<LandmarkId, double>
+StereoVisionImuFrontend::getLandmarkDisparities(
+    const StereoFrame& stereo_frame,
+    const gtsam::Pose3& stereo_frame_P_cur_frame) const {
+  const double fx_baseline = stereo_camera_->getStereoCalib()->fx() *
+                             stereo_camera_->getBaseline();
+  const LandmarkIds& landmarks = stereo_frame.left_frame_.landmarks_;
+  // Features detected after the stereo matching have no 3D point yet.
+  const size_t nr_points =
+      std::min(landmarks.size(), stereo_frame.keypoints_3d_.size());
+  CHECK_LE(nr_points, stereo_frame.right_keypoints_rectified_.size());
+  std::unordered_map<LandmarkId, double> lmk_disparities;
+  lmk_disparities.reserve(nr_points);
+  for (size_t i = 0u; i < nr_points; ++i) {
+    if (landmarks[i] == -1 ||
+        stereo_frame.right_keypoints_rectified_[i].first !=
+            KeypointStatus::VALID) {
+      continue;
+    }
+    const double depth =
+        stereo_frame_P_cur_frame.transformTo(stereo_frame.keypoints_3d_[i])
+            .z();
+    if (depth > 0.0) lmk_disparities[landmarks[i]] = fx_baseline / depth;
+  }
+  return lmk_disparities;
+}
+
+/* -------------------------------------------------------------------------- */
+std::vector<double> StereoVisionImuFrontend::getDisparityPriors(
+    const std::unordered_map<LandmarkId, double>& lmk_disparities) const {
+  CHECK(stereoFrame_k_);
+  const LandmarkIds& landmarks = stereoFrame_k_->left_frame_.landmarks_;
+  std::vector<double> disparity_priors(landmarks.size(), 0.0);
+  for (size_t i = 0u; i < landmarks.size(); ++i) {
+    const auto& it = lmk_disparities.find(landmarks[i]);
+    if (it != lmk_disparities.end()) disparity_priors[i] = it->second;
+  }
+  return disparity_priors;
+}
+
 /* -------------------------------------------------------------------------- */
 // TODO(Toni): THIS FUNCTION CAN BE GREATLY OPTIMIZED...
 void StereoVisionImuFrontend::getSmartStereoMeasurements(
@@ -494,77 +729,74 @@ void StereoVisionImuFrontend::getSmartStereoMeasurements(
   stereoFrame_kf->checkStereoFrame();
 
   // Extract relevant info from the stereo frame:
-  // essentially the landmark if and the left/right pixel measurements.
+  // essentially the landmark if and the left/right pixel measurements, as
+  // arrays so that the loop only reads what it needs.
   const LandmarkIds& landmarkId_kf = stereoFrame_kf->left_frame_.landmarks_;
-  const StatusKeypointsCV& leftKeypoints =
-      stereoFrame_kf->left_keypoints_rectified_;
-  const StatusKeypointsCV& rightKeypoints =
-      stereoFrame_kf->right_keypoints_rectified_;
+  const StatusKeypointsSoA left_keypoints(
+      stereoFrame_kf->left_keypoints_rectified_);
+  const StatusKeypointsSoA right_keypoints(
+      stereoFrame_kf->right_keypoints_rectified_);
+  const bool use_stereo = frontend_params_.use_stereo_tracking_;
+  if (!use_stereo) {
+    LOG_EVERY_N(WARNING, 10) << "Dropping stereo information! (set "
+                                "use_stereo_tracking_ = true to use it)";
+  }
 
   // Pack information in landmark structure.
   smart_stereo_measurements->clear();
   smart_stereo_measurements->reserve(landmarkId_kf.size());
+  const float* uL = left_keypoints.x();
+  const float* v = left_keypoints.y();
+  const float* uR = right_keypoints.x();
   for (size_t i = 0; i < landmarkId_kf.size(); ++i) {
-    if (landmarkId_kf.at(i) == -1) {
+    if (landmarkId_kf[i] == -1) {
       continue;  // skip invalid points
     }
 
     // TODO implicit conversion float to double increases floating-point
     // precision!
-    const double& uL = leftKeypoints.at(i).second.x;
-    const double& v = leftKeypoints.at(i).second.y;
-    // Initialize to missing pixel information.
-    double uR = std::numeric_limits<double>::quiet_NaN();
-    if (!frontend_params_.use_stereo_tracking_) {
-      LOG_EVERY_N(WARNING, 10) << "Dropping stereo information! (set "
-                                  "use_stereo_tracking_ = true to use it)";
-    }
-    if (frontend_params_.use_stereo_tracking_ &&
-        rightKeypoints.at(i).first == KeypointStatus::VALID) {
-      // TODO implicit conversion float to double increases floating-point
-      // precision!
-      uR = rightKeypoints.at(i).second.x;
-    }
-    smart_stereo_measurements->push_back(
-        std::make_pair(landmarkId_kf[i], gtsam::StereoPoint2(uL, uR, v)));
+    // Missing pixel information if the right keypoint is not valid.
+    const double uR_i = use_stereo && right_keypoints.isValid(i)
+                            ? uR[i]
+                            : std::numeric_limits<double>::quiet_NaN();
+    smart_stereo_measurements->emplace_back(
+        landmarkId_kf[i], gtsam::StereoPoint2(uL[i], uR_i, v[i]));
   }
 }
 
 /* -------------------------------------------------------------------------- */
 void StereoVisionImuFrontend::sendFeatureTracksToLogger() const {
-  CHECK(tracker_);
-  const Frame& left_frame_k(stereoFrame_k_->left_frame_);
-  cv::Mat img_left =
-      tracker_->getTrackerImage(stereoFrame_lkf_->left_frame_, left_frame_k);
-
-  logger_->logFrontendImg(left_frame_k.id_,
-                          img_left,
-                          "monoFeatureTracksLeft",
-                          "/monoFeatureTracksLeftImg/",
-                          FLAGS_visualize_frontend_images,
-                          FLAGS_save_frontend_images);
+  CHECK(logger_);
+  FrontendLogger* logger = logger_.get();
+  const FrameId frame_id = stereoFrame_k_->left_frame_.id_;
+  const bool disp_img = FLAGS_visualize_frontend_images;
+  const bool save_img = FLAGS_save_frontend_images;
+  TrackerImageInput input(stereoFrame_lkf_->left_frame_,
+                          stereoFrame_k_->left_frame_);
+  runDebugImageJob(
+      [logger, frame_id, disp_img, save_img, input = std::move(input)]() {
+        logger->logFrontendImg(frame_id,
+                               Tracker::drawTrackerImage(input),
+                               "monoFeatureTracksLeft",
+                               "/monoFeatureTracksLeftImg/",
+                               disp_img,
+                               save_img);
+      });
 }
 
 /* -------------------------------------------------------------------------- */
 void StereoVisionImuFrontend::sendStereoMatchesToLogger() const {
-  CHECK(tracker_);
+  CHECK(logger_);
   // Draw the matchings: assumes that keypoints in the left and right keyframe
   // are ordered in the same way
   const Frame& left_frame_k(stereoFrame_k_->left_frame_);
   const Frame& right_frame_k(stereoFrame_k_->right_frame_);
 
-  cv::Mat img_left =
-      tracker_->getTrackerImage(stereoFrame_lkf_->left_frame_, left_frame_k);
-
   if ((left_frame_k.img_.cols != right_frame_k.img_.cols) ||
       (left_frame_k.img_.rows != right_frame_k.img_.rows)) {
     LOG(FATAL) << "sendStereoMatchesToLogger: image dimension mismatch!";
   }
 
-  cv::Mat img_right;
-  right_frame_k.img_.copyTo(img_right);
-  // stereoFrame_k_->keypoints_depth_
-
   DMatchVec matches;
   const StatusKeypointsCV& right_status_keypoints =
       stereoFrame_k_->right_keypoints_rectified_;
@@ -580,117 +812,148 @@ void StereoVisionImuFrontend::sendStereoMatchesToLogger() const {
                 "in right frame.";
   }
 
-  //############################################################################
-  // Plot matches.
-  cv::Mat img_left_right =
-      UtilsOpenCV::DrawCornersMatches(img_left,
-                                      left_frame_k.keypoints_,
-                                      img_right,
-                                      right_frame_k.keypoints_,
-                                      matches,
-                                      false);  // true: random color
-  cv::putText(img_left_right,
-              "S:" + std::to_string(keyframe_count_),
-              KeypointCV(10, 15),
-              CV_FONT_HERSHEY_COMPLEX,
-              0.6,
-              cv::Scalar(0, 255, 0));
-
-  logger_->logFrontendImg(left_frame_k.id_,
-                          img_left_right,
-                          "stereoMatchingUnrectified",
-                          "/stereoMatchingUnrectifiedImg/",
-                          FLAGS_visualize_frontend_images,
-                          FLAGS_save_frontend_images);
-  //############################################################################
-
-  // Display rectified, plot matches.
-  static constexpr bool kUseRandomColor = false;
-  cv::Mat img_left_right_rectified = UtilsOpenCV::DrawCornersMatches(
-      stereoFrame_k_->getLeftImgRectified(),
-      stereoFrame_k_->left_keypoints_rectified_,
-      stereoFrame_k_->getRightImgRectified(),
-      stereoFrame_k_->right_keypoints_rectified_,
-      matches,
-      kUseRandomColor);
-  cv::putText(img_left_right_rectified,
-              "S(Rect):" + std::to_string(keyframe_count_),
-              KeypointCV(10, 15),
-              CV_FONT_HERSHEY_COMPLEX,
-              0.6,
-              cv::Scalar(0, 255, 0));
-
-  logger_->logFrontendImg(left_frame_k.id_,
-                          img_left_right_rectified,
-                          "stereoMatchingRectified",
-                          "/stereoMatchingRectifiedImg/",
-                          FLAGS_visualize_frontend_images,
-                          FLAGS_save_frontend_images);
+  // Only image headers and keypoints are copied for drawing.
+  FrontendLogger* logger = logger_.get();
+  const FrameId frame_id = left_frame_k.id_;
+  const int keyframe_count = keyframe_count_;
+  const bool disp_img = FLAGS_visualize_frontend_images;
+  const bool save_img = FLAGS_save_frontend_images;
+  TrackerImageInput left_input(stereoFrame_lkf_->left_frame_, left_frame_k);
+  const cv::Mat right_img = right_frame_k.img_;
+  KeypointsCV right_keypoints = right_frame_k.keypoints_;
+  const cv::Mat left_img_rectified = stereoFrame_k_->getLeftImgRectified();
+  StatusKeypointsCV left_keypoints_rectified =
+      stereoFrame_k_->left_keypoints_rectified_;
+  const cv::Mat right_img_rectified = stereoFrame_k_->getRightImgRectified();
+  StatusKeypointsCV right_keypoints_rectified = right_status_keypoints;
+  runDebugImageJob([logger,
+                    frame_id,
+                    keyframe_count,
+                    disp_img,
+                    save_img,
+                    left_input = std::move(left_input),
+                    right_img,
+                    right_keypoints = std::move(right_keypoints),
+                    left_img_rectified,
+                    left_keypoints_rectified =
+                        std::move(left_keypoints_rectified),
+                    right_img_rectified,
+                    right_keypoints_rectified =
+                        std::move(right_keypoints_rectified),
+                    matches = std::move(matches)]() {
+    //##########################################################################
+    // Plot matches.
+    cv::Mat img_left_right =
+        UtilsOpenCV::DrawCornersMatches(Tracker::drawTrackerImage(left_input),
+                                        left_input.cur_keypoints_,
+                                        right_img,
+                                        right_keypoints,
+                                        matches,
+                                        false);  // true: random color
+    cv::putText(img_left_right,
+                "S:" + std::to_string(keyframe_count),
+                KeypointCV(10, 15),
+                CV_FONT_HERSHEY_COMPLEX,
+                0.6,
+                cv::Scalar(0, 255, 0));
+
+    logger->logFrontendImg(frame_id,
+                           img_left_right,
+                           "stereoMatchingUnrectified",
+                           "/stereoMatchingUnrectifiedImg/",
+                           disp_img,
+                           save_img);
+    //##########################################################################
+
+    // Display rectified, plot matches.
+    static constexpr bool kUseRandomColor = false;
+    cv::Mat img_left_right_rectified =
+        UtilsOpenCV::DrawCornersMatches(left_img_rectified,
+                                        left_keypoints_rectified,
+                                        right_img_rectified,
+                                        right_keypoints_rectified,
+                                        matches,
+                                        kUseRandomColor);
+    cv::putText(img_left_right_rectified,
+                "S(Rect):" + std::to_string(keyframe_count),
+                KeypointCV(10, 15),
+                CV_FONT_HERSHEY_COMPLEX,
+                0.6,
+                cv::Scalar(0, 255, 0));
+
+    logger->logFrontendImg(frame_id,
+                           img_left_right_rectified,
+                           "stereoMatchingRectified",
+                           "/stereoMatchingRectifiedImg/",
+                           disp_img,
+                           save_img);
+  });
 }
 
 /* -------------------------------------------------------------------------- */
 void StereoVisionImuFrontend::sendMonoTrackingToLogger() const {
-  const Frame& cur_left_frame = stereoFrame_k_->left_frame_;
-  const Frame& ref_left_frame = stereoFrame_lkf_->left_frame_;
-
-  // Find keypoint matches.
-  DMatchVec matches;
-  for (size_t i = 0; i < cur_left_frame.keypoints_.size(); ++i) {
-    if (cur_left_frame.landmarks_.at(i) != -1) {  // if landmark is valid
-      auto it = find(ref_left_frame.landmarks_.begin(),
-                     ref_left_frame.landmarks_.end(),
-                     cur_left_frame.landmarks_.at(i));
-      if (it != ref_left_frame.landmarks_.end()) {  // if landmark was found
-        int nPos = std::distance(ref_left_frame.landmarks_.begin(), it);
-        matches.push_back(cv::DMatch(nPos, i, 0));
-      }
-    }
-  }
-  //############################################################################
-
-  // Plot matches.
-  cv::Mat img_left_lkf_kf =
-      UtilsOpenCV::DrawCornersMatches(ref_left_frame.img_,
-                                      ref_left_frame.keypoints_,
-                                      cur_left_frame.img_,
-                                      cur_left_frame.keypoints_,
-                                      matches,
-                                      false);  // true: random color
-  cv::putText(img_left_lkf_kf,
-              "M:" + std::to_string(keyframe_count_ - 1) + "-" +
-                  std::to_string(keyframe_count_),
-              KeypointCV(10, 15),
-              CV_FONT_HERSHEY_COMPLEX,
-              0.6,
-              cv::Scalar(0, 255, 0));
-
-  logger_->logFrontendImg(cur_left_frame.id_,
-                          img_left_lkf_kf,
-                          "monoTrackingUnrectified",
-                          "/monoTrackingUnrectifiedImg/",
-                          FLAGS_visualize_frontend_images,
-                          FLAGS_save_frontend_images);
-  //############################################################################
-
-  // Display rectified, plot matches.
-  static constexpr bool kUseRandomColor = false;
-  cv::Mat img_left_lkf_kf_rectified = StereoFrame::drawCornersMatches(
-      *stereoFrame_lkf_, *stereoFrame_k_, matches, kUseRandomColor);
-  cv::putText(img_left_lkf_kf_rectified,
-              "M(Rect):" + std::to_string(keyframe_count_ - 1) + "-" +
-                  std::to_string(keyframe_count_),
-              KeypointCV(10, 15),
-              CV_FONT_HERSHEY_COMPLEX,
-              0.6,
-              cv::Scalar(0, 255, 0));
-
-  logger_->logFrontendImg(cur_left_frame.id_,
-                          img_left_lkf_kf_rectified,
-                          "monoTrackingRectified",
-                          "/monoTrackingRectifiedImg/",
-                          FLAGS_visualize_frontend_images,
-                          FLAGS_save_frontend_images);
-  // TODO Visualization must be done in the main thread.
+  CHECK(logger_);
+  FrontendLogger* logger = logger_.get();
+  const FrameId frame_id = stereoFrame_k_->left_frame_.id_;
+  const int keyframe_count = keyframe_count_;
+  const bool disp_img = FLAGS_visualize_frontend_images;
+  const bool save_img = FLAGS_save_frontend_images;
+  const cv::Mat ref_img = stereoFrame_lkf_->left_frame_.img_;
+  TrackerImageInput input(stereoFrame_lkf_->left_frame_,
+                          stereoFrame_k_->left_frame_);
+  const cv::Mat ref_img_rectified = stereoFrame_lkf_->getLeftImgRectified();
+  StatusKeypointsCV ref_keypoints_rectified =
+      stereoFrame_lkf_->left_keypoints_rectified_;
+  const cv::Mat cur_img_rectified = stereoFrame_k_->getLeftImgRectified();
+  StatusKeypointsCV cur_keypoints_rectified =
+      stereoFrame_k_->left_keypoints_rectified_;
+  runDebugImageJob([logger,
+                    frame_id,
+                    keyframe_count,
+                    disp_img,
+                    save_img,
+                    ref_img,
+                    input = std::move(input),
+                    ref_img_rectified,
+                    ref_keypoints_rectified =
+                        std::move(ref_keypoints_rectified),
+                    cur_img_rectified,
+                    cur_keypoints_rectified =
+                        std::move(cur_keypoints_rectified)]() {
+    // Plot matches.
+    logger->logFrontendImg(
+        frame_id,
+        drawMonoTrackingImage(ref_img, input, keyframe_count),
+        "monoTrackingUnrectified",
+        "/monoTrackingUnrectifiedImg/",
+        disp_img,
+        save_img);
+    //##########################################################################
+
+    // Display rectified, plot matches.
+    static constexpr bool kUseRandomColor = false;
+    cv::Mat img_left_lkf_kf_rectified = UtilsOpenCV::DrawCornersMatches(
+        ref_img_rectified,
+        ref_keypoints_rectified,
+        cur_img_rectified,
+        cur_keypoints_rectified,
+        findLandmarkMatches(input.ref_landmarks_, input.cur_landmarks_),
+        kUseRandomColor);
+    cv::putText(img_left_lkf_kf_rectified,
+                "M(Rect):" + std::to_string(keyframe_count - 1) + "-" +
+                    std::to_string(keyframe_count),
+                KeypointCV(10, 15),
+                CV_FONT_HERSHEY_COMPLEX,
+                0.6,
+                cv::Scalar(0, 255, 0));
+
+    logger->logFrontendImg(frame_id,
+                           img_left_lkf_kf_rectified,
+                           "monoTrackingRectified",
+                           "/monoTrackingRectifiedImg/",
+                           disp_img,
+                           save_img);
+  });
 }
 
 /* -------------------------------------------------------------------------- */
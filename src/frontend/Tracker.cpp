@@ -22,7 +22,9 @@
 
 #include "kimera-vio/frontend/UndistorterRectifier.h"
 #include "kimera-vio/frontend/optical-flow/OpticalFlowPredictorFactory.h"
+#include "kimera-vio/utils/PerfCounters.h"
 #include "kimera-vio/utils/Timer.h"
+#include "kimera-vio/utils/Tracing.h"
 #include "kimera-vio/utils/UtilsOpenCV.h"
 #include "kimera-vio/visualizer/Display-definitions.h"
 
@@ -56,35 +58,92 @@ Tracker::Tracker(const TrackerParams& tracker_params,
                  DisplayQueue* display_queue)
     : tracker_params_(tracker_params),
       landmark_count_(0),
+      klt_max_level_(tracker_params.klt_max_level_),
+      ransac_max_iterations_(tracker_params.ransac_max_iterations_),
       camera_(camera),
       // Only for debugging and visualization:
       optical_flow_predictor_(nullptr),
+      gpu_optical_flow_(nullptr),
+      fixed_window_klt_(nullptr),
       display_queue_(display_queue),
+      debug_image_worker_(nullptr),
       output_images_path_("./outputImages/") {
-  // Create the optical flow prediction module
+  // Create the optical flow prediction module. The keypoints are tracked in
+  // the unrectified images: predict their flow with the radial distortion of
+  // the camera (the tangential distortion is neglected).
+  const CameraParams& cam_params = camera_->getCamParams();
+  cv::Vec2f radial_distortion(0.0f, 0.0f);
+  if (cam_params.distortion_model_ == DistortionModel::RADTAN &&
+      cam_params.distortion_coeff_.size() >= 2u) {
+    radial_distortion = cv::Vec2f(cam_params.distortion_coeff_[0],
+                                  cam_params.distortion_coeff_[1]);
+  }
   optical_flow_predictor_ =
       OpticalFlowPredictorFactory::makeOpticalFlowPredictor(
           tracker_params_.optical_flow_predictor_type_,
-          camera_->getCamParams().K_,
-          camera_->getCamParams().image_size_);
+          cam_params.K_,
+          cam_params.image_size_,
+          radial_distortion);
+
+  if (tracker_params_.klt_use_cuda_) {
+    if (GpuSparseOpticalFlow::isAvailable()) {
+      gpu_optical_flow_ = std::make_unique<GpuSparseOpticalFlow>();
+    } else {
+      LOG(WARNING) << "Tracker: no CUDA optical flow available, using the CPU.";
+    }
+  }
+  if (tracker_params_.klt_use_fixed_window_kernel_ && !gpu_optical_flow_) {
+    if (FixedWindowKlt::isSupported(tracker_params_.klt_win_size_)) {
+      fixed_window_klt_ =
+          std::make_unique<FixedWindowKlt>(tracker_params_.klt_win_size_);
+    } else {
+      LOG(WARNING) << "Tracker: no fixed window KLT kernel for a window of "
+                   << tracker_params_.klt_win_size_ << "px, using OpenCV's.";
+    }
+  }
 
   // Setup Mono Ransac
   mono_ransac_.threshold_ = tracker_params_.ransac_threshold_mono_;
-  mono_ransac_.max_iterations_ = tracker_params_.ransac_max_iterations_;
+  mono_ransac_.max_iterations_ = ransac_max_iterations_;
   mono_ransac_.probability_ = tracker_params_.ransac_probability_;
 
   // Setup Mono Ransac given Rotation
   mono_ransac_given_rot_.threshold_ = tracker_params_.ransac_threshold_mono_;
   mono_ransac_given_rot_.max_iterations_ =
-      tracker_params_.ransac_max_iterations_;
+      ransac_max_iterations_;
   mono_ransac_given_rot_.probability_ = tracker_params_.ransac_probability_;
 
   // Setup Stereo Ransac
   stereo_ransac_.threshold_ = tracker_params_.ransac_threshold_stereo_;
-  stereo_ransac_.max_iterations_ = tracker_params_.ransac_max_iterations_;
+  stereo_ransac_.max_iterations_ = ransac_max_iterations_;
   stereo_ransac_.probability_ = tracker_params_.ransac_probability_;
 }
 
+void Tracker::setRansacMaxIterations(const int& ransac_max_iterations) {
+  CHECK_GT(ransac_max_iterations, 0);
+  ransac_max_iterations_ = ransac_max_iterations;
+  mono_ransac_.max_iterations_ = ransac_max_iterations_;
+  mono_ransac_given_rot_.max_iterations_ = ransac_max_iterations_;
+  stereo_ransac_.max_iterations_ = ransac_max_iterations_;
+}
+
+void Tracker::buildOpticalFlowPyramid(const Frame& frame) const {
+  if (gpu_optical_flow_) {
+    // The GPU KLT builds its pyramids on the device.
+    gpu_optical_flow_->uploadAsync(frame.timestamp_, frame.img_);
+    return;
+  }
+  // Same window size and max level as in featureTracking.
+  if (fixed_window_klt_) {
+    // The derivatives are computed once the frame is tracked from.
+    frame.getKltPyramid(tracker_params_.klt_win_size_, klt_max_level_, false);
+    return;
+  }
+  frame.getOpticalFlowPyramid(
+      cv::Size2i(tracker_params_.klt_win_size_, tracker_params_.klt_win_size_),
+      klt_max_level_);
+}
+
 // TODO(Toni) a pity that this function is not const just because
 // it modifies debuginfo_...
 // NOTE: you do not need R in the mono case. For stereo cameras we pass R
@@ -94,29 +153,62 @@ void Tracker::featureTracking(
     Frame* cur_frame,
     const gtsam::Rot3& ref_R_cur,
     const FeatureDetectorParams& feature_detector_params,
-    std::optional<cv::Mat> R) {
+    std::optional<cv::Mat> R,
+    const std::optional<gtsam::Pose3>& ref_P_cur,
+    const std::vector<double>& ref_depths,
+    const bool& compute_versors) {
+  KIMERA_TRACE_SCOPE("Tracker::featureTracking");
+  KIMERA_PERF_SCOPE("Tracker::featureTracking");
   CHECK_NOTNULL(ref_frame);
   CHECK_NOTNULL(cur_frame);
   auto tic = utils::Timer::tic();
 
   // Fill up structure for reference pixels and their labels.
   const size_t& n_ref_kpts = ref_frame->keypoints_.size();
-  KeypointsCV px_ref;
-  std::vector<size_t> indices_of_valid_landmarks;
+  const bool use_motion_prior = ref_P_cur.has_value() &&
+                                tracker_params_.optical_flow_predictor_type_ ==
+                                    OpticalFlowPredictorType::kRotoTranslational;
+  if (use_motion_prior) CHECK_EQ(ref_depths.size(), n_ref_kpts);
+  // Scratch buffers are members: they keep their capacity across frames.
+  KeypointsCV& px_ref = klt_px_ref_;
+  std::vector<size_t>& indices_of_valid_landmarks = klt_ref_indices_;
+  px_ref.clear();
+  indices_of_valid_landmarks.clear();
   px_ref.reserve(n_ref_kpts);
   indices_of_valid_landmarks.reserve(n_ref_kpts);
+  std::vector<double> px_ref_depths;
+  if (use_motion_prior) px_ref_depths.reserve(n_ref_kpts);
   for (size_t i = 0; i < ref_frame->keypoints_.size(); ++i) {
-    if (ref_frame->landmarks_[i] != -1) {
-      // Current reference frame keypoint has a valid landmark.
-      px_ref.push_back(ref_frame->keypoints_[i]);
-      indices_of_valid_landmarks.push_back(i);
+    if (ref_frame->landmarks_[i] == -1) continue;
+    if (ref_frame->landmarks_age_[i] > tracker_params_.max_feature_track_age_) {
+      // Feature track is too long: it would be discarded after tracking, so
+      // do not even track it. We mark this bad in the ref_frame since
+      // features in the ref frame guide feature detection later on.
+      ref_frame->landmarks_[i] = -1;
+      continue;
     }
+    // Current reference frame keypoint has a valid landmark.
+    px_ref.push_back(ref_frame->keypoints_[i]);
+    indices_of_valid_landmarks.push_back(i);
+    if (use_motion_prior) px_ref_depths.push_back(ref_depths[i]);
   }
 
+  // With a translation prior, KLT starts closer to the solution: it can use
+  // fewer pyramid levels and iterations.
+  const int klt_max_iter =
+      use_motion_prior && tracker_params_.klt_max_iter_with_motion_prior_ > 0
+          ? tracker_params_.klt_max_iter_with_motion_prior_
+          : tracker_params_.klt_max_iter_;
+  const int klt_max_level =
+      use_motion_prior && tracker_params_.klt_max_level_with_motion_prior_ >= 0
+          ? std::min(tracker_params_.klt_max_level_with_motion_prior_,
+                     klt_max_level_)
+          : klt_max_level_;
+
   // Setup termination criteria for optical flow.
   const cv::TermCriteria kTerminationCriteria(
       cv::TermCriteria::COUNT + cv::TermCriteria::EPS,
-      tracker_params_.klt_max_iter_,
+      klt_max_iter,
       tracker_params_.klt_eps_);
   const cv::Size2i klt_window_size(tracker_params_.klt_win_size_,
                                    tracker_params_.klt_win_size_);
@@ -124,68 +216,130 @@ void Tracker::featureTracking(
   // Initialize to old locations
   LOG_IF(ERROR, px_ref.size() == 0u) << "No keypoints in reference frame!";
 
-  KeypointsCV px_cur;
-  CHECK(optical_flow_predictor_->predictSparseFlow(px_ref, ref_R_cur, &px_cur));
-  KeypointsCV px_predicted = px_cur;
+  // At this point cur_frame should have no keypoints...
+  CHECK(cur_frame->keypoints_.empty());
+  CHECK(cur_frame->landmarks_.empty());
+  CHECK(cur_frame->landmarks_age_.empty());
+  CHECK(cur_frame->scores_.empty());
+  CHECK(cur_frame->versors_.empty());
+
+  // Predict and track directly in the current frame's keypoints: these are
+  // compacted in place afterwards.
+  KeypointsCV& px_cur = cur_frame->keypoints_;
+  if (use_motion_prior) {
+    CHECK(optical_flow_predictor_->predictSparseFlow(
+        px_ref, *ref_P_cur, px_ref_depths, &px_cur));
+  } else {
+    CHECK(optical_flow_predictor_->predictSparseFlow(
+        px_ref, ref_R_cur, &px_cur));
+  }
+  const bool visualize_predictions =
+      display_queue_ && FLAGS_visualize_feature_predictions;
+  KeypointsCV px_predicted;
+  if (visualize_predictions) px_predicted = px_cur;
 
   // Do the actual tracking, so px_cur becomes the new pixel locations.
   VLOG(2) << "Starting Optical Flow Pyr LK tracking...";
 
-  std::vector<uchar> status;
-  std::vector<float> error;
+  std::vector<uchar>& status = klt_status_;
+  std::vector<float>& error = klt_error_;
   auto time_lukas_kanade_tic = utils::Timer::tic();
-  cv::calcOpticalFlowPyrLK(ref_frame->img_,
-                           cur_frame->img_,
-                           px_ref,
-                           px_cur,
-                           status,
-                           error,
-                           klt_window_size,
-                           tracker_params_.klt_max_level_,
-                           kTerminationCriteria,
-                           cv::OPTFLOW_USE_INITIAL_FLOW);
+  if (gpu_optical_flow_) {
+    // The images stay on the device: only the keypoints are transferred.
+    gpu_optical_flow_->track(ref_frame->timestamp_,
+                             ref_frame->img_,
+                             cur_frame->timestamp_,
+                             cur_frame->img_,
+                             klt_window_size,
+                             klt_max_level,
+                             klt_max_iter,
+                             px_ref,
+                             &px_cur,
+                             &status);
+  } else if (fixed_window_klt_) {
+    // Same pyramid caching as for OpenCV's KLT below.
+    const KltPyramid& ref_pyramid = ref_frame->getKltPyramid(
+        tracker_params_.klt_win_size_, klt_max_level_, true);
+    const KltPyramid& cur_pyramid = cur_frame->getKltPyramid(
+        tracker_params_.klt_win_size_, klt_max_level_, false);
+    const int nr_levels = std::min({ref_pyramid.getMaxLevel(),
+                                    cur_pyramid.getMaxLevel(),
+                                    klt_max_level});
+    fixed_window_klt_->track(ref_pyramid,
+                             cur_pyramid,
+                             nr_levels,
+                             kTerminationCriteria,
+                             px_ref,
+                             &px_cur,
+                             &status);
+  } else {
+    // Use the pyramids cached in the frames: the current frame's pyramid will
+    // be reused when this frame becomes the reference frame on the next call.
+    int ref_nr_levels = 0;
+    int cur_nr_levels = 0;
+    const std::vector<cv::Mat>& ref_pyramid = ref_frame->getOpticalFlowPyramid(
+        klt_window_size, klt_max_level_, &ref_nr_levels);
+    const std::vector<cv::Mat>& cur_pyramid = cur_frame->getOpticalFlowPyramid(
+        klt_window_size, klt_max_level_, &cur_nr_levels);
+    const int nr_levels =
+        std::min({ref_nr_levels, cur_nr_levels, klt_max_level});
+    cv::calcOpticalFlowPyrLK(ref_pyramid,
+                             cur_pyramid,
+                             px_ref,
+                             px_cur,
+                             status,
+                             error,
+                             klt_window_size,
+                             nr_levels,
+                             kTerminationCriteria,
+                             cv::OPTFLOW_USE_INITIAL_FLOW);
+  }
   VLOG(1) << "Optical Flow Timing [ms]: "
           << utils::Timer::toc(time_lukas_kanade_tic).count();
   VLOG(2) << "Finished Optical Flow Pyr LK tracking.";
 
+  // The reference frame will not be tracked from again, free its pyramid.
+  ref_frame->releaseOpticalFlowPyramid();
+
   // TODO(Toni): use the error to further take only the best tracks?
 
-  // At this point cur_frame should have no keypoints...
-  CHECK(cur_frame->keypoints_.empty());
-  CHECK(cur_frame->landmarks_.empty());
-  CHECK(cur_frame->landmarks_age_.empty());
-  CHECK(cur_frame->keypoints_.empty());
-  CHECK(cur_frame->scores_.empty());
-  CHECK(cur_frame->versors_.empty());
-  // TODO(TOni): this is basically copying the whole px_ref into the
-  // current frame as well as the ref_frame information! Absolute nonsense.
+  CHECK_EQ(px_cur.size(), px_ref.size());
+  CHECK_EQ(status.size(), px_ref.size());
   cur_frame->landmarks_.reserve(px_ref.size());
   cur_frame->landmarks_age_.reserve(px_ref.size());
-  cur_frame->keypoints_.reserve(px_ref.size());
   cur_frame->scores_.reserve(px_ref.size());
-  cur_frame->versors_.reserve(px_ref.size());
+  // Tracks leaving the static region of interest of the camera are dropped:
+  // they are not tracked (nor matched in stereo) any further.
+  const CameraParams& cur_cam_param = cur_frame->cam_param_;
+  const bool has_roi_mask = cur_cam_param.hasRoiMask();
+  size_t n_tracked = 0u;
   for (size_t i = 0u; i < indices_of_valid_landmarks.size(); ++i) {
     // If we failed to track mark off that landmark
     const size_t& idx_valid_lmk = indices_of_valid_landmarks[i];
-    const size_t& lmk_age = ref_frame->landmarks_age_[idx_valid_lmk];
-    const LandmarkId& lmk_id = ref_frame->landmarks_[idx_valid_lmk];
-
-    // if we tracked keypoint and feature track is not too long
-    if (!status[i] || lmk_age > tracker_params_.max_feature_track_age_) {
+    if (!status[i] || (has_roi_mask && !cur_cam_param.isInRoi(px_cur[i]))) {
       // we are marking this bad in the ref_frame since features
       // in the ref frame guide feature detection later on
       ref_frame->landmarks_[idx_valid_lmk] = -1;
       continue;
     }
-    cur_frame->landmarks_.push_back(lmk_id);
-    cur_frame->landmarks_age_.push_back(lmk_age);
+    // Compact the tracked keypoints in place (n_tracked <= i).
+    px_cur[n_tracked] = px_cur[i];
+    cur_frame->landmarks_.push_back(ref_frame->landmarks_[idx_valid_lmk]);
+    cur_frame->landmarks_age_.push_back(
+        ref_frame->landmarks_age_[idx_valid_lmk]);
     cur_frame->scores_.push_back(ref_frame->scores_[idx_valid_lmk]);
-    cur_frame->keypoints_.push_back(px_cur[i]);
-    gtsam::Vector3 bearing_vector = UndistorterRectifier::GetBearingVector(
-        px_cur[i], ref_frame->cam_param_, R);
-    CHECK_LT(std::abs(bearing_vector.norm() - 1.0), 1e-6)
-        << "Versor norm: " << bearing_vector.norm();
-    cur_frame->versors_.push_back(bearing_vector);
+    ++n_tracked;
+  }
+  px_cur.resize(n_tracked);
+
+  // Versors of all tracked keypoints at once.
+  if (compute_versors) {
+    UndistorterRectifier::GetBearingVectors(
+        px_cur, ref_frame->cam_param_, &cur_frame->versors_, R);
+    for (const gtsam::Vector3& bearing_vector : cur_frame->versors_) {
+      DCHECK_LT(std::abs(bearing_vector.norm() - 1.0), 1e-6)
+          << "Versor norm: " << bearing_vector.norm();
+    }
   }
 
   // max number of frames in which a feature is seen
@@ -198,11 +352,21 @@ void Tracker::featureTracking(
           << " vs. max_feature_track_age_: "
           << tracker_params_.max_feature_track_age_ << ")";
   // Display feature tracks together with predicted points.
-  if (display_queue_ && FLAGS_visualize_feature_predictions) {
-    displayImage(cur_frame->timestamp_,
-                 "feature_tracks_with_predicted_keypoints",
-                 getTrackerImage(*ref_frame, *cur_frame, px_predicted, px_ref),
-                 display_queue_);
+  if (visualize_predictions) {
+    const Timestamp timestamp = cur_frame->timestamp_;
+    DisplayQueue* display_queue = display_queue_;
+    TrackerImageInput input(*ref_frame, *cur_frame, px_predicted, px_ref);
+    auto display_job = [timestamp, display_queue, input = std::move(input)]() {
+      displayImage(timestamp,
+                   "feature_tracks_with_predicted_keypoints",
+                   drawTrackerImage(input),
+                   display_queue);
+    };
+    if (debug_image_worker_) {
+      debug_image_worker_->addJob(std::move(display_job));
+    } else {
+      display_job();
+    }
   }
 
   // Fill debug information
@@ -253,22 +417,39 @@ TrackingStatusPose Tracker::geometricOutlierRejection2d2d(
   //! Solve problem.
   gtsam::Pose3 best_pose = gtsam::Pose3();
   bool success = false;
-  if (tracker_params_.ransac_use_2point_mono_) {
+  bool used_2point = tracker_params_.ransac_use_2point_mono_;
+  if (used_2point) {
     success = runRansac(std::make_shared<Problem2d2dGivenRot>(
                             adapter, tracker_params_.ransac_randomize_),
                         tracker_params_.ransac_threshold_mono_,
-                        tracker_params_.ransac_max_iterations_,
+                        ransac_max_iterations_,
                         tracker_params_.ransac_probability_,
                         tracker_params_.optimize_2d2d_pose_from_inliers_,
                         &best_pose,
                         inliers);
-  } else {
+    if (tracker_params_.ransac_use_2point_fast_path_) {
+      ++debug_info_.nrMono2PointRansacs_;
+      const double inlier_ratio =
+          success ? static_cast<double>(inliers->size()) /
+                        static_cast<double>(n_matches)
+                  : 0.0;
+      if (inlier_ratio <
+          tracker_params_.ransac_2point_fallback_inlier_ratio_) {
+        // The rotation prior does not explain the data: fall back to 5-point.
+        VLOG(5) << "2-point RANSAC inlier ratio " << inlier_ratio
+                << " too low, falling back to 5-point RANSAC.";
+        ++debug_info_.nrMono2PointFallbacks_;
+        used_2point = false;
+      }
+    }
+  }
+  if (!used_2point) {
     success = runRansac(
         std::make_shared<Problem2d2d>(adapter,
                                       tracker_params_.pose_2d2d_algorithm_,
                                       tracker_params_.ransac_randomize_),
         tracker_params_.ransac_threshold_mono_,
-        tracker_params_.ransac_max_iterations_,
+        ransac_max_iterations_,
         tracker_params_.ransac_probability_,
         tracker_params_.optimize_2d2d_pose_from_inliers_,
         &best_pose,
@@ -293,7 +474,7 @@ TrackingStatusPose Tracker::geometricOutlierRejection2d2d(
 
     // NOTE: 2-point always returns the identity rotation, hence we have to
     // substitute it:
-    if (tracker_params_.ransac_use_2point_mono_) {
+    if (used_2point) {
       CHECK(cam_lkf_Pose_cam_kf.rotation().equals(best_pose.rotation()));
     }
 
@@ -413,8 +594,6 @@ Tracker::geometricOutlierRejection3d3dGivenRotation(
 
   // NOTE: 3d points are constructed by versors, which are already in the
   // rectified left camera frame. No further rectification needed.
-  gtsam::Vector3 f_ref_i, R_f_cur_i;
-  gtsam::Matrix3 cov_ref_i, cov_R_cur_i;
 
   // Relative translation suggested by each match and covariances
   // (DOUBLE FOR PRECISE COV COMPUTATION).
@@ -432,29 +611,43 @@ Tracker::geometricOutlierRejection3d3dGivenRotation(
   Matrices3f cov_relTranf;
   cov_relTranf.reserve(n_matches);
 
+  // Lift all the matched points at once: reference vectors and covariances,
+  // and current ones rotated to the reference frame.
+  std::vector<size_t> ref_ids;
+  std::vector<size_t> cur_ids;
+  ref_ids.reserve(n_matches);
+  cur_ids.reserve(n_matches);
   for (const KeypointMatch& kpt_match : matches_ref_cur) {
-    // Get reference vector and covariance:
-    std::tie(f_ref_i, cov_ref_i) =
-        Tracker::getPoint3AndCovariance(ref_keypoints_status_left,
-                                        ref_keypoints_status_right,
-                                        ref_keypoints_3d,
-                                        stereo_cam,
-                                        kpt_match.first,
-                                        stereo_pt_cov,
-                                        std::nullopt);
-    // Get current vectors and covariance:
-    std::tie(R_f_cur_i, cov_R_cur_i) =
-        Tracker::getPoint3AndCovariance(cur_keypoints_status_left,
-                                        cur_keypoints_status_right,
-                                        cur_keypoints_3d,
-                                        stereo_cam,
-                                        kpt_match.second,
-                                        stereo_pt_cov,
-                                        camLrectlkf_R_camLrectkf.matrix());
-
+    ref_ids.push_back(kpt_match.first);
+    cur_ids.push_back(kpt_match.second);
+  }
+  Vectors3 f_ref;
+  Matrices3 cov_ref;
+  Tracker::getPoints3AndCovariances(ref_keypoints_status_left,
+                                    ref_keypoints_status_right,
+                                    ref_keypoints_3d,
+                                    stereo_cam,
+                                    ref_ids,
+                                    stereo_pt_cov,
+                                    std::nullopt,
+                                    &f_ref,
+                                    &cov_ref);
+  Vectors3 R_f_cur;
+  Matrices3 cov_R_cur;
+  Tracker::getPoints3AndCovariances(cur_keypoints_status_left,
+                                    cur_keypoints_status_right,
+                                    cur_keypoints_3d,
+                                    stereo_cam,
+                                    cur_ids,
+                                    stereo_pt_cov,
+                                    camLrectlkf_R_camLrectkf.matrix(),
+                                    &R_f_cur,
+                                    &cov_R_cur);
+
+  for (size_t i = 0; i < n_matches; ++i) {
     // Populate relative translation estimates and their covariances.
-    gtsam::Vector3 v = f_ref_i - R_f_cur_i;
-    gtsam::Matrix3 M = cov_R_cur_i + cov_ref_i;
+    const gtsam::Vector3 v = f_ref[i] - R_f_cur[i];
+    const gtsam::Matrix3 M = cov_R_cur[i] + cov_ref[i];
 
     rel_tran.push_back(v);
     cov_relTran.push_back(M);
@@ -701,7 +894,7 @@ TrackingStatusPose Tracker::geometricOutlierRejection3d3d(
   success = runRansac(
       std::make_shared<Problem3d3d>(adapter, tracker_params_.ransac_randomize_),
       tracker_params_.ransac_threshold_stereo_,
-      tracker_params_.ransac_max_iterations_,
+      ransac_max_iterations_,
       tracker_params_.ransac_probability_,
       tracker_params_.optimize_3d3d_pose_from_inliers_,
       &best_pose,
@@ -817,6 +1010,55 @@ std::pair<Vector3, Matrix3> Tracker::getPoint3AndCovariance(
   return std::make_pair(point3_i, cov_i);
 }
 
+void Tracker::getPoints3AndCovariances(
+    const StatusKeypointsCV& keypoints_undistorted_left,
+    const StatusKeypointsCV& keypoints_undistorted_right,
+    const BearingVectors& keypoints_3d,
+    const gtsam::StereoCamera& stereo_cam,
+    const std::vector<size_t>& point_ids,
+    const gtsam::Matrix3& stereo_point_covariance,
+    const std::optional<gtsam::Matrix3>& Rmat,
+    Vectors3* points,
+    Matrices3* covariances) {
+  CHECK_NOTNULL(points)->clear();
+  CHECK_NOTNULL(covariances)->clear();
+  points->reserve(point_ids.size());
+  covariances->reserve(point_ids.size());
+
+  // Same Jacobian as gtsam::StereoCamera::backproject2, with the rotations
+  // folded in once for all the points.
+  const gtsam::Cal3_S2Stereo& K = stereo_cam.calibration();
+  const double fx = K.fx();
+  const double fy = K.fy();
+  const double cx = K.px();
+  const double cy = K.py();
+  const double b_fx = K.baseline() * fx;
+  gtsam::Matrix3 R = stereo_cam.pose().rotation().matrix();
+  if (Rmat) R = (*Rmat) * R;
+
+  for (const size_t& point_id : point_ids) {
+    const KeypointCV& left = keypoints_undistorted_left[point_id].second;
+    const double uL = left.x;
+    const double v = left.y;
+    const double uR = keypoints_undistorted_right[point_id].second.x;
+    const double disparity = uL - uR;
+    const double z = b_fx / disparity;
+    const double z_uR = z / disparity;
+    const double z_uL = -z_uR;
+    const double x_ratio = (uL - cx) / fx;
+    const double y_ratio = (v - cy) / fy;
+    gtsam::Matrix3 D_local_uv;
+    D_local_uv << z / fx + x_ratio * z_uL, x_ratio * z_uR, 0.0,
+        y_ratio * z_uL, y_ratio * z_uR, z / fy,
+        z_uL, z_uR, 0.0;
+    const gtsam::Matrix3 J = R * D_local_uv;
+
+    const Vector3& point3 = keypoints_3d[point_id];
+    points->push_back(Rmat ? Vector3((*Rmat) * point3) : point3);
+    covariances->push_back(J * stereo_point_covariance * J.transpose());
+  }
+}
+
 std::pair<Vector3, Matrix3> Tracker::getPoint3AndCovariance(
     const StereoFrame& stereo_frame,
     const gtsam::StereoCamera& stereo_cam,
@@ -921,28 +1163,57 @@ void Tracker::findMatchingKeypoints(const Frame& ref_frame,
                                     KeypointMatches* matches_ref_cur) {
   CHECK_NOTNULL(matches_ref_cur)->clear();
 
-  // Find keypoints that observe the same landmarks in both frames:
-  std::map<LandmarkId, size_t> ref_lm_index_map;
-  for (size_t i = 0; i < ref_frame.landmarks_.size(); ++i) {
-    const LandmarkId& ref_id = ref_frame.landmarks_.at(i);
-    if (ref_id != -1) {
-      // Map landmark id -> position in ref_frame.landmarks_
-      ref_lm_index_map[ref_id] = i;
+  // Find keypoints that observe the same landmarks in both frames, merging
+  // the (landmark id, position) pairs of both frames sorted by id. Tracked
+  // landmarks keep their order and new ones get increasing ids, so the pairs
+  // are usually sorted already and no sort nor tree is needed.
+  LandmarkIndex ref_lm_index;
+  LandmarkIndex cur_lm_index;
+  buildLandmarkIndex(ref_frame.landmarks_, &ref_lm_index);
+  const bool is_cur_sorted =
+      buildLandmarkIndex(cur_frame.landmarks_, &cur_lm_index);
+
+  // Pairs of position of landmark j in ref frame and position of landmark j
+  // in cur_frame.
+  matches_ref_cur->reserve(std::min(ref_lm_index.size(), cur_lm_index.size()));
+  auto ref_it = ref_lm_index.begin();
+  auto cur_it = cur_lm_index.begin();
+  while (ref_it != ref_lm_index.end() && cur_it != cur_lm_index.end()) {
+    if (ref_it->first < cur_it->first) {
+      ++ref_it;
+    } else if (cur_it->first < ref_it->first) {
+      ++cur_it;
+    } else {
+      matches_ref_cur->emplace_back(ref_it->second, cur_it->second);
+      ++ref_it;
+      ++cur_it;
     }
   }
 
-  // Map of position of landmark j in ref frame to position of landmark j in
-  // cur_frame
-  matches_ref_cur->reserve(ref_lm_index_map.size());
-  for (size_t i = 0; i < cur_frame.landmarks_.size(); ++i) {
-    const LandmarkId& cur_id = cur_frame.landmarks_.at(i);
-    if (cur_id != -1) {
-      auto it = ref_lm_index_map.find(cur_id);
-      if (it != ref_lm_index_map.end()) {
-        matches_ref_cur->push_back(std::make_pair(it->second, i));
-      }
-    }
+  // Matches in the order of the keypoints of cur_frame.
+  if (!is_cur_sorted) {
+    std::sort(matches_ref_cur->begin(),
+              matches_ref_cur->end(),
+              [](const KeypointMatch& a, const KeypointMatch& b) {
+                return a.second < b.second;
+              });
+  }
+}
+
+bool Tracker::buildLandmarkIndex(const LandmarkIds& landmarks,
+                                 LandmarkIndex* lm_index) {
+  CHECK_NOTNULL(lm_index)->clear();
+  lm_index->reserve(landmarks.size());
+  bool is_sorted = true;
+  for (size_t i = 0; i < landmarks.size(); ++i) {
+    const LandmarkId& lmk_id = landmarks[i];
+    if (lmk_id == -1) continue;
+    is_sorted = is_sorted &&
+                (lm_index->empty() || lm_index->back().first < lmk_id);
+    lm_index->push_back(std::make_pair(lmk_id, i));
   }
+  if (!is_sorted) std::sort(lm_index->begin(), lm_index->end());
+  return is_sorted;
 }
 
 void Tracker::findMatchingStereoKeypoints(
@@ -1017,12 +1288,31 @@ bool Tracker::computeMedianDisparity(const KeypointsCV& ref_frame_kpts,
   return true;
 }
 
+TrackerImageInput::TrackerImageInput(const Frame& ref_frame,
+                                     const Frame& cur_frame,
+                                     const KeypointsCV& extra_corners_gray,
+                                     const KeypointsCV& extra_corners_blue)
+    : cur_img_(cur_frame.img_),
+      ref_keypoints_(ref_frame.keypoints_),
+      ref_landmarks_(ref_frame.landmarks_),
+      cur_keypoints_(cur_frame.keypoints_),
+      cur_landmarks_(cur_frame.landmarks_),
+      extra_corners_gray_(extra_corners_gray),
+      extra_corners_blue_(extra_corners_blue) {}
+
 cv::Mat Tracker::getTrackerImage(const Frame& ref_frame,
                                  const Frame& cur_frame,
                                  const KeypointsCV& extra_corners_gray,
                                  const KeypointsCV& extra_corners_blue) const {
-  cv::Mat img_rgb(cur_frame.img_.size(), CV_8U);
-  cv::cvtColor(cur_frame.img_, img_rgb, cv::COLOR_GRAY2RGB);
+  return drawTrackerImage(TrackerImageInput(
+      ref_frame, cur_frame, extra_corners_gray, extra_corners_blue));
+}
+
+cv::Mat Tracker::drawTrackerImage(const TrackerImageInput& input) {
+  CHECK_EQ(input.ref_keypoints_.size(), input.ref_landmarks_.size());
+  CHECK_EQ(input.cur_keypoints_.size(), input.cur_landmarks_.size());
+  cv::Mat img_rgb(input.cur_img_.size(), CV_8U);
+  cv::cvtColor(input.cur_img_, img_rgb, cv::COLOR_GRAY2RGB);
 
   static const cv::Scalar gray(0, 255, 255);
   static const cv::Scalar red(0, 0, 255);
@@ -1030,28 +1320,35 @@ cv::Mat Tracker::getTrackerImage(const Frame& ref_frame,
   static const cv::Scalar blue(255, 0, 0);
 
   // Add extra corners if desired.
-  for (const auto& px : extra_corners_gray) {
+  for (const auto& px : input.extra_corners_gray_) {
     cv::circle(img_rgb, px, 4, gray, 2);
   }
-  for (const auto& px : extra_corners_blue) {
+  for (const auto& px : input.extra_corners_blue_) {
     cv::circle(img_rgb, px, 4, blue, 2);
   }
 
+  // Index of each landmark in the ref frame, to find the tracks.
+  LandmarkStore<size_t> ref_lmk_idx;
+  ref_lmk_idx.reserve(input.ref_landmarks_.size());
+  for (size_t i = 0; i < input.ref_landmarks_.size(); ++i) {
+    if (input.ref_landmarks_[i] != -1) {
+      ref_lmk_idx.emplace(input.ref_landmarks_[i], i);
+    }
+  }
+
   // Add all keypoints in cur_frame with the tracks.
-  for (size_t i = 0; i < cur_frame.keypoints_.size(); ++i) {
-    const cv::Point2f& px_cur = cur_frame.keypoints_.at(i);
-    if (cur_frame.landmarks_.at(i) == -1) {  // Untracked landmarks are red.
+  for (size_t i = 0; i < input.cur_keypoints_.size(); ++i) {
+    const cv::Point2f& px_cur = input.cur_keypoints_[i];
+    const LandmarkId& lmk_id = input.cur_landmarks_[i];
+    if (lmk_id == -1) {  // Untracked landmarks are red.
       cv::circle(img_rgb, px_cur, 4, red, 2);
     } else {
-      const auto& it = std::find(ref_frame.landmarks_.begin(),
-                                 ref_frame.landmarks_.end(),
-                                 cur_frame.landmarks_.at(i));
-      if (it != ref_frame.landmarks_.end()) {
+      const auto& it = ref_lmk_idx.find(lmk_id);
+      if (it != ref_lmk_idx.end()) {
         // If feature was in previous frame, display tracked feature with
         // green circle/line:
         cv::circle(img_rgb, px_cur, 6, green, 1);
-        int i = std::distance(ref_frame.landmarks_.begin(), it);
-        const cv::Point2f& px_ref = ref_frame.keypoints_.at(i);
+        const cv::Point2f& px_ref = input.ref_keypoints_[it->second];
         cv::arrowedLine(img_rgb, px_ref, px_cur, green, 1);
       } else {  // New feature tracks are blue.
         cv::circle(img_rgb, px_cur, 6, blue, 1);
@@ -1151,7 +1448,7 @@ bool Tracker::pnp(const BearingVectors& cam_bearing_vectors,
                          << "- Focal Length: " << avg_focal_length << '\n'
                          << "- Threshold: " << threshold << '\n'
                          << "- Ransac Max Iters: "
-                         << tracker_params_.ransac_max_iterations_ << '\n'
+                         << ransac_max_iterations_ << '\n'
                          << "- Ransac Probability : "
                          << tracker_params_.ransac_probability_ << '\n'
                          << "- Optimize inliers : "
@@ -1171,7 +1468,7 @@ bool Tracker::pnp(const BearingVectors& cam_bearing_vectors,
             std::make_shared<ProblemPnP>(
                 adapter, ProblemPnP::TWOPT, tracker_params_.ransac_randomize_),
             threshold,
-            tracker_params_.ransac_max_iterations_,
+            ransac_max_iterations_,
             tracker_params_.ransac_probability_,
             tracker_params_.optimize_2d3d_pose_from_inliers_,
             F_Pose_cam_estimate,
@@ -1183,7 +1480,7 @@ bool Tracker::pnp(const BearingVectors& cam_bearing_vectors,
             std::make_shared<ProblemPnP>(
                 adapter, ProblemPnP::KNEIP, tracker_params_.ransac_randomize_),
             threshold,
-            tracker_params_.ransac_max_iterations_,
+            ransac_max_iterations_,
             tracker_params_.ransac_probability_,
             tracker_params_.optimize_2d3d_pose_from_inliers_,
             F_Pose_cam_estimate,
@@ -1195,7 +1492,7 @@ bool Tracker::pnp(const BearingVectors& cam_bearing_vectors,
             std::make_shared<ProblemPnP>(
                 adapter, ProblemPnP::GAO, tracker_params_.ransac_randomize_),
             threshold,
-            tracker_params_.ransac_max_iterations_,
+            ransac_max_iterations_,
             tracker_params_.ransac_probability_,
             tracker_params_.optimize_2d3d_pose_from_inliers_,
             F_Pose_cam_estimate,
@@ -1207,7 +1504,7 @@ bool Tracker::pnp(const BearingVectors& cam_bearing_vectors,
             std::make_shared<ProblemPnP>(
                 adapter, ProblemPnP::EPNP, tracker_params_.ransac_randomize_),
             threshold,
-            tracker_params_.ransac_max_iterations_,
+            ransac_max_iterations_,
             tracker_params_.ransac_probability_,
             tracker_params_.optimize_2d3d_pose_from_inliers_,
             F_Pose_cam_estimate,
@@ -14,20 +14,99 @@
 
 #include "kimera-vio/frontend/UndistorterRectifier.h"
 
+#include <string>
+#include <variant>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <Eigen/Core>
+
 #include <opencv2/calib3d.hpp>
 #include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
 
 #include "kimera-vio/frontend/Camera.h"
+#include "kimera-vio/frontend/CameraModels.h"
 #include "kimera-vio/frontend/CameraParams.h"
 #include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/StartupCache.h"
+
+DEFINE_bool(undistort_rectify_fixed_point_maps,
+            false,
+            "Remap images with fixed-point (CV_16SC2 + CV_16UC1) maps instead "
+            "of floating point maps: about half the memory bandwidth, at the "
+            "cost of a 1/32 pixel interpolation precision.");
 
 namespace VIO {
 
+namespace {
+
+Eigen::Matrix3d toMatrix3d(const cv::Mat& mat) {
+  CHECK_EQ(mat.rows, 3);
+  CHECK_EQ(mat.cols, 3);
+  cv::Mat mat_double;
+  mat.convertTo(mat_double, CV_64F);
+  Eigen::Matrix3d matrix;
+  for (int row = 0; row < 3; ++row) {
+    for (int col = 0; col < 3; ++col) {
+      matrix(row, col) = mat_double.at<double>(row, col);
+    }
+  }
+  return matrix;
+}
+
+//! Same as cv::undistortPoints, with the camera model specialized for the
+//! distortion model instead. Returns false if there is no such model.
+bool undistortRectifyPinholeKeypoints(const KeypointsCV& keypoints,
+                                      const CameraParams& cam_param,
+                                      const std::optional<cv::Mat>& R,
+                                      const std::optional<cv::Mat>& P,
+                                      KeypointsCV* undistorted_keypoints) {
+  PinholeCameraModelVariant camera_model =
+      CameraModelFactory::createUndistortedPinholeCameraModel(cam_param);
+  if (!CameraModelFactory::createPinholeCameraModel(cam_param,
+                                                    &camera_model)) {
+    return false;
+  }
+  // As cv::undistortPoints: the rays are rotated by R, then projected by the
+  // left 3x3 block of P (normalized coordinates if there is no P).
+  Eigen::Matrix3d P_R = Eigen::Matrix3d::Identity();
+  if (R && !R->empty()) P_R = toMatrix3d(*R);
+  if (P && !P->empty()) P_R = toMatrix3d((*P)(cv::Rect(0, 0, 3, 3))) * P_R;
+
+  undistorted_keypoints->resize(keypoints.size());
+  std::visit(
+      [&](const auto& model) {
+        for (size_t i = 0u; i < keypoints.size(); ++i) {
+          const KeypointCV& kp = keypoints[i];
+          const Eigen::Vector3d ray =
+              P_R * model.unproject(Eigen::Vector2d(kp.x, kp.y));
+          (*undistorted_keypoints)[i] =
+              KeypointCV(ray.x() / ray.z(), ray.y() / ray.z());
+        }
+      },
+      camera_model);
+  return true;
+}
+
+}  // namespace
+
 UndistorterRectifier::UndistorterRectifier(const cv::Mat& P,
                                            const CameraParams& cam_params,
                                            const cv::Mat& R)
-    : map_x_(), map_y_(), P_(P), R_(R), cam_params_(cam_params) {
+    : map_x_(),
+      map_y_(),
+      fixed_map_xy_(),
+      fixed_map_interp_(),
+      P_(P),
+      R_(R),
+      cam_params_(cam_params) {
   initUndistortRectifyMaps(cam_params, R, P, &map_x_, &map_y_);
+  if (FLAGS_undistort_rectify_fixed_point_maps) {
+    initFixedPointMaps();
+  }
 }
 
 void UndistorterRectifier::UndistortRectifyKeypoints(
@@ -37,6 +116,10 @@ void UndistorterRectifier::UndistortRectifyKeypoints(
     std::optional<cv::Mat> R,
     std::optional<cv::Mat> P) {
   CHECK_NOTNULL(undistorted_keypoints)->clear();
+  if (undistortRectifyPinholeKeypoints(
+          keypoints, cam_param, R, P, undistorted_keypoints)) {
+    return;
+  }
   switch (cam_param.distortion_model_) {
     case DistortionModel::RADTAN: {
       cv::undistortPoints(keypoints,
@@ -112,6 +195,26 @@ gtsam::Vector3 UndistorterRectifier::GetBearingVector(
   return versor.normalized();
 }
 
+void UndistorterRectifier::GetBearingVectors(const KeypointsCV& keypoints,
+                                             const CameraParams& cam_param,
+                                             BearingVectors* bearing_vectors,
+                                             std::optional<cv::Mat> R) {
+  CHECK_NOTNULL(bearing_vectors)->clear();
+  if (keypoints.empty()) return;
+
+  // NOTE: not sending P because we want the canonical frame.
+  KeypointsCV undistorted_keypoints;
+  UndistorterRectifier::UndistortRectifyKeypoints(
+      keypoints, &undistorted_keypoints, cam_param, R, std::nullopt);
+  CHECK_EQ(undistorted_keypoints.size(), keypoints.size());
+
+  bearing_vectors->resize(undistorted_keypoints.size());
+  for (size_t i = 0u; i < undistorted_keypoints.size(); ++i) {
+    const KeypointCV& kp = undistorted_keypoints[i];
+    (*bearing_vectors)[i] = gtsam::Vector3(kp.x, kp.y, 1.0).normalized();
+  }
+}
+
 void UndistorterRectifier::undistortRectifyImage(
     const cv::Mat& img,
     cv::Mat* undistorted_img) const {
@@ -120,13 +223,53 @@ void UndistorterRectifier::undistortRectifyImage(
   CHECK_EQ(map_y_.size, img.size);
   cv::remap(img,
             *undistorted_img,
-            map_x_,
-            map_y_,
+            remapMap1(),
+            remapMap2(),
+            remap_interpolation_type_,
+            remap_use_constant_border_type_ ? cv::BORDER_CONSTANT
+                                            : cv::BORDER_REPLICATE);
+}
+
+void UndistorterRectifier::undistortRectifyImage(
+    const cv::Mat& img,
+    const cv::Rect& roi,
+    cv::Mat* undistorted_img) const {
+  CHECK_NOTNULL(undistorted_img);
+  CHECK_EQ(map_x_.size, img.size);
+  CHECK_EQ(map_y_.size, img.size);
+  const cv::Rect clipped_roi = roi & cv::Rect(0, 0, img.cols, img.rows);
+  if (undistorted_img->size() != img.size() ||
+      undistorted_img->type() != img.type()) {
+    *undistorted_img = cv::Mat::zeros(img.size(), img.type());
+  }
+  if (clipped_roi.empty()) return;
+
+  // The maps store absolute source coordinates, hence remapping a sub-region
+  // of the maps yields the corresponding sub-region of the rectified image.
+  cv::Mat undistorted_roi = (*undistorted_img)(clipped_roi);
+  cv::remap(img,
+            undistorted_roi,
+            remapMap1()(clipped_roi),
+            remapMap2()(clipped_roi),
             remap_interpolation_type_,
             remap_use_constant_border_type_ ? cv::BORDER_CONSTANT
                                             : cv::BORDER_REPLICATE);
 }
 
+cv::Rect UndistorterRectifier::getRectifiedRoi(const cv::Mat& mask) const {
+  CHECK_EQ(mask.type(), CV_8UC1);
+  CHECK_EQ(map_x_.size, mask.size);
+  cv::Mat rectified_mask;
+  cv::remap(mask,
+            rectified_mask,
+            remapMap1(),
+            remapMap2(),
+            cv::INTER_NEAREST,
+            cv::BORDER_CONSTANT,
+            cv::Scalar(0));
+  return cv::boundingRect(rectified_mask);
+}
+
 void UndistorterRectifier::undistortRectifyKeypoints(
     const KeypointsCV& keypoints,
     KeypointsCV* undistorted_keypoints) const {
@@ -238,6 +381,29 @@ void UndistorterRectifier::initUndistortRectifyMaps(
   static constexpr int kImageType = CV_32FC1;
   // static constexpr int kImageType = CV_16SC2;
 
+  // The maps only depend on these inputs: skip computing them if cached.
+  const bool is_cacheable =
+      cam_params.distortion_model_ == DistortionModel::RADTAN ||
+      cam_params.distortion_model_ == DistortionModel::EQUIDISTANT;
+  const std::string cache_key =
+      "undistort_rectify_maps/" + cam_params.camera_id_;
+  uint64_t cache_hash =
+      StartupCache::hashValue(VIO::to_underlying(cam_params.distortion_model_));
+  cache_hash = StartupCache::hash(cam_params.K_, cache_hash);
+  cache_hash = StartupCache::hash(cam_params.distortion_coeff_mat_, cache_hash);
+  cache_hash = StartupCache::hash(R, cache_hash);
+  cache_hash = StartupCache::hash(P, cache_hash);
+  cache_hash = StartupCache::hashValue(cam_params.image_size_, cache_hash);
+  cache_hash = StartupCache::hashValue(kImageType, cache_hash);
+  StartupCache& startup_cache = StartupCache::getInstance();
+  std::vector<cv::Mat> cached_maps;
+  if (is_cacheable && startup_cache.get(cache_key, cache_hash, &cached_maps) &&
+      cached_maps.size() == 2u) {
+    *map_x = cached_maps[0];
+    *map_y = cached_maps[1];
+    return;
+  }
+
   cv::Mat map_x_float, map_y_float;
   switch (cam_params.distortion_model_) {
     case DistortionModel::NONE: {
@@ -282,13 +448,28 @@ void UndistorterRectifier::initUndistortRectifyMaps(
     }
   }
 
-  // TODO(marcus): can we add this in without causing errors like before?
-  // The reason we convert from floating to fixed-point representations
-  // of a map is that they can yield much faster (~2x) remapping operations.
-  // cv::convertMaps(map_x_float, map_y_float, *map_x, *map_y, CV_16SC2, false);
-
+  // NOTE: the floating point maps are kept since they are needed for
+  // per-keypoint lookups (see distortUnrectifyKeypoints), the fixed-point
+  // ones are built on top of them in initFixedPointMaps.
   *map_x = map_x_float;
   *map_y = map_y_float;
+  if (is_cacheable) {
+    startup_cache.put(cache_key, cache_hash, {map_x_float, map_y_float});
+  }
+}
+
+void UndistorterRectifier::initFixedPointMaps() {
+  if (map_x_.empty() || map_y_.empty()) {
+    LOG(WARNING) << "UndistorterRectifier: no floating point maps to convert "
+                    "to fixed-point maps.";
+    return;
+  }
+  // The reason we convert from floating to fixed-point representations
+  // of a map is that they can yield much faster (~2x) remapping operations.
+  cv::convertMaps(
+      map_x_, map_y_, fixed_map_xy_, fixed_map_interp_, CV_16SC2, false);
+  CHECK_EQ(fixed_map_xy_.type(), CV_16SC2);
+  CHECK_EQ(fixed_map_interp_.type(), CV_16UC1);
 }
 
 }  // namespace VIO
@@ -14,8 +14,31 @@
 
 #include "kimera-vio/frontend/VisionImuFrontend.h"
 
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <utility>
+
 #include "kimera-vio/initial/CrossCorrTimeAligner.h"
+#include "kimera-vio/utils/Statistics.h"
+#include "kimera-vio/utils/Timer.h"
+#include "kimera-vio/utils/Tracing.h"
 #include "kimera-vio/utils/UtilsNumerical.h"
+#include "kimera-vio/utils/UtilsOpenCV.h"
+
+DEFINE_bool(frontend_parallel_imu_preintegration,
+            false,
+            "Preintegrate the IMU of each frame in a separate thread, while "
+            "the frame is copied and its image pyramid is built.");
+DEFINE_bool(frontend_async_debug_images,
+            true,
+            "Draw, save and display the frontend debug images (feature tracks, "
+            "matches...) in a low priority thread, instead of the frontend "
+            "thread.");
+DEFINE_int32(frontend_debug_images_max_queue_size,
+             4,
+             "Max nr of frames whose debug images wait to be drawn, beyond "
+             "which the debug images of new frames are dropped.");
 
 namespace VIO {
 
@@ -31,22 +54,129 @@ VisionImuFrontend::VisionImuFrontend(const FrontendParams& frontend_params,
       keyframe_count_(0),
       last_keyframe_timestamp_(0),
       imu_frontend_(nullptr),
+      imu_preintegration_graph_(nullptr),
       tracker_(nullptr),
       tracker_status_summary_(),
       display_queue_(display_queue),
       logger_(nullptr),
-      odom_params_(odom_params) {
+      odom_params_(odom_params),
+      feature_budget_scale_(1.0),
+      applied_feature_budget_scale_(1.0) {
   imu_frontend_ = std::make_unique<ImuFrontend>(imu_params, imu_initial_bias);
+  if (FLAGS_frontend_parallel_imu_preintegration) {
+    // The frontend thread runs the vision work, its thread the IMU.
+    imu_preintegration_graph_ = std::make_unique<utils::TaskGraph>(1u);
+  }
   if (log_output) {
     logger_ = std::make_unique<FrontendLogger>();
   }
+  if (FLAGS_frontend_async_debug_images && (display_queue_ || logger_)) {
+    CHECK_GT(FLAGS_frontend_debug_images_max_queue_size, 0);
+    debug_image_worker_ = std::make_unique<utils::LowPriorityWorker>(
+        "Frontend Debug Images",
+        static_cast<size_t>(FLAGS_frontend_debug_images_max_queue_size));
+  }
   time_aligner_ = std::make_unique<CrossCorrTimeAligner>(imu_params);
+  if (frontend_params_.adaptive_feature_budget_) {
+    feature_budget_controller_ = std::make_unique<FeatureBudgetController>(
+        frontend_params_.feature_budget_params_,
+        frontend_params_.feature_detector_params_.max_features_per_frame_,
+        frontend_params_.tracker_params_.klt_max_level_,
+        frontend_params_.tracker_params_.ransac_max_iterations_);
+  }
+  if (frontend_params_.use_idle_mode_) {
+    stationary_detector_ =
+        std::make_unique<StationaryDetector>(frontend_params_.idle_params_);
+  }
 }
 
 VisionImuFrontend::~VisionImuFrontend() {
   LOG(INFO) << "VisionImuFrontend destructor called.";
 }
 
+void VisionImuFrontend::runDebugImageJob(
+    utils::LowPriorityWorker::Job job) const {
+  if (debug_image_worker_) {
+    debug_image_worker_->addJob(std::move(job));
+  } else {
+    job();
+  }
+}
+
+void VisionImuFrontend::updateFeatureBudget(const double& keyframe_time_ms,
+                                            FeatureDetector* feature_detector) {
+  const double scale = feature_budget_scale_;
+  bool budget_changed = scale != applied_feature_budget_scale_;
+  applied_feature_budget_scale_ = scale;
+  if (feature_budget_controller_) {
+    double latency_ms = keyframe_time_ms;
+    // Measured by the backend pipeline module (see PipelineLatency).
+    static const std::string kBackendComputeTag = "VioBackend Compute [ms]";
+    if (frontend_params_.feature_budget_include_backend_ &&
+        utils::Statistics::HasHandle(kBackendComputeTag)) {
+      latency_ms += utils::Statistics::GetLastValue(kBackendComputeTag);
+    }
+    if (feature_budget_controller_->update(latency_ms)) {
+      budget_changed = true;
+      CHECK(tracker_);
+      tracker_->setKltMaxLevel(feature_budget_controller_->getKltMaxLevel());
+      tracker_->setRansacMaxIterations(
+          feature_budget_controller_->getRansacMaxIterations());
+    }
+  }
+  if (!budget_changed || !feature_detector) return;
+
+  const int max_features_per_frame =
+      feature_budget_controller_
+          ? feature_budget_controller_->getMaxFeaturesPerFrame()
+          : frontend_params_.feature_detector_params_.max_features_per_frame_;
+  feature_detector->setMaxFeaturesPerFrame(std::max(
+      1,
+      static_cast<int>(std::lround(scale * max_features_per_frame))));
+}
+
+DMatchVec VisionImuFrontend::findLandmarkMatches(
+    const LandmarkIds& ref_landmarks,
+    const LandmarkIds& cur_landmarks) {
+  std::unordered_map<LandmarkId, int> ref_lmk_idx;
+  ref_lmk_idx.reserve(ref_landmarks.size());
+  for (size_t i = 0; i < ref_landmarks.size(); ++i) {
+    if (ref_landmarks[i] != -1) {
+      ref_lmk_idx.emplace(ref_landmarks[i], static_cast<int>(i));
+    }
+  }
+  DMatchVec matches;
+  for (size_t i = 0; i < cur_landmarks.size(); ++i) {
+    if (cur_landmarks[i] == -1) continue;
+    const auto& it = ref_lmk_idx.find(cur_landmarks[i]);
+    if (it != ref_lmk_idx.end()) {
+      matches.push_back(cv::DMatch(it->second, i, 0));
+    }
+  }
+  return matches;
+}
+
+cv::Mat VisionImuFrontend::drawMonoTrackingImage(
+    const cv::Mat& ref_img,
+    const TrackerImageInput& input,
+    const int& keyframe_count) {
+  cv::Mat img_lkf_kf = UtilsOpenCV::DrawCornersMatches(
+      ref_img,
+      input.ref_keypoints_,
+      input.cur_img_,
+      input.cur_keypoints_,
+      findLandmarkMatches(input.ref_landmarks_, input.cur_landmarks_),
+      false);  // true: random color
+  cv::putText(img_lkf_kf,
+              "M:" + std::to_string(keyframe_count - 1) + "-" +
+                  std::to_string(keyframe_count),
+              KeypointCV(10, 15),
+              CV_FONT_HERSHEY_COMPLEX,
+              0.6,
+              cv::Scalar(0, 255, 0));
+  return img_lkf_kf;
+}
+
 FrontendOutputPacketBase::UniquePtr VisionImuFrontend::spinOnce(
     FrontendInputPacketBase::UniquePtr&& input) {
   const FrontendState& frontend_state = frontend_state_;
@@ -91,24 +221,32 @@ void VisionImuFrontend::outlierRejectionMono(
     const gtsam::Rot3& keyframe_R_cur_frame,
     Frame* frame_lkf,
     Frame* frame_k,
-    TrackingStatusPose* status_pose_mono) const {
+    TrackingStatusPose* status_pose_mono,
+    Tracker* tracker) const {
+  KIMERA_TRACE_SCOPE("VisionImuFrontend::outlierRejectionMono");
   CHECK_NOTNULL(status_pose_mono);
+  if (!tracker) tracker = tracker_.get();
+  CHECK(tracker);
 
   const bool given_rot = !keyframe_R_cur_frame.equals(gtsam::Rot3());
   const bool time_aligned =
       frontend_state_ != FrontendState::InitialTimeAlignment;
-  const bool imu_ok = given_rot && time_aligned;
+  // In fast-path mode the gyro rotation is always used, even if identity:
+  // the tracker falls back to 5-point if it is inconsistent with the data.
+  const bool imu_ok =
+      (given_rot || tracker->tracker_params_.ransac_use_2point_fast_path_) &&
+      time_aligned;
 
-  if (tracker_->tracker_params_.ransac_use_2point_mono_ && imu_ok) {
+  if (tracker->tracker_params_.ransac_use_2point_mono_ && imu_ok) {
     // 2-point RANSAC.
     // TODO(marcus): move things from tracker here, only ransac in tracker.cpp
     gtsam::Pose3 keyframe_Pose_cur_frame(keyframe_R_cur_frame, gtsam::Point3());
-    *status_pose_mono = tracker_->geometricOutlierRejection2d2d(
+    *status_pose_mono = tracker->geometricOutlierRejection2d2d(
         frame_lkf, frame_k, keyframe_Pose_cur_frame);
   } else {
     // 5-point RANSAC.
     *status_pose_mono =
-        tracker_->geometricOutlierRejection2d2d(frame_lkf, frame_k);
+        tracker->geometricOutlierRejection2d2d(frame_lkf, frame_k);
   }
 }
 
@@ -119,6 +257,7 @@ void VisionImuFrontend::outlierRejectionStereo(
     StereoFrame* frame_k,
     TrackingStatusPose* status_pose_stereo,
     gtsam::Matrix3* translation_info_matrix) const {
+  KIMERA_TRACE_SCOPE("VisionImuFrontend::outlierRejectionStereo");
   CHECK(frame_lkf);
   CHECK(frame_k);
   CHECK(tracker_);
@@ -146,6 +285,7 @@ void VisionImuFrontend::outlierRejectionStereo(
 void VisionImuFrontend::outlierRejectionPnP(
     const StereoFrame& frame,
     TrackingStatusPose* status_pnp) const {
+  KIMERA_TRACE_SCOPE("VisionImuFrontend::outlierRejectionPnP");
   CHECK_NOTNULL(status_pnp);
 
   gtsam::Pose3 best_absolute_pose;
@@ -204,6 +344,20 @@ bool VisionImuFrontend::shouldBeKeyframe(const Frame& frame,
   const bool disparity_flipped =
       ((enough_disparity || disparity_low_first_time) && min_time_elapsed);
 
+  if (updateIdleMode(frame, disparity)) {
+    // Standing still: the disparity is only noise, only create the keyframes
+    // that the smoother horizon and the tracking need.
+    const bool idle_time_elapsed =
+        UtilsNumerical::NsecToSec(kf_diff_ns) >=
+        frontend_params_.idle_params_.max_keyframe_time_s;
+    VLOG_IF(2, idle_time_elapsed) << "Keyframe reason: max idle time elapsed.";
+    VLOG_IF(2, nr_features_low)
+        << "Keyframe reason: low nr of features in idle mode.";
+    LOG_IF(WARNING, frame.isKeyframe_)
+        << "Keyframe reason: user enforced keyframe!";
+    return idle_time_elapsed || nr_features_low || frame.isKeyframe_;
+  }
+
   const bool need_new_keyframe = max_time_elapsed || max_disparity_reached ||
                                  disparity_flipped || nr_features_low ||
                                  frame.isKeyframe_;
@@ -231,6 +385,36 @@ bool VisionImuFrontend::shouldBeKeyframe(const Frame& frame,
   return true;
 }
 
+bool VisionImuFrontend::updateIdleMode(const Frame& frame,
+                                       const double& disparity) const {
+  if (!stationary_detector_) return false;
+  const bool was_idle = stationary_detector_->isIdle();
+  const double idle_duration_s =
+      stationary_detector_->getIdleDuration(frame.timestamp_);
+  Eigen::Vector3d gyro_mean;
+  const bool has_gyro_mean = stationary_detector_->getStillGyroMean(&gyro_mean);
+
+  const bool is_idle =
+      stationary_detector_->update(frame.timestamp_, disparity);
+  if (is_idle && !was_idle) {
+    LOG(INFO) << "Platform standing still: entering idle mode.";
+  } else if (!is_idle && was_idle) {
+    LOG(INFO) << "Motion resumed: leaving idle mode after " << idle_duration_s
+              << " [s].";
+    if (has_gyro_mean) {
+      // While still, the gyroscope only measures its bias.
+      const double gyro_bias_error =
+          (gyro_mean - imu_frontend_->getCurrentImuBias().gyroscope()).norm();
+      VLOG(1) << "Idle gyroscope mean: " << gyro_mean.transpose()
+              << ", bias error: " << gyro_bias_error << " [rad/s].";
+      static const utils::StatsCollector gyro_bias_error_stats(
+          "Frontend idle gyro bias error [rad/s]");
+      gyro_bias_error_stats.AddSample(gyro_bias_error);
+    }
+  }
+  return is_idle;
+}
+
 void VisionImuFrontend::printTrackingStatus(const TrackingStatus& status,
                                             const std::string& type) {
   LOG(INFO) << "Status " << type << ": "
@@ -301,4 +485,57 @@ VisionImuFrontend::getExternalOdometryWorldVelocity(
   return (*input->world_NavState_ext_odom_).velocity();
 }
 
+ImuFrontend::PimPtr VisionImuFrontend::preintegrateImuWhile(
+    const ImuStampS& imu_stamps,
+    const ImuAccGyrS& imu_accgyrs,
+    const std::function<void()>& vision_work) {
+  CHECK(vision_work);
+  if (stationary_detector_) {
+    stationary_detector_->addImuMeasurements(imu_accgyrs);
+  }
+  // Only touches the ImuFrontend, whose preintegration is guarded against
+  // the Backend resetting its gravity.
+  ImuFrontend::PimPtr pim = nullptr;
+  const auto preintegrate = [this, &imu_stamps, &imu_accgyrs, &pim]() {
+    auto tic = utils::Timer::tic();
+    pim = imu_frontend_->preintegrateImuMeasurements(imu_stamps, imu_accgyrs);
+    VLOG(1) << "Current IMU Preintegration time: "
+            << utils::Timer::toc<std::chrono::microseconds>(tic).count()
+            << "[us]";
+  };
+
+  if (imu_preintegration_graph_) {
+    imu_preintegration_graph_->addTask(preintegrate);
+    imu_preintegration_graph_->addTask(vision_work);
+    // Joins before tracking, which needs the rotation prior.
+    imu_preintegration_graph_->run();
+  } else {
+    preintegrate();
+    vision_work();
+  }
+  CHECK(pim);
+  return pim;
+}
+
+std::optional<gtsam::Pose3> VisionImuFrontend::predictBodyPoseFromImu(
+    const ImuFrontend::PimPtr& pim) const {
+  CHECK(pim);
+  std::lock_guard<std::mutex> lock(W_State_Blkf_mtx_);
+  // The backend may lag behind (parallel run): only use the state if it is
+  // the one of the last keyframe, which is the origin of the preintegration.
+  if (!W_State_Blkf_ || W_State_Blkf_->timestamp_ != last_keyframe_timestamp_) {
+    return std::nullopt;
+  }
+
+  // p_k = p_lkf + v_lkf * dt + 0.5 * g * dt^2 + R_lkf * deltaPij,
+  // expressed in the body frame of the last keyframe.
+  const gtsam::Rot3& W_R_Blkf = W_State_Blkf_->pose_.rotation();
+  const double dt = pim->deltaTij();
+  const gtsam::Vector3 Blkf_v = W_R_Blkf.unrotate(W_State_Blkf_->velocity_);
+  const gtsam::Vector3 Blkf_g = W_R_Blkf.unrotate(getGravity());
+  const gtsam::Vector3 Blkf_t_Bk =
+      Blkf_v * dt + 0.5 * Blkf_g * dt * dt + pim->deltaPij();
+  return gtsam::Pose3(pim->deltaRij(), Blkf_t_Bk);
+}
+
 }  // namespace VIO
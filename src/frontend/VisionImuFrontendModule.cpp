@@ -14,15 +14,32 @@
 
 #include "kimera-vio/frontend/VisionImuFrontendModule.h"
 
+#include "kimera-vio/utils/Statistics.h"
+
+DEFINE_int32(frontend_latency_budget_ms,
+             0,
+             "In parallel mode, max lag (in sensor time) between the frame "
+             "processed by the Frontend and the newest frame waiting for it. "
+             "Older frames are dropped (their IMU measurements are kept) to "
+             "bound the pose latency when the pipeline falls behind. "
+             "0 to process all frames.");
+
 namespace VIO {
 
 VisionImuFrontendModule::VisionImuFrontendModule(
-    InputQueue* input_queue,
+    InputQueueBase* input_queue,
     bool parallel_run,
     VisionImuFrontend::UniquePtr vio_frontend)
     : SIMO(input_queue, "VioFrontend", parallel_run),
-      vio_frontend_(std::move(vio_frontend)) {
+      vio_frontend_(std::move(vio_frontend)),
+      backlog_mutex_(),
+      backlog_(),
+      nr_dropped_frames_(0u),
+      frame_decimation_(1u),
+      nr_decimated_frames_(0u),
+      skipped_input_(nullptr) {
   CHECK(vio_frontend_);
+  CHECK_GE(FLAGS_frontend_latency_budget_ms, 0);
 }
 
 FrontendOutputPacketBase::UniquePtr VisionImuFrontendModule::spinOnce(
@@ -31,4 +48,80 @@ FrontendOutputPacketBase::UniquePtr VisionImuFrontendModule::spinOnce(
   return vio_frontend_->spinOnce(std::move(input));
 }
 
+VisionImuFrontendModule::InputUniquePtr
+VisionImuFrontendModule::getInputPacket() {
+  InputUniquePtr input = getLatencyBoundedInputPacket();
+  if (!input) return nullptr;
+  if (skipped_input_) {
+    input->prependImuMeasurements(*skipped_input_);
+    skipped_input_.reset();
+  }
+  const size_t decimation = frame_decimation_;
+  if (decimation <= 1u || !vio_frontend_->isInitialized() ||
+      nr_decimated_frames_++ % decimation == 0u) {
+    return input;
+  }
+  utils::StatsCollector decimated_frames_stats("VioFrontend Decimated Frames");
+  decimated_frames_stats.IncrementOne();
+  VLOG(2) << "Module: " << name_id_ << " - Decimated frame with timestamp: "
+          << input->timestamp_;
+  skipped_input_ = std::move(input);
+  return nullptr;
+}
+
+VisionImuFrontendModule::InputUniquePtr
+VisionImuFrontendModule::getLatencyBoundedInputPacket() {
+  if (!parallel_run_ || FLAGS_frontend_latency_budget_ms == 0) {
+    return SIMO::getInputPacket();
+  }
+
+  // Only block if there is nothing left to process.
+  bool is_backlog_empty = false;
+  {
+    std::lock_guard<std::mutex> lock(backlog_mutex_);
+    is_backlog_empty = backlog_.empty();
+  }
+  InputUniquePtr input = nullptr;
+  if (is_backlog_empty) {
+    input = SIMO::getInputPacket();
+    if (!input) return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(backlog_mutex_);
+  if (input) backlog_.push_back(std::move(input));
+  // Grab all the packets already waiting, without blocking.
+  InputUniquePtr next = nullptr;
+  while (input_queue_->pop(next)) {
+    CHECK(next);
+    backlog_.push_back(std::move(next));
+  }
+
+  const Timestamp budget_ns =
+      static_cast<Timestamp>(FLAGS_frontend_latency_budget_ms) * 1000000;
+  utils::StatsCollector dropped_frames_stats("VioFrontend Dropped Frames");
+  while (backlog_.size() > 1u &&
+         backlog_.back()->timestamp_ - backlog_.front()->timestamp_ >
+             budget_ns) {
+    InputUniquePtr dropped = std::move(backlog_.front());
+    backlog_.pop_front();
+    backlog_.front()->prependImuMeasurements(*dropped);
+    ++nr_dropped_frames_;
+    dropped_frames_stats.IncrementOne();
+    VLOG(1) << "Module: " << name_id_ << " - Over latency budget, dropped "
+            << "frame with timestamp: " << dropped->timestamp_;
+    LOG_EVERY_N(WARNING, 100)
+        << "Module: " << name_id_ << " - Over latency budget, dropped "
+        << nr_dropped_frames_ << " frames so far.";
+  }
+
+  input = std::move(backlog_.front());
+  backlog_.pop_front();
+  return input;
+}
+
+bool VisionImuFrontendModule::hasWork() const {
+  std::lock_guard<std::mutex> lock(backlog_mutex_);
+  return !backlog_.empty() || SIMO::hasWork();
+}
+
 }  // namespace VIO
@@ -17,6 +17,7 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include <algorithm>
 #include <string>
 #include <utility>
 
@@ -54,6 +55,32 @@ void FrontendParams::print() const {
                         max_intra_keyframe_time_ns_,
                         "minNumberFeatures_: ",
                         min_number_features_,
+                        "keyframe_only_processing_: ",
+                        keyframe_only_processing_,
+                        "adaptive_feature_budget_: ",
+                        adaptive_feature_budget_,
+                        "feature_budget_target_latency_ms: ",
+                        feature_budget_params_.target_latency_ms,
+                        "feature_budget_include_backend_: ",
+                        feature_budget_include_backend_,
+                        "use_idle_mode_: ",
+                        use_idle_mode_,
+                        "idle_max_gyro_std: ",
+                        idle_params_.max_gyro_std,
+                        "idle_max_acc_std: ",
+                        idle_params_.max_acc_std,
+                        "idle_max_disparity: ",
+                        idle_params_.max_disparity,
+                        "idle_min_duration: ",
+                        idle_params_.min_duration_s,
+                        "idle_max_keyframe_time: ",
+                        idle_params_.max_keyframe_time_s,
+                        "image_downscale_factor_: ",
+                        image_downscale_factor_,
+                        "speculative_feature_detection_: ",
+                        speculative_feature_detection_,
+                        "use_gpu_preprocessing_: ",
+                        use_gpu_preprocessing_,
                         "useStereoTracking_: ",
                         use_stereo_tracking_,
                         "max_disparity_since_lkf_: ",
@@ -98,13 +125,75 @@ bool FrontendParams::parseYAML(const std::string& filepath) {
   int min_number_features;
   yaml_parser.getYamlParam("minNumberFeatures", &min_number_features);
   min_number_features_ = static_cast<size_t>(min_number_features);
+  if (yaml_parser.hasParam("keyframe_only_processing")) {
+    yaml_parser.getYamlParam("keyframe_only_processing",
+                             &keyframe_only_processing_);
+  }
+  if (yaml_parser.hasParam("adaptive_feature_budget")) {
+    yaml_parser.getYamlParam("adaptive_feature_budget",
+                             &adaptive_feature_budget_);
+  }
+  if (yaml_parser.hasParam("feature_budget_target_latency_ms")) {
+    yaml_parser.getYamlParam("feature_budget_target_latency_ms",
+                             &feature_budget_params_.target_latency_ms);
+  }
+  if (yaml_parser.hasParam("feature_budget_min_features")) {
+    yaml_parser.getYamlParam("feature_budget_min_features",
+                             &feature_budget_params_.min_features_per_frame);
+  }
+  if (yaml_parser.hasParam("feature_budget_min_klt_max_level")) {
+    yaml_parser.getYamlParam("feature_budget_min_klt_max_level",
+                             &feature_budget_params_.min_klt_max_level);
+  }
+  if (yaml_parser.hasParam("feature_budget_min_ransac_iterations")) {
+    yaml_parser.getYamlParam("feature_budget_min_ransac_iterations",
+                             &feature_budget_params_.min_ransac_max_iterations);
+  }
+  if (yaml_parser.hasParam("feature_budget_include_backend")) {
+    yaml_parser.getYamlParam("feature_budget_include_backend",
+                             &feature_budget_include_backend_);
+  }
+  if (yaml_parser.hasParam("use_idle_mode")) {
+    yaml_parser.getYamlParam("use_idle_mode", &use_idle_mode_);
+  }
+  if (yaml_parser.hasParam("idle_max_gyro_std")) {
+    yaml_parser.getYamlParam("idle_max_gyro_std", &idle_params_.max_gyro_std);
+  }
+  if (yaml_parser.hasParam("idle_max_acc_std")) {
+    yaml_parser.getYamlParam("idle_max_acc_std", &idle_params_.max_acc_std);
+  }
+  if (yaml_parser.hasParam("idle_max_disparity")) {
+    yaml_parser.getYamlParam("idle_max_disparity",
+                             &idle_params_.max_disparity);
+  }
+  if (yaml_parser.hasParam("idle_min_duration")) {
+    yaml_parser.getYamlParam("idle_min_duration",
+                             &idle_params_.min_duration_s);
+  }
+  if (yaml_parser.hasParam("idle_max_keyframe_time")) {
+    yaml_parser.getYamlParam("idle_max_keyframe_time",
+                             &idle_params_.max_keyframe_time_s);
+  }
   yaml_parser.getYamlParam("useStereoTracking", &use_stereo_tracking_);
   yaml_parser.getYamlParam("useRANSAC", &useRANSAC_);
   yaml_parser.getYamlParam("use_2d2d_tracking", &use_2d2d_tracking_);
   yaml_parser.getYamlParam("use_3d3d_tracking", &use_3d3d_tracking_);
   yaml_parser.getYamlParam("use_pnp_tracking", &use_pnp_tracking_);
   yaml_parser.getYamlParam("max_disparity_since_lkf", &max_disparity_since_lkf_);
-  
+  if (yaml_parser.hasParam("image_downscale_factor")) {
+    yaml_parser.getYamlParam("image_downscale_factor",
+                             &image_downscale_factor_);
+    CHECK_GE(image_downscale_factor_, 1);
+    downscalePixelParams(image_downscale_factor_);
+  }
+  if (yaml_parser.hasParam("speculative_feature_detection")) {
+    yaml_parser.getYamlParam("speculative_feature_detection",
+                             &speculative_feature_detection_);
+  }
+  if (yaml_parser.hasParam("use_gpu_preprocessing")) {
+    yaml_parser.getYamlParam("use_gpu_preprocessing", &use_gpu_preprocessing_);
+  }
+
   // TODO(Toni): use yaml at some point
   visualize_feature_tracks_ = FLAGS_visualize_feature_tracks;
   visualize_frontend_images_ = FLAGS_visualize_frontend_images;
@@ -116,6 +205,38 @@ bool FrontendParams::parseYAML(const std::string& filepath) {
   return true;
 }
 
+void FrontendParams::downscalePixelParams(const int& factor) {
+  if (factor == 1) return;
+  const double scale = 1.0 / static_cast<double>(factor);
+  // Window sizes stay odd (centered templates) and at least 3 pixels.
+  const auto scale_odd = [factor](const int& size) {
+    return std::max((size / factor) | 1, 3);
+  };
+  const auto scale_int = [factor](const int& size) {
+    return std::max(size / factor, 1);
+  };
+
+  max_disparity_since_lkf_ *= scale;
+  idle_params_.max_disparity *= scale;
+
+  tracker_params_.klt_win_size_ = scale_int(tracker_params_.klt_win_size_);
+  tracker_params_.ransac_threshold_pnp_ *= scale;
+
+  feature_detector_params_.min_distance_btw_tracked_and_detected_features_ =
+      scale_int(feature_detector_params_
+                    .min_distance_btw_tracked_and_detected_features_);
+  feature_detector_params_.grid_detection_cell_border_ =
+      scale_int(feature_detector_params_.grid_detection_cell_border_);
+
+  StereoMatchingParams& stereo = stereo_matching_params_;
+  stereo.templ_cols_ = scale_odd(stereo.templ_cols_);
+  stereo.templ_rows_ = scale_odd(stereo.templ_rows_);
+  stereo.stripe_extra_rows_ = (stereo.stripe_extra_rows_ / factor) & ~1;
+  stereo.disparity_prior_margin_ = scale_int(stereo.disparity_prior_margin_);
+  stereo.klt_stereo_win_size_ = scale_int(stereo.klt_stereo_win_size_);
+  stereo.klt_stereo_max_epipolar_error_ *= scale;
+}
+
 bool FrontendParams::equals(const FrontendParams& tp2, double tol) const {
   return tracker_params_.equals(tp2.tracker_params_, tol) &&
          // stereo matching
@@ -124,7 +245,34 @@ bool FrontendParams::equals(const FrontendParams& tp2, double tol) const {
          (fabs(max_intra_keyframe_time_ns_ - tp2.max_intra_keyframe_time_ns_) <= tol) &&
          (fabs(min_intra_keyframe_time_ns_ - tp2.min_intra_keyframe_time_ns_) <= tol) &&
          (min_number_features_ == tp2.min_number_features_) &&
+         (keyframe_only_processing_ == tp2.keyframe_only_processing_) &&
+         (adaptive_feature_budget_ == tp2.adaptive_feature_budget_) &&
+         (fabs(feature_budget_params_.target_latency_ms -
+               tp2.feature_budget_params_.target_latency_ms) <= tol) &&
+         (feature_budget_params_.min_features_per_frame ==
+          tp2.feature_budget_params_.min_features_per_frame) &&
+         (feature_budget_params_.min_klt_max_level ==
+          tp2.feature_budget_params_.min_klt_max_level) &&
+         (feature_budget_params_.min_ransac_max_iterations ==
+          tp2.feature_budget_params_.min_ransac_max_iterations) &&
+         (feature_budget_include_backend_ ==
+          tp2.feature_budget_include_backend_) &&
+         (use_idle_mode_ == tp2.use_idle_mode_) &&
+         (fabs(idle_params_.max_gyro_std - tp2.idle_params_.max_gyro_std) <=
+          tol) &&
+         (fabs(idle_params_.max_acc_std - tp2.idle_params_.max_acc_std) <=
+          tol) &&
+         (fabs(idle_params_.max_disparity - tp2.idle_params_.max_disparity) <=
+          tol) &&
+         (fabs(idle_params_.min_duration_s - tp2.idle_params_.min_duration_s) <=
+          tol) &&
+         (fabs(idle_params_.max_keyframe_time_s -
+               tp2.idle_params_.max_keyframe_time_s) <= tol) &&
          (fabs(max_disparity_since_lkf_ - tp2.max_disparity_since_lkf_) <= tol) &&
+         (image_downscale_factor_ == tp2.image_downscale_factor_) &&
+         (speculative_feature_detection_ ==
+          tp2.speculative_feature_detection_) &&
+         (use_gpu_preprocessing_ == tp2.use_gpu_preprocessing_) &&
          (use_stereo_tracking_ == tp2.use_stereo_tracking_);
 }
 
@@ -39,10 +39,18 @@ void TrackerParams::print() const {
                         klt_max_level_,
                         "klt_eps_: ",
                         klt_eps_,
+                        "klt_use_cuda_: ",
+                        klt_use_cuda_,
+                        "klt_use_fixed_window_kernel_: ",
+                        klt_use_fixed_window_kernel_,
                         "max_feature_track_age_: ",
                         max_feature_track_age_,
                         "Optical Flow Predictor Type",
                         VIO::to_underlying(optical_flow_predictor_type_),
+                        "klt_max_level_with_motion_prior_: ",
+                        klt_max_level_with_motion_prior_,
+                        "klt_max_iter_with_motion_prior_: ",
+                        klt_max_iter_with_motion_prior_,
                         // RANSAC params
                         "minNrMonoInliers_: ",
                         minNrMonoInliers_,
@@ -56,12 +64,22 @@ void TrackerParams::print() const {
                         ransac_use_1point_stereo_,
                         "ransac_use_2point_mono_: ",
                         ransac_use_2point_mono_,
+                        "ransac_use_2point_fast_path_: ",
+                        ransac_use_2point_fast_path_,
+                        "ransac_2point_fallback_inlier_ratio_: ",
+                        ransac_2point_fallback_inlier_ratio_,
                         "ransac_max_iterations_: ",
                         ransac_max_iterations_,
                         "ransac_probability_: ",
                         ransac_probability_,
                         "ransac_randomize_: ",
                         ransac_randomize_,
+                        "ransac_use_parallel_engine_: ",
+                        ransac_use_parallel_engine_,
+                        "ransac_batch_size_: ",
+                        ransac_batch_size_,
+                        "ransac_preemptive_block_size_: ",
+                        ransac_preemptive_block_size_,
                         "2D2D Algorithm",
                         VIO::to_underlying(pose_2d2d_algorithm_),
                         "Optimize 2D2D Pose",
@@ -92,6 +110,13 @@ bool TrackerParams::parseYAML(const std::string& filepath) {
   CHECK_GE(klt_max_level_, 0);
   yaml_parser.getYamlParam("klt_eps", &klt_eps_);
   CHECK_GT(klt_eps_, 0);
+  if (yaml_parser.hasParam("klt_use_cuda")) {
+    yaml_parser.getYamlParam("klt_use_cuda", &klt_use_cuda_);
+  }
+  if (yaml_parser.hasParam("klt_use_fixed_window_kernel")) {
+    yaml_parser.getYamlParam("klt_use_fixed_window_kernel",
+                             &klt_use_fixed_window_kernel_);
+  }
 
   int max_feature_track_age;
   yaml_parser.getYamlParam("maxFeatureAge", &max_feature_track_age);
@@ -111,6 +136,29 @@ bool TrackerParams::parseYAML(const std::string& filepath) {
   yaml_parser.getYamlParam("ransac_use_1point_stereo",
                            &ransac_use_1point_stereo_);
   yaml_parser.getYamlParam("ransac_use_2point_mono", &ransac_use_2point_mono_);
+  if (yaml_parser.hasParam("ransac_use_2point_fast_path")) {
+    yaml_parser.getYamlParam("ransac_use_2point_fast_path",
+                             &ransac_use_2point_fast_path_);
+  }
+  if (yaml_parser.hasParam("ransac_2point_fallback_inlier_ratio")) {
+    yaml_parser.getYamlParam("ransac_2point_fallback_inlier_ratio",
+                             &ransac_2point_fallback_inlier_ratio_);
+    CHECK_GE(ransac_2point_fallback_inlier_ratio_, 0.0);
+    CHECK_LE(ransac_2point_fallback_inlier_ratio_, 1.0);
+  }
+  if (yaml_parser.hasParam("ransac_use_parallel_engine")) {
+    yaml_parser.getYamlParam("ransac_use_parallel_engine",
+                             &ransac_use_parallel_engine_);
+  }
+  if (yaml_parser.hasParam("ransac_batch_size")) {
+    yaml_parser.getYamlParam("ransac_batch_size", &ransac_batch_size_);
+    CHECK_GT(ransac_batch_size_, 0);
+  }
+  if (yaml_parser.hasParam("ransac_preemptive_block_size")) {
+    yaml_parser.getYamlParam("ransac_preemptive_block_size",
+                             &ransac_preemptive_block_size_);
+    CHECK_GE(ransac_preemptive_block_size_, 0);
+  }
 
   int pose_2d2d_algorithm;
   yaml_parser.getYamlParam("2d2d_algorithm", &pose_2d2d_algorithm);
@@ -129,6 +177,14 @@ bool TrackerParams::parseYAML(const std::string& filepath) {
   yaml_parser.getYamlParam("optical_flow_predictor_type", &optical_flow_predictor_type);
   optical_flow_predictor_type_ =
       static_cast<OpticalFlowPredictorType>(optical_flow_predictor_type);
+  if (yaml_parser.hasParam("klt_max_level_with_motion_prior")) {
+    yaml_parser.getYamlParam("klt_max_level_with_motion_prior",
+                             &klt_max_level_with_motion_prior_);
+  }
+  if (yaml_parser.hasParam("klt_max_iter_with_motion_prior")) {
+    yaml_parser.getYamlParam("klt_max_iter_with_motion_prior",
+                             &klt_max_iter_with_motion_prior_);
+  }
 
   yaml_parser.getYamlParam("disparityThreshold", &disparityThreshold_);
 
@@ -143,6 +199,8 @@ bool TrackerParams::equals(const TrackerParams& tp2, double tol) const {
          (klt_max_iter_ == tp2.klt_max_iter_) &&
          (klt_max_level_ == tp2.klt_max_level_) &&
          (fabs(klt_eps_ - tp2.klt_eps_) <= tol) &&
+         (klt_use_cuda_ == tp2.klt_use_cuda_) &&
+         (klt_use_fixed_window_kernel_ == tp2.klt_use_fixed_window_kernel_) &&
          (max_feature_track_age_ == tp2.max_feature_track_age_) &&
          // RANSAC parameters
          (minNrMonoInliers_ == tp2.minNrMonoInliers_) &&
@@ -152,11 +210,22 @@ bool TrackerParams::equals(const TrackerParams& tp2, double tol) const {
           tol) &&
          (ransac_use_1point_stereo_ == tp2.ransac_use_1point_stereo_) &&
          (ransac_use_2point_mono_ == tp2.ransac_use_2point_mono_) &&
+         (ransac_use_2point_fast_path_ == tp2.ransac_use_2point_fast_path_) &&
+         (fabs(ransac_2point_fallback_inlier_ratio_ -
+               tp2.ransac_2point_fallback_inlier_ratio_) <= tol) &&
          (ransac_max_iterations_ == tp2.ransac_max_iterations_) &&
          (fabs(ransac_probability_ - tp2.ransac_probability_) <= tol) &&
          (ransac_randomize_ == tp2.ransac_randomize_) &&
+         (ransac_use_parallel_engine_ == tp2.ransac_use_parallel_engine_) &&
+         (ransac_batch_size_ == tp2.ransac_batch_size_) &&
+         (ransac_preemptive_block_size_ ==
+          tp2.ransac_preemptive_block_size_) &&
          // others:
          (optical_flow_predictor_type_ == tp2.optical_flow_predictor_type_) &&
+         (klt_max_level_with_motion_prior_ ==
+          tp2.klt_max_level_with_motion_prior_) &&
+         (klt_max_iter_with_motion_prior_ ==
+          tp2.klt_max_iter_with_motion_prior_) &&
          (pose_2d2d_algorithm_ == tp2.pose_2d2d_algorithm_) &&
          (pnp_algorithm_ == tp2.pnp_algorithm_) &&
          (min_pnp_inliers_ == tp2.min_pnp_inliers_) &&
@@ -7,10 +7,15 @@
 #include "kimera-vio/frontend/feature-detector/FeatureDetector.h"
 
 #include <algorithm>
+#include <atomic>
 #include <numeric>
 
+#include <opencv2/core/utility.hpp>
+
 #include "kimera-vio/frontend/UndistorterRectifier.h"
+#include "kimera-vio/utils/PerfCounters.h"
 #include "kimera-vio/utils/Timer.h"
+#include "kimera-vio/utils/Tracing.h"
 #include "kimera-vio/utils/UtilsOpenCV.h"  // Just for ExtractCorners...
 
 namespace VIO {
@@ -18,8 +23,11 @@ namespace VIO {
 FeatureDetector::FeatureDetector(
     const FeatureDetectorParams& feature_detector_params)
     : feature_detector_params_(feature_detector_params),
+      max_features_per_frame_(feature_detector_params.max_features_per_frame_),
       non_max_suppression_(nullptr),
-      feature_detector_() {
+      feature_detector_(),
+      occupancy_grid_(feature_detector_params
+                          .min_distance_btw_tracked_and_detected_features_) {
   // TODO(Toni): parametrize as well whether we use bucketing or anms...
   // Right now we assume we want anms not bucketing...
   if (feature_detector_params.enable_non_max_suppression_) {
@@ -30,12 +38,36 @@ FeatureDetector::FeatureDetector(
   // pass to nonmax suppression that prunes them to
   // feature_detector_params_.max_features_per_frame_
 
+  feature_detector_ = createFeatureDetector(
+      feature_detector_params_.max_nr_keypoints_before_anms_);
+
+  if (feature_detector_params_.enable_grid_detection_) {
+    // One detector per cell: cells are processed concurrently and
+    // cv::Feature2D implementations are not guaranteed to be reentrant.
+    const int nr_cells = feature_detector_params_.grid_detection_rows_ *
+                         feature_detector_params_.grid_detection_cols_;
+    CHECK_GT(nr_cells, 0);
+    const int max_nr_keypoints_per_cell =
+        (feature_detector_params_.max_nr_keypoints_before_anms_ + nr_cells -
+         1) /
+        nr_cells;
+    grid_feature_detectors_.reserve(nr_cells);
+    for (int i = 0; i < nr_cells; ++i) {
+      grid_feature_detectors_.push_back(
+          createFeatureDetector(max_nr_keypoints_per_cell));
+    }
+  }
+}
+
+cv::Ptr<cv::Feature2D> FeatureDetector::createFeatureDetector(
+    const int& max_nr_keypoints) const {
+  cv::Ptr<cv::Feature2D> feature_detector;
   // TODO(Toni): find a way to pass params here using args lists
-  switch (feature_detector_params.feature_detector_type_) {
+  switch (feature_detector_params_.feature_detector_type_) {
     case FeatureDetectorType::FAST: {
       // Fast threshold, usually in range [10, 35]
-      feature_detector_ = cv::FastFeatureDetector::create(
-          feature_detector_params.fast_thresh_, true);
+      feature_detector = cv::FastFeatureDetector::create(
+          feature_detector_params_.fast_thresh_, true);
       break;
     }
     case FeatureDetectorType::ORB: {
@@ -52,8 +84,8 @@ FeatureDetector::FeatureDetector(
           cv::ORB::ScoreType::HARRIS_SCORE;
 #endif
       static constexpr int patch_size = 2;  // We don't use descriptors (yet).
-      feature_detector_ =
-          cv::ORB::create(feature_detector_params.max_nr_keypoints_before_anms_,
+      feature_detector =
+          cv::ORB::create(max_nr_keypoints,
                           scale_factor,
                           n_levels,
                           edge_threshold,
@@ -61,7 +93,7 @@ FeatureDetector::FeatureDetector(
                           WTA_K,
                           score_type,
                           patch_size,
-                          feature_detector_params.fast_thresh_);
+                          feature_detector_params_.fast_thresh_);
       break;
     }
     case FeatureDetectorType::AGAST: {
@@ -70,8 +102,8 @@ FeatureDetector::FeatureDetector(
     }
     case FeatureDetectorType::GFTT: {
       // goodFeaturesToTrack detector.
-      feature_detector_ = cv::GFTTDetector::create(
-          feature_detector_params.max_nr_keypoints_before_anms_,
+      feature_detector = cv::GFTTDetector::create(
+          max_nr_keypoints,
           feature_detector_params_.quality_level_,
           feature_detector_params_
               .min_distance_btw_tracked_and_detected_features_,
@@ -83,16 +115,21 @@ FeatureDetector::FeatureDetector(
     default: {
       LOG(FATAL) << "Unknown feature detector type: "
                  << VIO::to_underlying(
-                        feature_detector_params.feature_detector_type_);
+                        feature_detector_params_.feature_detector_type_);
     }
   }
+  return feature_detector;
 }
 
 // TODO(Toni) Optimize this function.
 // NOTE: for stereo cameras we pass R to ensure we rectify the versors
 // and 3D points of the features we detect.
-void FeatureDetector::featureDetection(Frame* cur_frame,
-                                       std::optional<cv::Mat> R) {
+void FeatureDetector::featureDetection(
+    Frame* cur_frame,
+    std::optional<cv::Mat> R,
+    const std::vector<cv::KeyPoint>* candidates) {
+  KIMERA_TRACE_SCOPE("FeatureDetector::featureDetection");
+  KIMERA_PERF_SCOPE("FeatureDetector::featureDetection");
   CHECK_NOTNULL(cur_frame);
 
   // Check how many new features we need: maxFeaturesPerFrame_ - n_existing
@@ -112,14 +149,15 @@ void FeatureDetector::featureDetection(Frame* cur_frame,
   // Detect new features in image.
   // detect this much new corners if possible
   int nr_corners_needed = std::max(
-      feature_detector_params_.max_features_per_frame_ - n_existing, 0);
+      max_features_per_frame_ - n_existing, 0);
   // debug_info_.need_n_corners_ = nr_corners_needed;
 
   ///////////////// FEATURE DETECTION //////////////////////
   // Actual feature detection: detects new keypoints where there are no
   // currently tracked ones
   //auto start_time_tic = utils::Timer::tic();
-  const KeypointsCV& corners = featureDetection(*cur_frame, nr_corners_needed);
+  const KeypointsCV& corners =
+      featureDetection(*cur_frame, nr_corners_needed, candidates);
   const size_t& n_corners = corners.size();
 
   // debug_info_.featureDetectionTime_ =
@@ -137,24 +175,30 @@ void FeatureDetector::featureDetection(Frame* cur_frame,
     cur_frame->scores_.reserve(new_nr_keypoints);
     cur_frame->versors_.reserve(new_nr_keypoints);
 
-    // Incremental id assigned to new landmarks
-    static LandmarkId lmk_id = 0;
-    const CameraParams& cam_param = cur_frame->cam_param_;
+    // Incremental id assigned to new landmarks, unique across detectors,
+    // which may run concurrently (e.g. one per camera): reserve the ids of
+    // all the new corners at once.
+    static std::atomic<LandmarkId> next_lmk_id(0);
+    LandmarkId lmk_id = next_lmk_id.fetch_add(n_corners);
+    BearingVectors corner_versors;
+    UndistorterRectifier::GetBearingVectors(
+        corners, cur_frame->cam_param_, &corner_versors, R);
     for (const KeypointCV& corner : corners) {
       cur_frame->landmarks_.push_back(lmk_id);
       // New keypoint, so seen in a single (key)frame so far.
       cur_frame->landmarks_age_.push_back(1u);
       cur_frame->keypoints_.push_back(corner);
       cur_frame->scores_.push_back(0.0);  // NOT IMPLEMENTED
-      cur_frame->versors_.push_back(
-          UndistorterRectifier::GetBearingVector(corner, cam_param, R));
       ++lmk_id;
     }
+    cur_frame->versors_.insert(cur_frame->versors_.end(),
+                               corner_versors.begin(),
+                               corner_versors.end());
     VLOG(10) << "featureExtraction: frame " << cur_frame->id_
              << ",  Nr tracked keypoints: " << prev_nr_keypoints
              << ",  Nr extracted keypoints: " << n_corners
              << ",  total: " << cur_frame->keypoints_.size()
-             << "  (max: " << feature_detector_params_.max_features_per_frame_
+             << "  (max: " << max_features_per_frame_
              << ")";
   } else {
     LOG(WARNING) << "No corners extracted for frame with id: "
@@ -162,17 +206,140 @@ void FeatureDetector::featureDetection(Frame* cur_frame,
   }
 }
 
+std::vector<cv::KeyPoint> FeatureDetector::filterCandidates(
+    const std::vector<cv::KeyPoint>& candidates,
+    const cv::Mat& mask,
+    const cv::Size& img_size,
+    const FeatureOccupancyGrid* occupancy_grid) {
+  const cv::Rect2f img_rect(0.0f, 0.0f, img_size.width, img_size.height);
+  std::vector<cv::KeyPoint> keypoints;
+  keypoints.reserve(candidates.size());
+  for (const cv::KeyPoint& kp : candidates) {
+    if (!img_rect.contains(kp.pt)) continue;
+    if (!mask.empty() && mask.at<uchar>(cv::Point(kp.pt)) == 0) continue;
+    if (occupancy_grid && !occupancy_grid->isFree(kp.pt)) continue;
+    keypoints.push_back(kp);
+  }
+  return keypoints;
+}
+
+std::vector<cv::KeyPoint> FeatureDetector::detectCandidates(
+    const cv::Mat& img,
+    const cv::Mat& mask,
+    const cv::Rect& roi) {
+  return feature_detector_params_.enable_grid_detection_
+             ? gridFeatureDetection(img, mask, nullptr, roi)
+             : rawFeatureDetection(img, mask, roi);
+}
+
 std::vector<cv::KeyPoint> FeatureDetector::rawFeatureDetection(
     const cv::Mat& img,
-    const cv::Mat& mask) {
+    const cv::Mat& mask,
+    const cv::Rect& roi) {
   std::vector<cv::KeyPoint> keypoints;
   CHECK(feature_detector_);
-  feature_detector_->detect(img, keypoints, mask);
+  const cv::Rect img_rect(0, 0, img.cols, img.rows);
+  const cv::Rect clipped_roi = roi.empty() ? img_rect : roi & img_rect;
+  if (clipped_roi == img_rect) {
+    feature_detector_->detect(img, keypoints, mask);
+    return keypoints;
+  }
+  if (clipped_roi.empty()) return keypoints;
+  feature_detector_->detect(img(clipped_roi),
+                            keypoints,
+                            mask.empty() ? cv::Mat() : mask(clipped_roi));
+  const cv::Point2f offset(clipped_roi.x, clipped_roi.y);
+  for (cv::KeyPoint& kp : keypoints) kp.pt += offset;
   return keypoints;
 }
 
-KeypointsCV FeatureDetector::featureDetection(const Frame& cur_frame,
-                                              const int& need_n_corners) {
+std::vector<cv::KeyPoint> FeatureDetector::gridFeatureDetection(
+    const cv::Mat& img,
+    const cv::Mat& mask,
+    const FeatureOccupancyGrid* occupancy_grid,
+    const cv::Rect& roi) {
+  CHECK(!img.empty());
+  CHECK(mask.empty() || mask.size() == img.size());
+  const int& grid_rows = feature_detector_params_.grid_detection_rows_;
+  const int& grid_cols = feature_detector_params_.grid_detection_cols_;
+  const int nr_cells = grid_rows * grid_cols;
+  CHECK_EQ(grid_feature_detectors_.size(), static_cast<size_t>(nr_cells));
+  const int max_nr_keypoints_per_cell =
+      (feature_detector_params_.max_nr_keypoints_before_anms_ + nr_cells - 1) /
+      nr_cells;
+  // Share of the features of each cell: no need to detect more there.
+  const size_t max_nr_tracked_per_cell =
+      static_cast<size_t>((max_features_per_frame_ + nr_cells - 1) / nr_cells);
+  // Cells are detected on a padded roi so that corners near the cell limits
+  // see the same neighbourhood as in a full-image detection. Only keypoints
+  // inside the (unpadded) cell are kept, so cells never share keypoints.
+  const int& border = feature_detector_params_.grid_detection_cell_border_;
+  const cv::Rect img_rect(0, 0, img.cols, img.rows);
+  const cv::Rect detection_rect = roi.empty() ? img_rect : roi & img_rect;
+
+  // Preallocated per-cell outputs: each cell writes only to its own slot,
+  // hence the merge below does not need any locking.
+  std::vector<std::vector<cv::KeyPoint>> cell_keypoints(nr_cells);
+  cv::parallel_for_(cv::Range(0, nr_cells), [&](const cv::Range& range) {
+    for (int cell_idx = range.start; cell_idx < range.end; ++cell_idx) {
+      const int r = cell_idx / grid_cols;
+      const int c = cell_idx % grid_cols;
+      const int x0 = c * img.cols / grid_cols;
+      const int y0 = r * img.rows / grid_rows;
+      // Only the part of the cell in the roi is detected.
+      const cv::Rect cell = cv::Rect(x0,
+                                     y0,
+                                     (c + 1) * img.cols / grid_cols - x0,
+                                     (r + 1) * img.rows / grid_rows - y0) &
+                            detection_rect;
+      if (cell.area() == 0) continue;
+      if (occupancy_grid &&
+          occupancy_grid->count(cell) >= max_nr_tracked_per_cell) {
+        continue;
+      }
+      const cv::Rect padded_cell =
+          cv::Rect(cell.x - border,
+                   cell.y - border,
+                   cell.width + 2 * border,
+                   cell.height + 2 * border) &
+          img_rect;
+      std::vector<cv::KeyPoint>& keypoints = cell_keypoints[cell_idx];
+      grid_feature_detectors_[cell_idx]->detect(
+          img(padded_cell),
+          keypoints,
+          mask.empty() ? cv::Mat() : mask(padded_cell));
+      // Back to image coordinates and drop keypoints of the padding, and
+      // those close to tracked features.
+      const cv::Point2f offset(padded_cell.x, padded_cell.y);
+      const cv::Rect2f cell_f(cell);
+      size_t n_kept = 0u;
+      for (cv::KeyPoint& kp : keypoints) {
+        kp.pt += offset;
+        if (cell_f.contains(kp.pt) &&
+            (!occupancy_grid || occupancy_grid->isFree(kp.pt))) {
+          keypoints[n_kept++] = kp;
+        }
+      }
+      keypoints.resize(n_kept);
+      // Per-cell budget (FAST does not bound the number of detections).
+      cv::KeyPointsFilter::retainBest(keypoints, max_nr_keypoints_per_cell);
+    }
+  });
+
+  size_t n_keypoints = 0u;
+  for (const auto& keypoints : cell_keypoints) n_keypoints += keypoints.size();
+  std::vector<cv::KeyPoint> keypoints;
+  keypoints.reserve(n_keypoints);
+  for (const auto& cell : cell_keypoints) {
+    keypoints.insert(keypoints.end(), cell.begin(), cell.end());
+  }
+  return keypoints;
+}
+
+KeypointsCV FeatureDetector::featureDetection(
+    const Frame& cur_frame,
+    const int& need_n_corners,
+    const std::vector<cv::KeyPoint>* candidates) {
   // cv::namedWindow("Input Image", cv::WINDOW_AUTOSIZE);
   // cv::imshow("Input Image", cur_frame.img_);
 
@@ -182,29 +349,75 @@ KeypointsCV FeatureDetector::featureDetection(const Frame& cur_frame,
   // longer good quality or visible early on if they don't have detected
   // keypoints nearby by! The mask is interpreted as: 255 -> consider, 0 ->
   // don't consider.
-  cv::Mat mask;
-  if (cur_frame.detection_mask_.empty()) {
-    mask = cv::Mat(cur_frame.img_.size(), CV_8U, cv::Scalar(255));
-  } else {
-    mask = cur_frame.detection_mask_;
+  // The static region of interest of the camera restricts the detection mask
+  // of the frame (if any), and bounds the detection.
+  const CameraParams& cam_param = cur_frame.cam_param_;
+  cv::Mat detection_mask = cur_frame.detection_mask_;
+  if (cam_param.hasRoiMask()) {
+    if (detection_mask.empty()) {
+      detection_mask = cam_param.roi_mask_;
+    } else {
+      cv::Mat combined_mask;
+      cv::bitwise_and(detection_mask, cam_param.roi_mask_, combined_mask);
+      detection_mask = combined_mask;
+    }
   }
+  const cv::Rect& roi = cam_param.roi_bbox_;
 
-  for (size_t i = 0u; i < cur_frame.keypoints_.size(); ++i) {
-    if (cur_frame.landmarks_.at(i) != -1) {
-      // Only mask keypoints that are being triangulated (I guess
-      // feature tracks? should be made more explicit)
-      cv::circle(mask,
-                 cur_frame.keypoints_.at(i),
-                 feature_detector_params_
-                     .min_distance_btw_tracked_and_detected_features_,
-                 cv::Scalar(0),
-                 CV_FILLED);
+  std::vector<cv::KeyPoint> keypoints;
+  if (feature_detector_params_.enable_occupancy_grid_) {
+    // Tracked keypoints go to the occupancy grid, which then filters the
+    // detections: no full resolution mask to allocate and draw.
+    occupancy_grid_.reset(cur_frame.img_.size());
+    for (size_t i = 0u; i < cur_frame.keypoints_.size(); ++i) {
+      if (cur_frame.landmarks_.at(i) != -1) {
+        occupancy_grid_.add(cur_frame.keypoints_.at(i));
+      }
+    }
+    const cv::Mat& mask = detection_mask;
+    if (candidates) {
+      // Already detected: only keep those away from the tracked features.
+      keypoints = filterCandidates(
+          *candidates, mask, cur_frame.img_.size(), &occupancy_grid_);
+    } else if (feature_detector_params_.enable_grid_detection_) {
+      keypoints =
+          gridFeatureDetection(cur_frame.img_, mask, &occupancy_grid_, roi);
+    } else {
+      keypoints = rawFeatureDetection(cur_frame.img_, mask, roi);
+      size_t n_kept = 0u;
+      for (const cv::KeyPoint& kp : keypoints) {
+        if (occupancy_grid_.isFree(kp.pt)) keypoints[n_kept++] = kp;
+      }
+      keypoints.resize(n_kept);
+    }
+  } else {
+    // Drawn on below: the frame's and the camera's masks are not modified.
+    cv::Mat mask;
+    if (detection_mask.empty()) {
+      mask = cv::Mat(cur_frame.img_.size(), CV_8U, cv::Scalar(255));
+    } else {
+      mask = detection_mask.clone();
     }
-  }
 
-  // Actual raw feature detection
-  std::vector<cv::KeyPoint> keypoints =
-      rawFeatureDetection(cur_frame.img_, mask);
+    for (size_t i = 0u; i < cur_frame.keypoints_.size(); ++i) {
+      if (cur_frame.landmarks_.at(i) != -1) {
+        // Only mask keypoints that are being triangulated (I guess
+        // feature tracks? should be made more explicit)
+        cv::circle(mask,
+                   cur_frame.keypoints_.at(i),
+                   feature_detector_params_
+                       .min_distance_btw_tracked_and_detected_features_,
+                   cv::Scalar(0),
+                   CV_FILLED);
+      }
+    }
+
+    // Actual raw feature detection, unless already done.
+    keypoints =
+        candidates
+            ? filterCandidates(*candidates, mask, cur_frame.img_.size())
+            : detectCandidates(cur_frame.img_, mask, roi);
+  }
   VLOG(1) << "Number of points detected : " << keypoints.size();
 
   /*{
@@ -223,6 +436,14 @@ KeypointsCV FeatureDetector::featureDetection(const Frame& cur_frame,
   // Tolerance of the number of returned points in percentage.
   std::vector<cv::KeyPoint>& max_keypoints = keypoints;
   if (non_max_suppression_) {
+    KeypointsCV tracked_keypoints;
+    tracked_keypoints.reserve(cur_frame.keypoints_.size());
+    for (size_t i = 0u; i < cur_frame.keypoints_.size(); ++i) {
+      if (cur_frame.landmarks_.at(i) != -1) {
+        tracked_keypoints.push_back(cur_frame.keypoints_.at(i));
+      }
+    }
+    non_max_suppression_->setTrackedKeypoints(tracked_keypoints);
     static constexpr float tolerance = 0.1;
     max_keypoints = non_max_suppression_->suppressNonMax(
         keypoints,
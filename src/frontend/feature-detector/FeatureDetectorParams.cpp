@@ -86,6 +86,16 @@ void FeatureDetectorParams::print() const {
                         nr_horizontal_bins_,
                         "Nr of vertical bins for feature binning",
                         nr_vertical_bins_,
+                        "Enable grid detection",
+                        enable_grid_detection_,
+                        "Grid detection rows",
+                        grid_detection_rows_,
+                        "Grid detection cols",
+                        grid_detection_cols_,
+                        "Grid detection cell border",
+                        grid_detection_cell_border_,
+                        "Enable occupancy grid",
+                        enable_occupancy_grid_,
                         "quality_level_: ",
                         quality_level_,
                         "block_size_: ",
@@ -169,6 +179,10 @@ bool FeatureDetectorParams::parseYAML(const std::string& filepath) {
       non_max_suppression_type_ = AnmsAlgorithmType::Binning;
       break;
     }
+    case VIO::to_underlying(AnmsAlgorithmType::Incremental): {
+      non_max_suppression_type_ = AnmsAlgorithmType::Incremental;
+      break;
+    }
     default: {
       LOG(FATAL) << "Unknown Non Maximum Suppression Type: "
                  << non_max_suppression_type;
@@ -207,6 +221,29 @@ bool FeatureDetectorParams::parseYAML(const std::string& filepath) {
     }
   }
 
+  // Grid (tiled) detection params
+  if (yaml_parser.hasParam("enable_grid_detection")) {
+    yaml_parser.getYamlParam("enable_grid_detection", &enable_grid_detection_);
+  }
+  if (yaml_parser.hasParam("grid_detection_rows")) {
+    yaml_parser.getYamlParam("grid_detection_rows", &grid_detection_rows_);
+  }
+  if (yaml_parser.hasParam("grid_detection_cols")) {
+    yaml_parser.getYamlParam("grid_detection_cols", &grid_detection_cols_);
+  }
+  if (yaml_parser.hasParam("grid_detection_cell_border")) {
+    yaml_parser.getYamlParam("grid_detection_cell_border",
+                             &grid_detection_cell_border_);
+  }
+  if (yaml_parser.hasParam("enable_occupancy_grid")) {
+    yaml_parser.getYamlParam("enable_occupancy_grid", &enable_occupancy_grid_);
+  }
+  if (enable_grid_detection_) {
+    CHECK_GT(grid_detection_rows_, 0);
+    CHECK_GT(grid_detection_cols_, 0);
+    CHECK_GE(grid_detection_cell_border_, 0);
+  }
+
   // GFTT specific parameters
   yaml_parser.getYamlParam("quality_level", &quality_level_);
   yaml_parser.getYamlParam("min_distance",
@@ -237,6 +274,11 @@ bool FeatureDetectorParams::equals(const FeatureDetectorParams& tp2,
          (fabs(max_nr_keypoints_before_anms_ -
                tp2.max_nr_keypoints_before_anms_) <= tol) &&
          (fabs(nr_vertical_bins_ - tp2.nr_vertical_bins_) <= tol) &&
+         (enable_grid_detection_ == tp2.enable_grid_detection_) &&
+         (grid_detection_rows_ == tp2.grid_detection_rows_) &&
+         (grid_detection_cols_ == tp2.grid_detection_cols_) &&
+         (grid_detection_cell_border_ == tp2.grid_detection_cell_border_) &&
+         (enable_occupancy_grid_ == tp2.enable_occupancy_grid_) &&
          (fabs(quality_level_ - tp2.quality_level_) <= tol) &&
          (block_size_ == tp2.block_size_) &&
          (use_harris_corner_detector_ == tp2.use_harris_corner_detector_) &&
@@ -0,0 +1,95 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   FeatureOccupancyGrid.cpp
+ * @brief  Coarse grid of the tracked keypoints, to reject detections close to
+ * them without drawing a full resolution mask.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/frontend/feature-detector/FeatureOccupancyGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+FeatureOccupancyGrid::FeatureOccupancyGrid(const int& min_distance)
+    : min_distance_(min_distance),
+      cell_size_(min_distance > 0 ? min_distance : 32),
+      cells_() {}
+
+void FeatureOccupancyGrid::reset(const cv::Size& img_size) {
+  CHECK_GT(img_size.width, 0);
+  CHECK_GT(img_size.height, 0);
+  grid_cols_ = (img_size.width + cell_size_ - 1) / cell_size_;
+  grid_rows_ = (img_size.height + cell_size_ - 1) / cell_size_;
+  const size_t nr_cells = static_cast<size_t>(grid_cols_ * grid_rows_);
+  // clear() keeps the capacity of the cells.
+  if (cells_.size() != nr_cells) cells_.resize(nr_cells);
+  for (KeypointsCV& cell : cells_) cell.clear();
+  nr_keypoints_ = 0u;
+}
+
+int FeatureOccupancyGrid::cellX(const float& x) const {
+  return std::min(std::max(static_cast<int>(std::floor(x / cell_size_)), 0),
+                  grid_cols_ - 1);
+}
+
+int FeatureOccupancyGrid::cellY(const float& y) const {
+  return std::min(std::max(static_cast<int>(std::floor(y / cell_size_)), 0),
+                  grid_rows_ - 1);
+}
+
+void FeatureOccupancyGrid::add(const KeypointCV& keypoint) {
+  CHECK(!cells_.empty()) << "Call reset first.";
+  cells_[cellIndex(cellX(keypoint.x), cellY(keypoint.y))].push_back(keypoint);
+  ++nr_keypoints_;
+}
+
+bool FeatureOccupancyGrid::isFree(const KeypointCV& keypoint) const {
+  if (min_distance_ <= 0 || nr_keypoints_ == 0u) return true;
+  // Cells are min_distance_ wide: only the neighbouring cells can have
+  // keypoints closer than min_distance_.
+  const int cell_x = cellX(keypoint.x);
+  const int cell_y = cellY(keypoint.y);
+  const float min_distance_sq =
+      static_cast<float>(min_distance_) * static_cast<float>(min_distance_);
+  for (int y = std::max(cell_y - 1, 0);
+       y <= std::min(cell_y + 1, grid_rows_ - 1);
+       ++y) {
+    for (int x = std::max(cell_x - 1, 0);
+         x <= std::min(cell_x + 1, grid_cols_ - 1);
+         ++x) {
+      for (const KeypointCV& occupied : cells_[cellIndex(x, y)]) {
+        const KeypointCV diff = occupied - keypoint;
+        if (diff.dot(diff) <= min_distance_sq) return false;
+      }
+    }
+  }
+  return true;
+}
+
+size_t FeatureOccupancyGrid::count(const cv::Rect& rect) const {
+  if (nr_keypoints_ == 0u || rect.area() == 0) return 0u;
+  const cv::Rect2f rect_f(rect);
+  size_t nr_keypoints = 0u;
+  for (int y = cellY(rect.y); y <= cellY(rect.y + rect.height - 1); ++y) {
+    for (int x = cellX(rect.x); x <= cellX(rect.x + rect.width - 1); ++x) {
+      for (const KeypointCV& occupied : cells_[cellIndex(x, y)]) {
+        if (rect_f.contains(occupied)) ++nr_keypoints;
+      }
+    }
+  }
+  return nr_keypoints;
+}
+
+}  // namespace VIO
@@ -28,7 +28,10 @@ namespace VIO {
 
 AdaptiveNonMaximumSuppression::AdaptiveNonMaximumSuppression(
     const AnmsAlgorithmType& anms_algorithm_type)
-    : NonMaximumSuppression(), anms_algorithm_type_(anms_algorithm_type){};
+    : NonMaximumSuppression(),
+      anms_algorithm_type_(anms_algorithm_type),
+      tracked_keypoints_(),
+      incremental_radius_(0.0f){};
 
 std::vector<cv::KeyPoint> AdaptiveNonMaximumSuppression::suppressNonMax(
     const std::vector<cv::KeyPoint>& keyPoints,
@@ -110,6 +113,13 @@ std::vector<cv::KeyPoint> AdaptiveNonMaximumSuppression::suppressNonMax(
                           binning_mask);
       break;
     };
+    case AnmsAlgorithmType::Incremental: {
+      VLOG(1) << "Running Incremental: "
+              << VIO::to_underlying(anms_algorithm_type_);
+      keypoints =
+          incremental(keyPointsSorted, numRetPoints, tolerance, cols, rows);
+      break;
+    };
     default: {
       VLOG(1) << "Unknown ANMS algorithm requested: "
               << VIO::to_underlying(anms_algorithm_type_);
@@ -168,4 +178,81 @@ std::vector<cv::KeyPoint> AdaptiveNonMaximumSuppression::binning(
   return binnedKpts;
 }
 
+// ---------------------------------------------------------------------------------
+std::vector<cv::KeyPoint> AdaptiveNonMaximumSuppression::incremental(
+    const std::vector<cv::KeyPoint>& keyPoints,
+    const int& numRetPoints,
+    const float& tolerance,
+    const int& cols,
+    const int& rows) {
+  CHECK_GT(cols, 0);
+  CHECK_GT(rows, 0);
+  if (numRetPoints <= 0) return std::vector<cv::KeyPoint>();
+  if (static_cast<size_t>(numRetPoints) >= keyPoints.size()) {
+    return keyPoints;
+  }
+
+  // Cold start: radius such that tracked + new keypoints tile the image.
+  const float n_total =
+      static_cast<float>(numRetPoints + tracked_keypoints_.size());
+  if (incremental_radius_ <= 0.0f) {
+    incremental_radius_ = 0.5f * std::sqrt(cols * rows / n_total);
+  }
+
+  // Keypoints are accepted greedily in decreasing order of response, and each
+  // accepted keypoint (tracked or new) covers a square of half-size radius
+  // on a grid of cells of size radius / 2.
+  static constexpr int kMaxPasses = 8;
+  static constexpr float kShrinkFactor = 0.75f;
+  static constexpr float kGrowFactor = 1.1f;
+  const size_t min_nr_points =
+      static_cast<size_t>(std::floor(numRetPoints * (1.0f - tolerance)));
+  std::vector<cv::KeyPoint> result;
+  result.reserve(numRetPoints);
+  bool saturated = false;
+  for (int pass = 0; pass < kMaxPasses; ++pass) {
+    const float radius = incremental_radius_;
+    const float cell_size = std::max(radius / 2.0f, 1.0f);
+    const int grid_cols = static_cast<int>(std::ceil(cols / cell_size)) + 1;
+    const int grid_rows = static_cast<int>(std::ceil(rows / cell_size)) + 1;
+    const int cover = static_cast<int>(std::ceil(radius / cell_size));
+    cv::Mat covered = cv::Mat::zeros(grid_rows, grid_cols, CV_8U);
+    auto cover_cells = [&](const cv::Point2f& pt) {
+      const int c = static_cast<int>(pt.x / cell_size);
+      const int r = static_cast<int>(pt.y / cell_size);
+      const cv::Rect square =
+          cv::Rect(c - cover, r - cover, 2 * cover + 1, 2 * cover + 1) &
+          cv::Rect(0, 0, grid_cols, grid_rows);
+      if (square.area() > 0) covered(square).setTo(1);
+    };
+    for (const KeypointCV& tracked_kpt : tracked_keypoints_) {
+      cover_cells(tracked_kpt);
+    }
+
+    result.clear();
+    saturated = false;
+    for (const cv::KeyPoint& kpt : keyPoints) {
+      const int c = static_cast<int>(kpt.pt.x / cell_size);
+      const int r = static_cast<int>(kpt.pt.y / cell_size);
+      if (r < 0 || c < 0 || r >= grid_rows || c >= grid_cols) continue;
+      if (covered.at<uint8_t>(r, c)) continue;
+      result.push_back(kpt);
+      cover_cells(kpt.pt);
+      if (result.size() == static_cast<size_t>(numRetPoints)) {
+        saturated = true;
+        break;
+      }
+    }
+
+    if (result.size() >= min_nr_points || incremental_radius_ <= 1.0f) break;
+    incremental_radius_ = std::max(incremental_radius_ * kShrinkFactor, 1.0f);
+  }
+
+  // We ran out of budget before looking at all candidates: spread the
+  // features more on the next keyframe.
+  if (saturated) incremental_radius_ *= kGrowFactor;
+  VLOG(5) << "Incremental ANMS radius: " << incremental_radius_;
+  return result;
+}
+
 }  // namespace VIO
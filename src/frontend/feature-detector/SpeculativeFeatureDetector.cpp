@@ -0,0 +1,101 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   SpeculativeFeatureDetector.cpp
+ * @brief  Detects feature candidates in non-keyframes on a worker thread, for
+ * the next keyframe to reuse them.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/frontend/feature-detector/SpeculativeFeatureDetector.h"
+
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
+#include <glog/logging.h>
+
+#include "kimera-vio/utils/Tracing.h"
+
+namespace VIO {
+
+SpeculativeFeatureDetector::SpeculativeFeatureDetector(
+    const FeatureDetectorParams& params)
+    : feature_detector_(params), detection_(), keypoints_(), landmarks_() {}
+
+SpeculativeFeatureDetector::~SpeculativeFeatureDetector() { reset(); }
+
+void SpeculativeFeatureDetector::launch(const Frame& frame) {
+  if (detection_.valid() &&
+      detection_.wait_for(std::chrono::seconds(0)) !=
+          std::future_status::ready) {
+    // Still detecting the previous frame, whose candidates stay usable.
+    return;
+  }
+  CHECK(!frame.img_.empty());
+  keypoints_ = frame.keypoints_;
+  landmarks_ = frame.landmarks_;
+  // The image is shared, not copied: frame images are never modified.
+  // The whole region of interest is detected, the keyframe masks its tracked
+  // features.
+  const cv::Mat img = frame.img_;
+  const cv::Rect roi = frame.cam_param_.roi_bbox_;
+  detection_ = std::async(std::launch::async, [this, img, roi]() {
+    KIMERA_TRACE_SCOPE("SpeculativeFeatureDetector::detectCandidates");
+    return feature_detector_.detectCandidates(img, cv::Mat(), roi);
+  });
+}
+
+bool SpeculativeFeatureDetector::takeCandidates(
+    const Frame& keyframe,
+    std::vector<cv::KeyPoint>* candidates) {
+  CHECK_NOTNULL(candidates)->clear();
+  if (!detection_.valid()) return false;
+  *candidates = detection_.get();
+
+  // Displacement of the features tracked from the launched frame.
+  std::unordered_map<LandmarkId, KeypointCV> launched_keypoints;
+  launched_keypoints.reserve(landmarks_.size());
+  for (size_t i = 0u; i < landmarks_.size(); ++i) {
+    if (landmarks_[i] != -1) launched_keypoints[landmarks_[i]] = keypoints_[i];
+  }
+  std::vector<float> dx;
+  std::vector<float> dy;
+  dx.reserve(launched_keypoints.size());
+  dy.reserve(launched_keypoints.size());
+  for (size_t i = 0u; i < keyframe.landmarks_.size(); ++i) {
+    const auto it = launched_keypoints.find(keyframe.landmarks_[i]);
+    if (it == launched_keypoints.end()) continue;
+    dx.push_back(keyframe.keypoints_[i].x - it->second.x);
+    dy.push_back(keyframe.keypoints_[i].y - it->second.y);
+  }
+  if (dx.size() < kMinNrCommonFeatures) {
+    VLOG(2) << "Dropping speculative candidates: only " << dx.size()
+            << " features in common with the keyframe.";
+    candidates->clear();
+    return false;
+  }
+
+  // Median, robust to the features tracked on moving objects.
+  const size_t median = dx.size() / 2u;
+  std::nth_element(dx.begin(), dx.begin() + median, dx.end());
+  std::nth_element(dy.begin(), dy.begin() + median, dy.end());
+  const cv::Point2f displacement(dx[median], dy[median]);
+  for (cv::KeyPoint& candidate : *candidates) candidate.pt += displacement;
+  return true;
+}
+
+void SpeculativeFeatureDetector::reset() {
+  if (detection_.valid()) detection_.wait();
+  detection_ = std::future<std::vector<cv::KeyPoint>>();
+  keypoints_.clear();
+  landmarks_.clear();
+}
+
+}  // namespace VIO
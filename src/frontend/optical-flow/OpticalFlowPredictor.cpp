@@ -20,6 +20,7 @@
 #include <gtsam/geometry/Rot3.h>
 
 #include "kimera-vio/frontend/optical-flow/OpticalFlowVisualizer.h"
+#include "kimera-vio/utils/SimdKernels.h"
 #include "kimera-vio/utils/UtilsOpenCV.h"
 
 namespace VIO {
@@ -32,12 +33,59 @@ bool NoOpticalFlowPredictor::predictSparseFlow(
   return true;
 }
 
+namespace {
+
+//! Fixed-point iterations of the radial undistortion, as in the warp kernel.
+constexpr int kUndistortIterations = 8;
+
+inline bool isDistorted(const cv::Vec2f& radial_distortion) {
+  return radial_distortion[0] != 0.0f || radial_distortion[1] != 0.0f;
+}
+
+inline float radialDistortionFactor(const cv::Vec2f& radial_distortion,
+                                    const float& x,
+                                    const float& y) {
+  const float r2 = x * x + y * y;
+  return 1.0f + r2 * (radial_distortion[0] + r2 * radial_distortion[1]);
+}
+
+//! Undistorted bearing vector (x, y, 1) of a keypoint.
+cv::Vec3f keypointToBearing(const KeypointCV& kpt,
+                            const cv::Matx33f& K_inverse,
+                            const cv::Vec2f& radial_distortion) {
+  const cv::Vec3f distorted = K_inverse * cv::Vec3f(kpt.x, kpt.y, 1.0f);
+  if (!isDistorted(radial_distortion)) return distorted;
+  float x = distorted[0];
+  float y = distorted[1];
+  for (int k = 0; k < kUndistortIterations; ++k) {
+    const float factor = radialDistortionFactor(radial_distortion, x, y);
+    x = distorted[0] / factor;
+    y = distorted[1] / factor;
+  }
+  return cv::Vec3f(x, y, 1.0f);
+}
+
+//! Distorted keypoint of a point in front of the camera.
+KeypointCV pointToKeypoint(const cv::Vec3f& point,
+                           const cv::Matx33f& K,
+                           const cv::Vec2f& radial_distortion) {
+  const float x = point[0] / point[2];
+  const float y = point[1] / point[2];
+  const float factor = radialDistortionFactor(radial_distortion, x, y);
+  const cv::Vec3f kpt = K * cv::Vec3f(x * factor, y * factor, 1.0f);
+  return KeypointCV(kpt[0], kpt[1]);
+}
+
+}  // namespace
+
 RotationalOpticalFlowPredictor::RotationalOpticalFlowPredictor(
     const cv::Matx33f& K,
-    const cv::Size& img_size)
+    const cv::Size& img_size,
+    const cv::Vec2f& radial_distortion)
     : K_(K),
       K_inverse_(K.inv()),
-      img_size_(0.0f, 0.0f, img_size.width, img_size.height) {}
+      img_size_(0.0f, 0.0f, img_size.width, img_size.height),
+      radial_distortion_(radial_distortion) {}
 
 cv::Mat RotationalOpticalFlowPredictor::predictDenseFlow(
     const gtsam::Rot3& cam1_R_cam2) {
@@ -86,42 +134,91 @@ bool RotationalOpticalFlowPredictor::predictSparseFlow(
 
   // R is a relative rotation which takes a vector from the last frame to
   // the current frame.
-  cv::Matx33f R = UtilsOpenCV::gtsamMatrix3ToCvMat(cam1_R_cam2.matrix());
+  const cv::Matx33f R =
+      UtilsOpenCV::gtsamMatrix3ToCvMat(cam1_R_cam2.matrix());
   // Get bearing vector for kpt, rotate knowing frame to frame rotation,
-  // get keypoints again
-  cv::Matx33f H = K_ * R.t() * K_inverse_;
+  // get keypoints again. With distortion, the kernel maps the keypoints to
+  // and from undistorted bearing vectors itself.
+  const bool distorted = isDistorted(radial_distortion_);
+  const cv::Matx33f H = distorted ? R.t() : K_ * R.t() * K_inverse_;
+  utils::PointWarp warp;
+  for (int i = 0; i < 9; ++i) warp.H[i] = H.val[i];
+  if (distorted) {
+    warp.k1 = radial_distortion_[0];
+    warp.k2 = radial_distortion_[1];
+    warp.fx = K_(0, 0);
+    warp.fy = K_(1, 1);
+    warp.cx = K_(0, 2);
+    warp.cy = K_(1, 2);
+  }
+  // Keypoints leaving the image keep their previous position.
+  warp.width = img_size_.width;
+  warp.height = img_size_.height;
+
+  // The warp is per keypoint, hence it can be done in place if next_kps is
+  // pointing to prev_kps.
+  static_assert(sizeof(KeypointCV) == 2u * sizeof(float),
+                "Keypoints are warped as interleaved (x, y) floats.");
+  const size_t n_kps = prev_kps.size();
+  next_kps->resize(n_kps);
+  utils::SimdKernels::get().warp_points(
+      reinterpret_cast<const float*>(prev_kps.data()),
+      warp,
+      static_cast<int>(n_kps),
+      reinterpret_cast<float*>(next_kps->data()));
+  return true;
+}
+
+RotoTranslationalOpticalFlowPredictor::RotoTranslationalOpticalFlowPredictor(
+    const cv::Matx33f& K,
+    const cv::Size& img_size,
+    const cv::Vec2f& radial_distortion)
+    : RotationalOpticalFlowPredictor(K, img_size, radial_distortion) {}
 
-  // We use a new object in case next_kps is pointing to prev_kps!
-  KeypointsCV predicted_kps;
-  const size_t& n_kps = prev_kps.size();
-  predicted_kps.reserve(n_kps);
+bool RotoTranslationalOpticalFlowPredictor::predictSparseFlow(
+    const KeypointsCV& prev_kps,
+    const gtsam::Pose3& cam1_P_cam2,
+    const std::vector<double>& prev_depths,
+    KeypointsCV* next_kps) {
+  CHECK_NOTNULL(next_kps);
+  CHECK_EQ(prev_kps.size(), prev_depths.size());
+
+  // The rotational prediction is written straight into next_kps, hence keep
+  // a copy of the previous keypoints if next_kps is pointing to prev_kps.
+  KeypointsCV prev_kps_copy;
+  if (next_kps == &prev_kps) prev_kps_copy = prev_kps;
+  const KeypointsCV& ref_kps = next_kps == &prev_kps ? prev_kps_copy : prev_kps;
+
+  // Rotation-only prediction, kept for keypoints without depth.
+  CHECK(RotationalOpticalFlowPredictor::predictSparseFlow(
+      ref_kps, cam1_P_cam2.rotation(), next_kps));
+  CHECK_EQ(next_kps->size(), ref_kps.size());
+
+  // X_cam2 = R^T * (X_cam1 - t), with X_cam1 = d * [x y 1]^T, the undistorted
+  // bearing vector of the keypoint.
+  const cv::Matx33f R =
+      UtilsOpenCV::gtsamMatrix3ToCvMat(cam1_P_cam2.rotation().matrix());
+  const cv::Matx33f Rt = R.t();
+  const gtsam::Point3& t = cam1_P_cam2.translation();
+  const cv::Vec3f Rt_t = Rt * cv::Vec3f(t.x(), t.y(), t.z());
+
+  const size_t& n_kps = ref_kps.size();
   for (size_t i = 0u; i < n_kps; ++i) {
-    // Create homogeneous keypoints.
-    const KeypointCV& prev_kpt = prev_kps[i];
-    cv::Vec3f p1(prev_kpt.x, prev_kpt.y, 1.0f);
-
-    cv::Vec3f p2 = H * p1;
-
-    // Project predicted bearing vectors to 2D again and re-homogenize.
-    KeypointCV new_kpt;
-    if (p2[2] > 0.0f) {
-      new_kpt = KeypointCV(p2[0] / p2[2], p2[1] / p2[2]);
-    } else {
-      LOG(WARNING) << "Landmark behind the camera:\n"
-                   << "- p1: " << p1 << '\n'
-                   << "- p2: " << p2;
-      new_kpt = prev_kpt;
+    const float depth = static_cast<float>(prev_depths[i]);
+    if (depth <= 0.0f) continue;
+    const KeypointCV& prev_kpt = ref_kps[i];
+    const cv::Vec3f X_cam1 =
+        depth * keypointToBearing(prev_kpt, K_inverse_, radial_distortion_);
+    const cv::Vec3f X_cam2 = Rt * X_cam1 - Rt_t;
+    if (X_cam2[2] <= 0.0f) {
+      // Landmark behind the second camera: no sensible prediction.
+      (*next_kps)[i] = prev_kpt;
+      continue;
     }
+    const KeypointCV new_kpt = pointToKeypoint(X_cam2, K_, radial_distortion_);
     // Check that keypoints remain inside the image boundaries!
-    if (img_size_.contains(new_kpt)) {
-      predicted_kps.push_back(new_kpt);
-    } else {
-      // Otw copy-paste previous keypoint.
-      predicted_kps.push_back(prev_kpt);
-    }
+    (*next_kps)[i] = img_size_.contains(new_kpt) ? new_kpt : prev_kpt;
   }
-
-  *next_kps = predicted_kps;
   return true;
 }
 
@@ -151,25 +151,79 @@ void ImuFrontend::initializeImuFrontend(const ImuBias& imu_bias) {
   }
 }
 
+namespace {
+
+/* -------------------------------------------------------------------------- */
+// Integration interval (in seconds) of each consecutive pair of Imu
+// measurements, computed and checked for the whole batch at once.
+Eigen::RowVectorXd computeImuDeltas(const ImuStampS& imu_stamps) {
+  const Eigen::Index nr_deltas = imu_stamps.cols() - 1;
+  const Eigen::RowVectorXd delta_ts =
+      (imu_stamps.rightCols(nr_deltas) - imu_stamps.leftCols(nr_deltas))
+          .cast<double>() *
+      1e-9;
+  CHECK((delta_ts.array() > 0.0).all()) << "Imu delta is 0!";
+  return delta_ts;
+}
+
+/* -------------------------------------------------------------------------- */
+// Product of the exponential maps of the columns of thetas, i.e. the rotation
+// preintegrated by gtsam::PreintegratedAhrsMeasurements. The rotation vectors
+// are converted to unit quaternions all at once, so that only the quaternion
+// products remain sequential.
+gtsam::Rot3 composeRotationIncrements(
+    const Eigen::Matrix<double, 3, Eigen::Dynamic>& thetas) {
+  const Eigen::ArrayXd angles = thetas.colwise().norm().transpose().array();
+  const Eigen::ArrayXd half_angles = 0.5 * angles;
+  // sin(angle / 2) / angle, with its Taylor expansion for small angles.
+  const Eigen::ArrayXd sinc_half =
+      (angles > 1e-5)
+          .select(half_angles.sin() / angles.max(1e-5),
+                  0.5 - angles.square() / 48.0);
+  const Eigen::ArrayXd cos_half = half_angles.cos();
+  Eigen::Quaterniond delta_q = Eigen::Quaterniond::Identity();
+  for (Eigen::Index i = 0; i < thetas.cols(); ++i) {
+    const Eigen::Vector3d vec = sinc_half(i) * thetas.col(i);
+    delta_q *= Eigen::Quaterniond(cos_half(i), vec.x(), vec.y(), vec.z());
+  }
+  delta_q.normalize();
+  return gtsam::Rot3(delta_q);
+}
+
+}  // namespace
+
 /* -------------------------------------------------------------------------- */
-// NOT THREAD-SAFE
-// What happens if someone updates the bias in the middle of the
-// preintegration??
+// THREAD-SAFE: the bias updated in the middle of the preintegration is only
+// used after the next resetIntegrationWithCachedBias.
 ImuFrontend::PimPtr ImuFrontend::preintegrateImuMeasurements(
     const ImuStampS& imu_stamps,
     const ImuAccGyrS& imu_accgyr) {
+  std::lock_guard<std::mutex> pim_lock(pim_mutex_);
   CHECK(pim_) << "Pim not initialized.";
   CHECK(imu_stamps.cols() >= 2) << "No Imu data found.";
   CHECK(imu_accgyr.cols() >= 2) << "No Imu data found.";
-  for (int i = 0; i < imu_stamps.cols() - 1; ++i) {
-    const gtsam::Vector3& measured_acc = imu_accgyr.block<3, 1>(0, i);
-    const gtsam::Vector3& measured_omega = imu_accgyr.block<3, 1>(3, i);
-    const double& delta_t =
-        UtilsNumerical::NsecToSec(imu_stamps(i + 1) - imu_stamps(i));
-    CHECK_GT(delta_t, 0.0) << "Imu delta is 0!";
-    // TODO Shouldn't we use pim_->integrateMeasurements(); for less code
-    // and efficiency??
-    pim_->integrateMeasurement(measured_acc, measured_omega, delta_t);
+  const Eigen::RowVectorXd delta_ts = computeImuDeltas(imu_stamps);
+  const Eigen::Index nr_deltas = delta_ts.cols();
+  switch (imu_params_.imu_preintegration_type_) {
+    case ImuPreintegrationType::kPreintegratedImuMeasurements: {
+      // Integrate the whole batch in one call.
+      auto* regular_pim =
+          dynamic_cast<gtsam::PreintegratedImuMeasurements*>(pim_.get());
+      CHECK_NOTNULL(regular_pim)
+          ->integrateMeasurements(imu_accgyr.topLeftCorner(3, nr_deltas),
+                                  imu_accgyr.bottomLeftCorner(3, nr_deltas),
+                                  delta_ts);
+      break;
+    }
+    default: {
+      // gtsam has no batch integration for the combined measurements.
+      for (Eigen::Index i = 0; i < nr_deltas; ++i) {
+        pim_->integrateMeasurement(imu_accgyr.block<3, 1>(0, i),
+                                   imu_accgyr.block<3, 1>(3, i),
+                                   delta_ts(i));
+      }
+      break;
+    }
   }
   if (VLOG_IS_ON(10)) {
     LOG(INFO) << "Finished preintegration: ";
@@ -202,21 +256,25 @@ gtsam::Rot3 ImuFrontend::preintegrateGyroMeasurements(
     const ImuAccGyrS& imu_accgyr) {
   CHECK(imu_stamps.cols() >= 2) << "No Imu data found.";
   CHECK(imu_accgyr.cols() >= 2) << "No Imu data found.";
-  std::lock_guard<std::mutex> lock(imu_bias_mutex_);
-  gtsam::PreintegratedAhrsMeasurements pim_rot(latest_imu_bias_.gyroscope(),
-                                               gtsam::Matrix3::Identity());
-  for (int i = 0; i < imu_stamps.cols() - 1; ++i) {
-    const gtsam::Vector3& measured_omega = imu_accgyr.block<3, 1>(3, i);
-    const double& delta_t =
-        UtilsNumerical::NsecToSec(imu_stamps(i + 1) - imu_stamps(i));
-    CHECK_GT(delta_t, 0.0) << "Imu delta is 0!";
-    pim_rot.integrateMeasurement(measured_omega, delta_t);
+  const Eigen::RowVectorXd delta_ts = computeImuDeltas(imu_stamps);
+  gtsam::Vector3 gyro_bias;
+  {
+    std::lock_guard<std::mutex> lock(imu_bias_mutex_);
+    gyro_bias = latest_imu_bias_.gyroscope();
   }
+  // Same as gtsam::PreintegratedAhrsMeasurements::deltaRij(), without its
+  // (unused here) Jacobians and covariance.
+  const Eigen::Matrix<double, 3, Eigen::Dynamic> thetas =
+      (imu_accgyr.bottomLeftCorner(3, delta_ts.cols()).colwise() - gyro_bias)
+          .array()
+          .rowwise() *
+      delta_ts.array();
+  const gtsam::Rot3 delta_R = composeRotationIncrements(thetas);
   if (VLOG_IS_ON(10)) {
     LOG(INFO) << "Finished preintegration for gyro aided: ";
-    pim_rot.print();
+    delta_R.print();
   }
-  return pim_rot.deltaRij();
+  return delta_R;
 }
 
 /* -------------------------------------------------------------------------- */
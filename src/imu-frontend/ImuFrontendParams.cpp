@@ -70,6 +70,23 @@ bool ImuParams::parseYAML(const std::string& filepath) {
   yaml_parser.getYamlParam("time_alignment_variance_threshold_scaling",
                            &time_alignment_variance_threshold_scaling_);
 
+  if (yaml_parser.hasParam("bias_first_order_correction")) {
+    yaml_parser.getYamlParam("bias_first_order_correction",
+                             &bias_first_order_correction_);
+  }
+  if (yaml_parser.hasParam("bias_correction_max_acc_change")) {
+    yaml_parser.getYamlParam("bias_correction_max_acc_change",
+                             &bias_correction_max_acc_change_);
+  }
+  if (yaml_parser.hasParam("bias_correction_max_gyro_change")) {
+    yaml_parser.getYamlParam("bias_correction_max_gyro_change",
+                             &bias_correction_max_gyro_change_);
+  }
+  if (yaml_parser.hasParam("bias_correction_max_interval_s")) {
+    yaml_parser.getYamlParam("bias_correction_max_interval_s",
+                             &bias_correction_max_interval_s_);
+  }
+
   std::vector<double> n_gravity;
   yaml_parser.getYamlParam("n_gravity", &n_gravity);
   CHECK_EQ(n_gravity.size(), 3);
@@ -95,6 +112,14 @@ void ImuParams::print() const {
                         imu_integration_sigma_,
                         "imu_time_shift: ",
                         imu_time_shift_,
+                        "bias_first_order_correction: ",
+                        bias_first_order_correction_,
+                        "bias_correction_max_acc_change: ",
+                        bias_correction_max_acc_change_,
+                        "bias_correction_max_gyro_change: ",
+                        bias_correction_max_gyro_change_,
+                        "bias_correction_max_interval_s: ",
+                        bias_correction_max_interval_s_,
                         "n_gravity: ",
                         n_gravity_);
   LOG(INFO) << out.str();
@@ -115,6 +140,10 @@ bool ImuParams::equals(const PipelineParams& obj) const {
       time_alignment_variance_threshold_scaling_ == rhs.time_alignment_variance_threshold_scaling_ &&
       nominal_sampling_time_s_ == rhs.nominal_sampling_time_s_ &&
       imu_integration_sigma_ == rhs.imu_integration_sigma_ &&
+      bias_first_order_correction_ == rhs.bias_first_order_correction_ &&
+      bias_correction_max_acc_change_ == rhs.bias_correction_max_acc_change_ &&
+      bias_correction_max_gyro_change_ == rhs.bias_correction_max_gyro_change_ &&
+      bias_correction_max_interval_s_ == rhs.bias_correction_max_interval_s_ &&
       n_gravity_ == rhs.n_gravity_;
   // clang-format on
 }
@@ -0,0 +1,381 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ImuPropagator.cpp
+ * @brief  Propagates the latest Backend state with the IMU, to output the
+ * state at IMU rate.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/imu-frontend/ImuPropagator.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include <gtsam/navigation/NavState.h>
+
+#include "kimera-vio/utils/UtilsNumerical.h"
+
+namespace VIO {
+
+namespace {
+
+/* -------------------------------------------------------------------------- */
+// Applies the motion integrated from the IMU between W_State_from and
+// W_State_to (dt apart) on top of W_State_new, which is at the time of
+// W_State_from: the preintegrated deltas are recovered in the body frame of
+// W_State_from, since
+//   R_to = R_from * dR,
+//   v_to = v_from + g * dt + R_from * dv,
+//   p_to = p_from + v_from * dt + g * dt^2 / 2 + R_from * dp.
+gtsam::NavState rebaseImuMotion(const gtsam::NavState& W_State_new,
+                                const gtsam::NavState& W_State_from,
+                                const gtsam::NavState& W_State_to,
+                                const double& dt,
+                                const gtsam::Vector3& n_gravity) {
+  const gtsam::Rot3& R_from = W_State_from.attitude();
+  const gtsam::Rot3 delta_R = R_from.between(W_State_to.attitude());
+  const gtsam::Vector3 delta_v = R_from.unrotate(
+      W_State_to.velocity() - W_State_from.velocity() - n_gravity * dt);
+  const gtsam::Vector3 delta_p = R_from.unrotate(
+      W_State_to.position() - W_State_from.position() -
+      W_State_from.velocity() * dt - 0.5 * n_gravity * dt * dt);
+  const gtsam::Rot3& R_new = W_State_new.attitude();
+  return gtsam::NavState(R_new * delta_R,
+                         W_State_new.position() + W_State_new.velocity() * dt +
+                             0.5 * n_gravity * dt * dt + R_new.rotate(delta_p),
+                         W_State_new.velocity() + n_gravity * dt +
+                             R_new.rotate(delta_v));
+}
+
+}  // namespace
+
+ImuPropagator::ImuPropagator(const ImuParams& imu_params,
+                             const bool& parallel_run,
+                             const Timestamp& buffer_length_ns)
+    : parallel_run_(parallel_run),
+      callbacks_mutex_(),
+      callbacks_(),
+      imu_buffer_(buffer_length_ns),
+      imu_time_offset_ns_(0),
+      mutex_(),
+      data_cv_(),
+      pending_state_(std::nullopt),
+      pending_measurements_(),
+      shutdown_(false),
+      imu_frontend_(imu_params, ImuBias()),
+      anchor_state_(std::nullopt),
+      waiting_state_(std::nullopt),
+      anchor_imu_time_offset_ns_(0),
+      last_measurement_(),
+      pim_(nullptr),
+      nr_propagated_states_(0u),
+      bias_first_order_correction_(imu_params.bias_first_order_correction_),
+      bias_correction_max_acc_change_(
+          imu_params.bias_correction_max_acc_change_),
+      bias_correction_max_gyro_change_(
+          imu_params.bias_correction_max_gyro_change_),
+      bias_correction_max_interval_ns_(UtilsNumerical::SecToNsec(
+          imu_params.bias_correction_max_interval_s_)),
+      n_gravity_(imu_params.n_gravity_),
+      origin_state_(std::nullopt),
+      origin_imu_timestamp_(0),
+      origin_W_State_anchor_(),
+      anchor_imu_timestamp_(0),
+      pim_history_(),
+      nr_reintegrations_(0u),
+      nr_bias_corrections_(0u),
+      thread_(nullptr) {
+  CHECK_GT(buffer_length_ns, 0);
+}
+
+ImuPropagator::~ImuPropagator() { shutdown(); }
+
+void ImuPropagator::registerPropagatedStateCallback(
+    const PropagatedStateCallback& cb) {
+  CHECK(cb);
+  std::lock_guard<std::mutex> lock(callbacks_mutex_);
+  callbacks_.push_back(cb);
+}
+
+void ImuPropagator::start() {
+  if (!parallel_run_) return;
+  CHECK(!thread_) << "IMU propagator already started.";
+  thread_ = std::make_unique<std::thread>(&ImuPropagator::spin, this);
+}
+
+void ImuPropagator::shutdown() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  data_cv_.notify_all();
+  imu_buffer_.shutdown();
+  if (thread_ && thread_->joinable()) {
+    thread_->join();
+  }
+}
+
+void ImuPropagator::fillImuQueue(const ImuMeasurement& imu_measurement) {
+  imu_buffer_.addMeasurement(imu_measurement.timestamp_,
+                             imu_measurement.acc_gyr_);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_measurements_.push_back(imu_measurement);
+  }
+  data_cv_.notify_one();
+}
+
+void ImuPropagator::fillImuQueue(const ImuMeasurements& imu_measurements) {
+  imu_buffer_.addMeasurements(imu_measurements.timestamps_,
+                              imu_measurements.acc_gyr_);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int i = 0; i < imu_measurements.timestamps_.cols(); ++i) {
+      pending_measurements_.emplace_back(imu_measurements.timestamps_(i),
+                                         imu_measurements.acc_gyr_.col(i));
+    }
+  }
+  data_cv_.notify_one();
+}
+
+void ImuPropagator::resetState(const VioNavStateTimestamped& state) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_state_ = state;
+  }
+  data_cv_.notify_one();
+}
+
+size_t ImuPropagator::spinOnce() {
+  std::optional<VioNavStateTimestamped> new_state = std::nullopt;
+  ImuMeasurementVector new_measurements;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    new_state.swap(pending_state_);
+    new_measurements.swap(pending_measurements_);
+  }
+
+  const size_t nr_propagated_states_before = nr_propagated_states_;
+  if (new_state) waiting_state_ = std::move(new_state);
+  if (waiting_state_ && resetPropagation(*waiting_state_)) {
+    waiting_state_.reset();
+  }
+  // Measurements already integrated by the reset are skipped.
+  for (const ImuMeasurement& imu_measurement : new_measurements) {
+    propagate(imu_measurement);
+  }
+  return nr_propagated_states_ - nr_propagated_states_before;
+}
+
+void ImuPropagator::spin() {
+  VLOG(1) << "IMU propagator - Spinning.";
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      data_cv_.wait(lock, [this] {
+        return shutdown_ || pending_state_ || !pending_measurements_.empty();
+      });
+      if (shutdown_) break;
+    }
+    spinOnce();
+  }
+  VLOG(1) << "IMU propagator - Successful shutdown.";
+}
+
+bool ImuPropagator::resetPropagation(const VioNavStateTimestamped& state) {
+  if (bias_first_order_correction_ && correctPropagation(state)) {
+    ++nr_bias_corrections_;
+    return true;
+  }
+
+  const Timestamp imu_time_offset_ns = imu_time_offset_ns_;
+  const Timestamp imu_timestamp_state = state.timestamp_ + imu_time_offset_ns;
+  ImuMeasurement newest_measurement;
+  if (!imu_buffer_.getNewestImuMeasurement(&newest_measurement) ||
+      newest_measurement.timestamp_ <= imu_timestamp_state) {
+    // Wait for the IMU to reach the state's timestamp.
+    return false;
+  }
+
+  ImuStampS imu_stamps;
+  ImuAccGyrS imu_accgyrs;
+  using QueryResult = utils::ThreadsafeImuBuffer::QueryResult;
+  const QueryResult query_result =
+      imu_buffer_.getImuDataBtwTimestamps(imu_timestamp_state,
+                                          newest_measurement.timestamp_,
+                                          &imu_stamps,
+                                          &imu_accgyrs);
+  if (query_result == QueryResult::kDataNeverAvailable) {
+    LOG(WARNING) << "IMU propagator - The IMU history does not reach the "
+                 << "state at " << UtilsNumerical::NsecToSec(state.timestamp_)
+                 << "[s], increase its buffer length. Dropping the state.";
+    anchor_state_.reset();
+    origin_state_.reset();
+    pim_history_.clear();
+    return true;
+  }
+  if (query_result == QueryResult::kQueueShutdown) return true;
+  // kTooFewMeasurementsAvailable: no measurement strictly in between.
+  CHECK(query_result == QueryResult::kDataAvailable ||
+        query_result == QueryResult::kTooFewMeasurementsAvailable);
+
+  // Measurements from the state's timestamp (interpolated) to the newest one.
+  const int nr_between = imu_stamps.cols();
+  ImuStampS stamps(nr_between + 2);
+  ImuAccGyrS accgyrs(6, nr_between + 2);
+  ImuAccGyr accgyr_state;
+  imu_buffer_.interpolateValueAtTimestamp(imu_timestamp_state, &accgyr_state);
+  stamps(0) = imu_timestamp_state;
+  accgyrs.col(0) = accgyr_state;
+  stamps.middleCols(1, nr_between) = imu_stamps;
+  accgyrs.middleCols(1, nr_between) = imu_accgyrs;
+  stamps(nr_between + 1) = newest_measurement.timestamp_;
+  accgyrs.col(nr_between + 1) = newest_measurement.acc_gyr_;
+
+  imu_frontend_.updateBias(state.imu_bias_);
+  imu_frontend_.resetIntegrationWithCachedBias();
+  pim_ = imu_frontend_.preintegrateImuMeasurements(stamps, accgyrs);
+  ++nr_reintegrations_;
+  anchor_state_ = state;
+  anchor_imu_time_offset_ns_ = imu_time_offset_ns;
+  last_measurement_ = newest_measurement;
+  if (bias_first_order_correction_) {
+    origin_state_ = state;
+    origin_imu_timestamp_ = imu_timestamp_state;
+    origin_W_State_anchor_ = gtsam::NavState(state.pose_, state.velocity_);
+    anchor_imu_timestamp_ = imu_timestamp_state;
+    pim_history_.clear();
+    pim_history_.emplace_back(newest_measurement.timestamp_, pim_);
+  }
+  publishState(newest_measurement.timestamp_);
+  return true;
+}
+
+bool ImuPropagator::correctPropagation(const VioNavStateTimestamped& state) {
+  if (!anchor_state_ || !origin_state_ || pim_history_.empty()) return false;
+  const Timestamp imu_time_offset_ns = imu_time_offset_ns_;
+  if (imu_time_offset_ns != anchor_imu_time_offset_ns_) return false;
+  const Timestamp imu_timestamp_state = state.timestamp_ + imu_time_offset_ns;
+  // The first-order correction degrades with the integration time.
+  if (last_measurement_.timestamp_ - origin_imu_timestamp_ >
+      bias_correction_max_interval_ns_) {
+    return false;
+  }
+  if (imu_timestamp_state < pim_history_.front().first ||
+      imu_timestamp_state > pim_history_.back().first) {
+    return false;
+  }
+  const ImuBias& origin_bias = origin_state_->imu_bias_;
+  if ((state.imu_bias_.accelerometer() - origin_bias.accelerometer()).norm() >
+          bias_correction_max_acc_change_ ||
+      (state.imu_bias_.gyroscope() - origin_bias.gyroscope()).norm() >
+          bias_correction_max_gyro_change_) {
+    return false;
+  }
+
+  // Predict the state at its timestamp from the origin, with its bias,
+  // interpolating between the integrated measurements around it.
+  const gtsam::NavState W_State_origin(origin_state_->pose_,
+                                       origin_state_->velocity_);
+  auto after_it = std::lower_bound(
+      pim_history_.begin(),
+      pim_history_.end(),
+      imu_timestamp_state,
+      [](const std::pair<Timestamp, ImuFrontend::PimPtr>& stamped_pim,
+         const Timestamp& timestamp) { return stamped_pim.first < timestamp; });
+  CHECK(after_it != pim_history_.end());
+  const gtsam::NavState W_State_after =
+      after_it->second->predict(W_State_origin, state.imu_bias_);
+  gtsam::NavState W_State_predicted = W_State_after;
+  if (after_it->first > imu_timestamp_state) {
+    const auto before_it = std::prev(after_it);
+    const gtsam::NavState W_State_before =
+        before_it->second->predict(W_State_origin, state.imu_bias_);
+    const double alpha =
+        static_cast<double>(imu_timestamp_state - before_it->first) /
+        static_cast<double>(after_it->first - before_it->first);
+    W_State_predicted = gtsam::NavState(
+        W_State_before.attitude().slerp(alpha, W_State_after.attitude()),
+        W_State_before.position() +
+            alpha * (W_State_after.position() - W_State_before.position()),
+        W_State_before.velocity() +
+            alpha * (W_State_after.velocity() - W_State_before.velocity()));
+    after_it = before_it;
+  }
+  // Later states are newer: keep the integration around this one onwards.
+  pim_history_.erase(pim_history_.begin(), after_it);
+
+  anchor_state_ = state;
+  origin_W_State_anchor_ = W_State_predicted;
+  anchor_imu_timestamp_ = imu_timestamp_state;
+  VLOG(5) << "IMU propagator - Corrected the integration to the new bias.";
+  publishState(last_measurement_.timestamp_);
+  return true;
+}
+
+void ImuPropagator::propagate(const ImuMeasurement& imu_measurement) {
+  if (!anchor_state_ ||
+      imu_measurement.timestamp_ <= last_measurement_.timestamp_) {
+    return;
+  }
+  ImuStampS stamps(2);
+  stamps << last_measurement_.timestamp_, imu_measurement.timestamp_;
+  ImuAccGyrS accgyrs(6, 2);
+  accgyrs << last_measurement_.acc_gyr_, imu_measurement.acc_gyr_;
+  pim_ = imu_frontend_.preintegrateImuMeasurements(stamps, accgyrs);
+  last_measurement_ = imu_measurement;
+  if (origin_state_) {
+    pim_history_.emplace_back(imu_measurement.timestamp_, pim_);
+    // Past the max interval, the next Backend update integrates again.
+    while (pim_history_.size() > 1u &&
+           imu_measurement.timestamp_ - pim_history_.front().first >
+               bias_correction_max_interval_ns_) {
+      pim_history_.pop_front();
+    }
+  }
+  publishState(imu_measurement.timestamp_);
+}
+
+void ImuPropagator::publishState(const Timestamp& imu_timestamp) {
+  CHECK(anchor_state_);
+  CHECK(pim_);
+  const gtsam::NavState W_State_anchor(anchor_state_->pose_,
+                                       anchor_state_->velocity_);
+  gtsam::NavState navstate;
+  if (origin_state_) {
+    // Integrated from the origin, corrected to the anchor's bias.
+    const gtsam::NavState W_State_origin_propagated = pim_->predict(
+        gtsam::NavState(origin_state_->pose_, origin_state_->velocity_),
+        anchor_state_->imu_bias_);
+    navstate = rebaseImuMotion(
+        W_State_anchor,
+        origin_W_State_anchor_,
+        W_State_origin_propagated,
+        UtilsNumerical::NsecToSec(imu_timestamp - anchor_imu_timestamp_),
+        n_gravity_);
+  } else {
+    navstate = pim_->predict(W_State_anchor, anchor_state_->imu_bias_);
+  }
+  const VioNavStateTimestamped propagated_state(
+      imu_timestamp - anchor_imu_time_offset_ns_,
+      navstate.pose(),
+      navstate.velocity(),
+      anchor_state_->imu_bias_);
+  ++nr_propagated_states_;
+  std::lock_guard<std::mutex> lock(callbacks_mutex_);
+  for (const PropagatedStateCallback& callback : callbacks_) {
+    callback(propagated_state);
+  }
+}
+
+}  // namespace VIO
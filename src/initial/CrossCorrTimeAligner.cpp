@@ -146,6 +146,10 @@ double valueAccessor(const CrossCorrTimeAligner::Measurement& m) {
   return m.value;
 }
 
+// Window size (in measurements) above which the O(N log N) FFT correlation is
+// cheaper than the direct O(N^2) one.
+constexpr size_t kMinFftCorrelationWindowSize = 128u;
+
 }  // namespace
 
 void CrossCorrTimeAligner::interpNewImageMeasurements(
@@ -238,8 +242,12 @@ size_t CrossCorrTimeAligner::getMaxFromN(const std::vector<double>& values,
 
 double CrossCorrTimeAligner::getTimeShift() const {
   using std::placeholders::_1;
-  const auto correlation = utils::crossCorrelation(
-      *vision_buffer_, *imu_buffer_, std::bind(valueAccessor, _1));
+  const auto accessor = std::bind(valueAccessor, _1);
+  const bool use_fft = vision_buffer_->size() >= kMinFftCorrelationWindowSize;
+  const auto correlation =
+      use_fft
+          ? utils::crossCorrelationFft(*vision_buffer_, *imu_buffer_, accessor)
+          : utils::crossCorrelation(*vision_buffer_, *imu_buffer_, accessor);
 
   if (VLOG_IS_ON(5)) {
     VLOG(5) << "Vision: " << getBufferStr(*vision_buffer_);
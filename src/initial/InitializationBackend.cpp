@@ -17,6 +17,8 @@
 
 #include "kimera-vio/initial/InitializationBackend.h"
 
+#include <chrono>
+
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
@@ -62,13 +64,13 @@ bool InitializationBackend::bundleAdjustmentAndGravityAlignment(
     const InitializationInputPayload& init_input_payload =
         *(*output_frontend.front());
     inputs_backend.push_back(std::make_unique<BackendInput>(
-        init_input_payload.stereo_frame_lkf_.timestamp_,
+        init_input_payload.stereo_frame_lkf_->timestamp_,
         init_input_payload.status_stereo_measurements_,
         init_input_payload.pim_,
         init_input_payload.imu_acc_gyrs_));
     pims.push_back(init_input_payload.pim_);
     // Bookkeeping for timestamps
-    Timestamp timestamp_kf = init_input_payload.stereo_frame_lkf_.timestamp_;
+    Timestamp timestamp_kf = init_input_payload.stereo_frame_lkf_->timestamp_;
     delta_t_camera.push_back(
         UtilsNumerical::NsecToSec(timestamp_kf - timestamp_lkf_));
     timestamp_lkf_ = timestamp_kf;
@@ -117,7 +119,7 @@ bool InitializationBackend::bundleAdjustmentAndGravityAlignment(
     std::vector<Timestamp> timestamps;
     for (int i = 0; i < output_frontend.size(); i++) {
       timestamps.push_back(
-          output_frontend.at(i)->stereo_frame_lkf_.timestamp_);
+          output_frontend.at(i)->stereo_frame_lkf_->timestamp_);
     }
     gt_dataset.parseGTdata("/home/sb/Dataset/EuRoC/V1_01_gt", "gt");
     const gtsam::NavState init_navstate_pass = *init_navstate;
@@ -312,14 +314,48 @@ std::vector<gtsam::Pose3> InitializationBackend::optimizeInitialVisualStates(
 
   // Levenberg-Marquardt optimization
   gtsam::LevenbergMarquardtParams lmParams;
+  lmParams.setMaxIterations(backend_params_.initialBAMaxIterations_);
+  // Eliminates the cliques of the Bayes tree in parallel if GTSAM uses TBB.
+  lmParams.setLinearSolverType("MULTIFRONTAL_CHOLESKY");
   gtsam::LevenbergMarquardtOptimizer initial_bundle_adjustment(
       new_factors_tmp, new_values_, lmParams);
   VLOG(10) << "LM optimizer created with error: "
            << initial_bundle_adjustment.error();
 
-  // Optimize and get values
-  gtsam::Values initial_values = initial_bundle_adjustment.optimize();
-  VLOG(10) << "Levenberg Marquardt optimizer done.";
+  // Optimize as LevenbergMarquardtOptimizer::optimize, but also within the
+  // time cap: the values are the best found so far (anytime).
+  const auto& tic_lm = utils::Timer::tic();
+  while (initial_bundle_adjustment.iterations() < lmParams.maxIterations) {
+    if (backend_params_.parallelSmartFactorsTriangulation_) {
+      // The serial linearization then reuses these triangulations.
+      triangulateSmartFactors(new_factors_tmp,
+                              initial_bundle_adjustment.values());
+    }
+    const double previous_error = initial_bundle_adjustment.error();
+    initial_bundle_adjustment.iterate();
+    if (gtsam::checkConvergence(lmParams.relativeErrorTol,
+                                lmParams.absoluteErrorTol,
+                                lmParams.errorTol,
+                                previous_error,
+                                initial_bundle_adjustment.error()) ||
+        initial_bundle_adjustment.lambda() >= lmParams.lambdaUpperBound) {
+      break;
+    }
+    const double lm_duration =
+        utils::Timer::toc<std::chrono::nanoseconds>(tic_lm).count() * 1e-9;
+    if (backend_params_.initialBAMaxTimeSec_ > 0.0 &&
+        lm_duration >= backend_params_.initialBAMaxTimeSec_) {
+      LOG(WARNING) << "Initial bundle adjustment stopped after "
+                   << initial_bundle_adjustment.iterations()
+                   << " iterations (" << lm_duration << " s), with error: "
+                   << initial_bundle_adjustment.error();
+      break;
+    }
+  }
+  const gtsam::Values& initial_values = initial_bundle_adjustment.values();
+  nr_initial_ba_iterations_ = initial_bundle_adjustment.iterations();
+  VLOG(10) << "Levenberg Marquardt optimizer done after "
+           << nr_initial_ba_iterations_ << " iterations.";
   // Query optimized poses in body frame (b0_T_bk)
   std::vector<gtsam::Pose3> initial_states;
   for (const auto& key_value : initial_values) {
@@ -253,36 +253,37 @@ void OnlineGravityAlignment::estimateGyroscopeBias(
     const VisualInertialFrames &vi_frames,
     gtsam::Vector3 *gyro_bias) {
   CHECK_NOTNULL(gyro_bias);
-  // Create Gaussian Graph with unit noise
-  gtsam::GaussianFactorGraph gaussian_graph;
-  auto noise = gtsam::noiseModel::Unit::Create(3);
+  CHECK(!vi_frames.empty());
+  // All frames constrain the same 3D unknown with unit noise: accumulate the
+  // 3x3 normal equations (J' * J * delta_bg = J' * dR) instead of building
+  // and eliminating a factor graph, same least-squares solution.
+  gtsam::Matrix3 hessian = gtsam::Matrix3::Zero();
+  gtsam::Vector3 information = gtsam::Vector3::Zero();
 
   // Loop through all initialization frame
-  for (size_t i = 0; i < vi_frames.size(); i++) {
-    auto frame_i = std::next(vi_frames.begin(), i);
-
+  for (const VisualInertialFrame &frame_i : vi_frames) {
     // Compute rotation error between pre-integrated and visual estimates
-    gtsam::Rot3 bkp1_error_bkp1(frame_i->bkGammaBkp1().transpose() *
-                                frame_i->bkRbkp1());
+    gtsam::Rot3 bkp1_error_bkp1(frame_i.bkGammaBkp1().transpose() *
+                                frame_i.bkRbkp1());
     // Compute rotation error in canonical coordinates (dR_bkp1)
-    gtsam::Vector3 dR = gtsam::Rot3::Logmap(bkp1_error_bkp1);
+    const gtsam::Vector3 dR = gtsam::Rot3::Logmap(bkp1_error_bkp1);
     // Get rotation Jacobian wrt. gyro_bias (dR_bkp1 = J * dbg_bkp1)
-    gtsam::Matrix3 dbg_J_dR = frame_i->dbgJacobianDr();
+    const gtsam::Matrix3 dbg_J_dR = frame_i.dbgJacobianDr();
 
-    // Insert Jacobian Factor in Gaussian Graph
-    gaussian_graph.add(gtsam::Symbol('d', 0), dbg_J_dR, dR, noise);
+    // Accumulate normal equations
+    hessian.noalias() += dbg_J_dR.transpose() * dbg_J_dR;
+    information.noalias() += dbg_J_dR.transpose() * dR;
   }
-  // Optimize Gaussian Graph and get solution
-  gtsam::VectorValues solution = gaussian_graph.optimize();
-  gtsam::Vector3 delta_bg = solution.at(gtsam::Symbol('d', 0));
+  // Solve normal equations
+  const gtsam::Vector3 delta_bg = hessian.ldlt().solve(information);
 
   // Adapt gyroscope bias
   *gyro_bias += delta_bg;
 
   // Logging of solution
-  if (VLOG_IS_ON(5)) {
-    gaussian_graph.print("\nGaussian Factor graph:\n");
-  }
+  VLOG(5) << "Gyro bias normal equations:\n"
+          << hessian << "\nwith information vector:\n"
+          << information;
   VLOG(5) << "Gyro bias estimation:\n" << delta_bg;
 
   // TODO(Sandro): Implement check on quality of estimate
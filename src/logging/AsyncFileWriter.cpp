@@ -0,0 +1,183 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   AsyncFileWriter.cpp
+ * @brief  Output file stream written by a background thread.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/logging/AsyncFileWriter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+constexpr size_t AsyncFileWriter::kChunkSize;
+constexpr size_t AsyncFileWriter::kMaxChunksInFlight;
+
+/* -------------------------------------------------------------------------- */
+// Writes the chunks of all the writers, when notified of a new chunk or
+// periodically.
+class AsyncFileWriter::Worker {
+ public:
+  KIMERA_DELETE_COPY_CONSTRUCTORS(Worker);
+
+  static Worker& instance() {
+    // Never destroyed: writers may outlive static objects. Writers write
+    // their own pending chunks when closed, hence nothing is lost at exit.
+    static Worker* worker = new Worker();
+    return *worker;
+  }
+
+  void add(AsyncFileWriter* writer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    writers_.push_back(CHECK_NOTNULL(writer));
+  }
+
+  void remove(AsyncFileWriter* writer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    writers_.erase(std::remove(writers_.begin(), writers_.end(), writer),
+                   writers_.end());
+  }
+
+  //! Does not lock: a missed notification only delays the write.
+  void notify() { cond_.notify_one(); }
+
+  void flushAll() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (AsyncFileWriter* writer : writers_) writer->flushToFile();
+  }
+
+ private:
+  Worker() : thread_(&Worker::spin, this) {}
+
+  void spin() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      cond_.wait_for(lock, kWritePeriod);
+      // Writers are not removed while the lock is held.
+      for (AsyncFileWriter* writer : writers_) writer->writeChunks(false);
+    }
+  }
+
+ private:
+  static constexpr std::chrono::milliseconds kWritePeriod{100};
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::vector<AsyncFileWriter*> writers_;
+  std::thread thread_;
+};
+
+constexpr std::chrono::milliseconds AsyncFileWriter::Worker::kWritePeriod;
+
+/* -------------------------------------------------------------------------- */
+AsyncFileWriter::StreamBuffer::StreamBuffer(AsyncFileWriter* writer)
+    : writer_(CHECK_NOTNULL(writer)) {
+  resetChunk();
+}
+
+void AsyncFileWriter::StreamBuffer::handOffChunk() {
+  if (pptr() == pbase()) return;
+  chunk_.resize(pptr() - pbase());
+  // Blocks while kMaxChunksInFlight chunks are waiting to be written.
+  writer_->chunks_.push(std::move(chunk_));
+  Worker::instance().notify();
+  resetChunk();
+}
+
+AsyncFileWriter::StreamBuffer::int_type
+AsyncFileWriter::StreamBuffer::overflow(int_type ch) {
+  handOffChunk();
+  if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+  }
+  return traits_type::not_eof(ch);
+}
+
+void AsyncFileWriter::StreamBuffer::resetChunk() {
+  chunk_.assign(kChunkSize, '\0');
+  setp(&chunk_[0], &chunk_[0] + chunk_.size());
+}
+
+/* -------------------------------------------------------------------------- */
+AsyncFileWriter::AsyncFileWriter()
+    : std::ostream(nullptr),
+      stream_buffer_(this),
+      chunks_("AsyncFileWriter Chunks", kMaxChunksInFlight),
+      file_mutex_(),
+      file_() {
+  rdbuf(&stream_buffer_);
+  Worker::instance().add(this);
+}
+
+AsyncFileWriter::AsyncFileWriter(const std::string& filename,
+                                 const bool& append_mode)
+    : AsyncFileWriter() {
+  open(filename, append_mode);
+}
+
+AsyncFileWriter::~AsyncFileWriter() {
+  Worker::instance().remove(this);
+  close();
+}
+
+void AsyncFileWriter::open(const std::string& filename,
+                           const bool& append_mode) {
+  close();
+  std::lock_guard<std::mutex> lock(file_mutex_);
+  file_.open(filename.c_str(),
+             append_mode ? std::ios_base::app : std::ios_base::out);
+  CHECK(file_.is_open()) << "Cannot open file: " << filename;
+  CHECK(file_.good()) << "File in bad state: " << filename;
+  clear();
+  precision(20);
+}
+
+void AsyncFileWriter::close() {
+  flushToFile();
+  std::lock_guard<std::mutex> lock(file_mutex_);
+  if (file_.is_open()) file_.close();
+}
+
+bool AsyncFileWriter::is_open() {
+  std::lock_guard<std::mutex> lock(file_mutex_);
+  return file_.is_open();
+}
+
+void AsyncFileWriter::flushToFile() {
+  // Make room first, so that handing off the last chunk does not wait for
+  // the background thread.
+  writeChunks(false);
+  stream_buffer_.handOffChunk();
+  writeChunks(true);
+}
+
+void AsyncFileWriter::flushAll() { Worker::instance().flushAll(); }
+
+void AsyncFileWriter::writeChunks(const bool& flush_file) {
+  // The mutex makes the background thread and the thread using the writer
+  // take turns as the single consumer of the queue.
+  std::lock_guard<std::mutex> lock(file_mutex_);
+  std::string chunk;
+  while (chunks_.pop(chunk)) {
+    file_.write(chunk.data(), chunk.size());
+  }
+  if (flush_file) file_.flush();
+}
+
+}  // namespace VIO
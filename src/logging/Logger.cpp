@@ -20,6 +20,7 @@
 #include <fstream>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "kimera-vio/frontend/StereoVisionImuFrontend-definitions.h"
 #include "kimera-vio/utils/Statistics.h"
@@ -27,6 +28,17 @@
 #include "kimera-vio/utils/UtilsOpenCV.h"
 
 DEFINE_string(output_path, "./", "Path where to store VIO's log output.");
+DEFINE_string(frontend_images_format,
+              "png",
+              "Format of the saved frontend images: png (lossless) or jpg "
+              "(smaller and faster to encode).");
+DEFINE_int32(frontend_images_jpeg_quality,
+             90,
+             "Quality (0 to 100) of the frontend images saved as jpg.");
+DEFINE_double(frontend_images_scale,
+              1.0,
+              "Scale of the frontend images (in (0, 1]) before they are saved "
+              "or displayed, e.g. 0.5 to halve their width and height.");
 
 namespace VIO {
 
@@ -42,24 +54,20 @@ OfstreamWrapper::OfstreamWrapper(const std::string& filename,
 // destructed. So no need to explicitly call .close();
 OfstreamWrapper::~OfstreamWrapper() {
   LOG(INFO) << "Closing output file: " << filename_.c_str();
-  ofstream_.flush();
   ofstream_.close();
 }
 
 void OfstreamWrapper::closeAndOpenLogFile() {
-  ofstream_.flush();
-  ofstream_.close();
   CHECK(!filename_.empty());
-  OpenFile(output_path_ + '/' + filename_, &ofstream_, false);
+  ofstream_.open(output_path_ + '/' + filename_, false);
 }
 
 void OfstreamWrapper::openLogFile(const std::string& output_file_name,
                                   bool open_file_in_append_mode) {
   CHECK(!output_file_name.empty());
   LOG(INFO) << "Opening output file: " << output_file_name.c_str();
-  OpenFile(output_path_ + '/' + output_file_name,
-           &ofstream_,
-           open_file_in_append_mode);
+  ofstream_.open(output_path_ + '/' + output_file_name,
+                 open_file_in_append_mode);
 }
 
 /* ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
@@ -72,10 +80,10 @@ void EurocGtLogger::logGtData(const std::string& file_path) {
   std::string dummy_header;
   std::getline(f_in, dummy_header);
 
-  std::ofstream& output_stream = output_gt_poses_csv_.ofstream_;
+  std::ostream& output_stream = output_gt_poses_csv_.ofstream_;
   // First, write header
   output_stream << "#timestamp,x,y,z,qw,qx,qy,qz,vx,vy,vz,"
-                << "bgx,bgy,bgz,bax,bay,baz" << std::endl;
+                << "bgx,bgy,bgz,bax,bay,baz" << '\n';
   // Then, copy all gt data to file
   output_stream << f_in.rdbuf();
 
@@ -141,13 +149,13 @@ void BackendLogger::displayInitialStateVioInfo(
 
 void BackendLogger::logBackendResultsCSV(const BackendOutput& vio_output) {
   // We log the poses in csv format for later alignement and analysis.
-  std::ofstream& output_stream = output_poses_vio_csv_.ofstream_;
+  std::ostream& output_stream = output_poses_vio_csv_.ofstream_;
   bool& is_header_written = is_header_written_poses_vio_;
 
   // First, write header, but only once.
   if (!is_header_written) {
     output_stream << "#timestamp,x,y,z,qw,qx,qy,qz,vx,vy,vz,"
-                  << "bgx,bgy,bgz,bax,bay,baz" << std::endl;
+                  << "bgx,bgy,bgz,bax,bay,baz" << '\n';
     is_header_written = true;
   }
   const auto& cached_state = vio_output.W_State_Blkf_;
@@ -173,11 +181,11 @@ void BackendLogger::logBackendResultsCSV(const BackendOutput& vio_output) {
                 << imu_bias_acc(0) << ","          //
                 << imu_bias_acc(1) << ","          //
                 << imu_bias_acc(2)                 //
-                << std::endl;
+                << '\n';
 }
 
 void BackendLogger::logSmartFactorsStats(const BackendOutput& output) {
-  std::ofstream& output_stream = output_smart_factors_stats_csv_.ofstream_;
+  std::ostream& output_stream = output_smart_factors_stats_csv_.ofstream_;
   bool& is_header_written = is_header_written_smart_factors_;
 
   // First, write header, but only once.
@@ -186,7 +194,7 @@ void BackendLogger::logSmartFactorsStats(const BackendOutput& output) {
                   << "numValid,numDegenerate,numFarPoints,numOutliers,"
                   << "numCheirality,numNonInitialized,meanPixelError,"
                   << "maxPixelError,meanTrackLength,maxTrackLength,"
-                  << "nrElementsInMatrix,nrZeroElementsInMatrix" << std::endl;
+                  << "nrElementsInMatrix,nrZeroElementsInMatrix" << '\n';
     is_header_written = true;
   }
 
@@ -203,16 +211,16 @@ void BackendLogger::logSmartFactorsStats(const BackendOutput& output) {
                 << output.debug_info_.meanTrackLength_ << ","
                 << output.debug_info_.maxTrackLength_ << ","
                 << output.debug_info_.nrElementsInMatrix_ << ","
-                << output.debug_info_.nrZeroElementsInMatrix_ << std::endl;
+                << output.debug_info_.nrZeroElementsInMatrix_ << '\n';
 }
 
 void BackendLogger::logBackendPimNavstates(const BackendOutput& output) {
-  std::ofstream& output_stream = output_pim_navstates_csv_.ofstream_;
+  std::ostream& output_stream = output_pim_navstates_csv_.ofstream_;
   bool& is_header_written = is_header_written_pim_navstates_;
 
   // First, write header, but only once.
   if (!is_header_written) {
-    output_stream << "#timestamp_kf,x,y,z,qw,qx,qy,qz,vx,vy,vz" << std::endl;
+    output_stream << "#timestamp_kf,x,y,z,qw,qx,qy,qz,vx,vy,vz" << '\n';
     is_header_written = true;
   }
 
@@ -225,11 +233,11 @@ void BackendLogger::logBackendPimNavstates(const BackendOutput& output) {
                 << position.y() << "," << position.z() << "," << quaternion.w()
                 << "," << quaternion.x() << "," << quaternion.y() << ","
                 << quaternion.z() << "," << velocity.x() << "," << velocity.y()
-                << "," << velocity.z() << std::endl;
+                << "," << velocity.z() << '\n';
 }
 
 void BackendLogger::logBackendTiming(const BackendOutput& output) {
-  std::ofstream& output_stream = output_backend_timing_csv_.ofstream_;
+  std::ostream& output_stream = output_backend_timing_csv_.ofstream_;
   bool& is_header_written = is_header_written_backend_timing_;
 
   // First, write header, but only once.
@@ -237,7 +245,7 @@ void BackendLogger::logBackendTiming(const BackendOutput& output) {
     output_stream << "#cur_kf_id,factorsAndSlotsTime,preUpdateTime,"
                   << "updateTime,updateSlotTime,extraIterationsTime,"
                   << "linearizeTime,linearSolveTime,retractTime,"
-                  << "linearizeMarginalizeTime,marginalizeTime" << std::endl;
+                  << "linearizeMarginalizeTime,marginalizeTime" << '\n';
     is_header_written = true;
   }
 
@@ -252,18 +260,18 @@ void BackendLogger::logBackendTiming(const BackendOutput& output) {
                 << output.debug_info_.linearSolveTime_ << ","
                 << output.debug_info_.retractTime_ << ","
                 << output.debug_info_.linearizeMarginalizeTime_ << ","
-                << output.debug_info_.marginalizeTime_ << std::endl;
+                << output.debug_info_.marginalizeTime_ << '\n';
 }
 
 void BackendLogger::logBackendFactorsStats(const BackendOutput& output) {
-  std::ofstream& output_stream = output_backend_factors_stats_csv_.ofstream_;
+  std::ostream& output_stream = output_backend_factors_stats_csv_.ofstream_;
   bool& is_header_written = is_header_written_backend_factors_stats_;
 
   // First, write header, but only once.
   if (!is_header_written) {
     output_stream << "#cur_kf_id,numAddedSmartF,numAddedImuF,numAddedNoMotionF,"
                   << "numAddedConstantF,numAddedBetweenStereoF,state_size,"
-                  << "landmark_count" << std::endl;
+                  << "landmark_count" << '\n';
     is_header_written = true;
   }
 
@@ -276,7 +284,7 @@ void BackendLogger::logBackendFactorsStats(const BackendOutput& output) {
                 << output.debug_info_.numAddedConstantVelF_ << ","
                 << output.debug_info_.numAddedBetweenStereoF_ << ","
                 << output.state_.size() << "," << output.landmark_count_
-                << std::endl;
+                << '\n';
 }
 
 void BackendLogger::logBackendExtOdom(const BackendInput& input) {
@@ -287,14 +295,14 @@ void BackendLogger::logBackendExtOdom(const BackendInput& input) {
     return;  // we're not using external odometry, don't log anything
   }
 
-  std::ofstream& output_stream = output_backend_external_odometry_.ofstream_;
+  std::ostream& output_stream = output_backend_external_odometry_.ofstream_;
 
   if (!is_header_written_external_odometry_) {
     // vx (kf), etc. is a little sloppy, but there's no better way to do this
     // More specifically: the pose is relative between the current and last
     // keyframe, but the velocity is absolute for the current keyframe
     output_stream << "#timestamp_kf,x,y,z,qw,qx,qy,qz,vx (kf),vy (kf),vz (kf)"
-                  << std::endl;
+                  << '\n';
     is_header_written_external_odometry_ = true;
   }
 
@@ -309,7 +317,7 @@ void BackendLogger::logBackendExtOdom(const BackendInput& input) {
                 << quat.z() << ",";
   output_stream << (*input.body_kf_world_OdomVel_body_kf_).x() << ","
                 << (*input.body_kf_world_OdomVel_body_kf_).y() << ","
-                << (*input.body_kf_world_OdomVel_body_kf_).z() << std::endl;
+                << (*input.body_kf_world_OdomVel_body_kf_).z() << '\n';
 }
 
 /* ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
@@ -318,12 +326,13 @@ MesherLogger::MesherLogger() : output_path_(FLAGS_output_path) {}
 
 /* ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 VisualizerLogger::VisualizerLogger()
-    : output_mesh_("output_mesh.ply"),
-      output_landmarks_("output_landmarks.txt") {}
+    : output_mesh_filename_(FLAGS_output_path + "/output_mesh.kvml"),
+      output_landmarks_("output_landmarks.txt"),
+      output_mesh_(nullptr) {}
 
 void VisualizerLogger::logLandmarks(const PointsWithId& lmks) {
   // Absolute vio errors
-  std::ofstream& output_landmarks_stream = output_landmarks_.ofstream_;
+  std::ostream& output_landmarks_stream = output_landmarks_.ofstream_;
   output_landmarks_stream << "Id\t"
                           << "x\t"
                           << "y\t"
@@ -333,13 +342,13 @@ void VisualizerLogger::logLandmarks(const PointsWithId& lmks) {
                             << point.second.y() << "\t" << point.second.z()
                             << "\n";
   }
-  output_landmarks_stream << std::endl;
+  output_landmarks_stream << '\n';
 }
 
 void VisualizerLogger::logLandmarks(const cv::Mat& lmks) {
   // cv::Mat each row has a lmk with x, y, z.
   // Absolute vio errors
-  std::ofstream& output_landmarks_stream = output_landmarks_.ofstream_;
+  std::ostream& output_landmarks_stream = output_landmarks_.ofstream_;
   output_landmarks_stream << "x\t"
                           << "y\t"
                           << "z\n";
@@ -348,60 +357,21 @@ void VisualizerLogger::logLandmarks(const cv::Mat& lmks) {
                             << lmks.at<float>(i, 1) << "\t"
                             << lmks.at<float>(i, 2) << "\n";
   }
-  output_landmarks_stream << std::endl;
+  output_landmarks_stream << '\n';
 }
 
-void VisualizerLogger::logMesh(const cv::Mat& lmks,
+void VisualizerLogger::logMesh(const LandmarkIds& lmk_ids,
+                               const cv::Mat& lmks,
                                const cv::Mat& colors,
-                               const cv::Mat& mesh,
-                               const double& timestamp,
+                               const cv::Mat& polygons_mesh,
+                               const Timestamp& timestamp,
                                bool log_accumulated_mesh) {
-  std::ofstream& output_mesh_stream = output_mesh_.ofstream_;
-  bool& is_header_written = is_header_written_mesh_;
-
-  CHECK(output_mesh_stream) << "Output File Mesh: error writing.";
-  // Number of vertices in the mesh.
-  int vertex_count = lmks.rows;
-  // Number of faces in the mesh.
-  int faces_count = std::round(mesh.rows / 4);
-  // First, write header, but only once.
-  if (!is_header_written || !log_accumulated_mesh) {
-    output_mesh_stream << "ply\n"
-                       << "format ascii 1.0\n"
-                       << "comment Mesh from KIMERA VIO at timestamp "
-                       << timestamp << "\n"
-                       << "element vertex " << vertex_count << "\n"
-                       << "property float x\n"
-                       << "property float y\n"
-                       << "property float z\n"
-                       << "property uchar red\n"  // Start of vertex color.
-                       << "property uchar green\n"
-                       << "property uchar blue\n"
-                       << "element face " << faces_count << "\n"
-                       << "property list uchar int vertex_indices\n"
-                       << "end_header\n";
-    is_header_written = true;
-  }
-
-  // Second, log vertices.
-  for (int i = 0; i < lmks.rows; i++) {
-    output_mesh_stream << lmks.at<float>(i, 0) << " "  // Log vertices x y z.
-                       << lmks.at<float>(i, 1) << " " << lmks.at<float>(i, 2)
-                       << " " << int(colors.at<uint8_t>(i, 0))
-                       << " "  // Log vertices colors.
-                       << int(colors.at<uint8_t>(i, 1)) << " "
-                       << int(colors.at<uint8_t>(i, 2)) << " \n";
-  }
-  // Finally, log faces.
-  for (int i = 0; i < faces_count; i++) {
+  if (!output_mesh_) {
     // Assumes the mesh is made of triangles
-    int index = i * 4;
-    output_mesh_stream << mesh.at<int32_t>(index) << " "
-                       << mesh.at<int32_t>(index + 1) << " "
-                       << mesh.at<int32_t>(index + 2) << " "
-                       << mesh.at<int32_t>(index + 3) << " \n";
+    output_mesh_ = std::make_unique<MeshLogWriter>(
+        output_mesh_filename_, 3u, 3u, !log_accumulated_mesh);
   }
-  output_mesh_stream << std::endl;
+  output_mesh_->append(timestamp, lmk_ids, lmks, colors, polygons_mesh);
 }
 
 /* ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
@@ -420,6 +390,7 @@ FrontendLogger::FrontendLogger()
   fs::create_directory(logger_dir / "stereoMatchingUnrectifiedImg");
   fs::create_directory(logger_dir / "stereoMatchingRectifiedImg");
   fs::create_directory(logger_dir / "rgbdDepthFeaturesImg");
+  fs::create_directory(logger_dir / "rgbdDepthFrames");
 }
 
 void FrontendLogger::logFrontendStats(
@@ -428,7 +399,7 @@ void FrontendLogger::logFrontendStats(
     const TrackerStatusSummary& tracker_summary,
     const size_t& nrKeypoints) {
   // We log Frontend results in csv format.
-  std::ofstream& output_stream_stats = output_frontend_stats_.ofstream_;
+  std::ostream& output_stream_stats = output_frontend_stats_.ofstream_;
   bool& is_header_written = is_header_written_frontend_stats_;
 
   if (!is_header_written) {
@@ -441,7 +412,7 @@ void FrontendLogger::logFrontendStats(
                         << "featureDetectionTime,featureTrackingTime,"
                         << "monoRansacTime,stereoRansacTime,"
                         << "featureSelectionTime,extracted_corners,"
-                        << "need_n_corners" << std::endl;
+                        << "need_n_corners" << '\n';
     is_header_written = true;
   }
 
@@ -479,7 +450,7 @@ void FrontendLogger::logFrontendStats(
       // Info about feature selector.
       << tracker_info.featureSelectionTime_ << ","
       << tracker_info.extracted_corners_ << "," << tracker_info.need_n_corners_
-      << std::endl;
+      << '\n';
 }
 
 void FrontendLogger::logFrontendRansac(
@@ -487,14 +458,14 @@ void FrontendLogger::logFrontendRansac(
     const gtsam::Pose3& relative_pose_body_mono,
     const gtsam::Pose3& relative_pose_body_stereo) {
   // We log the relative poses in csv format for later analysis.
-  std::ofstream& output_stream_mono = output_frontend_ransac_mono_.ofstream_;
-  std::ofstream& output_stream_stereo =
+  std::ostream& output_stream_mono = output_frontend_ransac_mono_.ofstream_;
+  std::ostream& output_stream_stereo =
       output_frontend_ransac_stereo_.ofstream_;
   bool& is_header_written = is_header_written_ransac_mono_;
 
   if (!is_header_written) {
-    output_stream_mono << "#timestamp_lkf,x,y,z,qw,qx,qy,qz" << std::endl;
-    output_stream_stereo << "#timestamp_lkf,x,y,z,qw,qx,qy,qz" << std::endl;
+    output_stream_mono << "#timestamp_lkf,x,y,z,qw,qx,qy,qz" << '\n';
+    output_stream_stereo << "#timestamp_lkf,x,y,z,qw,qx,qy,qz" << '\n';
     is_header_written = true;
   }
 
@@ -507,7 +478,7 @@ void FrontendLogger::logFrontendRansac(
   output_stream_mono << timestamp_lkf << "," << mono_tran.x() << ","
                      << mono_tran.y() << "," << mono_tran.z() << ","
                      << mono_quat.w() << "," << mono_quat.x() << ","
-                     << mono_quat.y() << "," << mono_quat.z() << std::endl;
+                     << mono_quat.y() << "," << mono_quat.z() << '\n';
 
   // Log relative stereo poses; pose from previous keyframe to current keyframe,
   // in previous-keyframe coordinates. These are not cumulative trajectories.
@@ -519,7 +490,7 @@ void FrontendLogger::logFrontendRansac(
                        << stereo_tran.y() << "," << stereo_tran.z() << ","
                        << stereo_quat.w() << "," << stereo_quat.x() << ","
                        << stereo_quat.y() << "," << stereo_quat.z()
-                       << std::endl;
+                       << '\n';
 }
 
 void FrontendLogger::logFrontendImg(const FrameId& kf_id,
@@ -529,23 +500,56 @@ void FrontendLogger::logFrontendImg(const FrameId& kf_id,
                                     bool disp_img,
                                     bool save_img) {
   // We save the images to the output folder so that they can be visualized.
-
+  const bool is_jpg = FLAGS_frontend_images_format == "jpg";
+  CHECK(is_jpg || FLAGS_frontend_images_format == "png")
+      << "Unknown frontend images format: " << FLAGS_frontend_images_format;
   std::string img_name = output_frontend_img_path_ + dir_name +
-                         img_name_prepend + std::to_string(kf_id) + ".png";
+                         img_name_prepend + std::to_string(kf_id) +
+                         (is_jpg ? ".jpg" : ".png");
+
+  CHECK_GT(FLAGS_frontend_images_scale, 0.0);
+  CHECK_LE(FLAGS_frontend_images_scale, 1.0);
+  cv::Mat scaled_img = img;
+  if (FLAGS_frontend_images_scale < 1.0) {
+    cv::resize(img,
+               scaled_img,
+               cv::Size(),
+               FLAGS_frontend_images_scale,
+               FLAGS_frontend_images_scale,
+               cv::INTER_AREA);
+  }
 
   // Show image.
   if (disp_img) {
-    cv::imshow(img_name_prepend, img);
+    cv::imshow(img_name_prepend, scaled_img);
     cv::waitKey(1);
   }
 
   // Write image to disk.
   if (save_img) {
     LOG(INFO) << "Writing image: " << img_name;
-    cv::imwrite(img_name, img);
+    std::vector<int> params;
+    if (is_jpg) {
+      params = {cv::IMWRITE_JPEG_QUALITY, FLAGS_frontend_images_jpeg_quality};
+    }
+    cv::imwrite(img_name, scaled_img, params);
   }
 }
 
+void FrontendLogger::logDepthFrame(const DepthFrame& depth_frame) {
+  std::vector<std::uint8_t> bytes;
+  depth_frame.encode(&bytes);
+  const std::string filename = output_frontend_img_path_ +
+                               "/rgbdDepthFrames/depth_" +
+                               std::to_string(depth_frame.id_) + ".bin";
+  std::ofstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    LOG(ERROR) << "Could not open depth frame file: " << filename;
+    return;
+  }
+  file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
 void FrontendLogger::logFrontendTemporalCal(
     const Timestamp& timestamp_vision,
     const Timestamp& timestamp_imu,
@@ -554,20 +558,20 @@ void FrontendLogger::logFrontendTemporalCal(
     bool not_enough_data,
     bool not_enough_variance,
     const double& result) {
-  std::ofstream& output_stream = output_frontend_temporal_cal_.ofstream_;
+  std::ostream& output_stream = output_frontend_temporal_cal_.ofstream_;
 
   if (!is_header_written_temporal_cal_) {
     output_stream << "#timestamp_vision,timestamp_imu,vision_relative_angle_"
                      "norm,imu_relative_angle_norm,not_enough_data,not_"
                      "enough_variance,t_imu_cam_s"
-                  << std::endl;
+                  << '\n';
     is_header_written_temporal_cal_ = true;
   }
 
   output_stream << timestamp_vision << "," << timestamp_imu << ","
                 << vision_relative_angle_norm << "," << imu_relative_angle_norm
                 << "," << not_enough_data << "," << not_enough_variance << ","
-                << result << "," << std::endl;
+                << result << "," << '\n';
 }
 
 /* ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
@@ -577,12 +581,15 @@ PipelineLogger::PipelineLogger()
 void PipelineLogger::logPipelineOverallTiming(
     const std::chrono::milliseconds& duration) {
   // Add header.
-  std::ofstream& outputFile_timingOverall_ = output_pipeline_timing_.ofstream_;
-  outputFile_timingOverall_ << "vio_overall_time [ms]" << std::endl;
+  std::ostream& outputFile_timingOverall_ = output_pipeline_timing_.ofstream_;
+  outputFile_timingOverall_ << "vio_overall_time [ms]" << '\n';
   outputFile_timingOverall_ << duration.count();
 
   VIO::utils::Statistics::WriteAllSamplesToCsvFile(FLAGS_output_path + '/' +
                                                    "StatisticsVIO.csv");
+  // The csv only has the last samples, the yaml summarizes the whole run.
+  VIO::utils::Statistics::WriteToYamlFile(FLAGS_output_path + '/' +
+                                          "StatisticsVIO.yaml");
 }
 
 /* ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
@@ -592,7 +599,8 @@ LoopClosureDetectorLogger::LoopClosureDetectorLogger()
       output_status_("output_lcd_status.csv"),
       output_geom_verif_("output_lcd_geom_verif.csv"),
       output_pose_recovery_("output_lcd_pose_recovery.csv"),
-      ts_map_() {}
+      ts_map_(),
+      traj_() {}
 
 void LoopClosureDetectorLogger::logTimestampMap(
     const std::unordered_map<VIO::FrameId, VIO::Timestamp>& ts_map) {
@@ -606,12 +614,12 @@ void LoopClosureDetectorLogger::logLCDResult(const LcdOutput& lcd_output) {
 
 void LoopClosureDetectorLogger::logLoopClosure(const LcdOutput& lcd_output) {
   // We log loop-closure results in csv format.
-  std::ofstream& output_stream_lcd = output_lcd_.ofstream_;
+  std::ostream& output_stream_lcd = output_lcd_.ofstream_;
   bool& is_header_written = is_header_written_lcd_;
 
   if (!is_header_written) {
     output_stream_lcd << "#timestamp_kf,timestamp_query,timestamp_match,isLoop,"
-                      << "matchKfId,queryKfId,x,y,z,qw,qx,qy,qz" << std::endl;
+                      << "matchKfId,queryKfId,x,y,z,qw,qx,qy,qz" << '\n';
     is_header_written = true;
   }
 
@@ -627,7 +635,7 @@ void LoopClosureDetectorLogger::logLoopClosure(const LcdOutput& lcd_output) {
                     << "," << rel_trans.x() << "," << rel_trans.y() << ","
                     << rel_trans.z() << "," << rel_quat.w() << ","
                     << rel_quat.x() << "," << rel_quat.y() << ","
-                    << rel_quat.z() << std::endl;
+                    << rel_quat.z() << '\n';
 }
 
 void LoopClosureDetectorLogger::logGeometricVerification(
@@ -635,12 +643,12 @@ void LoopClosureDetectorLogger::logGeometricVerification(
     const Timestamp& timestamp_match,
     const gtsam::Pose3& camRef_Pose_camCur) {
   // We log 2d2d ransac result pose in csv format.
-  std::ofstream& output_stream_lcd = output_geom_verif_.ofstream_;
+  std::ostream& output_stream_lcd = output_geom_verif_.ofstream_;
   bool& is_header_written = is_header_written_geom_verif_;
 
   if (!is_header_written) {
     output_stream_lcd << "#timestamp_match,timestamp_query,x,y,z,qw,qx,qy,qz"
-                      << std::endl;
+                      << '\n';
     is_header_written = true;
   }
 
@@ -652,7 +660,7 @@ void LoopClosureDetectorLogger::logGeometricVerification(
                     << rel_trans.x() << "," << rel_trans.y() << ","
                     << rel_trans.z() << "," << rel_quat.w() << ","
                     << rel_quat.x() << "," << rel_quat.y() << ","
-                    << rel_quat.z() << std::endl;
+                    << rel_quat.z() << '\n';
 }
 
 void LoopClosureDetectorLogger::logPoseRecovery(
@@ -660,12 +668,12 @@ void LoopClosureDetectorLogger::logPoseRecovery(
     const Timestamp& timestamp_match,
     const gtsam::Pose3& camMatch_T_camQuery_3d) {
   // We log 2d2d ransac result pose in csv format.
-  std::ofstream& output_stream_lcd = output_pose_recovery_.ofstream_;
+  std::ostream& output_stream_lcd = output_pose_recovery_.ofstream_;
   bool& is_header_written = is_header_written_pose_recovery_;
 
   if (!is_header_written) {
     output_stream_lcd << "#timestamp_match,timestamp_query,x,y,z,qw,qx,qy,qz"
-                      << std::endl;
+                      << '\n';
     is_header_written = true;
   }
 
@@ -677,44 +685,60 @@ void LoopClosureDetectorLogger::logPoseRecovery(
                     << rel_trans.x() << "," << rel_trans.y() << ","
                     << rel_trans.z() << "," << rel_quat.w() << ","
                     << rel_quat.x() << "," << rel_quat.y() << ","
-                    << rel_quat.z() << std::endl;
+                    << rel_quat.z() << '\n';
 }
 
 void LoopClosureDetectorLogger::logOptimizedTraj(const LcdOutput& lcd_output) {
-  // We close and reopen log file to clear contents completely.
-  output_traj_.closeAndOpenLogFile();
-  // We log the full optimized trajectory in csv format.
-  std::ofstream& output_stream_traj = output_traj_.ofstream_;
-
-  bool is_header_written = false;
-  if (!is_header_written) {
-    output_stream_traj << "#timestamp_kf,x,y,z,qw,qx,qy,qz" << std::endl;
-    is_header_written = true;
+  // The output only has the poses that changed (see LcdOutput::states_).
+  for (const gtsam::Key& key : lcd_output.states_.keys()) {
+    const gtsam::Pose3& pose = lcd_output.states_.at<gtsam::Pose3>(key);
+    if (traj_.exists(key)) {
+      traj_.update(key, pose);
+    } else {
+      traj_.insert(key, pose);
+    }
   }
 
-  const gtsam::Values& traj = lcd_output.states_;
-
-  for (size_t i = 1; i < traj.size(); i++) {
-    const gtsam::Pose3& pose = traj.at<gtsam::Pose3>(i);
-    const gtsam::Point3& trans = pose.translation();
-    const gtsam::Quaternion& quat = pose.rotation().toQuaternion();
+  std::ostream& output_stream_traj = output_traj_.ofstream_;
+  if (lcd_output.is_trajectory_corrected_ || !is_header_written_traj_) {
+    // We close and reopen log file to clear contents completely, and log the
+    // full optimized trajectory in csv format.
+    output_traj_.closeAndOpenLogFile();
+    output_stream_traj << "#timestamp_kf,x,y,z,qw,qx,qy,qz" << '\n';
+    is_header_written_traj_ = true;
+    for (size_t i = 1; i < traj_.size(); i++) {
+      logTrajPose(i, traj_.at<gtsam::Pose3>(i));
+    }
+    return;
+  }
 
-    output_stream_traj << ts_map_.at(i) << "," << trans.x() << "," << trans.y()
-                       << "," << trans.z() << "," << quat.w() << "," << quat.x()
-                       << "," << quat.y() << "," << quat.z() << std::endl;
+  // Else only the new keyframe is appended.
+  for (const gtsam::Key& key : lcd_output.states_.keys()) {
+    if (key == 0u) continue;
+    logTrajPose(key, lcd_output.states_.at<gtsam::Pose3>(key));
   }
 }
 
+void LoopClosureDetectorLogger::logTrajPose(const FrameId& kf_id,
+                                            const gtsam::Pose3& pose) {
+  const gtsam::Point3& trans = pose.translation();
+  const gtsam::Quaternion& quat = pose.rotation().toQuaternion();
+  output_traj_.ofstream_ << ts_map_.at(kf_id) << "," << trans.x() << ","
+                         << trans.y() << "," << trans.z() << "," << quat.w()
+                         << "," << quat.x() << "," << quat.y() << ","
+                         << quat.z() << '\n';
+}
+
 void LoopClosureDetectorLogger::logDebugInfo(const LcdDebugInfo& debug_info) {
   // We log the loop-closure result of every key frame in csv format.
-  std::ofstream& output_stream_status = output_status_.ofstream_;
+  std::ostream& output_stream_status = output_status_.ofstream_;
   bool& is_header_written = is_header_written_status_;
 
   if (!is_header_written) {
     output_stream_status << "#timestamp_kf,lcd_status,query_id,match_id,"
                          << "mono_input_size,mono_inliers,mono_iters,"
                          << "stereo_input_size,stereo_inliers,stereo_iters,"
-                         << "pgo_size,pgo_lc_count,pgo_lc_inliers" << std::endl;
+                         << "pgo_size,pgo_lc_count,pgo_lc_inliers" << '\n';
     is_header_written = true;
   }
 
@@ -729,7 +753,7 @@ void LoopClosureDetectorLogger::logDebugInfo(const LcdDebugInfo& debug_info) {
                        << debug_info.stereo_inliers_ << ","
                        << debug_info.stereo_iter_ << "," << debug_info.pgo_size_
                        << "," << debug_info.pgo_lc_count_ << ","
-                       << debug_info.pgo_lc_inliers_ << std::endl;
+                       << debug_info.pgo_lc_inliers_ << '\n';
 }
 
 }  // namespace VIO
@@ -0,0 +1,219 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   TrajectoryEvaluator.cpp
+ * @brief  Online evaluation of the estimated trajectory against ground truth.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/logging/TrajectoryEvaluator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+#include <Eigen/SVD>
+
+#include <glog/logging.h>
+
+#include <gtsam/geometry/Rot3.h>
+
+#include "kimera-vio/utils/Statistics.h"
+
+namespace VIO {
+
+TrajectoryEvaluator::TrajectoryEvaluator(const GroundTruthCallback& gt_callback,
+                                         const double& rpe_delta_s,
+                                         const bool& align_scale)
+    : gt_callback_(gt_callback),
+      rpe_delta_ns_(static_cast<Timestamp>(rpe_delta_s * 1e9)),
+      align_scale_(align_scale),
+      mutex_(),
+      nr_poses_(0u),
+      W_origin_(Eigen::Vector3d::Zero()),
+      gt_origin_(Eigen::Vector3d::Zero()),
+      sum_W_p_(Eigen::Vector3d::Zero()),
+      sum_gt_p_(Eigen::Vector3d::Zero()),
+      sum_gt_p_W_p_t_(Eigen::Matrix3d::Zero()),
+      sum_W_p_sq_(0.0),
+      sum_gt_p_sq_(0.0),
+      rpe_window_(),
+      nr_rpe_pairs_(0u),
+      sum_rpe_translation_sq_(0.0),
+      sum_rpe_rotation_sq_(0.0) {
+  CHECK_GT(rpe_delta_ns_, 0) << "The RPE delta must be positive.";
+}
+
+bool TrajectoryEvaluator::addPose(const Timestamp& timestamp,
+                                  const gtsam::Pose3& W_Pose_B) {
+  CHECK(gt_callback_);
+  gtsam::Pose3 gt_Pose_B;
+  if (!gt_callback_(timestamp, &gt_Pose_B)) {
+    VLOG(5) << "No ground truth for timestamp: " << timestamp;
+    return false;
+  }
+  addPose(timestamp, W_Pose_B, gt_Pose_B);
+  return true;
+}
+
+void TrajectoryEvaluator::addPose(const Timestamp& timestamp,
+                                  const gtsam::Pose3& W_Pose_B,
+                                  const gtsam::Pose3& gt_Pose_B) {
+  // The RPE samples are added to the statistics once out of the lock.
+  bool has_rpe_pair = false;
+  double rpe_translation = 0.0;
+  double rpe_rotation = 0.0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (nr_poses_ == 0u) {
+      W_origin_ = W_Pose_B.translation();
+      gt_origin_ = gt_Pose_B.translation();
+    }
+    const Eigen::Vector3d W_p = W_Pose_B.translation() - W_origin_;
+    const Eigen::Vector3d gt_p = gt_Pose_B.translation() - gt_origin_;
+    ++nr_poses_;
+    sum_W_p_ += W_p;
+    sum_gt_p_ += gt_p;
+    sum_gt_p_W_p_t_ += gt_p * W_p.transpose();
+    sum_W_p_sq_ += W_p.squaredNorm();
+    sum_gt_p_sq_ += gt_p.squaredNorm();
+
+    // Keep the latest pose at least rpe_delta_ns_ older than this one.
+    while (rpe_window_.size() >= 2u &&
+           timestamp - rpe_window_[1].timestamp_ >= rpe_delta_ns_) {
+      rpe_window_.pop_front();
+    }
+    if (!rpe_window_.empty() &&
+        timestamp - rpe_window_.front().timestamp_ >= rpe_delta_ns_) {
+      const TimestampedPoses& previous = rpe_window_.front();
+      const gtsam::Pose3 error =
+          previous.gt_Pose_B_.between(gt_Pose_B)
+              .between(previous.W_Pose_B_.between(W_Pose_B));
+      rpe_translation = error.translation().norm();
+      rpe_rotation = gtsam::Rot3::Logmap(error.rotation()).norm() * 180.0 /
+                     M_PI;
+      ++nr_rpe_pairs_;
+      sum_rpe_translation_sq_ += rpe_translation * rpe_translation;
+      sum_rpe_rotation_sq_ += rpe_rotation * rpe_rotation;
+      has_rpe_pair = true;
+    }
+    rpe_window_.push_back({timestamp, W_Pose_B, gt_Pose_B});
+  }
+
+  if (has_rpe_pair) {
+    static const utils::StatsCollector rpe_translation_stats(
+        "Evaluation RPE translation [m]");
+    static const utils::StatsCollector rpe_rotation_stats(
+        "Evaluation RPE rotation [deg]");
+    rpe_translation_stats.AddSample(rpe_translation);
+    rpe_rotation_stats.AddSample(rpe_rotation);
+  }
+}
+
+double TrajectoryEvaluator::getAteRmse(gtsam::Pose3* gt_Pose_W,
+                                       double* scale) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (nr_poses_ == 0u) {
+    if (gt_Pose_W) *gt_Pose_W = gtsam::Pose3();
+    if (scale) *scale = 1.0;
+    return 0.0;
+  }
+
+  // Umeyama (1991) from the moments of the centered positions.
+  const double n = static_cast<double>(nr_poses_);
+  const Eigen::Vector3d mean_W_p = sum_W_p_ / n;
+  const Eigen::Vector3d mean_gt_p = sum_gt_p_ / n;
+  const Eigen::Matrix3d covariance =
+      sum_gt_p_W_p_t_ / n - mean_gt_p * mean_W_p.transpose();
+  const double variance_W_p =
+      std::max(sum_W_p_sq_ / n - mean_W_p.squaredNorm(), 0.0);
+  const double variance_gt_p =
+      std::max(sum_gt_p_sq_ / n - mean_gt_p.squaredNorm(), 0.0);
+
+  const Eigen::JacobiSVD<Eigen::Matrix3d> svd(
+      covariance, Eigen::ComputeFullU | Eigen::ComputeFullV);
+  Eigen::Vector3d signs = Eigen::Vector3d::Ones();
+  if (svd.matrixU().determinant() * svd.matrixV().determinant() < 0.0) {
+    signs.z() = -1.0;
+  }
+  const Eigen::Matrix3d R =
+      svd.matrixU() * signs.asDiagonal() * svd.matrixV().transpose();
+  // trace(R * covariance^T).
+  const double trace = svd.singularValues().dot(signs);
+  const double s =
+      align_scale_ && variance_W_p > 0.0 ? trace / variance_W_p : 1.0;
+
+  if (gt_Pose_W || scale) {
+    // Back to the original positions: gt_p + gt_origin_ =
+    // s * R * (W_p + W_origin_) + t.
+    const Eigen::Vector3d t =
+        mean_gt_p + gt_origin_ - s * R * (mean_W_p + W_origin_);
+    if (gt_Pose_W) *gt_Pose_W = gtsam::Pose3(gtsam::Rot3(R), t);
+    if (scale) *scale = s;
+  }
+
+  // Mean of |gt_p - s * R * W_p - t|^2 over the centered positions.
+  const double ate_sq = variance_gt_p - 2.0 * s * trace + s * s * variance_W_p;
+  return std::sqrt(std::max(ate_sq, 0.0));
+}
+
+double TrajectoryEvaluator::getRpeTranslationRmse() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return nr_rpe_pairs_ == 0u
+             ? 0.0
+             : std::sqrt(sum_rpe_translation_sq_ / nr_rpe_pairs_);
+}
+
+double TrajectoryEvaluator::getRpeRotationRmse() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return nr_rpe_pairs_ == 0u ? 0.0
+                             : std::sqrt(sum_rpe_rotation_sq_ / nr_rpe_pairs_);
+}
+
+size_t TrajectoryEvaluator::getNrPoses() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return nr_poses_;
+}
+
+size_t TrajectoryEvaluator::getNrRpePairs() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return nr_rpe_pairs_;
+}
+
+void TrajectoryEvaluator::reportStatistics() const {
+  if (getNrPoses() == 0u) {
+    LOG(WARNING) << "No pose was evaluated against the ground truth.";
+    return;
+  }
+  utils::StatsCollector("Evaluation ATE RMSE [m]").AddSample(getAteRmse());
+  if (getNrRpePairs() > 0u) {
+    utils::StatsCollector("Evaluation RPE translation RMSE [m]")
+        .AddSample(getRpeTranslationRmse());
+    utils::StatsCollector("Evaluation RPE rotation RMSE [deg]")
+        .AddSample(getRpeRotationRmse());
+  }
+}
+
+std::string TrajectoryEvaluator::print() const {
+  gtsam::Pose3 gt_Pose_W;
+  double scale = 1.0;
+  const double ate_rmse = getAteRmse(&gt_Pose_W, &scale);
+  std::stringstream out;
+  out << "Trajectory evaluation:\n"
+      << " - Nr of poses: " << getNrPoses() << '\n'
+      << " - ATE RMSE [m]: " << ate_rmse << '\n'
+      << " - Alignment scale: " << scale << '\n'
+      << " - Nr of RPE pairs (delta " << rpe_delta_ns_ * 1e-9
+      << " s): " << getNrRpePairs() << '\n'
+      << " - RPE translation RMSE [m]: " << getRpeTranslationRmse() << '\n'
+      << " - RPE rotation RMSE [deg]: " << getRpeRotationRmse();
+  return out.str();
+}
+
+}  // namespace VIO
@@ -0,0 +1,237 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   BinaryVocabulary.cpp
+ * @brief  Compact binary serialization of the ORB vocabulary, loaded with a
+ * memory mapping instead of parsing the text/YAML vocabulary.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/loopclosure/BinaryVocabulary.h"
+
+#include <DBoW2/DBoW2.h>
+#include <glog/logging.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "kimera-vio/utils/MappedFile.h"
+
+namespace VIO {
+
+namespace {
+
+/**
+ * Gives access to the (protected) vocabulary tree of DBoW2's vocabulary.
+ * Only adds constructors: built vocabularies are plain OrbVocabulary.
+ */
+class OrbVocabularyTree : public OrbVocabulary {
+ public:
+  using OrbVocabulary::Node;
+
+  static const std::vector<Node>& getNodes(const OrbVocabulary& vocab) {
+    // Pointer to the base member, read from any OrbVocabulary.
+    std::vector<Node> OrbVocabulary::*nodes = &OrbVocabularyTree::m_nodes;
+    return vocab.*nodes;
+  }
+
+  OrbVocabularyTree(const std::shared_ptr<const MappedFile>& mapped_file,
+                    const BinaryVocabularyHeader& header)
+      : OrbVocabulary(header.k,
+                      header.L,
+                      static_cast<DBoW2::WeightingType>(header.weighting),
+                      static_cast<DBoW2::ScoringType>(header.scoring)) {
+    const size_t nr_nodes = header.nr_nodes;
+    const BinaryVocabularyNode* records =
+        reinterpret_cast<const BinaryVocabularyNode*>(mapped_file->data() +
+                                                      header.nodes_offset);
+    // One matrix with all the descriptors, each node's is a row of it.
+    const cv::Mat descriptors = wrapMappedFile(mapped_file,
+                                               header.descriptors_offset,
+                                               static_cast<int>(nr_nodes),
+                                               DBoW2::FORB::L,
+                                               CV_8U,
+                                               DBoW2::FORB::L);
+    m_nodes.resize(nr_nodes);
+    m_nodes[0].id = 0;
+    for (size_t i = 1u; i < nr_nodes; ++i) {
+      const BinaryVocabularyNode& record = records[i];
+      CHECK_LT(record.parent, i) << "Node " << i << " before its parent.";
+      Node& node = m_nodes[i];
+      node.id = static_cast<DBoW2::NodeId>(i);
+      node.parent = record.parent;
+      node.weight = record.weight;
+      node.descriptor = descriptors.row(static_cast<int>(i));
+      m_nodes[record.parent].children.push_back(node.id);
+    }
+    createWords();
+  }
+};
+
+}  // namespace
+
+bool isBinaryVocabulary(const std::string& filename) {
+  std::ifstream file(filename, std::ios::in | std::ios::binary);
+  char magic[sizeof(kBinaryVocabularyMagic)];
+  if (!file.read(magic, sizeof(magic))) return false;
+  return std::memcmp(magic, kBinaryVocabularyMagic, sizeof(magic)) == 0;
+}
+
+void saveBinaryVocabulary(const OrbVocabulary& vocab,
+                          const std::string& filename) {
+  const std::vector<OrbVocabularyTree::Node>& nodes =
+      OrbVocabularyTree::getNodes(vocab);
+  CHECK(!nodes.empty()) << "Empty vocabulary.";
+  const size_t descriptor_size = static_cast<size_t>(DBoW2::FORB::L);
+
+  BinaryVocabularyHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kBinaryVocabularyMagic, sizeof(header.magic));
+  header.version = kBinaryVocabularyVersion;
+  header.k = vocab.getBranchingFactor();
+  header.L = vocab.getDepthLevels();
+  header.weighting = static_cast<int32_t>(vocab.getWeightingType());
+  header.scoring = static_cast<int32_t>(vocab.getScoringType());
+  header.descriptor_size = static_cast<uint32_t>(descriptor_size);
+  header.nr_nodes = nodes.size();
+  header.nodes_offset = sizeof(header);
+  const size_t nodes_end =
+      header.nodes_offset + nodes.size() * sizeof(BinaryVocabularyNode);
+  header.descriptors_offset =
+      (nodes_end + kBinaryVocabularyAlignment - 1u) /
+      kBinaryVocabularyAlignment * kBinaryVocabularyAlignment;
+  header.file_size =
+      header.descriptors_offset + nodes.size() * descriptor_size;
+
+  std::vector<BinaryVocabularyNode> records(nodes.size());
+  std::vector<uchar> descriptors(nodes.size() * descriptor_size, 0u);
+  for (size_t i = 0u; i < nodes.size(); ++i) {
+    const OrbVocabularyTree::Node& node = nodes[i];
+    CHECK_EQ(node.id, i);
+    if (i == 0u) continue;  // The root has no descriptor.
+    CHECK_LT(node.parent, i) << "Node " << i << " before its parent.";
+    CHECK_EQ(node.descriptor.type(), CV_8U);
+    CHECK_EQ(node.descriptor.total(), descriptor_size);
+    CHECK(node.descriptor.isContinuous());
+    records[i].parent = node.parent;
+    records[i].weight = node.weight;
+    std::memcpy(descriptors.data() + i * descriptor_size,
+                node.descriptor.data,
+                descriptor_size);
+  }
+
+  // Written to a temporary file first, not to clobber a mapped vocabulary.
+  const std::string tmp_filename = filename + ".tmp";
+  {
+    std::ofstream file(tmp_filename,
+                       std::ios::out | std::ios::binary | std::ios::trunc);
+    CHECK(file.is_open()) << "Could not open for writing: " << tmp_filename;
+    static const char kZeros[kBinaryVocabularyAlignment] = {0};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(records.data()),
+               records.size() * sizeof(BinaryVocabularyNode));
+    file.write(kZeros, header.descriptors_offset - nodes_end);
+    file.write(reinterpret_cast<const char*>(descriptors.data()),
+               descriptors.size());
+    CHECK(file.good()) << "Could not write: " << tmp_filename;
+  }
+  CHECK_EQ(std::rename(tmp_filename.c_str(), filename.c_str()), 0)
+      << "Could not write: " << filename;
+}
+
+void getVocabularyLevel(const OrbVocabulary& vocab,
+                        const int& level,
+                        cv::Mat* descriptors,
+                        cv::Mat* bit_means) {
+  CHECK_NOTNULL(descriptors);
+  CHECK_NOTNULL(bit_means);
+  CHECK_GT(level, 0);
+  CHECK_LE(level, vocab.getDepthLevels());
+  const std::vector<OrbVocabularyTree::Node>& nodes =
+      OrbVocabularyTree::getNodes(vocab);
+  CHECK(!nodes.empty()) << "Empty vocabulary.";
+  static constexpr int kBits = 8 * DBoW2::FORB::L;
+
+  // Row of the node at the level each node is below, -1 if above it.
+  std::vector<int> rows(nodes.size(), -1);
+  std::vector<int> depths(nodes.size(), 0);
+  *descriptors = cv::Mat();
+  for (size_t i = 1u; i < nodes.size(); ++i) {
+    const OrbVocabularyTree::Node& node = nodes[i];
+    CHECK_LT(node.parent, i) << "Node " << i << " before its parent.";
+    depths[i] = depths[node.parent] + 1;
+    if (depths[i] == level) {
+      rows[i] = descriptors->rows;
+      descriptors->push_back(node.descriptor);
+    } else {
+      rows[i] = rows[node.parent];
+    }
+  }
+  CHECK(!descriptors->empty()) << "No vocabulary node at level " << level;
+
+  *bit_means = cv::Mat::zeros(descriptors->rows, kBits, CV_32F);
+  std::vector<int> nr_words(descriptors->rows, 0);
+  for (size_t i = 1u; i < nodes.size(); ++i) {
+    const OrbVocabularyTree::Node& node = nodes[i];
+    if (!node.isLeaf() || rows[i] < 0) continue;
+    float* means = bit_means->ptr<float>(rows[i]);
+    const uchar* descriptor = node.descriptor.ptr<uchar>();
+    for (int b = 0; b < kBits; ++b) {
+      if (descriptor[b / 8] & (1u << (b % 8))) means[b] += 1.0f;
+    }
+    ++nr_words[rows[i]];
+  }
+  for (int r = 0; r < bit_means->rows; ++r) {
+    if (nr_words[r] > 0) bit_means->row(r) /= nr_words[r];
+  }
+}
+
+std::unique_ptr<OrbVocabulary> loadBinaryVocabulary(
+    const std::string& filename) {
+  auto mapped_file = std::make_shared<const MappedFile>(filename);
+  const size_t size = mapped_file->size();
+  CHECK_GE(size, sizeof(BinaryVocabularyHeader))
+      << "Binary vocabulary too small: " << filename;
+  BinaryVocabularyHeader header;
+  std::memcpy(&header, mapped_file->data(), sizeof(header));
+  CHECK_EQ(std::memcmp(header.magic,
+                       kBinaryVocabularyMagic,
+                       sizeof(kBinaryVocabularyMagic)),
+           0)
+      << "Not a binary vocabulary: " << filename;
+  CHECK_EQ(header.version, kBinaryVocabularyVersion)
+      << "Unsupported binary vocabulary version: " << filename;
+  CHECK_EQ(header.file_size, size)
+      << "Truncated binary vocabulary: " << filename;
+  CHECK_EQ(header.descriptor_size, static_cast<uint32_t>(DBoW2::FORB::L));
+  CHECK_GT(header.nr_nodes, 0u);
+  CHECK_EQ(header.nodes_offset % alignof(BinaryVocabularyNode), 0u);
+  CHECK_LE(header.nodes_offset +
+               header.nr_nodes * sizeof(BinaryVocabularyNode),
+           header.descriptors_offset);
+  CHECK_LE(header.descriptors_offset +
+               header.nr_nodes * header.descriptor_size,
+           size);
+  return std::make_unique<OrbVocabularyTree>(mapped_file, header);
+}
+
+void convertVocabularyToBinary(const std::string& vocabulary_filename,
+                               const std::string& binary_filename) {
+  OrbVocabulary vocab;
+  LOG(INFO) << "Loading vocabulary from " << vocabulary_filename;
+  vocab.load(vocabulary_filename);
+  CHECK(!vocab.empty()) << "Empty vocabulary: " << vocabulary_filename;
+  saveBinaryVocabulary(vocab, binary_filename);
+  LOG(INFO) << "Saved binary vocabulary with " << vocab.size()
+            << " visual words to " << binary_filename;
+}
+
+}  // namespace VIO
@@ -0,0 +1,347 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   BowDatabase.cpp
+ * @brief  Inverted-index database of bag-of-words vectors, to query the most
+ * similar images to a given one.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/loopclosure/BowDatabase.h"
+
+#include <DBoW2/DBoW2.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cmath>
+#include <istream>
+#include <ostream>
+
+namespace VIO {
+
+BowDatabase::BowDatabase(const OrbVocabulary& vocab,
+                         const BowDatabaseParams& params)
+    : params_(params),
+      vocab_(nullptr),
+      posting_lists_(),
+      entry_offsets_(1u, 0u),
+      entry_words_(),
+      entry_weights_() {
+  CHECK_GE(params_.num_threads, 1);
+  CHECK_GT(params_.stop_word_fraction, 0.0);
+  setVocabulary(vocab);
+}
+
+BowDatabase::BowDatabase(std::shared_ptr<const OrbVocabulary> vocab,
+                         const BowDatabaseParams& params)
+    : params_(params),
+      vocab_(std::move(vocab)),
+      posting_lists_(),
+      entry_offsets_(1u, 0u),
+      entry_words_(),
+      entry_weights_() {
+  CHECK(vocab_);
+  CHECK_GE(params_.num_threads, 1);
+  CHECK_GT(params_.stop_word_fraction, 0.0);
+  clear();
+}
+
+BowDatabase::BowDatabase(const BowDatabase& other)
+    : params_(other.params_),
+      vocab_(other.vocab_),
+      posting_lists_(other.posting_lists_),
+      entry_offsets_(other.entry_offsets_),
+      entry_words_(other.entry_words_),
+      entry_weights_(other.entry_weights_) {}
+
+BowDatabase& BowDatabase::operator=(const BowDatabase& other) {
+  if (this != &other) {
+    params_ = other.params_;
+    vocab_ = other.vocab_;
+    posting_lists_ = other.posting_lists_;
+    entry_offsets_ = other.entry_offsets_;
+    entry_words_ = other.entry_words_;
+    entry_weights_ = other.entry_weights_;
+  }
+  return *this;
+}
+
+BowDatabase::~BowDatabase() = default;
+
+void BowDatabase::setVocabulary(const OrbVocabulary& vocab) {
+  vocab_ = std::make_shared<const OrbVocabulary>(vocab);
+  clear();
+}
+
+void BowDatabase::clear() {
+  posting_lists_.clear();
+  posting_lists_.resize(vocab_->size());
+  entry_offsets_.assign(1u, 0u);
+  entry_words_.clear();
+  entry_weights_.clear();
+}
+
+size_t BowDatabase::getMemoryBytes() const {
+  size_t bytes = posting_lists_.capacity() * sizeof(PostingList) +
+                 entry_offsets_.capacity() * sizeof(size_t) +
+                 entry_words_.capacity() * sizeof(unsigned int) +
+                 entry_weights_.capacity() * sizeof(double);
+  for (const PostingList& posting_list : posting_lists_) {
+    bytes += posting_list.entry_ids.capacity() * sizeof(EntryId) +
+             posting_list.weights.capacity() * sizeof(double);
+  }
+  return bytes;
+}
+
+BowDatabase::EntryId BowDatabase::add(const DBoW2::BowVector& bow_vec) {
+  const EntryId entry_id = static_cast<EntryId>(size());
+  const bool store_entry = vocab_->getScoringType() != DBoW2::L1_NORM;
+  for (const auto& word : bow_vec) {
+    CHECK_LT(word.first, posting_lists_.size());
+    PostingList& posting_list = posting_lists_[word.first];
+    posting_list.entry_ids.push_back(entry_id);
+    posting_list.weights.push_back(word.second);
+    if (store_entry) {
+      entry_words_.push_back(word.first);
+      entry_weights_.push_back(word.second);
+    }
+  }
+  entry_offsets_.push_back(entry_words_.size());
+  return entry_id;
+}
+
+void BowDatabase::query(const DBoW2::BowVector& bow_vec,
+                        DBoW2::QueryResults& results,
+                        int max_results,
+                        int max_id) const {
+  results.clear();
+  const EntryId nr_entries = static_cast<EntryId>(size());
+  EntryId nr_scored = nr_entries;
+  if (max_id != -1) {
+    nr_scored = std::min(nr_entries, static_cast<EntryId>(std::max(max_id, 0)));
+  }
+  if (nr_scored == 0u) return;
+
+  std::vector<QueryWord> query_words;
+  getQueryWords(bow_vec, &query_words);
+
+  // Dense accumulators: threads write disjoint ranges of entries.
+  std::vector<double> scores(nr_scored, 0.0);
+  std::vector<uint8_t> is_candidate(nr_scored, 0u);
+  if (params_.num_threads > 1 &&
+      nr_scored >= static_cast<EntryId>(params_.min_parallel_entries)) {
+    cv::parallel_for_(
+        cv::Range(0, static_cast<int>(nr_scored)),
+        [&](const cv::Range& range) {
+          scoreEntriesL1(query_words,
+                         static_cast<EntryId>(range.start),
+                         static_cast<EntryId>(range.end),
+                         &scores,
+                         &is_candidate);
+        },
+        static_cast<double>(params_.num_threads));
+  } else {
+    scoreEntriesL1(query_words, 0u, nr_scored, &scores, &is_candidate);
+  }
+
+  const bool is_l1 = vocab_->getScoringType() == DBoW2::L1_NORM;
+  DBoW2::BowVector entry_bow_vec;
+  for (EntryId entry_id = 0u; entry_id < nr_scored; ++entry_id) {
+    if (!is_candidate[entry_id]) continue;
+    if (is_l1) {
+      // As DBoW2: the terms are in [-2 (best), 0 (worst)].
+      results.push_back(DBoW2::Result(entry_id, -scores[entry_id] / 2.0));
+    } else {
+      getEntry(entry_id, &entry_bow_vec);
+      results.push_back(
+          DBoW2::Result(entry_id, vocab_->score(bow_vec, entry_bow_vec)));
+    }
+  }
+
+  sortResults(max_results, &results);
+}
+
+void BowDatabase::queryCandidates(const DBoW2::BowVector& bow_vec,
+                                  DBoW2::QueryResults& results,
+                                  const std::vector<EntryId>& candidates,
+                                  int max_results) const {
+  results.clear();
+  if (candidates.empty()) return;
+  CHECK(std::is_sorted(candidates.begin(), candidates.end()));
+  CHECK_LT(candidates.back(), size());
+
+  std::vector<QueryWord> query_words;
+  getQueryWords(bow_vec, &query_words);
+
+  // Same terms as scoreEntriesL1, indexed by candidate instead of entry.
+  std::vector<double> scores(candidates.size(), 0.0);
+  std::vector<uint8_t> is_candidate(candidates.size(), 0u);
+  for (const QueryWord& query_word : query_words) {
+    const std::vector<EntryId>& entry_ids = query_word.posting_list->entry_ids;
+    const std::vector<double>& weights = query_word.posting_list->weights;
+    const double& qvalue = query_word.weight;
+    auto it = entry_ids.begin();
+    for (size_t k = 0u; k < candidates.size(); ++k) {
+      // Candidates are sorted: search from the previous one.
+      it = std::lower_bound(it, entry_ids.end(), candidates[k]);
+      if (it == entry_ids.end()) break;
+      if (*it != candidates[k]) continue;
+      const double& dvalue = weights[it - entry_ids.begin()];
+      scores[k] +=
+          std::fabs(qvalue - dvalue) - std::fabs(qvalue) - std::fabs(dvalue);
+      is_candidate[k] = 1u;
+    }
+  }
+
+  const bool is_l1 = vocab_->getScoringType() == DBoW2::L1_NORM;
+  DBoW2::BowVector entry_bow_vec;
+  for (size_t k = 0u; k < candidates.size(); ++k) {
+    if (!is_candidate[k]) continue;
+    if (is_l1) {
+      results.push_back(DBoW2::Result(candidates[k], -scores[k] / 2.0));
+    } else {
+      getEntry(candidates[k], &entry_bow_vec);
+      results.push_back(
+          DBoW2::Result(candidates[k], vocab_->score(bow_vec, entry_bow_vec)));
+    }
+  }
+  sortResults(max_results, &results);
+}
+
+void BowDatabase::getQueryWords(const DBoW2::BowVector& bow_vec,
+                                std::vector<QueryWord>* query_words) const {
+  CHECK_NOTNULL(query_words);
+  const EntryId nr_entries = static_cast<EntryId>(size());
+  const bool prune_stop_words =
+      params_.stop_word_fraction < 1.0 &&
+      nr_entries >= static_cast<EntryId>(params_.stop_word_min_entries);
+  const double max_posting_list_size =
+      params_.stop_word_fraction * static_cast<double>(nr_entries);
+  query_words->clear();
+  query_words->reserve(bow_vec.size());
+  for (const auto& word : bow_vec) {
+    if (word.first >= posting_lists_.size()) continue;
+    const PostingList& posting_list = posting_lists_[word.first];
+    if (posting_list.entry_ids.empty()) continue;
+    if (prune_stop_words && static_cast<double>(posting_list.entry_ids.size()) >
+                                max_posting_list_size) {
+      continue;
+    }
+    query_words->push_back({&posting_list, word.second});
+  }
+}
+
+void BowDatabase::sortResults(const int& max_results,
+                              DBoW2::QueryResults* results) {
+  CHECK_NOTNULL(results);
+  const auto is_better = [](const DBoW2::Result& a, const DBoW2::Result& b) {
+    return a.Score > b.Score || (a.Score == b.Score && a.Id < b.Id);
+  };
+  if (max_results > 0 && results->size() > static_cast<size_t>(max_results)) {
+    std::partial_sort(results->begin(),
+                      results->begin() + max_results,
+                      results->end(),
+                      is_better);
+    results->resize(max_results);
+  } else {
+    std::sort(results->begin(), results->end(), is_better);
+  }
+}
+
+void BowDatabase::scoreEntriesL1(const std::vector<QueryWord>& query_words,
+                                 const EntryId& begin,
+                                 const EntryId& end,
+                                 std::vector<double>* scores,
+                                 std::vector<uint8_t>* is_candidate) const {
+  CHECK_NOTNULL(scores);
+  CHECK_NOTNULL(is_candidate);
+  for (const QueryWord& query_word : query_words) {
+    const std::vector<EntryId>& entry_ids = query_word.posting_list->entry_ids;
+    const std::vector<double>& weights = query_word.posting_list->weights;
+    const double& qvalue = query_word.weight;
+    size_t i = static_cast<size_t>(
+        std::lower_bound(entry_ids.begin(), entry_ids.end(), begin) -
+        entry_ids.begin());
+    for (; i < entry_ids.size() && entry_ids[i] < end; ++i) {
+      const double& dvalue = weights[i];
+      (*scores)[entry_ids[i]] +=
+          std::fabs(qvalue - dvalue) - std::fabs(qvalue) - std::fabs(dvalue);
+      (*is_candidate)[entry_ids[i]] = 1u;
+    }
+  }
+}
+
+void BowDatabase::getEntry(const EntryId& entry_id,
+                           DBoW2::BowVector* bow_vec) const {
+  CHECK_NOTNULL(bow_vec);
+  CHECK_LT(entry_id, size());
+  bow_vec->clear();
+  for (size_t i = entry_offsets_[entry_id]; i < entry_offsets_[entry_id + 1u];
+       ++i) {
+    bow_vec->addWeight(entry_words_[i], entry_weights_[i]);
+  }
+}
+
+namespace {
+
+template <typename T>
+void writePod(std::ostream& out, const T& value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+T readPod(std::istream& in) {
+  T value;
+  in.read(reinterpret_cast<char*>(&value), sizeof(T));
+  CHECK(in.good()) << "BowDatabase: truncated database.";
+  return value;
+}
+
+}  // namespace
+
+void BowDatabase::save(std::ostream& out) const {
+  // The posting lists hold all the entries' words, even with L1 scoring.
+  std::vector<DBoW2::BowVector> entries(size());
+  for (size_t word = 0u; word < posting_lists_.size(); ++word) {
+    const PostingList& posting_list = posting_lists_[word];
+    for (size_t i = 0u; i < posting_list.entry_ids.size(); ++i) {
+      entries[posting_list.entry_ids[i]].addWeight(
+          static_cast<DBoW2::WordId>(word), posting_list.weights[i]);
+    }
+  }
+
+  writePod(out, static_cast<uint64_t>(vocab_->size()));
+  writePod(out, static_cast<uint64_t>(entries.size()));
+  for (const DBoW2::BowVector& entry : entries) {
+    writePod(out, static_cast<uint64_t>(entry.size()));
+    for (const auto& word : entry) {
+      writePod(out, static_cast<uint32_t>(word.first));
+      writePod(out, static_cast<double>(word.second));
+    }
+  }
+}
+
+void BowDatabase::load(std::istream& in) {
+  const uint64_t vocab_size = readPod<uint64_t>(in);
+  CHECK_EQ(vocab_size, vocab_->size())
+      << "BowDatabase: saved with another vocabulary.";
+  clear();
+  const uint64_t nr_entries = readPod<uint64_t>(in);
+  for (uint64_t i = 0u; i < nr_entries; ++i) {
+    DBoW2::BowVector entry;
+    const uint64_t nr_words = readPod<uint64_t>(in);
+    for (uint64_t j = 0u; j < nr_words; ++j) {
+      const DBoW2::WordId word = readPod<uint32_t>(in);
+      entry.addWeight(word, readPod<double>(in));
+    }
+    add(entry);
+  }
+}
+
+}  // namespace VIO
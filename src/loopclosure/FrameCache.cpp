@@ -14,7 +14,15 @@
 
 #include "kimera-vio/loopclosure/FrameCache.h"
 
+#include <algorithm>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
+#include <type_traits>
+
+#ifdef KIMERA_HAS_ZSTD
+#include <zstd.h>
+#endif
 
 namespace VIO {
 
@@ -23,11 +31,6 @@ void write(std::ostream& buffer, const T& field) {
   buffer.write(reinterpret_cast<const char*>(&field), sizeof(T));
 }
 
-template <typename T>
-void read(std::istream& buffer, T& field) {
-  buffer.read(reinterpret_cast<char*>(&field), sizeof(T));
-}
-
 template <>
 void write<cv::KeyPoint>(std::ostream& buffer, const cv::KeyPoint& pt) {
   write(buffer, pt.angle);
@@ -39,17 +42,6 @@ void write<cv::KeyPoint>(std::ostream& buffer, const cv::KeyPoint& pt) {
   write(buffer, pt.size);
 }
 
-template <>
-void read<cv::KeyPoint>(std::istream& buffer, cv::KeyPoint& pt) {
-  read(buffer, pt.angle);
-  read(buffer, pt.class_id);
-  read(buffer, pt.octave);
-  read(buffer, pt.pt.x);
-  read(buffer, pt.pt.y);
-  read(buffer, pt.response);
-  read(buffer, pt.size);
-}
-
 template <>
 void write<gtsam::Point3>(std::ostream& buffer, const gtsam::Point3& pt) {
   write(buffer, pt.x());
@@ -57,25 +49,12 @@ void write<gtsam::Point3>(std::ostream& buffer, const gtsam::Point3& pt) {
   write(buffer, pt.z());
 }
 
-template <>
-void read<gtsam::Vector3>(std::istream& buffer, gtsam::Vector3& pt) {
-  read(buffer, pt.x());
-  read(buffer, pt.y());
-  read(buffer, pt.z());
-}
-
 template <>
 void write<StatusKeypointCV>(std::ostream& buffer, const StatusKeypointCV& pt) {
   write(buffer, pt.first);
   write(buffer, pt.second);
 }
 
-template <>
-void read<StatusKeypointCV>(std::istream& buffer, StatusKeypointCV& pt) {
-  read(buffer, pt.first);
-  read(buffer, pt.second);
-}
-
 template <>
 void write<cv::Mat>(std::ostream& buffer, const cv::Mat& mat) {
   const auto type = mat.type();
@@ -90,28 +69,87 @@ void write<cv::Mat>(std::ostream& buffer, const cv::Mat& mat) {
   buffer.write(reinterpret_cast<const char*>(mat.data), bytes);
 }
 
-template <>
-void read<cv::Mat>(std::istream& buffer, cv::Mat& mat) {
-  int type;
-  read(buffer, type);
-  int dims;
-  read(buffer, dims);
-  std::vector<int> sizes(dims);
-  for (int i = 0; i < dims; ++i) {
-    read(buffer, sizes[i]);
+//! Reads what write wrote, and fails instead of reading more than the
+//! bytes left: a count must fit in them before anything is allocated.
+class FrameReader {
+ public:
+  FrameReader(std::istream& buffer, const size_t& max_bytes)
+      : buffer_(buffer), bytes_left_(max_bytes) {}
+
+  template <typename T>
+  bool read(T* field) {
+    if (sizeof(T) > bytes_left_) return false;
+    buffer_.read(reinterpret_cast<char*>(field), sizeof(T));
+    bytes_left_ -= sizeof(T);
+    return static_cast<bool>(buffer_);
   }
 
-  size_t bytes;
-  read(buffer, bytes);
+  bool read(cv::KeyPoint* pt) {
+    return read(&pt->angle) && read(&pt->class_id) && read(&pt->octave) &&
+           read(&pt->pt.x) && read(&pt->pt.y) && read(&pt->response) &&
+           read(&pt->size);
+  }
 
-  if (sizes.empty()) {
-    return;
+  bool read(gtsam::Vector3* pt) {
+    return read(&pt->x()) && read(&pt->y()) && read(&pt->z());
   }
 
-  mat = cv::Mat(sizes, type);
-  CHECK_EQ(bytes, mat.total() * mat.elemSize());
-  buffer.read(reinterpret_cast<char*>(mat.data), bytes);
-}
+  bool read(StatusKeypointCV* pt) {
+    return read(&pt->first) && read(&pt->second);
+  }
+
+  bool read(cv::Mat* mat) {
+    int type = 0;
+    int dims = 0;
+    if (!read(&type) || !read(&dims)) return false;
+    if ((type & ~CV_MAT_TYPE_MASK) != 0 || CV_MAT_DEPTH(type) > CV_64F ||
+        dims < 0 || dims > CV_MAX_DIM) {
+      return false;
+    }
+    std::vector<int> sizes(dims);
+    size_t total = dims == 0 ? 0u : 1u;
+    for (int& size : sizes) {
+      if (!read(&size) || size < 0) return false;
+      // Without overflow: the elements must fit in the bytes left.
+      if (size > 0 && total > bytes_left_ / static_cast<size_t>(size)) {
+        return false;
+      }
+      total *= static_cast<size_t>(size);
+    }
+    size_t bytes = 0u;
+    if (!read(&bytes)) return false;
+    const size_t elem_size = CV_ELEM_SIZE(type);
+    if (total > bytes_left_ / elem_size || bytes != total * elem_size) {
+      return false;
+    }
+
+    if (sizes.empty()) {
+      *mat = cv::Mat();
+      return true;
+    }
+    *mat = cv::Mat(dims, sizes.data(), type);
+    buffer_.read(reinterpret_cast<char*>(mat->data), bytes);
+    bytes_left_ -= bytes;
+    return static_cast<bool>(buffer_);
+  }
+
+  //! The count is checked against the bytes left, each item taking at least
+  //! one byte.
+  template <typename T, typename Alloc>
+  bool readVec(std::vector<T, Alloc>* vec) {
+    size_t size = 0u;
+    if (!read(&size) || size > bytes_left_) return false;
+    vec->resize(size);
+    for (T& item : *vec) {
+      if (!read(&item)) return false;
+    }
+    return true;
+  }
+
+ private:
+  std::istream& buffer_;
+  size_t bytes_left_;
+};
 
 template <typename T, typename Alloc>
 void write_vec(std::ostream& buffer, const std::vector<T, Alloc>& vec) {
@@ -122,36 +160,22 @@ void write_vec(std::ostream& buffer, const std::vector<T, Alloc>& vec) {
   }
 }
 
-template <typename T, typename Alloc>
-void read_vec(std::istream& buffer, std::vector<T, Alloc>& vec) {
-  size_t size;
-  read(buffer, size);
-  vec.resize(size);
-  for (size_t i = 0; i < size; ++i) {
-    read(buffer, vec[i]);
-  }
-}
-
 void LCDFrame::saveBytes(std::ostream& buffer) const {
   write(buffer, timestamp_);
   write(buffer, id_);
   write(buffer, id_kf_);
   write_vec(buffer, keypoints_);
   write_vec(buffer, keypoints_3d_);
-  write_vec(buffer, descriptors_vec_);
   write(buffer, descriptors_mat_);
   write_vec(buffer, bearing_vectors_);
 }
 
-void LCDFrame::loadBytes(std::istream& buffer) {
-  read(buffer, timestamp_);
-  read(buffer, id_);
-  read(buffer, id_kf_);
-  read_vec(buffer, keypoints_);
-  read_vec(buffer, keypoints_3d_);
-  read_vec(buffer, descriptors_vec_);
-  read(buffer, descriptors_mat_);
-  read_vec(buffer, bearing_vectors_);
+bool LCDFrame::loadBytes(FrameReader* reader) {
+  CHECK_NOTNULL(reader);
+  return reader->read(&timestamp_) && reader->read(&id_) &&
+         reader->read(&id_kf_) && reader->readVec(&keypoints_) &&
+         reader->readVec(&keypoints_3d_) && reader->read(&descriptors_mat_) &&
+         reader->readVec(&bearing_vectors_);
 }
 
 void StereoLCDFrame::saveBytes(std::ostream& buffer) const {
@@ -160,10 +184,10 @@ void StereoLCDFrame::saveBytes(std::ostream& buffer) const {
   write_vec(buffer, right_keypoints_rectified_);
 }
 
-void StereoLCDFrame::loadBytes(std::istream& buffer) {
-  LCDFrame::loadBytes(buffer);
-  read_vec(buffer, left_keypoints_rectified_);
-  read_vec(buffer, right_keypoints_rectified_);
+bool StereoLCDFrame::loadBytes(FrameReader* reader) {
+  return LCDFrame::loadBytes(reader) &&
+         reader->readVec(&left_keypoints_rectified_) &&
+         reader->readVec(&right_keypoints_rectified_);
 }
 
 void LCDFrame::save(std::ostream& buffer) const {
@@ -176,7 +200,7 @@ void StereoLCDFrame::save(std::ostream& buffer) const {
   saveBytes(buffer);
 }
 
-LCDFrame::Ptr LCDFrame::load(std::istream& buffer) {
+LCDFrame::Ptr LCDFrame::load(std::istream& buffer, const size_t& max_bytes) {
   std::string marker;
   std::getline(buffer, marker);
   LCDFrame::Ptr frame;
@@ -189,14 +213,37 @@ LCDFrame::Ptr LCDFrame::load(std::istream& buffer) {
     return frame;
   }
 
-  frame->loadBytes(buffer);
+  // The marker and its end of line.
+  if (marker.size() >= max_bytes) return nullptr;
+  FrameReader reader(buffer, max_bytes - marker.size() - 1u);
+  if (!frame->loadBytes(&reader)) {
+    LOG(ERROR) << "Truncated or invalid frame.";
+    return nullptr;
+  }
   return frame;
 }
 
 FrameCache::FrameCache() { impl_.reset(new InMemoryCacheImpl()); }
 
+size_t getFrameBytes(const LCDFrame& frame) {
+  size_t bytes = sizeof(frame);
+  bytes += frame.keypoints_.capacity() * sizeof(cv::KeyPoint);
+  bytes += frame.keypoints_3d_.capacity() * sizeof(Landmark);
+  bytes += frame.bearing_vectors_.capacity() * sizeof(BearingVector);
+  bytes += frame.descriptors_mat_.total() * frame.descriptors_mat_.elemSize();
+  const auto* stereo_frame = dynamic_cast<const StereoLCDFrame*>(&frame);
+  if (stereo_frame) {
+    bytes += (stereo_frame->left_keypoints_rectified_.capacity() +
+              stereo_frame->right_keypoints_rectified_.capacity()) *
+             sizeof(StatusKeypointCV);
+  }
+  return bytes;
+}
+
 FrameCache::FrameCache(const FrameCacheConfig& config) {
-  if (config.max_frames <= 0) {
+  if (config.max_resident_bytes > 0) {
+    impl_.reset(new MemoryBudgetCacheImpl(config));
+  } else if (config.max_frames <= 0) {
     impl_.reset(new InMemoryCacheImpl());
   } else {
     impl_.reset(new LRUCacheImpl(config));
@@ -209,6 +256,7 @@ size_t InMemoryCacheImpl::addFrame(const LCDFrame::Ptr& frame) {
   const auto new_id = frames_.size();
   frame->id_ = new_id;
   frames_.push_back(frame);
+  resident_bytes_ += getFrameBytes(*frame);
   return new_id;
 }
 
@@ -222,6 +270,213 @@ LCDFrame::Ptr InMemoryCacheImpl::getFrame(size_t index) const {
 
 size_t InMemoryCacheImpl::size() const { return frames_.size(); }
 
+size_t InMemoryCacheImpl::getResidentBytes() const { return resident_bytes_; }
+
+namespace {
+
+// Batch files: header, index of the frames, and the frame blobs.
+constexpr char kBatchMagic[8] = {'K', 'I', 'M', 'E', 'R', 'A', 'F', 'C'};
+// Version 2: the descriptors are only stored as a matrix.
+constexpr uint32_t kBatchVersion = 2u;
+
+struct BatchHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t nr_frames;
+  uint32_t compressed;
+  uint32_t padding;
+};
+
+struct BatchIndexEntry {
+  uint64_t offset;  // From the beginning of the file.
+  uint64_t stored_bytes;
+  uint64_t raw_bytes;
+};
+
+enum class FrameType : uint8_t { kNormal = 0, kStereo = 1 };
+
+template <typename T>
+void append(std::string* blob, const T& value) {
+  static_assert(std::is_trivially_copyable<T>::value, "Not a POD.");
+  blob->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void appendBytes(std::string* blob, const void* data, size_t bytes) {
+  blob->append(reinterpret_cast<const char*>(data), bytes);
+}
+
+void appendMat(std::string* blob, const cv::Mat& mat) {
+  const cv::Mat continuous = mat.isContinuous() ? mat : mat.clone();
+  append(blob, static_cast<int32_t>(continuous.type()));
+  append(blob, static_cast<int32_t>(continuous.dims));
+  for (int i = 0; i < continuous.dims; ++i) {
+    append(blob, static_cast<int32_t>(continuous.size[i]));
+  }
+  const uint64_t bytes = continuous.total() * continuous.elemSize();
+  append(blob, bytes);
+  appendBytes(blob, continuous.data, bytes);
+}
+
+template <typename Vectors>
+void appendVector3s(std::string* blob, const Vectors& vectors) {
+  append(blob, static_cast<uint64_t>(vectors.size()));
+  for (const auto& vector : vectors) {
+    append(blob, vector.x());
+    append(blob, vector.y());
+    append(blob, vector.z());
+  }
+}
+
+void appendStatusKeypoints(std::string* blob,
+                           const StatusKeypointsCV& keypoints) {
+  append(blob, static_cast<uint64_t>(keypoints.size()));
+  for (const StatusKeypointCV& keypoint : keypoints) {
+    append(blob, static_cast<int32_t>(keypoint.first));
+    append(blob, keypoint.second.x);
+    append(blob, keypoint.second.y);
+  }
+}
+
+//! Compact binary layout of a frame: arrays are stored as single blocks.
+std::string encodeFrame(const LCDFrame& frame) {
+  const auto* stereo_frame = dynamic_cast<const StereoLCDFrame*>(&frame);
+  std::string blob;
+  append(&blob,
+         stereo_frame ? FrameType::kStereo : FrameType::kNormal);
+  append(&blob, frame.timestamp_);
+  append(&blob, frame.id_);
+  append(&blob, frame.id_kf_);
+
+  static_assert(std::is_trivially_copyable<cv::KeyPoint>::value,
+                "cv::KeyPoint must be trivially copyable.");
+  append(&blob, static_cast<uint64_t>(frame.keypoints_.size()));
+  appendBytes(&blob,
+              frame.keypoints_.data(),
+              frame.keypoints_.size() * sizeof(cv::KeyPoint));
+  appendVector3s(&blob, frame.keypoints_3d_);
+  // A single block, the descriptors are continuous in the frames.
+  appendMat(&blob, frame.descriptors_mat_);
+  appendVector3s(&blob, frame.bearing_vectors_);
+
+  if (stereo_frame) {
+    appendStatusKeypoints(&blob, stereo_frame->left_keypoints_rectified_);
+    appendStatusKeypoints(&blob, stereo_frame->right_keypoints_rectified_);
+  }
+  return blob;
+}
+
+//! Reads a blob written by encodeFrame.
+class FrameDecoder {
+ public:
+  FrameDecoder(const char* data, size_t bytes) : data_(data), bytes_(bytes) {}
+
+  template <typename T>
+  T read() {
+    T value;
+    readBytes(&value, sizeof(T));
+    return value;
+  }
+
+  void readBytes(void* data, size_t bytes) {
+    CHECK_LE(offset_ + bytes, bytes_) << "Truncated cached frame.";
+    std::memcpy(data, data_ + offset_, bytes);
+    offset_ += bytes;
+  }
+
+  cv::Mat readMat() {
+    const int type = read<int32_t>();
+    const int dims = read<int32_t>();
+    std::vector<int> sizes(dims);
+    for (int& size : sizes) size = read<int32_t>();
+    const uint64_t bytes = read<uint64_t>();
+    // Same as read<cv::Mat>: a default cv::Mat has no dimensions.
+    if (sizes.empty()) return cv::Mat();
+    cv::Mat mat(sizes, type);
+    CHECK_EQ(bytes, mat.total() * mat.elemSize());
+    readBytes(mat.data, bytes);
+    return mat;
+  }
+
+  template <typename Vectors>
+  void readVector3s(Vectors* vectors) {
+    vectors->resize(read<uint64_t>());
+    for (auto& vector : *vectors) {
+      vector.x() = read<double>();
+      vector.y() = read<double>();
+      vector.z() = read<double>();
+    }
+  }
+
+  void readStatusKeypoints(StatusKeypointsCV* keypoints) {
+    keypoints->resize(read<uint64_t>());
+    for (StatusKeypointCV& keypoint : *keypoints) {
+      keypoint.first = static_cast<KeypointStatus>(read<int32_t>());
+      keypoint.second.x = read<float>();
+      keypoint.second.y = read<float>();
+    }
+  }
+
+ private:
+  const char* data_;
+  size_t bytes_;
+  size_t offset_ = 0u;
+};
+
+LCDFrame::Ptr decodeFrame(const char* data, size_t bytes) {
+  FrameDecoder decoder(data, bytes);
+  const FrameType type = decoder.read<FrameType>();
+  CHECK(type == FrameType::kNormal || type == FrameType::kStereo)
+      << "Unknown cached frame type.";
+  StereoLCDFrame::Ptr stereo_frame = nullptr;
+  LCDFrame::Ptr frame = nullptr;
+  if (type == FrameType::kStereo) {
+    stereo_frame = std::make_shared<StereoLCDFrame>();
+    frame = stereo_frame;
+  } else {
+    frame = std::make_shared<LCDFrame>();
+  }
+
+  frame->timestamp_ = decoder.read<Timestamp>();
+  frame->id_ = decoder.read<FrameId>();
+  frame->id_kf_ = decoder.read<FrameId>();
+  frame->keypoints_.resize(decoder.read<uint64_t>());
+  decoder.readBytes(frame->keypoints_.data(),
+                    frame->keypoints_.size() * sizeof(cv::KeyPoint));
+  decoder.readVector3s(&frame->keypoints_3d_);
+  frame->descriptors_mat_ = decoder.readMat();
+  decoder.readVector3s(&frame->bearing_vectors_);
+
+  if (stereo_frame) {
+    decoder.readStatusKeypoints(&stereo_frame->left_keypoints_rectified_);
+    decoder.readStatusKeypoints(&stereo_frame->right_keypoints_rectified_);
+  }
+  return frame;
+}
+
+#ifdef KIMERA_HAS_ZSTD
+std::string compress(const std::string& raw, int level) {
+  std::string compressed(ZSTD_compressBound(raw.size()), '\0');
+  const size_t bytes = ZSTD_compress(
+      &compressed[0], compressed.size(), raw.data(), raw.size(), level);
+  CHECK(!ZSTD_isError(bytes))
+      << "Failed to compress cached frame: " << ZSTD_getErrorName(bytes);
+  compressed.resize(bytes);
+  return compressed;
+}
+
+std::string decompress(const std::string& compressed, size_t raw_bytes) {
+  std::string raw(raw_bytes, '\0');
+  const size_t bytes = ZSTD_decompress(
+      &raw[0], raw.size(), compressed.data(), compressed.size());
+  CHECK(!ZSTD_isError(bytes))
+      << "Failed to decompress cached frame: " << ZSTD_getErrorName(bytes);
+  CHECK_EQ(bytes, raw_bytes);
+  return raw;
+}
+#endif
+
+}  // namespace
+
 LRUCacheImpl::LRUCacheImpl(const FrameCacheConfig& conf) : config(conf) {
   std::filesystem::path cache_root(conf.cache_path);
   const auto cache_path = cache_root / conf.cache_name;
@@ -232,9 +487,40 @@ LRUCacheImpl::LRUCacheImpl(const FrameCacheConfig& conf) : config(conf) {
                << "'";
   }
   LOG(WARNING) << "Using disk-backed cache at '" << cache_path.string() << "'";
+
+  CHECK_GE(config.compression_level, 0);
+#ifdef KIMERA_HAS_ZSTD
+  compress_ = config.compression_level > 0;
+#else
+  LOG_IF(WARNING, config.compression_level > 0)
+      << "Kimera-VIO built without zstd: the frame cache is not compressed.";
+#endif
+
+  if (config.async_write) {
+    writer_ = std::thread(&LRUCacheImpl::writerLoop, this);
+  }
 }
 
 LRUCacheImpl::~LRUCacheImpl() {
+  {
+    std::lock_guard<std::mutex> lock(prefetch_mutex_);
+    shutdown_prefetch_ = true;
+  }
+  prefetch_cv_.notify_all();
+  if (prefetcher_.joinable()) {
+    prefetcher_.join();
+  }
+
+  // Finish writing the pending batches first.
+  {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    shutdown_writer_ = true;
+  }
+  write_cv_.notify_all();
+  if (writer_.joinable()) {
+    writer_.join();
+  }
+
   if (!config.remove_cache_on_exit) {
     return;
   }
@@ -266,17 +552,211 @@ void LRUCacheImpl::cacheLastFrame() {
     return;
   }
 
-  const auto id_to_archive = to_archive_.front()->id_;
-  const auto filepath = getCacheFilepath(id_to_archive);
-  std::ofstream fin(filepath, std::ios::binary);
-  CHECK(fin.good()) << "invalid file: '" << filepath << "'";
-  VLOG(5) << "Archiving " << to_archive_.size() << " frames (starting at "
-          << id_to_archive << ") to '" << filepath << "'";
-  for (const auto& prev : to_archive_) {
-    prev->save(fin);
+  const auto batch_idx = to_archive_.front()->id_ / config.num_frames_per_file;
+  std::vector<LCDFrame::Ptr> batch(to_archive_.begin(), to_archive_.end());
+  to_archive_.clear();
+  if (!config.async_write) {
+    writeBatch(batch_idx, batch);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    pending_batches_.emplace(batch_idx, std::move(batch));
+  }
+  write_cv_.notify_one();
+}
+
+void LRUCacheImpl::writeBatch(size_t batch_idx,
+                              const std::vector<LCDFrame::Ptr>& frames) const {
+  CHECK(!frames.empty());
+  const auto filepath = getCacheFilepath(frames.front()->id_);
+  CHECK_EQ(frames.front()->id_ / config.num_frames_per_file, batch_idx);
+  VLOG(5) << "Archiving " << frames.size() << " frames (starting at "
+          << frames.front()->id_ << ") to '" << filepath << "'";
+
+  std::vector<std::string> blobs;
+  std::vector<BatchIndexEntry> index(frames.size());
+  uint64_t offset =
+      sizeof(BatchHeader) + index.size() * sizeof(BatchIndexEntry);
+  for (size_t i = 0u; i < frames.size(); ++i) {
+    std::string blob = encodeFrame(*frames[i]);
+    index[i].raw_bytes = blob.size();
+#ifdef KIMERA_HAS_ZSTD
+    if (compress_) blob = compress(blob, config.compression_level);
+#endif
+    index[i].offset = offset;
+    index[i].stored_bytes = blob.size();
+    offset += blob.size();
+    blobs.push_back(std::move(blob));
   }
 
-  to_archive_.clear();
+  BatchHeader header;
+  std::memcpy(header.magic, kBatchMagic, sizeof(kBatchMagic));
+  header.version = kBatchVersion;
+  header.nr_frames = static_cast<uint32_t>(frames.size());
+  header.compressed = compress_ ? 1u : 0u;
+  header.padding = 0u;
+
+  // Readers only open the file once it is complete.
+  const std::string tmp_filepath = filepath + ".tmp";
+  {
+    std::ofstream fout(tmp_filepath, std::ios::binary);
+    CHECK(fout.good()) << "invalid file: '" << tmp_filepath << "'";
+    fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    fout.write(reinterpret_cast<const char*>(index.data()),
+               index.size() * sizeof(BatchIndexEntry));
+    for (const std::string& blob : blobs) {
+      fout.write(blob.data(), blob.size());
+    }
+    CHECK(fout.good()) << "Failed to write '" << tmp_filepath << "'";
+  }
+  std::error_code err;
+  std::filesystem::rename(tmp_filepath, filepath, err);
+  CHECK(!err) << "Failed to rename '" << tmp_filepath << "' to '" << filepath
+              << "'";
+}
+
+void LRUCacheImpl::writerLoop() {
+  std::unique_lock<std::mutex> lock(write_mutex_);
+  while (true) {
+    write_cv_.wait(lock, [this] {
+      return shutdown_writer_ || !pending_batches_.empty();
+    });
+    // On shutdown, the pending batches are still written.
+    if (pending_batches_.empty()) break;
+
+    // Keep the batch pending (hence readable) until it is written.
+    const auto batch_iter = pending_batches_.begin();
+    const size_t batch_idx = batch_iter->first;
+    const std::vector<LCDFrame::Ptr> frames = batch_iter->second;
+    lock.unlock();
+    writeBatch(batch_idx, frames);
+    lock.lock();
+    pending_batches_.erase(batch_idx);
+  }
+}
+
+LCDFrame::Ptr LRUCacheImpl::readFrame(size_t index) const {
+  const auto filepath = getCacheFilepath(index);
+  const auto local_idx = index % config.num_frames_per_file;
+  VLOG(5) << "Loading frame " << index << " from '" << filepath << "'";
+  std::ifstream fin(filepath, std::ios::binary);
+  CHECK(fin.good()) << "invalid filepath: '" << filepath << "'";
+
+  BatchHeader header;
+  fin.read(reinterpret_cast<char*>(&header), sizeof(header));
+  CHECK(fin.good()) << "Truncated cache file: '" << filepath << "'";
+  CHECK(std::memcmp(header.magic, kBatchMagic, sizeof(kBatchMagic)) == 0 &&
+        header.version == kBatchVersion)
+      << "Not a frame cache file: '" << filepath << "'";
+  CHECK_LT(local_idx, header.nr_frames);
+#ifndef KIMERA_HAS_ZSTD
+  CHECK_EQ(header.compressed, 0u)
+      << "Compressed cache file, but Kimera-VIO is built without zstd.";
+#endif
+
+  BatchIndexEntry entry;
+  fin.seekg(sizeof(BatchHeader) + local_idx * sizeof(BatchIndexEntry));
+  fin.read(reinterpret_cast<char*>(&entry), sizeof(entry));
+  std::string blob(entry.stored_bytes, '\0');
+  fin.seekg(entry.offset);
+  fin.read(&blob[0], blob.size());
+  CHECK(fin.good()) << "Truncated cache file: '" << filepath << "'";
+
+#ifdef KIMERA_HAS_ZSTD
+  if (header.compressed) blob = decompress(blob, entry.raw_bytes);
+#endif
+  CHECK_EQ(blob.size(), entry.raw_bytes);
+  LCDFrame::Ptr frame = decodeFrame(blob.data(), blob.size());
+  CHECK_EQ(frame->id_, index);
+  return frame;
+}
+
+void LRUCacheImpl::prefetch(const std::vector<size_t>& indices) const {
+  // Only the frames already on disk (or being written) are prefetched.
+  size_t archived_end = total_;
+  if (!to_archive_.empty()) {
+    archived_end = to_archive_.front()->id_;
+  } else if (last_added_) {
+    archived_end = last_added_->id_;
+  }
+
+  std::vector<size_t> to_prefetch;
+  {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    for (const size_t& index : indices) {
+      if (index >= archived_end || entries_.count(index) ||
+          pending_batches_.count(index / config.num_frames_per_file)) {
+        continue;
+      }
+      to_prefetch.push_back(index);
+    }
+  }
+  if (to_prefetch.empty()) return;
+
+  {
+    std::lock_guard<std::mutex> lock(prefetch_mutex_);
+    for (const size_t& index : to_prefetch) {
+      if (prefetched_.count(index) || prefetching_ == index ||
+          std::find(prefetch_queue_.begin(), prefetch_queue_.end(), index) !=
+              prefetch_queue_.end()) {
+        continue;
+      }
+      prefetch_queue_.push_back(index);
+    }
+    if (!prefetcher_.joinable()) {
+      prefetcher_ = std::thread(&LRUCacheImpl::prefetchLoop, this);
+    }
+  }
+  prefetch_cv_.notify_one();
+}
+
+void LRUCacheImpl::prefetchLoop() const {
+  std::unique_lock<std::mutex> lock(prefetch_mutex_);
+  while (true) {
+    prefetch_cv_.wait(lock, [this] {
+      return shutdown_prefetch_ || !prefetch_queue_.empty();
+    });
+    if (shutdown_prefetch_) break;
+
+    const size_t index = prefetch_queue_.front();
+    prefetch_queue_.pop_front();
+    prefetching_ = index;
+    lock.unlock();
+    // readFrame does not touch the cache state.
+    LCDFrame::Ptr frame = readFrame(index);
+    lock.lock();
+    prefetching_.reset();
+    prefetched_[index] = std::move(frame);
+    prefetched_order_.push_back(index);
+    // Bound the frames prefetched but never retrieved.
+    while (prefetched_.size() > static_cast<size_t>(config.max_frames)) {
+      prefetched_.erase(prefetched_order_.front());
+      prefetched_order_.pop_front();
+    }
+    prefetch_cv_.notify_all();
+  }
+}
+
+LCDFrame::Ptr LRUCacheImpl::takePrefetchedFrame(size_t index) const {
+  std::unique_lock<std::mutex> lock(prefetch_mutex_);
+  prefetch_cv_.wait(lock, [this, index] { return prefetching_ != index; });
+  const auto queued_iter =
+      std::find(prefetch_queue_.begin(), prefetch_queue_.end(), index);
+  if (queued_iter != prefetch_queue_.end()) {
+    prefetch_queue_.erase(queued_iter);
+  }
+
+  const auto prefetched_iter = prefetched_.find(index);
+  if (prefetched_iter == prefetched_.end()) {
+    return nullptr;
+  }
+  LCDFrame::Ptr frame = std::move(prefetched_iter->second);
+  prefetched_.erase(prefetched_iter);
+  prefetched_order_.erase(std::find(
+      prefetched_order_.begin(), prefetched_order_.end(), index));
+  return frame;
 }
 
 size_t LRUCacheImpl::addFrame(const LCDFrame::Ptr& frame) {
@@ -338,31 +818,157 @@ LCDFrame::Ptr LRUCacheImpl::getFrame(size_t index) const {
   const auto batch_idx = index / config.num_frames_per_file;
   const auto local_idx = index % config.num_frames_per_file;
 
+  {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    const auto pending_iter = pending_batches_.find(batch_idx);
+    if (pending_iter != pending_batches_.end()) {
+      VLOG(5) << "Retrieved frame " << index << " (hit: pending write)";
+      return pending_iter->second.at(local_idx);
+    }
+  }
+
+  ++nr_accesses_;
   bool miss = false;
-  auto iter = entries_.find(batch_idx);
+  auto iter = entries_.find(index);
   if (iter == entries_.end()) {
-    size_t new_slot = getNextSlot();
     miss = true;
-
-    auto& to_fill = loaded_.at(new_slot);
-    to_fill.resize(config.num_frames_per_file);
-    const auto filepath = getCacheFilepath(index);
-    VLOG(5) << "Loading batch from '" << filepath << "' for frame " << index;
-    std::ifstream fin(filepath, std::ios::binary);
-    CHECK(fin.good()) << "invalid filepath: '" << filepath << "'";
-    for (auto& frame : to_fill) {
-      frame = LCDFrame::load(fin);
+    LCDFrame::Ptr frame = takePrefetchedFrame(index);
+    if (frame) {
+      ++nr_prefetch_hits_;
+    } else {
+      frame = readFrame(index);
     }
-
-    CacheEntry entry{new_slot, total_};
-    iter = entries_.emplace(batch_idx, entry).first;
+    size_t new_slot = getNextSlot();
+    loaded_.at(new_slot) = frame;
+    CacheEntry entry{new_slot, nr_accesses_};
+    iter = entries_.emplace(index, entry).first;
   }
 
   VLOG(5) << "Retrieved frame " << index << (miss ? " (miss)" : " (hit)");
-  iter->second.last_used = total_;
-  return loaded_.at(iter->second.slot).at(local_idx);
+  iter->second.last_used = nr_accesses_;
+  return loaded_.at(iter->second.slot);
 }
 
 size_t LRUCacheImpl::size() const { return total_; }
 
+size_t LRUCacheImpl::getResidentBytes() const {
+  size_t bytes = last_added_ ? getFrameBytes(*last_added_) : 0u;
+  for (const auto& frame : to_archive_) {
+    bytes += getFrameBytes(*frame);
+  }
+  for (const auto& frame : loaded_) {
+    if (frame) bytes += getFrameBytes(*frame);
+  }
+  {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    for (const auto& batch : pending_batches_) {
+      for (const auto& frame : batch.second) {
+        bytes += getFrameBytes(*frame);
+      }
+    }
+  }
+  std::lock_guard<std::mutex> lock(prefetch_mutex_);
+  for (const auto& prefetched : prefetched_) {
+    bytes += getFrameBytes(*prefetched.second);
+  }
+  return bytes;
+}
+
+namespace {
+
+LCDFrame::Ptr copyFrame(const LCDFrame& frame) {
+  const auto* stereo_frame = dynamic_cast<const StereoLCDFrame*>(&frame);
+  if (stereo_frame) {
+    return std::make_shared<StereoLCDFrame>(*stereo_frame);
+  }
+  return std::make_shared<LCDFrame>(frame);
+}
+
+FrameCacheConfig getSpilledCacheConfig(const FrameCacheConfig& config) {
+  FrameCacheConfig spilled_config = config;
+  if (spilled_config.max_frames <= 0) {
+    spilled_config.max_frames = config.num_frames_per_file;
+  }
+  spilled_config.cache_name += "_spilled";
+  return spilled_config;
+}
+
+}  // namespace
+
+MemoryBudgetCacheImpl::MemoryBudgetCacheImpl(const FrameCacheConfig& conf)
+    : config(conf),
+      spilled_(std::make_unique<LRUCacheImpl>(getSpilledCacheConfig(conf))) {
+  CHECK_GT(config.max_resident_bytes, 0);
+}
+
+size_t MemoryBudgetCacheImpl::addFrame(const LCDFrame::Ptr& frame) {
+  const auto new_id = frames_.size();
+  frame->id_ = new_id;
+  frames_.push_back(frame);
+  resident_bytes_ += getFrameBytes(*frame);
+  while (resident_bytes_ > static_cast<size_t>(config.max_resident_bytes) &&
+         nr_spilled_ + 1u < frames_.size()) {
+    spillOldestFrame();
+  }
+  LOG_IF_EVERY_N(WARNING,
+                 resident_bytes_ >
+                     static_cast<size_t>(config.max_resident_bytes),
+                 100)
+      << "LCD frame cache over its memory budget with only keypoints and "
+         "descriptors resident: "
+      << resident_bytes_ << " bytes.";
+  return new_id;
+}
+
+void MemoryBudgetCacheImpl::spillOldestFrame() {
+  const LCDFrame::Ptr& frame = frames_.at(nr_spilled_);
+  auto spilled_frame = std::make_shared<LCDFrame>();
+  spilled_frame->timestamp_ = frame->timestamp_;
+  spilled_frame->id_kf_ = frame->id_kf_;
+  spilled_frame->keypoints_3d_ = frame->keypoints_3d_;
+  spilled_frame->bearing_vectors_ = frame->bearing_vectors_;
+  CHECK_EQ(spilled_->addFrame(spilled_frame), nr_spilled_);
+
+  // The caller may still hold the frame: do not modify it.
+  LCDFrame::Ptr resident_frame = copyFrame(*frame);
+  resident_frame->keypoints_3d_ = Landmarks();
+  resident_frame->bearing_vectors_ = BearingVectors();
+  resident_bytes_ -= getFrameBytes(*frame);
+  resident_bytes_ += getFrameBytes(*resident_frame);
+  frames_.at(nr_spilled_) = resident_frame;
+  VLOG(5) << "Spilled frame " << nr_spilled_ << " to disk.";
+  ++nr_spilled_;
+}
+
+LCDFrame::Ptr MemoryBudgetCacheImpl::getFrame(size_t index) const {
+  if (index >= frames_.size()) {
+    return nullptr;
+  }
+  if (index >= nr_spilled_) {
+    return frames_.at(index);
+  }
+
+  const LCDFrame::Ptr spilled_frame = spilled_->getFrame(index);
+  CHECK(spilled_frame);
+  LCDFrame::Ptr frame = copyFrame(*frames_.at(index));
+  frame->keypoints_3d_ = spilled_frame->keypoints_3d_;
+  frame->bearing_vectors_ = spilled_frame->bearing_vectors_;
+  return frame;
+}
+
+void MemoryBudgetCacheImpl::prefetch(
+    const std::vector<size_t>& indices) const {
+  std::vector<size_t> spilled_indices;
+  for (const size_t& index : indices) {
+    if (index < nr_spilled_) spilled_indices.push_back(index);
+  }
+  if (!spilled_indices.empty()) spilled_->prefetch(spilled_indices);
+}
+
+size_t MemoryBudgetCacheImpl::size() const { return frames_.size(); }
+
+size_t MemoryBudgetCacheImpl::getResidentBytes() const {
+  return resident_bytes_ + spilled_->getResidentBytes();
+}
+
 }  // namespace VIO
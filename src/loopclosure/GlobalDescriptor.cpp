@@ -0,0 +1,120 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   GlobalDescriptor.cpp
+ * @brief  Compact global image descriptors aggregating ORB descriptors.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/loopclosure/GlobalDescriptor.h"
+
+#include <cmath>
+#include <limits>
+
+#include <glog/logging.h>
+
+#include "kimera-vio/loopclosure/OrbHammingMatcher.h"
+
+namespace VIO {
+
+namespace {
+//! L2-normalizes the values, if not all zero.
+void normalize(float* values, const size_t& size) {
+  double norm = 0.0;
+  for (size_t i = 0u; i < size; ++i) norm += values[i] * values[i];
+  if (norm <= 0.0) return;
+  const float scale = static_cast<float>(1.0 / std::sqrt(norm));
+  for (size_t i = 0u; i < size; ++i) values[i] *= scale;
+}
+}  // namespace
+
+GlobalDescriptorExtractor::GlobalDescriptorExtractor(const cv::Mat& centers,
+                                                     const cv::Mat& bit_means,
+                                                     const int& projection_dim)
+    : centers_(centers.clone()),
+      bit_means_(bit_means.clone()),
+      vlad_dim_(static_cast<size_t>(centers.rows) * kOrbDescriptorBits),
+      projection_(),
+      dim_(vlad_dim_) {
+  CHECK_GT(centers_.rows, 0);
+  CHECK_EQ(centers_.type(), CV_8U);
+  CHECK_EQ(centers_.cols, kOrbDescriptorBytes);
+  CHECK_EQ(bit_means_.type(), CV_32F);
+  CHECK_EQ(bit_means_.rows, centers_.rows);
+  CHECK_EQ(bit_means_.cols, kOrbDescriptorBits);
+  if (projection_dim > 0 && static_cast<size_t>(projection_dim) < vlad_dim_) {
+    // Fixed seed: descriptors must stay comparable across runs (e.g. maps).
+    projection_.create(projection_dim, static_cast<int>(vlad_dim_), CV_32F);
+    cv::RNG rng(42u);
+    rng.fill(projection_, cv::RNG::NORMAL, 0.0, 1.0);
+    dim_ = static_cast<size_t>(projection_dim);
+  }
+}
+
+std::vector<float> GlobalDescriptorExtractor::compute(
+    const cv::Mat& descriptors) const {
+  cv::Mat vlad = cv::Mat::zeros(1, static_cast<int>(vlad_dim_), CV_32F);
+  if (!descriptors.empty()) {
+    CHECK_EQ(descriptors.type(), CV_8U);
+    CHECK_EQ(descriptors.cols, kOrbDescriptorBytes);
+  }
+  float* vlad_data = vlad.ptr<float>();
+  for (int i = 0; i < descriptors.rows; ++i) {
+    const uchar* descriptor = descriptors.ptr<uchar>(i);
+    int best_center = 0;
+    int best_distance = std::numeric_limits<int>::max();
+    for (int c = 0; c < centers_.rows; ++c) {
+      const int distance = static_cast<int>(
+          orbHammingDistance(descriptor, centers_.ptr<uchar>(c)));
+      if (distance < best_distance) {
+        best_distance = distance;
+        best_center = c;
+      }
+    }
+    const float* means = bit_means_.ptr<float>(best_center);
+    float* residuals = vlad_data + best_center * kOrbDescriptorBits;
+    for (int b = 0; b < kOrbDescriptorBits; ++b) {
+      const bool bit = descriptor[b / 8] & (1u << (b % 8));
+      residuals[b] += (bit ? 1.0f : 0.0f) - means[b];
+    }
+  }
+
+  // Power law and intra-normalization (Arandjelovic and Zisserman, 2013):
+  // bursty features and dense clusters do not dominate the similarity.
+  for (size_t i = 0u; i < vlad_dim_; ++i) {
+    vlad_data[i] = std::copysign(std::sqrt(std::abs(vlad_data[i])),
+                                 vlad_data[i]);
+  }
+  for (int c = 0; c < centers_.rows; ++c) {
+    normalize(vlad_data + c * kOrbDescriptorBits, kOrbDescriptorBits);
+  }
+  normalize(vlad_data, vlad_dim_);
+
+  std::vector<float> global_descriptor(dim_);
+  if (projection_.empty()) {
+    global_descriptor.assign(vlad_data, vlad_data + vlad_dim_);
+  } else {
+    cv::Mat projected(static_cast<int>(dim_), 1, CV_32F,
+                      global_descriptor.data());
+    cv::gemm(projection_, vlad, 1.0, cv::noArray(), 0.0, projected,
+             cv::GEMM_2_T);
+  }
+  normalize(global_descriptor.data(), dim_);
+  return global_descriptor;
+}
+
+float GlobalDescriptorExtractor::similarity(const std::vector<float>& a,
+                                            const std::vector<float>& b) {
+  CHECK_EQ(a.size(), b.size());
+  float dot = 0.0f;
+  for (size_t i = 0u; i < a.size(); ++i) dot += a[i] * b[i];
+  return dot;
+}
+
+}  // namespace VIO
@@ -0,0 +1,90 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   GpuOrbExtractor.cpp
+ * @brief  ORB feature extraction on the GPU (OpenCV CUDA) for the LCD.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/loopclosure/GpuOrbExtractor.h"
+
+#include <glog/logging.h>
+
+#ifdef KIMERA_HAS_CUDA_ORB
+#include <opencv2/core/cuda.hpp>
+#include <opencv2/cudafeatures2d.hpp>
+#endif
+
+namespace VIO {
+
+#ifdef KIMERA_HAS_CUDA_ORB
+struct GpuOrbExtractor::Impl {
+  cv::Ptr<cv::cuda::ORB> orb;
+  cv::cuda::Stream stream;
+  cv::cuda::HostMem pinned_img{cv::cuda::HostMem::PAGE_LOCKED};
+  cv::cuda::GpuMat d_img;
+  cv::cuda::GpuMat d_keypoints;
+  cv::cuda::GpuMat d_descriptors;
+};
+#else
+struct GpuOrbExtractor::Impl {};
+#endif
+
+GpuOrbExtractor::GpuOrbExtractor(const LoopClosureDetectorParams& params)
+    : impl_(std::make_unique<Impl>()) {
+  CHECK(isAvailable()) << "GpuOrbExtractor: no CUDA device, or Kimera-VIO "
+                          "built without OpenCV's cudafeatures2d.";
+#ifdef KIMERA_HAS_CUDA_ORB
+  impl_->orb = cv::cuda::ORB::create(params.nfeatures_,
+                                     params.scale_factor_,
+                                     params.nlevels_,
+                                     params.edge_threshold_,
+                                     params.first_level_,
+                                     params.WTA_K_,
+                                     static_cast<int>(params.score_type_),
+                                     params.patch_sze_,
+                                     params.fast_threshold_);
+#endif
+}
+
+GpuOrbExtractor::~GpuOrbExtractor() = default;
+
+bool GpuOrbExtractor::isAvailable() {
+#ifdef KIMERA_HAS_CUDA_ORB
+  return cv::cuda::getCudaEnabledDeviceCount() > 0;
+#else
+  return false;
+#endif
+}
+
+void GpuOrbExtractor::detectAndCompute(const cv::Mat& img,
+                                       std::vector<cv::KeyPoint>* keypoints,
+                                       OrbDescriptor* descriptors) {
+  CHECK_NOTNULL(keypoints);
+  CHECK_NOTNULL(descriptors);
+  CHECK_EQ(img.type(), CV_8UC1) << "GpuOrbExtractor: expects grayscale images.";
+#ifdef KIMERA_HAS_CUDA_ORB
+  // Reallocated only if the image size changes.
+  impl_->pinned_img.create(img.rows, img.cols, img.type());
+  cv::Mat pinned_header = impl_->pinned_img.createMatHeader();
+  img.copyTo(pinned_header);
+  impl_->d_img.upload(impl_->pinned_img, impl_->stream);
+  impl_->orb->detectAndComputeAsync(impl_->d_img,
+                                    cv::noArray(),
+                                    impl_->d_keypoints,
+                                    impl_->d_descriptors,
+                                    false,
+                                    impl_->stream);
+  impl_->stream.waitForCompletion();
+  impl_->orb->convert(impl_->d_keypoints, *keypoints);
+  impl_->d_descriptors.download(*descriptors);
+#endif
+}
+
+}  // namespace VIO
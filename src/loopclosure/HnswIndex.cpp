@@ -0,0 +1,237 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   HnswIndex.cpp
+ * @brief  Approximate nearest neighbor index of unit vectors (HNSW).
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/loopclosure/HnswIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+HnswIndex::HnswIndex(const size_t& dim, const HnswParams& params)
+    : dim_(dim),
+      params_(params),
+      level_multiplier_(1.0 / std::log(static_cast<double>(params.M))),
+      rng_(42u),
+      data_(),
+      labels_(),
+      links_(),
+      entry_point_(0u),
+      max_level_(-1) {
+  CHECK_GT(dim_, 0u);
+  CHECK_GE(params_.M, 2);
+  CHECK_GT(params_.ef_construction, 0);
+  CHECK_GT(params_.ef_search, 0);
+}
+
+void HnswIndex::add(const Label& label, const std::vector<float>& vector) {
+  CHECK_EQ(vector.size(), dim_);
+  const NodeId node = static_cast<NodeId>(labels_.size());
+  data_.insert(data_.end(), vector.begin(), vector.end());
+  labels_.push_back(label);
+
+  // Exponentially decaying probability of each level.
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  const int level = static_cast<int>(
+      -std::log(std::max(uniform(rng_), 1e-12)) * level_multiplier_);
+  links_.emplace_back(level + 1);
+  if (max_level_ < 0) {
+    entry_point_ = node;
+    max_level_ = level;
+    return;
+  }
+
+  const float* query = getVector(node);
+  NodeId entry = entry_point_;
+  for (int l = max_level_; l > level; --l) {
+    entry = searchGreedy(query, entry, l);
+  }
+  for (int l = std::min(level, max_level_); l >= 0; --l) {
+    MaxHeap candidates =
+        searchLevel(query,
+                    entry,
+                    static_cast<size_t>(params_.ef_construction),
+                    l,
+                    std::numeric_limits<Label>::max());
+    // The closest candidate is the entry of the next level.
+    MaxHeap closest = candidates;
+    while (closest.size() > 1u) closest.pop();
+    entry = closest.top().second;
+
+    links_[node][l] = selectNeighbors(std::move(candidates),
+                                      static_cast<size_t>(params_.M));
+    for (const NodeId& neighbor : links_[node][l]) {
+      connect(neighbor, node, l);
+    }
+  }
+  if (level > max_level_) {
+    entry_point_ = node;
+    max_level_ = level;
+  }
+}
+
+void HnswIndex::search(const std::vector<float>& query,
+                       const size_t& k,
+                       const Label& max_label,
+                       std::vector<Result>* results) const {
+  CHECK_NOTNULL(results);
+  CHECK_EQ(query.size(), dim_);
+  results->clear();
+  if (max_level_ < 0 || k == 0u) return;
+
+  NodeId entry = entry_point_;
+  for (int l = max_level_; l > 0; --l) {
+    entry = searchGreedy(query.data(), entry, l);
+  }
+  MaxHeap candidates =
+      searchLevel(query.data(),
+                  entry,
+                  std::max(static_cast<size_t>(params_.ef_search), k),
+                  0,
+                  max_label);
+  while (candidates.size() > k) candidates.pop();
+  results->resize(candidates.size());
+  for (size_t i = candidates.size(); i > 0u; --i) {
+    const Candidate& candidate = candidates.top();
+    (*results)[i - 1u] = {labels_[candidate.second], 1.0f - candidate.first};
+    candidates.pop();
+  }
+}
+
+size_t HnswIndex::getMemoryBytes() const {
+  size_t bytes = data_.capacity() * sizeof(float) +
+                 labels_.capacity() * sizeof(Label) +
+                 links_.capacity() * sizeof(links_[0]);
+  for (const std::vector<std::vector<NodeId>>& levels : links_) {
+    bytes += levels.capacity() * sizeof(levels[0]);
+    for (const std::vector<NodeId>& neighbors : levels) {
+      bytes += neighbors.capacity() * sizeof(NodeId);
+    }
+  }
+  return bytes;
+}
+
+float HnswIndex::distance(const float* a, const float* b) const {
+  float dot = 0.0f;
+  for (size_t i = 0u; i < dim_; ++i) dot += a[i] * b[i];
+  return 1.0f - dot;
+}
+
+HnswIndex::NodeId HnswIndex::searchGreedy(const float* query,
+                                          NodeId entry,
+                                          const int& level) const {
+  float entry_distance = distance(query, getVector(entry));
+  bool improved = true;
+  while (improved) {
+    improved = false;
+    for (const NodeId& neighbor : links_[entry][level]) {
+      const float neighbor_distance = distance(query, getVector(neighbor));
+      if (neighbor_distance < entry_distance) {
+        entry = neighbor;
+        entry_distance = neighbor_distance;
+        improved = true;
+      }
+    }
+  }
+  return entry;
+}
+
+HnswIndex::MaxHeap HnswIndex::searchLevel(const float* query,
+                                          const NodeId& entry,
+                                          const size_t& ef,
+                                          const int& level,
+                                          const Label& max_label) const {
+  // Nodes to expand, closest first, and best nodes found, farthest first.
+  std::priority_queue<Candidate,
+                      std::vector<Candidate>,
+                      std::greater<Candidate>>
+      to_expand;
+  MaxHeap best;
+  // A bit per node: clearing it is negligible next to the distances.
+  std::vector<bool> visited(labels_.size(), false);
+
+  const float entry_distance = distance(query, getVector(entry));
+  to_expand.emplace(entry_distance, entry);
+  if (labels_[entry] < max_label) best.emplace(entry_distance, entry);
+  visited[entry] = true;
+
+  while (!to_expand.empty()) {
+    const Candidate current = to_expand.top();
+    if (best.size() >= ef && current.first > best.top().first) break;
+    to_expand.pop();
+    for (const NodeId& neighbor : links_[current.second][level]) {
+      if (visited[neighbor]) continue;
+      visited[neighbor] = true;
+      const float neighbor_distance = distance(query, getVector(neighbor));
+      if (best.size() < ef || neighbor_distance < best.top().first) {
+        // Filtered out nodes are still traversed, as paths to the others.
+        to_expand.emplace(neighbor_distance, neighbor);
+        if (labels_[neighbor] < max_label) {
+          best.emplace(neighbor_distance, neighbor);
+          if (best.size() > ef) best.pop();
+        }
+      }
+    }
+  }
+  return best;
+}
+
+std::vector<HnswIndex::NodeId> HnswIndex::selectNeighbors(
+    MaxHeap candidates,
+    const size_t& max_neighbors) const {
+  std::vector<Candidate> sorted;
+  sorted.reserve(candidates.size());
+  while (!candidates.empty()) {
+    sorted.push_back(candidates.top());
+    candidates.pop();
+  }
+  std::reverse(sorted.begin(), sorted.end());
+
+  std::vector<NodeId> neighbors;
+  for (const Candidate& candidate : sorted) {
+    if (neighbors.size() >= max_neighbors) break;
+    const float* vector = getVector(candidate.second);
+    bool keep = true;
+    for (const NodeId& neighbor : neighbors) {
+      if (distance(vector, getVector(neighbor)) < candidate.first) {
+        keep = false;
+        break;
+      }
+    }
+    if (keep) neighbors.push_back(candidate.second);
+  }
+  return neighbors;
+}
+
+void HnswIndex::connect(const NodeId& neighbor,
+                        const NodeId& node,
+                        const int& level) {
+  std::vector<NodeId>& neighbors = links_[neighbor][level];
+  neighbors.push_back(node);
+  const size_t max_neighbors = maxNeighbors(level);
+  if (neighbors.size() <= max_neighbors) return;
+
+  MaxHeap candidates;
+  const float* vector = getVector(neighbor);
+  for (const NodeId& other : neighbors) {
+    candidates.emplace(distance(vector, getVector(other)), other);
+  }
+  neighbors = selectNeighbors(std::move(candidates), max_neighbors);
+}
+
+}  // namespace VIO
@@ -0,0 +1,157 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   IncrementalPcm.cpp
+ * @brief  Pairwise consistency maximization of the loop closures, restricted
+ * to a window of recent loop closures in the same region.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/loopclosure/IncrementalPcm.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+IncrementalPcm::IncrementalPcm(const IncrementalPcmParams& params)
+    : params_(params),
+      W_Pose_B_(),
+      loop_closures_(),
+      nr_accepted_(0u),
+      nr_checks_(0u) {
+  CHECK_GT(params_.window_size, 0);
+  CHECK_GE(params_.region_radius, 0.0);
+  CHECK_GT(params_.min_clique_size, 0);
+}
+
+void IncrementalPcm::addOdometry(const FrameId& key,
+                                 const gtsam::Pose3& W_Pose_B) {
+  CHECK_EQ(key, W_Pose_B_.size()) << "Keyframes must be consecutive.";
+  W_Pose_B_.push_back(W_Pose_B);
+}
+
+std::vector<size_t> IncrementalPcm::addLoopClosure(
+    const FrameId& ref_key,
+    const FrameId& cur_key,
+    const gtsam::Pose3& ref_Pose_cur) {
+  CHECK_LT(ref_key, W_Pose_B_.size());
+  CHECK_LT(cur_key, W_Pose_B_.size());
+  const size_t index = loop_closures_.size();
+  loop_closures_.push_back({ref_key, cur_key, ref_Pose_cur, false, {}});
+
+  std::vector<size_t> group = getGroup(index);
+  group.push_back(index);
+  const std::vector<size_t> clique = findMaxClique(group);
+  std::vector<size_t> accepted;
+  if (clique.size() < static_cast<size_t>(params_.min_clique_size) ||
+      std::find(clique.begin(), clique.end(), index) == clique.end()) {
+    VLOG(5) << "IncrementalPcm: loop closure " << ref_key << " - " << cur_key
+            << " rejected (consistent set of " << clique.size() << ").";
+    return accepted;
+  }
+  for (const size_t& i : clique) {
+    if (!loop_closures_[i].accepted) {
+      loop_closures_[i].accepted = true;
+      accepted.push_back(i);
+    }
+  }
+  std::sort(accepted.begin(), accepted.end());
+  nr_accepted_ += accepted.size();
+  return accepted;
+}
+
+std::vector<size_t> IncrementalPcm::getGroup(const size_t& index) const {
+  const size_t window = static_cast<size_t>(params_.window_size);
+  const size_t begin = index > window ? index - window : 0u;
+  const gtsam::Point3& ref_position =
+      W_Pose_B_[loop_closures_[index].ref_key].translation();
+  std::vector<size_t> group;
+  group.reserve(index - begin);
+  for (size_t i = begin; i < index; ++i) {
+    if (params_.region_radius > 0.0 &&
+        (W_Pose_B_[loop_closures_[i].ref_key].translation() - ref_position)
+                .norm() > params_.region_radius) {
+      continue;
+    }
+    group.push_back(i);
+  }
+  return group;
+}
+
+bool IncrementalPcm::areConsistent(const size_t& i, const size_t& j) {
+  CHECK_NE(i, j);
+  // Cached in the most recent one.
+  LoopClosure& latest = loop_closures_[std::max(i, j)];
+  const size_t other = std::min(i, j);
+  const auto cached = latest.consistent_with.find(other);
+  if (cached != latest.consistent_with.end()) return cached->second;
+
+  // Cycle ref_a -> cur_a -> cur_b -> ref_b -> ref_a, where the loop closures
+  // close the odometry: identity if both are right.
+  const LoopClosure& a = loop_closures_[other];
+  const LoopClosure& b = latest;
+  const gtsam::Pose3 cur_a_Pose_cur_b =
+      W_Pose_B_[a.cur_key].between(W_Pose_B_[b.cur_key]);
+  const gtsam::Pose3 ref_b_Pose_ref_a =
+      W_Pose_B_[b.ref_key].between(W_Pose_B_[a.ref_key]);
+  const gtsam::Pose3 error = a.ref_Pose_cur * cur_a_Pose_cur_b *
+                             b.ref_Pose_cur.inverse() * ref_b_Pose_ref_a;
+  const bool consistent =
+      error.translation().norm() < params_.trans_threshold &&
+      error.rotation().axisAngle().second < params_.rot_threshold;
+  latest.consistent_with.emplace(other, consistent);
+  ++nr_checks_;
+  return consistent;
+}
+
+std::vector<size_t> IncrementalPcm::findMaxClique(
+    const std::vector<size_t>& group) {
+  // Consistent neighbours of each loop closure in the group (sorted).
+  std::vector<std::vector<size_t>> neighbours(group.size());
+  for (size_t i = 0u; i < group.size(); ++i) {
+    for (size_t j = i + 1u; j < group.size(); ++j) {
+      if (areConsistent(group[i], group[j])) {
+        neighbours[i].push_back(j);
+        neighbours[j].push_back(i);
+      }
+    }
+  }
+
+  // Greedy: grow a clique from each loop closure, adding its neighbours by
+  // decreasing degree, unless it can not beat the best clique.
+  const auto by_degree = [&neighbours](const size_t& lhs, const size_t& rhs) {
+    return neighbours[lhs].size() > neighbours[rhs].size();
+  };
+  std::vector<size_t> best;
+  for (size_t seed = 0u; seed < group.size(); ++seed) {
+    if (neighbours[seed].size() + 1u <= best.size()) continue;
+    std::vector<size_t> candidates = neighbours[seed];
+    std::sort(candidates.begin(), candidates.end(), by_degree);
+    std::vector<size_t> clique{seed};
+    for (const size_t& candidate : candidates) {
+      const bool consistent_with_clique = std::all_of(
+          clique.begin(), clique.end(), [&](const size_t& member) {
+            return std::binary_search(neighbours[member].begin(),
+                                      neighbours[member].end(),
+                                      candidate);
+          });
+      if (consistent_with_clique) clique.push_back(candidate);
+    }
+    if (clique.size() > best.size()) best = clique;
+  }
+
+  std::vector<size_t> max_clique;
+  max_clique.reserve(best.size());
+  for (const size_t& i : best) max_clique.push_back(group[i]);
+  return max_clique;
+}
+
+}  // namespace VIO
@@ -0,0 +1,255 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   IncrementalPgo.cpp
+ * @brief  Incremental (iSAM2) pose graph optimization of the LCD keyframes,
+ * with sparsified odometry chains and a bounded solve time.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/loopclosure/IncrementalPgo.h"
+
+#include <chrono>
+
+#include <glog/logging.h>
+
+#include <gtsam/inference/Symbol.h>
+#include <gtsam/slam/BetweenFactor.h>
+#include <gtsam/slam/PriorFactor.h>
+
+#include "kimera-vio/utils/Timer.h"
+
+namespace VIO {
+
+IncrementalPgo::IncrementalPgo(const IncrementalPgoParams& params)
+    : params_(params),
+      isam_(nullptr),
+      keyframes_(),
+      last_node_(0),
+      nr_nodes_(0u),
+      chain_covariance_(gtsam::Matrix6::Zero()),
+      nr_chained_keyframes_(0),
+      pending_factors_(),
+      pending_values_(),
+      pending_loop_closures_(),
+      nr_loop_closures_(0u),
+      last_solve_time_ms_(0.0),
+      estimate_cache_(std::nullopt) {
+  CHECK_GE(params_.min_node_translation, 0.0);
+  CHECK_GE(params_.min_node_rotation, 0.0);
+  CHECK_GT(params_.max_keyframes_between_nodes, 0);
+  CHECK_GE(params_.max_solve_iterations, 0);
+  CHECK_GE(params_.loop_closure_cauchy_width, 0.0);
+  gtsam::ISAM2Params isam_params;
+  isam_params.relinearizeThreshold = params_.relinearize_threshold;
+  isam_params.relinearizeSkip = 1;
+  isam_ = std::make_unique<gtsam::ISAM2>(isam_params);
+}
+
+void IncrementalPgo::initialize(const FrameId& key,
+                                const gtsam::Pose3& W_Pose_B,
+                                const gtsam::SharedNoiseModel& noise) {
+  CHECK(keyframes_.empty()) << "IncrementalPgo already initialized.";
+  CHECK_EQ(key, 0u);
+  keyframes_.push_back(KeyframeAnchor{key, gtsam::Pose3()});
+  last_node_ = key;
+  nr_nodes_ = 1u;
+  pending_values_.insert(gtsam::Symbol(key), W_Pose_B);
+  pending_factors_.add(
+      gtsam::PriorFactor<gtsam::Pose3>(gtsam::Symbol(key), W_Pose_B, noise));
+  update(false);
+}
+
+void IncrementalPgo::addOdometry(const FrameId& key,
+                                 const gtsam::Pose3& Blkf_Pose_Bkf,
+                                 const gtsam::SharedNoiseModel& noise) {
+  CHECK(!keyframes_.empty()) << "IncrementalPgo not initialized.";
+  CHECK_EQ(key, keyframes_.size());
+  const auto* gaussian =
+      dynamic_cast<const gtsam::noiseModel::Gaussian*>(noise.get());
+  CHECK(gaussian) << "IncrementalPgo: odometry noise must be Gaussian.";
+
+  // Chain the odometry wrt the last node.
+  const KeyframeAnchor& last_keyframe = keyframes_.back();
+  keyframes_.push_back(KeyframeAnchor{
+      last_node_, last_keyframe.node_Pose_kf.compose(Blkf_Pose_Bkf)});
+  // Transport the chain covariance to the new keyframe (right perturbation:
+  // node_T_kf exp(xi) Blkf_T_Bkf = node_T_kf Blkf_T_Bkf exp(Ad(Blkf_T_Bkf^-1)
+  // xi)), before adding the one of the new odometry.
+  const gtsam::Matrix6 adjoint = Blkf_Pose_Bkf.inverse().AdjointMap();
+  chain_covariance_ = adjoint * chain_covariance_ * adjoint.transpose() +
+                      gaussian->covariance();
+  ++nr_chained_keyframes_;
+
+  if (isNodeNeeded(keyframes_.back().node_Pose_kf)) addNode(key);
+}
+
+void IncrementalPgo::addLoopClosure(const FrameId& ref_key,
+                                    const FrameId& cur_key,
+                                    const gtsam::Pose3& ref_Pose_cur,
+                                    const gtsam::SharedNoiseModel& noise,
+                                    const bool& optimize) {
+  CHECK_LT(ref_key, keyframes_.size());
+  CHECK_LT(cur_key, keyframes_.size());
+  // The latest keyframe may not be a node yet: it has no successor, hence
+  // it can become one right away.
+  const FrameId latest_key = keyframes_.size() - 1u;
+  if ((ref_key == latest_key || cur_key == latest_key) &&
+      keyframes_.back().node != latest_key) {
+    addNode(latest_key);
+  }
+
+  const KeyframeAnchor& ref = keyframes_.at(ref_key);
+  const KeyframeAnchor& cur = keyframes_.at(cur_key);
+  if (ref.node == cur.node) {
+    VLOG(1) << "IncrementalPgo: loop closure between keyframes " << ref_key
+            << " and " << cur_key << " of the same node, ignoring it.";
+    return;
+  }
+  const gtsam::Pose3 refNode_Pose_curNode = ref.node_Pose_kf.compose(
+      ref_Pose_cur.compose(cur.node_Pose_kf.inverse()));
+
+  gtsam::SharedNoiseModel lc_noise = noise;
+  if (params_.loop_closure_cauchy_width > 0.0) {
+    lc_noise = gtsam::noiseModel::Robust::Create(
+        gtsam::noiseModel::mEstimator::Cauchy::Create(
+            params_.loop_closure_cauchy_width),
+        noise);
+  }
+  pending_loop_closures_.add(
+      gtsam::BetweenFactor<gtsam::Pose3>(gtsam::Symbol(ref.node),
+                                         gtsam::Symbol(cur.node),
+                                         refNode_Pose_curNode,
+                                         lc_noise));
+  ++nr_loop_closures_;
+
+  if (optimize) update(true);
+}
+
+void IncrementalPgo::addPrior(const FrameId& key,
+                              const gtsam::Pose3& W_Pose_B,
+                              const gtsam::SharedNoiseModel& noise,
+                              const bool& optimize) {
+  CHECK_LT(key, keyframes_.size());
+  const FrameId latest_key = keyframes_.size() - 1u;
+  if (key == latest_key && keyframes_.back().node != latest_key) {
+    addNode(latest_key);
+  }
+
+  const KeyframeAnchor& keyframe = keyframes_.at(key);
+  gtsam::SharedNoiseModel prior_noise = noise;
+  if (params_.loop_closure_cauchy_width > 0.0) {
+    prior_noise = gtsam::noiseModel::Robust::Create(
+        gtsam::noiseModel::mEstimator::Cauchy::Create(
+            params_.loop_closure_cauchy_width),
+        noise);
+  }
+  pending_loop_closures_.add(gtsam::PriorFactor<gtsam::Pose3>(
+      gtsam::Symbol(keyframe.node),
+      W_Pose_B.compose(keyframe.node_Pose_kf.inverse()),
+      prior_noise));
+  ++nr_loop_closures_;
+
+  if (optimize) update(true);
+}
+
+gtsam::Values IncrementalPgo::calculateEstimate() const {
+  if (!estimate_cache_) {
+    gtsam::Values estimate;
+    if (!keyframes_.empty()) {
+      const gtsam::Values nodes_estimate = isam_->calculateEstimate();
+      for (size_t key = 0u; key < keyframes_.size(); ++key) {
+        const KeyframeAnchor& keyframe = keyframes_[key];
+        estimate.insert(
+            gtsam::Symbol(key),
+            nodes_estimate.at<gtsam::Pose3>(gtsam::Symbol(keyframe.node))
+                .compose(keyframe.node_Pose_kf));
+      }
+    }
+    estimate_cache_ = std::move(estimate);
+  }
+  return *estimate_cache_;
+}
+
+gtsam::Pose3 IncrementalPgo::calculateEstimate(const FrameId& key) const {
+  CHECK_LT(key, keyframes_.size());
+  if (estimate_cache_) {
+    return estimate_cache_->at<gtsam::Pose3>(gtsam::Symbol(key));
+  }
+  const KeyframeAnchor& keyframe = keyframes_[key];
+  return isam_->calculateEstimate<gtsam::Pose3>(gtsam::Symbol(keyframe.node))
+      .compose(keyframe.node_Pose_kf);
+}
+
+gtsam::NonlinearFactorGraph IncrementalPgo::getFactors() const {
+  return isam_->getFactorsUnsafe();
+}
+
+bool IncrementalPgo::isNodeNeeded(const gtsam::Pose3& node_Pose_kf) const {
+  if (nr_chained_keyframes_ >= params_.max_keyframes_between_nodes) {
+    return true;
+  }
+  return node_Pose_kf.translation().norm() >= params_.min_node_translation ||
+         gtsam::Rot3::Logmap(node_Pose_kf.rotation()).norm() >=
+             params_.min_node_rotation;
+}
+
+void IncrementalPgo::addNode(const FrameId& key) {
+  CHECK_EQ(key, keyframes_.size() - 1u);
+  CHECK_GT(nr_chained_keyframes_, 0);
+  KeyframeAnchor& keyframe = keyframes_.back();
+  CHECK_EQ(keyframe.node, last_node_);
+  const gtsam::Pose3 lastNode_Pose_kf = keyframe.node_Pose_kf;
+
+  pending_factors_.add(gtsam::BetweenFactor<gtsam::Pose3>(
+      gtsam::Symbol(last_node_),
+      gtsam::Symbol(key),
+      lastNode_Pose_kf,
+      gtsam::noiseModel::Gaussian::Covariance(chain_covariance_)));
+  pending_values_.insert(
+      gtsam::Symbol(key),
+      isam_->calculateEstimate<gtsam::Pose3>(gtsam::Symbol(last_node_))
+          .compose(lastNode_Pose_kf));
+
+  keyframe = KeyframeAnchor{key, gtsam::Pose3()};
+  last_node_ = key;
+  ++nr_nodes_;
+  chain_covariance_.setZero();
+  nr_chained_keyframes_ = 0;
+  update(false);
+}
+
+void IncrementalPgo::update(const bool& solve_loop_closures) {
+  const auto tic = utils::Timer::tic();
+  if (solve_loop_closures) {
+    pending_factors_.push_back(pending_loop_closures_);
+    pending_loop_closures_.resize(0);
+  }
+  isam_->update(pending_factors_, pending_values_);
+  pending_factors_.resize(0);
+  pending_values_.clear();
+  estimate_cache_.reset();
+  if (!solve_loop_closures) return;
+
+  // The loop closure typically needs more relinearizations to converge: do
+  // them within the budget, else the next updates carry on converging.
+  for (int i = 0; i < params_.max_solve_iterations &&
+                  utils::Timer::toc<std::chrono::microseconds>(tic).count() <
+                      1000.0 * params_.max_solve_time_ms;
+       ++i) {
+    isam_->update();
+  }
+  last_solve_time_ms_ =
+      utils::Timer::toc<std::chrono::microseconds>(tic).count() / 1000.0;
+  VLOG(2) << "IncrementalPgo: solved loop closure with " << nr_nodes_
+          << " nodes for " << keyframes_.size() << " keyframes in "
+          << last_solve_time_ms_ << " [ms].";
+}
+
+}  // namespace VIO
@@ -0,0 +1,120 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   KeyframeSpatialIndex.cpp
+ * @brief  Grid over the keyframe positions, to gate loop closure candidates.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/loopclosure/KeyframeSpatialIndex.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+KeyframeSpatialIndex::KeyframeSpatialIndex(const SpatialGatingParams& params)
+    : params_(params),
+      first_id_(0u),
+      positions_(),
+      path_lengths_(),
+      cells_() {
+  CHECK_GT(params_.min_radius, 0.0);
+  CHECK_GE(params_.drift_fraction, 0.0);
+  CHECK_GE(params_.max_radius, params_.min_radius);
+  CHECK_GT(params_.max_candidate_fraction, 0.0);
+}
+
+void KeyframeSpatialIndex::addKeyframe(const FrameId& id,
+                                       const gtsam::Point3& position) {
+  if (positions_.empty()) {
+    first_id_ = id;
+    path_lengths_.push_back(0.0);
+  } else {
+    CHECK_EQ(id, first_id_ + positions_.size())
+        << "Keyframes must be added with consecutive ids.";
+    path_lengths_.push_back(path_lengths_.back() +
+                            (position - positions_.back()).norm());
+  }
+  positions_.push_back(position);
+  cells_[getCellKey(position, 0, 0, 0)].push_back(id);
+}
+
+bool KeyframeSpatialIndex::getCandidates(
+    const FrameId& query_id,
+    const FrameId& max_id,
+    std::vector<unsigned int>* candidates) const {
+  CHECK_NOTNULL(candidates);
+  candidates->clear();
+  if (!hasKeyframe(query_id)) return false;
+  const size_t query_idx = query_id - first_id_;
+  const gtsam::Point3& query_position = positions_[query_idx];
+  const double& query_path_length = path_lengths_[query_idx];
+
+  // Keyframes without position, or too uncertain to be gated: as the
+  // uncertainty decreases with the id, the ids before ungated_id.
+  FrameId ungated_id = first_id_;
+  if (params_.drift_fraction > 0.0) {
+    const double max_gated_path_length =
+        query_path_length -
+        (params_.max_radius - params_.min_radius) / params_.drift_fraction;
+    ungated_id += static_cast<FrameId>(
+        std::lower_bound(path_lengths_.begin(),
+                         path_lengths_.begin() + query_idx,
+                         max_gated_path_length) -
+        path_lengths_.begin());
+  }
+  ungated_id = std::min(ungated_id, max_id);
+  const double max_nr_candidates =
+      params_.max_candidate_fraction * static_cast<double>(max_id);
+  if (static_cast<double>(ungated_id) > max_nr_candidates) return false;
+  for (FrameId id = 0u; id < ungated_id; ++id) candidates->push_back(id);
+
+  for (int dx = -1; dx <= 1; ++dx) {
+    for (int dy = -1; dy <= 1; ++dy) {
+      for (int dz = -1; dz <= 1; ++dz) {
+        const auto cell = cells_.find(getCellKey(query_position, dx, dy, dz));
+        if (cell == cells_.end()) continue;
+        for (const FrameId& id : cell->second) {
+          if (id < ungated_id || id >= max_id) continue;
+          const size_t idx = id - first_id_;
+          const double radius =
+              params_.min_radius +
+              params_.drift_fraction *
+                  (query_path_length - path_lengths_[idx]);
+          if ((positions_[idx] - query_position).norm() <= radius) {
+            candidates->push_back(static_cast<unsigned int>(id));
+          }
+        }
+      }
+    }
+  }
+  std::sort(candidates->begin() + ungated_id, candidates->end());
+  return static_cast<double>(candidates->size()) <= max_nr_candidates;
+}
+
+int64_t KeyframeSpatialIndex::getCellKey(const gtsam::Point3& position,
+                                         const int& dx,
+                                         const int& dy,
+                                         const int& dz) const {
+  // 21 bits per axis: cells very far apart may share a key, but their
+  // keyframes are filtered by distance anyway.
+  static constexpr int64_t kMask = (int64_t(1) << 21) - 1;
+  const int64_t x =
+      static_cast<int64_t>(std::floor(position.x() / params_.max_radius)) + dx;
+  const int64_t y =
+      static_cast<int64_t>(std::floor(position.y() / params_.max_radius)) + dy;
+  const int64_t z =
+      static_cast<int64_t>(std::floor(position.z() / params_.max_radius)) + dz;
+  return ((x & kMask) << 42) | ((y & kMask) << 21) | (z & kMask);
+}
+
+}  // namespace VIO
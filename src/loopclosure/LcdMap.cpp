@@ -0,0 +1,353 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   LcdMap.cpp
+ * @brief  Persisted state of the LoopClosureDetector (frames, bag-of-words
+ * database and pose graph), to detect loop closures against prior sessions.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/loopclosure/LcdMap.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include <gtsam/base/GenericValue.h>
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/linear/NoiseModel.h>
+#include <gtsam/slam/BetweenFactor.h>
+#include <gtsam/slam/PriorFactor.h>
+
+namespace VIO {
+
+namespace {
+
+constexpr char kMagic[8] = {'K', 'I', 'M', 'E', 'R', 'A', 'L', 'M'};
+constexpr uint32_t kVersion = 1u;
+
+enum class SectionType : uint32_t {
+  kFrames = 0u,
+  kPoses = 1u,
+  kFactors = 2u,
+  kDatabase = 3u,
+};
+constexpr uint32_t kNrSections = 4u;
+
+enum class FactorType : uint8_t {
+  kPrior = 0u,
+  kBetween = 1u,
+};
+
+#pragma pack(push, 1)
+struct SectionEntry {
+  uint32_t type;
+  uint64_t offset;
+  uint64_t bytes;
+};
+
+struct FrameEntry {
+  //! Wrt the start of the frames section.
+  uint64_t offset;
+  uint64_t bytes;
+};
+#pragma pack(pop)
+
+template <typename T>
+void writePod(std::ostream& out, const T& value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+T readPod(std::istream& in) {
+  T value;
+  in.read(reinterpret_cast<char*>(&value), sizeof(T));
+  CHECK(in.good()) << "LcdMap: truncated map.";
+  return value;
+}
+
+void writePose(std::ostream& out, const gtsam::Pose3& pose) {
+  const gtsam::Matrix3 R = pose.rotation().matrix();
+  for (int r = 0; r < 3; ++r) {
+    for (int c = 0; c < 3; ++c) writePod(out, R(r, c));
+  }
+  for (int i = 0; i < 3; ++i) writePod(out, pose.translation()(i));
+}
+
+gtsam::Pose3 readPose(std::istream& in) {
+  gtsam::Matrix3 R;
+  for (int r = 0; r < 3; ++r) {
+    for (int c = 0; c < 3; ++c) R(r, c) = readPod<double>(in);
+  }
+  gtsam::Vector3 t;
+  for (int i = 0; i < 3; ++i) t(i) = readPod<double>(in);
+  return gtsam::Pose3(gtsam::Rot3(R), t);
+}
+
+//! Information matrix of the (possibly robust) noise of a factor, if
+//! Gaussian.
+bool getInformation(const gtsam::SharedNoiseModel& noise,
+                    gtsam::Matrix6* information) {
+  CHECK_NOTNULL(information);
+  const gtsam::noiseModel::Base* base = noise.get();
+  const auto* robust = dynamic_cast<const gtsam::noiseModel::Robust*>(base);
+  if (robust) base = robust->noise().get();
+  const auto* gaussian = dynamic_cast<const gtsam::noiseModel::Gaussian*>(base);
+  if (!gaussian || gaussian->dim() != 6u) return false;
+  *information = gaussian->information();
+  return true;
+}
+
+void writeFrames(std::ostream& out, const FrameCache& cache) {
+  const std::streampos section_start = out.tellp();
+  const uint64_t nr_frames = cache.size();
+  writePod(out, nr_frames);
+  const std::streampos index_start = out.tellp();
+  std::vector<FrameEntry> index(nr_frames, FrameEntry{0u, 0u});
+  out.write(reinterpret_cast<const char*>(index.data()),
+            index.size() * sizeof(FrameEntry));
+
+  for (uint64_t i = 0u; i < nr_frames; ++i) {
+    const LCDFrame::Ptr frame = cache.getFrame(i);
+    CHECK(frame) << "LcdMap: missing frame " << i << " in the cache.";
+    const std::streampos frame_start = out.tellp();
+    frame->save(out);
+    index[i].offset = static_cast<uint64_t>(frame_start - section_start);
+    index[i].bytes = static_cast<uint64_t>(out.tellp() - frame_start);
+  }
+
+  const std::streampos section_end = out.tellp();
+  out.seekp(index_start);
+  out.write(reinterpret_cast<const char*>(index.data()),
+            index.size() * sizeof(FrameEntry));
+  out.seekp(section_end);
+}
+
+void readFrames(std::istream& in, const SectionEntry& section, LcdMap* map) {
+  const std::streampos section_start = static_cast<std::streampos>(
+      static_cast<std::streamoff>(section.offset));
+  in.seekg(section_start);
+  const uint64_t nr_frames = readPod<uint64_t>(in);
+  std::vector<FrameEntry> index(nr_frames);
+  in.read(reinterpret_cast<char*>(index.data()),
+          index.size() * sizeof(FrameEntry));
+  CHECK(in.good()) << "LcdMap: truncated frame index.";
+
+  map->frames.reserve(nr_frames);
+  for (const FrameEntry& entry : index) {
+    CHECK_LE(entry.offset + entry.bytes, section.bytes);
+    in.seekg(section_start + static_cast<std::streamoff>(entry.offset));
+    LCDFrame::Ptr frame = LCDFrame::load(in, entry.bytes);
+    CHECK(frame && in.good()) << "LcdMap: invalid frame.";
+    map->frames.push_back(frame);
+  }
+}
+
+void writePoses(std::ostream& out, const gtsam::Values& W_Pose_B) {
+  std::vector<std::pair<gtsam::Key, gtsam::Pose3>> poses;
+  for (const auto& key_value : W_Pose_B) {
+    const auto* pose =
+        dynamic_cast<const gtsam::GenericValue<gtsam::Pose3>*>(
+            &key_value.value);
+    if (pose) poses.emplace_back(key_value.key, pose->value());
+  }
+  writePod(out, static_cast<uint64_t>(poses.size()));
+  for (const auto& key_pose : poses) {
+    writePod(out, static_cast<uint64_t>(key_pose.first));
+    writePose(out, key_pose.second);
+  }
+}
+
+void readPoses(std::istream& in, LcdMap* map) {
+  const uint64_t nr_poses = readPod<uint64_t>(in);
+  for (uint64_t i = 0u; i < nr_poses; ++i) {
+    const gtsam::Key key = readPod<uint64_t>(in);
+    map->W_Pose_B.insert(key, readPose(in));
+  }
+}
+
+void writeFactors(std::ostream& out,
+                  const gtsam::NonlinearFactorGraph& factors) {
+  const std::streampos count_pos = out.tellp();
+  uint64_t nr_factors = 0u;
+  writePod(out, nr_factors);
+  size_t nr_skipped = 0u;
+  for (const auto& factor : factors) {
+    if (!factor) continue;
+    const auto* prior =
+        dynamic_cast<const gtsam::PriorFactor<gtsam::Pose3>*>(factor.get());
+    const auto* between =
+        dynamic_cast<const gtsam::BetweenFactor<gtsam::Pose3>*>(factor.get());
+    gtsam::Matrix6 information;
+    if ((!prior && !between) ||
+        !getInformation(prior ? prior->noiseModel() : between->noiseModel(),
+                        &information)) {
+      ++nr_skipped;
+      continue;
+    }
+    if (prior) {
+      writePod(out, FactorType::kPrior);
+      writePod(out, static_cast<uint64_t>(prior->key()));
+      writePose(out, prior->prior());
+    } else {
+      writePod(out, FactorType::kBetween);
+      writePod(out, static_cast<uint64_t>(between->key1()));
+      writePod(out, static_cast<uint64_t>(between->key2()));
+      writePose(out, between->measured());
+    }
+    out.write(reinterpret_cast<const char*>(information.data()),
+              information.size() * sizeof(double));
+    ++nr_factors;
+  }
+  LOG_IF(WARNING, nr_skipped > 0u)
+      << "LcdMap: skipped " << nr_skipped
+      << " factors that are not Pose3 priors or between factors.";
+
+  const std::streampos section_end = out.tellp();
+  out.seekp(count_pos);
+  writePod(out, nr_factors);
+  out.seekp(section_end);
+}
+
+void readFactors(std::istream& in, LcdMap* map) {
+  const uint64_t nr_factors = readPod<uint64_t>(in);
+  for (uint64_t i = 0u; i < nr_factors; ++i) {
+    const FactorType type = readPod<FactorType>(in);
+    const gtsam::Key key1 = readPod<uint64_t>(in);
+    const gtsam::Key key2 =
+        type == FactorType::kBetween ? readPod<uint64_t>(in) : key1;
+    const gtsam::Pose3 pose = readPose(in);
+    gtsam::Matrix6 information;
+    in.read(reinterpret_cast<char*>(information.data()),
+            information.size() * sizeof(double));
+    CHECK(in.good()) << "LcdMap: truncated factor.";
+    const gtsam::SharedNoiseModel noise =
+        gtsam::noiseModel::Gaussian::Information(information);
+    if (type == FactorType::kPrior) {
+      map->factors.add(gtsam::PriorFactor<gtsam::Pose3>(key1, pose, noise));
+    } else {
+      CHECK(type == FactorType::kBetween) << "LcdMap: unknown factor type.";
+      map->factors.add(
+          gtsam::BetweenFactor<gtsam::Pose3>(key1, key2, pose, noise));
+    }
+  }
+}
+
+}  // namespace
+
+void saveLcdMap(const std::string& filepath,
+                const FrameCache& cache,
+                const gtsam::Values& W_Pose_B,
+                const gtsam::NonlinearFactorGraph& factors,
+                const BowDatabase& database) {
+  CHECK_EQ(cache.size(), database.size())
+      << "LcdMap: the database entries must be the cached frames.";
+  // Written to a temporary file first, to never leave a partial map behind.
+  const std::string tmp_filepath = filepath + ".tmp";
+  std::ofstream out(tmp_filepath, std::ios::binary | std::ios::trunc);
+  CHECK(out.is_open()) << "LcdMap: failed to open " << tmp_filepath;
+
+  out.write(kMagic, sizeof(kMagic));
+  writePod(out, kVersion);
+  writePod(out, kNrSections);
+  const std::streampos table_start = out.tellp();
+  std::vector<SectionEntry> sections(kNrSections, SectionEntry{0u, 0u, 0u});
+  out.write(reinterpret_cast<const char*>(sections.data()),
+            sections.size() * sizeof(SectionEntry));
+
+  for (uint32_t i = 0u; i < kNrSections; ++i) {
+    const std::streampos section_start = out.tellp();
+    switch (static_cast<SectionType>(i)) {
+      case SectionType::kFrames:
+        writeFrames(out, cache);
+        break;
+      case SectionType::kPoses:
+        writePoses(out, W_Pose_B);
+        break;
+      case SectionType::kFactors:
+        writeFactors(out, factors);
+        break;
+      case SectionType::kDatabase:
+        database.save(out);
+        break;
+    }
+    sections[i].type = i;
+    sections[i].offset = static_cast<uint64_t>(section_start);
+    sections[i].bytes = static_cast<uint64_t>(out.tellp() - section_start);
+  }
+
+  out.seekp(table_start);
+  out.write(reinterpret_cast<const char*>(sections.data()),
+            sections.size() * sizeof(SectionEntry));
+  out.close();
+  CHECK(!out.fail()) << "LcdMap: failed to write " << tmp_filepath;
+  CHECK_EQ(std::rename(tmp_filepath.c_str(), filepath.c_str()), 0)
+      << "LcdMap: failed to rename " << tmp_filepath << " to " << filepath;
+  LOG(INFO) << "LcdMap: saved " << cache.size() << " frames to " << filepath;
+}
+
+LcdMap::UniquePtr loadLcdMap(const std::string& filepath,
+                             const OrbVocabulary& vocab,
+                             const BowDatabaseParams& database_params) {
+  std::ifstream in(filepath, std::ios::binary);
+  if (!in.is_open()) {
+    LOG(ERROR) << "LcdMap: failed to open " << filepath;
+    return nullptr;
+  }
+  char magic[sizeof(kMagic)];
+  in.read(magic, sizeof(magic));
+  if (!in.good() || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+    LOG(ERROR) << "LcdMap: " << filepath << " is not an LCD map.";
+    return nullptr;
+  }
+  const uint32_t version = readPod<uint32_t>(in);
+  if (version != kVersion) {
+    LOG(ERROR) << "LcdMap: unsupported version " << version << " of "
+               << filepath;
+    return nullptr;
+  }
+  const uint32_t nr_sections = readPod<uint32_t>(in);
+  std::vector<SectionEntry> sections(nr_sections);
+  in.read(reinterpret_cast<char*>(sections.data()),
+          sections.size() * sizeof(SectionEntry));
+  CHECK(in.good()) << "LcdMap: truncated section table.";
+
+  auto map = std::make_unique<LcdMap>();
+  map->database = std::make_unique<BowDatabase>(vocab, database_params);
+  for (const SectionEntry& section : sections) {
+    in.seekg(static_cast<std::streamoff>(section.offset));
+    switch (static_cast<SectionType>(section.type)) {
+      case SectionType::kFrames:
+        readFrames(in, section, map.get());
+        break;
+      case SectionType::kPoses:
+        readPoses(in, map.get());
+        break;
+      case SectionType::kFactors:
+        readFactors(in, map.get());
+        break;
+      case SectionType::kDatabase:
+        map->database->load(in);
+        break;
+      default:
+        VLOG(1) << "LcdMap: skipping unknown section " << section.type;
+    }
+  }
+  CHECK_EQ(map->frames.size(), map->database->size())
+      << "LcdMap: inconsistent frames and database.";
+  LOG(INFO) << "LcdMap: loaded " << map->frames.size() << " frames from "
+            << filepath;
+  return map;
+}
+
+}  // namespace VIO
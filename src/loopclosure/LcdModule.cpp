@@ -15,16 +15,79 @@
 
 #include "kimera-vio/loopclosure/LcdModule.h"
 
+#include <chrono>
+
+#include "kimera-vio/utils/Timer.h"
+
 namespace VIO {
 
 LcdModule::LcdModule(bool parallel_run, LoopClosureDetector::UniquePtr lcd)
     : MIMOPipelineModule<LcdInput, LcdOutput>("Lcd", parallel_run),
-      frontend_queue_("lcd_frontend_queue"),
+      frontend_buffer_("lcd_frontend_buffer"),
       backend_queue_("lcd_backend_queue"),
-      lcd_(std::move(lcd)) {
+      lcd_(std::move(lcd)),
+      lcd_future_() {
   CHECK(lcd_);
-  lcd_->registerIsBackendQueueFilledCallback(
-      std::bind(&LcdModule::hasWork, this));
+  registerLcdCallbacks();
+}
+
+LcdModule::LcdModule(bool parallel_run,
+                     std::future<LoopClosureDetector::UniquePtr>&& lcd_future)
+    : MIMOPipelineModule<LcdInput, LcdOutput>("Lcd", parallel_run),
+      frontend_buffer_("lcd_frontend_buffer"),
+      backend_queue_("lcd_backend_queue"),
+      lcd_(nullptr),
+      lcd_future_(std::move(lcd_future)) {
+  CHECK(lcd_future_.valid());
+  if (lcd_future_.wait_for(std::chrono::seconds(0)) ==
+      std::future_status::deferred) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    getLcd();
+  }
+}
+
+bool LcdModule::isLcdReady() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return lcd_ != nullptr;
+}
+
+LoopClosureDetector& LcdModule::getLcd() {
+  if (!lcd_) {
+    CHECK(lcd_future_.valid());
+    const auto start_time = utils::Timer::tic();
+    lcd_ = lcd_future_.get();
+    CHECK(lcd_);
+    registerLcdCallbacks();
+    LOG(INFO) << "Module: " << name_id_ << " - Loop closure detector ready, "
+              << "waited " << utils::Timer::toc(start_time).count()
+              << " [ms], " << backend_queue_.size() << " queued keyframes.";
+  }
+  return *lcd_;
+}
+
+void LcdModule::registerRelocalizationCallback(
+    const LoopClosureDetector::RelocalizationCallback& cb) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  relocalization_cb_ = cb;
+  if (lcd_) {
+    lcd_->registerRelocalizationCallback(relocalization_cb_);
+  }
+}
+
+void LcdModule::registerLcdCallbacks() {
+  CHECK(lcd_);
+  lcd_->registerIsBackendQueueFilledCallback([this]() {
+    return hasWork() || (admission_controller_ &&
+                         admission_controller_->isCriticalPathAtRisk());
+  });
+  lcd_->registerIsDetectionAdmittedCallback([this]() {
+    return isKeptByInputDecimation() &&
+           (!admission_controller_ ||
+            admission_controller_->admit(admission_id_));
+  });
+  if (relocalization_cb_) {
+    lcd_->registerRelocalizationCallback(relocalization_cb_);
+  }
 }
 
 LcdModule::InputUniquePtr LcdModule::getInputPacket() {
@@ -46,22 +109,28 @@ LcdModule::InputUniquePtr LcdModule::getInputPacket() {
   CHECK(backend_payload);
   const Timestamp& timestamp = backend_payload->W_State_Blkf_.timestamp_;
 
-  // Look for the synchronized packet in Frontend payload queue
+  // Look for the synchronized packet in Frontend payload buffer
   // This should always work, because it should not be possible to have
   // a Backend payload without having a Frontend one first!
   LcdFrontendInput frontend_payload = nullptr;
-  PIO::syncQueue(timestamp, &frontend_queue_, &frontend_payload);
+  using QueryResult = ThreadsafeRendezvousBuffer<LcdFrontendInput>::QueryResult;
+  const QueryResult result =
+      PIO::syncBuffer(timestamp, &frontend_buffer_, &frontend_payload);
+  if (result == QueryResult::kShutdown) {
+    LOG(WARNING) << "Module: " << name_id_ << " - Frontend buffer is down";
+    return nullptr;
+  }
+  CHECK(result == QueryResult::kFound)
+      << "Module: " << name_id_
+      << " - No Frontend payload for Backend payload at timestamp: "
+      << timestamp;
   CHECK(frontend_payload);
   CHECK(frontend_payload->is_keyframe_);
   CHECK_EQ(timestamp, frontend_payload->timestamp_);
 
   // Push the synced messages to the lcd's input queue
-  const gtsam::Pose3& body_pose = backend_payload->W_State_Blkf_.pose_;
-  return std::make_unique<LcdInput>(timestamp,
-                                    frontend_payload,
-                                    backend_payload->cur_kf_id_,
-                                    backend_payload->landmarks_with_id_map_,
-                                    body_pose);
+  return std::make_unique<LcdInput>(
+      timestamp, frontend_payload, backend_payload);
 }
 
 }  // namespace VIO
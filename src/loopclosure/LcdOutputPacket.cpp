@@ -35,7 +35,8 @@ LcdOutput::LcdOutput(bool is_loop_closure,
       timestamp_match_(timestamp_match),
       id_match_(id_match),
       id_recent_(id_recent),
-      relative_pose_(relative_pose) {}
+      relative_pose_(relative_pose),
+      is_trajectory_corrected_(false) {}
 
 LcdOutput::LcdOutput(const Timestamp& timestamp_kf)
     : PipelinePayload(timestamp_kf),
@@ -43,7 +44,8 @@ LcdOutput::LcdOutput(const Timestamp& timestamp_kf)
       timestamp_query_(0),
       timestamp_match_(0),
       id_match_(0),
-      id_recent_(0) {}
+      id_recent_(0),
+      is_trajectory_corrected_(false) {}
 
 void LcdOutput::setMapInformation(const gtsam::Pose3& W_Pose_Map,
                                   const gtsam::Pose3& Map_Pose_Odom,
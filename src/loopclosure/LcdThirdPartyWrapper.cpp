@@ -44,6 +44,7 @@ POSSIBILITY OF SUCH DAMAGE.
  */
 
 #include <algorithm>
+#include <iterator>
 #include <vector>
 
 #include <gflags/gflags.h>
@@ -112,6 +113,7 @@ void LcdThirdPartyWrapper::computeIslands(
   CHECK_NOTNULL(q);
   CHECK_NOTNULL(islands);
   islands->clear();
+  if (q->empty()) return;
 
   // The case of one island is easy to compute and is done separately
   if (q->size() == 1) {
@@ -121,80 +123,51 @@ void LcdThirdPartyWrapper::computeIslands(
     island.best_id_ = result_id;
     island.best_score_ = result.Score;
     islands->push_back(island);
-  } else if (!q->empty()) {
-    // sort query results in ascending order of frame ids
+    return;
+  }
+
+  // sort query results in ascending order of frame ids (the database returns
+  // them sorted by score)
+  if (!std::is_sorted(q->begin(), q->end(), DBoW2::Result::ltId)) {
     std::sort(q->begin(), q->end(), DBoW2::Result::ltId);
+  }
 
-    // create long enough islands
-    DBoW2::QueryResults::const_iterator dit = q->begin();
-    int first_island_entry = static_cast<int>(dit->Id);
-    int last_island_entry = static_cast<int>(dit->Id);
-
-    // these are indices of q
-    FrameId i_first = 0;
-    FrameId i_last = 0;
-
-    double best_score = dit->Score;
-    DBoW2::EntryId best_entry = dit->Id;
-
-    ++dit;
-    for (FrameId idx = 1; dit != q->end(); ++dit, ++idx) {
-      if (static_cast<int>(dit->Id) - last_island_entry <
-          lcd_params_.max_intraisland_gap_) {
-        last_island_entry = dit->Id;
-        i_last = idx;
-        if (dit->Score > best_score) {
-          best_score = dit->Score;
-          best_entry = dit->Id;
-        }
-      } else {
-        // end of island reached
-        int length = last_island_entry - first_island_entry + 1;
-        if (length >= lcd_params_.min_matches_per_island_) {
-          MatchIsland island =
-              MatchIsland(first_island_entry,
-                          last_island_entry,
-                          computeIslandScore(*q, i_first, i_last));
-
-          islands->push_back(island);
-          islands->back().best_score_ = best_score;
-          islands->back().best_id_ = best_entry;
-        }
-
-        // prepare next island
-        first_island_entry = last_island_entry = dit->Id;
-        i_first = i_last = idx;
-        best_score = dit->Score;
-        best_entry = dit->Id;
-      }
-    }
-    // add last island
-    // TODO: do we need this? why isn't it handled in prev for loop?
+  // Single pass over the results: each island's score is accumulated while
+  // growing it (in the same order as summing it afterwards).
+  int first_island_entry = static_cast<int>(q->front().Id);
+  int last_island_entry = first_island_entry;
+  double island_score = q->front().Score;
+  double best_score = q->front().Score;
+  DBoW2::EntryId best_entry = q->front().Id;
+  const auto add_island = [&]() {
     if (last_island_entry - first_island_entry + 1 >=
         lcd_params_.min_matches_per_island_) {
-      MatchIsland island = MatchIsland(first_island_entry,
-                                       last_island_entry,
-                                       computeIslandScore(*q, i_first, i_last));
-
-      islands->push_back(island);
+      islands->push_back(
+          MatchIsland(first_island_entry, last_island_entry, island_score));
       islands->back().best_score_ = best_score;
       islands->back().best_id_ = static_cast<FrameId>(best_entry);
     }
+  };
+
+  for (auto it = std::next(q->begin()); it != q->end(); ++it) {
+    const DBoW2::Result& result = *it;
+    const int entry = static_cast<int>(result.Id);
+    if (entry - last_island_entry >= lcd_params_.max_intraisland_gap_) {
+      // end of island reached, prepare next island
+      add_island();
+      first_island_entry = entry;
+      island_score = 0.0;
+      best_score = result.Score;
+      best_entry = result.Id;
+    } else if (result.Score > best_score) {
+      best_score = result.Score;
+      best_entry = result.Id;
+    }
+    last_island_entry = entry;
+    island_score += result.Score;
   }
-}
-
-/* ------------------------------------------------------------------------ */
-double LcdThirdPartyWrapper::computeIslandScore(const DBoW2::QueryResults& q,
-                                                const FrameId& start_id,
-                                                const FrameId& end_id) const {
-  CHECK_GT(q.size(), start_id);
-  CHECK_GT(q.size(), end_id);
-  double score_sum = 0.0;
-  for (FrameId id = start_id; id <= end_id; id++) {
-    score_sum += q.at(id).Score;
-  }
-
-  return score_sum;
+  // add last island
+  add_island();
 }
 
 }  // namespace VIO
@@ -24,19 +24,25 @@
 #include <gtsam/nonlinear/LevenbergMarquardtOptimizer.h>
 
 #include <algorithm>
+#include <numeric>
 #include <string>
 #include <vector>
 
 #include "kimera-vio/frontend/MonoVisionImuFrontend-definitions.h"
 #include "kimera-vio/frontend/RgbdVisionImuFrontend-definitions.h"
+#include "kimera-vio/loopclosure/BinaryVocabulary.h"
 #include "kimera-vio/loopclosure/LcdThirdPartyWrapper.h"
+#include "kimera-vio/utils/PerfCounters.h"
 #include "kimera-vio/utils/Statistics.h"
 #include "kimera-vio/utils/Timer.h"
+#include "kimera-vio/utils/Tracing.h"
 #include "kimera-vio/utils/UtilsOpenCV.h"
 
 DEFINE_string(vocabulary_path,
               "../vocabulary/ORBvoc.yml",
-              "Path to BoW vocabulary file for LoopClosureDetector module.");
+              "Path to BoW vocabulary file for LoopClosureDetector module: "
+              "either a DBoW2 text/YAML vocabulary, or a binary vocabulary "
+              "(see BinaryVocabulary.h), memory-mapped instead of parsed.");
 
 DEFINE_bool(
     lcd_no_optimize,
@@ -66,16 +72,56 @@ std::unique_ptr<OrbVocabulary> loadOrbVocabulary() {
                         << FLAGS_vocabulary_path;
   f_vocab.close();
 
-  auto vocab = std::make_unique<OrbVocabulary>();
   LOG(INFO) << "LoopClosureDetector:: Loading vocabulary from "
             << FLAGS_vocabulary_path;
-  vocab->load(FLAGS_vocabulary_path);
+  std::unique_ptr<OrbVocabulary> vocab = nullptr;
+  if (isBinaryVocabulary(FLAGS_vocabulary_path)) {
+    vocab = loadBinaryVocabulary(FLAGS_vocabulary_path);
+  } else {
+    vocab = std::make_unique<OrbVocabulary>();
+    vocab->load(FLAGS_vocabulary_path);
+  }
   LOG(INFO) << "Loaded vocabulary with " << vocab->size() << " visual words.";
   return vocab;
 }
 
+namespace {
+
+//! Orientation (in degrees) of a keypoint as computed by cv::ORB: direction
+//! of the intensity centroid of the circular patch around it.
+float orbOrientation(const cv::Mat& img,
+                     const cv::Point2f& pt,
+                     const int& radius) {
+  const int x = cvRound(pt.x);
+  const int y = cvRound(pt.y);
+  if (x < radius || y < radius || x + radius >= img.cols ||
+      y + radius >= img.rows) {
+    return 0.0f;
+  }
+  int m_01 = 0;
+  int m_10 = 0;
+  for (int v = -radius; v <= radius; ++v) {
+    const uchar* row = img.ptr<uchar>(y + v);
+    for (int u = -radius; u <= radius; ++u) {
+      if (u * u + v * v > radius * radius) continue;
+      const int intensity = row[x + u];
+      m_10 += u * intensity;
+      m_01 += v * intensity;
+    }
+  }
+  return cv::fastAtan2(static_cast<float>(m_01), static_cast<float>(m_10));
+}
+
+}  // namespace
+
 PreloadedVocab::PreloadedVocab() { vocab = loadOrbVocabulary(); }
 
+PreloadedVocab::PreloadedVocab(
+    std::shared_ptr<const OrbVocabulary> shared_vocab)
+    : vocab(std::move(shared_vocab)) {
+  CHECK(vocab);
+}
+
 PreloadedVocab::PreloadedVocab(PreloadedVocab&& other) {
   vocab = std::move(other.vocab);
 }
@@ -96,20 +142,59 @@ LoopClosureDetector::LoopClosureDetector(
       lcd_params_(lcd_params),
       log_output_(log_output),
       orb_feature_detector_(),
+      gpu_orb_extractor_(nullptr),
       orb_feature_matcher_(),
+      orb_hamming_matcher_(lcd_params.max_hamming_distance_),
+      use_orb_hamming_matcher_(false),
       tracker_(nullptr),
       db_BoW_(nullptr),
+      db_frame_ids_(),
+      recent_db_bowvecs_(),
+      last_db_position_(std::nullopt),
+      spatial_index_(nullptr),
+      global_descriptor_extractor_(nullptr),
+      global_descriptor_index_(nullptr),
+      global_descriptor_id_(std::nullopt),
+      global_descriptor_(),
+      latest_global_descriptor_(),
       cache_(lcd_params.frame_cache),
+      frame_cache_memory_("LCD frame cache"),
+      bow_database_memory_("LCD BoW database"),
       lcd_tp_wrapper_(nullptr),
       latest_bowvec_(new DBoW2::BowVector()),
+      last_match_id_(std::nullopt),
+      prior_map_(nullptr),
+      Map_Pose_W_(std::nullopt),
+      nr_prior_map_lc_(0u),
+      tracking_lost_kf_id_(std::nullopt),
+      nr_relocalization_attempts_(0),
+      nr_relocalizations_(0u),
+      vio_trajectory_(),
+      relocalization_cb_(),
       B_Pose_Cam_(B_Pose_Cam),
       stereo_camera_(stereo_camera ? stereo_camera.value() : nullptr),
       stereo_matcher_(nullptr),
       rgbd_camera_(rgbd_camera ? rgbd_camera.value() : nullptr),
       pgo_(nullptr),
+      incremental_pgo_(nullptr),
       W_Pose_B_kf_vio_(),
+      W_Pose_B_kf_pgo_(),
+      is_pgo_optimized_(false),
+      published_trajectory_(),
       num_lc_unoptimized_(0),
-      logger_(nullptr) {
+      pending_loop_closures_(),
+      pending_loop_closures_kf_id_(0u),
+      verification_trackers_(),
+      verification_workers_(),
+      verification_mutex_(),
+      verification_cv_(),
+      pending_verifications_(),
+      verified_results_(),
+      nr_verifying_(0u),
+      nr_dropped_verifications_(0u),
+      shutdown_verification_(false),
+      logger_(nullptr),
+      logger_mutex_() {
   // Shared noise model initialization
   gtsam::Vector6 precisions;
   precisions.head<3>().setConstant(lcd_params_.betweenRotationPrecision_);
@@ -120,6 +205,12 @@ LoopClosureDetector::LoopClosureDetector(
   tracker_ = std::make_unique<Tracker>(
       lcd_params.tracker_params_,
       std::make_shared<VIO::Camera>(tracker_cam_params));
+  CHECK_GE(lcd_params_.verification_num_workers_, 0);
+  for (int i = 0; i < lcd_params_.verification_num_workers_; ++i) {
+    verification_trackers_.push_back(std::make_unique<Tracker>(
+        lcd_params.tracker_params_,
+        std::make_shared<VIO::Camera>(tracker_cam_params)));
+  }
 
   // Sparse stereo reconstruction members (only if stereo_camera is provided)
   if (stereo_camera) {
@@ -148,14 +239,31 @@ LoopClosureDetector::LoopClosureDetector(
                                           lcd_params_.score_type_,
                                           lcd_params_.patch_sze_,
                                           lcd_params_.fast_threshold_);
+  // The CPU detector is still used to compute descriptors of given keypoints.
+  if (lcd_params_.use_gpu_orb_) {
+    if (GpuOrbExtractor::isAvailable()) {
+      gpu_orb_extractor_ = std::make_unique<GpuOrbExtractor>(lcd_params_);
+    } else {
+      LOG(WARNING) << "LoopClosureDetector: use_gpu_orb set, but no CUDA "
+                      "device or OpenCV CUDA support: using the CPU ORB.";
+    }
+  }
 
   // Initialize our feature matching object:
   orb_feature_matcher_ =
       cv::DescriptorMatcher::create(lcd_params_.matcher_type_);
+  const int matcher_type = static_cast<int>(lcd_params_.matcher_type_);
+  use_orb_hamming_matcher_ =
+      matcher_type == cv::DescriptorMatcher::BRUTEFORCE_HAMMING ||
+      matcher_type == cv::DescriptorMatcher::BRUTEFORCE_HAMMINGLUT;
+  LOG_IF(WARNING,
+         lcd_params_.bow_guided_matching_ && !use_orb_hamming_matcher_)
+      << "LoopClosureDetector: bow_guided_matching requires a Hamming "
+         "matcher_type, ignoring it.";
 
   // Load ORB vocabulary:
 
-  std::unique_ptr<OrbVocabulary> vocab;
+  std::shared_ptr<const OrbVocabulary> vocab;
   if (preloaded_vocab && preloaded_vocab->vocab) {
     vocab = std::move(preloaded_vocab->vocab);
   } else {
@@ -166,20 +274,38 @@ LoopClosureDetector::LoopClosureDetector(
   lcd_tp_wrapper_ = std::make_unique<LcdThirdPartyWrapper>(lcd_params_);
 
   // Initialize db_BoW_:
-  db_BoW_ = std::make_unique<OrbDatabase>(*vocab);
+  db_BoW_ = std::make_unique<BowDatabase>(std::move(vocab),
+                                          lcd_params_.bow_database);
+  if (lcd_params_.spatial_gating.enabled) {
+    spatial_index_ =
+        std::make_unique<KeyframeSpatialIndex>(lcd_params_.spatial_gating);
+  }
+  resetGlobalDescriptors(*db_BoW_->getVocabulary());
 
-  // Initialize pgo_:
-  // TODO(marcus): parametrize the verbosity of PGO params
-  KimeraRPGO::RobustSolverParams pgo_params;
-  pgo_params.setPcmSimple3DParams(lcd_params_.odom_trans_threshold_,
-                                  lcd_params_.odom_rot_threshold_,
-                                  lcd_params_.pcm_trans_threshold_,
-                                  lcd_params_.pcm_rot_threshold_,
-                                  KimeraRPGO::Verbosity::QUIET);
-  if (lcd_params_.gnc_alpha_ > 0 && lcd_params_.gnc_alpha_ < 1) {
-    pgo_params.setGncInlierCostThresholdsAtProbability(lcd_params_.gnc_alpha_);
+  // Initialize pgo_ (or incremental_pgo_):
+  if (lcd_params_.incremental_pcm.window_size > 0) {
+    incremental_pcm_ =
+        std::make_unique<IncrementalPcm>(lcd_params_.incremental_pcm);
+  }
+  if (lcd_params_.incremental_pgo.enabled) {
+    incremental_pgo_ =
+        std::make_unique<IncrementalPgo>(lcd_params_.incremental_pgo);
+  } else {
+    // TODO(marcus): parametrize the verbosity of PGO params
+    KimeraRPGO::RobustSolverParams pgo_params;
+    // The loop closures checked by incremental_pcm_ skip KimeraRPGO's PCM.
+    pgo_params.setPcmSimple3DParams(
+        lcd_params_.odom_trans_threshold_,
+        lcd_params_.odom_rot_threshold_,
+        incremental_pcm_ ? -1.0 : lcd_params_.pcm_trans_threshold_,
+        incremental_pcm_ ? -1.0 : lcd_params_.pcm_rot_threshold_,
+        KimeraRPGO::Verbosity::QUIET);
+    if (lcd_params_.gnc_alpha_ > 0 && lcd_params_.gnc_alpha_ < 1) {
+      pgo_params.setGncInlierCostThresholdsAtProbability(
+          lcd_params_.gnc_alpha_);
+    }
+    pgo_ = std::make_unique<KimeraRPGO::RobustSolver>(pgo_params);
   }
-  pgo_ = std::make_unique<KimeraRPGO::RobustSolver>(pgo_params);
 
   if (log_output) {
     logger_ = std::make_unique<LoopClosureDetectorLogger>();
@@ -188,32 +314,102 @@ LoopClosureDetector::LoopClosureDetector(
   if (VLOG_IS_ON(1)) {
     print();
   }
+
+  if (!lcd_params_.prior_map_path_.empty()) {
+    LOG_IF(ERROR, !loadPriorMap(lcd_params_.prior_map_path_))
+        << "LoopClosureDetector: failed to load the prior map, running "
+           "without it.";
+  }
+
+  // Launch the verification workers last, once everything is initialized.
+  for (const Tracker::UniquePtr& tracker : verification_trackers_) {
+    verification_workers_.emplace_back(
+        &LoopClosureDetector::verificationWorker, this, tracker.get());
+  }
 }
 
 LoopClosureDetector::~LoopClosureDetector() {
   LOG(INFO) << "LoopClosureDetector desctuctor called.";
+  shutdownVerification();
+  if (!lcd_params_.save_map_path_.empty() && cache_.size() > 0u) {
+    saveMap(lcd_params_.save_map_path_);
+  }
 }
 
 /* ------------------------------------------------------------------------ */
 LcdOutput::UniquePtr LoopClosureDetector::spinOnce(const LcdInput& input) {
   CHECK_GE(input.cur_kf_id_, 0);
+  addKeyframeOdometry(input.timestamp_, input.cur_kf_id_, input.W_Pose_Blkf_);
+
+  // Process the StereoFrame and check for a loop closure with previous ones.
+  const FrameId lcd_frame_id = processAndAddFrame(input);
+  return detectAndOutput(input.timestamp_,
+                         input.cur_kf_id_,
+                         input.W_Pose_Blkf_,
+                         lcd_frame_id,
+                         input.frontend_output_->getTrackerStatus(),
+                         nullptr);
+}
+
+/* ------------------------------------------------------------------------ */
+LcdOutput::UniquePtr LoopClosureDetector::spinOnceWithFrame(
+    const Timestamp& timestamp,
+    const FrameId& kf_id,
+    const gtsam::Pose3& W_Pose_Blkf,
+    const LCDFrame::Ptr& frame,
+    const DBoW2::BowVector* bow_vec) {
+  CHECK(frame);
+  CHECK_EQ(frame->timestamp_, timestamp);
+  addKeyframeOdometry(timestamp, kf_id, W_Pose_Blkf);
+  // Cached as is: the frame was already processed.
+  const FrameId lcd_frame_id = cache_.addFrame(frame);
+  return detectAndOutput(
+      timestamp, kf_id, W_Pose_Blkf, lcd_frame_id, nullptr, bow_vec);
+}
+
+/* ------------------------------------------------------------------------ */
+void LoopClosureDetector::verifyLoop(const LCDFrame& match_frame,
+                                     const LCDFrame& query_frame,
+                                     LoopResult* result) {
+  verifyAndRecoverPose(match_frame, query_frame, tracker_.get(), result);
+}
 
+/* ------------------------------------------------------------------------ */
+void LoopClosureDetector::computeBowVector(const LCDFrame& frame,
+                                           DBoW2::BowVector* bow_vec) const {
+  CHECK_NOTNULL(bow_vec);
+  db_BoW_->getVocabulary()->transform(descriptorRows(frame.descriptors_mat_),
+                                      *bow_vec);
+}
+
+/* ------------------------------------------------------------------------ */
+FrameId LoopClosureDetector::storeFrame(const LCDFrame::Ptr& frame) {
+  return cache_.addFrame(frame);
+}
+
+/* ------------------------------------------------------------------------ */
+void LoopClosureDetector::addKeyframeOdometry(const Timestamp& timestamp,
+                                              const FrameId& kf_id,
+                                              const gtsam::Pose3& W_Pose_Blkf) {
   // Update the PGO with the Backend VIO estimate.
   // TODO(marcus): only add factor if it's a set distance away from previous
   // TODO(marcus): OdometryPose vs OdometryFactor
-  timestamp_map_[input.cur_kf_id_] = input.timestamp_;
-  OdometryFactor odom_factor(
-      input.cur_kf_id_, input.W_Pose_Blkf_, shared_noise_model_);
+  timestamp_map_[kf_id] = timestamp;
+  if (lcd_params_.relocalize_after_tracking_loss_) {
+    CHECK_EQ(vio_trajectory_.size(), kf_id);
+    vio_trajectory_.push_back(W_Pose_Blkf);
+  }
+  OdometryFactor odom_factor(kf_id, W_Pose_Blkf, shared_noise_model_);
 
   switch (lcd_state_) {
     case LcdState::Bootstrap: {
-      CHECK_EQ(pgo_->calculateEstimate().size(), 0);
+      CHECK_EQ(calculatePgoEstimate().size(), 0);
       initializePGO(odom_factor);
       break;
     }
     case LcdState::Nominal: {
-      // TODO(marcus): need a better check than this:
-      CHECK_GT(pgo_->calculateEstimate().size(), 0);
+      // One pose per keyframe published so far, without copying the PGO.
+      CHECK_EQ(published_trajectory_.size(), kf_id);
       addOdometryFactorAndOptimize(odom_factor);
       break;
     }
@@ -221,9 +417,11 @@ LcdOutput::UniquePtr LoopClosureDetector::spinOnce(const LcdInput& input) {
       LOG(FATAL) << "Unrecognized LCD state.";
     }
   }
+}
 
-  // Process the StereoFrame and check for a loop closure with previous ones.
-  FrameId lcd_frame_id;
+/* ------------------------------------------------------------------------ */
+FrameId LoopClosureDetector::processAndAddFrame(const LcdInput& input) {
+  FrameId lcd_frame_id = 0u;
   switch (input.frontend_output_->frontend_type_) {
     case FrontendType::kMonoImu: {
       auto mono_frontend_output =
@@ -232,7 +430,7 @@ LcdOutput::UniquePtr LoopClosureDetector::spinOnce(const LcdInput& input) {
       if (lcd_params_.pose_recovery_type_ == PoseRecoveryType::kPnP ||
           lcd_params_.pose_recovery_type_ == PoseRecoveryType::k5ptRotOnly) {
         lcd_frame_id = processAndAddMonoFrame(mono_frontend_output->frame_lkf_,
-                                              input.W_points_with_ids_,
+                                              *input.W_points_with_ids_,
                                               input.W_Pose_Blkf_);
       } else {
         LOG(FATAL) << "We have a mono frontend but no PnP pose recovery in LCD "
@@ -246,7 +444,7 @@ LcdOutput::UniquePtr LoopClosureDetector::spinOnce(const LcdInput& input) {
               input.frontend_output_);
       CHECK(stereo_frontend_output);
       lcd_frame_id =
-          processAndAddStereoFrame(stereo_frontend_output->stereo_frame_lkf_);
+          processAndAddStereoFrame(*stereo_frontend_output->stereo_frame_lkf_);
       break;
     }
     case FrontendType::kRgbdImu: {
@@ -262,72 +460,105 @@ LcdOutput::UniquePtr LoopClosureDetector::spinOnce(const LcdInput& input) {
           << "LoopClosureDetector not implemented for this frontend type.";
     }
   }
+  return lcd_frame_id;
+}
+
+/* ------------------------------------------------------------------------ */
+LcdOutput::UniquePtr LoopClosureDetector::detectAndOutput(
+    const Timestamp& timestamp,
+    const FrameId& cur_kf_id,
+    const gtsam::Pose3& W_Pose_Blkf,
+    const FrameId& lcd_frame_id,
+    const TrackerStatusSummary* tracker_status,
+    const DBoW2::BowVector* bow_vec) {
+  if (spatial_index_) {
+    spatial_index_->addKeyframe(lcd_frame_id, W_Pose_Blkf.translation());
+  }
 
   const auto curr_frame = cache_.getFrame(lcd_frame_id);
   CHECK(curr_frame) << "Invalid frame requested!";
+  frame_cache_memory_.set(cache_.getResidentBytes());
+  if (utils::isMemoryAccountingEnabled()) {
+    bow_database_memory_.set(db_BoW_->getMemoryBytes());
+  }
   DBoW2::BowVector curr_bow_vec;
-  db_BoW_->getVocabulary()->transform(curr_frame->descriptors_vec_,
-                                      curr_bow_vec);
+  if (bow_vec) {
+    curr_bow_vec = *bow_vec;
+  } else {
+    computeBowVector(*curr_frame, &curr_bow_vec);
+  }
 
   LoopResult loop_result;
   loop_result.status_ = LCDStatus::NO_MATCHES;
-  if (!FLAGS_lcd_no_detection) {
+  const bool do_detection =
+      !FLAGS_lcd_no_detection &&
+      (!is_detection_admitted_cb_ || is_detection_admitted_cb_());
+  if (do_detection) {
     detectLoop(lcd_frame_id, curr_bow_vec, &loop_result);
+  } else if (!FLAGS_lcd_no_detection) {
+    // Not queried, but still a candidate for the next keyframes.
+    addToDatabase(lcd_frame_id, curr_bow_vec);
+  }
+
+  // Relocalize in the prior map, if any (always verified synchronously).
+  if (prior_map_ && do_detection) {
+    LoopResult prior_map_result;
+    detectPriorMapLoop(*curr_frame, curr_bow_vec, &prior_map_result);
+    if (prior_map_result.isLoop()) {
+      VLOG(1) << "LoopClosureDetector: LOOP CLOSURE detected from prior map "
+              << "keyframe " << prior_map_result.match_id_ << " to keyframe "
+              << prior_map_result.query_id_;
+      addPriorMapFactor(prior_map_result);
+    }
+  }
+
+  // Relocalize the keyframes tracked again after a tracking loss.
+  if (lcd_params_.relocalize_after_tracking_loss_ && tracker_status &&
+      !FLAGS_lcd_no_detection) {
+    LoopResult relocalization_result;
+    relocalizeAfterTrackingLoss(
+        lcd_frame_id, curr_bow_vec, *tracker_status, &relocalization_result);
   }
 
   // Update latest bowvec for normalized similarity scoring (NSS).
   if (static_cast<int>(lcd_frame_id + 1) > lcd_params_.recent_frames_window_) {
     latest_bowvec_.reset(new DBoW2::BowVector(curr_bow_vec));
+    if (global_descriptor_extractor_) {
+      latest_global_descriptor_ = getGlobalDescriptor(lcd_frame_id);
+    }
   } else {
     VLOG(3) << "LoopClosureDetector: Not enough frames processed.";
   }
 
-  // Build and add LC factor if result is a loop closure.
-  if (loop_result.isLoop()) {
-    VLOG(1) << "LoopClosureDetector: LOOP CLOSURE detected from keyframe "
-            << loop_result.match_id_ << " to keyframe "
-            << loop_result.query_id_;
-
-    utils::StatsCollector stat_pgo_timing(
-        "PGO Update/Optimization Timing [ms]");
-    auto tic = utils::Timer::tic();
-
-    if (lcd_params_.pose_recovery_type_ == PoseRecoveryType::k5ptRotOnly) {
-      // Rotation part of the information matrix of the noise model emphasized.
-      gtsam::Matrix mat_info = gtsam::Matrix::Identity(6, 6);
-      gtsam::Matrix mat_info_rotation_part =
-          lcd_params_.betweenRotationPrecision_ * gtsam::Matrix::Identity(3, 3);
-      mat_info.block<3, 3>(0, 0) = (mat_info_rotation_part);
-
-      // Zero out the translation part of the noise model to only use the 2d2d
-      // pose for the loop closure factor.
-      // mat_info.block<3, 3>(3, 3) = gtsam::Matrix::Identity(3, 3) * 0.0;
-      mat_info.block<3, 3>(3, 3) = gtsam::Matrix::Identity(3, 3) * 1e-12;
-
-      // Instantiate a noise model from the rotation-only information matrix.
-      gtsam::SharedNoiseModel noise_model_5pt_rotation_only =
-          gtsam::noiseModel::Diagonal::Information(mat_info);
-
-      // Refresh timer because all previous stuff irrelevant to PGO timing.
-      tic = utils::Timer::tic();
-      addLoopClosureFactorAndOptimize(
-          LoopClosureFactor(loop_result.match_id_,
-                            loop_result.query_id_,
-                            loop_result.relative_pose_,
-                            noise_model_5pt_rotation_only));
+  // Build and add LC factors if the results are loop closures: in
+  // asynchronous mode, the ones verified since the last spinOnce, while this
+  // keyframe's candidate (if any) is being verified.
+  std::vector<LoopResult> verified_results;
+  if (isVerificationAsync()) {
+    VLOG(2) << "LoopClosureDetector: Detection result: "
+            << LoopResult::asString(loop_result.status_);
+    verified_results = takeVerifiedResults();
+  } else {
+    verified_results.push_back(loop_result);
+  }
+  for (const LoopResult& verified_result : verified_results) {
+    if (verified_result.isLoop()) {
+      VLOG(1) << "LoopClosureDetector: LOOP CLOSURE detected from keyframe "
+              << verified_result.match_id_ << " to keyframe "
+              << verified_result.query_id_;
+      addLoopClosure(verified_result);
+      // Report the latest loop closure.
+      loop_result = verified_result;
     } else {
-      addLoopClosureFactorAndOptimize(
-          LoopClosureFactor(loop_result.match_id_,
-                            loop_result.query_id_,
-                            loop_result.relative_pose_,
-                            shared_noise_model_));
+      VLOG(2) << "LoopClosureDetector: No loop closure detected. Reason: "
+              << LoopResult::asString(verified_result.status_);
     }
-
-    auto update_duration = utils::Timer::toc(tic).count();
-    stat_pgo_timing.AddSample(update_duration);
-  } else {
-    VLOG(2) << "LoopClosureDetector: No loop closure detected. Reason: "
-            << LoopResult::asString(loop_result.status_);
+  }
+  // The buffered loop closures are added once no other is likely to follow.
+  if (!pending_loop_closures_.empty() &&
+      cur_kf_id >= pending_loop_closures_kf_id_ +
+                              lcd_params_.loop_closure_batch_window_) {
+    addLoopClosureBatchAndOptimize();
   }
 
   // Timestamps for PGO and for LCD should match now.
@@ -335,52 +566,78 @@ LcdOutput::UniquePtr LoopClosureDetector::spinOnce(const LcdInput& input) {
   CHECK_EQ(timestamp_map_.size(), cache_.size());
   CHECK_EQ(timestamp_map_.size(), W_Pose_B_kf_vio_.first + 1);
 
-  // Construct output payload.
-  CHECK(pgo_);
+  // Construct output payload: the full trajectory and graph are only copied
+  // when a loop closure changed them, else only the new keyframe is sent.
   const gtsam::Pose3& w_Pose_map = getWPoseMap();
   const gtsam::Pose3& map_Pose_odom = getMapPoseOdom();
-  const gtsam::Values& pgo_states = pgo_->calculateEstimate();
-  const gtsam::NonlinearFactorGraph& pgo_nfg = pgo_->getFactorsUnsafe();
+  bool is_trajectory_corrected = false;
+  const gtsam::Values& pgo_states =
+      updatePublishedTrajectory(&is_trajectory_corrected);
+  const gtsam::NonlinearFactorGraph& pgo_nfg =
+      loop_result.isLoop() || is_trajectory_corrected
+          ? getPgoFactors()
+          : gtsam::NonlinearFactorGraph();
 
   LcdOutput::UniquePtr output_payload = nullptr;
   if (loop_result.isLoop()) {
     output_payload =
         std::make_unique<LcdOutput>(true,
-                                    input.timestamp_,
+                                    timestamp,
                                     timestamp_map_.at(loop_result.query_id_),
                                     timestamp_map_.at(loop_result.match_id_),
                                     loop_result.match_id_,
                                     loop_result.query_id_,
                                     loop_result.relative_pose_);
   } else {
-    output_payload = std::make_unique<LcdOutput>(input.timestamp_);
+    output_payload = std::make_unique<LcdOutput>(timestamp);
   }
 
   CHECK(output_payload) << "Missing LCD output payload.";
 
   output_payload->setMapInformation(
       w_Pose_map, map_Pose_odom, pgo_states, pgo_nfg);
+  output_payload->is_trajectory_corrected_ = is_trajectory_corrected;
 
   output_payload->setFrameInformation(curr_frame->keypoints_3d_,
                                       curr_frame->bearing_vectors_,
                                       curr_bow_vec,
                                       curr_frame->descriptors_mat_);
-  output_payload->timestamp_map_ = timestamp_map_;
+  for (const gtsam::Key& key : pgo_states.keys()) {
+    const FrameId kf_id = gtsam::Symbol(key).index();
+    output_payload->timestamp_map_[kf_id] = timestamp_map_.at(kf_id);
+  }
 
   if (logger_) {
+    std::lock_guard<std::mutex> lock(logger_mutex_);
     debug_info_.timestamp_ = output_payload->timestamp_;
     debug_info_.loop_result_ = loop_result;
-    debug_info_.pgo_size_ = pgo_->size();
-    debug_info_.pgo_lc_count_ = pgo_->getNumLC();
-    debug_info_.pgo_lc_inliers_ = pgo_->getNumLCInliers();
+    if (incremental_pgo_) {
+      // No outlier rejection: all loop closures are inliers.
+      debug_info_.pgo_size_ = incremental_pgo_->getNumNodes();
+      debug_info_.pgo_lc_count_ = incremental_pgo_->getNumLC();
+      debug_info_.pgo_lc_inliers_ = incremental_pgo_->getNumLC();
+    } else {
+      debug_info_.pgo_size_ = pgo_->size();
+      debug_info_.pgo_lc_count_ = pgo_->getNumLC();
+      debug_info_.pgo_lc_inliers_ = pgo_->getNumLCInliers();
+    }
+    if (incremental_pcm_) {
+      // Including the loop closures it rejected.
+      debug_info_.pgo_lc_count_ = incremental_pcm_->getNumLC();
+      if (incremental_pgo_) {
+        debug_info_.pgo_lc_inliers_ = incremental_pcm_->getNumLCInliers();
+      }
+    }
 
-    debug_info_.mono_input_size_ = tracker_->debug_info_.nrMonoPutatives_;
-    debug_info_.mono_inliers_ = tracker_->debug_info_.nrMonoInliers_;
-    debug_info_.mono_iter_ = tracker_->debug_info_.monoRansacIters_;
+    // From the tracker that verified the loop closure: in asynchronous mode,
+    // the one of a verification worker, not tracker_.
+    debug_info_.mono_input_size_ = loop_result.mono_input_size_;
+    debug_info_.mono_inliers_ = loop_result.mono_inliers_;
+    debug_info_.mono_iter_ = loop_result.mono_iter_;
 
-    debug_info_.stereo_input_size_ = tracker_->debug_info_.nrStereoPutatives_;
-    debug_info_.stereo_inliers_ = tracker_->debug_info_.nrStereoInliers_;
-    debug_info_.stereo_iter_ = tracker_->debug_info_.stereoRansacIters_;
+    debug_info_.stereo_input_size_ = loop_result.stereo_input_size_;
+    debug_info_.stereo_inliers_ = loop_result.stereo_inliers_;
+    debug_info_.stereo_iter_ = loop_result.stereo_iter_;
 
     logger_->logTimestampMap(timestamp_map_);
     logger_->logDebugInfo(debug_info_);
@@ -402,23 +659,29 @@ FrameId LoopClosureDetector::processAndAddMonoFrame(
       // translation.
       std::vector<cv::KeyPoint> keypoints;
       OrbDescriptor descriptors_mat;
-      OrbDescriptorVec descriptors_vec;
-      getNewFeaturesAndDescriptors(frame.img_, &keypoints, &descriptors_mat);
-      descriptorMatToVec(descriptors_mat, &descriptors_vec);
+      if (lcd_params_.reuse_frontend_features_) {
+        std::vector<size_t> indices;
+        getDescriptorsAtKeypoints(frame.img_,
+                                  frame.keypoints_,
+                                  &keypoints,
+                                  &descriptors_mat,
+                                  &indices);
+      } else {
+        getNewFeaturesAndDescriptors(frame.img_, &keypoints, &descriptors_mat);
+      }
 
+      KeypointsCV keypoints_cv;
+      cv::KeyPoint::convert(keypoints, keypoints_cv);
       BearingVectors versors;
-      for (const cv::KeyPoint& keypoint : keypoints) {
-        versors.push_back(UndistorterRectifier::GetBearingVector(
-            keypoint.pt, frame.cam_param_));
-      }
+      UndistorterRectifier::GetBearingVectors(
+          keypoints_cv, frame.cam_param_, &versors);
 
-      return cache_.addFrame(std::make_shared<LCDFrame>(
+      return storeFrame(std::make_shared<LCDFrame>(
           frame.timestamp_,
           FrameCache::NEW_ID,
           frame.id_,
           keypoints,
           Landmarks(),  // no 3d keypoints required for the 5-pt-only method
-          descriptors_vec,
           descriptors_mat,
           versors));
     } break;
@@ -436,6 +699,11 @@ FrameId LoopClosureDetector::processAndAddMonoFrame(
       CHECK_EQ(frame.versors_.size(), nr_kpts);
       CHECK_EQ(frame.keypoints_undistorted_.size(), nr_kpts);
 
+      if (lcd_params_.reuse_frontend_features_) {
+        return processAndAddMonoFrameWithTrackedFeatures(
+            frame, W_points_with_ids, W_Pose_Blkf);
+      }
+
       // Re-detect tracker features but with orientation for better descriptors
       // NOTE: see feature/omni/stereo from mubarik
       // TODO(marcus): collapse this with feature/omni/stereo and consider
@@ -528,24 +796,20 @@ FrameId LoopClosureDetector::processAndAddMonoFrame(
                                        keypoints_for_descriptor_compute_culled,
                                        descriptors_mat);
       }
-      OrbDescriptorVec descriptors_vec;
-      descriptorMatToVec(descriptors_mat, &descriptors_vec);
 
       size_t nr_kpts_culled = keypoints_for_descriptor_compute_culled.size();
       CHECK_EQ(keypoints_to_save.size(), nr_kpts_culled);
       CHECK_EQ(keypoints_3d.size(), nr_kpts_culled);
-      CHECK_EQ(descriptors_vec.size(), nr_kpts_culled);
+      CHECK_EQ(static_cast<size_t>(descriptors_mat.rows), nr_kpts_culled);
       CHECK_EQ(undistorted_bearing_vectors.size(), nr_kpts_culled);
-      CHECK_EQ(descriptors_vec.size(), nr_kpts_culled);
 
       // Build and store LCDFrame object.
-      return cache_.addFrame(
+      return storeFrame(
           std::make_shared<LCDFrame>(frame.timestamp_,
                                      FrameCache::NEW_ID,
                                      frame.id_,
                                      keypoints_to_save,
                                      keypoints_3d,
-                                     descriptors_vec,
                                      descriptors_mat,
                                      undistorted_bearing_vectors));
     } break;
@@ -564,29 +828,109 @@ FrameId LoopClosureDetector::processAndAddMonoFrame(
   throw std::runtime_error("Invalid pose recovery type");
 }
 
+/* ------------------------------------------------------------------------ */
+FrameId LoopClosureDetector::processAndAddMonoFrameWithTrackedFeatures(
+    const Frame& frame,
+    const PointsWithIdMap& W_points_with_ids,
+    const gtsam::Pose3& W_Pose_Blkf) {
+  // Only the tracked keypoints with a landmark in the backend are kept.
+  KeypointsCV keypoints_with_lmk;
+  std::vector<LandmarkId> lmk_ids;
+  for (size_t i = 0u; i < frame.keypoints_.size(); ++i) {
+    const LandmarkId& lmk_id = frame.landmarks_[i];
+    if (W_points_with_ids.find(lmk_id) != W_points_with_ids.end()) {
+      keypoints_with_lmk.push_back(frame.keypoints_[i]);
+      lmk_ids.push_back(lmk_id);
+    }
+  }
+
+  std::vector<cv::KeyPoint> keypoints;
+  OrbDescriptor descriptors_mat;
+  std::vector<size_t> indices;
+  getDescriptorsAtKeypoints(frame.img_,
+                            keypoints_with_lmk,
+                            &keypoints,
+                            &descriptors_mat,
+                            &indices);
+
+  // Landmarks in the local camera frame, as in the stereo case.
+  const gtsam::Pose3 Cam_Pose_W = (W_Pose_Blkf * B_Pose_Cam_).inverse();
+  BearingVectors bearing_vectors;
+  Landmarks keypoints_3d;
+  for (const size_t& i : indices) {
+    bearing_vectors.push_back(UndistorterRectifier::GetBearingVector(
+        keypoints_with_lmk[i], frame.cam_param_));
+    keypoints_3d.push_back(Cam_Pose_W * W_points_with_ids.at(lmk_ids[i]));
+  }
+
+  return storeFrame(std::make_shared<LCDFrame>(frame.timestamp_,
+                                                    FrameCache::NEW_ID,
+                                                    frame.id_,
+                                                    keypoints,
+                                                    keypoints_3d,
+                                                    descriptors_mat,
+                                                    bearing_vectors));
+}
+
 /* ------------------------------------------------------------------------ */
 FrameId LoopClosureDetector::processAndAddStereoFrame(
     const StereoFrame& stereo_frame) {
   std::vector<cv::KeyPoint> keypoints;
   OrbDescriptor descriptors_mat;
-  OrbDescriptorVec descriptors_vec;
+  if (lcd_params_.reuse_frontend_features_) {
+    // The frontend keypoints are already stereo matched and triangulated.
+    const Frame& left_frame = stereo_frame.left_frame_;
+    const size_t nr_kpts = left_frame.keypoints_.size();
+    CHECK_EQ(left_frame.versors_.size(), nr_kpts);
+    CHECK_EQ(stereo_frame.keypoints_3d_.size(), nr_kpts);
+    CHECK_EQ(stereo_frame.left_keypoints_rectified_.size(), nr_kpts);
+    CHECK_EQ(stereo_frame.right_keypoints_rectified_.size(), nr_kpts);
+    std::vector<size_t> indices;
+    getDescriptorsAtKeypoints(left_frame.img_,
+                              left_frame.keypoints_,
+                              &keypoints,
+                              &descriptors_mat,
+                              &indices);
+
+    Landmarks keypoints_3d;
+    BearingVectors versors;
+    StatusKeypointsCV left_keypoints_rectified;
+    StatusKeypointsCV right_keypoints_rectified;
+    for (const size_t& i : indices) {
+      keypoints_3d.push_back(stereo_frame.keypoints_3d_[i]);
+      versors.push_back(left_frame.versors_[i]);
+      left_keypoints_rectified.push_back(
+          stereo_frame.left_keypoints_rectified_[i]);
+      right_keypoints_rectified.push_back(
+          stereo_frame.right_keypoints_rectified_[i]);
+    }
+    return storeFrame(
+        std::make_shared<StereoLCDFrame>(stereo_frame.timestamp_,
+                                         FrameCache::NEW_ID,
+                                         stereo_frame.id_,
+                                         keypoints,
+                                         keypoints_3d,
+                                         descriptors_mat,
+                                         versors,
+                                         left_keypoints_rectified,
+                                         right_keypoints_rectified));
+  }
+
   getNewFeaturesAndDescriptors(
       stereo_frame.left_frame_.img_, &keypoints, &descriptors_mat);
-  descriptorMatToVec(descriptors_mat, &descriptors_vec);
 
   // Fill StereoFrame with ORB keypoints and perform stereo matching.
   StereoFrame cp_stereo_frame(stereo_frame);
   rewriteStereoFrameFeatures(keypoints, &cp_stereo_frame);
 
   // Build and store LCDFrame object.
-  return cache_.addFrame(std::make_shared<StereoLCDFrame>(
+  return storeFrame(std::make_shared<StereoLCDFrame>(
       cp_stereo_frame.timestamp_,
       FrameCache::NEW_ID,
       cp_stereo_frame.id_,
       keypoints,
       // keypoints_3d_ are in local (camera) frame
       cp_stereo_frame.keypoints_3d_,
-      descriptors_vec,
       descriptors_mat,
       cp_stereo_frame.left_frame_.versors_,
       cp_stereo_frame.left_keypoints_rectified_,
@@ -598,10 +942,18 @@ FrameId LoopClosureDetector::processAndAddRgbdFrame(
     const RgbdFrame& rgbd_frame) {
   std::vector<cv::KeyPoint> keypoints;
   OrbDescriptor descriptors_mat;
-  OrbDescriptorVec descriptors_vec;
-  getNewFeaturesAndDescriptors(
-      rgbd_frame.intensity_img_.img_, &keypoints, &descriptors_mat);
-  descriptorMatToVec(descriptors_mat, &descriptors_vec);
+  if (lcd_params_.reuse_frontend_features_) {
+    // Only the depth of the tracked keypoints is looked up again.
+    std::vector<size_t> indices;
+    getDescriptorsAtKeypoints(rgbd_frame.intensity_img_.img_,
+                              rgbd_frame.intensity_img_.keypoints_,
+                              &keypoints,
+                              &descriptors_mat,
+                              &indices);
+  } else {
+    getNewFeaturesAndDescriptors(
+        rgbd_frame.intensity_img_.img_, &keypoints, &descriptors_mat);
+  }
 
   // Fill StereoFrame with ORB keypoints and perform stereo matching.
   auto cp_stereo_frame = rgbd_frame.getStereoFrame();
@@ -617,14 +969,13 @@ FrameId LoopClosureDetector::processAndAddRgbdFrame(
   rgbd_frame.fillStereoFrame(*rgbd_camera_, *cp_stereo_frame);
 
   // Build and store LCDFrame object.
-  return cache_.addFrame(std::make_shared<StereoLCDFrame>(
+  return storeFrame(std::make_shared<StereoLCDFrame>(
       cp_stereo_frame->timestamp_,
       FrameCache::NEW_ID,
       cp_stereo_frame->id_,
       keypoints,
       // keypoints_3d_ are in local (camera) frame
       cp_stereo_frame->keypoints_3d_,
-      descriptors_vec,
       descriptors_mat,
       cp_stereo_frame->left_frame_.versors_,
       cp_stereo_frame->left_keypoints_rectified_,
@@ -639,25 +990,44 @@ void LoopClosureDetector::getNewFeaturesAndDescriptors(
   CHECK_NOTNULL(keypoints);
   CHECK_NOTNULL(descriptors_mat);
   // TODO(marcus): switch on feature type (orb, etc) when more are supported
-  // Extract ORB features and construct descriptors_vec.
-  orb_feature_detector_->detectAndCompute(
-      img, cv::Mat(), *keypoints, *descriptors_mat);
+  // Extract ORB features and their descriptors.
+  if (gpu_orb_extractor_) {
+    gpu_orb_extractor_->detectAndCompute(img, keypoints, descriptors_mat);
+  } else {
+    orb_feature_detector_->detectAndCompute(
+        img, cv::Mat(), *keypoints, *descriptors_mat);
+  }
 }
 
 /* ------------------------------------------------------------------------ */
-void LoopClosureDetector::descriptorMatToVec(
-    const OrbDescriptor& descriptors_mat,
-    OrbDescriptorVec* descriptors_vec) {
-  CHECK_NOTNULL(descriptors_vec);
-
-  // TODO(marcus): tied to ORB, need to generalize!
-  int L = orb_feature_detector_->descriptorSize();
-  descriptors_vec->resize(descriptors_mat.size().height);
+void LoopClosureDetector::getDescriptorsAtKeypoints(
+    const cv::Mat& img,
+    const KeypointsCV& keypoints_cv,
+    std::vector<cv::KeyPoint>* keypoints,
+    OrbDescriptor* descriptors_mat,
+    std::vector<size_t>* indices) {
+  CHECK_NOTNULL(keypoints);
+  CHECK_NOTNULL(descriptors_mat);
+  CHECK_NOTNULL(indices);
+  CHECK_EQ(img.type(), CV_8UC1);
+  const int radius = lcd_params_.patch_sze_ / 2;
+  keypoints->clear();
+  keypoints->reserve(keypoints_cv.size());
+  for (size_t i = 0u; i < keypoints_cv.size(); ++i) {
+    // The class_id keeps track of the keypoints ORB drops.
+    keypoints->emplace_back(keypoints_cv[i],
+                            static_cast<float>(lcd_params_.patch_sze_),
+                            orbOrientation(img, keypoints_cv[i], radius),
+                            0.0f,
+                            0,
+                            static_cast<int>(i));
+  }
+  orb_feature_detector_->compute(img, *keypoints, *descriptors_mat);
 
-  for (size_t i = 0; i < descriptors_vec->size(); i++) {
-    (*descriptors_vec)[i] =
-        cv::Mat(1, L, descriptors_mat.type());  // one row only
-    descriptors_mat.row(i).copyTo((*descriptors_vec)[i].row(0));
+  indices->clear();
+  indices->reserve(keypoints->size());
+  for (const cv::KeyPoint& keypoint : *keypoints) {
+    indices->push_back(static_cast<size_t>(keypoint.class_id));
   }
 }
 
@@ -674,7 +1044,8 @@ void LoopClosureDetector::detectLoopById(const FrameId& frame_id,
   }
 
   DBoW2::BowVector curr_bow_vec;
-  db_BoW_->getVocabulary()->transform(frame->descriptors_vec_, curr_bow_vec);
+  db_BoW_->getVocabulary()->transform(descriptorRows(frame->descriptors_mat_),
+                                      curr_bow_vec);
   detectLoop(frame_id, curr_bow_vec, result);
 }
 
@@ -682,6 +1053,8 @@ void LoopClosureDetector::detectLoopById(const FrameId& frame_id,
 void LoopClosureDetector::detectLoop(const FrameId& frame_id,
                                      const DBoW2::BowVector& bow_vec,
                                      LoopResult* result) {
+  KIMERA_TRACE_SCOPE("LoopClosureDetector::detectLoop");
+  KIMERA_PERF_SCOPE("LoopClosureDetector::detectLoop");
   CHECK_NOTNULL(result);
   result->query_id_ = frame_id;
 
@@ -690,15 +1063,74 @@ void LoopClosureDetector::detectLoop(const FrameId& frame_id,
     max_possible_match_id = 0;
   }
 
-  // Query for BoW vector matches in database.
+  // The frames following the last match are likely to match next: load them
+  // from disk while querying the database.
+  if (lcd_params_.prefetch_temporal_neighbors_ > 0 && last_match_id_) {
+    std::vector<size_t> neighbors;
+    for (int i = 1; i <= lcd_params_.prefetch_temporal_neighbors_; ++i) {
+      neighbors.push_back(*last_match_id_ + i);
+    }
+    cache_.prefetch(neighbors);
+  }
+
+  // Query for BoW vector matches in database: only the keyframes near this
+  // one, if their odometry is trusted (not across a tracking loss).
   DBoW2::QueryResults query_result;
-  db_BoW_->query(bow_vec,
-                 query_result,
-                 lcd_params_.max_db_results_,
-                 max_possible_match_id);
+  std::vector<unsigned int> spatial_candidates;
+  if (global_descriptor_index_) {
+    std::vector<HnswIndex::Result> results;
+    global_descriptor_index_->search(
+        getGlobalDescriptor(frame_id),
+        lcd_params_.max_db_results_ > 0
+            ? static_cast<size_t>(lcd_params_.max_db_results_)
+            : global_descriptor_index_->size(),
+        static_cast<HnswIndex::Label>(max_possible_match_id),
+        &results);
+    // Labeled by keyframe id.
+    for (const HnswIndex::Result& result : results) {
+      query_result.emplace_back(result.label, result.similarity);
+    }
+  } else if (spatial_index_ && !tracking_lost_kf_id_ &&
+      spatial_index_->getCandidates(
+          frame_id, max_possible_match_id, &spatial_candidates)) {
+    VLOG(10) << "LoopClosureDetector: querying " << spatial_candidates.size()
+             << " of " << max_possible_match_id << " keyframes.";
+    // Keyframes to the entries of the ones in the database.
+    std::vector<BowDatabase::EntryId> candidate_entries;
+    for (const unsigned int& candidate : spatial_candidates) {
+      const auto it = std::lower_bound(
+          db_frame_ids_.begin(), db_frame_ids_.end(), candidate);
+      if (it != db_frame_ids_.end() && *it == candidate) {
+        candidate_entries.push_back(
+            static_cast<BowDatabase::EntryId>(it - db_frame_ids_.begin()));
+      }
+    }
+    db_BoW_->queryCandidates(bow_vec,
+                             query_result,
+                             candidate_entries,
+                             lcd_params_.max_db_results_);
+    entryToFrameIds(&query_result);
+  } else {
+    db_BoW_->query(bow_vec,
+                   query_result,
+                   lcd_params_.max_db_results_,
+                   getNrEntriesBefore(max_possible_match_id));
+    entryToFrameIds(&query_result);
+  }
+
+  // Load the best matches while grouping them, before verifying one of them.
+  if (lcd_params_.prefetch_top_k_ > 0) {
+    std::vector<size_t> candidates;
+    for (size_t i = 0u; i < query_result.size() &&
+                        i < static_cast<size_t>(lcd_params_.prefetch_top_k_);
+         ++i) {
+      candidates.push_back(query_result[i].Id);
+    }
+    cache_.prefetch(candidates);
+  }
 
   // Add current BoW vector to database.
-  db_BoW_->add(bow_vec);
+  addToDatabase(frame_id, bow_vec);
 
   if (query_result.empty()) {
     result->status_ = LCDStatus::NO_MATCHES;
@@ -706,7 +1138,13 @@ void LoopClosureDetector::detectLoop(const FrameId& frame_id,
   }
 
   double nss_factor = 1.0;
-  if (lcd_params_.use_nss_ && latest_bowvec_) {
+  if (lcd_params_.use_nss_ && global_descriptor_extractor_) {
+    nss_factor = latest_global_descriptor_.empty()
+                     ? 0.0
+                     : GlobalDescriptorExtractor::similarity(
+                           getGlobalDescriptor(frame_id),
+                           latest_global_descriptor_);
+  } else if (lcd_params_.use_nss_ && latest_bowvec_) {
     nss_factor = db_BoW_->getVocabulary()->score(bow_vec, *latest_bowvec_);
   } else {
     LOG_IF(ERROR, !lcd_params_.use_nss_)
@@ -760,7 +1198,11 @@ void LoopClosureDetector::detectLoop(const FrameId& frame_id,
     return;
   }
 
-  verifyAndRecoverPose(result);
+  if (isVerificationAsync()) {
+    queueVerification(result);
+  } else {
+    verifyAndRecoverPose(result);
+  }
 }
 
 void LoopClosureDetector::verifyAndRecoverPose(LoopResult* result) {
@@ -773,38 +1215,318 @@ void LoopClosureDetector::verifyAndRecoverPose(LoopResult* result) {
     return;
   }
 
+  verifyAndRecoverPose(*match_frame, *query_frame, tracker_.get(), result);
+}
+
+void LoopClosureDetector::verifyAndRecoverPose(const LCDFrame& match_frame,
+                                               const LCDFrame& query_frame,
+                                               Tracker* tracker,
+                                               LoopResult* result) {
+  CHECK_NOTNULL(tracker);
+  CHECK_NOTNULL(result);
+
+  // The RANSAC statistics of this verification only, returned with its
+  // result since the tracker may be a verification worker's.
+  DebugTrackerInfo& tracker_info = tracker->debug_info_;
+  tracker_info.nrMonoPutatives_ = 0u;
+  tracker_info.nrMonoInliers_ = 0u;
+  tracker_info.monoRansacIters_ = 0u;
+  tracker_info.nrStereoPutatives_ = 0u;
+  tracker_info.nrStereoInliers_ = 0u;
+  tracker_info.stereoRansacIters_ = 0u;
+  const auto set_ransac_stats = [&tracker_info, result]() {
+    result->mono_input_size_ = tracker_info.nrMonoPutatives_;
+    result->mono_inliers_ = tracker_info.nrMonoInliers_;
+    result->mono_iter_ = static_cast<int>(tracker_info.monoRansacIters_);
+    result->stereo_input_size_ = tracker_info.nrStereoPutatives_;
+    result->stereo_inliers_ = tracker_info.nrStereoInliers_;
+    result->stereo_iter_ = static_cast<int>(tracker_info.stereoRansacIters_);
+  };
+
   // Find correspondences between keypoints.
   KeypointMatches matches_match_query;
-  computeDescriptorMatches(match_frame->descriptors_mat_,
-                           query_frame->descriptors_mat_,
-                           &matches_match_query,
-                           true);
+  if (lcd_params_.bow_guided_matching_ && use_orb_hamming_matcher_) {
+    computeBowGuidedDescriptorMatches(
+        match_frame, query_frame, &matches_match_query);
+  } else {
+    computeDescriptorMatches(match_frame.descriptors_mat_,
+                             query_frame.descriptors_mat_,
+                             &matches_match_query,
+                             true);
+  }
 
   // Perform geometric verification check.
   gtsam::Pose3 camMatch_T_camQuery_2d;
   std::vector<int> inliers;
   bool pass_geometric_verification =
-      geometricVerificationCam2d2d(*match_frame,
-                                   *query_frame,
+      geometricVerificationCam2d2d(match_frame,
+                                   query_frame,
                                    matches_match_query,
+                                   tracker,
                                    &camMatch_T_camQuery_2d,
                                    &inliers);
 
   if (!pass_geometric_verification) {
+    set_ransac_stats();
     result->status_ = LCDStatus::FAILED_GEOM_VERIFICATION;
     return;
   }
 
-  bool pose_valid = recoverPoseBody(*match_frame,
-                                    *query_frame,
+  bool pose_valid = recoverPoseBody(match_frame,
+                                    query_frame,
                                     camMatch_T_camQuery_2d,
                                     matches_match_query,
+                                    tracker,
                                     &(result->relative_pose_),
                                     &inliers);
+  set_ransac_stats();
   result->status_ =
       pose_valid ? LCDStatus::LOOP_DETECTED : LCDStatus::FAILED_POSE_RECOVERY;
 }
 
+/* ------------------------------------------------------------------------ */
+bool LoopClosureDetector::relocalizeAfterTrackingLoss(
+    const FrameId& frame_id,
+    const DBoW2::BowVector& bow_vec,
+    const TrackerStatusSummary& tracker_status,
+    LoopResult* result) {
+  KIMERA_TRACE_SCOPE("LoopClosureDetector::relocalizeAfterTrackingLoss");
+  CHECK_NOTNULL(result);
+  const TrackingStatus& tracking_status = tracker_status.kfTrackingStatus_mono_;
+  if (tracking_status == TrackingStatus::INVALID) {
+    if (!tracking_lost_kf_id_) {
+      LOG(WARNING) << "LoopClosureDetector: tracking lost at keyframe "
+                   << frame_id << ", relocalizing once tracking resumes.";
+      tracking_lost_kf_id_ = frame_id;
+      nr_relocalization_attempts_ = 0;
+    }
+    return false;
+  }
+  if (!tracking_lost_kf_id_ || tracking_status != TrackingStatus::VALID) {
+    return false;
+  }
+
+  // Only the keyframes before the loss are candidates (the database query
+  // scores the entries with a smaller id).
+  result->query_id_ = frame_id;
+  result->status_ = LCDStatus::NO_MATCHES;
+  DBoW2::QueryResults query_result;
+  db_BoW_->query(bow_vec,
+                 query_result,
+                 lcd_params_.max_db_results_,
+                 getNrEntriesBefore(static_cast<int>(*tracking_lost_kf_id_)));
+  entryToFrameIds(&query_result);
+  if (!query_result.empty()) {
+    result->match_id_ = query_result[0].Id;
+    verifyAndRecoverPose(result);
+  }
+
+  if (!result->isLoop()) {
+    VLOG(1) << "LoopClosureDetector: relocalization of keyframe " << frame_id
+            << " failed: " << LoopResult::asString(result->status_);
+    if (++nr_relocalization_attempts_ >=
+        lcd_params_.relocalization_max_keyframes_) {
+      LOG(WARNING) << "LoopClosureDetector: no relocalization within "
+                   << nr_relocalization_attempts_
+                   << " keyframes after the tracking loss, giving up.";
+      tracking_lost_kf_id_.reset();
+    }
+    return false;
+  }
+
+  // relative_pose_ is the pose of the query body wrt the match body.
+  const gtsam::Pose3 W_Pose_B =
+      vio_trajectory_.at(result->match_id_).compose(result->relative_pose_);
+  const gtsam::Pose3 correction =
+      vio_trajectory_.at(frame_id).between(W_Pose_B);
+  LOG(INFO) << "LoopClosureDetector: relocalized keyframe " << frame_id
+            << " against keyframe " << result->match_id_
+            << " after the tracking loss at keyframe " << *tracking_lost_kf_id_
+            << ", correction: " << correction.translation().norm() << " [m].";
+  tracking_lost_kf_id_.reset();
+  ++nr_relocalizations_;
+  if (relocalization_cb_) {
+    relocalization_cb_(frame_id, W_Pose_B);
+  }
+  return true;
+}
+
+/* ------------------------------------------------------------------------ */
+void LoopClosureDetector::queueVerification(LoopResult* result) {
+  CHECK_NOTNULL(result);
+
+  VerificationCandidate candidate;
+  candidate.match_frame = cache_.getFrame(result->match_id_);
+  candidate.query_frame = cache_.getFrame(result->query_id_);
+  if (!candidate.match_frame || !candidate.query_frame) {
+    result->status_ = LCDStatus::NO_MATCHES;
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(verification_mutex_);
+    if (pending_verifications_.size() >=
+        static_cast<size_t>(lcd_params_.verification_queue_size_)) {
+      ++nr_dropped_verifications_;
+      LOG_EVERY_N(WARNING, 10)
+          << "LoopClosureDetector: verification queue full, dropping "
+             "candidate with query id "
+          << result->query_id_ << " (" << nr_dropped_verifications_
+          << " dropped so far). Consider increasing verification_num_workers.";
+      result->status_ = LCDStatus::VERIFICATION_QUEUE_FULL;
+      return;
+    }
+    result->status_ = LCDStatus::VERIFICATION_PENDING;
+    candidate.result = *result;
+    pending_verifications_.push_back(std::move(candidate));
+  }
+  verification_cv_.notify_one();
+}
+
+void LoopClosureDetector::verificationWorker(Tracker* tracker) {
+  CHECK_NOTNULL(tracker);
+  while (true) {
+    VerificationCandidate candidate;
+    {
+      std::unique_lock<std::mutex> lock(verification_mutex_);
+      verification_cv_.wait(lock, [this] {
+        return shutdown_verification_ || !pending_verifications_.empty();
+      });
+      if (shutdown_verification_) break;
+      candidate = std::move(pending_verifications_.front());
+      pending_verifications_.pop_front();
+      ++nr_verifying_;
+    }
+
+    verifyAndRecoverPose(*candidate.match_frame,
+                         *candidate.query_frame,
+                         tracker,
+                         &candidate.result);
+
+    {
+      std::lock_guard<std::mutex> lock(verification_mutex_);
+      verified_results_.push_back(candidate.result);
+      --nr_verifying_;
+    }
+    // Wakes up waitForPendingVerifications.
+    verification_cv_.notify_all();
+  }
+}
+
+std::vector<LoopResult> LoopClosureDetector::takeVerifiedResults() {
+  std::vector<LoopResult> verified_results;
+  std::lock_guard<std::mutex> lock(verification_mutex_);
+  verified_results.swap(verified_results_);
+  return verified_results;
+}
+
+const std::vector<float>& LoopClosureDetector::getGlobalDescriptor(
+    const FrameId& frame_id) {
+  CHECK(global_descriptor_extractor_);
+  if (global_descriptor_id_ != frame_id) {
+    const auto frame = cache_.getFrame(frame_id);
+    CHECK(frame) << "Invalid frame requested!";
+    global_descriptor_ =
+        global_descriptor_extractor_->compute(frame->descriptors_mat_);
+    global_descriptor_id_ = frame_id;
+  }
+  return global_descriptor_;
+}
+
+/* ------------------------------------------------------------------------ */
+bool LoopClosureDetector::addToDatabase(const FrameId& frame_id,
+                                        const DBoW2::BowVector& bow_vec) {
+  if (!lcd_params_.database_insertion.enabled) {
+    // All the keyframes are added, in order: entry ids are keyframe ids.
+    db_frame_ids_.push_back(db_BoW_->add(bow_vec));
+  } else if (isNovelKeyframe(frame_id, bow_vec)) {
+    CHECK(db_frame_ids_.empty() || frame_id > db_frame_ids_.back());
+    db_BoW_->add(bow_vec);
+    db_frame_ids_.push_back(frame_id);
+  } else {
+    VLOG(10) << "LoopClosureDetector: keyframe " << frame_id
+             << " not added to the database, not novel.";
+    return false;
+  }
+  if (global_descriptor_index_) {
+    global_descriptor_index_->add(frame_id, getGlobalDescriptor(frame_id));
+  }
+
+  if (lcd_params_.database_insertion.enabled) {
+    recent_db_bowvecs_.push_back(bow_vec);
+    while (recent_db_bowvecs_.size() >
+           static_cast<size_t>(
+               lcd_params_.database_insertion.nr_recent_entries)) {
+      recent_db_bowvecs_.pop_front();
+    }
+    if (W_Pose_B_kf_vio_.first.index() == frame_id) {
+      last_db_position_ = W_Pose_B_kf_vio_.second.translation();
+    } else {
+      last_db_position_.reset();
+    }
+  }
+  return true;
+}
+
+/* ------------------------------------------------------------------------ */
+bool LoopClosureDetector::isNovelKeyframe(
+    const FrameId& frame_id,
+    const DBoW2::BowVector& bow_vec) const {
+  const DatabaseInsertionParams& params = lcd_params_.database_insertion;
+  // Without both positions, only the appearance tells.
+  if (last_db_position_ && W_Pose_B_kf_vio_.first.index() == frame_id &&
+      (W_Pose_B_kf_vio_.second.translation() - *last_db_position_).norm() >
+          params.min_translation) {
+    return true;
+  }
+  const OrbVocabulary* vocab = db_BoW_->getVocabulary();
+  for (const DBoW2::BowVector& recent_bow_vec : recent_db_bowvecs_) {
+    if (vocab->score(bow_vec, recent_bow_vec) >= params.max_similarity) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* ------------------------------------------------------------------------ */
+int LoopClosureDetector::getNrEntriesBefore(const int& frame_id) const {
+  if (frame_id < 0) return -1;
+  return static_cast<int>(std::lower_bound(db_frame_ids_.begin(),
+                                           db_frame_ids_.end(),
+                                           static_cast<FrameId>(frame_id)) -
+                          db_frame_ids_.begin());
+}
+
+/* ------------------------------------------------------------------------ */
+void LoopClosureDetector::entryToFrameIds(
+    DBoW2::QueryResults* query_result) const {
+  CHECK_NOTNULL(query_result);
+  for (DBoW2::Result& result : *query_result) {
+    result.Id = db_frame_ids_.at(result.Id);
+  }
+}
+
+void LoopClosureDetector::waitForPendingVerifications() {
+  if (!isVerificationAsync()) return;
+  std::unique_lock<std::mutex> lock(verification_mutex_);
+  verification_cv_.wait(lock, [this] {
+    return shutdown_verification_ ||
+           (pending_verifications_.empty() && nr_verifying_ == 0u);
+  });
+}
+
+void LoopClosureDetector::shutdownVerification() {
+  {
+    std::lock_guard<std::mutex> lock(verification_mutex_);
+    shutdown_verification_ = true;
+    pending_verifications_.clear();
+  }
+  verification_cv_.notify_all();
+  for (std::thread& worker : verification_workers_) {
+    if (worker.joinable()) worker.join();
+  }
+}
+
 LoopResult LoopClosureDetector::registerFrames(FrameId query_id,
                                                FrameId match_id) {
   LoopResult result;
@@ -821,6 +1543,22 @@ bool LoopClosureDetector::geometricVerificationCam2d2d(
     const KeypointMatches& matches_match_query,
     gtsam::Pose3* camMatch_T_camQuery_2d,
     std::vector<int>* inliers) {
+  return geometricVerificationCam2d2d(ref_frame,
+                                      cur_frame,
+                                      matches_match_query,
+                                      tracker_.get(),
+                                      camMatch_T_camQuery_2d,
+                                      inliers);
+}
+
+bool LoopClosureDetector::geometricVerificationCam2d2d(
+    const LCDFrame& ref_frame,
+    const LCDFrame& cur_frame,
+    const KeypointMatches& matches_match_query,
+    Tracker* tracker,
+    gtsam::Pose3* camMatch_T_camQuery_2d,
+    std::vector<int>* inliers) {
+  CHECK_NOTNULL(tracker);
   CHECK_NOTNULL(camMatch_T_camQuery_2d);
   CHECK_NOTNULL(inliers);
 
@@ -832,17 +1570,19 @@ bool LoopClosureDetector::geometricVerificationCam2d2d(
              << " current id: " << cur_frame.id_;
     result = std::make_pair(TrackingStatus::INVALID, gtsam::Pose3());
   } else {
-    result = tracker_->geometricOutlierRejection2d2d(ref_frame.bearing_vectors_,
-                                                     cur_frame.bearing_vectors_,
-                                                     matches_match_query,
-                                                     inliers);
+    result = tracker->geometricOutlierRejection2d2d(ref_frame.bearing_vectors_,
+                                                    cur_frame.bearing_vectors_,
+                                                    matches_match_query,
+                                                    inliers);
 
     *camMatch_T_camQuery_2d = result.second;
   }
 
-  if (logger_)
+  if (logger_) {
+    std::lock_guard<std::mutex> lock(logger_mutex_);
     logger_->logGeometricVerification(
         ref_frame.timestamp_, cur_frame.timestamp_, *camMatch_T_camQuery_2d);
+  }
 
   return result.first == TrackingStatus::VALID;
 }
@@ -855,6 +1595,24 @@ bool LoopClosureDetector::recoverPoseBody(
     const KeypointMatches& matches_match_query,
     gtsam::Pose3* bodyMatch_T_bodyQuery_3d,
     std::vector<int>* inliers) {
+  return recoverPoseBody(ref_frame,
+                         cur_frame,
+                         camMatch_T_camQuery_2d,
+                         matches_match_query,
+                         tracker_.get(),
+                         bodyMatch_T_bodyQuery_3d,
+                         inliers);
+}
+
+bool LoopClosureDetector::recoverPoseBody(
+    const LCDFrame& ref_frame,
+    const LCDFrame& cur_frame,
+    const gtsam::Pose3& camMatch_T_camQuery_2d,
+    const KeypointMatches& matches_match_query,
+    Tracker* tracker,
+    gtsam::Pose3* bodyMatch_T_bodyQuery_3d,
+    std::vector<int>* inliers) {
+  CHECK_NOTNULL(tracker);
   CHECK_NOTNULL(bodyMatch_T_bodyQuery_3d);
   CHECK_NOTNULL(inliers);
 
@@ -868,7 +1626,7 @@ bool LoopClosureDetector::recoverPoseBody(
     case PoseRecoveryType::k3d3d: {
       TrackingStatusPose result;
       const bool camera_valid = stereo_camera_ || rgbd_camera_;
-      if (tracker_->tracker_params_.ransac_use_1point_stereo_ && camera_valid) {
+      if (tracker->tracker_params_.ransac_use_1point_stereo_ && camera_valid) {
         // For 1pt we need stereo, so cast to derived form.
         ref_stereo_lcd_frame = dynamic_cast<const StereoLCDFrame*>(&ref_frame);
         cur_stereo_lcd_frame = dynamic_cast<const StereoLCDFrame*>(&cur_frame);
@@ -879,7 +1637,7 @@ bool LoopClosureDetector::recoverPoseBody(
         }
 
         std::pair<TrackingStatusPose, gtsam::Matrix3> result_full =
-            tracker_->geometricOutlierRejection3d3dGivenRotation(
+            tracker->geometricOutlierRejection3d3dGivenRotation(
                 ref_stereo_lcd_frame->left_keypoints_rectified_,
                 ref_stereo_lcd_frame->right_keypoints_rectified_,
                 cur_stereo_lcd_frame->left_keypoints_rectified_,
@@ -895,10 +1653,10 @@ bool LoopClosureDetector::recoverPoseBody(
         camMatch_T_camQuery_3d = result.second;
       } else {
         result =
-            tracker_->geometricOutlierRejection3d3d(ref_frame.keypoints_3d_,
-                                                    cur_frame.keypoints_3d_,
-                                                    matches_match_query,
-                                                    inliers);
+            tracker->geometricOutlierRejection3d3d(ref_frame.keypoints_3d_,
+                                                   cur_frame.keypoints_3d_,
+                                                   matches_match_query,
+                                                   inliers);
         camMatch_T_camQuery_3d = result.second;
       }
       if (result.first == TrackingStatus::VALID) success = true;
@@ -922,11 +1680,11 @@ bool LoopClosureDetector::recoverPoseBody(
         camMatch_points.push_back(match_point);
       }
 
-      success = tracker_->pnp(camQuery_bearing_vectors,
-                              camMatch_points,
-                              &camMatch_T_camQuery_3d,
-                              inliers,
-                              &camMatch_T_camQuery_2d_copy);
+      success = tracker->pnp(camQuery_bearing_vectors,
+                             camMatch_points,
+                             &camMatch_T_camQuery_3d,
+                             inliers,
+                             &camMatch_T_camQuery_2d_copy);
 
       // Manually fail the result if the norm of the translation vector is above
       // a fixed maximum. This is not technically required; PCM should be able
@@ -966,6 +1724,7 @@ bool LoopClosureDetector::recoverPoseBody(
   }
 
   if (logger_) {
+    std::lock_guard<std::mutex> lock(logger_mutex_);
     logger_->logPoseRecovery(
         cur_frame.timestamp_, ref_frame.timestamp_, camMatch_T_camQuery_3d);
   }
@@ -1074,11 +1833,10 @@ gtsam::Pose3 LoopClosureDetector::refinePoses(
 
 /* ------------------------------------------------------------------------ */
 const gtsam::Pose3 LoopClosureDetector::getWPoseMap() const {
-  CHECK(pgo_);
   const gtsam::Symbol& cur_id = W_Pose_B_kf_vio_.first;
   const gtsam::Pose3& w_Pose_Bkf_estim = W_Pose_B_kf_vio_.second;
   const gtsam::Pose3& w_Pose_Bkf_optimal =
-      pgo_->calculateEstimate().at<gtsam::Pose3>(cur_id);
+      calculatePgoEstimate(cur_id.index());
 
   return w_Pose_Bkf_optimal.between(w_Pose_Bkf_estim);
 }
@@ -1086,10 +1844,9 @@ const gtsam::Pose3 LoopClosureDetector::getWPoseMap() const {
 /* ------------------------------------------------------------------------ */
 const gtsam::Pose3 LoopClosureDetector::getMapPoseOdom() const {
   if (cache_.size() > 1) {
-    CHECK(pgo_);
     const gtsam::Pose3& w_Pose_Bkf_estim = W_Pose_B_kf_vio_.second;
     const gtsam::Pose3& w_Pose_Bkf_optimal =
-        pgo_->calculateEstimate().at<gtsam::Pose3>(W_Pose_B_kf_vio_.first);
+        calculatePgoEstimate(W_Pose_B_kf_vio_.first.index());
     return w_Pose_Bkf_optimal.compose(w_Pose_Bkf_estim.inverse());
   }
 
@@ -1098,24 +1855,141 @@ const gtsam::Pose3 LoopClosureDetector::getMapPoseOdom() const {
 
 /* ------------------------------------------------------------------------ */
 const gtsam::Values LoopClosureDetector::getPGOTrajectory() const {
+  return calculatePgoEstimate();
+}
+
+/* ------------------------------------------------------------------------ */
+const gtsam::NonlinearFactorGraph LoopClosureDetector::getPGOnfg() const {
+  return getPgoFactors();
+}
+
+/* ------------------------------------------------------------------------ */
+gtsam::Values LoopClosureDetector::calculatePgoEstimate() const {
+  if (incremental_pgo_) return incremental_pgo_->calculateEstimate();
   CHECK(pgo_);
   return pgo_->calculateEstimate();
 }
 
 /* ------------------------------------------------------------------------ */
-const gtsam::NonlinearFactorGraph LoopClosureDetector::getPGOnfg() const {
+gtsam::NonlinearFactorGraph LoopClosureDetector::getPgoFactors() const {
+  if (incremental_pgo_) return incremental_pgo_->getFactors();
   CHECK(pgo_);
   return pgo_->getFactorsUnsafe();
 }
 
 /* ------------------------------------------------------------------------ */
-void LoopClosureDetector::setDatabase(const OrbDatabase& db) {
-  db_BoW_ = std::make_unique<OrbDatabase>(db);
+gtsam::Pose3 LoopClosureDetector::calculatePgoEstimate(
+    const FrameId& key) const {
+  if (incremental_pgo_) return incremental_pgo_->calculateEstimate(key);
+  if (key == W_Pose_B_kf_pgo_.first.index()) return W_Pose_B_kf_pgo_.second;
+  CHECK(pgo_);
+  return pgo_->calculateEstimate().at<gtsam::Pose3>(gtsam::Symbol(key));
+}
+
+/* ------------------------------------------------------------------------ */
+gtsam::Values LoopClosureDetector::updatePublishedTrajectory(
+    bool* is_corrected) {
+  CHECK_NOTNULL(is_corrected);
+  *is_corrected = false;
+  gtsam::Values delta;
+  const FrameId cur_id = W_Pose_B_kf_vio_.first.index();
+  CHECK_EQ(published_trajectory_.size(), cur_id);
+  if (!is_pgo_optimized_) {
+    published_trajectory_.push_back(calculatePgoEstimate(cur_id));
+    delta.insert(gtsam::Symbol(cur_id), published_trajectory_.back());
+    return delta;
+  }
+
+  // Only the poses that moved, comparing the full estimate.
+  static constexpr double kPublishedPoseTol = 1e-6;
+  const gtsam::Values estimate = calculatePgoEstimate();
+  CHECK_EQ(estimate.size(), cur_id + 1u);
+  published_trajectory_.resize(estimate.size());
+  for (FrameId key = 0u; key < estimate.size(); ++key) {
+    const gtsam::Pose3& pose = estimate.at<gtsam::Pose3>(gtsam::Symbol(key));
+    if (key < cur_id &&
+        pose.equals(published_trajectory_[key], kPublishedPoseTol)) {
+      continue;
+    }
+    published_trajectory_[key] = pose;
+    delta.insert(gtsam::Symbol(key), pose);
+    *is_corrected = *is_corrected || key < cur_id;
+  }
+  is_pgo_optimized_ = false;
+  return delta;
+}
+
+/* ------------------------------------------------------------------------ */
+void LoopClosureDetector::setDatabase(const BowDatabase& db) {
+  db_BoW_ = std::make_unique<BowDatabase>(db);
+  // One entry per keyframe.
+  db_frame_ids_.resize(db_BoW_->size());
+  std::iota(db_frame_ids_.begin(), db_frame_ids_.end(), 0u);
+  recent_db_bowvecs_.clear();
+  last_db_position_.reset();
 }
 
 /* ------------------------------------------------------------------------ */
 void LoopClosureDetector::setVocabulary(const OrbVocabulary& voc) {
   db_BoW_->setVocabulary(voc);
+  db_frame_ids_.clear();
+  recent_db_bowvecs_.clear();
+  last_db_position_.reset();
+  resetGlobalDescriptors(voc);
+}
+
+/* ------------------------------------------------------------------------ */
+void LoopClosureDetector::resetGlobalDescriptors(const OrbVocabulary& voc) {
+  if (lcd_params_.lcd_type_ == LoopClosureDetectorType::GlobalDescriptor) {
+    const GlobalDescriptorParams& params = lcd_params_.global_descriptor;
+    cv::Mat centers, bit_means;
+    getVocabularyLevel(voc, params.vocabulary_level, &centers, &bit_means);
+    global_descriptor_extractor_ = std::make_unique<GlobalDescriptorExtractor>(
+        centers, bit_means, params.projection_dim);
+    global_descriptor_index_ = std::make_unique<HnswIndex>(
+        global_descriptor_extractor_->dim(), params.hnsw);
+    global_descriptor_id_.reset();
+    latest_global_descriptor_.clear();
+  }
+}
+
+/* ------------------------------------------------------------------------ */
+bool LoopClosureDetector::saveMap(const std::string& filepath) const {
+  if (db_BoW_->size() == cache_.size()) {
+    saveLcdMap(
+        filepath, cache_, calculatePgoEstimate(), getPgoFactors(), *db_BoW_);
+    return true;
+  }
+  if (!lcd_params_.database_insertion.enabled) {
+    LOG(ERROR) << "LoopClosureDetector: the database has " << db_BoW_->size()
+               << " entries for " << cache_.size()
+               << " frames, not saving the map.";
+    return false;
+  }
+  // Keyframes were left out of the database, but maps have an entry per
+  // keyframe.
+  BowDatabase db(*db_BoW_);
+  db.clear();
+  for (size_t frame_id = 0u; frame_id < cache_.size(); ++frame_id) {
+    const auto frame = cache_.getFrame(frame_id);
+    CHECK(frame) << "Invalid frame requested!";
+    DBoW2::BowVector bow_vec;
+    db.getVocabulary()->transform(descriptorRows(frame->descriptors_mat_),
+                                  bow_vec);
+    db.add(bow_vec);
+  }
+  saveLcdMap(filepath, cache_, calculatePgoEstimate(), getPgoFactors(), db);
+  return true;
+}
+
+/* ------------------------------------------------------------------------ */
+bool LoopClosureDetector::loadPriorMap(const std::string& filepath) {
+  LcdMap::UniquePtr prior_map = loadLcdMap(
+      filepath, *db_BoW_->getVocabulary(), lcd_params_.bow_database);
+  if (!prior_map) return false;
+  prior_map_ = std::move(prior_map);
+  Map_Pose_W_.reset();
+  return true;
 }
 
 /* ------------------------------------------------------------------------ */
@@ -1213,6 +2087,18 @@ void LoopClosureDetector::computeDescriptorMatches(
   double lowe_ratio = 1.0;
   if (cut_matches) lowe_ratio = lcd_params_.lowe_ratio_;
 
+  if (use_orb_hamming_matcher_ && cur_descriptors.type() == CV_8U &&
+      cur_descriptors.cols == kOrbDescriptorBytes) {
+    std::vector<cv::DMatch> hamming_matches;
+    orb_hamming_matcher_.match(
+        cur_descriptors, ref_descriptors, lowe_ratio, &hamming_matches);
+    for (const cv::DMatch& match : hamming_matches) {
+      matches_match_query->push_back(
+          std::make_pair(match.trainIdx, match.queryIdx));
+    }
+    return;
+  }
+
   orb_feature_matcher_->knnMatch(cur_descriptors, ref_descriptors, matches, 2u);
 
   const size_t& n_matches = matches.size();
@@ -1229,11 +2115,186 @@ void LoopClosureDetector::computeDescriptorMatches(
   }
 }
 
+/* ------------------------------------------------------------------------ */
+void LoopClosureDetector::computeBowGuidedDescriptorMatches(
+    const LCDFrame& ref_frame,
+    const LCDFrame& cur_frame,
+    KeypointMatches* matches_match_query) const {
+  CHECK_NOTNULL(matches_match_query);
+  matches_match_query->clear();
+
+  // Direct index: keypoint indices per vocabulary node.
+  const OrbVocabulary* vocab = db_BoW_->getVocabulary();
+  DBoW2::BowVector ref_bow_vec, cur_bow_vec;
+  DBoW2::FeatureVector ref_feat_vec, cur_feat_vec;
+  vocab->transform(descriptorRows(ref_frame.descriptors_mat_),
+                   ref_bow_vec,
+                   ref_feat_vec,
+                   lcd_params_.bow_guided_matching_levels_up_);
+  vocab->transform(descriptorRows(cur_frame.descriptors_mat_),
+                   cur_bow_vec,
+                   cur_feat_vec,
+                   lcd_params_.bow_guided_matching_levels_up_);
+
+  std::vector<cv::DMatch> matches;
+  orb_hamming_matcher_.matchGrouped(cur_frame.descriptors_mat_,
+                                    ref_frame.descriptors_mat_,
+                                    cur_feat_vec,
+                                    ref_feat_vec,
+                                    lcd_params_.lowe_ratio_,
+                                    &matches);
+  for (const cv::DMatch& match : matches) {
+    matches_match_query->push_back(
+        std::make_pair(match.trainIdx, match.queryIdx));
+  }
+}
+
+/* ------------------------------------------------------------------------ */
+void LoopClosureDetector::addLoopClosure(const LoopResult& loop_result) {
+  KIMERA_TRACE_SCOPE("LoopClosureDetector::addLoopClosure");
+  CHECK(loop_result.isLoop());
+  last_match_id_ = loop_result.match_id_;
+  utils::StatsCollector stat_pgo_timing("PGO Update/Optimization Timing [ms]");
+  auto tic = utils::Timer::tic();
+
+  if (lcd_params_.pose_recovery_type_ == PoseRecoveryType::k5ptRotOnly) {
+    // Rotation part of the information matrix of the noise model emphasized.
+    gtsam::Matrix mat_info = gtsam::Matrix::Identity(6, 6);
+    gtsam::Matrix mat_info_rotation_part =
+        lcd_params_.betweenRotationPrecision_ * gtsam::Matrix::Identity(3, 3);
+    mat_info.block<3, 3>(0, 0) = (mat_info_rotation_part);
+
+    // Zero out the translation part of the noise model to only use the 2d2d
+    // pose for the loop closure factor.
+    // mat_info.block<3, 3>(3, 3) = gtsam::Matrix::Identity(3, 3) * 0.0;
+    mat_info.block<3, 3>(3, 3) = gtsam::Matrix::Identity(3, 3) * 1e-12;
+
+    // Instantiate a noise model from the rotation-only information matrix.
+    gtsam::SharedNoiseModel noise_model_5pt_rotation_only =
+        gtsam::noiseModel::Diagonal::Information(mat_info);
+
+    // Refresh timer because all previous stuff irrelevant to PGO timing.
+    tic = utils::Timer::tic();
+    addLoopClosureFactorAndOptimize(
+        LoopClosureFactor(loop_result.match_id_,
+                          loop_result.query_id_,
+                          loop_result.relative_pose_,
+                          noise_model_5pt_rotation_only));
+  } else {
+    addLoopClosureFactorAndOptimize(
+        LoopClosureFactor(loop_result.match_id_,
+                          loop_result.query_id_,
+                          loop_result.relative_pose_,
+                          shared_noise_model_));
+  }
+
+  auto update_duration = utils::Timer::toc(tic).count();
+  stat_pgo_timing.AddSample(update_duration);
+}
+
+/* ------------------------------------------------------------------------ */
+void LoopClosureDetector::detectPriorMapLoop(const LCDFrame& query_frame,
+                                             const DBoW2::BowVector& bow_vec,
+                                             LoopResult* result) {
+  CHECK(prior_map_);
+  CHECK_NOTNULL(result);
+  result->query_id_ = query_frame.id_;
+  result->status_ = LCDStatus::NO_MATCHES;
+
+  DBoW2::QueryResults query_result;
+  prior_map_->database->query(bow_vec, query_result, 1);
+  if (query_result.empty()) return;
+
+  // Same thresholds as for the loop closures within this session.
+  double nss_factor = 1.0;
+  if (lcd_params_.use_nss_ && latest_bowvec_) {
+    nss_factor = db_BoW_->getVocabulary()->score(bow_vec, *latest_bowvec_);
+    if (nss_factor < lcd_params_.min_nss_factor_) {
+      result->status_ = LCDStatus::LOW_NSS_FACTOR;
+      return;
+    }
+  }
+  if (query_result[0].Score < lcd_params_.alpha_ * nss_factor) {
+    result->status_ = LCDStatus::LOW_SCORE;
+    return;
+  }
+
+  result->match_id_ = query_result[0].Id;
+  CHECK_LT(result->match_id_, prior_map_->frames.size());
+  verifyAndRecoverPose(*prior_map_->frames[result->match_id_],
+                       query_frame,
+                       tracker_.get(),
+                       result);
+}
+
+/* ------------------------------------------------------------------------ */
+void LoopClosureDetector::addPriorMapFactor(const LoopResult& loop_result) {
+  CHECK(loop_result.isLoop());
+  CHECK(prior_map_);
+  const gtsam::Symbol match_key(loop_result.match_id_);
+  if (!prior_map_->W_Pose_B.exists(match_key)) {
+    LOG(WARNING) << "LoopClosureDetector: no pose for prior map keyframe "
+                 << loop_result.match_id_ << ", ignoring its loop closure.";
+    return;
+  }
+  const gtsam::Pose3 Map_Pose_query =
+      prior_map_->W_Pose_B.at<gtsam::Pose3>(match_key)
+          .compose(loop_result.relative_pose_);
+  const gtsam::Symbol query_key(loop_result.query_id_);
+  if (!Map_Pose_W_) {
+    // The first loop closure only aligns this session with the prior map.
+    const gtsam::Pose3 W_Pose_query_estimate =
+        calculatePgoEstimate().at<gtsam::Pose3>(query_key);
+    Map_Pose_W_ = Map_Pose_query.compose(W_Pose_query_estimate.inverse());
+    LOG(INFO) << "LoopClosureDetector: relocalized in the prior map.";
+  }
+  const gtsam::Pose3 W_Pose_query =
+      Map_Pose_W_->inverse().compose(Map_Pose_query);
+
+  gtsam::Vector6 precisions;
+  precisions.head<3>().setConstant(lcd_params_.prior_map_rotation_precision_);
+  precisions.tail<3>().setConstant(
+      lcd_params_.pose_recovery_type_ == PoseRecoveryType::k5ptRotOnly
+          ? 1e-12
+          : lcd_params_.prior_map_translation_precision_);
+  const gtsam::SharedNoiseModel noise =
+      gtsam::noiseModel::Diagonal::Precisions(precisions);
+  const bool optimize = !FLAGS_lcd_no_optimize;
+  ++nr_prior_map_lc_;
+
+  utils::StatsCollector stat_pgo_timing("PGO Update/Optimization Timing [ms]");
+  const auto tic = utils::Timer::tic();
+  if (incremental_pgo_) {
+    incremental_pgo_->addPrior(
+        loop_result.query_id_, W_Pose_query, noise, optimize);
+  } else {
+    gtsam::NonlinearFactorGraph nfg;
+    nfg.add(gtsam::PriorFactor<gtsam::Pose3>(query_key, W_Pose_query, noise));
+    CHECK(pgo_);
+    pgo_->update(nfg, gtsam::Values(), optimize);
+  }
+  if (optimize) setPgoOptimized();
+  stat_pgo_timing.AddSample(utils::Timer::toc(tic).count());
+}
+
 /* ------------------------------------------------------------------------ */
 void LoopClosureDetector::initializePGO(const OdometryFactor& factor) {
   CHECK(lcd_state_ == LcdState::Bootstrap);
   CHECK_EQ(factor.cur_key_, 0u);
 
+  if (incremental_pcm_) {
+    incremental_pcm_->addOdometry(factor.cur_key_, factor.W_Pose_Blkf_);
+  }
+
+  if (incremental_pgo_) {
+    incremental_pgo_->initialize(
+        factor.cur_key_, factor.W_Pose_Blkf_, factor.noise_);
+    W_Pose_B_kf_vio_ = std::make_pair(factor.cur_key_, factor.W_Pose_Blkf_);
+    W_Pose_B_kf_pgo_ = W_Pose_B_kf_vio_;
+    lcd_state_ = LcdState::Nominal;
+    return;
+  }
+
   gtsam::NonlinearFactorGraph init_nfg;
   gtsam::Values init_val;
 
@@ -1248,6 +2309,7 @@ void LoopClosureDetector::initializePGO(const OdometryFactor& factor) {
   // Update tracker for latest VIO estimate
   // NOTE: done here instead of in spinOnce() to make unit tests easier.
   W_Pose_B_kf_vio_ = std::make_pair(factor.cur_key_, factor.W_Pose_Blkf_);
+  W_Pose_B_kf_pgo_ = W_Pose_B_kf_vio_;
 
   lcd_state_ = LcdState::Nominal;
 }
@@ -1262,14 +2324,25 @@ void LoopClosureDetector::addOdometryFactorAndOptimize(
   CHECK_GT(factor.cur_key_, 0u);
 
   const gtsam::Pose3& W_Pose_Bkf = factor.W_Pose_Blkf_;
+  if (incremental_pcm_) {
+    incremental_pcm_->addOdometry(factor.cur_key_, W_Pose_Bkf);
+  }
+
+  if (incremental_pgo_) {
+    CHECK_EQ(W_Pose_B_kf_vio_.first, factor.cur_key_ - 1);
+    incremental_pgo_->addOdometry(factor.cur_key_,
+                                  W_Pose_B_kf_vio_.second.between(W_Pose_Bkf),
+                                  factor.noise_);
+    W_Pose_B_kf_vio_ = std::make_pair(factor.cur_key_, W_Pose_Bkf);
+    return;
+  }
 
   gtsam::NonlinearFactorGraph nfg;
   gtsam::Values value;
 
-  const gtsam::Values& optimized_values = pgo_->calculateEstimate();
-  CHECK_EQ(factor.cur_key_, optimized_values.size());
-  const gtsam::Pose3& estimated_last_pose =
-      optimized_values.at<gtsam::Pose3>(factor.cur_key_ - 1);
+  // The estimate of the last keyframe, without copying the whole estimate.
+  CHECK_EQ(W_Pose_B_kf_pgo_.first, factor.cur_key_ - 1);
+  const gtsam::Pose3 estimated_last_pose = W_Pose_B_kf_pgo_.second;
 
   // We can get the same relative pose used in the backend after
   // smoother_->update() by getting the relative pose between the latest two
@@ -1292,6 +2365,8 @@ void LoopClosureDetector::addOdometryFactorAndOptimize(
   // Update tracker for latest VIO estimate
   // NOTE: done here instead of in spinOnce() to make unit tests easier.
   W_Pose_B_kf_vio_ = std::make_pair(factor.cur_key_, W_Pose_Bkf);
+  W_Pose_B_kf_pgo_ = std::make_pair(
+      factor.cur_key_, value.at<gtsam::Pose3>(gtsam::Symbol(factor.cur_key_)));
 }
 
 /* ------------------------------------------------------------------------ */
@@ -1299,12 +2374,38 @@ void LoopClosureDetector::addLoopClosureFactorAndOptimize(
     const LoopClosureFactor& factor) {
   CHECK(lcd_state_ == LcdState::Nominal);
 
-  gtsam::NonlinearFactorGraph nfg;
+  // The loop closures to add: this one, or those that it made consistent.
+  if (pending_loop_closures_.empty()) {
+    pending_loop_closures_kf_id_ = W_Pose_B_kf_vio_.first.index();
+  }
+  if (incremental_pcm_) {
+    pcm_loop_closures_.push_back(factor);
+    const std::vector<size_t> accepted = incremental_pcm_->addLoopClosure(
+        factor.ref_key_, factor.cur_key_, factor.ref_Pose_cur_);
+    if (accepted.empty()) {
+      VLOG(1) << "LoopClosureDetector: loop closure " << factor.ref_key_
+              << " - " << factor.cur_key_ << " rejected by the PCM.";
+      return;
+    }
+    for (const size_t& i : accepted) {
+      pending_loop_closures_.push_back(pcm_loop_closures_.at(i));
+    }
+  } else {
+    pending_loop_closures_.push_back(factor);
+  }
 
-  nfg.add(gtsam::BetweenFactor<gtsam::Pose3>(gtsam::Symbol(factor.ref_key_),
-                                             gtsam::Symbol(factor.cur_key_),
-                                             factor.ref_Pose_cur_,
-                                             factor.noise_));
+  if (pending_loop_closures_.size() >=
+      static_cast<size_t>(lcd_params_.loop_closure_batch_size_)) {
+    addLoopClosureBatchAndOptimize();
+  }
+}
+
+/* ------------------------------------------------------------------------ */
+void LoopClosureDetector::addLoopClosureBatchAndOptimize() {
+  CHECK(lcd_state_ == LcdState::Nominal);
+  if (pending_loop_closures_.empty()) return;
+  VLOG(1) << "LoopClosureDetector: adding " << pending_loop_closures_.size()
+          << " loop closures to the PGO.";
 
   // Only optimize if we don't have other potential loop closures to process.
   CHECK(is_backend_queue_filled_cb_);
@@ -1314,13 +2415,45 @@ void LoopClosureDetector::addLoopClosureFactorAndOptimize(
       !is_backend_queue_filled_cb_();
 
   if (!do_optimize) {
-    num_lc_unoptimized_++;
+    num_lc_unoptimized_ += pending_loop_closures_.size();
   } else {
     num_lc_unoptimized_ = 0;
   }
 
+  const bool optimize = do_optimize && !FLAGS_lcd_no_optimize;
+  if (incremental_pgo_) {
+    for (size_t i = 0u; i < pending_loop_closures_.size(); ++i) {
+      const LoopClosureFactor& lc = pending_loop_closures_[i];
+      incremental_pgo_->addLoopClosure(
+          lc.ref_key_,
+          lc.cur_key_,
+          lc.ref_Pose_cur_,
+          lc.noise_,
+          optimize && i + 1u == pending_loop_closures_.size());
+    }
+  } else {
+    gtsam::NonlinearFactorGraph nfg;
+    for (const LoopClosureFactor& lc : pending_loop_closures_) {
+      nfg.add(gtsam::BetweenFactor<gtsam::Pose3>(gtsam::Symbol(lc.ref_key_),
+                                                 gtsam::Symbol(lc.cur_key_),
+                                                 lc.ref_Pose_cur_,
+                                                 lc.noise_));
+    }
+
+    CHECK(pgo_);
+    pgo_->update(nfg, gtsam::Values(), optimize);
+  }
+  pending_loop_closures_.clear();
+  if (optimize) setPgoOptimized();
+}
+
+/* ------------------------------------------------------------------------ */
+void LoopClosureDetector::setPgoOptimized() {
+  is_pgo_optimized_ = true;
+  if (incremental_pgo_) return;
   CHECK(pgo_);
-  pgo_->update(nfg, gtsam::Values(), do_optimize && !FLAGS_lcd_no_optimize);
+  W_Pose_B_kf_pgo_.second =
+      pgo_->calculateEstimate().at<gtsam::Pose3>(W_Pose_B_kf_pgo_.first);
 }
 
 }  // namespace VIO
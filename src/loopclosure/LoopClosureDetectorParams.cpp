@@ -43,11 +43,47 @@ bool LoopClosureDetectorParams::parseYAML(const std::string& filepath) {
                            &max_nrFrames_between_islands_);
   yaml_parser.getYamlParam("max_nrFrames_between_queries",
                            &max_nrFrames_between_queries_);
+  if (yaml_parser.hasParam("verification_num_workers")) {
+    yaml_parser.getYamlParam("verification_num_workers",
+                             &verification_num_workers_);
+  }
+  CHECK_GE(verification_num_workers_, 0);
+  if (yaml_parser.hasParam("verification_queue_size")) {
+    yaml_parser.getYamlParam("verification_queue_size",
+                             &verification_queue_size_);
+  }
+  CHECK_GT(verification_queue_size_, 0);
+  if (yaml_parser.hasParam("prefetch_top_k")) {
+    yaml_parser.getYamlParam("prefetch_top_k", &prefetch_top_k_);
+  }
+  CHECK_GE(prefetch_top_k_, 0);
+  if (yaml_parser.hasParam("prefetch_temporal_neighbors")) {
+    yaml_parser.getYamlParam("prefetch_temporal_neighbors",
+                             &prefetch_temporal_neighbors_);
+  }
+  CHECK_GE(prefetch_temporal_neighbors_, 0);
+  if (yaml_parser.hasParam("lcd_type")) {
+    int lcd_type;
+    yaml_parser.getYamlParam("lcd_type", &lcd_type);
+    lcd_type_ = static_cast<LoopClosureDetectorType>(lcd_type);
+  }
   yaml_parser.getYamlParam("refine_pose", &refine_pose_);
   int pose_recovery_type;
   yaml_parser.getYamlParam("pose_recovery_type", &pose_recovery_type);
   pose_recovery_type_ = static_cast<PoseRecoveryType>(pose_recovery_type);
   yaml_parser.getYamlParam("lowe_ratio", &lowe_ratio_);
+  if (yaml_parser.hasParam("max_hamming_distance")) {
+    yaml_parser.getYamlParam("max_hamming_distance", &max_hamming_distance_);
+  }
+  CHECK_GE(max_hamming_distance_, 0);
+  if (yaml_parser.hasParam("bow_guided_matching")) {
+    yaml_parser.getYamlParam("bow_guided_matching", &bow_guided_matching_);
+  }
+  if (yaml_parser.hasParam("bow_guided_matching_levels_up")) {
+    yaml_parser.getYamlParam("bow_guided_matching_levels_up",
+                             &bow_guided_matching_levels_up_);
+  }
+  CHECK_GE(bow_guided_matching_levels_up_, 0);
 
   int matcher_type_id;
   yaml_parser.getYamlParam("matcher_type", &matcher_type_id);
@@ -82,6 +118,13 @@ bool LoopClosureDetectorParams::parseYAML(const std::string& filepath) {
   }
   yaml_parser.getYamlParam("patch_sze", &patch_sze_);
   yaml_parser.getYamlParam("fast_threshold", &fast_threshold_);
+  if (yaml_parser.hasParam("use_gpu_orb")) {
+    yaml_parser.getYamlParam("use_gpu_orb", &use_gpu_orb_);
+  }
+  if (yaml_parser.hasParam("reuse_frontend_features")) {
+    yaml_parser.getYamlParam("reuse_frontend_features",
+                             &reuse_frontend_features_);
+  }
   yaml_parser.getYamlParam("betweenRotationPrecision",
                            &betweenRotationPrecision_);
   yaml_parser.getYamlParam("betweenTranslationPrecision",
@@ -94,6 +137,66 @@ bool LoopClosureDetectorParams::parseYAML(const std::string& filepath) {
 
   yaml_parser.getYamlParam("max_lc_cached_before_optimize",
                            &max_lc_cached_before_optimize_);
+  if (yaml_parser.hasParam("loop_closure_batch_size")) {
+    yaml_parser.getYamlParam("loop_closure_batch_size",
+                             &loop_closure_batch_size_);
+    CHECK_GT(loop_closure_batch_size_, 0);
+  }
+  if (yaml_parser.hasParam("loop_closure_batch_window")) {
+    yaml_parser.getYamlParam("loop_closure_batch_window",
+                             &loop_closure_batch_window_);
+    CHECK_GE(loop_closure_batch_window_, 0);
+  }
+  if (yaml_parser.hasParam("prior_map_path")) {
+    yaml_parser.getYamlParam("prior_map_path", &prior_map_path_);
+  }
+  if (yaml_parser.hasParam("save_map_path")) {
+    yaml_parser.getYamlParam("save_map_path", &save_map_path_);
+  }
+  if (yaml_parser.hasParam("prior_map_rotation_precision")) {
+    yaml_parser.getYamlParam("prior_map_rotation_precision",
+                             &prior_map_rotation_precision_);
+  }
+  if (yaml_parser.hasParam("prior_map_translation_precision")) {
+    yaml_parser.getYamlParam("prior_map_translation_precision",
+                             &prior_map_translation_precision_);
+  }
+  if (yaml_parser.hasParam("relocalize_after_tracking_loss")) {
+    yaml_parser.getYamlParam("relocalize_after_tracking_loss",
+                             &relocalize_after_tracking_loss_);
+  }
+  if (yaml_parser.hasParam("relocalization_max_keyframes")) {
+    yaml_parser.getYamlParam("relocalization_max_keyframes",
+                             &relocalization_max_keyframes_);
+    CHECK_GT(relocalization_max_keyframes_, 0);
+  }
+  if (yaml_parser.hasParam("relocalization_rotation_precision")) {
+    yaml_parser.getYamlParam("relocalization_rotation_precision",
+                             &relocalization_rotation_precision_);
+    CHECK_GT(relocalization_rotation_precision_, 0.0);
+  }
+  if (yaml_parser.hasParam("relocalization_translation_precision")) {
+    yaml_parser.getYamlParam("relocalization_translation_precision",
+                             &relocalization_translation_precision_);
+    CHECK_GT(relocalization_translation_precision_, 0.0);
+  }
+  if (yaml_parser.hasParam("remote_server_host")) {
+    yaml_parser.getYamlParam("remote_server_host", &remote_server_host_);
+  }
+  if (yaml_parser.hasParam("remote_server_port")) {
+    yaml_parser.getYamlParam("remote_server_port", &remote_server_port_);
+    CHECK_GT(remote_server_port_, 0);
+    CHECK_LE(remote_server_port_, 65535);
+  }
+  if (yaml_parser.hasParam("robot_id")) {
+    yaml_parser.getYamlParam("robot_id", &robot_id_);
+    CHECK_GE(robot_id_, 0);
+  }
+  if (yaml_parser.hasParam("remote_max_pending_bytes")) {
+    yaml_parser.getYamlParam("remote_max_pending_bytes",
+                             &remote_max_pending_bytes_);
+    CHECK_GT(remote_max_pending_bytes_, 0);
+  }
 
   // Now manually change required parameters in tracker
   yaml_parser.getYamlParam("disparity_threshold",
@@ -164,6 +267,194 @@ bool LoopClosureDetectorParams::parseYAML(const std::string& filepath) {
                              &frame_cache.remove_cache_on_exit);
   }
 
+  if (yaml_parser.hasParam("frame_cache_async_write")) {
+    yaml_parser.getYamlParam("frame_cache_async_write",
+                             &frame_cache.async_write);
+  }
+
+  if (yaml_parser.hasParam("frame_cache_compression_level")) {
+    yaml_parser.getYamlParam("frame_cache_compression_level",
+                             &frame_cache.compression_level);
+  }
+  CHECK_GE(frame_cache.compression_level, 0);
+
+  if (yaml_parser.hasParam("frame_cache_max_resident_mb")) {
+    double max_resident_mb;
+    yaml_parser.getYamlParam("frame_cache_max_resident_mb", &max_resident_mb);
+    frame_cache.max_resident_bytes =
+        static_cast<int64_t>(max_resident_mb * 1.0e6);
+  }
+
+  if (yaml_parser.hasParam("bow_db_num_threads")) {
+    yaml_parser.getYamlParam("bow_db_num_threads", &bow_database.num_threads);
+  }
+  CHECK_GE(bow_database.num_threads, 1)
+      << "LoopClosureDetectorParams: bow_db_num_threads must be >= 1!";
+
+  if (yaml_parser.hasParam("bow_db_min_parallel_entries")) {
+    yaml_parser.getYamlParam("bow_db_min_parallel_entries",
+                             &bow_database.min_parallel_entries);
+  }
+
+  if (yaml_parser.hasParam("bow_db_stop_word_fraction")) {
+    yaml_parser.getYamlParam("bow_db_stop_word_fraction",
+                             &bow_database.stop_word_fraction);
+  }
+  CHECK_GT(bow_database.stop_word_fraction, 0.0)
+      << "LoopClosureDetectorParams: bow_db_stop_word_fraction must be > 0!";
+
+  if (yaml_parser.hasParam("bow_db_stop_word_min_entries")) {
+    yaml_parser.getYamlParam("bow_db_stop_word_min_entries",
+                             &bow_database.stop_word_min_entries);
+  }
+
+  if (yaml_parser.hasParam("incremental_pgo")) {
+    yaml_parser.getYamlParam("incremental_pgo", &incremental_pgo.enabled);
+  }
+  if (yaml_parser.hasParam("incremental_pgo_min_node_translation")) {
+    yaml_parser.getYamlParam("incremental_pgo_min_node_translation",
+                             &incremental_pgo.min_node_translation);
+  }
+  if (yaml_parser.hasParam("incremental_pgo_min_node_rotation")) {
+    yaml_parser.getYamlParam("incremental_pgo_min_node_rotation",
+                             &incremental_pgo.min_node_rotation);
+  }
+  if (yaml_parser.hasParam("incremental_pgo_max_keyframes_between_nodes")) {
+    yaml_parser.getYamlParam("incremental_pgo_max_keyframes_between_nodes",
+                             &incremental_pgo.max_keyframes_between_nodes);
+  }
+  CHECK_GT(incremental_pgo.max_keyframes_between_nodes, 0)
+      << "LoopClosureDetectorParams: "
+         "incremental_pgo_max_keyframes_between_nodes must be > 0!";
+  if (yaml_parser.hasParam("incremental_pgo_max_solve_iterations")) {
+    yaml_parser.getYamlParam("incremental_pgo_max_solve_iterations",
+                             &incremental_pgo.max_solve_iterations);
+  }
+  if (yaml_parser.hasParam("incremental_pgo_max_solve_time_ms")) {
+    yaml_parser.getYamlParam("incremental_pgo_max_solve_time_ms",
+                             &incremental_pgo.max_solve_time_ms);
+  }
+  if (yaml_parser.hasParam("incremental_pgo_relinearize_threshold")) {
+    yaml_parser.getYamlParam("incremental_pgo_relinearize_threshold",
+                             &incremental_pgo.relinearize_threshold);
+  }
+  if (yaml_parser.hasParam("incremental_pgo_loop_closure_cauchy_width")) {
+    yaml_parser.getYamlParam("incremental_pgo_loop_closure_cauchy_width",
+                             &incremental_pgo.loop_closure_cauchy_width);
+  }
+
+  if (yaml_parser.hasParam("incremental_pcm_window_size")) {
+    yaml_parser.getYamlParam("incremental_pcm_window_size",
+                             &incremental_pcm.window_size);
+  }
+  CHECK_GE(incremental_pcm.window_size, 0)
+      << "LoopClosureDetectorParams: "
+         "incremental_pcm_window_size must be >= 0!";
+  if (yaml_parser.hasParam("incremental_pcm_region_radius")) {
+    yaml_parser.getYamlParam("incremental_pcm_region_radius",
+                             &incremental_pcm.region_radius);
+  }
+  if (yaml_parser.hasParam("incremental_pcm_trans_threshold")) {
+    yaml_parser.getYamlParam("incremental_pcm_trans_threshold",
+                             &incremental_pcm.trans_threshold);
+  }
+  if (yaml_parser.hasParam("incremental_pcm_rot_threshold")) {
+    yaml_parser.getYamlParam("incremental_pcm_rot_threshold",
+                             &incremental_pcm.rot_threshold);
+  }
+  if (yaml_parser.hasParam("incremental_pcm_min_clique_size")) {
+    yaml_parser.getYamlParam("incremental_pcm_min_clique_size",
+                             &incremental_pcm.min_clique_size);
+  }
+
+  if (yaml_parser.hasParam("spatial_gating_enabled")) {
+    yaml_parser.getYamlParam("spatial_gating_enabled",
+                             &spatial_gating.enabled);
+  }
+  if (yaml_parser.hasParam("spatial_gating_min_radius")) {
+    yaml_parser.getYamlParam("spatial_gating_min_radius",
+                             &spatial_gating.min_radius);
+  }
+  CHECK_GT(spatial_gating.min_radius, 0.0)
+      << "LoopClosureDetectorParams: "
+         "spatial_gating_min_radius must be > 0!";
+  if (yaml_parser.hasParam("spatial_gating_drift_fraction")) {
+    yaml_parser.getYamlParam("spatial_gating_drift_fraction",
+                             &spatial_gating.drift_fraction);
+  }
+  CHECK_GE(spatial_gating.drift_fraction, 0.0)
+      << "LoopClosureDetectorParams: "
+         "spatial_gating_drift_fraction must be >= 0!";
+  if (yaml_parser.hasParam("spatial_gating_max_radius")) {
+    yaml_parser.getYamlParam("spatial_gating_max_radius",
+                             &spatial_gating.max_radius);
+  }
+  CHECK_GE(spatial_gating.max_radius, spatial_gating.min_radius)
+      << "LoopClosureDetectorParams: spatial_gating_max_radius must be >= "
+         "spatial_gating_min_radius!";
+  if (yaml_parser.hasParam("spatial_gating_max_candidate_fraction")) {
+    yaml_parser.getYamlParam("spatial_gating_max_candidate_fraction",
+                             &spatial_gating.max_candidate_fraction);
+  }
+  CHECK_GT(spatial_gating.max_candidate_fraction, 0.0)
+      << "LoopClosureDetectorParams: "
+         "spatial_gating_max_candidate_fraction must be > 0!";
+
+  if (yaml_parser.hasParam("database_insertion_enabled")) {
+    yaml_parser.getYamlParam("database_insertion_enabled",
+                             &database_insertion.enabled);
+  }
+  if (yaml_parser.hasParam("database_insertion_max_similarity")) {
+    yaml_parser.getYamlParam("database_insertion_max_similarity",
+                             &database_insertion.max_similarity);
+  }
+  CHECK_GE(database_insertion.max_similarity, 0.0)
+      << "LoopClosureDetectorParams: "
+         "database_insertion_max_similarity must be >= 0!";
+  if (yaml_parser.hasParam("database_insertion_nr_recent_entries")) {
+    yaml_parser.getYamlParam("database_insertion_nr_recent_entries",
+                             &database_insertion.nr_recent_entries);
+  }
+  CHECK_GT(database_insertion.nr_recent_entries, 0)
+      << "LoopClosureDetectorParams: "
+         "database_insertion_nr_recent_entries must be > 0!";
+  if (yaml_parser.hasParam("database_insertion_min_translation")) {
+    yaml_parser.getYamlParam("database_insertion_min_translation",
+                             &database_insertion.min_translation);
+  }
+  CHECK_GT(database_insertion.min_translation, 0.0)
+      << "LoopClosureDetectorParams: "
+         "database_insertion_min_translation must be > 0!";
+
+  if (yaml_parser.hasParam("global_descriptor_vocabulary_level")) {
+    yaml_parser.getYamlParam("global_descriptor_vocabulary_level",
+                             &global_descriptor.vocabulary_level);
+  }
+  CHECK_GT(global_descriptor.vocabulary_level, 0)
+      << "LoopClosureDetectorParams: "
+         "global_descriptor_vocabulary_level must be > 0!";
+  if (yaml_parser.hasParam("global_descriptor_projection_dim")) {
+    yaml_parser.getYamlParam("global_descriptor_projection_dim",
+                             &global_descriptor.projection_dim);
+  }
+  if (yaml_parser.hasParam("hnsw_m")) {
+    yaml_parser.getYamlParam("hnsw_m", &global_descriptor.hnsw.M);
+  }
+  CHECK_GE(global_descriptor.hnsw.M, 2)
+      << "LoopClosureDetectorParams: hnsw_m must be >= 2!";
+  if (yaml_parser.hasParam("hnsw_ef_construction")) {
+    yaml_parser.getYamlParam("hnsw_ef_construction",
+                             &global_descriptor.hnsw.ef_construction);
+  }
+  CHECK_GT(global_descriptor.hnsw.ef_construction, 0)
+      << "LoopClosureDetectorParams: hnsw_ef_construction must be > 0!";
+  if (yaml_parser.hasParam("hnsw_ef_search")) {
+    yaml_parser.getYamlParam("hnsw_ef_search",
+                             &global_descriptor.hnsw.ef_search);
+  }
+  CHECK_GT(global_descriptor.hnsw.ef_search, 0)
+      << "LoopClosureDetectorParams: hnsw_ef_search must be > 0!";
+
   return true;
 }
 
@@ -194,6 +485,16 @@ void LoopClosureDetectorParams::print() const {
                         max_nrFrames_between_islands_,
                         "max_nrFrames_between_queries_: ",
                         max_nrFrames_between_queries_,
+                        "verification_num_workers_: ",
+                        verification_num_workers_,
+                        "verification_queue_size_: ",
+                        verification_queue_size_,
+                        "prefetch_top_k_: ",
+                        prefetch_top_k_,
+                        "prefetch_temporal_neighbors_: ",
+                        prefetch_temporal_neighbors_,
+                        "lcd_type_: ",
+                        static_cast<unsigned int>(lcd_type_),
 
                         "refine_pose_:",
                         refine_pose_,
@@ -201,6 +502,12 @@ void LoopClosureDetectorParams::print() const {
                         static_cast<unsigned int>(pose_recovery_type_),
                         "lowe_ratio_: ",
                         lowe_ratio_,
+                        "max_hamming_distance_: ",
+                        max_hamming_distance_,
+                        "bow_guided_matching_: ",
+                        bow_guided_matching_,
+                        "bow_guided_matching_levels_up_: ",
+                        bow_guided_matching_levels_up_,
                         "matcher_type_:",
                         static_cast<unsigned int>(matcher_type_),
 
@@ -222,6 +529,10 @@ void LoopClosureDetectorParams::print() const {
                         patch_sze_,
                         "fast_threshold_: ",
                         fast_threshold_,
+                        "use_gpu_orb_: ",
+                        use_gpu_orb_,
+                        "reuse_frontend_features_: ",
+                        reuse_frontend_features_,
 
                         "betweenRotationPrecision_: ",
                         betweenRotationPrecision_,
@@ -240,6 +551,34 @@ void LoopClosureDetectorParams::print() const {
                         gnc_alpha_,
                         "max_lc_cached_before_optimize_",
                         max_lc_cached_before_optimize_,
+                        "loop_closure_batch_size_",
+                        loop_closure_batch_size_,
+                        "loop_closure_batch_window_",
+                        loop_closure_batch_window_,
+                        "prior_map_path_",
+                        prior_map_path_,
+                        "save_map_path_",
+                        save_map_path_,
+                        "prior_map_rotation_precision_",
+                        prior_map_rotation_precision_,
+                        "prior_map_translation_precision_",
+                        prior_map_translation_precision_,
+                        "relocalize_after_tracking_loss_",
+                        relocalize_after_tracking_loss_,
+                        "relocalization_max_keyframes_",
+                        relocalization_max_keyframes_,
+                        "relocalization_rotation_precision_",
+                        relocalization_rotation_precision_,
+                        "relocalization_translation_precision_",
+                        relocalization_translation_precision_,
+                        "remote_server_host_",
+                        remote_server_host_,
+                        "remote_server_port_",
+                        remote_server_port_,
+                        "robot_id_",
+                        robot_id_,
+                        "remote_max_pending_bytes_",
+                        remote_max_pending_bytes_,
 
                         "frame_cache.max_frames",
                         frame_cache.max_frames,
@@ -250,7 +589,80 @@ void LoopClosureDetectorParams::print() const {
                         "frame_cache.num_frames_per_file",
                         frame_cache.num_frames_per_file,
                         "frame_cahce.remove_cache_on_exit",
-                        frame_cache.remove_cache_on_exit);
+                        frame_cache.remove_cache_on_exit,
+                        "frame_cache.async_write",
+                        frame_cache.async_write,
+                        "frame_cache.compression_level",
+                        frame_cache.compression_level,
+                        "frame_cache.max_resident_bytes",
+                        frame_cache.max_resident_bytes,
+
+                        "bow_database.num_threads",
+                        bow_database.num_threads,
+                        "bow_database.min_parallel_entries",
+                        bow_database.min_parallel_entries,
+                        "bow_database.stop_word_fraction",
+                        bow_database.stop_word_fraction,
+                        "bow_database.stop_word_min_entries",
+                        bow_database.stop_word_min_entries,
+
+                        "incremental_pgo.enabled",
+                        incremental_pgo.enabled,
+                        "incremental_pgo.min_node_translation",
+                        incremental_pgo.min_node_translation,
+                        "incremental_pgo.min_node_rotation",
+                        incremental_pgo.min_node_rotation,
+                        "incremental_pgo.max_keyframes_between_nodes",
+                        incremental_pgo.max_keyframes_between_nodes,
+                        "incremental_pgo.max_solve_iterations",
+                        incremental_pgo.max_solve_iterations,
+                        "incremental_pgo.max_solve_time_ms",
+                        incremental_pgo.max_solve_time_ms,
+                        "incremental_pgo.relinearize_threshold",
+                        incremental_pgo.relinearize_threshold,
+                        "incremental_pgo.loop_closure_cauchy_width",
+                        incremental_pgo.loop_closure_cauchy_width,
+
+                        "incremental_pcm.window_size",
+                        incremental_pcm.window_size,
+                        "incremental_pcm.region_radius",
+                        incremental_pcm.region_radius,
+                        "incremental_pcm.trans_threshold",
+                        incremental_pcm.trans_threshold,
+                        "incremental_pcm.rot_threshold",
+                        incremental_pcm.rot_threshold,
+                        "incremental_pcm.min_clique_size",
+                        incremental_pcm.min_clique_size,
+
+                        "spatial_gating.enabled",
+                        spatial_gating.enabled,
+                        "spatial_gating.min_radius",
+                        spatial_gating.min_radius,
+                        "spatial_gating.drift_fraction",
+                        spatial_gating.drift_fraction,
+                        "spatial_gating.max_radius",
+                        spatial_gating.max_radius,
+                        "spatial_gating.max_candidate_fraction",
+                        spatial_gating.max_candidate_fraction,
+                        "database_insertion.enabled",
+                        database_insertion.enabled,
+                        "database_insertion.max_similarity",
+                        database_insertion.max_similarity,
+                        "database_insertion.nr_recent_entries",
+                        database_insertion.nr_recent_entries,
+                        "database_insertion.min_translation",
+                        database_insertion.min_translation,
+
+                        "global_descriptor.vocabulary_level",
+                        global_descriptor.vocabulary_level,
+                        "global_descriptor.projection_dim",
+                        global_descriptor.projection_dim,
+                        "global_descriptor.hnsw.M",
+                        global_descriptor.hnsw.M,
+                        "global_descriptor.hnsw.ef_construction",
+                        global_descriptor.hnsw.ef_construction,
+                        "global_descriptor.hnsw.ef_search",
+                        global_descriptor.hnsw.ef_search);
   LOG(INFO) << out.str();
 }
 
@@ -266,10 +678,19 @@ bool LoopClosureDetectorParams::equals(const LoopClosureDetectorParams& lp2,
          (max_intraisland_gap_ == lp2.max_intraisland_gap_) &&
          (max_nrFrames_between_islands_ == lp2.max_nrFrames_between_islands_) &&
          (max_nrFrames_between_queries_ == lp2.max_nrFrames_between_queries_) &&
+         (verification_num_workers_ == lp2.verification_num_workers_) &&
+         (verification_queue_size_ == lp2.verification_queue_size_) &&
+         (prefetch_top_k_ == lp2.prefetch_top_k_) &&
+         (prefetch_temporal_neighbors_ == lp2.prefetch_temporal_neighbors_) &&
+         (lcd_type_ == lp2.lcd_type_) &&
 
          (refine_pose_ == lp2.refine_pose_) &&
          (pose_recovery_type_ == lp2.pose_recovery_type_) &&
          (fabs(lowe_ratio_ - lp2.lowe_ratio_) <= tol) &&
+         (max_hamming_distance_ == lp2.max_hamming_distance_) &&
+         (bow_guided_matching_ == lp2.bow_guided_matching_) &&
+         (bow_guided_matching_levels_up_ ==
+          lp2.bow_guided_matching_levels_up_) &&
          (matcher_type_ == lp2.matcher_type_) &&
 
          (nfeatures_ == lp2.nfeatures_) &&
@@ -279,6 +700,8 @@ bool LoopClosureDetectorParams::equals(const LoopClosureDetectorParams& lp2,
          (first_level_ == lp2.first_level_) && (WTA_K_ == lp2.WTA_K_) &&
          (score_type_ == lp2.score_type_) && (patch_sze_ == lp2.patch_sze_) &&
          (fast_threshold_ == lp2.fast_threshold_) &&
+         (use_gpu_orb_ == lp2.use_gpu_orb_) &&
+         (reuse_frontend_features_ == lp2.reuse_frontend_features_) &&
 
          (fabs(betweenRotationPrecision_ - lp2.betweenRotationPrecision_) <=
           tol) &&
@@ -292,6 +715,25 @@ bool LoopClosureDetectorParams::equals(const LoopClosureDetectorParams& lp2,
          (fabs(gnc_alpha_ - lp2.gnc_alpha_) <= tol) &&
          (max_lc_cached_before_optimize_ ==
           lp2.max_lc_cached_before_optimize_) &&
+         (loop_closure_batch_size_ == lp2.loop_closure_batch_size_) &&
+         (loop_closure_batch_window_ == lp2.loop_closure_batch_window_) &&
+         (prior_map_path_ == lp2.prior_map_path_) &&
+         (save_map_path_ == lp2.save_map_path_) &&
+         (fabs(prior_map_rotation_precision_ -
+               lp2.prior_map_rotation_precision_) <= tol) &&
+         (fabs(prior_map_translation_precision_ -
+               lp2.prior_map_translation_precision_) <= tol) &&
+         (relocalize_after_tracking_loss_ ==
+          lp2.relocalize_after_tracking_loss_) &&
+         (relocalization_max_keyframes_ == lp2.relocalization_max_keyframes_) &&
+         (fabs(relocalization_rotation_precision_ -
+               lp2.relocalization_rotation_precision_) <= tol) &&
+         (fabs(relocalization_translation_precision_ -
+               lp2.relocalization_translation_precision_) <= tol) &&
+         (remote_server_host_ == lp2.remote_server_host_) &&
+         (remote_server_port_ == lp2.remote_server_port_) &&
+         (robot_id_ == lp2.robot_id_) &&
+         (remote_max_pending_bytes_ == lp2.remote_max_pending_bytes_) &&
 
          (frame_cache.max_frames == lp2.frame_cache.max_frames) &&
          (frame_cache.cache_path == lp2.frame_cache.cache_path) &&
@@ -299,7 +741,70 @@ bool LoopClosureDetectorParams::equals(const LoopClosureDetectorParams& lp2,
          (frame_cache.num_frames_per_file ==
           lp2.frame_cache.num_frames_per_file) &&
          (frame_cache.remove_cache_on_exit ==
-          lp2.frame_cache.remove_cache_on_exit);
+          lp2.frame_cache.remove_cache_on_exit) &&
+         (frame_cache.async_write == lp2.frame_cache.async_write) &&
+         (frame_cache.compression_level ==
+          lp2.frame_cache.compression_level) &&
+         (frame_cache.max_resident_bytes ==
+          lp2.frame_cache.max_resident_bytes) &&
+
+         (bow_database.num_threads == lp2.bow_database.num_threads) &&
+         (bow_database.min_parallel_entries ==
+          lp2.bow_database.min_parallel_entries) &&
+         (fabs(bow_database.stop_word_fraction -
+               lp2.bow_database.stop_word_fraction) <= tol) &&
+         (bow_database.stop_word_min_entries ==
+          lp2.bow_database.stop_word_min_entries) &&
+
+         (incremental_pgo.enabled == lp2.incremental_pgo.enabled) &&
+         (fabs(incremental_pgo.min_node_translation -
+               lp2.incremental_pgo.min_node_translation) <= tol) &&
+         (fabs(incremental_pgo.min_node_rotation -
+               lp2.incremental_pgo.min_node_rotation) <= tol) &&
+         (incremental_pgo.max_keyframes_between_nodes ==
+          lp2.incremental_pgo.max_keyframes_between_nodes) &&
+         (incremental_pgo.max_solve_iterations ==
+          lp2.incremental_pgo.max_solve_iterations) &&
+         (fabs(incremental_pgo.max_solve_time_ms -
+               lp2.incremental_pgo.max_solve_time_ms) <= tol) &&
+         (fabs(incremental_pgo.relinearize_threshold -
+               lp2.incremental_pgo.relinearize_threshold) <= tol) &&
+         (fabs(incremental_pgo.loop_closure_cauchy_width -
+               lp2.incremental_pgo.loop_closure_cauchy_width) <= tol) &&
+         (incremental_pcm.window_size == lp2.incremental_pcm.window_size) &&
+         (fabs(incremental_pcm.region_radius -
+               lp2.incremental_pcm.region_radius) <= tol) &&
+         (fabs(incremental_pcm.trans_threshold -
+               lp2.incremental_pcm.trans_threshold) <= tol) &&
+         (fabs(incremental_pcm.rot_threshold -
+               lp2.incremental_pcm.rot_threshold) <= tol) &&
+         (incremental_pcm.min_clique_size ==
+          lp2.incremental_pcm.min_clique_size) &&
+         (spatial_gating.enabled == lp2.spatial_gating.enabled) &&
+         (fabs(spatial_gating.min_radius - lp2.spatial_gating.min_radius) <=
+          tol) &&
+         (fabs(spatial_gating.drift_fraction -
+               lp2.spatial_gating.drift_fraction) <= tol) &&
+         (fabs(spatial_gating.max_radius - lp2.spatial_gating.max_radius) <=
+          tol) &&
+         (fabs(spatial_gating.max_candidate_fraction -
+               lp2.spatial_gating.max_candidate_fraction) <= tol) &&
+         (database_insertion.enabled == lp2.database_insertion.enabled) &&
+         (fabs(database_insertion.max_similarity -
+               lp2.database_insertion.max_similarity) <= tol) &&
+         (database_insertion.nr_recent_entries ==
+          lp2.database_insertion.nr_recent_entries) &&
+         (fabs(database_insertion.min_translation -
+               lp2.database_insertion.min_translation) <= tol) &&
+         (global_descriptor.vocabulary_level ==
+          lp2.global_descriptor.vocabulary_level) &&
+         (global_descriptor.projection_dim ==
+          lp2.global_descriptor.projection_dim) &&
+         (global_descriptor.hnsw.M == lp2.global_descriptor.hnsw.M) &&
+         (global_descriptor.hnsw.ef_construction ==
+          lp2.global_descriptor.hnsw.ef_construction) &&
+         (global_descriptor.hnsw.ef_search ==
+          lp2.global_descriptor.hnsw.ef_search);
 }
 
 }  // namespace VIO
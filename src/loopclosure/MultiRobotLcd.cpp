@@ -0,0 +1,207 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   MultiRobotLcd.cpp
+ * @brief  Loop closures and PGO of the keyframes streamed by several robots,
+ * with a database shared by all of them.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/loopclosure/MultiRobotLcd.h"
+
+#include <DBoW2/DBoW2.h>
+#include <glog/logging.h>
+#include <gtsam/inference/Symbol.h>
+
+namespace VIO {
+
+MultiRobotLcd::MultiRobotLcd(const LcdFactoryCallback& lcd_factory,
+                             const MultiRobotLcdParams& params)
+    : lcd_factory_(lcd_factory),
+      params_(params),
+      robots_(),
+      shared_db_(nullptr),
+      shared_db_entries_(),
+      nr_inter_robot_lc_(0u) {
+  CHECK(lcd_factory_);
+  CHECK_GT(params_.max_query_results, 0);
+  CHECK_GE(params_.max_inter_robot_candidates, 0);
+}
+
+/* ------------------------------------------------------------------------ */
+std::unique_ptr<RemoteLcdCorrection> MultiRobotLcd::addKeyframe(
+    const RemoteKeyframe& keyframe) {
+  CHECK(keyframe.frame_);
+  auto robot_it = robots_.find(keyframe.robot_id_);
+  if (robot_it == robots_.end()) {
+    Robot robot;
+    robot.lcd = lcd_factory_(keyframe.robot_id_);
+    CHECK(robot.lcd);
+    // No Backend queue here: optimize at each loop closure.
+    robot.lcd->registerIsBackendQueueFilledCallback([]() { return false; });
+    // The first robot defines the shared frame.
+    if (robots_.empty()) robot.Shared_Pose_Map = gtsam::Pose3();
+    if (!shared_db_) {
+      // Shares the vocabulary of the robot.
+      shared_db_ = std::make_unique<BowDatabase>(*robot.lcd->getBoWDatabase());
+      shared_db_->clear();
+    }
+    LOG(INFO) << "New robot: " << keyframe.robot_id_ << ".";
+    robot_it = robots_.emplace(keyframe.robot_id_, std::move(robot)).first;
+  }
+  Robot& robot = robot_it->second;
+  if (!robot.robot_kf_ids.empty() &&
+      keyframe.kf_id_ <= robot.robot_kf_ids.back()) {
+    LOG(WARNING) << "Dropping keyframe " << keyframe.kf_id_ << " of robot "
+                 << keyframe.robot_id_ << ", not after keyframe "
+                 << robot.robot_kf_ids.back() << ".";
+    return nullptr;
+  }
+
+  const FrameId kf_id = robot.robot_kf_ids.size();
+  robot.robot_kf_ids.push_back(keyframe.kf_id_);
+  DBoW2::BowVector bow_vec;
+  bow_vec.insert(keyframe.bow_vec_.begin(), keyframe.bow_vec_.end());
+  const LcdOutput::UniquePtr output =
+      robot.lcd->spinOnceWithFrame(keyframe.timestamp_,
+                                   kf_id,
+                                   keyframe.W_Pose_Blkf_,
+                                   keyframe.frame_,
+                                   bow_vec.empty() ? nullptr : &bow_vec);
+  CHECK(output);
+
+  if (!bow_vec.empty()) {
+    detectInterRobotLoop(
+        keyframe.robot_id_,
+        kf_id,
+        *keyframe.frame_,
+        output->states_.at<gtsam::Pose3>(gtsam::Symbol(kf_id)),
+        bow_vec);
+    shared_db_->add(bow_vec);
+    shared_db_entries_.emplace_back(keyframe.robot_id_, kf_id);
+  }
+  return toCorrection(keyframe.robot_id_, robot, *output);
+}
+
+/* ------------------------------------------------------------------------ */
+std::optional<gtsam::Pose3> MultiRobotLcd::getSharedPoseMap(
+    const RobotId& robot_id) const {
+  const auto robot_it = robots_.find(robot_id);
+  if (robot_it == robots_.end()) return std::nullopt;
+  return robot_it->second.Shared_Pose_Map;
+}
+
+const LoopClosureDetector* MultiRobotLcd::getLcd(
+    const RobotId& robot_id) const {
+  const auto robot_it = robots_.find(robot_id);
+  return robot_it == robots_.end() ? nullptr : robot_it->second.lcd.get();
+}
+
+/* ------------------------------------------------------------------------ */
+void MultiRobotLcd::detectInterRobotLoop(const RobotId& robot_id,
+                                         const FrameId& kf_id,
+                                         const LCDFrame& frame,
+                                         const gtsam::Pose3& Map_Pose_B,
+                                         const DBoW2::BowVector& bow_vec) {
+  Robot& query_robot = robots_.at(robot_id);
+  // Only the loop closures between an aligned and an unaligned robot count.
+  bool is_any_unaligned = false;
+  for (const auto& robot : robots_) {
+    is_any_unaligned = is_any_unaligned || !robot.second.Shared_Pose_Map;
+  }
+  if (!is_any_unaligned || shared_db_->size() == 0u) return;
+
+  DBoW2::QueryResults results;
+  shared_db_->query(bow_vec, results, params_.max_query_results);
+  int nr_candidates = 0;
+  for (const DBoW2::Result& result : results) {
+    if (nr_candidates >= params_.max_inter_robot_candidates ||
+        result.Score < params_.min_inter_robot_score) {
+      break;
+    }
+    const std::pair<RobotId, FrameId>& entry =
+        shared_db_entries_.at(result.Id);
+    if (entry.first == robot_id) continue;
+    Robot& match_robot = robots_.at(entry.first);
+    if (query_robot.Shared_Pose_Map.has_value() ==
+        match_robot.Shared_Pose_Map.has_value()) {
+      continue;
+    }
+    ++nr_candidates;
+
+    const LCDFrame::Ptr match_frame =
+        match_robot.lcd->getFrameCache().getFrame(entry.second);
+    if (!match_frame) continue;
+    LoopResult loop_result;
+    loop_result.query_id_ = kf_id;
+    loop_result.match_id_ = entry.second;
+    query_robot.lcd->verifyLoop(*match_frame, frame, &loop_result);
+    if (!loop_result.isLoop()) {
+      VLOG(2) << "MultiRobotLcd: no loop closure from robot " << entry.first
+              << " to robot " << robot_id << ". Reason: "
+              << LoopResult::asString(loop_result.status_);
+      continue;
+    }
+
+    // Both sides give the pose of the query in the shared frame, with m the
+    // match and q the query robot:
+    // Shared_Pose_Mapm * Mapm_Pose_Bm * Bm_Pose_Bq =
+    //   Shared_Pose_Mapq * Mapq_Pose_Bq
+    const gtsam::Pose3 Match_Map_Pose_B =
+        match_robot.lcd->getPGOTrajectory().at<gtsam::Pose3>(
+            gtsam::Symbol(entry.second));
+    const gtsam::Pose3& match_Pose_query = loop_result.relative_pose_;
+    if (match_robot.Shared_Pose_Map) {
+      query_robot.Shared_Pose_Map = match_robot.Shared_Pose_Map->compose(
+          Match_Map_Pose_B * match_Pose_query * Map_Pose_B.inverse());
+      LOG(INFO) << "Robot " << robot_id << " aligned through robot "
+                << entry.first << ".";
+    } else {
+      match_robot.Shared_Pose_Map = query_robot.Shared_Pose_Map->compose(
+          Map_Pose_B * match_Pose_query.inverse() * Match_Map_Pose_B.inverse());
+      LOG(INFO) << "Robot " << entry.first << " aligned through robot "
+                << robot_id << ".";
+    }
+    ++nr_inter_robot_lc_;
+    return;
+  }
+}
+
+/* ------------------------------------------------------------------------ */
+std::unique_ptr<RemoteLcdCorrection> MultiRobotLcd::toCorrection(
+    const RobotId& robot_id,
+    const Robot& robot,
+    const LcdOutput& output) const {
+  const std::vector<FrameId>& robot_kf_ids = robot.robot_kf_ids;
+  auto correction = std::make_unique<RemoteLcdCorrection>();
+  correction->robot_id_ = robot_id;
+  correction->kf_id_ = robot_kf_ids.back();
+  correction->timestamp_ = output.timestamp_;
+  correction->is_loop_closure_ = output.is_loop_closure_;
+  if (output.is_loop_closure_) {
+    correction->id_match_ = robot_kf_ids.at(output.id_match_);
+    correction->id_recent_ = robot_kf_ids.at(output.id_recent_);
+    correction->timestamp_match_ = output.timestamp_match_;
+    correction->timestamp_query_ = output.timestamp_query_;
+    correction->relative_pose_ = output.relative_pose_;
+  }
+  correction->W_Pose_Map_ = output.W_Pose_Map_;
+  correction->Map_Pose_Odom_ = output.Map_Pose_Odom_;
+  correction->is_trajectory_corrected_ = output.is_trajectory_corrected_;
+  for (const gtsam::Key& key : output.states_.keys()) {
+    const FrameId kf_id = gtsam::Symbol(key).index();
+    const FrameId robot_kf_id = robot_kf_ids.at(kf_id);
+    correction->states_[robot_kf_id] = output.states_.at<gtsam::Pose3>(key);
+    correction->timestamp_map_[robot_kf_id] = output.timestamp_map_.at(kf_id);
+  }
+  correction->Shared_Pose_Map_ = robot.Shared_Pose_Map;
+  return correction;
+}
+
+}  // namespace VIO
@@ -0,0 +1,133 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   OrbHammingMatcher.cpp
+ * @brief  Brute-force 2-NN matcher specialized for 256-bit ORB descriptors.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/loopclosure/OrbHammingMatcher.h"
+
+#include <limits>
+
+#include <glog/logging.h>
+
+#include "kimera-vio/utils/SimdKernels.h"
+
+namespace VIO {
+
+uint32_t orbHammingDistance(const uint8_t* a, const uint8_t* b) {
+  return utils::SimdKernels::get().orb_hamming_distance(a, b);
+}
+
+OrbHammingMatcher::OrbHammingMatcher(const int& max_distance)
+    : max_distance_(static_cast<uint32_t>(max_distance)) {
+  CHECK_GE(max_distance, 0);
+}
+
+void OrbHammingMatcher::match(const cv::Mat& query_descriptors,
+                              const cv::Mat& train_descriptors,
+                              const double& lowe_ratio,
+                              std::vector<cv::DMatch>* matches) const {
+  CHECK_NOTNULL(matches);
+  matches->clear();
+  if (query_descriptors.empty() || train_descriptors.rows < 2) return;
+  CHECK_EQ(query_descriptors.type(), CV_8U);
+  CHECK_EQ(train_descriptors.type(), CV_8U);
+  CHECK_EQ(query_descriptors.cols, kOrbDescriptorBytes);
+  CHECK_EQ(train_descriptors.cols, kOrbDescriptorBytes);
+  matches->reserve(query_descriptors.rows);
+  for (int query_idx = 0; query_idx < query_descriptors.rows; ++query_idx) {
+    matchQuery(query_descriptors.ptr<uint8_t>(query_idx),
+               query_idx,
+               train_descriptors,
+               nullptr,
+               lowe_ratio,
+               matches);
+  }
+}
+
+void OrbHammingMatcher::matchGrouped(const cv::Mat& query_descriptors,
+                                     const cv::Mat& train_descriptors,
+                                     const DescriptorGroups& query_groups,
+                                     const DescriptorGroups& train_groups,
+                                     const double& lowe_ratio,
+                                     std::vector<cv::DMatch>* matches) const {
+  CHECK_NOTNULL(matches);
+  matches->clear();
+  if (query_descriptors.empty() || train_descriptors.empty()) return;
+  CHECK_EQ(query_descriptors.type(), CV_8U);
+  CHECK_EQ(train_descriptors.type(), CV_8U);
+  CHECK_EQ(query_descriptors.cols, kOrbDescriptorBytes);
+  CHECK_EQ(train_descriptors.cols, kOrbDescriptorBytes);
+  // Both maps are sorted by group: walk them in lockstep.
+  auto query_it = query_groups.begin();
+  auto train_it = train_groups.begin();
+  while (query_it != query_groups.end() && train_it != train_groups.end()) {
+    if (query_it->first < train_it->first) {
+      ++query_it;
+    } else if (train_it->first < query_it->first) {
+      ++train_it;
+    } else {
+      for (const unsigned int& query_idx : query_it->second) {
+        CHECK_LT(query_idx, static_cast<unsigned int>(query_descriptors.rows));
+        matchQuery(query_descriptors.ptr<uint8_t>(query_idx),
+                   static_cast<int>(query_idx),
+                   train_descriptors,
+                   &train_it->second,
+                   lowe_ratio,
+                   matches);
+      }
+      ++query_it;
+      ++train_it;
+    }
+  }
+}
+
+void OrbHammingMatcher::matchQuery(
+    const uint8_t* query,
+    const int& query_idx,
+    const cv::Mat& train_descriptors,
+    const std::vector<unsigned int>* train_indices,
+    const double& lowe_ratio,
+    std::vector<cv::DMatch>* matches) const {
+  const int nr_train = train_indices
+                           ? static_cast<int>(train_indices->size())
+                           : train_descriptors.rows;
+  if (nr_train < 2) return;
+  const utils::SimdKernels::DescriptorFunction hamming_distance =
+      utils::SimdKernels::get().orb_hamming_distance;
+  uint32_t best_distance = std::numeric_limits<uint32_t>::max();
+  uint32_t second_distance = std::numeric_limits<uint32_t>::max();
+  int best_idx = -1;
+  for (int i = 0; i < nr_train; ++i) {
+    const int train_idx =
+        train_indices ? static_cast<int>((*train_indices)[i]) : i;
+    DCHECK_LT(train_idx, train_descriptors.rows);
+    const uint32_t distance =
+        hamming_distance(query, train_descriptors.ptr<uint8_t>(train_idx));
+    if (distance < best_distance) {
+      second_distance = best_distance;
+      best_distance = distance;
+      best_idx = train_idx;
+    } else if (distance < second_distance) {
+      second_distance = distance;
+      // Two exact matches: the ratio test can not pass anymore.
+      if (second_distance == 0u) return;
+    }
+  }
+  if (best_distance > max_distance_) return;
+  if (static_cast<double>(best_distance) <
+      lowe_ratio * static_cast<double>(second_distance)) {
+    matches->push_back(cv::DMatch(
+        query_idx, best_idx, static_cast<float>(best_distance)));
+  }
+}
+
+}  // namespace VIO
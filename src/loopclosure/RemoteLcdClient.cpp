@@ -0,0 +1,227 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   RemoteLcdClient.cpp
+ * @brief  Non-blocking connection of a robot to a RemoteLcdServer.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/loopclosure/RemoteLcdClient.h"
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kimera-vio/loopclosure/RemoteLcdCodec.h"
+
+namespace VIO {
+
+namespace {
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+// SO_NOSIGPIPE is set on the socket instead.
+constexpr int kSendFlags = 0;
+#endif
+
+void setNonBlocking(const int& fd) {
+  const int flags = fcntl(fd, F_GETFL, 0);
+  CHECK_GE(flags, 0) << std::strerror(errno);
+  CHECK_GE(fcntl(fd, F_SETFL, flags | O_NONBLOCK), 0) << std::strerror(errno);
+}
+}  // namespace
+
+RemoteLcdClient::RemoteLcdClient(const std::string& host,
+                                 const int& port,
+                                 const size_t& max_pending_bytes)
+    : host_(host),
+      port_(port),
+      max_pending_bytes_(max_pending_bytes),
+      socket_fd_(-1),
+      connecting_(false),
+      last_connect_attempt_(),
+      pending_packets_(),
+      front_offset_(0u),
+      pending_bytes_(0u),
+      nr_dropped_packets_(0u),
+      received_() {
+  CHECK(!host_.empty());
+  CHECK_GT(port_, 0);
+  CHECK_GT(max_pending_bytes_, 0u);
+}
+
+RemoteLcdClient::~RemoteLcdClient() { disconnect(); }
+
+bool RemoteLcdClient::send(std::string packet) {
+  bool is_queued = false;
+  if (pending_bytes_ + packet.size() <= max_pending_bytes_) {
+    pending_bytes_ += packet.size();
+    pending_packets_.push_back(std::move(packet));
+    is_queued = true;
+  } else {
+    ++nr_dropped_packets_;
+    LOG_EVERY_N(WARNING, 10) << "Remote LCD server lagging behind by "
+                             << pending_bytes_ << " bytes: dropped "
+                             << nr_dropped_packets_ << " packets so far.";
+  }
+  if (connect() && !sendPending()) disconnect();
+  return is_queued;
+}
+
+void RemoteLcdClient::receive(std::vector<std::string>* packets) {
+  CHECK_NOTNULL(packets);
+  if (!connect()) return;
+  // What was queued while connecting.
+  if (!sendPending()) {
+    disconnect();
+    return;
+  }
+
+  char buffer[65536];
+  while (true) {
+    const ssize_t size = recv(socket_fd_, buffer, sizeof(buffer), 0);
+    if (size > 0) {
+      received_.append(buffer, static_cast<size_t>(size));
+      continue;
+    }
+    if (size < 0 && errno == EINTR) continue;
+    if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+    LOG(WARNING) << "Remote LCD server disconnected"
+                 << (size < 0 ? std::string(": ") + std::strerror(errno)
+                              : std::string("."));
+    disconnect();
+    return;
+  }
+
+  size_t begin = 0u;
+  while (true) {
+    const char* data = received_.data() + begin;
+    const size_t size = received_.size() - begin;
+    if (!RemoteLcdCodec::isHeaderValid(data, size)) {
+      LOG(WARNING) << "Invalid stream from the remote LCD server.";
+      disconnect();
+      return;
+    }
+    const size_t packet_size = RemoteLcdCodec::getPacketSize(data, size);
+    if (packet_size == 0u) break;
+    packets->emplace_back(data, packet_size);
+    begin += packet_size;
+  }
+  received_.erase(0u, begin);
+}
+
+bool RemoteLcdClient::connect() {
+  if (socket_fd_ < 0) {
+    const auto now = std::chrono::steady_clock::now();
+    if (last_connect_attempt_ != std::chrono::steady_clock::time_point() &&
+        now - last_connect_attempt_ < kReconnectPeriod) {
+      return false;
+    }
+    last_connect_attempt_ = now;
+
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* address = nullptr;
+    const int error = getaddrinfo(
+        host_.c_str(), std::to_string(port_).c_str(), &hints, &address);
+    if (error != 0 || !address) {
+      LOG(WARNING) << "Cannot resolve the remote LCD server " << host_ << ": "
+                   << gai_strerror(error);
+      return false;
+    }
+
+    socket_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK_GE(socket_fd_, 0) << "Cannot create the remote LCD socket: "
+                            << std::strerror(errno);
+    setNonBlocking(socket_fd_);
+    const int enable = 1;
+    setsockopt(socket_fd_, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+#ifdef SO_NOSIGPIPE
+    setsockopt(socket_fd_, SOL_SOCKET, SO_NOSIGPIPE, &enable, sizeof(enable));
+#endif
+    const int result =
+        ::connect(socket_fd_, address->ai_addr, address->ai_addrlen);
+    freeaddrinfo(address);
+    if (result != 0 && errno != EINPROGRESS) {
+      LOG(WARNING) << "Cannot connect to the remote LCD server " << host_
+                   << ":" << port_ << ": " << std::strerror(errno);
+      disconnect();
+      return false;
+    }
+    connecting_ = result != 0;
+  }
+
+  if (connecting_) {
+    pollfd poll_fd;
+    poll_fd.fd = socket_fd_;
+    poll_fd.events = POLLOUT;
+    poll_fd.revents = 0;
+    if (poll(&poll_fd, 1, 0) <= 0) return false;
+    int error = 0;
+    socklen_t error_size = sizeof(error);
+    getsockopt(socket_fd_, SOL_SOCKET, SO_ERROR, &error, &error_size);
+    if (error != 0) {
+      LOG(WARNING) << "Cannot connect to the remote LCD server " << host_
+                   << ":" << port_ << ": " << std::strerror(error);
+      disconnect();
+      return false;
+    }
+    connecting_ = false;
+    LOG(INFO) << "Connected to the remote LCD server " << host_ << ":"
+              << port_ << ".";
+  }
+  return true;
+}
+
+void RemoteLcdClient::disconnect() {
+  if (socket_fd_ >= 0) close(socket_fd_);
+  socket_fd_ = -1;
+  connecting_ = false;
+  // The server drops what it received of the packet partly sent.
+  front_offset_ = 0u;
+  received_.clear();
+}
+
+bool RemoteLcdClient::sendPending() {
+  while (!pending_packets_.empty()) {
+    const std::string& packet = pending_packets_.front();
+    const ssize_t size = ::send(socket_fd_,
+                                packet.data() + front_offset_,
+                                packet.size() - front_offset_,
+                                kSendFlags);
+    if (size < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+      LOG(WARNING) << "Remote LCD server disconnected: "
+                   << std::strerror(errno);
+      return false;
+    }
+    front_offset_ += static_cast<size_t>(size);
+    if (front_offset_ == packet.size()) {
+      pending_bytes_ -= packet.size();
+      pending_packets_.pop_front();
+      front_offset_ = 0u;
+    }
+  }
+  return true;
+}
+
+}  // namespace VIO
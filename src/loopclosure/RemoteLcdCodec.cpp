@@ -0,0 +1,461 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   RemoteLcdCodec.cpp
+ * @brief  Binary encoding of the keyframes streamed by the robots to a
+ * RemoteLcdServer, and of the corrections it sends back.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/loopclosure/RemoteLcdCodec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+#include <glog/logging.h>
+
+#include "kimera-vio/loopclosure/OrbHammingMatcher.h"
+
+namespace VIO {
+
+namespace {
+
+/* -------------------------------------------------------------------------- */
+// Writers.
+template <typename UInt>
+void writeUInt(const UInt& value, std::string* out) {
+  for (size_t i = 0u; i < sizeof(UInt); ++i) {
+    out->push_back(static_cast<char>((value >> (8u * i)) & 0xffu));
+  }
+}
+
+void writeDouble(const double& value, std::string* out) {
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  writeUInt(bits, out);
+}
+
+void writeVarint(uint64_t value, std::string* out) {
+  while (value >= 0x80u) {
+    out->push_back(static_cast<char>((value & 0x7fu) | 0x80u));
+    value >>= 7u;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+void writeBool(const bool& value, std::string* out) {
+  writeUInt(static_cast<uint8_t>(value ? 1u : 0u), out);
+}
+
+void writePose(const gtsam::Pose3& pose, std::string* out) {
+  const gtsam::Point3& translation = pose.translation();
+  writeDouble(translation.x(), out);
+  writeDouble(translation.y(), out);
+  writeDouble(translation.z(), out);
+  const gtsam::Quaternion quaternion = pose.rotation().toQuaternion();
+  writeDouble(quaternion.w(), out);
+  writeDouble(quaternion.x(), out);
+  writeDouble(quaternion.y(), out);
+  writeDouble(quaternion.z(), out);
+}
+
+// Reserves the header, and writes the payload size in it once done.
+class PacketWriter {
+ public:
+  PacketWriter(const RemoteLcdPacketType& type, std::string* packet)
+      : packet_(CHECK_NOTNULL(packet)), header_begin_(packet->size()) {
+    writeUInt(kRemoteLcdMagic, packet_);
+    writeUInt(kRemoteLcdVersion, packet_);
+    writeUInt(static_cast<uint8_t>(type), packet_);
+    writeUInt(uint32_t(0u), packet_);
+  }
+
+  ~PacketWriter() {
+    const size_t payload_size =
+        packet_->size() - header_begin_ - kRemoteLcdHeaderSize;
+    CHECK_LE(payload_size, kRemoteLcdMaxPayloadSize);
+    for (size_t i = 0u; i < 4u; ++i) {
+      (*packet_)[header_begin_ + 4u + i] =
+          static_cast<char>((payload_size >> (8u * i)) & 0xffu);
+    }
+  }
+
+  inline std::string* payload() { return packet_; }
+
+ private:
+  std::string* packet_;
+  const size_t header_begin_;
+};
+
+/* -------------------------------------------------------------------------- */
+// Reader of a payload: reading past its end fails, and all further reads too.
+class PayloadReader {
+ public:
+  PayloadReader(const char* data, const size_t& size)
+      : data_(data), end_(data + size) {}
+
+  template <typename UInt>
+  bool readUInt(UInt* value) {
+    if (!ok_ || static_cast<size_t>(end_ - data_) < sizeof(UInt)) {
+      return fail();
+    }
+    *value = 0u;
+    for (size_t i = 0u; i < sizeof(UInt); ++i) {
+      *value |= static_cast<UInt>(static_cast<uint8_t>(*data_++)) << (8u * i);
+    }
+    return true;
+  }
+
+  bool readInt64(int64_t* value) {
+    uint64_t bits;
+    if (!readUInt(&bits)) return false;
+    *value = static_cast<int64_t>(bits);
+    return true;
+  }
+
+  bool readDouble(double* value) {
+    uint64_t bits;
+    if (!readUInt(&bits)) return false;
+    std::memcpy(value, &bits, sizeof(bits));
+    return true;
+  }
+
+  bool readBool(bool* value) {
+    uint8_t byte;
+    if (!readUInt(&byte)) return false;
+    if (byte > 1u) return fail();
+    *value = byte == 1u;
+    return true;
+  }
+
+  bool readVarint(uint64_t* value) {
+    *value = 0u;
+    for (size_t shift = 0u; shift < 64u; shift += 7u) {
+      if (!ok_ || data_ == end_) return fail();
+      const uint8_t byte = static_cast<uint8_t>(*data_++);
+      *value |= static_cast<uint64_t>(byte & 0x7fu) << shift;
+      if ((byte & 0x80u) == 0u) return true;
+    }
+    return fail();
+  }
+
+  //! Varint of a count of items of at least min_item_size bytes each, which
+  //! must fit in what is left of the payload.
+  bool readCount(const size_t& min_item_size, size_t* count) {
+    uint64_t value;
+    if (!readVarint(&value)) return false;
+    if (value > static_cast<uint64_t>(end_ - data_) / min_item_size) {
+      return fail();
+    }
+    *count = static_cast<size_t>(value);
+    return true;
+  }
+
+  bool readString(std::string* value) {
+    size_t size;
+    if (!readCount(1u, &size)) return false;
+    value->assign(data_, size);
+    data_ += size;
+    return true;
+  }
+
+  bool readPose(gtsam::Pose3* pose) {
+    double t[3];
+    double q[4];
+    for (double& value : t) {
+      if (!readDouble(&value)) return false;
+    }
+    for (double& value : q) {
+      if (!readDouble(&value)) return false;
+    }
+    const double norm =
+        std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    if (!(std::fabs(norm - 1.0) < 1e-6)) return fail();
+    *pose = gtsam::Pose3(gtsam::Rot3::Quaternion(q[0], q[1], q[2], q[3]),
+                         gtsam::Point3(t[0], t[1], t[2]));
+    return true;
+  }
+
+  inline bool atEnd() const { return ok_ && data_ == end_; }
+
+ private:
+  bool fail() {
+    ok_ = false;
+    return false;
+  }
+
+  const char* data_;
+  const char* end_;
+  bool ok_ = true;
+};
+
+constexpr size_t kPoseSize = 7u * sizeof(double);
+
+/* -------------------------------------------------------------------------- */
+// Checks the header of a complete packet of the given type, and returns the
+// reader of its payload.
+bool readHeader(const char* data,
+                const size_t& size,
+                const RemoteLcdPacketType& expected_type,
+                PayloadReader* payload_reader) {
+  CHECK_NOTNULL(data);
+  PayloadReader header_reader(data, std::min(size, kRemoteLcdHeaderSize));
+  uint16_t magic = 0u;
+  uint8_t version = 0u;
+  uint8_t packet_type = 0u;
+  uint32_t payload_size = 0u;
+  if (!header_reader.readUInt(&magic) || !header_reader.readUInt(&version) ||
+      !header_reader.readUInt(&packet_type) ||
+      !header_reader.readUInt(&payload_size)) {
+    LOG(WARNING) << "Remote LCD packet too short: " << size << " bytes.";
+    return false;
+  }
+  if (magic != kRemoteLcdMagic || version != kRemoteLcdVersion) {
+    LOG(WARNING) << "Unsupported remote LCD packet, magic: " << magic
+                 << ", version: " << static_cast<int>(version) << ".";
+    return false;
+  }
+  if (packet_type != static_cast<uint8_t>(expected_type)) {
+    LOG(WARNING) << "Unexpected remote LCD packet type: "
+                 << static_cast<int>(packet_type) << ".";
+    return false;
+  }
+  if (size != kRemoteLcdHeaderSize + payload_size) {
+    LOG(WARNING) << "Remote LCD packet of " << size << " bytes, expected "
+                 << kRemoteLcdHeaderSize + payload_size << ".";
+    return false;
+  }
+  *payload_reader = PayloadReader(data + kRemoteLcdHeaderSize, payload_size);
+  return true;
+}
+
+//! The server indexes the features of a frame with the rows of its ORB
+//! descriptors: a frame from the network must have as many of each (no 3D
+//! keypoints for the 5-point method of the mono LCD).
+bool isConsistent(const LCDFrame& frame) {
+  const size_t nr_features = frame.keypoints_.size();
+  const cv::Mat& descriptors = frame.descriptors_mat_;
+  if ((!frame.keypoints_3d_.empty() &&
+       frame.keypoints_3d_.size() != nr_features) ||
+      frame.bearing_vectors_.size() != nr_features) {
+    return false;
+  }
+  if (!descriptors.empty() &&
+      (descriptors.type() != CV_8UC1 || descriptors.dims != 2 ||
+       descriptors.cols != kOrbDescriptorBytes ||
+       static_cast<size_t>(descriptors.rows) != nr_features)) {
+    return false;
+  }
+  const auto* stereo_frame = dynamic_cast<const StereoLCDFrame*>(&frame);
+  return !stereo_frame ||
+         (stereo_frame->left_keypoints_rectified_.size() == nr_features &&
+          stereo_frame->right_keypoints_rectified_.size() == nr_features);
+}
+
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+void RemoteLcdCodec::encodeKeyframe(const RemoteKeyframe& keyframe,
+                                    std::string* packet) {
+  CHECK_NOTNULL(packet);
+  CHECK(keyframe.frame_);
+  PacketWriter writer(RemoteLcdPacketType::kKeyframe, packet);
+  std::string* out = writer.payload();
+  writeUInt(keyframe.robot_id_, out);
+  writeUInt(static_cast<uint64_t>(keyframe.kf_id_), out);
+  writeUInt(static_cast<uint64_t>(keyframe.timestamp_), out);
+  writePose(keyframe.W_Pose_Blkf_, out);
+
+  std::ostringstream frame_stream;
+  keyframe.frame_->save(frame_stream);
+  const std::string frame_bytes = frame_stream.str();
+  writeVarint(frame_bytes.size(), out);
+  out->append(frame_bytes);
+
+  writeVarint(keyframe.bow_vec_.size(), out);
+  for (const auto& word : keyframe.bow_vec_) {
+    writeUInt(static_cast<uint32_t>(word.first), out);
+    writeDouble(word.second, out);
+  }
+}
+
+void RemoteLcdCodec::encodeCorrection(const RemoteLcdCorrection& correction,
+                                      std::string* packet) {
+  CHECK_NOTNULL(packet);
+  PacketWriter writer(RemoteLcdPacketType::kCorrection, packet);
+  std::string* out = writer.payload();
+  writeUInt(correction.robot_id_, out);
+  writeUInt(static_cast<uint64_t>(correction.kf_id_), out);
+  writeUInt(static_cast<uint64_t>(correction.timestamp_), out);
+
+  writeBool(correction.is_loop_closure_, out);
+  writeUInt(static_cast<uint64_t>(correction.id_match_), out);
+  writeUInt(static_cast<uint64_t>(correction.id_recent_), out);
+  writeUInt(static_cast<uint64_t>(correction.timestamp_match_), out);
+  writeUInt(static_cast<uint64_t>(correction.timestamp_query_), out);
+  writePose(correction.relative_pose_, out);
+
+  writePose(correction.W_Pose_Map_, out);
+  writePose(correction.Map_Pose_Odom_, out);
+  writeBool(correction.is_trajectory_corrected_, out);
+
+  writeVarint(correction.states_.size(), out);
+  for (const auto& state : correction.states_) {
+    const auto timestamp = correction.timestamp_map_.find(state.first);
+    CHECK(timestamp != correction.timestamp_map_.end())
+        << "Missing timestamp of keyframe " << state.first;
+    writeUInt(static_cast<uint64_t>(state.first), out);
+    writeUInt(static_cast<uint64_t>(timestamp->second), out);
+    writePose(state.second, out);
+  }
+
+  writeBool(correction.Shared_Pose_Map_.has_value(), out);
+  if (correction.Shared_Pose_Map_) {
+    writePose(*correction.Shared_Pose_Map_, out);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+bool RemoteLcdCodec::isHeaderValid(const char* data, const size_t& size) {
+  if (size < kRemoteLcdHeaderSize) return true;
+  PayloadReader reader(data, kRemoteLcdHeaderSize);
+  uint16_t magic = 0u;
+  uint8_t version = 0u;
+  uint8_t packet_type = 0u;
+  uint32_t payload_size = 0u;
+  reader.readUInt(&magic);
+  reader.readUInt(&version);
+  reader.readUInt(&packet_type);
+  reader.readUInt(&payload_size);
+  return magic == kRemoteLcdMagic && version == kRemoteLcdVersion &&
+         payload_size <= kRemoteLcdMaxPayloadSize;
+}
+
+size_t RemoteLcdCodec::getPacketSize(const char* data, const size_t& size) {
+  if (size < kRemoteLcdHeaderSize) return 0u;
+  PayloadReader reader(data + 4u, 4u);
+  uint32_t payload_size = 0u;
+  reader.readUInt(&payload_size);
+  const size_t packet_size = kRemoteLcdHeaderSize + payload_size;
+  return size < packet_size ? 0u : packet_size;
+}
+
+/* -------------------------------------------------------------------------- */
+bool RemoteLcdCodec::decodeKeyframe(const char* data,
+                                    const size_t& size,
+                                    RemoteKeyframe* keyframe) {
+  CHECK_NOTNULL(keyframe);
+  PayloadReader reader(nullptr, 0u);
+  if (!readHeader(data, size, RemoteLcdPacketType::kKeyframe, &reader)) {
+    return false;
+  }
+
+  uint64_t kf_id = 0u;
+  int64_t timestamp = 0;
+  std::string frame_bytes;
+  bool success = reader.readUInt(&keyframe->robot_id_) &&
+                 reader.readUInt(&kf_id) && reader.readInt64(&timestamp) &&
+                 reader.readPose(&keyframe->W_Pose_Blkf_) &&
+                 reader.readString(&frame_bytes);
+  keyframe->kf_id_ = static_cast<FrameId>(kf_id);
+  keyframe->timestamp_ = static_cast<Timestamp>(timestamp);
+
+  static constexpr size_t kWordSize = sizeof(uint32_t) + sizeof(double);
+  size_t nr_words = 0u;
+  success = success && reader.readCount(kWordSize, &nr_words);
+  keyframe->bow_vec_.clear();
+  for (size_t i = 0u; success && i < nr_words; ++i) {
+    uint32_t word_id = 0u;
+    double weight = 0.0;
+    success = reader.readUInt(&word_id) && reader.readDouble(&weight);
+    if (success) keyframe->bow_vec_[word_id] = weight;
+  }
+  success = success && reader.atEnd();
+
+  keyframe->frame_.reset();
+  if (success) {
+    std::istringstream frame_stream(frame_bytes);
+    keyframe->frame_ = LCDFrame::load(frame_stream, frame_bytes.size());
+    success = keyframe->frame_ &&
+              frame_stream.peek() == std::char_traits<char>::eof() &&
+              isConsistent(*keyframe->frame_) &&
+              keyframe->frame_->timestamp_ == keyframe->timestamp_;
+    if (!success) keyframe->frame_.reset();
+  }
+  LOG_IF(WARNING, !success) << "Malformed remote LCD keyframe packet.";
+  return success;
+}
+
+bool RemoteLcdCodec::decodeCorrection(const char* data,
+                                      const size_t& size,
+                                      RemoteLcdCorrection* correction) {
+  CHECK_NOTNULL(correction);
+  PayloadReader reader(nullptr, 0u);
+  if (!readHeader(data, size, RemoteLcdPacketType::kCorrection, &reader)) {
+    return false;
+  }
+
+  uint64_t kf_id = 0u;
+  uint64_t id_match = 0u;
+  uint64_t id_recent = 0u;
+  int64_t timestamp = 0;
+  int64_t timestamp_match = 0;
+  int64_t timestamp_query = 0;
+  bool success =
+      reader.readUInt(&correction->robot_id_) && reader.readUInt(&kf_id) &&
+      reader.readInt64(&timestamp) &&
+      reader.readBool(&correction->is_loop_closure_) &&
+      reader.readUInt(&id_match) && reader.readUInt(&id_recent) &&
+      reader.readInt64(&timestamp_match) &&
+      reader.readInt64(&timestamp_query) &&
+      reader.readPose(&correction->relative_pose_) &&
+      reader.readPose(&correction->W_Pose_Map_) &&
+      reader.readPose(&correction->Map_Pose_Odom_) &&
+      reader.readBool(&correction->is_trajectory_corrected_);
+  correction->kf_id_ = static_cast<FrameId>(kf_id);
+  correction->timestamp_ = static_cast<Timestamp>(timestamp);
+  correction->id_match_ = static_cast<FrameId>(id_match);
+  correction->id_recent_ = static_cast<FrameId>(id_recent);
+  correction->timestamp_match_ = static_cast<Timestamp>(timestamp_match);
+  correction->timestamp_query_ = static_cast<Timestamp>(timestamp_query);
+
+  static constexpr size_t kStateSize = 2u * sizeof(uint64_t) + kPoseSize;
+  size_t nr_states = 0u;
+  success = success && reader.readCount(kStateSize, &nr_states);
+  correction->states_.clear();
+  correction->timestamp_map_.clear();
+  for (size_t i = 0u; success && i < nr_states; ++i) {
+    uint64_t state_id = 0u;
+    int64_t state_timestamp = 0;
+    gtsam::Pose3 pose;
+    success = reader.readUInt(&state_id) &&
+              reader.readInt64(&state_timestamp) && reader.readPose(&pose);
+    if (success) {
+      correction->states_[static_cast<FrameId>(state_id)] = pose;
+      correction->timestamp_map_[static_cast<FrameId>(state_id)] =
+          static_cast<Timestamp>(state_timestamp);
+    }
+  }
+
+  bool has_shared_pose_map = false;
+  success = success && reader.readBool(&has_shared_pose_map);
+  correction->Shared_Pose_Map_.reset();
+  if (success && has_shared_pose_map) {
+    gtsam::Pose3 shared_pose_map;
+    success = reader.readPose(&shared_pose_map);
+    correction->Shared_Pose_Map_ = shared_pose_map;
+  }
+  success = success && reader.atEnd();
+  LOG_IF(WARNING, !success) << "Malformed remote LCD correction packet.";
+  return success;
+}
+
+}  // namespace VIO
@@ -0,0 +1,241 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   RemoteLcdServer.cpp
+ * @brief  Server running the LCD and PGO of the robots streaming their
+ * keyframes to it.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/loopclosure/RemoteLcdServer.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "kimera-vio/loopclosure/RemoteLcdCodec.h"
+#include "kimera-vio/utils/Timer.h"
+
+namespace VIO {
+
+namespace {
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+// SO_NOSIGPIPE is set on the sockets instead.
+constexpr int kSendFlags = 0;
+#endif
+
+void setNonBlocking(const int& fd) {
+  const int flags = fcntl(fd, F_GETFL, 0);
+  CHECK_GE(flags, 0) << std::strerror(errno);
+  CHECK_GE(fcntl(fd, F_SETFL, flags | O_NONBLOCK), 0) << std::strerror(errno);
+}
+}  // namespace
+
+RemoteLcdServer::RemoteLcdServer(MultiRobotLcd::UniquePtr multi_robot_lcd,
+                                 const int& port,
+                                 const size_t& max_pending_bytes,
+                                 const std::string& bind_address)
+    : multi_robot_lcd_(std::move(multi_robot_lcd)),
+      max_pending_bytes_(max_pending_bytes),
+      server_fd_(-1),
+      port_(port),
+      connections_(),
+      shutdown_(false),
+      keyframe_stats_("Remote LCD server keyframe [ms]") {
+  CHECK(multi_robot_lcd_);
+  CHECK_GE(port_, 0);
+  server_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  CHECK_GE(server_fd_, 0) << "Cannot create the remote LCD socket: "
+                          << std::strerror(errno);
+  const int enable = 1;
+  setsockopt(server_fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+  sockaddr_in address;
+  std::memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  CHECK_EQ(inet_pton(AF_INET, bind_address.c_str(), &address.sin_addr), 1)
+      << "Invalid IPv4 address to bind the remote LCD server to: "
+      << bind_address;
+  address.sin_port = htons(static_cast<uint16_t>(port_));
+  CHECK_EQ(bind(server_fd_,
+                reinterpret_cast<const sockaddr*>(&address),
+                sizeof(address)),
+           0)
+      << "Cannot bind the remote LCD socket to " << bind_address << ":"
+      << port_ << ": " << std::strerror(errno);
+  CHECK_EQ(listen(server_fd_, 16), 0) << std::strerror(errno);
+  setNonBlocking(server_fd_);
+
+  socklen_t address_size = sizeof(address);
+  CHECK_EQ(getsockname(server_fd_,
+                       reinterpret_cast<sockaddr*>(&address),
+                       &address_size),
+           0);
+  port_ = ntohs(address.sin_port);
+  LOG(INFO) << "Remote LCD server listening on " << bind_address << ":"
+            << port_ << ".";
+}
+
+RemoteLcdServer::~RemoteLcdServer() {
+  for (const Connection& connection : connections_) {
+    close(connection.socket_fd_);
+  }
+  if (server_fd_ >= 0) close(server_fd_);
+}
+
+void RemoteLcdServer::spin() {
+  static constexpr int kSpinTimeoutMs = 100;
+  while (!shutdown_) spinOnce(kSpinTimeoutMs);
+}
+
+void RemoteLcdServer::spinOnce(const int& timeout_ms) {
+  std::vector<pollfd> poll_fds;
+  poll_fds.reserve(connections_.size() + 1u);
+  poll_fds.push_back({server_fd_, POLLIN, 0});
+  for (const Connection& connection : connections_) {
+    const short events = static_cast<short>(
+        POLLIN | (connection.pending_.empty() ? 0 : POLLOUT));
+    poll_fds.push_back({connection.socket_fd_, events, 0});
+  }
+  if (poll(poll_fds.data(), poll_fds.size(), timeout_ms) < 0) {
+    LOG_IF(WARNING, errno != EINTR)
+        << "Cannot poll the remote LCD sockets: " << std::strerror(errno);
+    return;
+  }
+
+  // Each connection is polled: the ones accepted now are read at the next
+  // spin.
+  size_t i = 1u;
+  for (auto it = connections_.begin(); it != connections_.end(); ++i) {
+    const short revents = poll_fds[i].revents;
+    bool is_open = true;
+    if (revents & (POLLIN | POLLERR | POLLHUP)) is_open = receive(&*it);
+    if (is_open) is_open = sendPending(&*it);
+    if (is_open) {
+      ++it;
+    } else {
+      close(it->socket_fd_);
+      it = connections_.erase(it);
+    }
+  }
+  if (poll_fds[0].revents & POLLIN) acceptConnections();
+}
+
+void RemoteLcdServer::acceptConnections() {
+  while (true) {
+    const int socket_fd = accept(server_fd_, nullptr, nullptr);
+    if (socket_fd < 0) {
+      LOG_IF(WARNING, errno != EAGAIN && errno != EWOULDBLOCK)
+          << "Cannot accept remote LCD connection: " << std::strerror(errno);
+      return;
+    }
+    setNonBlocking(socket_fd);
+    const int enable = 1;
+    setsockopt(socket_fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+#ifdef SO_NOSIGPIPE
+    setsockopt(socket_fd, SOL_SOCKET, SO_NOSIGPIPE, &enable, sizeof(enable));
+#endif
+    LOG(INFO) << "New remote LCD connection.";
+    connections_.push_back({socket_fd, std::string(), std::string()});
+  }
+}
+
+bool RemoteLcdServer::receive(Connection* connection) {
+  CHECK_NOTNULL(connection);
+  char buffer[65536];
+  bool is_open = true;
+  while (true) {
+    const ssize_t size =
+        recv(connection->socket_fd_, buffer, sizeof(buffer), 0);
+    if (size > 0) {
+      connection->received_.append(buffer, static_cast<size_t>(size));
+      continue;
+    }
+    if (size < 0 && errno == EINTR) continue;
+    if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+    LOG(INFO) << "Remote LCD connection closed"
+              << (size < 0 ? std::string(": ") + std::strerror(errno)
+                           : std::string("."));
+    // Still processes the complete keyframes received.
+    is_open = false;
+    break;
+  }
+
+  size_t begin = 0u;
+  while (true) {
+    const char* data = connection->received_.data() + begin;
+    const size_t size = connection->received_.size() - begin;
+    if (!RemoteLcdCodec::isHeaderValid(data, size)) {
+      LOG(WARNING) << "Invalid stream from a remote LCD connection.";
+      return false;
+    }
+    const size_t packet_size = RemoteLcdCodec::getPacketSize(data, size);
+    if (packet_size == 0u) break;
+    begin += packet_size;
+
+    RemoteKeyframe keyframe;
+    if (!RemoteLcdCodec::decodeKeyframe(data, packet_size, &keyframe)) {
+      continue;
+    }
+    const auto start = utils::Timer::tic();
+    const std::unique_ptr<RemoteLcdCorrection> correction =
+        multi_robot_lcd_->addKeyframe(keyframe);
+    keyframe_stats_.AddSample(
+        static_cast<double>(
+            utils::Timer::toc<std::chrono::microseconds>(start).count()) /
+        1e3);
+    if (correction) {
+      RemoteLcdCodec::encodeCorrection(*correction, &connection->pending_);
+    }
+  }
+  connection->received_.erase(0u, begin);
+  return is_open;
+}
+
+bool RemoteLcdServer::sendPending(Connection* connection) const {
+  CHECK_NOTNULL(connection);
+  size_t sent_size = 0u;
+  while (sent_size < connection->pending_.size()) {
+    const ssize_t size = send(connection->socket_fd_,
+                              connection->pending_.data() + sent_size,
+                              connection->pending_.size() - sent_size,
+                              kSendFlags);
+    if (size < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+      LOG(INFO) << "Remote LCD connection closed: " << std::strerror(errno);
+      return false;
+    }
+    sent_size += static_cast<size_t>(size);
+  }
+  connection->pending_.erase(0u, sent_size);
+  if (connection->pending_.size() > max_pending_bytes_) {
+    LOG(WARNING) << "Remote LCD connection lagging behind by "
+                 << connection->pending_.size() << " bytes, closing it.";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace VIO
@@ -0,0 +1,165 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   RemoteLoopClosureDetector.cpp
+ * @brief  Robot side of the LCD and PGO offloaded to a RemoteLcdServer.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/loopclosure/RemoteLoopClosureDetector.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <DBoW2/DBoW2.h>
+#include <glog/logging.h>
+#include <gtsam/inference/Symbol.h>
+
+namespace VIO {
+
+RemoteLoopClosureDetector::RemoteLoopClosureDetector(
+    const LoopClosureDetectorParams& lcd_params,
+    const CameraParams& tracker_cam_params,
+    const gtsam::Pose3& B_Pose_Cam,
+    const std::optional<VIO::StereoCamera::ConstPtr>& stereo_camera,
+    const std::optional<StereoMatchingParams>& stereo_matching_params,
+    const std::optional<VIO::RgbdCamera::ConstPtr>& rgbd_camera,
+    bool log_output,
+    PreloadedVocab::Ptr&& preloaded_vocab)
+    : LoopClosureDetector(lcd_params,
+                          tracker_cam_params,
+                          B_Pose_Cam,
+                          stereo_camera,
+                          stereo_matching_params,
+                          rgbd_camera,
+                          log_output,
+                          std::move(preloaded_vocab)),
+      robot_id_(static_cast<RobotId>(lcd_params.robot_id_)),
+      client_(lcd_params.remote_server_host_,
+              lcd_params.remote_server_port_,
+              static_cast<size_t>(lcd_params.remote_max_pending_bytes_)),
+      cur_kf_id_(0u),
+      cur_frame_(nullptr),
+      W_Pose_Map_(),
+      Map_Pose_Odom_(),
+      Shared_Pose_Map_(std::nullopt),
+      uncorrected_kfs_(),
+      keyframe_bytes_stats_("Remote LCD keyframe [B]") {
+  LOG(INFO) << "Loop closures of robot " << robot_id_ << " offloaded to "
+            << lcd_params.remote_server_host_ << ":"
+            << lcd_params.remote_server_port_ << ".";
+}
+
+/* ------------------------------------------------------------------------ */
+LcdOutput::UniquePtr RemoteLoopClosureDetector::spinOnce(
+    const LcdInput& input) {
+  CHECK_GE(input.cur_kf_id_, 0);
+  cur_kf_id_ = input.cur_kf_id_;
+
+  // Send the keyframe.
+  RemoteKeyframe keyframe;
+  keyframe.robot_id_ = robot_id_;
+  keyframe.kf_id_ = input.cur_kf_id_;
+  keyframe.timestamp_ = input.timestamp_;
+  keyframe.W_Pose_Blkf_ = input.W_Pose_Blkf_;
+  processAndAddFrame(input);
+  CHECK(cur_frame_) << "No frame stored for keyframe " << cur_kf_id_;
+  keyframe.frame_ = std::move(cur_frame_);
+  DBoW2::BowVector bow_vec;
+  computeBowVector(*keyframe.frame_, &bow_vec);
+  keyframe.bow_vec_.insert(bow_vec.begin(), bow_vec.end());
+
+  std::string packet;
+  RemoteLcdCodec::encodeKeyframe(keyframe, &packet);
+  keyframe_bytes_stats_.AddSample(static_cast<double>(packet.size()));
+  if (client_.send(std::move(packet))) {
+    uncorrected_kfs_[input.cur_kf_id_] =
+        std::make_pair(input.timestamp_, input.W_Pose_Blkf_);
+  }
+
+  // Apply the corrections received since the previous keyframe.
+  std::vector<std::string> packets;
+  client_.receive(&packets);
+  std::map<FrameId, gtsam::Pose3> states;
+  FrameIDTimestampMap timestamp_map;
+  bool is_trajectory_corrected = false;
+  std::optional<RemoteLcdCorrection> loop_correction;
+  for (const std::string& correction_packet : packets) {
+    RemoteLcdCorrection correction;
+    if (!RemoteLcdCodec::decodeCorrection(
+            correction_packet.data(), correction_packet.size(), &correction)) {
+      continue;
+    }
+    if (correction.robot_id_ != robot_id_) {
+      LOG(WARNING) << "Ignoring the correction of robot "
+                   << correction.robot_id_ << ".";
+      continue;
+    }
+    W_Pose_Map_ = correction.W_Pose_Map_;
+    Map_Pose_Odom_ = correction.Map_Pose_Odom_;
+    Shared_Pose_Map_ = correction.Shared_Pose_Map_;
+    is_trajectory_corrected =
+        is_trajectory_corrected || correction.is_trajectory_corrected_;
+    for (const auto& state : correction.states_) {
+      states[state.first] = state.second;
+      timestamp_map[state.first] = correction.timestamp_map_.at(state.first);
+    }
+    uncorrected_kfs_.erase(uncorrected_kfs_.begin(),
+                           uncorrected_kfs_.upper_bound(correction.kf_id_));
+    if (correction.is_loop_closure_) loop_correction = correction;
+  }
+
+  // Predict the keyframes the server did not correct yet: all of them if
+  // Map_Pose_Odom changed, else only the new one.
+  for (const auto& kf : uncorrected_kfs_) {
+    if (!is_trajectory_corrected && kf.first != input.cur_kf_id_) continue;
+    states[kf.first] = Map_Pose_Odom_.compose(kf.second.second);
+    timestamp_map[kf.first] = kf.second.first;
+  }
+  if (states.count(input.cur_kf_id_) == 0u) {
+    // Dropped, or already corrected.
+    states[input.cur_kf_id_] = Map_Pose_Odom_.compose(input.W_Pose_Blkf_);
+    timestamp_map[input.cur_kf_id_] = input.timestamp_;
+  }
+  gtsam::Values pgo_states;
+  for (const auto& state : states) {
+    pgo_states.insert(gtsam::Symbol(state.first), state.second);
+  }
+
+  LcdOutput::UniquePtr output_payload = nullptr;
+  if (loop_correction) {
+    output_payload =
+        std::make_unique<LcdOutput>(true,
+                                    input.timestamp_,
+                                    loop_correction->timestamp_query_,
+                                    loop_correction->timestamp_match_,
+                                    loop_correction->id_match_,
+                                    loop_correction->id_recent_,
+                                    loop_correction->relative_pose_);
+  } else {
+    output_payload = std::make_unique<LcdOutput>(input.timestamp_);
+  }
+  output_payload->setMapInformation(
+      W_Pose_Map_, Map_Pose_Odom_, pgo_states, gtsam::NonlinearFactorGraph());
+  output_payload->is_trajectory_corrected_ = is_trajectory_corrected;
+  output_payload->timestamp_map_ = timestamp_map;
+  output_payload->Shared_Pose_Map_ = Shared_Pose_Map_;
+  return output_payload;
+}
+
+/* ------------------------------------------------------------------------ */
+FrameId RemoteLoopClosureDetector::storeFrame(const LCDFrame::Ptr& frame) {
+  CHECK(frame);
+  frame->id_ = cur_kf_id_;
+  cur_frame_ = frame;
+  return cur_kf_id_;
+}
+
+}  // namespace VIO
@@ -0,0 +1,642 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   IncrementalDelaunay.cpp
+ * @brief  2D Delaunay triangulation updated incrementally (insertions,
+ * removals and moves of vertices), to mesh the keypoints tracked across
+ * frames without triangulating from scratch.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/mesh/IncrementalDelaunay.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+namespace {
+inline int next(const int& i) { return i == 2 ? 0 : i + 1; }
+inline int prev(const int& i) { return i == 0 ? 2 : i - 1; }
+}  // namespace
+
+IncrementalDelaunay::IncrementalDelaunay(const cv::Size& img_size)
+    : rect_(0.0, 0.0, img_size.width, img_size.height),
+      vertices_(),
+      triangles_(),
+      free_vertices_(),
+      free_triangles_(),
+      id_to_vertex_(),
+      last_triangle_(kInvalid) {
+  CHECK_GT(img_size.width, 0);
+  CHECK_GT(img_size.height, 0);
+  initOuterVertices();
+}
+
+void IncrementalDelaunay::initOuterVertices() {
+  // Same outer triangle as cv::Subdiv2D::initDelaunay, counterclockwise.
+  const double big_coord = 3.0 * std::max(rect_.width, rect_.height);
+  const Index a =
+      newVertex(cv::Point2d(rect_.x + big_coord, rect_.y), kInvalid);
+  const Index b =
+      newVertex(cv::Point2d(rect_.x, rect_.y + big_coord), kInvalid);
+  const Index c = newVertex(
+      cv::Point2d(rect_.x - big_coord, rect_.y - big_coord), kInvalid);
+  CHECK(isOuterVertex(a) && isOuterVertex(b) && isOuterVertex(c));
+  last_triangle_ = newTriangle(a, b, c);
+}
+
+void IncrementalDelaunay::clear() {
+  vertices_.clear();
+  triangles_.clear();
+  free_vertices_.clear();
+  free_triangles_.clear();
+  id_to_vertex_.clear();
+  initOuterVertices();
+}
+
+/* -------------------------------------------------------------------------- */
+bool IncrementalDelaunay::insert(const VertexId& id, const cv::Point2f& point) {
+  if (contains(id)) return false;
+  if (!isInside(point)) return false;
+  const Index vertex = newVertex(point, id);
+  if (!insertVertex(vertex, last_triangle_)) {
+    vertices_[vertex].alive = false;
+    free_vertices_.push_back(vertex);
+    return false;
+  }
+  id_to_vertex_[id] = vertex;
+  return true;
+}
+
+bool IncrementalDelaunay::move(const VertexId& id, const cv::Point2f& point) {
+  const auto it = id_to_vertex_.find(id);
+  if (it == id_to_vertex_.end()) return false;
+  const Index vertex = it->second;
+  const cv::Point2d new_point(point);
+  if (vertices_[vertex].point == new_point) return true;
+  if (!isInside(new_point)) {
+    remove(id);
+    return false;
+  }
+
+  // If the vertex stays within its neighbors (all its triangles keep their
+  // orientation), move it and only flip the edges around it.
+  std::vector<Index> star;
+  getStar(vertex, &star);
+  bool is_star_valid = true;
+  for (const Index& triangle : star) {
+    const int i = vertexIdx(triangle, vertex);
+    const auto& tri_vertices = triangles_[triangle].vertices;
+    if (orient(new_point,
+               vertices_[tri_vertices[next(i)]].point,
+               vertices_[tri_vertices[prev(i)]].point) <= 0.0) {
+      is_star_valid = false;
+      break;
+    }
+  }
+  if (is_star_valid) {
+    vertices_[vertex].point = new_point;
+    std::vector<Edge> edges;
+    edges.reserve(3u * star.size());
+    for (const Index& triangle : star) {
+      for (int i = 0; i < 3; ++i) edges.emplace_back(triangle, i);
+    }
+    legalize(&edges);
+    return true;
+  }
+
+  // Else, remove and re-insert it.
+  const Index hint =
+      triangles_[star.front()].neighbors[vertexIdx(star.front(), vertex)];
+  removeVertex(vertex);
+  vertices_[vertex].point = new_point;
+  if (!insertVertex(vertex, hint)) {
+    vertices_[vertex].alive = false;
+    free_vertices_.push_back(vertex);
+    id_to_vertex_.erase(it);
+    return false;
+  }
+  return true;
+}
+
+bool IncrementalDelaunay::remove(const VertexId& id) {
+  const auto it = id_to_vertex_.find(id);
+  if (it == id_to_vertex_.end()) return false;
+  const Index vertex = it->second;
+  removeVertex(vertex);
+  vertices_[vertex].alive = false;
+  free_vertices_.push_back(vertex);
+  id_to_vertex_.erase(it);
+  return true;
+}
+
+size_t IncrementalDelaunay::update(
+    const std::vector<std::pair<VertexId, cv::Point2f>>& vertices) {
+  // Remove first the vertices that are gone, so that moves and insertions
+  // do not flip edges that would be removed anyway.
+  std::vector<char> is_kept(vertices_.size(), 0);
+  for (const auto& id_point : vertices) {
+    const auto it = id_to_vertex_.find(id_point.first);
+    if (it != id_to_vertex_.end()) is_kept[it->second] = 1;
+  }
+  std::vector<VertexId> ids_to_remove;
+  for (const auto& id_vertex : id_to_vertex_) {
+    if (!is_kept[id_vertex.second]) ids_to_remove.push_back(id_vertex.first);
+  }
+  for (const VertexId& id : ids_to_remove) remove(id);
+
+  for (const auto& id_point : vertices) {
+    if (contains(id_point.first)) {
+      move(id_point.first, id_point.second);
+    } else {
+      insert(id_point.first, id_point.second);
+    }
+  }
+  VLOG(10) << "IncrementalDelaunay: removed " << ids_to_remove.size()
+           << " vertices, " << id_to_vertex_.size() << " vertices left.";
+  return id_to_vertex_.size();
+}
+
+std::vector<cv::Vec6f> IncrementalDelaunay::getTriangleList(
+    std::vector<TriangleVertexIds>* vertex_ids) const {
+  std::vector<cv::Vec6f> triangle_list;
+  triangle_list.reserve(2u * id_to_vertex_.size());
+  if (vertex_ids) {
+    vertex_ids->clear();
+    vertex_ids->reserve(2u * id_to_vertex_.size());
+  }
+  for (const Triangle& triangle : triangles_) {
+    if (!triangle.alive) continue;
+    const auto& v = triangle.vertices;
+    if (isOuterVertex(v[0]) || isOuterVertex(v[1]) || isOuterVertex(v[2])) {
+      continue;
+    }
+    const cv::Point2d& p0 = vertices_[v[0]].point;
+    const cv::Point2d& p1 = vertices_[v[1]].point;
+    const cv::Point2d& p2 = vertices_[v[2]].point;
+    triangle_list.emplace_back(p0.x, p0.y, p1.x, p1.y, p2.x, p2.y);
+    if (vertex_ids) {
+      vertex_ids->push_back(
+          {{vertices_[v[0]].id, vertices_[v[1]].id, vertices_[v[2]].id}});
+    }
+  }
+  return triangle_list;
+}
+
+bool IncrementalDelaunay::isValid() const {
+  for (size_t t = 0u; t < triangles_.size(); ++t) {
+    const Triangle& triangle = triangles_[t];
+    if (!triangle.alive) continue;
+    const auto& v = triangle.vertices;
+    if (orient(vertices_[v[0]].point,
+               vertices_[v[1]].point,
+               vertices_[v[2]].point) <= 0.0) {
+      LOG(ERROR) << "Triangle " << t << " is not counterclockwise.";
+      return false;
+    }
+    for (int i = 0; i < 3; ++i) {
+      const Index neighbor = triangle.neighbors[i];
+      if (neighbor == kInvalid) continue;
+      const int j = neighborIdx(neighbor, t);
+      if (j < 0 || !triangles_[neighbor].alive) {
+        LOG(ERROR) << "Triangles " << t << " and " << neighbor
+                   << " are not mutual neighbors.";
+        return false;
+      }
+      const auto& w = triangles_[neighbor].vertices;
+      if (w[next(j)] != v[prev(i)] || w[prev(j)] != v[next(i)]) {
+        LOG(ERROR) << "Triangles " << t << " and " << neighbor
+                   << " do not share their edge.";
+        return false;
+      }
+      const cv::Point2d& q = vertices_[w[j]].point;
+      if (inCircle(vertices_[v[0]].point,
+                   vertices_[v[1]].point,
+                   vertices_[v[2]].point,
+                   q) > 1e-6) {
+        LOG(ERROR) << "Edge of triangles " << t << " and " << neighbor
+                   << " is not Delaunay.";
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+IncrementalDelaunay::Index IncrementalDelaunay::newVertex(
+    const cv::Point2d& point,
+    const VertexId& id) {
+  Index vertex;
+  if (!free_vertices_.empty()) {
+    vertex = free_vertices_.back();
+    free_vertices_.pop_back();
+  } else {
+    vertex = static_cast<Index>(vertices_.size());
+    vertices_.emplace_back();
+  }
+  Vertex& v = vertices_[vertex];
+  v.point = point;
+  v.id = id;
+  v.triangle = kInvalid;
+  v.alive = true;
+  return vertex;
+}
+
+IncrementalDelaunay::Index IncrementalDelaunay::newTriangle(const Index& v0,
+                                                            const Index& v1,
+                                                            const Index& v2) {
+  Index triangle;
+  if (!free_triangles_.empty()) {
+    triangle = free_triangles_.back();
+    free_triangles_.pop_back();
+  } else {
+    triangle = static_cast<Index>(triangles_.size());
+    triangles_.emplace_back();
+  }
+  Triangle& t = triangles_[triangle];
+  t.vertices = {{v0, v1, v2}};
+  t.neighbors = {{kInvalid, kInvalid, kInvalid}};
+  t.alive = true;
+  vertices_[v0].triangle = triangle;
+  vertices_[v1].triangle = triangle;
+  vertices_[v2].triangle = triangle;
+  last_triangle_ = triangle;
+  return triangle;
+}
+
+void IncrementalDelaunay::deleteTriangle(const Index& triangle) {
+  DCHECK(triangles_[triangle].alive);
+  triangles_[triangle].alive = false;
+  free_triangles_.push_back(triangle);
+}
+
+/* -------------------------------------------------------------------------- */
+IncrementalDelaunay::Index IncrementalDelaunay::locate(
+    const cv::Point2d& point,
+    Index hint) const {
+  if (hint == kInvalid || hint >= static_cast<Index>(triangles_.size()) ||
+      !triangles_[hint].alive) {
+    hint = last_triangle_;
+  }
+  CHECK_NE(hint, kInvalid);
+  CHECK(triangles_[hint].alive);
+
+  // Visibility walk, which terminates in Delaunay triangulations. Bounded
+  // anyway, in case of numerical issues.
+  Index triangle = hint;
+  const size_t max_steps = triangles_.size() + 3u;
+  int start = 0;
+  for (size_t step = 0u; step < max_steps; ++step) {
+    const Triangle& t = triangles_[triangle];
+    bool moved = false;
+    for (int k = 0; k < 3; ++k) {
+      const int i = (start + k) % 3;
+      if (orient(vertices_[t.vertices[next(i)]].point,
+                 vertices_[t.vertices[prev(i)]].point,
+                 point) < 0.0) {
+        triangle = t.neighbors[i];
+        // Outside of the outer triangle.
+        if (triangle == kInvalid) return kInvalid;
+        moved = true;
+        break;
+      }
+    }
+    if (!moved) return triangle;
+    start = (start + 1) % 3;
+  }
+
+  LOG(WARNING) << "IncrementalDelaunay: walk did not converge, scanning.";
+  for (size_t t = 0u; t < triangles_.size(); ++t) {
+    if (!triangles_[t].alive) continue;
+    const auto& v = triangles_[t].vertices;
+    if (orient(vertices_[v[0]].point, vertices_[v[1]].point, point) >= 0.0 &&
+        orient(vertices_[v[1]].point, vertices_[v[2]].point, point) >= 0.0 &&
+        orient(vertices_[v[2]].point, vertices_[v[0]].point, point) >= 0.0) {
+      return static_cast<Index>(t);
+    }
+  }
+  return kInvalid;
+}
+
+bool IncrementalDelaunay::insertVertex(const Index& vertex, const Index& hint) {
+  const cv::Point2d& p = vertices_[vertex].point;
+  const Index t = locate(p, hint);
+  if (t == kInvalid) return false;
+
+  // Reject duplicated points, and find whether the point is on an edge.
+  int on_edge = -1;
+  for (int i = 0; i < 3; ++i) {
+    const Triangle& tri = triangles_[t];
+    if (vertices_[tri.vertices[i]].point == p) return false;
+    if (orient(vertices_[tri.vertices[next(i)]].point,
+               vertices_[tri.vertices[prev(i)]].point,
+               p) == 0.0) {
+      on_edge = i;
+    }
+  }
+
+  std::vector<Edge> edges;
+  if (on_edge < 0) {
+    // Split the triangle (a, b, c) in three around p.
+    const std::array<Index, 3> v = triangles_[t].vertices;
+    const std::array<Index, 3> n = triangles_[t].neighbors;
+    const Index t1 = newTriangle(vertex, v[2], v[0]);
+    const Index t2 = newTriangle(vertex, v[0], v[1]);
+    triangles_[t].vertices = {{vertex, v[1], v[2]}};
+    triangles_[t].neighbors = {{n[0], t1, t2}};
+    triangles_[t1].neighbors = {{n[1], t2, t}};
+    triangles_[t2].neighbors = {{n[2], t, t1}};
+    if (n[1] != kInvalid) setNeighbor(n[1], t, t1);
+    if (n[2] != kInvalid) setNeighbor(n[2], t, t2);
+    vertices_[vertex].triangle = t;
+    vertices_[v[1]].triangle = t;
+    vertices_[v[2]].triangle = t;
+    edges = {Edge(t, 0), Edge(t1, 0), Edge(t2, 0)};
+  } else {
+    // Split the triangle (a, b, c) and its neighbor (c, b, d) across the
+    // edge (b, c) containing p, in two each.
+    const Index u = triangles_[t].neighbors[on_edge];
+    if (u == kInvalid) return false;
+    const int i = on_edge;
+    const Index a = triangles_[t].vertices[i];
+    const Index b = triangles_[t].vertices[next(i)];
+    const Index c = triangles_[t].vertices[prev(i)];
+    const Index nb = triangles_[t].neighbors[next(i)];
+    const Index nc = triangles_[t].neighbors[prev(i)];
+    const int j = neighborIdx(u, t);
+    DCHECK_GE(j, 0);
+    const Index d = triangles_[u].vertices[j];
+    const Index u_c = triangles_[u].neighbors[next(j)];  // Edge (b, d).
+    const Index u_b = triangles_[u].neighbors[prev(j)];  // Edge (d, c).
+    DCHECK_EQ(triangles_[u].vertices[next(j)], c);
+    DCHECK_EQ(triangles_[u].vertices[prev(j)], b);
+
+    const Index t2 = newTriangle(a, vertex, c);
+    const Index u2 = newTriangle(d, c, vertex);
+    triangles_[t].vertices = {{a, b, vertex}};
+    triangles_[t].neighbors = {{u, t2, nc}};
+    triangles_[t2].neighbors = {{u2, nb, t}};
+    triangles_[u].vertices = {{d, vertex, b}};
+    triangles_[u].neighbors = {{t, u_c, u2}};
+    triangles_[u2].neighbors = {{t2, u, u_b}};
+    if (nb != kInvalid) setNeighbor(nb, t, t2);
+    if (u_b != kInvalid) setNeighbor(u_b, u, u2);
+    vertices_[a].triangle = t;
+    vertices_[b].triangle = t;
+    vertices_[vertex].triangle = t;
+    vertices_[d].triangle = u;
+    edges = {Edge(t, 2), Edge(t2, 1), Edge(u, 1), Edge(u2, 2)};
+  }
+  legalize(&edges);
+  return true;
+}
+
+void IncrementalDelaunay::removeVertex(const Index& vertex) {
+  CHECK(!isOuterVertex(vertex));
+  // The hole is the polygon linking the vertex' neighbors, counterclockwise.
+  std::vector<Index> star;
+  getStar(vertex, &star);
+  const size_t n = star.size();
+  CHECK_GE(n, 3u);
+  std::vector<Index> polygon(n);
+  std::vector<Index> outer(n);  // Triangle across each polygon edge.
+  for (size_t k = 0u; k < n; ++k) {
+    const int i = vertexIdx(star[k], vertex);
+    polygon[k] = triangles_[star[k]].vertices[next(i)];
+    outer[k] = triangles_[star[k]].neighbors[i];
+  }
+
+  // Ear clipping, preferring the Delaunay ears (with no polygon vertex in
+  // their circumcircle), so that few flips are left afterwards.
+  std::vector<std::array<Index, 3>> new_triangles;
+  new_triangles.reserve(n - 2u);
+  std::vector<Index> remaining = polygon;
+  while (remaining.size() > 3u) {
+    const size_t m = remaining.size();
+    int best_ear = -1;
+    for (size_t k = 0u; k < m && best_ear < 0; ++k) {
+      const cv::Point2d& a = vertices_[remaining[(k + m - 1u) % m]].point;
+      const cv::Point2d& b = vertices_[remaining[k]].point;
+      const cv::Point2d& c = vertices_[remaining[(k + 1u) % m]].point;
+      if (orient(a, b, c) <= 0.0) continue;
+      bool is_ear = true;
+      bool is_delaunay = true;
+      for (size_t l = 0u; l < m && is_ear; ++l) {
+        if (l == k || l == (k + 1u) % m || l == (k + m - 1u) % m) continue;
+        const cv::Point2d& p = vertices_[remaining[l]].point;
+        if (orient(a, b, p) >= 0.0 && orient(b, c, p) >= 0.0 &&
+            orient(c, a, p) >= 0.0) {
+          is_ear = false;
+        } else if (inCircle(a, b, c, p) > 0.0) {
+          is_delaunay = false;
+        }
+      }
+      if (!is_ear) continue;
+      if (is_delaunay) {
+        best_ear = static_cast<int>(k);
+      }
+    }
+    if (best_ear < 0) {
+      // No Delaunay ear (numerics), take any convex one: the flips fix it.
+      for (size_t k = 0u; k < m && best_ear < 0; ++k) {
+        if (orient(vertices_[remaining[(k + m - 1u) % m]].point,
+                   vertices_[remaining[k]].point,
+                   vertices_[remaining[(k + 1u) % m]].point) > 0.0) {
+          best_ear = static_cast<int>(k);
+        }
+      }
+    }
+    CHECK_GE(best_ear, 0) << "IncrementalDelaunay: hole has no ear.";
+    const size_t k = static_cast<size_t>(best_ear);
+    new_triangles.push_back({{remaining[(k + m - 1u) % m],
+                              remaining[k],
+                              remaining[(k + 1u) % m]}});
+    remaining.erase(remaining.begin() + k);
+  }
+  new_triangles.push_back({{remaining[0], remaining[1], remaining[2]}});
+
+  // Create the new triangles before freeing the star, so that their indices
+  // differ from the ones the outer triangles point to.
+  std::vector<Index> created;
+  created.reserve(new_triangles.size());
+  for (const auto& v : new_triangles) {
+    created.push_back(newTriangle(v[0], v[1], v[2]));
+  }
+  std::vector<Edge> edges;
+  edges.reserve(3u * created.size());
+  for (const Index& t : created) {
+    for (int i = 0; i < 3; ++i) {
+      const Index x = triangles_[t].vertices[next(i)];
+      const Index y = triangles_[t].vertices[prev(i)];
+      Index neighbor = kInvalid;
+      // The edge is either shared with another new triangle...
+      for (const Index& other : created) {
+        if (other == t) continue;
+        const auto& w = triangles_[other].vertices;
+        for (int j = 0; j < 3; ++j) {
+          if (w[next(j)] == y && w[prev(j)] == x) neighbor = other;
+        }
+      }
+      // ... or an edge of the polygon.
+      if (neighbor == kInvalid) {
+        for (size_t k = 0u; k < n; ++k) {
+          if (polygon[k] == x && polygon[(k + 1u) % n] == y) {
+            neighbor = outer[k];
+            if (neighbor != kInvalid) setNeighbor(neighbor, star[k], t);
+            break;
+          }
+        }
+      }
+      triangles_[t].neighbors[i] = neighbor;
+      edges.emplace_back(t, i);
+    }
+  }
+  for (const Index& t : star) deleteTriangle(t);
+  vertices_[vertex].triangle = kInvalid;
+  legalize(&edges);
+}
+
+/* -------------------------------------------------------------------------- */
+void IncrementalDelaunay::legalize(std::vector<Edge>* edges) {
+  CHECK_NOTNULL(edges);
+  // Lawson flips terminate, bound them anyway in case of numerical issues.
+  const size_t max_flips = 100u * (edges->size() + 10u);
+  size_t nr_flips = 0u;
+  while (!edges->empty()) {
+    const Edge edge = edges->back();
+    edges->pop_back();
+    const Index t = edge.first;
+    const int i = edge.second;
+    if (!triangles_[t].alive) continue;
+    const Index u = triangles_[t].neighbors[i];
+    if (u == kInvalid) continue;
+    const int j = neighborIdx(u, t);
+    DCHECK_GE(j, 0);
+    const auto& v = triangles_[t].vertices;
+    const cv::Point2d& p = vertices_[v[i]].point;
+    const cv::Point2d& a = vertices_[v[next(i)]].point;
+    const cv::Point2d& b = vertices_[v[prev(i)]].point;
+    const cv::Point2d& q = vertices_[triangles_[u].vertices[j]].point;
+    if (inCircle(p, a, b, q) <= 0.0) continue;
+    // The flipped triangles must be valid.
+    if (orient(p, a, q) <= 0.0 || orient(p, q, b) <= 0.0) continue;
+    if (++nr_flips > max_flips) {
+      LOG(WARNING) << "IncrementalDelaunay: too many flips, stopping.";
+      edges->clear();
+      break;
+    }
+    flip(t, i);
+    // Now t = (p, a, q) and u = (p, q, b): check the edges of the quad.
+    edges->emplace_back(t, 0);
+    edges->emplace_back(t, 2);
+    edges->emplace_back(u, 0);
+    edges->emplace_back(u, 1);
+  }
+}
+
+void IncrementalDelaunay::flip(const Index& t, const int& i) {
+  const Index u = triangles_[t].neighbors[i];
+  DCHECK_NE(u, kInvalid);
+  const int j = neighborIdx(u, t);
+  DCHECK_GE(j, 0);
+  const Index p = triangles_[t].vertices[i];
+  const Index a = triangles_[t].vertices[next(i)];
+  const Index b = triangles_[t].vertices[prev(i)];
+  const Index n_bp = triangles_[t].neighbors[next(i)];
+  const Index n_pa = triangles_[t].neighbors[prev(i)];
+  const Index q = triangles_[u].vertices[j];
+  DCHECK_EQ(triangles_[u].vertices[next(j)], b);
+  DCHECK_EQ(triangles_[u].vertices[prev(j)], a);
+  const Index n_aq = triangles_[u].neighbors[next(j)];
+  const Index n_qb = triangles_[u].neighbors[prev(j)];
+
+  triangles_[t].vertices = {{p, a, q}};
+  triangles_[t].neighbors = {{n_aq, u, n_pa}};
+  triangles_[u].vertices = {{p, q, b}};
+  triangles_[u].neighbors = {{n_qb, n_bp, t}};
+  if (n_aq != kInvalid) setNeighbor(n_aq, u, t);
+  if (n_bp != kInvalid) setNeighbor(n_bp, t, u);
+  vertices_[p].triangle = t;
+  vertices_[a].triangle = t;
+  vertices_[q].triangle = t;
+  vertices_[b].triangle = u;
+}
+
+void IncrementalDelaunay::getStar(const Index& vertex,
+                                  std::vector<Index>* star) const {
+  CHECK_NOTNULL(star);
+  star->clear();
+  const Index first = vertices_[vertex].triangle;
+  CHECK_NE(first, kInvalid);
+  Index triangle = first;
+  do {
+    star->push_back(triangle);
+    // Next triangle counterclockwise, across the edge (vertex, prev).
+    const int i = vertexIdx(triangle, vertex);
+    DCHECK_GE(i, 0);
+    triangle = triangles_[triangle].neighbors[next(i)];
+    CHECK_NE(triangle, kInvalid) << "IncrementalDelaunay: open star.";
+  } while (triangle != first);
+}
+
+void IncrementalDelaunay::setNeighbor(const Index& triangle,
+                                      const Index& old_neighbor,
+                                      const Index& new_neighbor) {
+  const int i = neighborIdx(triangle, old_neighbor);
+  DCHECK_GE(i, 0);
+  if (i >= 0) triangles_[triangle].neighbors[i] = new_neighbor;
+}
+
+int IncrementalDelaunay::vertexIdx(const Index& triangle,
+                                   const Index& vertex) const {
+  const auto& v = triangles_[triangle].vertices;
+  for (int i = 0; i < 3; ++i) {
+    if (v[i] == vertex) return i;
+  }
+  return -1;
+}
+
+int IncrementalDelaunay::neighborIdx(const Index& triangle,
+                                     const Index& neighbor) const {
+  const auto& n = triangles_[triangle].neighbors;
+  for (int i = 0; i < 3; ++i) {
+    if (n[i] == neighbor) return i;
+  }
+  return -1;
+}
+
+bool IncrementalDelaunay::isInside(const cv::Point2d& point) const {
+  return point.x >= rect_.x && point.y >= rect_.y &&
+         point.x < rect_.x + rect_.width && point.y < rect_.y + rect_.height;
+}
+
+double IncrementalDelaunay::orient(const cv::Point2d& a,
+                                   const cv::Point2d& b,
+                                   const cv::Point2d& c) {
+  return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+double IncrementalDelaunay::inCircle(const cv::Point2d& a,
+                                     const cv::Point2d& b,
+                                     const cv::Point2d& c,
+                                     const cv::Point2d& d) {
+  const double adx = a.x - d.x, ady = a.y - d.y;
+  const double bdx = b.x - d.x, bdy = b.y - d.y;
+  const double cdx = c.x - d.x, cdy = c.y - d.y;
+  const double ad = adx * adx + ady * ady;
+  const double bd = bdx * bdx + bdy * bdy;
+  const double cd = cdx * cdx + cdy * cdy;
+  return adx * (bdy * cd - bd * cdy) - ady * (bdx * cd - bd * cdx) +
+         ad * (bdx * cdy - bdy * cdx);
+}
+
+}  // namespace VIO
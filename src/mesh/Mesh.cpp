@@ -16,27 +16,39 @@
 
 #include <glog/logging.h>
 
+#include <algorithm>
+#include <array>
+#include <utility>
+
 #include <opencv2/core/core.hpp>
 #include <opencv2/core/persistence.hpp>
+#include <opencv2/core/utility.hpp>
 
+#include "kimera-vio/mesh/MeshLog.h"
+#include "kimera-vio/utils/MemoryAccounting.h"
 #include "kimera-vio/utils/UtilsNumerical.h"
 
 namespace VIO {
 
+namespace {
+//! Normal sums with a smaller norm (e.g. rounding errors of faces added and
+//! removed) give zero normals.
+static constexpr double kMinNormalSumNorm = 1e-12;
+
+inline cv::Point3d toPoint3d(const cv::Point2f& point) {
+  return cv::Point3d(point.x, point.y, 0.0);
+}
+inline cv::Point3d toPoint3d(const cv::Point3f& point) {
+  return cv::Point3d(point.x, point.y, point.z);
+}
+}  // namespace
+
 /**
  * param[in]: polygon_dimension number of vertices per polygon (triangle = 3).
  */
 template <typename VertexPositionType>
 Mesh<VertexPositionType>::Mesh(const size_t& polygon_dimension)
-    : vertex_to_lmk_id_map_(),
-      lmk_id_to_vertex_map_(),
-      vertices_mesh_(0, 1, CV_32FC3),
-      vertices_mesh_normal_(),
-      normals_computed_(false),
-      vertices_mesh_color_(0, 0, CV_8UC3, cv::viz::Color::blue()),
-      polygons_mesh_(0, 1, CV_32SC1),
-      adjacency_matrix_(1, 1, CV_8UC1, cv::Scalar(0u)),
-      face_hashes_(),
+    : data_(std::make_shared<MeshData>()),
       polygon_dimension_(polygon_dimension) {
   CHECK_GE(polygon_dimension, 3) << "A polygon must have more than 2"
                                     " vertices";
@@ -45,18 +57,8 @@ Mesh<VertexPositionType>::Mesh(const size_t& polygon_dimension)
 /* -------------------------------------------------------------------------- */
 template <typename VertexPositionType>
 Mesh<VertexPositionType>::Mesh(const Mesh<VertexPositionType>& rhs_mesh)
-    : vertex_to_lmk_id_map_(rhs_mesh.vertex_to_lmk_id_map_),
-      lmk_id_to_vertex_map_(rhs_mesh.lmk_id_to_vertex_map_),
-      vertices_mesh_(rhs_mesh.vertices_mesh_.clone()),        // CLONING!
-      vertices_mesh_normal_(rhs_mesh.vertices_mesh_normal_),  // COPYING!
-      normals_computed_(rhs_mesh.normals_computed_),
-      vertices_mesh_color_(rhs_mesh.vertices_mesh_color_.clone()),  // CLONING!
-      polygons_mesh_(rhs_mesh.polygons_mesh_.clone()),              // CLONING!
-      adjacency_matrix_(rhs_mesh.adjacency_matrix_.clone()),        // CLONING!
-      face_hashes_(rhs_mesh.face_hashes_),
-      polygon_dimension_(rhs_mesh.polygon_dimension_) {
-  VLOG(2) << "You are calling the copy ctor for a mesh... Cloning data.";
-}
+    : data_(rhs_mesh.data_),  // SHARING until modified!
+      polygon_dimension_(rhs_mesh.polygon_dimension_) {}
 
 /* -------------------------------------------------------------------------- */
 template <typename VertexPositionType>
@@ -67,30 +69,55 @@ Mesh<VertexPositionType>& Mesh<VertexPositionType>::operator=(
   CHECK_EQ(polygon_dimension_, rhs_mesh.polygon_dimension_)
       << "The Mesh that you are trying to copy has different dimensions"
       << " for the polygons!";
-  // Deep copy internal data.
-  lmk_id_to_vertex_map_ = rhs_mesh.lmk_id_to_vertex_map_;
-  vertex_to_lmk_id_map_ = rhs_mesh.vertex_to_lmk_id_map_;
-  vertices_mesh_ = rhs_mesh.vertices_mesh_.clone();
-  vertices_mesh_normal_ = rhs_mesh.vertices_mesh_normal_;
-  normals_computed_ = rhs_mesh.normals_computed_;
-  vertices_mesh_color_ = rhs_mesh.vertices_mesh_color_.clone();
-  polygons_mesh_ = rhs_mesh.polygons_mesh_.clone();
-  adjacency_matrix_ = rhs_mesh.adjacency_matrix_.clone();
-  face_hashes_ = rhs_mesh.face_hashes_;
+  data_ = rhs_mesh.data_;  // SHARING until modified!
   return *this;
 }
 
+/* -------------------------------------------------------------------------- */
+template <typename VertexPositionType>
+Mesh<VertexPositionType>::Mesh(Mesh<VertexPositionType>&& rhs_mesh)
+    : data_(std::move(rhs_mesh.data_)),
+      polygon_dimension_(rhs_mesh.polygon_dimension_) {
+  rhs_mesh.data_ = std::make_shared<MeshData>();
+}
+
+/* -------------------------------------------------------------------------- */
+template <typename VertexPositionType>
+Mesh<VertexPositionType>& Mesh<VertexPositionType>::operator=(
+    Mesh<VertexPositionType>&& rhs_mesh) {
+  if (&rhs_mesh == this) return *this;
+  CHECK_EQ(polygon_dimension_, rhs_mesh.polygon_dimension_)
+      << "The Mesh that you are trying to move has different dimensions"
+      << " for the polygons!";
+  data_ = std::move(rhs_mesh.data_);
+  rhs_mesh.data_ = std::make_shared<MeshData>();
+  return *this;
+}
+
+/* -------------------------------------------------------------------------- */
+template <typename VertexPositionType>
+void Mesh<VertexPositionType>::detach() {
+  CHECK(data_);
+  // Only this mesh can share its data with new meshes or views, hence if it
+  // is the only owner, it stays so while modifying the data.
+  if (data_.use_count() > 1) {
+    VLOG(10) << "Mesh data shared with other meshes, cloning it.";
+    data_ = data_->clone();
+  } else {
+    data_->detachMatrices();
+  }
+}
+
 /* -------------------------------------------------------------------------- */
 template <typename VertexPositionType>
 void Mesh<VertexPositionType>::addPolygonToMesh(const Polygon& polygon) {
+  detach();
   // Update mesh connectivity
   CHECK_EQ(polygon.size(), polygon_dimension_)
       << "Trying to insert a polygon of different dimension than "
       << "the mesh's polygons.\n"
       << "Polygon dimension: " << polygon.size() << "\n"
       << "Mesh expected polygon dimension: " << polygon_dimension_ << ".\n";
-  // Reset flag to know if normals are valid or not.
-  normals_computed_ = false;
 
   // Update vertices in the mesh (this happens all the time, even if we
   // do not add a new triangle connectivity-wise).
@@ -102,17 +129,20 @@ void Mesh<VertexPositionType>::addPolygonToMesh(const Polygon& polygon) {
     if (!getVtxIdForLmkId(lmk_id, &existing_vtx_id)) {
       // Vtx is not in the mesh, so no way the triangle is in the mesh.
       triangle_maybe_already_in_mesh = false;
+    } else if (data_->vertices_mesh_.at<VertexPositionType>(existing_vtx_id) !=
+               vertex.getVertexPosition()) {
+      // The normals of the faces of the vertex change with it.
+      moveVertex(existing_vtx_id, vertex.getVertexPosition());
     }
     const VertexId& vtx_id =
         updateMeshDataStructures(lmk_id,
                                  vertex.getVertexPosition(),
                                  vertex.getVertexColor(),
-                                 vertex.getVertexNormal(),
-                                 &vertex_to_lmk_id_map_,
-                                 &lmk_id_to_vertex_map_,
-                                 &vertices_mesh_,
-                                 &vertices_mesh_normal_,
-                                 &vertices_mesh_color_);
+                                 &data_->vertex_to_lmk_id_map_,
+                                 &data_->lmk_id_to_vertex_map_,
+                                 &data_->vertices_mesh_,
+                                 &data_->vertices_mesh_normal_,
+                                 &data_->vertices_mesh_color_);
     if (triangle_maybe_already_in_mesh) {
       // Just a small sanity check.
       CHECK_EQ(vtx_id, existing_vtx_id);
@@ -128,27 +158,27 @@ void Mesh<VertexPositionType>::addPolygonToMesh(const Polygon& polygon) {
   std::sort(sorted_vtx_ids.begin(), sorted_vtx_ids.end());
   const auto& face_hash = UtilsNumerical::hashTriplet(
       sorted_vtx_ids[0], sorted_vtx_ids[1], sorted_vtx_ids[2]);
-  const auto& it = face_hashes_.find(face_hash);
+  const auto& it = data_->face_hashes_.find(face_hash);
 
   // Check the triangle is not already in the mesh
   CHECK_EQ(polygon_dimension_, 3) << "This doesn't work with non-triangles";
   bool triangle_in_mesh = false;
   if (triangle_maybe_already_in_mesh) {
     // Check that the triangle is not already in the mesh!
-    if (it != face_hashes_.end()) {
+    if (it != data_->face_hashes_.end()) {
       // LOG(ERROR) << "Found existing face with hash: " << face_hash;
       // Triangle already exists!
       triangle_in_mesh = true;
-      CHECK(it->second);
-      CHECK_EQ(
-          adjacency_matrix_.at<uint8_t>(sorted_vtx_ids[0], sorted_vtx_ids[1]),
-          1u);
-      CHECK_EQ(
-          adjacency_matrix_.at<uint8_t>(sorted_vtx_ids[1], sorted_vtx_ids[2]),
-          1u);
-      CHECK_EQ(
-          adjacency_matrix_.at<uint8_t>(sorted_vtx_ids[2], sorted_vtx_ids[0]),
-          1u);
+      const std::vector<VertexIds>& adjacency = data_->adjacency_lists_;
+      DCHECK(std::binary_search(adjacency[sorted_vtx_ids[0]].begin(),
+                                adjacency[sorted_vtx_ids[0]].end(),
+                                sorted_vtx_ids[1]));
+      DCHECK(std::binary_search(adjacency[sorted_vtx_ids[1]].begin(),
+                                adjacency[sorted_vtx_ids[1]].end(),
+                                sorted_vtx_ids[2]));
+      DCHECK(std::binary_search(adjacency[sorted_vtx_ids[2]].begin(),
+                                adjacency[sorted_vtx_ids[2]].end(),
+                                sorted_vtx_ids[0]));
     } else {
       triangle_in_mesh = false;
     }
@@ -156,55 +186,308 @@ void Mesh<VertexPositionType>::addPolygonToMesh(const Polygon& polygon) {
 
   if (!triangle_in_mesh) {
     // LOG(ERROR) << "Adding face with hash: " << face_hash;
-    CHECK(it == face_hashes_.end()) << "Hash collision? This can happen but "
-                                       "weird... Check your hashing function.";
-    face_hashes_[face_hash] = true;
+    CHECK(it == data_->face_hashes_.end())
+        << "Hash collision? This can happen but "
+           "weird... Check your hashing function.";
+    data_->face_hashes_.insert(face_hash);
 
     // Update polygons_mesh_
     // Specify number of point ids per face in the mesh.
-    polygons_mesh_.push_back(static_cast<int>(polygon_dimension_));
+    data_->polygons_mesh_.push_back(static_cast<int>(polygon_dimension_));
     for (const VertexId& vtx_id : vtx_ids) {
-      polygons_mesh_.push_back(static_cast<int>(vtx_id));
+      data_->polygons_mesh_.push_back(static_cast<int>(vtx_id));
     }
 
-    // Update adjacency matrix
-    if (!triangle_maybe_already_in_mesh) {
-      // There are new vertices!
-      // TODO(Toni): this assumes that we never remove vertices!!
-      // Add a new col/row for each new vtx
-      // Check vtx_ids are ordered
-      VertexIds sorted_vtx_ids = vtx_ids;
-      std::sort(sorted_vtx_ids.begin(), sorted_vtx_ids.end());
-      for (const auto& sorted_vtx_id : sorted_vtx_ids) {
-        if (sorted_vtx_id >= static_cast<size_t>(adjacency_matrix_.rows)) {
-          // Non-existing vertex! Add row/col. Careful! vtx_ids ordering
-          // matters! First order them!
-          CHECK(adjacency_matrix_.rows != 0 && adjacency_matrix_.cols != 0);
-          cv::Mat row = cv::Mat::zeros(1, adjacency_matrix_.cols, CV_8UC1);
-          cv::vconcat(adjacency_matrix_, row, adjacency_matrix_);
-
-          cv::Mat col = cv::Mat::zeros(adjacency_matrix_.rows, 1, CV_8UC1);
-          cv::hconcat(adjacency_matrix_, col, adjacency_matrix_);
-        }
-        CHECK_LT(sorted_vtx_id, adjacency_matrix_.rows);
-      }
+    // Update adjacency lists, new vertices have been given the next rows.
+    if (data_->adjacency_lists_.size() < getNumberOfUniqueVertices()) {
+      data_->adjacency_lists_.resize(getNumberOfUniqueVertices());
+    }
+    if (data_->vertex_polygons_.size() < getNumberOfUniqueVertices()) {
+      data_->vertex_polygons_.resize(getNumberOfUniqueVertices());
+    }
+    if (data_->vertex_normal_sums_.size() < getNumberOfUniqueVertices()) {
+      data_->vertex_normal_sums_.resize(getNumberOfUniqueVertices(),
+                                        cv::Point3d(0.0, 0.0, 0.0));
     }
-    CHECK_EQ(adjacency_matrix_.rows, adjacency_matrix_.cols);
-
-    // Update old vertices col/row
-    adjacency_matrix_.at<uint8_t>(sorted_vtx_ids[0], sorted_vtx_ids[1]) = 1u;
-    adjacency_matrix_.at<uint8_t>(sorted_vtx_ids[1], sorted_vtx_ids[0]) = 1u;
-    adjacency_matrix_.at<uint8_t>(sorted_vtx_ids[0], sorted_vtx_ids[2]) = 1u;
-    adjacency_matrix_.at<uint8_t>(sorted_vtx_ids[2], sorted_vtx_ids[0]) = 1u;
-    adjacency_matrix_.at<uint8_t>(sorted_vtx_ids[1], sorted_vtx_ids[2]) = 1u;
-    adjacency_matrix_.at<uint8_t>(sorted_vtx_ids[2], sorted_vtx_ids[1]) = 1u;
+    const size_t polygon_idx = getNumberOfPolygons() - 1u;
+    for (size_t i = 0u; i < vtx_ids.size(); i++) {
+      const VertexId& vtx_id = vtx_ids[i];
+      const VertexId& next_vtx_id = vtx_ids[(i + 1u) % vtx_ids.size()];
+      addAdjacency(vtx_id, next_vtx_id);
+      addAdjacency(next_vtx_id, vtx_id);
+      data_->vertex_polygons_[vtx_id].push_back(polygon_idx);
+    }
+    accumulateFaceNormal(polygon_idx, 1.0);
   } else {
     // No need to update connectivity, since the triangle is in the mesh already
-    CHECK(it != face_hashes_.end());
-    CHECK(face_hashes_[face_hash]);
+    CHECK(it != data_->face_hashes_.end());
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+template <typename VertexPositionType>
+void Mesh<VertexPositionType>::removePolygon(const size_t& polygon_idx) {
+  CHECK_LT(polygon_idx, getNumberOfPolygons());
+  CHECK_EQ(polygon_dimension_, 3) << "This doesn't work with non-triangles";
+  detach();
+  accumulateFaceNormal(polygon_idx, -1.0);
+
+  VertexIds vtx_ids(polygon_dimension_);
+  LandmarkIds lmk_ids(polygon_dimension_);
+  for (size_t j = 0u; j < polygon_dimension_; j++) {
+    vtx_ids[j] = getPolygonVertexId(polygon_idx, j);
+    lmk_ids[j] = data_->vertex_to_lmk_id_map_[vtx_ids[j]];
+  }
+  data_->face_hashes_.erase(getFaceHash(polygon_idx));
+  for (const VertexId& vtx_id : vtx_ids) {
+    std::vector<size_t>& polygons = data_->vertex_polygons_[vtx_id];
+    const auto it = std::find(polygons.begin(), polygons.end(), polygon_idx);
+    CHECK(it != polygons.end());
+    *it = polygons.back();
+    polygons.pop_back();
+  }
+  // Remove the edges that no other polygon has.
+  for (size_t j = 0u; j < polygon_dimension_; j++) {
+    const VertexId& vtx_id = vtx_ids[j];
+    const VertexId& next_vtx_id = vtx_ids[(j + 1u) % polygon_dimension_];
+    if (!isEdgeInMesh(vtx_id, next_vtx_id)) {
+      for (const auto& edge : {std::make_pair(vtx_id, next_vtx_id),
+                               std::make_pair(next_vtx_id, vtx_id)}) {
+        VertexIds& adjacent_vtx_ids = data_->adjacency_lists_[edge.first];
+        const auto it = std::lower_bound(
+            adjacent_vtx_ids.begin(), adjacent_vtx_ids.end(), edge.second);
+        CHECK(it != adjacent_vtx_ids.end() && *it == edge.second);
+        adjacent_vtx_ids.erase(it);
+      }
+    }
+  }
+
+  // The last polygon takes the index of the removed one.
+  const size_t polygon_size = polygon_dimension_ + 1u;
+  const size_t last_polygon_idx = getNumberOfPolygons() - 1u;
+  if (polygon_idx != last_polygon_idx) {
+    for (size_t j = 0u; j < polygon_dimension_; j++) {
+      const VertexId vtx_id = getPolygonVertexId(last_polygon_idx, j);
+      data_->polygons_mesh_.at<int32_t>(polygon_idx * polygon_size + j + 1u) =
+          static_cast<int32_t>(vtx_id);
+      std::vector<size_t>& polygons = data_->vertex_polygons_[vtx_id];
+      std::replace(
+          polygons.begin(), polygons.end(), last_polygon_idx, polygon_idx);
+    }
+  }
+  data_->polygons_mesh_.pop_back(polygon_size);
+
+  // Vertices may have changed ids while removing the others: use lmk ids.
+  for (const LandmarkId& lmk_id : lmk_ids) {
+    VertexId vtx_id;
+    CHECK(getVtxIdForLmkId(lmk_id, &vtx_id));
+    if (data_->vertex_polygons_[vtx_id].empty()) removeVertex(vtx_id);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+template <typename VertexPositionType>
+size_t Mesh<VertexPositionType>::removePolygonsOfLmkId(
+    const LandmarkId& lmk_id) {
+  size_t nr_removed_polygons = 0u;
+  VertexId vtx_id;
+  // The vertex is removed with its last polygon.
+  while (getVtxIdForLmkId(lmk_id, &vtx_id)) {
+    const std::vector<size_t>& polygons = data_->vertex_polygons_.at(vtx_id);
+    CHECK(!polygons.empty()) << "Vertex without polygons in the mesh.";
+    removePolygon(polygons.back());
+    ++nr_removed_polygons;
+  }
+  return nr_removed_polygons;
+}
+
+/* -------------------------------------------------------------------------- */
+template <typename VertexPositionType>
+void Mesh<VertexPositionType>::removeVertex(const VertexId& vtx_id) {
+  CHECK_LT(vtx_id, getNumberOfUniqueVertices());
+  DCHECK(data_->vertex_polygons_[vtx_id].empty());
+  DCHECK(data_->adjacency_lists_[vtx_id].empty());
+  data_->lmk_id_to_vertex_map_.erase(data_->vertex_to_lmk_id_map_[vtx_id]);
+
+  // The last vertex takes the id of the removed one.
+  const VertexId last_vtx_id = getNumberOfUniqueVertices() - 1u;
+  if (vtx_id != last_vtx_id) {
+    data_->vertices_mesh_.at<VertexPositionType>(vtx_id) =
+        data_->vertices_mesh_.at<VertexPositionType>(last_vtx_id);
+    data_->vertices_mesh_color_.at<VertexColorRGB>(vtx_id) =
+        data_->vertices_mesh_color_.at<VertexColorRGB>(last_vtx_id);
+    data_->vertices_mesh_normal_[vtx_id] =
+        data_->vertices_mesh_normal_[last_vtx_id];
+    data_->vertex_normal_sums_[vtx_id] = data_->vertex_normal_sums_[last_vtx_id];
+    const LandmarkId& lmk_id = data_->vertex_to_lmk_id_map_[last_vtx_id];
+    data_->vertex_to_lmk_id_map_[vtx_id] = lmk_id;
+    data_->lmk_id_to_vertex_map_[lmk_id] = vtx_id;
+
+    data_->adjacency_lists_[vtx_id] =
+        std::move(data_->adjacency_lists_[last_vtx_id]);
+    for (const VertexId& adjacent_vtx_id : data_->adjacency_lists_[vtx_id]) {
+      VertexIds& adjacent_vtx_ids = data_->adjacency_lists_[adjacent_vtx_id];
+      const auto it = std::lower_bound(
+          adjacent_vtx_ids.begin(), adjacent_vtx_ids.end(), last_vtx_id);
+      CHECK(it != adjacent_vtx_ids.end() && *it == last_vtx_id);
+      adjacent_vtx_ids.erase(it);
+      addAdjacency(adjacent_vtx_id, vtx_id);
+    }
+
+    data_->vertex_polygons_[vtx_id] =
+        std::move(data_->vertex_polygons_[last_vtx_id]);
+    const size_t polygon_size = polygon_dimension_ + 1u;
+    for (const size_t& polygon_idx : data_->vertex_polygons_[vtx_id]) {
+      // Vertex ids of the polygon change, and so does its hash.
+      data_->face_hashes_.erase(getFaceHash(polygon_idx));
+      for (size_t j = 0u; j < polygon_dimension_; j++) {
+        int32_t& polygon_vtx_id = data_->polygons_mesh_.at<int32_t>(
+            polygon_idx * polygon_size + j + 1u);
+        if (polygon_vtx_id == static_cast<int32_t>(last_vtx_id)) {
+          polygon_vtx_id = static_cast<int32_t>(vtx_id);
+        }
+      }
+      data_->face_hashes_.insert(getFaceHash(polygon_idx));
+    }
+  }
+
+  data_->vertices_mesh_.pop_back();
+  data_->vertices_mesh_color_.pop_back();
+  data_->vertices_mesh_normal_.pop_back();
+  data_->vertex_normal_sums_.pop_back();
+  data_->vertex_to_lmk_id_map_.pop_back();
+  data_->adjacency_lists_.pop_back();
+  data_->vertex_polygons_.pop_back();
+}
+
+/* -------------------------------------------------------------------------- */
+template <typename VertexPositionType>
+size_t Mesh<VertexPositionType>::getFaceHash(const size_t& polygon_idx) const {
+  CHECK_EQ(polygon_dimension_, 3) << "This doesn't work with non-triangles";
+  std::array<VertexId, 3> vtx_ids = {{getPolygonVertexId(polygon_idx, 0),
+                                      getPolygonVertexId(polygon_idx, 1),
+                                      getPolygonVertexId(polygon_idx, 2)}};
+  std::sort(vtx_ids.begin(), vtx_ids.end());
+  return UtilsNumerical::hashTriplet(vtx_ids[0], vtx_ids[1], vtx_ids[2]);
+}
+
+/* -------------------------------------------------------------------------- */
+template <typename VertexPositionType>
+bool Mesh<VertexPositionType>::isEdgeInMesh(
+    const VertexId& vtx_id,
+    const VertexId& adjacent_vtx_id) const {
+  for (const size_t& polygon_idx : data_->vertex_polygons_[vtx_id]) {
+    for (size_t j = 0u; j < polygon_dimension_; j++) {
+      if (getPolygonVertexId(polygon_idx, j) == adjacent_vtx_id) return true;
+    }
+  }
+  return false;
+}
+
+/* -------------------------------------------------------------------------- */
+template <typename VertexPositionType>
+void Mesh<VertexPositionType>::addAdjacency(const VertexId& vtx_id,
+                                            const VertexId& adjacent_vtx_id) {
+  VertexIds& adjacent_vtx_ids = data_->adjacency_lists_.at(vtx_id);
+  const auto it = std::lower_bound(
+      adjacent_vtx_ids.begin(), adjacent_vtx_ids.end(), adjacent_vtx_id);
+  if (it == adjacent_vtx_ids.end() || *it != adjacent_vtx_id) {
+    adjacent_vtx_ids.insert(it, adjacent_vtx_id);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+template <typename VertexPositionType>
+void Mesh<VertexPositionType>::updateConnectivityFromPolygons() {
+  data_->adjacency_lists_.assign(getNumberOfUniqueVertices(), VertexIds());
+  data_->vertex_polygons_.assign(getNumberOfUniqueVertices(),
+                                 std::vector<size_t>());
+  data_->face_hashes_.clear();
+  const int polygon_size = static_cast<int>(polygon_dimension_) + 1;
+  CHECK_EQ(data_->polygons_mesh_.rows % polygon_size, 0);
+  for (int k = 0; k < data_->polygons_mesh_.rows; k += polygon_size) {
+    VertexIds vtx_ids(polygon_dimension_);
+    for (size_t j = 0u; j < polygon_dimension_; j++) {
+      vtx_ids[j] = data_->polygons_mesh_.at<int32_t>(k + j + 1);
+      CHECK_LT(vtx_ids[j], data_->adjacency_lists_.size());
+    }
+    for (size_t j = 0u; j < polygon_dimension_; j++) {
+      addAdjacency(vtx_ids[j], vtx_ids[(j + 1u) % polygon_dimension_]);
+      addAdjacency(vtx_ids[(j + 1u) % polygon_dimension_], vtx_ids[j]);
+      data_->vertex_polygons_[vtx_ids[j]].push_back(
+          static_cast<size_t>(k / polygon_size));
+    }
+    if (polygon_dimension_ == 3u) {
+      std::sort(vtx_ids.begin(), vtx_ids.end());
+      data_->face_hashes_.insert(
+          UtilsNumerical::hashTriplet(vtx_ids[0], vtx_ids[1], vtx_ids[2]));
+    }
+  }
+  recomputeVertexNormals(1);
+}
+
+/* -------------------------------------------------------------------------- */
+template <typename VertexPositionType>
+cv::Point3d Mesh<VertexPositionType>::getFaceNormalSum(
+    const size_t& polygon_idx) const {
+  const cv::Point3d p1 = toPoint3d(getPolygonVertexPosition(polygon_idx, 0));
+  const cv::Point3d p2 = toPoint3d(getPolygonVertexPosition(polygon_idx, 1));
+  const cv::Point3d p3 = toPoint3d(getPolygonVertexPosition(polygon_idx, 2));
+  // Outward-facing normal.
+  return (p3 - p1).cross(p2 - p1);
+}
+
+/* -------------------------------------------------------------------------- */
+template <typename VertexPositionType>
+void Mesh<VertexPositionType>::updateVertexNormal(const VertexId& vtx_id) {
+  const cv::Point3d& normal_sum = data_->vertex_normal_sums_[vtx_id];
+  const double norm = cv::norm(normal_sum);
+  data_->vertices_mesh_normal_[vtx_id] =
+      norm > kMinNormalSumNorm ? VertexNormal(normal_sum / norm)
+                               : VertexNormal(0.0f, 0.0f, 0.0f);
+}
+
+/* -------------------------------------------------------------------------- */
+template <typename VertexPositionType>
+void Mesh<VertexPositionType>::accumulateFaceNormal(const size_t& polygon_idx,
+                                                    const double& sign) {
+  if (polygon_dimension_ != 3u) return;
+  const cv::Point3d normal = sign * getFaceNormalSum(polygon_idx);
+  for (size_t j = 0u; j < polygon_dimension_; j++) {
+    const VertexId vtx_id = getPolygonVertexId(polygon_idx, j);
+    data_->vertex_normal_sums_[vtx_id] += normal;
+    updateVertexNormal(vtx_id);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+template <typename VertexPositionType>
+void Mesh<VertexPositionType>::moveVertex(const VertexId& vtx_id,
+                                          const VertexPositionType& position) {
+  const std::vector<size_t>& polygons = data_->vertex_polygons_[vtx_id];
+  for (const size_t& polygon_idx : polygons) {
+    accumulateFaceNormal(polygon_idx, -1.0);
+  }
+  data_->vertices_mesh_.at<VertexPositionType>(vtx_id) = position;
+  for (const size_t& polygon_idx : polygons) {
+    accumulateFaceNormal(polygon_idx, 1.0);
   }
 }
 
+/* -------------------------------------------------------------------------- */
+template <typename VertexPositionType>
+cv::Mat Mesh<VertexPositionType>::getAdjacencyMatrix() const {
+  const int n_vtx = static_cast<int>(data_->adjacency_lists_.size());
+  cv::Mat adjacency_matrix(
+      std::max(n_vtx, 1), std::max(n_vtx, 1), CV_8UC1, cv::Scalar(0u));
+  for (int v = 0; v < n_vtx; v++) {
+    for (const VertexId& u : data_->adjacency_lists_[v]) {
+      adjacency_matrix.at<uint8_t>(v, static_cast<int>(u)) = 1u;
+    }
+  }
+  return adjacency_matrix;
+}
+
 // Updates mesh data structures incrementally, by adding new landmark
 // if there was no previous id, or updating it if it was already present.
 // Provides the id of the row where the new/updated vertex is in the
@@ -215,9 +498,8 @@ Mesh<VertexPositionType>::updateMeshDataStructures(
     const LandmarkId& lmk_id,
     const VertexPositionType& lmk_position,
     const VertexColorRGB& vertex_color,
-    const VertexNormal& vertex_normal,
-    std::map<VertexId, LandmarkId>* vertex_to_lmk_id_map,
-    std::map<LandmarkId, VertexId>* lmk_id_to_vertex_id_map,
+    VertexToLmkIdMap* vertex_to_lmk_id_map,
+    LmkIdToVertexMap* lmk_id_to_vertex_id_map,
     cv::Mat* vertices_mesh,
     VertexNormals* vertices_mesh_normal,
     cv::Mat* vertices_mesh_color) const {
@@ -226,7 +508,6 @@ Mesh<VertexPositionType>::updateMeshDataStructures(
   CHECK_NOTNULL(vertices_mesh);
   CHECK_NOTNULL(vertices_mesh_normal);
   CHECK_NOTNULL(vertices_mesh_color);
-  DCHECK(!normals_computed_) << "Normals should be invalidated before...";
 
   const auto& lmk_id_to_vertex_map_end = lmk_id_to_vertex_id_map->end();
   const auto& vertex_it = lmk_id_to_vertex_id_map->find(lmk_id);
@@ -238,19 +519,21 @@ Mesh<VertexPositionType>::updateMeshDataStructures(
     // New landmark, create a new entrance in the set of vertices.
     // Store 3D points in map_points_3d.
     vertices_mesh->push_back(lmk_position);
-    vertices_mesh_normal->push_back(vertex_normal);
+    // Set with the normals of its faces, as they are added.
+    vertices_mesh_normal->push_back(VertexNormal(0.0f, 0.0f, 0.0f));
     vertices_mesh_color->push_back(vertex_color);
     row_id_vertex = vertices_mesh->rows - 1;
     // Book-keeping.
     // Store the row in the vertices structure of this new landmark id.
     (*lmk_id_to_vertex_id_map)[lmk_id] = row_id_vertex;
-    (*vertex_to_lmk_id_map)[row_id_vertex] = lmk_id;
+    CHECK_EQ(vertex_to_lmk_id_map->size(), row_id_vertex);
+    vertex_to_lmk_id_map->push_back(lmk_id);
   } else {
-    // Update old landmark with new position.
+    // Update old landmark with new position (see moveVertex for its
+    // normals).
     // But don't update the color information... Or should we?
     row_id_vertex = vertex_it->second;
     vertices_mesh->at<VertexPositionType>(row_id_vertex) = lmk_position;
-    vertices_mesh_normal->at(row_id_vertex) = vertex_normal;
     vertices_mesh_color->at<VertexColorRGB>(row_id_vertex) = vertex_color;
   }
   return row_id_vertex;
@@ -273,22 +556,22 @@ bool Mesh<VertexPositionType>::getPolygon(const size_t& polygon_idx,
     return false;
   };
 
-  bool has_normals =
-      static_cast<size_t>(vertices_mesh_.rows) == vertices_mesh_normal_.size();
-  CHECK_EQ(vertices_mesh_.rows, vertices_mesh_color_.rows);
+  bool has_normals = static_cast<size_t>(data_->vertices_mesh_.rows) ==
+                     data_->vertices_mesh_normal_.size();
+  CHECK_EQ(data_->vertices_mesh_.rows, data_->vertices_mesh_color_.rows);
   size_t idx_in_polygon_mesh = polygon_idx * (polygon_dimension_ + 1);
   polygon->resize(polygon_dimension_);
   for (size_t j = 0; j < polygon_dimension_; j++) {
     const int32_t& row_id_pt_j =
-        polygons_mesh_.at<int32_t>(idx_in_polygon_mesh + j + 1);
-    CHECK(vertex_to_lmk_id_map_.find(row_id_pt_j) !=
-          vertex_to_lmk_id_map_.end());
-    CHECK_LT(row_id_pt_j, vertices_mesh_.rows);
+        data_->polygons_mesh_.at<int32_t>(idx_in_polygon_mesh + j + 1);
+    CHECK(isVtxIdInMesh(row_id_pt_j));
+    CHECK_LT(row_id_pt_j, data_->vertices_mesh_.rows);
     polygon->at(j) = Vertex<VertexPositionType>(
-        vertex_to_lmk_id_map_.at(row_id_pt_j),
-        vertices_mesh_.at<VertexPositionType>(row_id_pt_j),
-        vertices_mesh_color_.at<VertexColorRGB>(row_id_pt_j),
-        has_normals ? vertices_mesh_normal_.at(row_id_pt_j) : VertexNormal());
+        data_->vertex_to_lmk_id_map_[row_id_pt_j],
+        data_->vertices_mesh_.at<VertexPositionType>(row_id_pt_j),
+        data_->vertices_mesh_color_.at<VertexColorRGB>(row_id_pt_j),
+        has_normals ? data_->vertices_mesh_normal_.at(row_id_pt_j)
+                    : VertexNormal());
   }
   return true;
 }
@@ -304,8 +587,8 @@ bool Mesh<VertexPosition>::getVertex(const LandmarkId& lmk_id,
                                      VertexId* vertex_id) const {
   CHECK(vertex != nullptr || vertex_id != nullptr)
       << "No output requested, are your sure you want to use this function?";
-  const auto& lmk_id_to_vertex_map_end = lmk_id_to_vertex_map_.end();
-  const auto& vertex_it = lmk_id_to_vertex_map_.find(lmk_id);
+  const auto& lmk_id_to_vertex_map_end = data_->lmk_id_to_vertex_map_.end();
+  const auto& vertex_it = data_->lmk_id_to_vertex_map_.find(lmk_id);
   if (vertex_it == lmk_id_to_vertex_map_end) {
     // We didn't find the lmk id!
     VLOG(100) << "Lmk id: " << lmk_id << " not found in mesh.";
@@ -313,96 +596,69 @@ bool Mesh<VertexPosition>::getVertex(const LandmarkId& lmk_id,
   } else {
     // Construct and Return the vertex.
     const VertexId& vtx_id = vertex_it->second;
-    CHECK_EQ(vertices_mesh_.rows, vertices_mesh_normal_.size());
-    CHECK_EQ(vertices_mesh_.rows, vertices_mesh_color_.rows);
-    CHECK_LT(vtx_id, vertices_mesh_.rows);
+    CHECK_EQ(data_->vertices_mesh_.rows, data_->vertices_mesh_normal_.size());
+    CHECK_EQ(data_->vertices_mesh_.rows, data_->vertices_mesh_color_.rows);
+    CHECK_LT(vtx_id, data_->vertices_mesh_.rows);
     if (vertex_id != nullptr) *vertex_id = vtx_id;
     if (vertex != nullptr)
       *vertex = Vertex<VertexPosition>(
-          vertex_to_lmk_id_map_.at(vtx_id),
-          vertices_mesh_.at<VertexPosition>(vtx_id),
-          vertices_mesh_color_.at<VertexColorRGB>(vtx_id),
-          vertices_mesh_normal_.at(vtx_id));
+          data_->vertex_to_lmk_id_map_.at(vtx_id),
+          data_->vertices_mesh_.at<VertexPosition>(vtx_id),
+          data_->vertices_mesh_color_.at<VertexColorRGB>(vtx_id),
+          data_->vertices_mesh_normal_.at(vtx_id));
     return true;  // Meaning we found the vertex.
   }
 }
 
 /* --------------------------------------------------------------------------
  */
-// Retrieve per vertex normals of the mesh.
+// Recompute per vertex normals of the mesh.
 template <typename VertexPositionType>
-void Mesh<VertexPositionType>::computePerVertexNormals() {
+void Mesh<VertexPositionType>::computePerVertexNormals(
+    const int& num_threads) {
   CHECK_EQ(polygon_dimension_, 3) << "Normals are only valid for dim 3 meshes.";
-  LOG_IF(ERROR, normals_computed_) << "Normals have been computed already...";
-
-  size_t n_vtx = getNumberOfUniqueVertices();
-  std::vector<int> counts(n_vtx, 0);
-
-  // Set all per-vertex normals in mesh to 0, since we want to average
-  // per-face
-  // normals.
-  clearVertexNormals();
-  vertices_mesh_normal_.resize(n_vtx);
-
-  // Walk through triangles and compute averaged vertex normals.
-  Polygon polygon;
-  for (size_t i = 0; i < getNumberOfPolygons(); i++) {
-    CHECK(getPolygon(i, &polygon)) << "Could not retrieve polygon.";
-    CHECK_EQ(polygon.size(), 3);
-    // TODO(Toni): it would be better if we could do a polygon.getNormal();
-    const VertexPositionType& p1 = polygon.at(0).getVertexPosition();
-    const VertexPositionType& p2 = polygon.at(1).getVertexPosition();
-    const VertexPositionType& p3 = polygon.at(2).getVertexPosition();
-
-    // Outward-facing normal.
-    VertexPositionType v21(p2 - p1);
-    VertexPositionType v31(p3 - p1);
-    VertexNormal normal(v31.cross(v21));
-
-    // Normalize.
-    double norm = cv::norm(normal);
-    CHECK_GT(norm, 0.0);
-    normal /= norm;
-
-    // TODO(Toni): Store normals at this point on a per-face basis.
-
-    // Sanity check
-    static constexpr double epsilon = 1e-3;  // 2.5 degrees aperture.
-    v21 /= cv::norm(v21);
-    v31 /= cv::norm(v31);
-    LOG_IF(WARNING, std::fabs(v21.ddot(v31)) >= 1.0 - epsilon)
-        << "Cross product of aligned vectors.";
-
-    // Compute per vertex averaged normals.
-    /// Indices of vertices
-    const VertexId& p1_idx = lmk_id_to_vertex_map_.at(polygon.at(0).getLmkId());
-    const VertexId& p2_idx = lmk_id_to_vertex_map_.at(polygon.at(1).getLmkId());
-    const VertexId& p3_idx = lmk_id_to_vertex_map_.at(polygon.at(2).getLmkId());
-    /// Sum of normals per vertex
-    vertices_mesh_normal_.at(p1_idx) =
-        (counts.at(p1_idx) * vertices_mesh_normal_.at(p1_idx) + normal) /
-        (counts.at(p1_idx) + 1.0);
-    vertices_mesh_normal_.at(p2_idx) =
-        counts.at(p2_idx) * vertices_mesh_normal_.at(p2_idx) +
-        normal / (counts.at(p2_idx) + 1.0);
-    vertices_mesh_normal_.at(p3_idx) =
-        counts.at(p3_idx) * vertices_mesh_normal_.at(p3_idx) +
-        normal / (counts.at(p3_idx) + 1.0);
-    // assumes non-zero normals...
-    vertices_mesh_normal_.at(p1_idx) /=
-        cv::norm(vertices_mesh_normal_.at(p1_idx));
-    vertices_mesh_normal_.at(p2_idx) /=
-        cv::norm(vertices_mesh_normal_.at(p2_idx));
-    vertices_mesh_normal_.at(p3_idx) /=
-        cv::norm(vertices_mesh_normal_.at(p3_idx));
-    /// Increase counts of normals added per vertex
-    counts.at(p1_idx)++;
-    counts.at(p2_idx)++;
-    counts.at(p3_idx)++;
-  }
-
-  CHECK_EQ(counts.size(), vertices_mesh_normal_.size());
-  return;
+  detach();
+  recomputeVertexNormals(num_threads);
+}
+
+/* -------------------------------------------------------------------------- */
+template <typename VertexPositionType>
+void Mesh<VertexPositionType>::recomputeVertexNormals(const int& num_threads) {
+  const size_t n_vtx = getNumberOfUniqueVertices();
+  const int n_polygons =
+      polygon_dimension_ == 3u ? static_cast<int>(getNumberOfPolygons()) : 0;
+  data_->vertex_normal_sums_.assign(n_vtx, cv::Point3d(0.0, 0.0, 0.0));
+  data_->vertices_mesh_normal_.assign(n_vtx, VertexNormal(0.0f, 0.0f, 0.0f));
+
+  // Per-face normals: independent per polygon, computed in parallel over
+  // polygon ranges.
+  std::vector<cv::Point3d> face_normals(n_polygons);
+  auto compute_face_normals = [&](const int& start, const int& end) {
+    for (int i = start; i < end; ++i) {
+      face_normals[i] = getFaceNormalSum(i);
+    }
+  };
+  if (num_threads > 1) {
+    cv::parallel_for_(
+        cv::Range(0, n_polygons),
+        [&](const cv::Range& range) {
+          compute_face_normals(range.start, range.end);
+        },
+        static_cast<double>(num_threads));
+  } else {
+    compute_face_normals(0, n_polygons);
+  }
+
+  // Sum of normals per vertex: vertices are shared among polygons, so the
+  // scatter is serial.
+  for (int i = 0; i < n_polygons; ++i) {
+    for (size_t j = 0u; j < polygon_dimension_; ++j) {
+      data_->vertex_normal_sums_[getPolygonVertexId(i, j)] += face_normals[i];
+    }
+  }
+  for (VertexId vtx_id = 0u; vtx_id < n_vtx; ++vtx_id) {
+    updateVertexNormal(vtx_id);
+  }
 }
 
 /* --------------------------------------------------------------------------
@@ -415,15 +671,17 @@ template <typename VertexPositionType>
 bool Mesh<VertexPositionType>::setVertexColor(
     const LandmarkId& lmk_id,
     const VertexColorRGB& vertex_color) {
-  const auto& lmk_id_to_vertex_map_end = lmk_id_to_vertex_map_.end();
-  const auto& vertex_it = lmk_id_to_vertex_map_.find(lmk_id);
+  const auto& lmk_id_to_vertex_map_end = data_->lmk_id_to_vertex_map_.end();
+  const auto& vertex_it = data_->lmk_id_to_vertex_map_.find(lmk_id);
   if (vertex_it == lmk_id_to_vertex_map_end) {
     // We didn't find the lmk id!
     VLOG(100) << "Lmk id: " << lmk_id << " not found in mesh.";
     return false;
   } else {
     // Color the vertex.
-    vertices_mesh_color_.at<VertexColorRGB>(vertex_it->second) = vertex_color;
+    const VertexId vtx_id = vertex_it->second;
+    detach();
+    data_->vertices_mesh_color_.at<VertexColorRGB>(vtx_id) = vertex_color;
     return true;  // Meaning we found the vertex.
   }
 }
@@ -432,15 +690,17 @@ template <typename VertexPositionType>
 bool Mesh<VertexPositionType>::setVertexPosition(
     const LandmarkId& lmk_id,
     const VertexPositionType& vertex) {
-  const auto& lmk_id_to_vertex_map_end = lmk_id_to_vertex_map_.end();
-  const auto& vertex_it = lmk_id_to_vertex_map_.find(lmk_id);
+  const auto& lmk_id_to_vertex_map_end = data_->lmk_id_to_vertex_map_.end();
+  const auto& vertex_it = data_->lmk_id_to_vertex_map_.find(lmk_id);
   if (vertex_it == lmk_id_to_vertex_map_end) {
     // We didn't find the lmk id!
     VLOG(100) << "Lmk id: " << lmk_id << " not found in mesh.";
     return false;
   } else {
     // Change the vertex position.
-    vertices_mesh_.at<VertexPositionType>(vertex_it->second) = vertex;
+    const VertexId vtx_id = vertex_it->second;
+    detach();
+    moveVertex(vtx_id, vertex);
     return true;  // Meaning we found the vertex.
   }
 }
@@ -448,104 +708,146 @@ bool Mesh<VertexPositionType>::setVertexPosition(
 // Get a list of all lmk ids in the mesh.
 template <typename VertexPositionType>
 LandmarkIds Mesh<VertexPositionType>::getLandmarkIds() const {
-  LandmarkIds lmk_ids(lmk_id_to_vertex_map_.size());
-  size_t i = 0;
-  for (LmkIdToVertexMap::const_iterator it = lmk_id_to_vertex_map_.begin();
-       it != lmk_id_to_vertex_map_.end();
-       ++it) {
-    lmk_ids[i] = it->first;
-    i++;
-  }
-  CHECK_EQ(i, lmk_id_to_vertex_map_.size());
-  return lmk_ids;
+  CHECK_EQ(data_->vertex_to_lmk_id_map_.size(),
+           data_->lmk_id_to_vertex_map_.size());
+  return LandmarkIds(data_->vertex_to_lmk_id_map_.begin(),
+                     data_->vertex_to_lmk_id_map_.end());
 }
 
 template <typename VertexPositionType>
-void Mesh<VertexPositionType>::getVerticesMeshToMat(
-    cv::Mat* vertices_mesh) const {
+void Mesh<VertexPositionType>::getVerticesMeshToMat(cv::Mat* vertices_mesh,
+                                                    const bool& safe) const {
   CHECK_NOTNULL(vertices_mesh);
-  *vertices_mesh = vertices_mesh_.clone();
+  *vertices_mesh =
+      safe ? data_->vertices_mesh_.clone() : data_->vertices_mesh_;
 }
 
 template <typename VertexPositionType>
-void Mesh<VertexPositionType>::getPolygonsMeshToMat(
-    cv::Mat* polygons_mesh) const {
+void Mesh<VertexPositionType>::getPolygonsMeshToMat(cv::Mat* polygons_mesh,
+                                                    const bool& safe) const {
   CHECK_NOTNULL(polygons_mesh);
-  *polygons_mesh = polygons_mesh_.clone();
+  *polygons_mesh =
+      safe ? data_->polygons_mesh_.clone() : data_->polygons_mesh_;
 }
 
 template <typename VertexPositionType>
 cv::Mat Mesh<VertexPositionType>::getColorsMesh(const bool& safe) const {
-  return safe ? vertices_mesh_color_.clone() : vertices_mesh_color_;
+  return safe ? data_->vertices_mesh_color_.clone()
+              : data_->vertices_mesh_color_;
 }
 
 template <typename VertexPositionType>
 void Mesh<VertexPositionType>::setTopology(const cv::Mat& polygons_mesh) {
-  polygons_mesh_ = polygons_mesh.clone();
-  // TODO(TONI) // What about adjacency matrix!!! and face_hashes!
+  detach();
+  data_->polygons_mesh_ = polygons_mesh.clone();
+  updateConnectivityFromPolygons();
 }
 
 // Reset all data structures of the mesh.
 template <typename VertexPositionType>
 void Mesh<VertexPositionType>::clearMesh() {
-  vertices_mesh_ = cv::Mat(0, 1, CV_32FC3);
-  vertices_mesh_normal_ = VertexNormals();
-  vertices_mesh_color_ = cv::Mat(0, 0, CV_8UC3, cv::viz::Color::blue());
-  polygons_mesh_ = cv::Mat(0, 1, CV_32SC1);
-  adjacency_matrix_ = cv::Mat(1, 1, CV_8UC1, cv::Scalar(0u));
-  face_hashes_.clear();
-  vertex_to_lmk_id_map_.clear();
-  lmk_id_to_vertex_map_.clear();
+  // No need to clone the data to clear it, even if shared.
+  data_ = std::make_shared<MeshData>();
 }
 
 template <typename VertexPositionType>
-void Mesh<VertexPositionType>::save(const std::string& filepath) const {
-  cv::FileStorage fs(filepath, cv::FileStorage::WRITE);
-  fs << "vertex_to_lmk_id_map"
-     << "[";
-  for (auto&& [vertex, lmk] : vertex_to_lmk_id_map_) {
-    fs << "{";
-    fs << "v" << static_cast<int>(vertex) << "l" << static_cast<int>(lmk);
-    fs << "}";
+size_t Mesh<VertexPositionType>::getMemoryBytes() const {
+  const MeshData& data = *data_;
+  size_t bytes = utils::getVectorBytes(data.vertex_to_lmk_id_map_) +
+                 utils::getUnorderedContainerBytes(data.lmk_id_to_vertex_map_) +
+                 utils::getVectorBytes(data.vertices_mesh_normal_) +
+                 utils::getVectorBytes(data.vertex_normal_sums_) +
+                 utils::getVectorBytes(data.adjacency_lists_) +
+                 utils::getVectorBytes(data.vertex_polygons_) +
+                 utils::getUnorderedContainerBytes(data.face_hashes_);
+  for (const cv::Mat* mat : {&data.vertices_mesh_,
+                             &data.vertices_mesh_color_,
+                             &data.polygons_mesh_}) {
+    bytes += mat->total() * mat->elemSize();
+  }
+  for (const VertexIds& adjacency_list : data.adjacency_lists_) {
+    bytes += utils::getVectorBytes(adjacency_list);
+  }
+  for (const std::vector<size_t>& vertex_polygons : data.vertex_polygons_) {
+    bytes += utils::getVectorBytes(vertex_polygons);
   }
-  fs << "]";
+  return bytes;
+}
 
-  fs << "lmk_id_to_vertex_map"
-     << "[";
-  for (auto&& [lmk, vertex] : lmk_id_to_vertex_map_) {
-    fs << "{";
-    fs << "l" << static_cast<int>(lmk) << "v" << static_cast<int>(vertex);
-    fs << "}";
+template <typename VertexPositionType>
+void Mesh<VertexPositionType>::setMesh(const LandmarkIds& lmk_ids,
+                                       const cv::Mat& vertices_mesh,
+                                       const cv::Mat& vertices_mesh_color,
+                                       const cv::Mat& polygons_mesh) {
+  CHECK_EQ(lmk_ids.size(), static_cast<size_t>(vertices_mesh.rows));
+  CHECK_EQ(lmk_ids.size(), static_cast<size_t>(vertices_mesh_color.rows));
+  data_ = std::make_shared<MeshData>();
+  data_->vertex_to_lmk_id_map_.assign(lmk_ids.begin(), lmk_ids.end());
+  for (size_t vtx_id = 0u; vtx_id < lmk_ids.size(); ++vtx_id) {
+    data_->lmk_id_to_vertex_map_[lmk_ids[vtx_id]] = vtx_id;
+  }
+  CHECK_EQ(data_->lmk_id_to_vertex_map_.size(), lmk_ids.size())
+      << "Repeated landmark ids.";
+  // Empty matrices lose their type when cloned: keep the default ones.
+  if (!lmk_ids.empty()) {
+    CHECK_EQ(vertices_mesh.type(), cv::traits::Type<VertexPositionType>::value);
+    CHECK_EQ(vertices_mesh_color.type(), CV_8UC3);
+    data_->vertices_mesh_ = vertices_mesh.clone();
+    data_->vertices_mesh_color_ = vertices_mesh_color.clone();
+  }
+  if (!polygons_mesh.empty()) {
+    CHECK_EQ(polygons_mesh.type(), CV_32SC1);
+    data_->polygons_mesh_ = polygons_mesh.clone();
   }
-  fs << "]";
+  updateConnectivityFromPolygons();
+}
 
-  fs << "vertices_mesh" << vertices_mesh_;
-  fs << "vertices_mesh_normal" << vertices_mesh_normal_;
-  fs << "normals_computed" << normals_computed_;
-  fs << "vertices_mesh_color" << vertices_mesh_color_;
-  fs << "polygons_mesh" << polygons_mesh_;
-  fs << "adjacency_matrix" << adjacency_matrix_;
-  fs << "polygon_dimension" << static_cast<int>(polygon_dimension_);
-  fs << "}";
+template <typename VertexPositionType>
+void Mesh<VertexPositionType>::save(const std::string& filepath) const {
+  // A single chunk, with the vertices and polygons in order.
+  MeshLogWriter writer(filepath,
+                       sizeof(VertexPositionType) / sizeof(float),
+                       polygon_dimension_);
+  writer.append(*this, 0);
 }
 
 template <typename VertexPositionType>
 void Mesh<VertexPositionType>::load(const std::string& filepath) {
+  const MeshLogReader reader(filepath);
+  if (reader.isValid()) {
+    reader.getMesh(reader.getNrChunks(), this);
+    return;
+  }
+  LOG(WARNING) << "Not a mesh log, loading it as a cv::FileStorage mesh: "
+               << filepath;
+  loadFileStorage(filepath);
+}
+
+// Meshes saved by older versions, with all the data structures.
+template <typename VertexPositionType>
+void Mesh<VertexPositionType>::loadFileStorage(
+    const std::string& filepath) {
   cv::FileStorage fs(filepath, cv::FileStorage::READ);
+  data_ = std::make_shared<MeshData>();
   for (const auto& pair : fs["vertex_to_lmk_id_map"]) {
-    vertex_to_lmk_id_map_[static_cast<int>(pair["v"])] = static_cast<int>(pair["l"]);
+    const size_t vertex = static_cast<int>(pair["v"]);
+    if (vertex >= data_->vertex_to_lmk_id_map_.size()) {
+      data_->vertex_to_lmk_id_map_.resize(vertex + 1u);
+    }
+    data_->vertex_to_lmk_id_map_[vertex] = static_cast<int>(pair["l"]);
   }
 
   for (const auto& pair : fs["lmk_id_to_vertex_map"]) {
-    lmk_id_to_vertex_map_[static_cast<int>(pair["l"])] = static_cast<int>(pair["v"]);
+    data_->lmk_id_to_vertex_map_[static_cast<int>(pair["l"])] =
+        static_cast<int>(pair["v"]);
   }
 
-  fs["vertices_mesh"] >> vertices_mesh_;
-  fs["vertices_mesh_normal"] >> vertices_mesh_normal_;
-  fs["normals_computed"] >> normals_computed_;
-  fs["vertices_mesh_color"] >> vertices_mesh_color_;
-  fs["polygons_mesh"] >> polygons_mesh_;
-  fs["adjacency_matrix"] >> adjacency_matrix_;
+  fs["vertices_mesh"] >> data_->vertices_mesh_;
+  fs["vertices_mesh_normal"] >> data_->vertices_mesh_normal_;
+  fs["vertices_mesh_color"] >> data_->vertices_mesh_color_;
+  fs["polygons_mesh"] >> data_->polygons_mesh_;
+  // Older files also have a dense "adjacency_matrix": rebuilt from polygons.
+  updateConnectivityFromPolygons();
   CHECK_EQ(polygon_dimension_, static_cast<int>(fs["polygon_dimension"]));
 }
 
@@ -0,0 +1,504 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   MeshDecimation.cpp
+ * @brief  Incremental quadric-error decimation of the 3D mesh, to keep a
+ * coarse level of detail of it for visualization and logging.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/mesh/MeshDecimation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <queue>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <Eigen/StdVector>
+#include <glog/logging.h>
+
+namespace VIO {
+
+namespace {
+//! Minimum cosine between the normals of a triangle before and after a
+//! collapse, smaller ones are considered flips.
+static constexpr double kMinNormalCosine = 0.2;
+
+inline void hashCombine(const size_t& value, size_t* seed) {
+  *seed ^= value + 0x9e3779b97f4a7c15ull + (*seed << 6) + (*seed >> 2);
+}
+
+inline size_t hashPosition(const Vertex3D& position) {
+  size_t seed = 0u;
+  for (const float& coordinate : {position.x, position.y, position.z}) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &coordinate, sizeof(bits));
+    hashCombine(bits, &seed);
+  }
+  return seed;
+}
+
+//! Rotates the triangle so that its smallest landmark id comes first, keeping
+//! its orientation, so that equal triangles compare equal.
+inline MeshDecimator::Triangle getCanonicalTriangle(
+    const MeshDecimator::Triangle& triangle) {
+  const size_t first = static_cast<size_t>(
+      std::min_element(triangle.begin(), triangle.end()) - triangle.begin());
+  return {triangle[first],
+          triangle[(first + 1u) % 3u],
+          triangle[(first + 2u) % 3u]};
+}
+
+inline Eigen::Vector3d toEigen(const Vertex3D& position) {
+  return Eigen::Vector3d(position.x, position.y, position.z);
+}
+
+inline Eigen::Vector3d getNormal(const Eigen::Vector3d& a,
+                                 const Eigen::Vector3d& b,
+                                 const Eigen::Vector3d& c) {
+  return (b - a).cross(c - a);
+}
+
+//! Quadric of the plane of a triangle, zero if the triangle is degenerate.
+Eigen::Matrix4d getTriangleQuadric(const Eigen::Vector3d& a,
+                                   const Eigen::Vector3d& b,
+                                   const Eigen::Vector3d& c) {
+  Eigen::Vector3d normal = getNormal(a, b, c);
+  const double norm = normal.norm();
+  if (norm < 1e-12) {
+    return Eigen::Matrix4d::Zero();
+  }
+  normal /= norm;
+  Eigen::Vector4d plane;
+  plane << normal, -normal.dot(a);
+  return plane * plane.transpose();
+}
+
+inline double getQuadricError(const Eigen::Matrix4d& quadric,
+                              const Eigen::Vector3d& point) {
+  Eigen::Vector4d point_h;
+  point_h << point, 1.0;
+  return std::max(0.0, point_h.dot(quadric * point_h));
+}
+
+inline std::uint64_t getEdgeKey(const int& a, const int& b) {
+  return (static_cast<std::uint64_t>(std::min(a, b)) << 32u) |
+         static_cast<std::uint32_t>(std::max(a, b));
+}
+
+//! Collapse of the edge (keep, removed) into keep, moved to target.
+struct Collapse {
+  double cost_;
+  int keep_;
+  int removed_;
+  Eigen::Vector3d target_;
+  //! Versions of the vertices when the collapse was computed, it is stale if
+  //! any of them changed since.
+  size_t keep_version_;
+  size_t removed_version_;
+
+  inline bool operator>(const Collapse& other) const {
+    return cost_ > other.cost_;
+  }
+};
+}  // namespace
+
+MeshDecimator::MeshDecimator(const MeshDecimationParams& params)
+    : params_(params), cells_(), coarse_mesh_(3u) {
+  CHECK_GT(params_.cell_size_, 0.0);
+  CHECK_GT(params_.target_ratio_, 0.0);
+  CHECK_LE(params_.target_ratio_, 1.0);
+  CHECK_GE(params_.max_error_, 0.0);
+}
+
+const Mesh3D& MeshDecimator::update(const Mesh3D& mesh) {
+  CHECK_EQ(mesh.getMeshPolygonDimension(), 3u)
+      << "Only triangle meshes can be decimated.";
+  nr_decimated_cells_ = 0u;
+
+  // Triangles of the full mesh by cell, and cells of each vertex.
+  std::unordered_map<CellKey, std::vector<Triangle>> cell_triangles;
+  std::unordered_map<LandmarkId, std::vector<CellKey>> vertex_cells;
+  LmkIdToPosition positions;
+  positions.reserve(mesh.getNumberOfUniqueVertices());
+  vertex_cells.reserve(mesh.getNumberOfUniqueVertices());
+  for (size_t polygon_idx = 0u; polygon_idx < mesh.getNumberOfPolygons();
+       ++polygon_idx) {
+    Triangle triangle;
+    Vertex3D centroid(0.0f, 0.0f, 0.0f);
+    for (size_t j = 0u; j < 3u; ++j) {
+      CHECK(mesh.getLmkIdForVtxId(mesh.getPolygonVertexId(polygon_idx, j),
+                                  &triangle[j]));
+      const Vertex3D& position = mesh.getPolygonVertexPosition(polygon_idx, j);
+      positions[triangle[j]] = position;
+      centroid += position;
+    }
+    const CellKey cell_key = getCellKey(centroid / 3.0f);
+    cell_triangles[cell_key].push_back(getCanonicalTriangle(triangle));
+    for (const LandmarkId& lmk_id : triangle) {
+      std::vector<CellKey>& cells = vertex_cells[lmk_id];
+      if (std::find(cells.begin(), cells.end(), cell_key) == cells.end()) {
+        cells.push_back(cell_key);
+      }
+    }
+  }
+
+  // Drop the cells left without triangles.
+  for (auto it = cells_.begin(); it != cells_.end();) {
+    if (cell_triangles.find(it->first) == cell_triangles.end()) {
+      it = cells_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  // Decimate the cells whose triangles, or the vertices they share with other
+  // cells, changed.
+  for (auto& key_and_triangles : cell_triangles) {
+    std::vector<Triangle>& triangles = key_and_triangles.second;
+    // The order of the polygons in the mesh changes with removals.
+    std::sort(triangles.begin(), triangles.end());
+    std::vector<LandmarkId> locked;
+    size_t signature = 0u;
+    for (const Triangle& triangle : triangles) {
+      for (const LandmarkId& lmk_id : triangle) {
+        hashCombine(std::hash<LandmarkId>{}(lmk_id), &signature);
+        hashCombine(hashPosition(positions.at(lmk_id)), &signature);
+        if (vertex_cells.at(lmk_id).size() > 1u) {
+          locked.push_back(lmk_id);
+        }
+      }
+    }
+    std::sort(locked.begin(), locked.end());
+    locked.erase(std::unique(locked.begin(), locked.end()), locked.end());
+    for (const LandmarkId& lmk_id : locked) {
+      hashCombine(std::hash<LandmarkId>{}(lmk_id), &signature);
+    }
+
+    Cell& cell = cells_[key_and_triangles.first];
+    if (!cell.triangles_.empty() && cell.signature_ == signature) {
+      continue;
+    }
+    cell.signature_ = signature;
+    decimate(triangles,
+             positions,
+             locked,
+             params_,
+             &cell.triangles_,
+             &cell.positions_);
+    ++nr_decimated_cells_;
+  }
+  VLOG(10) << "Mesh decimation: " << nr_decimated_cells_ << " of "
+           << cells_.size() << " cells decimated.";
+
+  // Stitch the coarse cells, with the colors of the full mesh.
+  const cv::Mat colors = mesh.getColorsMesh(false);
+  LandmarkIds lmk_ids;
+  std::vector<Vertex3D> vertices;
+  std::vector<cv::Vec3b> vertices_colors;
+  std::vector<int32_t> polygons;
+  std::unordered_map<LandmarkId, int32_t> lmk_id_to_vtx_id;
+  for (const auto& key_and_cell : cells_) {
+    const Cell& cell = key_and_cell.second;
+    for (const Triangle& triangle : cell.triangles_) {
+      polygons.push_back(3);
+      for (const LandmarkId& lmk_id : triangle) {
+        const auto& inserted = lmk_id_to_vtx_id.emplace(
+            lmk_id, static_cast<int32_t>(lmk_ids.size()));
+        if (inserted.second) {
+          lmk_ids.push_back(lmk_id);
+          vertices.push_back(cell.positions_.at(lmk_id));
+          Mesh3D::VertexId vtx_id;
+          CHECK(mesh.getVtxIdForLmkId(lmk_id, &vtx_id));
+          vertices_colors.push_back(
+              static_cast<int>(vtx_id) < colors.rows
+                  ? colors.at<cv::Vec3b>(static_cast<int>(vtx_id))
+                  : cv::Vec3b(255u, 255u, 255u));
+        }
+        polygons.push_back(inserted.first->second);
+      }
+    }
+  }
+  // setMesh clones the matrices.
+  coarse_mesh_.setMesh(lmk_ids,
+                       cv::Mat(vertices, false),
+                       cv::Mat(vertices_colors, false),
+                       cv::Mat(polygons, false));
+  return coarse_mesh_;
+}
+
+void MeshDecimator::clear() {
+  cells_.clear();
+  nr_decimated_cells_ = 0u;
+  coarse_mesh_.clearMesh();
+}
+
+void MeshDecimator::decimate(const std::vector<Triangle>& triangles,
+                             const LmkIdToPosition& positions,
+                             const std::vector<LandmarkId>& locked,
+                             const MeshDecimationParams& params,
+                             std::vector<Triangle>* decimated,
+                             LmkIdToPosition* decimated_positions) {
+  CHECK_NOTNULL(decimated)->clear();
+  CHECK_NOTNULL(decimated_positions)->clear();
+
+  // Local indices of the vertices.
+  std::unordered_map<LandmarkId, int> lmk_id_to_idx;
+  std::vector<LandmarkId> lmk_ids;
+  std::vector<Eigen::Vector3d> points;
+  std::vector<std::array<int, 3>> faces;
+  faces.reserve(triangles.size());
+  for (const Triangle& triangle : triangles) {
+    std::array<int, 3> face;
+    for (size_t j = 0u; j < 3u; ++j) {
+      auto it = lmk_id_to_idx.find(triangle[j]);
+      if (it == lmk_id_to_idx.end()) {
+        const auto& position_it = positions.find(triangle[j]);
+        CHECK(position_it != positions.end())
+            << "Missing position of landmark " << triangle[j];
+        it = lmk_id_to_idx
+                 .emplace(triangle[j], static_cast<int>(lmk_ids.size()))
+                 .first;
+        lmk_ids.push_back(triangle[j]);
+        points.push_back(toEigen(position_it->second));
+      }
+      face[j] = it->second;
+    }
+    faces.push_back(face);
+  }
+  const size_t nr_vertices = lmk_ids.size();
+
+  std::vector<std::vector<int>> vertex_faces(nr_vertices);
+  std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d>>
+      quadrics(nr_vertices, Eigen::Matrix4d::Zero());
+  std::unordered_map<std::uint64_t, size_t> edge_nr_faces;
+  for (size_t face_idx = 0u; face_idx < faces.size(); ++face_idx) {
+    const std::array<int, 3>& face = faces[face_idx];
+    const Eigen::Matrix4d quadric = getTriangleQuadric(
+        points[face[0]], points[face[1]], points[face[2]]);
+    for (size_t j = 0u; j < 3u; ++j) {
+      vertex_faces[face[j]].push_back(static_cast<int>(face_idx));
+      quadrics[face[j]] += quadric;
+      ++edge_nr_faces[getEdgeKey(face[j], face[(j + 1u) % 3u])];
+    }
+  }
+
+  // Lock the given vertices, the ones on the border of the mesh (edges of a
+  // single face) and the ones of non-manifold edges.
+  std::vector<bool> is_locked(nr_vertices, false);
+  for (const LandmarkId& lmk_id : locked) {
+    const auto& it = lmk_id_to_idx.find(lmk_id);
+    if (it != lmk_id_to_idx.end()) {
+      is_locked[it->second] = true;
+    }
+  }
+  for (const auto& edge_and_nr_faces : edge_nr_faces) {
+    if (edge_and_nr_faces.second != 2u) {
+      is_locked[edge_and_nr_faces.first >> 32u] = true;
+      is_locked[edge_and_nr_faces.first & 0xFFFFFFFFu] = true;
+    }
+  }
+
+  std::vector<bool> is_face_alive(faces.size(), true);
+  std::vector<size_t> versions(nr_vertices, 0u);
+
+  const auto getNeighbours = [&](const int& vtx) {
+    std::vector<int> neighbours;
+    for (const int& face_idx : vertex_faces[vtx]) {
+      for (const int& other_vtx : faces[face_idx]) {
+        if (other_vtx != vtx) {
+          neighbours.push_back(other_vtx);
+        }
+      }
+    }
+    std::sort(neighbours.begin(), neighbours.end());
+    neighbours.erase(std::unique(neighbours.begin(), neighbours.end()),
+                     neighbours.end());
+    return neighbours;
+  };
+
+  const auto getCollapse = [&](int keep, int removed, Collapse* collapse) {
+    if (is_locked[keep] && is_locked[removed]) {
+      return false;
+    }
+    // A locked vertex is always the one kept, and is not moved.
+    if (is_locked[removed]) {
+      std::swap(keep, removed);
+    }
+    const Eigen::Matrix4d quadric = quadrics[keep] + quadrics[removed];
+    collapse->keep_ = keep;
+    collapse->removed_ = removed;
+    collapse->target_ = points[keep];
+    collapse->cost_ = getQuadricError(quadric, points[keep]);
+    if (!is_locked[keep]) {
+      for (const Eigen::Vector3d& target :
+           {Eigen::Vector3d(points[removed]),
+            Eigen::Vector3d(0.5 * (points[keep] + points[removed]))}) {
+        const double cost = getQuadricError(quadric, target);
+        if (cost < collapse->cost_) {
+          collapse->cost_ = cost;
+          collapse->target_ = target;
+        }
+      }
+    }
+    collapse->keep_version_ = versions[keep];
+    collapse->removed_version_ = versions[removed];
+    return true;
+  };
+
+  std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>>
+      collapses;
+  const auto pushCollapses = [&](const int& vtx, const bool& only_larger) {
+    for (const int& neighbour : getNeighbours(vtx)) {
+      Collapse collapse;
+      if ((!only_larger || neighbour > vtx) &&
+          getCollapse(vtx, neighbour, &collapse)) {
+        collapses.push(collapse);
+      }
+    }
+  };
+  for (size_t vtx = 0u; vtx < nr_vertices; ++vtx) {
+    pushCollapses(static_cast<int>(vtx), true);
+  }
+
+  size_t nr_faces = faces.size();
+  const size_t target_nr_faces = std::max<size_t>(
+      1u,
+      static_cast<size_t>(std::ceil(params.target_ratio_ * faces.size())));
+  while (nr_faces > target_nr_faces && !collapses.empty()) {
+    const Collapse collapse = collapses.top();
+    collapses.pop();
+    if (collapse.cost_ > params.max_error_) {
+      break;
+    }
+    const int& keep = collapse.keep_;
+    const int& removed = collapse.removed_;
+    if (versions[keep] != collapse.keep_version_ ||
+        versions[removed] != collapse.removed_version_) {
+      continue;
+    }
+
+    // Link condition: the edge must only share the vertices of its faces,
+    // otherwise the collapse pinches the mesh.
+    const std::vector<int> keep_neighbours = getNeighbours(keep);
+    const std::vector<int> removed_neighbours = getNeighbours(removed);
+    std::vector<int> common_neighbours;
+    std::set_intersection(keep_neighbours.begin(),
+                          keep_neighbours.end(),
+                          removed_neighbours.begin(),
+                          removed_neighbours.end(),
+                          std::back_inserter(common_neighbours));
+    size_t nr_edge_faces = 0u;
+    for (const int& face_idx : vertex_faces[removed]) {
+      const std::array<int, 3>& face = faces[face_idx];
+      nr_edge_faces += std::count(face.begin(), face.end(), keep);
+    }
+    if (common_neighbours.size() != nr_edge_faces) {
+      continue;
+    }
+
+    // The faces that are kept must not flip nor degenerate.
+    bool is_valid = true;
+    for (const int& vtx : {keep, removed}) {
+      for (const int& face_idx : vertex_faces[vtx]) {
+        const std::array<int, 3>& face = faces[face_idx];
+        if (std::count(face.begin(), face.end(), keep) &&
+            std::count(face.begin(), face.end(), removed)) {
+          continue;
+        }
+        std::array<Eigen::Vector3d, 3> face_points;
+        for (size_t j = 0u; j < 3u; ++j) {
+          face_points[j] = face[j] == vtx ? collapse.target_ : points[face[j]];
+        }
+        const Eigen::Vector3d old_normal =
+            getNormal(points[face[0]], points[face[1]], points[face[2]]);
+        const Eigen::Vector3d new_normal =
+            getNormal(face_points[0], face_points[1], face_points[2]);
+        if (new_normal.norm() < 1e-12 ||
+            (old_normal.norm() > 1e-12 &&
+             old_normal.normalized().dot(new_normal.normalized()) <
+                 kMinNormalCosine)) {
+          is_valid = false;
+          break;
+        }
+      }
+      if (!is_valid) break;
+    }
+    if (!is_valid) {
+      continue;
+    }
+
+    // Collapse: the faces of the edge die, the others of removed go to keep.
+    for (const int& face_idx : vertex_faces[removed]) {
+      std::array<int, 3>& face = faces[face_idx];
+      if (std::count(face.begin(), face.end(), keep)) {
+        is_face_alive[face_idx] = false;
+        --nr_faces;
+      } else {
+        std::replace(face.begin(), face.end(), removed, keep);
+        vertex_faces[keep].push_back(face_idx);
+      }
+    }
+    vertex_faces[removed].clear();
+    std::vector<int>& keep_faces = vertex_faces[keep];
+    keep_faces.erase(std::remove_if(keep_faces.begin(),
+                                    keep_faces.end(),
+                                    [&is_face_alive](const int& face_idx) {
+                                      return !is_face_alive[face_idx];
+                                    }),
+                     keep_faces.end());
+    // The dead faces are also removed from the lists of the common
+    // neighbours.
+    for (const int& neighbour : common_neighbours) {
+      std::vector<int>& neighbour_faces = vertex_faces[neighbour];
+      neighbour_faces.erase(std::remove_if(neighbour_faces.begin(),
+                                           neighbour_faces.end(),
+                                           [&is_face_alive](const int& idx) {
+                                             return !is_face_alive[idx];
+                                           }),
+                            neighbour_faces.end());
+    }
+    points[keep] = collapse.target_;
+    quadrics[keep] += quadrics[removed];
+    ++versions[keep];
+    ++versions[removed];
+    pushCollapses(keep, false);
+  }
+
+  for (size_t face_idx = 0u; face_idx < faces.size(); ++face_idx) {
+    if (!is_face_alive[face_idx]) continue;
+    Triangle triangle;
+    for (size_t j = 0u; j < 3u; ++j) {
+      const int& vtx = faces[face_idx][j];
+      triangle[j] = lmk_ids[vtx];
+      decimated_positions->emplace(lmk_ids[vtx],
+                                   Vertex3D(static_cast<float>(points[vtx].x()),
+                                            static_cast<float>(points[vtx].y()),
+                                            static_cast<float>(points[vtx].z())));
+    }
+    decimated->push_back(triangle);
+  }
+}
+
+MeshDecimator::CellKey MeshDecimator::getCellKey(const Vertex3D& point) const {
+  // 21 bits per axis.
+  const auto get_axis_key = [this](const float& x) {
+    return static_cast<CellKey>(static_cast<std::int64_t>(
+               std::floor(static_cast<double>(x) / params_.cell_size_))) &
+           0x1FFFFFu;
+  };
+  return get_axis_key(point.x) | (get_axis_key(point.y) << 21u) |
+         (get_axis_key(point.z) << 42u);
+}
+
+}  // namespace VIO
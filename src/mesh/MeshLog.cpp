@@ -0,0 +1,436 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   MeshLog.cpp
+ * @brief  Binary, append-only log of a mesh, as one chunk of changes per
+ * keyframe, and its memory-mapped reader.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/mesh/MeshLog.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+#include <glog/logging.h>
+
+#include "kimera-vio/utils/MappedFile.h"
+#include "kimera-vio/utils/UtilsNumerical.h"
+
+namespace VIO {
+
+namespace {
+
+// "KVML", and version of the layout in MeshLog.h.
+constexpr uint32_t kMeshLogMagic = 0x4b564d4c;
+constexpr uint32_t kMeshLogVersion = 1u;
+// "KVMC", at the start of each chunk.
+constexpr uint32_t kChunkMagic = 0x4b564d43;
+// magic, version, vertex dimension, polygon dimension (uint32).
+constexpr size_t kHeaderSize = 16u;
+// magic, padding (uint32), timestamp (int64), 4 counts (uint64).
+constexpr size_t kChunkHeaderSize = 48u;
+// Arrays are padded so that they are all aligned in the mapping.
+constexpr size_t kArrayAlignment = 8u;
+
+inline size_t paddedSize(const size_t& size) {
+  return (size + kArrayAlignment - 1u) / kArrayAlignment * kArrayAlignment;
+}
+
+template <typename T>
+void write(std::ostream& stream, const T& field) {
+  stream.write(reinterpret_cast<const char*>(&field), sizeof(T));
+}
+
+template <typename T>
+void writeArray(std::ostream& stream, const std::vector<T>& array) {
+  static const char kZeros[kArrayAlignment] = {};
+  const size_t size = array.size() * sizeof(T);
+  stream.write(reinterpret_cast<const char*>(array.data()), size);
+  stream.write(kZeros, paddedSize(size) - size);
+}
+
+template <typename T>
+T read(const uchar* data) {
+  T field;
+  std::memcpy(&field, data, sizeof(T));
+  return field;
+}
+
+size_t chunkArraysSize(const size_t& vertex_dim,
+                       const size_t& polygon_dim,
+                       const uint64_t& nr_removed_vertices,
+                       const uint64_t& nr_removed_faces,
+                       const uint64_t& nr_vertices,
+                       const uint64_t& nr_faces) {
+  return paddedSize(nr_removed_vertices * sizeof(int64_t)) +
+         paddedSize(nr_removed_faces * sizeof(uint64_t)) +
+         paddedSize(nr_vertices * sizeof(int64_t)) +
+         paddedSize(nr_vertices * vertex_dim * sizeof(float)) +
+         paddedSize(nr_vertices * 3u * sizeof(uint8_t)) +
+         paddedSize(nr_faces * sizeof(uint64_t)) +
+         paddedSize(nr_faces * polygon_dim * sizeof(int64_t));
+}
+
+//! Consecutive arrays of a chunk, read in place in the mapping.
+class ChunkArrays {
+ public:
+  explicit ChunkArrays(const uchar* data) : data_(data) {}
+
+  template <typename T>
+  const T* next(const size_t& size) {
+    const T* array = reinterpret_cast<const T*>(data_);
+    data_ += paddedSize(size * sizeof(T));
+    return array;
+  }
+
+ private:
+  const uchar* data_;
+};
+
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+size_t MeshLogWriter::FaceKeyHash::operator()(const FaceKey& key) const {
+  return UtilsNumerical::hashTriplet(key[0], key[1], key[2]);
+}
+
+/* -------------------------------------------------------------------------- */
+MeshLogWriter::MeshLogWriter(const std::string& filepath,
+                             const size_t& vertex_dim,
+                             const size_t& polygon_dim,
+                             const bool& log_removals)
+    : vertex_dim_(vertex_dim),
+      polygon_dim_(polygon_dim),
+      log_removals_(log_removals),
+      stream_(filepath, std::ios::binary | std::ios::trunc),
+      nr_chunks_(0u),
+      generation_(0u),
+      next_face_id_(0u),
+      vertices_(),
+      faces_(),
+      memory_("Mesh log state") {
+  CHECK(vertex_dim_ == 2u || vertex_dim_ == 3u);
+  CHECK_EQ(polygon_dim_, 3u) << "Only triangle meshes can be logged.";
+  CHECK(stream_.is_open()) << "Cannot open mesh log: " << filepath;
+  write(stream_, kMeshLogMagic);
+  write(stream_, kMeshLogVersion);
+  write(stream_, static_cast<uint32_t>(vertex_dim_));
+  write(stream_, static_cast<uint32_t>(polygon_dim_));
+  stream_.flush();
+}
+
+/* -------------------------------------------------------------------------- */
+template <typename VertexPosition>
+void MeshLogWriter::append(const Mesh<VertexPosition>& mesh,
+                           const Timestamp& timestamp) {
+  CHECK_EQ(sizeof(VertexPosition), vertex_dim_ * sizeof(float));
+  // Views, no copies.
+  cv::Mat vertices, polygons_mesh;
+  mesh.getVerticesMeshToMat(&vertices, false);
+  mesh.getPolygonsMeshToMat(&polygons_mesh, false);
+  append(timestamp,
+         mesh.getLandmarkIds(),
+         vertices,
+         mesh.getColorsMesh(false),
+         polygons_mesh);
+}
+
+/* -------------------------------------------------------------------------- */
+void MeshLogWriter::append(const Timestamp& timestamp,
+                           const LandmarkIds& lmk_ids,
+                           const cv::Mat& vertices,
+                           const cv::Mat& colors,
+                           const cv::Mat& polygons_mesh) {
+  const int nr_vertices = static_cast<int>(lmk_ids.size());
+  CHECK_EQ(vertices.rows, nr_vertices);
+  CHECK_EQ(colors.rows, nr_vertices);
+  if (nr_vertices > 0) {
+    CHECK_EQ(vertices.depth(), CV_32F);
+    CHECK_EQ(static_cast<size_t>(vertices.cols * vertices.channels()),
+             vertex_dim_);
+    CHECK_EQ(colors.depth(), CV_8U);
+    CHECK_EQ(colors.cols * colors.channels(), 3);
+  }
+  const int polygon_size = static_cast<int>(polygon_dim_) + 1;
+  CHECK_EQ(polygons_mesh.rows % polygon_size, 0);
+  CHECK(polygons_mesh.empty() || polygons_mesh.type() == CV_32SC1);
+  ++generation_;
+
+  // Vertices added, moved or recolored since the previous chunk.
+  std::vector<int64_t> vertex_lmk_ids;
+  std::vector<float> positions;
+  std::vector<uint8_t> vertex_colors;
+  for (int i = 0; i < nr_vertices; ++i) {
+    std::array<float, 3> position = {0.0f, 0.0f, 0.0f};
+    std::copy_n(vertices.ptr<float>(i), vertex_dim_, position.begin());
+    std::array<uint8_t, 3> color;
+    std::copy_n(colors.ptr<uint8_t>(i), 3u, color.begin());
+    const auto& it_new = vertices_.try_emplace(lmk_ids[i]);
+    LoggedVertex& vertex = it_new.first->second;
+    if (it_new.second || vertex.position != position ||
+        vertex.color != color) {
+      vertex.position = position;
+      vertex.color = color;
+      vertex_lmk_ids.push_back(lmk_ids[i]);
+      positions.insert(
+          positions.end(), position.begin(), position.begin() + vertex_dim_);
+      vertex_colors.insert(vertex_colors.end(), color.begin(), color.end());
+    }
+    vertex.generation = generation_;
+  }
+
+  // Faces added since the previous chunk, whatever their vertex ids.
+  std::vector<uint64_t> face_ids;
+  std::vector<int64_t> face_lmk_ids;
+  for (int k = 0; k < polygons_mesh.rows; k += polygon_size) {
+    FaceKey face;
+    for (size_t j = 0u; j < polygon_dim_; ++j) {
+      const int32_t& vtx_id = polygons_mesh.at<int32_t>(k + j + 1);
+      CHECK(vtx_id >= 0 && vtx_id < nr_vertices);
+      face[j] = lmk_ids[vtx_id];
+    }
+    FaceKey key = face;
+    std::sort(key.begin(), key.end());
+    const auto& it_new = faces_.try_emplace(key);
+    LoggedFace& logged_face = it_new.first->second;
+    if (it_new.second) {
+      logged_face.id = next_face_id_++;
+      face_ids.push_back(logged_face.id);
+      // Keeps the orientation of the face.
+      face_lmk_ids.insert(face_lmk_ids.end(), face.begin(), face.end());
+    }
+    logged_face.generation = generation_;
+  }
+
+  // What was not seen above has been removed from the mesh.
+  std::vector<int64_t> removed_lmk_ids;
+  std::vector<uint64_t> removed_face_ids;
+  if (log_removals_) {
+    for (auto it = vertices_.begin(); it != vertices_.end();) {
+      if (it->second.generation == generation_) {
+        ++it;
+        continue;
+      }
+      removed_lmk_ids.push_back(it->first);
+      it = vertices_.erase(it);
+    }
+    for (auto it = faces_.begin(); it != faces_.end();) {
+      if (it->second.generation == generation_) {
+        ++it;
+        continue;
+      }
+      removed_face_ids.push_back(it->second.id);
+      it = faces_.erase(it);
+    }
+  }
+
+  write(stream_, kChunkMagic);
+  write(stream_, static_cast<uint32_t>(0u));
+  write(stream_, static_cast<int64_t>(timestamp));
+  write(stream_, static_cast<uint64_t>(removed_lmk_ids.size()));
+  write(stream_, static_cast<uint64_t>(removed_face_ids.size()));
+  write(stream_, static_cast<uint64_t>(vertex_lmk_ids.size()));
+  write(stream_, static_cast<uint64_t>(face_ids.size()));
+  writeArray(stream_, removed_lmk_ids);
+  writeArray(stream_, removed_face_ids);
+  writeArray(stream_, vertex_lmk_ids);
+  writeArray(stream_, positions);
+  writeArray(stream_, vertex_colors);
+  writeArray(stream_, face_ids);
+  writeArray(stream_, face_lmk_ids);
+  stream_.flush();
+  CHECK(stream_.good()) << "Failed to write the mesh log.";
+  ++nr_chunks_;
+  memory_.set(utils::getUnorderedContainerBytes(vertices_) +
+              utils::getUnorderedContainerBytes(faces_));
+  VLOG(10) << "Mesh log chunk: " << vertex_lmk_ids.size() << " vertices and "
+           << face_ids.size() << " faces added, " << removed_lmk_ids.size()
+           << " vertices and " << removed_face_ids.size()
+           << " faces removed.";
+}
+
+/* -------------------------------------------------------------------------- */
+MeshLogReader::MeshLogReader(const std::string& filepath)
+    : file_(nullptr), vertex_dim_(0u), polygon_dim_(0u), chunks_() {
+  std::error_code error;
+  const size_t size = std::filesystem::file_size(filepath, error);
+  if (error || size < kHeaderSize) return;
+  const std::shared_ptr<const MappedFile> file =
+      std::make_shared<const MappedFile>(filepath);
+  const uchar* data = file->data();
+  if (read<uint32_t>(data) != kMeshLogMagic ||
+      read<uint32_t>(data + 4u) != kMeshLogVersion) {
+    return;
+  }
+  vertex_dim_ = read<uint32_t>(data + 8u);
+  polygon_dim_ = read<uint32_t>(data + 12u);
+  if ((vertex_dim_ != 2u && vertex_dim_ != 3u) || polygon_dim_ != 3u) {
+    LOG(WARNING) << "Unsupported mesh log: " << filepath;
+    return;
+  }
+
+  // Index the chunks, up to the first one cut short.
+  size_t offset = kHeaderSize;
+  while (offset + kChunkHeaderSize <= size) {
+    const uchar* header = data + offset;
+    if (read<uint32_t>(header) != kChunkMagic) break;
+    Chunk chunk;
+    chunk.timestamp = read<int64_t>(header + 8u);
+    chunk.nr_removed_vertices = read<uint64_t>(header + 16u);
+    chunk.nr_removed_faces = read<uint64_t>(header + 24u);
+    chunk.nr_vertices = read<uint64_t>(header + 32u);
+    chunk.nr_faces = read<uint64_t>(header + 40u);
+    chunk.offset = offset + kChunkHeaderSize;
+    // Also rejects counts that would overflow the size below.
+    if (std::max({chunk.nr_removed_vertices,
+                  chunk.nr_removed_faces,
+                  chunk.nr_vertices,
+                  chunk.nr_faces}) > size) {
+      break;
+    }
+    const size_t arrays_size = chunkArraysSize(vertex_dim_,
+                                               polygon_dim_,
+                                               chunk.nr_removed_vertices,
+                                               chunk.nr_removed_faces,
+                                               chunk.nr_vertices,
+                                               chunk.nr_faces);
+    if (chunk.offset + arrays_size > size) break;
+    chunks_.push_back(chunk);
+    offset = chunk.offset + arrays_size;
+  }
+  LOG_IF(WARNING, offset != size)
+      << "Ignoring the last " << size - offset
+      << " bytes of the mesh log, which were not fully written: " << filepath;
+  file_ = file;
+}
+
+/* -------------------------------------------------------------------------- */
+Timestamp MeshLogReader::getTimestamp(const size_t& chunk_idx) const {
+  CHECK_LT(chunk_idx, chunks_.size());
+  return chunks_[chunk_idx].timestamp;
+}
+
+/* -------------------------------------------------------------------------- */
+template <typename VertexPosition>
+void MeshLogReader::getMesh(const size_t& nr_chunks,
+                            Mesh<VertexPosition>* mesh) const {
+  CHECK_NOTNULL(mesh);
+  CHECK(isValid());
+  CHECK_LE(nr_chunks, chunks_.size());
+  CHECK_EQ(sizeof(VertexPosition), vertex_dim_ * sizeof(float))
+      << "The mesh log is not of a mesh of this dimension.";
+  CHECK_EQ(mesh->getMeshPolygonDimension(), polygon_dim_);
+  typedef typename Mesh<VertexPosition>::VertexColorRGB VertexColorRGB;
+  typedef std::array<LandmarkId, 3> Face;
+
+  // Replayed mesh, removals move the last vertex/face in place.
+  LandmarkIds lmk_ids;
+  std::vector<VertexPosition> positions;
+  std::vector<VertexColorRGB> colors;
+  std::unordered_map<LandmarkId, size_t> lmk_id_to_idx;
+  std::vector<uint64_t> face_ids;
+  std::vector<Face> faces;
+  std::unordered_map<uint64_t, size_t> face_id_to_idx;
+  for (size_t c = 0u; c < nr_chunks; ++c) {
+    const Chunk& chunk = chunks_[c];
+    ChunkArrays arrays(file_->data() + chunk.offset);
+    const int64_t* removed_lmk_ids =
+        arrays.next<int64_t>(chunk.nr_removed_vertices);
+    const uint64_t* removed_face_ids =
+        arrays.next<uint64_t>(chunk.nr_removed_faces);
+    const int64_t* vertex_lmk_ids = arrays.next<int64_t>(chunk.nr_vertices);
+    const float* vertex_positions =
+        arrays.next<float>(chunk.nr_vertices * vertex_dim_);
+    const uint8_t* vertex_colors = arrays.next<uint8_t>(chunk.nr_vertices * 3u);
+    const uint64_t* new_face_ids = arrays.next<uint64_t>(chunk.nr_faces);
+    const int64_t* face_lmk_ids =
+        arrays.next<int64_t>(chunk.nr_faces * polygon_dim_);
+
+    for (uint64_t i = 0u; i < chunk.nr_removed_faces; ++i) {
+      const auto& it = face_id_to_idx.find(removed_face_ids[i]);
+      if (it == face_id_to_idx.end()) continue;
+      const size_t idx = it->second;
+      face_id_to_idx.erase(it);
+      if (idx + 1u != faces.size()) {
+        face_ids[idx] = face_ids.back();
+        faces[idx] = faces.back();
+        face_id_to_idx[face_ids[idx]] = idx;
+      }
+      face_ids.pop_back();
+      faces.pop_back();
+    }
+    for (uint64_t i = 0u; i < chunk.nr_removed_vertices; ++i) {
+      const auto& it = lmk_id_to_idx.find(removed_lmk_ids[i]);
+      if (it == lmk_id_to_idx.end()) continue;
+      const size_t idx = it->second;
+      lmk_id_to_idx.erase(it);
+      if (idx + 1u != lmk_ids.size()) {
+        lmk_ids[idx] = lmk_ids.back();
+        positions[idx] = positions.back();
+        colors[idx] = colors.back();
+        lmk_id_to_idx[lmk_ids[idx]] = idx;
+      }
+      lmk_ids.pop_back();
+      positions.pop_back();
+      colors.pop_back();
+    }
+    for (uint64_t i = 0u; i < chunk.nr_vertices; ++i) {
+      const auto& it_new =
+          lmk_id_to_idx.try_emplace(vertex_lmk_ids[i], lmk_ids.size());
+      if (it_new.second) {
+        lmk_ids.push_back(vertex_lmk_ids[i]);
+        positions.emplace_back();
+        colors.emplace_back();
+      }
+      const size_t idx = it_new.first->second;
+      std::memcpy(&positions[idx],
+                  vertex_positions + i * vertex_dim_,
+                  sizeof(VertexPosition));
+      const uint8_t* color = vertex_colors + i * 3u;
+      colors[idx] = VertexColorRGB(color[0], color[1], color[2]);
+    }
+    for (uint64_t i = 0u; i < chunk.nr_faces; ++i) {
+      face_id_to_idx[new_face_ids[i]] = faces.size();
+      face_ids.push_back(new_face_ids[i]);
+      const int64_t* face = face_lmk_ids + i * polygon_dim_;
+      faces.push_back({face[0], face[1], face[2]});
+    }
+  }
+
+  std::vector<int32_t> polygons_mesh;
+  polygons_mesh.reserve(faces.size() * (polygon_dim_ + 1u));
+  for (const Face& face : faces) {
+    polygons_mesh.push_back(static_cast<int32_t>(polygon_dim_));
+    for (const LandmarkId& lmk_id : face) {
+      const auto& it = lmk_id_to_idx.find(lmk_id);
+      CHECK(it != lmk_id_to_idx.end())
+          << "Mesh log face with unknown landmark: " << lmk_id;
+      polygons_mesh.push_back(static_cast<int32_t>(it->second));
+    }
+  }
+  mesh->setMesh(lmk_ids,
+                cv::Mat(positions, true),
+                cv::Mat(colors, true),
+                cv::Mat(polygons_mesh, true));
+}
+
+// explicit instantiations
+template void MeshLogWriter::append(const Mesh<Vertex2D>& mesh,
+                                    const Timestamp& timestamp);
+template void MeshLogWriter::append(const Mesh<Vertex3D>& mesh,
+                                    const Timestamp& timestamp);
+template void MeshLogReader::getMesh(const size_t& nr_chunks,
+                                     Mesh<Vertex2D>* mesh) const;
+template void MeshLogReader::getMesh(const size_t& nr_chunks,
+                                     Mesh<Vertex3D>* mesh) const;
+
+}  // namespace VIO
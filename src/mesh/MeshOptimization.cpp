@@ -18,11 +18,13 @@
 #include <gtsam/geometry/Cal3_S2.h>
 #include <gtsam/geometry/Pose3.h>
 #include <gtsam/linear/GaussianFactorGraph.h>
+#include <gtsam/linear/iterative.h>
 #include <gtsam/nonlinear/Marginals.h>
 
 #include <Eigen/Core>
 #include <opencv2/opencv.hpp>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "kimera-vio/common/vio_types.h"
@@ -32,6 +34,7 @@
 #include "kimera-vio/mesh/MeshUtils.h"
 #include "kimera-vio/mesh/Mesher-definitions.h"
 #include "kimera-vio/utils/Macros.h"
+#include "kimera-vio/utils/Tracing.h"
 #include "kimera-vio/utils/UtilsOpenCV.h"
 #include "kimera-vio/visualizer/OpenCvVisualizer3D.h"
 #include "kimera-vio/visualizer/Visualizer3D-definitions.h"
@@ -45,6 +48,9 @@ constexpr float MeshOptimization::kDepthMeasNoiseSigma;
 constexpr float MeshOptimization::kMissingZ;
 constexpr float MeshOptimization::kMinZ;
 constexpr float MeshOptimization::kMaxZ;
+constexpr size_t MeshOptimization::kIncrementalMaxIterations;
+constexpr double MeshOptimization::kIncrementalRelativeTolerance;
+constexpr double MeshOptimization::kIncrementalAbsoluteTolerance;
 
 MeshOptimization::MeshOptimization(const MeshOptimizerType& solver_type,
                                    const MeshColorType& mesh_color_type,
@@ -63,6 +69,7 @@ MeshOptimization::MeshOptimization(const MeshOptimizerType& solver_type,
 
 MeshOptimizationOutput::UniquePtr MeshOptimization::spinOnce(
     const MeshOptimizationInput& input) {
+  KIMERA_TRACE_SCOPE("MeshOptimization::spinOnce");
   return solveOptimalMesh(input.pcl, input.pcl_colors, input.mesh_2d);
 }
 
@@ -93,8 +100,9 @@ void MeshOptimization::draw3dMesh(const std::string& id,
                                   const double& opacity) {
   cv::Mat vertices_mesh;
   cv::Mat polygons_mesh;
-  mesh_3d.getVerticesMeshToMat(&vertices_mesh);
-  mesh_3d.getPolygonsMeshToMat(&polygons_mesh);
+  // No need to copy, cv::viz::Mesh copies them.
+  mesh_3d.getVerticesMeshToMat(&vertices_mesh, false);
+  mesh_3d.getPolygonsMeshToMat(&polygons_mesh, false);
   cv::Mat colors_mesh = mesh_3d.getColorsMesh().t();  // Note the transpose.
   if (colors_mesh.empty()) {
     colors_mesh = cv::Mat(1u,
@@ -137,6 +145,7 @@ void MeshOptimization::collectTriangleDataPointsFast(
   CHECK_NOTNULL(triangles_to_datapoints_pixels)->reserve(n_polys);
   *CHECK_NOTNULL(number_of_valid_datapoints) = 0u;
 
+  const cv::Size img_size(img_width, img_height);
   Mesh2D::Polygon polygon;
   for (size_t k = 0u; k < n_polys; k++) {
     CHECK(mesh_2d.getPolygon(k, &polygon));
@@ -144,70 +153,32 @@ void MeshOptimization::collectTriangleDataPointsFast(
     const Vertex2D& vtx2 = polygon.at(1).getVertexPosition();
     const Vertex2D& vtx3 = polygon.at(2).getVertexPosition();
 
-    // Loop over pixels inside the bounding box of the current triangle
-
-    // 1. Find bounding box of triangle
-    float xmin = min3(vtx1.x, vtx2.x, vtx3.x);
-    float ymin = min3(vtx1.y, vtx2.y, vtx3.y);
-
-    float xmax = max3(vtx1.x, vtx2.x, vtx3.x);
-    float ymax = max3(vtx1.y, vtx2.y, vtx3.y);
-
-    // Discard triangle out of screen
-    // WARNING bcs of cv::Point2f convention x is the width...
-    if (xmin > img_width - 1 || xmax < 0 || ymin > img_height - 1 || ymax < 0) {
-      LOG(ERROR) << "Triangle out of screen!:"
-                 << "xmin: " << xmin << '\n'
-                 << "xmax: " << xmax << '\n'
-                 << "ymin: " << ymin << '\n'
-                 << "ymax: " << ymax << '\n'
-                 << "img_height" << img_height - 1 << '\n'
-                 << "img_width" << img_width - 1;
-      continue;
-    }
-
-    // be careful xmin/xmax/ymin/ymax can be negative. Don't cast to uint32_t
-    uint32_t x0 = std::max(int32_t(0), (int32_t)(std::floor(xmin)));
-    uint32_t x1 = std::min(int32_t(img_width) - 1, (int32_t)(std::floor(xmax)));
-    uint32_t y0 = std::max(int32_t(0), (int32_t)(std::floor(ymin)));
-    uint32_t y1 =
-        std::min(int32_t(img_height) - 1, (int32_t)(std::floor(ymax)));
-
-    // 2. Loop over pixels in the bounding box
-    /// Cache stuff
-    float x12 = vtx1.x - vtx2.x;
-    float y12 = vtx1.y - vtx2.y;
-    float x23 = vtx2.x - vtx3.x;
-    float y23 = vtx2.y - vtx3.y;
-    float x31 = vtx3.x - vtx1.x;
-    float y31 = vtx3.y - vtx1.y;
-    for (uint32_t u = x0; u <= x1; ++u) {
-      for (uint32_t v = y0; v <= y1; ++v) {
-        // Check that pixel is in triangle
-        float d1, d2, d3;
-        bool has_neg, has_pos;
-
-        d1 = (u - vtx2.x) * y12 - x12 * (v - vtx2.y);
-        d2 = (u - vtx3.x) * y23 - x23 * (v - vtx3.y);
-        d3 = (u - vtx1.x) * y31 - x31 * (v - vtx1.y);
-
-        has_neg = (d1 < 0) || (d2 < 0) || (d3 < 0);
-        has_pos = (d1 > 0) || (d2 > 0) || (d3 > 0);
-
-        KeypointCV pixel = cv::Point2f(u, v);
-        CHECK_EQ(!(has_neg && has_pos),
-                 pointInTriangle(pixel, vtx1, vtx2, vtx3));
-        if (!(has_neg && has_pos)) {
+    // Loop over the pixels inside the current triangle, row by row.
+    const bool is_on_screen = rasterizeTriangle(
+        vtx1,
+        vtx2,
+        vtx3,
+        img_size,
+        [&](const int32_t& u, const int32_t& v) {
           // Point in triangle
-          const cv::Point3f& lmk = noisy_point_cloud.at<cv::Point3f>(pixel);
+          const cv::Point3f& lmk = noisy_point_cloud.at<cv::Point3f>(v, u);
           if (isValidPoint(lmk, kMissingZ, kMinZ, kMaxZ)) {
             (*triangles_to_datapoints_xyz)[k].push_back(lmk);
-            (*triangles_to_datapoints_pixels)[k].push_back(pixel);
+            (*triangles_to_datapoints_pixels)[k].push_back(
+                KeypointCV(u, v));
             ++(*number_of_valid_datapoints);
           }
-        }
-      }  // loop over y
-    }    // loop over x
+        });
+    if (!is_on_screen) {
+      // WARNING bcs of cv::Point2f convention x is the width...
+      LOG(ERROR) << "Triangle out of screen!:"
+                 << "xmin: " << min3(vtx1.x, vtx2.x, vtx3.x) << '\n'
+                 << "xmax: " << max3(vtx1.x, vtx2.x, vtx3.x) << '\n'
+                 << "ymin: " << min3(vtx1.y, vtx2.y, vtx3.y) << '\n'
+                 << "ymax: " << max3(vtx1.y, vtx2.y, vtx3.y) << '\n'
+                 << "img_height" << img_height - 1 << '\n'
+                 << "img_width" << img_width - 1;
+    }
   }
 }
 
@@ -222,9 +193,29 @@ void MeshOptimization::collectTriangleDataPoints(
   *CHECK_NOTNULL(number_of_valid_datapoints) = 0u;
   CHECK(mono_camera_);
 
+  // 1. Scan-convert the 2d mesh once into a pixel to triangle id buffer.
+  // A point should only be in one triangle: the first triangle containing a
+  // pixel keeps it.
+  static constexpr int32_t kNoTriangle = -1;
+  cv::Mat triangle_ids(noisy_point_cloud.size(), CV_32SC1, kNoTriangle);
+  Mesh2D::Polygon polygon;
+  for (size_t k = 0; k < mesh_2d.getNumberOfPolygons(); k++) {
+    CHECK(mesh_2d.getPolygon(k, &polygon));
+    rasterizeTriangle(polygon.at(0).getVertexPosition(),
+                      polygon.at(1).getVertexPosition(),
+                      polygon.at(2).getVertexPosition(),
+                      triangle_ids.size(),
+                      [&triangle_ids, &k](const int32_t& u, const int32_t& v) {
+                        int32_t& triangle_id = triangle_ids.at<int32_t>(v, u);
+                        if (triangle_id == kNoTriangle) {
+                          triangle_id = static_cast<int32_t>(k);
+                        }
+                      });
+  }
+
   for (int u = 0; u < noisy_point_cloud.cols; ++u) {
     for (int v = 0; v < noisy_point_cloud.rows; ++v) {
-      // 1. Project pointcloud to image (color img with projections)
+      // 2. Project pointcloud to image (color img with projections)
       // aka get pixel coordinates for all points in pointcloud.
       // TODO(Toni): the projection of all points could be greatly optimized
       // by
@@ -252,24 +243,12 @@ void MeshOptimization::collectTriangleDataPoints(
           // drawPixelOnImg(left_pixel, img_, cv::viz::Color::green(), 1u);
         }
 
-        // 2. Generate correspondences btw points and triangles.
-        // For each triangle in 2d Mesh
-        // TODO(Toni): this can be greatly optimized by going on a per
-        // triangle fashion and using halfplane checks on all points.
-        Mesh2D::Polygon polygon;
-        for (size_t k = 0; k < mesh_2d.getNumberOfPolygons(); k++) {
-          CHECK(mesh_2d.getPolygon(k, &polygon));
-          if (pointInTriangle(left_pixel,
-                              polygon.at(0).getVertexPosition(),
-                              polygon.at(1).getVertexPosition(),
-                              polygon.at(2).getVertexPosition())) {
-            // A point should only be in one triangle, once found, we can stop
-            // looping over the 2d mesh.
-            (*corresp)[k].push_back(lmk);
-            (*pixel_corresp)[k].push_back(left_pixel);
-            ++(*number_of_valid_datapoints);
-            break;
-          }
+        // 3. Generate correspondences btw points and triangles.
+        const int32_t& k = triangle_ids.at<int32_t>(v, u);
+        if (k != kNoTriangle) {
+          (*corresp)[k].push_back(lmk);
+          (*pixel_corresp)[k].push_back(left_pixel);
+          ++(*number_of_valid_datapoints);
         }
       }
     }
@@ -366,6 +345,8 @@ MeshOptimizationOutput::UniquePtr MeshOptimization::solveOptimalMesh(
   // VIT this needs to be static or out of the for loop above!
   // otw we overwrite previous rows in Y.
   std::map<gtsam::Key, size_t> vertex_supports;  //! Only for visualization.
+  //! Initial guess for the vertices not in the last solution.
+  double sum_inv_depth_meas = 0.0;
   for (size_t tri_idx = 0; tri_idx < mesh_2d.getNumberOfPolygons(); tri_idx++) {
     CHECK(mesh_2d.getPolygon(tri_idx, &polygon_2d));
     CHECK_EQ(polygon_2d.size(), 3);
@@ -425,7 +406,8 @@ MeshOptimizationOutput::UniquePtr MeshOptimization::solveOptimalMesh(
     VLOG(10) << "Adding " << triangle_datapoints_xyz_left_rect_cam_frame.size()
              << " datapoints to triangle with idx: " << tri_idx;
     switch (mesh_optimizer_type_) {
-      case MeshOptimizerType::kGtsamMesh: {
+      case MeshOptimizerType::kGtsamMesh:
+      case MeshOptimizerType::kIncrementalMesh: {
         // Build factor graph on a per triangle basis
         for (size_t i = 0u; i < triangle_datapoints_pixel.size(); i++) {
           const KeypointCV& pixel = triangle_datapoints_pixel[i];
@@ -435,6 +417,7 @@ MeshOptimizationOutput::UniquePtr MeshOptimization::solveOptimalMesh(
           // In principle, datapoints here are all valid, as filtered by the
           // collect data points function
           double inv_depth_meas = 1.0 / std::sqrt(lmk.dot(lmk));
+          sum_inv_depth_meas += inv_depth_meas;
           // These should not be recomputed but cached when computing triangle
           // rasterization pixels...
           BaryCoord b0, b1, b2;
@@ -502,12 +485,12 @@ MeshOptimizationOutput::UniquePtr MeshOptimization::solveOptimalMesh(
 
   LOG(INFO) << "Solving optimization problem.";
   switch (mesh_optimizer_type_) {
-    case MeshOptimizerType::kGtsamMesh: {
+    case MeshOptimizerType::kGtsamMesh:
+    case MeshOptimizerType::kIncrementalMesh: {
       if (kUseSpringEnergies) {
         //! Add spring energies for this triangle, but don't duplicate
-        //! springs! Hence, use adjacency matrix to know where to put the
+        //! springs! Hence, use the adjacency lists to know where to put the
         //! springs.
-        cv::Mat adjacency_matrix = mesh_2d.getAdjacencyMatrix();
         const gtsam::Vector1 kSpringRestLength(0);
         constexpr double kSpringConstant = 1.0;
         const gtsam::Matrix11 A1(kSpringConstant);
@@ -515,30 +498,33 @@ MeshOptimizationOutput::UniquePtr MeshOptimization::solveOptimalMesh(
         const gtsam::SharedDiagonal kSpringNoiseModel =
             gtsam::noiseModel::Diagonal::Sigmas(
                 gtsam::Vector1(kSpringNoiseSigma));
-        // ASSUMEs that vtx ids are the indices of the adjacency matrix!
-        for (int v = 0; v < adjacency_matrix.rows; v++) {
+        // ASSUMEs that vtx ids are the keys of the vertices!
+        for (size_t v = 0u; v < mesh_2d.getNumberOfUniqueVertices(); v++) {
           gtsam::Key i1(v);
-          for (int u = 0; u < adjacency_matrix.cols; u++) {
-            if (u < v) {
-              if (adjacency_matrix.at<uint8_t>(v, u) == 1u) {
-                // Vertices are connected!
-                gtsam::Key i2(u);
-                factor_graph += gtsam::JacobianFactor(
-                    i1, A1, i2, A2, kSpringRestLength, kSpringNoiseModel);
-              }
-            } else {
-              CHECK_EQ(u, v);
-              // The matrix is symmetric, avoid adding duplicated springs.
-              break;
-            }
+          for (const Mesh2D::VertexId& u : mesh_2d.getAdjacentVertices(v)) {
+            // Adjacency is symmetric and sorted, avoid adding duplicated
+            // springs.
+            if (u >= v) break;
+            // Vertices are connected!
+            gtsam::Key i2(u);
+            factor_graph += gtsam::JacobianFactor(
+                i1, A1, i2, A2, kSpringRestLength, kSpringNoiseModel);
           }
         }
       }
 
       // Solve linear factor graph Ax=b...
       // optimize the graph
-      gtsam::VectorValues actual = factor_graph.optimize(gtsam::EliminateQR);
-      actual.print("Values after optimization");
+      gtsam::VectorValues actual;
+      if (mesh_optimizer_type_ == MeshOptimizerType::kIncrementalMesh) {
+        actual = solveWarmStarted(
+            factor_graph,
+            mesh_2d,
+            sum_inv_depth_meas / number_of_valid_datapoints);
+      } else {
+        actual = factor_graph.optimize(gtsam::EliminateQR);
+        actual.print("Values after optimization");
+      }
 
       gtsam::VectorValues hessian = factor_graph.hessianDiagonal();
 
@@ -569,6 +555,7 @@ MeshOptimizationOutput::UniquePtr MeshOptimization::solveOptimalMesh(
       }
 
       // Add new polygons to reconstructed mesh
+      std::unordered_map<LandmarkId, double> lmk_ids_to_inv_depths;
       Mesh2D::Polygon poly_2d;
       for (size_t k = 0u; k < mesh_2d.getNumberOfPolygons(); k++) {
         CHECK(mesh_2d.getPolygon(k, &poly_2d));
@@ -591,6 +578,7 @@ MeshOptimizationOutput::UniquePtr MeshOptimization::solveOptimalMesh(
             add_poly = false;
             break;
           }
+          lmk_ids_to_inv_depths[lmk_id] = inv_depth;
 
           //! Calculate depth estimation variance
           // TODO(Toni): check that these divisions are not on 0;
@@ -666,6 +654,7 @@ MeshOptimizationOutput::UniquePtr MeshOptimization::solveOptimalMesh(
           LOG(WARNING) << "Non-reconstructed poly: " << k;
         }
       }
+      lmk_ids_to_inv_depths_.swap(lmk_ids_to_inv_depths);
 
       break;
     }
@@ -690,6 +679,38 @@ MeshOptimizationOutput::UniquePtr MeshOptimization::solveOptimalMesh(
   return mesh_output;
 }
 
+gtsam::VectorValues MeshOptimization::solveWarmStarted(
+    const gtsam::GaussianFactorGraph& factor_graph,
+    const Mesh2D& mesh_2d,
+    const double& initial_inv_depth) const {
+  // The inverse depths are along the bearing vectors of the current frame,
+  // so the previous solution is only an initial guess: the iterations still
+  // converge to the solution of the current problem, but far faster when
+  // only a few vertices moved.
+  gtsam::VectorValues initial;
+  size_t nr_warm_started = 0u;
+  for (const gtsam::Key& key : factor_graph.keys()) {
+    double inv_depth = initial_inv_depth;
+    LandmarkId lmk_id;
+    if (mesh_2d.getLmkIdForVtxId(key, &lmk_id)) {
+      const auto& it = lmk_ids_to_inv_depths_.find(lmk_id);
+      if (it != lmk_ids_to_inv_depths_.end()) {
+        inv_depth = it->second;
+        ++nr_warm_started;
+      }
+    }
+    initial.insert(key, gtsam::Vector1(inv_depth));
+  }
+  VLOG(1) << "Warm-started " << nr_warm_started << " out of "
+          << initial.size() << " vertices.";
+
+  gtsam::ConjugateGradientParameters cg_params;
+  cg_params.setMaxIterations(kIncrementalMaxIterations);
+  cg_params.setEpsilon_rel(kIncrementalRelativeTolerance);
+  cg_params.setEpsilon_abs(kIncrementalAbsoluteTolerance);
+  return gtsam::conjugateGradientDescent(factor_graph, initial, cg_params);
+}
+
 cv::Point2f MeshOptimization::generatePixelFromLandmarkGivenCamera(
     const cv::Point3f& lmk,
     const gtsam::Pose3& extrinsics,
@@ -19,12 +19,15 @@
 #include <math.h>
 
 #include <algorithm>
+#include <opencv2/core/utility.hpp>
 #include <opencv2/imgproc.hpp>
 #include <utility>  // for make_pair
 #include <vector>
 
+#include "kimera-vio/utils/PerfCounters.h"
 #include "kimera-vio/utils/Statistics.h"
 #include "kimera-vio/utils/Timer.h"
+#include "kimera-vio/utils/Tracing.h"
 #include "kimera-vio/utils/UtilsNumerical.h"
 
 #ifdef __cplusplus
@@ -48,8 +51,18 @@ DEFINE_bool(reduce_mesh_to_time_horizon,
             "landmarks available in current optimization's time horizon.");
 DEFINE_bool(compute_per_vertex_normals,
             false,
-            "Compute per-vertex normals,"
-            "this is for visualization in RVIZ, it is costly!");
+            "Recompute the per-vertex normals from scratch every keyframe, "
+            "instead of only updating them with the faces that changed.");
+DEFINE_int32(mesher_num_threads,
+             4,
+             "Number of threads for the per-polygon passes of the mesher "
+             "(triangle filtering, normals and normal clustering). "
+             "1 runs them serially.");
+DEFINE_int32(mesher_min_parallel_polygons,
+             1000,
+             "Minimum number of polygons (or normals) for the per-polygon "
+             "passes to run in parallel, below it the threading overhead "
+             "dominates.");
 
 // Mesh 2D return, for semantic segmentation.
 // TODO REMOVE THIS FLAG MAKE MESH_2D Optional!
@@ -59,6 +72,11 @@ DEFINE_bool(return_mesh_2d,
             " for semantic segmentation");
 
 // Visualization.
+DEFINE_bool(incremental_delaunay,
+            true,
+            "Update the 2D triangulation of the previous keyframe (moving, "
+            "removing and inserting keypoints) instead of triangulating all "
+            "keypoints from scratch.");
 DEFINE_bool(visualize_histogram_1D, false, "Visualize 1D histogram.");
 DEFINE_bool(log_histogram_1D,
             false,
@@ -180,13 +198,47 @@ DEFINE_int32(z_histogram_max_number_of_peaks_to_select,
 
 namespace VIO {
 
+namespace {
+// Runs the per-polygon pass f(start, end) over [0, nr_polygons), in parallel
+// over polygon ranges if the mesh is large enough. f must only write to the
+// elements of its own range.
+template <typename RangeFunction>
+void forEachPolygonRange(const size_t& nr_polygons, const RangeFunction& f) {
+  const int n = static_cast<int>(nr_polygons);
+  if (FLAGS_mesher_num_threads > 1 && n >= FLAGS_mesher_min_parallel_polygons) {
+    cv::parallel_for_(
+        cv::Range(0, n),
+        [&](const cv::Range& range) { f(range.start, range.end); },
+        static_cast<double>(FLAGS_mesher_num_threads));
+  } else {
+    f(0, n);
+  }
+}
+
+// Reduction of the per-normal cluster masks: appends the indices in the
+// cluster, in increasing order as the serial loop did.
+void appendClusterIndices(const std::vector<uint8_t>& in_cluster,
+                          std::vector<int>* cluster_normals_idx) {
+  CHECK_NOTNULL(cluster_normals_idx);
+  for (size_t i = 0u; i < in_cluster.size(); ++i) {
+    if (in_cluster[i]) cluster_normals_idx->push_back(static_cast<int>(i));
+  }
+}
+}  // namespace
+
 /* -------------------------------------------------------------------------- */
 Mesher::Mesher(const MesherParams& mesher_params, const bool& serialize_meshes)
     : mesh_2d_(),
       mesh_3d_(),
       mesher_params_(mesher_params),
+      delaunay_(mesher_params.img_size_),
+      polygon_normals_(),
+      polygon_has_normal_(),
+      polygon_normal_hash_(NormalHash::getChordRadius(
+          FLAGS_normal_tolerance_polygon_plane_association)),
       mesher_logger_(nullptr),
-      serialize_meshes_(serialize_meshes) {
+      serialize_meshes_(serialize_meshes),
+      mesh_memory_("Mesher 3D mesh") {
   mesher_logger_ = std::make_unique<MesherLogger>();
 
   // Create z histogram.
@@ -229,25 +281,41 @@ MesherOutput::UniquePtr Mesher::spinOnce(const MesherInput& input) {
   // Serialize 2D/3D Mesh if requested
   if (serialize_meshes_) {
     LOG_FIRST_N(WARNING, 1) << "Mesh serialization enabled.";
-    serializeMeshes();
+    serializeMeshes(input.timestamp_);
   }
-  // TODO(Toni): remove these calls, since all info is in mesh_3d_...
-  getVerticesMesh(&(mesher_output_payload->vertices_mesh_));
-  getPolygonsMesh(&(mesher_output_payload->polygons_mesh_));
+  if (utils::isMemoryAccountingEnabled()) {
+    mesh_memory_.set(mesh_3d_.getMemoryBytes());
+  }
+  // Snapshot of the mesh, sharing its data until the mesher modifies it.
   mesher_output_payload->mesh_3d_ = mesh_3d_;
+  // TODO(Toni): remove these, since all info is in mesh_3d_...
+  // Views of the snapshot, no copies.
+  mesher_output_payload->mesh_3d_.getVerticesMeshToMat(
+      &(mesher_output_payload->vertices_mesh_), false);
+  mesher_output_payload->mesh_3d_.getPolygonsMeshToMat(
+      &(mesher_output_payload->polygons_mesh_), false);
   return mesher_output_payload;
 }
 
 std::vector<cv::Vec6f> Mesher::computeDelaunayTriangulation(
     const KeypointsCV& keypoints,
     MeshIndices* vtx_indices) {
+  // Buffers for the Triangle library, reused across calls instead of
+  // allocating (and freeing) its inputs and outputs for each triangulation.
+  struct TriangleBuffers {
+    std::vector<float> points;
+    std::vector<int> triangles;
+  };
+  static thread_local TriangleBuffers buffers;
+
   // input/output structure for triangulation
   struct triangulateio in, out;
   int32_t k;
 
   // Input number of points and point list
   in.numberofpoints = keypoints.size();
-  in.pointlist = (float*)malloc(in.numberofpoints * 2 * sizeof(float));
+  buffers.points.resize(2u * keypoints.size());
+  in.pointlist = buffers.points.data();
   k = 0;
   for (int32_t i = 0; i < static_cast<int32_t>(keypoints.size()); i++) {
     in.pointlist[k++] = keypoints[i].x;
@@ -261,11 +329,13 @@ std::vector<cv::Vec6f> Mesher::computeDelaunayTriangulation(
   in.numberofregions = 0;
   in.regionlist = NULL;
 
-  // outputs
+  // outputs: Triangle only allocates the lists that are NULL, and a
+  // triangulation of n points has at most 2n triangles.
+  buffers.triangles.resize(3u * (2u * keypoints.size() + 1u));
   out.pointlist = NULL;
   out.pointattributelist = NULL;
   out.pointmarkerlist = NULL;
-  out.trianglelist = NULL;
+  out.trianglelist = buffers.triangles.data();
   out.triangleattributelist = NULL;
   out.neighborlist = NULL;
   out.segmentlist = NULL;
@@ -273,9 +343,9 @@ std::vector<cv::Vec6f> Mesher::computeDelaunayTriangulation(
   out.edgelist = NULL;
   out.edgemarkerlist = NULL;
 
-  // do triangulation (z=zero-based, n=neighbors, Q=quiet, B=no boundary
-  // markers)
-  char parameters[] = "zneQB";
+  // do triangulation (z=zero-based, N=no output points, Q=quiet, B=no
+  // boundary markers). Neither neighbors nor edges are used.
+  char parameters[] = "zNQB";
   ::triangulate(parameters, &in, &out, NULL);
 
   // put resulting triangles into vector tri
@@ -301,11 +371,6 @@ std::vector<cv::Vec6f> Mesher::computeDelaunayTriangulation(
     k += 3;
   }
 
-  // free memory used for triangulation
-  free(in.pointlist);
-  free(out.pointlist);
-  free(out.trianglelist);
-
   // return triangles
   return tri;
 }
@@ -376,25 +441,34 @@ void Mesher::filterOutBadTriangles(const gtsam::Pose3& leftCameraPose,
                                    double minRatioBetweenLargestAnSmallestSide,
                                    double min_elongation_ratio,
                                    double maxTriangleSide) {
-  Mesh3D mesh_output;
+  CHECK_EQ(mesh_3d_.getMeshPolygonDimension(), 3)
+      << "Expecting 3 vertices in triangle";
+  const size_t nr_polygons = mesh_3d_.getNumberOfPolygons();
+
+  // Check each face in the mesh, in parallel over polygon ranges.
+  std::vector<uint8_t> is_good(nr_polygons, 0u);
+  forEachPolygonRange(nr_polygons, [&](const int& start, const int& end) {
+    for (int i = start; i < end; ++i) {
+      is_good[i] = !isBadTriangle(mesh_3d_.getPolygonVertexPosition(i, 0),
+                                  mesh_3d_.getPolygonVertexPosition(i, 1),
+                                  mesh_3d_.getPolygonVertexPosition(i, 2),
+                                  leftCameraPose,
+                                  minRatioBetweenLargestAnSmallestSide,
+                                  min_elongation_ratio,
+                                  maxTriangleSide);
+    }
+  });
 
-  // Loop over each face in the mesh.
+  // Rebuild the mesh with the good faces, in order.
+  Mesh3D mesh_output;
   Mesh3D::Polygon polygon;
-
-  for (size_t i = 0; i < mesh_3d_.getNumberOfPolygons(); i++) {
+  for (size_t i = 0; i < nr_polygons; i++) {
+    if (!is_good[i]) continue;
     CHECK(mesh_3d_.getPolygon(i, &polygon)) << "Could not retrieve polygon.";
-    CHECK_EQ(polygon.size(), 3) << "Expecting 3 vertices in triangle";
-    // Check if triangle is good.
-    if (!isBadTriangle(polygon,
-                       leftCameraPose,
-                       minRatioBetweenLargestAnSmallestSide,
-                       min_elongation_ratio,
-                       maxTriangleSide)) {
-      mesh_output.addPolygonToMesh(polygon);
-    }
+    mesh_output.addPolygonToMesh(polygon);
   }
 
-  mesh_3d_ = mesh_output;
+  mesh_3d_ = std::move(mesh_output);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -406,10 +480,24 @@ bool Mesher::isBadTriangle(
     const double& min_elongation_ratio,
     const double& max_triangle_side) const {
   CHECK_EQ(polygon.size(), 3) << "Expecting 3 vertices in triangle";
-  const Vertex3D& p1 = polygon.at(0).getVertexPosition();
-  const Vertex3D& p2 = polygon.at(1).getVertexPosition();
-  const Vertex3D& p3 = polygon.at(2).getVertexPosition();
+  return isBadTriangle(polygon.at(0).getVertexPosition(),
+                       polygon.at(1).getVertexPosition(),
+                       polygon.at(2).getVertexPosition(),
+                       left_camera_pose,
+                       min_ratio_between_largest_an_smallest_side,
+                       min_elongation_ratio,
+                       max_triangle_side);
+}
 
+/* -------------------------------------------------------------------------- */
+bool Mesher::isBadTriangle(
+    const Vertex3D& p1,
+    const Vertex3D& p2,
+    const Vertex3D& p3,
+    const gtsam::Pose3& left_camera_pose,
+    const double& min_ratio_between_largest_an_smallest_side,
+    const double& min_elongation_ratio,
+    const double& max_triangle_side) const {
   double ratioSides_i = 0;
   double ratioTangentialRadial_i = 0;
   double maxTriangleSide_i = 0;
@@ -587,8 +675,8 @@ void Mesher::populate3dMesh(const std::vector<cv::Vec6f>& mesh_2d_pixels,
 }
 
 /* -------------------------------------------------------------------------- */
-// TODO the polygon_mesh has repeated faces...
-// And this seems to slow down quite a bit the for loop!
+// Updates the mesh in place: only the polygons of the landmarks that left the
+// time horizon and the polygons that became bad are removed.
 void Mesher::updatePolygonMeshToTimeHorizon(
     const PointsWithIdMap& points_with_id_map,
     const gtsam::Pose3& leftCameraPose,
@@ -599,60 +687,62 @@ void Mesher::updatePolygonMeshToTimeHorizon(
   LOG_IF(WARNING, points_with_id_map.size() == 0u)
       << "Missing landmark information for the Mesher: "
          "cannot trim 3D mesh to time horizon.";
-  const auto& end = points_with_id_map.end();
 
-  // Loop over each face in the mesh.
-  Mesh3D::Polygon polygon;
-  Mesh3D mesh_output;
-  for (size_t i = 0; i < mesh_3d_.getNumberOfPolygons(); i++) {
-    CHECK(mesh_3d_.getPolygon(i, &polygon)) << "Could not retrieve polygon.";
-    bool save_polygon = true;
-    for (Mesh3D::VertexType& vertex : polygon) {
-      const auto& point_with_id_it = points_with_id_map.find(vertex.getLmkId());
-      if (point_with_id_it == end) {
-        // Vertex of current polygon is not in points_with_id_map
-        if (reduce_mesh_to_time_horizon) {
-          // We want to reduce the mesh to time horizon.
-          // Delete the polygon by not adding it to the new mesh.
-          save_polygon = false;
-          break;
-        } else {
-          // We do not want to reduce the mesh to time horizon.
-          save_polygon = true;
-        }
-      } else {
-        // Update the vertex with newest landmark position.
-        // This is to ensure we have latest update, the previous
-        // addPolygonToMesh only updates the positions of the vertices in the
-        // visible frame.
-        vertex.setVertexPosition(Vertex3D(point_with_id_it->second.x(),
-                                          point_with_id_it->second.y(),
-                                          point_with_id_it->second.z()));
-      }
-    }
+  // Update the vertices with the newest landmark positions. This is to ensure
+  // we have latest update, the previous addPolygonToMesh only updates the
+  // positions of the vertices in the visible frame.
+  ++time_horizon_update_count_;
+  for (const auto& point_with_id : points_with_id_map) {
+    const LandmarkId& lmk_id = point_with_id.first;
+    const gtsam::Point3& point = point_with_id.second;
+    mesh_3d_.setVertexPosition(lmk_id,
+                               Vertex3D(point.x(), point.y(), point.z()));
+    lmk_ids_last_seen_[lmk_id] = time_horizon_update_count_;
+    lmk_ids_expiry_queue_.emplace_back(time_horizon_update_count_, lmk_id);
+  }
 
-    if (save_polygon) {
-      // Refilter polygons, as the updated vertices might make it unvalid.
-      if (!isBadTriangle(
-              polygon,
-              leftCameraPose,
-              min_ratio_largest_smallest_side,
-              -1.0,  // elongation test is invalid, no per-frame concept
-              max_triangle_side)) {
-        // Finally add the polygon to the mesh.
-        mesh_output.addPolygonToMesh(polygon);
+  // Landmarks not seen in this update left the time horizon: the entries of
+  // the landmarks seen again since are stale.
+  size_t nr_expired_polygons = 0u;
+  while (!lmk_ids_expiry_queue_.empty() &&
+         lmk_ids_expiry_queue_.front().first < time_horizon_update_count_) {
+    const size_t& last_seen = lmk_ids_expiry_queue_.front().first;
+    const LandmarkId& lmk_id = lmk_ids_expiry_queue_.front().second;
+    const auto& it = lmk_ids_last_seen_.find(lmk_id);
+    if (it != lmk_ids_last_seen_.end() && it->second == last_seen) {
+      lmk_ids_last_seen_.erase(it);
+      if (reduce_mesh_to_time_horizon) {
+        // We want to reduce the mesh to time horizon.
+        nr_expired_polygons += mesh_3d_.removePolygonsOfLmkId(lmk_id);
       }
     }
+    lmk_ids_expiry_queue_.pop_front();
   }
 
-  mesh_3d_ = mesh_output;
+  // Refilter polygons, as the updated vertices might make it unvalid. Going
+  // backwards, the polygons moved to the removed indices were checked already.
+  size_t nr_bad_polygons = 0u;
+  for (size_t i = mesh_3d_.getNumberOfPolygons(); i-- > 0u;) {
+    if (isBadTriangle(mesh_3d_.getPolygonVertexPosition(i, 0),
+                      mesh_3d_.getPolygonVertexPosition(i, 1),
+                      mesh_3d_.getPolygonVertexPosition(i, 2),
+                      leftCameraPose,
+                      min_ratio_largest_smallest_side,
+                      -1.0,  // elongation test is invalid, no per-frame concept
+                      max_triangle_side)) {
+      mesh_3d_.removePolygon(i);
+      ++nr_bad_polygons;
+    }
+  }
+  VLOG(10) << "Removed " << nr_expired_polygons << " polygons out of the time "
+           << "horizon and " << nr_bad_polygons << " bad polygons.";
   VLOG(10) << "Finished updatePolygonMeshToTimeHorizon.";
 }
 
 /* -------------------------------------------------------------------------- */
 // Calculate normals of polygonMesh.
 // TODO(Toni): put this inside the mesh itself...
-// TODO(Toni): the mesh has already a computePerVertexNormals.
+// TODO(Toni): the mesh already maintains per-vertex normals,
 // although here we are interested instead on a per-face normal.
 void Mesher::calculateNormals(std::vector<cv::Point3f>* normals) {
   CHECK_NOTNULL(normals);
@@ -660,30 +750,23 @@ void Mesher::calculateNormals(std::vector<cv::Point3f>* normals) {
       << "Expecting 3 vertices in triangle.";
 
   // Brute force, ideally only call when a new triangle appears...
+  const size_t nr_polygons = mesh_3d_.getNumberOfPolygons();
   normals->clear();
-  normals->resize(
-      mesh_3d_.getNumberOfPolygons());  // TODO Assumes we have triangles...
+  normals->resize(nr_polygons);
 
-  // Loop over each polygon face in the mesh.
+  // Loop over each polygon face in the mesh, in parallel over polygon ranges:
+  // each normal only depends on its own triangle.
   // TODO there are far too many loops over the total number of Polygon faces...
   // Should put them all in the same loop!
-  Mesh3D::Polygon polygon;
-  for (size_t i = 0; i < mesh_3d_.getNumberOfPolygons(); i++) {
-    CHECK(mesh_3d_.getPolygon(i, &polygon)) << "Could not retrieve polygon.";
-    DCHECK_EQ(polygon.size(), 3);
-    const Vertex3D& p1 = polygon.at(0).getVertexPosition();
-    const Vertex3D& p2 = polygon.at(1).getVertexPosition();
-    const Vertex3D& p3 = polygon.at(2).getVertexPosition();
-
-    cv::Point3f normal;
-    CHECK(calculateNormal(p1, p2, p3, &normal));
-    // Mat normal2;
-    // viz::computeNormals(mesh, normal2);
-    // https://github.com/zhoushiwei/Viz-opencv/blob/master/Viz/main.cpp
-
-    // Store normal to triangle i.
-    normals->at(i) = normal;
-  }
+  forEachPolygonRange(nr_polygons, [&](const int& start, const int& end) {
+    for (int i = start; i < end; ++i) {
+      // Store normal to triangle i.
+      CHECK(calculateNormal(mesh_3d_.getPolygonVertexPosition(i, 0),
+                            mesh_3d_.getPolygonVertexPosition(i, 1),
+                            mesh_3d_.getPolygonVertexPosition(i, 2),
+                            &(*normals)[i]));
+    }
+  });
 }
 
 /* -------------------------------------------------------------------------- */
@@ -737,14 +820,16 @@ void Mesher::clusterNormalsAroundAxis(const cv::Point3f& axis,
                                       const std::vector<cv::Point3f>& normals,
                                       const double& tolerance,
                                       std::vector<int>* cluster_normals_idx) {
-  size_t idx = 0;
+  CHECK_NOTNULL(cluster_normals_idx);
   // TODO, this should be in the same loop as the one calculating
   // the normals...
-  for (const cv::Point3f& normal : normals) {
-    if (isNormalAroundAxis(axis, normal, tolerance))
-      cluster_normals_idx->push_back(idx);
-    idx++;
-  }
+  std::vector<uint8_t> in_cluster(normals.size(), 0u);
+  forEachPolygonRange(normals.size(), [&](const int& start, const int& end) {
+    for (int i = start; i < end; ++i) {
+      in_cluster[i] = isNormalAroundAxis(axis, normals[i], tolerance);
+    }
+  });
+  appendClusterIndices(in_cluster, cluster_normals_idx);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -770,14 +855,14 @@ void Mesher::clusterNormalsPerpendicularToAxis(
     const std::vector<cv::Point3f>& normals,
     const double& tolerance,
     std::vector<int>* cluster_normals_idx) {
-  size_t idx = 0;
-  std::vector<cv::Point3f> cluster_normals;
-  for (const cv::Point3f& normal : normals) {
-    if (isNormalPerpendicularToAxis(axis, normal, tolerance)) {
-      cluster_normals_idx->push_back(idx);
+  CHECK_NOTNULL(cluster_normals_idx);
+  std::vector<uint8_t> in_cluster(normals.size(), 0u);
+  forEachPolygonRange(normals.size(), [&](const int& start, const int& end) {
+    for (int i = start; i < end; ++i) {
+      in_cluster[i] = isNormalPerpendicularToAxis(axis, normals[i], tolerance);
     }
-    idx++;
-  }
+  });
+  appendClusterIndices(in_cluster, cluster_normals_idx);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -835,6 +920,10 @@ bool Mesher::isPointAtDistanceFromPlane(
 void Mesher::clusterPlanesFromMesh(std::vector<Plane>* planes,
                                    const PointsWithIdMap& points_with_id_vio) {
   CHECK_NOTNULL(planes);
+  // Normals of the polygons, shared by the segmentation and the update of the
+  // lmk ids of the new planes below.
+  updatePolygonNormals();
+
   // Segment planes in the mesh, using seeds.
   VLOG(10) << "Starting plane segmentation...";
   std::vector<Plane> new_planes;
@@ -907,90 +996,150 @@ void Mesher::segmentPlanesInMesh(
   CHECK_EQ(mesh_3d_.getMeshPolygonDimension(), mesh_polygon_dim)
       << "Expecting 3 vertices in triangle.";
 
-  // Cluster new lmk ids for seed planes.
-  // Loop over the mesh only once.
-  Mesh3D::Polygon polygon;
-  cv::Mat z_components(1, 0, CV_32F);
-  cv::Mat walls(0, 0, CV_32FC2);
-  for (size_t i = 0; i < mesh_3d_.getNumberOfPolygons(); i++) {
-    CHECK(mesh_3d_.getPolygon(i, &polygon)) << "Could not retrieve polygon.";
-    CHECK_EQ(polygon.size(), mesh_polygon_dim);
-    const Vertex3D& p1 = polygon.at(0).getVertexPosition();
-    const Vertex3D& p2 = polygon.at(1).getVertexPosition();
-    const Vertex3D& p3 = polygon.at(2).getVertexPosition();
-
-    // Calculate normal of the triangle in the mesh.
-    // The normals are in the world frame of reference.
-    cv::Point3f triangle_normal;
-    if (calculateNormal(p1, p2, p3, &triangle_normal)) {
-      ////////////////////////// Update seed planes ////////////////////////////
-      // Update seed_planes lmk_ids field with ids of vertices of polygon if the
-      // polygon is on the plane.
-      bool is_polygon_on_a_plane = updatePlanesLmkIdsFromPolygon(
-          seed_planes,
-          polygon,
-          i,
-          triangle_normal,
-          normal_tolerance_polygon_plane_association,
-          distance_tolerance_polygon_plane_association,
-          points_with_id_vio,
-          FLAGS_only_associate_a_polygon_to_a_single_plane);
-
-      ////////////////// Build Histogram for new planes ////////////////////////
-      /// Values for Z Histogram.///////////////////////////////////////////////
-      // Collect z values of vertices of polygon which is not already on a plane
-      // and which has the normal aligned with the vertical direction so that we
-      // can build an histogram.
-      static const cv::Point3f vertical(0, 0, 1);
-      if ((FLAGS_only_use_non_clustered_points ? !is_polygon_on_a_plane
-                                               : true) &&
-          isNormalAroundAxis(
-              vertical, triangle_normal, normal_tolerance_horizontal_surface)) {
-        // We have a triangle with a normal aligned with gravity, which is not
-        // already clustered in a plane.
-        // Store z components to build histogram.
-        // TODO instead of storing z_components, use the accumulate flag in
-        // calcHist and add them straight.
-        z_components.push_back(p1.z);
-        z_components.push_back(p2.z);
-        z_components.push_back(p3.z);
-      } else if ((FLAGS_only_use_non_clustered_points ? !is_polygon_on_a_plane
-                                                      : true) &&
-                 isNormalPerpendicularToAxis(
-                     vertical, triangle_normal, normal_tolerance_walls)) {
-        /// Values for walls Histogram./////////////////////////////////////////
-        // WARNING if we do not normalize, we'll have two peaks for the same
-        // plane, no?
-        // Store theta.
-        double theta = getLongitude(triangle_normal, vertical);
-
-        // Store distance.
-        // Using triangle_normal.
-        double distance = p1.ddot(triangle_normal);
-        if (theta < 0) {
-          VLOG(10) << "Normalize theta: " << theta
-                   << " and distance: " << distance;
-          // Say theta is -pi/2, then normalized theta is pi/2.
-          theta = theta + M_PI;
-          // Change distance accordingly.
-          distance = -distance;
-          VLOG(10) << "New normalized theta: " << theta
-                   << " and distance: " << distance;
-        }
-        walls.push_back(cv::Point2f(theta, distance));
-        // WARNING should we instead be using projected triangle normal
-        // on equator, and taking average of three distances...
-        // NORMALIZE if a theta is positive and distance negative, it is the
-        // same as if theta is 180 deg from it and distance positive...
+  const size_t nr_polygons = mesh_3d_.getNumberOfPolygons();
+  CHECK_EQ(polygon_normals_.size(), nr_polygons)
+      << "Call updatePolygonNormals before segmenting planes.";
+
+  ////////////////////////// Update seed planes ////////////////////////////////
+  // Update seed_planes lmk_ids field with ids of vertices of the polygons on
+  // the plane.
+  std::vector<uint8_t> is_polygon_on_a_plane;
+  updatePlanesLmkIdsFromPolygons(
+      seed_planes,
+      normal_tolerance_polygon_plane_association,
+      distance_tolerance_polygon_plane_association,
+      points_with_id_vio,
+      FLAGS_only_associate_a_polygon_to_a_single_plane,
+      &is_polygon_on_a_plane);
+
+  ////////////////// Update Histograms for new planes /////////////////////////
+  updatePlaneHistograms(is_polygon_on_a_plane,
+                        normal_tolerance_horizontal_surface,
+                        normal_tolerance_walls);
+
+  // Segment new planes.
+  // Currently using lmks that were used by the seed_planes...
+  segmentNewPlanes(new_planes);
+}
+
+/* -------------------------------------------------------------------------- */
+// Updates the plane segmentation histograms with the polygons that changed
+// (added, removed, moved, or (un)clustered in a plane) since the last call.
+void Mesher::updatePlaneHistograms(
+    const std::vector<uint8_t>& is_polygon_on_a_plane,
+    const double& normal_tolerance_horizontal_surface,
+    const double& normal_tolerance_walls) {
+  const size_t nr_polygons = mesh_3d_.getNumberOfPolygons();
+  CHECK_EQ(polygon_normals_.size(), nr_polygons);
+  CHECK_EQ(is_polygon_on_a_plane.size(), nr_polygons);
+  if (z_hist_.getHistogram().empty()) z_hist_.resetHistogram();
+  if (hist_2d_.getHistogram().empty()) hist_2d_.resetHistogram();
+
+  const auto add_sample = [this](const PolygonHistogramSample& sample,
+                                 const float& weight) {
+    if (sample.type == PolygonHistogramSample::Type::kHorizontal) {
+      for (const float& z : sample.values) z_hist_.addSample(z, weight);
+    } else {
+      hist_2d_.addSample(cv::Point2f(sample.values[0], sample.values[1]),
+                         weight);
+    }
+  };
+
+  std::unordered_map<PolygonLmkIds, PolygonHistogramSample, PolygonLmkIdsHash>
+      polygon_histogram_samples;
+  polygon_histogram_samples.reserve(nr_polygons);
+  size_t nr_changed_samples = 0u;
+  size_t nr_wall_samples = 0u;
+  static const cv::Point3f vertical(0, 0, 1);
+  for (size_t i = 0; i < nr_polygons; i++) {
+    // Normal of the triangle in the mesh, in the world frame of reference.
+    if (!polygon_has_normal_[i]) continue;
+    if (FLAGS_only_use_non_clustered_points && is_polygon_on_a_plane[i]) {
+      continue;
+    }
+    const Vertex3D& p1 = mesh_3d_.getPolygonVertexPosition(i, 0);
+    const Vertex3D& p2 = mesh_3d_.getPolygonVertexPosition(i, 1);
+    const Vertex3D& p3 = mesh_3d_.getPolygonVertexPosition(i, 2);
+    const cv::Point3f& triangle_normal = polygon_normals_[i];
+
+    PolygonHistogramSample sample;
+    /// Values for Z Histogram./////////////////////////////////////////////////
+    // Collect z values of vertices of polygon which is not already on a plane
+    // and which has the normal aligned with the vertical direction so that we
+    // can build an histogram.
+    if (isNormalAroundAxis(
+            vertical, triangle_normal, normal_tolerance_horizontal_surface)) {
+      // We have a triangle with a normal aligned with gravity, which is not
+      // already clustered in a plane.
+      sample.type = PolygonHistogramSample::Type::kHorizontal;
+      sample.values = {{p1.z, p2.z, p3.z}};
+    } else if (isNormalPerpendicularToAxis(
+                   vertical, triangle_normal, normal_tolerance_walls)) {
+      /// Values for walls Histogram.///////////////////////////////////////////
+      // WARNING if we do not normalize, we'll have two peaks for the same
+      // plane, no?
+      // Store theta.
+      double theta = getLongitude(triangle_normal, vertical);
+
+      // Store distance.
+      // Using triangle_normal.
+      double distance = p1.ddot(triangle_normal);
+      if (theta < 0) {
+        VLOG(10) << "Normalize theta: " << theta
+                 << " and distance: " << distance;
+        // Say theta is -pi/2, then normalized theta is pi/2.
+        theta = theta + M_PI;
+        // Change distance accordingly.
+        distance = -distance;
+        VLOG(10) << "New normalized theta: " << theta
+                 << " and distance: " << distance;
+      }
+      sample.type = PolygonHistogramSample::Type::kWall;
+      sample.values = {
+          {static_cast<float>(theta), static_cast<float>(distance), 0.0f}};
+      nr_wall_samples++;
+      // WARNING should we instead be using projected triangle normal
+      // on equator, and taking average of three distances...
+      // NORMALIZE if a theta is positive and distance negative, it is the
+      // same as if theta is 180 deg from it and distance positive...
+    } else {
+      continue;
+    }
+
+    // Only update the histograms if the sample of the polygon changed.
+    PolygonLmkIds lmk_ids;
+    for (size_t j = 0u; j < lmk_ids.size(); j++) {
+      CHECK(mesh_3d_.getLmkIdForVtxId(mesh_3d_.getPolygonVertexId(i, j),
+                                      &lmk_ids[j]));
+    }
+    std::sort(lmk_ids.begin(), lmk_ids.end());
+    const auto& previous_it = polygon_histogram_samples_.find(lmk_ids);
+    if (previous_it == polygon_histogram_samples_.end()) {
+      add_sample(sample, 1.0f);
+      nr_changed_samples++;
+    } else {
+      if (!(previous_it->second == sample)) {
+        add_sample(previous_it->second, -1.0f);
+        add_sample(sample, 1.0f);
+        nr_changed_samples++;
       }
+      polygon_histogram_samples_.erase(previous_it);
     }
+    CHECK(polygon_histogram_samples.emplace(lmk_ids, sample).second)
+        << "Repeated polygon in the mesh.";
   }
 
-  VLOG(10) << "Number of polygons potentially on a wall: " << walls.rows;
+  // Polygons no longer in the mesh (or no longer horizontal or walls).
+  for (const auto& previous_sample : polygon_histogram_samples_) {
+    add_sample(previous_sample.second, -1.0f);
+    nr_changed_samples++;
+  }
+  polygon_histogram_samples_.swap(polygon_histogram_samples);
 
-  // Segment new planes.
-  // Currently using lmks that were used by the seed_planes...
-  segmentNewPlanes(new_planes, z_components, walls);
+  VLOG(10) << "Updated " << nr_changed_samples << " of "
+           << polygon_histogram_samples_.size()
+           << " polygon samples in the plane histograms.";
+  VLOG(10) << "Number of polygons potentially on a wall: " << nr_wall_samples;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -1024,81 +1173,104 @@ void Mesher::updatePlanesLmkIdsFromMesh(
   static constexpr size_t mesh_polygon_dim = 3;
   CHECK_EQ(mesh_3d_.getMeshPolygonDimension(), mesh_polygon_dim)
       << "Expecting 3 vertices in triangle.";
-  Mesh3D::Polygon polygon;
-  for (size_t i = 0; i < mesh_3d_.getNumberOfPolygons(); i++) {
-    CHECK(mesh_3d_.getPolygon(i, &polygon)) << "Could not retrieve polygon.";
-    CHECK_EQ(polygon.size(), mesh_polygon_dim);
-    const Vertex3D& p1 = polygon.at(0).getVertexPosition();
-    const Vertex3D& p2 = polygon.at(1).getVertexPosition();
-    const Vertex3D& p3 = polygon.at(2).getVertexPosition();
-
-    // Calculate normal of the triangle in the mesh.
-    // The normals are in the world frame of reference.
-    cv::Point3f triangle_normal;
-    if (calculateNormal(p1, p2, p3, &triangle_normal)) {
-      // Loop over newly segmented planes, and update lmk ids field if
-      // the current polygon is on the plane.
-      updatePlanesLmkIdsFromPolygon(
-          planes,
-          polygon,
-          i,
-          triangle_normal,
-          normal_tolerance,
-          distance_tolerance,
-          points_with_id_vio,
-          FLAGS_only_associate_a_polygon_to_a_single_plane);
+  CHECK_EQ(polygon_normals_.size(), mesh_3d_.getNumberOfPolygons())
+      << "Call updatePolygonNormals before updating the planes.";
+  // Loop over the newly segmented planes, and update lmk ids field with the
+  // polygons on the plane.
+  std::vector<uint8_t> is_polygon_on_a_plane;
+  updatePlanesLmkIdsFromPolygons(
+      planes,
+      normal_tolerance,
+      distance_tolerance,
+      points_with_id_vio,
+      FLAGS_only_associate_a_polygon_to_a_single_plane,
+      &is_polygon_on_a_plane);
+}
+
+/* -------------------------------------------------------------------------- */
+// Computes and hashes the normal of each polygon of the 3D mesh.
+void Mesher::updatePolygonNormals() {
+  static constexpr size_t mesh_polygon_dim = 3;
+  CHECK_EQ(mesh_3d_.getMeshPolygonDimension(), mesh_polygon_dim)
+      << "Expecting 3 vertices in triangle.";
+  const size_t nr_polygons = mesh_3d_.getNumberOfPolygons();
+  polygon_normals_.resize(nr_polygons);
+  polygon_has_normal_.resize(nr_polygons);
+  forEachPolygonRange(nr_polygons, [&](const int& start, const int& end) {
+    for (int i = start; i < end; ++i) {
+      // The normals are in the world frame of reference.
+      polygon_has_normal_[i] =
+          calculateNormal(mesh_3d_.getPolygonVertexPosition(i, 0),
+                          mesh_3d_.getPolygonVertexPosition(i, 1),
+                          mesh_3d_.getPolygonVertexPosition(i, 2),
+                          &polygon_normals_[i]);
+    }
+  });
+
+  polygon_normal_hash_.clear();
+  for (size_t i = 0; i < nr_polygons; i++) {
+    if (polygon_has_normal_[i]) {
+      polygon_normal_hash_.insert(i, polygon_normals_[i]);
     }
   }
 }
 
 /* -------------------------------------------------------------------------- */
-// Updates planes lmk ids field with a polygon vertices ids if this polygon
-// is part of the plane according to given tolerance.
+// Updates planes lmk ids field with the vertices ids of the polygons that are
+// part of the plane according to given tolerance.
 // points_with_id_vio is only used if we are using stereo points...
-bool Mesher::updatePlanesLmkIdsFromPolygon(
-    std::vector<Plane>* seed_planes,
-    const Mesh3D::Polygon& polygon,
-    const size_t& triangle_id,
-    const cv::Point3f& triangle_normal,
+void Mesher::updatePlanesLmkIdsFromPolygons(
+    std::vector<Plane>* planes,
     double normal_tolerance,
     double distance_tolerance,
     const PointsWithIdMap& points_with_id_vio,
-    bool only_associate_a_polygon_to_a_single_plane) const {
-  CHECK_NOTNULL(seed_planes);
-  bool is_polygon_on_a_plane = false;
-  for (Plane& seed_plane : *seed_planes) {
-    // Only cluster if normal and distance of polygon are close to plane.
-    // WARNING: same polygon is being possibly clustered in multiple planes.
-    // Break loop when polygon is in a plane?
-    if (isNormalAroundAxis(
-            seed_plane.normal_, triangle_normal, normal_tolerance) &&
-        isPolygonAtDistanceFromPlane(polygon,
-                                     seed_plane.distance_,
-                                     seed_plane.normal_,
-                                     distance_tolerance)) {
-      // I guess we can comment out the check below since it can happen that
-      // a poygon is segmented in two very close planes? Better we enable
-      // it again!
-      // CHECK(!is_polygon_on_a_plane) << "Polygon was already in a plane,"
-      //                                 " are we having similar planes?";
-
-      // Update lmk_ids of seed plane.
-      // Points_with_id_vio are only used for stereo.
-      appendLmkIdsOfPolygon(polygon, &seed_plane.lmk_ids_, points_with_id_vio);
-
-      // TODO Remove, only used for visualization...
-      seed_plane.triangle_cluster_.triangle_ids_.push_back(triangle_id);
-
-      // Acknowledge that the polygon is at least in one plane, to avoid
-      // sending this polygon to segmentation and segment the same plane
-      // again.
-      is_polygon_on_a_plane = true;
-      if (only_associate_a_polygon_to_a_single_plane) {
-        break;
+    bool only_associate_a_polygon_to_a_single_plane,
+    std::vector<uint8_t>* is_polygon_on_a_plane) const {
+  CHECK_NOTNULL(planes);
+  CHECK_NOTNULL(is_polygon_on_a_plane);
+  is_polygon_on_a_plane->assign(polygon_normals_.size(), 0u);
+
+  // Going plane by plane, in order, and through the candidate polygons in
+  // increasing order gives the same associations (and lmk ids order) as
+  // testing each polygon against each plane.
+  NormalHash::Ids candidate_polygons;
+  Mesh3D::Polygon polygon;
+  std::unordered_set<LandmarkId> lmk_ids_set;
+  for (Plane& plane : *planes) {
+    polygon_normal_hash_.query(
+        plane.normal_, normal_tolerance, &candidate_polygons);
+    lmk_ids_set.clear();
+    lmk_ids_set.insert(plane.lmk_ids_.begin(), plane.lmk_ids_.end());
+    for (const NormalHash::Id& polygon_idx : candidate_polygons) {
+      if (only_associate_a_polygon_to_a_single_plane &&
+          is_polygon_on_a_plane->at(polygon_idx)) {
+        continue;
+      }
+      // Only cluster if normal and distance of polygon are close to plane.
+      // WARNING: same polygon is being possibly clustered in multiple planes.
+      if (!isNormalAroundAxis(
+              plane.normal_, polygon_normals_[polygon_idx], normal_tolerance)) {
+        continue;
+      }
+      CHECK(mesh_3d_.getPolygon(polygon_idx, &polygon))
+          << "Could not retrieve polygon.";
+      if (isPolygonAtDistanceFromPlane(
+              polygon, plane.distance_, plane.normal_, distance_tolerance)) {
+        // Update lmk_ids of the plane.
+        // Points_with_id_vio are only used for stereo.
+        appendLmkIdsOfPolygon(
+            polygon, &plane.lmk_ids_, points_with_id_vio, &lmk_ids_set);
+
+        // TODO Remove, only used for visualization...
+        plane.triangle_cluster_.triangle_ids_.push_back(polygon_idx);
+
+        // Acknowledge that the polygon is at least in one plane, to avoid
+        // sending this polygon to segmentation and segment the same plane
+        // again.
+        is_polygon_on_a_plane->at(polygon_idx) = 1u;
       }
     }
   }
-  return is_polygon_on_a_plane;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -1109,35 +1281,29 @@ bool Mesher::updatePlanesLmkIdsFromPolygon(
 // be a cv::Mat walls (0, 0, CV_32FC2), with first channel being theta (yaw
 // angle of the wall) and the second channel the distance of it.
 // points_with_id_vio is only used if we are using stereo points...
-void Mesher::segmentNewPlanes(std::vector<Plane>* new_segmented_planes,
-                              const cv::Mat& z_components,
-                              const cv::Mat& walls) {
+void Mesher::segmentNewPlanes(std::vector<Plane>* new_segmented_planes) {
   CHECK_NOTNULL(new_segmented_planes);
   new_segmented_planes->clear();
 
   // Segment horizontal planes.
   static size_t plane_id = 0;
   static const Plane::Normal vertical(0, 0, 1);
-  segmentHorizontalPlanes(
-      new_segmented_planes, &plane_id, vertical, z_components);
+  segmentHorizontalPlanes(new_segmented_planes, &plane_id, vertical);
 
   // Segment vertical planes.
-  segmentWalls(new_segmented_planes, &plane_id, walls);
+  segmentWalls(new_segmented_planes, &plane_id);
 }
 
 /* -------------------------------------------------------------------------- */
 // Segment wall planes.
 // plane_id, starting id for new planes, it gets increased every time we add a
 // new plane.
-void Mesher::segmentWalls(std::vector<Plane>* wall_planes,
-                          size_t* plane_id,
-                          const cv::Mat& walls) {
+void Mesher::segmentWalls(std::vector<Plane>* wall_planes, size_t* plane_id) {
   CHECK_NOTNULL(wall_planes);
   CHECK_NOTNULL(plane_id);
   ////////////////////////////// 2D Histogram //////////////////////////////////
-  VLOG(10) << "Starting to calculate 2D histogram...";
-  hist_2d_.calculateHistogram(walls, FLAGS_log_histogram_2D);
-  VLOG(10) << "Finished to calculate 2D histogram.";
+  // Already updated in updatePlaneHistograms.
+  if (FLAGS_log_histogram_2D) hist_2d_.logHistogram();
 
   /// Added by me
   // cv::GaussianBlur(histImg, histImg, cv::Size(9, 9), 0);
@@ -1197,14 +1363,12 @@ void Mesher::segmentWalls(std::vector<Plane>* wall_planes,
 // new plane.
 void Mesher::segmentHorizontalPlanes(std::vector<Plane>* horizontal_planes,
                                      size_t* plane_id,
-                                     const Plane::Normal& normal,
-                                     const cv::Mat& z_components) {
+                                     const Plane::Normal& normal) {
   CHECK_NOTNULL(horizontal_planes);
   CHECK_NOTNULL(plane_id);
   ////////////////////////////// 1D Histogram //////////////////////////////////
-  VLOG(10) << "Starting calculate 1D histogram.";
-  z_hist_.calculateHistogram(z_components, FLAGS_log_histogram_1D);
-  VLOG(10) << "Finished calculate 1D histogram.";
+  // Already updated in updatePlaneHistograms.
+  if (FLAGS_log_histogram_1D) z_hist_.logHistogram();
 
   VLOG(10) << "Starting get local maximum for 1D.";
   static const cv::Size kernel_size(1, FLAGS_z_histogram_gaussian_kernel_size);
@@ -1342,9 +1506,19 @@ void Mesher::associatePlanes(const std::vector<Plane>& segmented_planes,
     // To avoid  associating several segmented planes to the same
     // plane_backend
     std::vector<uint64_t> associated_plane_ids;
+    // Only visit the backend planes with a normal close to the segmented one,
+    // in their original order.
+    NormalHash planes_normal_hash(NormalHash::getChordRadius(normal_tolerance));
+    for (size_t i = 0u; i < planes.size(); i++) {
+      planes_normal_hash.insert(i, planes[i].normal_);
+    }
+    NormalHash::Ids candidate_planes;
     for (const Plane& segmented_plane : segmented_planes) {
       bool is_segmented_plane_associated = false;
-      for (const Plane& plane_backend : planes) {
+      planes_normal_hash.query(
+          segmented_plane.normal_, normal_tolerance, &candidate_planes);
+      for (const NormalHash::Id& plane_idx : candidate_planes) {
+        const Plane& plane_backend = planes[plane_idx];
         // Check if normals are close or 180 degrees apart.
         // Check if distance is similar in absolute value.
         // TODO check distance given the difference in normals.
@@ -1487,12 +1661,20 @@ void Mesher::updateMesh3D(const PointsWithIdMap& points_with_id_VIO,
 
   // Build 2D mesh.
   std::vector<cv::Vec6f> mesh_2d_pixels;
-  createMesh2dVIO(&mesh_2d_pixels,
-                  landmarks,
-                  keypoints_status,
-                  keypoints,
-                  mesher_params_.img_size_,
-                  *points_with_id_all);
+  if (FLAGS_incremental_delaunay) {
+    createMesh2dIncremental(&mesh_2d_pixels,
+                            landmarks,
+                            keypoints_status,
+                            keypoints,
+                            *points_with_id_all);
+  } else {
+    createMesh2dVIO(&mesh_2d_pixels,
+                    landmarks,
+                    keypoints_status,
+                    keypoints,
+                    mesher_params_.img_size_,
+                    *points_with_id_all);
+  }
   if (mesh_2d_for_viz) *mesh_2d_for_viz = mesh_2d_pixels;
   LOG_IF(WARNING, mesh_2d_pixels.size() == 0) << "2D Mesh is empty!";
 
@@ -1506,8 +1688,10 @@ void Mesher::updateMesh3D(const PointsWithIdMap& points_with_id_VIO,
                             FLAGS_max_triangle_side,
                             mesh_2d);
 
-  // Calculate 3d mesh normals.
-  if (FLAGS_compute_per_vertex_normals) mesh_3d_.computePerVertexNormals();
+  // The mesh keeps its normals up to date: this only resets them.
+  if (FLAGS_compute_per_vertex_normals) {
+    mesh_3d_.computePerVertexNormals(FLAGS_mesher_num_threads);
+  }
 
   VLOG(10) << "Finished updateMesh3D.";
 }
@@ -1518,8 +1702,10 @@ void Mesher::updateMesh3D(const PointsWithIdMap& points_with_id_VIO,
 void Mesher::updateMesh3D(const MesherInput& mesher_payload,
                           Mesh2D* mesh_2d,
                           std::vector<cv::Vec6f>* mesh_2d_for_viz) {
+  KIMERA_TRACE_SCOPE("Mesher::updateMesh3D");
+  KIMERA_PERF_SCOPE("Mesher::updateMesh3D");
   const StereoFrame& stereo_frame =
-      mesher_payload.frontend_output_->stereo_frame_lkf_;
+      *mesher_payload.frontend_output_->stereo_frame_lkf_;
   const StatusKeypointsCV& right_keypoints =
       stereo_frame.right_keypoints_rectified_;
   std::vector<KeypointStatus> right_keypoint_status;
@@ -1553,14 +1739,26 @@ void Mesher::appendNonVioStereoPoints(
       << "Landmarks and keypoints_status should have same dimension...";
   CHECK_EQ(landmarks.size(), keypoints_3d.size())
       << "Landmarks and keypoints_3d should have same dimension...";
-  for (size_t i = 0; i < landmarks.size(); i++) {
-    const LandmarkId& landmark_id = landmarks.at(i);
-    if (keypoints_status.at(i) == KeypointStatus::VALID && landmark_id != -1) {
-      const gtsam::Point3& p_i_global =
-          left_cam_pose.transformFrom(gtsam::Point3(keypoints_3d.at(i)));
-      // Use insert() instead of [] operator, to make sure that if there is
+  if (landmarks.empty()) return;
+
+  // Transform all the points at once: the keypoints_3d are contiguous, and
+  // transforming the invalid ones too is cheaper than gathering the valid.
+  static_assert(sizeof(BearingVector) == 3u * sizeof(double),
+                "keypoints_3d must be packed to be mapped.");
+  const Eigen::Map<const Eigen::Matrix3Xd> C_points(
+      keypoints_3d.front().data(), 3, keypoints_3d.size());
+  const Eigen::Matrix3Xd W_points =
+      (left_cam_pose.rotation().matrix() * C_points).colwise() +
+      left_cam_pose.translation();
+
+  points_with_id_stereo->reserve(points_with_id_stereo->size() +
+                                 landmarks.size());
+  for (size_t i = 0u; i < landmarks.size(); ++i) {
+    const LandmarkId& landmark_id = landmarks[i];
+    if (keypoints_status[i] == KeypointStatus::VALID && landmark_id != -1) {
+      // Use emplace() instead of [] operator, to make sure that if there is
       // already a point with the same lmk_id, we do not override it.
-      points_with_id_stereo->insert(std::make_pair(landmark_id, p_i_global));
+      points_with_id_stereo->emplace(landmark_id, W_points.col(i));
     }
   }
 }
@@ -1618,13 +1816,17 @@ void Mesher::extractLmkIdsFromTriangleCluster(
 void Mesher::appendLmkIdsOfPolygon(
     const Mesh3D::Polygon& polygon,
     LandmarkIds* lmk_ids,
-    const PointsWithIdMap& points_with_id_vio) const {
+    const PointsWithIdMap& points_with_id_vio,
+    std::unordered_set<LandmarkId>* lmk_ids_set) const {
   CHECK_NOTNULL(lmk_ids);
   for (const Mesh3D::VertexType& vertex : polygon) {
     // Ensure we are not adding more than once the same lmk_id.
-    const auto& it =
-        std::find(lmk_ids->begin(), lmk_ids->end(), vertex.getLmkId());
-    if (it == lmk_ids->end()) {
+    const bool is_new_lmk_id =
+        lmk_ids_set ? lmk_ids_set->find(vertex.getLmkId()) == lmk_ids_set->end()
+                    : std::find(lmk_ids->begin(),
+                                lmk_ids->end(),
+                                vertex.getLmkId()) == lmk_ids->end();
+    if (is_new_lmk_id) {
       // The lmk id is not present in the lmk_ids vector, add it.
       if (FLAGS_add_extra_lmks_from_stereo) {
         // Only add lmks that are used in the Backend (time-horizon).
@@ -1634,9 +1836,11 @@ void Mesher::appendLmkIdsOfPolygon(
         if (points_with_id_vio.find(vertex.getLmkId()) !=
             points_with_id_vio.end()) {
           lmk_ids->push_back(vertex.getLmkId());
+          if (lmk_ids_set) lmk_ids_set->insert(vertex.getLmkId());
         }
       } else {
         lmk_ids->push_back(vertex.getLmkId());
+        if (lmk_ids_set) lmk_ids_set->insert(vertex.getLmkId());
       }
     } else {
       // The lmk id is already in the lmk_ids vector, do not add it.
@@ -1655,10 +1859,10 @@ void Mesher::getPolygonsMesh(cv::Mat* polygons_mesh) const {
   mesh_3d_.getPolygonsMeshToMat(polygons_mesh);
 }
 
-void Mesher::serializeMeshes() {
+void Mesher::serializeMeshes(const Timestamp& timestamp) {
   CHECK(mesher_logger_);
-  mesher_logger_->serializeMesh(mesh_3d_, "mesh_3d");
-  mesher_logger_->serializeMesh(mesh_2d_, "mesh_2d");
+  mesher_logger_->serializeMesh(mesh_3d_, "mesh_3d", timestamp);
+  mesher_logger_->serializeMesh(mesh_2d_, "mesh_2d", timestamp);
 }
 
 void Mesher::deserializeMeshes() {
@@ -1706,6 +1910,35 @@ void Mesher::createMesh2dVIO(
   *triangulation_2D = createMesh2dImpl(img_size, keypoints_for_mesh);
 }
 
+/* -------------------------------------------------------------------------- */
+void Mesher::createMesh2dIncremental(
+    std::vector<cv::Vec6f>* triangulation_2D,
+    const LandmarkIds& landmarks,
+    const std::vector<KeypointStatus>& keypoints_status,
+    const KeypointsCV& keypoints,
+    const PointsWithIdMap& pointsWithIdVIO) {
+  CHECK_NOTNULL(triangulation_2D);
+  CHECK_EQ(landmarks.size(), keypoints_status.size())
+      << "Wrong dimension for the landmarks";
+  CHECK_EQ(landmarks.size(), keypoints.size())
+      << "Wrong dimension for the keypoints";
+  LOG_IF(WARNING, pointsWithIdVIO.empty())
+      << "List of Keypoints with associated Landmarks is empty.";
+
+  // Valid keypoints with a landmark, identified by the landmark id.
+  std::vector<std::pair<IncrementalDelaunay::VertexId, cv::Point2f>> vertices;
+  vertices.reserve(landmarks.size());
+  for (size_t j = 0u; j < landmarks.size(); j++) {
+    if (keypoints_status[j] == KeypointStatus::VALID &&
+        pointsWithIdVIO.find(landmarks[j]) != pointsWithIdVIO.end()) {
+      vertices.emplace_back(landmarks[j], keypoints[j]);
+    }
+  }
+
+  delaunay_.update(vertices);
+  *triangulation_2D = delaunay_.getTriangleList();
+}
+
 /* -------------------------------------------------------------------------- */
 // Create a 2D mesh from 2D corners in an image
 // Returns the actual keypoints used to perform the triangulation.
@@ -18,7 +18,7 @@ namespace VIO {
 
 MesherModule::MesherModule(bool parallel_run, Mesher::UniquePtr mesher)
     : MIMOPipelineModule<MesherInput, MesherOutput>("Mesher", parallel_run),
-      frontend_payload_queue_("mesher_frontend"),
+      frontend_payload_buffer_("mesher_frontend"),
       backend_payload_queue_("mesher_backend"),
       mesher_(std::move(mesher)) {}
 
@@ -43,11 +43,22 @@ MesherModule::InputUniquePtr MesherModule::getInputPacket() {
   CHECK(backend_payload);
   const Timestamp& timestamp = backend_payload->timestamp_;
 
-  // Look for the synchronized packet in Frontend payload queue
+  // Look for the synchronized packet in Frontend payload buffer
   // This should always work, because it should not be possible to have
   // a Backend payload without having a Frontend one first!
   MesherFrontendInput frontend_payload = nullptr;
-  PIO::syncQueue(timestamp, &frontend_payload_queue_, &frontend_payload);
+  using QueryResult =
+      ThreadsafeRendezvousBuffer<MesherFrontendInput>::QueryResult;
+  const QueryResult result = PIO::syncBuffer(
+      timestamp, &frontend_payload_buffer_, &frontend_payload);
+  if (result == QueryResult::kShutdown) {
+    LOG(WARNING) << "Module: " << name_id_ << " - Frontend buffer is down";
+    return nullptr;
+  }
+  CHECK(result == QueryResult::kFound)
+      << "Module: " << name_id_
+      << " - No Frontend payload for Backend payload at timestamp: "
+      << timestamp;
   CHECK(frontend_payload);
   CHECK(frontend_payload->is_keyframe_);
 
@@ -63,7 +74,7 @@ MesherModule::OutputUniquePtr MesherModule::spinOnce(
 
 void MesherModule::shutdownQueues() {
   LOG(INFO) << "Shutting down queues for: " << name_id_;
-  frontend_payload_queue_.shutdown();
+  frontend_payload_buffer_.shutdown();
   backend_payload_queue_.shutdown();
 };
 
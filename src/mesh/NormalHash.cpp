@@ -0,0 +1,141 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   NormalHash.cpp
+ * @brief  Spatial hash of unit normals, to find the polygons or planes
+ * parallel to a given normal without testing all of them.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/mesh/NormalHash.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+namespace {
+// Cell coordinates are packed in 21 bits each.
+static constexpr int32_t kCellCoordsOffset = 1 << 20;
+// Slack on the chord radius, for the float normals.
+static constexpr double kRadiusSlack = 1e-4;
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+NormalHash::NormalHash(const double& cell_size) : cell_size_(cell_size) {
+  // Unit normals lie in [-1, 1]^3: at most 2 / cell_size cells per axis.
+  CHECK_GT(cell_size_, 2.0 / kCellCoordsOffset);
+}
+
+/* -------------------------------------------------------------------------- */
+void NormalHash::insert(const Id& id, const cv::Point3f& normal) {
+  DCHECK_NEAR(cv::norm(normal), 1.0, 1e-3) << "Expect unit norm.";
+  const CellCoords coords = getCellCoords(normal);
+  Cell& cell = cells_[getCellKey(coords)];
+  cell.coords = coords;
+  cell.ids.push_back(id);
+  ++size_;
+}
+
+/* -------------------------------------------------------------------------- */
+void NormalHash::query(const cv::Point3f& normal,
+                       const double& tolerance,
+                       Ids* ids) const {
+  CHECK_NOTNULL(ids);
+  ids->clear();
+  const double radius = getChordRadius(tolerance) + kRadiusSlack;
+  const cv::Point3d center(normal);
+  collectAround(center, radius, ids);
+  // Parallel normals in the opposite direction.
+  collectAround(-center, radius, ids);
+  std::sort(ids->begin(), ids->end());
+  ids->erase(std::unique(ids->begin(), ids->end()), ids->end());
+}
+
+/* -------------------------------------------------------------------------- */
+void NormalHash::clear() {
+  cells_.clear();
+  size_ = 0u;
+}
+
+/* -------------------------------------------------------------------------- */
+double NormalHash::getChordRadius(const double& tolerance) {
+  // |n - q|^2 = 2 - 2 n.dot(q) < 2 * tolerance, for unit normals.
+  return std::sqrt(2.0 * std::max(tolerance, 0.0));
+}
+
+/* -------------------------------------------------------------------------- */
+NormalHash::CellCoords NormalHash::getCellCoords(
+    const cv::Point3d& point) const {
+  // Clamp to the cube enclosing the unit sphere, so that queries with large
+  // radius do not visit empty cells.
+  const auto coord = [this](const double& x) {
+    return static_cast<int32_t>(
+        std::floor(std::min(std::max(x, -1.0), 1.0) / cell_size_));
+  };
+  return {{coord(point.x), coord(point.y), coord(point.z)}};
+}
+
+/* -------------------------------------------------------------------------- */
+int64_t NormalHash::getCellKey(const CellCoords& coords) {
+  int64_t key = 0;
+  for (const int32_t& coord : coords) {
+    key = (key << 21) | static_cast<int64_t>(coord + kCellCoordsOffset);
+  }
+  return key;
+}
+
+/* -------------------------------------------------------------------------- */
+void NormalHash::collectAround(const cv::Point3d& center,
+                               const double& radius,
+                               Ids* ids) const {
+  CHECK_NOTNULL(ids);
+  const cv::Point3d half_side(radius, radius, radius);
+  const CellCoords min_coords = getCellCoords(center - half_side);
+  const CellCoords max_coords = getCellCoords(center + half_side);
+  size_t nr_cells = 1u;
+  for (size_t k = 0u; k < 3u; ++k) {
+    nr_cells *= static_cast<size_t>(max_coords[k] - min_coords[k] + 1);
+  }
+
+  const auto is_inside = [&min_coords, &max_coords](const CellCoords& coords) {
+    for (size_t k = 0u; k < 3u; ++k) {
+      if (coords[k] < min_coords[k] || coords[k] > max_coords[k]) return false;
+    }
+    return true;
+  };
+  if (nr_cells > cells_.size()) {
+    // Large radius: cheaper to go through the non-empty cells.
+    for (const auto& key_cell : cells_) {
+      const Cell& cell = key_cell.second;
+      if (is_inside(cell.coords)) {
+        ids->insert(ids->end(), cell.ids.begin(), cell.ids.end());
+      }
+    }
+    return;
+  }
+
+  CellCoords coords;
+  for (coords[0] = min_coords[0]; coords[0] <= max_coords[0]; ++coords[0]) {
+    for (coords[1] = min_coords[1]; coords[1] <= max_coords[1]; ++coords[1]) {
+      for (coords[2] = min_coords[2]; coords[2] <= max_coords[2];
+           ++coords[2]) {
+        const auto& cell_it = cells_.find(getCellKey(coords));
+        if (cell_it != cells_.end()) {
+          const Ids& cell_ids = cell_it->second.ids;
+          ids->insert(ids->end(), cell_ids.begin(), cell_ids.end());
+        }
+      }
+    }
+  }
+}
+
+}  // namespace VIO
@@ -0,0 +1,164 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   AdmissionController.cpp
+ * @brief  Sheds the inputs of the optional modules when the critical path
+ * (Frontend and Backend) falls behind.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/pipeline/AdmissionController.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+namespace {
+//! Weight of the latest input in the mean processing time of a module.
+static constexpr double kSpinDurationWeight = 0.1;
+
+const char* asString(const CriticalPathLoad& load) {
+  switch (load) {
+    case CriticalPathLoad::kSlack:
+      return "slack";
+    case CriticalPathLoad::kPressure:
+      return "pressure";
+    case CriticalPathLoad::kCritical:
+      return "critical";
+  }
+  return "unknown";
+}
+}  // namespace
+
+AdmissionController::OptionalModule::OptionalModule(
+    const std::string& name_id,
+    const OptionalModuleBudget& budget)
+    : name_id(name_id),
+      budget(budget),
+      mean_spin_ms(0.0),
+      nr_inputs(0u),
+      nr_admitted(0u),
+      shed_stats("Admission " + name_id + " shed [#]") {}
+
+/* -------------------------------------------------------------------------- */
+AdmissionController::AdmissionController(const size_t& slack_depth,
+                                         const size_t& pressure_depth,
+                                         const size_t& critical_depth)
+    : slack_depth_(slack_depth),
+      pressure_depth_(pressure_depth),
+      critical_depth_(critical_depth),
+      mutex_(),
+      critical_path_queues_(),
+      optional_modules_(),
+      load_(CriticalPathLoad::kSlack) {
+  CHECK_LT(slack_depth_, pressure_depth_);
+  CHECK_LE(pressure_depth_, critical_depth_);
+}
+
+void AdmissionController::addCriticalPathQueue(const std::string& queue_id,
+                                               const DepthCallback& depth) {
+  CHECK(depth);
+  std::lock_guard<std::mutex> lock(mutex_);
+  critical_path_queues_.push_back({queue_id, depth});
+}
+
+size_t AdmissionController::registerOptionalModule(
+    const std::string& name_id,
+    const OptionalModuleBudget& budget) {
+  CHECK_GE(budget.budget_ms, 0.0);
+  CHECK_GT(budget.decimation_under_pressure, 0u);
+  std::lock_guard<std::mutex> lock(mutex_);
+  optional_modules_.push_back(
+      std::make_unique<OptionalModule>(name_id, budget));
+  return optional_modules_.size() - 1u;
+}
+
+CriticalPathLoad AdmissionController::getLoad() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return updateLoad();
+}
+
+bool AdmissionController::admit(const size_t& module_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  CHECK_LT(module_id, optional_modules_.size());
+  OptionalModule& module = *optional_modules_[module_id];
+  const CriticalPathLoad load = updateLoad();
+  bool admitted = false;
+  if (load != CriticalPathLoad::kCritical) {
+    size_t decimation = 1u;
+    if (module.budget.budget_ms > 0.0 &&
+        module.mean_spin_ms > module.budget.budget_ms) {
+      decimation = static_cast<size_t>(
+          std::ceil(module.mean_spin_ms / module.budget.budget_ms));
+    }
+    if (load == CriticalPathLoad::kPressure) {
+      decimation =
+          std::max(decimation, module.budget.decimation_under_pressure);
+    }
+    admitted = module.nr_inputs % decimation == 0u;
+  }
+  ++module.nr_inputs;
+  if (admitted) ++module.nr_admitted;
+  module.shed_stats.AddSample(admitted ? 0.0 : 1.0);
+  VLOG_IF(2, !admitted) << "Module: " << module.name_id
+                        << " - Input shed, critical path load: "
+                        << asString(load);
+  return admitted;
+}
+
+void AdmissionController::reportSpinDuration(const size_t& module_id,
+                                             const double& duration_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  CHECK_LT(module_id, optional_modules_.size());
+  OptionalModule& module = *optional_modules_[module_id];
+  module.mean_spin_ms =
+      module.mean_spin_ms == 0.0
+          ? duration_ms
+          : (1.0 - kSpinDurationWeight) * module.mean_spin_ms +
+                kSpinDurationWeight * duration_ms;
+}
+
+std::string AdmissionController::print() const {
+  std::stringstream ss;
+  std::lock_guard<std::mutex> lock(mutex_);
+  ss << "Admission control (critical path load: " << asString(load_)
+     << ")\nModule\tinputs\tadmitted\tmean [ms]\tbudget [ms]\n";
+  for (const auto& module : optional_modules_) {
+    ss << module->name_id << "\t" << module->nr_inputs << "\t"
+       << module->nr_admitted << "\t" << module->mean_spin_ms << "\t"
+       << module->budget.budget_ms << "\n";
+  }
+  return ss.str();
+}
+
+CriticalPathLoad AdmissionController::updateLoad() {
+  size_t max_depth = 0u;
+  for (const CriticalPathQueue& queue : critical_path_queues_) {
+    max_depth = std::max(max_depth, queue.depth());
+  }
+  CriticalPathLoad load = CriticalPathLoad::kSlack;
+  if (max_depth >= critical_depth_) {
+    load = CriticalPathLoad::kCritical;
+  } else if (max_depth >= pressure_depth_ ||
+             (load_ != CriticalPathLoad::kSlack && max_depth > slack_depth_)) {
+    // Hysteresis: stays loaded until there is slack.
+    load = CriticalPathLoad::kPressure;
+  }
+  VLOG_IF(1, load != load_) << "Critical path load: " << asString(load_)
+                            << " -> " << asString(load)
+                            << " (max queue depth: " << max_depth << ")";
+  load_ = load;
+  return load;
+}
+
+}  // namespace VIO
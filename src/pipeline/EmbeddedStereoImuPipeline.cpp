@@ -0,0 +1,193 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   EmbeddedStereoImuPipeline.cpp
+ * @brief  Stereo VIO run inline in the thread of the caller, one step per
+ * stereo frame.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/pipeline/EmbeddedStereoImuPipeline.h"
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <chrono>
+#include <memory>
+#include <utility>
+
+#include "kimera-vio/backend/VioBackendFactory.h"
+#include "kimera-vio/frontend/StereoFrame.h"
+#include "kimera-vio/frontend/StereoImuSyncPacket.h"
+#include "kimera-vio/frontend/StereoVisionImuFrontend-definitions.h"
+#include "kimera-vio/frontend/VisionImuFrontendFactory.h"
+#include "kimera-vio/mesh/MesherFactory.h"
+#include "kimera-vio/pipeline/Pipeline.h"
+#include "kimera-vio/utils/AllocationTracker.h"
+#include "kimera-vio/utils/Timer.h"
+
+DECLARE_bool(do_fine_imu_camera_temporal_sync);
+
+namespace VIO {
+
+EmbeddedStereoImuPipeline::EmbeddedStereoImuPipeline(
+    const VioParams& params,
+    const bool& use_mesher,
+    const size_t& max_imu_batch_size)
+    : stereo_camera_(nullptr),
+      vio_frontend_(nullptr),
+      vio_backend_(nullptr),
+      keyframe_step_(nullptr),
+      mesher_(nullptr),
+      max_imu_batch_size_(max_imu_batch_size),
+      W_State_Blkf_(0, VioNavState()),
+      backend_initialized_(false),
+      backend_failed_(false),
+      mesher_output_(nullptr),
+      step_stats_("Embedded step [ms]"),
+      frontend_stats_("Embedded Frontend [ms]"),
+      backend_stats_("Embedded Backend [ms]"),
+      mesher_stats_("Embedded Mesher [ms]"),
+      perf_stats_("Embedded step") {
+  CHECK_EQ(params.camera_params_.size(), 2u)
+      << "Need two cameras for EmbeddedStereoImuPipeline.";
+  CHECK(params.frontend_type_ == FrontendType::kStereoImu)
+      << "EmbeddedStereoImuPipeline needs a stereo Frontend.";
+  CHECK_GT(max_imu_batch_size_, 0u);
+  // The time alignment shifts the IMU stamps, which the caller gives.
+  CHECK(!FLAGS_do_fine_imu_camera_temporal_sync)
+      << "EmbeddedStereoImuPipeline does not support the online IMU-camera "
+         "time alignment: synchronize the IMU with the frames instead.";
+  stereo_camera_ = std::make_shared<StereoCamera>(params.camera_params_.at(0),
+                                                  params.camera_params_.at(1));
+
+  vio_frontend_ = VisionImuFrontendFactory::createFrontend(
+      params.frontend_type_,
+      params.imu_params_,
+      gtsam::imuBias::ConstantBias(),
+      params.frontend_params_,
+      stereo_camera_,
+      nullptr,
+      FLAGS_log_output,
+      params.odom_params_);
+  CHECK(vio_frontend_);
+
+  CHECK(params.backend_params_);
+  vio_backend_ = BackendFactory::createBackend(
+      static_cast<BackendType>(params.backend_type_),
+      stereo_camera_->getBodyPoseLeftCamRect(),
+      stereo_camera_->getStereoCalib(),
+      *params.backend_params_,
+      params.imu_params_,
+      BackendOutputParams(
+          use_mesher, FLAGS_min_num_obs_for_mesher_points, false),
+      FLAGS_log_output,
+      params.odom_params_);
+  CHECK(vio_backend_);
+  // Only the light fields of the output are used, see the Mesher.
+  vio_backend_->setOutputFields(BackendOutputFields());
+  // The Frontend tracks wrt the latest estimates without going through a
+  // module.
+  keyframe_step_ = std::make_unique<StereoKeyframeStep>(vio_frontend_.get(),
+                                                        vio_backend_.get());
+
+  if (use_mesher) {
+    mesher_ = MesherFactory::createMesher(
+        MesherType::PROJECTIVE,
+        MesherParams(stereo_camera_->getBodyPoseLeftCamRect(),
+                     params.camera_params_.at(0u).image_size_));
+    CHECK(mesher_);
+  }
+}
+
+bool EmbeddedStereoImuPipeline::step(const ImuStampS& imu_stamps,
+                                     const ImuAccGyrS& imu_accgyrs,
+                                     const Frame& left_frame,
+                                     const Frame& right_frame,
+                                     EmbeddedVioState* state) {
+  CHECK_NOTNULL(state);
+  CHECK_EQ(imu_stamps.cols(), imu_accgyrs.cols());
+  CHECK_LE(static_cast<size_t>(imu_stamps.cols()), max_imu_batch_size_)
+      << "Too many IMU measurements for one step.";
+  CHECK_EQ(left_frame.timestamp_, right_frame.timestamp_);
+  state->valid = false;
+  state->is_keyframe = false;
+  state->frontend_us = 0;
+  state->backend_us = 0;
+  state->mesher_us = 0;
+  state->step_us = 0;
+  if (backend_failed_) return false;
+
+  utils::PerfScope perf_scope(&perf_stats_);
+  utils::AllocationScope allocation_scope("Embedded step");
+  const auto step_start = utils::Timer::tic();
+
+  //////////////////////////////// FRONTEND ////////////////////////////////////
+  auto start = utils::Timer::tic();
+  FrontendOutputPacketBase::UniquePtr frontend_output = vio_frontend_->spinOnce(
+      std::make_unique<StereoImuSyncPacket>(
+          StereoFrame(
+              left_frame.id_, left_frame.timestamp_, left_frame, right_frame),
+          imu_stamps,
+          imu_accgyrs));
+  state->frontend_us =
+      utils::Timer::toc<std::chrono::microseconds>(start).count();
+  frontend_stats_.AddSample(static_cast<double>(state->frontend_us) / 1e3);
+
+  StereoFrontendOutput::Ptr stereo_output = nullptr;
+  if (frontend_output) {
+    stereo_output = StereoKeyframeStep::castOutput(std::move(frontend_output));
+    state->is_keyframe = stereo_output->is_keyframe_;
+  }
+
+  //////////////////////////////// BACKEND /////////////////////////////////////
+  if (state->is_keyframe) {
+    start = utils::Timer::tic();
+    const BackendOutput::Ptr backend_output =
+        keyframe_step_->spinOnce(*stereo_output);
+    state->backend_us =
+        utils::Timer::toc<std::chrono::microseconds>(start).count();
+    backend_stats_.AddSample(static_cast<double>(state->backend_us) / 1e3);
+    if (!backend_output) {
+      LOG(ERROR) << "Backend did not return an output: stopping the steps.";
+      backend_failed_ = true;
+      return false;
+    }
+    W_State_Blkf_ = backend_output->W_State_Blkf_;
+    backend_initialized_ = true;
+
+    ///////////////////////////////// MESHER /////////////////////////////////
+    if (mesher_) {
+      start = utils::Timer::tic();
+      mesher_output_ = mesher_->spinOnce(MesherInput(
+          backend_output->timestamp_, stereo_output, backend_output));
+      state->mesher_us =
+          utils::Timer::toc<std::chrono::microseconds>(start).count();
+      mesher_stats_.AddSample(static_cast<double>(state->mesher_us) / 1e3);
+    }
+    state->W_State_B = W_State_Blkf_;
+    state->valid = true;
+  } else if (backend_initialized_ && stereo_output && stereo_output->pim_) {
+    // Predicted from the last keyframe, as the IMU propagation would.
+    const gtsam::NavState W_NavState_B = stereo_output->pim_->predict(
+        gtsam::NavState(W_State_Blkf_.pose_, W_State_Blkf_.velocity_),
+        W_State_Blkf_.imu_bias_);
+    state->W_State_B = VioNavStateTimestamped(
+        left_frame.timestamp_,
+        VioNavState(W_NavState_B, W_State_Blkf_.imu_bias_));
+    state->valid = true;
+  }
+
+  state->step_us =
+      utils::Timer::toc<std::chrono::microseconds>(step_start).count();
+  step_stats_.AddSample(static_cast<double>(state->step_us) / 1e3);
+  return true;
+}
+
+}  // namespace VIO
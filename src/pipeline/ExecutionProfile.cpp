@@ -0,0 +1,440 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ExecutionProfile.cpp
+ * @brief  Performance, balanced and low-power execution profiles of the
+ * pipeline, and the monitor switching between them from the temperature, the
+ * CPU frequency and the latency headroom.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/pipeline/ExecutionProfile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+#include <glog/logging.h>
+
+#include "kimera-vio/utils/Statistics.h"
+#include "kimera-vio/utils/YamlParser.h"
+
+namespace VIO {
+
+namespace {
+//! End-to-end latency of the keyframes, see PipelineLatency.
+static const std::string kLatencyTag = "VioBackend Latency [ms]";
+
+//! @return False if the file can not be read (e.g. off Linux).
+bool readNumber(const std::filesystem::path& filepath, double* number) {
+  CHECK_NOTNULL(number);
+  std::ifstream file(filepath);
+  return static_cast<bool>(file >> *number);
+}
+
+ExecutionProfileType stepDown(const ExecutionProfileType& type) {
+  return type == ExecutionProfileType::kPerformance
+             ? ExecutionProfileType::kBalanced
+             : ExecutionProfileType::kLowPower;
+}
+
+ExecutionProfileType stepUp(const ExecutionProfileType& type) {
+  return type == ExecutionProfileType::kLowPower
+             ? ExecutionProfileType::kBalanced
+             : ExecutionProfileType::kPerformance;
+}
+
+void parseProfile(const YamlParser& yaml_parser,
+                  const std::string& prefix,
+                  ExecutionProfile* profile) {
+  CHECK_NOTNULL(profile);
+  if (yaml_parser.hasParam(prefix + "_feature_budget_scale")) {
+    yaml_parser.getYamlParam(prefix + "_feature_budget_scale",
+                             &profile->feature_budget_scale);
+  }
+  int decimation = 0;
+  if (yaml_parser.hasParam(prefix + "_frontend_frame_decimation")) {
+    yaml_parser.getYamlParam(prefix + "_frontend_frame_decimation",
+                             &decimation);
+    CHECK_GT(decimation, 0);
+    profile->frontend_frame_decimation = static_cast<size_t>(decimation);
+  }
+  if (yaml_parser.hasParam(prefix + "_mesher_decimation")) {
+    yaml_parser.getYamlParam(prefix + "_mesher_decimation", &decimation);
+    CHECK_GT(decimation, 0);
+    profile->mesher_decimation = static_cast<size_t>(decimation);
+  }
+  if (yaml_parser.hasParam(prefix + "_lcd_decimation")) {
+    yaml_parser.getYamlParam(prefix + "_lcd_decimation", &decimation);
+    CHECK_GT(decimation, 0);
+    profile->lcd_decimation = static_cast<size_t>(decimation);
+  }
+  if (yaml_parser.hasParam(prefix + "_backend_nr_threads")) {
+    yaml_parser.getYamlParam(prefix + "_backend_nr_threads",
+                             &profile->backend_nr_threads);
+  }
+  CHECK_GT(profile->feature_budget_scale, 0.0);
+  CHECK_LE(profile->feature_budget_scale, 1.0);
+  CHECK_GE(profile->backend_nr_threads, 0);
+}
+}  // namespace
+
+std::string asString(const ExecutionProfileType& type) {
+  switch (type) {
+    case ExecutionProfileType::kPerformance:
+      return "performance";
+    case ExecutionProfileType::kBalanced:
+      return "balanced";
+    case ExecutionProfileType::kLowPower:
+      return "low_power";
+  }
+  return "unknown";
+}
+
+bool operator==(const ExecutionProfile& lhs, const ExecutionProfile& rhs) {
+  return lhs.feature_budget_scale == rhs.feature_budget_scale &&
+         lhs.frontend_frame_decimation == rhs.frontend_frame_decimation &&
+         lhs.mesher_decimation == rhs.mesher_decimation &&
+         lhs.lcd_decimation == rhs.lcd_decimation &&
+         lhs.backend_nr_threads == rhs.backend_nr_threads;
+}
+
+ExecutionProfileParams::ExecutionProfileParams()
+    : PipelineParams("Execution Profile Parameters"),
+      initial_profile_(ExecutionProfileType::kPerformance),
+      auto_switch_(false),
+      profiles_(),
+      monitor_params_() {
+  // Performance: the configured pipeline, as without profiles.
+  ExecutionProfile& balanced =
+      profiles_[static_cast<size_t>(ExecutionProfileType::kBalanced)];
+  balanced.feature_budget_scale = 0.75;
+  balanced.mesher_decimation = 2u;
+  balanced.lcd_decimation = 2u;
+  ExecutionProfile& low_power =
+      profiles_[static_cast<size_t>(ExecutionProfileType::kLowPower)];
+  low_power.feature_budget_scale = 0.5;
+  low_power.frontend_frame_decimation = 2u;
+  low_power.mesher_decimation = 4u;
+  low_power.lcd_decimation = 4u;
+  low_power.backend_nr_threads = 1;
+}
+
+bool ExecutionProfileParams::parseYAML(const std::string& filepath) {
+  YamlParser yaml_parser(filepath);
+  if (yaml_parser.hasParam("execution_profile")) {
+    int profile = 0;
+    yaml_parser.getYamlParam("execution_profile", &profile);
+    CHECK_GE(profile, 0);
+    CHECK_LT(profile, static_cast<int>(kNrExecutionProfiles))
+        << "Unrecognized execution profile: " << profile
+        << ". 0: performance, 1: balanced, 2: low_power.";
+    initial_profile_ = static_cast<ExecutionProfileType>(profile);
+  }
+  if (yaml_parser.hasParam("auto_execution_profile")) {
+    yaml_parser.getYamlParam("auto_execution_profile", &auto_switch_);
+  }
+  for (size_t i = 0u; i < kNrExecutionProfiles; ++i) {
+    parseProfile(yaml_parser,
+                 asString(static_cast<ExecutionProfileType>(i)),
+                 &profiles_[i]);
+  }
+
+  ExecutionProfileMonitorParams& monitor = monitor_params_;
+  if (yaml_parser.hasParam("profile_monitor_period_ms")) {
+    int period_ms = 0;
+    yaml_parser.getYamlParam("profile_monitor_period_ms", &period_ms);
+    CHECK_GT(period_ms, 0);
+    monitor.period = std::chrono::milliseconds(period_ms);
+  }
+  if (yaml_parser.hasParam("profile_target_latency_ms")) {
+    yaml_parser.getYamlParam("profile_target_latency_ms",
+                             &monitor.target_latency_ms);
+    CHECK_GE(monitor.target_latency_ms, 0.0);
+  }
+  if (yaml_parser.hasParam("profile_hot_temperature_c")) {
+    yaml_parser.getYamlParam("profile_hot_temperature_c",
+                             &monitor.hot_temperature_c);
+  }
+  if (yaml_parser.hasParam("profile_cool_temperature_c")) {
+    yaml_parser.getYamlParam("profile_cool_temperature_c",
+                             &monitor.cool_temperature_c);
+  }
+  CHECK_LT(monitor.cool_temperature_c, monitor.hot_temperature_c);
+  if (yaml_parser.hasParam("profile_throttled_frequency_ratio")) {
+    yaml_parser.getYamlParam("profile_throttled_frequency_ratio",
+                             &monitor.throttled_frequency_ratio);
+    CHECK_GE(monitor.throttled_frequency_ratio, 0.0);
+    CHECK_LE(monitor.throttled_frequency_ratio, 1.0);
+  }
+  if (yaml_parser.hasParam("profile_min_latency_headroom")) {
+    yaml_parser.getYamlParam("profile_min_latency_headroom",
+                             &monitor.min_latency_headroom);
+  }
+  if (yaml_parser.hasParam("profile_recover_latency_headroom")) {
+    yaml_parser.getYamlParam("profile_recover_latency_headroom",
+                             &monitor.recover_latency_headroom);
+  }
+  CHECK_LT(monitor.min_latency_headroom, monitor.recover_latency_headroom);
+  int periods = 0;
+  if (yaml_parser.hasParam("profile_recover_periods")) {
+    yaml_parser.getYamlParam("profile_recover_periods", &periods);
+    CHECK_GT(periods, 0);
+    monitor.recover_periods = static_cast<size_t>(periods);
+  }
+  if (yaml_parser.hasParam("profile_hold_periods")) {
+    yaml_parser.getYamlParam("profile_hold_periods", &periods);
+    CHECK_GE(periods, 0);
+    monitor.hold_periods = static_cast<size_t>(periods);
+  }
+  return true;
+}
+
+void ExecutionProfileParams::print() const {
+  std::stringstream profiles;
+  for (size_t i = 0u; i < kNrExecutionProfiles; ++i) {
+    const ExecutionProfile& profile = profiles_[i];
+    profiles << '\n'
+             << asString(static_cast<ExecutionProfileType>(i))
+             << ": feature budget scale " << profile.feature_budget_scale
+             << ", frontend frame decimation "
+             << profile.frontend_frame_decimation << ", mesher decimation "
+             << profile.mesher_decimation << ", lcd decimation "
+             << profile.lcd_decimation << ", backend nr threads "
+             << profile.backend_nr_threads;
+  }
+  std::stringstream out;
+  PipelineParams::print(out,
+                        "Initial profile: ",
+                        asString(initial_profile_),
+                        "Auto switch: ",
+                        auto_switch_,
+                        "Monitor period [ms]: ",
+                        monitor_params_.period.count(),
+                        "Target latency [ms]: ",
+                        monitor_params_.target_latency_ms,
+                        "Hot temperature [C]: ",
+                        monitor_params_.hot_temperature_c,
+                        "Cool temperature [C]: ",
+                        monitor_params_.cool_temperature_c,
+                        "Throttled frequency ratio: ",
+                        monitor_params_.throttled_frequency_ratio,
+                        "Min latency headroom: ",
+                        monitor_params_.min_latency_headroom,
+                        "Recover latency headroom: ",
+                        monitor_params_.recover_latency_headroom,
+                        "Recover periods: ",
+                        monitor_params_.recover_periods,
+                        "Hold periods: ",
+                        monitor_params_.hold_periods);
+  LOG(INFO) << out.str() << profiles.str();
+}
+
+bool ExecutionProfileParams::equals(const PipelineParams& obj) const {
+  const auto& rhs = static_cast<const ExecutionProfileParams&>(obj);
+  const ExecutionProfileMonitorParams& m = monitor_params_;
+  const ExecutionProfileMonitorParams& rm = rhs.monitor_params_;
+  return initial_profile_ == rhs.initial_profile_ &&
+         auto_switch_ == rhs.auto_switch_ && profiles_ == rhs.profiles_ &&
+         m.period == rm.period && m.target_latency_ms == rm.target_latency_ms &&
+         m.hot_temperature_c == rm.hot_temperature_c &&
+         m.throttled_frequency_ratio == rm.throttled_frequency_ratio &&
+         m.min_latency_headroom == rm.min_latency_headroom &&
+         m.cool_temperature_c == rm.cool_temperature_c &&
+         m.recover_latency_headroom == rm.recover_latency_headroom &&
+         m.recover_periods == rm.recover_periods &&
+         m.hold_periods == rm.hold_periods;
+}
+
+ExecutionProfileGovernor::ExecutionProfileGovernor(
+    const ExecutionProfileMonitorParams& params,
+    const ExecutionProfileType& initial_profile)
+    : params_(params),
+      profile_(initial_profile),
+      nr_relaxed_readings_(0u),
+      readings_since_switch_(params.hold_periods) {
+  CHECK_GT(params_.recover_periods, 0u);
+}
+
+bool ExecutionProfileGovernor::update(const PlatformReading& reading) {
+  ++readings_since_switch_;
+  if (isStressed(reading)) {
+    nr_relaxed_readings_ = 0u;
+    if (profile_ == ExecutionProfileType::kLowPower ||
+        readings_since_switch_ <= params_.hold_periods) {
+      return false;
+    }
+    profile_ = stepDown(profile_);
+    readings_since_switch_ = 0u;
+    return true;
+  }
+  if (!isRelaxed(reading)) {
+    nr_relaxed_readings_ = 0u;
+    return false;
+  }
+  ++nr_relaxed_readings_;
+  if (profile_ == ExecutionProfileType::kPerformance ||
+      nr_relaxed_readings_ < params_.recover_periods) {
+    return false;
+  }
+  profile_ = stepUp(profile_);
+  nr_relaxed_readings_ = 0u;
+  readings_since_switch_ = 0u;
+  return true;
+}
+
+void ExecutionProfileGovernor::reset(const ExecutionProfileType& profile) {
+  profile_ = profile;
+  nr_relaxed_readings_ = 0u;
+  readings_since_switch_ = 0u;
+}
+
+bool ExecutionProfileGovernor::isStressed(
+    const PlatformReading& reading) const {
+  // Comparisons with NaN (unknown) are false.
+  return reading.temperature_c >= params_.hot_temperature_c ||
+         reading.frequency_ratio < params_.throttled_frequency_ratio ||
+         reading.latency_headroom < params_.min_latency_headroom;
+}
+
+bool ExecutionProfileGovernor::isRelaxed(
+    const PlatformReading& reading) const {
+  return !(reading.temperature_c > params_.cool_temperature_c) &&
+         !(reading.frequency_ratio < params_.throttled_frequency_ratio) &&
+         !(reading.latency_headroom < params_.recover_latency_headroom);
+}
+
+ExecutionProfileMonitor::ExecutionProfileMonitor(
+    const ExecutionProfileMonitorParams& params,
+    const ExecutionProfileType& initial_profile,
+    const SwitchCallback& switch_callback)
+    : params_(params),
+      switch_callback_(switch_callback),
+      mutex_(),
+      shutdown_cond_(),
+      shutdown_(false),
+      governor_(params, initial_profile),
+      last_nr_latency_samples_(0u),
+      last_latency_total_ms_(0.0),
+      thread_() {
+  CHECK(switch_callback_);
+  CHECK_GT(params_.period.count(), 0);
+  LOG_IF(WARNING,
+         std::isnan(readMaxTemperatureC()) &&
+             std::isnan(readMinFrequencyRatio()))
+      << "No thermal zone nor CPU frequency to read: execution profiles "
+         "only switch from the latency headroom.";
+  thread_ = std::thread(&ExecutionProfileMonitor::run, this);
+}
+
+ExecutionProfileMonitor::~ExecutionProfileMonitor() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  shutdown_cond_.notify_all();
+  thread_.join();
+}
+
+void ExecutionProfileMonitor::reset(const ExecutionProfileType& profile) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  governor_.reset(profile);
+}
+
+double ExecutionProfileMonitor::readMaxTemperatureC() {
+  namespace fs = std::filesystem;
+  double max_temperature_c = std::numeric_limits<double>::quiet_NaN();
+  std::error_code error;
+  for (fs::directory_iterator it("/sys/class/thermal", error), end;
+       !error && it != end;
+       it.increment(error)) {
+    if (it->path().filename().string().rfind("thermal_zone", 0) != 0u) {
+      continue;
+    }
+    double millidegrees = 0.0;
+    if (!readNumber(it->path() / "temp", &millidegrees)) continue;
+    // fmax ignores the NaN.
+    max_temperature_c = std::fmax(max_temperature_c, millidegrees / 1000.0);
+  }
+  return max_temperature_c;
+}
+
+double ExecutionProfileMonitor::readMinFrequencyRatio() {
+  namespace fs = std::filesystem;
+  double min_ratio = std::numeric_limits<double>::quiet_NaN();
+  std::error_code error;
+  for (fs::directory_iterator it("/sys/devices/system/cpu/cpufreq", error),
+       end;
+       !error && it != end;
+       it.increment(error)) {
+    if (it->path().filename().string().rfind("policy", 0) != 0u) continue;
+    double max_khz = 0.0;
+    double allowed_khz = 0.0;
+    if (!readNumber(it->path() / "cpuinfo_max_freq", &max_khz) ||
+        !readNumber(it->path() / "scaling_max_freq", &allowed_khz) ||
+        max_khz <= 0.0) {
+      continue;
+    }
+    min_ratio = std::fmin(min_ratio, allowed_khz / max_khz);
+  }
+  return min_ratio;
+}
+
+void ExecutionProfileMonitor::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!shutdown_) {
+    shutdown_cond_.wait_for(lock, params_.period, [this] { return shutdown_; });
+    if (shutdown_) break;
+    PlatformReading reading;
+    reading.temperature_c = readMaxTemperatureC();
+    reading.frequency_ratio = readMinFrequencyRatio();
+    reading.latency_headroom = measureLatencyHeadroom();
+    VLOG(5) << "Platform reading: temperature " << reading.temperature_c
+            << " C, frequency ratio " << reading.frequency_ratio
+            << ", latency headroom " << reading.latency_headroom;
+    if (!governor_.update(reading)) continue;
+    const ExecutionProfileType profile = governor_.getProfile();
+    LOG(WARNING) << "Switching to the " << asString(profile)
+                 << " execution profile (temperature "
+                 << reading.temperature_c << " C, frequency ratio "
+                 << reading.frequency_ratio << ", latency headroom "
+                 << reading.latency_headroom << ").";
+    // Without the lock, the callback may take a while.
+    lock.unlock();
+    switch_callback_(profile);
+    lock.lock();
+  }
+}
+
+double ExecutionProfileMonitor::measureLatencyHeadroom() {
+  if (params_.target_latency_ms <= 0.0 ||
+      !utils::Statistics::HasHandle(kLatencyTag)) {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+  const size_t nr_samples = utils::Statistics::GetNumSamples(kLatencyTag);
+  const double total_ms = utils::Statistics::GetTotal(kLatencyTag);
+  if (nr_samples < last_nr_latency_samples_) {
+    // The statistics were reset since the last reading.
+    last_nr_latency_samples_ = 0u;
+    last_latency_total_ms_ = 0.0;
+  }
+  const size_t nr_new_samples = nr_samples - last_nr_latency_samples_;
+  const double new_total_ms = total_ms - last_latency_total_ms_;
+  last_nr_latency_samples_ = nr_samples;
+  last_latency_total_ms_ = total_ms;
+  if (nr_new_samples == 0u) return std::numeric_limits<double>::quiet_NaN();
+  const double mean_latency_ms =
+      new_total_ms / static_cast<double>(nr_new_samples);
+  return 1.0 - mean_latency_ms / params_.target_latency_ms;
+}
+
+}  // namespace VIO
@@ -0,0 +1,177 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ModuleScheduler.cpp
+ * @brief  Runs pipeline modules as tasks on a shared pool of worker threads,
+ * instead of one thread per module.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/pipeline/ModuleScheduler.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+ModuleScheduler::ModuleScheduler(
+    const size_t& nr_workers,
+    const std::chrono::milliseconds& idle_poll_period)
+    : nr_workers_(nr_workers),
+      idle_poll_period_(idle_poll_period),
+      mutex_(),
+      work_cv_(),
+      modules_(),
+      nr_critical_modules_(0u),
+      nr_running_background_(0u),
+      shutdown_(false),
+      workers_() {
+  CHECK_GT(nr_workers_, 0u);
+  CHECK_GT(idle_poll_period_.count(), 0);
+}
+
+ModuleScheduler::~ModuleScheduler() {
+  shutdown();
+  join();
+}
+
+void ModuleScheduler::addModule(PipelineModuleBase* module,
+                                const ModulePriority& priority,
+                                const std::string& name) {
+  CHECK_NOTNULL(module);
+  std::lock_guard<std::mutex> lock(mutex_);
+  ScheduledModule scheduled_module;
+  scheduled_module.module = module;
+  scheduled_module.priority = priority;
+  scheduled_module.name = name;
+  // Keep critical modules first, in the order they were added.
+  auto it = modules_.begin();
+  while (it != modules_.end() && it->priority <= priority) ++it;
+  modules_.insert(it, scheduled_module);
+  if (priority == ModulePriority::kCritical) ++nr_critical_modules_;
+  LOG_IF(WARNING, !workers_.empty() && nr_critical_modules_ >= nr_workers_)
+      << "Module scheduler has " << nr_critical_modules_
+      << " critical modules for " << nr_workers_
+      << " workers: they will not all run at the same time.";
+  if (!workers_.empty()) work_cv_.notify_all();
+}
+
+void ModuleScheduler::removeModule(PipelineModuleBase* module) {
+  CHECK_NOTNULL(module);
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto it = modules_.begin();
+  while (it != modules_.end() && it->module != module) ++it;
+  CHECK(it != modules_.end()) << "Module not in the scheduler.";
+  it->is_done = true;
+  // Workers notify after each run.
+  work_cv_.wait(lock, [&it] { return !it->is_running; });
+  VLOG(1) << "Module scheduler removes: " << it->name << " after "
+          << it->nr_runs << " runs.";
+  if (it->priority == ModulePriority::kCritical) --nr_critical_modules_;
+  modules_.erase(it);
+}
+
+void ModuleScheduler::start() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  CHECK(workers_.empty()) << "Module scheduler already started.";
+  CHECK(nr_critical_modules_ == modules_.size() ||
+        nr_workers_ > nr_critical_modules_)
+      << "Need more workers (" << nr_workers_ << ") than critical modules ("
+      << nr_critical_modules_ << ") to run background modules.";
+  LOG(INFO) << "Launching module scheduler with " << nr_workers_
+            << " workers for " << modules_.size() << " modules.";
+  for (size_t i = 0u; i < nr_workers_; ++i) {
+    workers_.emplace_back(&ModuleScheduler::workerLoop, this);
+  }
+}
+
+void ModuleScheduler::notify() {
+  { std::lock_guard<std::mutex> lock(mutex_); }
+  work_cv_.notify_all();
+}
+
+void ModuleScheduler::shutdown() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  work_cv_.notify_all();
+}
+
+void ModuleScheduler::join() {
+  for (std::thread& worker : workers_) {
+    if (worker.joinable()) worker.join();
+  }
+  workers_.clear();
+}
+
+std::string ModuleScheduler::printStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::stringstream out;
+  out << "Module scheduler runs per module:";
+  for (const ScheduledModule& scheduled_module : modules_) {
+    out << ' ' << scheduled_module.name << ": " << scheduled_module.nr_runs
+        << ';';
+  }
+  return out.str();
+}
+
+void ModuleScheduler::workerLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!shutdown_) {
+    ScheduledModule* scheduled_module = pickModule();
+    if (!scheduled_module) {
+      work_cv_.wait_for(lock, idle_poll_period_);
+      continue;
+    }
+
+    scheduled_module->is_running = true;
+    const bool is_background =
+        scheduled_module->priority == ModulePriority::kBackground;
+    if (is_background) ++nr_running_background_;
+    lock.unlock();
+
+    // In sequential mode, spin runs one iteration and returns false only
+    // once the module is shutdown.
+    const bool is_alive = scheduled_module->module->spin();
+
+    lock.lock();
+    scheduled_module->is_running = false;
+    // Not reset: it may have been removed meanwhile.
+    if (!is_alive) scheduled_module->is_done = true;
+    ++scheduled_module->nr_runs;
+    if (is_background) --nr_running_background_;
+    // Its output is likely another module's input.
+    work_cv_.notify_all();
+  }
+}
+
+ModuleScheduler::ScheduledModule* ModuleScheduler::pickModule() {
+  // Workers kept for the critical modules, leaving at least one (only with
+  // modules added after start, see the check in start()).
+  const size_t nr_reserved_workers =
+      std::min(nr_critical_modules_, nr_workers_ - 1u);
+  const bool can_run_background =
+      nr_running_background_ + nr_reserved_workers < nr_workers_;
+  for (ScheduledModule& scheduled_module : modules_) {
+    if (scheduled_module.is_running || scheduled_module.is_done) continue;
+    if (scheduled_module.priority == ModulePriority::kBackground &&
+        !can_run_background) {
+      // Modules are sorted by priority: no other module can run.
+      break;
+    }
+    // Not running, hence isWorking only checks its input queues.
+    if (scheduled_module.module->isWorking()) return &scheduled_module;
+  }
+  return nullptr;
+}
+
+}  // namespace VIO
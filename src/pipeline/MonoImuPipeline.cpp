@@ -17,6 +17,7 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include <future>
 #include <string>
 
 #include "kimera-vio/backend/VioBackendFactory.h"
@@ -38,14 +39,70 @@ namespace VIO {
 MonoImuPipeline::MonoImuPipeline(const VioParams& params,
                                  Visualizer3D::UniquePtr&& visualizer,
                                  DisplayBase::UniquePtr&& displayer,
-                                 PreloadedVocab::Ptr&& preloaded_vocab)
-    : Pipeline(params), camera_(nullptr) {
+                                 PreloadedVocab::Ptr&& preloaded_vocab,
+                                 PipelineContext::Ptr context)
+    : Pipeline(params, std::move(context)), camera_(nullptr) {
   // CHECK_EQ(params.camera_params_.size(), 1u) << "Need one camera for
   // MonoImuPipeline.";
   camera_ = std::make_shared<Camera>(params.camera_params_.at(0));
+  const bool visualize = shouldVisualize(params, visualizer != nullptr,
+                                         displayer != nullptr);
+
+  //! The LCD, whose vocabulary takes the longest to load, and the Backend
+  //! are constructed while the other modules are. The task of the LCD may
+  //! outlive this constructor: it only captures copies.
+  std::future<LoopClosureDetector::UniquePtr> lcd_future;
+  if (FLAGS_use_lcd) {
+    lcd_future = startAsync([lcd_params = params.lcd_params_,
+                             camera = camera_,
+                             context = context_,
+                             preloaded_vocab =
+                                 std::move(preloaded_vocab)]() mutable {
+      if (!preloaded_vocab && context) {
+        preloaded_vocab = context->getPreloadedVocab();
+      }
+      return LcdFactory::createLcd(lcd_params.lcd_type_,
+                                   lcd_params,
+                                   camera->getCamParams(),
+                                   camera->getBodyPoseCam(),
+                                   std::nullopt,
+                                   std::nullopt,
+                                   std::nullopt,
+                                   FLAGS_log_output,
+                                   std::move(preloaded_vocab));
+    });
+  }
+
+  //! Params for what the Backend outputs.
+  // TODO(Toni): put this into Backend params.
+  BackendOutputParams backend_output_params(
+      static_cast<VisualizationType>(FLAGS_viz_type) !=
+          VisualizationType::kNone,
+      FLAGS_min_num_obs_for_mesher_points,
+      visualize && FLAGS_visualize_lmk_type);
+  // TODO(marcus): get rid of fake stereocam
+  LOG_IF(FATAL, params.backend_params_->addBetweenStereoFactors_)
+      << "addBetweenStereoFactors is set to true, but this is a mono pipeline!";
+  const auto& calib = camera_->getCalibration();
+  // TODO(marcus): hardcoded baseline!
+  StereoCalibPtr stereo_calib(new gtsam::Cal3_S2Stereo(
+      calib.fx(), calib.fy(), calib.skew(), calib.px(), calib.py(), 0.1));
+  CHECK(backend_params_);
+  auto backend_future = startAsync([&]() {
+    return BackendFactory::createBackend(
+        static_cast<BackendType>(params.backend_type_),
+        // These two should be given by parameters.
+        camera_->getBodyPoseCam(),
+        stereo_calib,
+        *backend_params_,
+        imu_params_,
+        backend_output_params,
+        FLAGS_log_output,
+        params.odom_params_);
+  });
 
   data_provider_module_ = std::make_unique<MonoDataProviderModule>(
-      &frontend_input_queue_, "Mono Data Provider", parallel_run_);
+      frontend_input_queue_.get(), "Mono Data Provider", parallel_run_);
   if (FLAGS_do_coarse_imu_camera_temporal_sync) {
     data_provider_module_->doCoarseImuCameraTemporalSync();
   }
@@ -69,15 +126,15 @@ MonoImuPipeline::MonoImuPipeline(const VioParams& params,
   LOG_IF(FATAL, params.frontend_params_.use_stereo_tracking_)
       << "useStereoTracking is set to true, but this is a mono pipeline!";
   vio_frontend_module_ = std::make_unique<VisionImuFrontendModule>(
-      &frontend_input_queue_,
-      parallel_run_,
+      frontend_input_queue_.get(),
+      spinModulesInOwnThreads(),
       VisionImuFrontendFactory::createFrontend(
           params.frontend_type_,
           params.imu_params_,
           gtsam::imuBias::ConstantBias(),
           params.frontend_params_,
           camera_,
-          FLAGS_visualize ? &display_input_queue_ : nullptr,
+          visualize ? &display_input_queue_ : nullptr,
           FLAGS_log_output,
           params.odom_params_));
   vio_frontend_module_->registerImuTimeShiftUpdateCallback(
@@ -93,7 +150,7 @@ MonoImuPipeline::MonoImuPipeline(const VioParams& params,
         CHECK(converted_output);
         if (converted_output->is_keyframe_) {
           //! Only push to Backend input queue if it is a keyframe!
-          backend_input_queue.push(std::make_unique<BackendInput>(
+          backend_input_queue->push(std::make_unique<BackendInput>(
               converted_output->frame_lkf_.timestamp_,
               converted_output->status_mono_measurements_,
               converted_output->pim_,
@@ -106,36 +163,11 @@ MonoImuPipeline::MonoImuPipeline(const VioParams& params,
         }
       });
 
-  //! Params for what the Backend outputs.
-  // TODO(Toni): put this into Backend params.
-  BackendOutputParams backend_output_params(
-      static_cast<VisualizationType>(FLAGS_viz_type) !=
-          VisualizationType::kNone,
-      FLAGS_min_num_obs_for_mesher_points,
-      FLAGS_visualize && FLAGS_visualize_lmk_type);
-
   //! Create Backend
-  // TODO(marcus): get rid of fake stereocam
-  LOG_IF(FATAL, params.backend_params_->addBetweenStereoFactors_)
-      << "addBetweenStereoFactors is set to true, but this is a mono pipeline!";
-  const auto& calib = camera_->getCalibration();
-  // TODO(marcus): hardcoded baseline!
-  StereoCalibPtr stereo_calib(new gtsam::Cal3_S2Stereo(
-      calib.fx(), calib.fy(), calib.skew(), calib.px(), calib.py(), 0.1));
-  CHECK(backend_params_);
   vio_backend_module_ = std::make_unique<VioBackendModule>(
-      &backend_input_queue_,
-      parallel_run_,
-      BackendFactory::createBackend(
-          static_cast<BackendType>(params.backend_type_),
-          // These two should be given by parameters.
-          camera_->getBodyPoseCam(),
-          stereo_calib,
-          *backend_params_,
-          imu_params_,
-          backend_output_params,
-          FLAGS_log_output,
-          params.odom_params_));
+      backend_input_queue_.get(),
+      spinModulesInOwnThreads(),
+      backend_future.get());
 
   vio_backend_module_->registerOnFailureCallback(
       std::bind(&MonoImuPipeline::signalBackendFailure, this));
@@ -174,17 +206,24 @@ MonoImuPipeline::MonoImuPipeline(const VioParams& params,
   // }
 
   if (FLAGS_use_lcd) {
-    lcd_module_ = std::make_unique<LcdModule>(
-        parallel_run_,
-        LcdFactory::createLcd(LoopClosureDetectorType::BoW,
-                              params.lcd_params_,
-                              camera_->getCamParams(),
-                              camera_->getBodyPoseCam(),
-                              std::nullopt,
-                              std::nullopt,
-                              std::nullopt,
-                              FLAGS_log_output,
-                              std::move(preloaded_vocab)));
+    lcd_module_ = std::make_unique<LcdModule>(spinModulesInOwnThreads(),
+                                              std::move(lcd_future));
+    if (params.lcd_params_.relocalize_after_tracking_loss_) {
+      auto& vio_backend_module = vio_backend_module_;
+      lcd_module_->registerRelocalizationCallback(
+          [&vio_backend_module,
+           rotation_precision =
+               params.lcd_params_.relocalization_rotation_precision_,
+           translation_precision =
+               params.lcd_params_.relocalization_translation_precision_](
+              const FrameId& kf_id, const gtsam::Pose3& W_Pose_B) {
+            CHECK_NOTNULL(vio_backend_module.get())
+                ->setRelocalizationPrior(kf_id,
+                                         W_Pose_B,
+                                         rotation_precision,
+                                         translation_precision);
+          });
+    }
     //! Register input callbacks
     vio_backend_module_->registerOutputCallback(
         std::bind(&LcdModule::fillBackendQueue,
@@ -196,16 +235,18 @@ MonoImuPipeline::MonoImuPipeline(const VioParams& params,
                   std::placeholders::_1));
   }
 
-  if (FLAGS_visualize) {
+  if (visualize) {
     visualizer_module_ = std::make_unique<VisualizerModule>(
         //! Send ouput of visualizer to the display_input_queue_
         &display_input_queue_,
-        parallel_run_,
+        spinModulesInOwnThreads(),
         FLAGS_use_lcd,
         // Use given visualizer if any
         visualizer ? std::move(visualizer)
                    : VisualizerFactory::createVisualizer(
-                         VisualizerType::OpenCV,
+                         // Headless: no widgets for the telemetry display.
+                         VisualizerFactory::getVisualizerTypeForDisplay(
+                             params.display_params_->display_type_),
                          // TODO(Toni): bundle these three params in
                          // VisualizerParams...
                          // NOTE: use kNone or kPointCloud for now because
@@ -218,7 +259,8 @@ MonoImuPipeline::MonoImuPipeline(const VioParams& params,
     vio_backend_module_->registerOutputCallback(
         std::bind(&VisualizerModule::fillBackendQueue,
                   std::ref(*CHECK_NOTNULL(visualizer_module_.get())),
-                  std::placeholders::_1));
+                  std::placeholders::_1),
+        visualizer_module_->getRequiredBackendOutputFields());
 
     auto& visualizer_module = visualizer_module_;
     vio_frontend_module_->registerOutputCallback(
@@ -248,7 +290,8 @@ MonoImuPipeline::MonoImuPipeline(const VioParams& params,
                   : DisplayFactory::makeDisplay(
                         params.display_params_->display_type_,
                         params.display_params_,
-                        std::bind(&MonoImuPipeline::shutdown, this)));
+                        std::bind(&MonoImuPipeline::shutdown, this)),
+        params.display_params_->target_fps_);
   }
 
   launchThreads();
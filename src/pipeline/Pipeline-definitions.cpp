@@ -18,7 +18,10 @@
 #include <glog/logging.h>
 
 #include "kimera-vio/frontend/Camera.h"
-#include "kimera-vio/visualizer/OpenCvDisplay.h"  // for ocv display params...
+#include "kimera-vio/utils/Threading.h"
+#include "kimera-vio/visualizer/OpenCvDisplayParams.h"
+#include "kimera-vio/visualizer/TelemetryDisplayParams.h"
+#include "kimera-vio/visualizer/VideoDisplayParams.h"
 
 DEFINE_bool(use_external_odometry, false, "Use an external odometry input.");
 
@@ -87,6 +90,10 @@ VioParams::VioParams(const std::string& pipeline_params_filepath,
       frontend_type_(FrontendType::kStereoImu),
       backend_type_(BackendType::kStructuralRegularities),
       parallel_run_(true),
+      backend_nr_threads_(0),
+      frontend_cpus_(),
+      backend_cpus_(),
+      execution_profile_params_(),
       // Filepaths, keep defaults unless you changed file names.
       pipeline_params_filepath_(pipeline_params_filepath),
       imu_params_filepath_(imu_params_filepath),
@@ -119,6 +126,17 @@ bool VioParams::parseYAML(const std::string&) {
   yaml_parser.getYamlParam("display_type", &display_type);
   display_type_ = static_cast<DisplayType>(display_type);
   yaml_parser.getYamlParam("parallel_run", &parallel_run_);
+  if (yaml_parser.hasParam("backend_nr_threads")) {
+    yaml_parser.getYamlParam("backend_nr_threads", &backend_nr_threads_);
+    CHECK_GE(backend_nr_threads_, 0);
+  }
+  if (yaml_parser.hasParam("frontend_cpus")) {
+    yaml_parser.getYamlParam("frontend_cpus", &frontend_cpus_);
+  }
+  if (yaml_parser.hasParam("backend_cpus")) {
+    yaml_parser.getYamlParam("backend_cpus", &backend_cpus_);
+  }
+  execution_profile_params_.parseYAML(pipeline_params_filepath_);
 
   // Parse IMU params
   parsePipelineParams(imu_params_filepath_, &imu_params_);
@@ -139,10 +157,16 @@ bool VioParams::parseYAML(const std::string&) {
       backend_params_ = std::make_shared<RegularVioBackendParams>();
       break;
     }
+    case BackendType::kProjection:
+    case BackendType::kSlidingWindow: {
+      backend_params_ = std::make_shared<BackendParams>();
+      break;
+    }
     default: {
       LOG(FATAL) << "Unrecognized Backend type: "
                  << static_cast<int>(backend_type_) << "."
-                 << " 0: normalVio, 1: RegularVio.";
+                 << " 0: normalVio, 1: RegularVio, 2: ProjectionVio,"
+                 << " 3: SlidingWindowVio.";
     }
   }
   CHECK(backend_params_);
@@ -150,6 +174,10 @@ bool VioParams::parseYAML(const std::string&) {
 
   // Parse Frontend params.
   parsePipelineParams(frontend_params_filepath_, &frontend_params_);
+  // The images are downscaled at ingestion, the cameras see smaller images.
+  for (CameraParams& cam : camera_params_) {
+    cam.downscale(frontend_params_.image_downscale_factor_);
+  }
 
   // Parse LcdParams
   parsePipelineParams(lcd_params_filepath_, &lcd_params_);
@@ -165,10 +193,18 @@ bool VioParams::parseYAML(const std::string&) {
       display_params_ = std::make_shared<DisplayParams>();
       break;
     }
+    case DisplayType::kTelemetry: {
+      display_params_ = std::make_shared<TelemetryDisplayParams>();
+      break;
+    }
+    case DisplayType::kVideo: {
+      display_params_ = std::make_shared<VideoDisplayParams>();
+      break;
+    }
     default: {
       LOG(FATAL) << "Unrecognized display type: "
                  << static_cast<int>(display_type_) << "."
-                 << " 0: OpenCV, 1: Pangolin.";
+                 << " 0: OpenCV, 1: Pangolin, 2: Telemetry, 3: Video.";
     }
   }
   CHECK(display_params_);
@@ -199,6 +235,10 @@ void VioParams::print() const {
   LOG(INFO) << "Display Type: " << VIO::to_underlying(display_type_);
   LOG(INFO) << "Running VIO in " << (parallel_run_ ? "parallel" : "sequential")
             << " mode.";
+  LOG(INFO) << "Backend Nr Threads: " << backend_nr_threads_ << '\n'
+            << "Frontend CPUs: " << utils::cpusToString(frontend_cpus_) << '\n'
+            << "Backend CPUs: " << utils::cpusToString(backend_cpus_);
+  execution_profile_params_.print();
 }
 
 //! Helper function to parse camera params.
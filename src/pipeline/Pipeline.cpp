@@ -15,6 +15,13 @@
 
 #include "kimera-vio/pipeline/Pipeline.h"
 
+#include <opencv2/core/utility.hpp>
+
+#include "kimera-vio/utils/AllocationTracker.h"
+#include "kimera-vio/utils/SimdKernels.h"
+#include "kimera-vio/visualizer/DisplayFactory.h"
+#include "kimera-vio/visualizer/Visualizer3DFactory.h"
+
 DEFINE_bool(log_output, false, "Log output to CSV files.");
 DEFINE_bool(extract_planes_from_the_scene,
             false,
@@ -46,6 +53,13 @@ DEFINE_int32(min_num_obs_for_mesher_points,
 DEFINE_bool(use_lcd,
             false,
             "Enable LoopClosureDetector processing in pipeline.");
+DEFINE_bool(parallel_startup,
+            true,
+            "Construct the Backend and the LoopClosureDetector (with its "
+            "vocabulary) on startup threads, while the other modules are "
+            "constructed. The pipeline takes data once the Frontend and "
+            "Backend are ready, the LCD catches up with its queued inputs "
+            "once its vocabulary is loaded.");
 DEFINE_bool(
     do_coarse_imu_camera_temporal_sync,
     false,
@@ -60,22 +74,182 @@ DEFINE_bool(
     "estimating the time delay between the IMU and the camera (currently by "
     "cross-correlation between relative rotation angles).");
 
+DEFINE_bool(deterministic_replay,
+            false,
+            "In parallel mode, replay datasets as fast as the pipeline can "
+            "absorb them using credit-based backpressure, with the same "
+            "results as in sequential mode (the dataset provider must use "
+            "fillLeftFrameQueueWithBackpressure).");
+DEFINE_int32(replay_max_frames_in_flight,
+             4,
+             "Nr of frames a dataset provider can send ahead of the data "
+             "provider module in deterministic replay mode.");
+DEFINE_bool(use_spsc_frontend_input_queue,
+            false,
+            "Use a bounded lock-free single-producer single-consumer queue "
+            "between the data provider module and the Frontend.");
+DEFINE_bool(use_spsc_backend_input_queue,
+            false,
+            "Use a bounded lock-free single-producer single-consumer queue "
+            "between the Frontend and the Backend.");
+DEFINE_int32(spsc_queue_capacity,
+             64,
+             "Capacity of the lock-free queues, rounded up to a power of two.");
+DEFINE_bool(use_module_scheduler,
+            false,
+            "In parallel mode, run the Frontend, Backend, Mesher, LCD and "
+            "Visualizer modules as tasks on a shared pool of workers instead "
+            "of one thread per module.");
+DEFINE_int32(module_scheduler_workers,
+             3,
+             "Nr of workers of the module scheduler. Must be at least 3 if "
+             "any of the Mesher, LCD or Visualizer modules is enabled, since "
+             "the Frontend and Backend always have a worker available.");
+
+DEFINE_bool(use_imu_propagator,
+            false,
+            "Propagate the latest Backend state with each IMU measurement, "
+            "to output the state at IMU rate (see "
+            "registerPropagatedStateCallback).");
+DEFINE_int32(imu_propagator_buffer_length_ms,
+             10000,
+             "Length of the IMU history of the IMU propagator, must be longer "
+             "than the latency of the Backend output.");
+
+DEFINE_string(checkpoint_path,
+              "",
+              "If not empty, the latest Backend state (and IMU bias) is saved "
+              "to this file at each keyframe.");
+DEFINE_bool(resume_from_checkpoint,
+            false,
+            "Initialize the Backend with the state at checkpoint_path "
+            "instead of from ground-truth or the IMU, to recover quickly "
+            "after a restart.");
+DEFINE_double(checkpoint_max_age_s,
+              2.0,
+              "Initialize the Backend normally instead if the checkpoint is "
+              "older than this at the first keyframe: its velocity is stale.");
+DEFINE_string(trace_output_file,
+              "",
+              "If not empty, trace the pipeline modules and write the trace "
+              "to this file at shutdown, in the Chrome trace event format "
+              "(open it with chrome://tracing or ui.perfetto.dev).");
+DEFINE_string(record_pipeline_inputs_path,
+              "",
+              "If not empty, record the inputs of the Backend, Mesher and "
+              "LCD to this file, to replay these modules without the "
+              "Frontend (see ReplayPipelineRecording).");
+DEFINE_string(shared_memory_output,
+              "",
+              "If not empty, name of the shared memory region (e.g. "
+              "/kimera_vio) where to publish the latest nav state, its "
+              "covariance, the optimized trajectory and the mesh for other "
+              "processes (see SharedMemoryReader.h).");
+DEFINE_int32(shared_memory_trajectory_capacity,
+             20000,
+             "Max nr of poses of the trajectory in shared memory, the latest "
+             "ones are kept.");
+DEFINE_int32(shared_memory_mesh_vertices_capacity,
+             50000,
+             "Max nr of mesh vertices in shared memory.");
+DEFINE_int32(shared_memory_mesh_triangles_capacity,
+             100000,
+             "Max nr of mesh triangles in shared memory.");
+
+DEFINE_bool(use_admission_control,
+            false,
+            "Let the optional modules (Mesher, LCD, Visualizer, Display) "
+            "skip inputs to stay within their budgets, and when the Frontend "
+            "or Backend input queues back up.");
+DEFINE_int32(admission_slack_depth,
+             0,
+             "Once loaded, the optional modules take all their inputs again "
+             "when the Frontend and Backend input queues are down to this "
+             "depth.");
+DEFINE_int32(admission_pressure_depth,
+             2,
+             "Depth of the Frontend or Backend input queue from which the "
+             "optional modules decimate their inputs.");
+DEFINE_int32(admission_critical_depth,
+             5,
+             "Depth of the Frontend or Backend input queue from which the "
+             "optional modules skip all their inputs.");
+DEFINE_int32(admission_decimation,
+             2,
+             "Under pressure, the optional modules process one input out of "
+             "this many.");
+DEFINE_double(mesher_budget_ms,
+              0.0,
+              "Mean time per input the Mesher may use with admission "
+              "control (0: no budget).");
+DEFINE_double(lcd_budget_ms,
+              0.0,
+              "Mean time per keyframe the LCD may use with admission control, "
+              "beyond which it skips loop detections (0: no budget).");
+DEFINE_double(visualizer_budget_ms,
+              0.0,
+              "Mean time per input the Visualizer may use with admission "
+              "control (0: no budget).");
+DEFINE_double(display_budget_ms,
+              0.0,
+              "Mean time per input the Display may use with admission "
+              "control (0: no budget).");
+
+DECLARE_int32(memory_report_period_s);
+DECLARE_int32(metrics_port);
+
 namespace VIO {
 
-Pipeline::Pipeline(const VioParams& params)
+namespace {
+//! Creates a mutex-based queue, or a lock-free one if the edge has a single
+//! producer and a single consumer thread.
+template <typename T>
+typename ThreadsafeQueueBase<T>::UniquePtr makeInputQueue(
+    const std::string& queue_id,
+    const bool& use_spsc_queue) {
+  if (use_spsc_queue) {
+    CHECK_GT(FLAGS_spsc_queue_capacity, 0);
+    return std::make_unique<ThreadsafeSpscQueue<T>>(
+        queue_id, static_cast<size_t>(FLAGS_spsc_queue_capacity));
+  }
+  return std::make_unique<ThreadsafeQueue<T>>(queue_id);
+}
+}  // namespace
+
+Pipeline::Pipeline(const VioParams& params, PipelineContext::Ptr context)
     : backend_params_(params.backend_params_),
       frontend_params_(params.frontend_params_),
       imu_params_(params.imu_params_),
       parallel_run_(params.parallel_run_),
+      frontend_cpus_(params.frontend_cpus_),
+      backend_cpus_(params.backend_cpus_),
+      backend_nr_threads_(params.backend_nr_threads_),
+      execution_profile_params_(params.execution_profile_params_),
+      gtsam_threading_control_(nullptr),
+      shared_memory_output_(nullptr),
+      pose_history_(std::make_shared<PoseHistory>()),
       data_provider_module_(nullptr),
       vio_frontend_module_(nullptr),
-      frontend_input_queue_("frontend_input_queue"),
+      frontend_input_queue_(makeInputQueue<FrontendInputPacketBase::UniquePtr>(
+          "frontend_input_queue", FLAGS_use_spsc_frontend_input_queue)),
       vio_backend_module_(nullptr),
-      backend_input_queue_("backend_input_queue"),
+      backend_input_queue_(makeInputQueue<BackendInput::UniquePtr>(
+          "backend_input_queue", FLAGS_use_spsc_backend_input_queue)),
       mesher_module_(nullptr),
       lcd_module_(nullptr),
       visualizer_module_(nullptr),
-      display_input_queue_("display_input_queue"),
+      replay_scheduler_(nullptr),
+      admission_controller_(nullptr),
+      context_(std::move(context)),
+      module_scheduler_(nullptr),
+      owns_module_scheduler_(false),
+      imu_propagator_(nullptr),
+      memory_reporter_(nullptr),
+      metrics_exporter_(nullptr),
+      execution_profile_mutex_(),
+      execution_profile_(execution_profile_params_.initial_profile_),
+      execution_profile_monitor_(nullptr),
+      display_input_queue_("display_input_queue", &DisplayModule::mergeInputs),
       display_module_(nullptr),
       shutdown_pipeline_cb_(nullptr),
       frontend_thread_(nullptr),
@@ -83,9 +257,63 @@ Pipeline::Pipeline(const VioParams& params)
       mesher_thread_(nullptr),
       lcd_thread_(nullptr),
       visualizer_thread_(nullptr) {
+  if (!FLAGS_trace_output_file.empty()) utils::Tracer::enable();
   if (FLAGS_deterministic_random_number_generator) {
     setDeterministicPipeline();
   }
+  if (FLAGS_deterministic_replay) {
+    LOG_IF(WARNING, !parallel_run_)
+        << "Deterministic replay only applies to parallel mode.";
+    if (parallel_run_) {
+      CHECK_GT(FLAGS_replay_max_frames_in_flight, 0);
+      replay_scheduler_ = std::make_unique<ReplayScheduler>(
+          static_cast<size_t>(FLAGS_replay_max_frames_in_flight));
+    }
+  }
+  if (FLAGS_use_admission_control) {
+    LOG_IF(WARNING, replay_scheduler_)
+        << "Admission control skips inputs: the replay is not deterministic.";
+    CHECK_GE(FLAGS_admission_slack_depth, 0);
+    CHECK_GT(FLAGS_admission_decimation, 0);
+    admission_controller_ = std::make_shared<AdmissionController>(
+        static_cast<size_t>(FLAGS_admission_slack_depth),
+        static_cast<size_t>(FLAGS_admission_pressure_depth),
+        static_cast<size_t>(FLAGS_admission_critical_depth));
+  }
+  if (context_ && context_->getModuleScheduler()) {
+    LOG_IF(WARNING, !parallel_run_)
+        << "The module scheduler only applies to parallel mode.";
+    if (parallel_run_) module_scheduler_ = context_->getModuleScheduler();
+  } else if (FLAGS_use_module_scheduler) {
+    LOG_IF(WARNING, !parallel_run_)
+        << "The module scheduler only applies to parallel mode.";
+    if (parallel_run_) {
+      CHECK_GT(FLAGS_module_scheduler_workers, 0);
+      module_scheduler_ = std::make_shared<ModuleScheduler>(
+          static_cast<size_t>(FLAGS_module_scheduler_workers));
+      owns_module_scheduler_ = true;
+    }
+  }
+  // Before any GTSAM call, so that TBB's scheduler starts with these limits.
+  gtsam_threading_control_ = std::make_unique<utils::GtsamThreadingControl>(
+      backend_nr_threads_, backend_cpus_);
+  if (FLAGS_use_imu_propagator) {
+    CHECK_GT(FLAGS_imu_propagator_buffer_length_ms, 0);
+    imu_propagator_ = std::make_unique<ImuPropagator>(
+        imu_params_,
+        parallel_run_,
+        UtilsNumerical::SecToNsec(FLAGS_imu_propagator_buffer_length_ms /
+                                  1000.0));
+  }
+  if (utils::isMemoryAccountingEnabled()) {
+    CHECK_GE(FLAGS_memory_report_period_s, 0);
+    memory_reporter_ = std::make_unique<utils::MemoryReporter>(
+        std::chrono::seconds(FLAGS_memory_report_period_s));
+  }
+  if (FLAGS_metrics_port >= 0) {
+    metrics_exporter_ =
+        std::make_unique<utils::MetricsExporter>(FLAGS_metrics_port);
+  }
 }
 
 Pipeline::~Pipeline() {
@@ -96,6 +324,42 @@ Pipeline::~Pipeline() {
   }
 }
 
+void Pipeline::fillLeftFrameQueueWithBackpressure(
+    Frame::UniquePtr left_frame) {
+  CHECK(data_provider_module_);
+  CHECK(left_frame);
+  if (!replay_scheduler_) {
+    data_provider_module_->fillLeftFrameQueueBlockingIfFull(
+        std::move(left_frame));
+    return;
+  }
+  if (replay_scheduler_->acquireFrameCredit(left_frame->timestamp_)) {
+    data_provider_module_->fillLeftFrameQueue(std::move(left_frame));
+  }
+}
+
+bool Pipeline::shouldVisualize(const VioParams& params,
+                               const bool& has_visualizer,
+                               const bool& has_displayer) {
+  if (!FLAGS_visualize) return false;
+  CHECK(params.display_params_);
+  const DisplayType& display_type = params.display_params_->display_type_;
+  if (!has_displayer && !DisplayFactory::isDisplayRegistered(display_type)) {
+    LOG(WARNING) << "Display type " << VIO::to_underlying(display_type)
+                 << " was not built, visualization is disabled.";
+    return false;
+  }
+  if (!has_visualizer &&
+      !VisualizerFactory::isVisualizerRegistered(
+          VisualizerFactory::getVisualizerTypeForDisplay(display_type))) {
+    LOG(WARNING) << "Visualizer for display type "
+                 << VIO::to_underlying(display_type)
+                 << " was not built, visualization is disabled.";
+    return false;
+  }
+  return true;
+}
+
 bool Pipeline::spin() {
   // Feed data to the pipeline
   CHECK(data_provider_module_);
@@ -120,13 +384,13 @@ std::string Pipeline::printStatus() const {
      << "Backend initialized? " << vio_backend_module_->isInitialized() << '\n'
      << "Data provider is working? " << data_provider_module_->isWorking()
      << '\n'
-     << "Frontend input queue shutdown? " << frontend_input_queue_.isShutdown()
+     << "Frontend input queue shutdown? " << frontend_input_queue_->isShutdown()
      << '\n'
-     << "Frontend input queue empty? " << frontend_input_queue_.empty() << '\n'
+     << "Frontend input queue empty? " << frontend_input_queue_->empty() << '\n'
      << "Frontend is working? " << vio_frontend_module_->isWorking() << '\n'
-     << "Backend Input queue shutdown? " << backend_input_queue_.isShutdown()
+     << "Backend Input queue shutdown? " << backend_input_queue_->isShutdown()
      << '\n'
-     << "Backend Input queue empty? " << backend_input_queue_.empty() << '\n'
+     << "Backend Input queue empty? " << backend_input_queue_->empty() << '\n'
      << "Backend is working? " << vio_backend_module_->isWorking() << '\n'
      << (mesher_module_
              ? ("Mesher is working? " +
@@ -178,6 +442,7 @@ bool Pipeline::waitForShutdown(const std::function<bool()>& data_done_cb,
 
     // Print all statistics
     LOG_IF(INFO, print_stats) << utils::Statistics::Print();
+    LOG_IF(INFO, print_stats) << PipelineLatency::print();
 
     // Time to sleep between queries to the queues [in milliseconds].
     std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time_ms));
@@ -212,6 +477,8 @@ void Pipeline::spinSequential() {
   if (visualizer_module_) visualizer_module_->spin();
 
   if (display_module_) display_module_->spin();
+
+  if (imu_propagator_) imu_propagator_->spinOnce();
 }
 
 bool Pipeline::hasFinished() const {
@@ -220,9 +487,9 @@ bool Pipeline::hasFinished() const {
   CHECK(vio_backend_module_);
 
   const bool fqueue_done =
-      frontend_input_queue_.isShutdown() || frontend_input_queue_.empty();
+      frontend_input_queue_->isShutdown() || frontend_input_queue_->empty();
   const bool bqueue_done =
-      backend_input_queue_.isShutdown() || backend_input_queue_.empty();
+      backend_input_queue_->isShutdown() || backend_input_queue_->empty();
   const bool dqueue_done =
       display_input_queue_.isShutdown() || display_input_queue_.empty();
   const bool mesher_done =
@@ -256,10 +523,11 @@ bool Pipeline::hasFinished() const {
       (!isInitialized() ||  // Pipeline is not initialized and
                             // data is not yet consumed.
        !(!data_provider_module_->isWorking() &&
-         (frontend_input_queue_.isShutdown() ||
-          frontend_input_queue_.empty()) &&
+         (frontend_input_queue_->isShutdown() ||
+          frontend_input_queue_->empty()) &&
          !vio_frontend_module_->isWorking() &&
-         (backend_input_queue_.isShutdown() || backend_input_queue_.empty()) &&
+         (backend_input_queue_->isShutdown() ||
+          backend_input_queue_->empty()) &&
          !vio_backend_module_->isWorking() &&
          (mesher_module_ ? !mesher_module_->isWorking() : true) &&
          (lcd_module_ ? !lcd_module_->isWorking() : true) &&
@@ -274,6 +542,12 @@ void Pipeline::shutdown() {
   LOG(INFO) << "Shutting down VIO pipeline.";
   shutdown_ = true;
 
+  // Unblock data providers and the data provider module if replaying.
+  if (replay_scheduler_) {
+    replay_scheduler_->shutdown();
+    LOG(INFO) << replay_scheduler_->printStats();
+  }
+
   // First: call registered shutdown callbacks, these are typically to signal
   // data providers that they should now die.
   if (shutdown_pipeline_cb_) {
@@ -283,6 +557,9 @@ void Pipeline::shutdown() {
     shutdown_pipeline_cb_();
   }
 
+  // Stop switching the execution profile of the modules shutting down.
+  execution_profile_monitor_.reset();
+
   // Second: stop data provider
   CHECK(data_provider_module_);
   data_provider_module_->shutdown();
@@ -294,6 +571,33 @@ void Pipeline::shutdown() {
   }
   LOG(INFO) << "VIO Pipeline's threads shutdown successfully.\n"
             << "VIO Pipeline successful shutdown.";
+  LOG(INFO) << PipelineLatency::print();
+  if (admission_controller_) {
+    LOG(INFO) << admission_controller_->print();
+  }
+  if (utils::AllocationTracker::isEnabled()) {
+    LOG(INFO) << utils::AllocationTracker::print();
+  }
+  // Logs the final memory report.
+  memory_reporter_.reset();
+  metrics_exporter_.reset();
+
+  if (!FLAGS_trace_output_file.empty()) {
+    utils::Tracer::writeChromeTrace(FLAGS_trace_output_file);
+  }
+
+  if (recorder_) {
+    recorder_->flush();
+  }
+
+  if (checkpoint_writer_) {
+    checkpoint_writer_->flush();
+  }
+
+  if (trajectory_evaluator_) {
+    trajectory_evaluator_->reportStatistics();
+    LOG(INFO) << trajectory_evaluator_->print();
+  }
 
   if (FLAGS_log_output) {
     PipelineLogger logger;
@@ -302,20 +606,42 @@ void Pipeline::shutdown() {
   }
 }
 
+void Pipeline::setTrajectoryEvaluator(
+    TrajectoryEvaluator::UniquePtr evaluator) {
+  CHECK(evaluator);
+  CHECK(!trajectory_evaluator_) << "The trajectory evaluator is already set.";
+  trajectory_evaluator_ = std::move(evaluator);
+  TrajectoryEvaluator* trajectory_evaluator = trajectory_evaluator_.get();
+  registerBackendOutputCallback(
+      [trajectory_evaluator](const BackendOutput::Ptr& output) {
+        CHECK(output);
+        trajectory_evaluator->addPose(output->timestamp_,
+                                      output->W_State_Blkf_.pose_);
+      });
+}
+
 void Pipeline::resume() {
   LOG(INFO) << "Restarting Frontend workers and queues...";
-  frontend_input_queue_.resume();
+  frontend_input_queue_->resume();
 
   LOG(INFO) << "Restarting Backend workers and queues...";
-  backend_input_queue_.resume();
+  backend_input_queue_->resume();
 }
 
 void Pipeline::spinOnce(FrontendInputPacketBase::UniquePtr input) {
   CHECK(input);
   if (!shutdown_) {
     // Push to Frontend input queue.
+    if (replay_scheduler_) {
+      // Return the credits of this and dropped frames, and wait for the
+      // previous frame to be done before the Frontend sees this one.
+      replay_scheduler_->releaseFrameCredits(input->timestamp_);
+      if (!replay_scheduler_->waitForIdlePipeline()) return;
+    }
     VLOG(2) << "Push input payload to Frontend.";
-    frontend_input_queue_.pushBlockingIfFull(std::move(input), 5u);
+    PipelineLatency::recordPipelineIngress(input->timestamp_);
+    frontend_input_queue_->pushBlockingIfFull(std::move(input), 5u);
+    if (module_scheduler_) module_scheduler_->notify();
 
     if (!parallel_run_) {
       // Run the pipeline sequentially.
@@ -326,8 +652,284 @@ void Pipeline::spinOnce(FrontendInputPacketBase::UniquePtr input) {
   }
 }
 
+void Pipeline::registerReplaySchedulerCallbacks() {
+  CHECK(replay_scheduler_);
+  CHECK(vio_frontend_module_);
+  CHECK(vio_backend_module_);
+  ReplayScheduler* replay_scheduler = replay_scheduler_.get();
+  vio_frontend_module_->registerOutputCallback(
+      [replay_scheduler](const FrontendOutputPacketBase::Ptr& output) {
+        CHECK(output);
+        // Keyframes are done once the Backend processed them.
+        if (!output->is_keyframe_) replay_scheduler->signalFrameDone();
+      });
+  vio_frontend_module_->registerOnFailureCallback(
+      [replay_scheduler]() { replay_scheduler->signalFrameDone(); });
+  vio_backend_module_->registerOutputCallback(
+      [replay_scheduler](const BackendOutput::Ptr&) {
+        replay_scheduler->signalFrameDone();
+      });
+  vio_backend_module_->registerOnFailureCallback(
+      [replay_scheduler]() { replay_scheduler->signalFrameDone(); });
+}
+
+void Pipeline::registerImuPropagatorCallbacks() {
+  CHECK(imu_propagator_);
+  CHECK(vio_backend_module_);
+  CHECK(data_provider_module_);
+  ImuPropagator* imu_propagator = imu_propagator_.get();
+  MonoDataProviderModule* data_provider_module = data_provider_module_.get();
+  // Runs in the Backend thread: only copies the state, the propagator
+  // integrates the IMU in its own thread.
+  vio_backend_module_->registerOutputCallback(
+      [imu_propagator, data_provider_module](const BackendOutput::Ptr& output) {
+        CHECK(output);
+        imu_propagator->setImuTimeOffset(
+            data_provider_module->getImuTimeOffset());
+        imu_propagator->resetState(output->W_State_Blkf_);
+      });
+}
+
+void Pipeline::setupCheckpointing() {
+  CHECK(vio_backend_module_);
+  CHECK(!FLAGS_checkpoint_path.empty())
+      << "Checkpointing requires a checkpoint_path.";
+  if (FLAGS_resume_from_checkpoint) {
+    PipelineCheckpoint checkpoint;
+    if (PipelineCheckpoint::load(FLAGS_checkpoint_path, &checkpoint)) {
+      LOG(INFO) << "Resuming pipeline from checkpoint: "
+                << FLAGS_checkpoint_path;
+      vio_backend_module_->setResumeState(
+          checkpoint.state_,
+          UtilsNumerical::SecToNsec(FLAGS_checkpoint_max_age_s));
+    } else {
+      LOG(WARNING) << "Could not resume from checkpoint "
+                   << FLAGS_checkpoint_path << ", initializing normally.";
+    }
+  }
+  // Runs in the Backend thread, only hands the state over to the writer.
+  checkpoint_writer_ =
+      std::make_unique<PipelineCheckpointWriter>(FLAGS_checkpoint_path);
+  PipelineCheckpointWriter* checkpoint_writer = checkpoint_writer_.get();
+  vio_backend_module_->registerOutputCallback(
+      [checkpoint_writer](const BackendOutput::Ptr& output) {
+        CHECK(output);
+        checkpoint_writer->write(output->W_State_Blkf_);
+      });
+}
+
+void Pipeline::setupRecording() {
+  CHECK(vio_backend_module_);
+  CHECK(!FLAGS_record_pipeline_inputs_path.empty());
+  recorder_ =
+      std::make_unique<PipelineRecorder>(FLAGS_record_pipeline_inputs_path);
+  CHECK(backend_params_);
+  recorder_->recordInitialState(backend_params_->initial_ground_truth_state_);
+  // The callbacks run in the modules' threads, the recorder is thread-safe.
+  PipelineRecorder* recorder = recorder_.get();
+  vio_backend_module_->registerInputCallback(
+      [recorder](const BackendInput& input) {
+        recorder->recordBackendInput(input);
+      });
+  if (mesher_module_) {
+    mesher_module_->registerInputCallback(
+        [recorder](const MesherInput& input) {
+          recorder->recordMesherInput(input);
+        });
+  }
+  if (lcd_module_) {
+    lcd_module_->registerInputCallback([recorder](const LcdInput& input) {
+      recorder->recordLcdInput(input);
+    });
+  }
+}
+
+void Pipeline::setupAdmissionControl() {
+  CHECK(admission_controller_);
+  CHECK(frontend_input_queue_);
+  CHECK(backend_input_queue_);
+  auto* frontend_input_queue = frontend_input_queue_.get();
+  admission_controller_->addCriticalPathQueue(
+      frontend_input_queue->queue_id_,
+      [frontend_input_queue]() { return frontend_input_queue->size(); });
+  auto* backend_input_queue = backend_input_queue_.get();
+  admission_controller_->addCriticalPathQueue(
+      backend_input_queue->queue_id_,
+      [backend_input_queue]() { return backend_input_queue->size(); });
+
+  const auto budget = [](const double& budget_ms) {
+    OptionalModuleBudget module_budget;
+    module_budget.budget_ms = budget_ms;
+    module_budget.decimation_under_pressure =
+        static_cast<size_t>(FLAGS_admission_decimation);
+    return module_budget;
+  };
+  if (mesher_module_) {
+    mesher_module_->setAdmissionController(admission_controller_,
+                                           budget(FLAGS_mesher_budget_ms));
+  }
+  if (lcd_module_) {
+    lcd_module_->setAdmissionController(admission_controller_,
+                                        budget(FLAGS_lcd_budget_ms));
+  }
+  if (visualizer_module_) {
+    visualizer_module_->setAdmissionController(
+        admission_controller_, budget(FLAGS_visualizer_budget_ms));
+  }
+  if (display_module_) {
+    display_module_->setAdmissionController(admission_controller_,
+                                            budget(FLAGS_display_budget_ms));
+  }
+}
+
+void Pipeline::setExecutionProfile(const ExecutionProfileType& profile) {
+  if (execution_profile_monitor_) execution_profile_monitor_->reset(profile);
+  applyExecutionProfile(profile);
+}
+
+void Pipeline::setupExecutionProfiles() {
+  applyExecutionProfile(execution_profile_params_.initial_profile_);
+  if (execution_profile_params_.auto_switch_) {
+    execution_profile_monitor_ = std::make_unique<ExecutionProfileMonitor>(
+        execution_profile_params_.monitor_params_,
+        execution_profile_params_.initial_profile_,
+        [this](const ExecutionProfileType& profile) {
+          applyExecutionProfile(profile);
+        });
+  }
+}
+
+void Pipeline::applyExecutionProfile(const ExecutionProfileType& type) {
+  const ExecutionProfile& profile = execution_profile_params_.getProfile(type);
+  std::lock_guard<std::mutex> lock(execution_profile_mutex_);
+  CHECK(vio_frontend_module_);
+  vio_frontend_module_->setFeatureBudgetScale(profile.feature_budget_scale);
+  // The skipped frames would never be done for the replay scheduler.
+  LOG_IF(WARNING, replay_scheduler_ && profile.frontend_frame_decimation > 1u)
+      << "Deterministic replay: ignoring the frame decimation of the "
+      << asString(type) << " execution profile.";
+  vio_frontend_module_->setFrameDecimation(
+      replay_scheduler_ ? 1u : profile.frontend_frame_decimation);
+  if (mesher_module_) {
+    mesher_module_->setInputDecimation(profile.mesher_decimation);
+  }
+  if (lcd_module_) lcd_module_->setInputDecimation(profile.lcd_decimation);
+  CHECK(gtsam_threading_control_);
+  gtsam_threading_control_->setMaxNrThreads(profile.backend_nr_threads > 0
+                                                ? profile.backend_nr_threads
+                                                : backend_nr_threads_);
+  execution_profile_ = type;
+  utils::StatsCollector execution_profile_stats("Execution profile");
+  execution_profile_stats.AddSample(static_cast<double>(to_underlying(type)));
+  LOG(INFO) << "Execution profile: " << asString(type) << '.';
+}
+
+void Pipeline::setupSharedMemoryOutput() {
+  CHECK(vio_backend_module_);
+  CHECK_GT(FLAGS_shared_memory_trajectory_capacity, 0);
+  CHECK_GE(FLAGS_shared_memory_mesh_vertices_capacity, 0);
+  CHECK_GE(FLAGS_shared_memory_mesh_triangles_capacity, 0);
+  shared_memory_output_ = std::make_unique<SharedMemoryOutput>(
+      FLAGS_shared_memory_output,
+      static_cast<size_t>(FLAGS_shared_memory_trajectory_capacity),
+      static_cast<size_t>(FLAGS_shared_memory_mesh_vertices_capacity),
+      static_cast<size_t>(FLAGS_shared_memory_mesh_triangles_capacity));
+  // The callbacks run in the modules' threads, each one writes its sections.
+  SharedMemoryOutput* shared_memory_output = shared_memory_output_.get();
+  BackendOutputFields required_fields;
+  required_fields.state_covariance_ = true;
+  vio_backend_module_->registerOutputCallback(
+      [shared_memory_output](const BackendOutput::Ptr& output) {
+        shared_memory_output->publishBackendOutput(*CHECK_NOTNULL(output));
+      },
+      required_fields);
+  if (lcd_module_) {
+    lcd_module_->registerOutputCallback(
+        [shared_memory_output](const LcdOutput::Ptr& output) {
+          shared_memory_output->publishLcdOutput(*CHECK_NOTNULL(output));
+        });
+  }
+  if (mesher_module_) {
+    mesher_module_->registerOutputCallback(
+        [shared_memory_output](const MesherOutput::Ptr& output) {
+          shared_memory_output->publishMesherOutput(*CHECK_NOTNULL(output));
+        });
+  }
+}
+
+void Pipeline::registerPoseHistoryCallbacks() {
+  CHECK(vio_backend_module_);
+  CHECK(pose_history_);
+  // The callbacks run in the modules' threads, the history is thread-safe.
+  PoseHistory* pose_history = pose_history_.get();
+  vio_backend_module_->registerOutputCallback(
+      [pose_history](const BackendOutput::Ptr& output) {
+        CHECK(output);
+        pose_history->addPose(output->W_State_Blkf_.timestamp_,
+                              output->W_State_Blkf_.pose_);
+      });
+  if (lcd_module_) {
+    lcd_module_->registerOutputCallback(
+        [pose_history](const LcdOutput::Ptr& output) {
+          CHECK(output);
+          pose_history->setCorrection(output->Map_Pose_Odom_);
+        });
+  }
+}
+
 void Pipeline::launchThreads() {
-  if (parallel_run_) {
+  LOG_IF(WARNING, FLAGS_resume_from_checkpoint && FLAGS_checkpoint_path.empty())
+      << "Requested to resume from a checkpoint, but no checkpoint_path.";
+  if (!FLAGS_checkpoint_path.empty()) {
+    setupCheckpointing();
+  }
+  if (!FLAGS_record_pipeline_inputs_path.empty()) {
+    setupRecording();
+  }
+  if (!FLAGS_shared_memory_output.empty()) {
+    setupSharedMemoryOutput();
+  }
+  registerPoseHistoryCallbacks();
+  if (replay_scheduler_) {
+    registerReplaySchedulerCallbacks();
+  }
+  if (admission_controller_) {
+    setupAdmissionControl();
+  }
+  setupExecutionProfiles();
+  if (imu_propagator_) {
+    registerImuPropagatorCallbacks();
+    imu_propagator_->start();
+  }
+  if (module_scheduler_) {
+    // Frontend and Backend are never blocked by the other modules.
+    scheduleModule(CHECK_NOTNULL(vio_frontend_module_.get()),
+                   ModulePriority::kCritical,
+                   "Frontend");
+    scheduleModule(CHECK_NOTNULL(vio_backend_module_.get()),
+                   ModulePriority::kCritical,
+                   "Backend");
+    if (mesher_module_) {
+      scheduleModule(
+          mesher_module_.get(), ModulePriority::kBackground, "Mesher");
+    }
+    if (lcd_module_) {
+      scheduleModule(lcd_module_.get(), ModulePriority::kBackground, "LCD");
+    }
+    if (visualizer_module_) {
+      scheduleModule(
+          visualizer_module_.get(), ModulePriority::kBackground, "Visualizer");
+    }
+    // A shared scheduler is already running: the new modules are picked up
+    // by its workers.
+    if (owns_module_scheduler_) {
+      module_scheduler_->start();
+    } else {
+      module_scheduler_->notify();
+    }
+    LOG(INFO) << "Pipeline Modules launched on "
+              << module_scheduler_->getNrWorkers() << " workers.";
+  } else if (parallel_run_) {
     frontend_thread_ = std::make_unique<std::thread>(
         &VisionImuFrontendModule::spin,
         CHECK_NOTNULL(vio_frontend_module_.get()));
@@ -349,22 +951,81 @@ void Pipeline::launchThreads() {
       visualizer_thread_ = std::make_unique<std::thread>(
           &VisualizerModule::spin, CHECK_NOTNULL(visualizer_module_.get()));
     }
+    setThreadsAffinity();
     LOG(INFO) << "Pipeline Modules launched (parallel_run set to "
               << parallel_run_ << ").";
   } else {
     LOG(INFO) << "Pipeline Modules running in sequential mode"
               << " (parallel_run set to " << parallel_run_ << ").";
   }
+  logThreadingConfig();
+}
+
+void Pipeline::scheduleModule(PipelineModuleBase* module,
+                              const ModulePriority& priority,
+                              const std::string& name) {
+  CHECK(module_scheduler_);
+  module_scheduler_->addModule(module, priority, name);
+  scheduled_modules_.push_back(module);
+}
+
+void Pipeline::removeScheduledModules() {
+  CHECK(module_scheduler_);
+  for (PipelineModuleBase* module : scheduled_modules_) {
+    module_scheduler_->removeModule(module);
+  }
+  scheduled_modules_.clear();
+}
+
+void Pipeline::setThreadsAffinity() {
+  CHECK(frontend_thread_);
+  CHECK(backend_thread_);
+  utils::setThreadAffinity(frontend_thread_.get(), frontend_cpus_);
+  utils::setThreadAffinity(backend_thread_.get(), backend_cpus_);
+}
+
+void Pipeline::logThreadingConfig() const {
+  std::string mode = "sequential";
+  if (module_scheduler_) {
+    mode = "module scheduler (" +
+           std::to_string(module_scheduler_->getNrWorkers()) + " workers)";
+  } else if (parallel_run_) {
+    mode = "one thread per module";
+  }
+  const bool pinned = spinModulesInOwnThreads();
+  LOG_IF(WARNING,
+         !pinned && (!frontend_cpus_.empty() || !backend_cpus_.empty()))
+      << "Frontend and Backend CPUs only apply when each module has its own "
+         "thread: ignoring them.";
+  LOG(INFO) << "Threading config:\n"
+            << " - Hardware concurrency: "
+            << std::thread::hardware_concurrency() << '\n'
+            << " - Modules: " << mode << '\n'
+            << " - Frontend CPUs: "
+            << (pinned ? utils::cpusToString(frontend_cpus_) : "any") << '\n'
+            << " - Backend CPUs: "
+            << (pinned ? utils::cpusToString(backend_cpus_) : "any") << '\n'
+            << " - GTSAM TBB: "
+            << (utils::GtsamThreadingControl::isTbbEnabled()
+                    ? "enabled, max " +
+                          std::to_string(utils::GtsamThreadingControl::
+                                             getMaxNrThreads()) +
+                          " threads on CPUs " +
+                          utils::cpusToString(backend_cpus_)
+                    : std::string("disabled (single threaded)"))
+            << '\n'
+            << " - OpenCV threads: " << cv::getNumThreads();
+  LOG(INFO) << utils::SimdKernels::get().print();
 }
 
 void Pipeline::stopThreads() {
   VLOG(1) << "Stopping workers and queues...";
 
-  backend_input_queue_.shutdown();
+  backend_input_queue_->shutdown();
   CHECK(vio_backend_module_);
   vio_backend_module_->shutdown();
 
-  frontend_input_queue_.shutdown();
+  frontend_input_queue_->shutdown();
   CHECK(vio_frontend_module_);
   vio_frontend_module_->shutdown();
 
@@ -375,6 +1036,15 @@ void Pipeline::stopThreads() {
     display_input_queue_.shutdown();
     display_module_->shutdown();
   }
+  if (module_scheduler_) {
+    if (owns_module_scheduler_) {
+      module_scheduler_->shutdown();
+    } else {
+      // Keep the shared scheduler running for the other pipelines.
+      removeScheduledModules();
+    }
+  }
+  if (imu_propagator_) imu_propagator_->shutdown();
 
   VLOG(1) << "Sent stop flag to all module and queues...";
 }
@@ -385,6 +1055,15 @@ void Pipeline::joinThreads() {
       << "should not happen.";
   VLOG(1) << "Joining threads...";
 
+  if (module_scheduler_) {
+    if (owns_module_scheduler_) {
+      module_scheduler_->join();
+      LOG(INFO) << module_scheduler_->printStats();
+      VLOG(1) << "All module scheduler workers joined.";
+    }
+    return;
+  }
+
   joinThread("Backend", backend_thread_.get());
   joinThread("Frontend", frontend_thread_.get());
   joinThread("mesher", mesher_thread_.get());
@@ -0,0 +1,216 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   PipelineCheckpoint.cpp
+ * @brief  On-disk checkpoint of the latest Backend state, to resume the
+ * pipeline without initializing it again.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/pipeline/PipelineCheckpoint.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+namespace {
+
+// "KVCK", and version of the layout below.
+constexpr uint32_t kCheckpointMagic = 0x4b56434b;
+constexpr uint32_t kCheckpointVersion = 1u;
+
+template <typename T>
+void write(std::ostream& stream, const T& field) {
+  stream.write(reinterpret_cast<const char*>(&field), sizeof(T));
+}
+
+template <typename T>
+void read(std::istream& stream, T* field) {
+  stream.read(reinterpret_cast<char*>(field), sizeof(T));
+}
+
+void writeVector3(std::ostream& stream, const gtsam::Vector3& vector) {
+  for (int i = 0; i < 3; ++i) write(stream, vector(i));
+}
+
+gtsam::Vector3 readVector3(std::istream& stream) {
+  gtsam::Vector3 vector;
+  for (int i = 0; i < 3; ++i) read(stream, &vector(i));
+  return vector;
+}
+
+//! Writes the bytes to the file and syncs them to disk.
+bool writeAndSync(const std::string& filepath, const std::string& bytes) {
+  const int fd = ::open(filepath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    LOG(ERROR) << "Could not open checkpoint file: " << filepath << ": "
+               << std::strerror(errno);
+    return false;
+  }
+  size_t written = 0u;
+  while (written < bytes.size()) {
+    const ssize_t n =
+        ::write(fd, bytes.data() + written, bytes.size() - written);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) break;
+    written += static_cast<size_t>(n);
+  }
+  const bool success = written == bytes.size() && ::fsync(fd) == 0;
+  LOG_IF(ERROR, !success) << "Could not write checkpoint file: " << filepath
+                          << ": " << std::strerror(errno);
+  return ::close(fd) == 0 && success;
+}
+
+//! Syncs the directory of the file, for its rename to survive a power loss.
+bool syncDirectory(const std::string& filepath) {
+  std::string directory =
+      std::filesystem::path(filepath).parent_path().string();
+  if (directory.empty()) directory = ".";
+  const int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0) {
+    LOG(ERROR) << "Could not open checkpoint directory: " << directory;
+    return false;
+  }
+  const bool success = ::fsync(fd) == 0;
+  LOG_IF(ERROR, !success) << "Could not sync checkpoint directory: "
+                          << directory << ": " << std::strerror(errno);
+  return ::close(fd) == 0 && success;
+}
+
+}  // namespace
+
+bool PipelineCheckpoint::save(const std::string& filepath) const {
+  const std::string tmp_filepath = filepath + ".tmp";
+  {
+    std::ostringstream stream;
+    write(stream, kCheckpointMagic);
+    write(stream, kCheckpointVersion);
+    write(stream, state_.timestamp_);
+    const gtsam::Quaternion quaternion = state_.pose_.rotation().toQuaternion();
+    write(stream, quaternion.w());
+    write(stream, quaternion.x());
+    write(stream, quaternion.y());
+    write(stream, quaternion.z());
+    writeVector3(stream, state_.pose_.translation());
+    writeVector3(stream, state_.velocity_);
+    writeVector3(stream, state_.imu_bias_.accelerometer());
+    writeVector3(stream, state_.imu_bias_.gyroscope());
+    if (!writeAndSync(tmp_filepath, stream.str())) return false;
+  }
+  std::error_code error;
+  std::filesystem::rename(tmp_filepath, filepath, error);
+  if (error) {
+    LOG(ERROR) << "Could not move " << tmp_filepath << " to " << filepath
+               << ": " << error.message();
+    return false;
+  }
+  return syncDirectory(filepath);
+}
+
+bool PipelineCheckpoint::load(const std::string& filepath,
+                              PipelineCheckpoint* checkpoint) {
+  CHECK_NOTNULL(checkpoint);
+  std::ifstream stream(filepath, std::ios::binary);
+  if (!stream.good()) {
+    LOG(WARNING) << "No checkpoint file at: " << filepath;
+    return false;
+  }
+  uint32_t magic = 0u;
+  uint32_t version = 0u;
+  read(stream, &magic);
+  read(stream, &version);
+  if (!stream.good() || magic != kCheckpointMagic ||
+      version != kCheckpointVersion) {
+    LOG(ERROR) << "Not a valid checkpoint (version " << kCheckpointVersion
+               << "): " << filepath;
+    return false;
+  }
+
+  Timestamp timestamp = 0;
+  read(stream, &timestamp);
+  double qw, qx, qy, qz;
+  read(stream, &qw);
+  read(stream, &qx);
+  read(stream, &qy);
+  read(stream, &qz);
+  const gtsam::Vector3 translation = readVector3(stream);
+  const gtsam::Vector3 velocity = readVector3(stream);
+  const gtsam::Vector3 acc_bias = readVector3(stream);
+  const gtsam::Vector3 gyro_bias = readVector3(stream);
+  if (!stream.good()) {
+    LOG(ERROR) << "Truncated checkpoint: " << filepath;
+    return false;
+  }
+
+  checkpoint->state_ = VioNavStateTimestamped(
+      timestamp,
+      gtsam::Pose3(gtsam::Rot3::Quaternion(qw, qx, qy, qz), translation),
+      velocity,
+      gtsam::imuBias::ConstantBias(acc_bias, gyro_bias));
+  return true;
+}
+
+PipelineCheckpointWriter::PipelineCheckpointWriter(const std::string& filepath)
+    : filepath_(filepath) {
+  writer_thread_ = std::thread(&PipelineCheckpointWriter::writerLoop, this);
+}
+
+PipelineCheckpointWriter::~PipelineCheckpointWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  cv_.notify_all();
+  writer_thread_.join();
+}
+
+void PipelineCheckpointWriter::write(const VioNavStateTimestamped& state) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pending_state_) ++nr_skipped_;
+    pending_state_ = state;
+  }
+  cv_.notify_all();
+}
+
+void PipelineCheckpointWriter::flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [this] { return !pending_state_ && !is_saving_; });
+}
+
+void PipelineCheckpointWriter::writerLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    cv_.wait(lock, [this] { return shutdown_ || pending_state_; });
+    // On shutdown, the pending checkpoint is still saved.
+    if (!pending_state_) break;
+
+    const PipelineCheckpoint checkpoint(*pending_state_);
+    pending_state_.reset();
+    is_saving_ = true;
+    lock.unlock();
+    LOG_IF(WARNING, !checkpoint.save(filepath_))
+        << "Could not save checkpoint: " << filepath_;
+    lock.lock();
+    is_saving_ = false;
+    cv_.notify_all();
+  }
+}
+
+}  // namespace VIO
@@ -0,0 +1,52 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   PipelineContext.cpp
+ * @brief  Read-only resources shared by the pipelines of a process.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/pipeline/PipelineContext.h"
+
+#include <glog/logging.h>
+
+#include "kimera-vio/utils/StartupCache.h"
+
+namespace VIO {
+
+PipelineContext::PipelineContext(const size_t& nr_scheduler_workers)
+    : vocab_mutex_(), vocab_(nullptr), module_scheduler_(nullptr) {
+  StartupCache::getInstance().shareInMemory();
+  if (nr_scheduler_workers > 0u) {
+    module_scheduler_ = std::make_shared<ModuleScheduler>(nr_scheduler_workers);
+    module_scheduler_->start();
+    LOG(INFO) << "Pipelines share a module scheduler with "
+              << module_scheduler_->getNrWorkers() << " workers.";
+  }
+}
+
+PipelineContext::~PipelineContext() {
+  if (module_scheduler_) {
+    module_scheduler_->shutdown();
+    module_scheduler_->join();
+    LOG(INFO) << module_scheduler_->printStats();
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+PreloadedVocab::Ptr PipelineContext::getPreloadedVocab() {
+  std::lock_guard<std::mutex> lock(vocab_mutex_);
+  if (!vocab_) {
+    PreloadedVocab loaded_vocab;
+    vocab_ = loaded_vocab.vocab;
+  }
+  return std::make_unique<PreloadedVocab>(vocab_);
+}
+
+}  // namespace VIO
@@ -0,0 +1,145 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   PipelineLatency.cpp
+ * @brief  Per-frame latency of the pipeline modules: queue wait, compute, and
+ * end-to-end latency since the frame entered the pipeline.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/pipeline/PipelineLatency.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include <glog/logging.h>
+
+#include "kimera-vio/utils/Statistics.h"
+
+namespace VIO {
+
+namespace {
+inline double toMs(const PipelineLatency::TimePoint& begin,
+                   const PipelineLatency::TimePoint& end) {
+  return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+inline std::string getQueueWaitTag(const std::string& module_name) {
+  return module_name + " Queue Wait [ms]";
+}
+inline std::string getComputeTag(const std::string& module_name) {
+  return module_name + " Compute [ms]";
+}
+inline std::string getLatencyTag(const std::string& module_name) {
+  return module_name + " Latency [ms]";
+}
+}  // namespace
+
+constexpr size_t PipelineLatency::kMaxFramesInFlight;
+
+PipelineLatency& PipelineLatency::instance() {
+  static PipelineLatency instance;
+  return instance;
+}
+
+void PipelineLatency::recordPipelineIngress(const Timestamp& timestamp) {
+  PipelineLatency& latency = instance();
+  std::lock_guard<std::mutex> lock(latency.mutex_);
+  latency.pipeline_ingress_[timestamp] =
+      std::chrono::high_resolution_clock::now();
+  while (latency.pipeline_ingress_.size() > kMaxFramesInFlight) {
+    latency.pipeline_ingress_.erase(latency.pipeline_ingress_.begin());
+  }
+}
+
+void PipelineLatency::recordModule(const std::string& module_name,
+                                   const Timestamp& timestamp,
+                                   const TimePoint& input_creation,
+                                   const TimePoint& ingress,
+                                   const TimePoint& egress) {
+  bool has_pipeline_ingress = false;
+  TimePoint pipeline_ingress;
+  {
+    PipelineLatency& latency = instance();
+    std::lock_guard<std::mutex> lock(latency.mutex_);
+    latency.module_names_.insert(module_name);
+    const auto& it = latency.pipeline_ingress_.find(timestamp);
+    if (it != latency.pipeline_ingress_.end()) {
+      has_pipeline_ingress = true;
+      pipeline_ingress = it->second;
+    }
+  }
+
+  // The Statistics lock-free buffers take the samples.
+  utils::StatsCollector(getQueueWaitTag(module_name))
+      .AddSample(std::max(toMs(input_creation, ingress), 0.0));
+  utils::StatsCollector(getComputeTag(module_name))
+      .AddSample(toMs(ingress, egress));
+  if (has_pipeline_ingress) {
+    utils::StatsCollector(getLatencyTag(module_name))
+        .AddSample(toMs(pipeline_ingress, egress));
+  } else {
+    // E.g. the data provider, upstream of the pipeline ingress.
+    VLOG(10) << "No pipeline ingress for the frame with timestamp "
+             << timestamp << " in module " << module_name << ".";
+  }
+}
+
+std::string PipelineLatency::print() {
+  std::set<std::string> module_names;
+  {
+    PipelineLatency& latency = instance();
+    std::lock_guard<std::mutex> lock(latency.mutex_);
+    module_names = latency.module_names_;
+  }
+  if (module_names.empty()) return "";
+
+  size_t max_name_length = 6u;
+  for (const std::string& module_name : module_names) {
+    max_name_length = std::max(max_name_length, module_name.size());
+  }
+
+  std::stringstream ss;
+  ss << "Pipeline latency [ms] (p50 / p95 / p99)\n";
+  ss << std::left << std::setw(max_name_length + 3u) << "Module"
+     << std::right << std::setw(24) << "Queue Wait" << std::setw(24)
+     << "Compute" << std::setw(24) << "Latency" << '\n';
+  const auto print_percentiles = [&ss](const std::string& tag) {
+    std::stringstream percentiles;
+    percentiles << std::fixed << std::setprecision(1);
+    if (utils::Statistics::HasHandle(tag) &&
+        utils::Statistics::GetNumSamples(tag) > 0u) {
+      percentiles << utils::Statistics::GetPercentile(tag, 50.0) << " / "
+                  << utils::Statistics::GetPercentile(tag, 95.0) << " / "
+                  << utils::Statistics::GetPercentile(tag, 99.0);
+    } else {
+      percentiles << "-";
+    }
+    ss << std::setw(24) << percentiles.str();
+  };
+  for (const std::string& module_name : module_names) {
+    ss << std::left << std::setw(max_name_length + 3u) << module_name
+       << std::right;
+    print_percentiles(getQueueWaitTag(module_name));
+    print_percentiles(getComputeTag(module_name));
+    print_percentiles(getLatencyTag(module_name));
+    ss << '\n';
+  }
+  return ss.str();
+}
+
+void PipelineLatency::reset() {
+  PipelineLatency& latency = instance();
+  std::lock_guard<std::mutex> lock(latency.mutex_);
+  latency.pipeline_ingress_.clear();
+  latency.module_names_.clear();
+}
+
+}  // namespace VIO
@@ -3,6 +3,7 @@
 namespace VIO {
 
 PipelinePayload::PipelinePayload(const Timestamp& timestamp)
-    : timestamp_(timestamp){};
+    : timestamp_(timestamp),
+      creation_time_(std::chrono::high_resolution_clock::now()){};
 
 }  // namespace VIO
@@ -0,0 +1,747 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   PipelineRecording.cpp
+ * @brief  Records the inputs of the Backend, Mesher and LCD modules to a file,
+ * and reads them back, to replay these modules without the Frontend.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/pipeline/PipelineRecording.h"
+
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <gtsam/navigation/CombinedImuFactor.h>
+#include <gtsam/navigation/ImuFactor.h>
+
+#include "kimera-vio/frontend/StereoFrame.h"
+#include "kimera-vio/frontend/StereoVisionImuFrontend-definitions.h"
+
+namespace VIO {
+
+namespace {
+
+enum class PimType : uint8_t {
+  kRegular = 0u,
+  kCombined = 1u,
+};
+
+// Works for both std and boost shared pointers, depending on the GTSAM
+// version.
+using RegularParams = gtsam::PreintegratedImuMeasurements::Params;
+using RegularParamsPtr = decltype(RegularParams::MakeSharedD());
+using CombinedParams = gtsam::PreintegratedCombinedMeasurements::Params;
+using CombinedParamsPtr = decltype(CombinedParams::MakeSharedD());
+
+/* -------------------------------------------------------------------------- */
+template <typename T>
+void writePod(std::ostream& out, const T& value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+T readPod(std::istream& in) {
+  T value;
+  in.read(reinterpret_cast<char*>(&value), sizeof(T));
+  CHECK(in.good()) << "PipelineRecording: truncated record.";
+  return value;
+}
+
+template <typename T>
+void writePodVector(std::ostream& out, const std::vector<T>& values) {
+  writePod(out, static_cast<uint64_t>(values.size()));
+  out.write(reinterpret_cast<const char*>(values.data()),
+            values.size() * sizeof(T));
+}
+
+template <typename T>
+void readPodVector(std::istream& in, std::vector<T>* values) {
+  CHECK_NOTNULL(values)->resize(readPod<uint64_t>(in));
+  in.read(reinterpret_cast<char*>(values->data()),
+          values->size() * sizeof(T));
+  CHECK(in.good()) << "PipelineRecording: truncated record.";
+}
+
+//! Coefficients in column-major order, the size is implied by the type.
+template <typename Derived>
+void writeMatrix(std::ostream& out, const Eigen::MatrixBase<Derived>& matrix) {
+  for (Eigen::Index c = 0; c < matrix.cols(); ++c) {
+    for (Eigen::Index r = 0; r < matrix.rows(); ++r) {
+      writePod(out, static_cast<double>(matrix(r, c)));
+    }
+  }
+}
+
+template <typename Derived>
+void readMatrix(std::istream& in, Eigen::MatrixBase<Derived>* matrix) {
+  CHECK_NOTNULL(matrix);
+  for (Eigen::Index c = 0; c < matrix->cols(); ++c) {
+    for (Eigen::Index r = 0; r < matrix->rows(); ++r) {
+      (*matrix)(r, c) = readPod<double>(in);
+    }
+  }
+}
+
+template <typename Matrix>
+Matrix readMatrix(std::istream& in) {
+  Matrix matrix;
+  readMatrix(in, &matrix);
+  return matrix;
+}
+
+void writePose(std::ostream& out, const gtsam::Pose3& pose) {
+  writeMatrix(out, pose.rotation().matrix());
+  writeMatrix(out, pose.translation());
+}
+
+gtsam::Pose3 readPose(std::istream& in) {
+  const gtsam::Matrix3 R = readMatrix<gtsam::Matrix3>(in);
+  const gtsam::Vector3 t = readMatrix<gtsam::Vector3>(in);
+  return gtsam::Pose3(gtsam::Rot3(R), t);
+}
+
+template <typename T>
+void writeOptional(std::ostream& out,
+                   const std::optional<T>& value,
+                   void (*write)(std::ostream&, const T&)) {
+  writePod(out, static_cast<uint8_t>(value.has_value()));
+  if (value) write(out, *value);
+}
+
+template <typename T>
+std::optional<T> readOptional(std::istream& in, T (*read)(std::istream&)) {
+  if (!readPod<uint8_t>(in)) return std::nullopt;
+  return read(in);
+}
+
+void writeVector3(std::ostream& out, const gtsam::Vector3& vector) {
+  writeMatrix(out, vector);
+}
+
+gtsam::Vector3 readVector3(std::istream& in) {
+  return readMatrix<gtsam::Vector3>(in);
+}
+
+void writeBias(std::ostream& out, const ImuBias& bias) {
+  writeMatrix(out, bias.accelerometer());
+  writeMatrix(out, bias.gyroscope());
+}
+
+ImuBias readBias(std::istream& in) {
+  const gtsam::Vector3 acc_bias = readVector3(in);
+  const gtsam::Vector3 gyro_bias = readVector3(in);
+  return ImuBias(acc_bias, gyro_bias);
+}
+
+void writeNavState(std::ostream& out, const VioNavState& state) {
+  writePose(out, state.pose_);
+  writeMatrix(out, state.velocity_);
+  writeBias(out, state.imu_bias_);
+}
+
+VioNavState readNavState(std::istream& in) {
+  const gtsam::Pose3 pose = readPose(in);
+  const gtsam::Vector3 velocity = readVector3(in);
+  return VioNavState(pose, velocity, readBias(in));
+}
+
+/* -------------------------------------------------------------------------- */
+void writeImage(std::ostream& out, const cv::Mat& image) {
+  writePod(out, static_cast<int32_t>(image.rows));
+  writePod(out, static_cast<int32_t>(image.cols));
+  writePod(out, static_cast<int32_t>(image.type()));
+  const size_t row_size = image.cols * image.elemSize();
+  for (int r = 0; r < image.rows; ++r) {
+    out.write(reinterpret_cast<const char*>(image.ptr(r)), row_size);
+  }
+}
+
+cv::Mat readImage(std::istream& in) {
+  const int32_t rows = readPod<int32_t>(in);
+  const int32_t cols = readPod<int32_t>(in);
+  const int32_t type = readPod<int32_t>(in);
+  CHECK_GE(rows, 0);
+  CHECK_GE(cols, 0);
+  if (rows == 0 || cols == 0) return cv::Mat();
+  cv::Mat image(rows, cols, type);
+  const size_t row_size = image.cols * image.elemSize();
+  for (int r = 0; r < image.rows; ++r) {
+    in.read(reinterpret_cast<char*>(image.ptr(r)), row_size);
+  }
+  CHECK(in.good()) << "PipelineRecording: truncated image.";
+  return image;
+}
+
+void writeStatusKeypoints(std::ostream& out,
+                          const StatusKeypointsCV& keypoints) {
+  writePod(out, static_cast<uint64_t>(keypoints.size()));
+  for (const StatusKeypointCV& keypoint : keypoints) {
+    writePod(out, static_cast<int32_t>(keypoint.first));
+    writePod(out, keypoint.second);
+  }
+}
+
+void readStatusKeypoints(std::istream& in, StatusKeypointsCV* keypoints) {
+  CHECK_NOTNULL(keypoints)->resize(readPod<uint64_t>(in));
+  for (StatusKeypointCV& keypoint : *keypoints) {
+    keypoint.first = static_cast<KeypointStatus>(readPod<int32_t>(in));
+    keypoint.second = readPod<KeypointCV>(in);
+  }
+}
+
+template <typename Vectors>
+void writeVectors3(std::ostream& out, const Vectors& vectors) {
+  writePod(out, static_cast<uint64_t>(vectors.size()));
+  for (const auto& vector : vectors) writeMatrix(out, vector);
+}
+
+template <typename Vectors>
+void readVectors3(std::istream& in, Vectors* vectors) {
+  CHECK_NOTNULL(vectors)->resize(readPod<uint64_t>(in));
+  for (auto& vector : *vectors) readMatrix(in, &vector);
+}
+
+void writePoints(std::ostream& out, const PointsWithIdMap& points) {
+  writePod(out, static_cast<uint64_t>(points.size()));
+  for (const auto& lmk_id_point : points) {
+    writePod(out, static_cast<int64_t>(lmk_id_point.first));
+    writeMatrix(out, lmk_id_point.second);
+  }
+}
+
+PointsWithIdMap readPoints(std::istream& in) {
+  PointsWithIdMap points;
+  const uint64_t nr_points = readPod<uint64_t>(in);
+  points.reserve(nr_points);
+  for (uint64_t i = 0u; i < nr_points; ++i) {
+    const LandmarkId lmk_id = readPod<int64_t>(in);
+    points[lmk_id] = readMatrix<gtsam::Point3>(in);
+  }
+  return points;
+}
+
+/* -------------------------------------------------------------------------- */
+void writeStereoMeasurements(std::ostream& out,
+                             const StatusStereoMeasurements& measurements) {
+  const TrackerStatusSummary& status = measurements.first;
+  writePod(out, static_cast<int32_t>(status.kfTrackingStatus_mono_));
+  writePod(out, static_cast<int32_t>(status.kfTrackingStatus_stereo_));
+  writePod(out, static_cast<int32_t>(status.kfTracking_status_pnp_));
+  writePose(out, status.lkf_T_k_mono_);
+  writePose(out, status.lkf_T_k_stereo_);
+  writePose(out, status.W_T_k_pnp_);
+  writeMatrix(out, status.infoMatStereoTranslation_);
+
+  const StereoMeasurements& stereo_measurements = measurements.second;
+  writePod(out, static_cast<uint64_t>(stereo_measurements.size()));
+  for (const StereoMeasurement& measurement : stereo_measurements) {
+    writePod(out, static_cast<int64_t>(measurement.first));
+    writePod(out, measurement.second.uL());
+    writePod(out, measurement.second.uR());
+    writePod(out, measurement.second.v());
+  }
+}
+
+StatusStereoMeasurementsPtr readStereoMeasurements(std::istream& in) {
+  TrackerStatusSummary status;
+  status.kfTrackingStatus_mono_ =
+      static_cast<TrackingStatus>(readPod<int32_t>(in));
+  status.kfTrackingStatus_stereo_ =
+      static_cast<TrackingStatus>(readPod<int32_t>(in));
+  status.kfTracking_status_pnp_ =
+      static_cast<TrackingStatus>(readPod<int32_t>(in));
+  status.lkf_T_k_mono_ = readPose(in);
+  status.lkf_T_k_stereo_ = readPose(in);
+  status.W_T_k_pnp_ = readPose(in);
+  readMatrix(in, &status.infoMatStereoTranslation_);
+
+  StereoMeasurements stereo_measurements(readPod<uint64_t>(in));
+  for (StereoMeasurement& measurement : stereo_measurements) {
+    measurement.first = readPod<int64_t>(in);
+    const double uL = readPod<double>(in);
+    const double uR = readPod<double>(in);
+    const double v = readPod<double>(in);
+    measurement.second = gtsam::StereoPoint2(uL, uR, v);
+  }
+  return std::make_shared<StatusStereoMeasurements>(
+      std::make_pair(status, stereo_measurements));
+}
+
+/* -------------------------------------------------------------------------- */
+void writePreintegrationParams(std::ostream& out,
+                               const gtsam::PreintegrationParams& params) {
+  writeMatrix(out, params.n_gravity);
+  writeMatrix(out, params.accelerometerCovariance);
+  writeMatrix(out, params.gyroscopeCovariance);
+  writeMatrix(out, params.integrationCovariance);
+  writePod(out, static_cast<uint8_t>(params.use2ndOrderCoriolis));
+  writePod(out, static_cast<uint8_t>(static_cast<bool>(params.omegaCoriolis)));
+  if (params.omegaCoriolis) writeMatrix(out, *params.getOmegaCoriolis());
+  writePod(out, static_cast<uint8_t>(static_cast<bool>(params.body_P_sensor)));
+  if (params.body_P_sensor) writePose(out, *params.getBodyPSensor());
+}
+
+template <typename ParamsPtr>
+void readPreintegrationParams(std::istream& in, const ParamsPtr& params) {
+  CHECK(params);
+  // The gravity is set at construction.
+  readMatrix(in, &params->accelerometerCovariance);
+  readMatrix(in, &params->gyroscopeCovariance);
+  readMatrix(in, &params->integrationCovariance);
+  params->setUse2ndOrderCoriolis(readPod<uint8_t>(in));
+  if (readPod<uint8_t>(in)) params->setOmegaCoriolis(readVector3(in));
+  if (readPod<uint8_t>(in)) params->setBodyPSensor(readPose(in));
+}
+
+/**
+ * @brief The PimRestorer class restores the state of a preintegration, which
+ * gtsam only exposes to derived classes. Copy it into a PimType afterwards.
+ */
+template <typename PimType>
+class PimRestorer : public PimType {
+ public:
+  template <typename ParamsPtr>
+  PimRestorer(const ParamsPtr& params, const ImuBias& bias)
+      : PimType(params, bias) {}
+
+  void readState(std::istream& in) {
+    this->deltaTij_ = readPod<double>(in);
+#ifdef GTSAM_TANGENT_PREINTEGRATION
+    readMatrix(in, &this->preintegrated_);
+    readMatrix(in, &this->preintegrated_H_biasAcc_);
+    readMatrix(in, &this->preintegrated_H_biasOmega_);
+#else
+    const gtsam::Pose3 delta_pose = readPose(in);
+    const gtsam::Vector3 delta_vel = readVector3(in);
+    this->deltaXij_ = gtsam::NavState(
+        delta_pose.rotation(), delta_pose.translation(), delta_vel);
+    readMatrix(in, &this->delRdelBiasOmega_);
+    readMatrix(in, &this->delPdelBiasAcc_);
+    readMatrix(in, &this->delPdelBiasOmega_);
+    readMatrix(in, &this->delVdelBiasAcc_);
+    readMatrix(in, &this->delVdelBiasOmega_);
+#endif
+    readMatrix(in, &this->preintMeasCov_);
+  }
+};
+
+void writePimState(std::ostream& out, const gtsam::PreintegrationType& pim) {
+  writePod(out, pim.deltaTij());
+#ifdef GTSAM_TANGENT_PREINTEGRATION
+  writeMatrix(out, pim.preintegrated());
+  writeMatrix(out, pim.preintegrated_H_biasAcc());
+  writeMatrix(out, pim.preintegrated_H_biasOmega());
+#else
+  const gtsam::NavState& delta_state = pim.deltaXij();
+  writePose(out, gtsam::Pose3(delta_state.attitude(), delta_state.position()));
+  writeMatrix(out, delta_state.velocity());
+  writeMatrix(out, pim.delRdelBiasOmega());
+  writeMatrix(out, pim.delPdelBiasAcc());
+  writeMatrix(out, pim.delPdelBiasOmega());
+  writeMatrix(out, pim.delVdelBiasAcc());
+  writeMatrix(out, pim.delVdelBiasOmega());
+#endif
+}
+
+void writePim(std::ostream& out, const gtsam::PreintegrationType& pim) {
+  const auto* combined_pim =
+      dynamic_cast<const gtsam::PreintegratedCombinedMeasurements*>(&pim);
+  const auto* regular_pim =
+      dynamic_cast<const gtsam::PreintegratedImuMeasurements*>(&pim);
+  CHECK(combined_pim || regular_pim) << "Unknown PIM type.";
+  writePod(out, combined_pim ? PimType::kCombined : PimType::kRegular);
+  writePreintegrationParams(out, *pim.params());
+  if (combined_pim) {
+    const CombinedParams& params = combined_pim->p();
+    writeMatrix(out, params.biasAccCovariance);
+    writeMatrix(out, params.biasOmegaCovariance);
+    writeMatrix(out, params.biasAccOmegaInt);
+  }
+  writeBias(out, pim.biasHat());
+  writePimState(out, pim);
+  if (combined_pim) {
+    writeMatrix(out, combined_pim->preintMeasCov());
+  } else {
+    writeMatrix(out, regular_pim->preintMeasCov());
+  }
+}
+
+ImuFrontend::PimPtr readPim(std::istream& in) {
+  const PimType type = readPod<PimType>(in);
+  const gtsam::Vector3 n_gravity = readVector3(in);
+  switch (type) {
+    case PimType::kRegular: {
+      RegularParamsPtr params(new RegularParams(n_gravity));
+      readPreintegrationParams(in, params);
+      const ImuBias bias = readBias(in);
+      PimRestorer<gtsam::PreintegratedImuMeasurements> restorer(params, bias);
+      restorer.readState(in);
+      // Slices the restorer on purpose.
+      return std::make_shared<gtsam::PreintegratedImuMeasurements>(restorer);
+    }
+    case PimType::kCombined: {
+      CombinedParamsPtr params(new CombinedParams(n_gravity));
+      readPreintegrationParams(in, params);
+      readMatrix(in, &params->biasAccCovariance);
+      readMatrix(in, &params->biasOmegaCovariance);
+      readMatrix(in, &params->biasAccOmegaInt);
+      const ImuBias bias = readBias(in);
+      PimRestorer<gtsam::PreintegratedCombinedMeasurements> restorer(params,
+                                                                     bias);
+      restorer.readState(in);
+      return std::make_shared<gtsam::PreintegratedCombinedMeasurements>(
+          restorer);
+    }
+    default: {
+      LOG(FATAL) << "PipelineRecording: unknown PIM type "
+                 << static_cast<int>(type);
+      return nullptr;
+    }
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+void writeFrame(std::ostream& out,
+                const Frame& frame,
+                const bool& with_image) {
+  writePod(out, static_cast<uint64_t>(frame.id_));
+  writePod(out, static_cast<int64_t>(frame.timestamp_));
+  writePod(out, static_cast<uint8_t>(frame.isKeyframe_));
+  writePodVector(out, frame.keypoints_);
+  writeStatusKeypoints(out, frame.keypoints_undistorted_);
+  writePodVector(out, frame.scores_);
+  writePodVector(out, frame.landmarks_);
+  writePodVector(out, frame.landmarks_age_);
+  writeVectors3(out, frame.versors_);
+  writeImage(out, frame.descriptors_);
+  writePod(out, static_cast<uint8_t>(with_image));
+  if (with_image) writeImage(out, frame.img_);
+}
+
+Frame readFrame(std::istream& in, const CameraParams& cam_params) {
+  const FrameId id = readPod<uint64_t>(in);
+  const Timestamp timestamp = readPod<int64_t>(in);
+  const bool is_keyframe = readPod<uint8_t>(in);
+  KeypointsCV keypoints;
+  readPodVector(in, &keypoints);
+  StatusKeypointsCV keypoints_undistorted;
+  readStatusKeypoints(in, &keypoints_undistorted);
+  std::vector<double> scores;
+  readPodVector(in, &scores);
+  LandmarkIds landmarks;
+  readPodVector(in, &landmarks);
+  std::vector<size_t> landmarks_age;
+  readPodVector(in, &landmarks_age);
+  BearingVectors versors;
+  readVectors3(in, &versors);
+  const cv::Mat descriptors = readImage(in);
+  const bool has_image = readPod<uint8_t>(in);
+
+  Frame frame(id, timestamp, cam_params, has_image ? readImage(in) : cv::Mat());
+  frame.isKeyframe_ = is_keyframe;
+  frame.keypoints_ = std::move(keypoints);
+  frame.keypoints_undistorted_ = std::move(keypoints_undistorted);
+  frame.scores_ = std::move(scores);
+  frame.landmarks_ = std::move(landmarks);
+  frame.landmarks_age_ = std::move(landmarks_age);
+  frame.versors_ = std::move(versors);
+  frame.descriptors_ = descriptors;
+  return frame;
+}
+
+void writeStereoFrame(std::ostream& out,
+                      const StereoFrame& stereo_frame,
+                      const bool& with_images) {
+  writePod(out, static_cast<uint64_t>(stereo_frame.id_));
+  writePod(out, static_cast<int64_t>(stereo_frame.timestamp_));
+  writePod(out, static_cast<uint8_t>(stereo_frame.isKeyframe()));
+  writeFrame(out, stereo_frame.left_frame_, with_images);
+  writeFrame(out, stereo_frame.right_frame_, with_images);
+  writeStatusKeypoints(out, stereo_frame.left_keypoints_rectified_);
+  writeStatusKeypoints(out, stereo_frame.right_keypoints_rectified_);
+  writePodVector(out, stereo_frame.keypoints_depth_);
+  writeVectors3(out, stereo_frame.keypoints_3d_);
+}
+
+StereoFrame readStereoFrame(std::istream& in,
+                            const CameraParams& left_cam_params,
+                            const CameraParams& right_cam_params) {
+  const FrameId id = readPod<uint64_t>(in);
+  const Timestamp timestamp = readPod<int64_t>(in);
+  const bool is_keyframe = readPod<uint8_t>(in);
+  const Frame left_frame = readFrame(in, left_cam_params);
+  const Frame right_frame = readFrame(in, right_cam_params);
+  StereoFrame stereo_frame(id, timestamp, left_frame, right_frame);
+  stereo_frame.setIsKeyframe(is_keyframe);
+  readStatusKeypoints(in, &stereo_frame.left_keypoints_rectified_);
+  readStatusKeypoints(in, &stereo_frame.right_keypoints_rectified_);
+  readPodVector(in, &stereo_frame.keypoints_depth_);
+  readVectors3(in, &stereo_frame.keypoints_3d_);
+  return stereo_frame;
+}
+
+void writeStereoFrontendOutput(std::ostream& out,
+                               const StereoFrontendOutput& output,
+                               const bool& with_images) {
+  writePod(out, static_cast<uint8_t>(output.is_keyframe_));
+  writePod(out,
+           static_cast<uint8_t>(output.status_stereo_measurements_ != nullptr));
+  if (output.status_stereo_measurements_) {
+    writeStereoMeasurements(out, *output.status_stereo_measurements_);
+  }
+  writePose(out, output.b_Pose_camL_rect_);
+  writePose(out, output.b_Pose_camR_rect_);
+  writeStereoFrame(out, *output.stereo_frame_lkf_, with_images);
+  writeOptional(out, output.body_lkf_OdomPose_body_kf_, &writePose);
+  writeOptional(out, output.body_kf_world_OdomVel_body_kf_, &writeVector3);
+}
+
+//! Without the PIM, IMU measurements and debug info, unused downstream.
+StereoFrontendOutput::Ptr readStereoFrontendOutput(
+    std::istream& in,
+    const CameraParams& left_cam_params,
+    const CameraParams& right_cam_params) {
+  const bool is_keyframe = readPod<uint8_t>(in);
+  const StatusStereoMeasurementsPtr measurements =
+      readPod<uint8_t>(in) ? readStereoMeasurements(in) : nullptr;
+  const gtsam::Pose3 b_Pose_camL_rect = readPose(in);
+  const gtsam::Pose3 b_Pose_camR_rect = readPose(in);
+  const StereoFrame stereo_frame =
+      readStereoFrame(in, left_cam_params, right_cam_params);
+  const std::optional<gtsam::Pose3> odom_pose = readOptional(in, &readPose);
+  const std::optional<gtsam::Velocity3> odom_vel =
+      readOptional(in, &readVector3);
+  return std::make_shared<StereoFrontendOutput>(is_keyframe,
+                                                measurements,
+                                                b_Pose_camL_rect,
+                                                b_Pose_camR_rect,
+                                                stereo_frame,
+                                                nullptr,
+                                                ImuAccGyrS(6, 0),
+                                                cv::Mat(),
+                                                DebugTrackerInfo(),
+                                                odom_pose,
+                                                odom_vel);
+}
+
+/* -------------------------------------------------------------------------- */
+void writeBackendInput(std::ostream& out, const BackendInput& input) {
+  CHECK(input.status_stereo_measurements_kf_);
+  writePod(out, static_cast<int64_t>(input.timestamp_));
+  writeStereoMeasurements(out, *input.status_stereo_measurements_kf_);
+  writePod(out, static_cast<uint8_t>(input.pim_ != nullptr));
+  if (input.pim_) writePim(out, *input.pim_);
+  writePod(out, static_cast<uint64_t>(input.imu_acc_gyrs_.cols()));
+  writeMatrix(out, input.imu_acc_gyrs_);
+  writeOptional(out, input.body_lkf_OdomPose_body_kf_, &writePose);
+  writeOptional(out, input.body_kf_world_OdomVel_body_kf_, &writeVector3);
+}
+
+BackendInput::UniquePtr readBackendInput(std::istream& in) {
+  const Timestamp timestamp = readPod<int64_t>(in);
+  const StatusStereoMeasurementsPtr measurements = readStereoMeasurements(in);
+  const ImuFrontend::PimPtr pim = readPod<uint8_t>(in) ? readPim(in) : nullptr;
+  ImuAccGyrS imu_acc_gyrs(6, readPod<uint64_t>(in));
+  readMatrix(in, &imu_acc_gyrs);
+  const std::optional<gtsam::Pose3> odom_pose = readOptional(in, &readPose);
+  const std::optional<gtsam::Velocity3> odom_vel =
+      readOptional(in, &readVector3);
+  return std::make_unique<BackendInput>(
+      timestamp, measurements, pim, imu_acc_gyrs, odom_pose, odom_vel);
+}
+
+//! Only what the Mesher uses from the Backend output.
+void writeMesherBackendOutput(std::ostream& out, const BackendOutput& output) {
+  writePod(out, static_cast<int64_t>(output.timestamp_));
+  writeNavState(out, output.W_State_Blkf_);
+  writePod(out, static_cast<uint64_t>(output.cur_kf_id_));
+  writePod(out, static_cast<int32_t>(output.landmark_count_));
+  writePoints(out, output.landmarks_with_id_map_);
+  writePod(out, static_cast<uint64_t>(output.lmk_id_to_lmk_type_map_.size()));
+  for (const auto& lmk_id_type : output.lmk_id_to_lmk_type_map_) {
+    writePod(out, static_cast<int64_t>(lmk_id_type.first));
+    writePod(out, static_cast<int32_t>(lmk_id_type.second));
+  }
+}
+
+BackendOutput::Ptr readMesherBackendOutput(std::istream& in) {
+  const Timestamp timestamp = readPod<int64_t>(in);
+  const VioNavState state = readNavState(in);
+  const FrameId cur_kf_id = readPod<uint64_t>(in);
+  const int landmark_count = readPod<int32_t>(in);
+  const PointsWithIdMap landmarks = readPoints(in);
+  LmkIdToLmkTypeMap lmk_types;
+  const uint64_t nr_lmk_types = readPod<uint64_t>(in);
+  for (uint64_t i = 0u; i < nr_lmk_types; ++i) {
+    const LandmarkId lmk_id = readPod<int64_t>(in);
+    lmk_types[lmk_id] = static_cast<LandmarkType>(readPod<int32_t>(in));
+  }
+  return std::make_shared<BackendOutput>(
+      VioNavStateTimestamped(timestamp, state),
+      gtsam::Values(),
+      gtsam::NonlinearFactorGraph(),
+      gtsam::Matrix(),
+      cur_kf_id,
+      landmark_count,
+      DebugVioInfo(),
+      landmarks,
+      lmk_types);
+}
+
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+PipelineRecorder::PipelineRecorder(const std::string& filename)
+    : mutex_(), file_() {
+  file_.open(filename);
+  file_.write(kPipelineRecordingMagic, sizeof(kPipelineRecordingMagic));
+  writePod(file_, kPipelineRecordingVersion);
+  LOG(INFO) << "Recording the Backend, Mesher and LCD inputs to: "
+            << filename;
+}
+
+void PipelineRecorder::recordInitialState(const VioNavState& initial_state) {
+  std::ostringstream payload;
+  writeNavState(payload, initial_state);
+  writeRecord(PipelineRecordType::kInitialState, payload.str());
+}
+
+void PipelineRecorder::recordBackendInput(const BackendInput& input) {
+  std::ostringstream payload;
+  writeBackendInput(payload, input);
+  writeRecord(PipelineRecordType::kBackendInput, payload.str());
+}
+
+void PipelineRecorder::recordMesherInput(const MesherInput& input) {
+  CHECK(input.frontend_output_);
+  CHECK(input.backend_output_);
+  std::ostringstream payload;
+  writePod(payload, static_cast<int64_t>(input.timestamp_));
+  writeStereoFrontendOutput(payload, *input.frontend_output_, false);
+  writeMesherBackendOutput(payload, *input.backend_output_);
+  writeRecord(PipelineRecordType::kMesherInput, payload.str());
+}
+
+void PipelineRecorder::recordLcdInput(const LcdInput& input) {
+  const auto* frontend_output =
+      dynamic_cast<const StereoFrontendOutput*>(input.frontend_output_.get());
+  if (!frontend_output) {
+    LOG_FIRST_N(WARNING, 1) << "PipelineRecorder: only the LCD inputs with "
+                               "a stereo Frontend output are recorded.";
+    return;
+  }
+  std::ostringstream payload;
+  writePod(payload, static_cast<int64_t>(input.timestamp_));
+  // The LCD extracts its own features from the images.
+  writeStereoFrontendOutput(payload, *frontend_output, true);
+  writePod(payload, static_cast<uint64_t>(input.cur_kf_id_));
+  writePoints(payload, *input.W_points_with_ids_);
+  writePose(payload, input.W_Pose_Blkf_);
+  writeRecord(PipelineRecordType::kLcdInput, payload.str());
+}
+
+void PipelineRecorder::flush() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  file_.flushToFile();
+}
+
+void PipelineRecorder::writeRecord(const PipelineRecordType& type,
+                                   const std::string& payload) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  writePod(file_, type);
+  writePod(file_, static_cast<uint64_t>(payload.size()));
+  file_.write(payload.data(), payload.size());
+}
+
+/* -------------------------------------------------------------------------- */
+PipelineRecordingReader::PipelineRecordingReader(
+    const std::string& filename,
+    const CameraParams& left_cam_params,
+    const CameraParams& right_cam_params)
+    : file_(filename, std::ios::in | std::ios::binary),
+      left_cam_params_(left_cam_params),
+      right_cam_params_(right_cam_params) {
+  CHECK(file_.is_open()) << "Could not open recording: " << filename;
+  char magic[sizeof(kPipelineRecordingMagic)];
+  file_.read(magic, sizeof(magic));
+  CHECK(file_.good() &&
+        std::memcmp(magic, kPipelineRecordingMagic, sizeof(magic)) == 0)
+      << "Not a pipeline recording: " << filename;
+  const uint32_t version = readPod<uint32_t>(file_);
+  CHECK_EQ(version, kPipelineRecordingVersion)
+      << "Unsupported pipeline recording version: " << filename;
+}
+
+bool PipelineRecordingReader::next(PipelineRecord* record) {
+  CHECK_NOTNULL(record);
+  PipelineRecordType type;
+  while (true) {
+    file_.read(reinterpret_cast<char*>(&type), sizeof(type));
+    if (file_.gcount() == 0 && file_.eof()) return false;
+    CHECK(file_.good()) << "PipelineRecording: truncated record header.";
+    std::string payload(readPod<uint64_t>(file_), '\0');
+    file_.read(&payload[0], payload.size());
+    CHECK(file_.good()) << "PipelineRecording: truncated record.";
+    std::istringstream in(payload);
+
+    *record = PipelineRecord();
+    record->type_ = type;
+    switch (type) {
+      case PipelineRecordType::kInitialState: {
+        record->initial_state_ = readNavState(in);
+        break;
+      }
+      case PipelineRecordType::kBackendInput: {
+        record->backend_input_ = readBackendInput(in);
+        break;
+      }
+      case PipelineRecordType::kMesherInput: {
+        const Timestamp timestamp = readPod<int64_t>(in);
+        const StereoFrontendOutput::Ptr frontend_output =
+            readStereoFrontendOutput(in, left_cam_params_, right_cam_params_);
+        const BackendOutput::Ptr backend_output = readMesherBackendOutput(in);
+        record->mesher_input_ = std::make_unique<MesherInput>(
+            timestamp, frontend_output, backend_output);
+        break;
+      }
+      case PipelineRecordType::kLcdInput: {
+        const Timestamp timestamp = readPod<int64_t>(in);
+        const StereoFrontendOutput::Ptr frontend_output =
+            readStereoFrontendOutput(in, left_cam_params_, right_cam_params_);
+        const FrameId cur_kf_id = readPod<uint64_t>(in);
+        PointsWithIdMap points = readPoints(in);
+        const gtsam::Pose3 W_Pose_Blkf = readPose(in);
+        record->lcd_input_ = std::make_unique<LcdInput>(timestamp,
+                                                        frontend_output,
+                                                        cur_kf_id,
+                                                        std::move(points),
+                                                        W_Pose_Blkf);
+        break;
+      }
+      default: {
+        // Newer record types are skipped.
+        LOG_FIRST_N(WARNING, 1) << "PipelineRecording: skipping records of "
+                                   "unknown type "
+                                << static_cast<uint32_t>(type);
+        continue;
+      }
+    }
+    CHECK_EQ(static_cast<size_t>(in.tellg()), payload.size())
+        << "PipelineRecording: inconsistent record.";
+    return true;
+  }
+}
+
+}  // namespace VIO
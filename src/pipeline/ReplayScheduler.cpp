@@ -0,0 +1,110 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ReplayScheduler.cpp
+ * @brief  Credit-based backpressure to replay datasets as fast as the
+ * pipeline can absorb them, with the same results as in sequential mode.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/pipeline/ReplayScheduler.h"
+
+#include <sstream>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+ReplayScheduler::ReplayScheduler(const size_t& max_frames_in_flight)
+    : max_frames_in_flight_(max_frames_in_flight),
+      mutex_(),
+      credits_cv_(),
+      pipeline_cv_(),
+      frames_in_flight_(),
+      is_frame_in_pipeline_(false),
+      shutdown_(false),
+      nr_frames_done_(0u),
+      first_frame_time_(),
+      last_frame_done_time_() {
+  CHECK_GE(max_frames_in_flight_, 2u)
+      << "The data provider module holds back one frame, at least two frames "
+         "must be allowed in flight.";
+}
+
+bool ReplayScheduler::acquireFrameCredit(const Timestamp& timestamp) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  credits_cv_.wait(lock, [this] {
+    return shutdown_ || frames_in_flight_.size() < max_frames_in_flight_;
+  });
+  if (shutdown_) return false;
+  frames_in_flight_.push_back(timestamp);
+  return true;
+}
+
+void ReplayScheduler::releaseFrameCredits(const Timestamp& timestamp) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (!frames_in_flight_.empty() &&
+           frames_in_flight_.front() <= timestamp) {
+      frames_in_flight_.pop_front();
+    }
+  }
+  credits_cv_.notify_all();
+}
+
+bool ReplayScheduler::waitForIdlePipeline() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  pipeline_cv_.wait(lock,
+                    [this] { return shutdown_ || !is_frame_in_pipeline_; });
+  if (shutdown_) return false;
+  if (nr_frames_done_ == 0u) {
+    first_frame_time_ = std::chrono::high_resolution_clock::now();
+  }
+  is_frame_in_pipeline_ = true;
+  return true;
+}
+
+void ReplayScheduler::signalFrameDone() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!is_frame_in_pipeline_) return;
+    is_frame_in_pipeline_ = false;
+    ++nr_frames_done_;
+    last_frame_done_time_ = std::chrono::high_resolution_clock::now();
+  }
+  pipeline_cv_.notify_all();
+}
+
+void ReplayScheduler::shutdown() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  credits_cv_.notify_all();
+  pipeline_cv_.notify_all();
+}
+
+double ReplayScheduler::getThroughput() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (nr_frames_done_ == 0u) return 0.0;
+  const double elapsed_s =
+      std::chrono::duration<double>(last_frame_done_time_ - first_frame_time_)
+          .count();
+  return elapsed_s > 0.0 ? static_cast<double>(nr_frames_done_) / elapsed_s
+                         : 0.0;
+}
+
+std::string ReplayScheduler::printStats() const {
+  std::stringstream out;
+  out << "Replay: " << getNrFramesDone() << " frames processed at "
+      << getThroughput() << " frames/s.";
+  return out.str();
+}
+
+}  // namespace VIO
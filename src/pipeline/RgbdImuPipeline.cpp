@@ -17,6 +17,7 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include <future>
 #include <string>
 
 #include "kimera-vio/backend/VioBackendFactory.h"
@@ -38,14 +39,62 @@ namespace VIO {
 RgbdImuPipeline::RgbdImuPipeline(const VioParams& params,
                                  Visualizer3D::UniquePtr&& visualizer,
                                  DisplayBase::UniquePtr&& displayer,
-                                 PreloadedVocab::Ptr&& preloaded_vocab)
-    : Pipeline(params) {
+                                 PreloadedVocab::Ptr&& preloaded_vocab,
+                                 PipelineContext::Ptr context)
+    : Pipeline(params, std::move(context)) {
   CHECK_GE(params.camera_params_.size(), 1u)
       << "Need at least one camera for RgbdImuPipeline.";
   camera_ = std::make_shared<RgbdCamera>(params.camera_params_.at(0));
+  const bool visualize = shouldVisualize(params, visualizer != nullptr,
+                                         displayer != nullptr);
+
+  //! The LCD, whose vocabulary takes the longest to load, and the Backend
+  //! are constructed while the other modules are. The task of the LCD may
+  //! outlive this constructor: it only captures copies.
+  std::future<LoopClosureDetector::UniquePtr> lcd_future;
+  if (FLAGS_use_lcd) {
+    lcd_future = startAsync([lcd_params = params.lcd_params_,
+                             camera = camera_,
+                             context = context_,
+                             preloaded_vocab =
+                                 std::move(preloaded_vocab)]() mutable {
+      if (!preloaded_vocab && context) {
+        preloaded_vocab = context->getPreloadedVocab();
+      }
+      return LcdFactory::createLcd(lcd_params.lcd_type_,
+                                   lcd_params,
+                                   camera->getCamParams(),
+                                   camera->getBodyPoseCam(),
+                                   std::nullopt,
+                                   std::nullopt,
+                                   camera,
+                                   FLAGS_log_output,
+                                   std::move(preloaded_vocab));
+    });
+  }
+
+  // TODO(Toni): put this into Backend params.
+  BackendOutputParams backend_output_params(
+      static_cast<VisualizationType>(FLAGS_viz_type) !=
+          VisualizationType::kNone,
+      FLAGS_min_num_obs_for_mesher_points,
+      visualize && FLAGS_visualize_lmk_type);
+  CHECK(backend_params_);
+  auto backend_future = startAsync([&]() {
+    return BackendFactory::createBackend(
+        static_cast<BackendType>(params.backend_type_),
+        // These two should be given by parameters.
+        camera_->getBodyPoseCam(),
+        camera_->getFakeStereoCalib(),
+        *backend_params_,
+        imu_params_,
+        backend_output_params,
+        FLAGS_log_output,
+        params.odom_params_);
+  });
 
   data_provider_module_ = std::make_unique<RgbdDataProviderModule>(
-      &frontend_input_queue_, "Rgbd Data Provider", parallel_run_);
+      frontend_input_queue_.get(), "Rgbd Data Provider", parallel_run_);
 
   if (FLAGS_do_coarse_imu_camera_temporal_sync) {
     data_provider_module_->doCoarseImuCameraTemporalSync();
@@ -70,14 +119,14 @@ RgbdImuPipeline::RgbdImuPipeline(const VioParams& params,
   LOG_IF(FATAL, !params.frontend_params_.use_stereo_tracking_)
       << "useStereoTracking is set to false, but is required for RGBD!";
   vio_frontend_module_ = std::make_unique<VisionImuFrontendModule>(
-      &frontend_input_queue_,
-      parallel_run_,
+      frontend_input_queue_.get(),
+      spinModulesInOwnThreads(),
       std::make_unique<RgbdVisionImuFrontend>(
           params.frontend_params_,
           params.imu_params_,
           gtsam::imuBias::ConstantBias(),
           camera_,
-          FLAGS_visualize ? &display_input_queue_ : nullptr,
+          visualize ? &display_input_queue_ : nullptr,
           FLAGS_log_output,
           params.odom_params_));
   vio_frontend_module_->registerImuTimeShiftUpdateCallback(
@@ -93,7 +142,7 @@ RgbdImuPipeline::RgbdImuPipeline(const VioParams& params,
             std::dynamic_pointer_cast<RgbdFrontendOutput>(output);
         CHECK(converted_output);
         if (converted_output->is_keyframe_) {
-          backend_input_queue.push(std::make_unique<BackendInput>(
+          backend_input_queue->push(std::make_unique<BackendInput>(
               converted_output->frame_lkf_.timestamp_,
               converted_output->status_stereo_measurements_,
               converted_output->pim_,
@@ -106,27 +155,10 @@ RgbdImuPipeline::RgbdImuPipeline(const VioParams& params,
         }
       });
 
-  // TODO(Toni): put this into Backend params.
-  BackendOutputParams backend_output_params(
-      static_cast<VisualizationType>(FLAGS_viz_type) !=
-          VisualizationType::kNone,
-      FLAGS_min_num_obs_for_mesher_points,
-      FLAGS_visualize && FLAGS_visualize_lmk_type);
-
-  CHECK(backend_params_);
   vio_backend_module_ = std::make_unique<VioBackendModule>(
-      &backend_input_queue_,
-      parallel_run_,
-      BackendFactory::createBackend(
-          static_cast<BackendType>(params.backend_type_),
-          // These two should be given by parameters.
-          camera_->getBodyPoseCam(),
-          camera_->getFakeStereoCalib(),
-          *backend_params_,
-          imu_params_,
-          backend_output_params,
-          FLAGS_log_output,
-          params.odom_params_));
+      backend_input_queue_.get(),
+      spinModulesInOwnThreads(),
+      backend_future.get());
   vio_backend_module_->registerOnFailureCallback(
       std::bind(&RgbdImuPipeline::signalBackendFailure, this));
   vio_backend_module_->registerImuBiasUpdateCallback(
@@ -142,7 +174,7 @@ RgbdImuPipeline::RgbdImuPipeline(const VioParams& params,
   if (static_cast<VisualizationType>(FLAGS_viz_type) ==
       VisualizationType::kMesh2dTo3dSparse) {
     mesher_module_ = std::make_unique<MesherModule>(
-        parallel_run_,
+        spinModulesInOwnThreads(),
         MesherFactory::createMesher(
             MesherType::PROJECTIVE,
             MesherParams(camera_->getBodyPoseCam(),
@@ -158,6 +190,10 @@ RgbdImuPipeline::RgbdImuPipeline(const VioParams& params,
         [&mesher_module](const FrontendOutputPacketBase::Ptr& base_output) {
           CHECK(base_output->frontend_type_ == FrontendType::kRgbdImu)
               << "Frontend output packet found that isn't an RGBD packet!";
+          // The mesher only uses keyframes: don't copy the frame otherwise.
+          if (!base_output->is_keyframe_) {
+            return;
+          }
 
           RgbdFrontendOutput::Ptr output =
               std::dynamic_pointer_cast<RgbdFrontendOutput>(base_output);
@@ -181,17 +217,24 @@ RgbdImuPipeline::RgbdImuPipeline(const VioParams& params,
 
   // TODO(nathan) LCD
   if (FLAGS_use_lcd) {
-    lcd_module_ = std::make_unique<LcdModule>(
-        parallel_run_,
-        LcdFactory::createLcd(LoopClosureDetectorType::BoW,
-                              params.lcd_params_,
-                              camera_->getCamParams(),
-                              camera_->getBodyPoseCam(),
-                              std::nullopt,
-                              std::nullopt,
-                              camera_,
-                              FLAGS_log_output,
-                              std::move(preloaded_vocab)));
+    lcd_module_ = std::make_unique<LcdModule>(spinModulesInOwnThreads(),
+                                              std::move(lcd_future));
+    if (params.lcd_params_.relocalize_after_tracking_loss_) {
+      auto& vio_backend_module = vio_backend_module_;
+      lcd_module_->registerRelocalizationCallback(
+          [&vio_backend_module,
+           rotation_precision =
+               params.lcd_params_.relocalization_rotation_precision_,
+           translation_precision =
+               params.lcd_params_.relocalization_translation_precision_](
+              const FrameId& kf_id, const gtsam::Pose3& W_Pose_B) {
+            CHECK_NOTNULL(vio_backend_module.get())
+                ->setRelocalizationPrior(kf_id,
+                                         W_Pose_B,
+                                         rotation_precision,
+                                         translation_precision);
+          });
+    }
     //! Register input callbacks
     vio_backend_module_->registerOutputCallback(
         std::bind(&LcdModule::fillBackendQueue,
@@ -203,21 +246,24 @@ RgbdImuPipeline::RgbdImuPipeline(const VioParams& params,
                   std::placeholders::_1));
   }
 
-  if (FLAGS_visualize) {
+  if (visualize) {
     visualizer_module_ = std::make_unique<VisualizerModule>(
         &display_input_queue_,
-        parallel_run_,
+        spinModulesInOwnThreads(),
         FLAGS_use_lcd,
         visualizer ? std::move(visualizer)
                    : VisualizerFactory::createVisualizer(
-                         VisualizerType::OpenCV,
+                         // Headless: no widgets for the telemetry display.
+                         VisualizerFactory::getVisualizerTypeForDisplay(
+                             params.display_params_->display_type_),
                          static_cast<VisualizationType>(FLAGS_viz_type),
                          static_cast<BackendType>(params.backend_type_)));
 
     vio_backend_module_->registerOutputCallback(
         std::bind(&VisualizerModule::fillBackendQueue,
                   std::ref(*CHECK_NOTNULL(visualizer_module_.get())),
-                  std::placeholders::_1));
+                  std::placeholders::_1),
+        visualizer_module_->getRequiredBackendOutputFields());
 
     auto& visualizer_module = visualizer_module_;
     vio_frontend_module_->registerOutputCallback(
@@ -245,7 +291,8 @@ RgbdImuPipeline::RgbdImuPipeline(const VioParams& params,
                   : DisplayFactory::makeDisplay(
                         params.display_params_->display_type_,
                         params.display_params_,
-                        std::bind(&RgbdImuPipeline::shutdown, this)));
+                        std::bind(&RgbdImuPipeline::shutdown, this)),
+        params.display_params_->target_fps_);
   }
 
   launchThreads();
@@ -0,0 +1,314 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   SharedMemoryOutput.cpp
+ * @brief  Publishes the latest outputs of the pipeline to a shared memory
+ * region, for readers in other processes (see SharedMemoryReader.h).
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/pipeline/SharedMemoryOutput.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+#include <glog/logging.h>
+
+#include <gtsam/inference/Symbol.h>
+
+#include "kimera-vio/backend/VioBackend-definitions.h"
+#include "kimera-vio/loopclosure/LcdOutputPacket.h"
+#include "kimera-vio/mesh/Mesher-definitions.h"
+
+namespace VIO {
+
+namespace {
+kimera_shm_pose toSharedPose(const Timestamp& timestamp,
+                             const gtsam::Pose3& pose) {
+  kimera_shm_pose shared_pose;
+  shared_pose.timestamp_ns = timestamp;
+  const gtsam::Point3& position = pose.translation();
+  const gtsam::Quaternion& quaternion = pose.rotation().toQuaternion();
+  shared_pose.position[0] = position.x();
+  shared_pose.position[1] = position.y();
+  shared_pose.position[2] = position.z();
+  shared_pose.orientation[0] = quaternion.w();
+  shared_pose.orientation[1] = quaternion.x();
+  shared_pose.orientation[2] = quaternion.y();
+  shared_pose.orientation[3] = quaternion.z();
+  return shared_pose;
+}
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+SharedMemoryOutput::SharedMemoryOutput(const std::string& name,
+                                       const size_t& trajectory_capacity,
+                                       const size_t& vertices_capacity,
+                                       const size_t& triangles_capacity)
+    : name_(name),
+      layout_(trajectory_capacity, vertices_capacity, triangles_capacity),
+      data_(nullptr),
+      header_(nullptr),
+      nav_state_section_(nullptr),
+      trajectory_section_(nullptr),
+      trajectory_poses_(nullptr),
+      mesh_section_(nullptr),
+      mesh_vertices_(nullptr),
+      mesh_triangles_(nullptr),
+      nav_state_mutex_(),
+      trajectory_mutex_(),
+      mesh_mutex_(),
+      trajectory_(),
+      has_lcd_trajectory_(false) {
+  CHECK(!name_.empty() && name_[0] == '/')
+      << "Shared memory names start with '/': " << name_;
+  // A previous writer may have crashed without unlinking its region: readers
+  // of the new one must not see its data.
+  ::shm_unlink(name_.c_str());
+  const int fd = ::shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  CHECK_GE(fd, 0) << "Could not create shared memory " << name_ << ": "
+                  << std::strerror(errno);
+  CHECK_EQ(::ftruncate(fd, static_cast<off_t>(layout_.size)), 0)
+      << "Could not size shared memory " << name_ << ": "
+      << std::strerror(errno);
+  data_ = ::mmap(
+      nullptr, layout_.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  CHECK(data_ != MAP_FAILED) << "Could not map shared memory " << name_
+                             << ": " << std::strerror(errno);
+
+  // ftruncate zero-fills: all sections start at sequence 0 (no data).
+  uint8_t* base = static_cast<uint8_t*>(data_);
+  header_ = new (base) SharedMemoryHeader();
+  nav_state_section_ =
+      new (base + layout_.nav_state_offset) SharedNavStateSection();
+  trajectory_section_ =
+      new (base + layout_.trajectory_offset) SharedTrajectorySection();
+  trajectory_poses_ = reinterpret_cast<kimera_shm_pose*>(
+      base + layout_.trajectory_offset + sizeof(SharedTrajectorySection));
+  mesh_section_ = new (base + layout_.mesh_offset) SharedMeshSection();
+  mesh_vertices_ = reinterpret_cast<float*>(base + layout_.mesh_offset +
+                                            sizeof(SharedMeshSection));
+  mesh_triangles_ =
+      reinterpret_cast<int32_t*>(mesh_vertices_ + 3u * vertices_capacity);
+
+  header_->version = kSharedMemoryVersion;
+  header_->size = layout_.size;
+  header_->trajectory_capacity = trajectory_capacity;
+  header_->vertices_capacity = vertices_capacity;
+  header_->triangles_capacity = triangles_capacity;
+  header_->nav_state_offset = layout_.nav_state_offset;
+  header_->trajectory_offset = layout_.trajectory_offset;
+  header_->mesh_offset = layout_.mesh_offset;
+  // Readers check the magic before reading the rest of the header.
+  header_->magic.store(kSharedMemoryMagic, std::memory_order_release);
+
+  LOG(INFO) << "Publishing the pipeline outputs to shared memory " << name_
+            << " (" << layout_.size / 1024u << " KB).";
+}
+
+SharedMemoryOutput::~SharedMemoryOutput() {
+  ::munmap(data_, layout_.size);
+  ::shm_unlink(name_.c_str());
+}
+
+/* -------------------------------------------------------------------------- */
+void SharedMemoryOutput::publishNavState(
+    const kimera_shm_nav_state& nav_state) {
+  std::lock_guard<std::mutex> lock(nav_state_mutex_);
+  nav_state_section_->lock.beginWrite();
+  nav_state_section_->nav_state = nav_state;
+  nav_state_section_->lock.endWrite();
+}
+
+void SharedMemoryOutput::publishTrajectory(
+    const std::vector<kimera_shm_pose>& poses) {
+  std::lock_guard<std::mutex> lock(trajectory_mutex_);
+  const size_t capacity = header_->trajectory_capacity;
+  trajectory_.assign(
+      poses.size() > capacity ? poses.end() - capacity : poses.begin(),
+      poses.end());
+  writeTrajectory();
+}
+
+void SharedMemoryOutput::appendTrajectoryPose(const kimera_shm_pose& pose) {
+  std::lock_guard<std::mutex> lock(trajectory_mutex_);
+  trajectory_.push_back(pose);
+  if (trajectory_.size() > header_->trajectory_capacity) {
+    // Keep the latest poses.
+    trajectory_.erase(trajectory_.begin());
+    writeTrajectory();
+    return;
+  }
+  // Only the new pose changes.
+  trajectory_section_->lock.beginWrite();
+  trajectory_poses_[trajectory_.size() - 1u] = pose;
+  trajectory_section_->nr_poses = trajectory_.size();
+  trajectory_section_->lock.endWrite();
+}
+
+void SharedMemoryOutput::writeTrajectory() {
+  DCHECK_LE(trajectory_.size(), header_->trajectory_capacity);
+  trajectory_section_->lock.beginWrite();
+  std::copy(trajectory_.begin(), trajectory_.end(), trajectory_poses_);
+  trajectory_section_->nr_poses = trajectory_.size();
+  trajectory_section_->lock.endWrite();
+}
+
+void SharedMemoryOutput::publishMesh(const float* vertices,
+                                     const size_t& nr_vertices,
+                                     const int32_t* triangles,
+                                     const size_t& nr_triangles) {
+  CHECK(vertices || nr_vertices == 0u);
+  CHECK(triangles || nr_triangles == 0u);
+  std::lock_guard<std::mutex> lock(mesh_mutex_);
+  const size_t nr_published_vertices =
+      std::min<size_t>(nr_vertices, header_->vertices_capacity);
+  const size_t nr_published_triangles =
+      std::min<size_t>(nr_triangles, header_->triangles_capacity);
+  const bool is_truncated = nr_published_vertices < nr_vertices ||
+                            nr_published_triangles < nr_triangles;
+  LOG_IF_EVERY_N(WARNING, is_truncated, 100)
+      << "Mesh of " << nr_vertices << " vertices and " << nr_triangles
+      << " triangles truncated to the capacity of " << name_;
+
+  mesh_section_->lock.beginWrite();
+  std::copy(vertices, vertices + 3u * nr_published_vertices, mesh_vertices_);
+  size_t nr_valid_triangles = 0u;
+  for (size_t i = 0u; i < nr_published_triangles; ++i) {
+    const int32_t* triangle = triangles + 3u * i;
+    // Vertices past the capacity are not published.
+    if (static_cast<size_t>(*std::max_element(triangle, triangle + 3)) >=
+        nr_published_vertices) {
+      continue;
+    }
+    std::copy(
+        triangle, triangle + 3, mesh_triangles_ + 3u * nr_valid_triangles);
+    ++nr_valid_triangles;
+  }
+  mesh_section_->nr_vertices = nr_published_vertices;
+  mesh_section_->nr_triangles = nr_valid_triangles;
+  mesh_section_->is_truncated = is_truncated ? 1u : 0u;
+  mesh_section_->lock.endWrite();
+}
+
+/* -------------------------------------------------------------------------- */
+void SharedMemoryOutput::publishBackendOutput(const BackendOutput& output) {
+  const VioNavStateTimestamped& state = output.W_State_Blkf_;
+  const kimera_shm_pose pose = toSharedPose(state.timestamp_, state.pose_);
+
+  kimera_shm_nav_state nav_state;
+  std::memset(&nav_state, 0, sizeof(nav_state));
+  nav_state.timestamp_ns = state.timestamp_;
+  nav_state.keyframe_id = output.cur_kf_id_;
+  nav_state.landmark_count = output.landmark_count_;
+  std::copy(pose.position, pose.position + 3, nav_state.position);
+  std::copy(pose.orientation, pose.orientation + 4, nav_state.orientation);
+  const gtsam::Vector3& acc_bias = state.imu_bias_.accelerometer();
+  const gtsam::Vector3& gyro_bias = state.imu_bias_.gyroscope();
+  for (int i = 0; i < 3; ++i) {
+    nav_state.velocity[i] = state.velocity_(i);
+    nav_state.acc_bias[i] = acc_bias(i);
+    nav_state.gyro_bias[i] = gyro_bias(i);
+  }
+  const gtsam::Matrix& covariance = output.state_covariance_lkf_;
+  if (covariance.rows() == covariance.cols() &&
+      covariance.rows() <= KIMERA_SHM_MAX_COVARIANCE_DIM) {
+    const int dim = static_cast<int>(covariance.rows());
+    nav_state.covariance_dim = static_cast<uint32_t>(dim);
+    for (int row = 0; row < dim; ++row) {
+      for (int col = 0; col < dim; ++col) {
+        nav_state.covariance[row * dim + col] = covariance(row, col);
+      }
+    }
+  }
+  publishNavState(nav_state);
+
+  bool has_lcd_trajectory = false;
+  {
+    std::lock_guard<std::mutex> lock(trajectory_mutex_);
+    has_lcd_trajectory = has_lcd_trajectory_;
+  }
+  if (!has_lcd_trajectory) appendTrajectoryPose(pose);
+}
+
+void SharedMemoryOutput::publishLcdOutput(const LcdOutput& output) {
+  if (output.states_.empty()) return;
+  // Keyed by keyframe id, the first one is the world origin (see
+  // LoopClosureDetectorLogger::logOptimizedTraj).
+  std::vector<kimera_shm_pose> new_poses;
+  bool is_appended = true;
+  for (const gtsam::Key& key : output.states_.keys()) {
+    const size_t kf_id = gtsam::Symbol(key).index();
+    const auto timestamp = output.timestamp_map_.find(kf_id);
+    if (kf_id == 0u || timestamp == output.timestamp_map_.end()) continue;
+    const kimera_shm_pose pose =
+        toSharedPose(timestamp->second, output.states_.at<gtsam::Pose3>(key));
+    // Only poses after the last one can be appended.
+    is_appended = is_appended && (lcd_trajectory_.empty() ||
+                                  kf_id > lcd_trajectory_.rbegin()->first);
+    lcd_trajectory_[kf_id] = pose;
+    new_poses.push_back(pose);
+  }
+
+  bool has_lcd_trajectory = false;
+  {
+    std::lock_guard<std::mutex> lock(trajectory_mutex_);
+    has_lcd_trajectory = has_lcd_trajectory_;
+    has_lcd_trajectory_ = true;
+  }
+  if (has_lcd_trajectory && is_appended) {
+    // Usual case: only the new keyframe, no loop closure.
+    for (const kimera_shm_pose& pose : new_poses) appendTrajectoryPose(pose);
+    return;
+  }
+  // First output, or corrected trajectory: replaces the Backend poses.
+  std::vector<kimera_shm_pose> poses;
+  poses.reserve(lcd_trajectory_.size());
+  for (const auto& kf_pose : lcd_trajectory_) poses.push_back(kf_pose.second);
+  publishTrajectory(poses);
+}
+
+void SharedMemoryOutput::publishMesherOutput(const MesherOutput& output) {
+  // Views, no copies of the mesh.
+  cv::Mat vertices;
+  output.mesh_3d_.getVerticesMeshToMat(&vertices, false);
+  cv::Mat polygons;
+  output.mesh_3d_.getPolygonsMeshToMat(&polygons, false);
+  if (!vertices.empty()) {
+    CHECK_EQ(vertices.type(), CV_32FC3);
+    vertices = vertices.isContinuous() ? vertices : vertices.clone();
+  }
+
+  // Polygons are [size, vertex ids...]: only triangles are published.
+  std::vector<int32_t> triangles;
+  triangles.reserve(3u * output.mesh_3d_.getNumberOfPolygons());
+  for (int i = 0; i + 3 < polygons.rows;) {
+    const int polygon_size = polygons.at<int32_t>(i);
+    CHECK_GT(polygon_size, 0);
+    if (polygon_size == 3) {
+      triangles.push_back(polygons.at<int32_t>(i + 1));
+      triangles.push_back(polygons.at<int32_t>(i + 2));
+      triangles.push_back(polygons.at<int32_t>(i + 3));
+    }
+    i += 1 + polygon_size;
+  }
+  publishMesh(vertices.empty() ? nullptr : vertices.ptr<float>(),
+              static_cast<size_t>(vertices.total()),
+              triangles.data(),
+              triangles.size() / 3u);
+}
+
+}  // namespace VIO
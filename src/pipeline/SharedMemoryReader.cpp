@@ -0,0 +1,199 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   SharedMemoryReader.cpp
+ * @brief  C API to read the outputs published by SharedMemoryOutput from
+ * another process, without serialization.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/pipeline/SharedMemoryReader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "kimera-vio/pipeline/SharedMemoryOutput-definitions.h"
+
+// The C API does not log nor throw: errors are return codes.
+struct kimera_shm_reader {
+  const uint8_t* data;
+  size_t size;
+  const VIO::SharedMemoryHeader* header;
+};
+
+namespace {
+inline const VIO::SeqlockSection* getSection(
+    const kimera_shm_reader* reader,
+    const kimera_shm_section& section) {
+  const uint8_t* data = reader->data;
+  const VIO::SharedMemoryHeader& header = *reader->header;
+  switch (section) {
+    case KIMERA_SHM_NAV_STATE:
+      return reinterpret_cast<const VIO::SeqlockSection*>(
+          data + header.nav_state_offset);
+    case KIMERA_SHM_TRAJECTORY:
+      return reinterpret_cast<const VIO::SeqlockSection*>(
+          data + header.trajectory_offset);
+    case KIMERA_SHM_MESH:
+      return reinterpret_cast<const VIO::SeqlockSection*>(data +
+                                                          header.mesh_offset);
+  }
+  return nullptr;
+}
+
+//! Whether the header describes the layout SharedMemoryOutput writes for its
+//! capacities, over the whole region: only then are its offsets safe to read.
+bool isLayoutValid(const VIO::SharedMemoryHeader& header, const size_t& size) {
+  // Bounded first, so that the layout does not overflow: any element of a
+  // section takes at least one byte.
+  if (header.trajectory_capacity > size || header.vertices_capacity > size ||
+      header.triangles_capacity > size) {
+    return false;
+  }
+  const VIO::SharedMemoryLayout layout(header.trajectory_capacity,
+                                       header.vertices_capacity,
+                                       header.triangles_capacity);
+  return header.size == size && layout.size == size &&
+         header.nav_state_offset == layout.nav_state_offset &&
+         header.trajectory_offset == layout.trajectory_offset &&
+         header.mesh_offset == layout.mesh_offset;
+}
+}  // namespace
+
+kimera_shm_reader* kimera_shm_open(const char* name) {
+  if (name == nullptr) return nullptr;
+  const int fd = ::shm_open(name, O_RDONLY, 0);
+  if (fd < 0) return nullptr;
+  struct stat file_stat;
+  if (::fstat(fd, &file_stat) != 0 ||
+      static_cast<size_t>(file_stat.st_size) <
+          sizeof(VIO::SharedMemoryHeader)) {
+    ::close(fd);
+    return nullptr;
+  }
+  const size_t size = static_cast<size_t>(file_stat.st_size);
+  void* data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) return nullptr;
+
+  const VIO::SharedMemoryHeader* header =
+      static_cast<const VIO::SharedMemoryHeader*>(data);
+  // The writer may still be initializing the region.
+  if (header->magic.load(std::memory_order_acquire) !=
+          VIO::kSharedMemoryMagic ||
+      header->version != VIO::kSharedMemoryVersion ||
+      !isLayoutValid(*header, size)) {
+    ::munmap(data, size);
+    return nullptr;
+  }
+  kimera_shm_reader* reader = new kimera_shm_reader();
+  reader->data = static_cast<const uint8_t*>(data);
+  reader->size = size;
+  reader->header = header;
+  return reader;
+}
+
+void kimera_shm_close(kimera_shm_reader* reader) {
+  if (reader == nullptr) return;
+  ::munmap(const_cast<uint8_t*>(reader->data), reader->size);
+  delete reader;
+}
+
+uint64_t kimera_shm_get_version(const kimera_shm_reader* reader,
+                                kimera_shm_section section) {
+  if (reader == nullptr) return 0u;
+  const VIO::SeqlockSection* lock = getSection(reader, section);
+  return lock ? lock->version() : 0u;
+}
+
+int kimera_shm_read_nav_state(const kimera_shm_reader* reader,
+                              kimera_shm_nav_state* nav_state) {
+  if (reader == nullptr || nav_state == nullptr) return KIMERA_SHM_ERROR;
+  const VIO::SharedNavStateSection& section =
+      *reinterpret_cast<const VIO::SharedNavStateSection*>(
+          reader->data + reader->header->nav_state_offset);
+  return section.lock.read([&section, nav_state]() {
+    *nav_state = section.nav_state;
+    return KIMERA_SHM_OK;
+  });
+}
+
+int kimera_shm_read_trajectory(const kimera_shm_reader* reader,
+                               kimera_shm_pose* poses,
+                               size_t poses_capacity,
+                               size_t* nr_poses) {
+  if (reader == nullptr || nr_poses == nullptr ||
+      (poses == nullptr && poses_capacity > 0u)) {
+    return KIMERA_SHM_ERROR;
+  }
+  const uint8_t* base = reader->data + reader->header->trajectory_offset;
+  const VIO::SharedTrajectorySection& section =
+      *reinterpret_cast<const VIO::SharedTrajectorySection*>(base);
+  const kimera_shm_pose* shared_poses =
+      reinterpret_cast<const kimera_shm_pose*>(
+          base + sizeof(VIO::SharedTrajectorySection));
+  const uint64_t capacity = reader->header->trajectory_capacity;
+  return section.lock.read([&]() {
+    const size_t nr_shared_poses =
+        static_cast<size_t>(std::min(section.nr_poses, capacity));
+    *nr_poses = nr_shared_poses;
+    if (nr_shared_poses > poses_capacity) return KIMERA_SHM_TOO_SMALL;
+    std::copy(shared_poses, shared_poses + nr_shared_poses, poses);
+    return KIMERA_SHM_OK;
+  });
+}
+
+int kimera_shm_read_mesh(const kimera_shm_reader* reader,
+                         float* vertices,
+                         size_t vertices_capacity,
+                         size_t* nr_vertices,
+                         int32_t* triangles,
+                         size_t triangles_capacity,
+                         size_t* nr_triangles,
+                         int* is_truncated) {
+  if (reader == nullptr || nr_vertices == nullptr || nr_triangles == nullptr ||
+      (vertices == nullptr && vertices_capacity > 0u) ||
+      (triangles == nullptr && triangles_capacity > 0u)) {
+    return KIMERA_SHM_ERROR;
+  }
+  const VIO::SharedMemoryHeader& header = *reader->header;
+  const uint8_t* base = reader->data + header.mesh_offset;
+  const VIO::SharedMeshSection& section =
+      *reinterpret_cast<const VIO::SharedMeshSection*>(base);
+  const float* shared_vertices =
+      reinterpret_cast<const float*>(base + sizeof(VIO::SharedMeshSection));
+  const int32_t* shared_triangles = reinterpret_cast<const int32_t*>(
+      shared_vertices + 3u * header.vertices_capacity);
+  return section.lock.read([&]() {
+    const size_t nr_shared_vertices =
+        static_cast<size_t>(std::min(section.nr_vertices,
+                                     header.vertices_capacity));
+    const size_t nr_shared_triangles =
+        static_cast<size_t>(std::min(section.nr_triangles,
+                                     header.triangles_capacity));
+    *nr_vertices = nr_shared_vertices;
+    *nr_triangles = nr_shared_triangles;
+    if (is_truncated) *is_truncated = section.is_truncated != 0u;
+    if (nr_shared_vertices > vertices_capacity ||
+        nr_shared_triangles > triangles_capacity) {
+      return KIMERA_SHM_TOO_SMALL;
+    }
+    std::copy(shared_vertices,
+              shared_vertices + 3u * nr_shared_vertices,
+              vertices);
+    std::copy(shared_triangles,
+              shared_triangles + 3u * nr_shared_triangles,
+              triangles);
+    return KIMERA_SHM_OK;
+  });
+}
@@ -18,6 +18,7 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include <future>
 #include <string>
 
 #include "kimera-vio/backend/VioBackendFactory.h"
@@ -39,17 +40,68 @@ namespace VIO {
 StereoImuPipeline::StereoImuPipeline(const VioParams& params,
                                      Visualizer3D::UniquePtr&& visualizer,
                                      DisplayBase::UniquePtr&& displayer,
-                                     PreloadedVocab::Ptr&& preloaded_vocab)
-    : Pipeline(params), stereo_camera_(nullptr) {
+                                     PreloadedVocab::Ptr&& preloaded_vocab,
+                                     PipelineContext::Ptr context)
+    : Pipeline(params, std::move(context)), stereo_camera_(nullptr) {
   //! Create Stereo Camera
   CHECK_EQ(params.camera_params_.size(), 2u)
       << "Need two cameras for StereoImuPipeline.";
   stereo_camera_ = std::make_shared<StereoCamera>(params.camera_params_.at(0),
                                                   params.camera_params_.at(1));
+  const bool visualize = shouldVisualize(params, visualizer != nullptr,
+                                         displayer != nullptr);
+
+  //! The LCD, whose vocabulary takes the longest to load, and the Backend
+  //! are constructed while the other modules are. The task of the LCD may
+  //! outlive this constructor: it only captures copies.
+  std::future<LoopClosureDetector::UniquePtr> lcd_future;
+  if (FLAGS_use_lcd) {
+    lcd_future = startAsync(
+        [lcd_params = params.lcd_params_,
+         stereo_camera = stereo_camera_,
+         stereo_matching_params =
+             params.frontend_params_.stereo_matching_params_,
+         context = context_,
+         preloaded_vocab = std::move(preloaded_vocab)]() mutable {
+          if (!preloaded_vocab && context) {
+            preloaded_vocab = context->getPreloadedVocab();
+          }
+          return LcdFactory::createLcd(lcd_params.lcd_type_,
+                                       lcd_params,
+                                       stereo_camera->getLeftCamParams(),
+                                       stereo_camera->getBodyPoseLeftCamRect(),
+                                       stereo_camera,
+                                       stereo_matching_params,
+                                       std::nullopt,
+                                       FLAGS_log_output,
+                                       std::move(preloaded_vocab));
+        });
+  }
+
+  //! Params for what the Backend outputs.
+  // TODO(Toni): put this into Backend params.
+  BackendOutputParams backend_output_params(
+      static_cast<VisualizationType>(FLAGS_viz_type) !=
+          VisualizationType::kNone,
+      FLAGS_min_num_obs_for_mesher_points,
+      visualize && FLAGS_visualize_lmk_type);
+  CHECK(backend_params_);
+  auto backend_future = startAsync([&]() {
+    return BackendFactory::createBackend(
+        static_cast<BackendType>(params.backend_type_),
+        // These two should be given by parameters.
+        stereo_camera_->getBodyPoseLeftCamRect(),
+        stereo_camera_->getStereoCalib(),
+        *backend_params_,
+        imu_params_,
+        backend_output_params,
+        FLAGS_log_output,
+        params.odom_params_);
+  });
 
   //! Create DataProvider
   data_provider_module_ = std::make_unique<StereoDataProviderModule>(
-      &frontend_input_queue_,
+      frontend_input_queue_.get(),
       "Stereo Data Provider",
       parallel_run_,
       // TODO(Toni): these params should not be sent...
@@ -76,15 +128,15 @@ StereoImuPipeline::StereoImuPipeline(const VioParams& params,
 
   //! Create Frontend
   vio_frontend_module_ = std::make_unique<VisionImuFrontendModule>(
-      &frontend_input_queue_,
-      parallel_run_,
+      frontend_input_queue_.get(),
+      spinModulesInOwnThreads(),
       VisionImuFrontendFactory::createFrontend(
           params.frontend_type_,
           params.imu_params_,
           gtsam::imuBias::ConstantBias(),
           params.frontend_params_,
           stereo_camera_,
-          FLAGS_visualize ? &display_input_queue_ : nullptr,
+          visualize ? &display_input_queue_ : nullptr,
           FLAGS_log_output,
           params.odom_params_));
   auto& backend_input_queue = backend_input_queue_;  //! for the lambda below
@@ -100,8 +152,8 @@ StereoImuPipeline::StereoImuPipeline(const VioParams& params,
 
         if (converted_output && converted_output->is_keyframe_) {
           //! Only push to Backend input queue if it is a keyframe!
-          backend_input_queue.push(std::make_unique<BackendInput>(
-              converted_output->stereo_frame_lkf_.timestamp_,
+          backend_input_queue->push(std::make_unique<BackendInput>(
+              converted_output->stereo_frame_lkf_->timestamp_,
               converted_output->status_stereo_measurements_,
               converted_output->pim_,
               converted_output->imu_acc_gyrs_,
@@ -113,29 +165,11 @@ StereoImuPipeline::StereoImuPipeline(const VioParams& params,
         }
       });
 
-  //! Params for what the Backend outputs.
-  // TODO(Toni): put this into Backend params.
-  BackendOutputParams backend_output_params(
-      static_cast<VisualizationType>(FLAGS_viz_type) !=
-          VisualizationType::kNone,
-      FLAGS_min_num_obs_for_mesher_points,
-      FLAGS_visualize && FLAGS_visualize_lmk_type);
-
   //! Create Backend
-  CHECK(backend_params_);
   vio_backend_module_ = std::make_unique<VioBackendModule>(
-      &backend_input_queue_,
-      parallel_run_,
-      BackendFactory::createBackend(
-          static_cast<BackendType>(params.backend_type_),
-          // These two should be given by parameters.
-          stereo_camera_->getBodyPoseLeftCamRect(),
-          stereo_camera_->getStereoCalib(),
-          *backend_params_,
-          imu_params_,
-          backend_output_params,
-          FLAGS_log_output,
-          params.odom_params_));
+      backend_input_queue_.get(),
+      spinModulesInOwnThreads(),
+      backend_future.get());
   vio_backend_module_->registerOnFailureCallback(
       std::bind(&StereoImuPipeline::signalBackendFailure, this));
   vio_backend_module_->registerImuBiasUpdateCallback(
@@ -147,11 +181,22 @@ StereoImuPipeline::StereoImuPipeline(const VioParams& params,
       std::bind(&VisionImuFrontendModule::updateMap,
                 std::cref(*CHECK_NOTNULL(vio_frontend_module_.get())),
                 std::placeholders::_1));
+  if (params.frontend_params_.tracker_params_.optical_flow_predictor_type_ ==
+      OpticalFlowPredictorType::kRotoTranslational) {
+    // The translational optical flow prediction needs the keyframe velocity.
+    auto& vio_frontend_module = vio_frontend_module_;
+    vio_backend_module_->registerOutputCallback(
+        [&vio_frontend_module](const BackendOutput::Ptr& output) {
+          CHECK(output);
+          CHECK_NOTNULL(vio_frontend_module.get())
+              ->updateNavState(output->W_State_Blkf_);
+        });
+  }
 
   if (static_cast<VisualizationType>(FLAGS_viz_type) ==
       VisualizationType::kMesh2dTo3dSparse) {
     mesher_module_ = std::make_unique<MesherModule>(
-        parallel_run_,
+        spinModulesInOwnThreads(),
         MesherFactory::createMesher(
             MesherType::PROJECTIVE,
             MesherParams(stereo_camera_->getBodyPoseLeftCamRect(),
@@ -174,17 +219,24 @@ StereoImuPipeline::StereoImuPipeline(const VioParams& params,
   }
 
   if (FLAGS_use_lcd) {
-    lcd_module_ = std::make_unique<LcdModule>(
-        parallel_run_,
-        LcdFactory::createLcd(LoopClosureDetectorType::BoW,
-                              params.lcd_params_,
-                              stereo_camera_->getLeftCamParams(),
-                              stereo_camera_->getBodyPoseLeftCamRect(),
-                              stereo_camera_,
-                              params.frontend_params_.stereo_matching_params_,
-                              std::nullopt,
-                              FLAGS_log_output,
-                              std::move(preloaded_vocab)));
+    lcd_module_ = std::make_unique<LcdModule>(spinModulesInOwnThreads(),
+                                              std::move(lcd_future));
+    if (params.lcd_params_.relocalize_after_tracking_loss_) {
+      auto& vio_backend_module = vio_backend_module_;
+      lcd_module_->registerRelocalizationCallback(
+          [&vio_backend_module,
+           rotation_precision =
+               params.lcd_params_.relocalization_rotation_precision_,
+           translation_precision =
+               params.lcd_params_.relocalization_translation_precision_](
+              const FrameId& kf_id, const gtsam::Pose3& W_Pose_B) {
+            CHECK_NOTNULL(vio_backend_module.get())
+                ->setRelocalizationPrior(kf_id,
+                                         W_Pose_B,
+                                         rotation_precision,
+                                         translation_precision);
+          });
+    }
     //! Register input callbacks
     vio_backend_module_->registerOutputCallback(
         std::bind(&LcdModule::fillBackendQueue,
@@ -197,16 +249,18 @@ StereoImuPipeline::StereoImuPipeline(const VioParams& params,
                   std::placeholders::_1));
   }
 
-  if (FLAGS_visualize) {
+  if (visualize) {
     visualizer_module_ = std::make_unique<VisualizerModule>(
         //! Send ouput of visualizer to the display_input_queue_
         &display_input_queue_,
-        parallel_run_,
+        spinModulesInOwnThreads(),
         FLAGS_use_lcd,
         // Use given visualizer if any
         visualizer ? std::move(visualizer)
                    : VisualizerFactory::createVisualizer(
-                         VisualizerType::OpenCV,
+                         // Headless: no widgets for the telemetry display.
+                         VisualizerFactory::getVisualizerTypeForDisplay(
+                             params.display_params_->display_type_),
                          // TODO(Toni): bundle these three params in
                          // VisualizerParams...
                          static_cast<VisualizationType>(FLAGS_viz_type),
@@ -215,7 +269,8 @@ StereoImuPipeline::StereoImuPipeline(const VioParams& params,
     vio_backend_module_->registerOutputCallback(
         std::bind(&VisualizerModule::fillBackendQueue,
                   std::ref(*CHECK_NOTNULL(visualizer_module_.get())),
-                  std::placeholders::_1));
+                  std::placeholders::_1),
+        visualizer_module_->getRequiredBackendOutputFields());
 
     auto& visualizer_module = visualizer_module_;
     vio_frontend_module_->registerOutputCallback(
@@ -245,7 +300,8 @@ StereoImuPipeline::StereoImuPipeline(const VioParams& params,
                   : DisplayFactory::makeDisplay(
                         params.display_params_->display_type_,
                         params.display_params_,
-                        std::bind(&StereoImuPipeline::shutdown, this)));
+                        std::bind(&StereoImuPipeline::shutdown, this)),
+        params.display_params_->target_fps_);
   }
 
   // All modules are ready, launch threads! If the parallel_run flag is set to
@@ -0,0 +1,69 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   StereoKeyframeStep.cpp
+ * @brief  Step from the stereo Frontend to the Backend of the pipelines that
+ * call them directly.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/pipeline/StereoKeyframeStep.h"
+
+#include <glog/logging.h>
+
+#include <memory>
+#include <utility>
+
+namespace VIO {
+
+StereoKeyframeStep::StereoKeyframeStep(VisionImuFrontend* frontend,
+                                       VioBackend* backend)
+    : frontend_(CHECK_NOTNULL(frontend)), backend_(CHECK_NOTNULL(backend)) {
+  backend_->registerImuBiasUpdateCallback(
+      [frontend](const ImuBias& imu_bias) {
+        frontend->updateImuBias(imu_bias);
+      });
+  backend_->registerMapUpdateCallback(
+      [frontend](const LandmarksMap& map) { frontend->updateMap(map); });
+}
+
+const StereoFrontendOutput& StereoKeyframeStep::castOutput(
+    const FrontendOutputPacketBase& frontend_output) {
+  DCHECK(frontend_output.frontend_type_ == FrontendType::kStereoImu);
+  return static_cast<const StereoFrontendOutput&>(frontend_output);
+}
+
+StereoFrontendOutput::Ptr StereoKeyframeStep::castOutput(
+    FrontendOutputPacketBase::UniquePtr frontend_output) {
+  CHECK(frontend_output);
+  DCHECK(frontend_output->frontend_type_ == FrontendType::kStereoImu);
+  return std::static_pointer_cast<StereoFrontendOutput>(
+      FrontendOutputPacketBase::Ptr(std::move(frontend_output)));
+}
+
+BackendInput StereoKeyframeStep::toBackendInput(
+    const StereoFrontendOutput& keyframe) {
+  DCHECK(keyframe.is_keyframe_);
+  return BackendInput(keyframe.stereo_frame_lkf_->timestamp_,
+                      keyframe.status_stereo_measurements_,
+                      keyframe.pim_,
+                      keyframe.imu_acc_gyrs_,
+                      keyframe.body_lkf_OdomPose_body_kf_,
+                      keyframe.body_kf_world_OdomVel_body_kf_);
+}
+
+BackendOutput::UniquePtr StereoKeyframeStep::spinOnce(
+    const StereoFrontendOutput& keyframe) const {
+  BackendOutput::UniquePtr backend_output =
+      backend_->spinOnce(toBackendInput(keyframe));
+  if (backend_output) frontend_->updateNavState(backend_output->W_State_Blkf_);
+  return backend_output;
+}
+
+}  // namespace VIO
@@ -1,12 +1,51 @@
 #include "kimera-vio/playground/EurocPlayground.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "kimera-vio/mesh/MeshUtils.h"
+#include "kimera-vio/utils/SimdKernels.h"
 #include "kimera-vio/visualizer/OpenCvDisplay.h"
 #include "kimera-vio/visualizer/OpenCvDisplayParams.h"
 #include "kimera-vio/visualizer/Visualizer3D-definitions.h"
 
 namespace VIO {
 
+namespace {
+
+//! Binary PLY of points with a grey color. The host is assumed little-endian,
+//! as on x86 and ARM.
+bool writeGreyPointsPly(const std::string& filename,
+                        const std::vector<float>& xyz,
+                        const std::vector<uint8_t>& greys) {
+  CHECK_EQ(xyz.size(), 3u * greys.size());
+  std::ofstream file(filename, std::ios::binary);
+  if (!file) return false;
+  file << "ply\nformat binary_little_endian 1.0\n"
+       << "element vertex " << greys.size() << '\n'
+       << "property float x\nproperty float y\nproperty float z\n"
+       << "property uchar red\nproperty uchar green\nproperty uchar blue\n"
+       << "end_header\n";
+  // 15 bytes per vertex, without padding.
+  static constexpr size_t kVertexBytes = 3u * sizeof(float) + 3u;
+  std::vector<char> vertices(kVertexBytes * greys.size());
+  char* vertex = vertices.data();
+  for (size_t i = 0u; i < greys.size(); ++i, vertex += kVertexBytes) {
+    std::memcpy(vertex, &xyz[3u * i], 3u * sizeof(float));
+    std::memset(vertex + 3u * sizeof(float), greys[i], 3u);
+  }
+  file.write(vertices.data(), vertices.size());
+  return static_cast<bool>(file);
+}
+
+}  // namespace
+
 EurocPlayground::EurocPlayground(const std::string& dataset_path,
                                  const std::string& params_path,
                                  const int& initial_k,
@@ -189,11 +228,10 @@ void EurocPlayground::visualizeGtData(const bool& viz_traj,
             euroc_data_provider_->getGroundTruthPose(left_frame->timestamp_);
         mesh_packet_.left_cam_rect_pose_ = left_cam_rect_pose;
         // Shouldn't we send rectified images?
-        mesh_packet_.left_image_rect_ =
-            stereo_frame.getLeftImgRectified().clone();
+        // Shared, the rectified images are only read from now on.
+        mesh_packet_.left_image_rect_ = stereo_frame.getLeftImgRectified();
         mesh_packet_.right_cam_rect_pose_ = right_cam_rect_pose;
-        mesh_packet_.right_image_rect =
-            stereo_frame.getRightImgRectified().clone();
+        mesh_packet_.right_image_rect = stereo_frame.getRightImgRectified();
 
         LOG(INFO) << "Converting depth to pcl.";
         // Reshape as a list of 3D points, same channels,
@@ -240,6 +278,132 @@ void EurocPlayground::visualizeGtData(const bool& viz_traj,
   display_module_->spinOnce(std::move(output));
 }
 
+size_t EurocPlayground::reconstructDenseBatch(const std::string& output_dir,
+                                              const FrameId& frame_stride,
+                                              const size_t& nr_threads) {
+  CHECK_GT(frame_stride, 0u);
+  CHECK(stereo_camera_);
+  const size_t nr_workers = std::max(
+      nr_threads > 0u ? nr_threads : std::thread::hardware_concurrency(),
+      size_t(1u));
+  LOG(INFO) << "Dense reconstruction with " << nr_workers << " threads to "
+            << output_dir;
+
+  // Both queues are popped at once to keep the stereo pairs together.
+  std::mutex pop_mutex;
+  std::atomic<size_t> nr_written(0u);
+  const auto work = [&]() {
+    // Dense stereo matchers are stateful: one per worker.
+    StereoMatcher stereo_matcher(
+        stereo_camera_, vio_params_.frontend_params_.stereo_matching_params_);
+    for (;;) {
+      Frame::UniquePtr left_frame = nullptr;
+      Frame::UniquePtr right_frame = nullptr;
+      {
+        std::lock_guard<std::mutex> lock(pop_mutex);
+        if (!left_frame_queue_.pop(left_frame) ||
+            !right_frame_queue_.pop(right_frame)) {
+          return;
+        }
+      }
+      CHECK(left_frame);
+      CHECK(right_frame);
+      CHECK_EQ(left_frame->timestamp_, right_frame->timestamp_);
+      if ((left_frame->id_ % frame_stride) != 0u) continue;
+
+      const std::string filename = output_dir + "/" +
+                                   std::to_string(left_frame->timestamp_) +
+                                   ".ply";
+      if (reconstructDenseFrame(
+              *left_frame, *right_frame, &stereo_matcher, filename)) {
+        ++nr_written;
+      } else {
+        LOG(ERROR) << "Could not write dense point cloud: " << filename;
+      }
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t i = 1u; i < nr_workers; ++i) workers.emplace_back(work);
+  work();
+  for (std::thread& worker : workers) worker.join();
+
+  LOG(INFO) << "Wrote " << nr_written << " dense point clouds.";
+  return nr_written;
+}
+
+bool EurocPlayground::reconstructDenseFrame(const Frame& left_frame,
+                                            const Frame& right_frame,
+                                            StereoMatcher* stereo_matcher,
+                                            const std::string& filename) const {
+  CHECK_NOTNULL(stereo_matcher);
+  StereoFrame stereo_frame(
+      left_frame.id_, left_frame.timestamp_, left_frame, right_frame);
+  stereo_camera_->undistortRectifyStereoFrame(&stereo_frame);
+  const cv::Mat& left_img_rect = stereo_frame.getLeftImgRectified();
+  CHECK_EQ(left_img_rect.type(), CV_8UC1);  // for color
+
+  cv::Mat disp_img(left_img_rect.rows, left_img_rect.cols, CV_32F);
+  stereo_matcher->denseStereoReconstruction(
+      left_img_rect, stereo_frame.getRightImgRectified(), &disp_img);
+  // Fixed-point disparities, as in visualizeGtData.
+  cv::Mat disparity;
+  disp_img.convertTo(disparity, CV_32F, 1.0f / 16.0f);
+
+  // Back-projection with Q (see StereoCamera::backProjectDisparityTo3D):
+  // z = f / (Q32 * d), (x, y) = (ray_x[u] * z, ray_y[v] * z).
+  const cv::Mat Q = stereo_camera_->getQ();
+  CHECK_EQ(Q.at<double>(3, 3), 0.0);
+  const float f = static_cast<float>(Q.at<double>(2, 3));
+  const float depth_times_disparity =
+      static_cast<float>(Q.at<double>(2, 3) / Q.at<double>(3, 2));
+  const int cols = disparity.cols;
+  std::vector<float> ray_x(cols);
+  for (int u = 0; u < cols; ++u) {
+    ray_x[u] = (u + static_cast<float>(Q.at<double>(0, 3))) / f;
+  }
+
+  const gtsam::Pose3 W_Pose_left_cam_rect =
+      euroc_data_provider_->getGroundTruthPose(left_frame.timestamp_)
+          .compose(stereo_camera_->getBodyPoseLeftCamRect());
+  const Eigen::Matrix3f W_R_cam =
+      W_Pose_left_cam_rect.rotation().matrix().cast<float>();
+  const Eigen::Vector3f W_t_cam =
+      W_Pose_left_cam_rect.translation().cast<float>();
+
+  const utils::SimdKernels::DepthRowFunction depth_row_to_points =
+      utils::SimdKernels::get().depth_row_to_points;
+  std::vector<float> depth_row(cols);
+  std::vector<float> cam_xyz_row(3 * cols);
+  std::vector<float> W_xyz;
+  std::vector<uint8_t> greys;
+  for (int v = 0; v < disparity.rows; ++v) {
+    const float* disparity_ptr = disparity.ptr<float>(v);
+    for (int u = 0; u < cols; ++u) {
+      // Invalid disparities are NaNs for the kernel.
+      depth_row[u] = disparity_ptr[u] > 0.0f
+                         ? depth_times_disparity / disparity_ptr[u]
+                         : std::numeric_limits<float>::quiet_NaN();
+    }
+    const float ray_y = (v + static_cast<float>(Q.at<double>(1, 3))) / f;
+    depth_row_to_points(
+        depth_row.data(), ray_x.data(), ray_y, cols, cam_xyz_row.data());
+
+    const uint8_t* grey_ptr = left_img_rect.ptr<uint8_t>(v);
+    for (int u = 0; u < cols; ++u) {
+      const float* cam_xyz = &cam_xyz_row[3 * u];
+      if (!isValidPoint(cv::Point3f(cam_xyz[0], cam_xyz[1], cam_xyz[2]))) {
+        continue;
+      }
+      const Eigen::Vector3f W_xyz_point =
+          W_R_cam * Eigen::Map<const Eigen::Vector3f>(cam_xyz) + W_t_cam;
+      W_xyz.insert(W_xyz.end(), W_xyz_point.data(), W_xyz_point.data() + 3);
+      greys.push_back(grey_ptr[u]);
+    }
+  }
+  return writeGreyPointsPly(filename, W_xyz, greys);
+}
+
 void EurocPlayground::projectVisibleLandmarksToCam(
     const StereoCamera& stereo_cam,
     const Landmarks& lmks) {
@@ -0,0 +1,169 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   AllocationInterposer.cpp
+ * @brief  Replaces the allocation functions to count the allocations, see
+ * AllocationTracker. Only linked in the executables that count them (tests
+ * and benchmarks), never in the library.
+ * @author Antoni Rosinol
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include "kimera-vio/utils/AllocationTracker.h"
+
+using VIO::utils::AllocationTracker;
+
+namespace {
+struct AllocationTrackerEnabler {
+  AllocationTrackerEnabler() { AllocationTracker::enable(); }
+} allocation_tracker_enabler;
+}  // namespace
+
+#ifdef __GLIBC__
+// With glibc, the malloc family is interposed: it also serves operator new,
+// and C libraries (e.g. OpenCV's own allocator).
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+
+void* malloc(size_t size) {
+  AllocationTracker::onAllocation(size);
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+  AllocationTracker::onAllocation(count * size);
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+  AllocationTracker::onAllocation(size);
+  return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr) {
+  if (ptr) AllocationTracker::onDeallocation();
+  __libc_free(ptr);
+}
+
+void* memalign(size_t alignment, size_t size) {
+  AllocationTracker::onAllocation(size);
+  return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+  AllocationTracker::onAllocation(size);
+  return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size) {
+  if (alignment % sizeof(void*) != 0u ||
+      (alignment & (alignment - 1u)) != 0u) {
+    return EINVAL;
+  }
+  AllocationTracker::onAllocation(size);
+  void* allocated = __libc_memalign(alignment, size);
+  if (!allocated) return ENOMEM;
+  *ptr = allocated;
+  return 0;
+}
+}  // extern "C"
+
+#else
+// Elsewhere, only the C++ allocations are counted.
+namespace {
+void* allocate(std::size_t size, std::size_t alignment) {
+  AllocationTracker::onAllocation(size);
+  if (size == 0u) size = 1u;
+  alignment = std::max(alignment, sizeof(void*));
+  while (true) {
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, alignment, size) == 0) return ptr;
+    const std::new_handler handler = std::get_new_handler();
+    if (!handler) throw std::bad_alloc();
+    handler();
+  }
+}
+
+void* allocateNoThrow(std::size_t size, std::size_t alignment) noexcept {
+  try {
+    return allocate(size, alignment);
+  } catch (const std::bad_alloc&) {
+    return nullptr;
+  }
+}
+
+void deallocate(void* ptr) noexcept {
+  if (ptr) AllocationTracker::onDeallocation();
+  std::free(ptr);
+}
+
+constexpr std::size_t kDefaultAlignment = alignof(std::max_align_t);
+}  // namespace
+
+void* operator new(std::size_t size) {
+  return allocate(size, kDefaultAlignment);
+}
+void* operator new[](std::size_t size) {
+  return allocate(size, kDefaultAlignment);
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  return allocateNoThrow(size, kDefaultAlignment);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return allocateNoThrow(size, kDefaultAlignment);
+}
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  return allocate(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+  return allocate(size, static_cast<std::size_t>(alignment));
+}
+void* operator new(std::size_t size,
+                   std::align_val_t alignment,
+                   const std::nothrow_t&) noexcept {
+  return allocateNoThrow(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[](std::size_t size,
+                     std::align_val_t alignment,
+                     const std::nothrow_t&) noexcept {
+  return allocateNoThrow(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr) noexcept { deallocate(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { deallocate(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+  deallocate(ptr);
+}
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+  deallocate(ptr);
+}
+void operator delete(void* ptr, std::align_val_t) noexcept {
+  deallocate(ptr);
+}
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+  deallocate(ptr);
+}
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+  deallocate(ptr);
+}
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept {
+  deallocate(ptr);
+}
+#endif
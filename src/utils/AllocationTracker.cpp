@@ -0,0 +1,268 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   AllocationTracker.cpp
+ * @brief  Counts the heap allocations of the threads and of the module spins.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/utils/AllocationTracker.h"
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+#include <execinfo.h>
+#define KIMERA_HAS_BACKTRACE 1
+#endif
+
+#include <atomic>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <utility>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kimera-vio/utils/Statistics.h"
+
+DEFINE_int32(allocation_warmup_spins,
+             10,
+             "Spins of each pipeline module after which its heap allocations "
+             "are reported as violations, if the allocations are counted "
+             "(tests and benchmarks).");
+
+namespace VIO {
+
+namespace utils {
+
+struct AllocationTracker::Module {
+  explicit Module(const std::string& module_name)
+      : name(module_name),
+        nr_spins(0u),
+        nr_allocations(0u),
+        nr_violations(0u),
+        mutex(),
+        violations(),
+        allocations_stats(module_name + " allocations [#]") {}
+
+  const std::string name;
+  std::atomic<size_t> nr_spins;
+  std::atomic<uint64_t> nr_allocations;
+  std::atomic<uint64_t> nr_violations;
+  std::mutex mutex;
+  std::vector<AllocationViolation> violations;
+  StatsCollector allocations_stats;
+};
+
+namespace {
+std::atomic_bool enabled(false);
+
+//! Constant-initialized: accessing it neither allocates nor runs a
+//! constructor, which the allocation hooks rely on.
+struct ThreadState {
+  AllocationCounts counts;
+  //! Module spinning in the thread, nullptr if none.
+  AllocationTracker::Module* module;
+  size_t spin;
+  //! Allocations of the tracker itself are not counted.
+  bool in_tracker;
+};
+thread_local ThreadState thread_state = {{0u, 0u, 0u}, nullptr, 0u, false};
+
+//! The allocations of the tracker itself are neither counted nor checked.
+class InTrackerGuard {
+ public:
+  InTrackerGuard() : previous_(thread_state.in_tracker) {
+    thread_state.in_tracker = true;
+  }
+  ~InTrackerGuard() { thread_state.in_tracker = previous_; }
+
+ private:
+  const bool previous_;
+};
+
+struct Registry {
+  std::mutex mutex;
+  //! Modules are never destroyed: scopes and threads keep pointers to them.
+  std::map<std::string, std::unique_ptr<AllocationTracker::Module>> modules;
+};
+
+Registry& getRegistry() {
+  // Leaked: the hooks may run after the static destructors.
+  static Registry* registry = new Registry();
+  return *registry;
+}
+}  // namespace
+
+bool AllocationTracker::isEnabled() {
+  return enabled.load(std::memory_order_relaxed);
+}
+
+void AllocationTracker::enable() {
+#ifdef KIMERA_HAS_BACKTRACE
+  // The first backtrace loads the unwinder, which allocates.
+  void* frame = nullptr;
+  backtrace(&frame, 1);
+#endif
+  enabled = true;
+}
+
+void AllocationTracker::onAllocation(const size_t& bytes) {
+  ThreadState& state = thread_state;
+  if (state.in_tracker) return;
+  ++state.counts.nr_allocations;
+  state.counts.allocated_bytes += bytes;
+  Module* module = state.module;
+  if (module == nullptr) return;
+  module->nr_allocations.fetch_add(1u, std::memory_order_relaxed);
+  if (state.spin < static_cast<size_t>(FLAGS_allocation_warmup_spins)) return;
+  if (module->nr_violations.fetch_add(1u, std::memory_order_relaxed) >=
+      kMaxViolationsPerModule) {
+    return;
+  }
+
+  InTrackerGuard guard;
+  AllocationViolation violation;
+  violation.module = module->name;
+  violation.spin = state.spin;
+  violation.bytes = bytes;
+#ifdef KIMERA_HAS_BACKTRACE
+  void* frames[kMaxCallstackDepth + 1u];
+  const int depth =
+      backtrace(frames, static_cast<int>(kMaxCallstackDepth + 1u));
+  // Without the frame of this hook.
+  if (depth > 1) violation.callstack.assign(frames + 1, frames + depth);
+#endif
+  {
+    std::lock_guard<std::mutex> lock(module->mutex);
+    module->violations.push_back(std::move(violation));
+  }
+}
+
+void AllocationTracker::onDeallocation() {
+  ThreadState& state = thread_state;
+  if (!state.in_tracker) ++state.counts.nr_deallocations;
+}
+
+AllocationCounts AllocationTracker::getThreadCounts() {
+  return thread_state.counts;
+}
+
+size_t AllocationTracker::getNumViolations() {
+  Registry& registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  size_t nr_violations = 0u;
+  for (const auto& module : registry.modules) {
+    nr_violations += module.second->nr_violations;
+  }
+  return nr_violations;
+}
+
+std::vector<AllocationViolation> AllocationTracker::getViolations() {
+  InTrackerGuard guard;
+  Registry& registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  std::vector<AllocationViolation> violations;
+  for (const auto& module : registry.modules) {
+    std::lock_guard<std::mutex> module_lock(module.second->mutex);
+    violations.insert(violations.end(),
+                      module.second->violations.begin(),
+                      module.second->violations.end());
+  }
+  return violations;
+}
+
+std::string AllocationTracker::print() {
+  std::stringstream ss;
+  if (!isEnabled()) {
+    ss << "Allocations are not counted: the allocation functions are not "
+          "interposed.\n";
+    return ss.str();
+  }
+  InTrackerGuard guard;
+  ss << "Allocations\tspins\tallocations\tafter warmup ("
+     << FLAGS_allocation_warmup_spins << " spins)\n";
+  Registry& registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (const auto& module : registry.modules) {
+    ss << module.first << "\t" << module.second->nr_spins << "\t"
+       << module.second->nr_allocations << "\t"
+       << module.second->nr_violations << "\n";
+  }
+  for (const auto& module : registry.modules) {
+    std::lock_guard<std::mutex> module_lock(module.second->mutex);
+    for (const AllocationViolation& violation : module.second->violations) {
+      ss << "Allocation of " << violation.bytes << " bytes in spin "
+         << violation.spin << " of " << violation.module << ":\n";
+#ifdef KIMERA_HAS_BACKTRACE
+      char** symbols =
+          backtrace_symbols(violation.callstack.data(),
+                            static_cast<int>(violation.callstack.size()));
+      for (size_t i = 0u; symbols && i < violation.callstack.size(); ++i) {
+        ss << "  #" << i << " " << symbols[i] << "\n";
+      }
+      std::free(symbols);
+#endif
+    }
+  }
+  return ss.str();
+}
+
+void AllocationTracker::reset() {
+  Registry& registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (const auto& module : registry.modules) {
+    std::lock_guard<std::mutex> module_lock(module.second->mutex);
+    module.second->nr_spins = 0u;
+    module.second->nr_allocations = 0u;
+    module.second->nr_violations = 0u;
+    module.second->violations.clear();
+  }
+}
+
+AllocationTracker::Module* AllocationTracker::getModule(
+    const std::string& name) {
+  InTrackerGuard guard;
+  Registry& registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  std::unique_ptr<Module>& module = registry.modules[name];
+  if (!module) module = std::make_unique<Module>(name);
+  return module.get();
+}
+
+/* -------------------------------------------------------------------------- */
+AllocationScope::AllocationScope(const std::string& module)
+    : module_(nullptr),
+      previous_module_(nullptr),
+      previous_spin_(0u),
+      begin_nr_allocations_(0u) {
+  if (!AllocationTracker::isEnabled()) return;
+  module_ = AllocationTracker::getModule(module);
+  ThreadState& state = thread_state;
+  previous_module_ = state.module;
+  previous_spin_ = state.spin;
+  state.module = module_;
+  state.spin = module_->nr_spins.fetch_add(1u);
+  begin_nr_allocations_ = state.counts.nr_allocations;
+}
+
+AllocationScope::~AllocationScope() {
+  if (!module_) return;
+  ThreadState& state = thread_state;
+  const uint64_t nr_allocations =
+      state.counts.nr_allocations - begin_nr_allocations_;
+  state.module = previous_module_;
+  state.spin = previous_spin_;
+  module_->allocations_stats.AddSample(static_cast<double>(nr_allocations));
+}
+
+}  // namespace utils
+
+}  // namespace VIO
@@ -0,0 +1,240 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   DepthCodec.cpp
+ * @brief  Compression of depth images for caching and logging.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/utils/DepthCodec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+namespace {
+
+constexpr std::uint8_t kMagic[4] = {'K', 'R', 'V', 'L'};
+
+//! Header of the compressed images, stored as is (native endianness).
+struct DepthCodecHeader {
+  std::uint8_t magic[4];
+  std::int32_t rows;
+  std::int32_t cols;
+  std::int32_t type;
+  float float_step;
+  //! Size of the nibble stream following the header [bytes].
+  std::uint32_t payload_size;
+};
+
+class NibbleWriter {
+ public:
+  explicit NibbleWriter(std::vector<std::uint8_t>* bytes) : bytes_(bytes) {}
+
+  //! Writes value in nibbles of 3 bits, the 4th one flagging that more
+  //! nibbles follow.
+  void writeVle(std::uint32_t value) {
+    do {
+      std::uint8_t nibble = value & 0x7u;
+      value >>= 3;
+      if (value) nibble |= 0x8u;
+      writeNibble(nibble);
+    } while (value);
+  }
+
+ private:
+  void writeNibble(const std::uint8_t& nibble) {
+    if (high_) {
+      bytes_->push_back(static_cast<std::uint8_t>(nibble << 4));
+    } else {
+      bytes_->back() |= nibble;
+    }
+    high_ = !high_;
+  }
+
+  std::vector<std::uint8_t>* bytes_;
+  bool high_ = true;
+};
+
+class NibbleReader {
+ public:
+  NibbleReader(const std::uint8_t* begin, const std::uint8_t* end)
+      : cur_(begin), end_(end) {}
+
+  bool readVle(std::uint32_t* value) {
+    *value = 0u;
+    for (int shift = 0; shift < 32; shift += 3) {
+      if (cur_ == end_) return false;
+      const std::uint8_t nibble = high_ ? (*cur_ >> 4) : (*cur_ & 0xFu);
+      if (!high_) ++cur_;
+      high_ = !high_;
+      *value |= static_cast<std::uint32_t>(nibble & 0x7u) << shift;
+      if (!(nibble & 0x8u)) return true;
+    }
+    return false;
+  }
+
+ private:
+  const std::uint8_t* cur_;
+  const std::uint8_t* end_;
+  bool high_ = true;
+};
+
+void encodeRvl(const std::uint16_t* values,
+               const size_t& n,
+               std::vector<std::uint8_t>* bytes) {
+  NibbleWriter writer(bytes);
+  std::int32_t previous = 0;
+  size_t i = 0u;
+  while (i < n) {
+    size_t zeros = 0u;
+    while (i + zeros < n && values[i + zeros] == 0u) ++zeros;
+    i += zeros;
+    size_t nonzeros = 0u;
+    while (i + nonzeros < n && values[i + nonzeros] != 0u) ++nonzeros;
+    writer.writeVle(static_cast<std::uint32_t>(zeros));
+    writer.writeVle(static_cast<std::uint32_t>(nonzeros));
+    for (const size_t end = i + nonzeros; i < end; ++i) {
+      const std::int32_t delta = values[i] - previous;
+      // Zigzag: small deltas of either sign give small values.
+      writer.writeVle((static_cast<std::uint32_t>(delta) << 1) ^
+                      static_cast<std::uint32_t>(delta >> 31));
+      previous = values[i];
+    }
+  }
+}
+
+bool decodeRvl(const std::uint8_t* begin,
+               const std::uint8_t* end,
+               const size_t& n,
+               std::uint16_t* values) {
+  NibbleReader reader(begin, end);
+  std::int32_t previous = 0;
+  size_t i = 0u;
+  while (i < n) {
+    std::uint32_t zeros, nonzeros;
+    if (!reader.readVle(&zeros) || !reader.readVle(&nonzeros)) return false;
+    if (zeros > n - i || nonzeros > n - i - zeros) return false;
+    std::memset(values + i, 0, zeros * sizeof(std::uint16_t));
+    i += zeros;
+    for (const size_t run_end = i + nonzeros; i < run_end; ++i) {
+      std::uint32_t zigzag;
+      if (!reader.readVle(&zigzag)) return false;
+      previous += static_cast<std::int32_t>(zigzag >> 1) ^
+                  -static_cast<std::int32_t>(zigzag & 1u);
+      values[i] = static_cast<std::uint16_t>(previous);
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+void DepthCodec::encode(const cv::Mat& depth,
+                        const float& float_step,
+                        std::vector<std::uint8_t>* bytes) {
+  CHECK_NOTNULL(bytes);
+  CHECK(depth.type() == CV_16UC1 || depth.type() == CV_32FC1)
+      << "Unsupported depth type: " << depth.type();
+
+  // The quantized image, continuous for the RVL stream.
+  cv::Mat_<std::uint16_t> values;
+  if (depth.type() == CV_16UC1) {
+    values = depth.isContinuous() ? depth : depth.clone();
+  } else {
+    CHECK_GT(float_step, 0.0f);
+    values.create(depth.rows, depth.cols);
+    const float inv_step = 1.0f / float_step;
+    static constexpr float max_value =
+        std::numeric_limits<std::uint16_t>::max();
+    for (int r = 0; r < depth.rows; ++r) {
+      const float* in = depth.ptr<float>(r);
+      std::uint16_t* out = values.ptr<std::uint16_t>(r);
+      for (int c = 0; c < depth.cols; ++c) {
+        // NaN fails the comparison as well.
+        if (!(in[c] > 0.0f) || std::isinf(in[c])) {
+          out[c] = 0u;
+          continue;
+        }
+        // Valid depths never decode as invalid ones.
+        const float q = std::round(in[c] * inv_step);
+        out[c] = static_cast<std::uint16_t>(
+            std::min(std::max(q, 1.0f), max_value));
+      }
+    }
+  }
+
+  const size_t header_offset = bytes->size();
+  bytes->resize(header_offset + sizeof(DepthCodecHeader));
+  encodeRvl(values.ptr<std::uint16_t>(), values.total(), bytes);
+
+  DepthCodecHeader header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.rows = depth.rows;
+  header.cols = depth.cols;
+  header.type = depth.type();
+  header.float_step = depth.type() == CV_32FC1 ? float_step : 1.0f;
+  header.payload_size = static_cast<std::uint32_t>(
+      bytes->size() - header_offset - sizeof(DepthCodecHeader));
+  std::memcpy(bytes->data() + header_offset, &header, sizeof(header));
+}
+
+bool DepthCodec::decode(const std::vector<std::uint8_t>& bytes,
+                        size_t* offset,
+                        cv::Mat* depth) {
+  CHECK_NOTNULL(offset);
+  CHECK_NOTNULL(depth);
+  DepthCodecHeader header;
+  if (*offset > bytes.size() || bytes.size() - *offset < sizeof(header)) {
+    LOG(ERROR) << "Truncated depth image header.";
+    return false;
+  }
+  std::memcpy(&header, bytes.data() + *offset, sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.rows < 0 || header.cols < 0 ||
+      (header.type != CV_16UC1 && header.type != CV_32FC1)) {
+    LOG(ERROR) << "Invalid depth image header.";
+    return false;
+  }
+  const size_t payload_offset = *offset + sizeof(header);
+  if (bytes.size() - payload_offset < header.payload_size) {
+    LOG(ERROR) << "Truncated depth image.";
+    return false;
+  }
+
+  const std::uint8_t* payload = bytes.data() + payload_offset;
+  cv::Mat_<std::uint16_t> values;
+  if (header.type == CV_16UC1) {
+    // Decoded in place, hence it must be continuous.
+    if (!depth->isContinuous()) depth->release();
+    depth->create(header.rows, header.cols, CV_16UC1);
+    values = *depth;
+  } else {
+    values.create(header.rows, header.cols);
+  }
+  if (!decodeRvl(payload,
+                 payload + header.payload_size,
+                 values.total(),
+                 values.ptr<std::uint16_t>())) {
+    LOG(ERROR) << "Corrupted depth image.";
+    return false;
+  }
+  if (header.type == CV_32FC1) {
+    values.convertTo(*depth, CV_32FC1, header.float_step);
+  }
+  *offset = payload_offset + header.payload_size;
+  return true;
+}
+
+}  // namespace VIO
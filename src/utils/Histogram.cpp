@@ -14,6 +14,7 @@
 
 #include "kimera-vio/utils/Histogram.h"
 
+#include <algorithm>
 #include <cstddef>  // for nullptr
 
 #include <glog/logging.h>
@@ -75,12 +76,12 @@ Histogram::~Histogram() {
 // Copy constructor.
 Histogram::Histogram(const Histogram& other) {
   n_images_ = other.n_images_;
+  dims_ = other.dims_;
   channels_ = new int[dims_];
   for (int i = 0; i < dims_; i++) {
     *(channels_ + i) = *(other.channels_ + i);
   }
   mask_ = other.mask_;
-  dims_ = other.dims_;
   hist_size_ = new int[dims_];
   for (int i = 0; i < dims_; i++) {
     *(hist_size_ + i) = *(other.hist_size_ + i);
@@ -94,6 +95,7 @@ Histogram::Histogram(const Histogram& other) {
   }
   uniform_ = other.uniform_;
   accumulate_ = other.accumulate_;
+  histogram_ = other.histogram_.clone();
 }
 
 // Copy assignment.
@@ -132,6 +134,7 @@ Histogram& Histogram::operator=(const Histogram& other) {
   ranges_ = tmp_ranges;
   uniform_ = other.uniform_;
   accumulate_ = other.accumulate_;
+  histogram_ = other.histogram_.clone();
 
   // Return this object.
   return *this;
@@ -140,11 +143,11 @@ Histogram& Histogram::operator=(const Histogram& other) {
 /* -------------------------------------------------------------------------- */
 void Histogram::calculateHistogram(const cv::Mat& input, bool log_histogram) {
   if (dims_ == 1) {
-    static const float* range_hist[] = {ranges_[0]};
+    const float* range_hist[] = {ranges_[0]};
     cv::calcHist(&input, n_images_, channels_, mask_, histogram_, dims_,
                  hist_size_, range_hist, uniform_, accumulate_);
   } else if (dims_ == 2) {
-    static const float* range_hist[] = {ranges_[0], ranges_[1]};
+    const float* range_hist[] = {ranges_[0], ranges_[1]};
     cv::calcHist(&input, n_images_, channels_, mask_, histogram_, dims_,
                  hist_size_, range_hist, uniform_, accumulate_);
   } else {
@@ -152,13 +155,48 @@ void Histogram::calculateHistogram(const cv::Mat& input, bool log_histogram) {
   }
 
   if (log_histogram) {
-    cv::FileStorage file("histogram_" + std::to_string(dims_) + ".yaml",
-                         cv::FileStorage::WRITE);
-    file << "Histogram";
-    file << histogram_;
+    logHistogram();
   }
 }
 
+/* -------------------------------------------------------------------------- */
+void Histogram::resetHistogram() {
+  CHECK_GT(dims_, 0) << "Histogram without dimensions.";
+  histogram_.create(dims_, hist_size_, CV_32F);
+  histogram_.setTo(cv::Scalar(0));
+}
+
+/* -------------------------------------------------------------------------- */
+void Histogram::addSample(const float* sample, const float& weight) {
+  CHECK_NOTNULL(sample);
+  CHECK(uniform_) << "Only uniform histograms can be updated per sample.";
+  CHECK(mask_.empty()) << "Masks are not supported per sample.";
+  CHECK_LE(dims_, 2) << "The histogram is not meant for dim: " << dims_;
+  if (histogram_.empty()) resetHistogram();
+
+  // Bin of each value, as cv::calcHist for uniform histograms.
+  int bin[2] = {0, 0};
+  for (int dim = 0; dim < dims_; dim++) {
+    const float& value = sample[dim];
+    const float& lower = ranges_[dim][0];
+    const float& upper = ranges_[dim][1];
+    if (!(value >= lower && value < upper)) return;
+    const double scale = hist_size_[dim] / (static_cast<double>(upper) - lower);
+    bin[dim] = std::min(std::max(cvFloor(value * scale - lower * scale), 0),
+                        hist_size_[dim] - 1);
+  }
+  // 1D histograms are hist_size x 1 matrices.
+  histogram_.at<float>(bin[0], bin[1]) += weight;
+}
+
+/* -------------------------------------------------------------------------- */
+void Histogram::logHistogram() const {
+  cv::FileStorage file("histogram_" + std::to_string(dims_) + ".yaml",
+                       cv::FileStorage::WRITE);
+  file << "Histogram";
+  file << histogram_;
+}
+
 /* -------------------------------------------------------------------------- */
 // void Histogram::print1DHistogram() {
 //  CHECK_EQ(dims_, 1);
@@ -0,0 +1,125 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   ImageBufferPool.cpp
+ * @brief  cv::Mat allocator recycling image buffers.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/utils/ImageBufferPool.h"
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+ImageBufferPool::ImageBufferPool(const size_t& max_nr_free_buffers)
+    : cv::MatAllocator(),
+      max_nr_free_buffers_(max_nr_free_buffers),
+      mutex_(),
+      free_buffers_(),
+      nr_allocated_buffers_(0u) {}
+
+ImageBufferPool::~ImageBufferPool() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& size_buffer : free_buffers_) {
+    cv::fastFree(size_buffer.second);
+  }
+  free_buffers_.clear();
+}
+
+ImageBufferPool& ImageBufferPool::getInstance() {
+  // Intentionally leaked: cv::Mats released during static destruction still
+  // need their allocator.
+  static ImageBufferPool* instance = new ImageBufferPool();
+  return *instance;
+}
+
+cv::UMatData* ImageBufferPool::allocate(int dims,
+                                        const int* sizes,
+                                        int type,
+                                        void* data0,
+                                        size_t* step,
+                                        cv::AccessFlag /*flags*/,
+                                        cv::UMatUsageFlags /*usage*/) const {
+  // Same layout as OpenCV's default allocator.
+  size_t total = CV_ELEM_SIZE(type);
+  for (int i = dims - 1; i >= 0; i--) {
+    if (step) {
+      if (data0 && step[i] != CV_AUTOSTEP) {
+        CHECK_GE(step[i], total);
+        total = step[i];
+      } else {
+        step[i] = total;
+      }
+    }
+    total *= sizes[i];
+  }
+
+  cv::UMatData* u = new cv::UMatData(this);
+  u->data = u->origdata =
+      data0 ? static_cast<uchar*>(data0) : acquireBuffer(total);
+  u->size = total;
+  if (data0) u->flags |= cv::UMatData::USER_ALLOCATED;
+  return u;
+}
+
+bool ImageBufferPool::allocate(cv::UMatData* u,
+                               cv::AccessFlag /*access_flags*/,
+                               cv::UMatUsageFlags /*usage_flags*/) const {
+  return u != nullptr;
+}
+
+void ImageBufferPool::deallocate(cv::UMatData* u) const {
+  if (!u) return;
+  CHECK_EQ(u->urefcount, 0);
+  CHECK_EQ(u->refcount, 0);
+  if (!(u->flags & cv::UMatData::USER_ALLOCATED)) {
+    releaseBuffer(u->origdata, u->size);
+    u->origdata = nullptr;
+  }
+  delete u;
+}
+
+size_t ImageBufferPool::getNrFreeBuffers() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return free_buffers_.size();
+}
+
+size_t ImageBufferPool::getNrAllocatedBuffers() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return nr_allocated_buffers_;
+}
+
+uchar* ImageBufferPool::acquireBuffer(const size_t& size) const {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = free_buffers_.find(size);
+    if (it != free_buffers_.end()) {
+      uchar* buffer = it->second;
+      free_buffers_.erase(it);
+      return buffer;
+    }
+    ++nr_allocated_buffers_;
+  }
+  return static_cast<uchar*>(cv::fastMalloc(size));
+}
+
+void ImageBufferPool::releaseBuffer(uchar* buffer, const size_t& size) const {
+  CHECK_NOTNULL(buffer);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_buffers_.size() < max_nr_free_buffers_) {
+      free_buffers_.emplace(size, buffer);
+      return;
+    }
+  }
+  cv::fastFree(buffer);
+}
+
+}  // namespace VIO
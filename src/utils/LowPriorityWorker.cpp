@@ -0,0 +1,104 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   LowPriorityWorker.cpp
+ * @brief  Thread running optional work (e.g. debug images) at low priority.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/utils/LowPriorityWorker.h"
+
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kimera-vio/utils/Threading.h"
+
+namespace VIO {
+
+namespace utils {
+
+LowPriorityWorker::LowPriorityWorker(const std::string& name,
+                                     const size_t& max_nr_queued_jobs)
+    : name_(name),
+      max_nr_queued_jobs_(max_nr_queued_jobs),
+      mutex_(),
+      jobs_cond_(),
+      idle_cond_(),
+      jobs_(),
+      is_running_job_(false),
+      shutdown_(false),
+      nr_dropped_jobs_(0u),
+      dropped_jobs_stats_(name + " Dropped Jobs [#]"),
+      thread_() {
+  CHECK_GT(max_nr_queued_jobs_, 0u);
+  // Started last, once all members are initialized.
+  thread_ = std::thread(&LowPriorityWorker::run, this);
+}
+
+LowPriorityWorker::~LowPriorityWorker() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  jobs_cond_.notify_one();
+  if (thread_.joinable()) thread_.join();
+  LOG_IF(WARNING, nr_dropped_jobs_ > 0u)
+      << name_ << " dropped " << nr_dropped_jobs_ << " jobs.";
+}
+
+bool LowPriorityWorker::addJob(Job job) {
+  CHECK(job);
+  std::unique_lock<std::mutex> lock(mutex_);
+  CHECK(!shutdown_);
+  if (jobs_.size() >= max_nr_queued_jobs_) {
+    ++nr_dropped_jobs_;
+    lock.unlock();
+    dropped_jobs_stats_.IncrementOne();
+    VLOG(5) << name_ << " is lagging behind, dropped a job.";
+    return false;
+  }
+  jobs_.push_back(std::move(job));
+  lock.unlock();
+  jobs_cond_.notify_one();
+  return true;
+}
+
+void LowPriorityWorker::waitUntilIdle() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_cond_.wait(lock, [this] { return jobs_.empty() && !is_running_job_; });
+}
+
+size_t LowPriorityWorker::getNrDroppedJobs() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return nr_dropped_jobs_;
+}
+
+void LowPriorityWorker::run() {
+  setCurrentThreadLowPriority();
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    jobs_cond_.wait(lock, [this] { return shutdown_ || !jobs_.empty(); });
+    if (jobs_.empty()) break;  // Shutdown, and the queue is drained.
+    Job job = std::move(jobs_.front());
+    jobs_.pop_front();
+    is_running_job_ = true;
+    lock.unlock();
+    job();
+    lock.lock();
+    is_running_job_ = false;
+    if (jobs_.empty()) idle_cond_.notify_all();
+  }
+  // Wake up waiters even if no job ever ran.
+  idle_cond_.notify_all();
+}
+
+}  // namespace utils
+
+}  // namespace VIO
@@ -0,0 +1,111 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   MappedFile.cpp
+ * @brief  Memory mapping of a whole file, and cv::Mat pointing inside it.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/utils/MappedFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+MappedFile::MappedFile(const std::string& filename)
+    : data_(nullptr), size_(0u) {
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  CHECK_GE(fd, 0) << "Could not open: " << filename;
+  struct stat file_stat;
+  CHECK_EQ(::fstat(fd, &file_stat), 0) << "Could not stat: " << filename;
+  size_ = static_cast<size_t>(file_stat.st_size);
+  CHECK_GT(size_, 0u) << "Empty file: " << filename;
+  void* data =
+      ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  CHECK(data != MAP_FAILED) << "Could not map: " << filename;
+  data_ = static_cast<uchar*>(data);
+}
+
+MappedFile::~MappedFile() {
+  if (data_) ::munmap(data_, size_);
+}
+
+namespace {
+
+/**
+ * Allocator of the cv::Mat pointing inside a mapping: their cv::UMatData
+ * holds a reference to the mapping, released with the last cv::Mat using it.
+ * New allocations (e.g. create() with another size) use OpenCV's default
+ * allocator.
+ */
+class MappedFileAllocator : public cv::MatAllocator {
+ public:
+  static const MappedFileAllocator& getInstance() {
+    // Never destroyed, so that the cv::Mat can be released at any time.
+    static const MappedFileAllocator* instance = new MappedFileAllocator();
+    return *instance;
+  }
+
+  cv::UMatData* allocate(int dims,
+                         const int* sizes,
+                         int type,
+                         void* data,
+                         size_t* step,
+                         cv::AccessFlag flags,
+                         cv::UMatUsageFlags usage_flags) const override {
+    return cv::Mat::getDefaultAllocator()->allocate(
+        dims, sizes, type, data, step, flags, usage_flags);
+  }
+
+  bool allocate(cv::UMatData* u,
+                cv::AccessFlag access_flags,
+                cv::UMatUsageFlags usage_flags) const override {
+    return cv::Mat::getDefaultAllocator()->allocate(
+        u, access_flags, usage_flags);
+  }
+
+  void deallocate(cv::UMatData* u) const override {
+    if (!u) return;
+    CHECK_EQ(u->urefcount, 0);
+    CHECK_EQ(u->refcount, 0);
+    delete static_cast<std::shared_ptr<const MappedFile>*>(u->userdata);
+    u->userdata = nullptr;
+    delete u;
+  }
+};
+
+}  // namespace
+
+cv::Mat wrapMappedFile(const std::shared_ptr<const MappedFile>& mapped_file,
+                       const size_t& offset,
+                       const int& rows,
+                       const int& cols,
+                       const int& type,
+                       const size_t& step) {
+  CHECK(mapped_file);
+  CHECK_LE(offset + step * static_cast<size_t>(rows), mapped_file->size());
+  uchar* data = mapped_file->data() + offset;
+  cv::Mat mat(rows, cols, type, data, step);
+  cv::UMatData* u = new cv::UMatData(&MappedFileAllocator::getInstance());
+  u->data = u->origdata = data;
+  u->size = step * static_cast<size_t>(rows);
+  u->flags |= cv::UMatData::USER_ALLOCATED;
+  u->userdata = new std::shared_ptr<const MappedFile>(mapped_file);
+  u->refcount = 1;
+  mat.u = u;
+  return mat;
+}
+
+}  // namespace VIO
@@ -0,0 +1,196 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   MemoryAccounting.cpp
+ * @brief  Bytes held by the major structures of each module, and high-water
+ * marks of the queues.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/utils/MemoryAccounting.h"
+
+#include <unistd.h>
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+DEFINE_bool(enable_memory_accounting,
+            false,
+            "Report the bytes held by the major structures of the modules "
+            "(frame cache, BoW database, smoother graph, mesh...) to the "
+            "statistics.");
+DEFINE_int32(memory_report_period_s,
+             60,
+             "Period of the memory report logged while the pipeline runs, if "
+             "enable_memory_accounting (0: only at shutdown).");
+
+namespace VIO {
+
+namespace utils {
+
+namespace {
+inline double toMegabytes(const size_t& bytes) {
+  return static_cast<double>(bytes) / 1.0e6;
+}
+}  // namespace
+
+bool isMemoryAccountingEnabled() { return FLAGS_enable_memory_accounting; }
+
+size_t getResidentSetBytes() {
+  // Second field, in pages.
+  std::ifstream statm("/proc/self/statm");
+  size_t nr_total_pages = 0u;
+  size_t nr_resident_pages = 0u;
+  if (!(statm >> nr_total_pages >> nr_resident_pages)) return 0u;
+  return nr_resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+/* -------------------------------------------------------------------------- */
+MemoryGauge::MemoryGauge(const std::string& tag)
+    : tag_(tag),
+      bytes_(0u),
+      peak_bytes_(0u),
+      stats_("Memory " + tag + " [MB]") {
+  MemoryAccounting::getInstance().registerGauge(this);
+}
+
+MemoryGauge::~MemoryGauge() {
+  MemoryAccounting::getInstance().unregisterGauge(this);
+}
+
+void MemoryGauge::set(const size_t& bytes) {
+  bytes_ = bytes;
+  size_t peak_bytes = peak_bytes_;
+  while (bytes > peak_bytes &&
+         !peak_bytes_.compare_exchange_weak(peak_bytes, bytes)) {
+  }
+  stats_.AddSample(toMegabytes(bytes));
+}
+
+/* -------------------------------------------------------------------------- */
+MemoryAccounting& MemoryAccounting::getInstance() {
+  static MemoryAccounting instance;
+  return instance;
+}
+
+void MemoryAccounting::registerGauge(const MemoryGauge* gauge) {
+  CHECK_NOTNULL(gauge);
+  std::lock_guard<std::mutex> lock(mutex_);
+  gauges_.emplace(gauge->getTag(), gauge);
+}
+
+void MemoryAccounting::unregisterGauge(const MemoryGauge* gauge) {
+  CHECK_NOTNULL(gauge);
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto range = gauges_.equal_range(gauge->getTag());
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second == gauge) {
+      gauges_.erase(it);
+      return;
+    }
+  }
+  LOG(DFATAL) << "Memory gauge not registered: " << gauge->getTag();
+}
+
+size_t MemoryAccounting::registerQueue(
+    const std::string& queue_id,
+    const HighWaterMarkCallback& high_water_mark) {
+  CHECK(high_water_mark);
+  std::lock_guard<std::mutex> lock(mutex_);
+  const size_t id = next_queue_id_++;
+  queues_[id] = Queue{queue_id, high_water_mark};
+  return id;
+}
+
+void MemoryAccounting::unregisterQueue(const size_t& id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  queues_.erase(id);
+}
+
+MemoryReport MemoryAccounting::getReport() const {
+  MemoryReport report;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto it = gauges_.begin(); it != gauges_.end();) {
+    // Gauges with the same tag (e.g. one per pipeline) are summed.
+    MemoryReport::Gauge gauge{it->first, 0u, 0u};
+    for (; it != gauges_.end() && it->first == gauge.tag; ++it) {
+      gauge.bytes += it->second->get();
+      gauge.peak_bytes += it->second->getPeak();
+    }
+    report.gauges.push_back(gauge);
+  }
+  for (const auto& queue : queues_) {
+    report.queues.push_back(
+        {queue.second.queue_id, queue.second.high_water_mark()});
+  }
+  report.resident_set_bytes = getResidentSetBytes();
+  return report;
+}
+
+std::string MemoryAccounting::print() const {
+  const MemoryReport report = getReport();
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(2);
+  ss << "Memory [MB]\tcurrent\tpeak\n";
+  size_t total_bytes = 0u;
+  for (const MemoryReport::Gauge& gauge : report.gauges) {
+    total_bytes += gauge.bytes;
+    ss << gauge.tag << "\t" << toMegabytes(gauge.bytes) << "\t"
+       << toMegabytes(gauge.peak_bytes) << "\n";
+  }
+  ss << "Total accounted\t" << toMegabytes(total_bytes) << "\n";
+  ss << "Resident set\t" << toMegabytes(report.resident_set_bytes) << "\n";
+  ss << "Queue high-water marks [#]\n";
+  for (const MemoryReport::Queue& queue : report.queues) {
+    ss << queue.queue_id << "\t" << queue.high_water_mark << "\n";
+  }
+  return ss.str();
+}
+
+/* -------------------------------------------------------------------------- */
+MemoryReporter::MemoryReporter(const std::chrono::seconds& period)
+    : period_(period),
+      mutex_(),
+      shutdown_cond_(),
+      shutdown_(false),
+      resident_set_stats_("Memory resident set [MB]"),
+      thread_(&MemoryReporter::run, this) {}
+
+MemoryReporter::~MemoryReporter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  shutdown_cond_.notify_all();
+  thread_.join();
+  resident_set_stats_.AddSample(toMegabytes(getResidentSetBytes()));
+  LOG(INFO) << MemoryAccounting::getInstance().print();
+}
+
+void MemoryReporter::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!shutdown_) {
+    if (period_.count() > 0) {
+      shutdown_cond_.wait_for(lock, period_, [this] { return shutdown_; });
+    } else {
+      shutdown_cond_.wait(lock, [this] { return shutdown_; });
+    }
+    if (shutdown_) break;
+    resident_set_stats_.AddSample(toMegabytes(getResidentSetBytes()));
+    LOG(INFO) << MemoryAccounting::getInstance().print();
+  }
+}
+
+}  // namespace utils
+
+}  // namespace VIO
@@ -0,0 +1,321 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   MetricsExporter.cpp
+ * @brief  Serves the statistics and memory counters to Prometheus over HTTP.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/utils/MetricsExporter.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kimera-vio/utils/MemoryAccounting.h"
+#include "kimera-vio/utils/Statistics.h"
+
+DEFINE_int32(metrics_port,
+             -1,
+             "Port of the HTTP endpoint serving the statistics and memory "
+             "counters in Prometheus format while the pipeline runs (-1: "
+             "disabled, 0: any free port).");
+
+namespace VIO {
+
+namespace utils {
+
+namespace {
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+//! Period at which the server thread checks for shutdown.
+constexpr int kPollPeriodMs = 100;
+//! Slow or silent clients are disconnected after this.
+constexpr int kClientTimeoutS = 2;
+//! Longer requests are not ours.
+constexpr size_t kMaxRequestSize = 8192u;
+
+//! Label values are quoted: backslashes, quotes and newlines are escaped.
+std::string escapeLabel(const std::string& value) {
+  std::string escaped;
+  escaped.reserve(value.size());
+  for (const char& c : value) {
+    switch (c) {
+      case '\\':
+        escaped += "\\\\";
+        break;
+      case '"':
+        escaped += "\\\"";
+        break;
+      case '\n':
+        escaped += "\\n";
+        break;
+      default:
+        escaped += c;
+    }
+  }
+  return escaped;
+}
+
+std::string printValue(const double& value) {
+  if (std::isnan(value)) return "NaN";
+  if (std::isinf(value)) return value > 0.0 ? "+Inf" : "-Inf";
+  std::stringstream ss;
+  ss << std::setprecision(15) << value;
+  return ss.str();
+}
+
+void printHeader(const std::string& name,
+                 const std::string& type,
+                 const std::string& help,
+                 std::stringstream* ss) {
+  *ss << "# HELP " << name << " " << help << "\n"
+      << "# TYPE " << name << " " << type << "\n";
+}
+
+void sendAll(const int& socket_fd, const std::string& data) {
+  size_t sent_size = 0u;
+  while (sent_size < data.size()) {
+    const ssize_t size = send(socket_fd,
+                              data.data() + sent_size,
+                              data.size() - sent_size,
+                              kSendFlags);
+    if (size < 0) {
+      if (errno == EINTR) continue;
+      VLOG(1) << "Metrics client disconnected: " << std::strerror(errno);
+      return;
+    }
+    sent_size += static_cast<size_t>(size);
+  }
+}
+}  // namespace
+
+MetricsExporter::MetricsExporter(const int& port)
+    : server_fd_(-1), port_(port), shutdown_(false), thread_() {
+  CHECK_GE(port_, 0);
+  server_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  CHECK_GE(server_fd_, 0) << "Cannot create the metrics socket: "
+                          << std::strerror(errno);
+  const int enable = 1;
+  setsockopt(server_fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+  sockaddr_in address;
+  std::memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(static_cast<uint16_t>(port_));
+  CHECK_EQ(bind(server_fd_,
+                reinterpret_cast<const sockaddr*>(&address),
+                sizeof(address)),
+           0)
+      << "Cannot bind the metrics socket to port " << port_ << ": "
+      << std::strerror(errno);
+  CHECK_EQ(listen(server_fd_, 4), 0) << std::strerror(errno);
+
+  socklen_t address_size = sizeof(address);
+  CHECK_EQ(getsockname(server_fd_,
+                       reinterpret_cast<sockaddr*>(&address),
+                       &address_size),
+           0);
+  port_ = ntohs(address.sin_port);
+  LOG(INFO) << "Serving the metrics at http://localhost:" << port_
+            << "/metrics";
+  thread_ = std::thread(&MetricsExporter::run, this);
+}
+
+MetricsExporter::~MetricsExporter() {
+  shutdown_ = true;
+  thread_.join();
+  close(server_fd_);
+}
+
+std::string MetricsExporter::printMetrics() {
+  const std::vector<StatisticSnapshot> statistics = Statistics::GetSnapshot();
+  const MemoryReport memory = MemoryAccounting::getInstance().getReport();
+
+  std::stringstream ss;
+  printHeader("kimera_vio_statistic",
+              "summary",
+              "Samples of the statistic tag since the start.",
+              &ss);
+  for (const StatisticSnapshot& statistic : statistics) {
+    const std::string label = "tag=\"" + escapeLabel(statistic.tag) + "\"";
+    for (size_t i = 0u; i < Statistics::kSnapshotQuantiles.size(); ++i) {
+      ss << "kimera_vio_statistic{" << label << ",quantile=\""
+         << printValue(Statistics::kSnapshotQuantiles[i]) << "\"} "
+         << printValue(statistic.quantiles[i]) << "\n";
+    }
+    ss << "kimera_vio_statistic_sum{" << label << "} "
+       << printValue(statistic.sum) << "\n";
+    ss << "kimera_vio_statistic_count{" << label << "} "
+       << statistic.num_samples << "\n";
+  }
+
+  // Gauges of the statistics, e.g. the current depth of a queue.
+  const auto print_statistics_gauge =
+      [&ss, &statistics](const std::string& name,
+                         const std::string& help,
+                         double StatisticSnapshot::*value) {
+        printHeader(name, "gauge", help, &ss);
+        for (const StatisticSnapshot& statistic : statistics) {
+          ss << name << "{tag=\"" << escapeLabel(statistic.tag) << "\"} "
+             << printValue(statistic.*value) << "\n";
+        }
+      };
+  print_statistics_gauge("kimera_vio_statistic_last",
+                         "Last sample of the statistic tag.",
+                         &StatisticSnapshot::last);
+  print_statistics_gauge("kimera_vio_statistic_min",
+                         "Min sample of the statistic tag.",
+                         &StatisticSnapshot::min);
+  print_statistics_gauge("kimera_vio_statistic_max",
+                         "Max sample of the statistic tag.",
+                         &StatisticSnapshot::max);
+  printHeader("kimera_vio_statistic_rate_hz",
+              "gauge",
+              "Mean rate of the samples of the statistic tag.",
+              &ss);
+  for (const StatisticSnapshot& statistic : statistics) {
+    // Negative if unknown, e.g. with a single sample.
+    if (statistic.hz < 0.0) continue;
+    ss << "kimera_vio_statistic_rate_hz{tag=\"" << escapeLabel(statistic.tag)
+       << "\"} " << printValue(statistic.hz) << "\n";
+  }
+
+  printHeader("kimera_vio_memory_bytes",
+              "gauge",
+              "Bytes held by the structures tag (enable_memory_accounting).",
+              &ss);
+  for (const MemoryReport::Gauge& gauge : memory.gauges) {
+    ss << "kimera_vio_memory_bytes{tag=\"" << escapeLabel(gauge.tag) << "\"} "
+       << gauge.bytes << "\n";
+  }
+  printHeader("kimera_vio_memory_peak_bytes",
+              "gauge",
+              "Peak bytes held by the structures tag.",
+              &ss);
+  for (const MemoryReport::Gauge& gauge : memory.gauges) {
+    ss << "kimera_vio_memory_peak_bytes{tag=\"" << escapeLabel(gauge.tag)
+       << "\"} " << gauge.peak_bytes << "\n";
+  }
+  printHeader("kimera_vio_queue_high_water_mark",
+              "gauge",
+              "Max nr of values the queue ever held.",
+              &ss);
+  for (const MemoryReport::Queue& queue : memory.queues) {
+    ss << "kimera_vio_queue_high_water_mark{queue=\""
+       << escapeLabel(queue.queue_id) << "\"} " << queue.high_water_mark
+       << "\n";
+  }
+  printHeader("kimera_vio_resident_set_bytes",
+              "gauge",
+              "Resident set size of the process.",
+              &ss);
+  ss << "kimera_vio_resident_set_bytes " << memory.resident_set_bytes << "\n";
+  return ss.str();
+}
+
+void MetricsExporter::run() {
+  pollfd server_poll;
+  server_poll.fd = server_fd_;
+  server_poll.events = POLLIN;
+  while (!shutdown_) {
+    server_poll.revents = 0;
+    const int nr_ready = poll(&server_poll, 1, kPollPeriodMs);
+    if (nr_ready < 0) {
+      LOG_IF(ERROR, errno != EINTR)
+          << "Cannot poll the metrics socket: " << std::strerror(errno);
+      continue;
+    }
+    if (nr_ready == 0) continue;
+    const int socket_fd = accept(server_fd_, nullptr, nullptr);
+    if (socket_fd < 0) {
+      LOG(WARNING) << "Cannot accept metrics client: " << std::strerror(errno);
+      continue;
+    }
+    serve(socket_fd);
+    close(socket_fd);
+  }
+}
+
+void MetricsExporter::serve(const int& socket_fd) const {
+  timeval timeout;
+  timeout.tv_sec = kClientTimeoutS;
+  timeout.tv_usec = 0;
+  setsockopt(socket_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(socket_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+#ifdef SO_NOSIGPIPE
+  const int enable = 1;
+  setsockopt(socket_fd, SOL_SOCKET, SO_NOSIGPIPE, &enable, sizeof(enable));
+#endif
+
+  // Only the request line matters, but the headers are read until their end
+  // so that the client does not get a reset before the response.
+  std::string request;
+  char buffer[1024];
+  while (request.find("\r\n\r\n") == std::string::npos &&
+         request.size() < kMaxRequestSize) {
+    const ssize_t size = recv(socket_fd, buffer, sizeof(buffer), 0);
+    if (size < 0 && errno == EINTR) continue;
+    if (size <= 0) break;
+    request.append(buffer, static_cast<size_t>(size));
+  }
+
+  const std::string request_line = request.substr(0u, request.find("\r\n"));
+  std::istringstream request_stream(request_line);
+  std::string method;
+  std::string target;
+  request_stream >> method >> target;
+  // Prometheus may add parameters to the path.
+  target = target.substr(0u, target.find('?'));
+
+  std::string response;
+  if (method == "GET" && target == "/metrics") {
+    const std::string body = printMetrics();
+    response =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+        "Content-Length: " +
+        std::to_string(body.size()) +
+        "\r\n"
+        "Connection: close\r\n\r\n" +
+        body;
+  } else {
+    const std::string body = "Only GET /metrics is served.\n";
+    response =
+        "HTTP/1.1 404 Not Found\r\n"
+        "Content-Type: text/plain; charset=utf-8\r\n"
+        "Content-Length: " +
+        std::to_string(body.size()) +
+        "\r\n"
+        "Connection: close\r\n\r\n" +
+        body;
+  }
+  sendAll(socket_fd, response);
+}
+
+}  // namespace utils
+
+}  // namespace VIO
@@ -0,0 +1,214 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   PerfCounters.cpp
+ * @brief  Hardware performance counters of the scopes of the pipeline.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/utils/PerfCounters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+DEFINE_bool(enable_perf_counters,
+            false,
+            "Sample the hardware performance counters (cycles, instructions, "
+            "LLC misses, branch misses, context switches) of each pipeline "
+            "module spin and of the major stages, to the statistics and to "
+            "the trace. Linux only, see perf_event_paranoid.");
+
+namespace VIO {
+
+namespace utils {
+
+namespace {
+/**
+ * @brief The ThreadCounters class is the group of counters of one thread:
+ * read at once, so that their counts cover the same instructions.
+ */
+class ThreadCounters {
+ public:
+  ThreadCounters() : fds_(), counters_() {
+#ifdef __linux__
+    for (size_t i = 0u; i < PerfCounters::kNumCounters; ++i) {
+      const auto counter = static_cast<PerfCounters::Counter>(i);
+      const int fd = open(counter);
+      if (fd < 0) continue;
+      fds_.push_back(fd);
+      counters_.push_back(counter);
+    }
+#endif
+  }
+
+  ~ThreadCounters() {
+#ifdef __linux__
+    for (const int& fd : fds_) close(fd);
+#endif
+  }
+
+  bool read(PerfCounters::Values* values) const {
+    CHECK_NOTNULL(values)->counts.fill(0u);
+    values->available.fill(false);
+#ifdef __linux__
+    if (fds_.empty()) return false;
+    // Group read format: the nr of counters, then their values.
+    uint64_t buffer[PerfCounters::kNumCounters + 1u];
+    const ssize_t size = ::read(fds_.front(), buffer, sizeof(buffer));
+    if (size < static_cast<ssize_t>((counters_.size() + 1u) *
+                                    sizeof(uint64_t))) {
+      return false;
+    }
+    for (size_t i = 0u; i < counters_.size(); ++i) {
+      values->counts[counters_[i]] = buffer[i + 1u];
+      values->available[counters_[i]] = true;
+    }
+    return true;
+#else
+    return false;
+#endif
+  }
+
+ private:
+#ifdef __linux__
+  //! @return The fd of the counter for the calling thread, < 0 if none.
+  int open(const PerfCounters::Counter& counter) const {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    switch (counter) {
+      case PerfCounters::kCycles:
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+      case PerfCounters::kInstructions:
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+      case PerfCounters::kLlcMisses:
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+      case PerfCounters::kBranchMisses:
+        attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+      case PerfCounters::kContextSwitches:
+        attr.type = PERF_TYPE_SOFTWARE;
+        attr.config = PERF_COUNT_SW_CONTEXT_SWITCHES;
+        break;
+      default:
+        LOG(FATAL) << "Unknown performance counter: " << counter;
+    }
+    attr.read_format = PERF_FORMAT_GROUP;
+    const int group_fd = fds_.empty() ? -1 : fds_.front();
+    // The kernel may only let the user space be counted.
+    for (const bool exclude_kernel : {false, true}) {
+      attr.exclude_kernel = exclude_kernel ? 1u : 0u;
+      attr.exclude_hv = attr.exclude_kernel;
+      // This thread, on any CPU.
+      const long fd =
+          syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+      if (fd >= 0) return static_cast<int>(fd);
+    }
+    VLOG(1) << "Performance counter " << PerfCounters::getName(counter)
+            << " unavailable: " << std::strerror(errno);
+    return -1;
+  }
+#endif
+
+ private:
+  //! The first one is the group leader.
+  std::vector<int> fds_;
+  //! Counter of each fd.
+  std::vector<PerfCounters::Counter> counters_;
+};
+}  // namespace
+
+bool isPerfCountingEnabled() { return FLAGS_enable_perf_counters; }
+
+const char* PerfCounters::getName(const Counter& counter) {
+  switch (counter) {
+    case kCycles:
+      return "cycles";
+    case kInstructions:
+      return "instructions";
+    case kLlcMisses:
+      return "LLC misses";
+    case kBranchMisses:
+      return "branch misses";
+    case kContextSwitches:
+      return "context switches";
+    default:
+      LOG(FATAL) << "Unknown performance counter: " << counter;
+      return "";
+  }
+}
+
+bool PerfCounters::read(Values* values) {
+  thread_local const ThreadCounters thread_counters;
+  if (thread_counters.read(values)) return true;
+  static std::atomic_bool warned(false);
+  LOG_IF(WARNING, !warned.exchange(true))
+      << "No performance counter available: enable_perf_counters samples "
+         "nothing (see /proc/sys/kernel/perf_event_paranoid).";
+  return false;
+}
+
+/* -------------------------------------------------------------------------- */
+PerfCounterStats::PerfCounterStats(const std::string& name)
+    : name_(name), registered_(), handles_(), trace_names_() {}
+
+void PerfCounterStats::addSample(const PerfCounters::Values& counts,
+                                 const int64_t& time_ns) {
+  std::call_once(registered_, [this]() {
+    for (size_t i = 0u; i < PerfCounters::kNumCounters; ++i) {
+      const std::string counter_name =
+          name_ + " " +
+          PerfCounters::getName(static_cast<PerfCounters::Counter>(i));
+      handles_[i] = Statistics::GetHandle(counter_name + " [#]");
+      trace_names_[i] = Tracer::internName(counter_name);
+    }
+  });
+  for (size_t i = 0u; i < PerfCounters::kNumCounters; ++i) {
+    if (!counts.available[i]) continue;
+    const double count = static_cast<double>(counts.counts[i]);
+    StatsCollector(handles_[i]).AddSample(count);
+    Tracer::recordCounter(trace_names_[i], time_ns, count);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+PerfScope::PerfScope(PerfCounterStats* stats)
+    : stats_(isPerfCountingEnabled() ? CHECK_NOTNULL(stats) : nullptr),
+      begin_() {
+  if (stats_ && !PerfCounters::read(&begin_)) stats_ = nullptr;
+}
+
+PerfScope::~PerfScope() {
+  if (!stats_) return;
+  PerfCounters::Values end;
+  if (!PerfCounters::read(&end)) return;
+  for (size_t i = 0u; i < PerfCounters::kNumCounters; ++i) {
+    end.counts[i] -= begin_.counts[i];
+  }
+  stats_->addSample(end, Tracer::now());
+}
+
+}  // namespace utils
+
+}  // namespace VIO
@@ -0,0 +1,97 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   QueueInstrumentation.cpp
+ * @brief  Rates, depth and wait times of a queue, exported to the statistics
+ * and to the trace.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/utils/QueueInstrumentation.h"
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+DEFINE_bool(instrument_queues,
+            false,
+            "Record the push/pop rates, depth, time in queue and blocked "
+            "producer/consumer times of the pipeline queues to the "
+            "statistics, and to the trace if enabled.");
+
+namespace VIO {
+
+namespace utils {
+
+constexpr int64_t QueueInstrumentation::kNotWaited;
+
+namespace {
+inline double toMilliseconds(const int64_t& duration_ns) {
+  return static_cast<double>(duration_ns) * 1.0e-6;
+}
+}  // namespace
+
+bool isQueueInstrumentationEnabled() { return FLAGS_instrument_queues; }
+
+/* -------------------------------------------------------------------------- */
+QueueInstrumentation::QueueInstrumentation(const std::string& queue_id)
+    : depth_trace_name_(Tracer::internName(queue_id + " depth")),
+      push_blocked_trace_name_(Tracer::internName(queue_id + " push blocked")),
+      pop_wait_trace_name_(Tracer::internName(queue_id + " pop wait")),
+      nr_pushes_(0u),
+      nr_pops_(0u),
+      max_depth_(0u),
+      push_blocked_stats_(queue_id + " Push blocked [ms]"),
+      pop_wait_stats_(queue_id + " Pop wait [ms]"),
+      time_in_queue_stats_(queue_id + " Time in queue [ms]"),
+      depth_stats_(queue_id + " Depth [#]") {}
+
+void QueueInstrumentation::onPush(const size_t& depth,
+                                  const int64_t& push_ns,
+                                  const int64_t& blocked_since_ns) {
+  ++nr_pushes_;
+  if (blocked_since_ns == kNotWaited) {
+    push_blocked_stats_.AddSample(0.0);
+  } else {
+    DCHECK_LE(blocked_since_ns, push_ns);
+    push_blocked_stats_.AddSample(toMilliseconds(push_ns - blocked_since_ns));
+    Tracer::record(push_blocked_trace_name_, blocked_since_ns, push_ns);
+  }
+  updateDepth(depth, push_ns);
+}
+
+void QueueInstrumentation::onPop(const size_t& depth,
+                                 const int64_t& pushed_ns,
+                                 const int64_t& waiting_since_ns) {
+  ++nr_pops_;
+  const int64_t pop_ns = now();
+  DCHECK_LE(pushed_ns, pop_ns);
+  time_in_queue_stats_.AddSample(toMilliseconds(pop_ns - pushed_ns));
+  if (waiting_since_ns == kNotWaited) {
+    pop_wait_stats_.AddSample(0.0);
+  } else {
+    pop_wait_stats_.AddSample(toMilliseconds(pop_ns - waiting_since_ns));
+    Tracer::record(pop_wait_trace_name_, waiting_since_ns, pop_ns);
+  }
+  updateDepth(depth, pop_ns);
+}
+
+void QueueInstrumentation::updateDepth(const size_t& depth,
+                                       const int64_t& time_ns) {
+  size_t max_depth = max_depth_;
+  while (depth > max_depth &&
+         !max_depth_.compare_exchange_weak(max_depth, depth)) {
+  }
+  depth_stats_.AddSample(static_cast<double>(depth));
+  Tracer::recordCounter(
+      depth_trace_name_, time_ns, static_cast<double>(depth));
+}
+
+}  // namespace utils
+
+}  // namespace VIO
@@ -0,0 +1,659 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   SimdKernels.cpp
+ * @brief  Registry of the vectorized kernels, with one implementation per
+ * instruction set, selected at run time for the CPU.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/utils/SimdKernels.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+#include <gflags/gflags.h>
+
+// x86 kernels are compiled with function target attributes: they are part of
+// any x86-64 build, and only called if the CPU supports them.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define KIMERA_X86_KERNELS
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define KIMERA_NEON_KERNELS
+#include <arm_neon.h>
+#endif
+
+DEFINE_bool(disable_simd_kernels,
+            false,
+            "Use the scalar reference of each vectorized kernel, whatever the "
+            "CPU supports.");
+
+namespace VIO {
+
+namespace utils {
+
+namespace {
+
+constexpr int kDescriptorBytes = 32;
+
+/* -------------------------------------------------------------------------- */
+uint32_t ssdRowScalar(const uint8_t* a, const uint8_t* b, int n) {
+  uint32_t ssd = 0u;
+  for (int i = 0; i < n; ++i) {
+    const int diff = static_cast<int>(a[i]) - static_cast<int>(b[i]);
+    ssd += static_cast<uint32_t>(diff * diff);
+  }
+  return ssd;
+}
+
+uint32_t dotRowScalar(const uint8_t* a, const uint8_t* b, int n) {
+  uint32_t dot = 0u;
+  for (int i = 0; i < n; ++i) {
+    dot += static_cast<uint32_t>(a[i]) * static_cast<uint32_t>(b[i]);
+  }
+  return dot;
+}
+
+uint32_t orbHammingDistanceScalar(const uint8_t* a, const uint8_t* b) {
+  uint32_t distance = 0u;
+  for (int i = 0; i < kDescriptorBytes; i += 8) {
+    uint64_t wa;
+    uint64_t wb;
+    std::memcpy(&wa, a + i, sizeof(wa));
+    std::memcpy(&wb, b + i, sizeof(wb));
+    distance += static_cast<uint32_t>(__builtin_popcountll(wa ^ wb));
+  }
+  return distance;
+}
+
+void depthRowToPointsScalar(const float* depth,
+                            const float* ray_x,
+                            float ray_y,
+                            int n,
+                            float* xyz) {
+  static constexpr float kNaN = std::numeric_limits<float>::quiet_NaN();
+  for (int i = 0; i < n; ++i) {
+    const float d = depth[i];
+    float* point = xyz + 3 * i;
+    if (std::isfinite(d)) {
+      point[0] = ray_x[i] * d;
+      point[1] = ray_y * d;
+      point[2] = d;
+    } else {
+      point[0] = kNaN;
+      point[1] = kNaN;
+      point[2] = kNaN;
+    }
+  }
+}
+
+//! Fixed-point iterations of the radial undistortion.
+constexpr int kUndistortIterations = 8;
+
+inline bool isDistorted(const PointWarp& warp) {
+  return warp.k1 != 0.0f || warp.k2 != 0.0f;
+}
+
+void warpPointsScalar(const float* src_xy,
+                      const PointWarp& warp,
+                      int n,
+                      float* dst_xy) {
+  const float* H = warp.H;
+  const bool distorted = isDistorted(warp);
+  for (int i = 0; i < n; ++i) {
+    const float u = src_xy[2 * i];
+    const float v = src_xy[2 * i + 1];
+    float x = u;
+    float y = v;
+    if (distorted) {
+      const float xd = (u - warp.cx) / warp.fx;
+      const float yd = (v - warp.cy) / warp.fy;
+      x = xd;
+      y = yd;
+      for (int k = 0; k < kUndistortIterations; ++k) {
+        const float r2 = x * x + y * y;
+        const float factor = 1.0f + r2 * (warp.k1 + r2 * warp.k2);
+        x = xd / factor;
+        y = yd / factor;
+      }
+    }
+    const float w = H[6] * x + H[7] * y + H[8];
+    float x2 = (H[0] * x + H[1] * y + H[2]) / w;
+    float y2 = (H[3] * x + H[4] * y + H[5]) / w;
+    if (distorted) {
+      const float r2 = x2 * x2 + y2 * y2;
+      const float factor = 1.0f + r2 * (warp.k1 + r2 * warp.k2);
+      x2 = warp.fx * (x2 * factor) + warp.cx;
+      y2 = warp.fy * (y2 * factor) + warp.cy;
+    }
+    // NaNs fail the comparisons as well.
+    const bool valid = w > 0.0f && x2 >= 0.0f && x2 < warp.width &&
+                       y2 >= 0.0f && y2 < warp.height;
+    dst_xy[2 * i] = valid ? x2 : u;
+    dst_xy[2 * i + 1] = valid ? y2 : v;
+  }
+}
+
+#if defined(KIMERA_X86_KERNELS)
+/* -------------------------------------------------------------------------- */
+__attribute__((target("avx2"))) uint32_t ssdRowAvx2(const uint8_t* a,
+                                                     const uint8_t* b,
+                                                     int n) {
+  int i = 0;
+  __m256i acc = _mm256_setzero_si256();
+  for (; i + 16 <= n; i += 16) {
+    const __m256i a16 = _mm256_cvtepu8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+    const __m256i b16 = _mm256_cvtepu8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+    const __m256i diff = _mm256_sub_epi16(a16, b16);
+    acc = _mm256_add_epi32(acc, _mm256_madd_epi16(diff, diff));
+  }
+  __m128i acc128 = _mm_add_epi32(_mm256_castsi256_si128(acc),
+                                 _mm256_extracti128_si256(acc, 1));
+  acc128 = _mm_hadd_epi32(acc128, acc128);
+  acc128 = _mm_hadd_epi32(acc128, acc128);
+  return static_cast<uint32_t>(_mm_cvtsi128_si32(acc128)) +
+         ssdRowScalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2"))) uint32_t dotRowAvx2(const uint8_t* a,
+                                                     const uint8_t* b,
+                                                     int n) {
+  int i = 0;
+  __m256i acc = _mm256_setzero_si256();
+  for (; i + 16 <= n; i += 16) {
+    const __m256i a16 = _mm256_cvtepu8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+    const __m256i b16 = _mm256_cvtepu8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+    acc = _mm256_add_epi32(acc, _mm256_madd_epi16(a16, b16));
+  }
+  __m128i acc128 = _mm_add_epi32(_mm256_castsi256_si128(acc),
+                                 _mm256_extracti128_si256(acc, 1));
+  acc128 = _mm_hadd_epi32(acc128, acc128);
+  acc128 = _mm_hadd_epi32(acc128, acc128);
+  return static_cast<uint32_t>(_mm_cvtsi128_si32(acc128)) +
+         dotRowScalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2,avx512vl,avx512vpopcntdq"))) uint32_t
+orbHammingDistanceAvx512(const uint8_t* a, const uint8_t* b) {
+  const __m256i x =
+      _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a)),
+                       _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b)));
+  const __m256i counts = _mm256_popcnt_epi64(x);
+  const __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(counts),
+                                    _mm256_extracti128_si256(counts, 1));
+  return static_cast<uint32_t>(_mm_cvtsi128_si64(sum) +
+                               _mm_extract_epi64(sum, 1));
+}
+
+__attribute__((target("popcnt"))) uint32_t orbHammingDistancePopcnt(
+    const uint8_t* a,
+    const uint8_t* b) {
+  uint64_t wa[4];
+  uint64_t wb[4];
+  std::memcpy(wa, a, kDescriptorBytes);
+  std::memcpy(wb, b, kDescriptorBytes);
+  return static_cast<uint32_t>(_mm_popcnt_u64(wa[0] ^ wb[0]) +
+                               _mm_popcnt_u64(wa[1] ^ wb[1]) +
+                               _mm_popcnt_u64(wa[2] ^ wb[2]) +
+                               _mm_popcnt_u64(wa[3] ^ wb[3]));
+}
+
+__attribute__((target("avx2"))) uint32_t orbHammingDistanceAvx2(
+    const uint8_t* a,
+    const uint8_t* b) {
+  // Nibble lookup table (for CPUs without POPCNT).
+  const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3,
+                                          2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3,
+                                          1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_mask = _mm256_set1_epi8(0x0f);
+  const __m256i x =
+      _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a)),
+                       _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b)));
+  const __m256i counts = _mm256_add_epi8(
+      _mm256_shuffle_epi8(lookup, _mm256_and_si256(x, low_mask)),
+      _mm256_shuffle_epi8(lookup,
+                          _mm256_and_si256(_mm256_srli_epi16(x, 4), low_mask)));
+  const __m256i sums = _mm256_sad_epu8(counts, _mm256_setzero_si256());
+  return static_cast<uint32_t>(
+      _mm256_extract_epi64(sums, 0) + _mm256_extract_epi64(sums, 1) +
+      _mm256_extract_epi64(sums, 2) + _mm256_extract_epi64(sums, 3));
+}
+
+__attribute__((target("avx2"))) void depthRowToPointsAvx2(const float* depth,
+                                                          const float* ray_x,
+                                                          float ray_y,
+                                                          int n,
+                                                          float* xyz) {
+  const __m256 nan = _mm256_set1_ps(std::numeric_limits<float>::quiet_NaN());
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 ray_y8 = _mm256_set1_ps(ray_y);
+  // Interleaving of 8 points (x, y, z) in 3 registers:
+  // x0 y0 z0 x1 y1 z1 x2 y2 | z2 x3 y3 z3 x4 y4 z4 x5 | y5 z5 x6 y6 z6 x7 y7 z7
+  const __m256i idx_x0 = _mm256_setr_epi32(0, 0, 0, 1, 0, 0, 2, 0);
+  const __m256i idx_y0 = _mm256_setr_epi32(0, 0, 0, 0, 1, 0, 0, 2);
+  const __m256i idx_z0 = _mm256_setr_epi32(0, 0, 0, 0, 0, 1, 0, 0);
+  const __m256i idx_x1 = _mm256_setr_epi32(0, 3, 0, 0, 4, 0, 0, 5);
+  const __m256i idx_y1 = _mm256_setr_epi32(0, 0, 3, 0, 0, 4, 0, 0);
+  const __m256i idx_z1 = _mm256_setr_epi32(2, 0, 0, 3, 0, 0, 4, 0);
+  const __m256i idx_x2 = _mm256_setr_epi32(0, 0, 6, 0, 0, 7, 0, 0);
+  const __m256i idx_y2 = _mm256_setr_epi32(5, 0, 0, 6, 0, 0, 7, 0);
+  const __m256i idx_z2 = _mm256_setr_epi32(0, 5, 0, 0, 6, 0, 0, 7);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m256 d = _mm256_loadu_ps(depth + i);
+    // d - d is 0 for finite depths, NaN otherwise.
+    const __m256 valid =
+        _mm256_cmp_ps(_mm256_sub_ps(d, d), zero, _CMP_EQ_OQ);
+    const __m256 z = _mm256_blendv_ps(nan, d, valid);
+    const __m256 x = _mm256_mul_ps(_mm256_loadu_ps(ray_x + i), z);
+    const __m256 y = _mm256_mul_ps(ray_y8, z);
+    const __m256 out0 = _mm256_blend_ps(
+        _mm256_blend_ps(_mm256_permutevar8x32_ps(x, idx_x0),
+                        _mm256_permutevar8x32_ps(y, idx_y0),
+                        0x92),
+        _mm256_permutevar8x32_ps(z, idx_z0),
+        0x24);
+    const __m256 out1 = _mm256_blend_ps(
+        _mm256_blend_ps(_mm256_permutevar8x32_ps(z, idx_z1),
+                        _mm256_permutevar8x32_ps(x, idx_x1),
+                        0x92),
+        _mm256_permutevar8x32_ps(y, idx_y1),
+        0x24);
+    const __m256 out2 = _mm256_blend_ps(
+        _mm256_blend_ps(_mm256_permutevar8x32_ps(y, idx_y2),
+                        _mm256_permutevar8x32_ps(z, idx_z2),
+                        0x92),
+        _mm256_permutevar8x32_ps(x, idx_x2),
+        0x24);
+    float* point = xyz + 3 * i;
+    _mm256_storeu_ps(point, out0);
+    _mm256_storeu_ps(point + 8, out1);
+    _mm256_storeu_ps(point + 16, out2);
+  }
+  depthRowToPointsScalar(depth + i, ray_x + i, ray_y, n - i, xyz + 3 * i);
+}
+
+__attribute__((target("avx2"))) void warpPointsAvx2(const float* src_xy,
+                                                    const PointWarp& warp,
+                                                    int n,
+                                                    float* dst_xy) {
+  const bool distorted = isDistorted(warp);
+  const __m256 h0 = _mm256_set1_ps(warp.H[0]);
+  const __m256 h1 = _mm256_set1_ps(warp.H[1]);
+  const __m256 h2 = _mm256_set1_ps(warp.H[2]);
+  const __m256 h3 = _mm256_set1_ps(warp.H[3]);
+  const __m256 h4 = _mm256_set1_ps(warp.H[4]);
+  const __m256 h5 = _mm256_set1_ps(warp.H[5]);
+  const __m256 h6 = _mm256_set1_ps(warp.H[6]);
+  const __m256 h7 = _mm256_set1_ps(warp.H[7]);
+  const __m256 h8 = _mm256_set1_ps(warp.H[8]);
+  const __m256 k1 = _mm256_set1_ps(warp.k1);
+  const __m256 k2 = _mm256_set1_ps(warp.k2);
+  const __m256 fx = _mm256_set1_ps(warp.fx);
+  const __m256 fy = _mm256_set1_ps(warp.fy);
+  const __m256 cx = _mm256_set1_ps(warp.cx);
+  const __m256 cy = _mm256_set1_ps(warp.cy);
+  const __m256 width = _mm256_set1_ps(warp.width);
+  const __m256 height = _mm256_set1_ps(warp.height);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.0f);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m256 a = _mm256_loadu_ps(src_xy + 2 * i);
+    const __m256 b = _mm256_loadu_ps(src_xy + 2 * i + 8);
+    // Points in the order 0 1 4 5 2 3 6 7: the warp is per point, and the
+    // unpacks below restore the order.
+    const __m256 u = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+    const __m256 v = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+    __m256 x = u;
+    __m256 y = v;
+    if (distorted) {
+      const __m256 xd = _mm256_div_ps(_mm256_sub_ps(u, cx), fx);
+      const __m256 yd = _mm256_div_ps(_mm256_sub_ps(v, cy), fy);
+      x = xd;
+      y = yd;
+      for (int k = 0; k < kUndistortIterations; ++k) {
+        const __m256 r2 =
+            _mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y));
+        const __m256 factor = _mm256_add_ps(
+            one, _mm256_mul_ps(r2, _mm256_add_ps(k1, _mm256_mul_ps(r2, k2))));
+        x = _mm256_div_ps(xd, factor);
+        y = _mm256_div_ps(yd, factor);
+      }
+    }
+    const __m256 w = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(h6, x), _mm256_mul_ps(h7, y)), h8);
+    __m256 x2 = _mm256_div_ps(
+        _mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(h0, x), _mm256_mul_ps(h1, y)), h2),
+        w);
+    __m256 y2 = _mm256_div_ps(
+        _mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(h3, x), _mm256_mul_ps(h4, y)), h5),
+        w);
+    if (distorted) {
+      const __m256 r2 =
+          _mm256_add_ps(_mm256_mul_ps(x2, x2), _mm256_mul_ps(y2, y2));
+      const __m256 factor = _mm256_add_ps(
+          one, _mm256_mul_ps(r2, _mm256_add_ps(k1, _mm256_mul_ps(r2, k2))));
+      x2 = _mm256_add_ps(_mm256_mul_ps(fx, _mm256_mul_ps(x2, factor)), cx);
+      y2 = _mm256_add_ps(_mm256_mul_ps(fy, _mm256_mul_ps(y2, factor)), cy);
+    }
+    // Ordered comparisons: NaNs are invalid.
+    const __m256 valid = _mm256_and_ps(
+        _mm256_and_ps(_mm256_cmp_ps(w, zero, _CMP_GT_OQ),
+                      _mm256_and_ps(_mm256_cmp_ps(x2, zero, _CMP_GE_OQ),
+                                    _mm256_cmp_ps(x2, width, _CMP_LT_OQ))),
+        _mm256_and_ps(_mm256_cmp_ps(y2, zero, _CMP_GE_OQ),
+                      _mm256_cmp_ps(y2, height, _CMP_LT_OQ)));
+    x2 = _mm256_blendv_ps(u, x2, valid);
+    y2 = _mm256_blendv_ps(v, y2, valid);
+    _mm256_storeu_ps(dst_xy + 2 * i, _mm256_unpacklo_ps(x2, y2));
+    _mm256_storeu_ps(dst_xy + 2 * i + 8, _mm256_unpackhi_ps(x2, y2));
+  }
+  warpPointsScalar(src_xy + 2 * i, warp, n - i, dst_xy + 2 * i);
+}
+#endif
+
+#if defined(KIMERA_NEON_KERNELS)
+/* -------------------------------------------------------------------------- */
+uint32_t ssdRowNeon(const uint8_t* a, const uint8_t* b, int n) {
+  int i = 0;
+  int32x4_t acc = vdupq_n_s32(0);
+  for (; i + 8 <= n; i += 8) {
+    const int16x8_t diff =
+        vreinterpretq_s16_u16(vsubl_u8(vld1_u8(a + i), vld1_u8(b + i)));
+    acc = vmlal_s16(acc, vget_low_s16(diff), vget_low_s16(diff));
+    acc = vmlal_s16(acc, vget_high_s16(diff), vget_high_s16(diff));
+  }
+  return static_cast<uint32_t>(vgetq_lane_s32(acc, 0) +
+                               vgetq_lane_s32(acc, 1) +
+                               vgetq_lane_s32(acc, 2) +
+                               vgetq_lane_s32(acc, 3)) +
+         ssdRowScalar(a + i, b + i, n - i);
+}
+
+uint32_t dotRowNeon(const uint8_t* a, const uint8_t* b, int n) {
+  int i = 0;
+  uint32x4_t acc = vdupq_n_u32(0);
+  for (; i + 8 <= n; i += 8) {
+    acc = vpadalq_u16(acc, vmull_u8(vld1_u8(a + i), vld1_u8(b + i)));
+  }
+  return vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1) +
+         vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3) +
+         dotRowScalar(a + i, b + i, n - i);
+}
+
+uint32_t orbHammingDistanceNeon(const uint8_t* a, const uint8_t* b) {
+  const uint8x16_t counts_low = vcntq_u8(veorq_u8(vld1q_u8(a), vld1q_u8(b)));
+  const uint8x16_t counts_high =
+      vcntq_u8(veorq_u8(vld1q_u8(a + 16), vld1q_u8(b + 16)));
+  // Max 16 per byte pair: no overflow in u8.
+  const uint16x8_t sums = vpaddlq_u8(vaddq_u8(counts_low, counts_high));
+  const uint64x2_t sums64 = vpaddlq_u32(vpaddlq_u16(sums));
+  return static_cast<uint32_t>(vgetq_lane_u64(sums64, 0) +
+                               vgetq_lane_u64(sums64, 1));
+}
+
+void depthRowToPointsNeon(const float* depth,
+                          const float* ray_x,
+                          float ray_y,
+                          int n,
+                          float* xyz) {
+  const float32x4_t nan =
+      vdupq_n_f32(std::numeric_limits<float>::quiet_NaN());
+  const float32x4_t zero = vdupq_n_f32(0.0f);
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const float32x4_t d = vld1q_f32(depth + i);
+    // d - d is 0 for finite depths, NaN otherwise.
+    const uint32x4_t valid = vceqq_f32(vsubq_f32(d, d), zero);
+    float32x4x3_t point;
+    point.val[2] = vbslq_f32(valid, d, nan);
+    point.val[0] = vmulq_f32(vld1q_f32(ray_x + i), point.val[2]);
+    point.val[1] = vmulq_n_f32(point.val[2], ray_y);
+    vst3q_f32(xyz + 3 * i, point);
+  }
+  depthRowToPointsScalar(depth + i, ray_x + i, ray_y, n - i, xyz + 3 * i);
+}
+
+#if defined(__aarch64__)
+// Needs the vector division of AArch64.
+void warpPointsNeon(const float* src_xy,
+                    const PointWarp& warp,
+                    int n,
+                    float* dst_xy) {
+  const bool distorted = isDistorted(warp);
+  const float* H = warp.H;
+  const float32x4_t fx = vdupq_n_f32(warp.fx);
+  const float32x4_t fy = vdupq_n_f32(warp.fy);
+  const float32x4_t cx = vdupq_n_f32(warp.cx);
+  const float32x4_t cy = vdupq_n_f32(warp.cy);
+  const float32x4_t width = vdupq_n_f32(warp.width);
+  const float32x4_t height = vdupq_n_f32(warp.height);
+  const float32x4_t zero = vdupq_n_f32(0.0f);
+  const float32x4_t one = vdupq_n_f32(1.0f);
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const float32x4x2_t uv = vld2q_f32(src_xy + 2 * i);
+    float32x4_t x = uv.val[0];
+    float32x4_t y = uv.val[1];
+    if (distorted) {
+      const float32x4_t xd = vdivq_f32(vsubq_f32(uv.val[0], cx), fx);
+      const float32x4_t yd = vdivq_f32(vsubq_f32(uv.val[1], cy), fy);
+      x = xd;
+      y = yd;
+      for (int k = 0; k < kUndistortIterations; ++k) {
+        const float32x4_t r2 = vaddq_f32(vmulq_f32(x, x), vmulq_f32(y, y));
+        const float32x4_t factor = vaddq_f32(
+            one,
+            vmulq_f32(r2,
+                      vaddq_f32(vdupq_n_f32(warp.k1),
+                                vmulq_n_f32(r2, warp.k2))));
+        x = vdivq_f32(xd, factor);
+        y = vdivq_f32(yd, factor);
+      }
+    }
+    const float32x4_t w = vaddq_f32(
+        vaddq_f32(vmulq_n_f32(x, H[6]), vmulq_n_f32(y, H[7])),
+        vdupq_n_f32(H[8]));
+    float32x4_t x2 = vdivq_f32(
+        vaddq_f32(vaddq_f32(vmulq_n_f32(x, H[0]), vmulq_n_f32(y, H[1])),
+                  vdupq_n_f32(H[2])),
+        w);
+    float32x4_t y2 = vdivq_f32(
+        vaddq_f32(vaddq_f32(vmulq_n_f32(x, H[3]), vmulq_n_f32(y, H[4])),
+                  vdupq_n_f32(H[5])),
+        w);
+    if (distorted) {
+      const float32x4_t r2 = vaddq_f32(vmulq_f32(x2, x2), vmulq_f32(y2, y2));
+      const float32x4_t factor = vaddq_f32(
+          one,
+          vmulq_f32(r2,
+                    vaddq_f32(vdupq_n_f32(warp.k1), vmulq_n_f32(r2, warp.k2))));
+      x2 = vaddq_f32(vmulq_f32(fx, vmulq_f32(x2, factor)), cx);
+      y2 = vaddq_f32(vmulq_f32(fy, vmulq_f32(y2, factor)), cy);
+    }
+    // Comparisons with NaNs are false: NaNs are invalid.
+    const uint32x4_t valid = vandq_u32(
+        vandq_u32(vcgtq_f32(w, zero),
+                  vandq_u32(vcgeq_f32(x2, zero), vcltq_f32(x2, width))),
+        vandq_u32(vcgeq_f32(y2, zero), vcltq_f32(y2, height)));
+    float32x4x2_t out;
+    out.val[0] = vbslq_f32(valid, x2, uv.val[0]);
+    out.val[1] = vbslq_f32(valid, y2, uv.val[1]);
+    vst2q_f32(dst_xy + 2 * i, out);
+  }
+  warpPointsScalar(src_xy + 2 * i, warp, n - i, dst_xy + 2 * i);
+}
+#endif
+#endif
+
+/* -------------------------------------------------------------------------- */
+CpuFeatures detectCpuFeaturesUncached() {
+  CpuFeatures features = kCpuScalar;
+#if defined(KIMERA_X86_KERNELS)
+  // Also checks that the OS saves the extended registers.
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("popcnt")) features |= kCpuPopcnt;
+  if (__builtin_cpu_supports("avx2")) features |= kCpuAvx2;
+  if (__builtin_cpu_supports("avx512vl")) features |= kCpuAvx512Vl;
+  if (__builtin_cpu_supports("avx512vpopcntdq")) {
+    features |= kCpuAvx512Vpopcntdq;
+  }
+#elif defined(KIMERA_NEON_KERNELS)
+  features |= kCpuNeon;
+#endif
+  return features;
+}
+
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+CpuFeatures detectCpuFeatures() {
+  static const CpuFeatures features = detectCpuFeaturesUncached();
+  return features;
+}
+
+/* -------------------------------------------------------------------------- */
+std::string cpuFeaturesToString(const CpuFeatures& features) {
+  static const std::vector<std::pair<CpuFeatures, std::string>> kNames = {
+      {kCpuPopcnt, "popcnt"},
+      {kCpuAvx2, "avx2"},
+      {kCpuAvx512Vl, "avx512vl"},
+      {kCpuAvx512Vpopcntdq, "avx512vpopcntdq"},
+      {kCpuNeon, "neon"}};
+  std::string str;
+  for (const auto& feature_name : kNames) {
+    if (features & feature_name.first) {
+      if (!str.empty()) str += " ";
+      str += feature_name.second;
+    }
+  }
+  return str.empty() ? "none" : str;
+}
+
+/* -------------------------------------------------------------------------- */
+const std::vector<KernelImplementation<SimdKernels::RowFunction>>&
+SimdKernels::ssdRowImplementations() {
+  static const std::vector<KernelImplementation<RowFunction>> kImpls = {
+#if defined(KIMERA_X86_KERNELS)
+      {"avx2", kCpuAvx2, &ssdRowAvx2},
+#elif defined(KIMERA_NEON_KERNELS)
+      {"neon", kCpuNeon, &ssdRowNeon},
+#endif
+      {"scalar", kCpuScalar, &ssdRowScalar}};
+  return kImpls;
+}
+
+const std::vector<KernelImplementation<SimdKernels::RowFunction>>&
+SimdKernels::dotRowImplementations() {
+  static const std::vector<KernelImplementation<RowFunction>> kImpls = {
+#if defined(KIMERA_X86_KERNELS)
+      {"avx2", kCpuAvx2, &dotRowAvx2},
+#elif defined(KIMERA_NEON_KERNELS)
+      {"neon", kCpuNeon, &dotRowNeon},
+#endif
+      {"scalar", kCpuScalar, &dotRowScalar}};
+  return kImpls;
+}
+
+const std::vector<KernelImplementation<SimdKernels::DescriptorFunction>>&
+SimdKernels::orbHammingDistanceImplementations() {
+  static const std::vector<KernelImplementation<DescriptorFunction>> kImpls = {
+#if defined(KIMERA_X86_KERNELS)
+      {"avx512", kCpuAvx2 | kCpuAvx512Vl | kCpuAvx512Vpopcntdq,
+       &orbHammingDistanceAvx512},
+      {"popcnt", kCpuPopcnt, &orbHammingDistancePopcnt},
+      {"avx2", kCpuAvx2, &orbHammingDistanceAvx2},
+#elif defined(KIMERA_NEON_KERNELS)
+      {"neon", kCpuNeon, &orbHammingDistanceNeon},
+#endif
+      {"scalar", kCpuScalar, &orbHammingDistanceScalar}};
+  return kImpls;
+}
+
+const std::vector<KernelImplementation<SimdKernels::DepthRowFunction>>&
+SimdKernels::depthRowToPointsImplementations() {
+  static const std::vector<KernelImplementation<DepthRowFunction>> kImpls = {
+#if defined(KIMERA_X86_KERNELS)
+      {"avx2", kCpuAvx2, &depthRowToPointsAvx2},
+#elif defined(KIMERA_NEON_KERNELS)
+      {"neon", kCpuNeon, &depthRowToPointsNeon},
+#endif
+      {"scalar", kCpuScalar, &depthRowToPointsScalar}};
+  return kImpls;
+}
+
+const std::vector<KernelImplementation<SimdKernels::WarpPointsFunction>>&
+SimdKernels::warpPointsImplementations() {
+  static const std::vector<KernelImplementation<WarpPointsFunction>> kImpls = {
+#if defined(KIMERA_X86_KERNELS)
+      {"avx2", kCpuAvx2, &warpPointsAvx2},
+#elif defined(KIMERA_NEON_KERNELS) && defined(__aarch64__)
+      {"neon", kCpuNeon, &warpPointsNeon},
+#endif
+      {"scalar", kCpuScalar, &warpPointsScalar}};
+  return kImpls;
+}
+
+/* -------------------------------------------------------------------------- */
+SimdKernels::SimdKernels(const CpuFeatures& features)
+    : cpu_features(features) {
+  const auto& ssd_row_impl = selectKernel(ssdRowImplementations(), features);
+  ssd_row = ssd_row_impl.function;
+  ssd_row_name_ = ssd_row_impl.name;
+  const auto& dot_row_impl = selectKernel(dotRowImplementations(), features);
+  dot_row = dot_row_impl.function;
+  dot_row_name_ = dot_row_impl.name;
+  const auto& orb_hamming_distance_impl =
+      selectKernel(orbHammingDistanceImplementations(), features);
+  orb_hamming_distance = orb_hamming_distance_impl.function;
+  orb_hamming_distance_name_ = orb_hamming_distance_impl.name;
+  const auto& depth_row_to_points_impl =
+      selectKernel(depthRowToPointsImplementations(), features);
+  depth_row_to_points = depth_row_to_points_impl.function;
+  depth_row_to_points_name_ = depth_row_to_points_impl.name;
+  const auto& warp_points_impl =
+      selectKernel(warpPointsImplementations(), features);
+  warp_points = warp_points_impl.function;
+  warp_points_name_ = warp_points_impl.name;
+}
+
+/* -------------------------------------------------------------------------- */
+const SimdKernels& SimdKernels::get() {
+  static const SimdKernels kernels(
+      FLAGS_disable_simd_kernels ? kCpuScalar : detectCpuFeatures());
+  return kernels;
+}
+
+/* -------------------------------------------------------------------------- */
+std::string SimdKernels::print() const {
+  std::stringstream out;
+  out << "SIMD kernels:\n"
+      << " - CPU features: " << cpuFeaturesToString(detectCpuFeatures())
+      << (FLAGS_disable_simd_kernels ? " (disabled)" : "") << '\n'
+      << " - ssdRow: " << ssd_row_name_ << '\n'
+      << " - dotRow: " << dot_row_name_ << '\n'
+      << " - orbHammingDistance: " << orb_hamming_distance_name_ << '\n'
+      << " - depthRowToPoints: " << depth_row_to_points_name_ << '\n'
+      << " - warpPoints: " << warp_points_name_;
+  return out.str();
+}
+
+}  // namespace utils
+
+}  // namespace VIO
@@ -0,0 +1,274 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   StartupCache.cpp
+ * @brief  On-disk cache of the data precomputed at startup from the params
+ * (e.g. undistortion maps), to skip computing it at the next launch.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/utils/StartupCache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <utility>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kimera-vio/utils/MappedFile.h"
+
+DEFINE_string(startup_cache_path,
+              "",
+              "Binary file caching the data precomputed from the params at "
+              "startup (e.g. undistortion maps), to skip computing it at the "
+              "next launch. Disabled if empty.");
+
+namespace VIO {
+
+namespace {
+
+// "KVSC", and version of the layout below.
+constexpr uint32_t kCacheMagic = 0x4b565343;
+constexpr uint32_t kCacheVersion = 1u;
+// Matrix data is aligned as cv::fastMalloc aligns it.
+constexpr size_t kDataAlignment = 64u;
+
+template <typename T>
+void write(std::ostream& stream, const T& field) {
+  stream.write(reinterpret_cast<const char*>(&field), sizeof(T));
+}
+
+void writePadding(std::ostream& stream) {
+  static const char kZeros[kDataAlignment] = {};
+  const size_t position = static_cast<size_t>(stream.tellp());
+  const size_t padding = (kDataAlignment - position % kDataAlignment) %
+                         kDataAlignment;
+  stream.write(kZeros, padding);
+}
+
+/**
+ * Layout, after the magic and version:
+ *   nr_entries (uint32)
+ *   per entry: key size (uint32), key, hash (uint64), nr_mats (uint32),
+ *     per mat: rows, cols, type (int32), padding, rows * cols values.
+ * Reads past the end of the mapping fail instead of crashing.
+ */
+class MappedFileReader {
+ public:
+  explicit MappedFileReader(const std::shared_ptr<const MappedFile>& file)
+      : file_(file), offset_(0u) {}
+
+  template <typename T>
+  bool read(T* field) {
+    if (offset_ + sizeof(T) > file_->size()) return false;
+    std::memcpy(field, file_->data() + offset_, sizeof(T));
+    offset_ += sizeof(T);
+    return true;
+  }
+
+  bool readString(const size_t& size, std::string* string) {
+    if (offset_ + size > file_->size()) return false;
+    string->assign(reinterpret_cast<const char*>(file_->data() + offset_),
+                   size);
+    offset_ += size;
+    return true;
+  }
+
+  bool readMat(cv::Mat* mat) {
+    int32_t rows, cols, type;
+    if (!read(&rows) || !read(&cols) || !read(&type)) return false;
+    if (rows < 0 || cols < 0) return false;
+    offset_ = (offset_ + kDataAlignment - 1u) / kDataAlignment * kDataAlignment;
+    if (rows == 0 || cols == 0) {
+      *mat = cv::Mat();
+      return true;
+    }
+    const size_t step = static_cast<size_t>(cols) * CV_ELEM_SIZE(type);
+    const size_t size = step * static_cast<size_t>(rows);
+    if (offset_ + size > file_->size()) return false;
+    *mat = wrapMappedFile(file_, offset_, rows, cols, type, step);
+    offset_ += size;
+    return true;
+  }
+
+ private:
+  const std::shared_ptr<const MappedFile> file_;
+  size_t offset_;
+};
+
+}  // namespace
+
+StartupCache::StartupCache(const std::string& filepath)
+    : filepath_(filepath),
+      share_in_memory_(false),
+      mutex_(),
+      loaded_(false),
+      entries_() {}
+
+StartupCache& StartupCache::getInstance() {
+  static StartupCache instance(FLAGS_startup_cache_path);
+  return instance;
+}
+
+bool StartupCache::get(const std::string& key,
+                       const uint64_t& hash,
+                       std::vector<cv::Mat>* mats) {
+  CHECK_NOTNULL(mats);
+  if (!isEnabled()) return false;
+  std::lock_guard<std::mutex> lock(mutex_);
+  loadIfNeeded();
+  const auto it = entries_.find(key);
+  if (it == entries_.end() || it->second.hash_ != hash) {
+    VLOG(1) << "Startup cache miss for: " << key;
+    return false;
+  }
+  VLOG(1) << "Startup cache hit for: " << key;
+  *mats = it->second.mats_;
+  return true;
+}
+
+bool StartupCache::put(const std::string& key,
+                       const uint64_t& hash,
+                       const std::vector<cv::Mat>& mats) {
+  if (!isEnabled()) return false;
+  std::lock_guard<std::mutex> lock(mutex_);
+  loadIfNeeded();
+  Entry& entry = entries_[key];
+  entry.hash_ = hash;
+  entry.mats_.clear();
+  for (const cv::Mat& mat : mats) {
+    CHECK_LE(mat.dims, 2) << "Startup cache only stores 2D matrices.";
+    // Copies, so that the caller may modify its matrices.
+    entry.mats_.push_back(mat.clone());
+  }
+  return filepath_.empty() || save();
+}
+
+uint64_t StartupCache::hash(const void* data,
+                            const size_t& size,
+                            const uint64_t& seed) {
+  static constexpr uint64_t kPrime = 1099511628211ull;
+  uint64_t hash = seed;
+  const uchar* bytes = static_cast<const uchar*>(data);
+  for (size_t i = 0u; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= kPrime;
+  }
+  return hash;
+}
+
+uint64_t StartupCache::hash(const cv::Mat& mat, const uint64_t& seed) {
+  uint64_t hash = hashValue(mat.rows, seed);
+  hash = hashValue(mat.cols, hash);
+  hash = hashValue(mat.type(), hash);
+  if (mat.empty()) return hash;
+  const size_t row_size = static_cast<size_t>(mat.cols) * mat.elemSize();
+  for (int row = 0; row < mat.rows; ++row) {
+    hash = StartupCache::hash(mat.ptr(row), row_size, hash);
+  }
+  return hash;
+}
+
+void StartupCache::loadIfNeeded() {
+  if (loaded_) return;
+  loaded_ = true;
+  if (filepath_.empty()) return;
+  if (!std::ifstream(filepath_).good() ||
+      std::filesystem::file_size(filepath_) == 0u) {
+    LOG(INFO) << "No startup cache at: " << filepath_
+              << ", it will be created.";
+    return;
+  }
+  MappedFileReader reader(std::make_shared<const MappedFile>(filepath_));
+  uint32_t magic = 0u;
+  uint32_t version = 0u;
+  uint32_t nr_entries = 0u;
+  if (!reader.read(&magic) || !reader.read(&version) ||
+      magic != kCacheMagic || version != kCacheVersion ||
+      !reader.read(&nr_entries)) {
+    LOG(WARNING) << "Not a valid startup cache (version " << kCacheVersion
+                 << "), it will be overwritten: " << filepath_;
+    return;
+  }
+  std::map<std::string, Entry> entries;
+  for (uint32_t i = 0u; i < nr_entries; ++i) {
+    uint32_t key_size = 0u;
+    std::string key;
+    Entry entry;
+    uint32_t nr_mats = 0u;
+    if (!reader.read(&key_size) || !reader.readString(key_size, &key) ||
+        !reader.read(&entry.hash_) || !reader.read(&nr_mats)) {
+      LOG(WARNING) << "Truncated startup cache, it will be overwritten: "
+                   << filepath_;
+      return;
+    }
+    entry.mats_.resize(nr_mats);
+    for (cv::Mat& mat : entry.mats_) {
+      if (!reader.readMat(&mat)) {
+        LOG(WARNING) << "Truncated startup cache, it will be overwritten: "
+                     << filepath_;
+        return;
+      }
+    }
+    entries.emplace(std::move(key), std::move(entry));
+  }
+  entries_ = std::move(entries);
+  LOG(INFO) << "Loaded startup cache with " << entries_.size()
+            << " entries: " << filepath_;
+}
+
+bool StartupCache::save() const {
+  const std::string tmp_filepath = filepath_ + ".tmp";
+  {
+    std::ofstream stream(tmp_filepath, std::ios::binary | std::ios::trunc);
+    if (!stream.good()) {
+      LOG(ERROR) << "Could not open startup cache file: " << tmp_filepath;
+      return false;
+    }
+    write(stream, kCacheMagic);
+    write(stream, kCacheVersion);
+    write(stream, static_cast<uint32_t>(entries_.size()));
+    for (const auto& key_entry : entries_) {
+      const std::string& key = key_entry.first;
+      const Entry& entry = key_entry.second;
+      write(stream, static_cast<uint32_t>(key.size()));
+      stream.write(key.data(), key.size());
+      write(stream, entry.hash_);
+      write(stream, static_cast<uint32_t>(entry.mats_.size()));
+      for (const cv::Mat& mat : entry.mats_) {
+        write(stream, static_cast<int32_t>(mat.rows));
+        write(stream, static_cast<int32_t>(mat.cols));
+        write(stream, static_cast<int32_t>(mat.type()));
+        writePadding(stream);
+        const size_t row_size = static_cast<size_t>(mat.cols) * mat.elemSize();
+        for (int row = 0; row < mat.rows; ++row) {
+          stream.write(reinterpret_cast<const char*>(mat.ptr(row)), row_size);
+        }
+      }
+    }
+    stream.flush();
+    if (!stream.good()) {
+      LOG(ERROR) << "Could not write startup cache file: " << tmp_filepath;
+      return false;
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(tmp_filepath, filepath_, error);
+  if (error) {
+    LOG(ERROR) << "Could not move " << tmp_filepath << " to " << filepath_
+               << ": " << error.message();
+    return false;
+  }
+  return true;
+}
+
+}  // namespace VIO
@@ -30,24 +30,114 @@
 
 #include "kimera-vio/utils/Statistics.h"
 
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 #include <iomanip>
 #include <ostream>
 #include <sstream>
+#include <utility>
+
+#include "kimera-vio/utils/ThreadsafeSpscQueue.h"
 
 namespace VIO {
 
 namespace utils {
 
+namespace {
+// Samples a thread can add between two flushes without locking.
+static constexpr size_t kThreadBufferCapacity = 4096u;
+static constexpr std::chrono::milliseconds kAggregationPeriod(100);
+}  // namespace
+
+// The owning thread is the only producer. Consumers (the aggregator, or any
+// thread querying the stats) pop under the Statistics mutex, hence one at a
+// time.
+class Statistics::ThreadBuffer {
+ public:
+  ThreadBuffer()
+      : samples_("Statistics Thread Buffer",
+                 kThreadBufferCapacity,
+                 // Instrumenting it would record samples while recording.
+                 false) {
+    Statistics& statistics = Instance();
+    std::lock_guard<std::mutex> lock(statistics.mutex_);
+    statistics.thread_buffers_.push_back(this);
+  }
+
+  ~ThreadBuffer() {
+    Statistics& statistics = Instance();
+    std::lock_guard<std::mutex> lock(statistics.mutex_);
+    statistics.FlushThreadBuffers();
+    auto& thread_buffers = statistics.thread_buffers_;
+    thread_buffers.erase(
+        std::remove(thread_buffers.begin(), thread_buffers.end(), this),
+        thread_buffers.end());
+  }
+
+  void Push(Sample sample) {
+    if (samples_.size() >= samples_.capacity()) {
+      // The aggregator is lagging behind: flush ourselves instead of waiting.
+      Statistics& statistics = Instance();
+      std::lock_guard<std::mutex> lock(statistics.mutex_);
+      statistics.FlushThreadBuffers();
+    }
+    // Only this thread pushes: there is room now, push does not block.
+    CHECK(samples_.push(std::move(sample)));
+  }
+
+  inline bool Pop(Sample* sample) { return samples_.pop(*sample); }
+
+ private:
+  ThreadsafeSpscQueue<Sample> samples_;
+};
+
 Statistics& Statistics::Instance() {
   static Statistics instance;
   return instance;
 }
 
-Statistics::Statistics() : max_tag_length_(0) {}
+Statistics::Statistics()
+    : max_tag_length_(0),
+      shutdown_aggregator_(false),
+      aggregator_(&Statistics::SpinAggregator, this) {}
+
+Statistics::~Statistics() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_aggregator_ = true;
+  }
+  aggregator_cond_.notify_all();
+  aggregator_.join();
+}
+
+void Statistics::SpinAggregator() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!shutdown_aggregator_) {
+    aggregator_cond_.wait_for(
+        lock, kAggregationPeriod, [this] { return shutdown_aggregator_; });
+    FlushThreadBuffers();
+  }
+}
 
-Statistics::~Statistics() {}
+void Statistics::FlushThreadBuffers() {
+  flushed_samples_.clear();
+  Sample sample;
+  for (ThreadBuffer* thread_buffer : thread_buffers_) {
+    while (thread_buffer->Pop(&sample)) flushed_samples_.push_back(sample);
+  }
+  if (flushed_samples_.empty()) return;
+  // Keep the time deltas meaningful when several threads share a tag.
+  std::stable_sort(flushed_samples_.begin(),
+                   flushed_samples_.end(),
+                   [](const Sample& a, const Sample& b) {
+                     return a.time < b.time;
+                   });
+  for (const Sample& flushed_sample : flushed_samples_) {
+    stats_collectors_[flushed_sample.handle].AddValue(flushed_sample.value,
+                                                      flushed_sample.time);
+  }
+}
 
 // Static functions to query the stats collectors:
 size_t Statistics::GetHandle(std::string const& tag) {
@@ -102,11 +192,18 @@ void StatsCollectorImpl::IncrementOne() const {
   Statistics::Instance().AddSample(handle_, 1.0);
 }
 void Statistics::AddSample(size_t handle, double seconds) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  stats_collectors_[handle].AddValue(seconds);
+  // Constructed (and registered) on the first sample of each thread, and
+  // flushed when the thread exits.
+  thread_local ThreadBuffer thread_buffer;
+  Sample sample;
+  sample.handle = handle;
+  sample.value = seconds;
+  sample.time = std::chrono::system_clock::now();
+  thread_buffer.Push(std::move(sample));
 }
 double Statistics::GetLastValue(size_t handle) {
   std::lock_guard<std::mutex> lock(Instance().mutex_);
+  Instance().FlushThreadBuffers();
   return Instance().stats_collectors_[handle].GetLastValue();
 }
 double Statistics::GetLastValue(std::string const& tag) {
@@ -114,6 +211,7 @@ double Statistics::GetLastValue(std::string const& tag) {
 }
 double Statistics::GetTotal(size_t handle) {
   std::lock_guard<std::mutex> lock(Instance().mutex_);
+  Instance().FlushThreadBuffers();
   return Instance().stats_collectors_[handle].Sum();
 }
 double Statistics::GetTotal(std::string const& tag) {
@@ -121,6 +219,7 @@ double Statistics::GetTotal(std::string const& tag) {
 }
 double Statistics::GetMean(size_t handle) {
   std::lock_guard<std::mutex> lock(Instance().mutex_);
+  Instance().FlushThreadBuffers();
   return Instance().stats_collectors_[handle].Mean();
 }
 double Statistics::GetMean(std::string const& tag) {
@@ -128,6 +227,7 @@ double Statistics::GetMean(std::string const& tag) {
 }
 size_t Statistics::GetNumSamples(size_t handle) {
   std::lock_guard<std::mutex> lock(Instance().mutex_);
+  Instance().FlushThreadBuffers();
   return Instance().stats_collectors_[handle].TotalSamples();
 }
 size_t Statistics::GetNumSamples(std::string const& tag) {
@@ -135,6 +235,7 @@ size_t Statistics::GetNumSamples(std::string const& tag) {
 }
 std::vector<double> Statistics::GetAllSamples(size_t handle) {
   std::lock_guard<std::mutex> lock(Instance().mutex_);
+  Instance().FlushThreadBuffers();
   return Instance().stats_collectors_[handle].GetAllValues();
 }
 std::vector<double> Statistics::GetAllSamples(std::string const& tag) {
@@ -142,6 +243,7 @@ std::vector<double> Statistics::GetAllSamples(std::string const& tag) {
 }
 double Statistics::GetVariance(size_t handle) {
   std::lock_guard<std::mutex> lock(Instance().mutex_);
+  Instance().FlushThreadBuffers();
   return Instance().stats_collectors_[handle].LazyVariance();
 }
 double Statistics::GetVariance(std::string const& tag) {
@@ -149,6 +251,7 @@ double Statistics::GetVariance(std::string const& tag) {
 }
 double Statistics::GetMin(size_t handle) {
   std::lock_guard<std::mutex> lock(Instance().mutex_);
+  Instance().FlushThreadBuffers();
   return Instance().stats_collectors_[handle].Min();
 }
 double Statistics::GetMin(std::string const& tag) {
@@ -156,6 +259,7 @@ double Statistics::GetMin(std::string const& tag) {
 }
 double Statistics::GetMax(size_t handle) {
   std::lock_guard<std::mutex> lock(Instance().mutex_);
+  Instance().FlushThreadBuffers();
   return Instance().stats_collectors_[handle].Max();
 }
 double Statistics::GetMax(std::string const& tag) {
@@ -163,6 +267,7 @@ double Statistics::GetMax(std::string const& tag) {
 }
 double Statistics::GetMedian(size_t handle) {
   std::lock_guard<std::mutex> lock(Instance().mutex_);
+  Instance().FlushThreadBuffers();
   return Instance().stats_collectors_[handle].Median();
 }
 double Statistics::GetMedian(std::string const& tag) {
@@ -170,6 +275,7 @@ double Statistics::GetMedian(std::string const& tag) {
 }
 double Statistics::GetQ1(size_t handle) {
   std::lock_guard<std::mutex> lock(Instance().mutex_);
+  Instance().FlushThreadBuffers();
   return Instance().stats_collectors_[handle].Q1();
 }
 double Statistics::GetQ1(std::string const& tag) {
@@ -177,13 +283,23 @@ double Statistics::GetQ1(std::string const& tag) {
 }
 double Statistics::GetQ3(size_t handle) {
   std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().stats_collectors_[handle].Q1();
+  Instance().FlushThreadBuffers();
+  return Instance().stats_collectors_[handle].Q3();
 }
 double Statistics::GetQ3(std::string const& tag) {
   return GetQ3(GetHandle(tag));
 }
+double Statistics::GetPercentile(size_t handle, double percentile) {
+  std::lock_guard<std::mutex> lock(Instance().mutex_);
+  Instance().FlushThreadBuffers();
+  return Instance().stats_collectors_[handle].Percentile(percentile);
+}
+double Statistics::GetPercentile(std::string const& tag, double percentile) {
+  return GetPercentile(GetHandle(tag), percentile);
+}
 double Statistics::GetHz(size_t handle) {
   std::lock_guard<std::mutex> lock(Instance().mutex_);
+  Instance().FlushThreadBuffers();
   return Instance().stats_collectors_[handle].MeanCallsPerSec();
 }
 double Statistics::GetHz(std::string const& tag) {
@@ -196,6 +312,7 @@ double Statistics::GetMeanDeltaTime(std::string const& tag) {
 }
 double Statistics::GetMeanDeltaTime(size_t handle) {
   std::lock_guard<std::mutex> lock(Instance().mutex_);
+  Instance().FlushThreadBuffers();
   return Instance().stats_collectors_[handle].MeanDeltaTime();
 }
 double Statistics::GetMaxDeltaTime(std::string const& tag) {
@@ -203,6 +320,7 @@ double Statistics::GetMaxDeltaTime(std::string const& tag) {
 }
 double Statistics::GetMaxDeltaTime(size_t handle) {
   std::lock_guard<std::mutex> lock(Instance().mutex_);
+  Instance().FlushThreadBuffers();
   return Instance().stats_collectors_[handle].MaxDeltaTime();
 }
 double Statistics::GetMinDeltaTime(std::string const& tag) {
@@ -210,6 +328,7 @@ double Statistics::GetMinDeltaTime(std::string const& tag) {
 }
 double Statistics::GetMinDeltaTime(size_t handle) {
   std::lock_guard<std::mutex> lock(Instance().mutex_);
+  Instance().FlushThreadBuffers();
   return Instance().stats_collectors_[handle].MinDeltaTime();
 }
 double Statistics::GetLastDeltaTime(std::string const& tag) {
@@ -217,6 +336,7 @@ double Statistics::GetLastDeltaTime(std::string const& tag) {
 }
 double Statistics::GetLastDeltaTime(size_t handle) {
   std::lock_guard<std::mutex> lock(Instance().mutex_);
+  Instance().FlushThreadBuffers();
   return Instance().stats_collectors_[handle].GetLastDeltaTime();
 }
 double Statistics::GetVarianceDeltaTime(std::string const& tag) {
@@ -224,6 +344,7 @@ double Statistics::GetVarianceDeltaTime(std::string const& tag) {
 }
 double Statistics::GetVarianceDeltaTime(size_t handle) {
   std::lock_guard<std::mutex> lock(Instance().mutex_);
+  Instance().FlushThreadBuffers();
   return Instance().stats_collectors_[handle].LazyVarianceDeltaTime();
 }
 
@@ -384,6 +505,10 @@ void Statistics::WriteToYamlFile(const std::string& path) {
       output_file << "  median: " << GetMedian(index) << "\n";
       output_file << "  q1: " << GetQ1(index) << "\n";
       output_file << "  q3: " << GetQ3(index) << "\n";
+      output_file << "  p50: " << GetPercentile(index, 50.0) << "\n";
+      output_file << "  p95: " << GetPercentile(index, 95.0) << "\n";
+      output_file << "  p99: " << GetPercentile(index, 99.0) << "\n";
+      output_file << "  p99.9: " << GetPercentile(index, 99.9) << "\n";
     }
     output_file << "\n";
   }
@@ -395,6 +520,32 @@ std::string Statistics::Print() {
   return ss.str();
 }
 
+std::vector<StatisticSnapshot> Statistics::GetSnapshot() {
+  Statistics& instance = Instance();
+  std::lock_guard<std::mutex> lock(instance.mutex_);
+  instance.FlushThreadBuffers();
+  std::vector<StatisticSnapshot> snapshot;
+  snapshot.reserve(instance.tag_map_.size());
+  for (const auto& tag_handle : instance.tag_map_) {
+    const StatisticsMapValue& stats =
+        instance.stats_collectors_[tag_handle.second];
+    if (stats.TotalSamples() <= 0) continue;
+    StatisticSnapshot statistic;
+    statistic.tag = tag_handle.first;
+    statistic.num_samples = static_cast<size_t>(stats.TotalSamples());
+    statistic.sum = stats.Sum();
+    statistic.last = stats.GetLastValue();
+    statistic.min = stats.Min();
+    statistic.max = stats.Max();
+    statistic.hz = stats.MeanCallsPerSec();
+    for (const double& quantile : kSnapshotQuantiles) {
+      statistic.quantiles.push_back(stats.Percentile(100.0 * quantile));
+    }
+    snapshot.push_back(std::move(statistic));
+  }
+  return snapshot;
+}
+
 void Statistics::Reset() {
   std::lock_guard<std::mutex> lock(Instance().mutex_);
   Instance().tag_map_.clear();
@@ -0,0 +1,158 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   TaskGraph.cpp
+ * @brief  Runs the tasks of a small dependency graph on a pool of threads.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/utils/TaskGraph.h"
+
+#include <utility>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+namespace utils {
+
+TaskGraph::TaskGraph(const size_t& nr_threads)
+    : nodes_(),
+      mutex_(),
+      cond_(),
+      ready_tasks_(),
+      nr_unfinished_tasks_(0u),
+      exception_(),
+      shutdown_(false),
+      threads_() {
+  threads_.reserve(nr_threads);
+  for (size_t i = 0u; i < nr_threads; ++i) {
+    threads_.emplace_back(&TaskGraph::workerLoop, this);
+  }
+}
+
+TaskGraph::~TaskGraph() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CHECK_EQ(nr_unfinished_tasks_, 0u) << "TaskGraph destroyed while running.";
+    shutdown_ = true;
+  }
+  cond_.notify_all();
+  for (std::thread& thread : threads_) thread.join();
+}
+
+TaskGraph::TaskId TaskGraph::addTask(Task task,
+                                     const std::vector<TaskId>& dependencies) {
+  CHECK(task);
+  const TaskId task_id = nodes_.size();
+  for (const TaskId& dependency : dependencies) {
+    CHECK_LT(dependency, task_id) << "Dependencies must be added first.";
+    nodes_[dependency].dependents.push_back(task_id);
+  }
+  nodes_.push_back({std::move(task), {}, dependencies.size(), false});
+  return task_id;
+}
+
+void TaskGraph::run() {
+  if (threads_.empty()) {
+    // Added in a topological order already.
+    std::vector<Node> nodes;
+    nodes.swap(nodes_);
+    std::exception_ptr exception;
+    for (Node& node : nodes) {
+      if (!node.skipped) {
+        try {
+          node.task();
+          continue;
+        } catch (...) {
+          if (!exception) exception = std::current_exception();
+        }
+      }
+      for (const TaskId& dependent_id : node.dependents) {
+        nodes[dependent_id].skipped = true;
+      }
+    }
+    if (exception) std::rethrow_exception(exception);
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  CHECK_EQ(nr_unfinished_tasks_, 0u) << "TaskGraph::run is not reentrant.";
+  nr_unfinished_tasks_ = nodes_.size();
+  for (TaskId task_id = 0u; task_id < nodes_.size(); ++task_id) {
+    if (nodes_[task_id].nr_pending_dependencies == 0u) {
+      ready_tasks_.push_back(task_id);
+    }
+  }
+  cond_.notify_all();
+
+  while (nr_unfinished_tasks_ > 0u) {
+    if (ready_tasks_.empty()) {
+      cond_.wait(lock);
+      continue;
+    }
+    const TaskId task_id = ready_tasks_.front();
+    ready_tasks_.pop_front();
+    runTask(task_id, &lock);
+  }
+
+  nodes_.clear();
+  std::exception_ptr exception;
+  std::swap(exception, exception_);
+  lock.unlock();
+  if (exception) std::rethrow_exception(exception);
+}
+
+void TaskGraph::workerLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    cond_.wait(lock, [this]() { return shutdown_ || !ready_tasks_.empty(); });
+    if (shutdown_) return;
+    const TaskId task_id = ready_tasks_.front();
+    ready_tasks_.pop_front();
+    runTask(task_id, &lock);
+  }
+}
+
+void TaskGraph::runTask(const TaskId& task_id,
+                        std::unique_lock<std::mutex>* lock) {
+  CHECK_NOTNULL(lock);
+  // Nodes are not added while running: the reference stays valid.
+  Node& node = nodes_[task_id];
+  bool threw = node.skipped;
+  if (!node.skipped) {
+    lock->unlock();
+    try {
+      node.task();
+    } catch (...) {
+      threw = true;
+      lock->lock();
+      if (!exception_) exception_ = std::current_exception();
+      lock->unlock();
+    }
+    lock->lock();
+  }
+
+  bool has_new_ready_tasks = false;
+  for (const TaskId& dependent_id : node.dependents) {
+    Node& dependent = nodes_[dependent_id];
+    if (threw) dependent.skipped = true;
+    if (--dependent.nr_pending_dependencies == 0u) {
+      ready_tasks_.push_back(dependent_id);
+      has_new_ready_tasks = true;
+    }
+  }
+  --nr_unfinished_tasks_;
+  // Wakes up the workers for the new tasks, and run() if it was the last.
+  if (has_new_ready_tasks || nr_unfinished_tasks_ == 0u) cond_.notify_all();
+}
+
+}  // namespace utils
+
+}  // namespace VIO
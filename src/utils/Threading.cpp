@@ -0,0 +1,195 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   Threading.cpp
+ * @brief  CPU affinity of the pipeline threads, and control of the worker
+ * threads GTSAM spawns (if built with TBB).
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/utils/Threading.h"
+
+#include <mutex>
+#include <sstream>
+
+#include <glog/logging.h>
+
+#include <gtsam/config.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#endif
+
+#ifdef GTSAM_USE_TBB
+#include <tbb/global_control.h>
+#include <tbb/task_scheduler_observer.h>
+#endif
+
+namespace VIO {
+
+namespace utils {
+
+namespace {
+
+#ifdef __linux__
+bool setAffinity(const pthread_t& thread, const std::vector<int>& cpus) {
+  if (cpus.empty()) return true;
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (const int& cpu : cpus) {
+    CHECK_GE(cpu, 0);
+    CHECK_LT(cpu, CPU_SETSIZE);
+    CPU_SET(cpu, &cpu_set);
+  }
+  const int error = pthread_setaffinity_np(thread, sizeof(cpu_set), &cpu_set);
+  LOG_IF(ERROR, error != 0) << "Could not pin thread to CPUs "
+                            << cpusToString(cpus) << " (error " << error
+                            << ").";
+  return error == 0;
+}
+#endif
+
+}  // namespace
+
+bool setThreadAffinity(std::thread* thread, const std::vector<int>& cpus) {
+  CHECK_NOTNULL(thread);
+  if (cpus.empty()) return true;
+#ifdef __linux__
+  return setAffinity(thread->native_handle(), cpus);
+#else
+  LOG(WARNING) << "Thread affinity is only supported on Linux.";
+  return false;
+#endif
+}
+
+bool setCurrentThreadAffinity(const std::vector<int>& cpus) {
+  if (cpus.empty()) return true;
+#ifdef __linux__
+  return setAffinity(pthread_self(), cpus);
+#else
+  LOG(WARNING) << "Thread affinity is only supported on Linux.";
+  return false;
+#endif
+}
+
+bool setCurrentThreadLowPriority() {
+#ifdef __linux__
+  sched_param param;
+  param.sched_priority = 0;
+  if (pthread_setschedparam(pthread_self(), SCHED_IDLE, &param) == 0) {
+    return true;
+  }
+  // On Linux, the niceness is per thread.
+  const bool success = setpriority(PRIO_PROCESS, 0, 19) == 0;
+#else
+  // Elsewhere, this lowers the priority of the whole process: skip it.
+  const bool success = false;
+#endif
+  LOG_IF(WARNING, !success) << "Could not lower the thread priority.";
+  return success;
+}
+
+std::string cpusToString(const std::vector<int>& cpus) {
+  if (cpus.empty()) return "any";
+  std::stringstream ss;
+  ss << "{";
+  for (size_t i = 0u; i < cpus.size(); ++i) {
+    ss << (i == 0u ? "" : ", ") << cpus[i];
+  }
+  ss << "}";
+  return ss.str();
+}
+
+#ifdef GTSAM_USE_TBB
+//! Pins the TBB worker threads when they join the scheduler.
+class PinningObserver : public tbb::task_scheduler_observer {
+ public:
+  explicit PinningObserver(const std::vector<int>& cpus) : cpus_(cpus) {
+    observe(true);
+  }
+  ~PinningObserver() { observe(false); }
+
+  void on_scheduler_entry(bool is_worker) override {
+    if (is_worker) setCurrentThreadAffinity(cpus_);
+  }
+
+ private:
+  const std::vector<int> cpus_;
+};
+
+struct GtsamThreadingControl::Impl {
+  //! Guards the global control and its max number of threads.
+  std::mutex mutex;
+  int max_nr_threads = 0;
+  std::unique_ptr<tbb::global_control> global_control;
+  std::unique_ptr<PinningObserver> observer;
+};
+#else
+struct GtsamThreadingControl::Impl {};
+#endif
+
+GtsamThreadingControl::GtsamThreadingControl(const int& max_nr_threads,
+                                             const std::vector<int>& cpus)
+    : impl_(std::make_unique<Impl>()) {
+  CHECK_GE(max_nr_threads, 0);
+#ifdef GTSAM_USE_TBB
+  impl_->max_nr_threads = max_nr_threads;
+  if (max_nr_threads > 0) {
+    impl_->global_control = std::make_unique<tbb::global_control>(
+        tbb::global_control::max_allowed_parallelism,
+        static_cast<size_t>(max_nr_threads));
+  }
+  if (!cpus.empty()) impl_->observer = std::make_unique<PinningObserver>(cpus);
+#else
+  LOG_IF(WARNING, max_nr_threads > 0 || !cpus.empty())
+      << "GTSAM is not built with TBB: ignoring its threading params.";
+#endif
+}
+
+GtsamThreadingControl::~GtsamThreadingControl() = default;
+
+void GtsamThreadingControl::setMaxNrThreads(const int& max_nr_threads) {
+  CHECK_GE(max_nr_threads, 0);
+#ifdef GTSAM_USE_TBB
+  std::lock_guard<std::mutex> lock(impl_->mutex);
+  if (max_nr_threads == impl_->max_nr_threads) return;
+  impl_->max_nr_threads = max_nr_threads;
+  // The most restrictive of the live global controls applies: release the
+  // previous limit first.
+  impl_->global_control.reset();
+  if (max_nr_threads > 0) {
+    impl_->global_control = std::make_unique<tbb::global_control>(
+        tbb::global_control::max_allowed_parallelism,
+        static_cast<size_t>(max_nr_threads));
+  }
+#endif
+}
+
+bool GtsamThreadingControl::isTbbEnabled() {
+#ifdef GTSAM_USE_TBB
+  return true;
+#else
+  return false;
+#endif
+}
+
+size_t GtsamThreadingControl::getMaxNrThreads() {
+#ifdef GTSAM_USE_TBB
+  return tbb::global_control::active_value(
+      tbb::global_control::max_allowed_parallelism);
+#else
+  return 1u;
+#endif
+}
+
+}  // namespace utils
+
+}  // namespace VIO
@@ -43,9 +43,6 @@ namespace VIO {
 
 namespace utils {
 
-template <template <typename, typename> class Container, typename Type>
-using Aligned = Container<Type, Eigen::aligned_allocator<Type>>;
-
 ThreadsafeImuBuffer::QueryResult ThreadsafeImuBuffer::isDataAvailableUpToImpl(
     const Timestamp& timestamp_ns_from,
     const Timestamp& timestamp_ns_to) const {
@@ -60,14 +57,16 @@ ThreadsafeImuBuffer::QueryResult ThreadsafeImuBuffer::isDataAvailableUpToImpl(
   }
 
   ImuMeasurement value;
-  if (buffer_.getNewestValue(&value) && value.timestamp_ < timestamp_ns_to) {
+  if (buffer_.getNewestValue(&value.timestamp_, &value.acc_gyr_) &&
+      value.timestamp_ < timestamp_ns_to) {
     // This is triggered if the timestamp_ns_to requested exceeds the newest
     // IMU measurement, meaning that there is data still to arrive to reach the
     // requested point in time.
     return QueryResult::kDataNotYetAvailable;
   }
 
-  if (buffer_.getOldestValue(&value) && timestamp_ns_from < value.timestamp_) {
+  if (buffer_.getOldestValue(&value.timestamp_, &value.acc_gyr_) &&
+      timestamp_ns_from < value.timestamp_) {
     // This is triggered if the user requests data previous to the oldest IMU
     // measurement present in the buffer, meaning that there is missing data
     // from the timestamp_ns_from requested to the oldest stored timestamp.
@@ -78,7 +77,7 @@ ThreadsafeImuBuffer::QueryResult ThreadsafeImuBuffer::isDataAvailableUpToImpl(
 
 bool ThreadsafeImuBuffer::getNewestImuMeasurement(ImuMeasurement* value) {
   CHECK_NOTNULL(value);
-  return buffer_.getNewestValue(value);
+  return buffer_.getNewestValue(&value->timestamp_, &value->acc_gyr_);
 }
 
 void ThreadsafeImuBuffer::linearInterpolate(const Timestamp& t0,
@@ -112,14 +111,15 @@ ThreadsafeImuBuffer::QueryResult ThreadsafeImuBuffer::getImuDataBtwTimestamps(
     return query_result;
   }
 
-  // TODO can we avoid copying and have the temporal buffer store pairs of
-  // timestamps/accgyr data?
-  // Copy the data with timestamp_up_to <= timestamps_buffer from the buffer.
-  Aligned<std::vector, ImuMeasurement> between_values;
-  CHECK(buffer_.getValuesBetweenTimes(timestamp_ns_from, timestamp_ns_to,
-                                      &between_values, get_lower_bound));
+  // Copy the data with timestamp_up_to <= timestamps_buffer from the buffer,
+  // as contiguous blocks.
+  CHECK(buffer_.getValuesBetweenTimes(timestamp_ns_from,
+                                      timestamp_ns_to,
+                                      imu_timestamps,
+                                      imu_measurements,
+                                      get_lower_bound));
 
-  if (between_values.empty()) {
+  if (imu_timestamps->cols() == 0) {
     LOG(WARNING) << "No IMU measurements available strictly between time "
                  << timestamp_ns_from << "[ns] and " << timestamp_ns_to
                  << "[ns].";
@@ -128,15 +128,6 @@ ThreadsafeImuBuffer::QueryResult ThreadsafeImuBuffer::getImuDataBtwTimestamps(
     return QueryResult::kTooFewMeasurementsAvailable;
   }
 
-  const size_t num_measurements = between_values.size();
-  imu_timestamps->resize(Eigen::NoChange, num_measurements);
-  imu_measurements->resize(Eigen::NoChange, num_measurements);
-
-  for (size_t idx = 0u; idx < num_measurements; ++idx) {
-    (*imu_timestamps)(idx) = between_values[idx].timestamp_;
-    (*imu_measurements).col(idx) = between_values[idx].acc_gyr_;
-  }
-
   return query_result;
 }
 
@@ -231,21 +222,19 @@ void ThreadsafeImuBuffer::interpolateValueAtTimestamp(
     ImuAccGyr* interpolated_imu_measurement) {
   CHECK_NOTNULL(interpolated_imu_measurement);
   Timestamp pre_border_timestamp, post_border_timestamp;
-  ImuMeasurement pre_border_value, post_border_value;
+  ImuAccGyr pre_border_value, post_border_value;
   CHECK(buffer_.getValueAtOrBeforeTime(timestamp_ns, &pre_border_timestamp,
                                        &pre_border_value))
       << "The IMU buffer seems not to contain measurements at or before time: "
       << timestamp_ns;
-  CHECK_EQ(pre_border_timestamp, pre_border_value.timestamp_);
   CHECK(buffer_.getValueAtOrAfterTime(timestamp_ns, &post_border_timestamp,
                                       &post_border_value))
       << "The IMU buffer seems not to contain measurements at or after time: "
       << timestamp_ns;
-  CHECK_EQ(post_border_timestamp, post_border_value.timestamp_);
-  linearInterpolate(pre_border_value.timestamp_,
-                    pre_border_value.acc_gyr_,
-                    post_border_value.timestamp_,
-                    post_border_value.acc_gyr_,
+  linearInterpolate(pre_border_timestamp,
+                    pre_border_value,
+                    post_border_timestamp,
+                    post_border_value,
                     timestamp_ns,
                     interpolated_imu_measurement);
 }
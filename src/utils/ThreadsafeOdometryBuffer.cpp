@@ -13,6 +13,11 @@
  */
 
 #include "kimera-vio/utils/ThreadsafeOdometryBuffer.h"
+
+#include <iterator>
+
+#include <gtsam/base/Lie.h>
+
 #include "kimera-vio/utils/UtilsNumerical.h"
 
 namespace VIO {
@@ -31,33 +36,103 @@ void ThreadsafeOdometryBuffer::add(const Timestamp& time,
 ThreadsafeOdometryBuffer::QueryResult ThreadsafeOdometryBuffer::getNearest(
     const Timestamp& timestamp,
     gtsam::NavState* odometry) {
-  if (buffer_.empty()) {
-    return QueryResult::DataNotYetAvailable;
+  CHECK_NOTNULL(odometry);
+  buffer_.lockContainer();
+  const QueryResult result = getNearestLocked(timestamp, odometry);
+  buffer_.unlockContainer();
+  return result;
+}
+
+ThreadsafeOdometryBuffer::QueryResult
+ThreadsafeOdometryBuffer::getInterpolated(const Timestamp& timestamp,
+                                          gtsam::NavState* odometry) {
+  CHECK_NOTNULL(odometry);
+  buffer_.lockContainer();
+  const QueryResult result = getInterpolatedLocked(timestamp, odometry);
+  buffer_.unlockContainer();
+  return result;
+}
+
+ThreadsafeOdometryBuffer::QueryResult
+ThreadsafeOdometryBuffer::getRelativePose(const Timestamp& timestamp_from,
+                                          const Timestamp& timestamp_to,
+                                          gtsam::Pose3* from_Pose_to) {
+  CHECK_NOTNULL(from_Pose_to);
+  CHECK_LE(timestamp_from, timestamp_to);
+  gtsam::NavState odometry_from, odometry_to;
+  buffer_.lockContainer();
+  QueryResult result = getInterpolatedLocked(timestamp_from, &odometry_from);
+  if (result == QueryResult::DataAvailable) {
+    result = getInterpolatedLocked(timestamp_to, &odometry_to);
+  }
+  buffer_.unlockContainer();
+  if (result == QueryResult::DataAvailable) {
+    *from_Pose_to = odometry_from.pose().between(odometry_to.pose());
   }
+  return result;
+}
 
-  Odometry oldest;
-  CHECK(buffer_.getOldestValue(&oldest))
-      << "odomety buffer failed to get oldest value";
-  if (oldest.timestamp > timestamp) {
+ThreadsafeOdometryBuffer::QueryResult
+ThreadsafeOdometryBuffer::getNearestLocked(const Timestamp& timestamp,
+                                           gtsam::NavState* odometry) const {
+  const auto& values = buffer_.buffered_values();
+  if (values.empty()) {
+    return QueryResult::DataNotYetAvailable;
+  }
+  if (values.begin()->first > timestamp) {
     return QueryResult::DataNeverAvailable;
   }
-
-  Odometry newest;
-  CHECK(buffer_.getNewestValue(&newest))
-      << "odometry buffer failed to get newest value";
-
-  if (newest.timestamp < timestamp) {
+  // First measurement at or after the timestamp.
+  auto it_after = values.lower_bound(timestamp);
+  if (it_after == values.end()) {
     return QueryResult::DataNotYetAvailable;
   }
 
-  Odometry m_nearest;
-  buffer_.getNearestValueToTime(timestamp, &m_nearest);
+  // As getNearestValueToTime: ties go to the later measurement.
+  const Odometry* nearest = &it_after->second;
+  if (it_after->first != timestamp) {
+    const auto it_before = std::prev(it_after);
+    if (timestamp - it_before->first < it_after->first - timestamp) {
+      nearest = &it_before->second;
+    }
+  }
   VLOG(10) << "Found odom measurement with t="
-           << UtilsNumerical::NsecToSec(m_nearest.timestamp) << " which is "
-           << UtilsNumerical::NsecToSec(m_nearest.timestamp - timestamp)
+           << UtilsNumerical::NsecToSec(nearest->timestamp) << " which is "
+           << UtilsNumerical::NsecToSec(nearest->timestamp - timestamp)
            << " seconds away from t=" << UtilsNumerical::NsecToSec(timestamp);
 
-  *odometry = m_nearest.value;
+  *odometry = nearest->value;
+  return QueryResult::DataAvailable;
+}
+
+ThreadsafeOdometryBuffer::QueryResult
+ThreadsafeOdometryBuffer::getInterpolatedLocked(
+    const Timestamp& timestamp,
+    gtsam::NavState* odometry) const {
+  const auto& values = buffer_.buffered_values();
+  if (values.empty()) {
+    return QueryResult::DataNotYetAvailable;
+  }
+  if (values.begin()->first > timestamp) {
+    return QueryResult::DataNeverAvailable;
+  }
+  auto it_after = values.lower_bound(timestamp);
+  if (it_after == values.end()) {
+    return QueryResult::DataNotYetAvailable;
+  }
+  if (it_after->first == timestamp) {
+    *odometry = it_after->second.value;
+    return QueryResult::DataAvailable;
+  }
+
+  const auto it_before = std::prev(it_after);
+  const gtsam::NavState& before = it_before->second.value;
+  const gtsam::NavState& after = it_after->second.value;
+  const double alpha = static_cast<double>(timestamp - it_before->first) /
+                       static_cast<double>(it_after->first - it_before->first);
+  *odometry = gtsam::NavState(
+      gtsam::interpolate(before.pose(), after.pose(), alpha),
+      before.velocity() + alpha * (after.velocity() - before.velocity()));
   return QueryResult::DataAvailable;
 }
 
@@ -0,0 +1,335 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   Tracing.cpp
+ * @brief  Scoped trace events per thread, exported to the Chrome trace event
+ * format (chrome://tracing, ui.perfetto.dev).
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/utils/Tracing.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+namespace utils {
+
+std::atomic_bool Tracer::enabled_(false);
+constexpr int64_t Tracer::kNoCorrelationId;
+constexpr size_t Tracer::kEventsPerThread;
+
+struct Tracer::Event {
+  const char* name = nullptr;
+  int64_t begin_ns = 0;
+  int64_t end_ns = 0;
+  int64_t correlation_id = kNoCorrelationId;
+  //! Counter samples are at begin_ns (= end_ns), without correlation id.
+  bool is_counter = false;
+  double counter_value = 0.0;
+};
+
+// Ring buffer with a single writer, the owning thread. Readers copy the
+// events and then drop those the writer may have overwritten meanwhile.
+class Tracer::ThreadBuffer {
+ public:
+  KIMERA_DELETE_COPY_CONSTRUCTORS(ThreadBuffer);
+  static_assert((kEventsPerThread & (kEventsPerThread - 1u)) == 0u,
+                "kEventsPerThread must be a power of two.");
+
+  explicit ThreadBuffer(const size_t& thread_id)
+      : thread_id_(thread_id), events_(kEventsPerThread), nr_events_(0u) {}
+
+  inline void push(const Event& event) {
+    const size_t nr_events = nr_events_.load(std::memory_order_relaxed);
+    events_[nr_events & kMask] = event;
+    nr_events_.store(nr_events + 1u, std::memory_order_release);
+  }
+
+  void copyEvents(std::vector<Event>* events) const {
+    CHECK_NOTNULL(events);
+    events->clear();
+    const size_t end = nr_events_.load(std::memory_order_acquire);
+    const size_t begin = end > kEventsPerThread ? end - kEventsPerThread : 0u;
+    for (size_t i = begin; i < end; ++i) {
+      events->push_back(events_[i & kMask]);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const size_t new_end = nr_events_.load(std::memory_order_relaxed);
+    if (new_end > end) {
+      // The oldest events may have been overwritten while copying.
+      const size_t nr_overwritten = std::min(end - begin, new_end - end);
+      events->erase(events->begin(), events->begin() + nr_overwritten);
+    }
+  }
+
+  inline size_t size() const {
+    return std::min(nr_events_.load(std::memory_order_acquire),
+                    kEventsPerThread);
+  }
+
+  inline void clear() { nr_events_.store(0u, std::memory_order_release); }
+
+ public:
+  const size_t thread_id_;
+  //! Guarded by the mutex of the tracer.
+  std::string thread_name_;
+
+ private:
+  static constexpr size_t kMask = kEventsPerThread - 1u;
+  std::vector<Event> events_;
+  std::atomic<size_t> nr_events_;
+};
+
+struct Tracer::State {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadBuffer>> thread_buffers;
+  //! Node based: pointers to the names stay valid.
+  std::unordered_set<std::string> interned_names;
+};
+
+namespace {
+
+void writeJsonString(std::ostream* out, const char* str) {
+  CHECK_NOTNULL(out);
+  *out << '"';
+  for (const char* c = str; *c != '\0'; ++c) {
+    switch (*c) {
+      case '"':
+        *out << "\\\"";
+        break;
+      case '\\':
+        *out << "\\\\";
+        break;
+      case '\n':
+        *out << "\\n";
+        break;
+      case '\t':
+        *out << "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(*c) < 0x20) {
+          *out << ' ';
+        } else {
+          *out << *c;
+        }
+    }
+  }
+  *out << '"';
+}
+
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+void Tracer::enable() {
+  enabled_.store(true, std::memory_order_relaxed);
+  LOG(INFO) << "Tracing enabled: keeping the latest " << kEventsPerThread
+            << " events per thread.";
+}
+
+void Tracer::disable() { enabled_.store(false, std::memory_order_relaxed); }
+
+const char* Tracer::internName(const std::string& name) {
+  auto& state = getState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  return state.interned_names.insert(name).first->c_str();
+}
+
+void Tracer::setCurrentThreadName(const std::string& name) {
+  // Avoids allocating buffers for the threads of untraced runs.
+  if (!isEnabled()) return;
+  ThreadBuffer* thread_buffer = getThreadBuffer();
+  auto& state = getState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  thread_buffer->thread_name_ = name;
+}
+
+void Tracer::record(const char* name,
+                    const int64_t& begin_ns,
+                    const int64_t& end_ns,
+                    const int64_t& correlation_id) {
+  if (!isEnabled()) return;
+  DCHECK(name);
+  Event event;
+  event.name = name;
+  event.begin_ns = begin_ns;
+  event.end_ns = end_ns;
+  event.correlation_id = correlation_id;
+  getThreadBuffer()->push(event);
+}
+
+void Tracer::recordCounter(const char* name,
+                           const int64_t& time_ns,
+                           const double& value) {
+  if (!isEnabled()) return;
+  DCHECK(name);
+  Event event;
+  event.name = name;
+  event.begin_ns = time_ns;
+  event.end_ns = time_ns;
+  event.is_counter = true;
+  event.counter_value = value;
+  getThreadBuffer()->push(event);
+}
+
+void Tracer::clear() {
+  auto& state = getState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  for (const auto& thread_buffer : state.thread_buffers) {
+    thread_buffer->clear();
+  }
+}
+
+size_t Tracer::getNumberOfEvents() {
+  auto& state = getState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  size_t nr_events = 0u;
+  for (const auto& thread_buffer : state.thread_buffers) {
+    nr_events += thread_buffer->size();
+  }
+  return nr_events;
+}
+
+/* -------------------------------------------------------------------------- */
+void Tracer::writeChromeTrace(std::ostream& out) {
+  struct ThreadEvent {
+    size_t thread_id;
+    Event event;
+  };
+  std::vector<ThreadEvent> thread_events;
+  std::vector<std::pair<size_t, std::string>> thread_names;
+  {
+    auto& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    std::vector<Event> events;
+    for (const auto& thread_buffer : state.thread_buffers) {
+      thread_buffer->copyEvents(&events);
+      for (const Event& event : events) {
+        thread_events.push_back({thread_buffer->thread_id_, event});
+      }
+      if (!thread_buffer->thread_name_.empty()) {
+        thread_names.emplace_back(thread_buffer->thread_id_,
+                                  thread_buffer->thread_name_);
+      }
+    }
+  }
+  std::stable_sort(thread_events.begin(),
+                   thread_events.end(),
+                   [](const ThreadEvent& a, const ThreadEvent& b) {
+                     return a.event.begin_ns < b.event.begin_ns;
+                   });
+
+  // Microseconds since the first event, as expected by the viewers.
+  const int64_t start_ns =
+      thread_events.empty() ? 0 : thread_events.front().event.begin_ns;
+  const auto to_us = [&start_ns](const int64_t& time_ns) {
+    return static_cast<double>(time_ns - start_ns) * 1.0e-3;
+  };
+
+  const auto prec = out.precision();
+  out << std::fixed << std::setprecision(3);
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+         "\"args\":{\"name\":\"Kimera-VIO\"}}";
+  for (const auto& thread_name : thread_names) {
+    out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+        << thread_name.first << ",\"args\":{\"name\":";
+    writeJsonString(&out, thread_name.second.c_str());
+    out << "}}";
+  }
+
+  // Complete and counter events. Correlation ids are written as strings: they
+  // may not fit in the doubles of JSON readers (e.g. timestamps in
+  // nanoseconds).
+  std::unordered_map<int64_t, std::vector<size_t>> correlated_events;
+  for (size_t i = 0u; i < thread_events.size(); ++i) {
+    const ThreadEvent& thread_event = thread_events[i];
+    const Event& event = thread_event.event;
+    out << ",\n{\"name\":";
+    writeJsonString(&out, event.name);
+    if (event.is_counter) {
+      // Counters are per process in the viewers.
+      out << ",\"cat\":\"kimera\",\"ph\":\"C\",\"pid\":1,\"ts\":"
+          << to_us(event.begin_ns) << ",\"args\":{\"value\":"
+          << event.counter_value << "}}";
+      continue;
+    }
+    out << ",\"cat\":\"kimera\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+        << thread_event.thread_id << ",\"ts\":" << to_us(event.begin_ns)
+        << ",\"dur\":" << to_us(event.end_ns) - to_us(event.begin_ns);
+    if (event.correlation_id != kNoCorrelationId) {
+      out << ",\"args\":{\"id\":\"" << event.correlation_id << "\"}";
+      correlated_events[event.correlation_id].push_back(i);
+    }
+    out << "}";
+  }
+
+  // Flow events linking the spans with the same correlation id, in order.
+  for (const auto& correlated : correlated_events) {
+    const std::vector<size_t>& indices = correlated.second;
+    if (indices.size() < 2u) continue;
+    for (size_t k = 0u; k < indices.size(); ++k) {
+      const ThreadEvent& thread_event = thread_events[indices[k]];
+      const char* phase =
+          k == 0u ? "s" : (k + 1u == indices.size() ? "f" : "t");
+      out << ",\n{\"name\":\"flow\",\"cat\":\"kimera\",\"ph\":\"" << phase
+          << "\",\"id\":\"" << correlated.first << "\",\"pid\":1,\"tid\":"
+          << thread_event.thread_id
+          << ",\"ts\":" << to_us(thread_event.event.begin_ns);
+      if (k > 0u) out << ",\"bp\":\"e\"";
+      out << "}";
+    }
+  }
+  out << "\n]}\n";
+  out << std::setprecision(prec) << std::defaultfloat;
+}
+
+bool Tracer::writeChromeTrace(const std::string& path) {
+  std::ofstream output_file(path);
+  if (!output_file) {
+    LOG(ERROR) << "Could not write trace: Unable to open file: " << path;
+    return false;
+  }
+  VLOG(1) << "Writing trace to file: " << path;
+  writeChromeTrace(output_file);
+  return static_cast<bool>(output_file);
+}
+
+/* -------------------------------------------------------------------------- */
+Tracer::ThreadBuffer* Tracer::getThreadBuffer() {
+  thread_local ThreadBuffer* thread_buffer = nullptr;
+  if (!thread_buffer) {
+    auto& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.thread_buffers.push_back(
+        std::make_unique<ThreadBuffer>(state.thread_buffers.size() + 1u));
+    thread_buffer = state.thread_buffers.back().get();
+  }
+  return thread_buffer;
+}
+
+Tracer::State& Tracer::getState() {
+  // Never destroyed: threads may still record while the program exits.
+  static State* state = new State();
+  return *state;
+}
+
+}  // namespace utils
+
+}  // namespace VIO
@@ -388,11 +388,22 @@ std::pair<double, double> UtilsOpenCV::ComputeRotationAndTranslationErrors(
 /* -------------------------------------------------------------------------- */
 // Reads image and converts to 1 channel image.
 cv::Mat UtilsOpenCV::ReadAndConvertToGrayScale(const std::string& img_name,
-                                               bool equalize) {
-  cv::Mat img = cv::imread(img_name, cv::IMREAD_ANYCOLOR);
+                                               bool equalize,
+                                               cv::MatAllocator* allocator) {
+  cv::Mat img;
+  img.allocator = allocator;
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 10)
+  // Decode straight into a buffer of the allocator.
+  cv::imread(img_name, img, cv::IMREAD_ANYCOLOR);
+#else
+  img = cv::imread(img_name, cv::IMREAD_ANYCOLOR);
+#endif
   if (img.channels() > 1) {
     LOG(WARNING) << "Converting img from BGR to GRAY...";
-    cv::cvtColor(img, img, cv::COLOR_BGR2GRAY);
+    cv::Mat gray_img;
+    gray_img.allocator = allocator;
+    cv::cvtColor(img, gray_img, cv::COLOR_BGR2GRAY);
+    img = gray_img;
   }
   // Apply Histogram Equalization
   if (equalize) {
@@ -557,32 +568,44 @@ void UtilsOpenCV::DrawTextInPlace(cv::Mat& img,
           color);
   }
 }
+/* -------------------------------------------------------------------------- */
+cv::Mat UtilsOpenCV::CopyForDrawing(const cv::Mat& img) {
+  cv::Mat img_bgr;
+  if (img.channels() == 1) {
+    cv::cvtColor(img, img_bgr, cv::COLOR_GRAY2BGR);
+  } else {
+    img_bgr = img.clone();
+  }
+  return img_bgr;
+}
+
 /* -------------------------------------------------------------------------- */
 // Concatenate two images and return results as a new mat.
-// Clones the two images.
+// The images are written directly in it, without intermediate copies.
 cv::Mat UtilsOpenCV::concatenateTwoImages(const cv::Mat& left_img,
                                           const cv::Mat& right_img) {
-  cv::Mat left_img_tmp = left_img.clone();
-  if (left_img_tmp.channels() == 1) {
-    cv::cvtColor(left_img_tmp, left_img_tmp, cv::COLOR_GRAY2BGR);
-  }
-  cv::Mat right_img_tmp = right_img.clone();
-  if (right_img_tmp.channels() == 1) {
-    cv::cvtColor(right_img_tmp, right_img_tmp, cv::COLOR_GRAY2BGR);
-  }
-  cv::Size left_img_size = left_img_tmp.size();
-  cv::Size right_img_size = right_img_tmp.size();
+  const cv::Size left_img_size = left_img.size();
+  const cv::Size right_img_size = right_img.size();
   cv::Mat dual_img(left_img_size.height,
                    left_img_size.width + right_img_size.width,
                    CV_8UC3);
   cv::Mat left(dual_img,
                cv::Rect(0, 0, left_img_size.width, left_img_size.height));
-  left_img_tmp.copyTo(left);
   cv::Mat right(
       dual_img,
       cv::Rect(
           left_img_size.width, 0, right_img_size.width, right_img_size.height));
-  right_img_tmp.copyTo(right);
+  // The destinations have the right size and type: no reallocation.
+  if (left_img.channels() == 1) {
+    cv::cvtColor(left_img, left, cv::COLOR_GRAY2BGR);
+  } else {
+    left_img.copyTo(left);
+  }
+  if (right_img.channels() == 1) {
+    cv::cvtColor(right_img, right, cv::COLOR_GRAY2BGR);
+  } else {
+    right_img.copyTo(right);
+  }
   return dual_img;
 }
 
@@ -693,10 +716,7 @@ cv::Mat UtilsOpenCV::DrawCircles(const cv::Mat img,
                                  const bool& display_with_size,
                                  const bool& display_with_text) {
   KeypointCV text_offset(-10.0, -5.0);
-  cv::Mat img_color = img.clone();
-  if (img_color.channels() < 3) {
-    cv::cvtColor(img_color, img_color, cv::COLOR_GRAY2BGR);
-  }
+  cv::Mat img_color = CopyForDrawing(img);
 
   for (size_t i = 0u; i < image_points.size(); i++) {
     double circle_size = 3.0;
@@ -781,18 +801,17 @@ double UtilsOpenCV::MaxAbsValue(gtsam::Matrix M) {
 // compute image gradients (TODO: untested: taken from
 // http://www.coldvision.io/2016/03/18/image-gradient-sobel-operator-opencv-3-x-cuda/)
 cv::Mat UtilsOpenCV::ImageLaplacian(const cv::Mat& img) {
-  // duplicate image to preserve const input
-  cv::Mat input = img.clone();
-
-  // blur the input image to remove the noise
-  cv::GaussianBlur(input, input, cv::Size(3, 3), 0, 0, cv::BORDER_DEFAULT);
+  // blur the input image to remove the noise (into a new image, the input is
+  // shared)
+  cv::Mat input;
+  cv::GaussianBlur(img, input, cv::Size(3, 3), 0, 0, cv::BORDER_DEFAULT);
 
   // convert it to grayscale (CV_8UC3 -> CV_8UC1)
   cv::Mat input_gray;
   if (input.channels() > 1)
     cv::cvtColor(input, input_gray, cv::COLOR_RGB2GRAY);
   else
-    input_gray = input.clone();
+    input_gray = input;
 
   // compute the gradients on both directions x and y
   cv::Mat grad_x, grad_y;
@@ -820,9 +839,9 @@ cv::Mat UtilsOpenCV::ImageLaplacian(const cv::Mat& img) {
 // compute canny edges (TODO: untested: taken from
 // https://github.com/opencv/opencv/blob/master/samples/cpp/edge.cpp)
 cv::Mat UtilsOpenCV::EdgeDetectorCanny(const cv::Mat& img) {
-  // duplicate image to preserve const input
-  cv::Mat input = img.clone();
-  cv::equalizeHist(input, input);
+  // equalize into a new image, the input is shared
+  cv::Mat input;
+  cv::equalizeHist(img, input);
 
   // blur the input image to remove the noise
   cv::GaussianBlur(input, input, cv::Size(3, 3), 0, 0, cv::BORDER_DEFAULT);
@@ -832,7 +851,7 @@ cv::Mat UtilsOpenCV::EdgeDetectorCanny(const cv::Mat& img) {
   if (input.channels() > 1)
     cv::cvtColor(input, input_gray, cv::COLOR_RGB2GRAY);
   else
-    input_gray = input.clone();
+    input_gray = input;
 
   // Run the edge detector on grayscale
   cv::Mat edges;
@@ -874,8 +893,7 @@ UtilsOpenCV::FindHighIntensityInTriangle(const cv::Mat img,
   if (isDebug) {
     std::vector<cv::Point> pts(3);
     cv::minMaxLoc(img, &min, &max);
-    imgCopy = img.clone();
-    cv::cvtColor(imgCopy, imgCopy, cv::COLOR_GRAY2BGR);
+    imgCopy = CopyForDrawing(img);
     pts[0] = cv::Point(x0, y0);
     pts[1] = cv::Point(x1, y1);
     pts[2] = cv::Point(x2, y2);
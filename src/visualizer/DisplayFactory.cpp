@@ -8,12 +8,66 @@
 
 /**
  * @file   DisplayFactory.cpp
- * @brief
+ * @brief  Display factory
  * @author Antoni Rosinol
  */
 
 #include "kimera-vio/visualizer/DisplayFactory.h"
 
+#include <map>
+#include <mutex>
+
 namespace VIO {
 
+namespace {
+
+struct DisplayRegistry {
+  std::mutex mutex_;
+  std::map<DisplayType, DisplayFactory::DisplayCreator> creators_;
+};
+
+//! Constructed on first use: displays register from static initializers.
+DisplayRegistry& getDisplayRegistry() {
+  static DisplayRegistry registry;
+  return registry;
+}
+
+}  // namespace
+
+bool DisplayFactory::registerDisplay(const DisplayType& display_type,
+                                     const DisplayCreator& creator) {
+  CHECK(creator);
+  DisplayRegistry& registry = getDisplayRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex_);
+  registry.creators_[display_type] = creator;
+  return true;
+}
+
+bool DisplayFactory::isDisplayRegistered(const DisplayType& display_type) {
+  DisplayRegistry& registry = getDisplayRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex_);
+  return registry.creators_.count(display_type) > 0u;
+}
+
+DisplayBase::UniquePtr DisplayFactory::makeDisplay(
+    const DisplayType& display_type,
+    DisplayParams::Ptr display_params,
+    const ShutdownPipelineCallback& shutdown_pipeline_cb) {
+  DisplayCreator creator;
+  {
+    DisplayRegistry& registry = getDisplayRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex_);
+    const auto it = registry.creators_.find(display_type);
+    if (it != registry.creators_.end()) creator = it->second;
+  }
+  if (!creator) {
+    LOG(ERROR) << "Requested display type is not built: "
+               << VIO::to_underlying(display_type) << "\n"
+               << "Display types: 0: OpenCV 3D viz, 1: Pangolin "
+               << "(both need KIMERA_BUILD_GUI), 2: Telemetry.";
+    return nullptr;
+  }
+  return creator(display_params, shutdown_pipeline_cb);
+}
+
 }  // namespace VIO
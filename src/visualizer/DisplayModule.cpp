@@ -16,14 +16,40 @@
 
 #include <glog/logging.h>
 
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
 namespace VIO {
 
+namespace {
+// The images of the new input, plus the stale ones of other windows.
+std::vector<ImageToDisplay> mergeImages(
+    std::vector<ImageToDisplay>&& stale_images,
+    std::vector<ImageToDisplay>&& new_images) {
+  std::unordered_set<std::string> new_names;
+  for (const ImageToDisplay& image : new_images) new_names.insert(image.name_);
+  for (ImageToDisplay& image : stale_images) {
+    if (new_names.count(image.name_) == 0u) {
+      new_images.push_back(std::move(image));
+    }
+  }
+  return std::move(new_images);
+}
+}  // namespace
+
 DisplayModule::DisplayModule(DisplayQueue* input_queue,
                              OutputQueue* output_queue,
                              bool parallel_run,
-                             DisplayBase::UniquePtr&& display)
+                             DisplayBase::UniquePtr&& display,
+                             const double& target_fps)
     : SISO(input_queue, output_queue, "Display", parallel_run),
-      display_(std::move(display)) {}
+      display_(std::move(display)),
+      target_fps_(target_fps),
+      last_display_time_() {
+  CHECK_GE(target_fps_, 0.0);
+}
 
 DisplayModule::OutputUniquePtr DisplayModule::spinOnce(InputUniquePtr input) {
   CHECK(input);
@@ -32,10 +58,17 @@ DisplayModule::OutputUniquePtr DisplayModule::spinOnce(InputUniquePtr input) {
 }
 
 typename DisplayModule::MISO::InputUniquePtr DisplayModule::getInputPacket() {
-  if (display_ && display_->display_type_ == DisplayType::kPangolin) {
-    // If we are using pangolin just fake a constant input of messages
-    // to not block the visualizer.
-    return std::make_unique<DisplayInputBase>();
+  if (target_fps_ > 0.0 && last_display_time_) {
+    const auto next_display_time =
+        *last_display_time_ +
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / target_fps_));
+    if (MISO::parallel_run_) {
+      // Meanwhile, the inputs are merged in the input queue.
+      std::this_thread::sleep_until(next_display_time);
+    } else if (std::chrono::steady_clock::now() < next_display_time) {
+      return nullptr;
+    }
   }
 
   typename MISO::InputUniquePtr input = nullptr;
@@ -48,6 +81,7 @@ typename DisplayModule::MISO::InputUniquePtr DisplayModule::getInputPacket() {
   }
 
   if (queue_state) {
+    last_display_time_ = std::chrono::steady_clock::now();
     return input;
   } else {
     VLOG(10) << "Module: " << MISO::name_id_ << " - "
@@ -57,4 +91,43 @@ typename DisplayModule::MISO::InputUniquePtr DisplayModule::getInputPacket() {
   }
 }
 
+DisplayModule::InputUniquePtr DisplayModule::mergeInputs(
+    InputUniquePtr stale_input,
+    InputUniquePtr new_input) {
+  CHECK(stale_input);
+  CHECK(new_input);
+  VisualizerOutput* stale_viz_output =
+      dynamic_cast<VisualizerOutput*>(stale_input.get());
+  VisualizerOutput* new_viz_output =
+      dynamic_cast<VisualizerOutput*>(new_input.get());
+
+  if (stale_viz_output && !new_viz_output) {
+    // E.g. an image of the Frontend after a visualizer output.
+    stale_input->timestamp_ = new_input->timestamp_;
+    stale_input->images_to_display_ =
+        mergeImages(std::move(stale_input->images_to_display_),
+                    std::move(new_input->images_to_display_));
+    return stale_input;
+  }
+
+  if (stale_viz_output && new_viz_output) {
+    // The display removes widgets before adding the new ones.
+    WidgetIds& widget_ids_to_remove = stale_viz_output->widget_ids_to_remove_;
+    for (const std::string& widget_id : new_viz_output->widget_ids_to_remove_) {
+      stale_viz_output->widgets_.erase(widget_id);
+      widget_ids_to_remove.push_back(widget_id);
+    }
+    new_viz_output->widget_ids_to_remove_ = std::move(widget_ids_to_remove);
+    for (auto& widget : stale_viz_output->widgets_) {
+      // Does not replace the new widgets.
+      new_viz_output->widgets_.try_emplace(widget.first,
+                                           std::move(widget.second));
+    }
+  }
+  new_input->images_to_display_ =
+      mergeImages(std::move(stale_input->images_to_display_),
+                  std::move(new_input->images_to_display_));
+  return new_input;
+}
+
 }  // namespace VIO
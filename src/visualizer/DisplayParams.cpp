@@ -14,6 +14,7 @@
 
 #include "kimera-vio/visualizer/DisplayParams.h"
 
+#include <cmath>
 #include <fstream>
 #include <iostream>
 
@@ -28,19 +29,29 @@ DisplayParams::DisplayParams(const DisplayType& display_type)
     : PipelineParams("Display Parameters"), display_type_(display_type) {}
 
 // Parse YAML file describing camera parameters.
-bool DisplayParams::parseYAML(const std::string& filepath) { return true; }
+bool DisplayParams::parseYAML(const std::string& filepath) {
+  YamlParser yaml_parser(filepath);
+  if (yaml_parser.hasParam("target_fps")) {
+    yaml_parser.getYamlParam("target_fps", &target_fps_);
+  }
+  return true;
+}
 
 // Display all params.
 void DisplayParams::print() const {
   std::stringstream out;
-  PipelineParams::print(
-      out, "Display Type ", VIO::to_underlying(display_type_));
+  PipelineParams::print(out,
+                        "Display Type ",
+                        VIO::to_underlying(display_type_),
+                        "Target FPS ",
+                        target_fps_);
 }
 
 // Assert equality up to a tolerance.
 bool DisplayParams::equals(const DisplayParams& cam_par,
                            const double& tol) const {
-  return display_type_ == cam_par.display_type_;
+  return display_type_ == cam_par.display_type_ &&
+         std::fabs(target_fps_ - cam_par.target_fps_) <= tol;
 }
 
 }  // namespace VIO
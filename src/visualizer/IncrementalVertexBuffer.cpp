@@ -0,0 +1,135 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   IncrementalVertexBuffer.cpp
+ * @brief  Host copy of a GPU vertex buffer, tracking what to upload.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/visualizer/IncrementalVertexBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+namespace {
+//! Initial capacity of the GPU buffers, in points.
+constexpr size_t kMinCapacity = 1024u;
+//! Ranges of dirty points closer than this are uploaded as one.
+constexpr size_t kMaxRangeGap = 16u;
+}  // namespace
+
+IncrementalVertexBuffer::IncrementalVertexBuffer(
+    const float& position_tolerance)
+    : position_tolerance_(position_tolerance),
+      data_(),
+      lmk_ids_(),
+      slots_(),
+      dirty_slots_(),
+      capacity_(0u),
+      reallocate_(false) {
+  CHECK_GE(position_tolerance_, 0.0f);
+}
+
+void IncrementalVertexBuffer::append(const TelemetryPoint& point) {
+  CHECK(lmk_ids_.empty()) << "Appending to a buffer of landmarks.";
+  data_.insert(data_.end(), point.begin(), point.end());
+  dirty_slots_.push_back(size() - 1u);
+  if (size() > capacity_) {
+    capacity_ = std::max(2u * capacity_, kMinCapacity);
+    reallocate_ = true;
+  }
+}
+
+void IncrementalVertexBuffer::update(const TelemetryPoints& points) {
+  CHECK_EQ(lmk_ids_.size(), size()) << "Updating a buffer appended to.";
+  // From the last slot, so that the points moved to the slots of the
+  // removed ones are already known to stay.
+  for (size_t slot = size(); slot > 0u; --slot) {
+    const size_t removed = slot - 1u;
+    if (points.count(lmk_ids_[removed]) > 0u) continue;
+    slots_.erase(lmk_ids_[removed]);
+    const size_t last = size() - 1u;
+    if (removed != last) {
+      std::copy(data_.begin() + 3u * last,
+                data_.begin() + 3u * last + 3u,
+                data_.begin() + 3u * removed);
+      lmk_ids_[removed] = lmk_ids_[last];
+      slots_[lmk_ids_[removed]] = removed;
+      dirty_slots_.push_back(removed);
+    }
+    data_.resize(3u * last);
+    lmk_ids_.pop_back();
+  }
+
+  for (const auto& lmk : points) {
+    const auto it = slots_.find(lmk.first);
+    if (it != slots_.end()) {
+      setPoint(it->second, lmk.second);
+      continue;
+    }
+    slots_.emplace(lmk.first, size());
+    data_.insert(data_.end(), lmk.second.begin(), lmk.second.end());
+    lmk_ids_.push_back(lmk.first);
+    dirty_slots_.push_back(size() - 1u);
+  }
+  if (size() > capacity_) {
+    capacity_ = std::max(std::max(2u * capacity_, size()), kMinCapacity);
+    reallocate_ = true;
+  }
+}
+
+bool IncrementalVertexBuffer::takeDirtyRanges(std::vector<SlotRange>* ranges) {
+  CHECK_NOTNULL(ranges)->clear();
+  if (reallocate_) {
+    if (size() > 0u) ranges->push_back({0u, size()});
+    dirty_slots_.clear();
+    reallocate_ = false;
+    return true;
+  }
+
+  std::sort(dirty_slots_.begin(), dirty_slots_.end());
+  for (const size_t& slot : dirty_slots_) {
+    // Removed since.
+    if (slot >= size()) break;
+    if (!ranges->empty() && slot <= ranges->back().end + kMaxRangeGap) {
+      ranges->back().end = std::max(ranges->back().end, slot + 1u);
+    } else {
+      ranges->push_back({slot, slot + 1u});
+    }
+  }
+  dirty_slots_.clear();
+  return false;
+}
+
+bool IncrementalVertexBuffer::getSlot(const LandmarkId& lmk_id,
+                                      size_t* slot) const {
+  CHECK_NOTNULL(slot);
+  const auto it = slots_.find(lmk_id);
+  if (it == slots_.end()) return false;
+  *slot = it->second;
+  return true;
+}
+
+void IncrementalVertexBuffer::setPoint(const size_t& slot,
+                                       const TelemetryPoint& point) {
+  float* data = data_.data() + 3u * slot;
+  bool moved = false;
+  for (size_t i = 0u; i < 3u; ++i) {
+    moved = moved || std::abs(data[i] - point[i]) > position_tolerance_;
+  }
+  if (!moved) return;
+  std::copy(point.begin(), point.end(), data);
+  dirty_slots_.push_back(slot);
+}
+
+}  // namespace VIO
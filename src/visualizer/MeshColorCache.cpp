@@ -0,0 +1,71 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   MeshColorCache.cpp
+ * @brief  Per-vertex colors of a mesh, only rewritten where they changed.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/visualizer/MeshColorCache.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+MeshColorCache::MeshColorCache(const cv::Vec3b& default_color)
+    : default_color_(default_color), colors_(), frame_colors_() {}
+
+void MeshColorCache::startFrame(const size_t& nr_vertices) {
+  frame_colors_.assign(nr_vertices, default_color_);
+}
+
+void MeshColorCache::setTrianglesColor(const std::vector<int>& triangle_ids,
+                                       const cv::Mat& polygons_mesh,
+                                       const cv::Vec3b& color) {
+  CHECK_EQ(polygons_mesh.type(), CV_32SC1);
+  for (const int& triangle_id : triangle_ids) {
+    const int triangle_idx = triangle_id * 4;
+    DCHECK_GE(triangle_idx, 0);
+    DCHECK_LE(triangle_idx + 3, polygons_mesh.rows)
+        << "An id in triangle_ids is too large.";
+    for (int i = 1; i <= 3; ++i) {
+      const int32_t& vertex_idx = polygons_mesh.at<int32_t>(triangle_idx + i);
+      DCHECK_GE(vertex_idx, 0);
+      DCHECK_LT(static_cast<size_t>(vertex_idx), frame_colors_.size());
+      frame_colors_[vertex_idx] = color;
+    }
+  }
+}
+
+size_t MeshColorCache::finishFrame() {
+  const int nr_vertices = static_cast<int>(frame_colors_.size());
+  // Rows past the previous nr of vertices are new: always written.
+  int nr_cached = std::min(colors_.rows, nr_vertices);
+  if (colors_.empty()) {
+    colors_.create(nr_vertices, 1, CV_8UC3);
+    nr_cached = 0;
+  } else if (colors_.rows != nr_vertices) {
+    // Keeps the colors of the rows kept.
+    colors_.resize(nr_vertices);
+  }
+
+  size_t nr_recolored = 0u;
+  for (int i = 0; i < nr_vertices; ++i) {
+    cv::Vec3b& color = colors_.at<cv::Vec3b>(i);
+    if (i >= nr_cached || color != frame_colors_[i]) {
+      color = frame_colors_[i];
+      ++nr_recolored;
+    }
+  }
+  return nr_recolored;
+}
+
+}  // namespace VIO
@@ -21,6 +21,7 @@
 
 #include "kimera-vio/common/vio_types.h"
 #include "kimera-vio/utils/FilesystemUtils.h"
+#include "kimera-vio/visualizer/DisplayFactory.h"
 #include "kimera-vio/visualizer/DisplayParams.h"
 #include "kimera-vio/visualizer/OpenCvDisplayParams.h"
 
@@ -372,4 +373,15 @@ void OpenCv3dDisplay::setOffScreenRendering() {
   window_data_.window_.setOffScreenRendering();
 }
 
+namespace {
+[[maybe_unused]] const bool kOpenCvDisplayRegistered =
+    DisplayFactory::registerDisplay(
+        DisplayType::kOpenCV,
+        [](DisplayParams::Ptr display_params,
+           const ShutdownPipelineCallback& shutdown_pipeline_cb) {
+          return std::make_unique<OpenCv3dDisplay>(display_params,
+                                                   shutdown_pipeline_cb);
+        });
+}  // namespace
+
 }  // namespace VIO
@@ -38,6 +38,8 @@ void OpenCv3dDisplayParams::print() const {
   PipelineParams::print(out,
                         "Display Type ",
                         VIO::to_underlying(display_type_),
+                        "Target FPS ",
+                        target_fps_,
                         "Hold 2D Display ",
                         hold_2d_display_,
                         "Hold 3D Display ",
@@ -46,7 +48,7 @@ void OpenCv3dDisplayParams::print() const {
 
 bool OpenCv3dDisplayParams::equals(const OpenCv3dDisplayParams& cam_par,
                                    const double& tol) const {
-  return display_type_ == cam_par.display_type_ &&
+  return DisplayParams::equals(cam_par, tol) &&
          hold_2d_display_ == cam_par.hold_2d_display_ &&
          hold_3d_display_ == cam_par.hold_3d_display_;
 }
@@ -17,10 +17,14 @@
 #include <gflags/gflags.h>
 
 #include <algorithm>  // for min
+#include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <memory>     // for shared_ptr<>
 #include <opencv2/viz.hpp>
 #include <string>         // for string
 #include <unordered_map>  // for unordered_map<>
+#include <unordered_set>
 #include <utility>        // for pair<>
 #include <vector>         // for vector<>
 // To convert from/to eigen
@@ -39,6 +43,7 @@
 #include "kimera-vio/utils/Timer.h"
 #include "kimera-vio/utils/UtilsGTSAM.h"
 #include "kimera-vio/utils/UtilsOpenCV.h"
+#include "kimera-vio/visualizer/Visualizer3DFactory.h"
 
 // TODO(Toni): remove visualizer gflags! There are far too many, use a
 // yaml params class (aka inherit from PipelineParams.
@@ -78,20 +83,71 @@ DEFINE_bool(texturize_3d_mesh,
             " frame.");
 DEFINE_bool(log_mesh, false, "Log the mesh at time horizon.");
 DEFINE_bool(log_accumulated_mesh, false, "Accumulate the mesh when logging.");
+DEFINE_bool(visualize_decimated_mesh,
+            false,
+            "Display and log a coarse version of the 3D mesh, decimated "
+            "incrementally where it changed (see MeshDecimator). Not used "
+            "with semantic or textured meshes.");
+DEFINE_double(mesh_decimation_cell_size,
+              2.0,
+              "Side [m] of the cells in which the mesh is decimated.");
+DEFINE_double(mesh_decimation_ratio,
+              0.5,
+              "Fraction of the triangles of the mesh kept by the decimation.");
+DEFINE_double(mesh_decimation_max_error,
+              1e-3,
+              "Max quadric error [m^2] of the edges collapsed by the "
+              "decimation.");
 
 DEFINE_int32(displayed_trajectory_length,
              50,
              "Set length of plotted trajectory."
              "If -1 then all the trajectory is plotted.");
+DEFINE_double(visualizer_widgets_rate_hz,
+              0.0,
+              "Max rate at which the 3D widgets are rebuilt, independently "
+              "of the rate of the pipeline. If 0 they are rebuilt for every "
+              "visualizer input.");
+DEFINE_double(visualize_point_cloud_voxel_size,
+              0.0,
+              "Side [m] of the voxels used to downsample the displayed "
+              "landmark cloud, keeping one landmark per voxel. If 0 all the "
+              "landmarks are displayed.");
 
 namespace VIO {
 
+namespace {
+// Key of the voxel containing the point, 21 bits per axis.
+inline std::uint64_t getVoxelKey(const gtsam::Point3& point,
+                                 const double& voxel_size) {
+  const auto get_axis_key = [&voxel_size](const double& x) {
+    return static_cast<std::uint64_t>(
+               static_cast<std::int64_t>(std::floor(x / voxel_size))) &
+           0x1FFFFFu;
+  };
+  return get_axis_key(point.x()) | (get_axis_key(point.y()) << 21u) |
+         (get_axis_key(point.z()) << 42u);
+}
+}  // namespace
+
 OpenCvVisualizer3D::OpenCvVisualizer3D(const VisualizationType& viz_type,
                                        const BackendType& backend_type)
-    : Visualizer3D(viz_type), backend_type_(backend_type), logger_(nullptr) {
+    : Visualizer3D(viz_type),
+      backend_type_(backend_type),
+      logger_(nullptr),
+      mesh_color_cache_(cv::Vec3b(cv::viz::Color::gray()[0],
+                                  cv::viz::Color::gray()[1],
+                                  cv::viz::Color::gray()[2])) {
   if (FLAGS_log_mesh) {
     logger_ = std::make_unique<VisualizerLogger>();
   }
+  if (FLAGS_visualize_decimated_mesh) {
+    MeshDecimationParams decimation_params;
+    decimation_params.cell_size_ = FLAGS_mesh_decimation_cell_size;
+    decimation_params.target_ratio_ = FLAGS_mesh_decimation_ratio;
+    decimation_params.max_error_ = FLAGS_mesh_decimation_max_error;
+    mesh_decimator_ = std::make_unique<MeshDecimator>(decimation_params);
+  }
 }
 
 OpenCvVisualizer3D::~OpenCvVisualizer3D() {
@@ -117,6 +173,11 @@ VisualizerOutput::UniquePtr OpenCvVisualizer3D::spinOnce(
   }
   output->visualization_type_ = visualization_type_;
 
+  // The 3D widgets are only rebuilt at FLAGS_visualizer_widgets_rate_hz, the
+  // display keeps showing the previous ones meanwhile. The data of the
+  // skipped inputs is still accumulated (trajectory, previous mesh).
+  const bool update_widgets = shouldUpdateWidgets();
+
   cv::Mat mesh_2d_img;  // Only for visualization.
   const Frame* left_stereo_keyframe =
       input.frontend_output_->getTrackingFrame();
@@ -155,173 +216,198 @@ VisualizerOutput::UniquePtr OpenCvVisualizer3D::spinOnce(
       static LmkIdToLmkTypeMap lmk_id_to_lmk_type_map_prev;
       static cv::Mat vertices_mesh_prev;
       static cv::Mat polygons_mesh_prev;
+      static LandmarkIds vertices_lmk_ids_prev;
       static Mesh3DVizProperties mesh_3d_viz_props_prev;
 
-      if (FLAGS_visualize_mesh) {
-        VLOG(10) << "Visualize mesh.";
-        if (FLAGS_visualize_semantic_mesh) {
-          VLOG(10) << "Visualize Semantic mesh.";
-          LOG_IF(WARNING, FLAGS_visualize_mesh_with_colored_polygon_clusters)
-              << "Both gflags visualize_semantic_mesh and "
-                 "visualize_mesh_with_colored_polygon_cluster are set to True,"
-                 " but visualization of the semantic mesh has priority over "
-                 "visualization of the polygon clusters.";
-          visualizeMesh3D(vertices_mesh_prev,
-                          mesh_3d_viz_props_prev.colors_,
-                          polygons_mesh_prev,
-                          &output->widgets_,
-                          mesh_3d_viz_props_prev.tcoords_,
-                          mesh_3d_viz_props_prev.texture_);
-        } else {
-          VLOG(10) << "Visualize mesh with colored clusters.";
-          LOG_IF(ERROR, mesh_3d_viz_props_prev.colors_.rows > 0)
-              << "The 3D mesh is being colored with semantic information, but"
-                 " gflag visualize_semantic_mesh is set to false...";
-          visualizeMesh3DWithColoredClusters(
-              planes_prev,
-              vertices_mesh_prev,
-              polygons_mesh_prev,
-              &output->widgets_,
-              FLAGS_visualize_mesh_with_colored_polygon_clusters,
-              input.timestamp_);
+      if (update_widgets) {
+        if (FLAGS_visualize_mesh) {
+          VLOG(10) << "Visualize mesh.";
+          if (FLAGS_visualize_semantic_mesh) {
+            VLOG(10) << "Visualize Semantic mesh.";
+            LOG_IF(WARNING, FLAGS_visualize_mesh_with_colored_polygon_clusters)
+                << "Both gflags visualize_semantic_mesh and "
+                   "visualize_mesh_with_colored_polygon_cluster are set to "
+                   "True, but visualization of the semantic mesh has priority "
+                   "over visualization of the polygon clusters.";
+            visualizeMesh3D(vertices_mesh_prev,
+                            mesh_3d_viz_props_prev.colors_,
+                            polygons_mesh_prev,
+                            &output->widgets_,
+                            mesh_3d_viz_props_prev.tcoords_,
+                            mesh_3d_viz_props_prev.texture_);
+          } else {
+            VLOG(10) << "Visualize mesh with colored clusters.";
+            LOG_IF(ERROR, mesh_3d_viz_props_prev.colors_.rows > 0)
+                << "The 3D mesh is being colored with semantic information, but"
+                   " gflag visualize_semantic_mesh is set to false...";
+            visualizeMesh3DWithColoredClusters(
+                planes_prev,
+                vertices_mesh_prev,
+                polygons_mesh_prev,
+                vertices_lmk_ids_prev,
+                &output->widgets_,
+                FLAGS_visualize_mesh_with_colored_polygon_clusters,
+                input.timestamp_);
+          }
         }
-      }
 
-      if (FLAGS_visualize_point_cloud) {
-        visualizePoints3D(points_with_id_VIO_prev,
-                          lmk_id_to_lmk_type_map_prev,
-                          &output->widgets_);
-      }
+        if (FLAGS_visualize_point_cloud) {
+          visualizePoints3D(points_with_id_VIO_prev,
+                            lmk_id_to_lmk_type_map_prev,
+                            &output->widgets_);
+        }
 
-      if (!FLAGS_visualize_load_mesh_filename.empty()) {
-        // TODO(Toni): remove static, never use static wo const/constexpr
-        static bool visualize_ply_mesh_once = true;
-        if (visualize_ply_mesh_once) {
-          visualizePlyMesh(FLAGS_visualize_load_mesh_filename.c_str(),
-                           &output->widgets_);
-          visualize_ply_mesh_once = false;
+        if (!FLAGS_visualize_load_mesh_filename.empty()) {
+          // TODO(Toni): remove static, never use static wo const/constexpr
+          static bool visualize_ply_mesh_once = true;
+          if (visualize_ply_mesh_once) {
+            visualizePlyMesh(FLAGS_visualize_load_mesh_filename.c_str(),
+                             &output->widgets_);
+            visualize_ply_mesh_once = false;
+          }
         }
-      }
 
-      if (FLAGS_visualize_convex_hull) {
-        if (planes_prev.size() != 0) {
-          visualizeConvexHull(planes_prev.at(0).triangle_cluster_,
-                              vertices_mesh_prev,
-                              polygons_mesh_prev,
-                              &output->widgets_);
+        if (FLAGS_visualize_convex_hull) {
+          if (planes_prev.size() != 0) {
+            visualizeConvexHull(planes_prev.at(0).triangle_cluster_,
+                                vertices_mesh_prev,
+                                polygons_mesh_prev,
+                                &output->widgets_);
+          }
         }
-      }
 
-      if (backend_type_ == BackendType::kStructuralRegularities &&
-          FLAGS_visualize_plane_constraints) {
-        LandmarkIds lmk_ids_in_current_pp_factors;
-        for (const auto& g : input.backend_output_->factor_graph_) {
-          const auto ppf =
-              dynamic_cast<const gtsam::PointPlaneFactor*>(g.get());
-          if (ppf) {
-            // We found a PointPlaneFactor.
-            // Get point key.
-            Key point_key = ppf->getPointKey();
-            LandmarkId lmk_id = gtsam::Symbol(point_key).index();
-            lmk_ids_in_current_pp_factors.push_back(lmk_id);
-            // Get point estimate.
-            gtsam::Point3 point;
-            // This call makes visualizer unable to perform this
-            // in parallel. But you can just copy the state_
-            CHECK(getEstimateOfKey(
-                input.backend_output_->state_, point_key, &point));
-            // Visualize.
-            const Key& ppf_plane_key = ppf->getPlaneKey();
-            // not sure, we are having some w planes_prev
-            // others with planes...
-            for (const Plane& plane : input.mesher_output_->planes_) {
-              if (ppf_plane_key == plane.getPlaneSymbol().key()) {
-                gtsam::OrientedPlane3 current_plane_estimate;
-                CHECK(getEstimateOfKey(  // This call makes visualizer
-                                         // unable to perform this in
-                                         // parallel.
-                    input.backend_output_->state_,
-                    ppf_plane_key,
-                    &current_plane_estimate));
-                // WARNING assumes the Backend updates normal and distance
-                // of plane and that no one modifies it afterwards...
-                visualizePlaneConstraints(
-                    plane.getPlaneSymbol().key(),
-                    current_plane_estimate.normal().point3(),
-                    current_plane_estimate.distance(),
-                    lmk_id,
-                    point,
-                    &output->widgets_);
-                // Stop since there are not multiple planes for one
-                // ppf.
-                break;
+        if (backend_type_ == BackendType::kStructuralRegularities &&
+            FLAGS_visualize_plane_constraints) {
+          LandmarkIds lmk_ids_in_current_pp_factors;
+          for (const auto& g : input.backend_output_->factor_graph_) {
+            const auto ppf =
+                dynamic_cast<const gtsam::PointPlaneFactor*>(g.get());
+            if (ppf) {
+              // We found a PointPlaneFactor.
+              // Get point key.
+              Key point_key = ppf->getPointKey();
+              LandmarkId lmk_id = gtsam::Symbol(point_key).index();
+              lmk_ids_in_current_pp_factors.push_back(lmk_id);
+              // Get point estimate.
+              gtsam::Point3 point;
+              // This call makes visualizer unable to perform this
+              // in parallel. But you can just copy the state_
+              CHECK(getEstimateOfKey(
+                  input.backend_output_->state_, point_key, &point));
+              // Visualize.
+              const Key& ppf_plane_key = ppf->getPlaneKey();
+              // not sure, we are having some w planes_prev
+              // others with planes...
+              for (const Plane& plane : input.mesher_output_->planes_) {
+                if (ppf_plane_key == plane.getPlaneSymbol().key()) {
+                  gtsam::OrientedPlane3 current_plane_estimate;
+                  CHECK(getEstimateOfKey(  // This call makes visualizer
+                                           // unable to perform this in
+                                           // parallel.
+                      input.backend_output_->state_,
+                      ppf_plane_key,
+                      &current_plane_estimate));
+                  // WARNING assumes the Backend updates normal and distance
+                  // of plane and that no one modifies it afterwards...
+                  visualizePlaneConstraints(
+                      plane.getPlaneSymbol().key(),
+                      current_plane_estimate.normal().point3(),
+                      current_plane_estimate.distance(),
+                      lmk_id,
+                      point,
+                      &output->widgets_);
+                  // Stop since there are not multiple planes for one
+                  // ppf.
+                  break;
+                }
               }
             }
           }
-        }
 
-        // Remove lines that are not representing a point plane factor
-        // in the current graph.
-        removeOldLines(lmk_ids_in_current_pp_factors);
-      }
+          // Remove lines that are not representing a point plane factor
+          // in the current graph.
+          removeOldLines(lmk_ids_in_current_pp_factors);
+        }
 
-      // Must go after visualize plane constraints.
-      if (FLAGS_visualize_planes || FLAGS_visualize_plane_constraints) {
-        for (const Plane& plane : input.mesher_output_->planes_) {
-          const gtsam::Symbol& plane_symbol = plane.getPlaneSymbol();
-          const std::uint64_t& plane_index = plane_symbol.index();
-          gtsam::OrientedPlane3 current_plane_estimate;
-          if (getEstimateOfKey<gtsam::OrientedPlane3>(
-                  input.backend_output_->state_,
-                  plane_symbol.key(),
-                  &current_plane_estimate)) {
-            const cv::Point3d& plane_normal_estimate =
-                UtilsOpenCV::unit3ToPoint3d(current_plane_estimate.normal());
-            CHECK(plane.normal_ == plane_normal_estimate);
-            // We have the plane in the optimization.
-            // Visualize plane.
-            visualizePlane(plane_index,
-                           plane_normal_estimate.x,
-                           plane_normal_estimate.y,
-                           plane_normal_estimate.z,
-                           current_plane_estimate.distance(),
-                           &output->widgets_,
-                           FLAGS_visualize_plane_label,
-                           plane.triangle_cluster_.cluster_id_);
-          } else {
-            // We could not find the plane in the optimization...
-            // Careful cause we might enter here because there are new
-            // segmented planes.
-            // Delete the plane.
-            LOG(ERROR) << "Remove plane viz for id:" << plane_index;
-            if (FLAGS_visualize_plane_constraints) {
-              removePlaneConstraintsViz(plane_index);
+        // Must go after visualize plane constraints.
+        if (FLAGS_visualize_planes || FLAGS_visualize_plane_constraints) {
+          for (const Plane& plane : input.mesher_output_->planes_) {
+            const gtsam::Symbol& plane_symbol = plane.getPlaneSymbol();
+            const std::uint64_t& plane_index = plane_symbol.index();
+            gtsam::OrientedPlane3 current_plane_estimate;
+            if (getEstimateOfKey<gtsam::OrientedPlane3>(
+                    input.backend_output_->state_,
+                    plane_symbol.key(),
+                    &current_plane_estimate)) {
+              const cv::Point3d& plane_normal_estimate =
+                  UtilsOpenCV::unit3ToPoint3d(current_plane_estimate.normal());
+              CHECK(plane.normal_ == plane_normal_estimate);
+              // We have the plane in the optimization.
+              // Visualize plane.
+              visualizePlane(plane_index,
+                             plane_normal_estimate.x,
+                             plane_normal_estimate.y,
+                             plane_normal_estimate.z,
+                             current_plane_estimate.distance(),
+                             &output->widgets_,
+                             FLAGS_visualize_plane_label,
+                             plane.triangle_cluster_.cluster_id_);
+            } else {
+              // We could not find the plane in the optimization...
+              // Careful cause we might enter here because there are new
+              // segmented planes.
+              // Delete the plane.
+              LOG(ERROR) << "Remove plane viz for id:" << plane_index;
+              if (FLAGS_visualize_plane_constraints) {
+                removePlaneConstraintsViz(plane_index);
+              }
+              removePlane(plane_index);
             }
-            removePlane(plane_index);
           }
-        }
 
-        // Also remove planes that were deleted by the Backend...
-        for (const Plane& plane : planes_prev) {
-          const gtsam::Symbol& plane_symbol = plane.getPlaneSymbol();
-          const std::uint64_t& plane_index = plane_symbol.index();
-          gtsam::OrientedPlane3 current_plane_estimate;
-          if (!getEstimateOfKey(input.backend_output_->state_,
-                                plane_symbol.key(),
-                                &current_plane_estimate)) {
-            // We could not find the plane in the optimization...
-            // Delete the plane.
-            if (FLAGS_visualize_plane_constraints) {
-              removePlaneConstraintsViz(plane_index);
+          // Also remove planes that were deleted by the Backend...
+          for (const Plane& plane : planes_prev) {
+            const gtsam::Symbol& plane_symbol = plane.getPlaneSymbol();
+            const std::uint64_t& plane_index = plane_symbol.index();
+            gtsam::OrientedPlane3 current_plane_estimate;
+            if (!getEstimateOfKey(input.backend_output_->state_,
+                                  plane_symbol.key(),
+                                  &current_plane_estimate)) {
+              // We could not find the plane in the optimization...
+              // Delete the plane.
+              if (FLAGS_visualize_plane_constraints) {
+                removePlaneConstraintsViz(plane_index);
+              }
+              removePlane(plane_index);
             }
-            removePlane(plane_index);
           }
         }
       }
 
       planes_prev = input.mesher_output_->planes_;
-      vertices_mesh_prev = input.mesher_output_->vertices_mesh_;
-      polygons_mesh_prev = input.mesher_output_->polygons_mesh_;
+      // The semantic/texture properties are given per vertex of the full
+      // mesh, which is then not decimated.
+      const bool decimate_mesh = mesh_decimator_ &&
+                                 !mesh3d_viz_properties_callback_ &&
+                                 !FLAGS_texturize_3d_mesh;
+      LOG_IF_EVERY_N(WARNING, mesh_decimator_ && !decimate_mesh, 100)
+          << "The mesh is not decimated when it is semantic or textured.";
+      if (decimate_mesh) {
+        // Only the cells of the mesh that changed are decimated again.
+        const Mesh3D& coarse_mesh =
+            mesh_decimator_->update(input.mesher_output_->mesh_3d_);
+        coarse_mesh.getVerticesMeshToMat(&vertices_mesh_prev, false);
+        coarse_mesh.getPolygonsMeshToMat(&polygons_mesh_prev, false);
+        vertices_lmk_ids_prev =
+            FLAGS_log_mesh ? coarse_mesh.getLandmarkIds() : LandmarkIds();
+      } else {
+        vertices_mesh_prev = input.mesher_output_->vertices_mesh_;
+        polygons_mesh_prev = input.mesher_output_->polygons_mesh_;
+        // Only needed to log the mesh, the vertices being in this order.
+        vertices_lmk_ids_prev =
+            FLAGS_log_mesh ? input.mesher_output_->mesh_3d_.getLandmarkIds()
+                           : LandmarkIds();
+      }
       points_with_id_VIO_prev = input.backend_output_->landmarks_with_id_map_;
       lmk_id_to_lmk_type_map_prev =
           input.backend_output_->lmk_id_to_lmk_type_map_;
@@ -352,9 +438,11 @@ VisualizerOutput::UniquePtr OpenCvVisualizer3D::spinOnce(
       // Do not color the cloud, send empty lmk id to lmk type map
       // TODO(Toni): don't use the backend's maps, instead, build these maps,
       // in the visualizer using the state and the factor graph.
-      visualizePoints3D(input.backend_output_->landmarks_with_id_map_,
-                        input.backend_output_->lmk_id_to_lmk_type_map_,
-                        &output->widgets_);
+      if (update_widgets) {
+        visualizePoints3D(input.backend_output_->landmarks_with_id_map_,
+                          input.backend_output_->lmk_id_to_lmk_type_map_,
+                          &output->widgets_);
+      }
       break;
     }
     case VisualizationType::kNone: {
@@ -369,30 +457,34 @@ VisualizerOutput::UniquePtr OpenCvVisualizer3D::spinOnce(
       *CHECK_NOTNULL(input.frontend_output_->getBodyPoseCam());
   addPoseToTrajectory(UtilsOpenCV::gtsamPose3ToCvAffine3d(
       input.backend_output_->W_State_Blkf_.pose_.compose(b_Pose_cam_Lrect)));
-  // Generate line through all poses
-  visualizeTrajectory3D(&output->widgets_);
-  // Generate frustums for the last 10 poses.
-  // visualizeTrajectoryWithFrustums(&output->widgets_, 10u);
-  // Generate frustum with an image inside it for the current pose.
-  visualizePoseWithImgInFrustum(
-      FLAGS_visualize_mesh_in_frustum
-          ? mesh_2d_img
-          : *CHECK_NOTNULL(input.frontend_output_->getTrackingImage()),
-      trajectory_poses_3d_.back(),
-      &output->widgets_);
+  if (update_widgets) {
+    // Generate line through all poses
+    visualizeTrajectory3D(&output->widgets_);
+    // Generate frustums for the last 10 poses.
+    // visualizeTrajectoryWithFrustums(&output->widgets_, 10u);
+    // Generate frustum with an image inside it for the current pose.
+    visualizePoseWithImgInFrustum(
+        FLAGS_visualize_mesh_in_frustum
+            ? mesh_2d_img
+            : *CHECK_NOTNULL(input.frontend_output_->getTrackingImage()),
+        trajectory_poses_3d_.back(),
+        &output->widgets_);
+  }
   VLOG(10) << "Finished trajectory visualization.";
 
-  // Visualize the factor-graph in 3D, this trajectory might be different
-  // than the one above!
-  visualizeFactorGraph(input.backend_output_->state_,
-                       input.backend_output_->factor_graph_,
-                       b_Pose_cam_Lrect,
-                       input.frontend_output_->getBodyPoseCamRight(),
-                       &output->widgets_);
-
-  // Visualize frontend RANSAC data
-  visualizeFrontendRansac(
-      input.frontend_output_, W_Pose_Bllkf_, &output->widgets_);
+  if (update_widgets) {
+    // Visualize the factor-graph in 3D, this trajectory might be different
+    // than the one above!
+    visualizeFactorGraph(input.backend_output_->state_,
+                         input.backend_output_->factor_graph_,
+                         b_Pose_cam_Lrect,
+                         input.frontend_output_->getBodyPoseCamRight(),
+                         &output->widgets_);
+
+    // Visualize frontend RANSAC data
+    visualizeFrontendRansac(
+        input.frontend_output_, W_Pose_Bllkf_, &output->widgets_);
+  }
 
   // Add widgets to remove
   output->widget_ids_to_remove_ = widget_ids_to_remove_;
@@ -1107,8 +1199,7 @@ cv::Mat OpenCvVisualizer3D::visualizeMesh2D(
   static const cv::Scalar kPointsColor(255u, 0u, 0u);
 
   // Duplicate image for annotation and visualization.
-  cv::Mat img_clone = img.clone();
-  cv::cvtColor(img_clone, img_clone, cv::COLOR_GRAY2BGR);
+  cv::Mat img_clone = UtilsOpenCV::CopyForDrawing(img);
   const cv::Size& size = img_clone.size();
   cv::Rect rect(0, 0, size.width, size.height);
   std::vector<cv::Point> pt(3);
@@ -1146,8 +1237,7 @@ cv::Mat OpenCvVisualizer3D::visualizeMesh2DStereo(
       << "Frame: wrong dimension for the landmarks.";
 
   // Duplicate image for annotation and visualization.
-  cv::Mat img_clone = ref_frame.img_.clone();
-  cv::cvtColor(img_clone, img_clone, cv::COLOR_GRAY2BGR);
+  cv::Mat img_clone = UtilsOpenCV::CopyForDrawing(ref_frame.img_);
 
   // Visualize extra vertices.
   for (size_t i = 0; i < ref_frame.keypoints_.size(); i++) {
@@ -1204,13 +1294,27 @@ void OpenCvVisualizer3D::visualizePoints3D(
     return;
   }
 
+  // Downsample the cloud, keeping the first landmark of each voxel.
+  std::vector<const PointsWithIdMap::value_type*> displayed_points;
+  displayed_points.reserve(points_with_id.size());
+  const double& voxel_size = FLAGS_visualize_point_cloud_voxel_size;
+  std::unordered_set<std::uint64_t> occupied_voxels;
+  for (const PointsWithIdMap::value_type& id_point : points_with_id) {
+    if (voxel_size <= 0.0 ||
+        occupied_voxels.insert(getVoxelKey(id_point.second, voxel_size))
+            .second) {
+      displayed_points.push_back(&id_point);
+    }
+  }
+
   // Populate cloud structure with 3D points.
-  cv::Mat point_cloud(1, points_with_id.size(), CV_32FC3);
+  cv::Mat point_cloud(1, displayed_points.size(), CV_32FC3);
   cv::Mat point_cloud_color(
-      1, lmk_id_to_lmk_type_map.size(), CV_8UC3, cloud_color_);
+      1, color_the_cloud ? displayed_points.size() : 0u, CV_8UC3, cloud_color_);
   cv::Point3f* data = point_cloud.ptr<cv::Point3f>();
   size_t i = 0;
-  for (const std::pair<LandmarkId, gtsam::Point3>& id_point : points_with_id) {
+  for (const PointsWithIdMap::value_type* id_point_ptr : displayed_points) {
+    const PointsWithIdMap::value_type& id_point = *id_point_ptr;
     const gtsam::Point3& point_3d = id_point.second;
     data[i].x = static_cast<float>(point_3d.x());
     data[i].y = static_cast<float>(point_3d.y());
@@ -1422,6 +1526,7 @@ void OpenCvVisualizer3D::visualizeMesh3DWithColoredClusters(
     const std::vector<Plane>& planes,
     const cv::Mat& map_points_3d,
     const cv::Mat& polygons_mesh,
+    const LandmarkIds& vertices_lmk_ids,
     WidgetsMap* widgets,
     const bool visualize_mesh_with_colored_polygon_clusters,
     const Timestamp& timestamp) {
@@ -1433,7 +1538,8 @@ void OpenCvVisualizer3D::visualizeMesh3DWithColoredClusters(
     visualizeMesh3D(map_points_3d, colors, polygons_mesh, widgets);
     // Log the mesh.
     if (FLAGS_log_mesh) {
-      logMesh(map_points_3d,
+      logMesh(vertices_lmk_ids,
+              map_points_3d,
               colors,
               polygons_mesh,
               timestamp,
@@ -1569,14 +1675,58 @@ void OpenCvVisualizer3D::visualizeTrajectory3D(WidgetsMap* widgets_map) {
     return;
   }
 
-  // Create a Trajectory widget. (argument can be PATH, FRAMES, BOTH).
-  std::vector<cv::Affine3f> trajectory;
-  trajectory.reserve(trajectory_poses_3d_.size());
-  for (const auto& pose : trajectory_poses_3d_) {
-    trajectory.push_back(pose);
+  // The trajectory is split in widgets of kTrajectoryWidgetSize segments:
+  // widget k links the poses k * kTrajectoryWidgetSize to
+  // (k + 1) * kTrajectoryWidgetSize (indices since the first pose ever added).
+  // Only the widgets at both ends, which gained or lost poses since the last
+  // call, are rebuilt.
+  const size_t& kSize = kTrajectoryWidgetSize;
+  const size_t first_pose = trajectory_nr_poses_ - trajectory_poses_3d_.size();
+  const size_t last_pose = trajectory_nr_poses_ - 1u;
+  const size_t first_widget = first_pose / kSize;
+  const size_t last_widget =
+      std::max(first_widget, last_pose == 0u ? 0u : (last_pose - 1u) / kSize);
+
+  const auto get_widget_id = [](const size_t& widget) {
+    return "Trajectory " + std::to_string(widget);
+  };
+  const auto build_widget = [&](const size_t& widget) {
+    // Create a Trajectory widget. (argument can be PATH, FRAMES, BOTH).
+    std::vector<cv::Affine3f> trajectory;
+    trajectory.reserve(kSize + 1u);
+    const size_t end_pose = std::min((widget + 1u) * kSize, last_pose);
+    for (size_t pose = std::max(widget * kSize, first_pose); pose <= end_pose;
+         ++pose) {
+      trajectory.push_back(trajectory_poses_3d_.at(pose - first_pose));
+    }
+    (*widgets_map)[get_widget_id(widget)] =
+        std::make_unique<cv::viz::WTrajectory>(
+            trajectory, cv::viz::WTrajectory::PATH, 1.0, trajectory_color_);
+  };
+
+  // Remove the widgets that left the displayed trajectory.
+  for (size_t widget = trajectory_widgets_begin_;
+       widget < std::min(first_widget, trajectory_widgets_end_);
+       ++widget) {
+    removeWidget(get_widget_id(widget));
   }
-  (*widgets_map)["Trajectory"] = std::make_unique<cv::viz::WTrajectory>(
-      trajectory, cv::viz::WTrajectory::PATH, 1.0, trajectory_color_);
+  // Rebuild the last widget shown, which may have grown, and the new ones.
+  const size_t rebuild_begin =
+      trajectory_widgets_end_ == 0u
+          ? first_widget
+          : std::max(first_widget, trajectory_widgets_end_ - 1u);
+  for (size_t widget = rebuild_begin; widget <= last_widget; ++widget) {
+    build_widget(widget);
+  }
+  // And the first widget, if it lost poses.
+  if (first_widget < rebuild_begin &&
+      first_pose != trajectory_first_pose_shown_) {
+    build_widget(first_widget);
+  }
+
+  trajectory_widgets_begin_ = first_widget;
+  trajectory_widgets_end_ = last_widget + 1u;
+  trajectory_first_pose_shown_ = first_pose;
 }
 
 void OpenCvVisualizer3D::visualizeTrajectoryWithFrustums(
@@ -1766,6 +1916,7 @@ void OpenCvVisualizer3D::removePlane(const PlaneId& plane_index,
 
 void OpenCvVisualizer3D::addPoseToTrajectory(const cv::Affine3d& pose) {
   trajectory_poses_3d_.push_back(pose);
+  ++trajectory_nr_poses_;
   if (FLAGS_displayed_trajectory_length <= 0) {
     return;
   }
@@ -1776,6 +1927,18 @@ void OpenCvVisualizer3D::addPoseToTrajectory(const cv::Affine3d& pose) {
   }
 }
 
+bool OpenCvVisualizer3D::shouldUpdateWidgets() {
+  if (FLAGS_visualizer_widgets_rate_hz <= 0.0) return true;
+  const auto now = utils::Timer::tic();
+  if (last_widgets_update_ &&
+      std::chrono::duration<double>(now - *last_widgets_update_).count() <
+          1.0 / FLAGS_visualizer_widgets_rate_hz) {
+    return false;
+  }
+  last_widgets_update_ = now;
+  return true;
+}
+
 Mesh3DVizProperties OpenCvVisualizer3D::texturizeMesh3D(
     const Timestamp& image_timestamp,
     const cv::Mat& texture_image,
@@ -1879,20 +2042,25 @@ Mesh3DVizProperties OpenCvVisualizer3D::texturizeMesh3D(
   return mesh_3d_viz_props;
 }
 
-void OpenCvVisualizer3D::logMesh(const cv::Mat& map_points_3d,
+void OpenCvVisualizer3D::logMesh(const LandmarkIds& vertices_lmk_ids,
+                                 const cv::Mat& map_points_3d,
                                  const cv::Mat& colors,
                                  const cv::Mat& polygons_mesh,
                                  const Timestamp& timestamp,
                                  bool log_accumulated_mesh) {
-  /// Log the mesh in a ply file.
+  /// Log the changes of the mesh.
   static Timestamp last_timestamp = timestamp;
   if ((timestamp - last_timestamp) >
       6500000000) {  // Log every 6 seconds approx. (a little bit more than
                      // time-horizon)
     LOG(WARNING) << "Logging mesh every (ns) = " << timestamp - last_timestamp;
     CHECK(logger_);
-    logger_->logMesh(
-        map_points_3d, colors, polygons_mesh, timestamp, log_accumulated_mesh);
+    logger_->logMesh(vertices_lmk_ids,
+                     map_points_3d,
+                     colors,
+                     polygons_mesh,
+                     timestamp,
+                     log_accumulated_mesh);
     last_timestamp = timestamp;
   }
 }
@@ -1900,9 +2068,11 @@ void OpenCvVisualizer3D::logMesh(const cv::Mat& map_points_3d,
 void OpenCvVisualizer3D::colorMeshByClusters(const std::vector<Plane>& planes,
                                              const cv::Mat& map_points_3d,
                                              const cv::Mat& polygons_mesh,
-                                             cv::Mat* colors) const {
+                                             cv::Mat* colors) {
   CHECK_NOTNULL(colors);
-  *colors = cv::Mat(map_points_3d.rows, 1, CV_8UC3, cv::viz::Color::gray());
+  static const utils::StatsCollector recolored_stats(
+      "Visualizer Recolored Vertices");
+  mesh_color_cache_.startFrame(map_points_3d.rows);
 
   // The code below assumes triangles as polygons.
   for (const Plane& plane : planes) {
@@ -1910,20 +2080,16 @@ void OpenCvVisualizer3D::colorMeshByClusters(const std::vector<Plane>& planes,
     // Decide color for cluster.
     cv::viz::Color cluster_color = cv::viz::Color::gray();
     getColorById(cluster.cluster_id_, &cluster_color);
-
-    for (const size_t& triangle_id : cluster.triangle_ids_) {
-      size_t triangle_idx = std::round(triangle_id * 4);
-      DCHECK_LE(triangle_idx + 3, polygons_mesh.rows)
-          << "Visualizer3D: an id in triangle_ids_ is too large.";
-      const int32_t& idx_1 = polygons_mesh.at<int32_t>(triangle_idx + 1);
-      const int32_t& idx_2 = polygons_mesh.at<int32_t>(triangle_idx + 2);
-      const int32_t& idx_3 = polygons_mesh.at<int32_t>(triangle_idx + 3);
-      // Overrides potential previous color.
-      colors->row(idx_1) = cluster_color;
-      colors->row(idx_2) = cluster_color;
-      colors->row(idx_3) = cluster_color;
-    }
+    // Overrides potential previous color.
+    mesh_color_cache_.setTrianglesColor(
+        cluster.triangle_ids_,
+        polygons_mesh,
+        cv::Vec3b(cluster_color[0], cluster_color[1], cluster_color[2]));
   }
+
+  // Only the vertices whose color changed since the last mesh are written.
+  recolored_stats.AddSample(mesh_color_cache_.finishFrame());
+  *colors = mesh_color_cache_.getColors();
 }
 
 void OpenCvVisualizer3D::getColorById(const size_t& id,
@@ -1985,4 +2151,13 @@ void OpenCvVisualizer3D::updateLineFromPlaneToPoint(const std::string& line_id,
                            widgets);
 }
 
+namespace {
+[[maybe_unused]] const bool kOpenCvVisualizerRegistered =
+    VisualizerFactory::registerVisualizer(
+        VisualizerType::OpenCV,
+        [](const VisualizationType& viz_type, const BackendType& backend_type) {
+          return std::make_unique<OpenCvVisualizer3D>(viz_type, backend_type);
+        });
+}  // namespace
+
 }  // namespace VIO
@@ -14,69 +14,232 @@
 
 #include "kimera-vio/visualizer/PangolinDisplay.h"
 
+#include <algorithm>
+
+#include <Eigen/Geometry>
 #include <glog/logging.h>
 
 #include <pangolin/pangolin.h>
-#include <pangolin/scene/axis.h>
-#include <pangolin/scene/scenehandler.h>
 
 #include "kimera-vio/visualizer/DisplayParams.h"
 #include "kimera-vio/pipeline/Pipeline-definitions.h"  // Needed for shutdown cb
+#include "kimera-vio/visualizer/DisplayFactory.h"
+#include "kimera-vio/visualizer/TelemetryVisualizer3D.h"
 
 namespace VIO {
 
+struct PangolinDisplay::GlScene {
+  pangolin::GlBuffer trajectory_;
+  size_t nr_trajectory_points_ = 0u;
+  pangolin::GlBuffer landmarks_;
+  size_t nr_landmarks_ = 0u;
+  pangolin::GlBuffer mesh_vertices_;
+  pangolin::GlBuffer mesh_indices_;
+  size_t nr_mesh_indices_ = 0u;
+  pangolin::OpenGlMatrix W_T_B_;
+};
+
+namespace {
+//! Uploads the changed points of a host buffer to its OpenGL buffer.
+void uploadPoints(IncrementalVertexBuffer* points, pangolin::GlBuffer* buffer) {
+  CHECK_NOTNULL(points);
+  CHECK_NOTNULL(buffer);
+  std::vector<IncrementalVertexBuffer::SlotRange> ranges;
+  if (points->takeDirtyRanges(&ranges)) {
+    buffer->Reinitialise(pangolin::GlArrayBuffer,
+                         static_cast<GLuint>(points->capacity()),
+                         GL_FLOAT,
+                         3,
+                         GL_DYNAMIC_DRAW);
+  }
+  constexpr size_t kPointBytes = 3u * sizeof(float);
+  for (const IncrementalVertexBuffer::SlotRange& range : ranges) {
+    buffer->Upload(points->getData().data() + 3u * range.begin,
+                   (range.end - range.begin) * kPointBytes,
+                   range.begin * kPointBytes);
+  }
+}
+
+void drawPoints(const pangolin::GlBuffer& buffer,
+                const size_t& nr_points,
+                const GLenum& mode) {
+  if (nr_points == 0u) return;
+  buffer.Bind();
+  glVertexPointer(3, GL_FLOAT, 0, 0);
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glDrawArrays(mode, 0, static_cast<GLsizei>(nr_points));
+  glDisableClientState(GL_VERTEX_ARRAY);
+  buffer.Unbind();
+}
+}  // namespace
+
 PangolinDisplay::PangolinDisplay(
     DisplayParams::Ptr display_params,
     const ShutdownPipelineCallback& shutdown_pipeline_cb)
     : DisplayBase(display_params->display_type_),
-      handler(nullptr),
-      shutdown_pipeline_cb_(shutdown_pipeline_cb) {
+      window_name_(display_params->name_),
+      shutdown_pipeline_cb_(shutdown_pipeline_cb),
+      scene_mutex_(),
+      trajectory_(),
+      landmarks_(),
+      mesh_vertices_(),
+      mesh_indices_(),
+      mesh_indices_changed_(false),
+      W_T_B_(pangolin::IdentityMatrix()),
+      shutdown_(false),
+      window_closed_(false),
+      render_thread_() {
   CHECK(display_params);
-  pangolin::CreateWindowAndBind(display_params->name_, 640, 480);
-  glEnable(GL_DEPTH_TEST);
-
-  // Define Projection and initial ModelView matrix
-  s_cam = pangolin::OpenGlRenderState(
-      pangolin::ProjectionMatrix(640, 480, 420, 420, 320, 240, 0.2, 100),
-      pangolin::ModelViewLookAt(-2, 2, -2, 0, 0, 0, pangolin::AxisY));
-
-  tree.Add(std::make_shared<pangolin::Axis>());
-
-  // Create Interactive View in window
-  handler = std::make_unique<pangolin::SceneHandler>(tree, s_cam);
-  d_cam = pangolin::CreateDisplay()
-              .SetBounds(0.0, 1.0, 0.0, 1.0, -640.0f / 480.0f)
-              .SetHandler(handler.get());
+  // The window is created here (some platforms require the main thread), and
+  // its context is bound to the render thread.
+  pangolin::CreateWindowAndBind(window_name_, 640, 480);
+  pangolin::GetBoundWindow()->RemoveCurrent();
+  render_thread_ = std::thread(&PangolinDisplay::render, this);
+}
 
-  d_cam.SetDrawFunction([&](pangolin::View& view) {
-    view.Activate(s_cam);
-    tree.Render();
-  });
+PangolinDisplay::~PangolinDisplay() {
+  shutdown_ = true;
+  if (render_thread_.joinable()) render_thread_.join();
+  pangolin::DestroyWindow(window_name_);
 }
 
-void PangolinDisplay::spinOnce(
-    DisplayInputBase::UniquePtr&& viz_input) {
+void PangolinDisplay::spinOnce(DisplayInputBase::UniquePtr&& viz_input) {
   CHECK(viz_input);
-  if (!pangolin::ShouldQuit()) {
-    // Clear screen and activate view to render into
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    d_cam.Activate(s_cam);
-
-    // Render OpenGL Cube
-    pangolin::glDrawColouredCube();
-
-    // Swap frames and Process Events
-    pangolin::FinishFrame();
-  } else {
+  if (window_closed_) {
     if (shutdown_pipeline_cb_) shutdown_pipeline_cb_();
+    return;
+  }
+  // E.g. images of the Frontend.
+  const TelemetryOutput* output =
+      dynamic_cast<const TelemetryOutput*>(viz_input.get());
+  if (!output) return;
+  const TelemetryMap& map = output->map_;
+
+  Eigen::Matrix4d W_T_B = Eigen::Matrix4d::Identity();
+  W_T_B.topLeftCorner<3, 3>() =
+      Eigen::Quaterniond(map.orientation_[0],
+                         map.orientation_[1],
+                         map.orientation_[2],
+                         map.orientation_[3])
+          .toRotationMatrix();
+  W_T_B.topRightCorner<3, 1>() =
+      Eigen::Vector3d(map.position_[0], map.position_[1], map.position_[2]);
+
+  std::lock_guard<std::mutex> lock(scene_mutex_);
+  // Column major, as OpenGL.
+  std::copy(W_T_B.data(), W_T_B.data() + 16, W_T_B_.m);
+  trajectory_.append({{static_cast<float>(map.position_[0]),
+                       static_cast<float>(map.position_[1]),
+                       static_cast<float>(map.position_[2])}});
+  landmarks_.update(map.landmarks_);
+  mesh_vertices_.update(map.mesh_vertices_);
+  mesh_indices_.clear();
+  for (const TelemetryTriangle& triangle : map.mesh_triangles_) {
+    for (const LandmarkId& lmk_id : triangle) {
+      size_t slot = 0u;
+      CHECK(mesh_vertices_.getSlot(lmk_id, &slot))
+          << "Mesh triangle without vertex " << lmk_id;
+      mesh_indices_.push_back(static_cast<uint32_t>(slot));
+    }
   }
+  mesh_indices_changed_ = true;
 }
 
-//! Adds 3D widgets to the window, and displays it.
-void PangolinDisplay::spin3dWindow(VisualizerOutput::UniquePtr&& viz_output) {}
+void PangolinDisplay::render() {
+  pangolin::BindToContext(window_name_);
+  glEnable(GL_DEPTH_TEST);
+  {
+    // Define Projection and initial ModelView matrix
+    pangolin::OpenGlRenderState s_cam(
+        pangolin::ProjectionMatrix(640, 480, 420, 420, 320, 240, 0.2, 1000),
+        pangolin::ModelViewLookAt(-10, -10, 10, 0, 0, 0, pangolin::AxisZ));
+    // Create Interactive View in window
+    pangolin::Handler3D handler(s_cam);
+    pangolin::View& d_cam = pangolin::CreateDisplay()
+                                .SetBounds(0.0, 1.0, 0.0, 1.0, -640.0f / 480.0f)
+                                .SetHandler(&handler);
+
+    // Freed before the context is released.
+    GlScene gl_scene;
+    while (!shutdown_ && !pangolin::ShouldQuit()) {
+      // Clear screen and activate view to render into
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      d_cam.Activate(s_cam);
+
+      uploadScene(&gl_scene);
+      glColor3f(0.0f, 1.0f, 0.0f);
+      drawPoints(gl_scene.trajectory_,
+                 gl_scene.nr_trajectory_points_,
+                 GL_LINE_STRIP);
+      glColor3f(1.0f, 1.0f, 1.0f);
+      drawPoints(gl_scene.landmarks_, gl_scene.nr_landmarks_, GL_POINTS);
+      if (gl_scene.nr_mesh_indices_ > 0u) {
+        glColor3f(0.5f, 0.5f, 1.0f);
+        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        gl_scene.mesh_vertices_.Bind();
+        glVertexPointer(3, GL_FLOAT, 0, 0);
+        glEnableClientState(GL_VERTEX_ARRAY);
+        gl_scene.mesh_indices_.Bind();
+        glDrawElements(GL_TRIANGLES,
+                       static_cast<GLsizei>(gl_scene.nr_mesh_indices_),
+                       GL_UNSIGNED_INT,
+                       0);
+        gl_scene.mesh_indices_.Unbind();
+        glDisableClientState(GL_VERTEX_ARRAY);
+        gl_scene.mesh_vertices_.Unbind();
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+      }
+      glPushMatrix();
+      gl_scene.W_T_B_.Multiply();
+      pangolin::glDrawAxis(0.5f);
+      glPopMatrix();
+
+      // Swap frames (at the monitor rate with vsync) and Process Events
+      pangolin::FinishFrame();
+    }
+  }
+  window_closed_ = !shutdown_;
+  pangolin::GetBoundWindow()->RemoveCurrent();
+}
+
+void PangolinDisplay::uploadScene(GlScene* gl_scene) {
+  CHECK_NOTNULL(gl_scene);
+  std::lock_guard<std::mutex> lock(scene_mutex_);
+  uploadPoints(&trajectory_, &gl_scene->trajectory_);
+  gl_scene->nr_trajectory_points_ = trajectory_.size();
+  uploadPoints(&landmarks_, &gl_scene->landmarks_);
+  gl_scene->nr_landmarks_ = landmarks_.size();
+  uploadPoints(&mesh_vertices_, &gl_scene->mesh_vertices_);
+  if (mesh_indices_changed_) {
+    if (mesh_indices_.size() > gl_scene->mesh_indices_.num_elements) {
+      gl_scene->mesh_indices_.Reinitialise(
+          pangolin::GlElementArrayBuffer,
+          static_cast<GLuint>(std::max(
+              mesh_indices_.size(),
+              2u * static_cast<size_t>(gl_scene->mesh_indices_.num_elements))),
+          GL_UNSIGNED_INT,
+          1,
+          GL_DYNAMIC_DRAW);
+    }
+    if (!mesh_indices_.empty()) {
+      gl_scene->mesh_indices_.Upload(mesh_indices_.data(),
+                                     mesh_indices_.size() * sizeof(uint32_t));
+    }
+    gl_scene->nr_mesh_indices_ = mesh_indices_.size();
+    mesh_indices_changed_ = false;
+  }
+  gl_scene->W_T_B_ = W_T_B_;
+}
 
-//! Visualizes 2D data.
-void PangolinDisplay::spin2dWindow(const DisplayInputBase& viz_output) {}
+namespace {
+[[maybe_unused]] const bool kPangolinDisplayRegistered =
+    DisplayFactory::registerDisplay(
+        DisplayType::kPangolin,
+        [](DisplayParams::Ptr display_params,
+           const ShutdownPipelineCallback& shutdown_pipeline_cb) {
+          return std::make_unique<PangolinDisplay>(display_params,
+                                                   shutdown_pipeline_cb);
+        });
+}  // namespace
 
 }  // namespace VIO
@@ -0,0 +1,472 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   TelemetryCodec.cpp
+ * @brief  Compact binary encoding of the map essentials (pose, landmarks,
+ * mesh, images) for external viewers.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/visualizer/TelemetryCodec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <vector>
+
+#include <glog/logging.h>
+
+namespace VIO {
+
+namespace {
+
+/* -------------------------------------------------------------------------- */
+// Writers.
+template <typename UInt>
+void writeUInt(const UInt& value, std::string* out) {
+  for (size_t i = 0u; i < sizeof(UInt); ++i) {
+    out->push_back(static_cast<char>((value >> (8u * i)) & 0xffu));
+  }
+}
+
+void writeFloat(const float& value, std::string* out) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  writeUInt(bits, out);
+}
+
+void writeDouble(const double& value, std::string* out) {
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  writeUInt(bits, out);
+}
+
+void writeVarint(uint64_t value, std::string* out) {
+  while (value >= 0x80u) {
+    out->push_back(static_cast<char>((value & 0x7fu) | 0x80u));
+    value >>= 7u;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+//! Small differences, negative or not, take few bytes.
+void writeIdDelta(const LandmarkId& id,
+                  LandmarkId* previous_id,
+                  std::string* out) {
+  const int64_t delta = static_cast<int64_t>(id) - *previous_id;
+  writeVarint((static_cast<uint64_t>(delta) << 1u) ^
+                  static_cast<uint64_t>(delta >> 63),
+              out);
+  *previous_id = id;
+}
+
+void writeString(const std::string& value, std::string* out) {
+  writeVarint(value.size(), out);
+  out->append(value);
+}
+
+// Reserves the header, and writes the payload size in it once done.
+class PacketWriter {
+ public:
+  PacketWriter(const TelemetryPacketType& type, std::string* packet)
+      : packet_(CHECK_NOTNULL(packet)), header_begin_(packet->size()) {
+    writeUInt(kTelemetryMagic, packet_);
+    writeUInt(kTelemetryVersion, packet_);
+    writeUInt(static_cast<uint8_t>(type), packet_);
+    writeUInt(uint32_t(0u), packet_);
+  }
+
+  ~PacketWriter() {
+    const size_t payload_size =
+        packet_->size() - header_begin_ - kTelemetryHeaderSize;
+    CHECK_LE(payload_size, std::numeric_limits<uint32_t>::max());
+    for (size_t i = 0u; i < 4u; ++i) {
+      (*packet_)[header_begin_ + 4u + i] =
+          static_cast<char>((payload_size >> (8u * i)) & 0xffu);
+    }
+  }
+
+  inline std::string* payload() { return packet_; }
+
+ private:
+  std::string* packet_;
+  const size_t header_begin_;
+};
+
+/* -------------------------------------------------------------------------- */
+// Reader of a payload: reading past its end fails, and all further reads too.
+class PayloadReader {
+ public:
+  PayloadReader(const char* data, const size_t& size)
+      : data_(data), end_(data + size) {}
+
+  template <typename UInt>
+  bool readUInt(UInt* value) {
+    if (!ok_ || static_cast<size_t>(end_ - data_) < sizeof(UInt)) {
+      return fail();
+    }
+    *value = 0u;
+    for (size_t i = 0u; i < sizeof(UInt); ++i) {
+      *value |= static_cast<UInt>(static_cast<uint8_t>(*data_++)) << (8u * i);
+    }
+    return true;
+  }
+
+  bool readFloat(float* value) {
+    uint32_t bits;
+    if (!readUInt(&bits)) return false;
+    std::memcpy(value, &bits, sizeof(bits));
+    return true;
+  }
+
+  bool readDouble(double* value) {
+    uint64_t bits;
+    if (!readUInt(&bits)) return false;
+    std::memcpy(value, &bits, sizeof(bits));
+    return true;
+  }
+
+  bool readVarint(uint64_t* value) {
+    *value = 0u;
+    for (size_t shift = 0u; shift < 64u; shift += 7u) {
+      if (!ok_ || data_ == end_) return fail();
+      const uint8_t byte = static_cast<uint8_t>(*data_++);
+      *value |= static_cast<uint64_t>(byte & 0x7fu) << shift;
+      if ((byte & 0x80u) == 0u) return true;
+    }
+    return fail();
+  }
+
+  //! Varint of a count of items of at least min_item_size bytes each, which
+  //! must fit in what is left of the payload.
+  bool readCount(const size_t& min_item_size, size_t* count) {
+    uint64_t value;
+    if (!readVarint(&value)) return false;
+    if (value > static_cast<uint64_t>(end_ - data_) / min_item_size) {
+      return fail();
+    }
+    *count = static_cast<size_t>(value);
+    return true;
+  }
+
+  bool readIdDelta(LandmarkId* previous_id, LandmarkId* id) {
+    uint64_t value;
+    if (!readVarint(&value)) return false;
+    const int64_t delta =
+        static_cast<int64_t>(value >> 1u) ^ -static_cast<int64_t>(value & 1u);
+    *id = static_cast<LandmarkId>(*previous_id + delta);
+    *previous_id = *id;
+    return true;
+  }
+
+  bool readString(std::string* value) {
+    size_t size;
+    if (!readCount(1u, &size)) return false;
+    value->assign(data_, size);
+    data_ += size;
+    return true;
+  }
+
+  inline bool atEnd() const { return ok_ && data_ == end_; }
+
+ private:
+  bool fail() {
+    ok_ = false;
+    return false;
+  }
+
+  const char* data_;
+  const char* end_;
+  bool ok_ = true;
+};
+
+/* -------------------------------------------------------------------------- */
+inline bool isWithinTolerance(const TelemetryPoint& lhs,
+                              const TelemetryPoint& rhs,
+                              const float& tolerance) {
+  return std::fabs(lhs[0] - rhs[0]) < tolerance &&
+         std::fabs(lhs[1] - rhs[1]) < tolerance &&
+         std::fabs(lhs[2] - rhs[2]) < tolerance;
+}
+
+// Encodes the points that are new or moved, and the removed ones, and
+// updates the encoded points accordingly.
+void encodePointsDelta(const TelemetryPoints& points,
+                       const float& tolerance,
+                       TelemetryPoints* encoded_points,
+                       std::string* out) {
+  std::vector<TelemetryPoints::const_iterator> upserts;
+  std::vector<LandmarkId> removals;
+  auto encoded_it = encoded_points->begin();
+  for (auto it = points.begin(); it != points.end(); ++it) {
+    while (encoded_it != encoded_points->end() &&
+           encoded_it->first < it->first) {
+      removals.push_back(encoded_it->first);
+      ++encoded_it;
+    }
+    if (encoded_it != encoded_points->end() &&
+        encoded_it->first == it->first) {
+      if (!isWithinTolerance(encoded_it->second, it->second, tolerance)) {
+        upserts.push_back(it);
+      }
+      ++encoded_it;
+    } else {
+      upserts.push_back(it);
+    }
+  }
+  for (; encoded_it != encoded_points->end(); ++encoded_it) {
+    removals.push_back(encoded_it->first);
+  }
+
+  LandmarkId previous_id = 0;
+  writeVarint(upserts.size(), out);
+  for (const auto& it : upserts) {
+    writeIdDelta(it->first, &previous_id, out);
+    for (const float& coordinate : it->second) writeFloat(coordinate, out);
+    (*encoded_points)[it->first] = it->second;
+  }
+  previous_id = 0;
+  writeVarint(removals.size(), out);
+  for (const LandmarkId& id : removals) {
+    writeIdDelta(id, &previous_id, out);
+    encoded_points->erase(id);
+  }
+}
+
+void encodeTriangles(const std::vector<TelemetryTriangle>& triangles,
+                     std::string* out) {
+  LandmarkId previous_id = 0;
+  writeVarint(triangles.size(), out);
+  for (const TelemetryTriangle& triangle : triangles) {
+    for (const LandmarkId& id : triangle) writeIdDelta(id, &previous_id, out);
+  }
+}
+
+void encodeTrianglesDelta(const TelemetryTriangles& triangles,
+                          TelemetryTriangles* encoded_triangles,
+                          std::string* out) {
+  // Both sets are sorted.
+  std::vector<TelemetryTriangle> additions;
+  std::vector<TelemetryTriangle> removals;
+  std::set_difference(triangles.begin(),
+                      triangles.end(),
+                      encoded_triangles->begin(),
+                      encoded_triangles->end(),
+                      std::back_inserter(additions));
+  std::set_difference(encoded_triangles->begin(),
+                      encoded_triangles->end(),
+                      triangles.begin(),
+                      triangles.end(),
+                      std::back_inserter(removals));
+  encodeTriangles(additions, out);
+  encodeTriangles(removals, out);
+  *encoded_triangles = triangles;
+}
+
+void encodeMap(const TelemetryMap& map,
+               const TelemetryPacketType& type,
+               const float& tolerance,
+               TelemetryMap* encoded_map,
+               std::string* packet) {
+  PacketWriter writer(type, packet);
+  std::string* out = writer.payload();
+  writeUInt(static_cast<uint64_t>(map.timestamp_), out);
+  for (const double& coordinate : map.position_) writeDouble(coordinate, out);
+  for (const double& coordinate : map.orientation_) {
+    writeFloat(static_cast<float>(coordinate), out);
+  }
+  encodePointsDelta(map.landmarks_, tolerance, &encoded_map->landmarks_, out);
+  encodePointsDelta(
+      map.mesh_vertices_, tolerance, &encoded_map->mesh_vertices_, out);
+  encodeTrianglesDelta(
+      map.mesh_triangles_, &encoded_map->mesh_triangles_, out);
+  encoded_map->timestamp_ = map.timestamp_;
+  encoded_map->position_ = map.position_;
+  encoded_map->orientation_ = map.orientation_;
+}
+
+/* -------------------------------------------------------------------------- */
+bool decodePointsDelta(PayloadReader* reader, TelemetryPoints* points) {
+  static constexpr size_t kMinPointSize = 1u + 3u * sizeof(float);
+  size_t nr_upserts;
+  if (!reader->readCount(kMinPointSize, &nr_upserts)) return false;
+  LandmarkId id = 0;
+  LandmarkId previous_id = 0;
+  for (size_t i = 0u; i < nr_upserts; ++i) {
+    TelemetryPoint point;
+    if (!reader->readIdDelta(&previous_id, &id) ||
+        !reader->readFloat(&point[0]) || !reader->readFloat(&point[1]) ||
+        !reader->readFloat(&point[2])) {
+      return false;
+    }
+    (*points)[id] = point;
+  }
+  size_t nr_removals;
+  if (!reader->readCount(1u, &nr_removals)) return false;
+  previous_id = 0;
+  for (size_t i = 0u; i < nr_removals; ++i) {
+    if (!reader->readIdDelta(&previous_id, &id)) return false;
+    points->erase(id);
+  }
+  return true;
+}
+
+bool decodeTriangles(PayloadReader* reader,
+                     std::vector<TelemetryTriangle>* triangles) {
+  size_t nr_triangles;
+  if (!reader->readCount(3u, &nr_triangles)) return false;
+  triangles->resize(nr_triangles);
+  LandmarkId previous_id = 0;
+  for (TelemetryTriangle& triangle : *triangles) {
+    for (LandmarkId& id : triangle) {
+      if (!reader->readIdDelta(&previous_id, &id)) return false;
+    }
+  }
+  return true;
+}
+
+bool decodeMap(PayloadReader* reader, TelemetryMap* map) {
+  uint64_t timestamp;
+  if (!reader->readUInt(&timestamp)) return false;
+  map->timestamp_ = static_cast<Timestamp>(timestamp);
+  for (double& coordinate : map->position_) {
+    if (!reader->readDouble(&coordinate)) return false;
+  }
+  for (double& coordinate : map->orientation_) {
+    float value;
+    if (!reader->readFloat(&value)) return false;
+    coordinate = value;
+  }
+  if (!decodePointsDelta(reader, &map->landmarks_) ||
+      !decodePointsDelta(reader, &map->mesh_vertices_)) {
+    return false;
+  }
+  std::vector<TelemetryTriangle> additions;
+  std::vector<TelemetryTriangle> removals;
+  if (!decodeTriangles(reader, &additions) ||
+      !decodeTriangles(reader, &removals)) {
+    return false;
+  }
+  for (const TelemetryTriangle& triangle : removals) {
+    map->mesh_triangles_.erase(triangle);
+  }
+  map->mesh_triangles_.insert(additions.begin(), additions.end());
+  return true;
+}
+
+}  // namespace
+
+/* -------------------------------------------------------------------------- */
+TelemetryEncoder::TelemetryEncoder(const float& position_tolerance)
+    : position_tolerance_(position_tolerance), encoded_map_() {
+  CHECK_GE(position_tolerance_, 0.0f);
+}
+
+void TelemetryEncoder::encodeMapDelta(const TelemetryMap& map,
+                                      std::string* packet) {
+  CHECK_NOTNULL(packet);
+  encodeMap(map,
+            TelemetryPacketType::kMapDelta,
+            position_tolerance_,
+            &encoded_map_,
+            packet);
+}
+
+void TelemetryEncoder::encodeMapSnapshot(std::string* packet) const {
+  CHECK_NOTNULL(packet);
+  // The delta from an empty map, with its exact points.
+  TelemetryMap empty_map;
+  encodeMap(encoded_map_,
+            TelemetryPacketType::kMapSnapshot,
+            0.0f,
+            &empty_map,
+            packet);
+}
+
+void TelemetryEncoder::encodeImage(const TelemetryImage& image,
+                                   std::string* packet) {
+  CHECK_NOTNULL(packet);
+  PacketWriter writer(TelemetryPacketType::kImage, packet);
+  std::string* out = writer.payload();
+  writeUInt(static_cast<uint64_t>(image.timestamp_), out);
+  writeString(image.name_, out);
+  writeString(image.data_, out);
+}
+
+/* -------------------------------------------------------------------------- */
+size_t TelemetryDecoder::getPacketSize(const char* data, const size_t& size) {
+  if (size < kTelemetryHeaderSize) return 0u;
+  PayloadReader reader(data + 4u, 4u);
+  uint32_t payload_size = 0u;
+  reader.readUInt(&payload_size);
+  const size_t packet_size = kTelemetryHeaderSize + payload_size;
+  return size < packet_size ? 0u : packet_size;
+}
+
+bool TelemetryDecoder::decodePacket(const char* data,
+                                    const size_t& size,
+                                    TelemetryPacketType* type) {
+  CHECK_NOTNULL(data);
+  PayloadReader header_reader(data, std::min(size, kTelemetryHeaderSize));
+  uint16_t magic = 0u;
+  uint8_t version = 0u;
+  uint8_t packet_type = 0u;
+  uint32_t payload_size = 0u;
+  if (!header_reader.readUInt(&magic) || !header_reader.readUInt(&version) ||
+      !header_reader.readUInt(&packet_type) ||
+      !header_reader.readUInt(&payload_size)) {
+    LOG(WARNING) << "Telemetry packet too short: " << size << " bytes.";
+    return false;
+  }
+  if (magic != kTelemetryMagic || version != kTelemetryVersion) {
+    LOG(WARNING) << "Unsupported telemetry packet, magic: " << magic
+                 << ", version: " << static_cast<int>(version) << ".";
+    return false;
+  }
+  if (size != kTelemetryHeaderSize + payload_size) {
+    LOG(WARNING) << "Telemetry packet of " << size << " bytes, expected "
+                 << kTelemetryHeaderSize + payload_size << ".";
+    return false;
+  }
+
+  PayloadReader reader(data + kTelemetryHeaderSize, payload_size);
+  bool success = false;
+  switch (static_cast<TelemetryPacketType>(packet_type)) {
+    case TelemetryPacketType::kMapSnapshot: {
+      map_ = TelemetryMap();
+      success = decodeMap(&reader, &map_);
+      break;
+    }
+    case TelemetryPacketType::kMapDelta: {
+      success = decodeMap(&reader, &map_);
+      break;
+    }
+    case TelemetryPacketType::kImage: {
+      uint64_t timestamp = 0u;
+      success = reader.readUInt(&timestamp) &&
+                reader.readString(&image_.name_) &&
+                reader.readString(&image_.data_);
+      image_.timestamp_ = static_cast<Timestamp>(timestamp);
+      break;
+    }
+    default: {
+      LOG(WARNING) << "Unknown telemetry packet type: "
+                   << static_cast<int>(packet_type) << ".";
+      return false;
+    }
+  }
+  success = success && reader.atEnd();
+  LOG_IF(WARNING, !success) << "Malformed telemetry packet.";
+  if (type) *type = static_cast<TelemetryPacketType>(packet_type);
+  return success;
+}
+
+}  // namespace VIO
@@ -0,0 +1,219 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   TelemetryDisplay.cpp
+ * @brief  Streams the map essentials and image thumbnails to external
+ * viewers, instead of rendering them.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/visualizer/TelemetryDisplay.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include <glog/logging.h>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "kimera-vio/visualizer/DisplayFactory.h"
+#include "kimera-vio/visualizer/TelemetryVisualizer3D.h"
+
+namespace VIO {
+
+namespace {
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+// SO_NOSIGPIPE is set on the sockets instead.
+constexpr int kSendFlags = 0;
+#endif
+
+void setNonBlocking(const int& fd) {
+  const int flags = fcntl(fd, F_GETFL, 0);
+  CHECK_GE(flags, 0) << std::strerror(errno);
+  CHECK_GE(fcntl(fd, F_SETFL, flags | O_NONBLOCK), 0) << std::strerror(errno);
+}
+}  // namespace
+
+TelemetryDisplay::TelemetryDisplay(
+    DisplayParams::Ptr display_params,
+    const ShutdownPipelineCallback& /*shutdown_pipeline_cb*/)
+    : DisplayBase(display_params->display_type_),
+      params_(*CHECK_NOTNULL(
+          std::dynamic_pointer_cast<TelemetryDisplayParams>(display_params))),
+      encoder_(static_cast<float>(params_.position_tolerance_)),
+      server_fd_(-1),
+      port_(params_.port_),
+      viewers_() {
+  server_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  CHECK_GE(server_fd_, 0) << "Cannot create the telemetry socket: "
+                          << std::strerror(errno);
+  const int enable = 1;
+  setsockopt(server_fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+  sockaddr_in address;
+  std::memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(static_cast<uint16_t>(port_));
+  CHECK_EQ(bind(server_fd_,
+                reinterpret_cast<const sockaddr*>(&address),
+                sizeof(address)),
+           0)
+      << "Cannot bind the telemetry socket to port " << port_ << ": "
+      << std::strerror(errno);
+  CHECK_EQ(listen(server_fd_, 4), 0) << std::strerror(errno);
+  setNonBlocking(server_fd_);
+
+  socklen_t address_size = sizeof(address);
+  CHECK_EQ(getsockname(server_fd_,
+                       reinterpret_cast<sockaddr*>(&address),
+                       &address_size),
+           0);
+  port_ = ntohs(address.sin_port);
+  LOG(INFO) << "Telemetry display listening on port " << port_ << ".";
+}
+
+TelemetryDisplay::~TelemetryDisplay() {
+  for (const Viewer& viewer : viewers_) close(viewer.socket_fd_);
+  if (server_fd_ >= 0) close(server_fd_);
+}
+
+void TelemetryDisplay::spinOnce(DisplayInputBase::UniquePtr&& display_input) {
+  CHECK(display_input);
+  acceptViewers();
+
+  // The delta is encoded even without viewers: it keeps the encoded map,
+  // from which new viewers get their snapshot, up to date.
+  std::string map_delta;
+  const TelemetryOutput* telemetry_output =
+      dynamic_cast<const TelemetryOutput*>(display_input.get());
+  if (telemetry_output) {
+    encoder_.encodeMapDelta(telemetry_output->map_, &map_delta);
+  }
+  if (viewers_.empty()) return;
+
+  std::string snapshot;
+  std::string images;
+  encodeImages(*display_input, &images);
+  for (Viewer& viewer : viewers_) {
+    if (viewer.needs_snapshot_) {
+      if (snapshot.empty()) encoder_.encodeMapSnapshot(&snapshot);
+      viewer.pending_ += snapshot;
+      viewer.needs_snapshot_ = false;
+    } else {
+      viewer.pending_ += map_delta;
+    }
+    viewer.pending_ += images;
+  }
+
+  for (auto it = viewers_.begin(); it != viewers_.end();) {
+    if (sendPending(&*it)) {
+      ++it;
+    } else {
+      close(it->socket_fd_);
+      it = viewers_.erase(it);
+    }
+  }
+}
+
+void TelemetryDisplay::acceptViewers() {
+  while (true) {
+    const int socket_fd = accept(server_fd_, nullptr, nullptr);
+    if (socket_fd < 0) {
+      LOG_IF(WARNING, errno != EAGAIN && errno != EWOULDBLOCK)
+          << "Cannot accept telemetry viewer: " << std::strerror(errno);
+      return;
+    }
+    setNonBlocking(socket_fd);
+    const int enable = 1;
+    setsockopt(socket_fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+#ifdef SO_NOSIGPIPE
+    setsockopt(socket_fd, SOL_SOCKET, SO_NOSIGPIPE, &enable, sizeof(enable));
+#endif
+    LOG(INFO) << "New telemetry viewer.";
+    viewers_.push_back({socket_fd, std::string(), true});
+  }
+}
+
+void TelemetryDisplay::encodeImages(const DisplayInputBase& display_input,
+                                    std::string* packets) const {
+  CHECK_NOTNULL(packets);
+  const std::vector<int> jpeg_params = {cv::IMWRITE_JPEG_QUALITY,
+                                        params_.jpeg_quality_};
+  for (const ImageToDisplay& image_to_display :
+       display_input.images_to_display_) {
+    const cv::Mat& image = image_to_display.image_;
+    if (image.empty()) continue;
+    cv::Mat thumbnail = image;
+    if (image.cols > params_.thumbnail_width_) {
+      const double scale =
+          static_cast<double>(params_.thumbnail_width_) / image.cols;
+      cv::resize(image, thumbnail, cv::Size(), scale, scale, cv::INTER_AREA);
+    }
+    std::vector<uchar> jpeg;
+    if (!cv::imencode(".jpg", thumbnail, jpeg, jpeg_params)) {
+      LOG(WARNING) << "Cannot encode image: " << image_to_display.name_;
+      continue;
+    }
+    TelemetryImage telemetry_image;
+    telemetry_image.timestamp_ = display_input.timestamp_;
+    telemetry_image.name_ = image_to_display.name_;
+    telemetry_image.data_.assign(jpeg.begin(), jpeg.end());
+    TelemetryEncoder::encodeImage(telemetry_image, packets);
+  }
+}
+
+bool TelemetryDisplay::sendPending(Viewer* viewer) const {
+  CHECK_NOTNULL(viewer);
+  size_t sent_size = 0u;
+  while (sent_size < viewer->pending_.size()) {
+    const ssize_t size = send(viewer->socket_fd_,
+                              viewer->pending_.data() + sent_size,
+                              viewer->pending_.size() - sent_size,
+                              kSendFlags);
+    if (size < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+      LOG(INFO) << "Telemetry viewer disconnected: " << std::strerror(errno);
+      return false;
+    }
+    sent_size += static_cast<size_t>(size);
+  }
+  viewer->pending_.erase(0u, sent_size);
+  if (viewer->pending_.size() >
+      static_cast<size_t>(params_.max_pending_bytes_)) {
+    LOG(WARNING) << "Telemetry viewer lagging behind by "
+                 << viewer->pending_.size() << " bytes, disconnecting it.";
+    return false;
+  }
+  return true;
+}
+
+namespace {
+[[maybe_unused]] const bool kTelemetryDisplayRegistered =
+    DisplayFactory::registerDisplay(
+        DisplayType::kTelemetry,
+        [](DisplayParams::Ptr display_params,
+           const ShutdownPipelineCallback& shutdown_pipeline_cb) {
+          return std::make_unique<TelemetryDisplay>(display_params,
+                                                    shutdown_pipeline_cb);
+        });
+}  // namespace
+
+}  // namespace VIO
@@ -0,0 +1,86 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   TelemetryDisplayParams.cpp
+ * @brief  Params for the telemetry display
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/visualizer/TelemetryDisplayParams.h"
+
+#include <cmath>
+
+#include <glog/logging.h>
+
+#include "kimera-vio/utils/YamlParser.h"
+
+namespace VIO {
+
+TelemetryDisplayParams::TelemetryDisplayParams()
+    : DisplayParams(DisplayType::kTelemetry) {
+  CHECK(display_type_ == DisplayType::kTelemetry);
+}
+
+bool TelemetryDisplayParams::parseYAML(const std::string& filepath) {
+  bool parent = DisplayParams::parseYAML(filepath);
+  // Optional: the display params file is shared with the other displays.
+  YamlParser yaml_parser(filepath);
+  if (yaml_parser.hasParam("telemetry_port")) {
+    yaml_parser.getYamlParam("telemetry_port", &port_);
+  }
+  if (yaml_parser.hasParam("telemetry_thumbnail_width")) {
+    yaml_parser.getYamlParam("telemetry_thumbnail_width", &thumbnail_width_);
+  }
+  if (yaml_parser.hasParam("telemetry_jpeg_quality")) {
+    yaml_parser.getYamlParam("telemetry_jpeg_quality", &jpeg_quality_);
+  }
+  if (yaml_parser.hasParam("telemetry_position_tolerance")) {
+    yaml_parser.getYamlParam("telemetry_position_tolerance",
+                             &position_tolerance_);
+  }
+  if (yaml_parser.hasParam("telemetry_max_pending_bytes")) {
+    yaml_parser.getYamlParam("telemetry_max_pending_bytes",
+                             &max_pending_bytes_);
+  }
+  CHECK_GE(port_, 0);
+  CHECK_GT(thumbnail_width_, 0);
+  CHECK_GE(position_tolerance_, 0.0);
+  CHECK_GT(max_pending_bytes_, 0);
+  return true && parent;
+}
+
+void TelemetryDisplayParams::print() const {
+  std::stringstream out;
+  PipelineParams::print(out,
+                        "Display Type ",
+                        VIO::to_underlying(display_type_),
+                        "Target FPS ",
+                        target_fps_,
+                        "Telemetry Port ",
+                        port_,
+                        "Thumbnail Width ",
+                        thumbnail_width_,
+                        "JPEG Quality ",
+                        jpeg_quality_,
+                        "Position Tolerance ",
+                        position_tolerance_,
+                        "Max Pending Bytes ",
+                        max_pending_bytes_);
+}
+
+bool TelemetryDisplayParams::equals(const TelemetryDisplayParams& tel_par,
+                                    const double& tol) const {
+  return DisplayParams::equals(tel_par, tol) && port_ == tel_par.port_ &&
+         thumbnail_width_ == tel_par.thumbnail_width_ &&
+         jpeg_quality_ == tel_par.jpeg_quality_ &&
+         std::fabs(position_tolerance_ - tel_par.position_tolerance_) <= tol &&
+         max_pending_bytes_ == tel_par.max_pending_bytes_;
+}
+
+}  // namespace VIO
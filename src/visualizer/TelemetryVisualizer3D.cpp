@@ -0,0 +1,83 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   TelemetryVisualizer3D.cpp
+ * @brief  Gathers the map essentials for TelemetryDisplay, without building
+ * any 3D widget.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/visualizer/TelemetryVisualizer3D.h"
+
+#include <glog/logging.h>
+
+#include "kimera-vio/visualizer/Visualizer3DFactory.h"
+
+namespace VIO {
+
+TelemetryVisualizer3D::TelemetryVisualizer3D(
+    const VisualizationType& viz_type)
+    : Visualizer3D(viz_type) {}
+
+VisualizerOutput::UniquePtr TelemetryVisualizer3D::spinOnce(
+    const VisualizerInput& input) {
+  if (!input.backend_output_) return nullptr;
+
+  TelemetryOutput::UniquePtr output = std::make_unique<TelemetryOutput>();
+  output->timestamp_ = input.timestamp_;
+  output->visualization_type_ = visualization_type_;
+  TelemetryMap& map = output->map_;
+  map.timestamp_ = input.timestamp_;
+
+  const gtsam::Pose3& W_Pose_B = input.backend_output_->W_State_Blkf_.pose_;
+  const gtsam::Point3& position = W_Pose_B.translation();
+  map.position_ = {{position.x(), position.y(), position.z()}};
+  const gtsam::Quaternion orientation = W_Pose_B.rotation().toQuaternion();
+  map.orientation_ = {
+      {orientation.w(), orientation.x(), orientation.y(), orientation.z()}};
+
+  if (visualization_type_ == VisualizationType::kNone) return output;
+
+  for (const auto& lmk : input.backend_output_->landmarks_with_id_map_) {
+    map.landmarks_[lmk.first] = {{static_cast<float>(lmk.second.x()),
+                                  static_cast<float>(lmk.second.y()),
+                                  static_cast<float>(lmk.second.z())}};
+  }
+
+  if (visualization_type_ == VisualizationType::kMesh2dTo3dSparse &&
+      input.mesher_output_) {
+    const Mesh3D& mesh_3d = input.mesher_output_->mesh_3d_;
+    CHECK_EQ(mesh_3d.getMeshPolygonDimension(), 3u)
+        << "Only triangular meshes are supported.";
+    for (size_t i = 0u; i < mesh_3d.getNumberOfPolygons(); ++i) {
+      TelemetryTriangle triangle;
+      for (size_t j = 0u; j < 3u; ++j) {
+        LandmarkId lmk_id;
+        CHECK(mesh_3d.getLmkIdForVtxId(mesh_3d.getPolygonVertexId(i, j),
+                                       &lmk_id));
+        const Vertex3D& vertex = mesh_3d.getPolygonVertexPosition(i, j);
+        map.mesh_vertices_[lmk_id] = {{vertex.x, vertex.y, vertex.z}};
+        triangle[j] = lmk_id;
+      }
+      map.mesh_triangles_.insert(triangle);
+    }
+  }
+  return output;
+}
+
+namespace {
+[[maybe_unused]] const bool kTelemetryVisualizerRegistered =
+    VisualizerFactory::registerVisualizer(
+        VisualizerType::kTelemetry,
+        [](const VisualizationType& viz_type, const BackendType&) {
+          return std::make_unique<TelemetryVisualizer3D>(viz_type);
+        });
+}  // namespace
+
+}  // namespace VIO
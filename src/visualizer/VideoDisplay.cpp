@@ -0,0 +1,203 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   VideoDisplay.cpp
+ * @brief  Renders the visualizer output offscreen and encodes it to videos.
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/visualizer/VideoDisplay.h"
+
+#include <algorithm>
+#include <cctype>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <opencv2/core/version.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "kimera-vio/utils/FilesystemUtils.h"
+#include "kimera-vio/visualizer/DisplayFactory.h"
+
+// Encoder params, e.g. hardware acceleration, are in OpenCV >= 4.5.2.
+#if CV_VERSION_MAJOR > 4 ||                              \
+    (CV_VERSION_MAJOR == 4 &&                            \
+     (CV_VERSION_MINOR > 5 ||                            \
+      (CV_VERSION_MINOR == 5 && CV_VERSION_REVISION >= 2)))
+#define KIMERA_VIDEOIO_HW_ACCELERATION
+#endif
+
+namespace VIO {
+
+const std::string VideoDisplay::k3dStreamName = "3d_viz";
+
+namespace {
+
+//! Image names are e.g. "Left Image Rectified": safe file names instead.
+std::string toFileName(const std::string& stream_name) {
+  std::string file_name = stream_name;
+  for (char& c : file_name) {
+    if (!std::isalnum(static_cast<unsigned char>(c))) c = '_';
+  }
+  return file_name;
+}
+
+}  // namespace
+
+VideoDisplay::VideoDisplay(
+    DisplayParams::Ptr display_params,
+    const ShutdownPipelineCallback& /*shutdown_pipeline_cb*/)
+    : DisplayBase(display_params->display_type_),
+      params_(*CHECK_NOTNULL(
+          std::dynamic_pointer_cast<VideoDisplayParams>(display_params))),
+      window_("Video Display"),
+      streams_() {
+  if (params_.record_3d_) {
+    // Before anything is rendered: no window is ever created.
+    window_.setOffScreenRendering();
+    window_.setWindowSize(cv::Size(params_.width_3d_, params_.height_3d_));
+    window_.setBackgroundColor(cv::viz::Color::black());
+    window_.showWidget("Coordinate Widget", cv::viz::WCoordinateSystem());
+  }
+}
+
+void VideoDisplay::spinOnce(DisplayInputBase::UniquePtr&& display_input) {
+  CHECK(display_input);
+  for (const ImageToDisplay& img_to_display :
+       display_input->images_to_display_) {
+    writeFrame(img_to_display.name_, img_to_display.image_);
+  }
+
+  // Only the OpenCV visualizer output has widgets.
+  const VisualizerOutput* viz_output =
+      dynamic_cast<const VisualizerOutput*>(display_input.get());
+  if (params_.record_3d_ && viz_output &&
+      viz_output->visualization_type_ != VisualizationType::kNone) {
+    writeFrame(k3dStreamName, render3d(*viz_output));
+  }
+}
+
+size_t VideoDisplay::getNumberOfFrames(const std::string& stream_name) const {
+  const auto it = streams_.find(stream_name);
+  return it == streams_.end() ? 0u : it->second.nr_frames_;
+}
+
+bool VideoDisplay::isHardwareAccelerated(
+    const std::string& stream_name) const {
+  const auto it = streams_.find(stream_name);
+  return it != streams_.end() && it->second.hardware_accelerated_;
+}
+
+cv::Mat VideoDisplay::render3d(const VisualizerOutput& viz_output) {
+  // Same widget updates as OpenCv3dDisplay::spin3dWindow.
+  for (const std::string& widget_id : viz_output.widget_ids_to_remove_) {
+    try {
+      window_.removeWidget(widget_id);
+    } catch (const cv::Exception& e) {
+      VLOG(20) << e.what();
+    }
+  }
+  for (const auto& widget : viz_output.widgets_) {
+    CHECK(widget.second);
+    // OpenCV issue #10829: cv::viz::Widget3D::getPose segfaults otherwise.
+    widget.second->updatePose(cv::Affine3d());
+    window_.showWidget(widget.first, *widget.second, widget.second->getPose());
+  }
+  // Renders the offscreen window.
+  return window_.getScreenshot();
+}
+
+void VideoDisplay::writeFrame(const std::string& stream_name,
+                              const cv::Mat& frame) {
+  if (frame.empty()) return;
+  VideoStream& stream = streams_[stream_name];
+  if (stream.failed_) return;
+
+  // The encoders take 8-bit BGR images.
+  cv::Mat bgr = frame;
+  if (bgr.depth() != CV_8U) {
+    cv::normalize(frame, bgr, 0.0, 255.0, cv::NORM_MINMAX, CV_8U);
+  }
+  if (bgr.channels() == 1) {
+    cv::cvtColor(bgr, bgr, cv::COLOR_GRAY2BGR);
+  } else if (bgr.channels() == 4) {
+    cv::cvtColor(bgr, bgr, cv::COLOR_BGRA2BGR);
+  }
+  CHECK_EQ(bgr.type(), CV_8UC3);
+
+  if (!stream.writer_.isOpened()) {
+    // Even sizes, as required by the chroma subsampling of H.264/HEVC.
+    const cv::Size size(std::max(bgr.cols & ~1, 2), std::max(bgr.rows & ~1, 2));
+    if (!openStream(stream_name, size, &stream)) {
+      stream.failed_ = true;
+      return;
+    }
+  }
+  if (bgr.size() != stream.size_) {
+    cv::resize(bgr, bgr, stream.size_, 0.0, 0.0, cv::INTER_AREA);
+  }
+  stream.writer_.write(bgr);
+  ++stream.nr_frames_;
+}
+
+bool VideoDisplay::openStream(const std::string& stream_name,
+                              const cv::Size& size,
+                              VideoStream* stream) const {
+  CHECK_NOTNULL(stream);
+  int fourcc = cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+  if (params_.codec_ == "h264") {
+    fourcc = cv::VideoWriter::fourcc('a', 'v', 'c', '1');
+  } else if (params_.codec_ == "hevc") {
+    fourcc = cv::VideoWriter::fourcc('h', 'v', 'c', '1');
+  }
+  const std::string filename = common::pathAppend(
+      params_.output_path_,
+      toFileName(stream_name) + (params_.codec_ == "mjpg" ? ".avi" : ".mp4"));
+
+  stream->size_ = size;
+  stream->hardware_accelerated_ = false;
+#ifdef KIMERA_VIDEOIO_HW_ACCELERATION
+  if (params_.hardware_acceleration_) {
+    const std::vector<int> hw_params = {cv::VIDEOWRITER_PROP_HW_ACCELERATION,
+                                        cv::VIDEO_ACCELERATION_ANY};
+    if (stream->writer_.open(
+            filename, cv::CAP_ANY, fourcc, params_.fps_, size, hw_params)) {
+      stream->hardware_accelerated_ =
+          stream->writer_.get(cv::VIDEOWRITER_PROP_HW_ACCELERATION) !=
+          cv::VIDEO_ACCELERATION_NONE;
+    }
+  }
+#endif
+  if (!stream->writer_.isOpened() &&
+      !stream->writer_.open(
+          filename, cv::CAP_ANY, fourcc, params_.fps_, size, true)) {
+    LOG(ERROR) << "Could not open a " << params_.codec_
+               << " video encoder for: " << filename;
+    return false;
+  }
+  LOG(INFO) << "Recording " << stream_name << " to " << filename << " ("
+            << params_.codec_ << ", " << size << ", "
+            << (stream->hardware_accelerated_ ? "hardware" : "software")
+            << " encoder).";
+  return true;
+}
+
+namespace {
+[[maybe_unused]] const bool kVideoDisplayRegistered =
+    DisplayFactory::registerDisplay(
+        DisplayType::kVideo,
+        [](DisplayParams::Ptr display_params,
+           const ShutdownPipelineCallback& shutdown_pipeline_cb) {
+          return std::make_unique<VideoDisplay>(display_params,
+                                                shutdown_pipeline_cb);
+        });
+}  // namespace
+
+}  // namespace VIO
@@ -0,0 +1,96 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   VideoDisplayParams.cpp
+ * @brief  Params for the video display
+ * @author Antoni Rosinol
+ */
+
+#include "kimera-vio/visualizer/VideoDisplayParams.h"
+
+#include <cmath>
+
+#include <glog/logging.h>
+
+#include "kimera-vio/utils/YamlParser.h"
+
+namespace VIO {
+
+VideoDisplayParams::VideoDisplayParams() : DisplayParams(DisplayType::kVideo) {
+  CHECK(display_type_ == DisplayType::kVideo);
+}
+
+bool VideoDisplayParams::parseYAML(const std::string& filepath) {
+  bool parent = DisplayParams::parseYAML(filepath);
+  // Optional: the display params file is shared with the other displays.
+  YamlParser yaml_parser(filepath);
+  if (yaml_parser.hasParam("video_output_path")) {
+    yaml_parser.getYamlParam("video_output_path", &output_path_);
+  }
+  if (yaml_parser.hasParam("video_codec")) {
+    yaml_parser.getYamlParam("video_codec", &codec_);
+  }
+  if (yaml_parser.hasParam("video_fps")) {
+    yaml_parser.getYamlParam("video_fps", &fps_);
+  }
+  if (yaml_parser.hasParam("video_hardware_acceleration")) {
+    yaml_parser.getYamlParam("video_hardware_acceleration",
+                             &hardware_acceleration_);
+  }
+  if (yaml_parser.hasParam("video_record_3d")) {
+    yaml_parser.getYamlParam("video_record_3d", &record_3d_);
+  }
+  if (yaml_parser.hasParam("video_width_3d")) {
+    yaml_parser.getYamlParam("video_width_3d", &width_3d_);
+  }
+  if (yaml_parser.hasParam("video_height_3d")) {
+    yaml_parser.getYamlParam("video_height_3d", &height_3d_);
+  }
+  CHECK(codec_ == "h264" || codec_ == "hevc" || codec_ == "mjpg")
+      << "Unknown video codec: " << codec_;
+  CHECK_GT(fps_, 0.0);
+  CHECK_GT(width_3d_, 0);
+  CHECK_GT(height_3d_, 0);
+  return true && parent;
+}
+
+void VideoDisplayParams::print() const {
+  std::stringstream out;
+  PipelineParams::print(out,
+                        "Display Type ",
+                        VIO::to_underlying(display_type_),
+                        "Target FPS ",
+                        target_fps_,
+                        "Output Path ",
+                        output_path_,
+                        "Codec ",
+                        codec_,
+                        "Video FPS ",
+                        fps_,
+                        "Hardware Acceleration ",
+                        hardware_acceleration_,
+                        "Record 3D ",
+                        record_3d_,
+                        "3D Width ",
+                        width_3d_,
+                        "3D Height ",
+                        height_3d_);
+}
+
+bool VideoDisplayParams::equals(const VideoDisplayParams& vid_par,
+                                const double& tol) const {
+  return DisplayParams::equals(vid_par, tol) &&
+         output_path_ == vid_par.output_path_ && codec_ == vid_par.codec_ &&
+         std::fabs(fps_ - vid_par.fps_) <= tol &&
+         hardware_acceleration_ == vid_par.hardware_acceleration_ &&
+         record_3d_ == vid_par.record_3d_ && width_3d_ == vid_par.width_3d_ &&
+         height_3d_ == vid_par.height_3d_;
+}
+
+}  // namespace VIO
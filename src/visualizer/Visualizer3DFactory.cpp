@@ -13,26 +13,72 @@
  */
 
 #include "kimera-vio/visualizer/Visualizer3DFactory.h"
-#include "kimera-vio/visualizer/OpenCvVisualizer3D.h"
+
+#include <map>
+#include <mutex>
 
 namespace VIO {
 
+namespace {
+
+struct VisualizerRegistry {
+  std::mutex mutex_;
+  std::map<VisualizerType, VisualizerFactory::VisualizerCreator> creators_;
+};
+
+//! Constructed on first use: visualizers register from static initializers.
+VisualizerRegistry& getVisualizerRegistry() {
+  static VisualizerRegistry registry;
+  return registry;
+}
+
+}  // namespace
+
+bool VisualizerFactory::registerVisualizer(
+    const VisualizerType& visualizer_type,
+    const VisualizerCreator& creator) {
+  CHECK(creator);
+  VisualizerRegistry& registry = getVisualizerRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex_);
+  registry.creators_[visualizer_type] = creator;
+  return true;
+}
+
+bool VisualizerFactory::isVisualizerRegistered(
+    const VisualizerType& visualizer_type) {
+  VisualizerRegistry& registry = getVisualizerRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex_);
+  return registry.creators_.count(visualizer_type) > 0u;
+}
+
+VisualizerType VisualizerFactory::getVisualizerTypeForDisplay(
+    const DisplayType& display_type) {
+  // The Pangolin display renders the data of the telemetry output.
+  return display_type == DisplayType::kTelemetry ||
+                 display_type == DisplayType::kPangolin
+             ? VisualizerType::kTelemetry
+             : VisualizerType::OpenCV;
+}
+
 Visualizer3D::UniquePtr VisualizerFactory::createVisualizer(
     const VisualizerType visualizer_type,
     const VisualizationType& viz_type,
     const BackendType& backend_type) {
-  switch (visualizer_type) {
-    case VisualizerType::OpenCV: {
-      return std::make_unique<OpenCvVisualizer3D>(viz_type, backend_type);
-    }
-    default: {
-      LOG(FATAL) << "Requested visualizer type is not supported.\n"
-                 << "Currently supported visualizer types:\n"
-                 << "0: OpenCV 3D viz\n 1: Pangolin (not supported yet)\n"
-                 << " but requested visualizer: "
-                 << static_cast<int>(visualizer_type);
-    }
+  VisualizerCreator creator;
+  {
+    VisualizerRegistry& registry = getVisualizerRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex_);
+    const auto it = registry.creators_.find(visualizer_type);
+    if (it != registry.creators_.end()) creator = it->second;
+  }
+  if (!creator) {
+    LOG(ERROR) << "Requested visualizer type is not built: "
+               << static_cast<int>(visualizer_type) << "\n"
+               << "Visualizer types: 0: OpenCV 3D viz (needs "
+               << "KIMERA_BUILD_GUI), 1: Telemetry.";
+    return nullptr;
   }
+  return creator(viz_type, backend_type);
 }
 
 }  // namespace VIO
@@ -0,0 +1,116 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   StaticStereoImuSequence.h
+ * @brief  Synthetic stereo and IMU sequence of a platform at rest, to run the
+ * stereo pipelines without a dataset.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <glog/logging.h>
+
+#include "kimera-vio/common/vio_types.h"
+#include "kimera-vio/frontend/Frame.h"
+#include "kimera-vio/pipeline/Pipeline-definitions.h"
+#include "kimera-vio/utils/UtilsOpenCV.h"
+
+namespace VIO::test {
+
+/**
+ * @brief The StaticStereoImuSequence class: a platform at rest in front of
+ * the EuRoC stereo pair of the test data, seen again at each frame, and an
+ * IMU measuring the gravity only. The platform is at getInitialState(), from
+ * which the Backend of the given params is initialized.
+ */
+class StaticStereoImuSequence {
+ public:
+  /**
+   * @param test_data_path The FLAGS_test_data_path of the tests.
+   * @param params Vio parameters of the EurocParams of the test data: the
+   * Backend is set to be initialized at the initial state.
+   */
+  StaticStereoImuSequence(const std::string& test_data_path,
+                          VioParams* params,
+                          const size_t& nr_frames = 30u)
+      : nr_frames_(nr_frames),
+        camera_params_(CHECK_NOTNULL(params)->camera_params_),
+        specific_force_(-params->imu_params_.n_gravity_),
+        left_img_(UtilsOpenCV::ReadAndConvertToGrayScale(
+            test_data_path + "/ForStereoFrame/left_img_0.png")),
+        right_img_(UtilsOpenCV::ReadAndConvertToGrayScale(
+            test_data_path + "/ForStereoFrame/right_img_0.png")) {
+    CHECK_EQ(camera_params_.size(), 2u);
+    CHECK_GT(nr_frames_, 0u);
+    CHECK(params->backend_params_);
+    params->backend_params_->autoInitialize_ = 0;
+    params->backend_params_->initial_ground_truth_state_ = getInitialState();
+  }
+
+  inline size_t size() const { return nr_frames_; }
+
+  //! Upright and at rest, not at the identity which the Backend rejects.
+  static VioNavState getInitialState() {
+    VioNavState state;
+    state.pose_ = gtsam::Pose3(gtsam::Rot3(), gtsam::Point3(1.0, 0.0, 0.0));
+    return state;
+  }
+
+  //! 20 Hz frames, from 1 s.
+  static Timestamp getTimestamp(const size_t& k) {
+    return kFirstTimestamp + static_cast<Timestamp>(k) * kFramePeriod;
+  }
+
+  /**
+   * @brief getImu The 200 Hz IMU measurements since the previous frame, up to
+   * the frame k, as the data provider would give them. Only the one at the
+   * frame for the first frame.
+   */
+  void getImu(const size_t& k,
+              ImuStampS* imu_stamps,
+              ImuAccGyrS* imu_accgyrs) const {
+    CHECK_NOTNULL(imu_stamps);
+    CHECK_NOTNULL(imu_accgyrs);
+    const int nr_imu = k == 0u ? 1 : static_cast<int>(kImuPerFrame);
+    imu_stamps->resize(1, nr_imu);
+    imu_accgyrs->resize(6, nr_imu);
+    for (int i = 0; i < nr_imu; ++i) {
+      (*imu_stamps)(0, i) =
+          getTimestamp(k) - (nr_imu - 1 - i) * (kFramePeriod / kImuPerFrame);
+      imu_accgyrs->col(i) << specific_force_, gtsam::Vector3::Zero();
+    }
+  }
+
+  Frame::UniquePtr makeLeftFrame(const size_t& k) const {
+    return std::make_unique<Frame>(
+        k, getTimestamp(k), camera_params_.at(0u), left_img_.clone());
+  }
+
+  Frame::UniquePtr makeRightFrame(const size_t& k) const {
+    return std::make_unique<Frame>(
+        k, getTimestamp(k), camera_params_.at(1u), right_img_.clone());
+  }
+
+ private:
+  static constexpr Timestamp kFirstTimestamp = 1000000000;
+  static constexpr Timestamp kFramePeriod = 50000000;
+  static constexpr Timestamp kImuPerFrame = 10;
+
+  const size_t nr_frames_;
+  const MultiCameraParams camera_params_;
+  const gtsam::Vector3 specific_force_;
+  const cv::Mat left_img_;
+  const cv::Mat right_img_;
+};
+
+}  // namespace VIO::test
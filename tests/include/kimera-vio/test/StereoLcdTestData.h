@@ -0,0 +1,203 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   StereoLcdTestData.h
+ * @brief  Stereo keyframes of the loop closure test data, as the robots of a
+ * RemoteLcdServer stream them.
+ * @author Antoni Rosinol
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <DBoW2/DBoW2.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtsam/geometry/Pose3.h>
+
+#include "kimera-vio/frontend/CameraParams.h"
+#include "kimera-vio/frontend/StereoCamera.h"
+#include "kimera-vio/frontend/StereoFrame.h"
+#include "kimera-vio/frontend/StereoMatcher.h"
+#include "kimera-vio/frontend/VisionImuFrontendParams.h"
+#include "kimera-vio/frontend/feature-detector/FeatureDetector.h"
+#include "kimera-vio/loopclosure/LoopClosureDetector.h"
+#include "kimera-vio/loopclosure/RemoteLcdCodec.h"
+#include "kimera-vio/utils/UtilsOpenCV.h"
+
+DECLARE_string(vocabulary_path);
+
+namespace VIO::test {
+
+/**
+ * @brief The StereoLcdTestData class: the four stereo images of the
+ * ForLoopClosureDetector test data (match1, query1, match2, query2: the
+ * queries close a loop with their matches), with their ground-truth poses,
+ * and the LoopClosureDetectors of the test parameters to process them.
+ */
+class StereoLcdTestData {
+ public:
+  static constexpr size_t kMatch1 = 0u;
+  static constexpr size_t kQuery1 = 1u;
+  static constexpr size_t kMatch2 = 2u;
+  static constexpr size_t kQuery2 = 3u;
+
+  explicit StereoLcdTestData(const std::string& test_data_path)
+      : data_path_(test_data_path + "/ForLoopClosureDetector") {
+    frontend_params_.parseYAML(data_path_ + "/FrontendParams.yaml");
+    cam_params_left_.parseYAML(data_path_ + "/sensorLeft.yaml");
+    cam_params_right_.parseYAML(data_path_ + "/sensorRight.yaml");
+    stereo_camera_ =
+        std::make_shared<StereoCamera>(cam_params_left_, cam_params_right_);
+    stereo_matcher_ = std::make_unique<StereoMatcher>(
+        stereo_camera_, frontend_params_.stereo_matching_params_);
+    feature_detector_ =
+        std::make_unique<FeatureDetector>(FeatureDetectorParams());
+    lcd_params_.parseYAML(data_path_ + "/testLCDParameters.yaml");
+    lcd_params_.tracker_params_.pose_2d2d_algorithm_ =
+        Pose2d2dAlgorithm::NISTER;
+    FLAGS_vocabulary_path = data_path_ + "/small_voc.yml.gz";
+    robot_lcd_ = makeLcd<RobotLcd>(lcd_params_);
+  }
+
+  //! Ground-truth pose of the body of the image (EuRoC V1_01_easy).
+  static gtsam::Pose3 getWorldPoseBody(const size_t& image) {
+    switch (image) {
+      case kMatch1:
+        return gtsam::Pose3(gtsam::Rot3(gtsam::Quaternion(
+                                0.338337, 0.608466, -0.535476, 0.478082)),
+                            gtsam::Point3(1.573832, 2.023348, 1.738755));
+      case kQuery1:
+        return gtsam::Pose3(gtsam::Rot3(gtsam::Quaternion(
+                                0.478634, 0.415595, -0.700197, 0.328505)),
+                            gtsam::Point3(1.872115, 1.786064, 1.586159));
+      case kMatch2:
+        return gtsam::Pose3(gtsam::Rot3(gtsam::Quaternion(
+                                0.3394, -0.672895, -0.492724, -0.435018)),
+                            gtsam::Point3(-0.662997, -0.495046, 1.347300));
+      case kQuery2:
+        return gtsam::Pose3(gtsam::Rot3(gtsam::Quaternion(
+                                0.39266, -0.590667, -0.58023, -0.400326)),
+                            gtsam::Point3(-0.345638, -0.501712, 1.320441));
+      default:
+        LOG(FATAL) << "No image " << image << " in the test data.";
+    }
+    return gtsam::Pose3();
+  }
+
+  //! A LoopClosureDetector for the test images, run without a Backend queue.
+  template <class Lcd = LoopClosureDetector>
+  std::unique_ptr<Lcd> makeLcd(const LoopClosureDetectorParams& params) const {
+    auto lcd =
+        std::make_unique<Lcd>(params,
+                              stereo_camera_->getLeftCamParams(),
+                              stereo_camera_->getBodyPoseLeftCamRect(),
+                              stereo_camera_,
+                              frontend_params_.stereo_matching_params_,
+                              std::nullopt,
+                              false);
+    lcd->registerIsBackendQueueFilledCallback([]() { return false; });
+    return lcd;
+  }
+
+  //! The stereo keyframe of the image, with its stereo reconstruction.
+  StereoFrame::UniquePtr makeStereoFrame(const size_t& image,
+                                         const FrameId& frame_id,
+                                         const Timestamp& timestamp) const {
+    const std::string image_suffix = std::to_string(image) + ".png";
+    auto stereo_frame = std::make_unique<StereoFrame>(
+        frame_id,
+        timestamp,
+        Frame(frame_id,
+              timestamp,
+              cam_params_left_,
+              UtilsOpenCV::ReadAndConvertToGrayScale(data_path_ + "/left_img_" +
+                                                     image_suffix)),
+        Frame(frame_id,
+              timestamp,
+              cam_params_right_,
+              UtilsOpenCV::ReadAndConvertToGrayScale(
+                  data_path_ + "/right_img_" + image_suffix)));
+    feature_detector_->featureDetection(&stereo_frame->left_frame_);
+    stereo_frame->setIsKeyframe(true);
+    stereo_matcher_->sparseStereoReconstruction(stereo_frame.get());
+    stereo_frame->checkStereoFrame();
+    stereo_frame->left_frame_.keypoints_undistorted_ =
+        stereo_frame->left_keypoints_rectified_;
+    stereo_frame->right_frame_.keypoints_undistorted_ =
+        stereo_frame->right_keypoints_rectified_;
+    return stereo_frame;
+  }
+
+  /**
+   * @brief makeKeyframe The keyframe of the image as a robot streams it, and
+   * as the server decodes it.
+   * @param with_bow False to send it without its BoW vector, as if it was
+   * not worth looking for loop closures.
+   */
+  RemoteKeyframe makeKeyframe(const RobotId& robot_id,
+                              const FrameId& kf_id,
+                              const Timestamp& timestamp,
+                              const size_t& image,
+                              const gtsam::Pose3& W_Pose_Blkf,
+                              const bool& with_bow = true) {
+    RemoteKeyframe keyframe;
+    keyframe.robot_id_ = robot_id;
+    keyframe.kf_id_ = kf_id;
+    keyframe.timestamp_ = timestamp;
+    keyframe.W_Pose_Blkf_ = W_Pose_Blkf;
+    const FrameId frame_id = robot_lcd_->processAndAddStereoFrame(
+        *makeStereoFrame(image, kf_id, timestamp));
+    keyframe.frame_ = robot_lcd_->getFrameCache().getFrame(frame_id);
+    CHECK(keyframe.frame_);
+    if (with_bow) {
+      DBoW2::BowVector bow_vec;
+      robot_lcd_->computeBowVector(*keyframe.frame_, &bow_vec);
+      keyframe.bow_vec_.insert(bow_vec.begin(), bow_vec.end());
+    }
+
+    std::string packet;
+    RemoteLcdCodec::encodeKeyframe(keyframe, &packet);
+    RemoteKeyframe decoded;
+    CHECK(RemoteLcdCodec::decodeKeyframe(
+        packet.data(), packet.size(), &decoded));
+    return decoded;
+  }
+
+  inline const LoopClosureDetectorParams& getLcdParams() const {
+    return lcd_params_;
+  }
+  inline const StereoCamera::ConstPtr& getStereoCamera() const {
+    return stereo_camera_;
+  }
+
+ private:
+  //! Processes the keyframes as the RemoteLoopClosureDetector of a robot.
+  class RobotLcd : public LoopClosureDetector {
+   public:
+    using LoopClosureDetector::computeBowVector;
+    using LoopClosureDetector::LoopClosureDetector;
+  };
+
+ private:
+  const std::string data_path_;
+  FrontendParams frontend_params_;
+  CameraParams cam_params_left_;
+  CameraParams cam_params_right_;
+  LoopClosureDetectorParams lcd_params_;
+  StereoCamera::ConstPtr stereo_camera_;
+  StereoMatcher::UniquePtr stereo_matcher_;
+  FeatureDetector::UniquePtr feature_detector_;
+  std::unique_ptr<RobotLcd> robot_lcd_;
+};
+
+}  // namespace VIO::test
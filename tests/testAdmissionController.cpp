@@ -0,0 +1,107 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testAdmissionController.cpp
+ * @brief  test AdmissionController
+ * @author Antoni Rosinol
+ */
+
+#include <atomic>
+#include <string>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/pipeline/AdmissionController.h"
+
+namespace VIO {
+
+namespace {
+size_t countAdmitted(AdmissionController* controller,
+                     const size_t& module_id,
+                     const size_t& nr_inputs) {
+  CHECK_NOTNULL(controller);
+  size_t nr_admitted = 0u;
+  for (size_t i = 0u; i < nr_inputs; ++i) {
+    if (controller->admit(module_id)) ++nr_admitted;
+  }
+  return nr_admitted;
+}
+}  // namespace
+
+/* ************************************************************************* */
+TEST(testAdmissionController, loadWithHysteresis) {
+  std::atomic<size_t> depth(0u);
+  AdmissionController controller(1u, 3u, 6u);
+  controller.addCriticalPathQueue("backend_input_queue",
+                                  [&depth]() -> size_t { return depth; });
+  EXPECT_EQ(controller.getLoad(), CriticalPathLoad::kSlack);
+  depth = 2u;
+  EXPECT_EQ(controller.getLoad(), CriticalPathLoad::kSlack);
+  depth = 3u;
+  EXPECT_EQ(controller.getLoad(), CriticalPathLoad::kPressure);
+  EXPECT_TRUE(controller.isCriticalPathAtRisk());
+  depth = 6u;
+  EXPECT_EQ(controller.getLoad(), CriticalPathLoad::kCritical);
+  // Stays loaded until there is slack.
+  depth = 2u;
+  EXPECT_EQ(controller.getLoad(), CriticalPathLoad::kPressure);
+  depth = 1u;
+  EXPECT_EQ(controller.getLoad(), CriticalPathLoad::kSlack);
+  EXPECT_FALSE(controller.isCriticalPathAtRisk());
+}
+
+/* ************************************************************************* */
+TEST(testAdmissionController, decimatesUnderPressure) {
+  std::atomic<size_t> depth(0u);
+  AdmissionController controller(0u, 2u, 4u);
+  controller.addCriticalPathQueue("frontend_input_queue",
+                                  [&depth]() -> size_t { return depth; });
+  OptionalModuleBudget budget;
+  budget.decimation_under_pressure = 3u;
+  const size_t mesher_id = controller.registerOptionalModule("Mesher", budget);
+
+  EXPECT_EQ(countAdmitted(&controller, mesher_id, 12u), 12u);
+  depth = 2u;
+  EXPECT_EQ(countAdmitted(&controller, mesher_id, 12u), 4u);
+  depth = 4u;
+  EXPECT_EQ(countAdmitted(&controller, mesher_id, 12u), 0u);
+  // Resumes once there is slack.
+  depth = 0u;
+  EXPECT_EQ(countAdmitted(&controller, mesher_id, 12u), 12u);
+  EXPECT_NE(controller.print().find("Mesher\t48\t28"), std::string::npos);
+}
+
+/* ************************************************************************* */
+TEST(testAdmissionController, keepsModulesWithinBudget) {
+  AdmissionController controller(0u, 2u, 4u);
+  OptionalModuleBudget budget;
+  budget.budget_ms = 10.0;
+  const size_t lcd_id = controller.registerOptionalModule("Lcd", budget);
+  const size_t viz_id =
+      controller.registerOptionalModule("Visualizer", OptionalModuleBudget());
+
+  // Within budget.
+  controller.reportSpinDuration(lcd_id, 8.0);
+  EXPECT_EQ(countAdmitted(&controller, lcd_id, 10u), 10u);
+  // Four times its budget: one input out of four.
+  controller.reportSpinDuration(lcd_id, 40.0);
+  controller.reportSpinDuration(lcd_id, 40.0);
+  controller.reportSpinDuration(lcd_id, 40.0);
+  controller.reportSpinDuration(lcd_id, 40.0);
+  for (size_t i = 0u; i < 100u; ++i) {
+    controller.reportSpinDuration(lcd_id, 35.0);
+  }
+  EXPECT_EQ(countAdmitted(&controller, lcd_id, 12u), 3u);
+  // No budget.
+  controller.reportSpinDuration(viz_id, 1000.0);
+  EXPECT_EQ(countAdmitted(&controller, viz_id, 10u), 10u);
+}
+
+}  // namespace VIO
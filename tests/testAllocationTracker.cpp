@@ -0,0 +1,102 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testAllocationTracker.cpp
+ * @brief  test the allocation counting, linked with the interposer
+ * @author Antoni Rosinol
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/utils/AllocationTracker.h"
+#include "kimera-vio/utils/Statistics.h"
+
+DECLARE_int32(allocation_warmup_spins);
+
+namespace VIO {
+
+namespace {
+// Escapes the allocations, which could otherwise be elided.
+std::vector<int>* volatile escaped_values = nullptr;
+
+void allocate(const size_t& size) {
+  std::unique_ptr<std::vector<int>> values =
+      std::make_unique<std::vector<int>>(size, 1);
+  escaped_values = values.get();
+}
+}  // namespace
+
+class AllocationTrackerFixture : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    if (!utils::AllocationTracker::isEnabled()) {
+      GTEST_SKIP() << "The allocation functions are not interposed.";
+    }
+    warmup_spins_ = FLAGS_allocation_warmup_spins;
+    utils::AllocationTracker::reset();
+  }
+  void TearDown() override {
+    FLAGS_allocation_warmup_spins = warmup_spins_;
+    utils::AllocationTracker::reset();
+  }
+
+  int warmup_spins_ = 0;
+};
+
+/* ************************************************************************* */
+TEST_F(AllocationTrackerFixture, countsAllocationsOfTheThread) {
+  const utils::AllocationCounts before =
+      utils::AllocationTracker::getThreadCounts();
+  allocate(100u);
+  const utils::AllocationCounts after =
+      utils::AllocationTracker::getThreadCounts();
+  // The vector and its values.
+  EXPECT_GE(after.nr_allocations - before.nr_allocations, 2u);
+  EXPECT_GE(after.nr_deallocations - before.nr_deallocations, 2u);
+  EXPECT_GE(after.allocated_bytes - before.allocated_bytes,
+            100u * sizeof(int));
+}
+
+/* ************************************************************************* */
+TEST_F(AllocationTrackerFixture, reportsAllocationsAfterWarmup) {
+  FLAGS_allocation_warmup_spins = 2;
+  const std::string kModule = "testAllocationTracker module";
+  for (size_t spin = 0u; spin < 5u; ++spin) {
+    utils::AllocationScope scope(kModule);
+    // Spins 0 and 1 are the warmup, spin 3 allocates nothing.
+    if (spin != 3u) allocate(10u);
+  }
+  // 2 allocations (the vector and its values) in spins 2 and 4.
+  EXPECT_EQ(utils::AllocationTracker::getNumViolations(), 4u);
+  const std::vector<utils::AllocationViolation> violations =
+      utils::AllocationTracker::getViolations();
+  ASSERT_EQ(violations.size(), 4u);
+  EXPECT_EQ(violations.front().module, kModule);
+  EXPECT_EQ(violations.front().spin, 2u);
+  EXPECT_EQ(violations.back().spin, 4u);
+#if defined(__GLIBC__) || defined(__APPLE__)
+  EXPECT_FALSE(violations.front().callstack.empty());
+#endif
+  const std::string report = utils::AllocationTracker::print();
+  EXPECT_NE(report.find("in spin 4 of " + kModule), std::string::npos)
+      << report;
+
+  const std::string tag = kModule + " allocations [#]";
+  EXPECT_EQ(utils::Statistics::GetNumSamples(tag), 5u);
+  EXPECT_DOUBLE_EQ(utils::Statistics::GetMin(tag), 0.0);
+  EXPECT_DOUBLE_EQ(utils::Statistics::GetMax(tag), 2.0);
+}
+
+}  // namespace VIO
@@ -0,0 +1,109 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testAsyncFileWriter.cpp
+ * @brief  test AsyncFileWriter
+ * @author Antoni Rosinol
+ */
+
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/logging/AsyncFileWriter.h"
+
+namespace VIO {
+
+namespace {
+std::string readFile(const std::string& filename) {
+  std::ifstream file(filename);
+  std::stringstream ss;
+  ss << file.rdbuf();
+  return ss.str();
+}
+}  // namespace
+
+/* ************************************************************************** */
+TEST(testAsyncFileWriter, flushToFile) {
+  const std::string filename = "tmp_async_file_writer.txt";
+  AsyncFileWriter writer(filename);
+  EXPECT_TRUE(writer.is_open());
+  writer << "#timestamp,x" << std::endl;
+  writer << 123 << "," << 0.5 << '\n';
+  writer.flushToFile();
+  EXPECT_EQ(readFile(filename), "#timestamp,x\n123,0.5\n");
+
+  // Reopening truncates the file.
+  writer.open(filename);
+  writer << "456,1.5\n";
+  writer.close();
+  EXPECT_FALSE(writer.is_open());
+  EXPECT_EQ(readFile(filename), "456,1.5\n");
+}
+
+/* ************************************************************************** */
+TEST(testAsyncFileWriter, manyChunks) {
+  const std::string filename = "tmp_async_file_writer_chunks.txt";
+  // More chunks than fit in the queue.
+  const size_t kLineSize = 1024u;
+  const size_t kNrLines = 2u * AsyncFileWriter::kMaxChunksInFlight *
+                          AsyncFileWriter::kChunkSize / kLineSize;
+  std::string expected;
+  expected.reserve(kNrLines * kLineSize);
+  {
+    AsyncFileWriter writer(filename);
+    for (size_t i = 0u; i < kNrLines; ++i) {
+      const std::string line =
+          std::string(kLineSize - 1u, static_cast<char>('a' + i % 26u)) +
+          '\n';
+      writer << line;
+      expected += line;
+    }
+    // Written when destroyed.
+  }
+  EXPECT_EQ(readFile(filename), expected);
+}
+
+/* ************************************************************************** */
+TEST(testAsyncFileWriter, writersOfSeveralThreads) {
+  const size_t kNrThreads = 4u;
+  std::vector<std::string> filenames;
+  for (size_t t = 0u; t < kNrThreads; ++t) {
+    filenames.push_back("tmp_async_file_writer_" + std::to_string(t) + ".txt");
+  }
+  {
+    std::vector<AsyncFileWriter::UniquePtr> writers;
+    for (const std::string& filename : filenames) {
+      writers.emplace_back(std::make_unique<AsyncFileWriter>(filename));
+    }
+    std::vector<std::thread> threads;
+    for (size_t t = 0u; t < kNrThreads; ++t) {
+      threads.emplace_back([&writers, t]() {
+        for (size_t i = 0u; i < 100000u; ++i) *writers[t] << t << '\n';
+      });
+    }
+    for (std::thread& thread : threads) thread.join();
+    AsyncFileWriter::flushAll();
+    for (size_t t = 0u; t < kNrThreads; ++t) {
+      std::string expected;
+      for (size_t i = 0u; i < 100000u; ++i) {
+        expected += std::to_string(t) + '\n';
+      }
+      EXPECT_EQ(readFile(filenames[t]), expected);
+    }
+  }
+}
+
+}  // namespace VIO
@@ -0,0 +1,157 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testBinaryDataset.cpp
+ * @brief  test BinaryDataset and BinaryDataProvider
+ * @author Antoni Rosinol
+ */
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <opencv2/core/core.hpp>
+
+#include "kimera-vio/dataprovider/BinaryDataProvider.h"
+#include "kimera-vio/dataprovider/BinaryDataset.h"
+#include "kimera-vio/frontend/Frame.h"
+#include "kimera-vio/pipeline/Pipeline-definitions.h"
+
+DECLARE_string(test_data_path);
+
+namespace VIO {
+
+class BinaryDatasetFixture : public ::testing::Test {
+ public:
+  BinaryDatasetFixture()
+      : filename_(FLAGS_test_data_path + "/test_binary_dataset.kimera") {}
+
+ protected:
+  void SetUp() override {
+    // Odd width, so that rows are not a multiple of the alignment.
+    BinaryDatasetWriter writer(filename_, 2u);
+    for (size_t i = 0u; i < kNrImu; ++i) {
+      ImuAccGyr acc_gyr;
+      acc_gyr << 1.0, 2.0, 3.0, 4.0, 5.0, static_cast<double>(i);
+      writer.addImuMeasurement(ImuMeasurement(100 * i, acc_gyr));
+    }
+    VioNavState gt_state(
+        gtsam::Pose3(gtsam::Rot3::Ypr(0.1, 0.2, 0.3), gtsam::Point3(1, 2, 3)),
+        gtsam::Vector3(0.5, 0.6, 0.7),
+        gtsam::imuBias::ConstantBias(gtsam::Vector3(0.01, 0.02, 0.03),
+                                     gtsam::Vector3(0.04, 0.05, 0.06)));
+    writer.addGroundTruthState(42, gt_state);
+    for (size_t k = 0u; k < kNrFrames; ++k) {
+      writer.addFrame(10u + k,
+                      1000 * (k + 1),
+                      {cv::Mat(kRows, kCols, CV_8UC1, cv::Scalar(k)),
+                       cv::Mat(kRows, kCols, CV_8UC1, cv::Scalar(100 + k))});
+    }
+    writer.close();
+  }
+
+  void TearDown() override { std::remove(filename_.c_str()); }
+
+ protected:
+  static constexpr size_t kNrImu = 20u;
+  static constexpr size_t kNrFrames = 3u;
+  static constexpr int kRows = 30;
+  static constexpr int kCols = 37;
+  const std::string filename_;
+};
+
+TEST_F(BinaryDatasetFixture, RoundTrip) {
+  BinaryDatasetReader reader(filename_);
+  EXPECT_EQ(reader.getNrCameras(), 2u);
+  ASSERT_EQ(reader.getNrImuMeasurements(), kNrImu);
+  ASSERT_EQ(reader.getNrGroundTruthStates(), 1u);
+  ASSERT_EQ(reader.getNrFrames(), kNrFrames);
+
+  for (size_t i = 0u; i < kNrImu; ++i) {
+    const ImuMeasurement imu = reader.getImuMeasurement(i);
+    EXPECT_EQ(imu.timestamp_, static_cast<Timestamp>(100 * i));
+    EXPECT_DOUBLE_EQ(imu.acc_gyr_(0), 1.0);
+    EXPECT_DOUBLE_EQ(imu.acc_gyr_(5), static_cast<double>(i));
+  }
+
+  Timestamp timestamp;
+  VioNavState gt_state;
+  reader.getGroundTruthState(0u, &timestamp, &gt_state);
+  EXPECT_EQ(timestamp, 42);
+  EXPECT_TRUE(gt_state.pose_.equals(
+      gtsam::Pose3(gtsam::Rot3::Ypr(0.1, 0.2, 0.3), gtsam::Point3(1, 2, 3)),
+      1e-9));
+  EXPECT_TRUE(gtsam::assert_equal(gtsam::Vector3(0.5, 0.6, 0.7),
+                                  gt_state.velocity_));
+  EXPECT_TRUE(gtsam::assert_equal(gtsam::Vector3(0.04, 0.05, 0.06),
+                                  gt_state.imu_bias_.gyroscope()));
+
+  for (size_t k = 0u; k < kNrFrames; ++k) {
+    const BinaryFrameRecord& record = reader.getFrameRecord(k);
+    EXPECT_EQ(record.frame_id, 10u + k);
+    EXPECT_EQ(record.timestamp, static_cast<Timestamp>(1000 * (k + 1)));
+    for (size_t cam_idx = 0u; cam_idx < 2u; ++cam_idx) {
+      cv::Mat img = reader.getImage(k, cam_idx);
+      EXPECT_EQ(img.rows, kRows);
+      EXPECT_EQ(img.cols, kCols);
+      EXPECT_EQ(reinterpret_cast<uintptr_t>(img.data) %
+                    kBinaryDatasetAlignment,
+                0u);
+      EXPECT_EQ(cv::countNonZero(img != cv::Scalar(100 * cam_idx + k)), 0);
+    }
+  }
+}
+
+TEST_F(BinaryDatasetFixture, ImagesAreZeroCopyAndOutliveReader) {
+  cv::Mat img;
+  {
+    BinaryDatasetReader reader(filename_);
+    img = reader.getImage(1u, 0u);
+    // Same memory every time.
+    EXPECT_EQ(reader.getImage(1u, 0u).data, img.data);
+  }
+  // The mapping is still alive, and private.
+  EXPECT_EQ(cv::countNonZero(img != cv::Scalar(1)), 0);
+  img.setTo(cv::Scalar(255));
+  BinaryDatasetReader reader(filename_);
+  EXPECT_EQ(cv::countNonZero(reader.getImage(1u, 0u) != cv::Scalar(1)), 0);
+}
+
+TEST_F(BinaryDatasetFixture, DataProviderSendsAllData) {
+  VioParams vio_params(FLAGS_test_data_path + "/EurocParams");
+  vio_params.parallel_run_ = true;
+  vio_params.frontend_params_.stereo_matching_params_.equalize_image_ = false;
+  BinaryDataProvider data_provider(filename_, 1, 100, vio_params);
+  EXPECT_EQ(data_provider.gt_data_.map_to_gt_.size(), 1u);
+
+  size_t nr_imu = 0u;
+  std::vector<FrameId> left_ids;
+  std::vector<FrameId> right_ids;
+  data_provider.registerImuSingleCallback(
+      [&nr_imu](const ImuMeasurement&) { ++nr_imu; });
+  data_provider.registerLeftFrameCallback(
+      [&left_ids](Frame::UniquePtr frame) { left_ids.push_back(frame->id_); });
+  data_provider.registerRightFrameCallback(
+      [&right_ids](Frame::UniquePtr frame) {
+        right_ids.push_back(frame->id_);
+      });
+  EXPECT_FALSE(data_provider.spin());
+  EXPECT_FALSE(data_provider.hasData());
+
+  EXPECT_EQ(nr_imu, kNrImu);
+  // Starts at initial_k = 1, and is clipped to the nr of frames.
+  EXPECT_EQ(left_ids, std::vector<FrameId>({11u, 12u}));
+  EXPECT_EQ(right_ids, left_ids);
+}
+
+}  // namespace VIO
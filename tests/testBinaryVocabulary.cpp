@@ -0,0 +1,108 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testBinaryVocabulary.cpp
+ * @brief  test BinaryVocabulary
+ * @author Antoni Rosinol
+ */
+
+#include <DBoW2/DBoW2.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "kimera-vio/loopclosure/BinaryVocabulary.h"
+
+DECLARE_string(test_data_path);
+
+namespace VIO {
+
+class BinaryVocabularyFixture : public ::testing::Test {
+ public:
+  BinaryVocabularyFixture()
+      : vocabulary_filename_(FLAGS_test_data_path +
+                             "/ForLoopClosureDetector/small_voc.yml.gz"),
+        filename_(FLAGS_test_data_path + "/test_binary_vocabulary.bin"),
+        descriptors_() {
+    cv::RNG rng(42);
+    for (size_t i = 0u; i < 200u; ++i) {
+      cv::Mat descriptor(1, DBoW2::FORB::L, CV_8U);
+      rng.fill(descriptor, cv::RNG::UNIFORM, 0, 256);
+      descriptors_.push_back(descriptor);
+    }
+  }
+
+ protected:
+  void SetUp() override {
+    convertVocabularyToBinary(vocabulary_filename_, filename_);
+  }
+
+  void TearDown() override { std::remove(filename_.c_str()); }
+
+ protected:
+  const std::string vocabulary_filename_;
+  const std::string filename_;
+  std::vector<cv::Mat> descriptors_;
+};
+
+TEST_F(BinaryVocabularyFixture, DetectsFormat) {
+  EXPECT_TRUE(isBinaryVocabulary(filename_));
+  EXPECT_FALSE(isBinaryVocabulary(vocabulary_filename_));
+  EXPECT_FALSE(isBinaryVocabulary(filename_ + ".missing"));
+}
+
+TEST_F(BinaryVocabularyFixture, SameVocabularyAsText) {
+  OrbVocabulary text_vocab;
+  text_vocab.load(vocabulary_filename_);
+  std::unique_ptr<OrbVocabulary> binary_vocab = loadBinaryVocabulary(filename_);
+  ASSERT_TRUE(binary_vocab);
+
+  EXPECT_EQ(binary_vocab->size(), text_vocab.size());
+  EXPECT_EQ(binary_vocab->getBranchingFactor(),
+            text_vocab.getBranchingFactor());
+  EXPECT_EQ(binary_vocab->getDepthLevels(), text_vocab.getDepthLevels());
+  EXPECT_EQ(binary_vocab->getWeightingType(), text_vocab.getWeightingType());
+  EXPECT_EQ(binary_vocab->getScoringType(), text_vocab.getScoringType());
+  for (DBoW2::WordId word_id = 0u; word_id < text_vocab.size(); ++word_id) {
+    EXPECT_DOUBLE_EQ(binary_vocab->getWordWeight(word_id),
+                     text_vocab.getWordWeight(word_id));
+  }
+
+  // Same bag of words (hence same tree and descriptors).
+  DBoW2::BowVector text_bow, binary_bow;
+  DBoW2::FeatureVector text_features, binary_features;
+  text_vocab.transform(descriptors_, text_bow, text_features, 2);
+  binary_vocab->transform(descriptors_, binary_bow, binary_features, 2);
+  EXPECT_EQ(binary_bow, text_bow);
+  EXPECT_EQ(binary_features, text_features);
+}
+
+TEST_F(BinaryVocabularyFixture, CopiesOutliveFile) {
+  std::unique_ptr<OrbVocabulary> binary_vocab = loadBinaryVocabulary(filename_);
+  DBoW2::BowVector expected_bow;
+  binary_vocab->transform(descriptors_, expected_bow);
+
+  // As the LoopClosureDetector does: the database copies the vocabulary.
+  OrbDatabase db(*binary_vocab);
+  binary_vocab.reset();
+  std::remove(filename_.c_str());
+
+  DBoW2::BowVector bow;
+  db.getVocabulary()->transform(descriptors_, bow);
+  EXPECT_EQ(bow, expected_bow);
+}
+
+}  // namespace VIO
@@ -0,0 +1,189 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testBowDatabase.cpp
+ * @brief  test BowDatabase against DBoW2's database
+ * @author Antoni Rosinol
+ */
+
+#include <DBoW2/DBoW2.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "kimera-vio/loopclosure/BowDatabase.h"
+
+DECLARE_string(test_data_path);
+
+namespace VIO {
+
+class BowDatabaseFixture : public ::testing::Test {
+ public:
+  BowDatabaseFixture() : vocab_(), bow_vecs_() {
+    vocab_.load(FLAGS_test_data_path +
+                "/ForLoopClosureDetector/small_voc.yml.gz");
+    // Images sharing part of their descriptors with the previous ones.
+    cv::RNG rng(7);
+    std::vector<cv::Mat> descriptors;
+    for (size_t i = 0u; i < kNrEntries; ++i) {
+      for (size_t j = 0u; j < 20u; ++j) {
+        cv::Mat descriptor(1, DBoW2::FORB::L, CV_8U);
+        rng.fill(descriptor, cv::RNG::UNIFORM, 0, 256);
+        descriptors.push_back(descriptor);
+      }
+      if (descriptors.size() > 60u) {
+        descriptors.erase(descriptors.begin(), descriptors.begin() + 20);
+      }
+      DBoW2::BowVector bow_vec;
+      vocab_.transform(descriptors, bow_vec);
+      bow_vecs_.push_back(bow_vec);
+    }
+  }
+
+ protected:
+  void expectSameResults(const DBoW2::QueryResults& expected,
+                         const DBoW2::QueryResults& actual) {
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0u; i < expected.size(); ++i) {
+      EXPECT_NEAR(actual[i].Score, expected[i].Score, 1e-9);
+      // DBoW2 does not sort ties consistently.
+      const bool tie_with_next = i + 1u < expected.size() &&
+                                 expected[i].Score == expected[i + 1u].Score;
+      const bool tie_with_previous =
+          i > 0u && expected[i - 1u].Score == expected[i].Score;
+      if (!tie_with_next && !tie_with_previous) {
+        EXPECT_EQ(actual[i].Id, expected[i].Id);
+      }
+    }
+  }
+
+  void testSameAsDBoW2(const BowDatabaseParams& params) {
+    OrbDatabase dbow2_db(vocab_, false);
+    BowDatabase db(vocab_, params);
+    for (size_t i = 0u; i < kNrEntries; ++i) {
+      // Same queries as the LoopClosureDetector: query, then add.
+      const int max_id = static_cast<int>(i) - 5;
+      for (const int& max_results : {10, 0}) {
+        DBoW2::QueryResults expected, actual;
+        dbow2_db.query(bow_vecs_[i], expected, max_results, max_id);
+        db.query(bow_vecs_[i], actual, max_results, max_id);
+        expectSameResults(expected, actual);
+      }
+      EXPECT_EQ(db.add(bow_vecs_[i]), dbow2_db.add(bow_vecs_[i]));
+    }
+    EXPECT_EQ(db.size(), dbow2_db.size());
+
+    // Unbounded ids.
+    DBoW2::QueryResults expected, actual;
+    dbow2_db.query(bow_vecs_[0], expected, 0, -1);
+    db.query(bow_vecs_[0], actual, 0, -1);
+    expectSameResults(expected, actual);
+    ASSERT_FALSE(actual.empty());
+    EXPECT_EQ(actual[0].Id, 0u);
+  }
+
+ protected:
+  static constexpr size_t kNrEntries = 60u;
+  OrbVocabulary vocab_;
+  std::vector<DBoW2::BowVector> bow_vecs_;
+};
+
+TEST_F(BowDatabaseFixture, SameResultsAsDBoW2) {
+  testSameAsDBoW2(BowDatabaseParams());
+}
+
+TEST_F(BowDatabaseFixture, ParallelSameResultsAsDBoW2) {
+  BowDatabaseParams params;
+  params.num_threads = 4;
+  params.min_parallel_entries = 1;
+  testSameAsDBoW2(params);
+}
+
+TEST_F(BowDatabaseFixture, CopyAndSetVocabulary) {
+  BowDatabase db(vocab_);
+  for (const DBoW2::BowVector& bow_vec : bow_vecs_) db.add(bow_vec);
+  BowDatabase copy(db);
+  EXPECT_EQ(copy.size(), db.size());
+  EXPECT_NE(copy.getVocabulary(), db.getVocabulary());
+  DBoW2::QueryResults expected, actual;
+  db.query(bow_vecs_[3], expected, 5);
+  copy.query(bow_vecs_[3], actual, 5);
+  expectSameResults(expected, actual);
+
+  copy.setVocabulary(vocab_);
+  EXPECT_EQ(copy.size(), 0u);
+  copy.query(bow_vecs_[3], actual, 5);
+  EXPECT_TRUE(actual.empty());
+}
+
+TEST_F(BowDatabaseFixture, QueryCandidatesSameAsQuery) {
+  BowDatabase db(vocab_);
+  for (const DBoW2::BowVector& bow_vec : bow_vecs_) db.add(bow_vec);
+  std::vector<BowDatabase::EntryId> all_ids, even_ids;
+  for (unsigned int i = 0u; i < kNrEntries; ++i) {
+    all_ids.push_back(i);
+    if (i % 2u == 0u) even_ids.push_back(i);
+  }
+
+  for (const unsigned int& query_idx : {3u, 30u, 59u}) {
+    DBoW2::QueryResults expected, actual;
+    db.query(bow_vecs_[query_idx], expected, 0);
+    db.queryCandidates(bow_vecs_[query_idx], actual, all_ids, 0);
+    expectSameResults(expected, actual);
+
+    // Same as filtering the results of query.
+    db.queryCandidates(bow_vecs_[query_idx], actual, even_ids, 5);
+    DBoW2::QueryResults filtered;
+    for (const DBoW2::Result& result : expected) {
+      if (result.Id % 2u == 0u && filtered.size() < 5u) {
+        filtered.push_back(result);
+      }
+    }
+    expectSameResults(filtered, actual);
+  }
+
+  DBoW2::QueryResults actual;
+  db.queryCandidates(bow_vecs_[0], actual, {}, 0);
+  EXPECT_TRUE(actual.empty());
+}
+
+TEST_F(BowDatabaseFixture, StopWordsAreNotScored) {
+  BowDatabaseParams params;
+  params.stop_word_fraction = 0.5;
+  params.stop_word_min_entries = 1;
+  BowDatabase db(vocab_, params);
+  // Word 0 is in all entries, word i + 1 only in entry i.
+  for (unsigned int i = 0u; i < 4u; ++i) {
+    DBoW2::BowVector bow_vec;
+    bow_vec.addWeight(0u, 0.5);
+    bow_vec.addWeight(i + 1u, 0.5);
+    db.add(bow_vec);
+  }
+
+  DBoW2::QueryResults results;
+  DBoW2::BowVector stop_word_query;
+  stop_word_query.addWeight(0u, 1.0);
+  db.query(stop_word_query, results, 0);
+  EXPECT_TRUE(results.empty());
+
+  DBoW2::BowVector query;
+  query.addWeight(0u, 0.5);
+  query.addWeight(3u, 0.5);
+  db.query(query, results, 0);
+  ASSERT_EQ(results.size(), 1u);
+  EXPECT_EQ(results[0].Id, 2u);
+  EXPECT_NEAR(results[0].Score, 0.5, 1e-9);
+}
+
+}  // namespace VIO
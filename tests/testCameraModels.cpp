@@ -0,0 +1,195 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testCameraModels.cpp
+ * @brief  Unit tests the compile-time specialized camera models.
+ * @author Antoni Rosinol
+ */
+
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core.hpp>
+
+#include "kimera-vio/frontend/CameraModels.h"
+
+namespace VIO {
+
+namespace {
+
+// Euroc-like intrinsics.
+constexpr double kFx = 458.654;
+constexpr double kFy = 457.296;
+constexpr double kCx = 367.215;
+constexpr double kCy = 248.375;
+
+std::vector<Eigen::Vector3d> makePoints() {
+  std::vector<Eigen::Vector3d> points;
+  for (double x = -1.0; x <= 1.0; x += 0.5) {
+    for (double y = -0.5; y <= 0.5; y += 0.25) {
+      points.push_back(Eigen::Vector3d(x, y, 2.0));
+    }
+  }
+  return points;
+}
+
+template <typename Model>
+void checkRoundTrip(const Model& model) {
+  for (const Eigen::Vector3d& point : makePoints()) {
+    const Eigen::Vector2d pixel = model.project(point);
+    const Eigen::Vector3d ray = model.unproject(pixel);
+    EXPECT_NEAR(ray.z(), 1.0, 1e-12);
+    EXPECT_LT((ray * point.z() - point).norm(), 1e-8)
+        << "Point: " << point.transpose();
+    EXPECT_NEAR(model.bearing(pixel).norm(), 1.0, 1e-12);
+  }
+}
+
+//! Compares the Jacobians with central differences.
+template <typename Model>
+void checkJacobians(const Model& model) {
+  static constexpr double kDelta = 1e-6;
+  for (const Eigen::Vector3d& point : makePoints()) {
+    Eigen::Matrix<double, 2, 3> J_project;
+    const Eigen::Vector2d pixel = model.project(point, &J_project);
+    for (int i = 0; i < 3; ++i) {
+      const Eigen::Vector3d delta = kDelta * Eigen::Vector3d::Unit(i);
+      const Eigen::Vector2d numerical =
+          (model.project(point + delta) - model.project(point - delta)) /
+          (2.0 * kDelta);
+      EXPECT_LT((J_project.col(i) - numerical).norm(), 1e-4)
+          << "Point: " << point.transpose() << ", column " << i;
+    }
+
+    Eigen::Matrix<double, 3, 2> J_unproject;
+    model.unproject(pixel, &J_unproject);
+    for (int i = 0; i < 2; ++i) {
+      const Eigen::Vector2d delta = kDelta * Eigen::Vector2d::Unit(i);
+      const Eigen::Vector3d numerical =
+          (model.unproject(pixel + delta) - model.unproject(pixel - delta)) /
+          (2.0 * kDelta);
+      EXPECT_LT((J_unproject.col(i) - numerical).norm(), 1e-6)
+          << "Pixel: " << pixel.transpose() << ", column " << i;
+    }
+  }
+}
+
+cv::Mat makeK() {
+  return (cv::Mat_<double>(3, 3) << kFx, 0.0, kCx, 0.0, kFy, kCy, 0.0, 0.0,
+          1.0);
+}
+
+}  // namespace
+
+TEST(testCameraModels, PinholeNoDistortion) {
+  const PinholeCameraModel<NoDistortion> model(kFx, kFy, kCx, kCy);
+  const Eigen::Vector2d pixel = model.project(Eigen::Vector3d(0.2, -0.4, 2.0));
+  EXPECT_NEAR(pixel.x(), kFx * 0.1 + kCx, 1e-12);
+  EXPECT_NEAR(pixel.y(), -kFy * 0.2 + kCy, 1e-12);
+  checkRoundTrip(model);
+  checkJacobians(model);
+}
+
+TEST(testCameraModels, PinholeRadTan) {
+  const PinholeCameraModel<RadTanDistortion> model(
+      kFx,
+      kFy,
+      kCx,
+      kCy,
+      RadTanDistortion(-0.28340811, 0.07395907, 0.00019359, 1.76187114e-05));
+  checkRoundTrip(model);
+  checkJacobians(model);
+}
+
+TEST(testCameraModels, PinholeEquidistant) {
+  const PinholeCameraModel<EquidistantDistortion> model(
+      kFx,
+      kFy,
+      kCx,
+      kCy,
+      EquidistantDistortion(-0.0137, 0.0212, -0.0187, 0.0056));
+  checkRoundTrip(model);
+  checkJacobians(model);
+}
+
+TEST(testCameraModels, Omni) {
+  OmniCameraModel::Polynomial polynomial;
+  polynomial << -179.4711, 0.0, 0.002321, -3.920e-06, 1.838e-08;
+  Eigen::Matrix2d affine;
+  affine << 1.0, 0.0005, -0.0003, 1.0;
+  const OmniCameraModel model(
+      polynomial, Eigen::Vector2d(320.5, 240.25), affine);
+  // A point in front of a camera looking along -z, as per a0 < 0.
+  for (const Eigen::Vector3d& point : makePoints()) {
+    const Eigen::Vector3d flipped(point.x(), point.y(), -point.z());
+    const Eigen::Vector2d pixel = model.project(flipped);
+    const Eigen::Vector3d ray = model.unproject(pixel);
+    EXPECT_LT((ray * flipped.z() - flipped).norm(), 1e-8)
+        << "Point: " << flipped.transpose();
+  }
+  checkJacobians(model);
+}
+
+TEST(testCameraModels, RadTanUndistortMatchesOpenCv) {
+  const std::vector<double> coeffs = {
+      -0.28340811, 0.07395907, 0.00019359, 1.76187114e-05};
+  const PinholeCameraModel<RadTanDistortion> model(
+      kFx,
+      kFy,
+      kCx,
+      kCy,
+      RadTanDistortion(coeffs[0], coeffs[1], coeffs[2], coeffs[3]));
+  std::vector<cv::Point2d> pixels;
+  for (const Eigen::Vector3d& point : makePoints()) {
+    const Eigen::Vector2d pixel = model.project(point * 0.5);
+    pixels.push_back(cv::Point2d(pixel.x(), pixel.y()));
+  }
+  std::vector<cv::Point2d> undistorted;
+  cv::undistortPoints(pixels,
+                      undistorted,
+                      makeK(),
+                      coeffs,
+                      cv::noArray(),
+                      cv::noArray(),
+                      cv::TermCriteria(cv::TermCriteria::COUNT, 100, 0.0));
+  for (size_t i = 0u; i < pixels.size(); ++i) {
+    const Eigen::Vector3d ray =
+        model.unproject(Eigen::Vector2d(pixels[i].x, pixels[i].y));
+    EXPECT_NEAR(ray.x(), undistorted[i].x, 1e-6);
+    EXPECT_NEAR(ray.y(), undistorted[i].y, 1e-6);
+  }
+}
+
+TEST(testCameraModels, EquidistantUndistortMatchesOpenCv) {
+  const std::vector<double> coeffs = {-0.0137, 0.0212, -0.0187, 0.0056};
+  const PinholeCameraModel<EquidistantDistortion> model(
+      kFx,
+      kFy,
+      kCx,
+      kCy,
+      EquidistantDistortion(coeffs[0], coeffs[1], coeffs[2], coeffs[3]));
+  std::vector<cv::Point2d> pixels;
+  for (const Eigen::Vector3d& point : makePoints()) {
+    const Eigen::Vector2d pixel = model.project(point);
+    pixels.push_back(cv::Point2d(pixel.x(), pixel.y()));
+  }
+  std::vector<cv::Point2d> undistorted;
+  cv::fisheye::undistortPoints(pixels, undistorted, makeK(), coeffs);
+  for (size_t i = 0u; i < pixels.size(); ++i) {
+    const Eigen::Vector3d ray =
+        model.unproject(Eigen::Vector2d(pixels[i].x, pixels[i].y));
+    EXPECT_NEAR(ray.x(), undistorted[i].x, 1e-6);
+    EXPECT_NEAR(ray.y(), undistorted[i].y, 1e-6);
+  }
+}
+
+}  // namespace VIO
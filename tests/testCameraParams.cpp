@@ -143,4 +143,64 @@ TEST(testCameraParams, equals) {
   EXPECT_TRUE(camParams.equals(camParams2, 1e-7));
 }
 
+TEST(testCameraParams, downscale) {
+  CameraParams cam_params;
+  cam_params.parseYAML(FLAGS_test_data_path + "/sensor.yaml");
+  CameraParams half_params = cam_params;
+  half_params.downscale(2);
+  EXPECT_EQ(half_params.downscale_factor_, 2);
+  EXPECT_EQ(half_params.image_size_.width, cam_params.image_size_.width / 2);
+  EXPECT_EQ(half_params.image_size_.height, cam_params.image_size_.height / 2);
+  EXPECT_DOUBLE_EQ(half_params.intrinsics_[0], cam_params.intrinsics_[0] / 2);
+  EXPECT_DOUBLE_EQ(half_params.intrinsics_[1], cam_params.intrinsics_[1] / 2);
+  EXPECT_DOUBLE_EQ(half_params.K_.at<double>(0, 0),
+                   half_params.intrinsics_[0]);
+  EXPECT_FALSE(half_params.equals(cam_params));
+
+  // The principal point maps back to the original one.
+  const KeypointCV pp(half_params.intrinsics_[2], half_params.intrinsics_[3]);
+  const KeypointCV original_pp = half_params.toOriginalPixels(pp);
+  EXPECT_NEAR(original_pp.x, cam_params.intrinsics_[2], 1e-3);
+  EXPECT_NEAR(original_pp.y, cam_params.intrinsics_[3], 1e-3);
+
+  // No-op for a factor of 1.
+  CameraParams same_params = cam_params;
+  same_params.downscale(1);
+  EXPECT_TRUE(same_params.equals(cam_params));
+}
+
+TEST(testCameraParams, roiMask) {
+  CameraParams cam_params;
+  cam_params.parseYAML(FLAGS_test_data_path + "/sensor.yaml");
+  EXPECT_FALSE(cam_params.hasRoiMask());
+  EXPECT_TRUE(cam_params.isInRoi(KeypointCV(10.0f, 10.0f)));
+  EXPECT_FALSE(cam_params.isInRoi(KeypointCV(-1.0f, 10.0f)));
+
+  // Sky in the top 100 rows, robot body in the bottom right corner.
+  cv::Mat roi_mask(cam_params.image_size_, CV_8UC1, cv::Scalar(255));
+  roi_mask.rowRange(0, 100).setTo(0);
+  roi_mask(cv::Rect(600, 400, 152, 80)).setTo(0);
+  CameraParams roi_params = cam_params;
+  roi_params.setRoiMask(roi_mask);
+  ASSERT_TRUE(roi_params.hasRoiMask());
+  EXPECT_EQ(roi_params.roi_bbox_, cv::Rect(0, 100, 752, 380));
+  EXPECT_FALSE(roi_params.isInRoi(KeypointCV(300.0f, 50.0f)));
+  EXPECT_FALSE(roi_params.isInRoi(KeypointCV(700.0f, 450.0f)));
+  EXPECT_TRUE(roi_params.isInRoi(KeypointCV(300.0f, 450.0f)));
+  EXPECT_FALSE(roi_params.isInRoi(KeypointCV(300.0f, 1000.0f)));
+  EXPECT_FALSE(roi_params.equals(cam_params));
+  EXPECT_TRUE(roi_params.equals(roi_params));
+
+  // Downscaled with the image.
+  roi_params.downscale(2);
+  EXPECT_EQ(roi_params.roi_mask_.size(), roi_params.image_size_);
+  EXPECT_EQ(roi_params.roi_bbox_, cv::Rect(0, 50, 376, 190));
+  EXPECT_FALSE(roi_params.isInRoi(KeypointCV(350.0f, 225.0f)));
+  EXPECT_TRUE(roi_params.isInRoi(KeypointCV(150.0f, 225.0f)));
+
+  roi_params.setRoiMask(cv::Mat());
+  EXPECT_FALSE(roi_params.hasRoiMask());
+  EXPECT_TRUE(roi_params.roi_bbox_.empty());
+}
+
 }  // namespace VIO
@@ -41,6 +41,17 @@ std::vector<double> crossCorrelation(const RingBuffer<T>& seq_a,
       seq_a, seq_b, [](const T& value) { return static_cast<double>(value); });
 }
 
+template <typename T>
+std::vector<double> crossCorrelationFft(const RingBuffer<T>& seq_a,
+                                        const RingBuffer<T>& seq_b,
+                                        bool mean_removal = false) {
+  return utils::crossCorrelationFft(
+      seq_a,
+      seq_b,
+      [](const T& value) { return static_cast<double>(value); },
+      mean_removal);
+}
+
 TEST(testCrossCorrelation, ringBufferSimpleTest) {
   RingBuffer<int> buffer(5);
   buffer.push(1);
@@ -120,6 +131,26 @@ TEST(testCrossCorrelation, bufferFrontAndBack) {
   }
 }
 
+TEST(testCrossCorrelation, ringBufferFixedCapacity) {
+  // Stored in 8 slots: the values wrap around the end of the storage.
+  RingBuffer<int, 5> buffer;
+  EXPECT_EQ(buffer.capacity(), 5u);
+  for (int i = 0; i < 12; ++i) {
+    buffer.push(i);
+  }
+  EXPECT_TRUE(buffer.full());
+  EXPECT_EQ(buffer.front(), 7);
+  EXPECT_EQ(buffer.back(), 11);
+
+  std::vector<int> values;
+  for (const auto& range : buffer.ranges()) {
+    values.insert(values.end(), range.data, range.data + range.size);
+  }
+  EXPECT_EQ(values, std::vector<int>({7, 8, 9, 10, 11}));
+  EXPECT_EQ(values, std::vector<int>(buffer.begin(), buffer.end()));
+  EXPECT_EQ(buffer.ranges()[1].size, 4u);
+}
+
 TEST(testCrossCorrelation, meanCorrect) {
   RingBuffer<double> buffer(5);
   EXPECT_EQ(0.0, mean(buffer));
@@ -210,4 +241,53 @@ TEST(testCrossCorrelation, crossCorrelationNpyExample) {
   }
 }
 
+TEST(testCrossCorrelation, crossCorrelationFftNpyExample) {
+  RingBuffer<double> seq_a(3);
+  seq_a.push(1);
+  seq_a.push(2);
+  seq_a.push(3);
+
+  RingBuffer<double> seq_b(3);
+  seq_b.push(0);
+  seq_b.push(1);
+  seq_b.push(0.5);
+
+  std::vector<double> correlation = crossCorrelationFft(seq_a, seq_b);
+  std::vector<double> expected{0.5, 2.0, 3.5, 3.0, 0.0};
+  ASSERT_EQ(expected.size(), correlation.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_NEAR(expected[i], correlation[i], 1.0e-12);
+  }
+}
+
+TEST(testCrossCorrelation, crossCorrelationFftMatchesDirect) {
+  // sizes that are not powers of 2, different between the sequences, and
+  // buffers that wrapped around
+  for (const auto& sizes : std::vector<std::pair<size_t, size_t>>{
+           {1, 7}, {7, 1}, {64, 64}, {300, 300}, {257, 100}, {100, 513}}) {
+    RingBuffer<double> seq_a(sizes.first);
+    RingBuffer<double> seq_b(sizes.second);
+    for (size_t i = 0; i < 2 * sizes.first; ++i) {
+      seq_a.push(std::sin(0.1 * i) + 0.01 * (i % 7));
+    }
+    for (size_t i = 0; i < 2 * sizes.second + 3; ++i) {
+      seq_b.push(std::cos(0.05 * i) + 1.0);
+    }
+
+    for (const bool mean_removal : {false, true}) {
+      std::vector<double> expected = utils::crossCorrelation(
+          seq_a,
+          seq_b,
+          [](const double& value) { return value; },
+          mean_removal);
+      std::vector<double> correlation =
+          crossCorrelationFft(seq_a, seq_b, mean_removal);
+      ASSERT_EQ(expected.size(), correlation.size());
+      for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_NEAR(expected[i], correlation[i], 1.0e-9);
+      }
+    }
+  }
+}
+
 }  // namespace VIO
@@ -13,6 +13,11 @@
 
 #include <gtest/gtest.h>
 
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
 #include "kimera-vio/frontend/CameraParams.h"
 #include "kimera-vio/frontend/DepthFrame.h"
 
@@ -172,6 +177,127 @@ TEST_P(TestDepthFrameParam, GetDepthAtPoint) {
   }
 }
 
+TEST_P(TestDepthFrameParam, GetDepthsAtPointsMatchesGetDepthAtPoint) {
+  const DepthFrame frame(5, 10, (GetParam())());
+
+  CameraParams params;
+  params.depth.depth_to_meters_ = 1.0;
+  params.depth.min_depth_ = 0.1;
+
+  const KeypointsCV points = {KeypointCV(0, 0),
+                              KeypointCV(1, 0),
+                              KeypointCV(1, 1),
+                              KeypointCV(-1, 0),
+                              KeypointCV(2, 0)};
+  std::vector<float> depths;
+  frame.getDepthsAtPoints(params, points, &depths);
+  ASSERT_EQ(depths.size(), points.size());
+  for (size_t i = 0u; i < points.size(); ++i) {
+    const float expected = frame.getDepthAtPoint(params, points[i]);
+    if (std::isnan(expected)) {
+      EXPECT_TRUE(std::isnan(depths[i]));
+    } else {
+      EXPECT_NEAR(depths[i], expected, 1.0e-9f);
+    }
+  }
+}
+
+TEST_F(TestDepthFrame, DepthPyramidMedianOfValidDepths) {
+  cv::Mat depth_img(4, 4, CV_32FC1, cv::Scalar(2.0f));
+  // Top-left block: a hole and an outlier, the median keeps the surface.
+  depth_img.at<float>(0, 0) = 0.0f;
+  depth_img.at<float>(0, 1) = 8.0f;
+  // Top-right block: no valid depth.
+  depth_img(cv::Rect(2, 0, 2, 2)).setTo(0.0f);
+  // Bottom-right block: a farther surface (depth edge with the others).
+  depth_img(cv::Rect(2, 2, 2, 2)).setTo(6.0f);
+  const DepthFrame frame(5, 10, depth_img);
+
+  CameraParams params;
+  params.depth.depth_to_meters_ = 1.0;
+  params.depth.min_depth_ = 0.1;
+
+  const std::vector<cv::Mat>& pyramid = frame.getDepthPyramid(params, 1);
+  ASSERT_EQ(pyramid.size(), 2u);
+  ASSERT_EQ(pyramid[1].size(), cv::Size(2, 2));
+  EXPECT_NEAR(pyramid[1].at<float>(0, 0), 2.0f, 1.0e-6f);
+  EXPECT_TRUE(std::isnan(pyramid[1].at<float>(0, 1)));
+  EXPECT_NEAR(pyramid[1].at<float>(1, 0), 2.0f, 1.0e-6f);
+  EXPECT_NEAR(pyramid[1].at<float>(1, 1), 6.0f, 1.0e-6f);
+
+  // Lookups at level 1, with full resolution coordinates.
+  params.depth.pyramid_level_ = 1;
+  const KeypointsCV points = {
+      KeypointCV(0.5f, 0.5f), KeypointCV(3.0f, 0.0f), KeypointCV(3.0f, 3.0f)};
+  std::vector<float> depths;
+  frame.getDepthsAtPoints(params, points, &depths);
+  ASSERT_EQ(depths.size(), 3u);
+  EXPECT_NEAR(depths[0], 2.0f, 1.0e-6f);
+  EXPECT_TRUE(std::isnan(depths[1]));
+  EXPECT_NEAR(depths[2], 6.0f, 1.0e-6f);
+
+  // With the neighbourhood check, depths next to the edge are rejected.
+  params.depth.max_depth_discontinuity_ = 1.0f;
+  frame.getDepthsAtPoints(params, points, &depths);
+  EXPECT_TRUE(std::isnan(depths[0]));
+  EXPECT_TRUE(std::isnan(depths[2]));
+}
+
+TEST_F(TestDepthFrame, EncodeDecodeUINT16IsLossless) {
+  cv::Mat depth_img;
+  loadDepthImage("depth_img_0.tiff").convertTo(depth_img, CV_16UC1);
+  ASSERT_FALSE(depth_img.empty());
+  const DepthFrame frame(5, 10, depth_img);
+
+  std::vector<std::uint8_t> bytes;
+  frame.encode(&bytes);
+  frame.encode(&bytes);
+  EXPECT_LT(bytes.size(), 2u * depth_img.total() * sizeof(std::uint16_t));
+
+  // Two frames back to back.
+  size_t offset = 0u;
+  for (size_t i = 0u; i < 2u; ++i) {
+    DepthFrame::UniquePtr decoded = DepthFrame::decode(bytes, &offset);
+    ASSERT_TRUE(decoded);
+    EXPECT_EQ(decoded->id_, 5u);
+    EXPECT_EQ(decoded->timestamp_, 10);
+    ASSERT_EQ(decoded->depth_img_.type(), CV_16UC1);
+    ASSERT_EQ(decoded->depth_img_.size(), depth_img.size());
+    EXPECT_EQ(cv::countNonZero(decoded->depth_img_ != depth_img), 0);
+  }
+  EXPECT_EQ(offset, bytes.size());
+
+  // Truncated frames are rejected.
+  bytes.resize(bytes.size() - 1u);
+  offset = bytes.size() / 2u;
+  EXPECT_FALSE(DepthFrame::decode(bytes, &offset));
+  EXPECT_EQ(offset, bytes.size() / 2u);
+}
+
+TEST_F(TestDepthFrame, EncodeDecodeFloatHasBoundedError) {
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  cv::Mat depth_img = (cv::Mat_<float>(2, 4) << 0.0f, 1.2344f, 1.2346f, nan,
+                       -1.0f, 3.0f, 100.0f, 0.0001f);
+  const DepthFrame frame(5, 10, depth_img);
+  std::vector<std::uint8_t> bytes;
+  frame.encode(&bytes, 1e-3f);
+  size_t offset = 0u;
+  DepthFrame::UniquePtr decoded = DepthFrame::decode(bytes, &offset);
+  ASSERT_TRUE(decoded);
+  ASSERT_EQ(decoded->depth_img_.type(), CV_32FC1);
+  const cv::Mat& img = decoded->depth_img_;
+  // Invalid depths decode as 0.
+  EXPECT_EQ(img.at<float>(0, 0), 0.0f);
+  EXPECT_EQ(img.at<float>(0, 3), 0.0f);
+  EXPECT_EQ(img.at<float>(1, 0), 0.0f);
+  EXPECT_NEAR(img.at<float>(0, 1), 1.234f, 1.0e-6f);
+  EXPECT_NEAR(img.at<float>(0, 2), 1.235f, 1.0e-6f);
+  EXPECT_NEAR(img.at<float>(1, 1), 3.0f, 1.0e-6f);
+  // Clamped to the range of the quantized depths, valid ones stay valid.
+  EXPECT_NEAR(img.at<float>(1, 2), 65.535f, 1.0e-4f);
+  EXPECT_NEAR(img.at<float>(1, 3), 0.001f, 1.0e-6f);
+}
+
 INSTANTIATE_TEST_SUITE_P(GetDepthParameterized,
                          TestDepthFrameParam,
                          testing::Values(makeTestDepthFloat,
@@ -0,0 +1,72 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testEmbeddedStereoImuPipeline.cpp
+ * @brief  test EmbeddedStereoImuPipeline
+ * @author Antoni Rosinol
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/pipeline/EmbeddedStereoImuPipeline.h"
+#include "kimera-vio/test/StaticStereoImuSequence.h"
+
+DECLARE_string(test_data_path);
+
+namespace VIO {
+
+TEST(EmbeddedStereoImuPipeline, backendOutputsAtRest) {
+  VioParams vio_params(FLAGS_test_data_path + "/EurocParams");
+  // A few keyframes at rest, where the disparity does not trigger them.
+  vio_params.frontend_params_.max_intra_keyframe_time_ns_ = 0.5 * 1e9;
+  test::StaticStereoImuSequence sequence(FLAGS_test_data_path, &vio_params);
+  EmbeddedStereoImuPipeline pipeline(vio_params);
+
+  size_t nr_keyframes = 0u;
+  EmbeddedVioState state;
+  for (size_t k = 0u; k < sequence.size(); ++k) {
+    ImuStampS imu_stamps;
+    ImuAccGyrS imu_accgyrs;
+    sequence.getImu(k, &imu_stamps, &imu_accgyrs);
+    ASSERT_TRUE(pipeline.step(imu_stamps,
+                              imu_accgyrs,
+                              *sequence.makeLeftFrame(k),
+                              *sequence.makeRightFrame(k),
+                              &state))
+        << "Backend failed at frame " << k;
+    // The first frame initializes the Backend.
+    if (k == 0u) EXPECT_TRUE(state.is_keyframe);
+    EXPECT_TRUE(state.valid) << "No estimate at frame " << k;
+    EXPECT_GT(state.frontend_us, 0);
+    EXPECT_GE(state.step_us, state.frontend_us);
+    if (!state.valid) continue;
+    EXPECT_EQ(sequence.getTimestamp(k), state.W_State_B.timestamp_);
+    if (state.is_keyframe) {
+      ++nr_keyframes;
+      EXPECT_GT(state.backend_us, 0);
+    } else {
+      EXPECT_EQ(0, state.backend_us);
+    }
+    // At rest, both the Backend estimates and the IMU predictions.
+    const VioNavState initial_state =
+        test::StaticStereoImuSequence::getInitialState();
+    EXPECT_TRUE(gtsam::assert_equal(
+        initial_state.pose_, state.W_State_B.pose_, 1e-2));
+    EXPECT_LT(state.W_State_B.velocity_.norm(), 1e-2);
+  }
+  // The first keyframe, the one at min_intra_keyframe_time and those at
+  // max_intra_keyframe_time.
+  EXPECT_GE(nr_keyframes, 3u);
+  // No Mesher.
+  EXPECT_FALSE(pipeline.getMesherOutput());
+}
+
+}  // namespace VIO
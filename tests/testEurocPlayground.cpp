@@ -148,4 +148,16 @@ TEST(TestEurocPlayground, DISABLED_basicEurocPlayground) {
   }
 }
 
+TEST(TestEurocPlayground, DISABLED_parallelDenseReconstruction) {
+  EurocPlayground euroc_playground(FLAGS_test_data_path + "/V1_01_easy/",
+                                   FLAGS_test_data_path + "/EurocParams",
+                                   50,
+                                   1000,
+                                   300);
+  const std::string output_dir = ::testing::TempDir();
+  EXPECT_GT(euroc_playground.reconstructDenseBatch(output_dir, 100u, 4u), 0u);
+  EXPECT_EQ(euroc_playground.reconstructDenseBatch(output_dir, 100u, 4u), 0u)
+      << "The frame queues are consumed.";
+}
+
 }  // namespace kimera
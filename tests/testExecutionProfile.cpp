@@ -0,0 +1,127 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testExecutionProfile.cpp
+ * @brief  test the switches between execution profiles
+ * @author Antoni Rosinol
+ */
+
+#include <cmath>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/pipeline/ExecutionProfile.h"
+
+namespace VIO {
+
+namespace {
+
+ExecutionProfileMonitorParams makeParams() {
+  ExecutionProfileMonitorParams params;
+  params.hot_temperature_c = 80.0;
+  params.cool_temperature_c = 60.0;
+  params.throttled_frequency_ratio = 0.8;
+  params.min_latency_headroom = 0.1;
+  params.recover_latency_headroom = 0.4;
+  params.recover_periods = 3u;
+  params.hold_periods = 1u;
+  return params;
+}
+
+PlatformReading makeReading(const double& temperature_c,
+                            const double& frequency_ratio,
+                            const double& latency_headroom) {
+  PlatformReading reading;
+  reading.temperature_c = temperature_c;
+  reading.frequency_ratio = frequency_ratio;
+  reading.latency_headroom = latency_headroom;
+  return reading;
+}
+
+}  // namespace
+
+TEST(testExecutionProfile, defaultProfiles) {
+  ExecutionProfileParams params;
+  EXPECT_EQ(params.initial_profile_, ExecutionProfileType::kPerformance);
+  EXPECT_FALSE(params.auto_switch_);
+  // Performance runs the pipeline as configured.
+  EXPECT_EQ(params.getProfile(ExecutionProfileType::kPerformance),
+            ExecutionProfile());
+  // Each profile is at most as demanding as the previous one.
+  for (size_t i = 1u; i < kNrExecutionProfiles; ++i) {
+    const ExecutionProfile& previous =
+        params.getProfile(static_cast<ExecutionProfileType>(i - 1u));
+    const ExecutionProfile& profile =
+        params.getProfile(static_cast<ExecutionProfileType>(i));
+    EXPECT_LE(profile.feature_budget_scale, previous.feature_budget_scale);
+    EXPECT_GE(profile.frontend_frame_decimation,
+              previous.frontend_frame_decimation);
+    EXPECT_GE(profile.mesher_decimation, previous.mesher_decimation);
+    EXPECT_GE(profile.lcd_decimation, previous.lcd_decimation);
+  }
+  EXPECT_EQ(asString(ExecutionProfileType::kLowPower), "low_power");
+}
+
+TEST(testExecutionProfile, stepsDownWhenStressed) {
+  ExecutionProfileGovernor governor(makeParams(),
+                                    ExecutionProfileType::kPerformance);
+  // Hot.
+  EXPECT_TRUE(governor.update(makeReading(85.0, 1.0, 0.5)));
+  EXPECT_EQ(governor.getProfile(), ExecutionProfileType::kBalanced);
+  // Throttled, but holding after the switch.
+  EXPECT_FALSE(governor.update(makeReading(70.0, 0.5, 0.5)));
+  EXPECT_EQ(governor.getProfile(), ExecutionProfileType::kBalanced);
+  // Out of latency headroom.
+  EXPECT_TRUE(governor.update(makeReading(70.0, 1.0, -0.2)));
+  EXPECT_EQ(governor.getProfile(), ExecutionProfileType::kLowPower);
+  // Already at the least demanding profile.
+  EXPECT_FALSE(governor.update(makeReading(90.0, 0.5, -1.0)));
+  EXPECT_FALSE(governor.update(makeReading(90.0, 0.5, -1.0)));
+  EXPECT_EQ(governor.getProfile(), ExecutionProfileType::kLowPower);
+}
+
+TEST(testExecutionProfile, stepsUpOnceRelaxed) {
+  const ExecutionProfileMonitorParams params = makeParams();
+  ExecutionProfileGovernor governor(params, ExecutionProfileType::kLowPower);
+  for (size_t i = 1u; i < params.recover_periods; ++i) {
+    EXPECT_FALSE(governor.update(makeReading(50.0, 1.0, 0.6)));
+  }
+  // Between the cool and hot temperatures: hold, and start over.
+  EXPECT_FALSE(governor.update(makeReading(70.0, 1.0, 0.6)));
+  for (size_t i = 1u; i < params.recover_periods; ++i) {
+    EXPECT_FALSE(governor.update(makeReading(50.0, 1.0, 0.6)));
+  }
+  EXPECT_EQ(governor.getProfile(), ExecutionProfileType::kLowPower);
+  EXPECT_TRUE(governor.update(makeReading(50.0, 1.0, 0.6)));
+  EXPECT_EQ(governor.getProfile(), ExecutionProfileType::kBalanced);
+}
+
+TEST(testExecutionProfile, ignoresUnknownReadings) {
+  const ExecutionProfileMonitorParams params = makeParams();
+  ExecutionProfileGovernor governor(params, ExecutionProfileType::kBalanced);
+  // Only the latency is known, e.g. off Linux.
+  const PlatformReading stressed = makeReading(NAN, NAN, 0.0);
+  EXPECT_TRUE(governor.update(stressed));
+  EXPECT_EQ(governor.getProfile(), ExecutionProfileType::kLowPower);
+
+  governor.reset(ExecutionProfileType::kBalanced);
+  const PlatformReading unknown;
+  for (size_t i = 0u; i < params.recover_periods; ++i) {
+    EXPECT_FALSE(governor.update(makeReading(NAN, NAN, 0.2)));
+  }
+  // Nothing known: relaxed.
+  for (size_t i = 1u; i < params.recover_periods; ++i) {
+    EXPECT_FALSE(governor.update(unknown));
+  }
+  EXPECT_TRUE(governor.update(unknown));
+  EXPECT_EQ(governor.getProfile(), ExecutionProfileType::kPerformance);
+}
+
+}  // namespace VIO
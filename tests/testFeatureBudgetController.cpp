@@ -0,0 +1,102 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testFeatureBudgetController.cpp
+ * @brief  test the adaptation of the frontend budget to the latency
+ * @author Antoni Rosinol
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/frontend/FeatureBudgetController.h"
+
+namespace VIO {
+
+namespace {
+
+FeatureBudgetControllerParams makeParams() {
+  FeatureBudgetControllerParams params;
+  params.target_latency_ms = 20.0;
+  params.min_features_per_frame = 100;
+  params.features_step = 50;
+  params.min_klt_max_level = 1;
+  params.min_ransac_max_iterations = 30;
+  params.ransac_iterations_step = 40;
+  params.time_filter_weight = 1.0;
+  params.cooldown_keyframes = 0u;
+  return params;
+}
+
+}  // namespace
+
+TEST(testFeatureBudgetController, shrinksUnderLoad) {
+  FeatureBudgetController controller(makeParams(), 200, 3, 100);
+  EXPECT_EQ(controller.getMaxFeaturesPerFrame(), 200);
+  EXPECT_EQ(controller.getKltMaxLevel(), 3);
+  EXPECT_EQ(controller.getRansacMaxIterations(), 100);
+
+  // Features go first.
+  EXPECT_TRUE(controller.update(40.0));
+  EXPECT_EQ(controller.getMaxFeaturesPerFrame(), 150);
+  EXPECT_TRUE(controller.update(40.0));
+  EXPECT_EQ(controller.getMaxFeaturesPerFrame(), 100);
+  EXPECT_EQ(controller.getKltMaxLevel(), 3);
+
+  // Then the KLT levels.
+  EXPECT_TRUE(controller.update(40.0));
+  EXPECT_TRUE(controller.update(40.0));
+  EXPECT_EQ(controller.getKltMaxLevel(), 1);
+  EXPECT_EQ(controller.getRansacMaxIterations(), 100);
+
+  // Then the RANSAC iterations, down to their min.
+  EXPECT_TRUE(controller.update(40.0));
+  EXPECT_EQ(controller.getRansacMaxIterations(), 60);
+  EXPECT_TRUE(controller.update(40.0));
+  EXPECT_EQ(controller.getRansacMaxIterations(), 30);
+  EXPECT_FALSE(controller.update(40.0));
+  EXPECT_EQ(controller.getMaxFeaturesPerFrame(), 100);
+  EXPECT_EQ(controller.getKltMaxLevel(), 1);
+}
+
+TEST(testFeatureBudgetController, growsWithSlack) {
+  FeatureBudgetController controller(makeParams(), 150, 2, 70);
+  for (int i = 0; i < 10; ++i) controller.update(40.0);
+  EXPECT_EQ(controller.getMaxFeaturesPerFrame(), 100);
+  EXPECT_EQ(controller.getKltMaxLevel(), 1);
+  EXPECT_EQ(controller.getRansacMaxIterations(), 30);
+
+  // Within the dead band: no change.
+  EXPECT_FALSE(controller.update(15.0));
+
+  // RANSAC iterations go first, up to the configured value.
+  EXPECT_TRUE(controller.update(5.0));
+  EXPECT_EQ(controller.getRansacMaxIterations(), 70);
+  EXPECT_EQ(controller.getKltMaxLevel(), 1);
+  EXPECT_TRUE(controller.update(5.0));
+  EXPECT_EQ(controller.getKltMaxLevel(), 2);
+  EXPECT_EQ(controller.getMaxFeaturesPerFrame(), 100);
+  EXPECT_TRUE(controller.update(5.0));
+  EXPECT_EQ(controller.getMaxFeaturesPerFrame(), 150);
+  EXPECT_FALSE(controller.update(5.0));
+}
+
+TEST(testFeatureBudgetController, cooldown) {
+  FeatureBudgetControllerParams params = makeParams();
+  params.cooldown_keyframes = 2u;
+  FeatureBudgetController controller(params, 200, 3, 100);
+  EXPECT_FALSE(controller.update(40.0));
+  EXPECT_FALSE(controller.update(40.0));
+  EXPECT_TRUE(controller.update(40.0));
+  EXPECT_EQ(controller.getMaxFeaturesPerFrame(), 150);
+  EXPECT_FALSE(controller.update(40.0));
+}
+
+}  // namespace VIO
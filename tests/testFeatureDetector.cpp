@@ -12,6 +12,8 @@
 #include "kimera-vio/frontend/feature-detector/FeatureDetector-definitions.h"
 #include "kimera-vio/frontend/feature-detector/FeatureDetector.h"
 #include "kimera-vio/frontend/feature-detector/FeatureDetectorParams.h"
+#include "kimera-vio/frontend/feature-detector/FeatureOccupancyGrid.h"
+#include "kimera-vio/frontend/feature-detector/SpeculativeFeatureDetector.h"
 
 DECLARE_string(test_data_path);
 
@@ -257,4 +259,216 @@ TEST(FeatureDetector, FeatureDetector_ANMS_Binning3) {
   CHECK(gtsam::assert_equal(keypointPerBinCount, expectedBinCount, 1e-9));
 }
 
+/* ************************************************************************* */
+TEST(FeatureDetector, GridFeatureDetectionPerCellBudget) {
+  FeatureDetectorParams tp;
+  tp.parseYAML(FLAGS_test_data_path +
+               "/ForFeatureDetector/frontendParams-noNMS.yaml");
+  tp.quality_level_ = 1e-10;
+  tp.enable_grid_detection_ = true;
+  tp.grid_detection_rows_ = 2;
+  tp.grid_detection_cols_ = 3;
+  tp.max_nr_keypoints_before_anms_ = 60;
+
+  const string imgName =
+      string(FLAGS_test_data_path) + "/ForStereoFrame/left_fisheye_img_0.png";
+  const cv::Mat img = UtilsOpenCV::ReadAndConvertToGrayScale(imgName);
+
+  FeatureDetector feature_detector(tp);
+  const std::vector<cv::KeyPoint> keypoints =
+      feature_detector.gridFeatureDetection(img);
+
+  // Each cell gets at most 60 / 6 = 10 keypoints, and a textured image
+  // fills all of them.
+  Eigen::MatrixXi keypoints_per_cell = Eigen::MatrixXi::Zero(2, 3);
+  for (const cv::KeyPoint& kp : keypoints) {
+    ASSERT_GE(kp.pt.x, 0.0f);
+    ASSERT_GE(kp.pt.y, 0.0f);
+    ASSERT_LT(kp.pt.x, img.cols);
+    ASSERT_LT(kp.pt.y, img.rows);
+    // Same partition as the detector: cell c spans [c * cols / 3, ...).
+    int c = 2;
+    while (kp.pt.x < c * img.cols / 3) --c;
+    int r = 1;
+    while (kp.pt.y < r * img.rows / 2) --r;
+    keypoints_per_cell(r, c)++;
+  }
+  EXPECT_EQ(keypoints.size(), 60u);
+  EXPECT_TRUE(keypoints_per_cell.isApprox(10 * Eigen::MatrixXi::Ones(2, 3)));
+}
+
+/* ************************************************************************* */
+TEST(FeatureDetector, RoiMaskRestrictsDetection) {
+  FeatureDetectorParams tp;
+  tp.parseYAML(FLAGS_test_data_path +
+               "/ForFeatureDetector/frontendParams-noNMS.yaml");
+  CameraParams cam_params;
+  cam_params.parseYAML(FLAGS_test_data_path + "/sensor.yaml");
+  const string imgName =
+      string(FLAGS_test_data_path) + "/ForStereoFrame/left_fisheye_img_0.png";
+  const cv::Mat img = UtilsOpenCV::ReadAndConvertToGrayScale(imgName);
+
+  // Only the left half of the image is of interest.
+  cv::Mat roi_mask = cv::Mat::zeros(img.size(), CV_8UC1);
+  roi_mask.colRange(0, img.cols / 2).setTo(255);
+  cam_params.setRoiMask(roi_mask);
+
+  for (const bool& enable_grid_detection : {false, true}) {
+    tp.enable_grid_detection_ = enable_grid_detection;
+    FeatureDetector feature_detector(tp);
+    Frame frame(0, 123, cam_params, img);
+    feature_detector.featureDetection(&frame);
+    ASSERT_FALSE(frame.keypoints_.empty());
+    for (const KeypointCV& keypoint : frame.keypoints_) {
+      EXPECT_LT(keypoint.x, img.cols / 2);
+    }
+    // The camera's mask is not drawn on.
+    EXPECT_EQ(cv::countNonZero(cam_params.roi_mask_),
+              img.rows * (img.cols / 2));
+  }
+}
+
+/* ************************************************************************* */
+TEST(FeatureDetector, IncrementalAnmsSeededByTrackedKeypoints) {
+  // Regular grid of candidates, with increasing response to the right.
+  std::vector<cv::KeyPoint> keypoints;
+  for (int r = 5; r < 100; r += 10) {
+    for (int c = 5; c < 200; c += 10) {
+      keypoints.push_back(cv::KeyPoint(c, r, 1.0f, -1, c));
+    }
+  }
+  AdaptiveNonMaximumSuppression anms(AnmsAlgorithmType::Incremental);
+  // Tracked keypoints cover the right half of the image (strongest responses).
+  KeypointsCV tracked_keypoints;
+  for (int r = 5; r < 100; r += 10) {
+    for (int c = 105; c < 200; c += 10) {
+      tracked_keypoints.push_back(KeypointCV(c, r));
+    }
+  }
+  anms.setTrackedKeypoints(tracked_keypoints);
+  const Eigen::MatrixXd binning_mask;
+  const std::vector<cv::KeyPoint> selected =
+      anms.suppressNonMax(keypoints, 20, 0.1, 200, 100, 1, 1, binning_mask);
+
+  EXPECT_GE(selected.size(), 18u);
+  EXPECT_LE(selected.size(), 20u);
+  const float radius = anms.getIncrementalRadius();
+  EXPECT_GT(radius, 0.0f);
+  for (const cv::KeyPoint& kpt : selected) {
+    // New keypoints fill the part of the image without tracks.
+    EXPECT_LT(kpt.pt.x, 105.0f);
+  }
+
+  // The radius is reused on the next keyframe.
+  anms.setTrackedKeypoints(KeypointsCV());
+  anms.suppressNonMax(keypoints, 20, 0.1, 200, 100, 1, 1, binning_mask);
+  EXPECT_GT(anms.getIncrementalRadius(), 0.0f);
+}
+
+/* ************************************************************************* */
+TEST(FeatureDetector, FeatureOccupancyGrid) {
+  FeatureOccupancyGrid occupancy_grid(10);
+  occupancy_grid.reset(cv::Size(100, 50));
+  EXPECT_TRUE(occupancy_grid.isFree(KeypointCV(20.0f, 20.0f)));
+  occupancy_grid.add(KeypointCV(20.0f, 20.0f));
+  occupancy_grid.add(KeypointCV(95.0f, 45.0f));
+  EXPECT_EQ(occupancy_grid.size(), 2u);
+
+  // Same or neighbouring cells: rejected only within the min distance.
+  EXPECT_FALSE(occupancy_grid.isFree(KeypointCV(20.0f, 20.0f)));
+  EXPECT_FALSE(occupancy_grid.isFree(KeypointCV(29.0f, 24.0f)));
+  EXPECT_TRUE(occupancy_grid.isFree(KeypointCV(29.0f, 29.0f)));
+  EXPECT_FALSE(occupancy_grid.isFree(KeypointCV(99.0f, 49.0f)));
+  EXPECT_TRUE(occupancy_grid.isFree(KeypointCV(60.0f, 20.0f)));
+
+  EXPECT_EQ(occupancy_grid.count(cv::Rect(0, 0, 100, 50)), 2u);
+  EXPECT_EQ(occupancy_grid.count(cv::Rect(0, 0, 50, 50)), 1u);
+  EXPECT_EQ(occupancy_grid.count(cv::Rect(21, 0, 50, 50)), 0u);
+
+  occupancy_grid.reset(cv::Size(100, 50));
+  EXPECT_EQ(occupancy_grid.size(), 0u);
+  EXPECT_TRUE(occupancy_grid.isFree(KeypointCV(20.0f, 20.0f)));
+}
+
+/* ************************************************************************* */
+TEST(FeatureDetector, OccupancyGridRejectsDetectionsNearTracks) {
+  FeatureDetectorParams tp;
+  tp.parseYAML(FLAGS_test_data_path +
+               "/ForFeatureDetector/frontendParams-noNMS.yaml");
+  tp.enable_occupancy_grid_ = true;
+  tp.enable_subpixel_corner_refinement_ = false;
+
+  CameraParams cam_params;
+  cam_params.parseYAML(FLAGS_test_data_path + "/sensor.yaml");
+  const string imgName =
+      string(FLAGS_test_data_path) + "/ForStereoFrame/left_fisheye_img_0.png";
+  Frame frame(
+      0, 123, cam_params, UtilsOpenCV::ReadAndConvertToGrayScale(imgName));
+
+  // A first detection gives the tracked keypoints of the second one.
+  FeatureDetector feature_detector(tp);
+  feature_detector.featureDetection(&frame);
+  const size_t nr_tracked = frame.keypoints_.size();
+  ASSERT_GT(nr_tracked, 0u);
+  // Make room for new features.
+  tp.max_features_per_frame_ = 2 * static_cast<int>(nr_tracked);
+  FeatureDetector second_feature_detector(tp);
+  second_feature_detector.featureDetection(&frame);
+
+  const float min_distance =
+      tp.min_distance_btw_tracked_and_detected_features_;
+  for (size_t i = nr_tracked; i < frame.keypoints_.size(); ++i) {
+    for (size_t j = 0u; j < nr_tracked; ++j) {
+      const KeypointCV diff = frame.keypoints_[i] - frame.keypoints_[j];
+      EXPECT_GT(std::sqrt(diff.dot(diff)), min_distance);
+    }
+  }
+}
+
+/* ************************************************************************* */
+TEST(FeatureDetector, SpeculativeCandidatesFollowTrackedFeatures) {
+  FeatureDetectorParams tp;
+  tp.parseYAML(FLAGS_test_data_path +
+               "/ForFeatureDetector/frontendParams-noNMS.yaml");
+
+  CameraParams cam_params;
+  cam_params.parseYAML(FLAGS_test_data_path + "/sensor.yaml");
+  const string imgName =
+      string(FLAGS_test_data_path) + "/ForStereoFrame/left_fisheye_img_0.png";
+  Frame frame(
+      0, 123, cam_params, UtilsOpenCV::ReadAndConvertToGrayScale(imgName));
+  for (LandmarkId lmk_id = 0; lmk_id < 20; ++lmk_id) {
+    frame.keypoints_.push_back(KeypointCV(100 + 10 * lmk_id, 200));
+    frame.landmarks_.push_back(lmk_id);
+  }
+
+  // The keyframe moved by (3, -2) pixels, and lost some features.
+  Frame keyframe(frame);
+  keyframe.keypoints_.resize(15u);
+  keyframe.landmarks_.resize(15u);
+  for (KeypointCV& keypoint : keyframe.keypoints_) {
+    keypoint += KeypointCV(3, -2);
+  }
+
+  SpeculativeFeatureDetector speculative_feature_detector(tp);
+  speculative_feature_detector.launch(frame);
+  std::vector<cv::KeyPoint> candidates;
+  ASSERT_TRUE(
+      speculative_feature_detector.takeCandidates(keyframe, &candidates));
+
+  FeatureDetector feature_detector(tp);
+  const std::vector<cv::KeyPoint> expected_candidates =
+      feature_detector.detectCandidates(frame.img_);
+  ASSERT_EQ(candidates.size(), expected_candidates.size());
+  for (size_t i = 0u; i < candidates.size(); ++i) {
+    EXPECT_NEAR(candidates[i].pt.x, expected_candidates[i].pt.x + 3, tol);
+    EXPECT_NEAR(candidates[i].pt.y, expected_candidates[i].pt.y - 2, tol);
+  }
+
+  // Consumed: the next keyframe detects as usual.
+  EXPECT_FALSE(
+      speculative_feature_detector.takeCandidates(keyframe, &candidates));
+  EXPECT_TRUE(candidates.empty());
+}
+
 }  // namespace VIO
@@ -0,0 +1,156 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testFixedWindowKlt.cpp
+ * @brief  test the KLT kernels specialized for a window size
+ * @author Antoni Rosinol
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
+
+#include "kimera-vio/frontend/FixedWindowKlt.h"
+
+namespace VIO {
+
+namespace {
+
+//! Smooth texture, translated by (tx, ty) pixels.
+cv::Mat makeImage(const float& tx, const float& ty) {
+  cv::Mat img(240, 320, CV_8UC1);
+  for (int v = 0; v < img.rows; ++v) {
+    for (int u = 0; u < img.cols; ++u) {
+      const float x = u - tx;
+      const float y = v - ty;
+      const float value = 128.0f +
+                          50.0f * std::sin(0.21f * x) * std::cos(0.17f * y) +
+                          40.0f * std::sin(0.11f * (x + y)) +
+                          30.0f * std::cos(0.05f * x - 0.13f * y);
+      img.at<uchar>(v, u) = cv::saturate_cast<uchar>(value);
+    }
+  }
+  return img;
+}
+
+//! Keypoints far enough from the borders for the translation to be exact.
+KeypointsCV makeKeypoints() {
+  KeypointsCV keypoints;
+  for (int v = 60; v <= 180; v += 20) {
+    for (int u = 60; u <= 260; u += 20) {
+      keypoints.push_back(KeypointCV(u, v));
+    }
+  }
+  return keypoints;
+}
+
+}  // namespace
+
+TEST(testFixedWindowKlt, supportedWindowSizes) {
+  EXPECT_TRUE(FixedWindowKlt::isSupported(15));
+  EXPECT_TRUE(FixedWindowKlt::isSupported(21));
+  EXPECT_TRUE(FixedWindowKlt::isSupported(24));
+  EXPECT_TRUE(FixedWindowKlt::isSupported(31));
+  EXPECT_FALSE(FixedWindowKlt::isSupported(17));
+}
+
+TEST(testFixedWindowKlt, pyramidLevelsAsOpenCv) {
+  const cv::Mat img = makeImage(0.0f, 0.0f);
+  for (const int& win_size : {15, 31}) {
+    KltPyramid pyramid;
+    FixedWindowKlt::buildPyramid(img, win_size, 4, &pyramid);
+    std::vector<cv::Mat> cv_pyramid;
+    const int cv_max_level = cv::buildOpticalFlowPyramid(
+        img, cv_pyramid, cv::Size(win_size, win_size), 4, false);
+    ASSERT_EQ(pyramid.getMaxLevel(), cv_max_level);
+    for (int level = 0; level <= cv_max_level; ++level) {
+      const cv::Mat& padded = pyramid.levels[level];
+      EXPECT_EQ(cv::norm(padded(cv::Rect(pyramid.border,
+                                         pyramid.border,
+                                         padded.cols - 2 * pyramid.border,
+                                         padded.rows - 2 * pyramid.border)),
+                         cv_pyramid[level],
+                         cv::NORM_INF),
+                0.0);
+    }
+    EXPECT_FALSE(pyramid.hasGradients());
+    FixedWindowKlt::computeGradients(&pyramid);
+    ASSERT_TRUE(pyramid.hasGradients());
+    EXPECT_EQ(pyramid.grad_x.size(), pyramid.levels.size());
+    EXPECT_EQ(pyramid.grad_x[0].type(), CV_16SC1);
+  }
+}
+
+TEST(testFixedWindowKlt, tracksTranslation) {
+  const cv::Point2f translation(6.3f, -4.7f);
+  const cv::Mat ref_img = makeImage(0.0f, 0.0f);
+  const cv::Mat cur_img = makeImage(translation.x, translation.y);
+  const cv::TermCriteria criteria(
+      cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 30, 0.01);
+  for (const int& win_size : {15, 21, 24, 31}) {
+    KltPyramid ref_pyramid, cur_pyramid;
+    FixedWindowKlt::buildPyramid(ref_img, win_size, 3, &ref_pyramid);
+    FixedWindowKlt::buildPyramid(cur_img, win_size, 3, &cur_pyramid);
+    FixedWindowKlt::computeGradients(&ref_pyramid);
+    const int max_level =
+        std::min(ref_pyramid.getMaxLevel(), cur_pyramid.getMaxLevel());
+
+    const KeypointsCV px_ref = makeKeypoints();
+    // Initial guess: no motion.
+    KeypointsCV px_cur = px_ref;
+    std::vector<uchar> status;
+    FixedWindowKlt klt(win_size);
+    klt.track(ref_pyramid,
+              cur_pyramid,
+              max_level,
+              criteria,
+              px_ref,
+              &px_cur,
+              &status);
+    ASSERT_EQ(status.size(), px_ref.size());
+    size_t nr_tracked = 0u;
+    for (size_t i = 0u; i < px_ref.size(); ++i) {
+      if (!status[i]) continue;
+      ++nr_tracked;
+      EXPECT_LT(cv::norm(px_cur[i] - px_ref[i] - translation), 0.05)
+          << "Window size: " << win_size;
+    }
+    EXPECT_GT(nr_tracked, 0.9 * px_ref.size());
+  }
+}
+
+TEST(testFixedWindowKlt, failsOutsideTheImage) {
+  const cv::Mat img = makeImage(0.0f, 0.0f);
+  KltPyramid pyramid;
+  FixedWindowKlt::buildPyramid(img, 21, 0, &pyramid);
+  FixedWindowKlt::computeGradients(&pyramid);
+  const KeypointsCV px_ref = {KeypointCV(160.0f, 120.0f),
+                              KeypointCV(160.0f, 120.0f)};
+  KeypointsCV px_cur = {KeypointCV(160.0f, 120.0f),
+                        KeypointCV(1000.0f, 120.0f)};
+  std::vector<uchar> status;
+  FixedWindowKlt klt(21);
+  klt.track(pyramid,
+            pyramid,
+            0,
+            cv::TermCriteria(cv::TermCriteria::COUNT, 10, 0.0),
+            px_ref,
+            &px_cur,
+            &status);
+  EXPECT_EQ(status, std::vector<uchar>({1u, 0u}));
+  EXPECT_LT(cv::norm(px_cur[0] - px_ref[0]), 1e-3);
+}
+
+}  // namespace VIO
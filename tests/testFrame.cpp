@@ -199,3 +199,33 @@ TEST(testFrame, findLmkIdFromPixel) {
               i + 5);
   }
 }
+
+/* ************************************************************************* */
+TEST(testFrame, opticalFlowPyramidIsCached) {
+  Frame f(0,
+          0,
+          CameraParams(),
+          UtilsOpenCV::ReadAndConvertToGrayScale(chessboardImgName));
+  EXPECT_FALSE(f.hasOpticalFlowPyramid());
+
+  const cv::Size win_size(21, 21);
+  int nr_levels = -1;
+  const std::vector<cv::Mat>& pyramid =
+      f.getOpticalFlowPyramid(win_size, 3, &nr_levels);
+  EXPECT_TRUE(f.hasOpticalFlowPyramid());
+  EXPECT_EQ(nr_levels, 3);
+  ASSERT_FALSE(pyramid.empty());
+  const uchar* level_0_data = pyramid.at(0).data;
+
+  // Second call must not rebuild the pyramid.
+  const std::vector<cv::Mat>& pyramid_again =
+      f.getOpticalFlowPyramid(win_size, 3);
+  EXPECT_EQ(pyramid_again.at(0).data, level_0_data);
+
+  // Copies do not carry the pyramid.
+  Frame f_copy(f);
+  EXPECT_FALSE(f_copy.hasOpticalFlowPyramid());
+
+  f.releaseOpticalFlowPyramid();
+  EXPECT_FALSE(f.hasOpticalFlowPyramid());
+}
@@ -12,9 +12,13 @@
  * @author Nathan Hughes
  */
 
+#include <chrono>
+#include <thread>
+
 #include <gtest/gtest.h>
 
 #include "kimera-vio/loopclosure/FrameCache.h"
+#include "kimera-vio/utils/Timer.h"
 #include "kimera-vio/utils/UtilsOpenCV.h"
 
 namespace cv {
@@ -134,17 +138,6 @@ bool operator==(const LCDFrame& lhs, const LCDFrame& rhs) {
     return false;
   }
 
-  if (lhs.descriptors_vec_.size() != rhs.descriptors_vec_.size()) {
-    return false;
-  }
-
-  for (size_t i = 0; i < lhs.descriptors_vec_.size(); ++i) {
-    if (!UtilsOpenCV::compareCvMatsUpToTol(lhs.descriptors_vec_[i],
-                                           rhs.descriptors_vec_[i])) {
-      return false;
-    }
-  }
-
   return true;
 }
 
@@ -158,6 +151,22 @@ bool operator==(const StereoLCDFrame& lhs, const StereoLCDFrame& rhs) {
          lhs.right_keypoints_rectified_ == rhs.right_keypoints_rectified_;
 }
 
+TEST(testFrameCache, DescriptorRowsShareFrameDescriptors) {
+  OrbDescriptor descriptors(30, 32, CV_8UC1);
+  cv::randu(descriptors, 0, 255);
+  const LCDFrame frame(
+      1, 2, 3, {}, Landmarks(), descriptors, BearingVectors());
+  ASSERT_TRUE(frame.descriptors_mat_.isContinuous());
+
+  const OrbDescriptorVec rows = descriptorRows(frame.descriptors_mat_);
+  ASSERT_EQ(rows.size(), 30u);
+  for (int i = 0; i < descriptors.rows; ++i) {
+    EXPECT_EQ(rows[i].data, frame.descriptors_mat_.ptr(i));
+    EXPECT_EQ(rows[i].rows, 1);
+    EXPECT_EQ(rows[i].cols, 32);
+  }
+}
+
 TEST(testFrameCache, EmptyFrameRoundTripCorrect) {
   LCDFrame frame;
 
@@ -176,17 +185,10 @@ TEST(testFrameCache, NonEmptyFrameRoundTripCorrect) {
   BearingVectors bearings{
       {25.0, 26.0, 27.0}, {28.0, 29.0, 30.0}, {31.0, 32.0, 33.0}};
 
-  OrbDescriptorVec vec{cv::Mat(17, 18, CV_64FC1),
-                       cv::Mat(19, 20, CV_32SC1),
-                       cv::Mat(21, 22, CV_8UC3)};
-  cv::randu(vec[0], -10.0, 10.0);
-  cv::randu(vec[1], -10, 10);
-  cv::randu(vec[2], 0, 255);
-
   cv::Mat descriptors(23, 24, CV_16SC2);
   cv::randu(descriptors, 0, 50);
 
-  LCDFrame frame(1, 2, 3, keypoints, landmarks, vec, descriptors, bearings);
+  LCDFrame frame(1, 2, 3, keypoints, landmarks, descriptors, bearings);
 
   std::ostringstream s_out;
   frame.save(s_out);
@@ -215,13 +217,6 @@ TEST(testFrameCache, NonEmptyStereoFrameRoundTripCorrect) {
   BearingVectors bearings{
       {25.0, 26.0, 27.0}, {28.0, 29.0, 30.0}, {31.0, 32.0, 33.0}};
 
-  OrbDescriptorVec vec{cv::Mat(17, 18, CV_64FC1),
-                       cv::Mat(19, 20, CV_32SC1),
-                       cv::Mat(21, 22, CV_8UC3)};
-  cv::randu(vec[0], -10.0, 10.0);
-  cv::randu(vec[1], -10, 10);
-  cv::randu(vec[2], 0, 255);
-
   cv::Mat descriptors(23, 24, CV_16SC2);
   cv::randu(descriptors, 0, 50);
 
@@ -236,7 +231,6 @@ TEST(testFrameCache, NonEmptyStereoFrameRoundTripCorrect) {
                        3,
                        keypoints,
                        landmarks,
-                       vec,
                        descriptors,
                        bearings,
                        left_keypoints,
@@ -297,10 +291,128 @@ const FrameCacheTestConfig test_cases[] = {
     {{10, "/tmp", ".kimera_lcd_frames", 2}, 10, getAccessAllOrder(10)},
     {{}, 10, {{10, false}, {11, false}, {12, false}}},
     {{10, "/tmp", ".kimera_lcd_frames", 2}, 10, {{10, false}, {11, false}}},
+    {{3, "/tmp", ".kimera_lcd_frames_sync", 4, true, false},
+     20,
+     {{0, true}, {19, true}, {5, true}, {0, true}, {13, true}, {2, true}}},
+    {{3, "/tmp", ".kimera_lcd_frames_zstd", 4, true, true, 3},
+     20,
+     getAccessAllOrder(20)},
 };
 
 INSTANTIATE_TEST_SUITE_P(CacheAccessCorrect,
                          FrameCacheFixture,
                          testing::ValuesIn(test_cases));
 
+TEST(testFrameCache, DiskCacheRoundTripCorrect) {
+  std::vector<StereoLCDFrame::Ptr> frames;
+  for (size_t i = 0; i < 7; ++i) {
+    OrbDescriptor descriptors(5, 32, CV_8UC1);
+    cv::randu(descriptors, 0, 255);
+    const float offset = static_cast<float>(i);
+    std::vector<cv::KeyPoint> keypoints{
+        {4.0f + offset, 5.0f, 6.0f, 7.0f, 8.0f, 9, 10}};
+    StatusKeypointsCV left_keypoints{std::make_pair(
+        KeypointStatus::VALID, cv::Point2f(5.0f, 6.0f + offset))};
+    StatusKeypointsCV right_keypoints{
+        std::make_pair(KeypointStatus::NO_DEPTH, cv::Point2f(6.0f, 7.0f))};
+    frames.push_back(std::make_shared<StereoLCDFrame>(
+        100 + i,
+        0,
+        i,
+        keypoints,
+        Landmarks{{11.0 + offset, 12.0, 13.0}},
+        descriptors,
+        BearingVectors{{25.0, 26.0 + offset, 27.0}},
+        left_keypoints,
+        right_keypoints));
+  }
+
+  for (const bool async_write : {false, true}) {
+    FrameCache cache(
+        {2, "/tmp", ".kimera_lcd_frames_rt", 3, true, async_write, 1});
+    for (const auto& frame : frames) {
+      cache.addFrame(frame);
+    }
+
+    // Backwards, to load the frames from disk in random order.
+    for (size_t i = frames.size(); i-- > 0;) {
+      const auto result =
+          std::dynamic_pointer_cast<StereoLCDFrame>(cache.getFrame(i));
+      ASSERT_TRUE(result);
+      EXPECT_EQ(*frames[i], *result);
+    }
+  }
+}
+
+TEST(testFrameCache, MemoryBudgetSpillsLandmarks) {
+  FrameCacheConfig config{2, "/tmp", ".kimera_lcd_frames_budget", 3, true};
+  std::vector<LCDFrame::Ptr> frames;
+  for (size_t i = 0; i < 10; ++i) {
+    OrbDescriptor descriptors(50, 32, CV_8UC1);
+    cv::randu(descriptors, 0, 255);
+    frames.push_back(std::make_shared<LCDFrame>(
+        100 + i,
+        0,
+        i,
+        std::vector<cv::KeyPoint>(50),
+        Landmarks(50, Landmark(1.0, 2.0, static_cast<double>(i))),
+        descriptors,
+        BearingVectors(50, BearingVector(0.0, static_cast<double>(i), 1.0))));
+  }
+  // Room for about 5 full frames.
+  const size_t frame_bytes = getFrameBytes(*frames.front());
+  config.max_resident_bytes = 5 * frame_bytes;
+
+  MemoryBudgetCacheImpl cache(config);
+  for (const auto& frame : frames) {
+    cache.addFrame(frame);
+  }
+  EXPECT_GT(cache.getNrSpilledFrames(), 0u);
+  EXPECT_LT(cache.getNrSpilledFrames(), frames.size());
+  EXPECT_LT(cache.getResidentBytes(), frames.size() * frame_bytes);
+
+  for (size_t i = frames.size(); i-- > 0;) {
+    const auto result = cache.getFrame(i);
+    ASSERT_TRUE(result);
+    EXPECT_EQ(*frames[i], *result);
+  }
+  EXPECT_FALSE(cache.getFrame(frames.size()));
+}
+
+TEST(testFrameCache, PrefetchCorrect) {
+  LRUCacheImpl cache(
+      {2, "/tmp", ".kimera_lcd_frames_prefetch", 3, true, false});
+  std::vector<LCDFrame::Ptr> frames;
+  for (size_t i = 0; i < 10; ++i) {
+    frames.push_back(std::make_shared<LCDFrame>(
+        100 + i,
+        0,
+        i,
+        std::vector<cv::KeyPoint>(20),
+        Landmarks(20, Landmark(1.0, 2.0, static_cast<double>(i))),
+        OrbDescriptor(),
+        BearingVectors()));
+    cache.addFrame(frames.back());
+  }
+
+  // Frames not archived yet, or out of range, are not prefetched.
+  const size_t resident_bytes = cache.getResidentBytes();
+  cache.prefetch({9, 10, 0, 4});
+  const size_t prefetched_bytes =
+      getFrameBytes(*frames[0]) + getFrameBytes(*frames[4]);
+  const auto tic = utils::Timer::tic();
+  while (cache.getResidentBytes() < resident_bytes + prefetched_bytes &&
+         utils::Timer::toc(tic).count() < 5000) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(cache.getResidentBytes(), resident_bytes + prefetched_bytes);
+
+  for (const size_t i : {0u, 4u, 7u}) {
+    const auto result = cache.getFrame(i);
+    ASSERT_TRUE(result);
+    EXPECT_EQ(*frames[i], *result);
+  }
+  EXPECT_EQ(cache.getNrPrefetchHits(), 2u);
+}
+
 }  // namespace VIO
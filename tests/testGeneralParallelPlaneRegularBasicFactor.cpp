@@ -22,6 +22,7 @@
 #include <gtsam/slam/PriorFactor.h>
 
 #include <algorithm>
+#include <chrono>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
@@ -30,6 +31,7 @@
 #include "kimera-vio/factors/ParallelPlaneRegularFactor.h"
 #include "kimera-vio/factors/PointPlaneFactor.h"
 #include "kimera-vio/test/EvaluateFactor.h"
+#include "kimera-vio/utils/Timer.h"
 
 using namespace std;
 using namespace gtsam;
@@ -132,6 +134,48 @@ TEST(testGeneralParallelPlaneRegularFactor, Jacobians) {
   VIO::test::evaluateFactor(factor, plane_1, plane_2, tol, der_tol);
 }
 
+/**
+ * Test that the fixed-size linearization equals the generic one, and
+ * microbenchmark them.
+ */
+TEST(testGeneralParallelPlaneRegularBasicFactor, FixedSizeLinearization) {
+  Key plane_key_1(1);
+  Key plane_key_2(2);
+  GeneralParallelPlaneRegularBasicFactor factor(
+      plane_key_1,
+      plane_key_2,
+      noiseModel::Diagonal::Sigmas(Vector4(0.1, 0.1, 0.1, 0.2)),
+      1.0);
+  Values values;
+  values.insert(plane_key_1, OrientedPlane3(0.3, 0.2, 1.9, 0.9));
+  values.insert(plane_key_2, OrientedPlane3(0.1, 0.1, 0.9, 0.1));
+
+  const GaussianFactor::shared_ptr expected =
+      factor.NoiseModelFactor::linearize(values);
+  const GaussianFactor::shared_ptr actual = factor.linearize(values);
+  ASSERT_TRUE(expected);
+  ASSERT_TRUE(actual);
+  EXPECT_TRUE(expected->equals(*actual, tol));
+
+  static constexpr size_t kNrLinearizations = 100000u;
+  auto tic = VIO::utils::Timer::tic();
+  for (size_t i = 0u; i < kNrLinearizations; ++i) {
+    EXPECT_TRUE(factor.NoiseModelFactor::linearize(values));
+  }
+  const auto generic_us =
+      VIO::utils::Timer::toc<std::chrono::microseconds>(tic).count();
+  tic = VIO::utils::Timer::tic();
+  for (size_t i = 0u; i < kNrLinearizations; ++i) {
+    EXPECT_TRUE(factor.linearize(values));
+  }
+  const auto fixed_size_us =
+      VIO::utils::Timer::toc<std::chrono::microseconds>(tic).count();
+  LOG(INFO) << kNrLinearizations
+            << " GeneralParallelPlaneRegularBasicFactor linearizations:\n"
+            << " - Generic: " << generic_us << " us.\n"
+            << " - Fixed-size: " << fixed_size_us << " us.";
+}
+
 /**
   * Test that optimization works.
   * Two planes constrained together, using distance + parallelism factor.
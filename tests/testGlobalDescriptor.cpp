@@ -0,0 +1,119 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testGlobalDescriptor.cpp
+ * @brief  test GlobalDescriptorExtractor on descriptors near vocabulary words
+ * @author Antoni Rosinol
+ */
+
+#include <DBoW2/DBoW2.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "kimera-vio/loopclosure/BinaryVocabulary.h"
+#include "kimera-vio/loopclosure/GlobalDescriptor.h"
+
+DECLARE_string(test_data_path);
+
+namespace VIO {
+
+class GlobalDescriptorFixture : public ::testing::Test {
+ public:
+  GlobalDescriptorFixture() : vocab_(), centers_(), bit_means_(), rng_(5) {
+    vocab_.load(FLAGS_test_data_path +
+                "/ForLoopClosureDetector/small_voc.yml.gz");
+    getVocabularyLevel(vocab_, 1, &centers_, &bit_means_);
+  }
+
+ protected:
+  //! Vocabulary words with a few bits flipped, as features of an image.
+  cv::Mat randomDescriptors(const int& nr_descriptors) {
+    cv::Mat descriptors;
+    for (int i = 0; i < nr_descriptors; ++i) {
+      cv::Mat descriptor =
+          vocab_.getWord(rng_.uniform(0, static_cast<int>(vocab_.size())))
+              .clone();
+      for (int j = 0; j < 16; ++j) {
+        const int bit = rng_.uniform(0, 8 * DBoW2::FORB::L);
+        descriptor.data[bit / 8] ^= static_cast<uchar>(1u << (bit % 8));
+      }
+      descriptors.push_back(descriptor);
+    }
+    return descriptors;
+  }
+
+  static float norm(const std::vector<float>& descriptor) {
+    return std::sqrt(
+        GlobalDescriptorExtractor::similarity(descriptor, descriptor));
+  }
+
+ protected:
+  OrbVocabulary vocab_;
+  cv::Mat centers_;
+  cv::Mat bit_means_;
+  cv::RNG rng_;
+};
+
+TEST_F(GlobalDescriptorFixture, VocabularyLevels) {
+  EXPECT_EQ(centers_.rows, vocab_.getBranchingFactor());
+  EXPECT_EQ(centers_.cols, DBoW2::FORB::L);
+  ASSERT_EQ(bit_means_.rows, centers_.rows);
+  EXPECT_EQ(bit_means_.cols, 8 * DBoW2::FORB::L);
+  double min_mean, max_mean;
+  cv::minMaxLoc(bit_means_, &min_mean, &max_mean);
+  EXPECT_GE(min_mean, 0.0);
+  EXPECT_LE(max_mean, 1.0);
+
+  cv::Mat centers_2, bit_means_2;
+  getVocabularyLevel(vocab_, 2, &centers_2, &bit_means_2);
+  EXPECT_GT(centers_2.rows, centers_.rows);
+  EXPECT_LE(centers_2.rows, centers_.rows * vocab_.getBranchingFactor());
+}
+
+TEST_F(GlobalDescriptorFixture, SimilarImagesAreCloser) {
+  for (const int& projection_dim : {128, 0}) {
+    GlobalDescriptorExtractor extractor(centers_, bit_means_, projection_dim);
+    EXPECT_EQ(extractor.dim(),
+              projection_dim > 0 ? 128u
+                                 : static_cast<size_t>(256 * centers_.rows));
+
+    const cv::Mat descriptors = randomDescriptors(300);
+    // Same place: two thirds of the features seen again.
+    cv::Mat revisit = randomDescriptors(300);
+    descriptors.rowRange(0, 200).copyTo(revisit.rowRange(0, 200));
+    const std::vector<float> image = extractor.compute(descriptors);
+    const std::vector<float> same_place = extractor.compute(revisit);
+    const std::vector<float> other_place =
+        extractor.compute(randomDescriptors(300));
+
+    ASSERT_EQ(image.size(), extractor.dim());
+    EXPECT_NEAR(norm(image), 1.0f, 1e-5f);
+    EXPECT_GT(GlobalDescriptorExtractor::similarity(image, same_place),
+              GlobalDescriptorExtractor::similarity(image, other_place) +
+                  0.2f);
+    // Deterministic.
+    EXPECT_EQ(extractor.compute(descriptors), image);
+  }
+}
+
+TEST_F(GlobalDescriptorFixture, NoFeatures) {
+  GlobalDescriptorExtractor extractor(centers_, bit_means_, 32);
+  const std::vector<float> descriptor = extractor.compute(cv::Mat());
+  ASSERT_EQ(descriptor.size(), 32u);
+  EXPECT_EQ(norm(descriptor), 0.0f);
+}
+
+}  // namespace VIO
@@ -0,0 +1,89 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testGpuOrbExtractor.cpp
+ * @brief  test GpuOrbExtractor against OpenCV's CPU ORB
+ * @author Antoni Rosinol
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/features2d.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "kimera-vio/loopclosure/GpuOrbExtractor.h"
+
+namespace VIO {
+
+namespace {
+
+//! Textured image: blurred noise with a few bright rectangles.
+cv::Mat texturedImage() {
+  cv::RNG rng(5);
+  cv::Mat img(480, 752, CV_8UC1);
+  rng.fill(img, cv::RNG::UNIFORM, 0, 256);
+  cv::GaussianBlur(img, img, cv::Size(7, 7), 2.0);
+  for (int i = 0; i < 30; ++i) {
+    const cv::Point corner(rng.uniform(0, img.cols), rng.uniform(0, img.rows));
+    cv::rectangle(img,
+                  corner,
+                  corner + cv::Point(rng.uniform(10, 60), rng.uniform(10, 60)),
+                  cv::Scalar(rng.uniform(0, 256)),
+                  cv::FILLED);
+  }
+  return img;
+}
+
+}  // namespace
+
+TEST(GpuOrbExtractor, SameOutputsAsCpuOrb) {
+  if (!GpuOrbExtractor::isAvailable()) {
+    GTEST_SKIP() << "No CUDA ORB available.";
+  }
+  LoopClosureDetectorParams params;
+  GpuOrbExtractor extractor(params);
+  const cv::Mat img = texturedImage();
+
+  std::vector<cv::KeyPoint> keypoints;
+  OrbDescriptor descriptors;
+  extractor.detectAndCompute(img, &keypoints, &descriptors);
+  // Same image again, reusing the pinned buffer.
+  std::vector<cv::KeyPoint> keypoints_again;
+  OrbDescriptor descriptors_again;
+  extractor.detectAndCompute(img, &keypoints_again, &descriptors_again);
+
+  std::vector<cv::KeyPoint> cpu_keypoints;
+  OrbDescriptor cpu_descriptors;
+  cv::ORB::create(params.nfeatures_)
+      ->detectAndCompute(img, cv::noArray(), cpu_keypoints, cpu_descriptors);
+
+  // The CUDA implementation differs in details: only compare the formats.
+  ASSERT_FALSE(keypoints.empty());
+  EXPECT_LE(keypoints.size(), static_cast<size_t>(params.nfeatures_));
+  EXPECT_EQ(static_cast<size_t>(descriptors.rows), keypoints.size());
+  EXPECT_EQ(descriptors.cols, cpu_descriptors.cols);
+  EXPECT_EQ(descriptors.type(), cpu_descriptors.type());
+  EXPECT_EQ(keypoints_again.size(), keypoints.size());
+  EXPECT_EQ(cv::norm(descriptors, descriptors_again, cv::NORM_HAMMING), 0.0);
+}
+
+TEST(GpuOrbExtractor, DisabledWithoutCuda) {
+  if (GpuOrbExtractor::isAvailable()) {
+    GTEST_SKIP() << "CUDA ORB available.";
+  }
+  LoopClosureDetectorParams params;
+  EXPECT_DEATH(GpuOrbExtractor extractor(params), "GpuOrbExtractor");
+}
+
+}  // namespace VIO
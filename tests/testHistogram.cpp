@@ -0,0 +1,98 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testHistogram.cpp
+ * @brief  test Histogram streaming updates against cv::calcHist
+ * @author Antoni Rosinol
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <array>
+#include <vector>
+
+#include "kimera-vio/utils/Histogram.h"
+
+namespace VIO {
+
+namespace {
+
+void expectEqualHistograms(const cv::Mat& expected, const cv::Mat& actual) {
+  ASSERT_TRUE(expected.size == actual.size);
+  ASSERT_EQ(expected.type(), actual.type());
+  EXPECT_EQ(cv::norm(expected, actual, cv::NORM_INF), 0.0);
+}
+
+}  // namespace
+
+TEST(testHistogram, StreamingSamples1D) {
+  const std::vector<std::array<float, 2>> ranges = {{{-0.5f, 3.0f}}};
+  const Histogram hist(1, {0}, cv::Mat(), 1, {50}, ranges);
+  cv::RNG rng(1);
+  cv::Mat z_components(1, 0, CV_32F);
+  Histogram streaming_hist = hist;
+  streaming_hist.resetHistogram();
+  for (size_t i = 0u; i < 1000u; i++) {
+    // Some values out of range.
+    const float z = rng.uniform(-1.0f, 3.5f);
+    z_components.push_back(z);
+    streaming_hist.addSample(z);
+  }
+  Histogram batch_hist = hist;
+  batch_hist.calculateHistogram(z_components);
+  expectEqualHistograms(batch_hist.getHistogram(),
+                        streaming_hist.getHistogram());
+
+  // Removing samples leaves the histogram of the remaining ones.
+  cv::Mat remaining_z_components(1, 0, CV_32F);
+  for (int i = 0; i < z_components.rows; i++) {
+    if (i % 2 == 0) {
+      streaming_hist.addSample(z_components.at<float>(i), -1.0f);
+    } else {
+      remaining_z_components.push_back(z_components.at<float>(i));
+    }
+  }
+  batch_hist.calculateHistogram(remaining_z_components);
+  expectEqualHistograms(batch_hist.getHistogram(),
+                        streaming_hist.getHistogram());
+}
+
+TEST(testHistogram, StreamingSamples2D) {
+  const std::array<float, 2> theta_range = {
+      {0.0f, static_cast<float>(CV_PI)}};
+  const std::array<float, 2> distance_range = {{-6.0f, 6.0f}};
+  const std::vector<std::array<float, 2>> ranges = {theta_range,
+                                                    distance_range};
+  const Histogram hist(1, {0, 1}, cv::Mat(), 2, {40, 40}, ranges);
+  cv::RNG rng(2);
+  cv::Mat walls(0, 0, CV_32FC2);
+  Histogram streaming_hist = hist;
+  streaming_hist.resetHistogram();
+  for (size_t i = 0u; i < 1000u; i++) {
+    const cv::Point2f wall(rng.uniform(0.0f, static_cast<float>(CV_PI)),
+                           rng.uniform(-7.0f, 7.0f));
+    walls.push_back(wall);
+    streaming_hist.addSample(wall);
+  }
+  Histogram batch_hist = hist;
+  batch_hist.calculateHistogram(walls);
+  expectEqualHistograms(batch_hist.getHistogram(),
+                        streaming_hist.getHistogram());
+
+  // Copies keep the bins.
+  const Histogram copied_hist = streaming_hist;
+  expectEqualHistograms(streaming_hist.getHistogram(),
+                        copied_hist.getHistogram());
+  streaming_hist.resetHistogram();
+  EXPECT_EQ(cv::countNonZero(streaming_hist.getHistogram()), 0);
+}
+
+}  // namespace VIO
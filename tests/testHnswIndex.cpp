@@ -0,0 +1,118 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testHnswIndex.cpp
+ * @brief  test HnswIndex against brute force search
+ * @author Antoni Rosinol
+ */
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/loopclosure/HnswIndex.h"
+
+namespace VIO {
+
+namespace {
+constexpr size_t kDim = 32u;
+
+std::vector<float> randomUnitVector(std::mt19937* rng) {
+  std::normal_distribution<float> normal;
+  std::vector<float> vector(kDim);
+  float norm = 0.0f;
+  for (float& value : vector) {
+    value = normal(*rng);
+    norm += value * value;
+  }
+  for (float& value : vector) value /= std::sqrt(norm);
+  return vector;
+}
+
+//! The vector plus a small perturbation, normalized.
+std::vector<float> perturb(const std::vector<float>& vector,
+                           std::mt19937* rng) {
+  std::vector<float> noise = randomUnitVector(rng);
+  float norm = 0.0f;
+  for (size_t i = 0u; i < kDim; ++i) {
+    noise[i] = vector[i] + 0.1f * noise[i];
+    norm += noise[i] * noise[i];
+  }
+  for (float& value : noise) value /= std::sqrt(norm);
+  return noise;
+}
+}  // namespace
+
+TEST(testHnswIndex, EmptyIndex) {
+  HnswIndex index(kDim, HnswParams());
+  std::mt19937 rng(3u);
+  std::vector<HnswIndex::Result> results;
+  index.search(randomUnitVector(&rng), 5u, 100u, &results);
+  EXPECT_TRUE(results.empty());
+  EXPECT_EQ(index.size(), 0u);
+}
+
+TEST(testHnswIndex, FindsPerturbedEntries) {
+  static constexpr size_t kNrEntries = 3000u;
+  static constexpr size_t kNrQueries = 200u;
+  std::mt19937 rng(7u);
+  HnswIndex index(kDim, HnswParams());
+  std::vector<std::vector<float>> entries;
+  for (size_t i = 0u; i < kNrEntries; ++i) {
+    entries.push_back(randomUnitVector(&rng));
+    // Labels need not be the insertion order.
+    index.add(static_cast<HnswIndex::Label>(2u * i), entries.back());
+  }
+  EXPECT_EQ(index.size(), kNrEntries);
+
+  size_t nr_found = 0u;
+  std::vector<HnswIndex::Result> results;
+  for (size_t q = 0u; q < kNrQueries; ++q) {
+    const size_t i = (q * 7919u) % kNrEntries;
+    index.search(perturb(entries[i], &rng), 10u, 2u * kNrEntries, &results);
+    ASSERT_EQ(results.size(), 10u);
+    for (size_t r = 1u; r < results.size(); ++r) {
+      EXPECT_GE(results[r - 1u].similarity, results[r].similarity);
+    }
+    if (results[0].label == 2u * i) ++nr_found;
+  }
+  // Approximate search: allow a few misses.
+  EXPECT_GE(nr_found, kNrQueries * 95u / 100u);
+}
+
+TEST(testHnswIndex, OnlyLabelsBelowMaxLabel) {
+  std::mt19937 rng(11u);
+  HnswIndex index(kDim, HnswParams());
+  std::vector<std::vector<float>> entries;
+  for (HnswIndex::Label label = 0u; label < 500u; ++label) {
+    entries.push_back(randomUnitVector(&rng));
+    index.add(label, entries.back());
+  }
+
+  // The closest entry is excluded, the others are still found.
+  std::vector<HnswIndex::Result> results;
+  index.search(entries[450], 20u, 400u, &results);
+  ASSERT_EQ(results.size(), 20u);
+  for (const HnswIndex::Result& result : results) {
+    EXPECT_LT(result.label, 400u);
+  }
+  index.search(entries[100], 1u, 400u, &results);
+  ASSERT_EQ(results.size(), 1u);
+  EXPECT_EQ(results[0].label, 100u);
+  EXPECT_NEAR(results[0].similarity, 1.0f, 1e-5f);
+
+  index.search(entries[100], 10u, 0u, &results);
+  EXPECT_TRUE(results.empty());
+}
+
+}  // namespace VIO
@@ -0,0 +1,78 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testImageBufferPool.cpp
+ * @brief  test ImageBufferPool
+ * @author Antoni Rosinol
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <opencv2/core/core.hpp>
+
+#include "kimera-vio/utils/ImageBufferPool.h"
+#include "kimera-vio/utils/UtilsOpenCV.h"
+
+DECLARE_string(test_data_path);
+
+namespace VIO {
+
+TEST(testImageBufferPool, BuffersAreRecycled) {
+  ImageBufferPool pool(2u);
+  const uchar* first_data = nullptr;
+  {
+    cv::Mat img;
+    img.allocator = &pool;
+    img.create(480, 752, CV_8UC1);
+    img.setTo(cv::Scalar(7));
+    first_data = img.data;
+    EXPECT_EQ(pool.getNrAllocatedBuffers(), 1u);
+
+    // Shallow copies keep the buffer alive.
+    cv::Mat copy = img;
+    img.release();
+    EXPECT_EQ(pool.getNrFreeBuffers(), 0u);
+    EXPECT_EQ(copy.at<uchar>(0, 0), 7u);
+  }
+  EXPECT_EQ(pool.getNrFreeBuffers(), 1u);
+
+  // Same size: the buffer is reused, no new allocation.
+  cv::Mat img;
+  img.allocator = &pool;
+  img.create(480, 752, CV_8UC1);
+  EXPECT_EQ(img.data, first_data);
+  EXPECT_EQ(pool.getNrAllocatedBuffers(), 1u);
+  EXPECT_EQ(pool.getNrFreeBuffers(), 0u);
+
+  // Different size: new allocation.
+  cv::Mat other;
+  other.allocator = &pool;
+  other.create(10, 10, CV_8UC1);
+  EXPECT_EQ(pool.getNrAllocatedBuffers(), 2u);
+}
+
+TEST(testImageBufferPool, ReadImageIntoPool) {
+  ImageBufferPool pool;
+  const std::string img_path =
+      FLAGS_test_data_path + "/ForStereoFrame/left_img_0.png";
+  const cv::Mat expected = UtilsOpenCV::ReadAndConvertToGrayScale(img_path);
+  {
+    const cv::Mat img =
+        UtilsOpenCV::ReadAndConvertToGrayScale(img_path, false, &pool);
+    ASSERT_FALSE(img.empty());
+    EXPECT_TRUE(UtilsOpenCV::compareCvMatsUpToTol(img, expected, 0));
+  }
+  // Either the decoded image or none (older OpenCV versions decode with
+  // their own allocator) went back to the pool.
+  EXPECT_LE(pool.getNrFreeBuffers(), 1u);
+}
+
+}  // namespace VIO
@@ -0,0 +1,81 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testImagePrefetcher.cpp
+ * @brief  test ImagePrefetcher
+ * @author Antoni Rosinol
+ */
+
+#include <atomic>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <opencv2/core/core.hpp>
+
+#include "kimera-vio/dataprovider/ImagePrefetcher.h"
+
+namespace VIO {
+
+namespace {
+//! Fake loader: a 1x1 image whose only pixel is the frame id.
+std::vector<cv::Mat> loadFakeImage(const FrameId& k,
+                                   std::atomic<FrameId>* max_loaded_k) {
+  FrameId prev = max_loaded_k->load();
+  while (prev < k && !max_loaded_k->compare_exchange_weak(prev, k)) {
+  }
+  return {cv::Mat(1, 1, CV_32SC1, cv::Scalar(static_cast<int>(k)))};
+}
+}  // namespace
+
+TEST(testImagePrefetcher, FramesAreReturnedInOrder) {
+  std::atomic<FrameId> max_loaded_k(0u);
+  const size_t lookahead = 4u;
+  ImagePrefetcher prefetcher(
+      [&max_loaded_k](const FrameId& k) {
+        return loadFakeImage(k, &max_loaded_k);
+      },
+      0u,
+      50u,
+      3u,
+      lookahead);
+  for (FrameId k = 0u; k < 50u; ++k) {
+    std::vector<cv::Mat> images = prefetcher.get(k);
+    ASSERT_EQ(images.size(), 1u);
+    EXPECT_EQ(images[0].at<int>(0, 0), static_cast<int>(k));
+    // Workers never load further than the lookahead.
+    EXPECT_LT(max_loaded_k.load(), k + lookahead + 1u);
+  }
+}
+
+TEST(testImagePrefetcher, SkippedFramesAreDropped) {
+  std::atomic<FrameId> max_loaded_k(0u);
+  ImagePrefetcher prefetcher(
+      [&max_loaded_k](const FrameId& k) {
+        return loadFakeImage(k, &max_loaded_k);
+      },
+      10u,
+      100u,
+      2u,
+      8u);
+  for (FrameId k = 10u; k < 100u; k += 7u) {
+    std::vector<cv::Mat> images = prefetcher.get(k);
+    ASSERT_EQ(images.size(), 1u);
+    EXPECT_EQ(images[0].at<int>(0, 0), static_cast<int>(k));
+  }
+  prefetcher.shutdown();
+  // Still works after shutdown, synchronously.
+  std::vector<cv::Mat> images = prefetcher.get(100u);
+  ASSERT_EQ(images.size(), 1u);
+  EXPECT_EQ(images[0].at<int>(0, 0), 100);
+}
+
+}  // namespace VIO
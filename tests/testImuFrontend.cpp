@@ -16,10 +16,12 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include "kimera-vio/frontend/FrontendInputPacketBase.h"
 #include "kimera-vio/imu-frontend/ImuFrontend-definitions.h"
 #include "kimera-vio/imu-frontend/ImuFrontend.h"
 #include "kimera-vio/imu-frontend/ImuFrontendParams.h"
 #include "kimera-vio/utils/ThreadsafeImuBuffer.h"
+#include "kimera-vio/utils/UtilsNumerical.h"
 
 namespace VIO {
 
@@ -157,6 +159,122 @@ TEST(ImuFrontend, ResetPreintegration) {
   EXPECT_TRUE(!reseted_pim->equals(*curr_pim, 1e-8));
 }
 
+/* -------------------------------------------------------------------------- */
+TEST(ImuFrontend, PreintegrateMergedDroppedPacket) {
+  // Merging the IMU of a dropped Frontend packet in the next packet must
+  // give the same preintegration as processing both packets.
+  ImuParams imu_params;
+  imu_params.acc_random_walk_ = 1.0;
+  imu_params.acc_noise_density_ = 1.0;
+  imu_params.gyro_random_walk_ = 1.0;
+  imu_params.gyro_noise_density_ = 1.0;
+  imu_params.n_gravity_ << 0.0, 0.0, -9.81;
+  imu_params.imu_integration_sigma_ = 1.0;
+  ImuBias imu_bias(Vector3(0.1, 0.2, 0.3), Vector3(0.01, 0.02, 0.03));
+
+  // The last stamp of a packet is repeated as first stamp of the next one.
+  ImuStampS stamps_dropped(1, 3);
+  stamps_dropped << 1000000, 2000000, 3000000;
+  ImuAccGyrS accgyrs_dropped = ImuAccGyrS::Random(6, 3);
+  ImuStampS stamps_next(1, 3);
+  stamps_next << 3000000, 4000000, 5000000;
+  ImuAccGyrS accgyrs_next = ImuAccGyrS::Random(6, 3);
+  accgyrs_next.col(0) = accgyrs_dropped.col(2);
+  FrontendInputPacketBase dropped(3000000, stamps_dropped, accgyrs_dropped);
+  FrontendInputPacketBase next(5000000, stamps_next, accgyrs_next);
+
+  ImuFrontend imu_frontend(imu_params, imu_bias);
+  imu_frontend.preintegrateImuMeasurements(dropped.imu_stamps_,
+                                           dropped.imu_accgyrs_);
+  auto expected_pim = imu_frontend.preintegrateImuMeasurements(
+      next.imu_stamps_, next.imu_accgyrs_);
+
+  next.prependImuMeasurements(dropped);
+  ASSERT_EQ(next.imu_stamps_.cols(), 5);
+  EXPECT_EQ(next.imu_stamps_(0), 1000000);
+  EXPECT_EQ(next.imu_stamps_(4), 5000000);
+  imu_frontend.resetIntegrationWithCachedBias();
+  auto merged_pim = imu_frontend.preintegrateImuMeasurements(
+      next.imu_stamps_, next.imu_accgyrs_);
+  EXPECT_TRUE(merged_pim->equals(*expected_pim, 1e-8));
+}
+
+/* -------------------------------------------------------------------------- */
+TEST(ImuFrontend, PreintegrateBatchMatchesSampleBySample) {
+  // Preintegrating a whole batch must give the same PIM as preintegrating its
+  // measurements one interval at a time, for both preintegration types.
+  ImuParams imu_params;
+  imu_params.acc_random_walk_ = 1.0;
+  imu_params.acc_noise_density_ = 1.0;
+  imu_params.gyro_random_walk_ = 1.0;
+  imu_params.gyro_noise_density_ = 1.0;
+  imu_params.n_gravity_ << 0.0, 0.0, -9.81;
+  imu_params.imu_integration_sigma_ = 1.0;
+  ImuBias imu_bias(Vector3(0.1, 0.2, 0.3), Vector3(0.01, 0.02, 0.03));
+
+  static constexpr int kNrMeasurements = 50;
+  ImuStampS imu_stamps(1, kNrMeasurements);
+  for (int i = 0; i < kNrMeasurements; ++i) {
+    imu_stamps(i) = 1000000000 + i * 5000000 + (i % 3) * 100000;
+  }
+  ImuAccGyrS imu_accgyrs = ImuAccGyrS::Random(6, kNrMeasurements);
+
+  for (const ImuPreintegrationType& type :
+       {ImuPreintegrationType::kPreintegratedCombinedMeasurements,
+        ImuPreintegrationType::kPreintegratedImuMeasurements}) {
+    imu_params.imu_preintegration_type_ = type;
+    ImuFrontend batch_imu_frontend(imu_params, imu_bias);
+    auto batch_pim =
+        batch_imu_frontend.preintegrateImuMeasurements(imu_stamps, imu_accgyrs);
+
+    ImuFrontend imu_frontend(imu_params, imu_bias);
+    ImuFrontend::PimPtr expected_pim;
+    for (int i = 0; i < kNrMeasurements - 1; ++i) {
+      expected_pim = imu_frontend.preintegrateImuMeasurements(
+          imu_stamps.middleCols(i, 2), imu_accgyrs.middleCols(i, 2));
+    }
+    ASSERT_TRUE(expected_pim);
+    EXPECT_NEAR(batch_pim->deltaTij(), expected_pim->deltaTij(), 1e-12);
+    EXPECT_TRUE(batch_pim->equals(*expected_pim, 1e-8));
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+TEST(ImuFrontend, PreintegrateGyroMatchesAhrs) {
+  // The gyro preintegration must match gtsam's AHRS preintegration, also for
+  // measurements equal to the bias (zero rotation increments).
+  ImuParams imu_params;
+  imu_params.acc_random_walk_ = 1.0;
+  imu_params.acc_noise_density_ = 1.0;
+  imu_params.gyro_random_walk_ = 1.0;
+  imu_params.gyro_noise_density_ = 1.0;
+  imu_params.n_gravity_ << 0.0, 0.0, -9.81;
+  imu_params.imu_integration_sigma_ = 1.0;
+  const Vector3 bias_gyr(0.01, -0.02, 0.03);
+  ImuBias imu_bias(Vector3(0.1, 0.2, 0.3), bias_gyr);
+  ImuFrontend imu_frontend(imu_params, imu_bias);
+
+  static constexpr int kNrMeasurements = 100;
+  ImuStampS imu_stamps(1, kNrMeasurements);
+  for (int i = 0; i < kNrMeasurements; ++i) {
+    imu_stamps(i) = 1000000000 + i * 5000000;
+  }
+  ImuAccGyrS imu_accgyrs = 2.0 * ImuAccGyrS::Random(6, kNrMeasurements);
+  imu_accgyrs.block<3, 1>(3, 10) = bias_gyr;
+  imu_accgyrs.block<3, 1>(3, 11) = bias_gyr + Vector3(1e-9, 0.0, -1e-9);
+
+  gtsam::PreintegratedAhrsMeasurements expected_pim(bias_gyr,
+                                                    gtsam::Matrix3::Identity());
+  for (int i = 0; i < kNrMeasurements - 1; ++i) {
+    expected_pim.integrateMeasurement(
+        imu_accgyrs.block<3, 1>(3, i),
+        UtilsNumerical::NsecToSec(imu_stamps(i + 1) - imu_stamps(i)));
+  }
+  const gtsam::Rot3 delta_R =
+      imu_frontend.preintegrateGyroMeasurements(imu_stamps, imu_accgyrs);
+  EXPECT_TRUE(gtsam::assert_equal(expected_pim.deltaRij(), delta_R, 1e-9));
+}
+
 /* TODO(Toni): tests left:
 TEST(ImuFrontend, PreintegrateEmptyImuData) {
 }
@@ -0,0 +1,245 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testImuPropagator.cpp
+ * @brief  Unit tests ImuPropagator class' functionality.
+ * @author Antoni Rosinol
+ */
+
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/imu-frontend/ImuPropagator.h"
+#include "kimera-vio/utils/UtilsNumerical.h"
+
+namespace VIO {
+
+class ImuPropagatorFixture : public ::testing::Test {
+ public:
+  ImuPropagatorFixture() : imu_params_(), propagated_states_() {
+    imu_params_.acc_random_walk_ = 1.0e-3;
+    imu_params_.acc_noise_density_ = 1.0e-2;
+    imu_params_.gyro_random_walk_ = 1.0e-4;
+    imu_params_.gyro_noise_density_ = 1.0e-3;
+    imu_params_.n_gravity_ << 0.0, 0.0, -9.81;
+    imu_params_.imu_integration_sigma_ = 1.0e-8;
+    imu_params_.imu_preintegration_type_ =
+        ImuPreintegrationType::kPreintegratedImuMeasurements;
+  }
+
+ protected:
+  //! At rest or at constant velocity: the accelerometer only measures gravity.
+  ImuMeasurement constantVelocityMeasurement(const Timestamp& timestamp) const {
+    ImuAccGyr acc_gyr;
+    acc_gyr << 0.0, 0.0, 9.81, 0.0, 0.0, 0.0;
+    return ImuMeasurement(timestamp, acc_gyr);
+  }
+
+  void recordStates(ImuPropagator* imu_propagator) {
+    imu_propagator->registerPropagatedStateCallback(
+        [this](const VioNavStateTimestamped& state) {
+          propagated_states_.push_back(state);
+        });
+  }
+
+ protected:
+  static constexpr Timestamp kImuPeriodNs = 5000000;  // 200Hz
+  ImuParams imu_params_;
+  std::vector<VioNavStateTimestamped> propagated_states_;
+};
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ImuPropagatorFixture, NoOutputWithoutState) {
+  ImuPropagator imu_propagator(imu_params_, false);
+  recordStates(&imu_propagator);
+  for (Timestamp i = 1; i <= 10; ++i) {
+    imu_propagator.fillImuQueue(constantVelocityMeasurement(i * kImuPeriodNs));
+  }
+  EXPECT_EQ(imu_propagator.spinOnce(), 0u);
+  EXPECT_TRUE(propagated_states_.empty());
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ImuPropagatorFixture, ConstantVelocity) {
+  ImuPropagator imu_propagator(imu_params_, false);
+  recordStates(&imu_propagator);
+  const gtsam::Vector3 velocity(1.0, 0.0, 0.0);
+  for (Timestamp i = 1; i <= 4; ++i) {
+    imu_propagator.fillImuQueue(constantVelocityMeasurement(i * kImuPeriodNs));
+  }
+  // State in between IMU measurements: integration starts interpolated.
+  const Timestamp state_timestamp = 2 * kImuPeriodNs + kImuPeriodNs / 2;
+  imu_propagator.resetState(VioNavStateTimestamped(
+      state_timestamp, gtsam::Pose3(), velocity, ImuBias()));
+
+  // Reset outputs a single state, at the newest IMU measurement.
+  EXPECT_EQ(imu_propagator.spinOnce(), 1u);
+  ASSERT_EQ(propagated_states_.size(), 1u);
+  EXPECT_EQ(propagated_states_.back().timestamp_, 4 * kImuPeriodNs);
+
+  // Then one state per new IMU measurement.
+  for (Timestamp i = 5; i <= 20; ++i) {
+    imu_propagator.fillImuQueue(constantVelocityMeasurement(i * kImuPeriodNs));
+  }
+  EXPECT_EQ(imu_propagator.spinOnce(), 16u);
+  ASSERT_EQ(propagated_states_.size(), 17u);
+  for (size_t i = 0u; i < propagated_states_.size(); ++i) {
+    const VioNavStateTimestamped& state = propagated_states_[i];
+    EXPECT_EQ(state.timestamp_, static_cast<Timestamp>(i + 4) * kImuPeriodNs);
+    const double dt =
+        UtilsNumerical::NsecToSec(state.timestamp_ - state_timestamp);
+    EXPECT_TRUE(gtsam::assert_equal(
+        gtsam::Vector3(velocity * dt), state.pose_.translation(), 1e-6));
+    EXPECT_TRUE(gtsam::assert_equal(velocity, state.velocity_, 1e-6));
+  }
+  EXPECT_EQ(imu_propagator.getNrPropagatedStates(), 17u);
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ImuPropagatorFixture, ResetWithNewState) {
+  ImuPropagator imu_propagator(imu_params_, false);
+  recordStates(&imu_propagator);
+  for (Timestamp i = 1; i <= 10; ++i) {
+    imu_propagator.fillImuQueue(constantVelocityMeasurement(i * kImuPeriodNs));
+  }
+  imu_propagator.resetState(VioNavStateTimestamped(
+      kImuPeriodNs, gtsam::Pose3(), gtsam::Vector3::Zero(), ImuBias()));
+  EXPECT_EQ(imu_propagator.spinOnce(), 1u);
+
+  // Newer Backend state, both newer IMU measurements and those since the
+  // state are integrated from it.
+  const gtsam::Pose3 new_pose(gtsam::Rot3(), gtsam::Point3(1.0, 2.0, 3.0));
+  for (Timestamp i = 11; i <= 12; ++i) {
+    imu_propagator.fillImuQueue(constantVelocityMeasurement(i * kImuPeriodNs));
+  }
+  imu_propagator.resetState(VioNavStateTimestamped(
+      8 * kImuPeriodNs, new_pose, gtsam::Vector3::Zero(), ImuBias()));
+  EXPECT_EQ(imu_propagator.spinOnce(), 1u);
+  ASSERT_EQ(propagated_states_.size(), 2u);
+  EXPECT_EQ(propagated_states_.back().timestamp_, 12 * kImuPeriodNs);
+  EXPECT_TRUE(gtsam::assert_equal(new_pose.translation(),
+                                  propagated_states_.back().pose_.translation(),
+                                  1e-6));
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ImuPropagatorFixture, StateWaitsForImu) {
+  ImuPropagator imu_propagator(imu_params_, false);
+  recordStates(&imu_propagator);
+  for (Timestamp i = 1; i <= 2; ++i) {
+    imu_propagator.fillImuQueue(constantVelocityMeasurement(i * kImuPeriodNs));
+  }
+  // The IMU has not reached the state yet.
+  imu_propagator.resetState(VioNavStateTimestamped(
+      3 * kImuPeriodNs, gtsam::Pose3(), gtsam::Vector3::Zero(), ImuBias()));
+  EXPECT_EQ(imu_propagator.spinOnce(), 0u);
+  for (Timestamp i = 3; i <= 4; ++i) {
+    imu_propagator.fillImuQueue(constantVelocityMeasurement(i * kImuPeriodNs));
+  }
+  EXPECT_EQ(imu_propagator.spinOnce(), 1u);
+  ASSERT_EQ(propagated_states_.size(), 1u);
+  EXPECT_EQ(propagated_states_.back().timestamp_, 4 * kImuPeriodNs);
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ImuPropagatorFixture, ImuTimeOffset) {
+  ImuPropagator imu_propagator(imu_params_, false);
+  recordStates(&imu_propagator);
+  // t_imu = t_cam + offset.
+  const Timestamp imu_time_offset = 100 * kImuPeriodNs;
+  imu_propagator.setImuTimeOffset(imu_time_offset);
+  for (Timestamp i = 1; i <= 4; ++i) {
+    imu_propagator.fillImuQueue(
+        constantVelocityMeasurement(imu_time_offset + i * kImuPeriodNs));
+  }
+  imu_propagator.resetState(VioNavStateTimestamped(
+      2 * kImuPeriodNs, gtsam::Pose3(), gtsam::Vector3::Zero(), ImuBias()));
+  EXPECT_EQ(imu_propagator.spinOnce(), 1u);
+  ASSERT_EQ(propagated_states_.size(), 1u);
+  // Output in the camera clock.
+  EXPECT_EQ(propagated_states_.back().timestamp_, 4 * kImuPeriodNs);
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ImuPropagatorFixture, BiasFirstOrderCorrection) {
+  // Rotating and accelerating, with a constant measurement so that both the
+  // correction and the reintegration integrate exactly the same motion.
+  ImuAccGyr acc_gyr;
+  acc_gyr << 0.2, 0.1, 9.81, 0.05, -0.02, 0.3;
+  ImuParams corrected_params = imu_params_;
+  corrected_params.bias_first_order_correction_ = true;
+  ImuPropagator corrected_propagator(corrected_params, false);
+  ImuPropagator reintegrated_propagator(imu_params_, false);
+  std::vector<VioNavStateTimestamped> corrected_states;
+  corrected_propagator.registerPropagatedStateCallback(
+      [&corrected_states](const VioNavStateTimestamped& state) {
+        corrected_states.push_back(state);
+      });
+  recordStates(&reintegrated_propagator);
+
+  const auto fill_imu = [&](const Timestamp& first, const Timestamp& last) {
+    for (Timestamp i = first; i <= last; ++i) {
+      const ImuMeasurement imu_measurement(i * kImuPeriodNs, acc_gyr);
+      corrected_propagator.fillImuQueue(imu_measurement);
+      reintegrated_propagator.fillImuQueue(imu_measurement);
+    }
+  };
+  const auto reset_state = [&](const VioNavStateTimestamped& state) {
+    corrected_propagator.resetState(state);
+    reintegrated_propagator.resetState(state);
+    corrected_propagator.spinOnce();
+    reintegrated_propagator.spinOnce();
+  };
+
+  fill_imu(1, 10);
+  reset_state(VioNavStateTimestamped(
+      kImuPeriodNs, gtsam::Pose3(), gtsam::Vector3(1.0, 0.0, 0.0), ImuBias()));
+  fill_imu(11, 20);
+  corrected_propagator.spinOnce();
+  reintegrated_propagator.spinOnce();
+  EXPECT_EQ(corrected_propagator.getNrReintegrations(), 1u);
+
+  // Small bias change, in between IMU measurements.
+  const VioNavStateTimestamped new_state(
+      12 * kImuPeriodNs + kImuPeriodNs / 2,
+      gtsam::Pose3(gtsam::Rot3::RzRyRx(0.01, -0.02, 0.1),
+                   gtsam::Point3(0.1, 0.05, -0.02)),
+      gtsam::Vector3(1.1, 0.1, 0.0),
+      ImuBias(gtsam::Vector3(0.01, -0.01, 0.02),
+              gtsam::Vector3(0.001, 0.0, -0.001)));
+  reset_state(new_state);
+  EXPECT_EQ(corrected_propagator.getNrBiasCorrections(), 1u);
+  EXPECT_EQ(corrected_propagator.getNrReintegrations(), 1u);
+  EXPECT_EQ(reintegrated_propagator.getNrReintegrations(), 2u);
+  ASSERT_FALSE(corrected_states.empty());
+  ASSERT_FALSE(propagated_states_.empty());
+  const VioNavStateTimestamped& corrected = corrected_states.back();
+  const VioNavStateTimestamped& reintegrated = propagated_states_.back();
+  EXPECT_EQ(corrected.timestamp_, 20 * kImuPeriodNs);
+  EXPECT_EQ(reintegrated.timestamp_, 20 * kImuPeriodNs);
+  EXPECT_TRUE(gtsam::assert_equal(reintegrated.pose_, corrected.pose_, 1e-5));
+  EXPECT_TRUE(
+      gtsam::assert_equal(reintegrated.velocity_, corrected.velocity_, 1e-5));
+
+  // A large bias change integrates again.
+  fill_imu(21, 25);
+  corrected_propagator.spinOnce();
+  reset_state(VioNavStateTimestamped(
+      22 * kImuPeriodNs,
+      gtsam::Pose3(),
+      gtsam::Vector3::Zero(),
+      ImuBias(gtsam::Vector3(0.5, 0.0, 0.0), gtsam::Vector3::Zero())));
+  EXPECT_EQ(corrected_propagator.getNrBiasCorrections(), 1u);
+  EXPECT_EQ(corrected_propagator.getNrReintegrations(), 2u);
+}
+
+}  // namespace VIO
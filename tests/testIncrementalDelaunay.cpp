@@ -0,0 +1,209 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testIncrementalDelaunay.cpp
+ * @brief  test the incremental 2D Delaunay triangulation
+ * @author Antoni Rosinol
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <opencv2/imgproc.hpp>
+
+#include "kimera-vio/mesh/IncrementalDelaunay.h"
+#include "kimera-vio/utils/Timer.h"
+
+namespace VIO {
+
+namespace {
+
+using Vertices =
+    std::vector<std::pair<IncrementalDelaunay::VertexId, cv::Point2f>>;
+
+const cv::Size kImgSize(752, 480);
+
+cv::Point2f randomPoint(cv::RNG* rng) {
+  return cv::Point2f(rng->uniform(0.f, static_cast<float>(kImgSize.width)),
+                     rng->uniform(0.f, static_cast<float>(kImgSize.height)));
+}
+
+//! Tracks the vertices a frame further: some are lost, the others move by a
+//! few pixels (a few jump far away), and new ones replace the lost ones.
+Vertices track(const Vertices& vertices,
+               IncrementalDelaunay::VertexId* next_id,
+               cv::RNG* rng) {
+  const cv::Rect img_rect(cv::Point(0, 0), kImgSize);
+  Vertices tracked;
+  for (const auto& vertex : vertices) {
+    if (rng->uniform(0.0, 1.0) < 0.05) continue;
+    cv::Point2f point = vertex.second;
+    if (rng->uniform(0.0, 1.0) < 0.02) {
+      point = randomPoint(rng);
+    } else {
+      point += cv::Point2f(rng->uniform(-3.f, 3.f), rng->uniform(-3.f, 3.f));
+    }
+    if (!img_rect.contains(point)) continue;
+    tracked.emplace_back(vertex.first, point);
+  }
+  while (tracked.size() < vertices.size()) {
+    tracked.emplace_back((*next_id)++, randomPoint(rng));
+  }
+  return tracked;
+}
+
+//! Triangles as sorted vertex ids, to compare triangulations.
+std::vector<IncrementalDelaunay::TriangleVertexIds> getSortedTriangles(
+    const IncrementalDelaunay& delaunay) {
+  std::vector<IncrementalDelaunay::TriangleVertexIds> triangles;
+  delaunay.getTriangleList(&triangles);
+  for (auto& triangle : triangles) {
+    std::sort(triangle.begin(), triangle.end());
+  }
+  std::sort(triangles.begin(), triangles.end());
+  return triangles;
+}
+
+}  // namespace
+
+TEST(testIncrementalDelaunay, InsertMoveRemove) {
+  IncrementalDelaunay delaunay(kImgSize);
+  EXPECT_TRUE(delaunay.insert(0, cv::Point2f(10.f, 10.f)));
+  EXPECT_TRUE(delaunay.insert(1, cv::Point2f(100.f, 10.f)));
+  EXPECT_TRUE(delaunay.insert(2, cv::Point2f(10.f, 100.f)));
+  EXPECT_EQ(delaunay.getTriangleList().size(), 1u);
+
+  // Duplicated id, duplicated point, and point outside the image.
+  EXPECT_FALSE(delaunay.insert(0, cv::Point2f(50.f, 50.f)));
+  EXPECT_FALSE(delaunay.insert(3, cv::Point2f(100.f, 10.f)));
+  EXPECT_FALSE(delaunay.insert(4, cv::Point2f(-1.f, 10.f)));
+  EXPECT_EQ(delaunay.size(), 3u);
+
+  // Point on an edge.
+  EXPECT_TRUE(delaunay.insert(5, cv::Point2f(55.f, 10.f)));
+  EXPECT_EQ(delaunay.getTriangleList().size(), 2u);
+  EXPECT_TRUE(delaunay.isValid());
+
+  EXPECT_TRUE(delaunay.move(5, cv::Point2f(60.f, 60.f)));
+  EXPECT_TRUE(delaunay.move(2, cv::Point2f(200.f, 200.f)));
+  EXPECT_TRUE(delaunay.isValid());
+  EXPECT_TRUE(delaunay.remove(5));
+  EXPECT_FALSE(delaunay.remove(5));
+  EXPECT_EQ(delaunay.size(), 3u);
+  EXPECT_EQ(delaunay.getTriangleList().size(), 1u);
+  EXPECT_TRUE(delaunay.isValid());
+
+  // Moved outside the image: removed.
+  EXPECT_FALSE(delaunay.move(1, cv::Point2f(10.f, 1000.f)));
+  EXPECT_FALSE(delaunay.contains(1));
+  EXPECT_TRUE(delaunay.getTriangleList().empty());
+}
+
+TEST(testIncrementalDelaunay, DegenerateGrid) {
+  // Cocircular and collinear points.
+  IncrementalDelaunay delaunay(cv::Size(100, 100));
+  for (int i = 0; i < 10; ++i) {
+    for (int j = 0; j < 10; ++j) {
+      ASSERT_TRUE(delaunay.insert(10 * i + j,
+                                  cv::Point2f(5.f + 10.f * i, 5.f + 10.f * j)));
+    }
+  }
+  EXPECT_TRUE(delaunay.isValid());
+  EXPECT_EQ(delaunay.getTriangleList().size(), 2u * 9u * 9u);
+  for (int id = 0; id < 100; id += 3) EXPECT_TRUE(delaunay.remove(id));
+  EXPECT_TRUE(delaunay.isValid());
+  for (int id = 1; id < 100; id += 3) {
+    delaunay.move(
+        id, cv::Point2f(5.5f + 10.f * (id / 10), 5.f + 10.f * (id % 10)));
+  }
+  EXPECT_TRUE(delaunay.isValid());
+}
+
+TEST(testIncrementalDelaunay, SameAsFromScratch) {
+  cv::RNG rng(7);
+  IncrementalDelaunay::VertexId next_id = 0;
+  Vertices vertices;
+  for (int i = 0; i < 300; ++i) {
+    vertices.emplace_back(next_id++, randomPoint(&rng));
+  }
+
+  IncrementalDelaunay delaunay(kImgSize);
+  for (size_t frame = 0u; frame < 50u; ++frame) {
+    EXPECT_EQ(delaunay.update(vertices), vertices.size());
+    ASSERT_TRUE(delaunay.isValid()) << "Frame " << frame;
+
+    // Points in general position: same as triangulating them from scratch.
+    IncrementalDelaunay from_scratch(kImgSize);
+    from_scratch.update(vertices);
+    ASSERT_EQ(getSortedTriangles(delaunay), getSortedTriangles(from_scratch))
+        << "Frame " << frame;
+
+    // And as cv::Subdiv2D.
+    cv::Subdiv2D subdiv(cv::Rect(cv::Point(0, 0), kImgSize));
+    for (const auto& vertex : vertices) subdiv.insert(vertex.second);
+    std::vector<cv::Vec6f> subdiv_triangles;
+    subdiv.getTriangleList(subdiv_triangles);
+    const cv::Rect2f img_rect(cv::Point2f(0.f, 0.f), cv::Size2f(kImgSize));
+    const size_t nr_subdiv_triangles = std::count_if(
+        subdiv_triangles.begin(),
+        subdiv_triangles.end(),
+        [&img_rect](const cv::Vec6f& t) {
+          return img_rect.contains(cv::Point2f(t[0], t[1])) &&
+                 img_rect.contains(cv::Point2f(t[2], t[3])) &&
+                 img_rect.contains(cv::Point2f(t[4], t[5]));
+        });
+    EXPECT_EQ(delaunay.getTriangleList().size(), nr_subdiv_triangles);
+
+    vertices = track(vertices, &next_id, &rng);
+  }
+}
+
+TEST(testIncrementalDelaunay, UpdateTiming) {
+  cv::RNG rng(3);
+  for (const int& nr_vertices : {200, 800, 3200}) {
+    IncrementalDelaunay::VertexId next_id = 0;
+    Vertices vertices;
+    for (int i = 0; i < nr_vertices; ++i) {
+      vertices.emplace_back(next_id++, randomPoint(&rng));
+    }
+    IncrementalDelaunay delaunay(kImgSize);
+    delaunay.update(vertices);
+
+    const size_t nr_frames = 20u;
+    double incremental_us = 0.0;
+    double subdiv_us = 0.0;
+    for (size_t frame = 0u; frame < nr_frames; ++frame) {
+      vertices = track(vertices, &next_id, &rng);
+      auto tic = utils::Timer::tic();
+      delaunay.update(vertices);
+      const std::vector<cv::Vec6f> triangles = delaunay.getTriangleList();
+      incremental_us +=
+          utils::Timer::toc<std::chrono::microseconds>(tic).count();
+
+      tic = utils::Timer::tic();
+      cv::Subdiv2D subdiv(cv::Rect(cv::Point(0, 0), kImgSize));
+      for (const auto& vertex : vertices) subdiv.insert(vertex.second);
+      std::vector<cv::Vec6f> subdiv_triangles;
+      subdiv.getTriangleList(subdiv_triangles);
+      subdiv_us += utils::Timer::toc<std::chrono::microseconds>(tic).count();
+      EXPECT_FALSE(triangles.empty());
+    }
+    LOG(INFO) << "2D Delaunay of " << nr_vertices
+              << " keypoints per frame: incremental "
+              << incremental_us / nr_frames << " us, cv::Subdiv2D "
+              << subdiv_us / nr_frames << " us.";
+  }
+}
+
+}  // namespace VIO
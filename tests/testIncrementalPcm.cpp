@@ -0,0 +1,122 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testIncrementalPcm.cpp
+ * @brief  test IncrementalPcm on loop closures of a repeated square
+ * @author Antoni Rosinol
+ */
+
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/loopclosure/IncrementalPcm.h"
+
+namespace VIO {
+
+namespace {
+
+//! Square of side 10m, one keyframe per meter, driven three times.
+const size_t kNrKeyframesPerLap = 40u;
+const size_t kNrKeyframes = 3u * kNrKeyframesPerLap;
+gtsam::Pose3 groundTruthPose(const size_t& i) {
+  const gtsam::Rot3 turn = gtsam::Rot3::Yaw(M_PI / 2.0);
+  gtsam::Pose3 pose;
+  for (size_t j = 0u; j < i; ++j) {
+    pose = pose.compose(gtsam::Pose3(
+        (j + 1u) % 10u == 0u ? turn : gtsam::Rot3(), gtsam::Point3(1, 0, 0)));
+  }
+  return pose;
+}
+
+void addOdometry(IncrementalPcm* pcm) {
+  for (size_t i = 0u; i < kNrKeyframes; ++i) {
+    pcm->addOdometry(i, groundTruthPose(i));
+  }
+}
+
+gtsam::Pose3 trueLoopClosure(const size_t& ref, const size_t& cur) {
+  return groundTruthPose(ref).between(groundTruthPose(cur));
+}
+
+const gtsam::Pose3 kOutlier(gtsam::Rot3::Yaw(0.8), gtsam::Point3(3, -2, 0));
+
+}  // namespace
+
+TEST(testIncrementalPcm, rejectsInconsistentLoopClosures) {
+  IncrementalPcmParams params;
+  params.window_size = 10;
+  IncrementalPcm pcm(params);
+  addOdometry(&pcm);
+
+  // Loop closures of the second lap with the first, one outlier out of 4.
+  size_t nr_accepted = 0u;
+  for (size_t i = kNrKeyframesPerLap; i < 2u * kNrKeyframesPerLap; ++i) {
+    const size_t ref = i - kNrKeyframesPerLap;
+    const bool is_outlier = i % 4u == 0u && i != kNrKeyframesPerLap;
+    const std::vector<size_t> accepted = pcm.addLoopClosure(
+        ref, i, is_outlier ? kOutlier : trueLoopClosure(ref, i));
+    if (is_outlier) {
+      EXPECT_TRUE(accepted.empty());
+    } else {
+      EXPECT_EQ(accepted.size(), 1u);
+    }
+    nr_accepted += accepted.size();
+  }
+  EXPECT_EQ(pcm.getNumLC(), kNrKeyframesPerLap);
+  EXPECT_EQ(pcm.getNumLCInliers(), nr_accepted);
+  EXPECT_EQ(nr_accepted, kNrKeyframesPerLap - kNrKeyframesPerLap / 4u + 1u);
+}
+
+TEST(testIncrementalPcm, acceptsPendingLoopClosuresOnceConsistent) {
+  IncrementalPcmParams params;
+  params.window_size = 10;
+  params.min_clique_size = 2;
+  IncrementalPcm pcm(params);
+  addOdometry(&pcm);
+
+  // Alone, a loop closure is not enough.
+  EXPECT_TRUE(pcm.addLoopClosure(0u, 40u, trueLoopClosure(0u, 40u)).empty());
+  EXPECT_TRUE(pcm.addLoopClosure(1u, 41u, kOutlier).empty());
+  // The second inlier accepts the first one too.
+  EXPECT_EQ(pcm.addLoopClosure(2u, 42u, trueLoopClosure(2u, 42u)),
+            std::vector<size_t>({0u, 2u}));
+  EXPECT_EQ(pcm.getNumLCInliers(), 2u);
+}
+
+TEST(testIncrementalPcm, checksAreBoundedByWindowAndRegion) {
+  IncrementalPcmParams params;
+  params.window_size = 5;
+  IncrementalPcm pcm(params);
+  addOdometry(&pcm);
+  for (size_t i = kNrKeyframesPerLap; i < kNrKeyframes; ++i) {
+    const size_t ref = i - kNrKeyframesPerLap;
+    pcm.addLoopClosure(ref, i, trueLoopClosure(ref, i));
+  }
+  const size_t nr_loop_closures = kNrKeyframes - kNrKeyframesPerLap;
+  EXPECT_EQ(pcm.getNumLCInliers(), nr_loop_closures);
+  // Each loop closure is only checked against the previous window.
+  EXPECT_LE(pcm.getNumConsistencyChecks(), nr_loop_closures * 5u);
+
+  // Within 2.5m of its reference keyframe: mostly the 2 previous ones.
+  params.region_radius = 2.5;
+  IncrementalPcm regional_pcm(params);
+  addOdometry(&regional_pcm);
+  for (size_t i = kNrKeyframesPerLap; i < kNrKeyframes; ++i) {
+    const size_t ref = i - kNrKeyframesPerLap;
+    regional_pcm.addLoopClosure(ref, i, trueLoopClosure(ref, i));
+  }
+  EXPECT_EQ(regional_pcm.getNumLCInliers(), nr_loop_closures);
+  EXPECT_LT(regional_pcm.getNumConsistencyChecks(),
+            pcm.getNumConsistencyChecks());
+}
+
+}  // namespace VIO
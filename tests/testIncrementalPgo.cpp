@@ -0,0 +1,199 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testIncrementalPgo.cpp
+ * @brief  test IncrementalPgo, with and without odometry sparsification
+ * @author Antoni Rosinol
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <gtsam/inference/Symbol.h>
+#include <gtsam/nonlinear/Marginals.h>
+#include <gtsam/slam/BetweenFactor.h>
+#include <gtsam/slam/PriorFactor.h>
+
+#include "kimera-vio/loopclosure/IncrementalPgo.h"
+
+namespace VIO {
+
+namespace {
+
+const gtsam::SharedNoiseModel kNoise =
+    gtsam::noiseModel::Isotropic::Variance(6, 0.01);
+
+//! Square of side 10m, one keyframe per meter, ending where it started.
+const size_t kNrKeyframes = 41u;
+gtsam::Pose3 groundTruthPose(const size_t& i) {
+  const gtsam::Rot3 turn = gtsam::Rot3::Yaw(M_PI / 2.0);
+  gtsam::Pose3 pose;
+  for (size_t j = 0u; j < i; ++j) {
+    pose = pose.compose(gtsam::Pose3(
+        (j + 1u) % 10u == 0u ? turn : gtsam::Rot3(), gtsam::Point3(1, 0, 0)));
+  }
+  return pose;
+}
+
+//! Odometry of the square, with a small yaw drift at every step.
+void addSquareOdometry(IncrementalPgo* pgo, const double& yaw_drift) {
+  pgo->initialize(0u, groundTruthPose(0u), kNoise);
+  for (size_t i = 1u; i < kNrKeyframes; ++i) {
+    const gtsam::Pose3 prev_Pose_cur =
+        groundTruthPose(i - 1u).between(groundTruthPose(i));
+    pgo->addOdometry(
+        i,
+        prev_Pose_cur.compose(
+            gtsam::Pose3(gtsam::Rot3::Yaw(yaw_drift), gtsam::Point3())),
+        kNoise);
+  }
+}
+
+double positionError(const gtsam::Values& estimate, const size_t& i) {
+  return (estimate.at<gtsam::Pose3>(gtsam::Symbol(i)).translation() -
+          groundTruthPose(i).translation())
+      .norm();
+}
+
+}  // namespace
+
+TEST(testIncrementalPgo, odometryOnly) {
+  IncrementalPgoParams params;
+  params.enabled = true;
+  IncrementalPgo pgo(params);
+  addSquareOdometry(&pgo, 0.0);
+
+  EXPECT_EQ(pgo.size(), kNrKeyframes);
+  EXPECT_EQ(pgo.getNumNodes(), kNrKeyframes);
+  EXPECT_EQ(pgo.getNumLC(), 0u);
+  const gtsam::Values estimate = pgo.calculateEstimate();
+  ASSERT_EQ(estimate.size(), kNrKeyframes);
+  for (size_t i = 0u; i < kNrKeyframes; ++i) {
+    EXPECT_TRUE(estimate.at<gtsam::Pose3>(gtsam::Symbol(i))
+                    .equals(groundTruthPose(i), 1e-6));
+  }
+}
+
+TEST(testIncrementalPgo, sparsifiedOdometry) {
+  IncrementalPgoParams params;
+  params.enabled = true;
+  params.min_node_translation = 3.5;
+  params.min_node_rotation = M_PI;
+  IncrementalPgo pgo(params);
+  addSquareOdometry(&pgo, 0.0);
+
+  // A node every 4 or 5 keyframes (3.5m away from the previous node).
+  EXPECT_EQ(pgo.size(), kNrKeyframes);
+  EXPECT_LT(pgo.getNumNodes(), kNrKeyframes / 3u);
+  EXPECT_EQ(pgo.getFactors().size(), pgo.getNumNodes());
+  // Single keyframes, before the full estimate is cached.
+  for (size_t i = 0u; i < kNrKeyframes; ++i) {
+    EXPECT_TRUE(pgo.calculateEstimate(i).equals(groundTruthPose(i), 1e-6));
+  }
+  // All the keyframes still have their pose.
+  const gtsam::Values estimate = pgo.calculateEstimate();
+  ASSERT_EQ(estimate.size(), kNrKeyframes);
+  for (size_t i = 0u; i < kNrKeyframes; ++i) {
+    EXPECT_TRUE(estimate.at<gtsam::Pose3>(gtsam::Symbol(i))
+                    .equals(groundTruthPose(i), 1e-6));
+  }
+}
+
+TEST(testIncrementalPgo, sparsifiedOdometryCovariance) {
+  IncrementalPgoParams params;
+  params.enabled = true;
+  params.min_node_translation = 100.0;
+  params.min_node_rotation = M_PI;
+  params.max_keyframes_between_nodes = 2;
+  IncrementalPgo pgo(params);
+
+  // Turning odometry, of anisotropic noise: the lever arm of the first one
+  // matters for the second one.
+  const gtsam::Pose3 B0_Pose_B1(gtsam::Rot3::Ypr(0.5, -0.2, 0.1),
+                                gtsam::Point3(2.0, 0.5, -0.3));
+  const gtsam::Pose3 B1_Pose_B2(gtsam::Rot3::Ypr(-0.3, 0.1, 0.4),
+                                gtsam::Point3(1.0, -1.5, 0.2));
+  const gtsam::noiseModel::Diagonal::shared_ptr noise1 =
+      gtsam::noiseModel::Diagonal::Sigmas(
+          (gtsam::Vector6() << 0.01, 0.02, 0.05, 0.1, 0.2, 0.05).finished());
+  const gtsam::noiseModel::Diagonal::shared_ptr noise2 =
+      gtsam::noiseModel::Diagonal::Sigmas(
+          (gtsam::Vector6() << 0.03, 0.01, 0.02, 0.05, 0.1, 0.3).finished());
+  const gtsam::SharedNoiseModel prior_noise =
+      gtsam::noiseModel::Isotropic::Sigma(6, 1e-6);
+  pgo.initialize(0u, gtsam::Pose3(), prior_noise);
+  pgo.addOdometry(1u, B0_Pose_B1, noise1);
+  pgo.addOdometry(2u, B1_Pose_B2, noise2);
+  ASSERT_EQ(pgo.getNumNodes(), 2u);
+
+  // The factor composing both odometry measurements.
+  gtsam::BetweenFactor<gtsam::Pose3>::shared_ptr chain;
+  for (const auto& factor : pgo.getFactors()) {
+    const auto between =
+        boost::dynamic_pointer_cast<gtsam::BetweenFactor<gtsam::Pose3>>(
+            factor);
+    if (between) chain = between;
+  }
+  ASSERT_TRUE(chain);
+  EXPECT_EQ(chain->key1(), gtsam::Symbol(0u).key());
+  EXPECT_EQ(chain->key2(), gtsam::Symbol(2u).key());
+  EXPECT_TRUE(chain->measured().equals(B0_Pose_B1.compose(B1_Pose_B2)));
+  const auto gaussian =
+      boost::dynamic_pointer_cast<gtsam::noiseModel::Gaussian>(
+          chain->noiseModel());
+  ASSERT_TRUE(gaussian);
+
+  // Same as the marginal of the last keyframe of both factors, with the
+  // first one fixed.
+  gtsam::NonlinearFactorGraph graph;
+  graph.emplace_shared<gtsam::PriorFactor<gtsam::Pose3>>(
+      gtsam::Symbol(0u), gtsam::Pose3(), prior_noise);
+  graph.emplace_shared<gtsam::BetweenFactor<gtsam::Pose3>>(
+      gtsam::Symbol(0u), gtsam::Symbol(1u), B0_Pose_B1, noise1);
+  graph.emplace_shared<gtsam::BetweenFactor<gtsam::Pose3>>(
+      gtsam::Symbol(1u), gtsam::Symbol(2u), B1_Pose_B2, noise2);
+  gtsam::Values values;
+  values.insert(gtsam::Symbol(0u), gtsam::Pose3());
+  values.insert(gtsam::Symbol(1u), B0_Pose_B1);
+  values.insert(gtsam::Symbol(2u), B0_Pose_B1.compose(B1_Pose_B2));
+  const gtsam::Matrix6 expected =
+      gtsam::Marginals(graph, values).marginalCovariance(gtsam::Symbol(2u));
+  EXPECT_TRUE(gtsam::assert_equal(expected, gaussian->covariance(), 1e-8));
+
+  // Summing the covariances up would be overconfident.
+  const gtsam::Matrix6 summed = noise1->covariance() + noise2->covariance();
+  EXPECT_FALSE(gtsam::assert_equal(expected, summed, 1e-4));
+}
+
+TEST(testIncrementalPgo, loopClosureCorrectsDrift) {
+  for (const double& min_node_translation : {0.0, 3.5}) {
+    IncrementalPgoParams params;
+    params.enabled = true;
+    params.min_node_translation = min_node_translation;
+    params.min_node_rotation = min_node_translation > 0.0 ? M_PI : 0.0;
+    IncrementalPgo pgo(params);
+    addSquareOdometry(&pgo, 0.01);
+
+    const size_t last = kNrKeyframes - 1u;
+    const double drift_error = positionError(pgo.calculateEstimate(), last);
+    EXPECT_GT(drift_error, 1.0);
+
+    // The last keyframe is back at the start, and a bit after the start.
+    pgo.addLoopClosure(0u, last, gtsam::Pose3(), kNoise);
+    pgo.addLoopClosure(
+        2u, last, groundTruthPose(2u).between(groundTruthPose(last)), kNoise);
+    EXPECT_EQ(pgo.getNumLC(), 2u);
+    EXPECT_EQ(pgo.calculateEstimate().size(), kNrKeyframes);
+    EXPECT_LT(positionError(pgo.calculateEstimate(), last),
+              0.2 * drift_error);
+  }
+}
+
+}  // namespace VIO
@@ -0,0 +1,132 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testIncrementalVertexBuffer.cpp
+ * @brief  test IncrementalVertexBuffer uploads only what changed
+ * @author Antoni Rosinol
+ */
+
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/visualizer/IncrementalVertexBuffer.h"
+
+namespace VIO {
+
+namespace {
+using SlotRanges = std::vector<IncrementalVertexBuffer::SlotRange>;
+
+TelemetryPoints makePoints(const LandmarkId& begin, const LandmarkId& end) {
+  TelemetryPoints points;
+  for (LandmarkId id = begin; id < end; ++id) {
+    points[id] = {{static_cast<float>(id), 0.0f, 1.0f}};
+  }
+  return points;
+}
+
+//! The buffer holds the given points, whatever their slots.
+void expectPoints(const TelemetryPoints& points,
+                  const IncrementalVertexBuffer& buffer) {
+  ASSERT_EQ(buffer.size(), points.size());
+  for (const auto& lmk : points) {
+    size_t slot = 0u;
+    ASSERT_TRUE(buffer.getSlot(lmk.first, &slot));
+    for (size_t i = 0u; i < 3u; ++i) {
+      EXPECT_EQ(buffer.getData()[3u * slot + i], lmk.second[i]);
+    }
+  }
+}
+}  // namespace
+
+TEST(testIncrementalVertexBuffer, AppendUploadsNewPoints) {
+  IncrementalVertexBuffer buffer;
+  SlotRanges ranges;
+  EXPECT_FALSE(buffer.takeDirtyRanges(&ranges));
+  EXPECT_TRUE(ranges.empty());
+
+  buffer.append({{0.0f, 0.0f, 0.0f}});
+  buffer.append({{1.0f, 0.0f, 0.0f}});
+  EXPECT_TRUE(buffer.takeDirtyRanges(&ranges));
+  EXPECT_GE(buffer.capacity(), 2u);
+  ASSERT_EQ(ranges.size(), 1u);
+  EXPECT_EQ(ranges[0].begin, 0u);
+  EXPECT_EQ(ranges[0].end, 2u);
+
+  buffer.append({{2.0f, 0.0f, 0.0f}});
+  EXPECT_FALSE(buffer.takeDirtyRanges(&ranges));
+  ASSERT_EQ(ranges.size(), 1u);
+  EXPECT_EQ(ranges[0].begin, 2u);
+  EXPECT_EQ(ranges[0].end, 3u);
+  EXPECT_FALSE(buffer.takeDirtyRanges(&ranges));
+  EXPECT_TRUE(ranges.empty());
+
+  // Beyond the capacity, the buffer is reallocated and uploaded again.
+  const size_t capacity = buffer.capacity();
+  while (buffer.size() <= capacity) buffer.append({{0.0f, 0.0f, 0.0f}});
+  EXPECT_TRUE(buffer.takeDirtyRanges(&ranges));
+  EXPECT_GT(buffer.capacity(), capacity);
+  ASSERT_EQ(ranges.size(), 1u);
+  EXPECT_EQ(ranges[0].end, buffer.size());
+}
+
+TEST(testIncrementalVertexBuffer, UpdateUploadsMovedPoints) {
+  IncrementalVertexBuffer buffer(0.01f);
+  TelemetryPoints points = makePoints(0, 100);
+  buffer.update(points);
+  SlotRanges ranges;
+  EXPECT_TRUE(buffer.takeDirtyRanges(&ranges));
+  expectPoints(points, buffer);
+
+  // Within tolerance: not uploaded again.
+  points[10][0] += 0.005f;
+  buffer.update(points);
+  EXPECT_FALSE(buffer.takeDirtyRanges(&ranges));
+  EXPECT_TRUE(ranges.empty());
+
+  // Only the slots of the moved points, far apart.
+  points[10][0] += 0.1f;
+  points[90][2] -= 0.1f;
+  buffer.update(points);
+  EXPECT_FALSE(buffer.takeDirtyRanges(&ranges));
+  ASSERT_EQ(ranges.size(), 2u);
+  EXPECT_EQ(ranges[0].end - ranges[0].begin, 1u);
+  EXPECT_EQ(ranges[1].end - ranges[1].begin, 1u);
+  expectPoints(points, buffer);
+}
+
+TEST(testIncrementalVertexBuffer, UpdateKeepsPointsContiguous) {
+  IncrementalVertexBuffer buffer;
+  buffer.update(makePoints(0, 100));
+  SlotRanges ranges;
+  buffer.takeDirtyRanges(&ranges);
+
+  // 5 landmarks leave the window, and 5 new ones enter it.
+  const TelemetryPoints points = makePoints(5, 105);
+  buffer.update(points);
+  EXPECT_FALSE(buffer.takeDirtyRanges(&ranges));
+  expectPoints(points, buffer);
+  size_t slot = 0u;
+  EXPECT_FALSE(buffer.getSlot(0, &slot));
+  // The last points fill the slots of the removed ones, the new ones come
+  // after: only these are uploaded.
+  ASSERT_EQ(ranges.size(), 2u);
+  EXPECT_EQ(ranges[0].begin, 0u);
+  EXPECT_EQ(ranges[0].end, 5u);
+  EXPECT_EQ(ranges[1].begin, 95u);
+  EXPECT_EQ(ranges[1].end, 100u);
+
+  buffer.update(TelemetryPoints());
+  EXPECT_FALSE(buffer.takeDirtyRanges(&ranges));
+  EXPECT_TRUE(ranges.empty());
+  EXPECT_EQ(buffer.size(), 0u);
+}
+
+}  // namespace VIO
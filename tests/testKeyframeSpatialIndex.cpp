@@ -0,0 +1,116 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testKeyframeSpatialIndex.cpp
+ * @brief  test KeyframeSpatialIndex on a trajectory going back to its start
+ * @author Antoni Rosinol
+ */
+
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/loopclosure/KeyframeSpatialIndex.h"
+
+namespace VIO {
+
+namespace {
+
+//! One keyframe per meter along x for 100m, then one back at x = 5m.
+void addOutAndBack(KeyframeSpatialIndex* index) {
+  for (FrameId id = 0u; id < 100u; ++id) {
+    index->addKeyframe(id, gtsam::Point3(static_cast<double>(id), 0.0, 0.0));
+  }
+  index->addKeyframe(100u, gtsam::Point3(5.0, 0.0, 0.0));
+}
+
+std::vector<unsigned int> range(const unsigned int& begin,
+                                const unsigned int& end) {
+  std::vector<unsigned int> ids;
+  for (unsigned int id = begin; id < end; ++id) ids.push_back(id);
+  return ids;
+}
+
+}  // namespace
+
+TEST(testKeyframeSpatialIndex, GatesByDriftRadius) {
+  SpatialGatingParams params;
+  params.min_radius = 2.0;
+  params.drift_fraction = 0.01;
+  params.max_radius = 10.0;
+  params.max_candidate_fraction = 1.0;
+  KeyframeSpatialIndex index(params);
+  addOutAndBack(&index);
+  EXPECT_EQ(index.size(), 101u);
+
+  // The query traveled 193m since the start: the radius around keyframe i is
+  // 2 + 0.01 * (193 - i), i.e. ~3.9m at the start.
+  std::vector<unsigned int> candidates;
+  ASSERT_TRUE(index.getCandidates(100u, 100u, &candidates));
+  EXPECT_EQ(candidates, range(2u, 9u));
+
+  // Only the keyframes before max_id.
+  ASSERT_TRUE(index.getCandidates(100u, 6u, &candidates));
+  EXPECT_EQ(candidates, range(2u, 6u));
+}
+
+TEST(testKeyframeSpatialIndex, UncertainKeyframesAreNotGated) {
+  SpatialGatingParams params;
+  params.min_radius = 2.0;
+  params.drift_fraction = 0.05;
+  params.max_radius = 10.0;
+  params.max_candidate_fraction = 1.0;
+  KeyframeSpatialIndex index(params);
+  addOutAndBack(&index);
+
+  // Keyframes more than (10 - 2) / 0.05 = 160m before the query are always
+  // candidates, the others are all too far.
+  std::vector<unsigned int> candidates;
+  ASSERT_TRUE(index.getCandidates(100u, 100u, &candidates));
+  EXPECT_EQ(candidates, range(0u, 33u));
+
+  // Too many candidates: the whole database should be queried.
+  params.max_candidate_fraction = 0.3;
+  KeyframeSpatialIndex strict_index(params);
+  addOutAndBack(&strict_index);
+  EXPECT_FALSE(strict_index.getCandidates(100u, 100u, &candidates));
+}
+
+TEST(testKeyframeSpatialIndex, KeyframesWithoutPosition) {
+  SpatialGatingParams params;
+  params.min_radius = 2.0;
+  params.drift_fraction = 0.0;
+  params.max_radius = 10.0;
+  params.max_candidate_fraction = 1.0;
+  KeyframeSpatialIndex index(params);
+  // Keyframes 0 to 9 were loaded from a map, without position.
+  for (FrameId id = 10u; id <= 20u; ++id) {
+    index.addKeyframe(id,
+                      gtsam::Point3(static_cast<double>(id - 10u), 0.0, 0.0));
+  }
+  EXPECT_FALSE(index.hasKeyframe(9u));
+  EXPECT_TRUE(index.hasKeyframe(20u));
+  EXPECT_FALSE(index.hasKeyframe(21u));
+
+  std::vector<unsigned int> candidates;
+  EXPECT_FALSE(index.getCandidates(5u, 5u, &candidates));
+  EXPECT_TRUE(candidates.empty());
+
+  ASSERT_TRUE(index.getCandidates(20u, 15u, &candidates));
+  EXPECT_EQ(candidates, range(0u, 10u));
+  ASSERT_TRUE(index.getCandidates(20u, 20u, &candidates));
+  std::vector<unsigned int> expected = range(0u, 10u);
+  expected.push_back(18u);
+  expected.push_back(19u);
+  EXPECT_EQ(candidates, expected);
+}
+
+}  // namespace VIO
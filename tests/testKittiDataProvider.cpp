@@ -12,26 +12,142 @@
  * @author Yun Chang
  */
 
-#include <algorithm>
-#include <cstdlib>
+#include <filesystem>
 #include <fstream>
-#include <iostream>
-#include <random>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
-#include "kimera-vio/visualizer/Visualizer3D.h"
+#include <opencv2/imgcodecs.hpp>
+
+#include "kimera-vio/dataprovider/KittiDataProvider.h"
+#include "kimera-vio/pipeline/Pipeline-definitions.h"
 
 DECLARE_string(test_data_path);
 
-using namespace std;
-using namespace VIO;
-using namespace cv;
+namespace VIO {
+
+namespace {
+
+std::string indexedName(const size_t& k, const std::string& extension) {
+  std::ostringstream name;
+  name << std::setfill('0') << std::setw(10) << k << extension;
+  return name.str();
+}
+
+//! Writes a tiny KITTI raw sequence: nr_frames stereo frames and nr_imu OXTS
+//! measurements, all 1ms apart and starting at the same time.
+void writeKittiSequence(const std::filesystem::path& path,
+                        const size_t& nr_frames,
+                        const size_t& nr_imu) {
+  std::filesystem::remove_all(path);
+  for (const std::string& sensor : {"image_00", "image_01", "oxts"}) {
+    std::filesystem::create_directories(path / sensor / "data");
+  }
+  std::ofstream left_stamps(path / "image_00" / "timestamps.txt");
+  std::ofstream right_stamps(path / "image_01" / "timestamps.txt");
+  const cv::Mat img(20, 30, CV_8UC1, cv::Scalar(128));
+  for (size_t k = 0u; k < nr_frames; ++k) {
+    const std::string stamp =
+        "2011-09-26 13:02:25." + std::to_string(100 + k) + "000000";
+    left_stamps << stamp << '\n';
+    right_stamps << stamp << '\n';
+    for (const std::string& camera : {"image_00", "image_01"}) {
+      const std::filesystem::path img_path =
+          path / camera / "data" / indexedName(k, ".png");
+      ASSERT_TRUE(cv::imwrite(img_path.string(), img));
+    }
+  }
+  std::ofstream imu_stamps(path / "oxts" / "timestamps.txt");
+  for (size_t i = 0u; i < nr_imu; ++i) {
+    std::ostringstream stamp;
+    stamp << "2011-09-26 13:02:25.1" << std::setfill('0') << std::setw(2)
+          << i << "0000000";
+    imu_stamps << stamp.str() << '\n';
+    std::ofstream data(path / "oxts" / "data" / indexedName(i, ".txt"));
+    for (size_t j = 0u; j < 30u; ++j) data << static_cast<double>(j) << ' ';
+    data << '\n';
+  }
+}
+
+}  // namespace
+
+TEST(testKittiDataProvider, parseTimestamp) {
+  Timestamp timestamp;
+  ASSERT_TRUE(KittiDataProvider::parseTimestamp(
+      "2011-09-26 13:02:25.964389445", &timestamp));
+  EXPECT_EQ(timestamp, (13 * 3600 + 2 * 60 + 25) * 1000000000LL + 964389445LL);
+  EXPECT_FALSE(KittiDataProvider::parseTimestamp("", &timestamp));
+  EXPECT_FALSE(KittiDataProvider::parseTimestamp("2011-09-26", &timestamp));
+}
+
+TEST(testKittiDataProvider, parseOxtsImuMeasurement) {
+  std::ostringstream line;
+  for (size_t j = 0u; j < 30u; ++j) line << static_cast<double>(j) << ' ';
+  ImuAccGyr imu_accgyr;
+  ASSERT_TRUE(
+      KittiDataProvider::parseOxtsImuMeasurement(line.str(), &imu_accgyr));
+  ImuAccGyr expected;
+  expected << 11.0, 12.0, 13.0, 17.0, 18.0, 19.0;
+  EXPECT_TRUE(imu_accgyr.isApprox(expected));
+  EXPECT_FALSE(
+      KittiDataProvider::parseOxtsImuMeasurement("1.0 2.0 3.0", &imu_accgyr));
+}
+
+TEST(testKittiDataProvider, streamsSequence) {
+  const std::filesystem::path sequence_path =
+      std::filesystem::temp_directory_path() / "kimera_test_kitti_sequence";
+  static constexpr size_t kNrFrames = 5u;
+  static constexpr size_t kNrImu = 50u;
+  writeKittiSequence(sequence_path, kNrFrames, kNrImu);
 
-// TODO(Yun)
-TEST(testFrame, KittiDataProvider) {
-  // TODO: test kitti data provider Check image lists and also imu data parsing
-  // Construct a frame from image name.
+  VioParams vio_params(FLAGS_test_data_path + "/EurocParams");
+  vio_params.parallel_run_ = false;
+  KittiDataProvider kitti_provider(sequence_path.string(), 1, 100, vio_params);
+
+  std::vector<Timestamp> left_stamps;
+  size_t nr_right_frames = 0u;
+  std::vector<Timestamp> imu_stamps;
+  kitti_provider.registerLeftFrameCallback(
+      [&left_stamps](Frame::UniquePtr frame) {
+        ASSERT_TRUE(frame);
+        EXPECT_FALSE(frame->img_.empty());
+        left_stamps.push_back(frame->timestamp_);
+      });
+  kitti_provider.registerRightFrameCallback(
+      [&nr_right_frames](Frame::UniquePtr frame) {
+        ASSERT_TRUE(frame);
+        ++nr_right_frames;
+      });
+  kitti_provider.registerImuSingleCallback(
+      [&imu_stamps](const ImuMeasurement& imu_meas) {
+        imu_stamps.push_back(imu_meas.timestamp_);
+      });
+
+  // Sequential mode: one frame per spin, and the first frame is skipped.
+  size_t nr_spins = 0u;
+  while (kitti_provider.spin()) {
+    ++nr_spins;
+    ASSERT_EQ(left_stamps.size(), nr_spins);
+    // IMU data was sent past the frame, so that it can be synced.
+    ASSERT_FALSE(imu_stamps.empty());
+    EXPECT_GT(imu_stamps.back(), left_stamps.back());
+  }
+  EXPECT_EQ(nr_spins, kNrFrames - 1u);
+  EXPECT_EQ(nr_right_frames, kNrFrames - 1u);
+  EXPECT_FALSE(kitti_provider.hasData());
+  for (size_t i = 1u; i < imu_stamps.size(); ++i) {
+    EXPECT_GT(imu_stamps[i], imu_stamps[i - 1u]);
+  }
+  // Not all the IMU data was read, only up to the last frame.
+  EXPECT_LT(imu_stamps.size(), kNrImu);
+
+  std::filesystem::remove_all(sequence_path);
 }
+
+}  // namespace VIO
@@ -0,0 +1,100 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testLandmarkSelection.cpp
+ * @brief  test the scoring and selection of informative landmarks
+ * @author Antoni Rosinol
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <vector>
+
+#include <gtsam/geometry/StereoCamera.h>
+
+#include "kimera-vio/backend/LandmarkSelection.h"
+
+namespace VIO {
+
+namespace {
+
+gtsam::Cal3_S2Stereo::shared_ptr makeStereoCalibration() {
+  return gtsam::Cal3_S2Stereo::shared_ptr(
+      new gtsam::Cal3_S2Stereo(450.0, 450.0, 0.0, 320.0, 240.0, 0.11));
+}
+
+gtsam::StereoPoint2 project(const gtsam::Point3& point) {
+  const gtsam::StereoCamera camera(gtsam::Pose3(), makeStereoCalibration());
+  return camera.project(point);
+}
+
+}  // namespace
+
+TEST(testLandmarkSelection, closerLandmarksAreMoreInformative) {
+  const gtsam::Cal3_S2Stereo::shared_ptr stereo_cal = makeStereoCalibration();
+  const gtsam::Matrix6 covariance = gtsam::Matrix6::Identity() * 1e-2;
+  const double near_gain = computeLandmarkInformationGain(
+      project(gtsam::Point3(0.5, 0.2, 2.0)),
+      stereo_cal,
+      gtsam::Pose3(),
+      covariance,
+      1.0);
+  const double far_gain = computeLandmarkInformationGain(
+      project(gtsam::Point3(0.5, 0.2, 15.0)),
+      stereo_cal,
+      gtsam::Pose3(),
+      covariance,
+      1.0);
+  EXPECT_GT(far_gain, 0.0);
+  EXPECT_GT(near_gain, far_gain);
+
+  // A more uncertain pose gains more from the same measurement.
+  EXPECT_GT(computeLandmarkInformationGain(
+                project(gtsam::Point3(0.5, 0.2, 15.0)),
+                stereo_cal,
+                gtsam::Pose3(),
+                covariance * 10.0,
+                1.0),
+            far_gain);
+}
+
+TEST(testLandmarkSelection, invalidDisparityHasNoGain) {
+  const gtsam::Cal3_S2Stereo::shared_ptr stereo_cal = makeStereoCalibration();
+  const gtsam::Matrix6 covariance = gtsam::Matrix6::Identity();
+  EXPECT_EQ(
+      computeLandmarkInformationGain(gtsam::StereoPoint2(300.0, 310.0, 200.0),
+                                     stereo_cal,
+                                     gtsam::Pose3(),
+                                     covariance,
+                                     1.0),
+      0.0);
+  EXPECT_EQ(computeLandmarkInformationGain(
+                gtsam::StereoPoint2(
+                    300.0, std::numeric_limits<double>::quiet_NaN(), 200.0),
+                stereo_cal,
+                gtsam::Pose3(),
+                covariance,
+                1.0),
+            0.0);
+}
+
+TEST(testLandmarkSelection, selectMostInformativeLandmarks) {
+  const std::vector<LandmarkScore> scores = {
+      {3, 0.5}, {7, 2.0}, {1, 0.1}, {4, 1.5}, {9, 2.0}};
+  EXPECT_EQ(selectMostInformativeLandmarks(scores, 3u),
+            LandmarkIds({7, 9, 4}));
+  EXPECT_EQ(selectMostInformativeLandmarks(scores, 10u),
+            LandmarkIds({7, 9, 4, 3, 1}));
+  EXPECT_TRUE(selectMostInformativeLandmarks(scores, 0u).empty());
+}
+
+}  // namespace VIO
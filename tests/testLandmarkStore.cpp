@@ -0,0 +1,111 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testLandmarkStore.cpp
+ * @brief  test the dense landmark store
+ * @author Antoni Rosinol
+ */
+
+#include <map>
+#include <stdexcept>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/common/LandmarkStore.h"
+
+namespace VIO {
+
+TEST(testLandmarkStore, insertFindErase) {
+  LandmarkStore<int> store;
+  EXPECT_TRUE(store.empty());
+  EXPECT_TRUE(store.find(3) == store.end());
+
+  EXPECT_TRUE(store.emplace(3, 30).second);
+  EXPECT_TRUE(store.insert(std::make_pair(LandmarkId(5), 50)).second);
+  store[1] = 10;
+  // As std::unordered_map, existing values are not overwritten.
+  EXPECT_FALSE(store.emplace(3, 31).second);
+  EXPECT_EQ(store.size(), 3u);
+  EXPECT_EQ(store.at(1), 10);
+  EXPECT_EQ(store.at(3), 30);
+  EXPECT_EQ(store.find(5)->second, 50);
+  EXPECT_EQ(store.count(4), 0u);
+  EXPECT_THROW(store.at(4), std::out_of_range);
+
+  EXPECT_EQ(store.erase(3), 1u);
+  EXPECT_EQ(store.erase(3), 0u);
+  EXPECT_EQ(store.size(), 2u);
+  EXPECT_TRUE(store.find(3) == store.end());
+
+  // Iterating while erasing.
+  for (auto it = store.begin(); it != store.end();) {
+    it = it->first == 1 ? store.erase(it) : std::next(it);
+  }
+  EXPECT_EQ(store.size(), 1u);
+  EXPECT_EQ(store.begin()->first, 5);
+
+  store.clear();
+  EXPECT_TRUE(store.empty());
+  EXPECT_TRUE(store.begin() == store.end());
+}
+
+TEST(testLandmarkStore, matchesUnorderedMap) {
+  // A sliding window of landmark ids, as in the backend time horizon.
+  LandmarkStore<double> store;
+  std::map<LandmarkId, double> expected;
+  for (LandmarkId lmk_id = 0; lmk_id < 1000; ++lmk_id) {
+    store[lmk_id] = 0.5 * lmk_id;
+    expected[lmk_id] = 0.5 * lmk_id;
+    if (lmk_id >= 50 && lmk_id % 3 != 0) {
+      EXPECT_EQ(store.erase(lmk_id - 50), 1u);
+      expected.erase(lmk_id - 50);
+    }
+  }
+  // Ids below the live ones are fine too.
+  ASSERT_EQ(store.count(0), 0u);
+  store[0] = 1.0;
+  expected[0] = 1.0;
+
+  ASSERT_EQ(store.size(), expected.size());
+  std::map<LandmarkId, double> actual;
+  for (const auto& lmk_id_value : store) {
+    EXPECT_TRUE(actual.emplace(lmk_id_value).second);
+  }
+  EXPECT_EQ(actual, expected);
+
+  // Copies are independent.
+  LandmarkStore<double> copy = store;
+  copy.erase(0);
+  EXPECT_EQ(store.count(0), 1u);
+  EXPECT_EQ(copy.size() + 1u, store.size());
+}
+
+TEST(testLandmarkStore, recyclesSlots) {
+  LandmarkStore<int> store;
+  for (LandmarkId lmk_id = 0; lmk_id < 10; ++lmk_id) store[lmk_id] = 0;
+  const LandmarkStore<int>::Handle handle = store.getHandle(4);
+  ASSERT_TRUE(handle.isValid());
+  EXPECT_EQ(store.get(handle)->first, 4);
+  EXPECT_FALSE(store.getHandle(42).isValid());
+
+  // The slot of the erased landmark goes to the next one, and the handle to
+  // the erased one becomes stale.
+  store.erase(4);
+  EXPECT_TRUE(store.get(handle) == nullptr);
+  store[10] = 100;
+  const LandmarkStore<int>::Handle new_handle = store.getHandle(10);
+  EXPECT_EQ(new_handle.slot, handle.slot);
+  EXPECT_NE(new_handle.generation, handle.generation);
+  EXPECT_TRUE(store.get(handle) == nullptr);
+  EXPECT_EQ(store.get(new_handle)->second, 100);
+}
+
+}  // namespace VIO
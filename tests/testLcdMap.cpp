@@ -0,0 +1,174 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testLcdMap.cpp
+ * @brief  test saving and loading the LCD map of a session
+ * @author Antoni Rosinol
+ */
+
+#include <DBoW2/DBoW2.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/nonlinear/NonlinearFactorGraph.h>
+#include <gtsam/nonlinear/Values.h>
+#include <gtsam/slam/BetweenFactor.h>
+#include <gtsam/slam/PriorFactor.h>
+
+#include "kimera-vio/loopclosure/LcdMap.h"
+
+DECLARE_string(test_data_path);
+
+namespace VIO {
+
+namespace {
+
+LCDFrame::Ptr makeFrame(const FrameId& id, cv::RNG* rng) {
+  std::vector<cv::KeyPoint> keypoints;
+  Landmarks keypoints_3d;
+  OrbDescriptor descriptors_mat;
+  BearingVectors bearing_vectors;
+  for (int i = 0; i < 20; ++i) {
+    keypoints.emplace_back(
+        rng->uniform(0.f, 640.f), rng->uniform(0.f, 480.f), 31.f);
+    keypoints_3d.emplace_back(rng->uniform(-1.0, 1.0), 0.5, 2.0);
+    bearing_vectors.push_back(keypoints_3d.back().normalized());
+    cv::Mat descriptor(1, DBoW2::FORB::L, CV_8U);
+    rng->fill(descriptor, cv::RNG::UNIFORM, 0, 256);
+    descriptors_mat.push_back(descriptor);
+  }
+  if (id % 2u == 0u) {
+    return std::make_shared<LCDFrame>(id * 10,
+                                      id,
+                                      id,
+                                      keypoints,
+                                      keypoints_3d,
+                                      descriptors_mat,
+                                      bearing_vectors);
+  }
+  StatusKeypointsCV rectified(
+      1u, std::make_pair(KeypointStatus::VALID, KeypointCV(1.f, 2.f)));
+  return std::make_shared<StereoLCDFrame>(id * 10,
+                                          id,
+                                          id,
+                                          keypoints,
+                                          keypoints_3d,
+                                          descriptors_mat,
+                                          bearing_vectors,
+                                          rectified,
+                                          rectified);
+}
+
+}  // namespace
+
+TEST(testLcdMap, SaveAndLoad) {
+  OrbVocabulary vocab;
+  vocab.load(FLAGS_test_data_path + "/ForLoopClosureDetector/small_voc.yml.gz");
+
+  cv::RNG rng(3);
+  FrameCache cache;
+  BowDatabase database(vocab);
+  gtsam::Values W_Pose_B;
+  gtsam::NonlinearFactorGraph factors;
+  const gtsam::SharedNoiseModel noise =
+      gtsam::noiseModel::Isotropic::Sigma(6, 0.1);
+  const size_t nr_frames = 6u;
+  gtsam::Pose3 W_Pose_Bkf;
+  const gtsam::Pose3 Blkf_Pose_Bkf(gtsam::Rot3::Ypr(0.1, 0.0, 0.0),
+                                   gtsam::Point3(1.0, 0.0, 0.0));
+  for (size_t i = 0u; i < nr_frames; ++i) {
+    const LCDFrame::Ptr frame = makeFrame(i, &rng);
+    cache.addFrame(frame);
+    DBoW2::BowVector bow_vec;
+    vocab.transform(descriptorRows(frame->descriptors_mat_), bow_vec);
+    database.add(bow_vec);
+    if (i == 0u) {
+      factors.add(gtsam::PriorFactor<gtsam::Pose3>(i, W_Pose_Bkf, noise));
+    } else {
+      W_Pose_Bkf = W_Pose_Bkf.compose(Blkf_Pose_Bkf);
+      factors.add(gtsam::BetweenFactor<gtsam::Pose3>(
+          i - 1u, i, Blkf_Pose_Bkf, noise));
+    }
+    W_Pose_B.insert(i, W_Pose_Bkf);
+  }
+  // Robust loop closure: saved without its kernel.
+  factors.add(gtsam::BetweenFactor<gtsam::Pose3>(
+      0u,
+      nr_frames - 1u,
+      W_Pose_B.at<gtsam::Pose3>(nr_frames - 1u),
+      gtsam::noiseModel::Robust::Create(
+          gtsam::noiseModel::mEstimator::Cauchy::Create(1.0), noise)));
+
+  const std::string filepath = "/tmp/testLcdMap.bin";
+  saveLcdMap(filepath, cache, W_Pose_B, factors, database);
+  const LcdMap::UniquePtr map = loadLcdMap(filepath, vocab);
+  std::remove(filepath.c_str());
+  ASSERT_TRUE(map);
+
+  ASSERT_EQ(map->frames.size(), nr_frames);
+  for (size_t i = 0u; i < nr_frames; ++i) {
+    const LCDFrame::Ptr expected = cache.getFrame(i);
+    const LCDFrame::Ptr actual = map->frames[i];
+    ASSERT_TRUE(actual);
+    EXPECT_EQ(actual->id_, expected->id_);
+    EXPECT_EQ(actual->timestamp_, expected->timestamp_);
+    EXPECT_EQ(actual->keypoints_.size(), expected->keypoints_.size());
+    EXPECT_EQ(actual->keypoints_3d_, expected->keypoints_3d_);
+    EXPECT_EQ(cv::norm(actual->descriptors_mat_,
+                       expected->descriptors_mat_,
+                       cv::NORM_HAMMING),
+              0.0);
+    EXPECT_EQ(std::dynamic_pointer_cast<StereoLCDFrame>(actual) != nullptr,
+              i % 2u == 1u);
+  }
+
+  ASSERT_EQ(map->W_Pose_B.size(), nr_frames);
+  for (size_t i = 0u; i < nr_frames; ++i) {
+    EXPECT_TRUE(map->W_Pose_B.at<gtsam::Pose3>(i).equals(
+        W_Pose_B.at<gtsam::Pose3>(i), 1e-12));
+  }
+  ASSERT_EQ(map->factors.size(), factors.size());
+  EXPECT_NEAR(map->factors.error(W_Pose_B), 0.0, 1e-12);
+  gtsam::Values perturbed(W_Pose_B);
+  perturbed.update(0u, gtsam::Pose3(gtsam::Rot3(), gtsam::Point3(0, 1, 0)));
+  EXPECT_GT(map->factors.error(perturbed), 0.0);
+
+  ASSERT_TRUE(map->database);
+  ASSERT_EQ(map->database->size(), database.size());
+  for (size_t i = 0u; i < nr_frames; ++i) {
+    DBoW2::BowVector bow_vec;
+    vocab.transform(descriptorRows(cache.getFrame(i)->descriptors_mat_),
+                    bow_vec);
+    DBoW2::QueryResults expected, actual;
+    database.query(bow_vec, expected, 0);
+    map->database->query(bow_vec, actual, 0);
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t j = 0u; j < expected.size(); ++j) {
+      EXPECT_EQ(actual[j].Id, expected[j].Id);
+      EXPECT_NEAR(actual[j].Score, expected[j].Score, 1e-12);
+    }
+  }
+}
+
+TEST(testLcdMap, LoadInvalidFile) {
+  OrbVocabulary vocab;
+  vocab.load(FLAGS_test_data_path + "/ForLoopClosureDetector/small_voc.yml.gz");
+  EXPECT_FALSE(loadLcdMap("/tmp/testLcdMap_missing.bin", vocab));
+  EXPECT_FALSE(loadLcdMap(
+      FLAGS_test_data_path + "/ForLoopClosureDetector/small_voc.yml.gz",
+      vocab));
+}
+
+}  // namespace VIO
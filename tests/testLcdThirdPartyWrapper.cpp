@@ -0,0 +1,126 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testLcdThirdPartyWrapper.cpp
+ * @brief  test the island grouping of the LCD query results
+ * @author Antoni Rosinol
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "kimera-vio/loopclosure/LcdThirdPartyWrapper.h"
+#include "kimera-vio/utils/Timer.h"
+
+namespace VIO {
+
+namespace {
+
+//! Query results as returned by the database: sorted by decreasing score.
+DBoW2::QueryResults makeQueryResults(const size_t& nr_results,
+                                     const unsigned int& max_id,
+                                     cv::RNG* rng) {
+  std::vector<unsigned int> ids(max_id);
+  for (unsigned int i = 0u; i < max_id; ++i) ids[i] = i;
+  cv::randShuffle(ids, 1.0, rng);
+  DBoW2::QueryResults results;
+  for (size_t i = 0u; i < nr_results && i < ids.size(); ++i) {
+    results.push_back(DBoW2::Result(ids[i], rng->uniform(0.0, 1.0)));
+  }
+  std::sort(results.begin(), results.end());
+  std::reverse(results.begin(), results.end());
+  return results;
+}
+
+//! DLoopDetector's grouping, summing each island's scores afterwards.
+std::vector<MatchIsland> computeIslandsReference(
+    const LoopClosureDetectorParams& params,
+    DBoW2::QueryResults q) {
+  std::vector<MatchIsland> islands;
+  std::sort(q.begin(), q.end(), DBoW2::Result::ltId);
+  size_t i_first = 0u;
+  for (size_t i = 1u; i <= q.size(); ++i) {
+    if (i < q.size() && static_cast<int>(q[i].Id) -
+                                static_cast<int>(q[i - 1u].Id) <
+                            params.max_intraisland_gap_) {
+      continue;
+    }
+    const int length = static_cast<int>(q[i - 1u].Id - q[i_first].Id) + 1;
+    if (length >= params.min_matches_per_island_ || q.size() == 1u) {
+      MatchIsland island(q[i_first].Id, q[i - 1u].Id, 0.0);
+      island.best_score_ = q[i_first].Score;
+      island.best_id_ = q[i_first].Id;
+      for (size_t j = i_first; j < i; ++j) {
+        island.island_score_ += q[j].Score;
+        if (q[j].Score > island.best_score_) {
+          island.best_score_ = q[j].Score;
+          island.best_id_ = q[j].Id;
+        }
+      }
+      islands.push_back(island);
+    }
+    i_first = i;
+  }
+  return islands;
+}
+
+}  // namespace
+
+TEST(testLcdThirdPartyWrapper, computeIslandsSameAsReference) {
+  LoopClosureDetectorParams params;
+  params.max_intraisland_gap_ = 3;
+  params.min_matches_per_island_ = 2;
+  LcdThirdPartyWrapper wrapper(params);
+  cv::RNG rng(5);
+  for (const size_t& nr_results : {0u, 1u, 2u, 10u, 50u, 200u}) {
+    const DBoW2::QueryResults q = makeQueryResults(nr_results, 300u, &rng);
+    const std::vector<MatchIsland> expected =
+        computeIslandsReference(params, q);
+    DBoW2::QueryResults q_copy = q;
+    std::vector<MatchIsland> actual;
+    wrapper.computeIslands(&q_copy, &actual);
+    ASSERT_EQ(actual.size(), expected.size()) << nr_results << " results";
+    for (size_t i = 0u; i < expected.size(); ++i) {
+      EXPECT_EQ(actual[i].start_id_, expected[i].start_id_);
+      EXPECT_EQ(actual[i].end_id_, expected[i].end_id_);
+      EXPECT_EQ(actual[i].island_score_, expected[i].island_score_);
+      EXPECT_EQ(actual[i].best_id_, expected[i].best_id_);
+      EXPECT_EQ(actual[i].best_score_, expected[i].best_score_);
+    }
+  }
+}
+
+TEST(testLcdThirdPartyWrapper, computeIslandsScaling) {
+  LoopClosureDetectorParams params;
+  LcdThirdPartyWrapper wrapper(params);
+  cv::RNG rng(11);
+  for (const unsigned int& db_size : {1000u, 10000u, 100000u}) {
+    // As many results as a query returning all the candidates.
+    const DBoW2::QueryResults q =
+        makeQueryResults(db_size / 10u, db_size, &rng);
+    DBoW2::QueryResults q_copy = q;
+    std::vector<MatchIsland> islands;
+    const auto tic = utils::Timer::tic();
+    wrapper.computeIslands(&q_copy, &islands);
+    LOG(INFO) << "Island grouping of " << q.size() << " results (database of "
+              << db_size << " entries): "
+              << utils::Timer::toc<std::chrono::microseconds>(tic).count()
+              << " us.";
+    EXPECT_FALSE(islands.empty());
+  }
+}
+
+}  // namespace VIO
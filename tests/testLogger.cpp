@@ -50,6 +50,8 @@ class CSVReader {
   CSVReader(char sep = ',') : sep_(sep) {}
 
   CsvMat getData(std::string filename) {
+    // Loggers write their files asynchronously.
+    AsyncFileWriter::flushAll();
     std::ifstream file(filename);
     CsvMat dataList;
     std::string line = "";
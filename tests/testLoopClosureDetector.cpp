@@ -35,6 +35,7 @@
 
 DECLARE_string(test_data_path);
 DECLARE_string(vocabulary_path);
+DECLARE_bool(lcd_no_detection);
 
 namespace VIO {
 
@@ -452,7 +453,6 @@ TEST_F(LCDFixture, processAndAddStereoFrame) {
   EXPECT_EQ(stereo_lcd_frame->id_kf_, id_match1_);
   EXPECT_EQ(stereo_lcd_frame->keypoints_.size(), lcd_params_.nfeatures_);
   EXPECT_EQ(stereo_lcd_frame->keypoints_3d_.size(), lcd_params_.nfeatures_);
-  EXPECT_EQ(stereo_lcd_frame->descriptors_vec_.size(), lcd_params_.nfeatures_);
   EXPECT_EQ(stereo_lcd_frame->descriptors_mat_.size().height,
             lcd_params_.nfeatures_);
   EXPECT_EQ(stereo_lcd_frame->bearing_vectors_.size(), lcd_params_.nfeatures_);
@@ -472,7 +472,6 @@ TEST_F(LCDFixture, processAndAddStereoFrame) {
   EXPECT_EQ(stereo_lcd_frame->id_kf_, id_query1_);
   EXPECT_EQ(stereo_lcd_frame->keypoints_.size(), lcd_params_.nfeatures_);
   EXPECT_EQ(stereo_lcd_frame->keypoints_3d_.size(), lcd_params_.nfeatures_);
-  EXPECT_EQ(stereo_lcd_frame->descriptors_vec_.size(), lcd_params_.nfeatures_);
   EXPECT_EQ(stereo_lcd_frame->descriptors_mat_.size().height,
             lcd_params_.nfeatures_);
   EXPECT_EQ(stereo_lcd_frame->bearing_vectors_.size(), lcd_params_.nfeatures_);
@@ -482,6 +481,52 @@ TEST_F(LCDFixture, processAndAddStereoFrame) {
             lcd_params_.nfeatures_);
 }
 
+TEST_F(LCDFixture, processAndAddStereoFrameReusingFrontendFeatures) {
+  lcd_params_.reuse_frontend_features_ = true;
+  lcd_detector_ = std::make_unique<LoopClosureDetector>(
+      lcd_params_,
+      stereo_camera_->getLeftCamParams(),
+      stereo_camera_->getBodyPoseLeftCamRect(),
+      stereo_camera_,
+      frontend_params_.stereo_matching_params_,
+      std::nullopt,
+      false);
+  const auto& cache = lcd_detector_->getFrameCache();
+
+  FrameId id_0 = lcd_detector_->processAndAddStereoFrame(*match1_stereo_frame_);
+  EXPECT_EQ(id_0, 0);
+  ASSERT_EQ(cache.size(), 1u);
+
+  auto stereo_lcd_frame =
+      std::dynamic_pointer_cast<StereoLCDFrame>(cache.getFrame(0));
+  ASSERT_TRUE(stereo_lcd_frame != nullptr);
+  EXPECT_EQ(stereo_lcd_frame->timestamp_, timestamp_match1_);
+  EXPECT_EQ(stereo_lcd_frame->id_kf_, id_match1_);
+  // Descriptors at (most of) the frontend keypoints, no new detection.
+  const size_t nr_kpts = stereo_lcd_frame->keypoints_.size();
+  EXPECT_GT(nr_kpts, 0u);
+  EXPECT_LE(nr_kpts, match1_stereo_frame_->left_frame_.keypoints_.size());
+  EXPECT_EQ(stereo_lcd_frame->keypoints_3d_.size(), nr_kpts);
+  EXPECT_EQ(static_cast<size_t>(stereo_lcd_frame->descriptors_mat_.rows),
+            nr_kpts);
+  EXPECT_EQ(stereo_lcd_frame->bearing_vectors_.size(), nr_kpts);
+  EXPECT_EQ(stereo_lcd_frame->left_keypoints_rectified_.size(), nr_kpts);
+  EXPECT_EQ(stereo_lcd_frame->right_keypoints_rectified_.size(), nr_kpts);
+
+  // The stereo data follows its keypoint.
+  for (size_t i = 0; i < nr_kpts; ++i) {
+    const cv::Point2f& pt = stereo_lcd_frame->keypoints_[i].pt;
+    const auto& keypoints = match1_stereo_frame_->left_frame_.keypoints_;
+    const auto iter = std::find(keypoints.begin(), keypoints.end(), pt);
+    ASSERT_TRUE(iter != keypoints.end());
+    const size_t j = iter - keypoints.begin();
+    EXPECT_EQ(match1_stereo_frame_->keypoints_3d_[j],
+              stereo_lcd_frame->keypoints_3d_[i]);
+    EXPECT_EQ(match1_stereo_frame_->right_keypoints_rectified_[j].second,
+              stereo_lcd_frame->right_keypoints_rectified_[i].second);
+  }
+}
+
 TEST_F(LCDFixture, geometricVerificationCam2d2d) {
   lcd_params_.tracker_params_.pose_2d2d_algorithm_ = Pose2d2dAlgorithm::NISTER;
   lcd_detector_ = std::make_unique<LoopClosureDetector>(
@@ -940,6 +985,9 @@ TEST_F(LCDFixture, detectLoop) {
   EXPECT_EQ(loop_result_1.isLoop(), true);
   EXPECT_EQ(loop_result_1.match_id_, 0);
   EXPECT_EQ(loop_result_1.query_id_, 2);
+  // With the RANSAC statistics of its verification.
+  EXPECT_GT(loop_result_1.mono_inliers_, 0u);
+  EXPECT_LE(loop_result_1.mono_inliers_, loop_result_1.mono_input_size_);
 
   error = UtilsOpenCV::ComputeRotationAndTranslationErrors(
       bodyMatch1_T_bodyQuery1_gt_, loop_result_1.relative_pose_, false);
@@ -948,6 +996,43 @@ TEST_F(LCDFixture, detectLoop) {
   EXPECT_LT(error.second, tran_tol_stereo);
 }
 
+TEST_F(LCDFixture, detectLoopSkippingDuplicateKeyframes) {
+  lcd_params_.tracker_params_.pose_2d2d_algorithm_ = Pose2d2dAlgorithm::NISTER;
+  lcd_params_.database_insertion.enabled = true;
+  lcd_params_.database_insertion.max_similarity = 0.9;
+  lcd_detector_ = std::make_unique<LoopClosureDetector>(
+      lcd_params_,
+      stereo_camera_->getLeftCamParams(),
+      stereo_camera_->getBodyPoseLeftCamRect(),
+      stereo_camera_,
+      frontend_params_.stereo_matching_params_,
+      std::nullopt,
+      false);
+  CHECK(match1_stereo_frame_);
+  CHECK(query1_stereo_frame_);
+
+  // The robot stays still on the first keyframe.
+  FrameId frame_id_0 =
+      lcd_detector_->processAndAddStereoFrame(*match1_stereo_frame_);
+  FrameId frame_id_1 =
+      lcd_detector_->processAndAddStereoFrame(*match1_stereo_frame_);
+  FrameId frame_id_2 =
+      lcd_detector_->processAndAddStereoFrame(*query1_stereo_frame_);
+
+  LoopResult loop_result;
+  lcd_detector_->detectLoopById(frame_id_0, &loop_result);
+  EXPECT_EQ(lcd_detector_->getBoWDatabase()->size(), 1u);
+  lcd_detector_->detectLoopById(frame_id_1, &loop_result);
+  EXPECT_EQ(lcd_detector_->getBoWDatabase()->size(), 1u);
+
+  // Not a duplicate: added, and matched to the keyframe in the database.
+  lcd_detector_->detectLoopById(frame_id_2, &loop_result);
+  EXPECT_EQ(lcd_detector_->getBoWDatabase()->size(), 2u);
+  EXPECT_TRUE(loop_result.isLoop());
+  EXPECT_EQ(loop_result.match_id_, frame_id_0);
+  EXPECT_EQ(loop_result.query_id_, frame_id_2);
+}
+
 TEST_F(LCDFixture, addOdometryFactorAndOptimize) {
   /* Test the addition of odometry factors to the PGO */
   CHECK(lcd_detector_);
@@ -1079,6 +1164,59 @@ TEST_F(LCDFixture, addLoopClosureFactorNoOptimize) {
   }
 }
 
+TEST_F(LCDFixture, addLoopClosureFactorsInBatch) {
+  /* Buffered loop closures are added to the PGO with a single update */
+  LoopClosureDetectorParams params;
+  params.odom_rot_threshold_ = -1;
+  params.odom_trans_threshold_ = -1;
+  params.pcm_rot_threshold_ = -1;
+  params.pcm_trans_threshold_ = -1;
+  params.gnc_alpha_ = 0;
+  params.loop_closure_batch_size_ = 3;
+  lcd_detector_ = std::make_unique<LoopClosureDetector>(
+      params,
+      stereo_camera_->getLeftCamParams(),
+      stereo_camera_->getBodyPoseLeftCamRect(),
+      stereo_camera_,
+      frontend_params_.stereo_matching_params_,
+      std::nullopt,
+      false);
+  lcd_detector_->registerIsBackendQueueFilledCallback(
+      std::bind(&LCDFixture::lcdInputQueueCb, this));
+
+  lcd_detector_->initializePGO(OdometryFactor(
+      0, gtsam::Pose3(), gtsam::noiseModel::Isotropic::Variance(6, 0.1)));
+  const size_t num_odom = 5u;
+  for (size_t i = 1u; i < num_odom; i++) {
+    lcd_detector_->addOdometryFactorAndOptimize(
+        OdometryFactor(i,
+                       gtsam::Pose3(gtsam::Rot3(), gtsam::Point3(i, 0, 0)),
+                       gtsam::noiseModel::Isotropic::Variance(6, 0.1)));
+  }
+  ASSERT_EQ(lcd_detector_->getPGOnfg().size(), num_odom);
+
+  const auto add_loop_closure = [this](const FrameId& ref_key,
+                                       const FrameId& cur_key) {
+    const double distance = static_cast<double>(cur_key - ref_key);
+    lcd_detector_->addLoopClosureFactorAndOptimize(LoopClosureFactor(
+        ref_key,
+        cur_key,
+        gtsam::Pose3(gtsam::Rot3(), gtsam::Point3(distance, 0, 0)),
+        gtsam::noiseModel::Isotropic::Variance(6, 0.1)));
+  };
+  add_loop_closure(0u, 2u);
+  add_loop_closure(1u, 3u);
+  EXPECT_EQ(lcd_detector_->getPGOnfg().size(), num_odom);
+  add_loop_closure(2u, 4u);
+  EXPECT_EQ(lcd_detector_->getPGOnfg().size(), num_odom + 3u);
+
+  // An incomplete batch is added on demand.
+  add_loop_closure(0u, 4u);
+  EXPECT_EQ(lcd_detector_->getPGOnfg().size(), num_odom + 3u);
+  lcd_detector_->addLoopClosureBatchAndOptimize();
+  EXPECT_EQ(lcd_detector_->getPGOnfg().size(), num_odom + 4u);
+}
+
 TEST_F(LCDFixture, spinOnce) {
   /* Test the full pipeline with one loop closure and full PGO optimization */
   CHECK(lcd_detector_);
@@ -1164,6 +1302,72 @@ TEST_F(LCDFixture, spinOnce) {
   EXPECT_EQ(output_2->states_.size(), 3);
 }
 
+TEST_F(LCDFixture, spinOnceAsyncVerification) {
+  /* Same as spinOnce, but verifying the candidates in worker threads */
+  lcd_params_.verification_num_workers_ = 2;
+  lcd_detector_ = std::make_unique<LoopClosureDetector>(
+      lcd_params_,
+      stereo_camera_->getLeftCamParams(),
+      stereo_camera_->getBodyPoseLeftCamRect(),
+      stereo_camera_,
+      frontend_params_.stereo_matching_params_,
+      std::nullopt,
+      false);
+  lcd_detector_->registerIsBackendQueueFilledCallback(
+      std::bind(&LCDFixture::lcdInputQueueCb, this));
+
+  auto spinOnce = [this](const StereoFrame& stereo_frame,
+                         const Timestamp& timestamp,
+                         const FrameId& kf_id,
+                         const PointsWithIdMap& W_lmks3d) {
+    StereoFrontendOutput::Ptr stereo_frontend_output =
+        std::make_shared<StereoFrontendOutput>(
+            stereo_frame.isKeyframe(),
+            StatusStereoMeasurementsPtr(),
+            stereo_camera_->getBodyPoseLeftCamRect(),
+            stereo_camera_->getBodyPoseRightCamRect(),
+            stereo_frame,
+            ImuFrontend::PimPtr(),
+            ImuAccGyrS(),
+            cv::Mat(),
+            DebugTrackerInfo());
+    return lcd_detector_->spinOnce(LcdInput(
+        timestamp, stereo_frontend_output, kf_id, W_lmks3d, gtsam::Pose3()));
+  };
+
+  CHECK(match1_stereo_frame_);
+  CHECK(match2_stereo_frame_);
+  CHECK(query1_stereo_frame_);
+  LcdOutput::Ptr output_0 = spinOnce(
+      *match1_stereo_frame_, timestamp_match1_, FrameId(0), W_match1_lmks3d_);
+  LcdOutput::Ptr output_1 = spinOnce(
+      *match2_stereo_frame_, timestamp_match2_, FrameId(1), W_match2_lmks3d_);
+  // The candidate is only queued: no loop closure reported yet.
+  LcdOutput::Ptr output_2 = spinOnce(
+      *query1_stereo_frame_, timestamp_query1_, FrameId(2), W_query1_lmks3d_);
+  EXPECT_EQ(output_0->is_loop_closure_, false);
+  EXPECT_EQ(output_1->is_loop_closure_, false);
+  EXPECT_EQ(output_2->is_loop_closure_, false);
+  EXPECT_EQ(output_2->nfg_.size(), 3);
+
+  // The verified loop closure is added by the next spinOnce (without
+  // detection, so that this keyframe does not queue a new candidate).
+  lcd_detector_->waitForPendingVerifications();
+  FLAGS_lcd_no_detection = true;
+  LcdOutput::Ptr output_3 = spinOnce(
+      *match2_stereo_frame_, timestamp_match2_, FrameId(3), W_match2_lmks3d_);
+  FLAGS_lcd_no_detection = false;
+
+  EXPECT_EQ(output_3->is_loop_closure_, true);
+  EXPECT_EQ(output_3->timestamp_, timestamp_match2_);
+  EXPECT_EQ(output_3->timestamp_query_, timestamp_query1_);
+  EXPECT_EQ(output_3->timestamp_match_, timestamp_match1_);
+  EXPECT_EQ(output_3->id_match_, 0);
+  EXPECT_EQ(output_3->id_recent_, 2);
+  EXPECT_EQ(output_3->states_.size(), 4);
+  EXPECT_EQ(lcd_detector_->getNrDroppedVerifications(), 0u);
+}
+
 TEST_F(LCDFixture, noRefinePosesInMono) {
   /* Make sure the LCD pipline fails if refine_poses_ is set to true in mono */
   ::testing::FLAGS_gtest_death_test_style = "threadsafe";
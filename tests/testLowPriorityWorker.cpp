@@ -0,0 +1,83 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testLowPriorityWorker.cpp
+ * @brief  test LowPriorityWorker
+ * @author Antoni Rosinol
+ */
+
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/utils/LowPriorityWorker.h"
+
+namespace VIO {
+
+/* ************************************************************************* */
+TEST(testLowPriorityWorker, runsJobsInOrder) {
+  utils::LowPriorityWorker worker("test_worker", 100u);
+  std::vector<int> results;
+  for (int i = 0; i < 20; ++i) {
+    // Only the worker thread touches results until waitUntilIdle returns.
+    EXPECT_TRUE(worker.addJob([&results, i]() { results.push_back(i); }));
+  }
+  worker.waitUntilIdle();
+  ASSERT_EQ(results.size(), 20u);
+  for (int i = 0; i < 20; ++i) EXPECT_EQ(results[i], i);
+  EXPECT_EQ(worker.getNrDroppedJobs(), 0u);
+}
+
+/* ************************************************************************* */
+TEST(testLowPriorityWorker, dropsJobsWhenFull) {
+  utils::LowPriorityWorker worker("test_worker", 2u);
+  std::promise<void> unblock;
+  std::shared_future<void> unblocked = unblock.get_future().share();
+  std::promise<void> started;
+  std::atomic<int> nr_run_jobs(0);
+
+  // Blocks the worker, so that the following jobs queue up.
+  EXPECT_TRUE(worker.addJob([&started, unblocked, &nr_run_jobs]() {
+    started.set_value();
+    unblocked.wait();
+    ++nr_run_jobs;
+  }));
+  started.get_future().wait();
+  EXPECT_TRUE(worker.addJob([&nr_run_jobs]() { ++nr_run_jobs; }));
+  EXPECT_TRUE(worker.addJob([&nr_run_jobs]() { ++nr_run_jobs; }));
+  EXPECT_FALSE(worker.addJob([&nr_run_jobs]() { ++nr_run_jobs; }));
+  EXPECT_EQ(worker.getNrDroppedJobs(), 1u);
+
+  unblock.set_value();
+  worker.waitUntilIdle();
+  EXPECT_EQ(nr_run_jobs, 3);
+
+  // There is room again.
+  EXPECT_TRUE(worker.addJob([&nr_run_jobs]() { ++nr_run_jobs; }));
+  worker.waitUntilIdle();
+  EXPECT_EQ(nr_run_jobs, 4);
+}
+
+/* ************************************************************************* */
+TEST(testLowPriorityWorker, destructorRunsQueuedJobs) {
+  std::atomic<int> nr_run_jobs(0);
+  {
+    utils::LowPriorityWorker worker("test_worker", 10u);
+    for (int i = 0; i < 10; ++i) {
+      worker.addJob([&nr_run_jobs]() { ++nr_run_jobs; });
+    }
+  }
+  EXPECT_EQ(nr_run_jobs, 10);
+}
+
+}  // namespace VIO
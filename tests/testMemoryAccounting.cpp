@@ -0,0 +1,85 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testMemoryAccounting.cpp
+ * @brief  test the memory gauges and their report
+ * @author Antoni Rosinol
+ */
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/utils/MemoryAccounting.h"
+
+namespace VIO {
+
+/* ************************************************************************* */
+TEST(testMemoryAccounting, gaugeKeepsLastAndPeak) {
+  utils::MemoryGauge gauge("test gauge");
+  EXPECT_EQ(gauge.get(), 0u);
+  gauge.set(2000000u);
+  gauge.set(3000000u);
+  gauge.set(1000000u);
+  EXPECT_EQ(gauge.get(), 1000000u);
+  EXPECT_EQ(gauge.getPeak(), 3000000u);
+  EXPECT_EQ(utils::Statistics::GetNumSamples("Memory test gauge [MB]"), 3u);
+  EXPECT_DOUBLE_EQ(utils::Statistics::GetMax("Memory test gauge [MB]"), 3.0);
+}
+
+/* ************************************************************************* */
+TEST(testMemoryAccounting, reportSumsGaugesWithSameTag) {
+  const std::string kTag = "test summed gauge";
+  auto gauge_a = std::make_unique<utils::MemoryGauge>(kTag);
+  auto gauge_b = std::make_unique<utils::MemoryGauge>(kTag);
+  gauge_a->set(1000000u);
+  gauge_b->set(2500000u);
+  std::string report = utils::MemoryAccounting::getInstance().print();
+  EXPECT_NE(report.find(kTag + "\t3.50\t3.50"), std::string::npos) << report;
+
+  gauge_b.reset();
+  report = utils::MemoryAccounting::getInstance().print();
+  EXPECT_NE(report.find(kTag + "\t1.00\t1.00"), std::string::npos) << report;
+  gauge_a.reset();
+  report = utils::MemoryAccounting::getInstance().print();
+  EXPECT_EQ(report.find(kTag), std::string::npos) << report;
+}
+
+/* ************************************************************************* */
+TEST(testMemoryAccounting, reportsQueuesUntilUnregistered) {
+  size_t high_water_mark = 7u;
+  const size_t id = utils::MemoryAccounting::getInstance().registerQueue(
+      "test_accounted_queue", [&high_water_mark] { return high_water_mark; });
+  std::string report = utils::MemoryAccounting::getInstance().print();
+  EXPECT_NE(report.find("test_accounted_queue\t7"), std::string::npos);
+  utils::MemoryAccounting::getInstance().unregisterQueue(id);
+  report = utils::MemoryAccounting::getInstance().print();
+  EXPECT_EQ(report.find("test_accounted_queue"), std::string::npos);
+}
+
+/* ************************************************************************* */
+TEST(testMemoryAccounting, containerBytes) {
+  std::vector<double> vector;
+  vector.reserve(100u);
+  EXPECT_EQ(utils::getVectorBytes(vector), 100u * sizeof(double));
+  std::unordered_map<int, double> map;
+  const size_t empty_bytes = utils::getUnorderedContainerBytes(map);
+  for (int i = 0; i < 100; ++i) map[i] = i;
+  EXPECT_GE(utils::getUnorderedContainerBytes(map),
+            empty_bytes + 100u * sizeof(std::pair<const int, double>));
+#ifdef __linux__
+  EXPECT_GT(utils::getResidentSetBytes(), 0u);
+#endif
+}
+
+}  // namespace VIO
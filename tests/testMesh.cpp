@@ -16,7 +16,19 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <set>
+#include <string>
+#include <vector>
+
 #include "kimera-vio/mesh/Mesh.h"
+#include "kimera-vio/mesh/MeshLog.h"
+#include "kimera-vio/utils/Timer.h"
 
 DECLARE_string(test_data_path);
 DECLARE_bool(display);
@@ -235,4 +247,422 @@ TEST_F(MeshFixture, addPolygonNominalMesh) {
   EXPECT_EQ(vertices_mesh.at<Vertex2D>(2, 0), Vertex2D(4.0, 7.0));
 }
 
+namespace {
+
+//! Adds the triangles of a grid of nr_rows x nr_cols vertices, with lmk ids
+//! starting at 1 and row-major.
+void addGridToMesh(const size_t& nr_rows,
+                   const size_t& nr_cols,
+                   Mesh2D* mesh_2d) {
+  CHECK_NOTNULL(mesh_2d);
+  const auto vertex = [&nr_cols](const size_t& row, const size_t& col) {
+    const LandmarkId lmk_id = 1 + row * nr_cols + col;
+    return Mesh2D::VertexType(
+        lmk_id, Vertex2D(static_cast<float>(col), static_cast<float>(row)));
+  };
+  for (size_t row = 0u; row + 1u < nr_rows; row++) {
+    for (size_t col = 0u; col + 1u < nr_cols; col++) {
+      mesh_2d->addPolygonToMesh({vertex(row, col),
+                                 vertex(row + 1u, col),
+                                 vertex(row, col + 1u)});
+      mesh_2d->addPolygonToMesh({vertex(row, col + 1u),
+                                 vertex(row + 1u, col),
+                                 vertex(row + 1u, col + 1u)});
+    }
+  }
+}
+
+}  // namespace
+
+TEST_F(MeshFixture, adjacentVertices) {
+  Mesh2D mesh_2d;
+  addGridToMesh(3u, 3u, &mesh_2d);
+  ASSERT_EQ(mesh_2d.getNumberOfUniqueVertices(), 9u);
+
+  // Consistent with the dense adjacency matrix, and sorted.
+  const cv::Mat adjacency_matrix = mesh_2d.getAdjacencyMatrix();
+  ASSERT_EQ(adjacency_matrix.rows, 9);
+  size_t nr_edges = 0u;
+  for (size_t v = 0u; v < 9u; v++) {
+    const Mesh2D::VertexIds& adjacent = mesh_2d.getAdjacentVertices(v);
+    EXPECT_TRUE(std::is_sorted(adjacent.begin(), adjacent.end()));
+    EXPECT_EQ(static_cast<size_t>(cv::countNonZero(adjacency_matrix.row(v))),
+              adjacent.size());
+    for (const Mesh2D::VertexId& u : adjacent) {
+      EXPECT_EQ(adjacency_matrix.at<uint8_t>(v, u), 1u);
+      EXPECT_EQ(adjacency_matrix.at<uint8_t>(u, v), 1u);
+    }
+    nr_edges += adjacent.size();
+  }
+  // 12 grid edges and 4 diagonals.
+  EXPECT_EQ(nr_edges, 2u * 16u);
+
+  // The center vertex (lmk 5) is adjacent to all but two corners.
+  Mesh2D::VertexId center_vtx_id;
+  ASSERT_TRUE(mesh_2d.getVtxIdForLmkId(5, &center_vtx_id));
+  EXPECT_EQ(mesh_2d.getAdjacentVertices(center_vtx_id).size(), 6u);
+
+  // Re-adding polygons changes nothing.
+  addGridToMesh(3u, 3u, &mesh_2d);
+  EXPECT_EQ(mesh_2d.getNumberOfPolygons(), 8u);
+  EXPECT_EQ(cv::countNonZero(mesh_2d.getAdjacencyMatrix() != adjacency_matrix),
+            0);
+
+  // Topology replaced: connectivity rebuilt.
+  cv::Mat polygons_mesh;
+  mesh_2d.getPolygonsMeshToMat(&polygons_mesh);
+  mesh_2d.setTopology(polygons_mesh.rowRange(0, 4));
+  EXPECT_EQ(mesh_2d.getNumberOfPolygons(), 1u);
+  EXPECT_EQ(cv::countNonZero(mesh_2d.getAdjacencyMatrix()), 6);
+}
+
+TEST_F(MeshFixture, removePolygons) {
+  Mesh2D mesh_2d;
+  addGridToMesh(4u, 4u, &mesh_2d);
+  ASSERT_EQ(mesh_2d.getNumberOfPolygons(), 18u);
+  ASSERT_EQ(mesh_2d.getNumberOfUniqueVertices(), 16u);
+
+  // Corner lmk 1 only has the first polygon.
+  mesh_2d.removePolygon(0u);
+  EXPECT_EQ(mesh_2d.getNumberOfPolygons(), 17u);
+  EXPECT_EQ(mesh_2d.getNumberOfUniqueVertices(), 15u);
+  EXPECT_FALSE(mesh_2d.getVertex(1));
+
+  // Inner lmk 6 has 6 polygons, its neighbours stay in the mesh.
+  EXPECT_EQ(mesh_2d.removePolygonsOfLmkId(6), 6u);
+  EXPECT_EQ(mesh_2d.removePolygonsOfLmkId(6), 0u);
+  EXPECT_EQ(mesh_2d.getNumberOfPolygons(), 11u);
+  EXPECT_EQ(mesh_2d.getNumberOfUniqueVertices(), 14u);
+
+  // Same as the mesh rebuilt from the remaining polygons.
+  Mesh2D rebuilt_mesh_2d;
+  for (size_t i = 0u; i < mesh_2d.getNumberOfPolygons(); i++) {
+    Mesh2D::Polygon polygon;
+    ASSERT_TRUE(mesh_2d.getPolygon(i, &polygon));
+    rebuilt_mesh_2d.addPolygonToMesh(polygon);
+  }
+  ASSERT_EQ(rebuilt_mesh_2d.getNumberOfUniqueVertices(),
+            mesh_2d.getNumberOfUniqueVertices());
+  const auto get_adjacent_lmk_ids = [](const Mesh2D& mesh,
+                                       const LandmarkId& lmk_id) {
+    Mesh2D::VertexId vtx_id;
+    CHECK(mesh.getVtxIdForLmkId(lmk_id, &vtx_id));
+    std::vector<LandmarkId> lmk_ids;
+    for (const Mesh2D::VertexId& adjacent : mesh.getAdjacentVertices(vtx_id)) {
+      LandmarkId adjacent_lmk_id;
+      CHECK(mesh.getLmkIdForVtxId(adjacent, &adjacent_lmk_id));
+      lmk_ids.push_back(adjacent_lmk_id);
+    }
+    std::sort(lmk_ids.begin(), lmk_ids.end());
+    return lmk_ids;
+  };
+  for (Mesh2D::VertexId vtx_id = 0u;
+       vtx_id < mesh_2d.getNumberOfUniqueVertices();
+       vtx_id++) {
+    LandmarkId lmk_id;
+    ASSERT_TRUE(mesh_2d.getLmkIdForVtxId(vtx_id, &lmk_id));
+    Mesh2D::VertexId lmk_vtx_id;
+    ASSERT_TRUE(mesh_2d.getVtxIdForLmkId(lmk_id, &lmk_vtx_id));
+    EXPECT_EQ(lmk_vtx_id, vtx_id);
+    const Mesh2D::VertexIds& adjacent = mesh_2d.getAdjacentVertices(vtx_id);
+    EXPECT_TRUE(std::is_sorted(adjacent.begin(), adjacent.end()));
+    EXPECT_EQ(get_adjacent_lmk_ids(mesh_2d, lmk_id),
+              get_adjacent_lmk_ids(rebuilt_mesh_2d, lmk_id));
+  }
+
+  // Face hashes updated: removed polygons can be re-added, others cannot.
+  Mesh2D::Polygon polygon;
+  ASSERT_TRUE(mesh_2d.getPolygon(0u, &polygon));
+  mesh_2d.addPolygonToMesh(polygon);
+  EXPECT_EQ(mesh_2d.getNumberOfPolygons(), 11u);
+  addGridToMesh(4u, 4u, &mesh_2d);
+  EXPECT_EQ(mesh_2d.getNumberOfPolygons(), 18u);
+  EXPECT_EQ(mesh_2d.getNumberOfUniqueVertices(), 16u);
+}
+
+TEST_F(MeshFixture, viewsAndSaveLoad) {
+  Mesh2D mesh_2d;
+  addGridToMesh(4u, 5u, &mesh_2d);
+
+  // Views share the data, until the mesh is modified.
+  cv::Mat vertices_view;
+  mesh_2d.getVerticesMeshToMat(&vertices_view, false);
+  cv::Mat vertices_view_2;
+  mesh_2d.getVerticesMeshToMat(&vertices_view_2, false);
+  EXPECT_EQ(vertices_view.data, vertices_view_2.data);
+  ASSERT_TRUE(mesh_2d.setVertexPosition(1, Vertex2D(-1.0f, -1.0f)));
+  EXPECT_EQ(vertices_view.at<Vertex2D>(0), Vertex2D(0.0f, 0.0f));
+  cv::Mat vertices_mesh;
+  mesh_2d.getVerticesMeshToMat(&vertices_mesh, false);
+  EXPECT_NE(vertices_mesh.data, vertices_view.data);
+  EXPECT_EQ(vertices_mesh.at<Vertex2D>(0), Vertex2D(-1.0f, -1.0f));
+
+  const std::string filepath = "/tmp/testMesh_viewsAndSaveLoad.yaml";
+  mesh_2d.save(filepath);
+  Mesh2D loaded_mesh_2d;
+  loaded_mesh_2d.load(filepath);
+  std::remove(filepath.c_str());
+
+  EXPECT_EQ(loaded_mesh_2d.getNumberOfPolygons(),
+            mesh_2d.getNumberOfPolygons());
+  EXPECT_EQ(loaded_mesh_2d.getLandmarkIds(), mesh_2d.getLandmarkIds());
+  EXPECT_EQ(cv::countNonZero(loaded_mesh_2d.getAdjacencyMatrix() !=
+                             mesh_2d.getAdjacencyMatrix()),
+            0);
+  // Faces are known: re-adding them does not duplicate them.
+  addGridToMesh(4u, 5u, &loaded_mesh_2d);
+  EXPECT_EQ(loaded_mesh_2d.getNumberOfPolygons(),
+            mesh_2d.getNumberOfPolygons());
+}
+
+TEST_F(MeshFixture, meshLogReplaysChanges) {
+  // Meshes of consecutive keyframes: moved and removed vertices, new faces.
+  std::vector<Mesh2D> meshes(1u);
+  addGridToMesh(4u, 4u, &meshes.back());
+  meshes.push_back(meshes.back());
+  ASSERT_TRUE(meshes.back().setVertexPosition(1, Vertex2D(-1.0f, -1.0f)));
+  ASSERT_EQ(meshes.back().removePolygonsOfLmkId(6), 6u);
+  meshes.push_back(meshes.back());
+  meshes.back().addPolygonToMesh(
+      {Mesh2D::VertexType(100, Vertex2D(10.0f, 0.0f)),
+       Mesh2D::VertexType(101, Vertex2D(10.0f, 1.0f)),
+       Mesh2D::VertexType(102, Vertex2D(11.0f, 0.0f))});
+
+  const std::string filepath = "/tmp/testMesh_meshLogReplaysChanges.kvml";
+  const std::string accumulated_filepath =
+      "/tmp/testMesh_meshLogReplaysChanges_accumulated.kvml";
+  {
+    MeshLogWriter mesh_log(filepath, 2u);
+    MeshLogWriter accumulated_mesh_log(accumulated_filepath, 2u, 3u, false);
+    for (size_t i = 0u; i < meshes.size(); i++) {
+      mesh_log.append(meshes[i], static_cast<Timestamp>(i));
+      accumulated_mesh_log.append(meshes[i], static_cast<Timestamp>(i));
+    }
+  }
+
+  const auto get_faces = [](const Mesh2D& mesh) {
+    std::set<std::array<LandmarkId, 3>> faces;
+    for (size_t i = 0u; i < mesh.getNumberOfPolygons(); i++) {
+      Mesh2D::Polygon polygon;
+      CHECK(mesh.getPolygon(i, &polygon));
+      faces.insert({polygon[0].getLmkId(),
+                    polygon[1].getLmkId(),
+                    polygon[2].getLmkId()});
+    }
+    return faces;
+  };
+  const MeshLogReader mesh_log(filepath);
+  ASSERT_TRUE(mesh_log.isValid());
+  ASSERT_EQ(mesh_log.getNrChunks(), meshes.size());
+  for (size_t i = 0u; i < meshes.size(); i++) {
+    EXPECT_EQ(mesh_log.getTimestamp(i), static_cast<Timestamp>(i));
+    Mesh2D replayed_mesh;
+    mesh_log.getMesh(i + 1u, &replayed_mesh);
+    EXPECT_EQ(get_faces(replayed_mesh), get_faces(meshes[i]));
+    ASSERT_EQ(replayed_mesh.getNumberOfUniqueVertices(),
+              meshes[i].getNumberOfUniqueVertices());
+    for (const LandmarkId& lmk_id : meshes[i].getLandmarkIds()) {
+      Mesh2D::VertexType vertex, replayed_vertex;
+      ASSERT_TRUE(meshes[i].getVertex(lmk_id, &vertex));
+      ASSERT_TRUE(replayed_mesh.getVertex(lmk_id, &replayed_vertex));
+      EXPECT_EQ(replayed_vertex.getVertexPosition(),
+                vertex.getVertexPosition());
+    }
+  }
+
+  // Removed vertices and faces stay in the accumulated mesh.
+  const MeshLogReader accumulated_mesh_log(accumulated_filepath);
+  ASSERT_TRUE(accumulated_mesh_log.isValid());
+  Mesh2D accumulated_mesh;
+  accumulated_mesh_log.getMesh(meshes.size(), &accumulated_mesh);
+  EXPECT_TRUE(accumulated_mesh.isLmkIdInMesh(6));
+  EXPECT_TRUE(accumulated_mesh.isLmkIdInMesh(100));
+  EXPECT_EQ(accumulated_mesh.getNumberOfPolygons(), 19u);
+
+  // A chunk cut short is ignored.
+  std::filesystem::resize_file(filepath,
+                               std::filesystem::file_size(filepath) - 1u);
+  const MeshLogReader truncated_mesh_log(filepath);
+  ASSERT_TRUE(truncated_mesh_log.isValid());
+  EXPECT_EQ(truncated_mesh_log.getNrChunks(), meshes.size() - 1u);
+  std::remove(filepath.c_str());
+  std::remove(accumulated_filepath.c_str());
+}
+
+TEST_F(MeshFixture, copyOnWrite) {
+  Mesh2D mesh_2d;
+  addGridToMesh(3u, 4u, &mesh_2d);
+
+  // Copies share the data.
+  Mesh2D snapshot = mesh_2d;
+  Mesh2D snapshot_2(snapshot);
+  cv::Mat vertices_mesh, snapshot_vertices_mesh;
+  mesh_2d.getVerticesMeshToMat(&vertices_mesh, false);
+  snapshot.getVerticesMeshToMat(&snapshot_vertices_mesh, false);
+  EXPECT_EQ(vertices_mesh.data, snapshot_vertices_mesh.data);
+
+  // Modifying the mesh does not modify its snapshots.
+  ASSERT_TRUE(mesh_2d.setVertexPosition(1, Vertex2D(-1.0f, -1.0f)));
+  mesh_2d.addPolygonToMesh({Mesh2D::VertexType(100, Vertex2D(10.0f, 0.0f)),
+                            Mesh2D::VertexType(101, Vertex2D(10.0f, 1.0f)),
+                            Mesh2D::VertexType(102, Vertex2D(11.0f, 0.0f))});
+  EXPECT_EQ(mesh_2d.getNumberOfPolygons(), 13u);
+  EXPECT_EQ(mesh_2d.getNumberOfUniqueVertices(), 15u);
+  for (const Mesh2D* mesh : {&snapshot, &snapshot_2}) {
+    EXPECT_EQ(mesh->getNumberOfPolygons(), 12u);
+    EXPECT_EQ(mesh->getNumberOfUniqueVertices(), 12u);
+    EXPECT_FALSE(mesh->isLmkIdInMesh(100));
+    Mesh2D::VertexType vertex;
+    ASSERT_TRUE(mesh->getVertex(1, &vertex));
+    EXPECT_EQ(vertex.getVertexPosition(), Vertex2D(0.0f, 0.0f));
+  }
+
+  // Nor the other way around.
+  snapshot.clearMesh();
+  EXPECT_EQ(snapshot.getNumberOfPolygons(), 0u);
+  EXPECT_EQ(snapshot_2.getNumberOfPolygons(), 12u);
+
+  // Moved meshes are left empty.
+  Mesh2D moved(std::move(snapshot_2));
+  EXPECT_EQ(moved.getNumberOfPolygons(), 12u);
+  EXPECT_EQ(snapshot_2.getNumberOfPolygons(), 0u);
+  snapshot = std::move(moved);
+  EXPECT_EQ(snapshot.getNumberOfPolygons(), 12u);
+  EXPECT_EQ(moved.getNumberOfUniqueVertices(), 0u);
+}
+
+TEST_F(MeshFixture, addPolygonsLongTimeHorizon) {
+  // A dense adjacency matrix of these vertices would take 10 GB.
+  const size_t nr_rows = 100u;
+  const size_t nr_cols = 1000u;
+  Mesh2D mesh_2d;
+  const auto tic = utils::Timer::tic();
+  addGridToMesh(nr_rows, nr_cols, &mesh_2d);
+  LOG(INFO) << "Added " << mesh_2d.getNumberOfPolygons() << " polygons with "
+            << mesh_2d.getNumberOfUniqueVertices() << " vertices in "
+            << utils::Timer::toc<std::chrono::milliseconds>(tic).count()
+            << " ms.";
+  EXPECT_EQ(mesh_2d.getNumberOfUniqueVertices(), nr_rows * nr_cols);
+  EXPECT_EQ(mesh_2d.getNumberOfPolygons(),
+            2u * (nr_rows - 1u) * (nr_cols - 1u));
+}
+
+TEST_F(MeshFixture, computePerVertexNormals) {
+  // Grid on the surface z = 0.1 * sin(x) * cos(y).
+  const size_t nr_rows = 60u;
+  const size_t nr_cols = 60u;
+  const auto vertex = [&nr_cols](const size_t& row, const size_t& col) {
+    const float x = 0.1f * col;
+    const float y = 0.1f * row;
+    return Mesh3D::VertexType(
+        1 + row * nr_cols + col,
+        Vertex3D(x, y, 0.1f * std::sin(x) * std::cos(y)));
+  };
+  Mesh3D serial_mesh;
+  for (size_t row = 0u; row + 1u < nr_rows; row++) {
+    for (size_t col = 0u; col + 1u < nr_cols; col++) {
+      serial_mesh.addPolygonToMesh(
+          {vertex(row, col), vertex(row + 1u, col), vertex(row, col + 1u)});
+      serial_mesh.addPolygonToMesh({vertex(row, col + 1u),
+                                    vertex(row + 1u, col),
+                                    vertex(row + 1u, col + 1u)});
+    }
+  }
+  Mesh3D parallel_mesh = serial_mesh;
+
+  auto tic = utils::Timer::tic();
+  serial_mesh.computePerVertexNormals(1);
+  const auto serial_us =
+      utils::Timer::toc<std::chrono::microseconds>(tic).count();
+  tic = utils::Timer::tic();
+  parallel_mesh.computePerVertexNormals(4);
+  const auto parallel_us =
+      utils::Timer::toc<std::chrono::microseconds>(tic).count();
+  LOG(INFO) << "Per-vertex normals of " << serial_mesh.getNumberOfPolygons()
+            << " polygons: serial " << serial_us << " us, parallel "
+            << parallel_us << " us.";
+
+  Mesh3D::VertexType serial_vertex;
+  Mesh3D::VertexType parallel_vertex;
+  for (size_t row = 0u; row < nr_rows; row++) {
+    for (size_t col = 0u; col < nr_cols; col++) {
+      const LandmarkId lmk_id = vertex(row, col).getLmkId();
+      ASSERT_TRUE(serial_mesh.getVertex(lmk_id, &serial_vertex));
+      ASSERT_TRUE(parallel_mesh.getVertex(lmk_id, &parallel_vertex));
+      const Mesh3D::VertexNormal& normal = serial_vertex.getVertexNormal();
+      EXPECT_EQ(normal, parallel_vertex.getVertexNormal());
+      EXPECT_NEAR(cv::norm(normal), 1.0, 1e-5);
+      // Close to the analytical normal of the (nearly flat) surface.
+      const float x = 0.1f * col;
+      const float y = 0.1f * row;
+      cv::Point3f expected(-0.1f * std::cos(x) * std::cos(y),
+                           0.1f * std::sin(x) * std::sin(y),
+                           1.0f);
+      expected /= cv::norm(expected);
+      EXPECT_GT(std::fabs(normal.ddot(expected)), 0.99);
+    }
+  }
+}
+
+TEST_F(MeshFixture, vertexNormalsAreMaintainedIncrementally) {
+  // Grid on the surface z = 0.1 * sin(x) * cos(y).
+  const size_t nr_rows = 20u;
+  const size_t nr_cols = 20u;
+  const auto vertex = [&nr_cols](const size_t& row,
+                                 const size_t& col,
+                                 const float& z_offset = 0.0f) {
+    const float x = 0.1f * col;
+    const float y = 0.1f * row;
+    return Mesh3D::VertexType(
+        1 + row * nr_cols + col,
+        Vertex3D(x, y, 0.1f * std::sin(x) * std::cos(y) + z_offset));
+  };
+  Mesh3D mesh;
+  for (size_t row = 0u; row + 1u < nr_rows; row++) {
+    for (size_t col = 0u; col + 1u < nr_cols; col++) {
+      mesh.addPolygonToMesh(
+          {vertex(row, col), vertex(row + 1u, col), vertex(row, col + 1u)});
+      mesh.addPolygonToMesh({vertex(row, col + 1u),
+                             vertex(row + 1u, col),
+                             vertex(row + 1u, col + 1u)});
+    }
+  }
+  // Remove some polygons, move some vertices (directly, and by adding again
+  // their polygons with other positions).
+  for (size_t polygon_idx = 0u; polygon_idx < 50u; polygon_idx++) {
+    mesh.removePolygon(polygon_idx * 3u);
+  }
+  const Mesh3D::VertexType moved_vertex = vertex(10u, 10u, 0.2f);
+  EXPECT_TRUE(mesh.setVertexPosition(moved_vertex.getLmkId(),
+                                     moved_vertex.getVertexPosition()));
+  mesh.addPolygonToMesh(
+      {vertex(5u, 5u, -0.1f), vertex(6u, 5u), vertex(5u, 6u, 0.1f)});
+
+  Mesh3D recomputed_mesh = mesh;
+  recomputed_mesh.computePerVertexNormals();
+  // Calling it again is fine.
+  recomputed_mesh.computePerVertexNormals();
+
+  const LandmarkIds lmk_ids = mesh.getLandmarkIds();
+  ASSERT_EQ(lmk_ids.size(), recomputed_mesh.getNumberOfUniqueVertices());
+  Mesh3D::VertexType incremental_vertex;
+  Mesh3D::VertexType recomputed_vertex;
+  for (const LandmarkId& lmk_id : lmk_ids) {
+    ASSERT_TRUE(mesh.getVertex(lmk_id, &incremental_vertex));
+    ASSERT_TRUE(recomputed_mesh.getVertex(lmk_id, &recomputed_vertex));
+    const Mesh3D::VertexNormal& normal = incremental_vertex.getVertexNormal();
+    EXPECT_NEAR(cv::norm(normal), 1.0, 1e-5);
+    EXPECT_NEAR(
+        cv::norm(normal - recomputed_vertex.getVertexNormal()), 0.0, 1e-5);
+  }
+
+  // The normal of a vertex of a single triangle is the triangle's normal.
+  Mesh3D triangle_mesh;
+  triangle_mesh.addPolygonToMesh({Mesh3D::VertexType(1, Vertex3D(0, 0, 0)),
+                                  Mesh3D::VertexType(2, Vertex3D(0, 1, 0)),
+                                  Mesh3D::VertexType(3, Vertex3D(1, 0, 0))});
+  ASSERT_TRUE(triangle_mesh.getVertex(1, &incremental_vertex));
+  EXPECT_NEAR(incremental_vertex.getVertexNormal().z, 1.0, 1e-6);
+}
+
 }  // namespace VIO
@@ -0,0 +1,92 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testMeshColorCache.cpp
+ * @brief  test MeshColorCache only recolors the vertices that changed
+ * @author Antoni Rosinol
+ */
+
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/visualizer/MeshColorCache.h"
+
+namespace VIO {
+
+namespace {
+const cv::Vec3b kGray(128, 128, 128);
+const cv::Vec3b kRed(0, 0, 255);
+const cv::Vec3b kGreen(0, 255, 0);
+
+//! Triangles [0 1 2], [1 2 3], [2 3 4], ... over nr_vertices.
+cv::Mat makeStrip(const int& nr_vertices) {
+  cv::Mat polygons_mesh(0, 1, CV_32SC1);
+  for (int i = 0; i + 2 < nr_vertices; ++i) {
+    polygons_mesh.push_back(3);
+    polygons_mesh.push_back(i);
+    polygons_mesh.push_back(i + 1);
+    polygons_mesh.push_back(i + 2);
+  }
+  return polygons_mesh;
+}
+
+void expectColors(const std::vector<cv::Vec3b>& expected,
+                  const MeshColorCache& cache) {
+  const cv::Mat& colors = cache.getColors();
+  ASSERT_EQ(colors.rows, static_cast<int>(expected.size()));
+  ASSERT_EQ(colors.type(), CV_8UC3);
+  for (int i = 0; i < colors.rows; ++i) {
+    EXPECT_EQ(colors.at<cv::Vec3b>(i), expected[i]) << "vertex " << i;
+  }
+}
+}  // namespace
+
+TEST(testMeshColorCache, recolorsOnlyChangedVertices) {
+  MeshColorCache cache(kGray);
+  const cv::Mat polygons_mesh = makeStrip(5);
+
+  cache.startFrame(5u);
+  cache.setTrianglesColor({0}, polygons_mesh, kRed);
+  EXPECT_EQ(cache.finishFrame(), 5u);
+  expectColors({kRed, kRed, kRed, kGray, kGray}, cache);
+
+  // Same clusters: nothing to recolor.
+  cache.startFrame(5u);
+  cache.setTrianglesColor({0}, polygons_mesh, kRed);
+  EXPECT_EQ(cache.finishFrame(), 0u);
+  expectColors({kRed, kRed, kRed, kGray, kGray}, cache);
+
+  // The last cluster having a vertex wins, vertices left become gray.
+  cache.startFrame(5u);
+  cache.setTrianglesColor({1}, polygons_mesh, kRed);
+  cache.setTrianglesColor({2}, polygons_mesh, kGreen);
+  EXPECT_EQ(cache.finishFrame(), 3u);
+  expectColors({kGray, kRed, kGreen, kGreen, kGreen}, cache);
+}
+
+TEST(testMeshColorCache, resizes) {
+  MeshColorCache cache(kGray);
+  cache.startFrame(3u);
+  cache.setTrianglesColor({0}, makeStrip(3), kRed);
+  EXPECT_EQ(cache.finishFrame(), 3u);
+
+  // Added vertices are always written.
+  cache.startFrame(5u);
+  cache.setTrianglesColor({0}, makeStrip(5), kRed);
+  EXPECT_EQ(cache.finishFrame(), 2u);
+  expectColors({kRed, kRed, kRed, kGray, kGray}, cache);
+
+  cache.startFrame(2u);
+  EXPECT_EQ(cache.finishFrame(), 2u);
+  expectColors({kGray, kGray}, cache);
+}
+
+}  // namespace VIO
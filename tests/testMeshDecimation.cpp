@@ -0,0 +1,143 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testMeshDecimation.cpp
+ * @brief  test MeshDecimator
+ * @author Antoni Rosinol
+ */
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include "kimera-vio/mesh/Mesh.h"
+#include "kimera-vio/mesh/MeshDecimation.h"
+
+namespace VIO {
+
+namespace {
+//! Planar grid of n x n vertices (z = 0), with the given spacing. The vertex
+//! (i, j) has landmark id i * n + j.
+Mesh3D makeGridMesh(const size_t& n, const float& spacing) {
+  Mesh3D mesh;
+  const auto vertex = [&n, &spacing](const size_t& i, const size_t& j) {
+    return Mesh3D::VertexType(static_cast<LandmarkId>(i * n + j),
+                              Vertex3D(i * spacing, j * spacing, 0.0f));
+  };
+  for (size_t i = 0u; i + 1u < n; ++i) {
+    for (size_t j = 0u; j + 1u < n; ++j) {
+      mesh.addPolygonToMesh(
+          {vertex(i, j), vertex(i + 1u, j), vertex(i + 1u, j + 1u)});
+      mesh.addPolygonToMesh(
+          {vertex(i, j), vertex(i + 1u, j + 1u), vertex(i, j + 1u)});
+    }
+  }
+  return mesh;
+}
+}  // namespace
+
+TEST(MeshDecimation, DecimatesPlanarMeshKeepingBorder) {
+  static constexpr size_t n = 10u;
+  const Mesh3D mesh = makeGridMesh(n, 0.1f);
+  ASSERT_EQ(mesh.getNumberOfPolygons(), 2u * (n - 1u) * (n - 1u));
+
+  MeshDecimationParams params;
+  params.cell_size_ = 10.0;
+  params.target_ratio_ = 0.3;
+  MeshDecimator decimator(params);
+  const Mesh3D& coarse_mesh = decimator.update(mesh);
+  EXPECT_EQ(decimator.getNrCells(), 1u);
+  EXPECT_EQ(decimator.getNrDecimatedCells(), 1u);
+  EXPECT_LT(coarse_mesh.getNumberOfPolygons(), mesh.getNumberOfPolygons());
+  EXPECT_LT(coarse_mesh.getNumberOfUniqueVertices(),
+            mesh.getNumberOfUniqueVertices());
+
+  // A plane has no quadric error: the vertices stay on it, and the border of
+  // the mesh is kept.
+  for (size_t polygon_idx = 0u; polygon_idx < coarse_mesh.getNumberOfPolygons();
+       ++polygon_idx) {
+    for (size_t j = 0u; j < 3u; ++j) {
+      EXPECT_NEAR(
+          coarse_mesh.getPolygonVertexPosition(polygon_idx, j).z, 0.0f, 1e-6);
+    }
+  }
+  for (size_t i = 0u; i < n; ++i) {
+    for (const LandmarkId& lmk_id :
+         {static_cast<LandmarkId>(i),
+          static_cast<LandmarkId>((n - 1u) * n + i),
+          static_cast<LandmarkId>(i * n),
+          static_cast<LandmarkId>(i * n + n - 1u)}) {
+      EXPECT_TRUE(coarse_mesh.isLmkIdInMesh(lmk_id)) << lmk_id;
+    }
+  }
+
+  // Same area, no triangle flipped.
+  double area = 0.0;
+  for (size_t polygon_idx = 0u; polygon_idx < coarse_mesh.getNumberOfPolygons();
+       ++polygon_idx) {
+    const Vertex3D& a = coarse_mesh.getPolygonVertexPosition(polygon_idx, 0u);
+    const Vertex3D& b = coarse_mesh.getPolygonVertexPosition(polygon_idx, 1u);
+    const Vertex3D& c = coarse_mesh.getPolygonVertexPosition(polygon_idx, 2u);
+    const float cross_z = (b - a).cross(c - a).z;
+    EXPECT_GT(cross_z, 0.0f);
+    area += 0.5 * cross_z;
+  }
+  EXPECT_NEAR(area, 0.81, 1e-4);
+}
+
+TEST(MeshDecimation, OnlyChangedCellsAreDecimated) {
+  // 4 cells of 1m: x and y in [0, 1.8].
+  Mesh3D mesh = makeGridMesh(10u, 0.2f);
+  MeshDecimationParams params;
+  params.cell_size_ = 1.0;
+  MeshDecimator decimator(params);
+  decimator.update(mesh);
+  EXPECT_EQ(decimator.getNrCells(), 4u);
+  EXPECT_EQ(decimator.getNrDecimatedCells(), 4u);
+  const size_t nr_polygons = decimator.getCoarseMesh().getNumberOfPolygons();
+
+  // Nothing changed.
+  decimator.update(mesh);
+  EXPECT_EQ(decimator.getNrDecimatedCells(), 0u);
+  EXPECT_EQ(decimator.getCoarseMesh().getNumberOfPolygons(), nr_polygons);
+
+  // Vertex (2, 2), at (0.4, 0.4), only has triangles in the first cell.
+  ASSERT_TRUE(mesh.setVertexPosition(22, Vertex3D(0.4f, 0.4f, 0.1f)));
+  decimator.update(mesh);
+  EXPECT_EQ(decimator.getNrCells(), 4u);
+  EXPECT_EQ(decimator.getNrDecimatedCells(), 1u);
+
+  // Removing the cells' triangles removes them from the coarse mesh.
+  mesh.clearMesh();
+  decimator.update(mesh);
+  EXPECT_EQ(decimator.getNrCells(), 0u);
+  EXPECT_EQ(decimator.getCoarseMesh().getNumberOfPolygons(), 0u);
+}
+
+TEST(MeshDecimation, BumpIsKept) {
+  // Collapsing the edges of the tip of a bump has a large error.
+  static constexpr size_t n = 11u;
+  static constexpr LandmarkId tip_lmk_id = 5 * n + 5;
+  Mesh3D mesh = makeGridMesh(n, 0.1f);
+  ASSERT_TRUE(mesh.setVertexPosition(tip_lmk_id, Vertex3D(0.5f, 0.5f, 0.5f)));
+  MeshDecimationParams params;
+  params.cell_size_ = 10.0;
+  params.target_ratio_ = 0.01;
+  params.max_error_ = 1e-6;
+  MeshDecimator decimator(params);
+  const Mesh3D& coarse_mesh = decimator.update(mesh);
+  EXPECT_LT(coarse_mesh.getNumberOfPolygons(), mesh.getNumberOfPolygons());
+  Mesh3D::VertexType tip;
+  ASSERT_TRUE(coarse_mesh.getVertex(tip_lmk_id, &tip));
+  EXPECT_NEAR(tip.getVertexPosition().z, 0.5f, 1e-6);
+}
+
+}  // namespace VIO
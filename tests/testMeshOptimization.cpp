@@ -186,4 +186,71 @@ TEST_F(MeshOptimizationFixture, DISABLED_testCollectTriangleDataPointsFast) {
   }
 }
 
+TEST_F(MeshOptimizationFixture, IncrementalSameAsBatch) {
+  CameraParams camera_params;
+  camera_params.parseYAML(FLAGS_test_data_path +
+                          "/EurocParams/LeftCameraParams.yaml");
+  camera_params.body_Pose_cam_ = gtsam::Pose3();
+  camera_params.image_size_ = cv::Size(120, 90);
+  Camera::ConstPtr mono_camera = std::make_unique<Camera>(camera_params);
+
+  // 2d mesh: a grid of vertices, two triangles per cell.
+  Mesh2D mesh_2d;
+  static constexpr int kStep = 29;
+  const auto vertex = [](const int& i, const int& j) {
+    return Mesh2D::VertexType(10 * i + j, Vertex2D(kStep * i, kStep * j));
+  };
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      mesh_2d.addPolygonToMesh(
+          {vertex(i, j), vertex(i + 1, j), vertex(i + 1, j + 1)});
+      mesh_2d.addPolygonToMesh(
+          {vertex(i, j), vertex(i + 1, j + 1), vertex(i, j + 1)});
+    }
+  }
+
+  MeshOptimization batch(MeshOptimizerType::kGtsamMesh,
+                         MeshColorType::kVertexFlatColor,
+                         mono_camera);
+  MeshOptimization incremental(MeshOptimizerType::kIncrementalMesh,
+                               MeshColorType::kVertexFlatColor,
+                               mono_camera);
+  // A slanted plane that moves away from the camera: the second frames are
+  // warm-started with the solution of the previous ones.
+  for (size_t frame = 0u; frame < 3u; ++frame) {
+    MeshOptimizationInput input;
+    input.pcl = cv::Mat(camera_params.image_size_, CV_32FC3);
+    input.pcl_colors = cv::Mat(camera_params.image_size_, CV_8UC3);
+    for (int v = 0; v < input.pcl.rows; ++v) {
+      for (int u = 0; u < input.pcl.cols; ++u) {
+        LandmarkCV lmk;
+        mono_camera->backProject(
+            KeypointCV(u, v), 2.0 + 0.1 * frame + 0.005 * u, &lmk);
+        input.pcl.at<cv::Point3f>(v, u) = lmk;
+      }
+    }
+    input.mesh_2d = mesh_2d;
+
+    const MeshOptimizationOutput::UniquePtr batch_output =
+        batch.spinOnce(input);
+    const MeshOptimizationOutput::UniquePtr incremental_output =
+        incremental.spinOnce(input);
+    ASSERT_TRUE(batch_output);
+    ASSERT_TRUE(incremental_output);
+    const Mesh3D& batch_mesh = batch_output->optimized_mesh_3d;
+    const Mesh3D& incremental_mesh = incremental_output->optimized_mesh_3d;
+    ASSERT_EQ(batch_mesh.getNumberOfPolygons(), mesh_2d.getNumberOfPolygons());
+    ASSERT_EQ(incremental_mesh.getNumberOfPolygons(),
+              mesh_2d.getNumberOfPolygons());
+
+    cv::Mat batch_vertices, incremental_vertices;
+    batch_mesh.getVerticesMeshToMat(&batch_vertices);
+    incremental_mesh.getVerticesMeshToMat(&incremental_vertices);
+    ASSERT_EQ(batch_vertices.rows, incremental_vertices.rows);
+    EXPECT_LT(cv::norm(batch_vertices, incremental_vertices, cv::NORM_INF),
+              1e-3)
+        << "Frame " << frame;
+  }
+}
+
 }  // namespace VIO
@@ -16,10 +16,16 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <set>
+#include <utility>
+
 #include <opencv2/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
+#include "kimera-vio/mesh/MeshOptimization.h"
 #include "kimera-vio/mesh/MeshUtils.h"
+#include "kimera-vio/utils/Timer.h"
 
 DECLARE_string(test_data_path);
 DECLARE_bool(display);
@@ -162,4 +168,61 @@ TEST_F(MeshUtilsFixture, testRayIntersectAlgorithm) {
   delete[] bary_framebuffer;
 }
 
+TEST(MeshUtils, rasterizeTriangle) {
+  using Pixels = std::set<std::pair<int32_t, int32_t>>;
+  const cv::Size img_size(752, 480);
+  cv::RNG rng(5);
+  double raster_us = 0.0;
+  double bbox_us = 0.0;
+  for (size_t i = 0u; i < 2000u; ++i) {
+    // Random triangles, partially out of the image, small, and with pixel
+    // aligned, horizontal or collinear vertices.
+    KeypointCV v1(rng.uniform(-50.f, 800.f), rng.uniform(-50.f, 530.f));
+    const float size = i % 2u == 0u ? 800.f : 20.f;
+    KeypointCV v2 = v1 + KeypointCV(rng.uniform(-size, size),
+                                    rng.uniform(-size, size));
+    KeypointCV v3 = v1 + KeypointCV(rng.uniform(-size, size),
+                                    rng.uniform(-size, size));
+    if (i % 5u == 1u) {
+      v1 = KeypointCV(std::round(v1.x), std::round(v1.y));
+      v2 = KeypointCV(std::round(v2.x), v1.y);
+      v3 = KeypointCV(std::round(v3.x), std::round(v3.y));
+    } else if (i % 5u == 3u) {
+      v3 = v1 + 0.5f * (v2 - v1);
+    }
+
+    Pixels raster_pixels;
+    auto tic = utils::Timer::tic();
+    rasterizeTriangle(
+        v1, v2, v3, img_size, [&raster_pixels](const int32_t& u,
+                                               const int32_t& v) {
+          raster_pixels.emplace(u, v);
+        });
+    raster_us += utils::Timer::toc<std::chrono::microseconds>(tic).count();
+
+    // Same pixels as testing all pixels of the bounding box.
+    Pixels bbox_pixels;
+    tic = utils::Timer::tic();
+    const int32_t x0 = std::max(0, cvFloor(min3(v1.x, v2.x, v3.x)));
+    const int32_t x1 =
+        std::min(img_size.width - 1, cvFloor(max3(v1.x, v2.x, v3.x)));
+    const int32_t y0 = std::max(0, cvFloor(min3(v1.y, v2.y, v3.y)));
+    const int32_t y1 =
+        std::min(img_size.height - 1, cvFloor(max3(v1.y, v2.y, v3.y)));
+    for (int32_t v = y0; v <= y1; ++v) {
+      for (int32_t u = x0; u <= x1; ++u) {
+        if (MeshOptimization::pointInTriangle(
+                KeypointCV(u, v), v1, v2, v3)) {
+          bbox_pixels.emplace(u, v);
+        }
+      }
+    }
+    bbox_us += utils::Timer::toc<std::chrono::microseconds>(tic).count();
+    ASSERT_EQ(raster_pixels, bbox_pixels)
+        << "Triangle " << v1 << ", " << v2 << ", " << v3;
+  }
+  LOG(INFO) << "Pixels of 2000 triangles: rasterization " << raster_us
+            << " us, bounding box " << bbox_us << " us.";
+}
+
 }  // namespace VIO
@@ -0,0 +1,119 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testMetricsExporter.cpp
+ * @brief  test the metrics served in Prometheus format
+ * @author Antoni Rosinol
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/utils/MemoryAccounting.h"
+#include "kimera-vio/utils/MetricsExporter.h"
+#include "kimera-vio/utils/Statistics.h"
+
+namespace VIO {
+
+namespace {
+//! Sends the request to the exporter, returns the whole response.
+std::string request(const int& port, const std::string& request) {
+  const int socket_fd = socket(AF_INET, SOCK_STREAM, 0);
+  CHECK_GE(socket_fd, 0);
+  sockaddr_in address;
+  std::memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(static_cast<uint16_t>(port));
+  CHECK_EQ(connect(socket_fd,
+                   reinterpret_cast<const sockaddr*>(&address),
+                   sizeof(address)),
+           0);
+  CHECK_EQ(send(socket_fd, request.data(), request.size(), 0),
+           static_cast<ssize_t>(request.size()));
+  std::string response;
+  char buffer[1024];
+  ssize_t size = 0;
+  while ((size = recv(socket_fd, buffer, sizeof(buffer), 0)) > 0) {
+    response.append(buffer, static_cast<size_t>(size));
+  }
+  close(socket_fd);
+  return response;
+}
+
+bool contains(const std::string& text, const std::string& line) {
+  return text.find(line) != std::string::npos;
+}
+}  // namespace
+
+/* ************************************************************************* */
+TEST(testMetricsExporter, printsStatisticsAsSummaries) {
+  utils::StatsCollector stats("Metrics test \"quoted\" [ms]");
+  // Quantiles are exact (the min and max) if all the samples are equal.
+  for (int i = 0; i < 100; ++i) stats.AddSample(8.0);
+  utils::MemoryGauge gauge("metrics test gauge");
+  gauge.set(1234u);
+
+  const std::string metrics = utils::MetricsExporter::printMetrics();
+  const std::string label = "{tag=\"Metrics test \\\"quoted\\\" [ms]\"";
+  EXPECT_TRUE(contains(metrics, "# TYPE kimera_vio_statistic summary\n"));
+  EXPECT_TRUE(contains(
+      metrics, "kimera_vio_statistic" + label + ",quantile=\"0.5\"} 8\n"))
+      << metrics;
+  EXPECT_TRUE(contains(
+      metrics, "kimera_vio_statistic" + label + ",quantile=\"0.99\"} 8\n"))
+      << metrics;
+  EXPECT_TRUE(
+      contains(metrics, "kimera_vio_statistic_sum" + label + "} 800\n"))
+      << metrics;
+  EXPECT_TRUE(
+      contains(metrics, "kimera_vio_statistic_count" + label + "} 100\n"))
+      << metrics;
+  EXPECT_TRUE(
+      contains(metrics, "kimera_vio_statistic_last" + label + "} 8\n"))
+      << metrics;
+  EXPECT_TRUE(
+      contains(metrics, "kimera_vio_statistic_max" + label + "} 8\n"))
+      << metrics;
+  EXPECT_TRUE(contains(
+      metrics, "kimera_vio_memory_bytes{tag=\"metrics test gauge\"} 1234\n"))
+      << metrics;
+  EXPECT_TRUE(contains(metrics, "kimera_vio_resident_set_bytes "));
+}
+
+/* ************************************************************************* */
+TEST(testMetricsExporter, servesMetricsOverHttp) {
+  utils::StatsCollector stats("Metrics test served [#]");
+  stats.AddSample(3.0);
+  utils::MetricsExporter exporter(0);
+  ASSERT_GT(exporter.getPort(), 0);
+
+  const std::string response = request(
+      exporter.getPort(), "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n");
+  EXPECT_EQ(response.find("HTTP/1.1 200 OK\r\n"), 0u) << response;
+  EXPECT_TRUE(contains(response, "text/plain; version=0.0.4"));
+  EXPECT_TRUE(contains(
+      response,
+      "kimera_vio_statistic_last{tag=\"Metrics test served [#]\"} 3\n"))
+      << response;
+
+  const std::string not_found =
+      request(exporter.getPort(), "GET / HTTP/1.1\r\n\r\n");
+  EXPECT_EQ(not_found.find("HTTP/1.1 404 Not Found\r\n"), 0u) << not_found;
+}
+
+}  // namespace VIO
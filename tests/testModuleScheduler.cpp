@@ -0,0 +1,183 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testModuleScheduler.cpp
+ * @brief  test ModuleScheduler
+ * @author Antoni Rosinol
+ */
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/pipeline/ModuleScheduler.h"
+
+namespace VIO {
+
+//! Module doing one unit of work per spin, as when running sequentially.
+class DummyModule : public PipelineModuleBase {
+ public:
+  DummyModule(const std::string& name,
+              std::atomic<size_t>* nr_running_background = nullptr,
+              const std::chrono::milliseconds& work_duration =
+                  std::chrono::milliseconds(1))
+      : PipelineModuleBase(name, false),
+        nr_running_background_(nr_running_background),
+        work_duration_(work_duration) {}
+
+  bool spin() override {
+    if (shutdown_) return false;
+    if (pending_work_ == 0u) return true;
+    if (++nr_concurrent_runs_ > 1u) ++nr_reentrant_runs_;
+    if (nr_running_background_) ++(*nr_running_background_);
+    std::this_thread::sleep_for(work_duration_);
+    if (nr_running_background_) --(*nr_running_background_);
+    --nr_concurrent_runs_;
+    --pending_work_;
+    ++nr_work_done_;
+    return true;
+  }
+
+  void addWork(const size_t& nr_work) { pending_work_ += nr_work; }
+
+ public:
+  std::atomic<size_t> nr_work_done_ = {0u};
+  std::atomic<size_t> nr_reentrant_runs_ = {0u};
+
+ protected:
+  void shutdownQueues() override {}
+  bool hasWork() const override { return pending_work_ > 0u; }
+
+ private:
+  std::atomic<size_t> pending_work_ = {0u};
+  std::atomic<size_t> nr_concurrent_runs_ = {0u};
+  std::atomic<size_t>* nr_running_background_;
+  const std::chrono::milliseconds work_duration_;
+};
+
+bool waitFor(const std::function<bool()>& condition) {
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!condition()) {
+    if (std::chrono::steady_clock::now() > deadline) return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+TEST(testModuleScheduler, runsAllWorkWithoutReentrance) {
+  DummyModule frontend("Frontend");
+  DummyModule backend("Backend");
+  ModuleScheduler scheduler(4u);
+  scheduler.addModule(&frontend, ModulePriority::kCritical, "Frontend");
+  scheduler.addModule(&backend, ModulePriority::kCritical, "Backend");
+  scheduler.start();
+
+  frontend.addWork(50u);
+  backend.addWork(20u);
+  scheduler.notify();
+  EXPECT_TRUE(waitFor([&] {
+    return frontend.nr_work_done_ == 50u && backend.nr_work_done_ == 20u;
+  }));
+  EXPECT_EQ(frontend.nr_reentrant_runs_, 0u);
+  EXPECT_EQ(backend.nr_reentrant_runs_, 0u);
+
+  scheduler.shutdown();
+  scheduler.join();
+}
+
+TEST(testModuleScheduler, backgroundModulesDoNotBlockCriticalOnes) {
+  std::atomic<size_t> nr_running_background(0u);
+  DummyModule frontend("Frontend");
+  DummyModule mesher(
+      "Mesher", &nr_running_background, std::chrono::milliseconds(50));
+  DummyModule lcd("LCD", &nr_running_background, std::chrono::milliseconds(50));
+  // One worker is reserved for the critical module.
+  ModuleScheduler scheduler(2u);
+  scheduler.addModule(&mesher, ModulePriority::kBackground, "Mesher");
+  scheduler.addModule(&lcd, ModulePriority::kBackground, "LCD");
+  scheduler.addModule(&frontend, ModulePriority::kCritical, "Frontend");
+  scheduler.start();
+
+  mesher.addWork(4u);
+  lcd.addWork(4u);
+  scheduler.notify();
+  ASSERT_TRUE(waitFor([&] { return nr_running_background > 0u; }));
+
+  // The Frontend runs while the background modules are busy.
+  frontend.addWork(10u);
+  scheduler.notify();
+  EXPECT_TRUE(waitFor([&] { return frontend.nr_work_done_ == 10u; }));
+  EXPECT_LT(mesher.nr_work_done_ + lcd.nr_work_done_, 8u);
+  EXPECT_LE(nr_running_background, 1u);
+
+  EXPECT_TRUE(waitFor([&] {
+    return mesher.nr_work_done_ == 4u && lcd.nr_work_done_ == 4u;
+  }));
+  scheduler.shutdown();
+  scheduler.join();
+}
+
+TEST(testModuleScheduler, stopsRunningShutdownModules) {
+  DummyModule frontend("Frontend");
+  ModuleScheduler scheduler(1u);
+  scheduler.addModule(&frontend, ModulePriority::kCritical, "Frontend");
+  scheduler.start();
+  frontend.shutdown();
+  frontend.addWork(3u);
+  scheduler.notify();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(frontend.nr_work_done_, 0u);
+  scheduler.shutdown();
+  scheduler.join();
+}
+
+TEST(testModuleScheduler, modulesAddedAndRemovedWhileRunning) {
+  // As two pipelines sharing the scheduler.
+  DummyModule frontend_a("Frontend A");
+  DummyModule frontend_b("Frontend B");
+  DummyModule lcd_b("LCD B");
+  ModuleScheduler scheduler(2u);
+  scheduler.addModule(&frontend_a, ModulePriority::kCritical, "Frontend A");
+  scheduler.start();
+  scheduler.addModule(&frontend_b, ModulePriority::kCritical, "Frontend B");
+  // As many critical modules as workers: one is left to background modules.
+  scheduler.addModule(&lcd_b, ModulePriority::kBackground, "LCD B");
+
+  frontend_a.addWork(20u);
+  frontend_b.addWork(20u);
+  lcd_b.addWork(5u);
+  scheduler.notify();
+  EXPECT_TRUE(waitFor([&] {
+    return frontend_a.nr_work_done_ == 20u &&
+           frontend_b.nr_work_done_ == 20u && lcd_b.nr_work_done_ == 5u;
+  }));
+
+  // Removing waits for the running iteration: the module can be destroyed.
+  frontend_b.addWork(1000u);
+  scheduler.removeModule(&frontend_b);
+  scheduler.removeModule(&lcd_b);
+  const size_t nr_work_done_b = frontend_b.nr_work_done_;
+  EXPECT_LT(nr_work_done_b, 1020u);
+  frontend_a.addWork(10u);
+  scheduler.notify();
+  EXPECT_TRUE(waitFor([&] { return frontend_a.nr_work_done_ == 30u; }));
+  EXPECT_EQ(frontend_b.nr_work_done_, nr_work_done_b);
+  EXPECT_EQ(frontend_b.nr_reentrant_runs_, 0u);
+
+  scheduler.shutdown();
+  scheduler.join();
+}
+
+}  // namespace VIO
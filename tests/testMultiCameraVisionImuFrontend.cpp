@@ -0,0 +1,171 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testMultiCameraVisionImuFrontend.cpp
+ * @brief  test MultiCameraVisionImuFrontend
+ * @author Antoni Rosinol
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "kimera-vio/frontend/Camera.h"
+#include "kimera-vio/frontend/CameraParams.h"
+#include "kimera-vio/frontend/Frame.h"
+#include "kimera-vio/frontend/MultiCameraImuSyncPacket.h"
+#include "kimera-vio/frontend/MultiCameraVisionImuFrontend-definitions.h"
+#include "kimera-vio/frontend/MultiCameraVisionImuFrontend.h"
+#include "kimera-vio/utils/UtilsOpenCV.h"
+
+DECLARE_string(test_data_path);
+
+namespace VIO {
+
+class MultiCameraVisionImuFrontendFixture : public ::testing::Test {
+ public:
+  MultiCameraVisionImuFrontendFixture()
+      : data_path_(FLAGS_test_data_path + std::string("/ForStereoFrame/")) {
+    CameraParams cam_params;
+    cam_params.parseYAML(data_path_ + "sensorLeft.yaml");
+    // Same intrinsics, but a different extrinsic for each camera.
+    for (size_t cam_idx = 0u; cam_idx < kNrCameras; ++cam_idx) {
+      CameraParams params = cam_params;
+      params.camera_id_ = "cam" + std::to_string(cam_idx);
+      params.body_Pose_cam_ = cam_params.body_Pose_cam_.compose(gtsam::Pose3(
+          gtsam::Rot3(), gtsam::Point3(0.1 * cam_idx, 0.0, 0.0)));
+      cam_params_.push_back(params);
+      cameras_.push_back(std::make_shared<Camera>(params));
+    }
+
+    // Imu Params
+    imu_params_.acc_random_walk_ = 1;
+    imu_params_.gyro_random_walk_ = 1;
+    imu_params_.acc_noise_density_ = 1;
+    imu_params_.gyro_noise_density_ = 1;
+    imu_params_.imu_integration_sigma_ = 1;
+  }
+
+ protected:
+  static constexpr size_t kNrCameras = 3u;
+
+  //! All the cameras see the same image: their tracks must be identical.
+  MultiCameraImuSyncPacket::UniquePtr makePacket(const FrameId& id,
+                                                 const Timestamp& timestamp,
+                                                 const std::string& img_name,
+                                                 const ImuStampS& imu_stamps) {
+    const cv::Mat img =
+        UtilsOpenCV::ReadAndConvertToGrayScale(data_path_ + img_name);
+    std::vector<Frame::UniquePtr> frames;
+    for (const CameraParams& params : cam_params_) {
+      frames.push_back(std::make_unique<Frame>(id, timestamp, params, img));
+    }
+    ImuAccGyrS imu_acc_gyrs = ImuAccGyrS::Zero(6, imu_stamps.cols());
+    imu_acc_gyrs.row(2).setConstant(9.81);
+    return std::make_unique<MultiCameraImuSyncPacket>(
+        std::move(frames), imu_stamps, imu_acc_gyrs);
+  }
+
+  const std::string data_path_;
+  std::vector<CameraParams> cam_params_;
+  std::vector<Camera::ConstPtr> cameras_;
+  ImuParams imu_params_;
+};
+
+TEST_F(MultiCameraVisionImuFrontendFixture, threeCamerasToBackendInput) {
+  FrontendParams frontend_params;
+  // Every frame after the first one is a keyframe.
+  frontend_params.max_intra_keyframe_time_ns_ = 0;
+  MultiCameraVisionImuFrontend frontend(
+      frontend_params, imu_params_, ImuBias(), cameras_);
+  ASSERT_EQ(frontend.getNrCameras(), kNrCameras);
+
+  ImuStampS imu_stamps0(1, 1);
+  imu_stamps0 << 0;
+  auto output0 = castUnique<MultiCameraFrontendOutput>(
+      frontend.spinOnce(makePacket(0, 0, "left_img_0.png", imu_stamps0)));
+  ASSERT_TRUE(output0);
+  ASSERT_EQ(output0->getNrCameras(), kNrCameras);
+
+  // Each camera detects features in its own tracker, but the landmark ids
+  // come from one counter: no two cameras share a landmark id.
+  std::set<LandmarkId> all_lmk_ids;
+  size_t nr_lmks = 0u;
+  for (const Frame& frame : output0->frames_lkf_) {
+    EXPECT_TRUE(frame.isKeyframe_);
+    EXPECT_GT(frame.landmarks_.size(), 0u);
+    for (const LandmarkId& lmk_id : frame.landmarks_) {
+      if (lmk_id == -1) continue;
+      all_lmk_ids.insert(lmk_id);
+      ++nr_lmks;
+    }
+  }
+  EXPECT_GT(nr_lmks, 0u);
+  EXPECT_EQ(all_lmk_ids.size(), nr_lmks);
+  // Same image for all the cameras: same number of features in each.
+  EXPECT_EQ(output0->frames_lkf_[1].landmarks_.size(),
+            output0->frames_lkf_[0].landmarks_.size());
+  EXPECT_EQ(output0->frames_lkf_[2].landmarks_.size(),
+            output0->frames_lkf_[0].landmarks_.size());
+
+  const Timestamp timestamp1 = 100000000;
+  ImuStampS imu_stamps1(1, 2);
+  imu_stamps1 << timestamp1 / 2, timestamp1;
+  auto output1 = castUnique<MultiCameraFrontendOutput>(frontend.spinOnce(
+      makePacket(1, timestamp1, "left_img_1.png", imu_stamps1)));
+  ASSERT_TRUE(output1);
+  ASSERT_TRUE(output1->is_keyframe_);
+  ASSERT_EQ(output1->getNrCameras(), kNrCameras);
+  ASSERT_EQ(output1->camera_measurements_.size(), kNrCameras);
+
+  // Each camera tracked its own landmarks, in parallel with the others.
+  size_t nr_ref_measurements = 0u;
+  for (size_t cam_idx = 0u; cam_idx < kNrCameras; ++cam_idx) {
+    const LandmarkIds& lmks0 = output0->frames_lkf_[cam_idx].landmarks_;
+    const std::set<LandmarkId> cam_lmk_ids(lmks0.begin(), lmks0.end());
+    const CameraMeasurements& meas = output1->camera_measurements_[cam_idx];
+    ASSERT_TRUE(meas.status_measurements_);
+    const auto& smart_measurements = meas.status_measurements_->second;
+    EXPECT_GT(smart_measurements.size(), 0u);
+    if (cam_idx == 0u) nr_ref_measurements = smart_measurements.size();
+    EXPECT_EQ(smart_measurements.size(), nr_ref_measurements);
+    size_t nr_tracked = 0u;
+    for (const auto& lmk_id_measurement : smart_measurements) {
+      nr_tracked += cam_lmk_ids.count(lmk_id_measurement.first);
+    }
+    EXPECT_GT(nr_tracked, 0u) << "Camera " << cam_idx << " lost its tracks.";
+    EXPECT_TRUE(gtsam::assert_equal(cam_params_[cam_idx].body_Pose_cam_,
+                                    meas.body_Pose_cam_));
+  }
+
+  BackendInput::UniquePtr backend_input = output1->toBackendInput();
+  ASSERT_TRUE(backend_input);
+  EXPECT_EQ(backend_input->timestamp_, timestamp1);
+  EXPECT_EQ(backend_input->pim_, output1->pim_);
+  // The backends consume the reference camera's measurements.
+  EXPECT_EQ(backend_input->status_stereo_measurements_kf_,
+            output1->camera_measurements_[0u].status_measurements_);
+  ASSERT_EQ(backend_input->multi_camera_measurements_.size(), kNrCameras);
+  for (size_t cam_idx = 0u; cam_idx < kNrCameras; ++cam_idx) {
+    const CameraMeasurements& meas =
+        backend_input->multi_camera_measurements_[cam_idx];
+    EXPECT_EQ(meas.status_measurements_,
+              output1->camera_measurements_[cam_idx].status_measurements_);
+    EXPECT_TRUE(gtsam::assert_equal(cam_params_[cam_idx].body_Pose_cam_,
+                                    meas.body_Pose_cam_));
+  }
+}
+
+}  // namespace VIO
@@ -0,0 +1,230 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testMultiRobotLcd.cpp
+ * @brief  test MultiRobotLcd
+ * @author Antoni Rosinol
+ */
+
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/loopclosure/MultiRobotLcd.h"
+#include "kimera-vio/test/StereoLcdTestData.h"
+#include "kimera-vio/utils/UtilsOpenCV.h"
+
+DECLARE_string(test_data_path);
+
+namespace VIO {
+
+using test::StereoLcdTestData;
+
+class MultiRobotLcdFixture : public ::testing::Test {
+ protected:
+  // Tolerances of the stereo loop closures of the test data.
+  const double rot_tol_stereo = 0.3;   // radians
+  const double tran_tol_stereo = 0.6;  // meters
+
+ public:
+  MultiRobotLcdFixture()
+      : data_(FLAGS_test_data_path),
+        Shared_Pose_Map2_(gtsam::Rot3::Yaw(0.5),
+                          gtsam::Point3(2.0, -1.0, 0.3)),
+        multi_robot_lcd_(
+            [this](const RobotId&) {
+              return data_.makeLcd(data_.getLcdParams());
+            },
+            getParams()) {}
+
+ protected:
+  static MultiRobotLcdParams getParams() {
+    MultiRobotLcdParams params;
+    // Any candidate: the geometric verification decides.
+    params.min_inter_robot_score = 0.0;
+    return params;
+  }
+
+  //! Robot 1 is in the shared frame, robot 2 in its map frame.
+  gtsam::Pose3 getMapPoseBody(const RobotId& robot_id,
+                              const size_t& image) const {
+    const gtsam::Pose3 W_Pose_B = StereoLcdTestData::getWorldPoseBody(image);
+    return robot_id == 1u ? W_Pose_B : Shared_Pose_Map2_.inverse() * W_Pose_B;
+  }
+
+  std::unique_ptr<RemoteLcdCorrection> addKeyframe(
+      const RobotId& robot_id,
+      const FrameId& kf_id,
+      const size_t& image,
+      const bool& with_bow = true) {
+    return multi_robot_lcd_.addKeyframe(
+        data_.makeKeyframe(robot_id,
+                           kf_id,
+                           getTimestamp(kf_id),
+                           image,
+                           getMapPoseBody(robot_id, image),
+                           with_bow));
+  }
+
+  static Timestamp getTimestamp(const FrameId& kf_id) {
+    return 1000 * static_cast<Timestamp>(kf_id + 1u);
+  }
+
+  void expectNear(const gtsam::Pose3& expected,
+                  const gtsam::Pose3& actual) const {
+    const std::pair<double, double> error =
+        UtilsOpenCV::ComputeRotationAndTranslationErrors(
+            expected, actual, false);
+    EXPECT_LT(error.first, rot_tol_stereo);
+    EXPECT_LT(error.second, tran_tol_stereo);
+  }
+
+ protected:
+  StereoLcdTestData data_;
+  //! Ground truth of the alignment of robot 2.
+  const gtsam::Pose3 Shared_Pose_Map2_;
+  MultiRobotLcd multi_robot_lcd_;
+};
+
+TEST_F(MultiRobotLcdFixture, correctionsInRobotIds) {
+  // The robot drops keyframes: its ids are not contiguous.
+  ASSERT_TRUE(addKeyframe(1u, 3u, StereoLcdTestData::kMatch1));
+  ASSERT_TRUE(addKeyframe(1u, 4u, StereoLcdTestData::kMatch2));
+  const std::unique_ptr<RemoteLcdCorrection> correction =
+      addKeyframe(1u, 8u, StereoLcdTestData::kQuery1);
+  ASSERT_TRUE(correction);
+  EXPECT_EQ(1u, correction->robot_id_);
+  EXPECT_EQ(8u, correction->kf_id_);
+  EXPECT_EQ(getTimestamp(8u), correction->timestamp_);
+
+  // The loop closure, the states and their timestamps in the robot's ids.
+  ASSERT_TRUE(correction->is_loop_closure_);
+  EXPECT_EQ(3u, correction->id_match_);
+  EXPECT_EQ(8u, correction->id_recent_);
+  EXPECT_EQ(getTimestamp(3u), correction->timestamp_match_);
+  EXPECT_EQ(getTimestamp(8u), correction->timestamp_query_);
+  ASSERT_EQ(3u, correction->states_.size());
+  ASSERT_EQ(3u, correction->timestamp_map_.size());
+  for (const FrameId kf_id : {3u, 4u, 8u}) {
+    EXPECT_EQ(1u, correction->states_.count(kf_id));
+    EXPECT_EQ(getTimestamp(kf_id), correction->timestamp_map_.at(kf_id));
+  }
+
+  // The first robot defines the shared frame.
+  ASSERT_TRUE(correction->Shared_Pose_Map_);
+  EXPECT_TRUE(
+      gtsam::assert_equal(gtsam::Pose3(), *correction->Shared_Pose_Map_));
+
+  // Dropped: not after the previous keyframe of the robot.
+  EXPECT_FALSE(addKeyframe(1u, 8u, StereoLcdTestData::kQuery1));
+  EXPECT_FALSE(addKeyframe(1u, 6u, StereoLcdTestData::kQuery1));
+  const std::unique_ptr<RemoteLcdCorrection> next_correction =
+      addKeyframe(1u, 9u, StereoLcdTestData::kQuery2);
+  ASSERT_TRUE(next_correction);
+  EXPECT_EQ(9u, next_correction->kf_id_);
+  EXPECT_EQ(4u, next_correction->states_.size());
+  EXPECT_EQ(1u, next_correction->states_.count(9u));
+
+  EXPECT_EQ(1u, multi_robot_lcd_.getNrRobots());
+  EXPECT_EQ(0u, multi_robot_lcd_.getNrInterRobotLoopClosures());
+}
+
+TEST_F(MultiRobotLcdFixture, alignsQueryRobot) {
+  std::unique_ptr<RemoteLcdCorrection> correction =
+      addKeyframe(1u, 0u, StereoLcdTestData::kMatch1);
+  ASSERT_TRUE(correction);
+  ASSERT_TRUE(correction->Shared_Pose_Map_);
+
+  // Without its BoW vector, the first keyframe of robot 2 is not queried.
+  correction = addKeyframe(2u, 5u, StereoLcdTestData::kMatch2, false);
+  ASSERT_TRUE(correction);
+  EXPECT_FALSE(correction->Shared_Pose_Map_);
+  EXPECT_FALSE(multi_robot_lcd_.getSharedPoseMap(2u));
+
+  // The query of robot 2 closes a loop with the match of robot 1.
+  correction = addKeyframe(2u, 9u, StereoLcdTestData::kQuery1);
+  ASSERT_TRUE(correction);
+  EXPECT_EQ(2u, correction->robot_id_);
+  EXPECT_EQ(9u, correction->kf_id_);
+  EXPECT_EQ(2u, multi_robot_lcd_.getNrRobots());
+  EXPECT_EQ(1u, multi_robot_lcd_.getNrInterRobotLoopClosures());
+  ASSERT_TRUE(correction->Shared_Pose_Map_);
+  const std::optional<gtsam::Pose3> Shared_Pose_Map2 =
+      multi_robot_lcd_.getSharedPoseMap(2u);
+  ASSERT_TRUE(Shared_Pose_Map2);
+  EXPECT_TRUE(
+      gtsam::assert_equal(*Shared_Pose_Map2, *correction->Shared_Pose_Map_));
+
+  // The query is where the loop closure puts it from the match of robot 1.
+  ASSERT_EQ(1u, correction->states_.count(9u));
+  expectNear(StereoLcdTestData::getWorldPoseBody(StereoLcdTestData::kQuery1),
+             *Shared_Pose_Map2 * correction->states_.at(9u));
+  EXPECT_LT(Shared_Pose_Map2_.rotation()
+                .between(Shared_Pose_Map2->rotation())
+                .axisAngle()
+                .second,
+            rot_tol_stereo);
+
+  // Both aligned: no more inter-robot loop closures.
+  correction = addKeyframe(2u, 10u, StereoLcdTestData::kMatch1);
+  ASSERT_TRUE(correction);
+  ASSERT_TRUE(correction->Shared_Pose_Map_);
+  EXPECT_TRUE(
+      gtsam::assert_equal(*Shared_Pose_Map2, *correction->Shared_Pose_Map_));
+  EXPECT_EQ(1u, multi_robot_lcd_.getNrInterRobotLoopClosures());
+}
+
+TEST_F(MultiRobotLcdFixture, alignsMatchRobot) {
+  // Robot 1 defines the shared frame, without its first keyframe in the
+  // shared database.
+  ASSERT_TRUE(addKeyframe(1u, 0u, StereoLcdTestData::kMatch2, false));
+
+  // No keyframe of an aligned robot to match.
+  std::unique_ptr<RemoteLcdCorrection> correction =
+      addKeyframe(2u, 0u, StereoLcdTestData::kMatch1);
+  ASSERT_TRUE(correction);
+  EXPECT_FALSE(correction->Shared_Pose_Map_);
+  EXPECT_EQ(0u, multi_robot_lcd_.getNrInterRobotLoopClosures());
+
+  // The query of robot 1 closes a loop with the match of robot 2.
+  correction = addKeyframe(1u, 1u, StereoLcdTestData::kQuery1);
+  ASSERT_TRUE(correction);
+  EXPECT_EQ(1u, multi_robot_lcd_.getNrInterRobotLoopClosures());
+  const std::optional<gtsam::Pose3> Shared_Pose_Map2 =
+      multi_robot_lcd_.getSharedPoseMap(2u);
+  ASSERT_TRUE(Shared_Pose_Map2);
+
+  // The match is where the loop closure puts it from the query of robot 1.
+  const gtsam::Pose3 bodyMatch1_T_bodyQuery1_gt =
+      StereoLcdTestData::getWorldPoseBody(StereoLcdTestData::kMatch1)
+          .between(StereoLcdTestData::getWorldPoseBody(
+              StereoLcdTestData::kQuery1));
+  ASSERT_EQ(1u, correction->states_.count(1u));
+  expectNear(correction->states_.at(1u) * bodyMatch1_T_bodyQuery1_gt.inverse(),
+             *Shared_Pose_Map2 *
+                 getMapPoseBody(2u, StereoLcdTestData::kMatch1));
+  EXPECT_LT(Shared_Pose_Map2_.rotation()
+                .between(Shared_Pose_Map2->rotation())
+                .axisAngle()
+                .second,
+            rot_tol_stereo);
+
+  // Robot 2 gets its alignment with its next correction.
+  correction = addKeyframe(2u, 1u, StereoLcdTestData::kMatch2);
+  ASSERT_TRUE(correction);
+  ASSERT_TRUE(correction->Shared_Pose_Map_);
+  EXPECT_TRUE(
+      gtsam::assert_equal(*Shared_Pose_Map2, *correction->Shared_Pose_Map_));
+}
+
+}  // namespace VIO
@@ -0,0 +1,96 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testNormalHash.cpp
+ * @brief  test the spatial hash of unit normals
+ * @author Antoni Rosinol
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "kimera-vio/mesh/NormalHash.h"
+
+namespace VIO {
+
+namespace {
+
+cv::Point3f randomNormal(cv::RNG* rng) {
+  cv::Point3f normal(static_cast<float>(rng->gaussian(1.0)),
+                     static_cast<float>(rng->gaussian(1.0)),
+                     static_cast<float>(rng->gaussian(1.0)));
+  return normal / cv::norm(normal);
+}
+
+}  // namespace
+
+TEST(testNormalHash, ChordRadius) {
+  EXPECT_DOUBLE_EQ(NormalHash::getChordRadius(0.0), 0.0);
+  EXPECT_DOUBLE_EQ(NormalHash::getChordRadius(0.5), 1.0);
+  EXPECT_DOUBLE_EQ(NormalHash::getChordRadius(2.0), 2.0);
+}
+
+TEST(testNormalHash, QueryBothDirections) {
+  NormalHash hash(NormalHash::getChordRadius(0.01));
+  hash.insert(0u, cv::Point3f(0.f, 0.f, 1.f));
+  hash.insert(1u, cv::Point3f(0.f, 0.f, -1.f));
+  hash.insert(2u, cv::Point3f(1.f, 0.f, 0.f));
+  EXPECT_EQ(hash.size(), 3u);
+
+  NormalHash::Ids ids;
+  hash.query(cv::Point3f(0.f, 0.f, 1.f), 0.01, &ids);
+  EXPECT_EQ(ids, NormalHash::Ids({0u, 1u}));
+  hash.query(cv::Point3f(0.f, -1.f, 0.f), 0.01, &ids);
+  EXPECT_TRUE(ids.empty());
+
+  hash.clear();
+  EXPECT_EQ(hash.size(), 0u);
+  hash.query(cv::Point3f(0.f, 0.f, 1.f), 0.01, &ids);
+  EXPECT_TRUE(ids.empty());
+}
+
+TEST(testNormalHash, SupersetOfBruteForce) {
+  cv::RNG rng(5);
+  const double cell_tolerance = 0.011;
+  NormalHash hash(NormalHash::getChordRadius(cell_tolerance));
+  std::vector<cv::Point3f> normals;
+  for (size_t i = 0u; i < 5000u; i++) {
+    // A third of the normals are vertical, as for ground polygons.
+    normals.push_back(i % 3u == 0u ? cv::Point3f(0.f, 0.f, i % 2u ? 1.f : -1.f)
+                                   : randomNormal(&rng));
+    hash.insert(i, normals.back());
+  }
+
+  size_t nr_candidates = 0u;
+  NormalHash::Ids ids;
+  for (size_t query = 0u; query < 200u; query++) {
+    const cv::Point3f normal = randomNormal(&rng);
+    // Also with tolerances other than the one setting the cell size.
+    for (const double& tolerance : {cell_tolerance, 0.2, 1.5}) {
+      hash.query(normal, tolerance, &ids);
+      ASSERT_TRUE(std::is_sorted(ids.begin(), ids.end()));
+      for (size_t i = 0u; i < normals.size(); i++) {
+        if (std::fabs(normals[i].ddot(normal)) > 1.0 - tolerance) {
+          ASSERT_TRUE(std::binary_search(ids.begin(), ids.end(), i))
+              << "Missing normal " << i << " for tolerance " << tolerance;
+        }
+      }
+      if (tolerance == cell_tolerance) nr_candidates += ids.size();
+    }
+  }
+  // Only the cells around the query are visited.
+  EXPECT_LT(nr_candidates / 200u, normals.size() / 10u);
+}
+
+}  // namespace VIO
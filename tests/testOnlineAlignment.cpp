@@ -22,6 +22,7 @@
 #include "kimera-vio/imu-frontend/ImuFrontend.h"
 #include "kimera-vio/initial/OnlineGravityAlignment.h"
 #include "kimera-vio/utils/ThreadsafeImuBuffer.h"
+#include "kimera-vio/utils/Timer.h"
 #include "kimera-vio/utils/UtilsNumerical.h"
 
 DECLARE_string(test_data_path);
@@ -246,6 +247,51 @@ TEST_F(OnlineAlignmentFixture, CreateTangentBasis) {
   }
 }
 
+/* -------------------------------------------------------------------------- */
+TEST_F(OnlineAlignmentFixture, GyroscopeBiasEstimationSynthetic) {
+  // Constant angular velocity, measured with a constant gyroscope bias.
+  const gtsam::Vector3 omega(0.3, -0.2, 0.5);
+  const gtsam::Vector3 true_gyro_bias(0.01, -0.02, 0.015);
+  static constexpr int kNrFrames = 100;
+  static constexpr int kNrImuPerFrame = 20;
+  static constexpr Timestamp kImuPeriodNs = 5000000;
+  const double frame_dt =
+      UtilsNumerical::NsecToSec(kNrImuPerFrame * kImuPeriodNs);
+
+  ImuStampS imu_stamps(1, kNrImuPerFrame + 1);
+  ImuAccGyrS imu_accgyrs(6, kNrImuPerFrame + 1);
+  for (int k = 0; k <= kNrImuPerFrame; ++k) {
+    imu_stamps(k) = k * kImuPeriodNs;
+    imu_accgyrs.block<3, 1>(0, k) = gtsam::Vector3(0.0, 0.0, 9.81);
+    imu_accgyrs.block<3, 1>(3, k) = omega + true_gyro_bias;
+  }
+
+  estimated_poses_.clear();
+  pims_.clear();
+  delta_t_poses_.clear();
+  estimated_poses_.push_back(gtsam::Pose3());
+  for (int i = 0; i < kNrFrames; ++i) {
+    ImuFrontend imu_frontend(imu_params_, imu_bias_);
+    pims_.push_back(
+        imu_frontend.preintegrateImuMeasurements(imu_stamps, imu_accgyrs));
+    delta_t_poses_.push_back(frame_dt);
+    estimated_poses_.push_back(
+        gtsam::Pose3(gtsam::Rot3::Expmap(omega * frame_dt * (i + 1)),
+                     gtsam::Point3::Zero()));
+  }
+
+  OnlineGravityAlignment initial_alignment(
+      estimated_poses_, delta_t_poses_, pims_, imu_params_.n_gravity_);
+  gtsam::Vector3 gyro_bias = gtsam::Vector3::Zero();
+  auto tic = utils::Timer::tic();
+  EXPECT_TRUE(initial_alignment.estimateGyroscopeBiasOnly(&gyro_bias));
+  LOG(INFO) << "Gyroscope bias estimation latency for " << kNrFrames
+            << " frames: "
+            << utils::Timer::toc<std::chrono::microseconds>(tic).count()
+            << " us.";
+  EXPECT_TRUE(gtsam::assert_equal(true_gyro_bias, gyro_bias, tol_GB));
+}
+
 /* -------------------------------------------------------------------------- */
 TEST_F(OnlineAlignmentFixture, DISABLED_OnlineGravityAlignment) {
   // Construct ETH Parser and get data
@@ -12,6 +12,7 @@
  * @author Antoni Rosinol
  */
 
+#include <algorithm>
 #include <string>
 
 #include <gflags/gflags.h>
@@ -614,4 +615,86 @@ TEST_F(OpticalFlowPredictorFixture,
   visualizeScene("RotationAndTranslation", actual_kpts);
 }
 
+// Checks that with known depths the roto-translational predictor recovers the
+// exact keypoints, and that without depths it behaves as the rotational one.
+TEST_F(OpticalFlowPredictorFixture, RotoTranslationalOpticalFlowPrediction) {
+  optical_flow_predictor_ =
+      buildOpticalFlowPredictor(OpticalFlowPredictorType::kRotoTranslational);
+  ASSERT_TRUE(optical_flow_predictor_);
+
+  gtsam::Pose3 cam_1_P_cam_2(gtsam::Rot3::Ypr(0.05, -0.03, 0.02),
+                             gtsam::Vector3(0.3, -0.2, 0.5));
+  generateCam2(cam_1_P_cam_2);
+  ASSERT_EQ(cam_1_kpts_.size(), lmks_.size());
+  ASSERT_EQ(cam_2_kpts_.size(), lmks_.size());
+
+  std::vector<double> depths;
+  for (const Landmark& lmk : lmks_) {
+    depths.push_back(cam_1_pose_.transformTo(lmk).z());
+  }
+
+  KeypointsCV actual_kpts;
+  optical_flow_predictor_->predictSparseFlow(
+      cam_1_kpts_, cam_1_P_cam_2, depths, &actual_kpts);
+  compareKeypoints(cam_2_kpts_, actual_kpts, 1e-2);
+
+  // Unknown depths: same as a rotation-only prediction.
+  const std::vector<double> no_depths(cam_1_kpts_.size(), 0.0);
+  KeypointsCV rotational_kpts;
+  optical_flow_predictor_->predictSparseFlow(
+      cam_1_kpts_, cam_1_P_cam_2, no_depths, &actual_kpts);
+  optical_flow_predictor_->predictSparseFlow(
+      cam_1_kpts_, cam_1_P_cam_2.rotation(), &rotational_kpts);
+  compareKeypoints(rotational_kpts, actual_kpts, 1e-4);
+}
+
+// Checks that keypoints of unrectified images are predicted with the radial
+// distortion, also when predicting in place.
+TEST_F(OpticalFlowPredictorFixture, DistortedRotationalOpticalFlowPrediction) {
+  const PinholeCalibration distorted_calib(simulated_calib_.fx(),
+                                           simulated_calib_.fy(),
+                                           0.0,
+                                           simulated_calib_.px(),
+                                           simulated_calib_.py(),
+                                           -0.28,
+                                           0.07);
+  optical_flow_predictor_ = std::make_unique<RotationalOpticalFlowPredictor>(
+      UtilsOpenCV::gtsamMatrix3ToCvMat(simulated_calib_.K()),
+      camera_params_.image_size_,
+      cv::Vec2f(-0.28f, 0.07f));
+
+  gtsam::Pose3 cam_1_P_cam_2(gtsam::Rot3::Ypr(0.1, -0.05, 0.03),
+                             gtsam::Vector3::Zero());
+  generateCam2(cam_1_P_cam_2);
+  KeypointsCV distorted_kpts_1;
+  projectLandmarks(
+      lmks_, PinholeCamera(cam_1_pose_, distorted_calib), &distorted_kpts_1);
+  KeypointsCV distorted_kpts_2;
+  projectLandmarks(
+      lmks_, PinholeCamera(cam_2_pose_, distorted_calib), &distorted_kpts_2);
+
+  KeypointsCV actual_kpts;
+  optical_flow_predictor_->predictSparseFlow(
+      distorted_kpts_1, cam_1_P_cam_2.rotation(), &actual_kpts);
+  compareKeypoints(distorted_kpts_2, actual_kpts, 1e-1);
+
+  actual_kpts = distorted_kpts_1;
+  optical_flow_predictor_->predictSparseFlow(
+      actual_kpts, cam_1_P_cam_2.rotation(), &actual_kpts);
+  compareKeypoints(distorted_kpts_2, actual_kpts, 1e-1);
+
+  // Not the same as ignoring the distortion.
+  KeypointsCV pinhole_kpts;
+  buildOpticalFlowPredictor(OpticalFlowPredictorType::kRotational)
+      ->predictSparseFlow(
+          distorted_kpts_1, cam_1_P_cam_2.rotation(), &pinhole_kpts);
+  float max_difference = 0.0f;
+  for (size_t i = 0u; i < pinhole_kpts.size(); ++i) {
+    max_difference = std::max(
+        max_difference,
+        static_cast<float>(cv::norm(pinhole_kpts[i] - distorted_kpts_2[i])));
+  }
+  EXPECT_GT(max_difference, 1.0f);
+}
+
 }  // namespace VIO
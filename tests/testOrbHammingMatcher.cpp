@@ -0,0 +1,138 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testOrbHammingMatcher.cpp
+ * @brief  test OrbHammingMatcher against OpenCV's brute-force matcher
+ * @author Antoni Rosinol
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/features2d.hpp>
+
+#include "kimera-vio/loopclosure/OrbHammingMatcher.h"
+
+namespace VIO {
+
+namespace {
+
+cv::Mat randomDescriptors(const int& nr_descriptors, cv::RNG* rng) {
+  cv::Mat descriptors(nr_descriptors, kOrbDescriptorBytes, CV_8U);
+  rng->fill(descriptors, cv::RNG::UNIFORM, 0, 256);
+  return descriptors;
+}
+
+//! Copies of the train descriptors with a few flipped bits, and outliers.
+cv::Mat noisyCopies(const cv::Mat& train, cv::RNG* rng) {
+  cv::Mat query = randomDescriptors(train.rows + 50, rng);
+  for (int i = 0; i < train.rows; ++i) {
+    train.row(i).copyTo(query.row(i));
+    const int nr_flipped_bits = rng->uniform(0, 40);
+    for (int j = 0; j < nr_flipped_bits; ++j) {
+      query.at<uint8_t>(i, rng->uniform(0, kOrbDescriptorBytes)) ^=
+          static_cast<uint8_t>(1u << rng->uniform(0, 8));
+    }
+  }
+  return query;
+}
+
+std::vector<cv::DMatch> openCvMatches(const cv::Mat& query,
+                                      const cv::Mat& train,
+                                      const double& lowe_ratio) {
+  cv::BFMatcher matcher(cv::NORM_HAMMING);
+  std::vector<std::vector<cv::DMatch>> knn_matches;
+  matcher.knnMatch(query, train, knn_matches, 2u);
+  std::vector<cv::DMatch> matches;
+  for (const std::vector<cv::DMatch>& match : knn_matches) {
+    if (match.size() < 2) continue;
+    if (match[0].distance < lowe_ratio * match[1].distance) {
+      matches.push_back(match[0]);
+    }
+  }
+  return matches;
+}
+
+}  // namespace
+
+TEST(OrbHammingMatcher, DistanceMatchesOpenCv) {
+  cv::RNG rng(3);
+  const cv::Mat a = randomDescriptors(100, &rng);
+  const cv::Mat b = randomDescriptors(100, &rng);
+  for (int i = 0; i < a.rows; ++i) {
+    EXPECT_EQ(orbHammingDistance(a.ptr<uint8_t>(i), b.ptr<uint8_t>(i)),
+              static_cast<uint32_t>(cv::norm(a.row(i), b.row(i),
+                                             cv::NORM_HAMMING)));
+    EXPECT_EQ(orbHammingDistance(a.ptr<uint8_t>(i), a.ptr<uint8_t>(i)), 0u);
+  }
+}
+
+TEST(OrbHammingMatcher, SameMatchesAsOpenCv) {
+  cv::RNG rng(5);
+  const cv::Mat train = randomDescriptors(300, &rng);
+  const cv::Mat query = noisyCopies(train, &rng);
+  OrbHammingMatcher matcher;
+  for (const double& lowe_ratio : {0.7, 1.0}) {
+    const std::vector<cv::DMatch> expected =
+        openCvMatches(query, train, lowe_ratio);
+    std::vector<cv::DMatch> actual;
+    matcher.match(query, train, lowe_ratio, &actual);
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0u; i < expected.size(); ++i) {
+      EXPECT_EQ(actual[i].queryIdx, expected[i].queryIdx);
+      EXPECT_EQ(actual[i].trainIdx, expected[i].trainIdx);
+      EXPECT_FLOAT_EQ(actual[i].distance, expected[i].distance);
+    }
+  }
+  // The noisy copies are matched.
+  std::vector<cv::DMatch> matches;
+  matcher.match(query, train, 0.7, &matches);
+  EXPECT_GE(matches.size(), static_cast<size_t>(train.rows));
+}
+
+TEST(OrbHammingMatcher, MaxDistanceAndFewTrainDescriptors) {
+  cv::RNG rng(11);
+  const cv::Mat train = randomDescriptors(100, &rng);
+  const cv::Mat query = noisyCopies(train, &rng);
+  std::vector<cv::DMatch> matches;
+  OrbHammingMatcher(10).match(query, train, 1.0, &matches);
+  EXPECT_FALSE(matches.empty());
+  for (const cv::DMatch& match : matches) EXPECT_LE(match.distance, 10.0f);
+
+  // As knnMatch with k = 2: no match with a single train descriptor.
+  OrbHammingMatcher().match(query, train.rowRange(0, 1), 1.0, &matches);
+  EXPECT_TRUE(matches.empty());
+}
+
+TEST(OrbHammingMatcher, GroupedOnlyMatchesWithinGroups) {
+  cv::RNG rng(13);
+  const cv::Mat train = randomDescriptors(40, &rng);
+  const cv::Mat query = noisyCopies(train, &rng);
+  // Train i, and its query copy i, in group i % 4, except that query copies
+  // of group 3 are in group 5, without train descriptors.
+  OrbHammingMatcher::DescriptorGroups train_groups, query_groups;
+  for (unsigned int i = 0u; i < static_cast<unsigned int>(train.rows); ++i) {
+    train_groups[i % 4u].push_back(i);
+    query_groups[i % 4u == 3u ? 5u : i % 4u].push_back(i);
+  }
+  std::vector<cv::DMatch> matches;
+  OrbHammingMatcher().matchGrouped(
+      query, train, query_groups, train_groups, 0.7, &matches);
+  EXPECT_FALSE(matches.empty());
+  for (const cv::DMatch& match : matches) {
+    EXPECT_EQ(match.queryIdx, match.trainIdx);
+    EXPECT_NE(match.queryIdx % 4, 3);
+  }
+}
+
+}  // namespace VIO
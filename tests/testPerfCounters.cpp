@@ -0,0 +1,87 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testPerfCounters.cpp
+ * @brief  test the performance counters of the scopes
+ * @author Antoni Rosinol
+ */
+
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/utils/PerfCounters.h"
+#include "kimera-vio/utils/Statistics.h"
+
+DECLARE_bool(enable_perf_counters);
+
+namespace VIO {
+
+namespace {
+//! Touches the values, so that the scope has instructions to count.
+double work(const size_t& size) {
+  std::vector<double> values(size, 1.0);
+  double sum = 0.0;
+  for (const double& value : values) sum += value;
+  return sum;
+}
+}  // namespace
+
+/* ************************************************************************* */
+TEST(testPerfCounters, disabledSamplesNothing) {
+  FLAGS_enable_perf_counters = false;
+  {
+    KIMERA_PERF_SCOPE("testPerfCounters disabled");
+    EXPECT_DOUBLE_EQ(work(1000u), 1000.0);
+  }
+  EXPECT_FALSE(utils::Statistics::HasHandle(
+      "testPerfCounters disabled instructions [#]"));
+}
+
+/* ************************************************************************* */
+TEST(testPerfCounters, scopeSamplesItsCounts) {
+  utils::PerfCounters::Values values;
+  if (!utils::PerfCounters::read(&values)) {
+    GTEST_SKIP() << "No performance counter available.";
+  }
+  // Counts only increase.
+  utils::PerfCounters::Values later;
+  ASSERT_TRUE(utils::PerfCounters::read(&later));
+  for (size_t i = 0u; i < utils::PerfCounters::kNumCounters; ++i) {
+    EXPECT_EQ(later.available[i], values.available[i]);
+    EXPECT_GE(later.counts[i], values.counts[i]);
+  }
+
+  FLAGS_enable_perf_counters = true;
+  for (size_t i = 0u; i < 3u; ++i) {
+    KIMERA_PERF_SCOPE("testPerfCounters enabled");
+    EXPECT_DOUBLE_EQ(work(100000u), 100000.0);
+  }
+  FLAGS_enable_perf_counters = false;
+  for (size_t i = 0u; i < utils::PerfCounters::kNumCounters; ++i) {
+    const std::string tag =
+        std::string("testPerfCounters enabled ") +
+        utils::PerfCounters::getName(
+            static_cast<utils::PerfCounters::Counter>(i)) +
+        " [#]";
+    EXPECT_EQ(utils::Statistics::GetNumSamples(tag),
+              values.available[i] ? 3u : 0u)
+        << tag;
+  }
+  if (values.available[utils::PerfCounters::kInstructions]) {
+    // At least one instruction per value.
+    EXPECT_GT(utils::Statistics::GetMin(
+                  "testPerfCounters enabled instructions [#]"),
+              100000.0);
+  }
+}
+
+}  // namespace VIO
@@ -0,0 +1,122 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testPipelineCheckpoint.cpp
+ * @brief  Unit tests PipelineCheckpoint class' functionality.
+ * @author Antoni Rosinol
+ */
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/pipeline/PipelineCheckpoint.h"
+
+namespace VIO {
+
+class PipelineCheckpointFixture : public ::testing::Test {
+ public:
+  PipelineCheckpointFixture()
+      : filepath_((std::filesystem::temp_directory_path() /
+                   "kimera_test_pipeline_checkpoint.bin")
+                      .string()) {}
+
+ protected:
+  void SetUp() override { std::filesystem::remove(filepath_); }
+  void TearDown() override { std::filesystem::remove(filepath_); }
+
+  static VioNavStateTimestamped makeState() {
+    return VioNavStateTimestamped(
+        1403636580838555648,
+        gtsam::Pose3(gtsam::Rot3::RzRyRx(0.1, -0.2, 0.3),
+                     gtsam::Point3(1.0, -2.0, 3.0)),
+        gtsam::Vector3(0.5, 0.25, -0.125),
+        gtsam::imuBias::ConstantBias(gtsam::Vector3(0.01, 0.02, 0.03),
+                                     gtsam::Vector3(-0.001, 0.002, -0.003)));
+  }
+
+  const std::string filepath_;
+};
+
+TEST_F(PipelineCheckpointFixture, SaveAndLoad) {
+  const VioNavStateTimestamped state = makeState();
+  ASSERT_TRUE(PipelineCheckpoint(state).save(filepath_));
+  // The temporary file is renamed.
+  EXPECT_FALSE(std::filesystem::exists(filepath_ + ".tmp"));
+
+  PipelineCheckpoint checkpoint;
+  ASSERT_TRUE(PipelineCheckpoint::load(filepath_, &checkpoint));
+  EXPECT_EQ(checkpoint.state_.timestamp_, state.timestamp_);
+  EXPECT_TRUE(checkpoint.state_.equals(state));
+}
+
+TEST_F(PipelineCheckpointFixture, SaveOverwritesPreviousCheckpoint) {
+  VioNavStateTimestamped state = makeState();
+  ASSERT_TRUE(PipelineCheckpoint(state).save(filepath_));
+  state.timestamp_ += 100000000;
+  state.velocity_ = gtsam::Vector3(-1.0, 0.0, 1.0);
+  ASSERT_TRUE(PipelineCheckpoint(state).save(filepath_));
+
+  PipelineCheckpoint checkpoint;
+  ASSERT_TRUE(PipelineCheckpoint::load(filepath_, &checkpoint));
+  EXPECT_TRUE(checkpoint.state_.equals(state));
+}
+
+TEST_F(PipelineCheckpointFixture, LoadMissingFile) {
+  PipelineCheckpoint checkpoint;
+  EXPECT_FALSE(PipelineCheckpoint::load(filepath_, &checkpoint));
+}
+
+TEST_F(PipelineCheckpointFixture, LoadInvalidFile) {
+  {
+    std::ofstream stream(filepath_, std::ios::binary);
+    stream << "not a checkpoint";
+  }
+  PipelineCheckpoint checkpoint;
+  EXPECT_FALSE(PipelineCheckpoint::load(filepath_, &checkpoint));
+  EXPECT_EQ(checkpoint.state_.timestamp_, 0);
+}
+
+TEST_F(PipelineCheckpointFixture, LoadTruncatedFile) {
+  ASSERT_TRUE(PipelineCheckpoint(makeState()).save(filepath_));
+  std::filesystem::resize_file(filepath_,
+                               std::filesystem::file_size(filepath_) - 8u);
+  PipelineCheckpoint checkpoint;
+  EXPECT_FALSE(PipelineCheckpoint::load(filepath_, &checkpoint));
+}
+
+TEST_F(PipelineCheckpointFixture, WriterSavesLatestState) {
+  VioNavStateTimestamped state = makeState();
+  {
+    PipelineCheckpointWriter writer(filepath_);
+    for (int i = 0; i < 10; ++i) {
+      state.timestamp_ += 1000;
+      writer.write(state);
+    }
+    writer.flush();
+    PipelineCheckpoint checkpoint;
+    ASSERT_TRUE(PipelineCheckpoint::load(filepath_, &checkpoint));
+    EXPECT_EQ(checkpoint.state_.timestamp_, state.timestamp_);
+    EXPECT_LT(writer.getNrSkipped(), 10u);
+
+    // Saved on destruction, without a flush.
+    state.timestamp_ += 1000;
+    writer.write(state);
+  }
+  PipelineCheckpoint checkpoint;
+  ASSERT_TRUE(PipelineCheckpoint::load(filepath_, &checkpoint));
+  EXPECT_EQ(checkpoint.state_.timestamp_, state.timestamp_);
+  EXPECT_TRUE(checkpoint.state_.equals(state));
+  EXPECT_FALSE(std::filesystem::exists(filepath_ + ".tmp"));
+}
+
+}  // namespace VIO
@@ -0,0 +1,364 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testPipelineRecording.cpp
+ * @brief  Unit tests PipelineRecorder and PipelineRecordingReader classes.
+ * @author Antoni Rosinol
+ */
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <gtsam/navigation/CombinedImuFactor.h>
+#include <gtsam/navigation/ImuFactor.h>
+
+#include "kimera-vio/frontend/StereoFrame.h"
+#include "kimera-vio/frontend/StereoVisionImuFrontend-definitions.h"
+#include "kimera-vio/imu-frontend/ImuFrontend.h"
+#include "kimera-vio/pipeline/PipelineRecording.h"
+
+DECLARE_string(test_data_path);
+
+namespace VIO {
+
+class PipelineRecordingFixture : public ::testing::Test {
+ public:
+  PipelineRecordingFixture()
+      : filepath_((std::filesystem::temp_directory_path() /
+                   "kimera_test_pipeline_recording.bin")
+                      .string()),
+        cam_params_left_(),
+        cam_params_right_() {
+    const std::string data_path = FLAGS_test_data_path + "/ForStereoFrame/";
+    cam_params_left_.parseYAML(data_path + "sensorLeft.yaml");
+    cam_params_right_.parseYAML(data_path + "sensorRight.yaml");
+  }
+
+ protected:
+  void SetUp() override { std::filesystem::remove(filepath_); }
+  void TearDown() override { std::filesystem::remove(filepath_); }
+
+  static ImuFrontend::PimPtr makePim(const ImuPreintegrationType& type) {
+    ImuParams imu_params;
+    imu_params.acc_random_walk_ = 0.01;
+    imu_params.acc_noise_density_ = 0.02;
+    imu_params.gyro_random_walk_ = 0.001;
+    imu_params.gyro_noise_density_ = 0.002;
+    imu_params.imu_integration_sigma_ = 1e-4;
+    imu_params.imu_preintegration_type_ = type;
+    ImuFrontend imu_frontend(
+        imu_params,
+        ImuBias(gtsam::Vector3(0.1, -0.2, 0.3), gtsam::Vector3(0.01, 0, 0)));
+    const size_t nr_measurements = 10u;
+    ImuStampS imu_timestamps(1, nr_measurements);
+    ImuAccGyrS imu_measurements(6, nr_measurements);
+    for (size_t i = 0u; i < nr_measurements; ++i) {
+      imu_timestamps(0, i) = 1000000000 + i * 5000000;
+      imu_measurements.col(i) << 0.1 * i, 0.2, 9.81, 0.01, -0.02 * i, 0.03;
+    }
+    return imu_frontend.preintegrateImuMeasurements(imu_timestamps,
+                                                    imu_measurements);
+  }
+
+  static StatusStereoMeasurementsPtr makeStereoMeasurements() {
+    TrackerStatusSummary status;
+    status.kfTrackingStatus_mono_ = TrackingStatus::VALID;
+    status.kfTrackingStatus_stereo_ = TrackingStatus::FEW_MATCHES;
+    status.kfTracking_status_pnp_ = TrackingStatus::INVALID;
+    status.lkf_T_k_mono_ = gtsam::Pose3(gtsam::Rot3::RzRyRx(0.1, 0.2, 0.3),
+                                        gtsam::Point3(1.0, 2.0, 3.0));
+    status.infoMatStereoTranslation_ = 2.0 * gtsam::Matrix3::Identity();
+    StereoMeasurements measurements;
+    measurements.push_back({3, gtsam::StereoPoint2(320.5, 300.25, 240.0)});
+    measurements.push_back({7, gtsam::StereoPoint2(100.0, 90.0, 12.5)});
+    return std::make_shared<StatusStereoMeasurements>(
+        std::make_pair(status, measurements));
+  }
+
+  StereoFrontendOutput::Ptr makeFrontendOutput(const bool& with_images) const {
+    const FrameId id = 4u;
+    const Timestamp timestamp = 1000000042;
+    cv::Mat left_img, right_img;
+    if (with_images) {
+      left_img = cv::Mat(48, 64, CV_8UC1, cv::Scalar(17));
+      right_img = cv::Mat(48, 64, CV_8UC1, cv::Scalar(42));
+    }
+    Frame left_frame(id, timestamp, cam_params_left_, left_img);
+    left_frame.keypoints_ = {KeypointCV(10.0, 20.0), KeypointCV(30.0, 40.0)};
+    left_frame.keypoints_undistorted_ = {
+        {KeypointStatus::VALID, KeypointCV(10.5, 20.5)},
+        {KeypointStatus::NO_RIGHT_RECT, KeypointCV(30.5, 40.5)}};
+    left_frame.scores_ = {1.0, 0.5};
+    left_frame.landmarks_ = {3, 7};
+    left_frame.landmarks_age_ = {2u, 5u};
+    left_frame.versors_ = {gtsam::Vector3(0.0, 0.0, 1.0),
+                           gtsam::Vector3(0.6, 0.0, 0.8)};
+    Frame right_frame(id, timestamp, cam_params_right_, right_img);
+    StereoFrame stereo_frame(id, timestamp, left_frame, right_frame);
+    stereo_frame.setIsKeyframe(true);
+    stereo_frame.left_keypoints_rectified_ =
+        left_frame.keypoints_undistorted_;
+    stereo_frame.right_keypoints_rectified_ = {
+        {KeypointStatus::VALID, KeypointCV(8.0, 20.5)},
+        {KeypointStatus::NO_RIGHT_RECT, KeypointCV(0.0, 0.0)}};
+    stereo_frame.keypoints_depth_ = {2.5, 0.0};
+    stereo_frame.keypoints_3d_ = {gtsam::Vector3(0.0, 0.0, 2.5),
+                                  gtsam::Vector3::Zero()};
+    return std::make_shared<StereoFrontendOutput>(
+        true,
+        makeStereoMeasurements(),
+        gtsam::Pose3(gtsam::Rot3::RzRyRx(-0.1, 0.0, 0.1), gtsam::Point3()),
+        gtsam::Pose3(gtsam::Rot3(), gtsam::Point3(0.1, 0.0, 0.0)),
+        stereo_frame,
+        nullptr,
+        ImuAccGyrS(6, 0),
+        cv::Mat(),
+        DebugTrackerInfo(),
+        gtsam::Pose3(gtsam::Rot3(), gtsam::Point3(0.5, 0.0, 0.0)),
+        std::nullopt);
+  }
+
+  void expectStereoFramesEqual(const StereoFrame& expected,
+                               const StereoFrame& actual) const {
+    EXPECT_EQ(actual.id_, expected.id_);
+    EXPECT_EQ(actual.timestamp_, expected.timestamp_);
+    EXPECT_EQ(actual.isKeyframe(), expected.isKeyframe());
+    const Frame& expected_left = expected.left_frame_;
+    const Frame& actual_left = actual.left_frame_;
+    EXPECT_EQ(actual_left.keypoints_, expected_left.keypoints_);
+    EXPECT_EQ(actual_left.keypoints_undistorted_,
+              expected_left.keypoints_undistorted_);
+    EXPECT_EQ(actual_left.scores_, expected_left.scores_);
+    EXPECT_EQ(actual_left.landmarks_, expected_left.landmarks_);
+    EXPECT_EQ(actual_left.landmarks_age_, expected_left.landmarks_age_);
+    ASSERT_EQ(actual_left.versors_.size(), expected_left.versors_.size());
+    for (size_t i = 0u; i < expected_left.versors_.size(); ++i) {
+      EXPECT_TRUE(gtsam::assert_equal(expected_left.versors_[i],
+                                      actual_left.versors_[i]));
+    }
+    EXPECT_EQ(actual.left_keypoints_rectified_,
+              expected.left_keypoints_rectified_);
+    EXPECT_EQ(actual.right_keypoints_rectified_,
+              expected.right_keypoints_rectified_);
+    EXPECT_EQ(actual.keypoints_depth_, expected.keypoints_depth_);
+    ASSERT_EQ(actual.keypoints_3d_.size(), expected.keypoints_3d_.size());
+    for (size_t i = 0u; i < expected.keypoints_3d_.size(); ++i) {
+      EXPECT_TRUE(gtsam::assert_equal(expected.keypoints_3d_[i],
+                                      actual.keypoints_3d_[i]));
+    }
+  }
+
+  const std::string filepath_;
+  CameraParams cam_params_left_;
+  CameraParams cam_params_right_;
+};
+
+TEST_F(PipelineRecordingFixture, BackendInputs) {
+  const VioNavState initial_state(
+      gtsam::Pose3(gtsam::Rot3::RzRyRx(0.1, -0.2, 0.3),
+                   gtsam::Point3(1.0, -2.0, 3.0)),
+      gtsam::Vector3(0.5, 0.25, -0.125),
+      ImuBias(gtsam::Vector3(0.01, 0.02, 0.03), gtsam::Vector3::Zero()));
+  ImuAccGyrS imu_acc_gyrs(6, 3);
+  imu_acc_gyrs.setRandom();
+  const BackendInput regular_input(
+      1000000000,
+      makeStereoMeasurements(),
+      makePim(ImuPreintegrationType::kPreintegratedImuMeasurements),
+      imu_acc_gyrs,
+      gtsam::Pose3(gtsam::Rot3::RzRyRx(0.0, 0.1, 0.0), gtsam::Point3()),
+      gtsam::Velocity3(1.0, 0.0, 0.0));
+  const BackendInput combined_input(
+      1100000000,
+      makeStereoMeasurements(),
+      makePim(ImuPreintegrationType::kPreintegratedCombinedMeasurements),
+      ImuAccGyrS(6, 0));
+  {
+    PipelineRecorder recorder(filepath_);
+    recorder.recordInitialState(initial_state);
+    recorder.recordBackendInput(regular_input);
+    recorder.recordBackendInput(combined_input);
+    recorder.flush();
+  }
+
+  PipelineRecordingReader reader(
+      filepath_, cam_params_left_, cam_params_right_);
+  PipelineRecord record;
+  ASSERT_TRUE(reader.next(&record));
+  EXPECT_EQ(record.type_, PipelineRecordType::kInitialState);
+  EXPECT_TRUE(record.initial_state_.equals(initial_state));
+
+  ASSERT_TRUE(reader.next(&record));
+  ASSERT_EQ(record.type_, PipelineRecordType::kBackendInput);
+  ASSERT_TRUE(record.backend_input_);
+  const BackendInput& regular_output = *record.backend_input_;
+  EXPECT_EQ(regular_output.timestamp_, regular_input.timestamp_);
+  const StatusStereoMeasurements& status_measurements =
+      *regular_output.status_stereo_measurements_kf_;
+  EXPECT_EQ(status_measurements.first.kfTrackingStatus_stereo_,
+            TrackingStatus::FEW_MATCHES);
+  EXPECT_TRUE(status_measurements.first.lkf_T_k_mono_.equals(
+      regular_input.status_stereo_measurements_kf_->first.lkf_T_k_mono_));
+  ASSERT_EQ(status_measurements.second.size(), 2u);
+  EXPECT_EQ(status_measurements.second[1].first, 7);
+  EXPECT_TRUE(status_measurements.second[1].second.equals(
+      gtsam::StereoPoint2(100.0, 90.0, 12.5)));
+  const auto* regular_pim =
+      dynamic_cast<const gtsam::PreintegratedImuMeasurements*>(
+          regular_output.pim_.get());
+  ASSERT_TRUE(regular_pim);
+  EXPECT_TRUE(regular_pim->equals(
+      dynamic_cast<const gtsam::PreintegratedImuMeasurements&>(
+          *regular_input.pim_),
+      1e-12));
+  EXPECT_TRUE(gtsam::assert_equal(gtsam::Matrix(regular_input.imu_acc_gyrs_),
+                                  gtsam::Matrix(regular_output.imu_acc_gyrs_)));
+  ASSERT_TRUE(regular_output.body_lkf_OdomPose_body_kf_);
+  EXPECT_TRUE(regular_output.body_lkf_OdomPose_body_kf_->equals(
+      *regular_input.body_lkf_OdomPose_body_kf_));
+  ASSERT_TRUE(regular_output.body_kf_world_OdomVel_body_kf_);
+
+  ASSERT_TRUE(reader.next(&record));
+  ASSERT_EQ(record.type_, PipelineRecordType::kBackendInput);
+  const BackendInput& combined_output = *record.backend_input_;
+  const auto* combined_pim =
+      dynamic_cast<const gtsam::PreintegratedCombinedMeasurements*>(
+          combined_output.pim_.get());
+  ASSERT_TRUE(combined_pim);
+  EXPECT_TRUE(combined_pim->equals(
+      dynamic_cast<const gtsam::PreintegratedCombinedMeasurements&>(
+          *combined_input.pim_),
+      1e-12));
+  EXPECT_FALSE(combined_output.body_lkf_OdomPose_body_kf_);
+  EXPECT_FALSE(combined_output.body_kf_world_OdomVel_body_kf_);
+
+  EXPECT_FALSE(reader.next(&record));
+}
+
+TEST_F(PipelineRecordingFixture, MesherAndLcdInputs) {
+  const StereoFrontendOutput::Ptr frontend_output = makeFrontendOutput(true);
+  PointsWithIdMap points;
+  points[3] = gtsam::Point3(0.0, 0.0, 2.5);
+  points[7] = gtsam::Point3(1.0, -1.0, 4.0);
+  LmkIdToLmkTypeMap lmk_types;
+  lmk_types[3] = LandmarkType::SMART;
+  lmk_types[7] = LandmarkType::PROJECTION;
+  const VioNavStateTimestamped state(
+      frontend_output->timestamp_,
+      gtsam::Pose3(gtsam::Rot3::RzRyRx(0.0, 0.0, 0.5), gtsam::Point3(1, 2, 3)),
+      gtsam::Vector3(0.1, 0.2, 0.3),
+      ImuBias());
+  const BackendOutput::Ptr backend_output =
+      std::make_shared<BackendOutput>(state,
+                                      gtsam::Values(),
+                                      gtsam::NonlinearFactorGraph(),
+                                      gtsam::Matrix(),
+                                      4u,
+                                      2,
+                                      DebugVioInfo(),
+                                      points,
+                                      lmk_types);
+  const MesherInput mesher_input(
+      frontend_output->timestamp_, frontend_output, backend_output);
+  const LcdInput lcd_input(
+      frontend_output->timestamp_, frontend_output, backend_output);
+  // The landmarks are shared with the Backend output.
+  EXPECT_EQ(lcd_input.W_points_with_ids_.get(),
+            &backend_output->landmarks_with_id_map_);
+  {
+    PipelineRecorder recorder(filepath_);
+    recorder.recordMesherInput(mesher_input);
+    recorder.recordLcdInput(lcd_input);
+  }
+
+  PipelineRecordingReader reader(
+      filepath_, cam_params_left_, cam_params_right_);
+  PipelineRecord record;
+  ASSERT_TRUE(reader.next(&record));
+  ASSERT_EQ(record.type_, PipelineRecordType::kMesherInput);
+  ASSERT_TRUE(record.mesher_input_);
+  const MesherInput& mesher_output = *record.mesher_input_;
+  EXPECT_EQ(mesher_output.timestamp_, mesher_input.timestamp_);
+  expectStereoFramesEqual(*frontend_output->stereo_frame_lkf_,
+                          *mesher_output.frontend_output_->stereo_frame_lkf_);
+  // Images are only recorded for the LCD.
+  EXPECT_TRUE(
+      mesher_output.frontend_output_->stereo_frame_lkf_->left_frame_.img_
+          .empty());
+  ASSERT_TRUE(mesher_output.frontend_output_->body_lkf_OdomPose_body_kf_);
+  EXPECT_TRUE(mesher_output.backend_output_->W_State_Blkf_.equals(state));
+  EXPECT_EQ(mesher_output.backend_output_->landmarks_with_id_map_.size(), 2u);
+  EXPECT_TRUE(gtsam::assert_equal(
+      points[7], mesher_output.backend_output_->landmarks_with_id_map_.at(7)));
+  EXPECT_EQ(mesher_output.backend_output_->lmk_id_to_lmk_type_map_, lmk_types);
+
+  ASSERT_TRUE(reader.next(&record));
+  ASSERT_EQ(record.type_, PipelineRecordType::kLcdInput);
+  ASSERT_TRUE(record.lcd_input_);
+  const LcdInput& lcd_output = *record.lcd_input_;
+  EXPECT_EQ(lcd_output.cur_kf_id_, 4u);
+  EXPECT_TRUE(lcd_output.W_Pose_Blkf_.equals(state.pose_));
+  EXPECT_EQ(lcd_output.W_points_with_ids_->size(), 2u);
+  const StereoFrontendOutput* lcd_frontend_output =
+      dynamic_cast<const StereoFrontendOutput*>(
+          lcd_output.frontend_output_.get());
+  ASSERT_TRUE(lcd_frontend_output);
+  const Frame& expected_right =
+      frontend_output->stereo_frame_lkf_->right_frame_;
+  const Frame& actual_right =
+      lcd_frontend_output->stereo_frame_lkf_->right_frame_;
+  ASSERT_EQ(actual_right.img_.size(), expected_right.img_.size());
+  EXPECT_EQ(cv::countNonZero(actual_right.img_ != expected_right.img_), 0);
+
+  EXPECT_FALSE(reader.next(&record));
+}
+
+TEST_F(PipelineRecordingFixture, SkipsUnknownRecords) {
+  {
+    PipelineRecorder recorder(filepath_);
+    recorder.recordInitialState(VioNavState());
+  }
+  {
+    // Append a record of a newer type.
+    std::ofstream stream(filepath_, std::ios::binary | std::ios::app);
+    const uint32_t type = 42u;
+    const uint64_t payload_size = 3u;
+    stream.write(reinterpret_cast<const char*>(&type), sizeof(type));
+    stream.write(reinterpret_cast<const char*>(&payload_size),
+                 sizeof(payload_size));
+    stream.write("abc", payload_size);
+  }
+  PipelineRecordingReader reader(
+      filepath_, cam_params_left_, cam_params_right_);
+  PipelineRecord record;
+  ASSERT_TRUE(reader.next(&record));
+  EXPECT_EQ(record.type_, PipelineRecordType::kInitialState);
+  EXPECT_FALSE(reader.next(&record));
+}
+
+TEST_F(PipelineRecordingFixture, InvalidFile) {
+  {
+    std::ofstream stream(filepath_, std::ios::binary);
+    stream << "not a recording";
+  }
+  EXPECT_DEATH(
+      {
+        PipelineRecordingReader reader(
+            filepath_, cam_params_left_, cam_params_right_);
+      },
+      "Not a pipeline recording");
+}
+
+}  // namespace VIO
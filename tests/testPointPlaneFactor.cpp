@@ -22,6 +22,7 @@
 #include <gtsam_unstable/nonlinear/IncrementalFixedLagSmoother.h>
 
 #include <algorithm>
+#include <chrono>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
@@ -30,6 +31,7 @@
 #include "kimera-vio/backend/VioBackendParams.h"
 #include "kimera-vio/factors/PointPlaneFactor.h"
 #include "kimera-vio/test/EvaluateFactor.h"
+#include "kimera-vio/utils/Timer.h"
 
 using namespace std;
 using namespace gtsam;
@@ -170,6 +172,63 @@ TEST(testPointPlaneFactor, JacobiansNegative) {
   VIO::test::evaluateFactor(factor, point, plane, delta_value, tol);
 }
 
+/**
+ * Test that the fixed-size linearization equals the generic one, and that
+ * robust noise models fall back to the generic one.
+ */
+TEST(testPointPlaneFactor, FixedSizeLinearization) {
+  Key pointKey(1);
+  Key planeKey(2);
+  const SharedNoiseModel gaussian_noise =
+      noiseModel::Diagonal::Sigmas(Vector1::Constant(0.1));
+  const SharedNoiseModel robust_noise = noiseModel::Robust::Create(
+      noiseModel::mEstimator::Huber::Create(0.01), gaussian_noise);
+
+  Values values;
+  values.insert(pointKey, Point3(4.3, 3.2, 1.9));
+  values.insert(planeKey, OrientedPlane3(Unit3(2.4, 1.2, 1.9), -2.3));
+  for (const SharedNoiseModel& noise : {gaussian_noise, robust_noise}) {
+    PointPlaneFactor factor(pointKey, planeKey, noise);
+    const GaussianFactor::shared_ptr expected =
+        factor.NoiseModelFactor::linearize(values);
+    const GaussianFactor::shared_ptr actual = factor.linearize(values);
+    ASSERT_TRUE(expected);
+    ASSERT_TRUE(actual);
+    EXPECT_TRUE(expected->equals(*actual, tol));
+  }
+}
+
+/**
+ * Microbenchmark of the fixed-size linearization against the generic one.
+ */
+TEST(testPointPlaneFactor, FixedSizeLinearizationTiming) {
+  Key pointKey(1);
+  Key planeKey(2);
+  PointPlaneFactor factor(pointKey,
+                          planeKey,
+                          noiseModel::Diagonal::Sigmas(Vector1::Constant(0.1)));
+  Values values;
+  values.insert(pointKey, Point3(4.3, 3.2, 1.9));
+  values.insert(planeKey, OrientedPlane3(Unit3(2.4, 1.2, 1.9), 2.3));
+
+  static constexpr size_t kNrLinearizations = 100000u;
+  auto tic = VIO::utils::Timer::tic();
+  for (size_t i = 0u; i < kNrLinearizations; ++i) {
+    EXPECT_TRUE(factor.NoiseModelFactor::linearize(values));
+  }
+  const auto generic_us =
+      VIO::utils::Timer::toc<std::chrono::microseconds>(tic).count();
+  tic = VIO::utils::Timer::tic();
+  for (size_t i = 0u; i < kNrLinearizations; ++i) {
+    EXPECT_TRUE(factor.linearize(values));
+  }
+  const auto fixed_size_us =
+      VIO::utils::Timer::toc<std::chrono::microseconds>(tic).count();
+  LOG(INFO) << kNrLinearizations << " PointPlaneFactor linearizations:\n"
+            << " - Generic: " << generic_us << " us.\n"
+            << " - Fixed-size: " << fixed_size_us << " us.";
+}
+
 /**
  * Test that optimization works for plane parameters.
  * Three landmarks, with prior factors, and a plane constrained together
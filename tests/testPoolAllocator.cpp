@@ -0,0 +1,86 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testPoolAllocator.cpp
+ * @brief  test FixedSizeBlockPool and PoolAllocator
+ * @author Antoni Rosinol
+ */
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <set>
+#include <vector>
+
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/inference/Symbol.h>
+#include <gtsam/nonlinear/NonlinearFactorGraph.h>
+#include <gtsam/slam/BetweenFactor.h>
+
+#include "kimera-vio/utils/PoolAllocator.h"
+
+namespace VIO {
+
+TEST(testPoolAllocator, BlocksAreRecycled) {
+  FixedSizeBlockPool pool(24u, 8u, 4u);
+  EXPECT_EQ(pool.getBlockSize(), 24u);
+  EXPECT_EQ(pool.getNrBlocks(), 0u);
+
+  std::vector<void*> blocks;
+  for (size_t i = 0u; i < 5u; ++i) blocks.push_back(pool.allocate());
+  // Two chunks of 4 blocks.
+  EXPECT_EQ(pool.getNrBlocks(), 8u);
+  EXPECT_EQ(pool.getNrFreeBlocks(), 3u);
+  EXPECT_EQ(std::set<void*>(blocks.begin(), blocks.end()).size(), 5u);
+
+  void* released = blocks.back();
+  pool.deallocate(released);
+  EXPECT_EQ(pool.allocate(), released);
+  for (void* block : blocks) pool.deallocate(block);
+  EXPECT_EQ(pool.getNrFreeBlocks(), 8u);
+  EXPECT_EQ(pool.getNrBlocks(), 8u);
+}
+
+TEST(testPoolAllocator, BlocksAreAligned) {
+  // The block size is rounded up to the alignment.
+  FixedSizeBlockPool pool(40u, 32u, 3u);
+  EXPECT_EQ(pool.getBlockSize(), 64u);
+  for (size_t i = 0u; i < 7u; ++i) {
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(pool.allocate()) % 32u, 0u);
+  }
+}
+
+TEST(testPoolAllocator, AllocatePooledFactors) {
+  typedef gtsam::BetweenFactor<gtsam::Pose3> Factor;
+  const gtsam::SharedNoiseModel noise =
+      gtsam::noiseModel::Isotropic::Sigma(6u, 0.1);
+  gtsam::NonlinearFactorGraph graph;
+  for (size_t i = 0u; i < 10u; ++i) {
+    graph.push_back(allocatePooled<Factor>(
+        gtsam::Symbol('x', i), gtsam::Symbol('x', i + 1u), gtsam::Pose3(),
+        noise));
+  }
+  ASSERT_EQ(graph.size(), 10u);
+  const auto factor = boost::dynamic_pointer_cast<Factor>(graph.at(3u));
+  ASSERT_TRUE(factor);
+  EXPECT_EQ(factor->key1(), gtsam::Symbol('x', 3u));
+  EXPECT_EQ(factor->key2(), gtsam::Symbol('x', 4u));
+  EXPECT_EQ(factor->noiseModel(), noise);
+
+  // Releasing the graph gives the blocks back for the next factors.
+  graph.resize(0u);
+  const void* recycled = allocatePooled<Factor>(
+                             gtsam::Symbol('x', 0u), gtsam::Symbol('x', 1u),
+                             gtsam::Pose3(), noise)
+                             .get();
+  EXPECT_NE(recycled, nullptr);
+}
+
+}  // namespace VIO
@@ -0,0 +1,86 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testPoseHistory.cpp
+ * @brief  test the interpolated pose history
+ * @author Antoni Rosinol
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <gtsam/geometry/Pose3.h>
+
+#include "kimera-vio/common/PoseHistory.h"
+
+namespace VIO {
+
+TEST(testPoseHistory, interpolatesBetweenPoses) {
+  PoseHistory history;
+  gtsam::Pose3 pose;
+  EXPECT_FALSE(history.getPoseAtTime(0, &pose));
+
+  const gtsam::Pose3 first(gtsam::Rot3(), gtsam::Point3(0.0, 0.0, 0.0));
+  const gtsam::Pose3 second(gtsam::Rot3::Yaw(0.2),
+                            gtsam::Point3(2.0, 0.0, 0.0));
+  history.addPose(100, first);
+  history.addPose(200, second);
+  EXPECT_EQ(history.size(), 2u);
+
+  // Outside of the history.
+  EXPECT_FALSE(history.getPoseAtTime(99, &pose));
+  EXPECT_FALSE(history.getPoseAtTime(201, &pose));
+
+  ASSERT_TRUE(history.getPoseAtTime(200, &pose));
+  EXPECT_TRUE(pose.equals(second));
+  ASSERT_TRUE(history.getPoseAtTime(125, &pose));
+  EXPECT_TRUE(pose.equals(gtsam::Pose3(gtsam::Rot3::Yaw(0.05),
+                                       gtsam::Point3(0.5, 0.0, 0.0)),
+                          1e-9));
+}
+
+TEST(testPoseHistory, insertsOutOfOrderPoses) {
+  PoseHistory history;
+  history.addPose(300, gtsam::Pose3(gtsam::Rot3(), gtsam::Point3(3, 0, 0)));
+  history.addPose(100, gtsam::Pose3(gtsam::Rot3(), gtsam::Point3(1, 0, 0)));
+  history.addPose(200, gtsam::Pose3(gtsam::Rot3(), gtsam::Point3(5, 0, 0)));
+  // Overwrites the pose at the same timestamp.
+  history.addPose(200, gtsam::Pose3(gtsam::Rot3(), gtsam::Point3(2, 0, 0)));
+  EXPECT_EQ(history.size(), 3u);
+
+  gtsam::Pose3 pose;
+  ASSERT_TRUE(history.getPoseAtTime(250, &pose));
+  EXPECT_NEAR(pose.x(), 2.5, 1e-9);
+
+  Timestamp timestamp = 0;
+  ASSERT_TRUE(history.getLatestPose(&timestamp, &pose));
+  EXPECT_EQ(timestamp, 300);
+  EXPECT_NEAR(pose.x(), 3.0, 1e-9);
+}
+
+TEST(testPoseHistory, appliesCorrectionOnRead) {
+  PoseHistory history;
+  const gtsam::Pose3 W_Pose_B(gtsam::Rot3::Roll(0.1), gtsam::Point3(1, 2, 3));
+  history.addPose(100, W_Pose_B);
+
+  const gtsam::Pose3 Map_Pose_Odom(gtsam::Rot3::Yaw(0.5),
+                                   gtsam::Point3(-1, 0, 4));
+  history.setCorrection(Map_Pose_Odom);
+  EXPECT_TRUE(history.getCorrection().equals(Map_Pose_Odom));
+
+  gtsam::Pose3 pose;
+  ASSERT_TRUE(history.getPoseAtTime(100, &pose));
+  EXPECT_TRUE(pose.equals(Map_Pose_Odom * W_Pose_B));
+  // The odometry pose is kept as is.
+  ASSERT_TRUE(history.getPoseAtTime(100, &pose, false));
+  EXPECT_TRUE(pose.equals(W_Pose_B));
+}
+
+}  // namespace VIO
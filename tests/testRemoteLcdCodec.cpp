@@ -0,0 +1,340 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testRemoteLcdCodec.cpp
+ * @brief  test the packets exchanged with the remote LCD server
+ * @author Antoni Rosinol
+ */
+
+#include <DBoW2/DBoW2.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtsam/geometry/Pose3.h>
+
+#include "kimera-vio/loopclosure/RemoteLcdCodec.h"
+
+namespace VIO {
+
+namespace {
+
+StereoLCDFrame::Ptr makeFrame(const FrameId& id) {
+  cv::RNG rng(7);
+  std::vector<cv::KeyPoint> keypoints;
+  Landmarks keypoints_3d;
+  OrbDescriptor descriptors_mat;
+  BearingVectors bearing_vectors;
+  for (int i = 0; i < 10; ++i) {
+    keypoints.emplace_back(
+        rng.uniform(0.f, 640.f), rng.uniform(0.f, 480.f), 31.f);
+    keypoints_3d.emplace_back(rng.uniform(-1.0, 1.0), 0.5, 2.0);
+    bearing_vectors.push_back(keypoints_3d.back().normalized());
+    cv::Mat descriptor(1, DBoW2::FORB::L, CV_8U);
+    rng.fill(descriptor, cv::RNG::UNIFORM, 0, 256);
+    descriptors_mat.push_back(descriptor);
+  }
+  StatusKeypointsCV rectified(
+      10u, std::make_pair(KeypointStatus::VALID, KeypointCV(1.f, 2.f)));
+  return std::make_shared<StereoLCDFrame>(id * 10,
+                                          id,
+                                          id,
+                                          keypoints,
+                                          keypoints_3d,
+                                          descriptors_mat,
+                                          bearing_vectors,
+                                          rectified,
+                                          rectified);
+}
+
+//! Sends the bytes of the frame edited, as a robot would send a corrupted
+//! or malicious frame.
+class EditedFrame : public StereoLCDFrame {
+ public:
+  EditedFrame(const StereoLCDFrame& frame,
+              const std::function<void(std::string*)>& edit)
+      : StereoLCDFrame(frame), edit_(edit) {}
+
+  void save(std::ostream& buffer) const override {
+    std::ostringstream frame_stream;
+    StereoLCDFrame::save(frame_stream);
+    std::string bytes = frame_stream.str();
+    edit_(&bytes);
+    buffer << bytes;
+  }
+
+ private:
+  const std::function<void(std::string*)> edit_;
+};
+
+//! Whether the keyframe of makeFrame is decoded with its frame edited.
+bool decodeEditedKeyframe(const std::function<void(std::string*)>& edit) {
+  RemoteKeyframe keyframe;
+  keyframe.robot_id_ = 1u;
+  keyframe.kf_id_ = 5u;
+  keyframe.timestamp_ = 50;
+  keyframe.frame_ = std::make_shared<EditedFrame>(*makeFrame(5u), edit);
+  std::string packet;
+  RemoteLcdCodec::encodeKeyframe(keyframe, &packet);
+  RemoteKeyframe decoded;
+  const bool success =
+      RemoteLcdCodec::decodeKeyframe(packet.data(), packet.size(), &decoded);
+  EXPECT_EQ(success, static_cast<bool>(decoded.frame_));
+  return success;
+}
+
+//! Overwrites the size_t at the offset of the frame bytes.
+void setCount(const size_t& offset, const size_t& count, std::string* bytes) {
+  ASSERT_LE(offset + sizeof(count), bytes->size());
+  std::memcpy(&(*bytes)[offset], &count, sizeof(count));
+}
+
+RemoteLcdCorrection makeCorrection() {
+  RemoteLcdCorrection correction;
+  correction.robot_id_ = 2u;
+  correction.kf_id_ = 12u;
+  correction.timestamp_ = 120;
+  correction.is_loop_closure_ = true;
+  correction.id_match_ = 3u;
+  correction.id_recent_ = 12u;
+  correction.timestamp_match_ = 30;
+  correction.timestamp_query_ = 120;
+  correction.relative_pose_ = gtsam::Pose3(gtsam::Rot3::Ypr(0.1, 0.2, 0.3),
+                                           gtsam::Point3(1.0, 2.0, 3.0));
+  correction.W_Pose_Map_ = gtsam::Pose3(gtsam::Rot3::Ypr(0.0, 0.0, 0.1),
+                                        gtsam::Point3(0.0, 1.0, 0.0));
+  correction.Map_Pose_Odom_ = gtsam::Pose3(gtsam::Rot3::Ypr(0.2, 0.0, 0.0),
+                                           gtsam::Point3(0.5, 0.0, 0.0));
+  correction.is_trajectory_corrected_ = true;
+  for (FrameId id = 3u; id <= 12u; id += 3u) {
+    correction.states_[id] = gtsam::Pose3(gtsam::Rot3::Ypr(0.01 * id, 0, 0),
+                                          gtsam::Point3(id, 0.0, 0.0));
+    correction.timestamp_map_[id] = id * 10;
+  }
+  correction.Shared_Pose_Map_ = gtsam::Pose3(
+      gtsam::Rot3::Ypr(-0.3, 0.0, 0.0), gtsam::Point3(0.0, 0.0, 4.0));
+  return correction;
+}
+
+}  // namespace
+
+TEST(testRemoteLcdCodec, KeyframeRoundTrip) {
+  RemoteKeyframe keyframe;
+  keyframe.robot_id_ = 1u;
+  keyframe.kf_id_ = 5u;
+  keyframe.timestamp_ = 50;
+  keyframe.W_Pose_Blkf_ = gtsam::Pose3(gtsam::Rot3::Ypr(0.1, 0.0, 0.0),
+                                       gtsam::Point3(1.0, 0.0, 0.0));
+  keyframe.frame_ = makeFrame(5u);
+  keyframe.bow_vec_ = {{3u, 0.25}, {42u, 0.75}};
+
+  std::string packet;
+  RemoteLcdCodec::encodeKeyframe(keyframe, &packet);
+  EXPECT_TRUE(RemoteLcdCodec::isHeaderValid(packet.data(), packet.size()));
+  EXPECT_EQ(RemoteLcdCodec::getPacketSize(packet.data(), packet.size()),
+            packet.size());
+
+  RemoteKeyframe decoded;
+  ASSERT_TRUE(RemoteLcdCodec::decodeKeyframe(
+      packet.data(), packet.size(), &decoded));
+  EXPECT_EQ(decoded.robot_id_, keyframe.robot_id_);
+  EXPECT_EQ(decoded.kf_id_, keyframe.kf_id_);
+  EXPECT_EQ(decoded.timestamp_, keyframe.timestamp_);
+  EXPECT_TRUE(decoded.W_Pose_Blkf_.equals(keyframe.W_Pose_Blkf_));
+  EXPECT_EQ(decoded.bow_vec_, keyframe.bow_vec_);
+  ASSERT_TRUE(decoded.frame_);
+  EXPECT_EQ(decoded.frame_->timestamp_, keyframe.frame_->timestamp_);
+  EXPECT_EQ(decoded.frame_->keypoints_.size(),
+            keyframe.frame_->keypoints_.size());
+  EXPECT_EQ(cv::norm(decoded.frame_->descriptors_mat_,
+                     keyframe.frame_->descriptors_mat_,
+                     cv::NORM_HAMMING),
+            0.0);
+  const StereoLCDFrame::Ptr stereo_frame =
+      std::dynamic_pointer_cast<StereoLCDFrame>(decoded.frame_);
+  ASSERT_TRUE(stereo_frame);
+  EXPECT_EQ(stereo_frame->left_keypoints_rectified_.size(), 10u);
+
+  // A keyframe is not a correction.
+  RemoteLcdCorrection correction;
+  EXPECT_FALSE(RemoteLcdCodec::decodeCorrection(
+      packet.data(), packet.size(), &correction));
+}
+
+TEST(testRemoteLcdCodec, CorrectionRoundTrip) {
+  const RemoteLcdCorrection correction = makeCorrection();
+  std::string packet;
+  RemoteLcdCodec::encodeCorrection(correction, &packet);
+
+  RemoteLcdCorrection decoded;
+  ASSERT_TRUE(RemoteLcdCodec::decodeCorrection(
+      packet.data(), packet.size(), &decoded));
+  EXPECT_EQ(decoded.robot_id_, correction.robot_id_);
+  EXPECT_EQ(decoded.kf_id_, correction.kf_id_);
+  EXPECT_EQ(decoded.timestamp_, correction.timestamp_);
+  EXPECT_TRUE(decoded.is_loop_closure_);
+  EXPECT_EQ(decoded.id_match_, correction.id_match_);
+  EXPECT_EQ(decoded.id_recent_, correction.id_recent_);
+  EXPECT_EQ(decoded.timestamp_match_, correction.timestamp_match_);
+  EXPECT_EQ(decoded.timestamp_query_, correction.timestamp_query_);
+  EXPECT_TRUE(decoded.relative_pose_.equals(correction.relative_pose_));
+  EXPECT_TRUE(decoded.W_Pose_Map_.equals(correction.W_Pose_Map_));
+  EXPECT_TRUE(decoded.Map_Pose_Odom_.equals(correction.Map_Pose_Odom_));
+  EXPECT_TRUE(decoded.is_trajectory_corrected_);
+  ASSERT_EQ(decoded.states_.size(), correction.states_.size());
+  for (const auto& state : correction.states_) {
+    ASSERT_EQ(decoded.states_.count(state.first), 1u);
+    EXPECT_TRUE(decoded.states_.at(state.first).equals(state.second));
+    EXPECT_EQ(decoded.timestamp_map_.at(state.first),
+              correction.timestamp_map_.at(state.first));
+  }
+  ASSERT_TRUE(decoded.Shared_Pose_Map_);
+  EXPECT_TRUE(decoded.Shared_Pose_Map_->equals(*correction.Shared_Pose_Map_));
+
+  // Without a shared frame yet.
+  RemoteLcdCorrection unaligned = correction;
+  unaligned.Shared_Pose_Map_.reset();
+  packet.clear();
+  RemoteLcdCodec::encodeCorrection(unaligned, &packet);
+  ASSERT_TRUE(RemoteLcdCodec::decodeCorrection(
+      packet.data(), packet.size(), &decoded));
+  EXPECT_FALSE(decoded.Shared_Pose_Map_);
+}
+
+TEST(testRemoteLcdCodec, StreamFraming) {
+  std::string stream;
+  RemoteLcdCorrection correction = makeCorrection();
+  RemoteLcdCodec::encodeCorrection(correction, &stream);
+  const size_t first_size = stream.size();
+  correction.kf_id_ = 13u;
+  RemoteLcdCodec::encodeCorrection(correction, &stream);
+
+  // Incomplete header and incomplete payload.
+  EXPECT_EQ(RemoteLcdCodec::getPacketSize(stream.data(), 3u), 0u);
+  EXPECT_TRUE(RemoteLcdCodec::isHeaderValid(stream.data(), 3u));
+  EXPECT_EQ(RemoteLcdCodec::getPacketSize(stream.data(), first_size - 1u),
+            0u);
+  EXPECT_EQ(RemoteLcdCodec::getPacketSize(stream.data(), stream.size()),
+            first_size);
+
+  RemoteLcdCorrection decoded;
+  const char* second = stream.data() + first_size;
+  const size_t second_size = stream.size() - first_size;
+  EXPECT_EQ(RemoteLcdCodec::getPacketSize(second, second_size), second_size);
+  ASSERT_TRUE(RemoteLcdCodec::decodeCorrection(second, second_size, &decoded));
+  EXPECT_EQ(decoded.kf_id_, 13u);
+}
+
+TEST(testRemoteLcdCodec, RejectMalformedPackets) {
+  std::string packet;
+  RemoteLcdCodec::encodeCorrection(makeCorrection(), &packet);
+  RemoteLcdCorrection decoded;
+
+  // Truncated.
+  EXPECT_FALSE(RemoteLcdCodec::decodeCorrection(
+      packet.data(), packet.size() - 1u, &decoded));
+  EXPECT_FALSE(RemoteLcdCodec::decodeCorrection(
+      packet.data(), kRemoteLcdHeaderSize - 1u, &decoded));
+
+  // Another magic.
+  std::string bad_magic = packet;
+  bad_magic[0] = static_cast<char>(bad_magic[0] ^ 0xff);
+  EXPECT_FALSE(
+      RemoteLcdCodec::isHeaderValid(bad_magic.data(), bad_magic.size()));
+  EXPECT_FALSE(RemoteLcdCodec::decodeCorrection(
+      bad_magic.data(), bad_magic.size(), &decoded));
+
+  // Another version.
+  std::string bad_version = packet;
+  bad_version[2] = static_cast<char>(kRemoteLcdVersion + 1u);
+  EXPECT_FALSE(
+      RemoteLcdCodec::isHeaderValid(bad_version.data(), bad_version.size()));
+
+  // A payload too large.
+  std::string too_large = packet;
+  too_large[7] = static_cast<char>(0x7f);
+  EXPECT_FALSE(
+      RemoteLcdCodec::isHeaderValid(too_large.data(), too_large.size()));
+
+  // Not a keyframe.
+  RemoteKeyframe keyframe;
+  EXPECT_FALSE(
+      RemoteLcdCodec::decodeKeyframe(packet.data(), packet.size(), &keyframe));
+}
+
+TEST(testRemoteLcdCodec, RejectMalformedFrames) {
+  // Offsets in the bytes of the frame of makeFrame: its marker line, its
+  // timestamp and ids, its 10 keypoints and 3D keypoints, and the type,
+  // dimensions and sizes of its descriptors.
+  const size_t keypoints_offset = std::string("stereo\n").size() +
+                                  sizeof(Timestamp) + 2u * sizeof(FrameId);
+  const size_t keypoint_bytes = 5u * sizeof(float) + 2u * sizeof(int);
+  const size_t keypoints_3d_offset =
+      keypoints_offset + sizeof(size_t) + 10u * keypoint_bytes;
+  const size_t mat_offset =
+      keypoints_3d_offset + sizeof(size_t) + 10u * 3u * sizeof(double);
+  const size_t mat_bytes_offset = mat_offset + 4u * sizeof(int);
+
+  std::string frame_bytes;
+  ASSERT_TRUE(decodeEditedKeyframe(
+      [&frame_bytes](std::string* bytes) { frame_bytes = *bytes; }));
+  ASSERT_GT(frame_bytes.size(), mat_bytes_offset);
+  EXPECT_EQ(10u,
+            *reinterpret_cast<const size_t*>(&frame_bytes[keypoints_offset]));
+  EXPECT_EQ(10u * DBoW2::FORB::L,
+            *reinterpret_cast<const size_t*>(&frame_bytes[mat_bytes_offset]));
+
+  // Truncated frames, in packets of consistent sizes.
+  for (size_t size = 0u; size < frame_bytes.size(); ++size) {
+    EXPECT_FALSE(decodeEditedKeyframe(
+        [&size](std::string* bytes) { bytes->resize(size); }))
+        << "Decoded a frame truncated to " << size << " bytes.";
+  }
+
+  // Counts of more items than the bytes left, or of overflowing sizes.
+  for (const size_t count :
+       {size_t(11u), size_t(1u) << 40, std::numeric_limits<size_t>::max()}) {
+    EXPECT_FALSE(decodeEditedKeyframe([&](std::string* bytes) {
+      setCount(keypoints_offset, count, bytes);
+    }));
+    EXPECT_FALSE(decodeEditedKeyframe([&](std::string* bytes) {
+      setCount(keypoints_3d_offset, count, bytes);
+    }));
+    EXPECT_FALSE(decodeEditedKeyframe([&](std::string* bytes) {
+      setCount(mat_bytes_offset, count, bytes);
+    }));
+  }
+  EXPECT_FALSE(decodeEditedKeyframe([&](std::string* bytes) {
+    const int rows = std::numeric_limits<int>::max();
+    std::memcpy(&(*bytes)[mat_offset + 2u * sizeof(int)], &rows, sizeof(rows));
+  }));
+
+  // Fewer items than keypoints: consistent bytes, but not a valid frame.
+  EXPECT_FALSE(decodeEditedKeyframe([&](std::string* bytes) {
+    setCount(keypoints_3d_offset, 9u, bytes);
+    bytes->erase(keypoints_3d_offset + sizeof(size_t), 3u * sizeof(double));
+  }));
+
+  // Bytes after the frame.
+  EXPECT_FALSE(decodeEditedKeyframe(
+      [](std::string* bytes) { bytes->push_back('\0'); }));
+
+  // Not a frame.
+  EXPECT_FALSE(decodeEditedKeyframe(
+      [](std::string* bytes) { *bytes = "unknown\n"; }));
+}
+
+}  // namespace VIO
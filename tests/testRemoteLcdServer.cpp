@@ -0,0 +1,210 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testRemoteLcdServer.cpp
+ * @brief  test RemoteLcdServer with its clients on the loopback interface:
+ * RemoteLcdClient and RemoteLoopClosureDetector
+ * @author Antoni Rosinol
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <gtsam/inference/Symbol.h>
+
+#include "kimera-vio/frontend/StereoVisionImuFrontend-definitions.h"
+#include "kimera-vio/loopclosure/MultiRobotLcd.h"
+#include "kimera-vio/loopclosure/RemoteLcdClient.h"
+#include "kimera-vio/loopclosure/RemoteLcdCodec.h"
+#include "kimera-vio/loopclosure/RemoteLcdServer.h"
+#include "kimera-vio/loopclosure/RemoteLoopClosureDetector.h"
+#include "kimera-vio/test/StereoLcdTestData.h"
+
+DECLARE_string(test_data_path);
+
+namespace VIO {
+
+using test::StereoLcdTestData;
+
+namespace {
+
+constexpr char kLoopback[] = "127.0.0.1";
+//! Spins of the server, of 10 ms at most, before giving up on the network.
+constexpr int kMaxSpins = 200;
+
+RemoteLcdServer::UniquePtr makeServer(const StereoLcdTestData& data) {
+  // On any free port.
+  return std::make_unique<RemoteLcdServer>(
+      std::make_unique<MultiRobotLcd>([&data](const RobotId&) {
+        return data.makeLcd(data.getLcdParams());
+      }),
+      0);
+}
+
+//! Spins the server until the PGO of the robot holds nr_keyframes.
+bool spinUntilProcessed(RemoteLcdServer* server,
+                        const RobotId& robot_id,
+                        const size_t& nr_keyframes) {
+  CHECK_NOTNULL(server);
+  for (int i = 0; i < kMaxSpins; ++i) {
+    server->spinOnce(10);
+    const LoopClosureDetector* lcd =
+        server->getMultiRobotLcd().getLcd(robot_id);
+    if (lcd && lcd->getPGOTrajectory().size() == nr_keyframes) return true;
+  }
+  return false;
+}
+
+//! The keyframe of the image, as the Frontend outputs it to the LCD.
+LcdOutput::UniquePtr spinOnce(const StereoLcdTestData& data,
+                              const FrameId& kf_id,
+                              const size_t& image,
+                              const gtsam::Pose3& W_Pose_Blkf,
+                              LoopClosureDetector* lcd) {
+  CHECK_NOTNULL(lcd);
+  const Timestamp timestamp = 1000 * static_cast<Timestamp>(kf_id + 1u);
+  const StereoFrame::UniquePtr stereo_frame =
+      data.makeStereoFrame(image, kf_id, timestamp);
+  const StereoCamera::ConstPtr& stereo_camera = data.getStereoCamera();
+  StereoFrontendOutput::Ptr frontend_output =
+      std::make_shared<StereoFrontendOutput>(
+          true,
+          StatusStereoMeasurementsPtr(),
+          stereo_camera->getBodyPoseLeftCamRect(),
+          stereo_camera->getBodyPoseRightCamRect(),
+          *stereo_frame,
+          ImuFrontend::PimPtr(),
+          ImuAccGyrS(),
+          cv::Mat(),
+          DebugTrackerInfo());
+  return lcd->spinOnce(LcdInput(
+      timestamp, frontend_output, kf_id, PointsWithIdMap(), W_Pose_Blkf));
+}
+
+}  // namespace
+
+TEST(RemoteLcdServer, keyframeAndCorrectionRoundTrip) {
+  StereoLcdTestData data(FLAGS_test_data_path);
+  RemoteLcdServer::UniquePtr server = makeServer(data);
+  ASSERT_GT(server->getPort(), 0);
+  RemoteLcdClient client(kLoopback, server->getPort(), 1024u * 1024u);
+
+  const gtsam::Pose3 W_Pose_B =
+      StereoLcdTestData::getWorldPoseBody(StereoLcdTestData::kMatch1);
+  std::string packet;
+  RemoteLcdCodec::encodeKeyframe(
+      data.makeKeyframe(3u, 7u, 1000, StereoLcdTestData::kMatch1, W_Pose_B),
+      &packet);
+  EXPECT_TRUE(client.send(std::move(packet)));
+
+  std::vector<std::string> packets;
+  for (int i = 0; i < kMaxSpins && packets.empty(); ++i) {
+    server->spinOnce(10);
+    client.receive(&packets);
+  }
+  ASSERT_EQ(1u, packets.size());
+  EXPECT_TRUE(client.isConnected());
+  EXPECT_EQ(0u, client.getPendingBytes());
+  EXPECT_EQ(0u, client.getNrDroppedPackets());
+  EXPECT_EQ(1u, server->getNrConnections());
+  EXPECT_EQ(1u, server->getMultiRobotLcd().getNrRobots());
+
+  RemoteLcdCorrection correction;
+  ASSERT_TRUE(RemoteLcdCodec::decodeCorrection(
+      packets.front().data(), packets.front().size(), &correction));
+  EXPECT_EQ(3u, correction.robot_id_);
+  EXPECT_EQ(7u, correction.kf_id_);
+  EXPECT_EQ(1000, correction.timestamp_);
+  EXPECT_FALSE(correction.is_loop_closure_);
+  ASSERT_EQ(1u, correction.states_.size());
+  ASSERT_EQ(1u, correction.states_.count(7u));
+  EXPECT_TRUE(gtsam::assert_equal(W_Pose_B, correction.states_.at(7u), 1e-6));
+  EXPECT_EQ(1000, correction.timestamp_map_.at(7u));
+  // The only robot defines the shared frame.
+  ASSERT_TRUE(correction.Shared_Pose_Map_);
+  EXPECT_TRUE(
+      gtsam::assert_equal(gtsam::Pose3(), *correction.Shared_Pose_Map_));
+}
+
+TEST(RemoteLoopClosureDetector, predictsUncorrectedKeyframes) {
+  StereoLcdTestData data(FLAGS_test_data_path);
+  RemoteLcdServer::UniquePtr server = makeServer(data);
+  LoopClosureDetectorParams lcd_params = data.getLcdParams();
+  lcd_params.remote_server_host_ = kLoopback;
+  lcd_params.remote_server_port_ = server->getPort();
+  lcd_params.robot_id_ = 2;
+  const std::unique_ptr<RemoteLoopClosureDetector> remote_lcd =
+      data.makeLcd<RemoteLoopClosureDetector>(lcd_params);
+
+  // Sent while the server does not spin: predicted from the odometry.
+  std::vector<gtsam::Pose3> W_Pose_Bkfs;
+  for (const size_t& image : {StereoLcdTestData::kMatch1,
+                              StereoLcdTestData::kMatch2,
+                              StereoLcdTestData::kQuery1,
+                              StereoLcdTestData::kQuery2}) {
+    W_Pose_Bkfs.push_back(StereoLcdTestData::getWorldPoseBody(image));
+  }
+  LcdOutput::UniquePtr output = spinOnce(
+      data, 0u, StereoLcdTestData::kMatch1, W_Pose_Bkfs[0], remote_lcd.get());
+  ASSERT_TRUE(output);
+  EXPECT_FALSE(output->is_loop_closure_);
+  EXPECT_FALSE(output->Shared_Pose_Map_);
+  ASSERT_EQ(1u, output->states_.size());
+  EXPECT_TRUE(gtsam::assert_equal(
+      W_Pose_Bkfs[0], output->states_.at<gtsam::Pose3>(gtsam::Symbol(0u))));
+
+  // Only the new keyframe is predicted: Map_Pose_Odom did not change.
+  output = spinOnce(
+      data, 1u, StereoLcdTestData::kMatch2, W_Pose_Bkfs[1], remote_lcd.get());
+  ASSERT_TRUE(output);
+  ASSERT_EQ(1u, output->states_.size());
+  EXPECT_TRUE(gtsam::assert_equal(
+      W_Pose_Bkfs[1], output->states_.at<gtsam::Pose3>(gtsam::Symbol(1u))));
+
+  // The corrections of the keyframes processed by the server come with the
+  // next keyframe, which closes a loop with the first one.
+  ASSERT_TRUE(spinUntilProcessed(server.get(), 2u, 2u));
+  output = spinOnce(
+      data, 2u, StereoLcdTestData::kQuery1, W_Pose_Bkfs[2], remote_lcd.get());
+  ASSERT_TRUE(output);
+  ASSERT_EQ(3u, output->states_.size());
+  for (FrameId kf_id = 0u; kf_id < 3u; ++kf_id) {
+    EXPECT_TRUE(gtsam::assert_equal(
+        W_Pose_Bkfs[kf_id],
+        output->states_.at<gtsam::Pose3>(gtsam::Symbol(kf_id)),
+        1e-6));
+    EXPECT_EQ(1000 * static_cast<Timestamp>(kf_id + 1u),
+              output->timestamp_map_.at(kf_id));
+  }
+  // The robot is the only one of the server.
+  ASSERT_TRUE(output->Shared_Pose_Map_);
+  EXPECT_TRUE(gtsam::assert_equal(gtsam::Pose3(), *output->Shared_Pose_Map_));
+  ASSERT_TRUE(remote_lcd->getSharedPoseMap());
+
+  // The loop closure corrects Map_Pose_Odom, which predicts the keyframes
+  // the server did not correct yet.
+  ASSERT_TRUE(spinUntilProcessed(server.get(), 2u, 3u));
+  output = spinOnce(
+      data, 3u, StereoLcdTestData::kQuery2, W_Pose_Bkfs[3], remote_lcd.get());
+  ASSERT_TRUE(output);
+  ASSERT_TRUE(output->is_loop_closure_);
+  EXPECT_EQ(0u, output->id_match_);
+  EXPECT_EQ(2u, output->id_recent_);
+  ASSERT_TRUE(output->states_.exists(gtsam::Symbol(3u)));
+  EXPECT_TRUE(gtsam::assert_equal(
+      output->Map_Pose_Odom_ * W_Pose_Bkfs[3],
+      output->states_.at<gtsam::Pose3>(gtsam::Symbol(3u))));
+  EXPECT_EQ(0u, remote_lcd->getNrDroppedKeyframes());
+}
+
+}  // namespace VIO
@@ -0,0 +1,84 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testReplayScheduler.cpp
+ * @brief  test ReplayScheduler
+ * @author Antoni Rosinol
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/pipeline/ReplayScheduler.h"
+
+namespace VIO {
+
+TEST(testReplayScheduler, CreditsBoundFramesInFlight) {
+  ReplayScheduler scheduler(2u);
+  EXPECT_TRUE(scheduler.acquireFrameCredit(1));
+  EXPECT_TRUE(scheduler.acquireFrameCredit(2));
+
+  std::atomic_bool acquired(false);
+  std::thread provider([&]() {
+    EXPECT_TRUE(scheduler.acquireFrameCredit(3));
+    acquired = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(acquired);
+
+  // Forwarding frame 2 also returns the credit of (dropped) frame 1.
+  scheduler.releaseFrameCredits(2);
+  provider.join();
+  EXPECT_TRUE(acquired);
+  EXPECT_TRUE(scheduler.acquireFrameCredit(4));
+}
+
+TEST(testReplayScheduler, BarrierWaitsForFrameDone) {
+  ReplayScheduler scheduler(2u);
+  EXPECT_TRUE(scheduler.waitForIdlePipeline());
+
+  std::atomic_bool entered(false);
+  std::thread data_provider([&]() {
+    EXPECT_TRUE(scheduler.waitForIdlePipeline());
+    entered = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(entered);
+
+  scheduler.signalFrameDone();
+  data_provider.join();
+  EXPECT_TRUE(entered);
+  scheduler.signalFrameDone();
+  // Spurious signals are ignored.
+  scheduler.signalFrameDone();
+  EXPECT_EQ(scheduler.getNrFramesDone(), 2u);
+  EXPECT_GE(scheduler.getThroughput(), 0.0);
+}
+
+TEST(testReplayScheduler, ShutdownUnblocks) {
+  ReplayScheduler scheduler(2u);
+  EXPECT_TRUE(scheduler.acquireFrameCredit(1));
+  EXPECT_TRUE(scheduler.acquireFrameCredit(2));
+  EXPECT_TRUE(scheduler.waitForIdlePipeline());
+  std::thread provider(
+      [&]() { EXPECT_FALSE(scheduler.acquireFrameCredit(3)); });
+  std::thread data_provider(
+      [&]() { EXPECT_FALSE(scheduler.waitForIdlePipeline()); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  scheduler.shutdown();
+  provider.join();
+  data_provider.join();
+}
+
+}  // namespace VIO
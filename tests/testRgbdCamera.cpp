@@ -30,6 +30,7 @@
 #include "kimera-vio/visualizer/Display.h"
 #include "kimera-vio/visualizer/DisplayFactory.h"
 #include "kimera-vio/visualizer/DisplayModule.h"
+#include "kimera-vio/visualizer/OpenCvDisplay.h"
 #include "kimera-vio/visualizer/OpenCvDisplayParams.h"
 #include "kimera-vio/visualizer/OpenCvVisualizer3D.h"
 #include "kimera-vio/visualizer/Visualizer3D.h"
@@ -185,4 +186,60 @@ TEST_F(RgbdCameraFixture, convertToPoincloud) {
   }
 }
 
+TEST_F(RgbdCameraFixture, convertToPointcloudWithStride) {
+  ASSERT_TRUE(rgbd_camera_);
+  CameraParams cam_params = vio_params_.camera_params_.at(0);
+  const auto& width = cam_params.image_size_.width;
+  const auto& height = cam_params.image_size_.height;
+
+  // Depth ramp with invalid (zero) measurements.
+  cv::Mat_<uint16_t> depth_map = cv::Mat(height, width, CV_16UC1);
+  cv::Mat intensity_img = cv::Mat(height, width, CV_8UC1);
+  for (int v = 0; v < height; v++) {
+    for (int u = 0; u < width; u++) {
+      depth_map(v, u) = (u + v) % 7 == 0 ? 0u : 500u + u + v;
+      intensity_img.at<uint8_t>(v, u) = static_cast<uint8_t>(u + 3 * v);
+    }
+  }
+  Frame frame(0u, 0u, cam_params, intensity_img);
+  DepthFrame depth_frame(0u, 0u, depth_map);
+  RgbdFrame rgbd_frame(0u, 0u, frame, depth_frame);
+
+  cv::Mat cloud, colors;
+  rgbd_camera_->convertRgbdToPointcloud(rgbd_frame, &cloud, &colors);
+  ASSERT_EQ(cloud.rows, height);
+  ASSERT_EQ(cloud.cols, width);
+
+  static constexpr int kStride = 3;
+  cv::Mat decimated_cloud, decimated_colors;
+  rgbd_camera_->convertRgbdToPointcloud(
+      rgbd_frame, &decimated_cloud, &decimated_colors, kStride);
+  ASSERT_EQ(decimated_cloud.rows, (height + kStride - 1) / kStride);
+  ASSERT_EQ(decimated_cloud.cols, (width + kStride - 1) / kStride);
+  for (int v = 0; v < decimated_cloud.rows; v++) {
+    for (int u = 0; u < decimated_cloud.cols; u++) {
+      const int row = v * kStride;
+      const int col = u * kStride;
+      const cv::Point3f& point = cloud.at<cv::Point3f>(row, col);
+      const cv::Point3f& decimated_point =
+          decimated_cloud.at<cv::Point3f>(v, u);
+      if (depth_map(row, col) == 0u) {
+        EXPECT_TRUE(std::isnan(decimated_point.z));
+      } else {
+        EXPECT_NEAR(decimated_point.x, point.x, 1e-6);
+        EXPECT_NEAR(decimated_point.y, point.y, 1e-6);
+        EXPECT_NEAR(decimated_point.z, point.z, 1e-6);
+      }
+      EXPECT_EQ(decimated_colors.at<cv::Vec3b>(v, u),
+                colors.at<cv::Vec3b>(row, col));
+    }
+  }
+
+  // The buffers of the previous conversion are reused.
+  const uchar* cloud_data = decimated_cloud.data;
+  rgbd_camera_->convertRgbdToPointcloud(
+      rgbd_frame, &decimated_cloud, &decimated_colors, kStride);
+  EXPECT_EQ(decimated_cloud.data, cloud_data);
+}
+
 }  // namespace VIO
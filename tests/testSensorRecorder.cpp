@@ -0,0 +1,123 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testSensorRecorder.cpp
+ * @brief  test SensorRecorder
+ * @author Antoni Rosinol
+ */
+
+#include <cstdio>
+#include <string>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <opencv2/core/core.hpp>
+
+#include "kimera-vio/dataprovider/BinaryDataset.h"
+#include "kimera-vio/dataprovider/SensorRecorder.h"
+#include "kimera-vio/frontend/CameraParams.h"
+#include "kimera-vio/frontend/Frame.h"
+
+DECLARE_string(test_data_path);
+
+namespace VIO {
+
+class SensorRecorderFixture : public ::testing::Test {
+ public:
+  SensorRecorderFixture()
+      : filename_(FLAGS_test_data_path + "/test_sensor_recording.kimera") {}
+
+ protected:
+  void TearDown() override { std::remove(filename_.c_str()); }
+
+  Frame makeFrame(const FrameId& id, const uchar& intensity) const {
+    return Frame(id,
+                 1000 * static_cast<Timestamp>(id + 1u),
+                 cam_params_,
+                 cv::Mat(kRows, kCols, CV_8UC1, cv::Scalar(intensity)));
+  }
+
+ protected:
+  static constexpr int kRows = 30;
+  static constexpr int kCols = 37;
+  const std::string filename_;
+  const CameraParams cam_params_;
+};
+
+TEST_F(SensorRecorderFixture, RecordsStereoData) {
+  SensorRecorder recorder(filename_, 2u);
+  for (size_t i = 0u; i < 10u; ++i) {
+    ImuAccGyr acc_gyr;
+    acc_gyr << 1.0, 2.0, 3.0, 4.0, 5.0, static_cast<double>(i);
+    recorder.recordImu(ImuMeasurement(100 * i, acc_gyr));
+  }
+  // Repeated timestamp: dropped.
+  recorder.recordImu(ImuMeasurement(900, ImuAccGyr::Zero()));
+  const gtsam::NavState odom_state(
+      gtsam::Rot3::Ypr(0.1, 0.2, 0.3),
+      gtsam::Point3(1.0, 2.0, 3.0),
+      gtsam::Vector3(0.5, 0.6, 0.7));
+  recorder.recordExternalOdom(ExternalOdomMeasurement(50, odom_state));
+
+  // Frame 0 complete, frame 1 misses its right image (dropped once frame 2
+  // completes), and frame 2 images come in reverse order.
+  recorder.recordFrame(0u, makeFrame(0u, 10u));
+  recorder.recordFrame(1u, makeFrame(0u, 110u));
+  recorder.recordFrame(0u, makeFrame(1u, 11u));
+  recorder.recordFrame(1u, makeFrame(2u, 112u));
+  recorder.recordFrame(0u, makeFrame(2u, 12u));
+  recorder.close();
+
+  EXPECT_EQ(recorder.getNrRecordedFrames(), 2u);
+  EXPECT_EQ(recorder.getNrDroppedImages(), 1u);
+  EXPECT_EQ(recorder.getNrDroppedMeasurements(), 1u);
+
+  BinaryDatasetReader reader(filename_);
+  EXPECT_EQ(reader.getNrCameras(), 2u);
+  EXPECT_EQ(reader.getNrImuMeasurements(), 10u);
+  EXPECT_EQ(reader.getImuMeasurement(9u).acc_gyr_(5), 9.0);
+  ASSERT_EQ(reader.getNrExternalOdomMeasurements(), 1u);
+  const ExternalOdomMeasurement odom = reader.getExternalOdomMeasurement(0u);
+  EXPECT_EQ(odom.timestamp_, 50);
+  EXPECT_TRUE(odom.odom_data_.pose().equals(odom_state.pose(), 1e-9));
+  EXPECT_TRUE(gtsam::assert_equal(
+      odom.odom_data_.velocity(), odom_state.velocity(), 1e-9));
+
+  ASSERT_EQ(reader.getNrFrames(), 2u);
+  EXPECT_EQ(reader.getFrameRecord(0u).frame_id, 0u);
+  EXPECT_EQ(reader.getFrameRecord(1u).frame_id, 2u);
+  EXPECT_EQ(reader.getFrameRecord(1u).timestamp, 3000);
+  EXPECT_EQ(cv::countNonZero(reader.getImage(1u, 0u) != cv::Scalar(12)), 0);
+  EXPECT_EQ(cv::countNonZero(reader.getImage(1u, 1u) != cv::Scalar(112)), 0);
+}
+
+TEST_F(SensorRecorderFixture, DropsInsteadOfBlocking) {
+  static constexpr size_t kNrFrames = 200u;
+  SensorRecorder recorder(filename_, 1u, 1u);
+  for (size_t k = 0u; k < kNrFrames; ++k) {
+    recorder.recordFrame(0u, makeFrame(k, static_cast<uchar>(k)));
+  }
+  recorder.close();
+  // Whatever the speed of the disk, every frame is either written or
+  // reported as dropped.
+  EXPECT_GT(recorder.getNrRecordedFrames(), 0u);
+  EXPECT_EQ(recorder.getNrRecordedFrames() + recorder.getNrDroppedImages(),
+            kNrFrames);
+
+  BinaryDatasetReader reader(filename_);
+  EXPECT_EQ(reader.getNrFrames(), recorder.getNrRecordedFrames());
+  // Data recorded after closing is ignored.
+  recorder.recordFrame(0u, makeFrame(kNrFrames, 0u));
+  EXPECT_EQ(recorder.getNrDroppedImages() + recorder.getNrRecordedFrames(),
+            kNrFrames);
+}
+
+}  // namespace VIO
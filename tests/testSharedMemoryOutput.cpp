@@ -0,0 +1,231 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testSharedMemoryOutput.cpp
+ * @brief  test SharedMemoryOutput and the SharedMemoryReader C API
+ * @author Antoni Rosinol
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/pipeline/SharedMemoryOutput-definitions.h"
+#include "kimera-vio/pipeline/SharedMemoryOutput.h"
+#include "kimera-vio/pipeline/SharedMemoryReader.h"
+
+namespace VIO {
+
+namespace {
+std::string testRegionName() {
+  return "/kimera_vio_test_" + std::to_string(::getpid());
+}
+
+kimera_shm_pose makePose(const int64_t& timestamp) {
+  kimera_shm_pose pose = {};
+  pose.timestamp_ns = timestamp;
+  pose.position[0] = static_cast<double>(timestamp);
+  pose.orientation[0] = 1.0;
+  return pose;
+}
+}  // namespace
+
+/* ************************************************************************* */
+TEST(testSharedMemoryOutput, navState) {
+  const std::string name = testRegionName();
+  EXPECT_EQ(kimera_shm_open(name.c_str()), nullptr);
+  SharedMemoryOutput output(name, 10u, 10u, 10u);
+  kimera_shm_reader* reader = kimera_shm_open(name.c_str());
+  ASSERT_NE(reader, nullptr);
+
+  kimera_shm_nav_state nav_state = {};
+  EXPECT_EQ(kimera_shm_read_nav_state(reader, &nav_state), KIMERA_SHM_NO_DATA);
+  EXPECT_EQ(kimera_shm_get_version(reader, KIMERA_SHM_NAV_STATE), 0u);
+
+  kimera_shm_nav_state published = {};
+  published.timestamp_ns = 123;
+  published.keyframe_id = 4u;
+  published.position[2] = 1.5;
+  published.orientation[0] = 1.0;
+  published.covariance_dim = 15u;
+  published.covariance[15 * 15 - 1] = 0.25;
+  output.publishNavState(published);
+  EXPECT_EQ(kimera_shm_get_version(reader, KIMERA_SHM_NAV_STATE), 1u);
+  ASSERT_EQ(kimera_shm_read_nav_state(reader, &nav_state), KIMERA_SHM_OK);
+  EXPECT_EQ(nav_state.timestamp_ns, 123);
+  EXPECT_EQ(nav_state.keyframe_id, 4u);
+  EXPECT_EQ(nav_state.position[2], 1.5);
+  EXPECT_EQ(nav_state.covariance_dim, 15u);
+  EXPECT_EQ(nav_state.covariance[15 * 15 - 1], 0.25);
+  kimera_shm_close(reader);
+}
+
+/* ************************************************************************* */
+TEST(testSharedMemoryOutput, trajectoryKeepsLatestPoses) {
+  const std::string name = testRegionName();
+  SharedMemoryOutput output(name, 3u, 1u, 1u);
+  kimera_shm_reader* reader = kimera_shm_open(name.c_str());
+  ASSERT_NE(reader, nullptr);
+
+  for (int64_t i = 0; i < 5; ++i) output.appendTrajectoryPose(makePose(i));
+  std::vector<kimera_shm_pose> poses(3u);
+  size_t nr_poses = 0u;
+  ASSERT_EQ(kimera_shm_read_trajectory(reader, poses.data(), 3u, &nr_poses),
+            KIMERA_SHM_OK);
+  ASSERT_EQ(nr_poses, 3u);
+  EXPECT_EQ(poses[0].timestamp_ns, 2);
+  EXPECT_EQ(poses[2].timestamp_ns, 4);
+  EXPECT_EQ(poses[2].position[0], 4.0);
+
+  // Buffer too small: the size needed is returned.
+  EXPECT_EQ(kimera_shm_read_trajectory(reader, poses.data(), 1u, &nr_poses),
+            KIMERA_SHM_TOO_SMALL);
+  EXPECT_EQ(nr_poses, 3u);
+
+  output.publishTrajectory({makePose(10), makePose(11)});
+  ASSERT_EQ(kimera_shm_read_trajectory(reader, poses.data(), 3u, &nr_poses),
+            KIMERA_SHM_OK);
+  ASSERT_EQ(nr_poses, 2u);
+  EXPECT_EQ(poses[0].timestamp_ns, 10);
+  EXPECT_EQ(poses[1].timestamp_ns, 11);
+  kimera_shm_close(reader);
+}
+
+/* ************************************************************************* */
+TEST(testSharedMemoryOutput, meshTruncatedToCapacity) {
+  const std::string name = testRegionName();
+  SharedMemoryOutput output(name, 1u, 3u, 2u);
+  kimera_shm_reader* reader = kimera_shm_open(name.c_str());
+  ASSERT_NE(reader, nullptr);
+
+  // 4 vertices, 2 triangles: the one using the 4th vertex is dropped.
+  const std::vector<float> vertices = {
+      0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 1.f, 0.f, 1.f, 1.f, 0.f};
+  const std::vector<int32_t> triangles = {0, 1, 2, 1, 3, 2};
+  output.publishMesh(vertices.data(), 4u, triangles.data(), 2u);
+
+  std::vector<float> read_vertices(3u * 3u);
+  std::vector<int32_t> read_triangles(3u * 2u);
+  size_t nr_vertices = 0u;
+  size_t nr_triangles = 0u;
+  int is_truncated = 0;
+  ASSERT_EQ(kimera_shm_read_mesh(reader,
+                                 read_vertices.data(),
+                                 3u,
+                                 &nr_vertices,
+                                 read_triangles.data(),
+                                 2u,
+                                 &nr_triangles,
+                                 &is_truncated),
+            KIMERA_SHM_OK);
+  EXPECT_EQ(nr_vertices, 3u);
+  ASSERT_EQ(nr_triangles, 1u);
+  EXPECT_TRUE(is_truncated);
+  EXPECT_EQ(read_vertices[3], 1.f);
+  EXPECT_EQ(read_triangles[0], 0);
+  EXPECT_EQ(read_triangles[2], 2);
+  kimera_shm_close(reader);
+}
+
+/* ************************************************************************* */
+TEST(testSharedMemoryOutput, readsAreConsistent) {
+  const std::string name = testRegionName();
+  SharedMemoryOutput output(name, 1u, 1u, 1u);
+  kimera_shm_reader* reader = kimera_shm_open(name.c_str());
+  ASSERT_NE(reader, nullptr);
+
+  std::atomic_bool done(false);
+  std::thread writer([&output, &done]() {
+    kimera_shm_nav_state nav_state = {};
+    for (uint64_t i = 1u; i <= 20000u; ++i) {
+      // All the fields of a state have the same value.
+      nav_state.keyframe_id = i;
+      nav_state.timestamp_ns = static_cast<int64_t>(i);
+      for (double& value : nav_state.covariance) {
+        value = static_cast<double>(i);
+      }
+      output.publishNavState(nav_state);
+    }
+    done = true;
+  });
+
+  size_t nr_reads = 0u;
+  uint64_t last_keyframe_id = 0u;
+  // At least one read once the writer is done.
+  while (!done || nr_reads == 0u) {
+    kimera_shm_nav_state nav_state;
+    if (kimera_shm_read_nav_state(reader, &nav_state) != KIMERA_SHM_OK) {
+      continue;
+    }
+    ++nr_reads;
+    ASSERT_EQ(nav_state.timestamp_ns,
+              static_cast<int64_t>(nav_state.keyframe_id));
+    for (const double& value : nav_state.covariance) {
+      ASSERT_EQ(value, static_cast<double>(nav_state.keyframe_id));
+    }
+    ASSERT_GE(nav_state.keyframe_id, last_keyframe_id);
+    last_keyframe_id = nav_state.keyframe_id;
+  }
+  writer.join();
+  EXPECT_GT(nr_reads, 0u);
+  EXPECT_EQ(kimera_shm_get_version(reader, KIMERA_SHM_NAV_STATE), 20000u);
+  kimera_shm_close(reader);
+}
+
+/* ************************************************************************* */
+TEST(testSharedMemoryOutput, rejectsInconsistentLayout) {
+  const std::string name = testRegionName();
+  const SharedMemoryLayout layout(10u, 10u, 10u);
+  const int fd = ::shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(::ftruncate(fd, static_cast<off_t>(layout.size)), 0);
+  void* data =
+      ::mmap(nullptr, layout.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  ASSERT_NE(data, MAP_FAILED);
+  SharedMemoryHeader* header = static_cast<SharedMemoryHeader*>(data);
+  header->version = kSharedMemoryVersion;
+  header->size = layout.size;
+  header->trajectory_capacity = 10u;
+  header->vertices_capacity = 10u;
+  header->triangles_capacity = 10u;
+  header->nav_state_offset = layout.nav_state_offset;
+  header->trajectory_offset = layout.trajectory_offset;
+  header->mesh_offset = layout.mesh_offset;
+  header->magic.store(kSharedMemoryMagic, std::memory_order_release);
+  kimera_shm_reader* reader = kimera_shm_open(name.c_str());
+  ASSERT_NE(reader, nullptr);
+  kimera_shm_close(reader);
+
+  // A mesh past the end of the region.
+  header->vertices_capacity = 1000u;
+  EXPECT_EQ(kimera_shm_open(name.c_str()), nullptr);
+  header->vertices_capacity = 10u;
+  // A section out of the region.
+  header->mesh_offset = layout.size;
+  EXPECT_EQ(kimera_shm_open(name.c_str()), nullptr);
+  header->mesh_offset = layout.mesh_offset;
+  // Capacities that overflow the layout.
+  header->trajectory_capacity = std::numeric_limits<uint64_t>::max();
+  EXPECT_EQ(kimera_shm_open(name.c_str()), nullptr);
+
+  ::munmap(data, layout.size);
+  ::shm_unlink(name.c_str());
+}
+
+}  // namespace VIO
@@ -0,0 +1,232 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testSimdKernels.cpp
+ * @brief  test the SIMD kernels against their scalar references
+ * @author Antoni Rosinol
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/utils/SimdKernels.h"
+
+namespace VIO {
+
+namespace {
+std::vector<uint8_t> randomBytes(const size_t& size, std::mt19937* rng) {
+  std::uniform_int_distribution<int> distribution(0, 255);
+  std::vector<uint8_t> bytes(size);
+  for (uint8_t& byte : bytes) {
+    byte = static_cast<uint8_t>(distribution(*rng));
+  }
+  return bytes;
+}
+
+template <typename Function>
+bool isRunnable(const utils::KernelImplementation<Function>& implementation) {
+  return (implementation.required_features & utils::detectCpuFeatures()) ==
+         implementation.required_features;
+}
+}  // namespace
+
+/* ************************************************************************* */
+TEST(testSimdKernels, selectBestRunnable) {
+  using Function = int (*)();
+  const std::vector<utils::KernelImplementation<Function>> implementations = {
+      {"avx512", utils::kCpuAvx2 | utils::kCpuAvx512Vl, nullptr},
+      {"avx2", utils::kCpuAvx2, nullptr},
+      {"scalar", utils::kCpuScalar, nullptr}};
+  EXPECT_EQ(utils::selectKernel(implementations,
+                                utils::kCpuAvx2 | utils::kCpuAvx512Vl |
+                                    utils::kCpuPopcnt)
+                .name,
+            "avx512");
+  // Only part of the features of the first implementation.
+  EXPECT_EQ(utils::selectKernel(implementations,
+                                utils::kCpuAvx512Vl | utils::kCpuAvx2)
+                .name,
+            "avx512");
+  EXPECT_EQ(utils::selectKernel(implementations, utils::kCpuAvx2).name,
+            "avx2");
+  EXPECT_EQ(utils::selectKernel(implementations, utils::kCpuAvx512Vl).name,
+            "scalar");
+  EXPECT_EQ(utils::selectKernel(implementations, utils::kCpuScalar).name,
+            "scalar");
+}
+
+/* ************************************************************************* */
+TEST(testSimdKernels, selectedKernelsAreRunnable) {
+  const utils::SimdKernels& kernels = utils::SimdKernels::get();
+  EXPECT_EQ(kernels.cpu_features & ~utils::detectCpuFeatures(), 0u);
+  EXPECT_EQ(kernels.ssd_row,
+            utils::selectKernel(utils::SimdKernels::ssdRowImplementations(),
+                                kernels.cpu_features)
+                .function);
+  EXPECT_EQ(kernels.orb_hamming_distance,
+            utils::selectKernel(
+                utils::SimdKernels::orbHammingDistanceImplementations(),
+                kernels.cpu_features)
+                .function);
+  EXPECT_FALSE(kernels.print().empty());
+}
+
+/* ************************************************************************* */
+TEST(testSimdKernels, rowKernelsMatchScalar) {
+  std::mt19937 rng(42);
+  // Worst case for the accumulators: all 255 vs all 0.
+  std::vector<uint8_t> a(1000, 255u);
+  std::vector<uint8_t> b(1000, 0u);
+  const auto& ssd_impls = utils::SimdKernels::ssdRowImplementations();
+  const auto& dot_impls = utils::SimdKernels::dotRowImplementations();
+  for (size_t trial = 0u; trial < 3u; ++trial) {
+    for (const int& n : {0, 1, 7, 8, 15, 16, 17, 31, 33, 100, 1000}) {
+      const uint32_t ssd = ssd_impls.back().function(a.data(), b.data(), n);
+      const uint32_t dot = dot_impls.back().function(a.data(), a.data(), n);
+      for (const auto& impl : ssd_impls) {
+        if (!isRunnable(impl)) continue;
+        EXPECT_EQ(impl.function(a.data(), b.data(), n), ssd)
+            << impl.name << " n = " << n;
+      }
+      for (const auto& impl : dot_impls) {
+        if (!isRunnable(impl)) continue;
+        EXPECT_EQ(impl.function(a.data(), a.data(), n), dot)
+            << impl.name << " n = " << n;
+      }
+    }
+    a = randomBytes(a.size(), &rng);
+    b = randomBytes(b.size(), &rng);
+  }
+}
+
+/* ************************************************************************* */
+TEST(testSimdKernels, hammingDistanceMatchesScalar) {
+  std::mt19937 rng(42);
+  const auto& impls = utils::SimdKernels::orbHammingDistanceImplementations();
+  const std::vector<uint8_t> zeros(32, 0u);
+  const std::vector<uint8_t> ones(32, 255u);
+  EXPECT_EQ(impls.back().function(zeros.data(), ones.data()), 256u);
+  for (size_t trial = 0u; trial < 100u; ++trial) {
+    const std::vector<uint8_t> a = randomBytes(32u, &rng);
+    const std::vector<uint8_t> b = randomBytes(32u, &rng);
+    const uint32_t distance = impls.back().function(a.data(), b.data());
+    for (const auto& impl : impls) {
+      if (!isRunnable(impl)) continue;
+      EXPECT_EQ(impl.function(a.data(), b.data()), distance) << impl.name;
+      EXPECT_EQ(impl.function(zeros.data(), ones.data()), 256u) << impl.name;
+    }
+  }
+}
+
+/* ************************************************************************* */
+TEST(testSimdKernels, depthRowToPointsMatchesScalar) {
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> distribution(-2.0f, 5.0f);
+  const auto& impls = utils::SimdKernels::depthRowToPointsImplementations();
+  for (const int& n : {0, 1, 3, 4, 7, 8, 9, 16, 23, 100}) {
+    std::vector<float> depth(n);
+    std::vector<float> ray_x(n);
+    for (int i = 0; i < n; ++i) {
+      depth[i] = distribution(rng);
+      ray_x[i] = distribution(rng);
+    }
+    // Invalid depths.
+    for (int i = 0; i < n; i += 5) {
+      depth[i] = std::numeric_limits<float>::quiet_NaN();
+    }
+    for (int i = 3; i < n; i += 7) {
+      depth[i] = std::numeric_limits<float>::infinity();
+    }
+    std::vector<float> expected(3 * n);
+    impls.back().function(
+        depth.data(), ray_x.data(), 0.3f, n, expected.data());
+    for (int i = 0; i < n; ++i) {
+      if (std::isfinite(depth[i])) {
+        EXPECT_EQ(expected[3 * i + 2], depth[i]);
+      } else {
+        EXPECT_TRUE(std::isnan(expected[3 * i + 2]));
+      }
+    }
+    for (const auto& impl : impls) {
+      if (!isRunnable(impl)) continue;
+      std::vector<float> xyz(3 * n);
+      impl.function(depth.data(), ray_x.data(), 0.3f, n, xyz.data());
+      for (int i = 0; i < 3 * n; ++i) {
+        if (std::isnan(expected[i])) {
+          EXPECT_TRUE(std::isnan(xyz[i])) << impl.name << " i = " << i;
+        } else {
+          EXPECT_EQ(xyz[i], expected[i]) << impl.name << " i = " << i;
+        }
+      }
+    }
+  }
+}
+
+/* ************************************************************************* */
+TEST(testSimdKernels, warpPointsMatchesScalar) {
+  std::mt19937 rng(42);
+  // Some points leave the image, some are behind the camera.
+  std::uniform_real_distribution<float> distribution(-100.0f, 850.0f);
+  const auto& impls = utils::SimdKernels::warpPointsImplementations();
+  utils::PointWarp pinhole_warp;
+  const float H[9] = {
+      0.99f, 0.02f, 5.0f, -0.01f, 1.01f, -3.0f, 1e-4f, -2e-3f, 1.0f};
+  std::copy(H, H + 9, pinhole_warp.H);
+  pinhole_warp.width = 752.0f;
+  pinhole_warp.height = 480.0f;
+  utils::PointWarp distorted_warp = pinhole_warp;
+  const float R[9] = {
+      0.999f, 0.02f, 0.01f, -0.02f, 0.999f, 0.03f, -0.01f, -0.03f, 0.999f};
+  std::copy(R, R + 9, distorted_warp.H);
+  distorted_warp.k1 = -0.28f;
+  distorted_warp.k2 = 0.07f;
+  distorted_warp.fx = 458.0f;
+  distorted_warp.fy = 457.0f;
+  distorted_warp.cx = 367.0f;
+  distorted_warp.cy = 248.0f;
+  for (const utils::PointWarp& warp : {pinhole_warp, distorted_warp}) {
+    for (const int& n : {0, 1, 3, 4, 7, 8, 9, 16, 23, 100}) {
+      std::vector<float> src_xy(2 * n);
+      for (float& value : src_xy) value = distribution(rng);
+      std::vector<float> expected(2 * n);
+      impls.back().function(src_xy.data(), warp, n, expected.data());
+      for (const auto& impl : impls) {
+        if (!isRunnable(impl)) continue;
+        // In place.
+        std::vector<float> xy = src_xy;
+        impl.function(xy.data(), warp, n, xy.data());
+        for (int i = 0; i < 2 * n; ++i) {
+          EXPECT_NEAR(xy[i], expected[i], 1e-3f) << impl.name << " i = " << i;
+          EXPECT_GE(xy[i], -100.0f);
+        }
+      }
+    }
+  }
+
+  // The identity warp only undistorts and distorts again the points.
+  utils::PointWarp identity_warp = distorted_warp;
+  const utils::PointWarp default_warp;
+  std::copy(default_warp.H, default_warp.H + 9, identity_warp.H);
+  const std::vector<float> src_xy = {10.0f, 10.0f, 700.0f, 470.0f, 367.0f,
+                                     248.0f};
+  std::vector<float> xy(src_xy.size());
+  impls.back().function(src_xy.data(), identity_warp, 3, xy.data());
+  for (size_t i = 0u; i < xy.size(); ++i) {
+    EXPECT_NEAR(xy[i], src_xy[i], 1e-2f);
+  }
+}
+
+}  // namespace VIO
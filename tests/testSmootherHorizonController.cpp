@@ -0,0 +1,91 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testSmootherHorizonController.cpp
+ * @brief  test the adaptation of the smoother horizon to the latency
+ * @author Antoni Rosinol
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/backend/SmootherHorizonController.h"
+
+namespace VIO {
+
+namespace {
+
+SmootherHorizonControllerParams makeParams() {
+  SmootherHorizonControllerParams params;
+  params.target_latency_ms = 20.0;
+  params.min_nr_states = 10.0;
+  params.max_nr_states = 20.0;
+  params.nr_states_step = 2.0;
+  params.time_filter_weight = 1.0;
+  params.cooldown_keyframes = 0u;
+  return params;
+}
+
+}  // namespace
+
+TEST(testSmootherHorizonController, shrinksUnderLoad) {
+  SmootherHorizonController controller(makeParams(), 16.0, 3u);
+  EXPECT_EQ(controller.getNrStates(), 16.0);
+  EXPECT_EQ(controller.getNumOptimize(), 3u);
+
+  // Extra iterations go first.
+  EXPECT_TRUE(controller.update(40.0));
+  EXPECT_EQ(controller.getNumOptimize(), 2u);
+  EXPECT_TRUE(controller.update(40.0));
+  EXPECT_EQ(controller.getNumOptimize(), 1u);
+  EXPECT_EQ(controller.getNrStates(), 16.0);
+
+  // Then the horizon, down to its min.
+  for (int i = 0; i < 10; ++i) controller.update(40.0);
+  EXPECT_EQ(controller.getNumOptimize(), 1u);
+  EXPECT_EQ(controller.getNrStates(), 10.0);
+  EXPECT_FALSE(controller.update(40.0));
+}
+
+TEST(testSmootherHorizonController, growsWithSlack) {
+  SmootherHorizonController controller(makeParams(), 30.0, 2u);
+  // Clamped to the max horizon.
+  EXPECT_EQ(controller.getNrStates(), 20.0);
+  for (int i = 0; i < 20; ++i) controller.update(40.0);
+  EXPECT_EQ(controller.getNrStates(), 10.0);
+  EXPECT_EQ(controller.getNumOptimize(), 1u);
+
+  // Horizon goes first, then the extra iterations.
+  EXPECT_TRUE(controller.update(1.0));
+  EXPECT_EQ(controller.getNrStates(), 12.0);
+  EXPECT_EQ(controller.getNumOptimize(), 1u);
+  for (int i = 0; i < 20; ++i) controller.update(1.0);
+  EXPECT_EQ(controller.getNrStates(), 20.0);
+  EXPECT_EQ(controller.getNumOptimize(), 2u);
+
+  // Within the dead band: nothing changes.
+  EXPECT_FALSE(controller.update(15.0));
+}
+
+TEST(testSmootherHorizonController, waitsAfterDecision) {
+  SmootherHorizonControllerParams params = makeParams();
+  params.cooldown_keyframes = 2u;
+  SmootherHorizonController controller(params, 16.0, 1u);
+  EXPECT_FALSE(controller.update(40.0));
+  EXPECT_FALSE(controller.update(40.0));
+  EXPECT_TRUE(controller.update(40.0));
+  EXPECT_EQ(controller.getNrStates(), 14.0);
+  EXPECT_FALSE(controller.update(40.0));
+  EXPECT_FALSE(controller.update(40.0));
+  EXPECT_TRUE(controller.update(40.0));
+  EXPECT_EQ(controller.getNrStates(), 12.0);
+}
+
+}  // namespace VIO
@@ -0,0 +1,129 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testStartupCache.cpp
+ * @brief  Unit tests StartupCache class' functionality.
+ * @author Antoni Rosinol
+ */
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <opencv2/core.hpp>
+
+#include "kimera-vio/utils/StartupCache.h"
+
+namespace VIO {
+
+class StartupCacheFixture : public ::testing::Test {
+ public:
+  StartupCacheFixture()
+      : filepath_((std::filesystem::temp_directory_path() /
+                   "kimera_test_startup_cache.bin")
+                      .string()) {}
+
+ protected:
+  void SetUp() override { std::filesystem::remove(filepath_); }
+  void TearDown() override { std::filesystem::remove(filepath_); }
+
+  static std::vector<cv::Mat> makeMats() {
+    cv::Mat map_x(48, 64, CV_32FC1);
+    cv::randu(map_x, cv::Scalar(0.0), cv::Scalar(64.0));
+    const cv::Mat rois = (cv::Mat_<int>(1, 8) << 1, 2, 3, 4, 5, 6, 7, 8);
+    return {map_x, rois, cv::Mat()};
+  }
+
+  static void expectEqual(const std::vector<cv::Mat>& expected,
+                          const std::vector<cv::Mat>& actual) {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0u; i < expected.size(); ++i) {
+      EXPECT_EQ(expected[i].size(), actual[i].size());
+      EXPECT_EQ(expected[i].type(), actual[i].type());
+      if (!expected[i].empty()) {
+        EXPECT_EQ(cv::norm(expected[i], actual[i], cv::NORM_INF), 0.0);
+      }
+    }
+  }
+
+  const std::string filepath_;
+};
+
+TEST_F(StartupCacheFixture, PutAndGetAfterRestart) {
+  const std::vector<cv::Mat> mats = makeMats();
+  const uint64_t hash = StartupCache::hash(mats[0]);
+  {
+    StartupCache cache(filepath_);
+    ASSERT_TRUE(cache.put("maps/cam0", hash, mats));
+    std::vector<cv::Mat> cached;
+    ASSERT_TRUE(cache.get("maps/cam0", hash, &cached));
+    expectEqual(mats, cached);
+  }
+  // The temporary file is renamed.
+  EXPECT_FALSE(std::filesystem::exists(filepath_ + ".tmp"));
+
+  // As in the next launch.
+  StartupCache cache(filepath_);
+  std::vector<cv::Mat> cached;
+  ASSERT_TRUE(cache.get("maps/cam0", hash, &cached));
+  expectEqual(mats, cached);
+}
+
+TEST_F(StartupCacheFixture, MissOnChangedInputs) {
+  const std::vector<cv::Mat> mats = makeMats();
+  const uint64_t hash = StartupCache::hash(mats[0]);
+  StartupCache cache(filepath_);
+  ASSERT_TRUE(cache.put("maps/cam0", hash, mats));
+
+  std::vector<cv::Mat> cached;
+  EXPECT_FALSE(cache.get("maps/cam1", hash, &cached));
+  cv::Mat changed = mats[0].clone();
+  changed.at<float>(10, 20) += 1.0f;
+  EXPECT_NE(StartupCache::hash(changed), hash);
+  EXPECT_FALSE(cache.get("maps/cam0", StartupCache::hash(changed), &cached));
+}
+
+TEST_F(StartupCacheFixture, HashChaining) {
+  const int a = 1;
+  const int b = 2;
+  EXPECT_EQ(StartupCache::hashValue(b, StartupCache::hashValue(a)),
+            StartupCache::hashValue(b, StartupCache::hashValue(a)));
+  EXPECT_NE(StartupCache::hashValue(b, StartupCache::hashValue(a)),
+            StartupCache::hashValue(a, StartupCache::hashValue(b)));
+}
+
+TEST_F(StartupCacheFixture, Disabled) {
+  StartupCache cache("");
+  EXPECT_FALSE(cache.isEnabled());
+  EXPECT_FALSE(cache.put("maps/cam0", 0u, makeMats()));
+  std::vector<cv::Mat> cached;
+  EXPECT_FALSE(cache.get("maps/cam0", 0u, &cached));
+}
+
+TEST_F(StartupCacheFixture, CorruptFileIsIgnored) {
+  {
+    std::ofstream stream(filepath_, std::ios::binary);
+    stream << "not a startup cache";
+  }
+  StartupCache cache(filepath_);
+  std::vector<cv::Mat> cached;
+  EXPECT_FALSE(cache.get("maps/cam0", 0u, &cached));
+  // And is replaced by the next put.
+  const std::vector<cv::Mat> mats = makeMats();
+  ASSERT_TRUE(cache.put("maps/cam0", 1u, mats));
+  StartupCache reloaded(filepath_);
+  ASSERT_TRUE(reloaded.get("maps/cam0", 1u, &cached));
+  expectEqual(mats, cached);
+}
+
+}  // namespace VIO
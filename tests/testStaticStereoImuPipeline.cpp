@@ -0,0 +1,155 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testStaticStereoImuPipeline.cpp
+ * @brief  test StaticStereoImuPipeline and the StereoKeyframeStep it shares
+ * with the EmbeddedStereoImuPipeline
+ * @author Antoni Rosinol
+ */
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/backend/VioBackend.h"
+#include "kimera-vio/frontend/StereoVisionImuFrontend.h"
+#include "kimera-vio/pipeline/EmbeddedStereoImuPipeline.h"
+#include "kimera-vio/pipeline/StaticStereoImuPipeline.h"
+#include "kimera-vio/pipeline/StereoKeyframeStep.h"
+#include "kimera-vio/test/StaticStereoImuSequence.h"
+
+DECLARE_string(test_data_path);
+
+namespace VIO {
+
+namespace {
+//! Keeps the estimates of the Backend outputs.
+struct StateSink {
+  inline void operator()(const BackendOutput& backend_output) {
+    states.push_back(backend_output.W_State_Blkf_);
+  }
+  std::vector<VioNavStateTimestamped> states;
+};
+
+using TestStaticPipeline =
+    StaticStereoImuPipeline<StereoVisionImuFrontend, VioBackend, StateSink>;
+}  // namespace
+
+TEST(StereoKeyframeStep, toBackendInput) {
+  CameraParams cam_params;
+  const StereoFrame::ConstPtr stereo_frame = std::make_shared<StereoFrame>(
+      3,
+      42,
+      Frame(3, 42, cam_params, cv::Mat::zeros(4, 4, CV_8UC1)),
+      Frame(3, 42, cam_params, cv::Mat::zeros(4, 4, CV_8UC1)));
+  StereoMeasurements measurements;
+  measurements.emplace_back(7, gtsam::StereoPoint2(1.0, 0.5, 2.0));
+  const StatusStereoMeasurementsPtr status_measurements =
+      std::make_shared<StatusStereoMeasurements>(
+          std::make_pair(TrackerStatusSummary(), measurements));
+  const gtsam::Pose3 lkf_body_Pose_kf_body(gtsam::Rot3::Yaw(0.1),
+                                           gtsam::Point3(1.0, 2.0, 3.0));
+  const gtsam::Velocity3 body_world_Vel_body(0.5, 0.0, -0.5);
+  FrontendOutputPacketBase::UniquePtr frontend_output =
+      std::make_unique<StereoFrontendOutput>(
+          true,
+          status_measurements,
+          gtsam::Pose3(),
+          gtsam::Pose3(),
+          stereo_frame,
+          nullptr,
+          ImuAccGyrS::Zero(6, 2),
+          []() { return cv::Mat(); },
+          DebugTrackerInfo(),
+          lkf_body_Pose_kf_body,
+          body_world_Vel_body);
+
+  const StereoFrontendOutput& keyframe =
+      StereoKeyframeStep::castOutput(*frontend_output);
+  EXPECT_EQ(frontend_output.get(), &keyframe);
+  const BackendInput backend_input =
+      StereoKeyframeStep::toBackendInput(keyframe);
+  EXPECT_EQ(42, backend_input.timestamp_);
+  EXPECT_EQ(status_measurements, backend_input.status_stereo_measurements_);
+  EXPECT_EQ(2, backend_input.imu_acc_gyrs_.cols());
+  ASSERT_TRUE(backend_input.body_lkf_OdomPose_body_kf_);
+  EXPECT_TRUE(gtsam::assert_equal(lkf_body_Pose_kf_body,
+                                  *backend_input.body_lkf_OdomPose_body_kf_));
+  ASSERT_TRUE(backend_input.body_kf_world_OdomVel_body_kf_);
+  EXPECT_TRUE(gtsam::assert_equal(
+      body_world_Vel_body, *backend_input.body_kf_world_OdomVel_body_kf_));
+  EXPECT_TRUE(backend_input.multi_camera_measurements_.empty());
+
+  const StereoFrontendOutput* keyframe_ptr = &keyframe;
+  const StereoFrontendOutput::Ptr shared_keyframe =
+      StereoKeyframeStep::castOutput(std::move(frontend_output));
+  EXPECT_EQ(keyframe_ptr, shared_keyframe.get());
+}
+
+TEST(StaticStereoImuPipeline, sameEstimatesAsEmbeddedPipeline) {
+  VioParams vio_params(FLAGS_test_data_path + "/EurocParams");
+  vio_params.frontend_params_.max_intra_keyframe_time_ns_ = 0.5 * 1e9;
+  // Deterministic, so that both pipelines track the same keypoints.
+  vio_params.frontend_params_.tracker_params_.ransac_randomize_ = false;
+  test::StaticStereoImuSequence sequence(FLAGS_test_data_path, &vio_params);
+
+  std::vector<VioNavStateTimestamped> embedded_states;
+  {
+    EmbeddedStereoImuPipeline pipeline(vio_params);
+    EmbeddedVioState state;
+    for (size_t k = 0u; k < sequence.size(); ++k) {
+      ImuStampS imu_stamps;
+      ImuAccGyrS imu_accgyrs;
+      sequence.getImu(k, &imu_stamps, &imu_accgyrs);
+      ASSERT_TRUE(pipeline.step(imu_stamps,
+                                imu_accgyrs,
+                                *sequence.makeLeftFrame(k),
+                                *sequence.makeRightFrame(k),
+                                &state));
+      if (state.is_keyframe) embedded_states.push_back(state.W_State_B);
+    }
+  }
+  ASSERT_GE(embedded_states.size(), 3u);
+
+  // Through the queue of the static pipeline, which holds all the packets.
+  TestStaticPipeline pipeline(vio_params, StateSink(), sequence.size() + 1u);
+  for (size_t k = 0u; k < sequence.size(); ++k) {
+    ImuStampS imu_stamps;
+    ImuAccGyrS imu_accgyrs;
+    sequence.getImu(k, &imu_stamps, &imu_accgyrs);
+    const Frame::UniquePtr left_frame = sequence.makeLeftFrame(k);
+    ASSERT_TRUE(pipeline.push(std::make_unique<StereoImuSyncPacket>(
+        StereoFrame(left_frame->id_,
+                    left_frame->timestamp_,
+                    *left_frame,
+                    *sequence.makeRightFrame(k)),
+        imu_stamps,
+        imu_accgyrs)));
+  }
+  ASSERT_TRUE(pipeline.push(nullptr));
+  EXPECT_TRUE(pipeline.spin());
+
+  // Same keyframes, and the Frontend got the same estimates: same tracking.
+  const std::vector<VioNavStateTimestamped>& static_states =
+      pipeline.getSink().states;
+  ASSERT_EQ(embedded_states.size(), static_states.size());
+  for (size_t i = 0u; i < static_states.size(); ++i) {
+    EXPECT_EQ(embedded_states[i].timestamp_, static_states[i].timestamp_);
+    EXPECT_TRUE(gtsam::assert_equal(
+        embedded_states[i].pose_, static_states[i].pose_, 1e-4));
+    EXPECT_TRUE(gtsam::assert_equal(
+        embedded_states[i].velocity_, static_states[i].velocity_, 1e-4));
+  }
+}
+
+}  // namespace VIO
@@ -0,0 +1,122 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testStationaryDetector.cpp
+ * @brief  test the detection of the idle mode from the IMU and the disparity
+ * @author Antoni Rosinol
+ */
+
+#include <cmath>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/frontend/StationaryDetector.h"
+
+namespace VIO {
+
+namespace {
+
+//! Frames at 20Hz.
+constexpr Timestamp kFramePeriodNs = 50000000;
+
+StationaryDetectorParams makeParams() {
+  StationaryDetectorParams params;
+  params.max_gyro_std = 0.01;
+  params.max_acc_std = 0.1;
+  params.max_disparity = 1.0;
+  params.min_duration_s = 0.5;
+  return params;
+}
+
+//! IMU measurements of a frame at 200Hz: gravity and gyro bias, plus a
+//! deterministic oscillation of the given amplitude.
+ImuAccGyrS makeImu(const double& amplitude) {
+  ImuAccGyrS imu_accgyrs(6, 10);
+  for (int i = 0; i < imu_accgyrs.cols(); ++i) {
+    const double oscillation = amplitude * std::sin(1.3 * i);
+    imu_accgyrs.col(i) << oscillation, 0.0, 9.81 + oscillation, 0.002,
+        -0.001 + oscillation, 0.003;
+  }
+  return imu_accgyrs;
+}
+
+}  // namespace
+
+TEST(testStationaryDetector, entersIdleModeAfterMinDuration) {
+  StationaryDetector detector(makeParams());
+  for (int k = 0; k < 10; ++k) {
+    detector.addImuMeasurements(makeImu(0.0));
+    EXPECT_FALSE(detector.update(k * kFramePeriodNs, 0.2));
+  }
+  // 0.5s after the first still frame.
+  detector.addImuMeasurements(makeImu(0.0));
+  EXPECT_TRUE(detector.update(10 * kFramePeriodNs, 0.2));
+  EXPECT_TRUE(detector.isIdle());
+  EXPECT_DOUBLE_EQ(detector.getIdleDuration(10 * kFramePeriodNs), 0.0);
+  EXPECT_DOUBLE_EQ(detector.getIdleDuration(12 * kFramePeriodNs), 0.1);
+}
+
+TEST(testStationaryDetector, leavesIdleModeOnMotion) {
+  StationaryDetector detector(makeParams());
+  Timestamp timestamp = 0;
+  for (int k = 0; k < 20; ++k, timestamp += kFramePeriodNs) {
+    detector.addImuMeasurements(makeImu(0.0));
+    detector.update(timestamp, 0.2);
+  }
+  ASSERT_TRUE(detector.isIdle());
+
+  // Vibrations only.
+  detector.addImuMeasurements(makeImu(0.5));
+  EXPECT_FALSE(detector.update(timestamp, 0.2));
+  EXPECT_DOUBLE_EQ(detector.getIdleDuration(timestamp), 0.0);
+
+  // Still again, but only for less than the min duration.
+  for (int k = 0; k < 5; ++k) {
+    timestamp += kFramePeriodNs;
+    detector.addImuMeasurements(makeImu(0.0));
+    EXPECT_FALSE(detector.update(timestamp, 0.2));
+  }
+
+  // Features moving with a still IMU (e.g. constant velocity).
+  timestamp += kFramePeriodNs;
+  detector.addImuMeasurements(makeImu(0.0));
+  EXPECT_FALSE(detector.update(timestamp, 3.0));
+}
+
+TEST(testStationaryDetector, needsImuMeasurements) {
+  StationaryDetector detector(makeParams());
+  for (int k = 0; k < 20; ++k) {
+    // Each batch is only used by the next update.
+    if (k != 15) detector.addImuMeasurements(makeImu(0.0));
+    detector.update(k * kFramePeriodNs, 0.2);
+  }
+  // The still period restarted at frame 16.
+  EXPECT_FALSE(detector.isIdle());
+}
+
+TEST(testStationaryDetector, averagesGyroWhileStill) {
+  StationaryDetector detector(makeParams());
+  Eigen::Vector3d gyro_mean;
+  detector.addImuMeasurements(makeImu(0.0));
+  detector.update(0, 0.2);
+  EXPECT_FALSE(detector.getStillGyroMean(&gyro_mean));
+
+  for (int k = 1; k <= 10; ++k) {
+    detector.addImuMeasurements(makeImu(0.0));
+    detector.update(k * kFramePeriodNs, 0.2);
+  }
+  ASSERT_TRUE(detector.getStillGyroMean(&gyro_mean));
+  EXPECT_NEAR(gyro_mean.x(), 0.002, 1e-12);
+  EXPECT_NEAR(gyro_mean.y(), -0.001, 1e-12);
+  EXPECT_NEAR(gyro_mean.z(), 0.003, 1e-12);
+}
+
+}  // namespace VIO
@@ -0,0 +1,173 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testStatistics.cpp
+ * @brief  test Statistics
+ * @author Antoni Rosinol
+ */
+
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/utils/Accumulator.h"
+#include "kimera-vio/utils/Statistics.h"
+
+namespace VIO {
+
+/* ************************************************************************** */
+TEST(testStatistics, samplesVisibleWhenQueried) {
+  const std::string tag = "testStatistics samplesVisibleWhenQueried";
+  utils::StatsCollector stats(tag);
+  stats.AddSample(1.0);
+  stats.AddSample(3.0);
+  // No need to wait for the aggregator.
+  EXPECT_EQ(utils::Statistics::GetNumSamples(tag), 2u);
+  EXPECT_DOUBLE_EQ(utils::Statistics::GetMean(tag), 2.0);
+  EXPECT_DOUBLE_EQ(utils::Statistics::GetLastValue(tag), 3.0);
+  EXPECT_DOUBLE_EQ(utils::Statistics::GetMax(tag), 3.0);
+  EXPECT_GE(utils::Statistics::GetMinDeltaTime(tag), 0.0);
+}
+
+/* ************************************************************************** */
+TEST(testStatistics, concurrentThreads) {
+  const std::string tag = "testStatistics concurrentThreads";
+  const size_t kNrThreads = 4u;
+  // More samples than fit in a thread buffer.
+  const size_t kNrSamplesPerThread = 10000u;
+  std::vector<std::thread> threads;
+  for (size_t t = 0u; t < kNrThreads; t++) {
+    threads.emplace_back([&tag, t, kNrSamplesPerThread]() {
+      // Handle resolved once per thread.
+      const utils::StatsCollector stats(tag);
+      for (size_t i = 0u; i < kNrSamplesPerThread; i++) {
+        stats.AddSample(static_cast<double>(t));
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+
+  // Samples of exited threads were flushed.
+  EXPECT_EQ(utils::Statistics::GetNumSamples(tag),
+            kNrThreads * kNrSamplesPerThread);
+  EXPECT_DOUBLE_EQ(utils::Statistics::GetTotal(tag),
+                   kNrSamplesPerThread * (0.0 + 1.0 + 2.0 + 3.0));
+  EXPECT_DOUBLE_EQ(utils::Statistics::GetMin(tag), 0.0);
+  EXPECT_DOUBLE_EQ(utils::Statistics::GetMax(tag), 3.0);
+  EXPECT_GE(utils::Statistics::GetMinDeltaTime(tag), 0.0);
+}
+
+/* ************************************************************************** */
+TEST(testStatistics, percentiles) {
+  const std::string tag = "testStatistics percentiles";
+  utils::StatsCollector stats(tag);
+  // More samples than the window of the mean/variance.
+  for (size_t i = 1u; i <= 1000u; i++) {
+    stats.AddSample(static_cast<double>(i));
+  }
+  const double kTol = utils::StatisticsMapValue::kPercentileRelativeError;
+  EXPECT_NEAR(utils::Statistics::GetPercentile(tag, 50.0), 500.0, 500.0 * kTol);
+  EXPECT_NEAR(utils::Statistics::GetPercentile(tag, 95.0), 950.0, 950.0 * kTol);
+  EXPECT_NEAR(utils::Statistics::GetPercentile(tag, 99.0), 990.0, 990.0 * kTol);
+  // Clamped to the extremes.
+  EXPECT_DOUBLE_EQ(utils::Statistics::GetPercentile(tag, 0.0), 1.0);
+  EXPECT_DOUBLE_EQ(utils::Statistics::GetPercentile(tag, 100.0), 1000.0);
+}
+
+/* ************************************************************************** */
+TEST(testStatistics, quantilesOfTheWholeRun) {
+  const std::string tag = "testStatistics quantilesOfTheWholeRun";
+  utils::StatsCollector stats(tag);
+  // Latencies of 1 to 10ms, with a 1000ms spike every 500 samples: only in
+  // the tail, long before the end of the run.
+  for (size_t i = 0u; i < 100000u; i++) {
+    stats.AddSample(i % 500u == 0u && i < 50000u ? 1000.0
+                                                 : 1.0 + (i % 10u));
+  }
+  const double kTol = utils::StatisticsMapValue::kPercentileRelativeError;
+  EXPECT_NEAR(utils::Statistics::GetMedian(tag), 6.0, 6.0 * kTol);
+  EXPECT_NEAR(utils::Statistics::GetQ1(tag), 3.0, 3.0 * kTol);
+  EXPECT_NEAR(utils::Statistics::GetQ3(tag), 8.0, 8.0 * kTol);
+  EXPECT_NEAR(utils::Statistics::GetPercentile(tag, 99.0), 10.0, 10.0 * kTol);
+  EXPECT_NEAR(
+      utils::Statistics::GetPercentile(tag, 99.95), 1000.0, 1000.0 * kTol);
+}
+
+/* ************************************************************************** */
+TEST(testStatistics, quantileHistogramMemory) {
+  utils::QuantileHistogram histogram;
+  // The bins span the range of the samples, not their number.
+  for (size_t i = 0u; i < 1000000u; i++) {
+    histogram.Add(1.0 + 99999.0 * (i % 1000u) / 999.0);
+  }
+  EXPECT_EQ(histogram.TotalSamples(), 1000000);
+  // log(1e5) / log(1.01) bins for 5 orders of magnitude.
+  EXPECT_LE(histogram.NumBins(), 1200u);
+  EXPECT_DOUBLE_EQ(histogram.Percentile(0.0, 1.0, 1e5), 1.0);
+  EXPECT_NEAR(histogram.Percentile(50.0, 1.0, 1e5),
+              50000.0,
+              50000.0 * utils::QuantileHistogram::kRelativeError);
+
+  // Negative samples extend the bins down.
+  histogram.Add(-1.0);
+  EXPECT_NEAR(histogram.Percentile(1e-5, -1.0, 1e5),
+              -1.0,
+              utils::QuantileHistogram::kRelativeError);
+}
+
+/* ************************************************************************** */
+TEST(testStatistics, quantileHistogramNonFinite) {
+  utils::QuantileHistogram histogram;
+  histogram.Add(1.0);
+  histogram.Add(std::numeric_limits<double>::infinity());
+  histogram.Add(-std::numeric_limits<double>::infinity());
+  histogram.Add(std::numeric_limits<double>::quiet_NaN());
+  // Not counted, and the bins still only span the finite samples.
+  EXPECT_EQ(histogram.TotalSamples(), 1);
+  EXPECT_EQ(histogram.NumBins(), 1u);
+  EXPECT_DOUBLE_EQ(histogram.Percentile(50.0, 1.0, 1.0), 1.0);
+
+  // The largest finite samples stay in bounded bins.
+  histogram.Add(std::numeric_limits<double>::max());
+  histogram.Add(-std::numeric_limits<double>::max());
+  EXPECT_EQ(histogram.TotalSamples(), 3);
+  EXPECT_LE(histogram.NumBins(), 2u * 75000u + 1u);
+
+  const std::string tag = "testStatistics quantileHistogramNonFinite";
+  utils::StatsCollector stats(tag);
+  stats.AddSample(2.0);
+  stats.AddSample(std::numeric_limits<double>::infinity());
+  stats.AddSample(std::numeric_limits<double>::quiet_NaN());
+  EXPECT_NEAR(utils::Statistics::GetMedian(tag),
+              2.0,
+              2.0 * utils::QuantileHistogram::kRelativeError);
+}
+
+/* ************************************************************************** */
+TEST(testStatistics, accumulatorWindow) {
+  utils::Accumulator<double, double, 5> accumulator;
+  for (size_t i = 1u; i <= 12u; i++) {
+    accumulator.Add(static_cast<double>(i));
+  }
+  EXPECT_EQ(accumulator.total_samples(), 12);
+  EXPECT_DOUBLE_EQ(accumulator.Mean(), 6.5);
+  // Only the last 5 samples, wrapping around the end of the ring buffer.
+  EXPECT_DOUBLE_EQ(accumulator.RollingMean(), 10.0);
+  EXPECT_DOUBLE_EQ(accumulator.LazyVariance(), 2.5);
+  EXPECT_EQ(accumulator.GetAllSamples(),
+            std::vector<double>({8.0, 9.0, 10.0, 11.0, 12.0}));
+  EXPECT_DOUBLE_EQ(accumulator.min(), 1.0);
+  EXPECT_DOUBLE_EQ(accumulator.max(), 12.0);
+}
+
+}  // namespace VIO
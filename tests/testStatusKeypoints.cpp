@@ -0,0 +1,58 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testStatusKeypoints.cpp
+ * @brief  test the structure-of-arrays container of keypoints
+ * @author Antoni Rosinol
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/frontend/StatusKeypoints.h"
+
+namespace VIO {
+
+TEST(testStatusKeypoints, roundTrip) {
+  const StatusKeypointsCV keypoints = {
+      {KeypointStatus::VALID, KeypointCV(1.0f, 2.0f)},
+      {KeypointStatus::NO_RIGHT_RECT, KeypointCV(3.0f, 4.0f)},
+      {KeypointStatus::NO_DEPTH, KeypointCV(5.0f, 6.0f)},
+      {KeypointStatus::VALID, KeypointCV(7.0f, 8.0f)}};
+  const StatusKeypointsSoA soa(keypoints);
+  ASSERT_EQ(soa.size(), keypoints.size());
+  EXPECT_EQ(soa.countValid(), 2u);
+  for (size_t i = 0u; i < keypoints.size(); ++i) {
+    EXPECT_EQ(soa.status(i), keypoints[i].first);
+    EXPECT_EQ(soa.isValid(i), keypoints[i].first == KeypointStatus::VALID);
+    EXPECT_EQ(soa.x()[i], keypoints[i].second.x);
+    EXPECT_EQ(soa.y()[i], keypoints[i].second.y);
+  }
+
+  StatusKeypointsCV converted;
+  soa.toStatusKeypointsCV(&converted);
+  EXPECT_EQ(converted, keypoints);
+}
+
+TEST(testStatusKeypoints, pushBackAndSetStatus) {
+  StatusKeypointsSoA soa;
+  EXPECT_TRUE(soa.empty());
+  soa.reserve(2u);
+  soa.push_back(KeypointStatus::VALID, KeypointCV(1.0f, 2.0f));
+  soa.push_back(KeypointStatus::VALID, KeypointCV(3.0f, 4.0f));
+  soa.setStatus(1u, KeypointStatus::FAILED_ARUN);
+  EXPECT_EQ(soa.countValid(), 1u);
+  EXPECT_EQ(soa.status(1u), KeypointStatus::FAILED_ARUN);
+  EXPECT_EQ(soa.keypoint(1u), KeypointCV(3.0f, 4.0f));
+  soa.clear();
+  EXPECT_TRUE(soa.empty());
+}
+
+}  // namespace VIO
@@ -0,0 +1,99 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testStereoFramePool.cpp
+ * @brief  test StereoFramePool and ContainerPool
+ * @author Antoni Rosinol
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/frontend/CameraParams.h"
+#include "kimera-vio/frontend/StereoFramePool.h"
+#include "kimera-vio/utils/ContainerPool.h"
+#include "kimera-vio/utils/UtilsOpenCV.h"
+
+DECLARE_string(test_data_path);
+
+namespace VIO {
+
+TEST(testStereoFramePool, ContainerPoolRecyclesMemory) {
+  ContainerPool<KeypointsCV> pool(1u);
+  KeypointsCV keypoints(100u, KeypointCV(1.0, 2.0));
+  const size_t capacity = keypoints.capacity();
+  pool.release(&keypoints);
+  EXPECT_TRUE(keypoints.empty());
+  EXPECT_EQ(pool.size(), 1u);
+
+  KeypointsCV recycled;
+  pool.acquire(&recycled);
+  EXPECT_TRUE(recycled.empty());
+  EXPECT_GE(recycled.capacity(), capacity);
+  EXPECT_EQ(pool.size(), 0u);
+
+  // An empty pool leaves the container untouched.
+  KeypointsCV other;
+  pool.acquire(&other);
+  EXPECT_EQ(other.capacity(), 0u);
+
+  // The pool does not grow past its maximum size.
+  KeypointsCV a(10u), b(10u);
+  pool.release(&a);
+  pool.release(&b);
+  EXPECT_EQ(pool.size(), 1u);
+}
+
+TEST(testStereoFramePool, StereoFrameContainersAreRecycled) {
+  const std::string data_path(FLAGS_test_data_path +
+                              std::string("/ForStereoFrame/"));
+  CameraParams cam_params_left, cam_params_right;
+  cam_params_left.parseYAML(data_path + "/sensorLeft.yaml");
+  cam_params_right.parseYAML(data_path + "/sensorRight.yaml");
+  const StereoFrame stereo_frame(
+      0u,
+      1,
+      Frame(0u,
+            1,
+            cam_params_left,
+            UtilsOpenCV::ReadAndConvertToGrayScale(data_path +
+                                                   "left_img_0.png")),
+      Frame(0u,
+            1,
+            cam_params_right,
+            UtilsOpenCV::ReadAndConvertToGrayScale(data_path +
+                                                   "right_img_0.png")));
+
+  StereoFramePool::Ptr pool = std::make_shared<StereoFramePool>(1u);
+  size_t keypoints_capacity = 0u;
+  size_t points_3d_capacity = 0u;
+  {
+    StereoFrame::Ptr first = pool->makeStereoFrame(stereo_frame);
+    first->left_frame_.keypoints_.resize(200u);
+    first->keypoints_3d_.resize(200u);
+    keypoints_capacity = first->left_frame_.keypoints_.capacity();
+    points_3d_capacity = first->keypoints_3d_.capacity();
+  }
+
+  StereoFrame::Ptr second = pool->makeStereoFrame(stereo_frame);
+  EXPECT_TRUE(second->left_frame_.keypoints_.empty());
+  EXPECT_TRUE(second->keypoints_3d_.empty());
+  // Either the left or right frame got the recycled keypoints.
+  EXPECT_GE(std::max(second->left_frame_.keypoints_.capacity(),
+                     second->right_frame_.keypoints_.capacity()),
+            keypoints_capacity);
+  EXPECT_GE(second->keypoints_3d_.capacity(), points_3d_capacity);
+
+  // Frames outliving their pool are simply deleted.
+  pool.reset();
+  second.reset();
+}
+
+}  // namespace VIO
@@ -16,11 +16,15 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include <opencv2/imgproc.hpp>
+
 #include "kimera-vio/frontend/VisionImuFrontendParams.h"
 #include "kimera-vio/frontend/StereoFrame.h"
 #include "kimera-vio/frontend/Camera.h"
 #include "kimera-vio/frontend/StereoCamera.h"
 #include "kimera-vio/frontend/StereoMatcher.h"
+#include "kimera-vio/frontend/GpuDenseStereoMatcher.h"
+#include "kimera-vio/frontend/GpuImagePreprocessor.h"
 
 DECLARE_string(test_data_path);
 
@@ -128,8 +132,119 @@ static cv::Mat cvTranslateImageX(cv::Mat img, double dist) {
   return result;
 }
 
+//! Fraction of the disparities (CV_16S, 4 fractional bits) of the interior of
+//! the image that are within 1 pixel of the expected disparity.
+static double getFractionOfGoodDisparities(const cv::Mat& disparity_img,
+                                           const double& expected_disparity) {
+  const cv::Rect interior(100, 20, disparity_img.cols - 120,
+                          disparity_img.rows - 40);
+  cv::Mat disparities;
+  disparity_img(interior).convertTo(disparities, CV_32F, 1.0 / 16.0);
+  cv::Mat good = cv::abs(disparities - expected_disparity) <= 1.0;
+  return static_cast<double>(cv::countNonZero(good)) / good.total();
+}
+
+//! Textured left image, and right image with a constant disparity.
+static void getShiftedStereoPair(const double& disparity,
+                                 cv::Mat* left_img,
+                                 cv::Mat* right_img) {
+  *left_img = cv::Mat(480, 752, CV_8UC1);
+  cv::RNG rng(3);
+  rng.fill(*left_img, cv::RNG::UNIFORM, 0, 255);
+  cv::GaussianBlur(*left_img, *left_img, cv::Size(5, 5), 1.0);
+  *right_img = cvTranslateImageX(*left_img, -disparity);
+}
+
 TEST_F(StereoMatcherFixture, denseStereoReconstruction) {
-  // TODO(marcus): implement
+  cv::Mat left_img, right_img;
+  getShiftedStereoPair(16.0, &left_img, &right_img);
+
+  cv::Mat disparity_img(left_img.rows, left_img.cols, CV_32F);
+  stereo_matcher->denseStereoReconstruction(
+      left_img, right_img, &disparity_img);
+  ASSERT_EQ(disparity_img.size(), left_img.size());
+  EXPECT_EQ(disparity_img.type(), CV_16S);
+  EXPECT_GT(getFractionOfGoodDisparities(disparity_img, 16.0), 0.9);
+
+  // The matcher is reused: same disparities for the same images.
+  cv::Mat disparity_img_2(left_img.rows, left_img.cols, CV_32F);
+  stereo_matcher->denseStereoReconstruction(
+      left_img, right_img, &disparity_img_2);
+  EXPECT_EQ(cv::norm(disparity_img, disparity_img_2, cv::NORM_INF), 0.0);
+}
+
+TEST_F(StereoMatcherFixture, denseStereoReconstructionHalfResolution) {
+  cv::Mat left_img, right_img;
+  getShiftedStereoPair(16.0, &left_img, &right_img);
+
+  DenseStereoParams dense_stereo_params;
+  dense_stereo_params.half_resolution_ = true;
+  VIO::FrontendParams tp;
+  StereoMatcher half_resolution_matcher(
+      stereo_camera, tp.stereo_matching_params_, dense_stereo_params);
+  cv::Mat disparity_img(left_img.rows, left_img.cols, CV_32F);
+  half_resolution_matcher.denseStereoReconstruction(
+      left_img, right_img, &disparity_img);
+  // Full resolution disparities.
+  ASSERT_EQ(disparity_img.size(), left_img.size());
+  EXPECT_EQ(disparity_img.type(), CV_16S);
+  EXPECT_GT(getFractionOfGoodDisparities(disparity_img, 16.0), 0.9);
+}
+
+TEST_F(StereoMatcherFixture, denseStereoReconstructionCudaSgm) {
+  if (!GpuDenseStereoMatcher::isAvailable()) {
+    LOG(WARNING) << "No CUDA SGM available, skipping test.";
+    return;
+  }
+  cv::Mat left_img, right_img;
+  getShiftedStereoPair(16.0, &left_img, &right_img);
+
+  DenseStereoParams dense_stereo_params;
+  dense_stereo_params.use_cuda_sgm_ = true;
+  VIO::FrontendParams tp;
+  StereoMatcher gpu_matcher(
+      stereo_camera, tp.stereo_matching_params_, dense_stereo_params);
+  cv::Mat disparity_img(left_img.rows, left_img.cols, CV_32F);
+  gpu_matcher.denseStereoReconstruction(left_img, right_img, &disparity_img);
+  ASSERT_EQ(disparity_img.size(), left_img.size());
+  EXPECT_EQ(disparity_img.type(), CV_16S);
+  EXPECT_GT(getFractionOfGoodDisparities(disparity_img, 16.0), 0.9);
+}
+
+TEST_F(StereoMatcherFixture, gpuImagePreprocessorRectification) {
+  if (!GpuImagePreprocessor::isAvailable()) {
+    LOG(WARNING) << "No CUDA preprocessing available, skipping test.";
+    return;
+  }
+  FeatureDetectorParams feature_detector_params;
+  GpuImagePreprocessor preprocessor(*stereo_camera, feature_detector_params);
+  preprocessor.enqueue(*sf);
+  GpuPreprocessedStereo preprocessed;
+  ASSERT_TRUE(preprocessor.retrieve(sf->id_, &preprocessed));
+  // Retrieved once.
+  GpuPreprocessedStereo retrieved_again;
+  EXPECT_FALSE(preprocessor.retrieve(sf->id_, &retrieved_again));
+
+  StereoFrame cpu_stereo_frame(*sf);
+  stereo_camera->undistortRectifyStereoFrame(&cpu_stereo_frame);
+  ASSERT_EQ(preprocessed.left_img_rectified.size(),
+            cpu_stereo_frame.getLeftImgRectified().size());
+  ASSERT_EQ(preprocessed.right_img_rectified.size(),
+            cpu_stereo_frame.getRightImgRectified().size());
+  // Interpolation differs slightly between cv::remap and cv::cuda::remap.
+  cv::Mat diff;
+  cv::absdiff(preprocessed.left_img_rectified,
+              cpu_stereo_frame.getLeftImgRectified(),
+              diff);
+  EXPECT_LT(cv::mean(diff)[0], 1.0);
+  cv::absdiff(preprocessed.right_img_rectified,
+              cpu_stereo_frame.getRightImgRectified(),
+              diff);
+  EXPECT_LT(cv::mean(diff)[0], 1.0);
+  if (preprocessor.detectsCandidates()) {
+    EXPECT_TRUE(preprocessed.has_candidates);
+    EXPECT_FALSE(preprocessed.candidates.empty());
+  }
 }
 
 TEST_F(StereoMatcherFixture, sparseStereoReconstruction) {
@@ -500,3 +615,230 @@ TEST_F(StereoMatcherFixture, getDepthFromRectifiedMatches) {
     }
   }
 }
+
+TEST_F(StereoMatcherFixture, epipolarStripeMatcherSsdMatchesOpenCv) {
+  const cv::Mat& left_img = sfnew->getLeftImgRectified();
+  const cv::Mat& right_img = sfnew->getRightImgRectified();
+  ASSERT_EQ(left_img.type(), CV_8UC1);
+
+  EpipolarStripeMatcher ssd_matcher(StereoMatchingKernelType::kSsd);
+  const cv::Rect templ_rect(300, 200, 21, 11);
+  const cv::Rect stripe_rect(200, 198, 151, 15);
+
+  cv::Point best_loc;
+  double score = -1.0;
+  ssd_matcher.match(
+      left_img, templ_rect, right_img, stripe_rect, &best_loc, &score);
+
+  // Compare against the cv::matchTemplate path.
+  cv::Mat result;
+  cv::matchTemplate(cv::Mat(right_img, stripe_rect),
+                    cv::Mat(left_img, templ_rect),
+                    result,
+                    CV_TM_SQDIFF);
+  cv::Point expected_loc;
+  cv::minMaxLoc(result, nullptr, nullptr, &expected_loc, nullptr);
+  EXPECT_EQ(best_loc, expected_loc);
+  EXPECT_DOUBLE_EQ(score, 0.0);
+}
+
+TEST_F(StereoMatcherFixture, epipolarStripeMatcherFindsShiftedTemplate) {
+  const cv::Mat& left_img = sfnew->getLeftImgRectified();
+  // Right image is the left one shifted by a known disparity.
+  static constexpr int kDisparity = 17;
+  cv::Mat right_img = cv::Mat::zeros(left_img.size(), left_img.type());
+  left_img.colRange(kDisparity, left_img.cols)
+      .copyTo(right_img.colRange(0, left_img.cols - kDisparity));
+
+  const cv::Rect templ_rect(400, 240, 31, 11);
+  const cv::Rect stripe_rect(300, 238, 131, 15);
+  for (const auto& kernel_type :
+       {StereoMatchingKernelType::kSsd, StereoMatchingKernelType::kNcc}) {
+    EpipolarStripeMatcher matcher(kernel_type);
+    cv::Point best_loc;
+    double score = -1.0;
+    matcher.match(
+        left_img, templ_rect, right_img, stripe_rect, &best_loc, &score);
+    EXPECT_EQ(best_loc.x + stripe_rect.x, templ_rect.x - kDisparity);
+    EXPECT_EQ(best_loc.y + stripe_rect.y, templ_rect.y);
+    EXPECT_NEAR(score, 0.0, 1e-6);
+  }
+}
+
+TEST(testEpipolarStripeMatcher, rowKernels) {
+  std::vector<uint8_t> a(203), b(203);
+  for (size_t i = 0u; i < a.size(); ++i) {
+    a[i] = static_cast<uint8_t>((i * 37u) % 256u);
+    b[i] = static_cast<uint8_t>((i * 91u + 13u) % 256u);
+  }
+  for (const int& n : {0, 5, 16, 17, 101, 203}) {
+    uint32_t expected_ssd = 0u;
+    uint32_t expected_dot = 0u;
+    for (int i = 0; i < n; ++i) {
+      const int diff = static_cast<int>(a[i]) - static_cast<int>(b[i]);
+      expected_ssd += diff * diff;
+      expected_dot += a[i] * b[i];
+    }
+    EXPECT_EQ(EpipolarStripeMatcher::ssdRow(a.data(), b.data(), n),
+              expected_ssd);
+    EXPECT_EQ(EpipolarStripeMatcher::dotRow(a.data(), b.data(), n),
+              expected_dot);
+  }
+}
+
+TEST_F(StereoMatcherFixture, parallelGetRightKeypointsRectified) {
+  const double fx = stereo_camera->getStereoCalib()->fx();
+  const double baseline = stereo_camera->getBaseline();
+  ASSERT_GT(sfnew->left_keypoints_rectified_.size(), 0u);
+
+  StatusKeypointsCV serial_right_keypoints;
+  stereo_matcher->getRightKeypointsRectified(sfnew->getLeftImgRectified(),
+                                             sfnew->getRightImgRectified(),
+                                             sfnew->left_keypoints_rectified_,
+                                             fx,
+                                             baseline,
+                                             &serial_right_keypoints);
+
+  VIO::FrontendParams tp;
+  tp.stereo_matching_params_.sparse_stereo_num_stripes_ = 4;
+  tp.stereo_matching_params_.sparse_stereo_min_parallel_kpts_ = 1;
+  StereoMatcher parallel_stereo_matcher(stereo_camera,
+                                        tp.stereo_matching_params_);
+  StatusKeypointsCV parallel_right_keypoints;
+  parallel_stereo_matcher.getRightKeypointsRectified(
+      sfnew->getLeftImgRectified(),
+      sfnew->getRightImgRectified(),
+      sfnew->left_keypoints_rectified_,
+      fx,
+      baseline,
+      &parallel_right_keypoints);
+
+  ASSERT_EQ(serial_right_keypoints.size(), parallel_right_keypoints.size());
+  for (size_t i = 0u; i < serial_right_keypoints.size(); ++i) {
+    EXPECT_EQ(serial_right_keypoints[i].first,
+              parallel_right_keypoints[i].first);
+    EXPECT_EQ(serial_right_keypoints[i].second,
+              parallel_right_keypoints[i].second);
+  }
+}
+
+TEST_F(StereoMatcherFixture, disparityPriorGetRightKeypointsRectified) {
+  const double fx = stereo_camera->getStereoCalib()->fx();
+  const double baseline = stereo_camera->getBaseline();
+  ASSERT_GT(sfnew->left_keypoints_rectified_.size(), 0u);
+
+  StatusKeypointsCV full_right_keypoints;
+  stereo_matcher->getRightKeypointsRectified(sfnew->getLeftImgRectified(),
+                                             sfnew->getRightImgRectified(),
+                                             sfnew->left_keypoints_rectified_,
+                                             fx,
+                                             baseline,
+                                             &full_right_keypoints);
+
+  // Priors from the full search: the narrow stripe contains the best match.
+  std::vector<double> disparity_priors(full_right_keypoints.size(), 0.0);
+  size_t nr_priors = 0u;
+  for (size_t i = 0u; i < full_right_keypoints.size(); ++i) {
+    if (full_right_keypoints[i].first != KeypointStatus::VALID) continue;
+    disparity_priors[i] = sfnew->left_keypoints_rectified_[i].second.x -
+                          full_right_keypoints[i].second.x;
+    if (disparity_priors[i] > 0.0) ++nr_priors;
+  }
+  ASSERT_GT(nr_priors, 0u);
+
+  VIO::FrontendParams tp;
+  tp.stereo_matching_params_.use_disparity_prior_ = true;
+  StereoMatcher prior_stereo_matcher(stereo_camera,
+                                     tp.stereo_matching_params_);
+  StatusKeypointsCV prior_right_keypoints;
+  prior_stereo_matcher.getRightKeypointsRectified(
+      sfnew->getLeftImgRectified(),
+      sfnew->getRightImgRectified(),
+      sfnew->left_keypoints_rectified_,
+      fx,
+      baseline,
+      &prior_right_keypoints,
+      disparity_priors);
+
+  ASSERT_EQ(full_right_keypoints.size(), prior_right_keypoints.size());
+  for (size_t i = 0u; i < full_right_keypoints.size(); ++i) {
+    EXPECT_EQ(full_right_keypoints[i].first, prior_right_keypoints[i].first);
+    EXPECT_EQ(full_right_keypoints[i].second, prior_right_keypoints[i].second);
+  }
+}
+
+TEST_F(StereoMatcherFixture, kltStereoMatching) {
+  VIO::FrontendParams tp;
+  tp.stereo_matching_params_.stereo_matching_mode_ = StereoMatchingMode::kKlt;
+  StereoMatcher klt_stereo_matcher(stereo_camera, tp.stereo_matching_params_);
+
+  StereoFrame klt_sf(*sfnew);
+  klt_stereo_matcher.sparseStereoReconstruction(&klt_sf);
+  ASSERT_EQ(klt_sf.right_keypoints_rectified_.size(),
+            sfnew->right_keypoints_rectified_.size());
+  EXPECT_FALSE(klt_sf.right_frame_.hasOpticalFlowPyramid());
+
+  // Most keypoints matched by the template matching are found by the KLT too,
+  // on the same epipolar line and at about the same disparity.
+  size_t nr_template_matches = 0u;
+  size_t nr_common_matches = 0u;
+  for (size_t i = 0u; i < klt_sf.right_keypoints_rectified_.size(); ++i) {
+    const StatusKeypointCV& klt_kp = klt_sf.right_keypoints_rectified_[i];
+    const StatusKeypointCV& templ_kp = sfnew->right_keypoints_rectified_[i];
+    if (klt_kp.first == KeypointStatus::VALID) {
+      EXPECT_LE(std::abs(klt_kp.second.y -
+                         klt_sf.left_keypoints_rectified_[i].second.y),
+                tp.stereo_matching_params_.klt_stereo_max_epipolar_error_);
+    }
+    if (templ_kp.first != KeypointStatus::VALID) continue;
+    ++nr_template_matches;
+    if (klt_kp.first == KeypointStatus::VALID &&
+        std::abs(klt_kp.second.x - templ_kp.second.x) <= 2.0) {
+      ++nr_common_matches;
+    }
+  }
+  ASSERT_GT(nr_template_matches, 0u);
+  EXPECT_GE(nr_common_matches, 0.8 * nr_template_matches);
+}
+
+TEST_F(StereoMatcherFixture, lazyStereoRectification) {
+  VIO::FrontendParams tp;
+  tp.stereo_matching_params_.lazy_stereo_rectification_ = true;
+  StereoMatcher lazy_stereo_matcher(stereo_camera, tp.stereo_matching_params_);
+
+  StereoFrame lazy_sf(*sfnew);
+  lazy_stereo_matcher.sparseStereoReconstruction(&lazy_sf);
+  EXPECT_TRUE(lazy_sf.isRectified());
+  EXPECT_FALSE(lazy_sf.hasFullRectifiedImages());
+  EXPECT_TRUE(sfnew->hasFullRectifiedImages());
+
+  // Only the rows read by the matcher are rectified, the matches are the same.
+  ASSERT_EQ(lazy_sf.right_keypoints_rectified_.size(),
+            sfnew->right_keypoints_rectified_.size());
+  for (size_t i = 0u; i < lazy_sf.right_keypoints_rectified_.size(); ++i) {
+    EXPECT_EQ(lazy_sf.right_keypoints_rectified_[i].first,
+              sfnew->right_keypoints_rectified_[i].first);
+    EXPECT_EQ(lazy_sf.right_keypoints_rectified_[i].second,
+              sfnew->right_keypoints_rectified_[i].second);
+  }
+}
+
+TEST_F(StereoMatcherFixture, getStripeRowRanges) {
+  StatusKeypointsCV left_keypoints;
+  left_keypoints.push_back(
+      std::make_pair(KeypointStatus::VALID, KeypointCV(10.0, 100.0)));
+  left_keypoints.push_back(
+      std::make_pair(KeypointStatus::VALID, KeypointCV(50.0, 103.0)));
+  left_keypoints.push_back(
+      std::make_pair(KeypointStatus::NO_LEFT_RECT, KeypointCV(50.0, 300.0)));
+  left_keypoints.push_back(
+      std::make_pair(KeypointStatus::VALID, KeypointCV(20.0, 2.0)));
+
+  std::vector<cv::Range> row_ranges;
+  stereo_matcher->getStripeRowRanges(left_keypoints, 480, &row_ranges);
+
+  // Default params: 11 template rows, no extra rows, no subpixel refinement.
+  ASSERT_EQ(row_ranges.size(), 2u);
+  EXPECT_EQ(row_ranges[0], cv::Range(0, 9));
+  EXPECT_EQ(row_ranges[1], cv::Range(94, 110));
+}
@@ -24,6 +24,7 @@
 #include <iostream>
 #include <random>
 #include <string>
+#include <vector>
 
 #include "kimera-vio/frontend/CameraParams.h"
 #include "kimera-vio/frontend/Frame.h"
@@ -531,7 +532,7 @@ TEST_F(StereoVisionImuFrontendFixture, processFirstFrame) {
   auto output = castUnique<StereoFrontendOutput>(std::move(output_base));
   EXPECT_TRUE(st.isInitialized());
   ASSERT_TRUE(output);
-  const StereoFrame& sf = output->stereo_frame_lkf_;
+  const StereoFrame& sf = *output->stereo_frame_lkf_;
 
   // Check the following results:
   // 1. Feature Detection
@@ -735,7 +736,7 @@ TEST_F(StereoVisionImuFrontendFixture, testDisparityCheck) {
       zeroth_stereo_frame, zeroth_imu_stamps, fake_imu_acc_gyr);
   auto output_base0 = st.spinOnce(std::move(input0));
   auto output0 = castUnique<StereoFrontendOutput>(std::move(output_base0));
-  const auto& sf0 = output0->stereo_frame_lkf_;
+  const auto& sf0 = *output0->stereo_frame_lkf_;
   EXPECT_TRUE(sf0.isKeyframe());
 
   ///// make next stereo frame - disparity is low and is keyframe /////
@@ -765,7 +766,7 @@ TEST_F(StereoVisionImuFrontendFixture, testDisparityCheck) {
   auto output1 = castUnique<StereoFrontendOutput>(std::move(output_base1));
   EXPECT_TRUE(st.isInitialized());
   ASSERT_TRUE(output1);
-  const auto& sf1 = output1->stereo_frame_lkf_;
+  const auto& sf1 = *output1->stereo_frame_lkf_;
 
   EXPECT_TRUE(sf1.isKeyframe());
 
@@ -795,7 +796,7 @@ TEST_F(StereoVisionImuFrontendFixture, testDisparityCheck) {
   auto output2 = castUnique<StereoFrontendOutput>(std::move(output_base2));
   EXPECT_TRUE(st.isInitialized());
   ASSERT_TRUE(output2);
-  const auto& sf2 = output2->stereo_frame_lkf_;
+  const auto& sf2 = *output2->stereo_frame_lkf_;
 
   EXPECT_TRUE(sf2.isKeyframe());
 
@@ -828,7 +829,7 @@ TEST_F(StereoVisionImuFrontendFixture, testDisparityCheck) {
   auto output3 = castUnique<StereoFrontendOutput>(std::move(output_base3));
   EXPECT_TRUE(st.isInitialized());
   ASSERT_TRUE(output3);
-  const auto& sf3 = output3->stereo_frame_lkf_;
+  const auto& sf3 = *output3->stereo_frame_lkf_;
 
   EXPECT_TRUE(sf3.isKeyframe());
 
@@ -859,7 +860,7 @@ TEST_F(StereoVisionImuFrontendFixture, testDisparityCheck) {
   auto output4 = castUnique<StereoFrontendOutput>(std::move(output_base4));
   EXPECT_TRUE(st.isInitialized());
   ASSERT_TRUE(output4);
-  const auto& sf4 = output4->stereo_frame_lkf_;
+  const auto& sf4 = *output4->stereo_frame_lkf_;
 
   EXPECT_TRUE(sf4.isKeyframe());
 
@@ -889,7 +890,7 @@ TEST_F(StereoVisionImuFrontendFixture, testDisparityCheck) {
   auto output5 = castUnique<StereoFrontendOutput>(std::move(output_base5));
   EXPECT_TRUE(st.isInitialized());
   ASSERT_TRUE(output5);
-  const auto& sf5 = output5->stereo_frame_lkf_;
+  const auto& sf5 = *output5->stereo_frame_lkf_;
 
   EXPECT_FALSE(sf5.isKeyframe());
 
@@ -920,7 +921,7 @@ TEST_F(StereoVisionImuFrontendFixture, testDisparityCheck) {
   auto output6 = castUnique<StereoFrontendOutput>(std::move(output_base6));
   EXPECT_TRUE(st.isInitialized());
   ASSERT_TRUE(output6);
-  const auto& sf6 = output6->stereo_frame_lkf_;
+  const auto& sf6 = *output6->stereo_frame_lkf_;
 
   EXPECT_TRUE(sf6.isKeyframe());
 }
@@ -989,7 +990,7 @@ TEST_F(StereoVisionImuFrontendFixture, testLostFeatureTrack) {
       zeroth_stereo_frame, zeroth_imu_stamps, fake_imu_acc_gyr);
   auto output_base0 = st.spinOnce(std::move(input0));
   auto output0 = castUnique<StereoFrontendOutput>(std::move(output_base0));
-  const StereoFrame& sf0 = output0->stereo_frame_lkf_;
+  const StereoFrame& sf0 = *output0->stereo_frame_lkf_;
   EXPECT_TRUE(sf0.isKeyframe());
 
   StereoFrame first_stereo_frame(
@@ -1007,7 +1008,7 @@ TEST_F(StereoVisionImuFrontendFixture, testLostFeatureTrack) {
   auto output1 = castUnique<StereoFrontendOutput>(std::move(output_base1));
   EXPECT_TRUE(st.isInitialized());
   ASSERT_TRUE(output1);
-  const auto& sf1 = output1->stereo_frame_lkf_;
+  const auto& sf1 = *output1->stereo_frame_lkf_;
 
   EXPECT_FALSE(sf1.isKeyframe());
 
@@ -1026,11 +1027,140 @@ TEST_F(StereoVisionImuFrontendFixture, testLostFeatureTrack) {
   auto output2 = castUnique<StereoFrontendOutput>(std::move(output_base2));
   EXPECT_TRUE(st.isInitialized());
   ASSERT_TRUE(output2);
-  const auto& sf2 = output2->stereo_frame_lkf_;
+  const auto& sf2 = *output2->stereo_frame_lkf_;
 
   // should be able to track, optical flow works since points bear
   // correspondence to prior image
   EXPECT_TRUE(sf2.isKeyframe());
 }
 
+TEST_F(StereoVisionImuFrontendFixture, keyframeOnlyProcessing) {
+  // Frames 0 and 2 are keyframes, frame 1 is not.
+  FrontendParams p;
+  p.min_intra_keyframe_time_ns_ = 2e+8;
+  p.max_intra_keyframe_time_ns_ = 2e+8;
+  p.max_disparity_since_lkf_ = 1e+6;
+  // Deterministic, so that both runs below track the same keypoints.
+  p.tracker_params_.ransac_randomize_ = false;
+  const std::vector<Timestamp> timestamps = {0, 100000000, 300000000};
+  const std::vector<std::string> img_ids = {"0", "1", "1"};
+
+  StereoCamera::ConstPtr stereo_camera =
+      std::make_shared<StereoCamera>(cam_params_left_, cam_params_right_);
+  // Copies of the left versors and right keypoints of each output frame.
+  struct OutputFrame {
+    bool is_keyframe;
+    size_t nr_keypoints;
+    BearingVectors versors;
+    StatusKeypointsCV right_keypoints_rectified;
+  };
+  auto run = [&](const bool& keyframe_only_processing) {
+    p.keyframe_only_processing_ = keyframe_only_processing;
+    StereoVisionImuFrontend st(p, imu_params_, ImuBias(), stereo_camera);
+    std::vector<OutputFrame> output_frames;
+    for (size_t i = 0u; i < timestamps.size(); ++i) {
+      const Timestamp& t = timestamps[i];
+      StereoFrame stereo_frame(
+          i,
+          t,
+          Frame(i,
+                t,
+                cam_params_left_,
+                UtilsOpenCV::ReadAndConvertToGrayScale(
+                    stereo_FLAGS_test_data_path + "left_img_" + img_ids[i] +
+                    ".png")),
+          Frame(i,
+                t,
+                cam_params_right_,
+                UtilsOpenCV::ReadAndConvertToGrayScale(
+                    stereo_FLAGS_test_data_path + "right_img_" + img_ids[i] +
+                    ".png")));
+      ImuStampS imu_stamps(1, 2);
+      imu_stamps << t - 1000, t;
+      ImuAccGyrS imu_acc_gyr = ImuAccGyrS::Zero(6, 2);
+      auto output = castUnique<StereoFrontendOutput>(
+          st.spinOnce(std::make_unique<StereoImuSyncPacket>(
+              stereo_frame, imu_stamps, imu_acc_gyr)));
+      CHECK(output);
+      const StereoFrame& sf = *output->stereo_frame_lkf_;
+      output_frames.push_back({sf.isKeyframe(),
+                               sf.left_frame_.keypoints_.size(),
+                               sf.left_frame_.versors_,
+                               sf.right_keypoints_rectified_});
+    }
+    return output_frames;
+  };
+
+  const std::vector<OutputFrame> all = run(false);
+  const std::vector<OutputFrame> kf_only = run(true);
+  ASSERT_EQ(3u, all.size());
+  ASSERT_EQ(3u, kf_only.size());
+  for (size_t i = 0u; i < all.size(); ++i) {
+    EXPECT_EQ(i != 1u, all[i].is_keyframe) << "Frame " << i;
+    EXPECT_EQ(i != 1u, kf_only[i].is_keyframe) << "Frame " << i;
+    EXPECT_GT(kf_only[i].nr_keypoints, 0u);
+    // Same tracking in both modes.
+    EXPECT_EQ(all[i].nr_keypoints, kf_only[i].nr_keypoints);
+  }
+
+  // The non-keyframe is only tracked: no versors, no right image work.
+  EXPECT_EQ(all[1].nr_keypoints, all[1].versors.size());
+  EXPECT_TRUE(kf_only[1].versors.empty());
+  EXPECT_TRUE(all[1].right_keypoints_rectified.empty());
+  EXPECT_TRUE(kf_only[1].right_keypoints_rectified.empty());
+
+  // The keyframe after it has the same versors and right keypoints as if
+  // all the frames were processed.
+  const OutputFrame& kf = kf_only[2];
+  ASSERT_EQ(kf.nr_keypoints, kf.versors.size());
+  ASSERT_EQ(kf.nr_keypoints, kf.right_keypoints_rectified.size());
+  ASSERT_EQ(all[2].versors.size(), kf.versors.size());
+  ASSERT_EQ(all[2].right_keypoints_rectified.size(),
+            kf.right_keypoints_rectified.size());
+  size_t nr_valid_right_keypoints = 0u;
+  for (size_t j = 0u; j < kf.nr_keypoints; ++j) {
+    EXPECT_NEAR(1.0, kf.versors[j].norm(), 1e-9);
+    EXPECT_TRUE(gtsam::assert_equal(all[2].versors[j], kf.versors[j], 1e-9));
+    const StatusKeypointCV& right_kpt = kf.right_keypoints_rectified[j];
+    const StatusKeypointCV& expected_right_kpt =
+        all[2].right_keypoints_rectified[j];
+    EXPECT_EQ(expected_right_kpt.first, right_kpt.first);
+    if (right_kpt.first == KeypointStatus::VALID) {
+      ++nr_valid_right_keypoints;
+      EXPECT_NEAR(expected_right_kpt.second.x, right_kpt.second.x, 1e-4);
+      EXPECT_NEAR(expected_right_kpt.second.y, right_kpt.second.y, 1e-4);
+    }
+  }
+  EXPECT_GT(nr_valid_right_keypoints, 0u);
+}
+
+TEST(StereoFrontendOutput, featureTracksDrawnOnDemand) {
+  CameraParams cam_params;
+  const StereoFrame::ConstPtr stereo_frame = std::make_shared<StereoFrame>(
+      0,
+      0,
+      Frame(0, 0, cam_params, cv::Mat::zeros(4, 4, CV_8UC1)),
+      Frame(0, 0, cam_params, cv::Mat::zeros(4, 4, CV_8UC1)));
+  size_t nr_draws = 0u;
+  StereoFrontendOutput output(
+      false,
+      nullptr,
+      gtsam::Pose3(),
+      gtsam::Pose3(),
+      stereo_frame,
+      nullptr,
+      ImuAccGyrS(6, 1),
+      [&nr_draws]() {
+        ++nr_draws;
+        return cv::Mat(2, 3, CV_8UC3, cv::Scalar::all(0));
+      },
+      DebugTrackerInfo());
+  // The output shares the frame instead of copying it.
+  EXPECT_EQ(stereo_frame.get(), output.stereo_frame_lkf_.get());
+  EXPECT_EQ(0u, nr_draws);
+  EXPECT_EQ(3, output.getTrackingImage()->cols);
+  EXPECT_EQ(3, output.getTrackingImage()->cols);
+  EXPECT_EQ(1u, nr_draws);
+}
+
 }  // namespace VIO
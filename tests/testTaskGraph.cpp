@@ -0,0 +1,110 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testTaskGraph.cpp
+ * @brief  test TaskGraph
+ * @author Antoni Rosinol
+ */
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/utils/TaskGraph.h"
+
+namespace VIO {
+
+/* ************************************************************************* */
+TEST(testTaskGraph, sequentialRunKeepsTheOrder) {
+  utils::TaskGraph graph(0u);
+  std::vector<int> order;
+  const auto a = graph.addTask([&order]() { order.push_back(0); });
+  const auto b = graph.addTask([&order]() { order.push_back(1); });
+  graph.addTask([&order]() { order.push_back(2); }, {a, b});
+  graph.run();
+  EXPECT_EQ(order, std::vector<int>({0, 1, 2}));
+
+  // The graph is cleared by run.
+  graph.run();
+  EXPECT_EQ(order.size(), 3u);
+}
+
+/* ************************************************************************* */
+TEST(testTaskGraph, dependenciesFinishFirst) {
+  utils::TaskGraph graph(3u);
+  for (int iteration = 0; iteration < 100; ++iteration) {
+    std::mutex mutex;
+    std::vector<int> order;
+    const auto log = [&mutex, &order](const int& i) {
+      std::lock_guard<std::mutex> lock(mutex);
+      order.push_back(i);
+    };
+    // Diamond: 0 -> {1, 2} -> 3.
+    const auto a = graph.addTask([&log]() { log(0); });
+    const auto b = graph.addTask([&log]() { log(1); }, {a});
+    const auto c = graph.addTask([&log]() { log(2); }, {a});
+    graph.addTask([&log]() { log(3); }, {b, c});
+    graph.run();
+    ASSERT_EQ(order.size(), 4u);
+    EXPECT_EQ(order.front(), 0);
+    EXPECT_EQ(order.back(), 3);
+  }
+}
+
+/* ************************************************************************* */
+TEST(testTaskGraph, independentTasksOverlap) {
+  utils::TaskGraph graph(1u);
+  // Each task waits for the other one to start: only completes if both run
+  // at the same time.
+  std::atomic<int> nr_started(0);
+  const auto rendezvous = [&nr_started]() {
+    ++nr_started;
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (nr_started < 2 && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::yield();
+    }
+  };
+  graph.addTask(rendezvous);
+  graph.addTask(rendezvous);
+  const auto start = std::chrono::steady_clock::now();
+  graph.run();
+  EXPECT_EQ(nr_started, 2);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+}
+
+/* ************************************************************************* */
+TEST(testTaskGraph, exceptionSkipsDependents) {
+  for (const size_t nr_threads : {size_t(0u), size_t(2u)}) {
+    utils::TaskGraph graph(nr_threads);
+    std::atomic<bool> dependent_ran(false);
+    std::atomic<bool> independent_ran(false);
+    const auto a =
+        graph.addTask([]() { throw std::runtime_error("task failed"); });
+    graph.addTask([&dependent_ran]() { dependent_ran = true; }, {a});
+    graph.addTask([&independent_ran]() { independent_ran = true; });
+    EXPECT_THROW(graph.run(), std::runtime_error);
+    EXPECT_FALSE(dependent_ran);
+    EXPECT_TRUE(independent_ran);
+
+    // Usable again afterwards.
+    bool ran = false;
+    graph.addTask([&ran]() { ran = true; });
+    graph.run();
+    EXPECT_TRUE(ran);
+  }
+}
+
+}  // namespace VIO
@@ -0,0 +1,199 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testTelemetryCodec.cpp
+ * @brief  test TelemetryEncoder and TelemetryDecoder
+ * @author Antoni Rosinol
+ */
+
+#include <string>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/visualizer/TelemetryCodec.h"
+
+namespace VIO {
+
+namespace {
+TelemetryMap makeMap(const Timestamp& timestamp, const size_t& nr_landmarks) {
+  TelemetryMap map;
+  map.timestamp_ = timestamp;
+  map.position_ = {{1.0, 2.0, 3.0 + timestamp}};
+  map.orientation_ = {{0.5, 0.5, 0.5, 0.5}};
+  for (size_t i = 0u; i < nr_landmarks; ++i) {
+    const LandmarkId id = 3 * i + 1;
+    map.landmarks_[id] = {{0.1f * i, -0.2f * i, 1.0f}};
+  }
+  for (size_t i = 0u; i + 2u < nr_landmarks; ++i) {
+    map.mesh_vertices_[3 * i + 1] = map.landmarks_[3 * i + 1];
+    map.mesh_triangles_.insert({{LandmarkId(3 * i + 1),
+                                 LandmarkId(3 * i + 4),
+                                 LandmarkId(3 * i + 7)}});
+  }
+  return map;
+}
+
+void expectEqualMaps(const TelemetryMap& expected, const TelemetryMap& actual) {
+  EXPECT_EQ(expected.timestamp_, actual.timestamp_);
+  for (size_t i = 0u; i < 3u; ++i) {
+    EXPECT_DOUBLE_EQ(expected.position_[i], actual.position_[i]);
+  }
+  for (size_t i = 0u; i < 4u; ++i) {
+    EXPECT_FLOAT_EQ(expected.orientation_[i], actual.orientation_[i]);
+  }
+  EXPECT_EQ(expected.landmarks_, actual.landmarks_);
+  EXPECT_EQ(expected.mesh_vertices_, actual.mesh_vertices_);
+  EXPECT_EQ(expected.mesh_triangles_, actual.mesh_triangles_);
+}
+
+bool decodeStream(const std::string& stream, TelemetryDecoder* decoder) {
+  size_t offset = 0u;
+  while (offset < stream.size()) {
+    const size_t packet_size = TelemetryDecoder::getPacketSize(
+        stream.data() + offset, stream.size() - offset);
+    if (packet_size == 0u) return false;
+    if (!decoder->decodePacket(stream.data() + offset, packet_size)) {
+      return false;
+    }
+    offset += packet_size;
+  }
+  return true;
+}
+}  // namespace
+
+/* ************************************************************************* */
+TEST(testTelemetryCodec, mapDeltas) {
+  TelemetryEncoder encoder(0.0f);
+  TelemetryDecoder decoder;
+  for (Timestamp timestamp = 0; timestamp < 5; ++timestamp) {
+    // Landmarks appear, disappear and move.
+    TelemetryMap map = makeMap(timestamp, 10u + 3u * timestamp);
+    map.landmarks_.erase(3 * timestamp + 1);
+    map.landmarks_[1000 - 7 * timestamp] = {{1.0f, 2.0f, 3.0f}};
+    map.landmarks_[4][2] = 0.5f * timestamp;
+    std::string packet;
+    encoder.encodeMapDelta(map, &packet);
+    TelemetryPacketType type;
+    ASSERT_TRUE(decoder.decodePacket(packet.data(), packet.size(), &type));
+    EXPECT_EQ(type, TelemetryPacketType::kMapDelta);
+    expectEqualMaps(map, decoder.getMap());
+    expectEqualMaps(map, encoder.getEncodedMap());
+  }
+}
+
+/* ************************************************************************* */
+TEST(testTelemetryCodec, unchangedMapDeltaIsSmall) {
+  TelemetryEncoder encoder;
+  const TelemetryMap map = makeMap(0, 100u);
+  std::string first_packet;
+  encoder.encodeMapDelta(map, &first_packet);
+  std::string second_packet;
+  encoder.encodeMapDelta(map, &second_packet);
+  // Header, timestamp, pose, and 6 empty lists.
+  EXPECT_EQ(second_packet.size(), kTelemetryHeaderSize + 8u + 24u + 16u + 6u);
+  EXPECT_LT(second_packet.size(), first_packet.size());
+}
+
+/* ************************************************************************* */
+TEST(testTelemetryCodec, positionTolerance) {
+  TelemetryEncoder encoder(0.01f);
+  TelemetryDecoder decoder;
+  TelemetryMap map = makeMap(0, 10u);
+  std::string stream;
+  encoder.encodeMapDelta(map, &stream);
+
+  // Small motions are not sent...
+  const TelemetryPoint first_position = map.landmarks_[4];
+  map.landmarks_[4][0] += 0.005f;
+  encoder.encodeMapDelta(map, &stream);
+  ASSERT_TRUE(decodeStream(stream, &decoder));
+  EXPECT_EQ(decoder.getMap().landmarks_.at(4), first_position);
+
+  // ... unless they add up.
+  map.landmarks_[4][0] += 0.006f;
+  stream.clear();
+  encoder.encodeMapDelta(map, &stream);
+  ASSERT_TRUE(decodeStream(stream, &decoder));
+  EXPECT_EQ(decoder.getMap().landmarks_.at(4), map.landmarks_[4]);
+}
+
+/* ************************************************************************* */
+TEST(testTelemetryCodec, snapshotForLateReceiver) {
+  TelemetryEncoder encoder(0.0f);
+  TelemetryDecoder early_decoder;
+  std::string early_stream;
+  for (Timestamp timestamp = 0; timestamp < 3; ++timestamp) {
+    encoder.encodeMapDelta(makeMap(timestamp, 5u + timestamp), &early_stream);
+  }
+  ASSERT_TRUE(decodeStream(early_stream, &early_decoder));
+
+  // A late receiver starts from a snapshot, with stale data to replace.
+  TelemetryDecoder late_decoder;
+  std::string late_stream;
+  TelemetryEncoder other_encoder;
+  other_encoder.encodeMapDelta(makeMap(7, 20u), &late_stream);
+  encoder.encodeMapSnapshot(&late_stream);
+  ASSERT_TRUE(decodeStream(late_stream, &late_decoder));
+  expectEqualMaps(early_decoder.getMap(), late_decoder.getMap());
+
+  // And then follows the deltas as the others.
+  std::string packet;
+  const TelemetryMap map = makeMap(3, 4u);
+  encoder.encodeMapDelta(map, &packet);
+  ASSERT_TRUE(late_decoder.decodePacket(packet.data(), packet.size()));
+  expectEqualMaps(map, late_decoder.getMap());
+}
+
+/* ************************************************************************* */
+TEST(testTelemetryCodec, images) {
+  TelemetryImage image;
+  image.timestamp_ = 123456789;
+  image.name_ = "Feature Tracks";
+  image.data_ = std::string("\xff\xd8\x00\x01 jpeg", 10u);
+  std::string packet;
+  TelemetryEncoder::encodeImage(image, &packet);
+  TelemetryDecoder decoder;
+  TelemetryPacketType type;
+  ASSERT_TRUE(decoder.decodePacket(packet.data(), packet.size(), &type));
+  EXPECT_EQ(type, TelemetryPacketType::kImage);
+  EXPECT_EQ(decoder.getImage().timestamp_, image.timestamp_);
+  EXPECT_EQ(decoder.getImage().name_, image.name_);
+  EXPECT_EQ(decoder.getImage().data_, image.data_);
+}
+
+/* ************************************************************************* */
+TEST(testTelemetryCodec, malformedPackets) {
+  TelemetryEncoder encoder;
+  std::string packet;
+  encoder.encodeMapDelta(makeMap(0, 10u), &packet);
+  TelemetryDecoder decoder;
+
+  // Incomplete packets are not framed.
+  EXPECT_EQ(TelemetryDecoder::getPacketSize(packet.data(), 5u), 0u);
+  EXPECT_EQ(TelemetryDecoder::getPacketSize(packet.data(), packet.size() - 1u),
+            0u);
+  EXPECT_EQ(TelemetryDecoder::getPacketSize(packet.data(), packet.size()),
+            packet.size());
+  EXPECT_FALSE(decoder.decodePacket(packet.data(), packet.size() - 1u));
+
+  std::string bad_magic = packet;
+  bad_magic[0] = 'X';
+  EXPECT_FALSE(decoder.decodePacket(bad_magic.data(), bad_magic.size()));
+
+  // Counts larger than the payload.
+  // The timestamp and pose take 56 bytes.
+  std::string bad_count = packet.substr(0u, kTelemetryHeaderSize + 56u);
+  bad_count += "\xff\xff\xff\x0f";
+  bad_count[4] = static_cast<char>(bad_count.size() - kTelemetryHeaderSize);
+  bad_count[5] = bad_count[6] = bad_count[7] = 0;
+  EXPECT_FALSE(decoder.decodePacket(bad_count.data(), bad_count.size()));
+}
+
+}  // namespace VIO
@@ -681,6 +681,35 @@ TEST(temporalCalibration, testPosDelayImuRate) {
   EXPECT_DOUBLE_EQ(data.expected_delay, result.imu_time_shift);
 }
 
+TEST(temporalCalibration, testPosDelayLargeWindowImuRate) {
+  // window large enough to use the FFT cross-correlation
+  TestData data = makeTestData(60, 5, 0.02, true, 7);
+
+  MockTracker tracker;
+  CrossCorrTimeAligner aligner(data.params);
+
+  ReturnHelper helper(data.results);
+  EXPECT_CALL(tracker, geometricOutlierRejection2d2d(NotNull(), NotNull(), _))
+      .With(Args<0, 1>(Ne()))
+      .Times(data.results.size())
+      .WillRepeatedly(Invoke(&helper, &ReturnHelper::getNext));
+
+  TimeAlignerBase::Result result;
+  for (size_t i = 0; i < data.results.size(); ++i) {
+    result = aligner.estimateTimeAlignment(
+        tracker, *(data.outputs[i]), data.imu_stamps[i], data.imu_values[i]);
+    EXPECT_FALSE(result.valid);
+    EXPECT_DOUBLE_EQ(0.0, result.imu_time_shift);
+  }
+
+  result = aligner.estimateTimeAlignment(tracker,
+                                         *(data.outputs.back()),
+                                         data.imu_stamps.back(),
+                                         data.imu_values.back());
+  EXPECT_TRUE(result.valid);
+  EXPECT_DOUBLE_EQ(data.expected_delay, result.imu_time_shift);
+}
+
 TEST(temporalCalibration, testNegDelayFrameRate) {
   TestData data = makeTestData(10, 5, 0.1, false, -8);
 
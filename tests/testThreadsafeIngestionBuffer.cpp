@@ -0,0 +1,97 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testThreadsafeIngestionBuffer.cpp
+ * @brief  test ThreadsafeIngestionBuffer
+ * @author Antoni Rosinol
+ */
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/utils/ThreadsafeIngestionBuffer.h"
+
+namespace VIO {
+
+/* ************************************************************************* */
+TEST(testThreadsafeIngestionBuffer, drainsInOrder) {
+  ThreadsafeIngestionBuffer<int> buffer("test_buffer", 4u);
+  EXPECT_TRUE(buffer.empty());
+  std::vector<int> drained;
+  const auto sink = [&drained](int&& value) { drained.push_back(value); };
+  EXPECT_EQ(buffer.drain(sink), 0u);
+
+  for (int i = 0; i < 3; ++i) EXPECT_TRUE(buffer.push(i));
+  EXPECT_FALSE(buffer.empty());
+  EXPECT_EQ(buffer.drain(sink), 3u);
+  EXPECT_TRUE(buffer.empty());
+  ASSERT_EQ(drained.size(), 3u);
+  for (int i = 0; i < 3; ++i) EXPECT_EQ(drained[i], i);
+}
+
+/* ************************************************************************* */
+TEST(testThreadsafeIngestionBuffer, overflowKeepsOrder) {
+  ThreadsafeIngestionBuffer<int> buffer("test_buffer", 4u);
+  // Way more than the ring capacity: nothing is dropped nor reordered.
+  for (int i = 0; i < 100; ++i) EXPECT_TRUE(buffer.push(i));
+  std::vector<int> drained;
+  const auto sink = [&drained](int&& value) { drained.push_back(value); };
+  EXPECT_EQ(buffer.drain(sink), 100u);
+  EXPECT_TRUE(buffer.empty());
+  // Back to the ring after the overflow has been drained.
+  for (int i = 100; i < 102; ++i) EXPECT_TRUE(buffer.push(i));
+  EXPECT_EQ(buffer.drain(sink), 2u);
+  ASSERT_EQ(drained.size(), 102u);
+  for (int i = 0; i < 102; ++i) EXPECT_EQ(drained[i], i);
+}
+
+/* ************************************************************************* */
+TEST(testThreadsafeIngestionBuffer, movesUniquePtrs) {
+  ThreadsafeIngestionBuffer<std::unique_ptr<int>> buffer("test_buffer", 2u);
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_TRUE(buffer.push(std::make_unique<int>(i)));
+  }
+  int expected = 0;
+  buffer.drain([&expected](std::unique_ptr<int>&& value) {
+    ASSERT_TRUE(value);
+    EXPECT_EQ(*value, expected++);
+  });
+  EXPECT_EQ(expected, 5);
+}
+
+/* ************************************************************************* */
+TEST(testThreadsafeIngestionBuffer, concurrentProducerConsumer) {
+  static constexpr int kNrValues = 200000;
+  ThreadsafeIngestionBuffer<int> buffer("test_buffer", 16u);
+  std::thread producer([&buffer]() {
+    for (int i = 0; i < kNrValues; ++i) ASSERT_TRUE(buffer.push(i));
+  });
+  int expected = 0;
+  while (expected < kNrValues) {
+    buffer.drain([&expected](int&& value) { ASSERT_EQ(value, expected++); });
+  }
+  producer.join();
+  EXPECT_TRUE(buffer.empty());
+}
+
+/* ************************************************************************* */
+TEST(testThreadsafeIngestionBuffer, shutdown) {
+  ThreadsafeIngestionBuffer<int> buffer("test_buffer", 4u);
+  EXPECT_TRUE(buffer.push(1));
+  buffer.shutdown();
+  EXPECT_TRUE(buffer.isShutdown());
+  EXPECT_FALSE(buffer.push(2));
+}
+
+}  // namespace VIO
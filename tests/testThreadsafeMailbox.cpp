@@ -0,0 +1,98 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testThreadsafeMailbox.cpp
+ * @brief  test ThreadsafeMailbox
+ * @author Antoni Rosinol
+ */
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/utils/ThreadsafeMailbox.h"
+
+namespace VIO {
+
+/* ************************************************************************* */
+TEST(testThreadsafeMailbox, overwrite) {
+  ThreadsafeMailbox<std::string> mailbox("test_mailbox");
+  std::string msg;
+  EXPECT_FALSE(mailbox.pop(msg));
+
+  EXPECT_TRUE(mailbox.push("first"));
+  EXPECT_TRUE(mailbox.push("second"));
+  EXPECT_TRUE(mailbox.pushBlockingIfFull("third", 1u));
+  EXPECT_TRUE(mailbox.pop(msg));
+  EXPECT_EQ(msg, "third");
+  EXPECT_TRUE(mailbox.empty());
+
+  // Not merged with an already popped value.
+  EXPECT_TRUE(mailbox.push("fourth"));
+  EXPECT_TRUE(mailbox.pop(msg));
+  EXPECT_EQ(msg, "fourth");
+
+  mailbox.shutdown();
+  EXPECT_FALSE(mailbox.push("fifth"));
+}
+
+/* ************************************************************************* */
+TEST(testThreadsafeMailbox, merge) {
+  ThreadsafeMailbox<std::string> mailbox(
+      "test_mailbox",
+      [](std::string stale_value, std::string new_value) {
+        return stale_value + "," + new_value;
+      });
+  EXPECT_TRUE(mailbox.push("a"));
+  EXPECT_TRUE(mailbox.push("b"));
+  EXPECT_TRUE(mailbox.push("c"));
+  std::string msg;
+  EXPECT_TRUE(mailbox.pop(msg));
+  EXPECT_EQ(msg, "a,b,c");
+  EXPECT_TRUE(mailbox.push("d"));
+  EXPECT_TRUE(mailbox.pop(msg));
+  EXPECT_EQ(msg, "d");
+}
+
+/* ************************************************************************* */
+TEST(testThreadsafeMailbox, slowConsumer) {
+  // Counts the values pushed, merged or not, in the popped value.
+  ThreadsafeMailbox<int> mailbox(
+      "test_mailbox",
+      [](int stale_value, int new_value) { return stale_value + new_value; });
+  static constexpr int kNrValues = 1000;
+  std::atomic_bool done(false);
+  std::thread producer([&mailbox, &done]() {
+    for (int i = 0; i < kNrValues; ++i) {
+      // Never blocks, even though the consumer is slower.
+      EXPECT_TRUE(mailbox.push(1));
+    }
+    done = true;
+  });
+
+  int nr_values = 0;
+  int nr_pops = 0;
+  int value = 0;
+  while (!done || !mailbox.empty()) {
+    if (mailbox.popBlockingWithTimeout(value, 10u)) {
+      nr_values += value;
+      ++nr_pops;
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+  producer.join();
+  EXPECT_EQ(nr_values, kNrValues);
+  EXPECT_LE(nr_pops, kNrValues);
+}
+
+}  // namespace VIO
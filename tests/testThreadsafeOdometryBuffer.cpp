@@ -97,4 +97,57 @@ TEST(ThreadsafeOdometryBuffer, getNearestCorrect) {
   }
 }
 
+TEST(ThreadsafeOdometryBuffer, getInterpolatedCorrect) {
+  ThreadsafeOdometryBuffer buffer(-1);
+  gtsam::NavState navstate_result;
+  EXPECT_EQ(QueryResult::DataNotYetAvailable,
+            buffer.getInterpolated(0, &navstate_result));
+
+  buffer.add(10,
+             gtsam::NavState(gtsam::Rot3(),
+                             gtsam::Point3(0.0, 0.0, 10.0),
+                             Eigen::Vector3d::Zero()));
+  buffer.add(20,
+             gtsam::NavState(gtsam::Rot3::Yaw(1.0),
+                             gtsam::Point3(0.0, 0.0, 20.0),
+                             Eigen::Vector3d(2.0, 0.0, 0.0)));
+
+  EXPECT_EQ(QueryResult::DataNeverAvailable,
+            buffer.getInterpolated(9, &navstate_result));
+  EXPECT_EQ(QueryResult::DataNotYetAvailable,
+            buffer.getInterpolated(21, &navstate_result));
+
+  // Exact matches are returned as they are.
+  ASSERT_EQ(QueryResult::DataAvailable,
+            buffer.getInterpolated(20, &navstate_result));
+  EXPECT_NEAR(20.0, navstate_result.t()(2, 0), 1e-9);
+  EXPECT_NEAR(1.0, navstate_result.attitude().yaw(), 1e-9);
+
+  ASSERT_EQ(QueryResult::DataAvailable,
+            buffer.getInterpolated(15, &navstate_result));
+  EXPECT_NEAR(15.0, navstate_result.t()(2, 0), 1e-9);
+  EXPECT_NEAR(0.5, navstate_result.attitude().yaw(), 1e-9);
+  EXPECT_NEAR(1.0, navstate_result.v()(0, 0), 1e-9);
+}
+
+TEST(ThreadsafeOdometryBuffer, getRelativePoseCorrect) {
+  ThreadsafeOdometryBuffer buffer(-1);
+  for (Timestamp t = 0; t <= 40; t += 10) {
+    buffer.add(t,
+               gtsam::NavState(gtsam::Rot3(),
+                               gtsam::Point3(static_cast<double>(t), 0.0, 0.0),
+                               Eigen::Vector3d::Zero()));
+  }
+
+  gtsam::Pose3 from_Pose_to;
+  ASSERT_EQ(QueryResult::DataAvailable,
+            buffer.getRelativePose(5, 35, &from_Pose_to));
+  EXPECT_TRUE(from_Pose_to.equals(
+      gtsam::Pose3(gtsam::Rot3(), gtsam::Point3(30.0, 0.0, 0.0)), 1e-9));
+
+  // Not both poses are available yet.
+  EXPECT_EQ(QueryResult::DataNotYetAvailable,
+            buffer.getRelativePose(5, 45, &from_Pose_to));
+}
+
 }  // namespace VIO
@@ -19,11 +19,14 @@
 #include <thread>
 #include <vector>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
 #include "kimera-vio/utils/ThreadsafeQueue.h"
 
+DECLARE_bool(instrument_queues);
+
 namespace VIO {
 
 void consumer(ThreadsafeQueue<std::string>& q,  // NOLINT
@@ -118,6 +121,66 @@ TEST(testThreadsafeQueue, push) {
   p.join();
 }
 
+/* ************************************************************************* */
+TEST(testThreadsafeQueue, highWaterMark) {
+  ThreadsafeQueue<int> q("test_queue");
+  EXPECT_EQ(q.getHighWaterMark(), 0u);
+  q.push(1);
+  q.push(2);
+  q.push(3);
+  int value;
+  EXPECT_TRUE(q.pop(value));
+  EXPECT_TRUE(q.pop(value));
+  q.pushBlockingIfFull(4, 5u);
+  EXPECT_EQ(q.getHighWaterMark(), 3u);
+  EXPECT_NE(utils::MemoryAccounting::getInstance().print().find("test_queue"),
+            std::string::npos);
+}
+
+/* ************************************************************************* */
+TEST(testThreadsafeQueue, instrumentation) {
+  EXPECT_EQ(ThreadsafeQueue<int>("not_instrumented").getInstrumentation(),
+            nullptr);
+  FLAGS_instrument_queues = true;
+  ThreadsafeQueue<int> q("instrumented_queue");
+  FLAGS_instrument_queues = false;
+  const utils::QueueInstrumentation* instrumentation = q.getInstrumentation();
+  ASSERT_TRUE(instrumentation);
+
+  q.push(1);
+  q.push(2);
+  // Blocks until the consumer pops.
+  std::thread p([&q] { q.pushBlockingIfFull(3, 2u); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  int value;
+  EXPECT_TRUE(q.pop(value));
+  p.join();
+  ThreadsafeQueue<int>::InternalQueue output_queue;
+  EXPECT_TRUE(q.batchPop(&output_queue));
+  // Waits until the producer pushes.
+  std::thread p2([&q] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    q.push(4);
+  });
+  EXPECT_TRUE(q.popBlocking(value));
+  p2.join();
+
+  EXPECT_EQ(instrumentation->getNrPushes(), 4u);
+  EXPECT_EQ(instrumentation->getNrPops(), 4u);
+  EXPECT_EQ(instrumentation->getMaxDepth(), 2u);
+  EXPECT_EQ(utils::Statistics::GetNumSamples("instrumented_queue Depth [#]"),
+            8u);
+  EXPECT_EQ(
+      utils::Statistics::GetLastValue("instrumented_queue Depth [#]"), 0.0);
+  EXPECT_GE(
+      utils::Statistics::GetMax("instrumented_queue Push blocked [ms]"), 25.0);
+  EXPECT_GE(utils::Statistics::GetMax("instrumented_queue Pop wait [ms]"),
+            25.0);
+  EXPECT_GE(
+      utils::Statistics::GetMax("instrumented_queue Time in queue [ms]"),
+      25.0);
+}
+
 /* ************************************************************************* */
 TEST(testThreadsafeQueue, pushBlockingIfFull) {
   // Here we test only its nominal push behavior, not the blocking behavior
@@ -0,0 +1,108 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testThreadsafeRendezvousBuffer.cpp
+ * @brief  test ThreadsafeRendezvousBuffer
+ * @author Antoni Rosinol
+ */
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/utils/ThreadsafeRendezvousBuffer.h"
+
+namespace VIO {
+
+using Buffer = ThreadsafeRendezvousBuffer<std::string>;
+using QueryResult = Buffer::QueryResult;
+
+/* ************************************************************************* */
+TEST(testThreadsafeRendezvousBuffer, popEvictsOlderValues) {
+  Buffer buffer("test_buffer");
+  EXPECT_TRUE(buffer.push(1, "one"));
+  EXPECT_TRUE(buffer.push(2, "two"));
+  EXPECT_TRUE(buffer.push(3, "three"));
+  EXPECT_TRUE(buffer.push(4, "four"));
+
+  std::string value;
+  EXPECT_EQ(buffer.pop(3, &value), QueryResult::kFound);
+  EXPECT_EQ(value, "three");
+  EXPECT_EQ(buffer.size(), 1u);
+
+  // Already evicted.
+  EXPECT_EQ(buffer.pop(2, &value), QueryResult::kMissed);
+  EXPECT_EQ(buffer.size(), 1u);
+  EXPECT_EQ(buffer.pop(4, &value), QueryResult::kFound);
+  EXPECT_EQ(value, "four");
+  EXPECT_TRUE(buffer.empty());
+}
+
+/* ************************************************************************* */
+TEST(testThreadsafeRendezvousBuffer, missedTimestamp) {
+  Buffer buffer("test_buffer");
+  std::string value;
+  // Not pushed yet: nothing is evicted.
+  EXPECT_TRUE(buffer.push(1, "one"));
+  EXPECT_EQ(buffer.pop(2, &value), QueryResult::kMissed);
+  EXPECT_EQ(buffer.size(), 1u);
+
+  // A newer value was pushed: the timestamp will never be found.
+  EXPECT_TRUE(buffer.push(3, "three"));
+  EXPECT_EQ(buffer.popBlockingWithTimeout(
+                2, &value, std::chrono::milliseconds(1000)),
+            QueryResult::kMissed);
+  EXPECT_EQ(buffer.size(), 1u);
+  EXPECT_TRUE(value.empty());
+}
+
+/* ************************************************************************* */
+TEST(testThreadsafeRendezvousBuffer, wakesUpOnArrival) {
+  Buffer buffer("test_buffer");
+  std::thread producer([&buffer]() {
+    for (Timestamp timestamp = 1; timestamp <= 5; ++timestamp) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      buffer.push(timestamp, std::to_string(timestamp));
+    }
+  });
+  std::string value;
+  EXPECT_EQ(buffer.popBlockingWithTimeout(
+                4, &value, std::chrono::milliseconds(10000)),
+            QueryResult::kFound);
+  EXPECT_EQ(value, "4");
+  producer.join();
+  EXPECT_EQ(buffer.size(), 1u);
+}
+
+/* ************************************************************************* */
+TEST(testThreadsafeRendezvousBuffer, timeoutAndShutdown) {
+  Buffer buffer("test_buffer");
+  std::string value;
+  EXPECT_EQ(
+      buffer.popBlockingWithTimeout(1, &value, std::chrono::milliseconds(10)),
+      QueryResult::kTimeout);
+
+  std::thread consumer([&buffer]() {
+    std::string value;
+    EXPECT_EQ(buffer.popBlockingWithTimeout(
+                  1, &value, std::chrono::milliseconds(10000)),
+              QueryResult::kShutdown);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  buffer.shutdown();
+  consumer.join();
+  EXPECT_TRUE(buffer.isShutdown());
+  EXPECT_FALSE(buffer.push(1, "one"));
+  EXPECT_EQ(buffer.pop(1, &value), QueryResult::kShutdown);
+}
+
+}  // namespace VIO
@@ -0,0 +1,161 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testThreadsafeSpscQueue.cpp
+ * @brief  test ThreadsafeSpscQueue
+ * @author Antoni Rosinol
+ */
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/utils/ThreadsafeSpscQueue.h"
+
+namespace VIO {
+
+/* ************************************************************************* */
+TEST(testThreadsafeSpscQueue, capacityIsPowerOfTwo) {
+  ThreadsafeSpscQueue<int> q("test_queue", 5u);
+  EXPECT_EQ(q.capacity(), 8u);
+  EXPECT_TRUE(q.empty());
+  EXPECT_EQ(q.size(), 0u);
+}
+
+/* ************************************************************************* */
+TEST(testThreadsafeSpscQueue, popInOrder) {
+  ThreadsafeSpscQueue<int> q("test_queue", 4u);
+  int value = -1;
+  EXPECT_FALSE(q.pop(value));
+  for (int i = 0; i < 4; ++i) EXPECT_TRUE(q.push(i));
+  EXPECT_EQ(q.size(), 4u);
+  // Wraps around the ring several times.
+  for (int i = 0; i < 20; ++i) {
+    EXPECT_TRUE(q.pop(value));
+    EXPECT_EQ(value, i);
+    EXPECT_TRUE(q.push(i + 4));
+  }
+  std::shared_ptr<int> front = q.popBlocking();
+  ASSERT_TRUE(front);
+  EXPECT_EQ(*front, 20);
+}
+
+/* ************************************************************************* */
+TEST(testThreadsafeSpscQueue, movesUniquePtrs) {
+  ThreadsafeSpscQueue<std::unique_ptr<int>> q("test_queue");
+  EXPECT_TRUE(q.push(std::make_unique<int>(1)));
+  std::unique_ptr<int> value;
+  EXPECT_TRUE(q.popBlocking(value));
+  ASSERT_TRUE(value);
+  EXPECT_EQ(*value, 1);
+  EXPECT_TRUE(q.empty());
+}
+
+/* ************************************************************************* */
+TEST(testThreadsafeSpscQueue, popBlockingWithTimeout) {
+  ThreadsafeSpscQueue<int> q("test_queue");
+  int value = -1;
+  const auto start = std::chrono::steady_clock::now();
+  EXPECT_FALSE(q.popBlockingWithTimeout(value, 50u));
+  EXPECT_GE(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(40));
+  q.push(7);
+  EXPECT_TRUE(q.popBlockingWithTimeout(value, 50u));
+  EXPECT_EQ(value, 7);
+}
+
+/* ************************************************************************* */
+TEST(testThreadsafeSpscQueue, peekDoesNotPop) {
+  ThreadsafeSpscQueue<int> q("test_queue");
+  EXPECT_FALSE(q.peekBlockingWithTimeout(10u));
+  q.push(3);
+  std::shared_ptr<int> front = q.peekBlockingWithTimeout(10u);
+  ASSERT_TRUE(front);
+  EXPECT_EQ(*front, 3);
+  EXPECT_EQ(q.size(), 1u);
+}
+
+/* ************************************************************************* */
+TEST(testThreadsafeSpscQueue, batchPop) {
+  ThreadsafeSpscQueue<int> q("test_queue");
+  ThreadsafeQueueBase<int>::InternalQueue output;
+  EXPECT_FALSE(q.batchPop(&output));
+  for (int i = 0; i < 5; ++i) q.push(i);
+  EXPECT_TRUE(q.batchPop(&output));
+  ASSERT_EQ(output.size(), 5u);
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(*output.front(), i);
+    output.pop();
+  }
+  EXPECT_TRUE(q.empty());
+}
+
+/* ************************************************************************* */
+TEST(testThreadsafeSpscQueue, shutdownUnblocksConsumer) {
+  ThreadsafeSpscQueue<int> q("test_queue");
+  std::atomic_bool returned(false);
+  bool result = true;
+  std::thread consumer([&] {
+    int value;
+    result = q.popBlocking(value);
+    returned = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(returned);
+  q.shutdown();
+  consumer.join();
+  EXPECT_FALSE(result);
+  EXPECT_FALSE(q.push(1));
+  q.resume();
+  EXPECT_TRUE(q.push(1));
+}
+
+/* ************************************************************************* */
+TEST(testThreadsafeSpscQueue, pushBlocksIfFull) {
+  ThreadsafeSpscQueue<int> q("test_queue", 8u);
+  for (int i = 0; i < 2; ++i) EXPECT_TRUE(q.pushBlockingIfFull(i, 2u));
+  std::atomic_bool pushed(false);
+  std::thread producer([&] {
+    q.pushBlockingIfFull(2, 2u);
+    pushed = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(pushed);
+  int value;
+  EXPECT_TRUE(q.pop(value));
+  producer.join();
+  EXPECT_TRUE(pushed);
+  EXPECT_EQ(q.size(), 2u);
+}
+
+/* ************************************************************************* */
+TEST(testThreadsafeSpscQueue, producerConsumer) {
+  ThreadsafeSpscQueue<size_t> q("test_queue", 16u);
+  static constexpr size_t kNrValues = 100000u;
+  std::thread producer([&q] {
+    for (size_t i = 0u; i < kNrValues; ++i) CHECK(q.push(i));
+  });
+  std::vector<size_t> values;
+  values.reserve(kNrValues);
+  size_t value;
+  while (values.size() < kNrValues && q.popBlocking(value)) {
+    values.push_back(value);
+  }
+  producer.join();
+  ASSERT_EQ(values.size(), kNrValues);
+  for (size_t i = 0u; i < kNrValues; ++i) ASSERT_EQ(values[i], i);
+}
+
+}  // namespace VIO
@@ -0,0 +1,259 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testThreadsafeTemporalRingBuffer.cpp
+ * @brief  Unit tests ThreadsafeTemporalRingBuffer class' functionality.
+ * @author Antoni Rosinol
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "kimera-vio/utils/ThreadsafeTemporalRingBuffer.h"
+
+namespace VIO {
+
+namespace utils {
+
+using TestRingBuffer = ThreadsafeTemporalRingBuffer<2>;
+
+class ThreadsafeTemporalRingBufferFixture : public ::testing::Test {
+ public:
+  ThreadsafeTemporalRingBufferFixture()
+      : buffer_(kBufferLengthNs, kInitialCapacity) {}
+
+ protected:
+  //! Values encode their timestamp, to check that they match.
+  static TestRingBuffer::Value valueAt(const Timestamp& timestamp) {
+    return TestRingBuffer::Value(static_cast<double>(timestamp),
+                                 -static_cast<double>(timestamp));
+  }
+
+  bool addValue(const Timestamp& timestamp) {
+    return buffer_.addValue(timestamp, valueAt(timestamp));
+  }
+
+  static constexpr Timestamp kBufferLengthNs = 100;
+  static constexpr size_t kInitialCapacity = 4u;
+  TestRingBuffer buffer_;
+};
+
+TEST_F(ThreadsafeTemporalRingBufferFixture, SizeEmptyClearWork) {
+  EXPECT_TRUE(buffer_.empty());
+  EXPECT_EQ(buffer_.size(), 0u);
+
+  EXPECT_TRUE(addValue(10));
+  EXPECT_TRUE(addValue(20));
+  EXPECT_TRUE(!buffer_.empty());
+  EXPECT_EQ(buffer_.size(), 2u);
+
+  buffer_.clear();
+  EXPECT_TRUE(buffer_.empty());
+  EXPECT_EQ(buffer_.size(), 0u);
+}
+
+TEST_F(ThreadsafeTemporalRingBufferFixture, RejectsNonIncreasingTimestamps) {
+  EXPECT_TRUE(addValue(10));
+  EXPECT_TRUE(addValue(20));
+  EXPECT_FALSE(addValue(20));
+  EXPECT_FALSE(addValue(15));
+  EXPECT_EQ(buffer_.size(), 2u);
+}
+
+TEST_F(ThreadsafeTemporalRingBufferFixture, OldestNewestValueWork) {
+  Timestamp timestamp = 0;
+  TestRingBuffer::Value value;
+  EXPECT_FALSE(buffer_.getOldestValue(&timestamp, &value));
+  EXPECT_FALSE(buffer_.getNewestValue(&timestamp, &value));
+
+  addValue(10);
+  addValue(20);
+  addValue(30);
+  EXPECT_TRUE(buffer_.getOldestValue(&timestamp, &value));
+  EXPECT_EQ(timestamp, 10);
+  EXPECT_EQ(value, valueAt(10));
+  EXPECT_TRUE(buffer_.getNewestValue(&timestamp, &value));
+  EXPECT_EQ(timestamp, 30);
+  EXPECT_EQ(value, valueAt(30));
+}
+
+TEST_F(ThreadsafeTemporalRingBufferFixture, GetValueAtOrBeforeAfterTimeWork) {
+  addValue(10);
+  addValue(20);
+  addValue(30);
+
+  Timestamp timestamp = 0;
+  TestRingBuffer::Value value;
+  EXPECT_TRUE(buffer_.getValueAtOrBeforeTime(20, &timestamp, &value));
+  EXPECT_EQ(timestamp, 20);
+  EXPECT_EQ(value, valueAt(20));
+  EXPECT_TRUE(buffer_.getValueAtOrBeforeTime(25, &timestamp, &value));
+  EXPECT_EQ(timestamp, 20);
+  EXPECT_TRUE(buffer_.getValueAtOrBeforeTime(35, &timestamp, &value));
+  EXPECT_EQ(timestamp, 30);
+  EXPECT_FALSE(buffer_.getValueAtOrBeforeTime(5, &timestamp, &value));
+
+  EXPECT_TRUE(buffer_.getValueAtOrAfterTime(20, &timestamp, &value));
+  EXPECT_EQ(timestamp, 20);
+  EXPECT_TRUE(buffer_.getValueAtOrAfterTime(15, &timestamp, &value));
+  EXPECT_EQ(timestamp, 20);
+  EXPECT_EQ(value, valueAt(20));
+  EXPECT_TRUE(buffer_.getValueAtOrAfterTime(5, &timestamp, &value));
+  EXPECT_EQ(timestamp, 10);
+  EXPECT_FALSE(buffer_.getValueAtOrAfterTime(35, &timestamp, &value));
+}
+
+TEST_F(ThreadsafeTemporalRingBufferFixture, GetValuesBetweenTimesWorks) {
+  addValue(10);
+  addValue(20);
+  addValue(30);
+  addValue(40);
+
+  TestRingBuffer::Stamps stamps;
+  TestRingBuffer::Values values;
+  // Borders are excluded.
+  EXPECT_TRUE(buffer_.getValuesBetweenTimes(10, 40, &stamps, &values));
+  ASSERT_EQ(stamps.cols(), 2);
+  ASSERT_EQ(values.cols(), 2);
+  EXPECT_EQ(stamps(0), 20);
+  EXPECT_EQ(stamps(1), 30);
+  EXPECT_EQ(values.col(0), valueAt(20));
+  EXPECT_EQ(values.col(1), valueAt(30));
+
+  // Unless the lower border is requested.
+  EXPECT_TRUE(buffer_.getValuesBetweenTimes(10, 40, &stamps, &values, true));
+  ASSERT_EQ(stamps.cols(), 3);
+  EXPECT_EQ(stamps(0), 10);
+
+  // Query in between values.
+  EXPECT_TRUE(buffer_.getValuesBetweenTimes(15, 25, &stamps, &values));
+  ASSERT_EQ(stamps.cols(), 1);
+  EXPECT_EQ(stamps(0), 20);
+  EXPECT_TRUE(buffer_.getValuesBetweenTimes(21, 29, &stamps, &values));
+  EXPECT_EQ(stamps.cols(), 0);
+  EXPECT_EQ(values.cols(), 0);
+
+  // Only queries within the buffered interval are accepted.
+  EXPECT_FALSE(buffer_.getValuesBetweenTimes(5, 30, &stamps, &values));
+  EXPECT_FALSE(buffer_.getValuesBetweenTimes(20, 45, &stamps, &values));
+}
+
+TEST_F(ThreadsafeTemporalRingBufferFixture, MaintainsBufferLength) {
+  for (Timestamp timestamp = 0; timestamp <= 150; timestamp += 10) {
+    addValue(timestamp);
+  }
+  // Same as ThreadsafeTemporalBuffer: keeps values within kBufferLengthNs of
+  // the newest one.
+  Timestamp timestamp = 0;
+  TestRingBuffer::Value value;
+  EXPECT_TRUE(buffer_.getOldestValue(&timestamp, &value));
+  EXPECT_EQ(timestamp, 150 - kBufferLengthNs);
+  EXPECT_EQ(value, valueAt(timestamp));
+  EXPECT_EQ(buffer_.size(), 11u);
+}
+
+TEST_F(ThreadsafeTemporalRingBufferFixture, ContiguousWhenWrappingAround) {
+  // Small buffer length: the ring wraps around without growing.
+  TestRingBuffer buffer(30, kInitialCapacity);
+  for (Timestamp timestamp = 0; timestamp <= 1000; timestamp += 10) {
+    ASSERT_TRUE(buffer.addValue(timestamp, valueAt(timestamp)));
+    EXPECT_LE(buffer.size(), kInitialCapacity);
+    if (timestamp < 30) continue;
+    TestRingBuffer::Stamps stamps;
+    TestRingBuffer::Values values;
+    ASSERT_TRUE(buffer.getValuesBetweenTimes(
+        timestamp - 30, timestamp, &stamps, &values, true));
+    ASSERT_EQ(stamps.cols(), 3);
+    for (Eigen::Index i = 0; i < stamps.cols(); ++i) {
+      EXPECT_EQ(stamps(i), timestamp - 30 + 10 * i);
+      EXPECT_EQ(values.col(i), valueAt(stamps(i)));
+    }
+  }
+  EXPECT_EQ(buffer.capacity(), kInitialCapacity);
+}
+
+TEST_F(ThreadsafeTemporalRingBufferFixture, GrowsWhenFull) {
+  // Infinite length: grows while keeping all values in order.
+  TestRingBuffer buffer(-1, kInitialCapacity);
+  for (Timestamp timestamp = 1; timestamp <= 100; ++timestamp) {
+    ASSERT_TRUE(buffer.addValue(timestamp, valueAt(timestamp)));
+  }
+  EXPECT_EQ(buffer.size(), 100u);
+  EXPECT_GE(buffer.capacity(), 100u);
+  size_t nr_visited = 0u;
+  EXPECT_TRUE(buffer.visitValuesBetweenTimes(
+      1,
+      100,
+      [&nr_visited](const auto& stamps, const auto& values) {
+        nr_visited = static_cast<size_t>(stamps.cols());
+        for (Eigen::Index i = 0; i < stamps.cols(); ++i) {
+          EXPECT_EQ(stamps(i), i + 2);
+          EXPECT_EQ(values(0, i), static_cast<double>(i + 2));
+        }
+      }));
+  EXPECT_EQ(nr_visited, 98u);
+}
+
+TEST_F(ThreadsafeTemporalRingBufferFixture, ConcurrentReadsAreConsistent) {
+  // Small initial capacity and finite length: wraps around and grows while
+  // being read.
+  TestRingBuffer buffer(1000, 2u);
+  constexpr Timestamp kNrValues = 200000;
+  std::atomic<bool> done(false);
+  std::atomic<size_t> nr_inconsistent(0u);
+
+  std::vector<std::thread> readers;
+  for (size_t i = 0u; i < 3u; ++i) {
+    readers.emplace_back([&]() {
+      Timestamp timestamp;
+      TestRingBuffer::Value value;
+      TestRingBuffer::Stamps stamps;
+      TestRingBuffer::Values values;
+      while (!done) {
+        if (buffer.getNewestValue(&timestamp, &value)) {
+          if (value != valueAt(timestamp)) ++nr_inconsistent;
+          if (buffer.getValueAtOrBeforeTime(timestamp - 10, &timestamp,
+                                            &value) &&
+              value != valueAt(timestamp)) {
+            ++nr_inconsistent;
+          }
+          if (buffer.getValuesBetweenTimes(
+                  timestamp - 50, timestamp, &stamps, &values, true)) {
+            // All the values in between, in order.
+            if (stamps.cols() != 50) ++nr_inconsistent;
+            for (Eigen::Index j = 0; j < stamps.cols(); ++j) {
+              if (stamps(j) != timestamp - 50 + j ||
+                  values.col(j) != valueAt(stamps(j))) {
+                ++nr_inconsistent;
+              }
+            }
+          }
+        }
+      }
+    });
+  }
+
+  for (Timestamp timestamp = 1; timestamp <= kNrValues; ++timestamp) {
+    ASSERT_TRUE(buffer.addValue(timestamp, valueAt(timestamp)));
+  }
+  done = true;
+  for (std::thread& reader : readers) reader.join();
+
+  EXPECT_EQ(nr_inconsistent, 0u);
+  EXPECT_LE(buffer.size(), 1001u);
+}
+
+}  // namespace utils
+
+}  // namespace VIO
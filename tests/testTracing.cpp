@@ -0,0 +1,119 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testTracing.cpp
+ * @brief  test Tracer and TraceSpan
+ * @author Antoni Rosinol
+ */
+
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/utils/Tracing.h"
+
+namespace VIO {
+
+namespace {
+size_t countOccurrences(const std::string& str, const std::string& pattern) {
+  size_t count = 0u;
+  for (size_t pos = str.find(pattern); pos != std::string::npos;
+       pos = str.find(pattern, pos + pattern.size())) {
+    ++count;
+  }
+  return count;
+}
+}  // namespace
+
+class TracingFixture : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    utils::Tracer::clear();
+    utils::Tracer::enable();
+  }
+  void TearDown() override {
+    utils::Tracer::disable();
+    utils::Tracer::clear();
+  }
+};
+
+/* ************************************************************************** */
+TEST_F(TracingFixture, disabledRecordsNothing) {
+  utils::Tracer::disable();
+  { KIMERA_TRACE_SCOPE("disabled"); }
+  EXPECT_EQ(utils::Tracer::getNumberOfEvents(), 0u);
+}
+
+/* ************************************************************************** */
+TEST_F(TracingFixture, chromeTraceExport) {
+  utils::Tracer::setCurrentThreadName("main \"thread\"");
+  const int64_t kFrameTimestamp = 1403636579763555584;
+  {
+    KIMERA_TRACE_SCOPE_ID("Frontend", kFrameTimestamp);
+    KIMERA_TRACE_SCOPE("Feature detection");
+  }
+  std::thread backend_thread([&kFrameTimestamp]() {
+    KIMERA_TRACE_SCOPE_ID(utils::Tracer::internName("Backend"),
+                          kFrameTimestamp);
+  });
+  backend_thread.join();
+  // Events of joined threads are kept.
+  EXPECT_EQ(utils::Tracer::getNumberOfEvents(), 3u);
+
+  std::stringstream ss;
+  utils::Tracer::writeChromeTrace(ss);
+  const std::string trace = ss.str();
+  EXPECT_EQ(trace.front(), '{');
+  EXPECT_EQ(countOccurrences(trace, "\"ph\":\"X\""), 3u);
+  EXPECT_EQ(countOccurrences(trace, "\"name\":\"Feature detection\""), 1u);
+  EXPECT_EQ(countOccurrences(trace, "\"name\":\"main \\\"thread\\\"\""), 1u);
+  // Correlation ids as strings, and the two spans of the frame linked.
+  EXPECT_EQ(countOccurrences(trace, "\"id\":\"1403636579763555584\""), 4u);
+  EXPECT_EQ(countOccurrences(trace, "\"ph\":\"s\""), 1u);
+  EXPECT_EQ(countOccurrences(trace, "\"ph\":\"f\""), 1u);
+}
+
+/* ************************************************************************** */
+TEST_F(TracingFixture, counterExport) {
+  const int64_t now = utils::Tracer::now();
+  utils::Tracer::recordCounter("Backend queue depth", now, 3.0);
+  utils::Tracer::recordCounter("Backend queue depth", now + 1000, 2.0);
+  EXPECT_EQ(utils::Tracer::getNumberOfEvents(), 2u);
+
+  std::stringstream ss;
+  utils::Tracer::writeChromeTrace(ss);
+  const std::string trace = ss.str();
+  EXPECT_EQ(countOccurrences(trace, "\"ph\":\"C\""), 2u);
+  EXPECT_EQ(countOccurrences(trace, "\"ph\":\"X\""), 0u);
+  EXPECT_EQ(countOccurrences(trace, "\"args\":{\"value\":3.000}"), 1u);
+  EXPECT_EQ(countOccurrences(trace, "\"args\":{\"value\":2.000}"), 1u);
+}
+
+/* ************************************************************************** */
+TEST_F(TracingFixture, ringBufferKeepsLatestEvents) {
+  const size_t kNrEvents = utils::Tracer::kEventsPerThread + 10u;
+  for (size_t i = 0u; i < kNrEvents; ++i) {
+    const int64_t now = utils::Tracer::now();
+    utils::Tracer::record("event", now, now, static_cast<int64_t>(i));
+  }
+  EXPECT_EQ(utils::Tracer::getNumberOfEvents(),
+            utils::Tracer::kEventsPerThread);
+  std::stringstream ss;
+  utils::Tracer::writeChromeTrace(ss);
+  const std::string trace = ss.str();
+  EXPECT_EQ(countOccurrences(trace, "\"id\":\"9\""), 0u);
+  EXPECT_EQ(countOccurrences(trace, "\"id\":\"10\""), 1u);
+  EXPECT_EQ(countOccurrences(trace, "\"ph\":\"X\""),
+            utils::Tracer::kEventsPerThread);
+}
+
+}  // namespace VIO
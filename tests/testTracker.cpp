@@ -21,11 +21,15 @@
 #include <algorithm>
 #include <cstdlib>
 #include <iostream>
+#include <map>
 #include <random>
+#include <set>
 
 #include "kimera-vio/frontend/Camera.h"
 #include "kimera-vio/frontend/CameraParams.h"
 #include "kimera-vio/frontend/Frame.h"
+#include "kimera-vio/frontend/GpuSparseOpticalFlow.h"
+#include "kimera-vio/frontend/ParallelRansac.h"
 #include "kimera-vio/frontend/StereoFrame.h"
 #include "kimera-vio/frontend/StereoMatcher.h"
 #include "kimera-vio/frontend/Tracker-definitions.h"
@@ -894,6 +898,54 @@ TEST_F(TestTracker, geometricOutlierRejection2d2dGivenRotation) {
   }
 }
 
+/* ************************************************************************* */
+TEST_F(TestTracker, geometricOutlierRejection2d2dFastPathFallback) {
+  TrackerParams tracker_params = TrackerParams();
+  tracker_params.ransac_randomize_ = false;
+  tracker_params.ransac_use_2point_mono_ = true;
+  tracker_params.ransac_use_2point_fast_path_ = true;
+  Tracker tracker(tracker_params, stereo_camera_->getOriginalLeftCamera());
+
+  const Pose3 camRef_pose_camCur(Rot3::Expmap(Vector3(0.1, -0.1, 0.2)),
+                                 Vector3(1, 0, 0));
+  vector<double> depth_range;
+  depth_range.push_back(camRef_pose_camCur.translation().norm());
+  depth_range.push_back(10 * camRef_pose_camCur.translation().norm());
+
+  // Consistent rotation prior: 2-point RANSAC is enough.
+  ClearFrame(ref_frame.get());
+  ClearFrame(cur_frame.get());
+  AddNonPlanarInliersToFrame(ref_frame.get(),
+                             cur_frame.get(),
+                             camRef_pose_camCur,
+                             depth_range,
+                             80);
+  TrackingStatusPose status_pose = tracker.geometricOutlierRejection2d2d(
+      ref_frame.get(), cur_frame.get(), camRef_pose_camCur);
+  EXPECT_EQ(status_pose.first, TrackingStatus::VALID);
+  EXPECT_EQ(tracker.debug_info_.nrMono2PointRansacs_, 1u);
+  EXPECT_EQ(tracker.debug_info_.nrMono2PointFallbacks_, 0u);
+
+  // Wrong rotation prior: falls back to 5-point RANSAC, which recovers the
+  // rotation.
+  ClearFrame(ref_frame.get());
+  ClearFrame(cur_frame.get());
+  AddNonPlanarInliersToFrame(ref_frame.get(),
+                             cur_frame.get(),
+                             camRef_pose_camCur,
+                             depth_range,
+                             80);
+  status_pose = tracker.geometricOutlierRejection2d2d(
+      ref_frame.get(),
+      cur_frame.get(),
+      Pose3(Rot3(), camRef_pose_camCur.translation()));
+  EXPECT_EQ(status_pose.first, TrackingStatus::VALID);
+  EXPECT_EQ(tracker.debug_info_.nrMono2PointRansacs_, 2u);
+  EXPECT_EQ(tracker.debug_info_.nrMono2PointFallbacks_, 1u);
+  EXPECT_TRUE(status_pose.second.rotation().equals(
+      camRef_pose_camCur.rotation(), 1e-3));
+}
+
 /* ************************************************************************* */
 TEST_F(TestTracker, geometricOutlierRejection3d3d) {
   // Start with the simplest case:
@@ -1232,6 +1284,59 @@ TEST_F(TestTracker, getPoint3AndCovariance) {
   // cout << "cov_ref_i_expected \n" << cov_ref_i_expected << endl;
 }
 
+/* ************************************************************************* */
+TEST_F(TestTracker, getPoints3AndCovariances) {
+  ClearStereoFrame(ref_stereo_frame.get());
+  VIO::StereoCamera ref_stereo_camera(
+      ref_stereo_frame->left_frame_.cam_param_,
+      ref_stereo_frame->right_frame_.cam_param_);
+  gtsam::StereoCamera stereoCam =
+      gtsam::StereoCamera(gtsam::Pose3(), ref_stereo_camera.getStereoCalib());
+
+  // A few stereo points with different disparities.
+  for (int i = 0; i < 5; i++) {
+    const double xL = 100.0 + 30.0 * i;
+    const double v = 80.0 + 20.0 * i;
+    const double xR = xL - 5.0 - 3.0 * i;
+    ref_stereo_frame->left_keypoints_rectified_.push_back(
+        StatusKeypointCV(KeypointStatus::VALID, KeypointCV(xL, v)));
+    ref_stereo_frame->right_keypoints_rectified_.push_back(
+        StatusKeypointCV(KeypointStatus::VALID, KeypointCV(xR, v)));
+    ref_stereo_frame->keypoints_3d_.push_back(
+        stereoCam.backproject2(StereoPoint2(xL, xR, v)));
+  }
+  const Matrix3 stereoPtCov = Matrix3::Identity();
+  const Matrix3 R = gtsam::Rot3::Ypr(0.1, -0.2, 0.3).matrix();
+  const std::vector<size_t> point_ids = {4u, 0u, 2u};
+
+  // Same as the per-point version, with and without rotation.
+  for (const std::optional<gtsam::Matrix3>& Rmat :
+       {std::optional<gtsam::Matrix3>(), std::optional<gtsam::Matrix3>(R)}) {
+    Vectors3 points;
+    Matrices3 covariances;
+    Tracker::getPoints3AndCovariances(
+        ref_stereo_frame->left_keypoints_rectified_,
+        ref_stereo_frame->right_keypoints_rectified_,
+        ref_stereo_frame->keypoints_3d_,
+        stereoCam,
+        point_ids,
+        stereoPtCov,
+        Rmat,
+        &points,
+        &covariances);
+    ASSERT_EQ(points.size(), point_ids.size());
+    ASSERT_EQ(covariances.size(), point_ids.size());
+    for (size_t i = 0; i < point_ids.size(); i++) {
+      Vector3 point_expected;
+      Matrix3 cov_expected;
+      tie(point_expected, cov_expected) = Tracker::getPoint3AndCovariance(
+          *ref_stereo_frame, stereoCam, point_ids[i], stereoPtCov, Rmat);
+      EXPECT_TRUE(assert_equal(point_expected, points[i], 1e-9));
+      EXPECT_TRUE(assert_equal(cov_expected, covariances[i], 1e-6));
+    }
+  }
+}
+
 /* ************************************************************************* */
 TEST_F(TestTracker, findOutliers) {
   // Normal case:
@@ -1382,6 +1487,27 @@ TEST_F(TestTracker, FindMatchingKeypoints) {
   }
 }
 
+/* ************************************************************************* */
+TEST_F(TestTracker, FindMatchingKeypointsInCurOrder) {
+  ClearFrame(ref_frame.get());
+  ClearFrame(cur_frame.get());
+
+  // Tracked landmarks keep their order, and new ones have larger ids.
+  ref_frame->landmarks_ = {0, 2, -1, 5, 7, 9};
+  cur_frame->landmarks_ = {2, -1, 5, 9, 10, 11};
+
+  KeypointMatches matches_ref_cur;
+  Tracker::findMatchingKeypoints(*ref_frame, *cur_frame, &matches_ref_cur);
+  const KeypointMatches expected = {{1, 0}, {3, 2}, {5, 3}};
+  EXPECT_EQ(matches_ref_cur, expected);
+
+  // Unsorted landmarks give the same matches, in the order of cur_frame.
+  cur_frame->landmarks_ = {9, 11, -1, 2, 10, 5};
+  Tracker::findMatchingKeypoints(*ref_frame, *cur_frame, &matches_ref_cur);
+  const KeypointMatches expected_unsorted = {{5, 0}, {1, 3}, {3, 5}};
+  EXPECT_EQ(matches_ref_cur, expected_unsorted);
+}
+
 /* ************************************************************************* */
 TEST_F(TestTracker, FindMatchingStereoKeypoints) {
   // Synthesize the data for test!
@@ -1590,6 +1716,230 @@ TEST_F(TestTracker, FeatureTrackingNoOpticalFlowPredictionLargeRot) {
 TEST_F(TestTracker,
        FeatureTrackingRotationalOpticalFlowPredictionWithLargeRot) {}
 
+TEST_F(TestTracker, FeatureTrackingSkipsInvalidAndOldTracks) {
+  FeatureDetectorParams feature_detector_params;
+  FeatureDetector feature_detector(feature_detector_params);
+  feature_detector.featureDetection(ref_frame.get());
+  const size_t n_ref_kpts = ref_frame->keypoints_.size();
+  ASSERT_GT(n_ref_kpts, 10u);
+
+  // Invalidate some keypoints and make others too old to be tracked.
+  std::set<LandmarkId> invalid_lmks, old_lmks;
+  for (size_t i = 0u; i < n_ref_kpts; i += 5u) {
+    invalid_lmks.insert(ref_frame->landmarks_[i]);
+    ref_frame->landmarks_[i] = -1;
+  }
+  for (size_t i = 1u; i < n_ref_kpts; i += 5u) {
+    old_lmks.insert(ref_frame->landmarks_[i]);
+    ref_frame->landmarks_age_[i] = tracker_params_.max_feature_track_age_ + 1u;
+  }
+
+  tracker_->featureTracking(
+      ref_frame.get(), cur_frame.get(), gtsam::Rot3(), feature_detector_params);
+
+  // Current frame vectors are consistent and only contain tracked landmarks.
+  const size_t n_cur_kpts = cur_frame->keypoints_.size();
+  EXPECT_GT(n_cur_kpts, 0u);
+  EXPECT_LE(n_cur_kpts, n_ref_kpts - invalid_lmks.size() - old_lmks.size());
+  EXPECT_EQ(cur_frame->landmarks_.size(), n_cur_kpts);
+  EXPECT_EQ(cur_frame->landmarks_age_.size(), n_cur_kpts);
+  EXPECT_EQ(cur_frame->scores_.size(), n_cur_kpts);
+  EXPECT_EQ(cur_frame->versors_.size(), n_cur_kpts);
+  for (const LandmarkId& lmk_id : cur_frame->landmarks_) {
+    EXPECT_NE(lmk_id, -1);
+    EXPECT_EQ(invalid_lmks.count(lmk_id), 0u);
+    EXPECT_EQ(old_lmks.count(lmk_id), 0u);
+  }
+  // Too old tracks are marked off in the reference frame.
+  for (size_t i = 1u; i < n_ref_kpts; i += 5u) {
+    EXPECT_EQ(ref_frame->landmarks_[i], -1);
+  }
+}
+
+TEST_F(TestTracker, FeatureTrackingWithPrebuiltPyramid) {
+  FeatureDetectorParams feature_detector_params;
+  FeatureDetector feature_detector(feature_detector_params);
+  feature_detector.featureDetection(ref_frame.get());
+  ASSERT_GT(ref_frame->keypoints_.size(), 10u);
+  Frame ref_frame_copy = *ref_frame;
+  Frame cur_frame_copy = *cur_frame;
+
+  // Lazily built pyramid.
+  tracker_->featureTracking(
+      ref_frame.get(), cur_frame.get(), gtsam::Rot3(), feature_detector_params);
+
+  // Pyramid built beforehand, e.g. while preintegrating the IMU.
+  tracker_->buildOpticalFlowPyramid(cur_frame_copy);
+  EXPECT_TRUE(cur_frame_copy.hasOpticalFlowPyramid());
+  tracker_->featureTracking(&ref_frame_copy,
+                            &cur_frame_copy,
+                            gtsam::Rot3(),
+                            feature_detector_params);
+
+  ASSERT_EQ(cur_frame_copy.keypoints_.size(), cur_frame->keypoints_.size());
+  for (size_t i = 0u; i < cur_frame->keypoints_.size(); ++i) {
+    EXPECT_EQ(cur_frame_copy.keypoints_[i], cur_frame->keypoints_[i]);
+    EXPECT_EQ(cur_frame_copy.landmarks_[i], cur_frame->landmarks_[i]);
+  }
+}
+
+TEST_F(TestTracker, FeatureTrackingWithoutVersors) {
+  FeatureDetectorParams feature_detector_params;
+  FeatureDetector feature_detector(feature_detector_params);
+  feature_detector.featureDetection(ref_frame.get());
+  ASSERT_GT(ref_frame->keypoints_.size(), 10u);
+  Frame ref_frame_copy = *ref_frame;
+  Frame cur_frame_copy = *cur_frame;
+
+  tracker_->featureTracking(
+      ref_frame.get(), cur_frame.get(), gtsam::Rot3(), feature_detector_params);
+  // As for the intermediate frames of a keyframe only processing frontend.
+  tracker_->featureTracking(&ref_frame_copy,
+                            &cur_frame_copy,
+                            gtsam::Rot3(),
+                            feature_detector_params,
+                            std::nullopt,
+                            std::nullopt,
+                            std::vector<double>(),
+                            false);
+
+  // Same tracks, but no versors.
+  EXPECT_TRUE(cur_frame_copy.versors_.empty());
+  ASSERT_EQ(cur_frame_copy.keypoints_.size(), cur_frame->keypoints_.size());
+  for (size_t i = 0u; i < cur_frame->keypoints_.size(); ++i) {
+    EXPECT_EQ(cur_frame_copy.keypoints_[i], cur_frame->keypoints_[i]);
+    EXPECT_EQ(cur_frame_copy.landmarks_[i], cur_frame->landmarks_[i]);
+  }
+
+  // Computed afterwards, if the frame becomes a keyframe.
+  UndistorterRectifier::GetBearingVectors(cur_frame_copy.keypoints_,
+                                          cur_frame_copy.cam_param_,
+                                          &cur_frame_copy.versors_);
+  ASSERT_EQ(cur_frame_copy.versors_.size(), cur_frame->versors_.size());
+  for (size_t i = 0u; i < cur_frame->versors_.size(); ++i) {
+    EXPECT_TRUE(gtsam::assert_equal(cur_frame->versors_[i],
+                                    cur_frame_copy.versors_[i]));
+  }
+}
+
+TEST_F(TestTracker, FeatureTrackingCuda) {
+  if (!GpuSparseOpticalFlow::isAvailable()) {
+    LOG(WARNING) << "No CUDA optical flow available, skipping test.";
+    return;
+  }
+  FeatureDetectorParams feature_detector_params;
+  FeatureDetector feature_detector(feature_detector_params);
+  feature_detector.featureDetection(ref_frame.get());
+  ASSERT_GT(ref_frame->keypoints_.size(), 10u);
+  Frame ref_frame_copy = *ref_frame;
+  Frame cur_frame_copy = *cur_frame;
+
+  tracker_->featureTracking(
+      ref_frame.get(), cur_frame.get(), gtsam::Rot3(), feature_detector_params);
+
+  TrackerParams gpu_tracker_params = tracker_params_;
+  gpu_tracker_params.klt_use_cuda_ = true;
+  Tracker gpu_tracker(gpu_tracker_params,
+                      stereo_camera_->getOriginalLeftCamera());
+  // The current image is uploaded beforehand, the reference one on demand.
+  gpu_tracker.buildOpticalFlowPyramid(cur_frame_copy);
+  EXPECT_FALSE(cur_frame_copy.hasOpticalFlowPyramid());
+  gpu_tracker.featureTracking(&ref_frame_copy,
+                              &cur_frame_copy,
+                              gtsam::Rot3(),
+                              feature_detector_params);
+
+  // Both KLTs track (almost) the same features to (almost) the same pixels.
+  std::map<LandmarkId, KeypointCV> cpu_tracks;
+  for (size_t i = 0u; i < cur_frame->keypoints_.size(); ++i) {
+    cpu_tracks[cur_frame->landmarks_[i]] = cur_frame->keypoints_[i];
+  }
+  size_t nr_matching_tracks = 0u;
+  for (size_t i = 0u; i < cur_frame_copy.keypoints_.size(); ++i) {
+    const auto it = cpu_tracks.find(cur_frame_copy.landmarks_[i]);
+    if (it == cpu_tracks.end()) continue;
+    if (cv::norm(it->second - cur_frame_copy.keypoints_[i]) < 0.5) {
+      ++nr_matching_tracks;
+    }
+  }
+  EXPECT_GT(nr_matching_tracks, 0.9 * cur_frame->keypoints_.size());
+}
+
+TEST_F(TestTracker, FeatureTrackingFixedWindowKernel) {
+  FeatureDetectorParams feature_detector_params;
+  FeatureDetector feature_detector(feature_detector_params);
+  feature_detector.featureDetection(ref_frame.get());
+  ASSERT_GT(ref_frame->keypoints_.size(), 10u);
+  Frame ref_frame_copy = *ref_frame;
+  Frame cur_frame_copy = *cur_frame;
+
+  tracker_->featureTracking(
+      ref_frame.get(), cur_frame.get(), gtsam::Rot3(), feature_detector_params);
+
+  TrackerParams fixed_window_tracker_params = tracker_params_;
+  fixed_window_tracker_params.klt_use_fixed_window_kernel_ = true;
+  ASSERT_TRUE(
+      FixedWindowKlt::isSupported(fixed_window_tracker_params.klt_win_size_));
+  Tracker fixed_window_tracker(fixed_window_tracker_params,
+                               stereo_camera_->getOriginalLeftCamera());
+  fixed_window_tracker.buildOpticalFlowPyramid(cur_frame_copy);
+  EXPECT_TRUE(cur_frame_copy.hasOpticalFlowPyramid());
+  fixed_window_tracker.featureTracking(&ref_frame_copy,
+                                       &cur_frame_copy,
+                                       gtsam::Rot3(),
+                                       feature_detector_params);
+  EXPECT_FALSE(ref_frame_copy.hasOpticalFlowPyramid());
+
+  // Same algorithm as OpenCV's KLT: (almost) the same tracks.
+  std::map<LandmarkId, KeypointCV> cv_tracks;
+  for (size_t i = 0u; i < cur_frame->keypoints_.size(); ++i) {
+    cv_tracks[cur_frame->landmarks_[i]] = cur_frame->keypoints_[i];
+  }
+  size_t nr_matching_tracks = 0u;
+  for (size_t i = 0u; i < cur_frame_copy.keypoints_.size(); ++i) {
+    const auto it = cv_tracks.find(cur_frame_copy.landmarks_[i]);
+    if (it == cv_tracks.end()) continue;
+    if (cv::norm(it->second - cur_frame_copy.keypoints_[i]) < 0.1) {
+      ++nr_matching_tracks;
+    }
+  }
+  EXPECT_GT(nr_matching_tracks, 0.95 * cur_frame->keypoints_.size());
+}
+
+TEST_F(TestTracker, ParallelRansac3d3dFindsInliers) {
+  // Two point clouds related by a rigid transformation, with 30% outliers.
+  const gtsam::Pose3 pose(gtsam::Rot3::Ypr(0.1, -0.2, 0.05),
+                          gtsam::Point3(0.3, -0.1, 0.2));
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<double> coord(-5.0, 5.0);
+  opengv::points_t f_ref, f_cur;
+  std::set<int> expected_inliers;
+  for (int i = 0; i < 200; ++i) {
+    const gtsam::Point3 p_cur(coord(rng), coord(rng), coord(rng) + 10.0);
+    f_cur.push_back(p_cur);
+    if (i % 10 < 3) {
+      f_ref.push_back(
+          gtsam::Point3(coord(rng), coord(rng), coord(rng) + 10.0));
+    } else {
+      f_ref.push_back(pose.transformFrom(p_cur));
+      expected_inliers.insert(i);
+    }
+  }
+  Adapter3d3d adapter(f_ref, f_cur);
+
+  for (const int& block_size : {0, 20}) {
+    ParallelRansac<Problem3d3d> ransac(500, 0.01, 0.995, 16, block_size);
+    ransac.sac_model_ = std::make_shared<Problem3d3d>(adapter, false);
+    ASSERT_TRUE(ransac.computeModel());
+    const std::set<int> inliers(ransac.inliers_.begin(),
+                                ransac.inliers_.end());
+    EXPECT_EQ(inliers, expected_inliers);
+    EXPECT_LE(ransac.iterations_, 500);
+    EXPECT_TRUE(UtilsOpenCV::openGvTfToGtsamPose3(ransac.model_coefficients_)
+                    .equals(pose, 1e-6));
+  }
+}
+
 // TODO(Toni): copy of the function from PR 420
 void getBearingVectorFromUndistortedKeypoint(
     const KeypointCV& undistorted_keypoint,
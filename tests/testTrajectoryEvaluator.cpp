@@ -0,0 +1,141 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testTrajectoryEvaluator.cpp
+ * @brief  test TrajectoryEvaluator
+ * @author Antoni Rosinol
+ */
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include <gtsam/geometry/Pose3.h>
+
+#include "kimera-vio/logging/TrajectoryEvaluator.h"
+
+namespace VIO {
+
+namespace {
+//! Helix of 10s sampled at 10Hz, turning about the vertical axis.
+std::vector<gtsam::Pose3> makeTrajectory() {
+  std::vector<gtsam::Pose3> poses;
+  for (size_t i = 0u; i <= 100u; ++i) {
+    const double t = 0.1 * i;
+    poses.push_back(
+        gtsam::Pose3(gtsam::Rot3::Ypr(0.3 * t, 0.1 * std::sin(t), 0.0),
+                     gtsam::Point3(2.0 * std::cos(t), 2.0 * std::sin(t), t)));
+  }
+  return poses;
+}
+
+Timestamp timestampAt(const size_t& i) {
+  return static_cast<Timestamp>(i) * 100000000;
+}
+
+TrajectoryEvaluator::GroundTruthCallback noGroundTruth() {
+  return [](const Timestamp&, gtsam::Pose3*) { return false; };
+}
+}  // namespace
+
+TEST(TrajectoryEvaluator, RigidlyTransformedTrajectoryHasNoError) {
+  const std::vector<gtsam::Pose3> gt_poses = makeTrajectory();
+  const gtsam::Pose3 gt_Pose_W(gtsam::Rot3::Ypr(0.5, -0.2, 0.1),
+                               gtsam::Point3(10.0, -3.0, 1.0));
+  TrajectoryEvaluator evaluator(noGroundTruth(), 1.0);
+  for (size_t i = 0u; i < gt_poses.size(); ++i) {
+    evaluator.addPose(
+        timestampAt(i), gt_Pose_W.inverse() * gt_poses[i], gt_poses[i]);
+  }
+  EXPECT_EQ(evaluator.getNrPoses(), gt_poses.size());
+  // Poses 10 to 100 have a pose 1s older.
+  EXPECT_EQ(evaluator.getNrRpePairs(), 91u);
+
+  gtsam::Pose3 alignment;
+  double scale = 0.0;
+  EXPECT_NEAR(evaluator.getAteRmse(&alignment, &scale), 0.0, 1e-6);
+  EXPECT_TRUE(alignment.equals(gt_Pose_W, 1e-6));
+  EXPECT_DOUBLE_EQ(scale, 1.0);
+  EXPECT_NEAR(evaluator.getRpeTranslationRmse(), 0.0, 1e-9);
+  EXPECT_NEAR(evaluator.getRpeRotationRmse(), 0.0, 1e-6);
+}
+
+TEST(TrajectoryEvaluator, AteMatchesAlignedResiduals) {
+  const std::vector<gtsam::Pose3> gt_poses = makeTrajectory();
+  std::vector<gtsam::Pose3> poses;
+  TrajectoryEvaluator evaluator(noGroundTruth());
+  for (size_t i = 0u; i < gt_poses.size(); ++i) {
+    // Deterministic, non-rigid perturbation.
+    const gtsam::Point3 noise(0.05 * std::sin(3.0 * i),
+                              0.05 * std::cos(5.0 * i),
+                              0.02 * std::sin(7.0 * i));
+    poses.push_back(gtsam::Pose3(gt_poses[i].rotation(),
+                                 gt_poses[i].translation() + noise));
+    evaluator.addPose(timestampAt(i), poses.back(), gt_poses[i]);
+  }
+
+  gtsam::Pose3 alignment;
+  const double ate_rmse = evaluator.getAteRmse(&alignment);
+  double sum_sq = 0.0;
+  for (size_t i = 0u; i < poses.size(); ++i) {
+    sum_sq += (gt_poses[i].translation() -
+               alignment.transformFrom(poses[i].translation()))
+                  .squaredNorm();
+  }
+  EXPECT_GT(ate_rmse, 0.01);
+  EXPECT_NEAR(ate_rmse, std::sqrt(sum_sq / poses.size()), 1e-9);
+}
+
+TEST(TrajectoryEvaluator, ScaleIsOnlyAlignedIfRequested) {
+  const std::vector<gtsam::Pose3> gt_poses = makeTrajectory();
+  TrajectoryEvaluator rigid_evaluator(noGroundTruth());
+  TrajectoryEvaluator similarity_evaluator(noGroundTruth(), 1.0, true);
+  for (size_t i = 0u; i < gt_poses.size(); ++i) {
+    const gtsam::Pose3 pose(gt_poses[i].rotation(),
+                            0.5 * gt_poses[i].translation());
+    rigid_evaluator.addPose(timestampAt(i), pose, gt_poses[i]);
+    similarity_evaluator.addPose(timestampAt(i), pose, gt_poses[i]);
+  }
+  EXPECT_GT(rigid_evaluator.getAteRmse(), 0.5);
+  double scale = 0.0;
+  EXPECT_NEAR(similarity_evaluator.getAteRmse(nullptr, &scale), 0.0, 1e-6);
+  EXPECT_NEAR(scale, 2.0, 1e-9);
+}
+
+TEST(TrajectoryEvaluator, RpeOfScaleDrift) {
+  // 10% too fast along a straight line, at 1m/s.
+  TrajectoryEvaluator evaluator(noGroundTruth(), 1.0);
+  for (size_t i = 0u; i <= 50u; ++i) {
+    const double t = 0.1 * i;
+    const gtsam::Pose3 gt_pose(gtsam::Rot3(), gtsam::Point3(t, 0.0, 0.0));
+    const gtsam::Pose3 pose(gtsam::Rot3(), 1.1 * gt_pose.translation());
+    evaluator.addPose(timestampAt(i), pose, gt_pose);
+  }
+  EXPECT_EQ(evaluator.getNrRpePairs(), 41u);
+  EXPECT_NEAR(evaluator.getRpeTranslationRmse(), 0.1, 1e-9);
+  EXPECT_NEAR(evaluator.getRpeRotationRmse(), 0.0, 1e-9);
+}
+
+TEST(TrajectoryEvaluator, PosesWithoutGroundTruthAreIgnored) {
+  TrajectoryEvaluator evaluator(
+      [](const Timestamp& timestamp, gtsam::Pose3* pose) {
+        if (timestamp < timestampAt(5u)) return false;
+        *pose = gtsam::Pose3();
+        return true;
+      });
+  for (size_t i = 0u; i < 10u; ++i) {
+    EXPECT_EQ(evaluator.addPose(timestampAt(i), gtsam::Pose3()), i >= 5u);
+  }
+  EXPECT_EQ(evaluator.getNrPoses(), 5u);
+  EXPECT_EQ(evaluator.getAteRmse(), 0.0);
+}
+
+}  // namespace VIO
@@ -28,6 +28,7 @@
 #include "kimera-vio/frontend/VisionImuFrontendParams.h"
 
 DECLARE_string(test_data_path);
+DECLARE_bool(undistort_rectify_fixed_point_maps);
 
 static const std::string stereo_FLAGS_test_data_path(
     FLAGS_test_data_path + std::string("/ForStereoFrame/"));
@@ -84,6 +85,46 @@ TEST_F(UndistortRectifierFixture, unidstortRectifyImage) {
   // TODO(marcus): implement
 }
 
+TEST_F(UndistortRectifierFixture, undistortRectifyImageFixedPointMaps) {
+  const cv::Mat img = VIO::UtilsOpenCV::ReadAndConvertToGrayScale(
+      stereo_FLAGS_test_data_path + left_image_name);
+  cv::Mat float_rectified;
+  undistorter_rectifier->undistortRectifyImage(img, &float_rectified);
+
+  FLAGS_undistort_rectify_fixed_point_maps = true;
+  VIO::UndistorterRectifier fixed_point_undistorter_rectifier(
+      stereo_camera->getP1(), cam_params_left, stereo_camera->getR1());
+  FLAGS_undistort_rectify_fixed_point_maps = false;
+  cv::Mat fixed_rectified;
+  fixed_point_undistorter_rectifier.undistortRectifyImage(img,
+                                                          &fixed_rectified);
+
+  // Fixed-point interpolation is accurate up to 1/32 of pixel.
+  ASSERT_EQ(float_rectified.size(), fixed_rectified.size());
+  cv::Mat diff;
+  cv::absdiff(float_rectified, fixed_rectified, diff);
+  double max_diff = 0.0;
+  cv::minMaxLoc(diff, nullptr, &max_diff);
+  EXPECT_LE(max_diff, 8.0);
+  EXPECT_LT(cv::mean(diff)[0], 1.0);
+}
+
+TEST_F(UndistortRectifierFixture, undistortRectifyImageRoi) {
+  const cv::Mat img = VIO::UtilsOpenCV::ReadAndConvertToGrayScale(
+      stereo_FLAGS_test_data_path + left_image_name);
+  cv::Mat full_rectified;
+  undistorter_rectifier->undistortRectifyImage(img, &full_rectified);
+
+  const cv::Rect roi(0, 100, img.cols, 40);
+  cv::Mat roi_rectified;
+  undistorter_rectifier->undistortRectifyImage(img, roi, &roi_rectified);
+  ASSERT_EQ(roi_rectified.size(), img.size());
+  EXPECT_TRUE(VIO::UtilsOpenCV::compareCvMatsUpToTol(full_rectified(roi),
+                                                     roi_rectified(roi)));
+  // Outside the roi nothing is computed.
+  EXPECT_EQ(cv::countNonZero(roi_rectified.rowRange(0, roi.y)), 0);
+}
+
 TEST_F(UndistortRectifierFixture, undistortRectifyKeypoints) {
   CHECK(undistorter_rectifier);
 
@@ -144,6 +185,28 @@ TEST_F(UndistortRectifierFixture, undistortRectifyKeypoints) {
   }
 }
 
+TEST_F(UndistortRectifierFixture, getBearingVectorsMatchesSingleKeypoint) {
+  VIO::KeypointsCV keypoints;
+  GeneratePointGrid(6, 8, cam_params_left.image_size_.height,
+                    cam_params_left.image_size_.width, &keypoints);
+
+  VIO::BearingVectors bearing_vectors;
+  VIO::UndistorterRectifier::GetBearingVectors(
+      keypoints, cam_params_left, &bearing_vectors, stereo_camera->getR1());
+  ASSERT_EQ(bearing_vectors.size(), keypoints.size());
+  for (size_t i = 0u; i < keypoints.size(); ++i) {
+    const gtsam::Vector3 expected = VIO::UndistorterRectifier::GetBearingVector(
+        keypoints[i], cam_params_left, stereo_camera->getR1());
+    EXPECT_NEAR(bearing_vectors[i].norm(), 1.0, 1e-9);
+    EXPECT_TRUE(gtsam::assert_equal(expected, bearing_vectors[i], 1e-9));
+  }
+
+  // Empty input gives empty output.
+  VIO::UndistorterRectifier::GetBearingVectors(
+      VIO::KeypointsCV(), cam_params_left, &bearing_vectors);
+  EXPECT_TRUE(bearing_vectors.empty());
+}
+
 TEST_F(UndistortRectifierFixture, checkUndistortedRectifiedLeftKeypoints) {
   CHECK(undistorter_rectifier);
   // TODO(marcus): implement
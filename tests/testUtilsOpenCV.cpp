@@ -598,3 +598,25 @@ TEST_F(UtilsOpenCVFixture, ImageLaplacian) {
   // cv::imshow("actual",actual);
   // cv::waitKey(100);
 }
+
+/* ************************************************************************** */
+TEST(testUtilsOpenCV, CopyForDrawingDoesNotShareTheImage) {
+  const cv::Mat gray(4, 6, CV_8UC1, cv::Scalar(7));
+  cv::Mat gray_copy = UtilsOpenCV::CopyForDrawing(gray);
+  ASSERT_EQ(gray_copy.type(), CV_8UC3);
+  EXPECT_EQ(gray_copy.at<cv::Vec3b>(1, 2), cv::Vec3b(7, 7, 7));
+  gray_copy.setTo(cv::Scalar(0, 255, 0));
+  EXPECT_EQ(cv::countNonZero(gray != 7), 0);
+
+  const cv::Mat color(4, 6, CV_8UC3, cv::Scalar(1, 2, 3));
+  cv::Mat color_copy = UtilsOpenCV::CopyForDrawing(color);
+  ASSERT_EQ(color_copy.type(), CV_8UC3);
+  EXPECT_NE(color_copy.data, color.data);
+  EXPECT_EQ(color_copy.at<cv::Vec3b>(3, 5), cv::Vec3b(1, 2, 3));
+
+  // Gray and color images side by side.
+  const cv::Mat dual_img = UtilsOpenCV::concatenateTwoImages(gray, color);
+  ASSERT_EQ(dual_img.size(), cv::Size(12, 4));
+  EXPECT_EQ(dual_img.at<cv::Vec3b>(2, 5), cv::Vec3b(7, 7, 7));
+  EXPECT_EQ(dual_img.at<cv::Vec3b>(2, 6), cv::Vec3b(1, 2, 3));
+}
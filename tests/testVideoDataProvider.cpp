@@ -0,0 +1,144 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testVideoDataProvider.cpp
+ * @brief  test VideoDataProvider
+ * @author Antoni Rosinol
+ */
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/videoio.hpp>
+
+#include "kimera-vio/dataprovider/VideoDataProvider.h"
+#include "kimera-vio/frontend/Frame.h"
+#include "kimera-vio/pipeline/Pipeline-definitions.h"
+
+DECLARE_string(test_data_path);
+
+namespace VIO {
+
+class VideoDataProviderFixture : public ::testing::Test {
+ public:
+  VideoDataProviderFixture()
+      : dataset_path_(FLAGS_test_data_path + "/test_video_dataset") {}
+
+ protected:
+  void SetUp() override {
+    std::filesystem::create_directories(dataset_path_);
+    std::ofstream imu_file(dataset_path_ + "/imu.csv");
+    imu_file << "#timestamp [ns],w_x,w_y,w_z,a_x,a_y,a_z\n";
+    for (size_t i = 0u; i < kNrImu; ++i) {
+      imu_file << 100 * i << ",1,2,3,4,5," << i << "\n";
+    }
+    std::ofstream frames_file(dataset_path_ + "/frames.csv");
+    frames_file << "#timestamp [ns]\n";
+    for (size_t k = 0u; k < kNrFrames; ++k) {
+      frames_file << 1000 * (k + 1) << "\n";
+    }
+  }
+
+  void TearDown() override { std::filesystem::remove_all(dataset_path_); }
+
+  //! Writes the left stream, uniform images of intensity 40 * k.
+  //! @return False if no lossless encoder is available.
+  bool writeLeftStream() const {
+    const cv::Size size(kCols, kRows);
+    cv::VideoWriter writer(dataset_path_ + "/left.mkv",
+                           cv::VideoWriter::fourcc('F', 'F', 'V', '1'),
+                           20.0,
+                           size,
+                           true);
+    if (!writer.isOpened()) return false;
+    for (size_t k = 0u; k < kNrFrames; ++k) {
+      writer.write(cv::Mat(size, CV_8UC3, cv::Scalar::all(40.0 * k)));
+    }
+    return true;
+  }
+
+ protected:
+  static constexpr size_t kNrImu = 20u;
+  static constexpr size_t kNrFrames = 4u;
+  static constexpr int kRows = 32;
+  static constexpr int kCols = 48;
+  const std::string dataset_path_;
+};
+
+TEST_F(VideoDataProviderFixture, DataProviderSendsAllData) {
+  if (!writeLeftStream()) {
+    GTEST_SKIP() << "No FFV1 video encoder available.";
+  }
+  VioParams vio_params(FLAGS_test_data_path + "/EurocParams");
+  vio_params.parallel_run_ = true;
+  vio_params.frontend_params_.stereo_matching_params_.equalize_image_ = false;
+  VideoDataProvider data_provider(dataset_path_, 1, 100, vio_params);
+  EXPECT_EQ(data_provider.getNrFrames(), kNrFrames);
+  EXPECT_FALSE(data_provider.hasRightStream());
+  EXPECT_FALSE(data_provider.hasDepthStream());
+
+  std::vector<ImuMeasurement> imu_measurements;
+  std::vector<FrameId> left_ids;
+  std::vector<Timestamp> left_timestamps;
+  std::vector<double> left_intensities;
+  data_provider.registerImuSingleCallback(
+      [&imu_measurements](const ImuMeasurement& imu_meas) {
+        imu_measurements.push_back(imu_meas);
+      });
+  data_provider.registerLeftFrameCallback([&](Frame::UniquePtr frame) {
+    left_ids.push_back(frame->id_);
+    left_timestamps.push_back(frame->timestamp_);
+    EXPECT_EQ(frame->img_.type(), CV_8UC1);
+    left_intensities.push_back(cv::mean(frame->img_)[0]);
+  });
+  EXPECT_FALSE(data_provider.spin());
+  EXPECT_FALSE(data_provider.hasData());
+
+  ASSERT_EQ(imu_measurements.size(), kNrImu);
+  // Acceleration first.
+  EXPECT_EQ(imu_measurements.back().timestamp_, 1900);
+  EXPECT_EQ(imu_measurements.back().acc_gyr_(0), 4.0);
+  EXPECT_EQ(imu_measurements.back().acc_gyr_(2), 19.0);
+  EXPECT_EQ(imu_measurements.back().acc_gyr_(3), 1.0);
+
+  // Starts at initial_k = 1, and is clipped to the nr of frames.
+  EXPECT_EQ(left_ids, std::vector<FrameId>({1u, 2u, 3u}));
+  EXPECT_EQ(left_timestamps, std::vector<Timestamp>({2000, 3000, 4000}));
+  ASSERT_EQ(left_intensities.size(), 3u);
+  for (size_t i = 0u; i < left_intensities.size(); ++i) {
+    EXPECT_NEAR(left_intensities[i], 40.0 * (i + 1u), 2.0);
+  }
+}
+
+TEST(testVideoDataProvider, UnpackDepth) {
+  cv::Mat depth(3, 5, CV_16UC1);
+  cv::randu(depth, 0, 65535);
+  // Native 16-bit frames are used as is.
+  EXPECT_EQ(VideoDataProvider::unpackDepth(depth).data, depth.data);
+
+  cv::Mat packed(depth.size(), CV_8UC3, cv::Scalar::all(0));
+  for (int v = 0; v < depth.rows; ++v) {
+    for (int u = 0; u < depth.cols; ++u) {
+      const uint16_t& d = depth.at<uint16_t>(v, u);
+      packed.at<cv::Vec3b>(v, u) = cv::Vec3b(d & 0xFF, d >> 8, 0);
+    }
+  }
+  const cv::Mat unpacked = VideoDataProvider::unpackDepth(packed);
+  ASSERT_EQ(unpacked.type(), CV_16UC1);
+  EXPECT_EQ(cv::norm(unpacked, depth, cv::NORM_INF), 0.0);
+}
+
+}  // namespace VIO
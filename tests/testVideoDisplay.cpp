@@ -0,0 +1,72 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testVideoDisplay.cpp
+ * @brief  test VideoDisplay
+ * @author Antoni Rosinol
+ */
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <opencv2/videoio.hpp>
+
+#include "kimera-vio/utils/FilesystemUtils.h"
+#include "kimera-vio/visualizer/DisplayFactory.h"
+#include "kimera-vio/visualizer/VideoDisplay.h"
+
+namespace VIO {
+
+namespace {
+DisplayInputBase::UniquePtr makeImageInput(const cv::Mat& image) {
+  DisplayInputBase::UniquePtr input = std::make_unique<DisplayInputBase>();
+  input->images_to_display_.push_back(ImageToDisplay("Tracked Frame", image));
+  return input;
+}
+}  // namespace
+
+TEST(testVideoDisplay, isRegistered) {
+  EXPECT_TRUE(DisplayFactory::isDisplayRegistered(DisplayType::kVideo));
+}
+
+TEST(testVideoDisplay, encodesEachImageStream) {
+  VideoDisplayParams::Ptr params = std::make_shared<VideoDisplayParams>();
+  params->output_path_ = ::testing::TempDir();
+  // Available in every OpenCV build, unlike H.264.
+  params->codec_ = "mjpg";
+  params->hardware_acceleration_ = false;
+  params->record_3d_ = false;
+
+  {
+    VideoDisplay display(params, nullptr);
+    // Grey, color, and odd-sized frames go in the same video.
+    display.spinOnce(makeImageInput(cv::Mat(240, 320, CV_8UC1, 128)));
+    display.spinOnce(
+        makeImageInput(cv::Mat(240, 320, CV_8UC3, cv::Scalar(0, 0, 255))));
+    display.spinOnce(makeImageInput(cv::Mat(101, 151, CV_32FC1, 0.5f)));
+    display.spinOnce(makeImageInput(cv::Mat()));
+    EXPECT_EQ(display.getNumberOfFrames("Tracked Frame"), 3u);
+    EXPECT_EQ(display.getNumberOfFrames(VideoDisplay::k3dStreamName), 0u);
+    EXPECT_FALSE(display.isHardwareAccelerated("Tracked Frame"));
+  }
+
+  // Finalized when the display is destroyed.
+  cv::VideoCapture video(
+      common::pathAppend(params->output_path_, "Tracked_Frame.avi"));
+  ASSERT_TRUE(video.isOpened());
+  cv::Mat frame;
+  size_t nr_frames = 0u;
+  while (video.read(frame)) {
+    EXPECT_EQ(frame.size(), cv::Size(320, 240));
+    ++nr_frames;
+  }
+  EXPECT_EQ(nr_frames, 3u);
+}
+
+}  // namespace VIO
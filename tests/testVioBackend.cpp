@@ -18,12 +18,20 @@
 #include <gtest/gtest.h>
 #include <gtsam/base/Vector.h>
 #include <gtsam/geometry/Pose3.h>
+#include <gtsam/navigation/CombinedImuFactor.h>
 #include <gtsam/navigation/ImuBias.h>
+#include <gtsam/nonlinear/Marginals.h>
+#include <gtsam/slam/PriorFactor.h>
 
 #include <algorithm>
+#include <chrono>
 #include <cstdlib>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <optional>
 #include <random>
+#include <vector>
 
 #include "kimera-vio/backend/VioBackend.h"
 #include "kimera-vio/backend/VioBackendFactory.h"
@@ -33,6 +41,7 @@
 #include "kimera-vio/imu-frontend/ImuFrontendParams.h"
 #include "kimera-vio/initial/InitializationBackend.h"
 #include "kimera-vio/utils/ThreadsafeImuBuffer.h"
+#include "kimera-vio/utils/Timer.h"
 
 DECLARE_string(test_data_path);
 
@@ -146,6 +155,151 @@ class BackendFixture : public ::testing::Test {
     }
   }
 
+  static Cal3_S2 createCameraParams() {
+    const double fov = M_PI / 3 * 2;
+    const double img_height = 600;
+    const double img_width = 800;
+    const double fx = img_width / 2 / tan(fov / 2);
+    return Cal3_S2(fx, fx, 0.0, img_width / 2, img_height / 2);
+  }
+
+  StereoCalibPtr createStereoCalibration() const {
+    const Cal3_S2 cam_params = createCameraParams();
+    return StereoCalibPtr(new gtsam::Cal3_S2Stereo(cam_params.fx(),
+                                                   cam_params.fy(),
+                                                   0.0,
+                                                   cam_params.px(),
+                                                   cam_params.py(),
+                                                   baseline));
+  }
+
+  //! The stereo measurements of the scene from the stereo pose.
+  StatusStereoMeasurementsPtr createStereoMeasurements(
+      const std::vector<Point3>& pts,
+      const StereoPoses::value_type& stereo_pose,
+      const gtsam::Pose3& lkf_T_k_stereo = gtsam::Pose3()) const {
+    const Cal3_S2 cam_params = createCameraParams();
+    gtsam::PinholeCamera<Cal3_S2> cam_left(stereo_pose.first, cam_params);
+    gtsam::PinholeCamera<Cal3_S2> cam_right(stereo_pose.second, cam_params);
+    StereoMeasurements measurement_frame;
+    for (size_t l_id = 0u; l_id < pts.size(); l_id++) {
+      const Point2 pt_left = cam_left.project2(pts[l_id]);
+      const Point2 pt_right = cam_right.project2(pts[l_id]);
+      measurement_frame.push_back(std::make_pair(
+          l_id, StereoPoint2(pt_left.x(), pt_right.x(), pt_left.y())));
+    }
+    TrackerStatusSummary tracker_status_valid;
+    tracker_status_valid.kfTrackingStatus_mono_ = TrackingStatus::VALID;
+    tracker_status_valid.kfTrackingStatus_stereo_ = TrackingStatus::VALID;
+    tracker_status_valid.lkf_T_k_stereo_ = lkf_T_k_stereo;
+    return std::make_shared<StatusStereoMeasurements>(
+        std::make_pair(tracker_status_valid, measurement_frame));
+  }
+
+  //! Runs the given backend on the synthetic scene, returns its last state
+  //! and the time spent in the backend (and its last output if requested).
+  //! After the first keyframe, keyframes are given in batches of batch_size.
+  gtsam::Values runBackend(
+      const BackendType& backend_type,
+      double* backend_time_ms,
+      const std::optional<BackendOutputFields>& output_fields = std::nullopt,
+      BackendOutput::Ptr* last_output = nullptr,
+      const size_t& batch_size = 1u,
+      const BackendOutputParams& output_params =
+          BackendOutputParams(false, 0, false),
+      std::vector<BackendOutput::Ptr>* outputs = nullptr,
+      const std::optional<FrameId>& relocalized_kf_id = std::nullopt,
+      size_t* nr_relocalizations = nullptr) {
+    CHECK_NOTNULL(backend_time_ms);
+    *backend_time_ms = 0.0;
+    const std::vector<Point3> pts = createScene();
+    StereoPoses poses;
+    VIO::utils::ThreadsafeImuBuffer imu_buf(-1);
+    createCameraPoses(&poses);
+    createImuBuffer(&imu_buf);
+
+    const StereoCalibPtr stereo_calibration = createStereoCalibration();
+    ImuFrontend imu_frontend(imu_params_, imu_bias_);
+    BackendParams backend_params = backend_params_;
+    backend_params.initial_ground_truth_state_ =
+        VioNavState(poses[0].first, velocity_x_, imu_bias_);
+    VioBackend::UniquePtr vio_backend = nullptr;
+    if (backend_creator_) {
+      vio_backend =
+          backend_creator_(stereo_calibration, backend_params, output_params);
+    } else {
+      vio_backend = BackendFactory::createBackend(backend_type,
+                                                  gtsam::Pose3(),
+                                                  stereo_calibration,
+                                                  backend_params,
+                                                  imu_params_,
+                                                  output_params,
+                                                  false,
+                                                  std::nullopt);
+    }
+    vio_backend->registerImuBiasUpdateCallback(
+        std::bind(&ImuFrontend::updateBias,
+                  std::ref(imu_frontend),
+                  std::placeholders::_1));
+    vio_backend->registerMapUpdateCallback(
+        std::bind(&BackendFixture::map_update_cb, this, std::placeholders::_1));
+    if (output_fields) vio_backend->setOutputFields(*output_fields);
+
+    Timestamp timestamp_km1 =
+        t_start_ - before_start_imu_msgs_ * imu_time_step_;
+    std::vector<BackendInput::UniquePtr> batch;
+    for (FrameId k = 0u; k < num_keyframes_; k++) {
+      const Timestamp timestamp_k = k * keyframe_time_step_ + t_start_;
+      ImuStampS imu_stamps;
+      ImuAccGyrS imu_accgyr;
+      CHECK(imu_buf.getImuDataInterpolatedUpperBorder(
+                timestamp_km1, timestamp_k, &imu_stamps, &imu_accgyr) ==
+            utils::ThreadsafeImuBuffer::QueryResult::kDataAvailable);
+      timestamp_km1 = timestamp_k;
+      const auto& pim =
+          imu_frontend.preintegrateImuMeasurements(imu_stamps, imu_accgyr);
+
+      auto input = std::make_unique<BackendInput>(
+          timestamp_k,
+          createStereoMeasurements(pts, poses[k]),
+          pim,
+          imu_accgyr);
+      if (relocalized_kf_id && k == *relocalized_kf_id + 1u) {
+        // Relocalized (at its true pose) while processing the next keyframe.
+        vio_backend->setRelocalizationPrior(
+            *relocalized_kf_id, poses[*relocalized_kf_id].first, 1e4, 1e4);
+      }
+      const auto tic = utils::Timer::tic();
+      std::vector<BackendOutput::UniquePtr> backend_outputs;
+      if (k == 0u || batch_size <= 1u) {
+        backend_outputs.push_back(vio_backend->spinOnce(*input));
+      } else {
+        batch.push_back(std::move(input));
+        if (batch.size() == batch_size ||
+            k + 1u == static_cast<FrameId>(num_keyframes_)) {
+          backend_outputs = vio_backend->spinOnceBatched(batch);
+          CHECK_EQ(backend_outputs.size(), batch.size());
+          batch.clear();
+        }
+      }
+      *backend_time_ms +=
+          utils::Timer::toc<std::chrono::microseconds>(tic).count() / 1000.0;
+      for (BackendOutput::UniquePtr& backend_output : backend_outputs) {
+        CHECK(backend_output);
+        BackendOutput::Ptr output = std::move(backend_output);
+        if (outputs) outputs->push_back(output);
+        if (last_output) *last_output = output;
+      }
+      imu_frontend.resetIntegrationWithCachedBias();
+    }
+    if (nr_relocalizations) {
+      *nr_relocalizations = vio_backend->getNrRelocalizations();
+    }
+    const gtsam::Values state = vio_backend->getState();
+    last_backend_ = std::move(vio_backend);
+    return state;
+  }
+
  public:
   const double tol = 1e-7;
   //! Number of frames of the synthetic scene
@@ -169,6 +323,33 @@ class BackendFixture : public ::testing::Test {
  public:
   BackendParams backend_params_;
   ImuParams imu_params_;
+  //! Builds the backend of runBackend instead of BackendFactory, if set.
+  std::function<VioBackend::UniquePtr(const StereoCalibPtr&,
+                                      const BackendParams&,
+                                      const BackendOutputParams&)>
+      backend_creator_;
+  //! The backend of the last runBackend.
+  VioBackend::UniquePtr last_backend_;
+};
+
+//! Gives the tests access to the smoother.
+class SmootherTestBackend : public VioBackend {
+ public:
+  using VioBackend::VioBackend;
+  using VioBackend::getSmootherSnapshot;
+  using VioBackend::restoreSmoother;
+  using VioBackend::SmootherSnapshot;
+
+  inline Smoother* getSmoother() const { return smoother_.get(); }
+
+  //! As if the horizon controller had shrunk the horizon to nr_states.
+  void shrinkHorizon(const double& nr_states) {
+    SmootherHorizonControllerParams params;
+    params.min_nr_states = nr_states;
+    params.max_nr_states = nr_states;
+    horizon_controller_ =
+        std::make_unique<SmootherHorizonController>(params, nr_states, 1u);
+  }
 };
 
 TEST_F(BackendFixture, initializationFromGt) {
@@ -177,6 +358,51 @@ TEST_F(BackendFixture, initializationFromGt) {
   // Expect imu bias set
 }
 
+TEST_F(BackendFixture, initialBundleAdjustmentIsCapped) {
+  const std::vector<Point3> pts = createScene();
+  StereoPoses poses;
+  createCameraPoses(&poses);
+  // The stereo RANSAC poses, off the true ones: the BA needs to iterate.
+  const gtsam::Pose3 noise(gtsam::Rot3::Ypr(0.05, -0.02, 0.03),
+                           gtsam::Point3(0.1, -0.05, 0.02));
+
+  // Capped in iterations, then in time (checked after each iteration).
+  for (const auto& caps :
+       {std::make_pair(2, 0.0), std::make_pair(100, 1e-9)}) {
+    BackendParams backend_params = backend_params_;
+    backend_params.initialBAMaxIterations_ = caps.first;
+    backend_params.initialBAMaxTimeSec_ = caps.second;
+    InitializationBackend backend(gtsam::Pose3(),
+                                  createStereoCalibration(),
+                                  backend_params,
+                                  imu_params_,
+                                  BackendOutputParams(false, 0, false),
+                                  false);
+    std::vector<BackendInput::UniquePtr> inputs;
+    for (FrameId k = 0u; k < static_cast<FrameId>(num_keyframes_); k++) {
+      const gtsam::Pose3 lkf_T_k =
+          k == 0u ? gtsam::Pose3()
+                  : poses[k - 1u].first.between(poses[k].first).compose(noise);
+      inputs.push_back(std::make_unique<BackendInput>(
+          k * keyframe_time_step_ + t_start_,
+          createStereoMeasurements(pts, poses[k], lkf_T_k),
+          nullptr,
+          ImuAccGyrS()));
+    }
+
+    const std::vector<gtsam::Pose3> estimated_poses =
+        backend.addInitialVisualStatesAndOptimize(inputs);
+    EXPECT_EQ(estimated_poses.size(), inputs.size());
+    EXPECT_GE(backend.getNrInitialBAIterations(), 1u);
+    if (caps.second > 0.0) {
+      EXPECT_EQ(backend.getNrInitialBAIterations(), 1u);
+    } else {
+      EXPECT_LE(backend.getNrInitialBAIterations(),
+                static_cast<size_t>(caps.first));
+    }
+  }
+}
+
 TEST_F(BackendFixture, robotMovingWithConstantVelocity) {
   // Create cameras
   double fov = M_PI / 3 * 2;
@@ -361,8 +587,299 @@ TEST_F(BackendFixture, robotMovingWithConstantVelocity) {
   }
 }
 
+TEST_F(BackendFixture, projectionBackendSameAsSmartBackend) {
+  double smart_time_ms = 0.0;
+  const gtsam::Values smart_state =
+      runBackend(BackendType::kStereoImu, &smart_time_ms);
+  double projection_time_ms = 0.0;
+  const gtsam::Values projection_state =
+      runBackend(BackendType::kProjection, &projection_time_ms);
+  LOG(INFO) << "Backend time for " << num_keyframes_
+            << " keyframes: smart factors " << smart_time_ms
+            << " [ms], projection factors " << projection_time_ms << " [ms].";
+
+  StereoPoses poses;
+  createCameraPoses(&poses);
+  size_t nr_landmarks = 0u;
+  for (const auto& key_value : projection_state) {
+    if (gtsam::Symbol(key_value.key).chr() == kLandmarkSymbolChar) {
+      ++nr_landmarks;
+    }
+  }
+  EXPECT_EQ(nr_landmarks, createScene().size());
+  for (FrameId f_id = 0u; f_id < static_cast<FrameId>(num_keyframes_);
+       f_id++) {
+    const gtsam::Symbol pose_key('x', f_id);
+    EXPECT_TRUE(assert_equal(
+        poses[f_id].first, projection_state.at<gtsam::Pose3>(pose_key), 1e-5));
+    EXPECT_TRUE(assert_equal(smart_state.at<gtsam::Pose3>(pose_key),
+                             projection_state.at<gtsam::Pose3>(pose_key),
+                             1e-5));
+  }
+}
+
+TEST_F(BackendFixture, slidingWindowBackendSameAsSmartBackend) {
+  // Smaller than the nr of keyframes, to go through the marginalization.
+  static constexpr int kWindowSize = 5;
+  double smart_time_ms = 0.0;
+  const gtsam::Values smart_state =
+      runBackend(BackendType::kStereoImu, &smart_time_ms);
+  backend_params_.slidingWindowSize_ = kWindowSize;
+  double window_time_ms = 0.0;
+  const gtsam::Values window_state =
+      runBackend(BackendType::kSlidingWindow, &window_time_ms);
+  LOG(INFO) << "Backend time for " << num_keyframes_
+            << " keyframes: smart factors " << smart_time_ms
+            << " [ms], sliding window " << window_time_ms << " [ms].";
+
+  StereoPoses poses;
+  createCameraPoses(&poses);
+  size_t nr_landmarks = 0u;
+  for (const auto& key_value : window_state) {
+    if (gtsam::Symbol(key_value.key).chr() == kLandmarkSymbolChar) {
+      ++nr_landmarks;
+    }
+  }
+  EXPECT_GT(nr_landmarks, 0u);
+  EXPECT_LE(nr_landmarks, createScene().size());
+  for (FrameId f_id = 0u; f_id < static_cast<FrameId>(num_keyframes_);
+       f_id++) {
+    const gtsam::Symbol pose_key('x', f_id);
+    // Only the keyframes of the window are in the state.
+    if (f_id + kWindowSize < static_cast<FrameId>(num_keyframes_)) {
+      EXPECT_FALSE(window_state.exists(pose_key));
+      continue;
+    }
+    EXPECT_TRUE(assert_equal(
+        poses[f_id].first, window_state.at<gtsam::Pose3>(pose_key), 1e-5));
+    EXPECT_TRUE(assert_equal(smart_state.at<gtsam::Pose3>(pose_key),
+                             window_state.at<gtsam::Pose3>(pose_key),
+                             1e-5));
+  }
+}
+
+TEST_F(BackendFixture, batchedUpdatesSameAsSequential) {
+  static constexpr size_t kBatchSize = 4u;
+  StereoPoses poses;
+  createCameraPoses(&poses);
+  for (const BackendType& backend_type :
+       {BackendType::kStereoImu, BackendType::kProjection}) {
+    backend_params_.maxBatchedKeyframes_ = 1;
+    double sequential_time_ms = 0.0;
+    const gtsam::Values sequential_state =
+        runBackend(backend_type, &sequential_time_ms);
+    backend_params_.maxBatchedKeyframes_ = kBatchSize;
+    double batched_time_ms = 0.0;
+    BackendOutput::Ptr last_output = nullptr;
+    const gtsam::Values batched_state = runBackend(backend_type,
+                                                   &batched_time_ms,
+                                                   std::nullopt,
+                                                   &last_output,
+                                                   kBatchSize);
+    LOG(INFO) << "Backend time for " << num_keyframes_
+              << " keyframes: sequential " << sequential_time_ms
+              << " [ms], batched " << batched_time_ms << " [ms].";
+
+    ASSERT_TRUE(last_output);
+    EXPECT_EQ(last_output->cur_kf_id_,
+              static_cast<FrameId>(num_keyframes_ - 1));
+    for (FrameId f_id = 0u; f_id < static_cast<FrameId>(num_keyframes_);
+         f_id++) {
+      const gtsam::Symbol pose_key('x', f_id);
+      EXPECT_TRUE(assert_equal(
+          poses[f_id].first, batched_state.at<gtsam::Pose3>(pose_key), 1e-5));
+      EXPECT_TRUE(assert_equal(sequential_state.at<gtsam::Pose3>(pose_key),
+                               batched_state.at<gtsam::Pose3>(pose_key),
+                               1e-5));
+    }
+  }
+}
+
+TEST_F(BackendFixture, slotCompactionKeepsEstimates) {
+  StereoPoses poses;
+  createCameraPoses(&poses);
+  double backend_time_ms = 0.0;
+  BackendOutput::Ptr output = nullptr;
+  backend_params_.factorSlotCompactionPeriod_ = 0;
+  const gtsam::Values state = runBackend(BackendType::kStereoImu,
+                                         &backend_time_ms,
+                                         BackendOutputFields::all(),
+                                         &output);
+  ASSERT_TRUE(output);
+  const size_t nr_slots = output->factor_graph_.size();
+  const size_t nr_factors = output->factor_graph_.nrFactors();
+  // Smart factors are replaced at every keyframe, leaving empty slots.
+  ASSERT_LT(nr_factors, nr_slots);
+
+  backend_params_.factorSlotCompactionPeriod_ = 1;
+  backend_params_.minEmptySlotsRatio_ = 0.0;
+  const gtsam::Values compacted_state = runBackend(BackendType::kStereoImu,
+                                                   &backend_time_ms,
+                                                   BackendOutputFields::all(),
+                                                   &output);
+  ASSERT_TRUE(output);
+  EXPECT_EQ(output->factor_graph_.size(), output->factor_graph_.nrFactors());
+  EXPECT_EQ(output->factor_graph_.nrFactors(), nr_factors);
+  for (FrameId f_id = 0u; f_id < static_cast<FrameId>(num_keyframes_);
+       f_id++) {
+    const gtsam::Symbol pose_key('x', f_id);
+    EXPECT_TRUE(assert_equal(poses[f_id].first,
+                             compacted_state.at<gtsam::Pose3>(pose_key),
+                             1e-5));
+    EXPECT_TRUE(assert_equal(state.at<gtsam::Pose3>(pose_key),
+                             compacted_state.at<gtsam::Pose3>(pose_key),
+                             1e-5));
+  }
+}
+
+TEST_F(BackendFixture, relocalizationPriorReseedsOutputPose) {
+  StereoPoses poses;
+  createCameraPoses(&poses);
+  double backend_time_ms = 0.0;
+  std::vector<BackendOutput::Ptr> outputs;
+  size_t nr_relocalizations = 0u;
+  const FrameId relocalized_kf_id = 4u;
+  const gtsam::Values state = runBackend(BackendType::kStereoImu,
+                                         &backend_time_ms,
+                                         std::nullopt,
+                                         nullptr,
+                                         1u,
+                                         BackendOutputParams(false, 0, false),
+                                         &outputs,
+                                         relocalized_kf_id,
+                                         &nr_relocalizations);
+  EXPECT_EQ(nr_relocalizations, 1u);
+  ASSERT_EQ(outputs.size(), static_cast<size_t>(num_keyframes_));
+  for (FrameId f_id = 0u; f_id < static_cast<FrameId>(num_keyframes_);
+       f_id++) {
+    EXPECT_TRUE(assert_equal(
+        poses[f_id].first, state.at<gtsam::Pose3>(gtsam::Symbol('x', f_id)),
+        1e-5));
+  }
+  // The output pose restarts from the relocalized state.
+  const BackendOutput::Ptr& output = outputs.at(relocalized_kf_id + 1u);
+  EXPECT_TRUE(assert_equal(poses[relocalized_kf_id + 1u].first,
+                           output->W_State_Blkf_.pose_,
+                           1e-5));
+}
+
+TEST_F(BackendFixture, resumeOnlyFromRecentState) {
+  StereoPoses poses;
+  createCameraPoses(&poses);
+  // Off the ground-truth initial state used otherwise.
+  const gtsam::Pose3 resume_pose(Rot3(),
+                                 poses[0].first.translation() +
+                                     gtsam::Vector3(0.0, 1.0, 0.0));
+  const Timestamp max_age = 10;
+  // Recent, too old, and after the first keyframe.
+  for (const Timestamp& resume_timestamp :
+       {t_start_ - 5, t_start_ - 50, t_start_ + 5}) {
+    backend_creator_ = [&](const StereoCalibPtr& stereo_calibration,
+                           const BackendParams& backend_params,
+                           const BackendOutputParams& output_params) {
+      auto backend = std::make_unique<VioBackend>(gtsam::Pose3(),
+                                                  stereo_calibration,
+                                                  backend_params,
+                                                  imu_params_,
+                                                  output_params,
+                                                  false);
+      backend->setResumeState(
+          VioNavStateTimestamped(
+              resume_timestamp, resume_pose, velocity_x_, imu_bias_),
+          max_age);
+      return backend;
+    };
+    double backend_time_ms = 0.0;
+    std::vector<BackendOutput::Ptr> outputs;
+    runBackend(BackendType::kStereoImu,
+               &backend_time_ms,
+               std::nullopt,
+               nullptr,
+               1u,
+               BackendOutputParams(false, 0, false),
+               &outputs);
+    ASSERT_FALSE(outputs.empty());
+    const bool is_resumed = resume_timestamp == t_start_ - 5;
+    EXPECT_TRUE(assert_equal(is_resumed ? resume_pose : poses[0].first,
+                             outputs.front()->W_State_Blkf_.pose_,
+                             1e-5))
+        << "Resume state at timestamp " << resume_timestamp;
+  }
+}
+
+TEST_F(BackendFixture, landmarksDeltaRebuildsLandmarksMap) {
+  double backend_time_ms = 0.0;
+  std::vector<BackendOutput::Ptr> outputs;
+  runBackend(BackendType::kStereoImu,
+             &backend_time_ms,
+             std::nullopt,
+             nullptr,
+             1u,
+             BackendOutputParams(true, 2, true),
+             &outputs);
+  ASSERT_EQ(outputs.size(), static_cast<size_t>(num_keyframes_));
+
+  // Applying the deltas in order gives the map of each output.
+  PointsWithIdMap landmarks;
+  size_t nr_moved = 0u;
+  for (const BackendOutput::Ptr& output : outputs) {
+    const LandmarksDelta& delta = output->landmarks_delta_;
+    for (const auto& lmk : delta.added_) {
+      EXPECT_TRUE(landmarks.find(lmk.first) == landmarks.end());
+      landmarks[lmk.first] = lmk.second;
+    }
+    for (const auto& lmk : delta.moved_) {
+      ASSERT_TRUE(landmarks.find(lmk.first) != landmarks.end());
+      landmarks[lmk.first] = lmk.second;
+    }
+    nr_moved += delta.moved_.size();
+    for (const LandmarkId& lmk_id : delta.removed_) {
+      EXPECT_EQ(landmarks.erase(lmk_id), 1u);
+    }
+
+    ASSERT_EQ(landmarks.size(), output->landmarks_with_id_map_.size());
+    for (const auto& lmk : output->landmarks_with_id_map_) {
+      const auto it = landmarks.find(lmk.first);
+      ASSERT_TRUE(it != landmarks.end());
+      EXPECT_TRUE(gtsam::assert_equal(lmk.second, it->second, tol));
+    }
+  }
+  EXPECT_GT(landmarks.size(), 0u);
+  // The smoother refines the points, without adding them again.
+  EXPECT_GT(nr_moved, 0u);
+}
+
 // make sure you have 2x factors with odom
 // make sure that these factors are between factors and match your input
+TEST_F(BackendFixture, outputOnlyHasRequestedHeavyFields) {
+  double backend_time_ms = 0.0;
+  BackendOutput::Ptr full_output = nullptr;
+  runBackend(BackendType::kStereoImu,
+             &backend_time_ms,
+             BackendOutputFields::all(),
+             &full_output);
+  ASSERT_TRUE(full_output);
+  EXPECT_TRUE(full_output->fields_.state_);
+  EXPECT_FALSE(full_output->state_.empty());
+  EXPECT_GT(full_output->factor_graph_.size(), 0u);
+
+  BackendOutputFields state_only;
+  state_only.state_ = true;
+  BackendOutput::Ptr slim_output = nullptr;
+  runBackend(
+      BackendType::kStereoImu, &backend_time_ms, state_only, &slim_output);
+  ASSERT_TRUE(slim_output);
+  EXPECT_TRUE(slim_output->fields_.state_);
+  EXPECT_FALSE(slim_output->fields_.factor_graph_);
+  EXPECT_FALSE(slim_output->fields_.state_covariance_);
+  EXPECT_EQ(slim_output->state_.size(), full_output->state_.size());
+  EXPECT_EQ(slim_output->factor_graph_.size(), 0u);
+  EXPECT_EQ(slim_output->state_covariance_lkf_.size(), 0);
+  // The light fields do not depend on the requested fields.
+  EXPECT_EQ(slim_output->cur_kf_id_, full_output->cur_kf_id_);
+  EXPECT_TRUE(slim_output->W_State_Blkf_.equals(full_output->W_State_Blkf_));
+}
+
 TEST_F(BackendFixture, robotMovingWithConstantVelocityWithExternalOdometry) {
   // Create cameras
   double fov = M_PI / 3 * 2;
@@ -559,4 +1076,170 @@ TEST_F(BackendFixture, robotMovingWithConstantVelocityWithExternalOdometry) {
   }
 }
 
+TEST_F(BackendFixture, restoreSmootherAfterFailedUpdate) {
+  backend_creator_ = [this](const StereoCalibPtr& stereo_calibration,
+                            const BackendParams& backend_params,
+                            const BackendOutputParams& output_params) {
+    return std::make_unique<SmootherTestBackend>(gtsam::Pose3(),
+                                                 stereo_calibration,
+                                                 backend_params,
+                                                 imu_params_,
+                                                 output_params,
+                                                 false);
+  };
+  double backend_time_ms = 0.0;
+  runBackend(BackendType::kStereoImu, &backend_time_ms);
+  auto* backend = static_cast<SmootherTestBackend*>(last_backend_.get());
+  ASSERT_TRUE(backend);
+  const SmootherTestBackend::SmootherSnapshot snapshot =
+      backend->getSmootherSnapshot();
+  ASSERT_GT(snapshot.factors.nrFactors(), 0u);
+
+  // A factor on a pose without value: the update throws, after adding the
+  // factor and the timestamp to the smoother.
+  const gtsam::Symbol missing_key('x', 1000u);
+  gtsam::NonlinearFactorGraph new_factors;
+  new_factors.emplace_shared<gtsam::PriorFactor<gtsam::Pose3>>(
+      missing_key,
+      gtsam::Pose3(),
+      gtsam::noiseModel::Isotropic::Sigma(6, 0.1));
+  const double latest_timestamp = snapshot.timestamps.rbegin()->second;
+  gtsam::FixedLagSmoother::KeyTimestampMap timestamps;
+  timestamps[missing_key] = latest_timestamp;
+  EXPECT_ANY_THROW(
+      backend->getSmoother()->update(new_factors, gtsam::Values(), timestamps));
+
+  backend->restoreSmoother(snapshot);
+  const Smoother& smoother = *backend->getSmoother();
+  EXPECT_TRUE(smoother.getFactors().equals(snapshot.factors));
+  EXPECT_EQ(smoother.getFactors().size(), snapshot.factors.size());
+  EXPECT_TRUE(gtsam::assert_equal(snapshot.linearization_point,
+                                  smoother.getLinearizationPoint()));
+  EXPECT_EQ(smoother.timestamps(), snapshot.timestamps);
+  EXPECT_EQ(smoother.timestamps().count(missing_key), 0u);
+
+  // The restored smoother still updates.
+  gtsam::Values new_values;
+  new_values.insert(missing_key, gtsam::Pose3());
+  EXPECT_NO_THROW(backend->getSmoother()->update(
+      new_factors, new_values, timestamps));
+}
+
+TEST_F(BackendFixture, rootCliqueCovarianceSameAsMarginals) {
+  SmootherTestBackend backend(gtsam::Pose3(),
+                              StereoCalibPtr(new gtsam::Cal3_S2Stereo()),
+                              backend_params_,
+                              imu_params_,
+                              BackendOutputParams(false, 0, false),
+                              false);
+  Smoother* smoother = backend.getSmoother();
+  ASSERT_TRUE(smoother);
+
+  // A small graph of IMU factors, one state per update: the keys of the
+  // latest update are eliminated last, in the root clique.
+  auto pim_params = gtsam::PreintegrationCombinedParams::MakeSharedU(9.81);
+  pim_params->setAccelerometerCovariance(gtsam::I_3x3 * 1e-3);
+  pim_params->setGyroscopeCovariance(gtsam::I_3x3 * 1e-4);
+  pim_params->setIntegrationCovariance(gtsam::I_3x3 * 1e-8);
+  pim_params->biasAccCovariance = gtsam::I_3x3 * 1e-4;
+  pim_params->biasOmegaCovariance = gtsam::I_3x3 * 1e-5;
+  gtsam::PreintegratedCombinedMeasurements pim(pim_params, imu_bias_);
+  for (size_t i = 0u; i < 10u; ++i) {
+    pim.integrateMeasurement(gtsam::Vector3(0.1, 0.0, 9.81),
+                             gtsam::Vector3(0.0, 0.0, 0.1),
+                             0.01);
+  }
+
+  const FrameId nr_states = 4u;
+  for (FrameId k = 0u; k < nr_states; ++k) {
+    const gtsam::Symbol pose_key(kPoseSymbolChar, k);
+    const gtsam::Symbol vel_key(kVelocitySymbolChar, k);
+    const gtsam::Symbol bias_key(kImuBiasSymbolChar, k);
+    gtsam::NonlinearFactorGraph new_factors;
+    gtsam::Values new_values;
+    new_values.insert(pose_key,
+                      gtsam::Pose3(gtsam::Rot3::Yaw(0.01 * k),
+                                   gtsam::Point3(0.001 * k, 0.0, 0.0)));
+    new_values.insert(vel_key, gtsam::Vector3(0.1, 0.0, 0.0));
+    new_values.insert(bias_key, imu_bias_);
+    if (k == 0u) {
+      new_factors.emplace_shared<gtsam::PriorFactor<gtsam::Pose3>>(
+          pose_key,
+          gtsam::Pose3(),
+          gtsam::noiseModel::Isotropic::Sigma(6, 0.1));
+      new_factors.emplace_shared<gtsam::PriorFactor<gtsam::Vector3>>(
+          vel_key,
+          gtsam::Vector3(0.1, 0.0, 0.0),
+          gtsam::noiseModel::Isotropic::Sigma(3, 0.1));
+      new_factors.emplace_shared<gtsam::PriorFactor<ImuBias>>(
+          bias_key, imu_bias_, gtsam::noiseModel::Isotropic::Sigma(6, 0.1));
+    } else {
+      new_factors.emplace_shared<gtsam::CombinedImuFactor>(
+          gtsam::Symbol(kPoseSymbolChar, k - 1u),
+          gtsam::Symbol(kVelocitySymbolChar, k - 1u),
+          pose_key,
+          vel_key,
+          gtsam::Symbol(kImuBiasSymbolChar, k - 1u),
+          bias_key,
+          pim);
+    }
+    gtsam::FixedLagSmoother::KeyTimestampMap timestamps;
+    for (const gtsam::Key& key : new_values.keys()) {
+      timestamps[key] = static_cast<double>(k);
+    }
+    smoother->update(new_factors, new_values, timestamps);
+  }
+
+  // Pose, velocity and bias blocks, and their cross-covariances.
+  const FrameId last_id = nr_states - 1u;
+  const gtsam::KeyVector keys = {gtsam::Symbol(kPoseSymbolChar, last_id),
+                                 gtsam::Symbol(kVelocitySymbolChar, last_id),
+                                 gtsam::Symbol(kImuBiasSymbolChar, last_id)};
+  gtsam::Matrix covariance;
+  ASSERT_TRUE(backend.getRootCliqueCovariance(keys, &covariance));
+  gtsam::Marginals marginals(smoother->getFactors(),
+                             smoother->getLinearizationPoint(),
+                             gtsam::Marginals::Factorization::CHOLESKY);
+  const gtsam::Matrix expected_covariance =
+      marginals.jointMarginalCovariance(keys).fullMatrix();
+  ASSERT_EQ(covariance.rows(), 15);
+  ASSERT_EQ(covariance.cols(), 15);
+  EXPECT_TRUE(gtsam::assert_equal(expected_covariance, covariance, 1e-7));
+
+  // Not in the root clique: falls back to the full factorization.
+  EXPECT_FALSE(backend.getRootCliqueCovariance(
+      {gtsam::Symbol(kPoseSymbolChar, 0u)}, &covariance));
+}
+
+TEST_F(BackendFixture, restoreSmootherAfterHorizonShrinks) {
+  backend_creator_ = [this](const StereoCalibPtr& stereo_calibration,
+                            const BackendParams& backend_params,
+                            const BackendOutputParams& output_params) {
+    return std::make_unique<SmootherTestBackend>(gtsam::Pose3(),
+                                                 stereo_calibration,
+                                                 backend_params,
+                                                 imu_params_,
+                                                 output_params,
+                                                 false);
+  };
+  double backend_time_ms = 0.0;
+  runBackend(BackendType::kStereoImu, &backend_time_ms);
+  auto* backend = static_cast<SmootherTestBackend*>(last_backend_.get());
+  ASSERT_TRUE(backend);
+  const SmootherTestBackend::SmootherSnapshot snapshot =
+      backend->getSmootherSnapshot();
+  EXPECT_EQ(snapshot.lag, backend_params_.nr_states_);
+
+  // Shorter than the time between keyframes: all the keys but the latest
+  // ones would be marginalized with this lag.
+  const double nr_states = 1e-9;
+  backend->shrinkHorizon(nr_states);
+  backend->restoreSmoother(snapshot);
+  const Smoother& smoother = *backend->getSmoother();
+  EXPECT_TRUE(smoother.getFactors().equals(snapshot.factors));
+  EXPECT_EQ(smoother.timestamps(), snapshot.timestamps);
+  // The shorter lag applies from the next update on.
+  EXPECT_EQ(smoother.smootherLag(), nr_states);
+}
+
 }  // namespace VIO
@@ -22,6 +22,8 @@
 #include <fstream>
 #include <iostream>
 #include <random>
+#include <string>
+#include <vector>
 
 #include "kimera-vio/backend/VioBackend-definitions.h"
 #include "kimera-vio/frontend/StereoVisionImuFrontend-definitions.h"
@@ -31,6 +33,7 @@
 #include "kimera-vio/visualizer/Visualizer3D.h"
 
 DECLARE_string(test_data_path);
+DECLARE_int32(displayed_trajectory_length);
 
 namespace VIO {
 
@@ -133,4 +136,37 @@ TEST_F(VisualizerFixture, spinOnce) {
   EXPECT_NO_THROW(visualizer_->spinOnce(visualizer_input));
 }
 
+TEST_F(VisualizerFixture, visualizeTrajectory3DIncrementally) {
+  const int displayed_trajectory_length = FLAGS_displayed_trajectory_length;
+  FLAGS_displayed_trajectory_length = -1;
+  const auto get_widget_ids = [this]() {
+    WidgetsMap widgets;
+    visualizer_->visualizeTrajectory3D(&widgets);
+    std::vector<std::string> widget_ids;
+    for (const auto& widget : widgets) widget_ids.push_back(widget.first);
+    return widget_ids;
+  };
+  const auto add_poses = [this](const size_t& nr_poses) {
+    for (size_t i = 0u; i < nr_poses; ++i) {
+      visualizer_->addPoseToTrajectory(
+          cv::Affine3d(cv::Vec3d::all(0.0), cv::Vec3d(i, 0.0, 0.0)));
+    }
+  };
+
+  // Widgets of 100 segments, only the last ones are rebuilt.
+  add_poses(250u);
+  EXPECT_EQ(get_widget_ids(),
+            std::vector<std::string>(
+                {"Trajectory 0", "Trajectory 1", "Trajectory 2"}));
+  add_poses(1u);
+  EXPECT_EQ(get_widget_ids(), std::vector<std::string>({"Trajectory 2"}));
+  add_poses(50u);
+  EXPECT_EQ(get_widget_ids(), std::vector<std::string>({"Trajectory 2"}));
+  add_poses(1u);
+  EXPECT_EQ(get_widget_ids(),
+            std::vector<std::string>({"Trajectory 2", "Trajectory 3"}));
+
+  FLAGS_displayed_trajectory_length = displayed_trajectory_length;
+}
+
 }  // namespace VIO
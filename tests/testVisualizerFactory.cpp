@@ -0,0 +1,72 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2017, Massachusetts Institute of Technology,
+ * Cambridge, MA 02139
+ * All Rights Reserved
+ * Authors: Luca Carlone, et al. (see THANKS for the full author list)
+ * See LICENSE for the license information
+ * -------------------------------------------------------------------------- */
+
+/**
+ * @file   testVisualizerFactory.cpp
+ * @brief  test the registries of the VisualizerFactory and DisplayFactory
+ * @author Antoni Rosinol
+ */
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kimera-vio/visualizer/DisplayFactory.h"
+#include "kimera-vio/visualizer/TelemetryVisualizer3D.h"
+#include "kimera-vio/visualizer/Visualizer3DFactory.h"
+
+namespace VIO {
+
+TEST(testVisualizerFactory, telemetryIsAlwaysBuilt) {
+  // Headless builds have the telemetry visualizer and display.
+  EXPECT_TRUE(
+      VisualizerFactory::isVisualizerRegistered(VisualizerType::kTelemetry));
+  EXPECT_TRUE(DisplayFactory::isDisplayRegistered(DisplayType::kTelemetry));
+  EXPECT_EQ(VisualizerFactory::getVisualizerTypeForDisplay(
+                DisplayType::kTelemetry),
+            VisualizerType::kTelemetry);
+  EXPECT_EQ(
+      VisualizerFactory::getVisualizerTypeForDisplay(DisplayType::kPangolin),
+      VisualizerType::kTelemetry);
+  EXPECT_EQ(
+      VisualizerFactory::getVisualizerTypeForDisplay(DisplayType::kOpenCV),
+      VisualizerType::OpenCV);
+
+  Visualizer3D::UniquePtr visualizer = VisualizerFactory::createVisualizer(
+      VisualizerType::kTelemetry,
+      VisualizationType::kPointcloud,
+      BackendType::kStereoImu);
+  ASSERT_TRUE(visualizer);
+  EXPECT_TRUE(dynamic_cast<TelemetryVisualizer3D*>(visualizer.get()));
+}
+
+TEST(testVisualizerFactory, registeredCreatorIsUsed) {
+  // Replaces the telemetry visualizer for this test only.
+  size_t nr_created = 0u;
+  VisualizerFactory::registerVisualizer(
+      VisualizerType::kTelemetry,
+      [&nr_created](const VisualizationType& viz_type, const BackendType&) {
+        ++nr_created;
+        return std::make_unique<TelemetryVisualizer3D>(viz_type);
+      });
+  EXPECT_TRUE(VisualizerFactory::createVisualizer(VisualizerType::kTelemetry,
+                                                  VisualizationType::kNone,
+                                                  BackendType::kStereoImu));
+  EXPECT_EQ(nr_created, 1u);
+
+  VisualizerFactory::registerVisualizer(
+      VisualizerType::kTelemetry,
+      [](const VisualizationType& viz_type, const BackendType&) {
+        return std::make_unique<TelemetryVisualizer3D>(viz_type);
+      });
+  EXPECT_TRUE(VisualizerFactory::createVisualizer(VisualizerType::kTelemetry,
+                                                  VisualizationType::kNone,
+                                                  BackendType::kStereoImu));
+  EXPECT_EQ(nr_created, 1u);
+}
+
+}  // namespace VIO